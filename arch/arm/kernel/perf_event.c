@@ -13,11 +13,13 @@
 #define pr_fmt(fmt) "hw perfevents: " fmt
 
 #include <linux/bitmap.h>
+#include <linux/cpu_pm.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/export.h>
 #include <linux/perf_event.h>
 #include <linux/platform_device.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock.h>
 #include <linux/uaccess.h>
 
@@ -716,6 +718,80 @@ static struct notifier_block __cpuinitdata pmu_cpu_notifier = {
 	.notifier_call = pmu_cpu_notify,
 };
 
+#ifdef CONFIG_CPU_PM
+/*
+ * The PMU also loses its context when cpuidle powers a CPU down. Take
+ * the counts of the running events before, and program the counters
+ * again after the power came back.
+ */
+static void cpu_pm_pmu_setup(struct arm_pmu *armpmu, unsigned long cmd)
+{
+	struct pmu_hw_events *hw_events = armpmu->get_hw_events();
+	struct perf_event *event;
+	int idx;
+
+	for (idx = 0; idx < armpmu->num_events; idx++) {
+		if (!test_bit(idx, hw_events->used_mask))
+			continue;
+
+		event = hw_events->events[idx];
+		if (!event)
+			continue;
+
+		if (cmd == CPU_PM_ENTER) {
+			armpmu_stop(event, PERF_EF_UPDATE);
+		} else {
+			/* updates the user page, RCU must watch this cpu */
+			RCU_NONIDLE(armpmu_start(event, PERF_EF_RELOAD));
+		}
+	}
+}
+
+static int cpu_pm_pmu_notify(struct notifier_block *b, unsigned long cmd,
+			     void *v)
+{
+	struct pmu_hw_events *hw_events;
+
+	if (!cpu_pmu)
+		return NOTIFY_DONE;
+
+	/* the registers are UNKNOWN after power-up, counting or not */
+	if (cmd == CPU_PM_EXIT && cpu_pmu->reset)
+		cpu_pmu->reset(NULL);
+
+	hw_events = cpu_pmu->get_hw_events();
+	if (bitmap_empty(hw_events->used_mask, cpu_pmu->num_events))
+		return NOTIFY_OK;
+
+	switch (cmd) {
+	case CPU_PM_ENTER:
+		cpu_pmu->stop();
+		cpu_pm_pmu_setup(cpu_pmu, cmd);
+		break;
+	case CPU_PM_EXIT:
+	case CPU_PM_ENTER_FAILED:
+		cpu_pm_pmu_setup(cpu_pmu, cmd);
+		cpu_pmu->start();
+		break;
+	default:
+		return NOTIFY_DONE;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpu_pm_pmu_notifier = {
+	.notifier_call = cpu_pm_pmu_notify,
+};
+
+static void __init cpu_pm_pmu_register(void)
+{
+	cpu_pm_register_notifier(&cpu_pm_pmu_notifier);
+}
+#else
+static inline void cpu_pm_pmu_register(void) { }
+#endif
+
 /*
  * CPU PMU identification and registration.
  */
@@ -771,6 +847,7 @@ init_hw_perf_events(void)
 			cpu_pmu->name, cpu_pmu->num_events);
 		cpu_pmu_init(cpu_pmu);
 		register_cpu_notifier(&pmu_cpu_notifier);
+		cpu_pm_pmu_register();
 		armpmu_register(cpu_pmu, "cpu", PERF_TYPE_RAW);
 	} else {
 		pr_info("no hardware support available\n");
@@ -229,6 +229,9 @@
 /* spi controller just suppport 20Mhz */
 #define SPI_MAX_FREQUENCY 80000000
 
+/* above this SCLK the master samples with a delay (SDC) */
+#define SPI_SAMPLE_DELAY_FREQUENCY 40000000
+
 /* distinguish sdram and sram address */
 #define SPI_RAM_BOUNDAY   (0x80000000)
 
@@ -21,6 +21,10 @@
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/syscore_ops.h>
+#include <linux/notifier.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <mach/includes.h>
 #include <plat/sys_config.h>
 
@@ -30,6 +34,256 @@ __ccu_clk_t aw_clock[AW_CCU_CLK_CNT];
 
 static struct clk_lookup lookups[AW_CCU_CLK_CNT];
 
+/*
+ * Rates are cached per clock, tagged with the generation of the clock
+ * tree they were read at. The rate of a clock is computed from the
+ * registers of all its ancestors, so any rate or parent change bumps
+ * the generation and drops every cached rate at once. Reading a cached
+ * rate takes no lock.
+ */
+static atomic_t aw_clk_gen = ATOMIC_INIT(1);
+
+/* serializes batches, the clock locks are taken inside it */
+static DEFINE_SPINLOCK(aw_clk_batch_lock);
+
+static inline void __clk_cache_set(struct clk *clk, unsigned int gen, unsigned long rate)
+{
+    clk->rate_gen = 0;
+    smp_wmb();
+    clk->rate_cache = rate;
+    smp_wmb();
+    clk->rate_gen = gen;
+}
+
+static inline int __clk_cache_get(struct clk *clk, unsigned long *rate)
+{
+    unsigned int gen = ACCESS_ONCE(clk->rate_gen);
+
+    smp_rmb();
+    *rate = ACCESS_ONCE(clk->rate_cache);
+    smp_rmb();
+
+    return gen && gen == ACCESS_ONCE(clk->rate_gen) &&
+           gen == (unsigned int)atomic_read(&aw_clk_gen);
+}
+
+/* the clock tree changed, 0 is left out as it marks an empty cache */
+static inline void __clk_tree_changed(void)
+{
+    if (unlikely(atomic_inc_return(&aw_clk_gen) == 0))
+        atomic_inc(&aw_clk_gen);
+}
+
+/* read the rate of a clock from the registers, with clk->lock held */
+static unsigned long __clk_read_rate(struct clk *clk)
+{
+    unsigned int gen = atomic_read(&aw_clk_gen);
+
+    /* a change after this point must not be hidden by the new entry */
+    rmb();
+    clk->aw_clk->rate = clk->ops->get_rate(clk->aw_clk->id);
+    __clk_cache_set(clk, gen, (unsigned long)clk->aw_clk->rate);
+
+    return (unsigned long)clk->aw_clk->rate;
+}
+
+/* standby reprograms the plls behind our back */
+static void aw_clk_resume(void)
+{
+    __clk_tree_changed();
+}
+
+static struct syscore_ops aw_clk_syscore_ops = {
+    .resume = aw_clk_resume,
+};
+
+/*
+ * Rate change notifiers, with the semantics of the common clock
+ * framework: PRE_RATE_CHANGE before a change reaches the registers,
+ * POST_RATE_CHANGE after it, ABORT_RATE_CHANGE if a PRE callback
+ * refused it. A change notifies the clock and every clock below it,
+ * so the users of a shared pll hear about it through their own clock.
+ * The pre notification of a clock below the changed one carries its
+ * rate scaled by the change, the dividers between them are assumed
+ * unchanged. Without any notifier registered nothing of this runs and
+ * clk_set_rate() stays callable from atomic context.
+ */
+static struct srcu_notifier_head aw_clk_nh[AW_CCU_CLK_CNT];
+static unsigned int aw_clk_nb_cnt[AW_CCU_CLK_CNT];
+static unsigned int aw_clk_nb_total;
+static DEFINE_MUTEX(aw_clk_notify_lock);
+
+/* rates of the clocks involved in the change going on, under aw_clk_notify_lock */
+static unsigned long aw_clk_old[AW_CCU_CLK_CNT];
+static unsigned long aw_clk_new[AW_CCU_CLK_CNT];
+static u8 aw_clk_affected[AW_CCU_CLK_CNT];
+
+static inline int __clk_valid_id(__aw_ccu_clk_id_e id)
+{
+    return (id > AW_SYS_CLK_NONE) && (id < AW_CCU_CLK_CNT) && (id != AW_CCU_CLK_NULL);
+}
+
+/* is clk id below root in the clock tree (or root itself) */
+static int __clk_is_below(__aw_ccu_clk_id_e id, __aw_ccu_clk_id_e root)
+{
+    int depth;
+
+    /* the tree is a handful of levels deep, the bound guards against loops */
+    for (depth = 0; depth < 16 && __clk_valid_id(id); depth++) {
+        if (id == root)
+            return 1;
+        if (aw_clock[id].aw_clk->parent == id)
+            break;
+        id = aw_clock[id].aw_clk->parent;
+    }
+
+    return 0;
+}
+
+static int __clk_notify(__aw_ccu_clk_id_e id, unsigned long msg,
+                        unsigned long old_rate, unsigned long new_rate)
+{
+    struct clk_notifier_data cnd;
+
+    cnd.clk = &aw_clock[id];
+    cnd.old_rate = old_rate;
+    cnd.new_rate = new_rate;
+
+    return srcu_notifier_call_chain(&aw_clk_nh[id], msg, &cnd);
+}
+
+/*
+ * Mark the clocks with notifiers below the targets of ops, note their
+ * current rates and estimate the ones they will have afterwards.
+ * Returns the number of clocks to notify.
+ */
+static int __clk_notify_prepare(const struct clk_batch_op *ops, int count)
+{
+    __aw_ccu_clk_id_e id, target;
+    unsigned long before;
+    int i, nr = 0;
+
+    memset(aw_clk_affected, 0, sizeof(aw_clk_affected));
+
+    for (id = 0; id < AW_CCU_CLK_CNT; id++) {
+        if (!aw_clk_nb_cnt[id])
+            continue;
+        for (i = 0; i < count; i++)
+            if (__clk_is_below(id, ops[i].clk->aw_clk->id))
+                break;
+        if (i == count)
+            continue;
+        aw_clk_affected[id] = 1;
+        aw_clk_old[id] = clk_get_rate(&aw_clock[id]);
+        aw_clk_new[id] = aw_clk_old[id];
+        nr++;
+    }
+    if (!nr)
+        return 0;
+
+    /* the targets are tracked too, to scale the clocks below them */
+    for (i = 0; i < count; i++) {
+        target = ops[i].clk->aw_clk->id;
+        if (!aw_clk_affected[target]) {
+            aw_clk_affected[target] = 2;
+            aw_clk_old[target] = clk_get_rate(ops[i].clk);
+            aw_clk_new[target] = aw_clk_old[target];
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (ops[i].type != CLK_BATCH_RATE)
+            continue;
+        target = ops[i].clk->aw_clk->id;
+        before = aw_clk_new[target];
+        for (id = 0; id < AW_CCU_CLK_CNT; id++) {
+            if (!aw_clk_affected[id])
+                continue;
+            if (id == target)
+                aw_clk_new[id] = ops[i].rate;
+            else if (before && __clk_is_below(id, target))
+                aw_clk_new[id] = div64_u64((u64)aw_clk_new[id] * ops[i].rate, before);
+        }
+    }
+
+    return nr;
+}
+
+/* send msg to the marked clocks, up to (not including) the one at stop */
+static int __clk_notify_send(unsigned long msg, __aw_ccu_clk_id_e stop)
+{
+    __aw_ccu_clk_id_e id;
+    int ret;
+
+    for (id = 0; id < stop; id++) {
+        if (aw_clk_affected[id] != 1)
+            continue;
+        if (msg == POST_RATE_CHANGE)
+            aw_clk_new[id] = clk_get_rate(&aw_clock[id]);
+        ret = __clk_notify(id, msg, aw_clk_old[id], aw_clk_new[id]);
+        if ((msg == PRE_RATE_CHANGE) && (ret & NOTIFY_STOP_MASK)) {
+            CCU_INF("%s: change refused by a notifier of %s\n", __func__,
+                    aw_clock[id].aw_clk->name);
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+int clk_notifier_register(struct clk *clk, struct notifier_block *nb)
+{
+    __aw_ccu_clk_id_e id;
+    int ret;
+
+    if ((clk == NULL) || IS_ERR(clk) || (nb == NULL)) {
+        CCU_ERR("%s: invalid handle\n", __func__);
+        return -EINVAL;
+    }
+
+    id = clk->aw_clk->id;
+    mutex_lock(&aw_clk_notify_lock);
+    if (!aw_clk_nb_cnt[id])
+        srcu_init_notifier_head(&aw_clk_nh[id]);
+    ret = srcu_notifier_chain_register(&aw_clk_nh[id], nb);
+    if (!ret) {
+        aw_clk_nb_cnt[id]++;
+        aw_clk_nb_total++;
+    }
+    mutex_unlock(&aw_clk_notify_lock);
+
+    return ret;
+}
+EXPORT_SYMBOL(clk_notifier_register);
+
+int clk_notifier_unregister(struct clk *clk, struct notifier_block *nb)
+{
+    __aw_ccu_clk_id_e id;
+    int ret;
+
+    if ((clk == NULL) || IS_ERR(clk) || (nb == NULL)) {
+        CCU_ERR("%s: invalid handle\n", __func__);
+        return -EINVAL;
+    }
+
+    id = clk->aw_clk->id;
+    mutex_lock(&aw_clk_notify_lock);
+    if (!aw_clk_nb_cnt[id]) {
+        mutex_unlock(&aw_clk_notify_lock);
+        return -ENOENT;
+    }
+    ret = srcu_notifier_chain_unregister(&aw_clk_nh[id], nb);
+    if (!ret) {
+        aw_clk_nb_total--;
+        if (--aw_clk_nb_cnt[id] == 0)
+            srcu_cleanup_notifier_head(&aw_clk_nh[id]);
+    }
+    mutex_unlock(&aw_clk_notify_lock);
+
+    return ret;
+}
+EXPORT_SYMBOL(clk_notifier_unregister);
+
 /*
  * clock manage initialize.
  *
@@ -126,6 +380,8 @@ int clk_init(void)
         }
     }
 
+    register_syscore_ops(&aw_clk_syscore_ops);
+
     return 0;
 }
 arch_initcall(clk_init);
@@ -186,9 +442,11 @@ unsigned long clk_get_rate(struct clk *clk)
         return 0;
     }
 
+    if (__clk_cache_get(clk, &ret))
+        return ret;
+
     CCU_LOCK(&clk->lock, flags);
-    clk->aw_clk->rate = clk->ops->get_rate(clk->aw_clk->id);
-    ret = (unsigned long)clk->aw_clk->rate;
+    ret = __clk_read_rate(clk);
     CCU_UNLOCK(&clk->lock, flags);
 
     CCU_DBG("%s: %s current rate is %llu\n", __func__, clk->aw_clk->name, clk->aw_clk->rate);
@@ -197,8 +455,27 @@ unsigned long clk_get_rate(struct clk *clk)
 }
 EXPORT_SYMBOL(clk_get_rate);
 
+/* set the rate with clk->lock held, the registers may have changed on failure too */
+static int __clk_set_rate(struct clk *clk, unsigned long rate)
+{
+    int ret = clk->ops->set_rate(clk->aw_clk->id, rate);
+
+    __clk_tree_changed();
+    return ret;
+}
+
+static int __clk_set_parent(struct clk *clk, struct clk *parent)
+{
+    int ret = clk->ops->set_parent(clk->aw_clk->id, parent->aw_clk->id);
+
+    __clk_tree_changed();
+    clk->aw_clk->parent = clk->ops->get_parent(clk->aw_clk->id);
+    return ret;
+}
+
 int clk_set_rate(struct clk *clk, unsigned long rate)
 {
+    struct clk_batch_op op;
     DEFINE_FLAGS(flags);
 
     if (clk == NULL || IS_ERR(clk)) {
@@ -206,9 +483,18 @@ int clk_set_rate(struct clk *clk, unsigned long rate)
         return -EINVAL;
     }
 
+    if (ACCESS_ONCE(aw_clk_nb_total)) {
+        /* a batch of one, that path sends the notifications */
+        memset(&op, 0, sizeof(op));
+        op.clk = clk;
+        op.type = CLK_BATCH_RATE;
+        op.rate = rate;
+        return clk_apply_batch(&op, 1);
+    }
+
     CCU_LOCK(&clk->lock, flags);
-    if (clk->ops->set_rate(clk->aw_clk->id, rate) == 0) {
-        clk->aw_clk->rate = clk->ops->get_rate(clk->aw_clk->id);
+    if (__clk_set_rate(clk, rate) == 0) {
+        __clk_read_rate(clk);
         CCU_UNLOCK(&clk->lock, flags);
         CCU_DBG("%s: set %s rate to %lu, actual rate is %llu\n", __func__,
                 clk->aw_clk->name, rate, clk->aw_clk->rate);
@@ -246,6 +532,7 @@ EXPORT_SYMBOL(clk_get_parent);
 
 int clk_set_parent(struct clk *clk, struct clk *parent)
 {
+    struct clk_batch_op op;
     DEFINE_FLAGS(flags);
 
     if ((clk == NULL) || IS_ERR(clk) ||
@@ -254,10 +541,17 @@ int clk_set_parent(struct clk *clk, struct clk *parent)
         return -EINVAL;
     }
 
+    if (ACCESS_ONCE(aw_clk_nb_total)) {
+        memset(&op, 0, sizeof(op));
+        op.clk = clk;
+        op.type = CLK_BATCH_PARENT;
+        op.parent = parent;
+        return clk_apply_batch(&op, 1);
+    }
+
     CCU_LOCK(&clk->lock, flags);
-    if (clk->ops->set_parent(clk->aw_clk->id, parent->aw_clk->id) == 0) {
-        clk->aw_clk->parent = clk->ops->get_parent(clk->aw_clk->id);
-        clk->aw_clk->rate   = clk->ops->get_rate(clk->aw_clk->id);
+    if (__clk_set_parent(clk, parent) == 0) {
+        __clk_read_rate(clk);
         CCU_UNLOCK(&clk->lock, flags);
         CCU_DBG("%s: set %s parent to %s, actual parent is %s, current rate is %llu\n",
                 __func__, clk->aw_clk->name, parent->aw_clk->name,
@@ -273,6 +567,215 @@ int clk_set_parent(struct clk *clk, struct clk *parent)
 }
 EXPORT_SYMBOL(clk_set_parent);
 
+static int __clk_apply_batch(const struct clk_batch_op *ops, int count)
+{
+    const struct clk_batch_op *op;
+    int i, ret = 0;
+    DEFINE_FLAGS(flags);
+
+    CCU_LOCK(&aw_clk_batch_lock, flags);
+    for (i = 0; i < count; i++) {
+        op = &ops[i];
+
+        spin_lock(&op->clk->lock);
+        if (op->type == CLK_BATCH_PARENT)
+            ret = __clk_set_parent(op->clk, op->parent);
+        else
+            ret = __clk_set_rate(op->clk, op->rate);
+        spin_unlock(&op->clk->lock);
+
+        if (ret) {
+            CCU_ERR("%s: entry %d on %s failed\n", __func__, i,
+                    op->clk->aw_clk->name);
+            ret = -1;
+            break;
+        }
+    }
+    CCU_UNLOCK(&aw_clk_batch_lock, flags);
+
+    CCU_DBG("%s: %d of %d changes applied\n", __func__, i, count);
+
+    return ret;
+}
+
+/*
+ * Apply several rate and parent changes in one locked sequence, e.g. a
+ * pll and the dividers below it. The changes are made in array order;
+ * the first one that fails stops the batch, the ones before it stay.
+ * With notifiers on the clocks involved the pre notifications go out
+ * once for the whole batch, and the post ones after it.
+ *
+ * Returns 0, -EINVAL for a bad entry, -EBUSY if a notifier refused
+ * the change, or -1 if a change failed.
+ */
+int clk_apply_batch(const struct clk_batch_op *ops, int count)
+{
+    const struct clk_batch_op *op;
+    int i, ret, refused;
+
+    for (i = 0; i < count; i++) {
+        op = &ops[i];
+        if ((op->clk == NULL) || IS_ERR(op->clk) ||
+            ((op->type == CLK_BATCH_PARENT) &&
+             ((op->parent == NULL) || IS_ERR(op->parent)))) {
+            CCU_ERR("%s: invalid handle in entry %d\n", __func__, i);
+            return -EINVAL;
+        }
+    }
+
+    if (!ACCESS_ONCE(aw_clk_nb_total))
+        return __clk_apply_batch(ops, count);
+
+    might_sleep();
+    mutex_lock(&aw_clk_notify_lock);
+    if (!__clk_notify_prepare(ops, count)) {
+        ret = __clk_apply_batch(ops, count);
+        mutex_unlock(&aw_clk_notify_lock);
+        return ret;
+    }
+
+    refused = __clk_notify_send(PRE_RATE_CHANGE, AW_CCU_CLK_CNT);
+    if (refused >= 0) {
+        /* the ones told before the refusal hear it is off */
+        __clk_notify_send(ABORT_RATE_CHANGE, refused);
+        mutex_unlock(&aw_clk_notify_lock);
+        return -EBUSY;
+    }
+
+    ret = __clk_apply_batch(ops, count);
+    __clk_notify_send(POST_RATE_CHANGE, AW_CCU_CLK_CNT);
+    mutex_unlock(&aw_clk_notify_lock);
+
+    return ret;
+}
+EXPORT_SYMBOL(clk_apply_batch);
+
+#ifdef CONFIG_DEBUG_FS
+/* /sys/kernel/debug/clk/clk_summary, the clock tree as the common clock framework shows it */
+static void clk_summary_show_one(struct seq_file *s, __aw_ccu_clk_id_e id, int level)
+{
+    __aw_ccu_clk_id_e child;
+
+    seq_printf(s, "%*s%-*s %-11d %-10lu\n",
+               level * 3 + 1, "", 30 - level * 3, aw_clock[id].aw_clk->name,
+               aw_clock[id].enable, clk_get_rate(&aw_clock[id]));
+
+    if (level >= 8)
+        return;
+    for (child = 0; child < AW_CCU_CLK_CNT; child++)
+        if (__clk_valid_id(child) && (child != id) &&
+            (aw_clock[child].aw_clk->parent == id))
+            clk_summary_show_one(s, child, level + 1);
+}
+
+static int clk_summary_show(struct seq_file *s, void *data)
+{
+    __aw_ccu_clk_id_e id, parent;
+
+    seq_printf(s, "   clock                        enable_cnt  rate\n");
+    seq_printf(s, "--------------------------------------------------------\n");
+
+    /* roots: no valid parent, or their own parent */
+    for (id = 0; id < AW_CCU_CLK_CNT; id++) {
+        if (!__clk_valid_id(id))
+            continue;
+        parent = aw_clock[id].aw_clk->parent;
+        if (!__clk_valid_id(parent) || (parent == id))
+            clk_summary_show_one(s, id, 0);
+    }
+
+    return 0;
+}
+
+static int clk_summary_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, clk_summary_show, inode->i_private);
+}
+
+static const struct file_operations clk_summary_fops = {
+    .open       = clk_summary_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+static int __init clk_debug_init(void)
+{
+    struct dentry *root;
+
+    root = debugfs_create_dir("clk", NULL);
+    if (!root)
+        return -ENOMEM;
+
+    if (!debugfs_create_file("clk_summary", S_IRUGO, root, NULL, &clk_summary_fops)) {
+        debugfs_remove_recursive(root);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+late_initcall(clk_debug_init);
+#endif
+
+/*
+ * Gate the module clocks that are on in hardware without anyone having
+ * enabled them, left over from boot0/u-boot. The system clocks stay,
+ * as do the gates that are used without clk_enable(). "clk_ignore_unused"
+ * on the command line keeps everything as the loader left it.
+ */
+static int clk_ignore_unused;
+
+static int __init clk_ignore_unused_setup(char *__unused)
+{
+    clk_ignore_unused = 1;
+    return 1;
+}
+__setup("clk_ignore_unused", clk_ignore_unused_setup);
+
+static const __aw_ccu_clk_id_e aw_clk_keep_on[] = {
+    AW_AHB_CLK_SDRAM,       /* dram controller */
+    AW_MOD_CLK_MBUS,        /* memory bus */
+    AW_APB_CLK_PIO,         /* gpio, driven by register access only */
+    AW_MOD_CLK_SMPTWD,      /* local timers */
+    AW_AHB_CLK_STMR,        /* high speed timer */
+    AW_APB_CLK_UART0,       /* debug console, before its driver is up */
+};
+
+static int __init clk_disable_unused(void)
+{
+    __aw_ccu_clk_id_e id;
+    struct clk *clk;
+    int i, cnt = 0;
+    DEFINE_FLAGS(flags);
+
+    if (clk_ignore_unused) {
+        CCU_INF("not gating unused clocks\n");
+        return 0;
+    }
+
+    for (id = AW_CCU_CLK_NULL + 1; id < AW_CCU_CLK_CNT; id++) {
+        for (i = 0; i < ARRAY_SIZE(aw_clk_keep_on); i++)
+            if (aw_clk_keep_on[i] == id)
+                break;
+        if (i < ARRAY_SIZE(aw_clk_keep_on))
+            continue;
+
+        clk = &aw_clock[id];
+        CCU_LOCK(&clk->lock, flags);
+        if (!clk->enable && (clk->ops->get_status(id) == AW_CCU_CLK_ON)) {
+            clk->ops->set_status(id, AW_CCU_CLK_OFF);
+            CCU_DBG("%s: %s gated\n", __func__, clk->aw_clk->name);
+            cnt++;
+        }
+        CCU_UNLOCK(&clk->lock, flags);
+    }
+
+    CCU_INF("%d unused clocks gated\n", cnt);
+
+    return 0;
+}
+late_initcall(clk_disable_unused);
+
 int clk_reset(struct clk *clk, int reset)
 {
     DEFINE_FLAGS(flags);
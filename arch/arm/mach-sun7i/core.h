@@ -29,4 +29,9 @@
 
 extern struct platform_device sun7i_uart_debug_port;
 
+#define IS_WFI_MODE(cpu)    (readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + CPUX_STATUS(cpu)) & (1<<2))
+
+extern void sun7i_cpu_power_up(int cpu, unsigned long paddr);
+extern void sun7i_cpu_power_down(int cpu);
+
 #endif
@@ -25,6 +25,11 @@
 #include <linux/cpu.h>
 #include <linux/clk.h>
 #include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <plat/sys_config.h>
 #include <linux/cpu.h>
 #include <asm/cpu.h>
@@ -33,6 +38,10 @@
 #include <linux/pm.h>
 #include <linux/regulator/consumer.h>
 #include <mach/includes.h>
+#ifdef CONFIG_THERMAL
+#include <linux/thermal.h>
+#include <linux/sunxi_thermal.h>
+#endif
 
 #define AHB_APB_CLK_ASYNC
 
@@ -50,6 +59,32 @@ static struct clk *clk_sata_pll; /* apb clock handler */
 
 static DEFINE_MUTEX(sunxi_cpu_lock);
 
+/*
+ * transition plans between two entries of sunxi_freq_tbl, built at init:
+ * the order the axi divider and the pll change in so that axi stays
+ * under SUNXI_AXI_MAX, or SUNXI_TRANS_WALK for the checkpoint walk.
+ */
+#define SUNXI_TRANS_AXI_FIRST   (1<<0)  /* set the new axi divider before the pll */
+#define SUNXI_TRANS_AXI_LAST    (1<<1)  /* set the new axi divider after the pll  */
+#define SUNXI_TRANS_WALK        (1<<7)  /* no short safe order, walk the checkpoints */
+static u8 *trans_plan;
+static int trans_cnt;
+
+/*
+ * measured switch times per pair of table entries, in us: the clock
+ * part (pll relock and dividers), the vdd ramp, and the whole switch.
+ */
+struct sunxi_trans_stat {
+    __u32   count;
+    __u32   clk_max;
+    __u32   vdd_max;
+    __u32   total_max;
+    __u64   total_sum;
+};
+static struct sunxi_trans_stat *trans_stat;
+static __u32 trans_latency_max;     /* us, fed to cpuinfo.transition_latency */
+static struct dentry *cpufreq_dbg_root;
+
 static unsigned int cpu_freq_max = SUNXI_CPUFREQ_MAX / 1000;
 static unsigned int cpu_freq_min = SUNXI_CPUFREQ_MIN / 1000;
 
@@ -283,6 +318,115 @@ static inline int __set_cpufreq_hw(struct sunxi_cpu_freq_t *freq)
 }
 
 
+/*
+ * index of the sunxi_freq_tbl entry with the configuration of freq,
+ * or -1 if it is none of them (like the boot configuration).
+ */
+static int __get_freq_index(struct sunxi_cpu_freq_t *freq)
+{
+    int i;
+
+    for (i = 0; i < trans_cnt; i++) {
+        if (sunxi_freq_tbl[i].frequency * 1000 == freq->pll &&
+            sunxi_freq_tbl[i].index == *(__u32 *)&freq->div)
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * the axi clock of pll with the dividers of div, must stay under the
+ * limit in every state a transition goes through.
+ */
+static inline int __axi_ok(__u32 pll, struct sunxi_clk_div_t *div)
+{
+    return pll / div->cpu_div / div->axi_div <= SUNXI_AXI_MAX;
+}
+
+static u8 __calc_trans_plan(struct sunxi_cpu_freq_t *old, struct sunxi_cpu_freq_t *new)
+{
+    if (old->div.cpu_div != new->div.cpu_div)
+        return SUNXI_TRANS_WALK;
+#ifndef AHB_APB_CLK_ASYNC
+    /* ahb and apb hang off the cpu clock, leave them to the walk */
+    if (old->div.ahb_div != new->div.ahb_div || old->div.apb_div != new->div.apb_div)
+        return SUNXI_TRANS_WALK;
+#endif
+    if (old->div.axi_div == new->div.axi_div)
+        return __axi_ok(new->pll, &old->div) ? 0 : SUNXI_TRANS_WALK;
+    /* the new divider at the old pll, then the new pll */
+    if (__axi_ok(old->pll, &new->div) && __axi_ok(new->pll, &new->div))
+        return SUNXI_TRANS_AXI_FIRST;
+    /* the new pll with the old divider, then the new divider */
+    if (__axi_ok(new->pll, &old->div) && __axi_ok(new->pll, &new->div))
+        return SUNXI_TRANS_AXI_LAST;
+
+    return SUNXI_TRANS_WALK;
+}
+
+static void __init __init_trans_plan(void)
+{
+    struct sunxi_cpu_freq_t old, new;
+    int i, j, walks = 0;
+
+    while (sunxi_freq_tbl[trans_cnt].frequency != CPUFREQ_TABLE_END)
+        trans_cnt++;
+
+    trans_plan = kmalloc(trans_cnt * trans_cnt, GFP_KERNEL);
+    if (!trans_plan) {
+        CPUFREQ_ERR("no memory for the transition plans, walk the checkpoints\n");
+        trans_cnt = 0;
+        return;
+    }
+
+    for (i = 0; i < trans_cnt; i++) {
+        old.pll = sunxi_freq_tbl[i].frequency * 1000;
+        old.div = *(struct sunxi_clk_div_t *)&sunxi_freq_tbl[i].index;
+        for (j = 0; j < trans_cnt; j++) {
+            new.pll = sunxi_freq_tbl[j].frequency * 1000;
+            new.div = *(struct sunxi_clk_div_t *)&sunxi_freq_tbl[j].index;
+            trans_plan[i * trans_cnt + j] = __calc_trans_plan(&old, &new);
+            if (trans_plan[i * trans_cnt + j] & SUNXI_TRANS_WALK)
+                walks++;
+        }
+    }
+
+    CPUFREQ_DBG("%d transition plans, %d walk the checkpoints\n",
+                trans_cnt * trans_cnt, walks);
+}
+
+/*
+ * one step for each clock that changes: the pll (which waits for the
+ * lock) once, the axi divider at most once. axi_div of old is what the
+ * hardware runs now, the cpu clock follows the pll by itself.
+ */
+static int __set_cpufreq_fast(struct sunxi_cpu_freq_t *old, struct sunxi_cpu_freq_t *new, u8 plan)
+{
+    struct clk_batch_op ops[4];
+    int cnt = 0;
+
+    /* one locked sequence for the pll and its dividers */
+    memset(ops, 0, sizeof(ops));
+    if (plan & SUNXI_TRANS_AXI_FIRST) {
+        ops[cnt].clk = clk_axi;
+        ops[cnt++].rate = old->pll / new->div.cpu_div / new->div.axi_div;
+    }
+    if (new->pll != old->pll) {
+        ops[cnt].clk = clk_pll;
+        ops[cnt++].rate = new->pll;
+        ops[cnt].clk = clk_cpu;
+        ops[cnt++].rate = new->pll / new->div.cpu_div;
+    }
+    if (plan & SUNXI_TRANS_AXI_LAST) {
+        ops[cnt].clk = clk_axi;
+        ops[cnt++].rate = new->pll / new->div.cpu_div / new->div.axi_div;
+    }
+
+    return clk_apply_batch(ops, cnt);
+}
+
+
 /*
 *********************************************************************************************************
 *                           __set_cpufreq_target
@@ -296,7 +440,9 @@ static inline int __set_cpufreq_hw(struct sunxi_cpu_freq_t *freq)
 *
 *Return     : result, 0 - set frequency successed, !0 - set frequency failed;
 *
-*Notes      : we check two frequency point: 204Mhz, 408Mhz, 816Mhz and 1200Mhz.
+*Notes      : transitions between two table entries use the plan built at init and change
+*             every clock at most once. Others, and plans without a short safe order,
+*             walk the check points: 204Mhz, 408Mhz, 816Mhz and 1200Mhz.
 *             if increase cpu frequency, the flow should be:
 *               low(1:1:1:2) -> 204Mhz(1:1:1:2) -> 204Mhz(1:1:2:2) -> 408Mhz(1:1:2:2)
 *               -> 408Mhz(1:2:2:2) -> 816Mhz(1:2:2:2) -> 816Mhz(1:3:2:2) -> 1200Mhz(1:3:2:2)
@@ -310,6 +456,8 @@ static inline int __set_cpufreq_hw(struct sunxi_cpu_freq_t *freq)
 static int __set_cpufreq_target(struct sunxi_cpu_freq_t *old, struct sunxi_cpu_freq_t *new)
 {
     int     ret = 0;
+    int     old_idx, new_idx;
+    u8      plan = SUNXI_TRANS_WALK;
     struct sunxi_cpu_freq_t old_freq, new_freq;
 
     if(!old || !new) {
@@ -321,7 +469,15 @@ static int __set_cpufreq_target(struct sunxi_cpu_freq_t *old, struct sunxi_cpu_f
 
     CPUFREQ_DBG("cpu: %dMhz->%dMhz\n", old_freq.pll/1000000, new_freq.pll/1000000);
 
-    if(new_freq.pll > old_freq.pll) {
+    old_idx = __get_freq_index(&old_freq);
+    new_idx = __get_freq_index(&new_freq);
+    if (old_idx >= 0 && new_idx >= 0)
+        plan = trans_plan[old_idx * trans_cnt + new_idx];
+
+    if (!(plan & SUNXI_TRANS_WALK)) {
+        ret = __set_cpufreq_fast(&old_freq, &new_freq, plan);
+    }
+    else if(new_freq.pll > old_freq.pll) {
         if((old_freq.pll <= 204000000) && (new_freq.pll >= 204000000)) {
             /* set to 204Mhz (1:1:1:2) */
             old_freq.pll = 204000000;
@@ -481,6 +637,36 @@ static int __set_cpufreq_target(struct sunxi_cpu_freq_t *old, struct sunxi_cpu_f
 }
 
 
+/*
+ * account one successful switch between table entries old_idx and
+ * new_idx, and let cpuinfo.transition_latency follow the slowest one.
+ */
+static void __account_trans(struct cpufreq_policy *policy, int old_idx, int new_idx,
+                            __u32 clk_us, __u32 vdd_us, __u32 total_us)
+{
+    struct sunxi_trans_stat *st;
+
+    if (!trans_stat || old_idx < 0 || new_idx < 0)
+        return;
+
+    st = &trans_stat[old_idx * trans_cnt + new_idx];
+    st->count++;
+    st->total_sum += total_us;
+    if (clk_us > st->clk_max)
+        st->clk_max = clk_us;
+    if (vdd_us > st->vdd_max)
+        st->vdd_max = vdd_us;
+    if (total_us > st->total_max)
+        st->total_max = total_us;
+
+    if (total_us > trans_latency_max) {
+        trans_latency_max = total_us;
+        if (policy)
+            policy->cpuinfo.transition_latency = total_us * 1000;
+    }
+}
+
+
 /*
 *********************************************************************************************************
 *                           sunxi_cpufreq_settarget
@@ -501,6 +687,9 @@ static int sunxi_cpufreq_settarget(struct cpufreq_policy *policy, struct sunxi_c
     struct cpufreq_freqs    freqs;
     struct sunxi_cpu_freq_t cpu_new;
     int                     i;
+    ktime_t                 start, t;
+    __u32                   clk_us, vdd_us = 0;
+    int                     old_idx, new_idx;
 
     #ifdef CONFIG_CPU_FREQ_DVFS
     unsigned int    new_vdd;
@@ -513,6 +702,10 @@ static int sunxi_cpufreq_settarget(struct cpufreq_policy *policy, struct sunxi_c
 	cpu_new = *cpu_freq;
 	sunxi_cpufreq_show("new", &cpu_new);
 
+    old_idx = __get_freq_index(&cpu_cur);
+    new_idx = __get_freq_index(&cpu_new);
+    start = ktime_get();
+
     /* notify that cpu clock will be adjust if needed */
 	if (policy) {
         freqs.cpu = policy->cpu;
@@ -535,6 +728,7 @@ static int sunxi_cpufreq_settarget(struct cpufreq_policy *policy, struct sunxi_c
 
     if(corevdd && (new_vdd > last_vdd)) {
         CPUFREQ_DBG("set core vdd to %d\n", new_vdd);
+        t = ktime_get();
         if(regulator_set_voltage(corevdd, new_vdd*1000, new_vdd*1000)) {
             CPUFREQ_ERR("try to set voltage failed!\n");
 
@@ -547,9 +741,11 @@ static int sunxi_cpufreq_settarget(struct cpufreq_policy *policy, struct sunxi_c
 	        }
             return -EINVAL;
         }
+        vdd_us = ktime_to_us(ktime_sub(ktime_get(), t));
     }
     #endif
 
+    t = ktime_get();
     if(__set_cpufreq_target(&cpu_cur, &cpu_new)){
 
         /* try to set cpu frequency failed */
@@ -582,18 +778,24 @@ static int sunxi_cpufreq_settarget(struct cpufreq_policy *policy, struct sunxi_c
 
         return -EINVAL;
     }
+    clk_us = ktime_to_us(ktime_sub(ktime_get(), t));
 
     #ifdef CONFIG_CPU_FREQ_DVFS
     if(corevdd && (new_vdd < last_vdd)) {
         CPUFREQ_DBG("set core vdd to %d\n", new_vdd);
+        t = ktime_get();
         if(regulator_set_voltage(corevdd, new_vdd*1000, new_vdd*1000)) {
             CPUFREQ_ERR("try to set voltage failed!\n");
             new_vdd = last_vdd;
         }
+        vdd_us = ktime_to_us(ktime_sub(ktime_get(), t));
     }
     last_vdd = new_vdd;
     #endif
 
+    __account_trans(policy, old_idx, new_idx, clk_us, vdd_us,
+                    ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	/* update our current settings */
 	cpu_cur = cpu_new;
 
@@ -823,8 +1025,9 @@ static int sunxi_cpufreq_init(struct cpufreq_policy *policy)
     policy->cpuinfo.min_freq = SUNXI_CPUFREQ_MIN / 1000;
     policy->governor = CPUFREQ_DEFAULT_GOVERNOR;
 
-    /* feed the latency information from the cpu driver */
-    policy->cpuinfo.transition_latency = SUNXI_FREQTRANS_LATENCY;
+    /* feed the latency information from the cpu driver, measured once switched */
+    policy->cpuinfo.transition_latency = trans_latency_max ?
+            trans_latency_max * 1000 : SUNXI_FREQTRANS_LATENCY;
     cpufreq_frequency_table_get_attr(sunxi_freq_tbl, policy->cpu);
 
 #ifdef CONFIG_SMP
@@ -939,6 +1142,164 @@ static struct cpufreq_driver sunxi_cpufreq_driver = {
 };
 
 
+/*
+ * debugfs cpufreq/transitions: one line for each pair of table entries
+ * switched between so far, times in us.
+ */
+static int __trans_stat_show(struct seq_file *m, void *v)
+{
+    struct sunxi_trans_stat st;
+    int i, j;
+
+    seq_printf(m, "transition_latency %u us\n\n", trans_latency_max);
+    seq_printf(m, "%8s %8s %8s %8s %8s %8s %8s\n", "from", "to", "count",
+               "clk_max", "vdd_max", "avg", "max");
+
+    for (i = 0; i < trans_cnt; i++) {
+        for (j = 0; j < trans_cnt; j++) {
+            /* snapshot under the lock settarget runs with */
+            mutex_lock(&sunxi_cpu_lock);
+            st = trans_stat[i * trans_cnt + j];
+            mutex_unlock(&sunxi_cpu_lock);
+
+            if (!st.count)
+                continue;
+            seq_printf(m, "%8u %8u %8u %8u %8u %8llu %8u\n",
+                       sunxi_freq_tbl[i].frequency / 1000,
+                       sunxi_freq_tbl[j].frequency / 1000, st.count,
+                       st.clk_max, st.vdd_max,
+                       div_u64(st.total_sum, st.count), st.total_max);
+        }
+    }
+
+    return 0;
+}
+
+static int __trans_stat_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, __trans_stat_show, NULL);
+}
+
+static const struct file_operations trans_stat_fops = {
+    .open       = __trans_stat_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+static void __init __init_trans_stat(void)
+{
+    if (!trans_cnt)
+        return;
+
+    trans_stat = kzalloc(trans_cnt * trans_cnt * sizeof(struct sunxi_trans_stat),
+                         GFP_KERNEL);
+    if (!trans_stat) {
+        CPUFREQ_ERR("no memory for the transition statistics\n");
+        return;
+    }
+
+    cpufreq_dbg_root = debugfs_create_dir("cpufreq", NULL);
+    if (IS_ERR_OR_NULL(cpufreq_dbg_root))
+        return;
+    if (!debugfs_create_file("transitions", 0444, cpufreq_dbg_root, NULL, &trans_stat_fops)) {
+        debugfs_remove_recursive(cpufreq_dbg_root);
+        cpufreq_dbg_root = NULL;
+    }
+}
+
+
+#ifdef CONFIG_THERMAL
+/*
+ * cooling device of the SoC thermal zone: state n takes the policy
+ * maximum n steps of SUNXI_COOL_STEP below cpu_freq_max, never below
+ * cpu_freq_min. The cap goes in through the policy notifier, so the
+ * governor and the user limits still work under it.
+ */
+#define SUNXI_COOL_STEP     (96000)     /* kHz */
+
+static unsigned long cool_state;
+static struct thermal_cooling_device *cool_dev;
+
+static unsigned int __cool_max_freq(unsigned long state)
+{
+    unsigned int step = state * SUNXI_COOL_STEP;
+
+    if (cpu_freq_max < cpu_freq_min + step)
+        return cpu_freq_min;
+
+    return __get_valid_freq(cpu_freq_max - step);
+}
+
+static int __cool_policy_notify(struct notifier_block *nb, unsigned long event, void *data)
+{
+    struct cpufreq_policy *policy = data;
+
+    if (event == CPUFREQ_ADJUST && cool_state)
+        cpufreq_verify_within_limits(policy, 0, __cool_max_freq(cool_state));
+
+    return 0;
+}
+
+static struct notifier_block cool_policy_nb = {
+    .notifier_call = __cool_policy_notify,
+};
+
+static int __cool_get_max_state(struct thermal_cooling_device *cdev, unsigned long *state)
+{
+    *state = DIV_ROUND_UP(cpu_freq_max - cpu_freq_min, SUNXI_COOL_STEP);
+    return 0;
+}
+
+static int __cool_get_cur_state(struct thermal_cooling_device *cdev, unsigned long *state)
+{
+    *state = cool_state;
+    return 0;
+}
+
+static int __cool_set_cur_state(struct thermal_cooling_device *cdev, unsigned long state)
+{
+    unsigned long max_state;
+
+    __cool_get_max_state(cdev, &max_state);
+    if (state > max_state)
+        return -EINVAL;
+    if (state == cool_state)
+        return 0;
+
+    cool_state = state;
+    CPUFREQ_DBG("thermal cap %uMHz\n", __cool_max_freq(state) / 1000);
+
+    /* both cores share the policy, and cpu0 never goes offline */
+    cpufreq_update_policy(0);
+    return 0;
+}
+
+static const struct thermal_cooling_device_ops cool_ops = {
+    .get_max_state  = __cool_get_max_state,
+    .get_cur_state  = __cool_get_cur_state,
+    .set_cur_state  = __cool_set_cur_state,
+};
+
+static void __init __init_cooling(void)
+{
+    if (cpufreq_register_notifier(&cool_policy_nb, CPUFREQ_POLICY_NOTIFIER)) {
+        CPUFREQ_ERR("no policy notifier, no thermal cooling\n");
+        return;
+    }
+
+    cool_dev = thermal_cooling_device_register(SUNXI_COOLING_CPU, NULL, &cool_ops);
+    if (IS_ERR(cool_dev)) {
+        CPUFREQ_ERR("register the cooling device failed, %ld\n", PTR_ERR(cool_dev));
+        cpufreq_unregister_notifier(&cool_policy_nb, CPUFREQ_POLICY_NOTIFIER);
+        cool_dev = NULL;
+    }
+}
+#else
+static inline void __init_cooling(void) { }
+#endif
+
+
 /*
  * cpu frequency driver init
  */
@@ -991,6 +1352,9 @@ static int __init sunxi_cpufreq_initcall(void)
 		__vftable_show();
 #endif
 
+    __init_trans_plan();
+    __init_trans_stat();
+
     /* init cpu frequency from sysconfig */
     if(__init_freq_syscfg()) {
         CPUFREQ_ERR("%s, use default cpu max/min frequency, max freq: %uMHz, min freq: %uMHz\n",
@@ -1006,6 +1370,8 @@ static int __init sunxi_cpufreq_initcall(void)
 
     /* register cpu frequency driver */
     ret = cpufreq_register_driver(&sunxi_cpufreq_driver);
+    if (!ret)
+        __init_cooling();
 
     return ret;
 }
@@ -40,6 +40,7 @@
 #define SUNXI_CPUFREQ_MAX       (1400000000)    /* config the maximum frequency of sunxi core */
 #define SUNXI_CPUFREQ_MIN       (60000000)      /* config the minimum frequency of sunxi core */
 #define SUNXI_FREQTRANS_LATENCY (2000000)       /* config the transition latency, based on ns */
+#define SUNXI_AXI_MAX           (450000000)     /* the axi clock must never run faster than this */
 
 struct sunxi_clk_div_t {
     __u32   cpu_div:4;      /* division of cpu clock, divide core_pll */
@@ -0,0 +1,311 @@
+/*
+ *  linux/arch/arm/mach-sun7i/cpuidle.c
+ *
+ *  Copyright (C) 2012-2016 Allwinner Ltd.
+ *  All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Two idle states: WFI on each core, and a coupled one for when both
+ * cores are idle, in which cpu1 is powered down the way hotplug does
+ * it. cpu0 stays in WFI meanwhile and takes every wakeup: the spis
+ * routed to cpu1 are moved over for the time, and with the arch timer
+ * cpu0's comparator is armed for whichever core's timer is due first.
+ * On wakeup cpu0 powers cpu1 up again into cpu_resume, and both leave
+ * the state together.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/cpuidle.h>
+#include <linux/cpu_pm.h>
+#include <linux/delay.h>
+#include <linux/io.h>
+#include <asm/cpuidle.h>
+#include <asm/proc-fns.h>
+#include <asm/suspend.h>
+#include <asm/cacheflush.h>
+#include <asm/hardware/gic.h>
+#include <mach/platform.h>
+#include <mach/hardware.h>
+
+#include "core.h"
+
+#define SUN7I_IDLE_STATES	2
+
+/*
+ * The power-up sequence of platsmp.c waits 11ms for the clamp and the
+ * power gate, the power-down 1ms. The defaults cover that with some
+ * margin; measured numbers for a board can be given on the command
+ * line.
+ */
+static unsigned int pd_latency_us = 13000;
+module_param(pd_latency_us, uint, 0444);
+MODULE_PARM_DESC(pd_latency_us, "exit latency of the cpu1 power-down state, us");
+
+static unsigned int pd_residency_us = 100000;
+module_param(pd_residency_us, uint, 0444);
+MODULE_PARM_DESC(pd_residency_us, "target residency of the cpu1 power-down state, us");
+
+static DEFINE_PER_CPU(struct cpuidle_device, sun7i_idle_dev);
+static atomic_t sun7i_idle_barrier;
+static int sun7i_cpu1_down;
+
+/* targets of the spis while cpu1 is down, the sgis and ppis are banked */
+static u32 sun7i_gic_targets[1020 / 4];
+static unsigned int sun7i_gic_irqs;
+
+static void sun7i_gic_move_to_cpu0(void)
+{
+	void __iomem *base = (void __iomem *)SW_VA_GIC_DIST_IO_BASE + GIC_DIST_TARGET;
+	unsigned int i;
+	u32 val;
+
+	for (i = 32 / 4; i < sun7i_gic_irqs / 4; i++) {
+		val = readl_relaxed(base + i * 4);
+		sun7i_gic_targets[i] = val;
+		if (val & 0x02020202)
+			writel_relaxed((val & ~0x02020202) | 0x01010101, base + i * 4);
+	}
+}
+
+static void sun7i_gic_restore(void)
+{
+	void __iomem *base = (void __iomem *)SW_VA_GIC_DIST_IO_BASE + GIC_DIST_TARGET;
+	unsigned int i;
+
+	for (i = 32 / 4; i < sun7i_gic_irqs / 4; i++)
+		if (sun7i_gic_targets[i] & 0x02020202)
+			writel_relaxed(sun7i_gic_targets[i], base + i * 4);
+}
+
+#ifdef CONFIG_ARM_ARCH_TIMER
+/*
+ * The comparator of the physical timer is lost with the core. cpu1
+ * leaves its compare value here, and cpu0 wakes up for the earlier of
+ * the two; the timer of each core is put back afterwards and fires
+ * right away if it is due.
+ */
+static u32 sun7i_cpu1_timer_ctl;
+static u64 sun7i_cpu1_timer_cval;
+
+static inline u32 sun7i_timer_get_ctl(void)
+{
+	u32 val;
+
+	asm volatile("mrc p15, 0, %0, c14, c2, 1" : "=r" (val));
+	return val;
+}
+
+static inline void sun7i_timer_set_ctl(u32 val)
+{
+	asm volatile("mcr p15, 0, %0, c14, c2, 1" : : "r" (val));
+	isb();
+}
+
+static inline u64 sun7i_timer_get_cval(void)
+{
+	u64 val;
+
+	asm volatile("mrrc p15, 2, %Q0, %R0, c14" : "=r" (val));
+	return val;
+}
+
+static inline void sun7i_timer_set_cval(u64 val)
+{
+	asm volatile("mcrr p15, 2, %Q0, %R0, c14" : : "r" (val));
+	isb();
+}
+
+static void sun7i_cpu1_timer_save(void)
+{
+	sun7i_cpu1_timer_ctl = sun7i_timer_get_ctl();
+	sun7i_cpu1_timer_cval = sun7i_timer_get_cval();
+}
+
+static void sun7i_cpu1_timer_restore(void)
+{
+	sun7i_timer_set_cval(sun7i_cpu1_timer_cval);
+	sun7i_timer_set_ctl(sun7i_cpu1_timer_ctl);
+}
+
+/* cpu0: arm the own comparator for cpu1's event if that is earlier */
+static int sun7i_cpu0_timer_arm(u32 *ctl, u64 *cval)
+{
+	/* enabled and not masked */
+	if ((sun7i_cpu1_timer_ctl & 0x3) != 0x1)
+		return 0;
+
+	*ctl = sun7i_timer_get_ctl();
+	*cval = sun7i_timer_get_cval();
+	if ((*ctl & 0x3) == 0x1 && *cval <= sun7i_cpu1_timer_cval)
+		return 0;
+
+	sun7i_timer_set_cval(sun7i_cpu1_timer_cval);
+	sun7i_timer_set_ctl((*ctl & ~0x2) | 0x1);
+	return 1;
+}
+
+static void sun7i_cpu0_timer_disarm(u32 ctl, u64 cval)
+{
+	sun7i_timer_set_cval(cval);
+	sun7i_timer_set_ctl(ctl);
+}
+#else
+static inline void sun7i_cpu1_timer_save(void) { }
+static inline void sun7i_cpu1_timer_restore(void) { }
+static inline int sun7i_cpu0_timer_arm(u32 *ctl, u64 *cval) { return 0; }
+static inline void sun7i_cpu0_timer_disarm(u32 ctl, u64 cval) { }
+#endif
+
+/* the same steps as platform_cpu_die(), cpu0 cuts the power then */
+static int sun7i_cpu1_finish(unsigned long arg)
+{
+	unsigned long actlr;
+
+	sun7i_cpu1_timer_save();
+	sun7i_cpu1_down = 1;
+	smp_wmb();
+
+	/* disable cache */
+	asm("mrc    p15, 0, %0, c1, c0, 0" : "=r" (actlr) );
+	actlr &= ~(1<<2);
+	asm("mcr    p15, 0, %0, c1, c0, 0\n" : : "r" (actlr));
+
+	/* clean and ivalidate L1 cache */
+	flush_cache_all();
+
+	/* execute a CLREX instruction */
+	asm("clrex" : : : "memory", "cc");
+
+	/* switch from SMP mode to AMP mode, out of cache coherency */
+	asm("mrc    p15, 0, %0, c1, c0, 1" : "=r" (actlr) );
+	actlr &= ~(1<<6);
+	asm("mcr    p15, 0, %0, c1, c0, 1\n" : : "r" (actlr));
+
+	isb();
+	dsb();
+
+	while (1)
+		asm("wfi" : : : "memory", "cc");
+
+	return 0;
+}
+
+static void sun7i_idle_cpu1(void)
+{
+	cpu_pm_enter();
+	/* comes back through cpu_resume once cpu0 powered the core up */
+	cpu_suspend(0, sun7i_cpu1_finish);
+	sun7i_cpu1_timer_restore();
+	cpu_pm_exit();
+}
+
+static void sun7i_idle_cpu0(void)
+{
+	u32 ctl = 0;
+	u64 cval = 0;
+	int armed;
+	int k;
+
+	/* cpu1 is offline, the coupled state is just WFI then */
+	if (!cpu_online(1)) {
+		cpu_do_idle();
+		return;
+	}
+
+	for (k = 0; k < 1000; k++) {
+		if (ACCESS_ONCE(sun7i_cpu1_down) && IS_WFI_MODE(1))
+			break;
+		udelay(1);
+	}
+	if (k == 1000)
+		pr_warn("[cpuidle]: cpu1 did not reach WFI\n");
+	/* the timer cpu1 left before it went out of coherency */
+	smp_rmb();
+
+	sun7i_cpu_power_down(1);
+	sun7i_gic_move_to_cpu0();
+	armed = sun7i_cpu0_timer_arm(&ctl, &cval);
+
+	cpu_do_idle();
+
+	if (armed)
+		sun7i_cpu0_timer_disarm(ctl, cval);
+	sun7i_gic_restore();
+
+	sun7i_cpu1_down = 0;
+	smp_wmb();
+	sun7i_cpu_power_up(1, virt_to_phys(cpu_resume));
+}
+
+static int sun7i_enter_pd(struct cpuidle_device *dev,
+			  struct cpuidle_driver *drv,
+			  int index)
+{
+	cpuidle_coupled_parallel_barrier(dev, &sun7i_idle_barrier);
+
+	if (dev->cpu == 0)
+		sun7i_idle_cpu0();
+	else
+		sun7i_idle_cpu1();
+
+	/* cpu0 returns only after cpu1 is up again */
+	cpuidle_coupled_parallel_barrier(dev, &sun7i_idle_barrier);
+
+	return index;
+}
+
+static struct cpuidle_driver sun7i_idle_driver = {
+	.name			= "sun7i_idle",
+	.owner			= THIS_MODULE,
+	.en_core_tk_irqen	= 1,
+	.states[0]		= ARM_CPUIDLE_WFI_STATE,
+	.states[1]		= {
+		.enter			= sun7i_enter_pd,
+		.flags			= CPUIDLE_FLAG_TIME_VALID |
+					  CPUIDLE_FLAG_COUPLED,
+		.name			= "PD",
+		.desc			= "cpu1 power-down, cpu0 WFI",
+	},
+	.state_count		= SUN7I_IDLE_STATES,
+	.safe_state_index	= 0,
+};
+
+static int __init sun7i_init_cpuidle(void)
+{
+	struct cpuidle_device *dev;
+	int cpu, ret;
+
+	sun7i_gic_irqs = ((readl((void __iomem *)SW_VA_GIC_DIST_IO_BASE + GIC_DIST_CTR)
+			   & 0x1f) + 1) * 32;
+	if (sun7i_gic_irqs > 1020)
+		sun7i_gic_irqs = 1020;
+
+	sun7i_idle_driver.states[1].exit_latency = pd_latency_us;
+	sun7i_idle_driver.states[1].target_residency = pd_residency_us;
+
+	ret = cpuidle_register_driver(&sun7i_idle_driver);
+	if (ret) {
+		pr_err("[cpuidle]: register driver failed (%d)\n", ret);
+		return ret;
+	}
+
+	for_each_possible_cpu(cpu) {
+		dev = &per_cpu(sun7i_idle_dev, cpu);
+		dev->cpu = cpu;
+		dev->state_count = SUN7I_IDLE_STATES;
+		cpumask_copy(&dev->coupled_cpus, cpu_possible_mask);
+
+		ret = cpuidle_register_device(dev);
+		if (ret) {
+			pr_err("[cpuidle]: register cpu%d failed (%d)\n", cpu, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+device_initcall(sun7i_init_cpuidle);
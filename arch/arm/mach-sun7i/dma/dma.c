@@ -16,8 +16,6 @@
 #include "dma_include.h"
 #include <linux/pm.h>
 
-struct kmem_cache *g_buf_cache;
-
 /**
  * handle_dma_irq - dma irq handle
  * @pchan:	dma channel handle
@@ -34,13 +32,16 @@ void handle_dma_irq(dma_channel_t *pchan, u32 upend_bits)
 	/* deal half done */
 	if(upend_bits & CHAN_IRQ_HD) {
 		csp_dma_clear_irqpend(pchan, CHAN_IRQ_HD);
+		/* preload the next buf for continuous mode */
+		if(true == pchan->bconti_mode)
+			dma_hdl_irq_hd(pchan);
 		if((irq_spt & CHAN_IRQ_HD) && NULL != pchan->hd_cb.func)
 			pchan->hd_cb.func((dma_hdl_t)pchan, pchan->hd_cb.parg);
 	}
 	/* deal queue done */
 	if(upend_bits & CHAN_IRQ_FD) {
 		csp_dma_clear_irqpend(pchan, CHAN_IRQ_FD);
-		if(irq_spt & CHAN_IRQ_FD)
+		if((irq_spt & CHAN_IRQ_FD) || true == pchan->bconti_mode)
 			dma_hdl_irq_fd(pchan);
 	}
 }
@@ -77,11 +78,6 @@ irqreturn_t __dma_irq_hdl(int irq, void *dev)
 	return IRQ_HANDLED;
 }
 
-static void __dma_cache_ctor(void *p)
-{
-	memset(p, 0, sizeof(buf_item));
-}
-
 /**
  * __dma_init - initial the dma manager, request irq
  * @device:	platform device pointer
@@ -110,14 +106,6 @@ int __dma_init(struct platform_device *device)
 		pchan->state = CHAN_STA_IDLE;
 	}
 
-	/* alloc dma pool for des list */
-	g_buf_cache = kmem_cache_create("dma_desc", sizeof(buf_item), 0, SLAB_HWCACHE_ALIGN, __dma_cache_ctor);
-	if(NULL == g_buf_cache) {
-		ret = __LINE__;
-		goto end;
-	}
-	DMA_INF("%s(%d): g_buf_cache 0x%08x\n", __func__, __LINE__, (u32)g_buf_cache);
-
 	/* register dma interrupt */
 	ret = request_irq(SW_INT_IRQNO_DMA, __dma_irq_hdl, IRQF_DISABLED,
 			"dma_irq", (void *)&g_dma_mgr);
@@ -131,10 +119,6 @@ int __dma_init(struct platform_device *device)
 end:
 	if(0 != ret) {
 		DMA_ERR("%s err, line %d\n", __func__, ret);
-		if (NULL != g_buf_cache) {
-			kmem_cache_destroy(g_buf_cache);
-			g_buf_cache = NULL;
-		}
 		for(i = 0; i < DMA_CHAN_TOTAL; i++)
 			DMA_CHAN_LOCK_DEINIT(&g_dma_mgr.chnl[i].lock);
 	}
@@ -153,11 +137,6 @@ int __dma_deinit(void)
 	DMA_INF("%s, line %d\n", __func__, __LINE__);
 	/* free dma irq */
 	free_irq(SW_INT_IRQNO_DMA, (void *)&g_dma_mgr);
-	/* free kcache */
-	if (NULL != g_buf_cache) {
-		kmem_cache_destroy(g_buf_cache);
-		g_buf_cache = NULL;
-	}
 	for(i = 0; i < DMA_CHAN_TOTAL; i++)
 		DMA_CHAN_LOCK_DEINIT(&g_dma_mgr.chnl[i].lock);
 	/* clear dma manager */
@@ -173,7 +152,16 @@ int __dma_deinit(void)
  */
 static int __devinit dma_drv_probe(struct platform_device *dev)
 {
-	return __dma_init(dev);
+	int ret = __dma_init(dev);
+
+	if(0 != ret)
+		return ret;
+	/* dmaengine is optional, the sw_dma_xxx interface still works without it */
+	if(0 != sw_dma_engine_init(&dev->dev))
+		DMA_ERR("%s err: sw_dma_engine_init failed\n", __func__);
+	if(0 != dma_debugfs_init())
+		DMA_ERR("%s err: dma_debugfs_init failed\n", __func__);
+	return 0;
 }
 
 /**
@@ -184,6 +172,8 @@ static int __devinit dma_drv_probe(struct platform_device *dev)
  */
 static int __devexit dma_drv_remove(struct platform_device *dev)
 {
+	dma_debugfs_exit();
+	sw_dma_engine_exit();
 	return __dma_deinit();
 }
 
@@ -17,6 +17,7 @@
 #define __DMA_COMMON_H
 
 #include <linux/spinlock.h>
+#include <linux/atomic.h>
 
 /* dma print macro */
 #define DMA_DBG_LEVEL		3
@@ -95,9 +96,37 @@ typedef struct {
 	u32	saddr;		/* src phys address */
 	u32	daddr;		/* dst phys address */
 	u32	bcnt;		/* bytes cnt to transfer */
-	struct list_head list;	/* list node */
 }buf_item;
 
+/*
+ * buf ring size for each channel, must be power of 2. two slots are kept
+ * for the buf in transferring and the buf preloaded in continuous mode,
+ * so DMA_RING_SIZE - 2 bufs can be queued.
+ */
+#define DMA_RING_SIZE		(64)
+#define DMA_RING_MASK		(DMA_RING_SIZE - 1)
+
+/*
+ * max bytes of one buf. the normal channel byte counter is the narrower
+ * one, so use it for both channel types, bigger requests are split.
+ */
+#define DMA_BUF_MAX_BCNT	(0x20000)
+
+/*
+ * irq-to-restart latency histogram, bucket n counts gaps of [2^(n-1), 2^n) us,
+ * bucket 0 is below 1us, the last one holds all bigger gaps
+ */
+#define DMA_LAT_HIST_CNT	(16)
+
+/* dma channel statistics, cleared when channel requested */
+typedef struct {
+	u64		bytes_done;	/* bytes transferred */
+	u32		buf_enqueued;	/* bufs enqueued */
+	u32		buf_done;	/* bufs done */
+	u32		lat_max;	/* max irq-to-restart latency, us */
+	u32		lat_hist[DMA_LAT_HIST_CNT]; /* irq-to-restart latency histogram */
+}dma_stat_t;
+
 /* dma channel owner name max len */
 #define MAX_NAME_LEN	32
 
@@ -116,16 +145,22 @@ typedef struct {
 					 */
 	u32		bconti_mode;	/* cotinue mode, same in ctrl, add here in order easy to use */
 	spinlock_t 	lock;		/* channel lock for buf list and reg ops */
-	buf_item	*pcur_buf;	/* cur buf in transferring */
-	struct list_head buf_list;	/* buf list head */
+	buf_item	*pcur_buf;	/* cur buf in transferring, points into ring */
+	buf_item	*pnext_buf;	/* buf preloaded to hw on half done, continuous mode only */
+	bool		bchained;	/* buf enqueued while running in continuous mode */
+	u32		underrun_cnt;	/* hw restarted the old buf, nothing preloaded in time */
+	dma_stat_t	stat;		/* statistics, for debugfs */
+	buf_item	*ring;		/* buf ring, alloced when channel requested */
+	atomic_t	ring_head;	/* producer index, only changed by enqueue */
+	atomic_t	ring_tail;	/* consumer index, only changed by start/stop */
 }dma_channel_t;
 
 /* dma manager struct */
 struct dma_mgr_t {
 	dma_channel_t chnl[DMA_CHAN_TOTAL];
+	u32 req_fail[2];	/* sw_dma_request failed, no free channel, normal/dedicate */
 };
 extern struct dma_mgr_t g_dma_mgr;
-extern struct kmem_cache *g_buf_cache;
 
 /* dma channel lock */
 #define DMA_CHAN_LOCK_INIT(lock)	spin_lock_init((lock))
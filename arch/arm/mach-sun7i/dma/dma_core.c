@@ -14,12 +14,78 @@
  */
 
 #include "dma_include.h"
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/sunxi_dma.h>
+
+/*
+ * buf ring helpers. head is only moved by the producer (enqueue), tail only
+ * by the consumer (start/stop), so the indices need no lock themselves;
+ * the channel lock is still held around them for the hw reg ops.
+ */
+static inline u32 __dma_ring_cnt(dma_channel_t *pchan)
+{
+	return (u32)atomic_read(&pchan->ring_head) - (u32)atomic_read(&pchan->ring_tail);
+}
+
+static inline bool __dma_ring_empty(dma_channel_t *pchan)
+{
+	return 0 == __dma_ring_cnt(pchan);
+}
+
+/**
+ * __dma_ring_put - add buf to the ring tail
+ * @pchan:	dma handle
+ * @src_addr:	src phys addr
+ * @dst_addr:	dst phys addr
+ * @byte_cnt:	buffer length
+ *
+ * Returns 0 if sucess, -ENOSPC if the ring is full.
+ */
+static inline int __dma_ring_put(dma_channel_t *pchan, u32 src_addr, u32 dst_addr, u32 byte_cnt)
+{
+	u32 head = (u32)atomic_read(&pchan->ring_head);
+	buf_item *pbuf = NULL;
+
+	/* keep slots for pcur_buf and pnext_buf, which are still used by hw */
+	if(__dma_ring_cnt(pchan) >= DMA_RING_SIZE - 2)
+		return -ENOSPC;
+	pbuf = &pchan->ring[head & DMA_RING_MASK];
+	pbuf->saddr = src_addr;
+	pbuf->daddr = dst_addr;
+	pbuf->bcnt = byte_cnt;
+	smp_wmb(); /* item visible before head moves */
+	atomic_set(&pchan->ring_head, head + 1);
+	return 0;
+}
+
+/**
+ * __dma_ring_get - take buf from the ring head
+ * @pchan:	dma handle
+ *
+ * Returns the buf, NULL if ring empty. the slot stays valid until
+ * DMA_RING_SIZE - 2 more bufs are put.
+ */
+static inline buf_item *__dma_ring_get(dma_channel_t *pchan)
+{
+	u32 tail = (u32)atomic_read(&pchan->ring_tail);
+	buf_item *pbuf = NULL;
+
+	if(__dma_ring_empty(pchan))
+		return NULL;
+	smp_rmb(); /* read item after seeing head */
+	pbuf = &pchan->ring[tail & DMA_RING_MASK];
+	atomic_set(&pchan->ring_tail, tail + 1);
+	return pbuf;
+}
 
 /**
  * __dma_start - start dma
  * @dma_hdl:	dma handle
  *
- * find the first buf in list, remove it, and start it.
+ * find the first buf in ring, take it, and start it.
  *
  * Returns 0 if sucess, otherwise failed.
  */
@@ -28,22 +94,20 @@ u32 __dma_start(dma_hdl_t dma_hdl)
 	buf_item *pbuf = NULL;
 	dma_channel_t *pchan = (dma_channel_t *)dma_hdl;
 
-	if(unlikely(list_empty(&pchan->buf_list))) {
+	/* take from ring, the slot is not reused until the buf done */
+	pbuf = __dma_ring_get(pchan);
+	if(unlikely(NULL == pbuf)) {
 		BUG();
 		return -EPERM;
 	}
-
-	/* remove from list */
-	pbuf = list_entry(pchan->buf_list.next, buf_item, list);
-	list_del(&pbuf->list); /* only remove from list, not free it */
 	/* set src addr */
 	csp_dma_set_saddr(pchan, pbuf->saddr);
 	/* set dst addr */
 	csp_dma_set_daddr(pchan, pbuf->daddr);
 	/* set byte cnt */
 	csp_dma_set_bcnt(pchan, pbuf->bcnt);
-	/* irq enable */
-	csp_dma_irq_enable(pchan, pchan->irq_spt);
+	/* irq enable, continuous mode always need hd to preload and fd to switch buf */
+	csp_dma_irq_enable(pchan, pchan->bconti_mode ? (CHAN_IRQ_HD | CHAN_IRQ_FD) : pchan->irq_spt);
 	/* set ctrl reg */
 	csp_dma_set_ctrl(pchan, *(u32 *)&pchan->ctrl);
 
@@ -56,30 +120,22 @@ u32 __dma_start(dma_hdl_t dma_hdl)
 }
 
 /**
- * __dma_free_buflist - free buf in list, not include cur buf
+ * __dma_free_buflist - drop buf in ring, not include cur buf
  * @pchan:	dma handle
  */
 void __dma_free_buflist(dma_channel_t *pchan)
 {
-	buf_item *pbuf = NULL;
-
-	while (!list_empty(&pchan->buf_list)) {
-		pbuf = list_entry(pchan->buf_list.next, buf_item, list);
-		list_del(&pbuf->list);
-		kmem_cache_free(g_buf_cache, pbuf);
-	}
+	atomic_set(&pchan->ring_tail, atomic_read(&pchan->ring_head));
 }
 
 /**
- * __dma_free_buflist - free all buf, include cur buf
+ * __dma_free_allbuf - drop all buf, include cur buf
  * @pchan:	dma handle
  */
 void __dma_free_allbuf(dma_channel_t *pchan)
 {
-	if(NULL != pchan->pcur_buf) {
-		kmem_cache_free(g_buf_cache, pchan->pcur_buf);
-		pchan->pcur_buf = NULL;
-	}
+	pchan->pcur_buf = NULL;
+	pchan->pnext_buf = NULL;
 	__dma_free_buflist(pchan);
 }
 
@@ -107,7 +163,7 @@ void __dma_stop(dma_hdl_t dma_hdl)
 		break;
 	case CHAN_STA_LAST_DONE:
 		DMA_INF("%s: state last done, so stop the channel, buffer already freed all, to check\n", __func__);
-		WARN_ON(NULL != pchan->pcur_buf || !list_empty(&pchan->buf_list));
+		WARN_ON(NULL != pchan->pcur_buf || !__dma_ring_empty(pchan));
 		break;
 	default:
 		BUG();
@@ -122,6 +178,7 @@ void __dma_stop(dma_hdl_t dma_hdl)
 
 	/* change channel state to idle */
 	pchan->state = CHAN_STA_IDLE;
+	pchan->bchained = false;
 }
 
 void __dma_set_hd_cb(dma_hdl_t dma_hdl, dma_cb_t *pcb)
@@ -143,7 +200,7 @@ void __dma_set_fd_cb(dma_hdl_t dma_hdl, dma_cb_t *pcb)
 }
 
 /**
- * __dma_enqueue - add buf to channel buf list
+ * __dma_enqueue - add buf to channel buf ring
  * @dma_hdl:	dma handle
  * @src_addr:	src phys addr
  * @dst_addr:	dst phys addr
@@ -154,20 +211,19 @@ void __dma_set_fd_cb(dma_hdl_t dma_hdl, dma_cb_t *pcb)
 u32 __dma_enqueue(dma_hdl_t dma_hdl, u32 src_addr, u32 dst_addr, u32 byte_cnt)
 {
 	dma_channel_t *pchan = (dma_channel_t *)dma_hdl;
-	buf_item *pbuf_item = NULL;
 	u32 uret = 0;
 
-	pbuf_item = (buf_item *)kmem_cache_alloc(g_buf_cache, GFP_ATOMIC);
-	if(NULL == pbuf_item) {
+	/* add to ring end */
+	if(0 != __dma_ring_put(pchan, src_addr, dst_addr, byte_cnt)) {
 		uret = __LINE__;
 		goto end;
 	}
-	pbuf_item->saddr = src_addr;
-	pbuf_item->daddr = dst_addr;
-	pbuf_item->bcnt = byte_cnt;
-
-	/* add to list end */
-	list_add_tail(&pbuf_item->list, &pchan->buf_list);
+	pchan->stat.buf_enqueued++;
+	trace_sunxi_dma_enqueue(pchan->id, pchan->owner, src_addr, dst_addr,
+		byte_cnt, __dma_ring_cnt(pchan));
+	/* continuous mode, the buf will be preloaded on the next half done */
+	if(true == pchan->bconti_mode && CHAN_STA_RUNING == pchan->state)
+		pchan->bchained = true;
 	/* start it if state is last done*/
 	if(CHAN_STA_LAST_DONE == pchan->state) {
 		DMA_INF("%s(%d): last done\n", __func__, __LINE__);
@@ -177,14 +233,107 @@ u32 __dma_enqueue(dma_hdl_t dma_hdl, u32 src_addr, u32 dst_addr, u32 byte_cnt)
 		}
 	}
 end:
-	if(0 != uret) {
+	if(0 != uret)
 		DMA_ERR("%s err, line %d\n", __func__, uret);
-		if(pbuf_item)
-			kmem_cache_free(g_buf_cache, pbuf_item);
-	}
 	return uret;
 }
 
+/**
+ * __dma_stat_done - account a done buf
+ * @pchan:	dma handle
+ * @pbuf:	the buf done
+ */
+static inline void __dma_stat_done(dma_channel_t *pchan, buf_item *pbuf)
+{
+	if(NULL == pbuf)
+		return;
+	pchan->stat.bytes_done += pbuf->bcnt;
+	pchan->stat.buf_done++;
+}
+
+/**
+ * __dma_stat_latency - account the gap from fd irq to the next buf started
+ * @pchan:	dma handle
+ * @start:	sched_clock when fd irq handling began
+ */
+static inline void __dma_stat_latency(dma_channel_t *pchan, u64 start)
+{
+	u64 ns = sched_clock() - start;
+	u32 us = 0, idx = 0;
+
+	us = (ns >= (u64)UINT_MAX * 1000) ? UINT_MAX : (u32)div_u64(ns, 1000);
+	if(us > pchan->stat.lat_max)
+		pchan->stat.lat_max = us;
+	idx = (0 == us) ? 0 : fls(us);
+	if(idx >= DMA_LAT_HIST_CNT)
+		idx = DMA_LAT_HIST_CNT - 1;
+	pchan->stat.lat_hist[idx]++;
+}
+
+/**
+ * dma_hdl_irq_hd - half done irq handler, for continuous mode
+ * @pchan:	dma handle
+ *
+ * in continuous mode the hw restarts by itself when the buf done, using the
+ * src/dst/cnt regs at that time. so write the next buf in ring to the regs
+ * here, the cur transfer is not affected, and the next one starts back to
+ * back without waiting the fd irq.
+ */
+void dma_hdl_irq_hd(dma_channel_t *pchan)
+{
+	unsigned long flags = 0;
+	buf_item *pbuf = NULL;
+
+	DMA_CHAN_LOCK(&pchan->lock, flags);
+	if(CHAN_STA_RUNING != pchan->state || NULL != pchan->pnext_buf)
+		goto end;
+	pbuf = __dma_ring_get(pchan);
+	if(NULL == pbuf)
+		goto end;
+	csp_dma_set_saddr(pchan, pbuf->saddr);
+	csp_dma_set_daddr(pchan, pbuf->daddr);
+	csp_dma_set_bcnt(pchan, pbuf->bcnt);
+	pchan->pnext_buf = pbuf;
+end:
+	DMA_CHAN_UNLOCK(&pchan->lock, flags);
+}
+
+/**
+ * __dma_hdl_irq_fd_conti - full done irq handler, for continuous mode
+ * @pchan:	dma handle
+ *
+ * the hw already restarted, with the buf preloaded on half done if there
+ * is one, or else the old buf once more. the later is an underrun if bufs
+ * were chained, and fd_cb is not called for it, as no new buf is done.
+ *
+ * Returns 0 if sucess, otherwise failed.
+ */
+static u32 __dma_hdl_irq_fd_conti(dma_channel_t *pchan)
+{
+	unsigned long flags = 0;
+	bool underrun = false;
+
+	DMA_CHAN_LOCK(&pchan->lock, flags);
+	if(CHAN_STA_RUNING != pchan->state) {
+		DMA_CHAN_UNLOCK(&pchan->lock, flags);
+		return 0;
+	}
+	WARN_ON(NULL == pchan->pcur_buf);
+	if(NULL != pchan->pnext_buf) {
+		__dma_stat_done(pchan, pchan->pcur_buf);
+		pchan->pcur_buf = pchan->pnext_buf;
+		pchan->pnext_buf = NULL;
+	} else if(pchan->bchained) {
+		pchan->underrun_cnt++;
+		underrun = true;
+	}
+	DMA_CHAN_UNLOCK(&pchan->lock, flags);
+
+	if(!underrun && (pchan->irq_spt & CHAN_IRQ_FD) && NULL != pchan->fd_cb.func)
+		pchan->fd_cb.func((dma_hdl_t)pchan, pchan->fd_cb.parg);
+	return 0;
+}
+
 /**
  * dma_hdl_irq_fd - full done irq handler
  * @pchan:	dma handle
@@ -198,8 +347,14 @@ u32 dma_hdl_irq_fd(dma_channel_t *pchan)
 {
 	chan_state_e cur_state = 0;
 	unsigned long flags = 0;
+	u64 start = sched_clock();
 	u32 uret = 0;
 
+	trace_sunxi_dma_irq_fd(pchan->id, pchan->owner, pchan->bconti_mode,
+		__dma_ring_cnt(pchan));
+	if(true == pchan->bconti_mode)
+		return __dma_hdl_irq_fd_conti(pchan);
+
 	/*
 	 * cannot lock fd_cb function, in case sw_dma_enqueue called in callback and lock again,
 	 * lead to deadlock
@@ -212,18 +367,17 @@ u32 dma_hdl_irq_fd(dma_channel_t *pchan)
 	switch(cur_state) {
 	case CHAN_STA_IDLE: /* stopped in hd_cb/fd_cb/somewhere? */
 		DMA_INF("%s: state idle, stopped in cb before? just return ok!\n", __func__);
-		//WARN_ON(!list_empty(&pchan->buf_list)); /* maybe new enqueue after stopped */
+		//WARN_ON(!__dma_ring_empty(pchan)); /* maybe new enqueue after stopped */
 		goto end;
 	case CHAN_STA_RUNING:
 		WARN_ON(NULL == pchan->pcur_buf);
-		if(unlikely(true == pchan->bconti_mode)) /* hw restart, not need soft start */
-			break;
-		/* for no-continue mode, free cur buf and start the next buf in chain */
-		kmem_cache_free(g_buf_cache, pchan->pcur_buf);
+		/* for no-continue mode, drop cur buf and start the next buf in ring */
+		__dma_stat_done(pchan, pchan->pcur_buf);
 		pchan->pcur_buf = NULL;
 		/* start next if there is, or change to last done */
-		if(!list_empty(&pchan->buf_list)) {
+		if(!__dma_ring_empty(pchan)) {
 			uret = __dma_start((dma_hdl_t)pchan);
+			__dma_stat_latency(pchan, start);
 			goto end;
 		} else {
 			DMA_INF("%s(%d), all buf done, change state to last done\n", __func__, __LINE__);
@@ -249,6 +403,7 @@ end:
 void dma_dump_chain(dma_channel_t *pchan)
 {
 	buf_item *pitem = NULL;
+	u32 i = 0;
 
 	if(NULL == pchan) {
 		DMA_ERR("%s(%d) err, para is NULL\n", __func__, __LINE__);
@@ -276,8 +431,11 @@ void dma_dump_chain(dma_channel_t *pchan)
 	printk("  channel fd_cb:     0x%08x\n", (u32)pchan->fd_cb.func);
 	printk("  ctrl reg:          0x%08x\n", *(u32 *)&pchan->ctrl);
 	printk("  pcur_buf:          0x%08x\n", (u32)pchan->pcur_buf);
-	printk("  buf list:\n");
-	list_for_each_entry(pitem, &pchan->buf_list, list) {
+	printk("  pnext_buf:         0x%08x\n", (u32)pchan->pnext_buf);
+	printk("  underrun_cnt:      %d\n", pchan->underrun_cnt);
+	printk("  buf ring:          head %d, tail %d\n", atomic_read(&pchan->ring_head), atomic_read(&pchan->ring_tail));
+	for(i = 0; NULL != pchan->ring && i < __dma_ring_cnt(pchan); i++) {
+		pitem = &pchan->ring[(atomic_read(&pchan->ring_tail) + i) & DMA_RING_MASK];
 		printk("         saddr: 0x%08x, daddr 0x%08x, bcnt 0x%08x\n", pitem->saddr, pitem->daddr, pitem->bcnt);
 	}
 	printk("-----------%s-----------\n", __func__);
@@ -286,12 +444,25 @@ void dma_dump_chain(dma_channel_t *pchan)
 /**
  * dma_request_init - init some member after requested
  * @pchan:	dma handle
+ *
+ * alloc the buf ring here, so enqueue never allocs in atomic context.
+ *
+ * Returns 0 if sucess, otherwise failed.
  */
-void dma_request_init(dma_channel_t *pchan)
+u32 dma_request_init(dma_channel_t *pchan)
 {
-	INIT_LIST_HEAD(&pchan->buf_list);
+	pchan->ring = kzalloc(DMA_RING_SIZE * sizeof(buf_item), GFP_KERNEL);
+	if(NULL == pchan->ring)
+		return __LINE__;
+	atomic_set(&pchan->ring_head, 0);
+	atomic_set(&pchan->ring_tail, 0);
 	pchan->state = CHAN_STA_IDLE;
 	pchan->pcur_buf = NULL;
+	pchan->pnext_buf = NULL;
+	pchan->bchained = false;
+	pchan->underrun_cnt = 0;
+	memset(&pchan->stat, 0, sizeof(pchan->stat));
+	return 0;
 }
 
 /**
@@ -304,6 +475,7 @@ void dma_release(dma_hdl_t dma_hdl)
 {
 	unsigned long 	flags = 0;
 	dma_channel_t *pchan = (dma_channel_t *)dma_hdl;
+	buf_item *pring = NULL;
 
 	DMA_CHAN_LOCK(&pchan->lock, flags);
 
@@ -321,11 +493,14 @@ void dma_release(dma_hdl_t dma_hdl)
 	memset(&pchan->ctrl, 0, sizeof(pchan->ctrl));
 	memset(&pchan->hd_cb, 0, sizeof(pchan->hd_cb));
 	memset(&pchan->fd_cb, 0, sizeof(pchan->fd_cb));
-	/* maybe enqueued but not started, so free buf */
+	/* maybe enqueued but not started, so drop buf */
 	WARN_ON(NULL != pchan->pcur_buf);
 	__dma_free_buflist(pchan);
+	pring = pchan->ring;
+	pchan->ring = NULL;
 
 	DMA_CHAN_UNLOCK(&pchan->lock, flags);
+	kfree(pring);
 }
 
 /**
@@ -361,6 +536,10 @@ u32 dma_ctrl(dma_hdl_t dma_hdl, dma_op_type_e op, void *parg)
 	case DMA_OP_GET_BYTECNT_LEFT: /* bc_mode 1, so readback is left bytes */
 		*(u32 *)parg = csp_dma_get_bcnt(pchan);
 		break;
+	case DMA_OP_GET_UNDERRUN_CNT:
+		BUG_ON(NULL == parg);
+		*(u32 *)parg = pchan->underrun_cnt;
+		break;
 	case DMA_OP_SET_HD_CB:
 		BUG_ON(NULL == parg);
 		__dma_set_hd_cb(dma_hdl, (dma_cb_t *)parg);
@@ -470,12 +649,6 @@ u32 dma_enqueue(dma_hdl_t dma_hdl, u32 src_addr, u32 dst_addr, u32 byte_cnt)
 
 	DMA_CHAN_LOCK(&pchan->lock, flags);
 
-	/* cannot enqueue more than one buffer in single_continue mode */
-	if(true == pchan->bconti_mode
-		&& !list_empty(&pchan->buf_list)) {
-		uret = __LINE__;
-		goto end;
-	}
 	if(0 != __dma_enqueue(dma_hdl, src_addr, dst_addr, byte_cnt)) {
 		uret = __LINE__;
 		goto end;
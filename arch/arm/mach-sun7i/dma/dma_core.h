@@ -20,8 +20,9 @@ u32 dma_enqueue(dma_hdl_t dma_hdl, u32 src_addr, u32 dst_addr, u32 byte_cnt);
 void dma_config(dma_hdl_t dma_hdl, dma_config_t *pcfg);
 u32 dma_ctrl(dma_hdl_t dma_hdl, dma_op_type_e op, void *parg);
 void dma_release(dma_hdl_t dma_hdl);
-void dma_request_init(dma_channel_t *pchan);
+u32 dma_request_init(dma_channel_t *pchan);
 void dma_dump_chain(dma_channel_t *pchan);
+void dma_hdl_irq_hd(dma_channel_t *pchan);
 u32 dma_hdl_irq_fd(dma_channel_t *pchan);
 
 #endif  /* __DMA_CORE_H */
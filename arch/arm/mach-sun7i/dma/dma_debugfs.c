@@ -0,0 +1,163 @@
+/*
+ * arch/arm/mach-sun7i/dma/dma_debugfs.c
+ * (C) Copyright 2010-2015
+ * Reuuimlla Technology Co., Ltd. <www.reuuimllatech.com>
+ * liugang <liugang@reuuimllatech.com>
+ *
+ * sun7i dma channel statistics in debugfs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#include "dma_include.h"
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+static struct dentry *g_dma_dbg_root;
+
+static const char *__state_name(chan_state_e state)
+{
+	switch(state) {
+	case CHAN_STA_IDLE:
+		return "idle";
+	case CHAN_STA_RUNING:
+		return "running";
+	case CHAN_STA_LAST_DONE:
+		return "last_done";
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * __dma_chan_show - show one line for each channel, then the latency histograms
+ * @m:		seq file
+ * @v:		not used
+ */
+static int __dma_chan_show(struct seq_file *m, void *v)
+{
+	dma_channel_t *pchan = NULL;
+	dma_stat_t stat;
+	unsigned long flags = 0;
+	char owner[MAX_NAME_LEN];
+	chan_state_e state;
+	u32 i, j, used, queued, underrun;
+
+	seq_printf(m, "request failed: normal %d, dedicate %d\n\n",
+		g_dma_mgr.req_fail[CHAN_NORMAL], g_dma_mgr.req_fail[CHAN_DEDICATE]);
+	seq_printf(m, "%-3s %-20s %-9s %-5s %12s %10s %10s %6s %8s %8s\n", "id", "owner", "state",
+		"conti", "bytes", "enqueued", "done", "queued", "underrun", "lat_max");
+	for(i = 0; i < DMA_CHAN_TOTAL; i++) {
+		pchan = &g_dma_mgr.chnl[i];
+
+		/* snapshot under lock, print without it */
+		DMA_CHAN_LOCK(&pchan->lock, flags);
+		used = pchan->used;
+		memcpy(owner, pchan->owner, sizeof(owner));
+		state = pchan->state;
+		stat = pchan->stat;
+		queued = (u32)atomic_read(&pchan->ring_head) - (u32)atomic_read(&pchan->ring_tail);
+		underrun = pchan->underrun_cnt;
+		DMA_CHAN_UNLOCK(&pchan->lock, flags);
+
+		if(!used)
+			continue;
+		owner[MAX_NAME_LEN - 1] = 0;
+		seq_printf(m, "%-3d %-20s %-9s %-5d %12llu %10u %10u %6u %8u %8u\n", i,
+			owner[0] ? owner : "-", __state_name(state), pchan->bconti_mode,
+			stat.bytes_done, stat.buf_enqueued, stat.buf_done, queued, underrun,
+			stat.lat_max);
+
+		seq_printf(m, "    lat(us):");
+		for(j = 0; j < DMA_LAT_HIST_CNT; j++)
+			seq_printf(m, " %s%u:%u", (DMA_LAT_HIST_CNT - 1 == j) ? ">=" : "<",
+				(DMA_LAT_HIST_CNT - 1 == j) ? (1 << (j - 1)) : (1 << j), stat.lat_hist[j]);
+		seq_printf(m, "\n");
+	}
+	return 0;
+}
+
+static int __dma_chan_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, __dma_chan_show, inode->i_private);
+}
+
+/**
+ * __dma_chan_write - any write clears the statistics of all channels
+ */
+static ssize_t __dma_chan_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	dma_channel_t *pchan = NULL;
+	unsigned long flags = 0;
+	u32 i;
+
+	for(i = 0; i < DMA_CHAN_TOTAL; i++) {
+		pchan = &g_dma_mgr.chnl[i];
+		DMA_CHAN_LOCK(&pchan->lock, flags);
+		memset(&pchan->stat, 0, sizeof(pchan->stat));
+		pchan->underrun_cnt = 0;
+		DMA_CHAN_UNLOCK(&pchan->lock, flags);
+	}
+	g_dma_mgr.req_fail[CHAN_NORMAL] = 0;
+	g_dma_mgr.req_fail[CHAN_DEDICATE] = 0;
+	return count;
+}
+
+static const struct file_operations dma_chan_fops = {
+	.owner		= THIS_MODULE,
+	.open		= __dma_chan_open,
+	.read		= seq_read,
+	.write		= __dma_chan_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __dma_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_memcpy_bench_show, inode->i_private);
+}
+
+/* reading it runs the bench, which takes about a second */
+static const struct file_operations dma_bench_fops = {
+	.owner		= THIS_MODULE,
+	.open		= __dma_bench_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/**
+ * dma_debugfs_init - create dma/channels and dma/memcpy_bench in debugfs
+ *
+ * Returns 0 if sucess, otherwise failed.
+ */
+int dma_debugfs_init(void)
+{
+	g_dma_dbg_root = debugfs_create_dir("dma", NULL);
+	if(IS_ERR_OR_NULL(g_dma_dbg_root)) {
+		g_dma_dbg_root = NULL;
+		return -ENOENT;
+	}
+	if(NULL == debugfs_create_file("channels", 0644, g_dma_dbg_root, NULL, &dma_chan_fops)
+		|| NULL == debugfs_create_file("memcpy_bench", 0400, g_dma_dbg_root, NULL, &dma_bench_fops)) {
+		debugfs_remove_recursive(g_dma_dbg_root);
+		g_dma_dbg_root = NULL;
+		return -ENOENT;
+	}
+	return 0;
+}
+
+/**
+ * dma_debugfs_exit - remove dma dir in debugfs
+ */
+void dma_debugfs_exit(void)
+{
+	debugfs_remove_recursive(g_dma_dbg_root);
+	g_dma_dbg_root = NULL;
+}
@@ -0,0 +1,30 @@
+/*
+ * arch/arm/mach-sun7i/dma/dma_debugfs.h
+ * (C) Copyright 2010-2015
+ * Reuuimlla Technology Co., Ltd. <www.reuuimllatech.com>
+ * liugang <liugang@reuuimllatech.com>
+ *
+ * sun7i dma debugfs header file
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef __DMA_DEBUGFS_H
+#define __DMA_DEBUGFS_H
+
+#ifdef CONFIG_DEBUG_FS
+struct seq_file;
+
+int dma_debugfs_init(void);
+void dma_debugfs_exit(void);
+int dma_memcpy_bench_show(struct seq_file *m, void *v);
+#else
+static inline int dma_debugfs_init(void) { return 0; }
+static inline void dma_debugfs_exit(void) { }
+#endif
+
+#endif  /* __DMA_DEBUGFS_H */
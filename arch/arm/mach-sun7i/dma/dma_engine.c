@@ -0,0 +1,683 @@
+/*
+ * arch/arm/mach-sun7i/dma/dma_engine.c
+ * (C) Copyright 2010-2015
+ * Reuuimlla Technology Co., Ltd. <www.reuuimllatech.com>
+ * liugang <liugang@reuuimllatech.com>
+ *
+ * sun7i dmaengine provider, built on top of the sw_dma_xxx interface
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#include "dma_include.h"
+#include <linux/dmaengine.h>
+#include <linux/interrupt.h>
+#include <linux/scatterlist.h>
+
+/*
+ * max buffers of a desc kept in the sw_dma ring, the rest are enqueued from
+ * the fd callback as buffers complete. must be less than DMA_RING_SIZE - 1.
+ */
+#define SW_DMA_PRELOAD		(8)
+
+/* one hw buffer of a descriptor */
+struct sw_dma_seg {
+	u32	saddr;		/* src phys address */
+	u32	daddr;		/* dst phys address */
+	u32	bcnt;		/* bytes cnt to transfer */
+};
+
+/* dmaengine descriptor, one or more hw buffers with the same config */
+struct sw_dma_desc {
+	struct dma_async_tx_descriptor txd;
+	struct list_head node;		/* in queued/completed list */
+	dma_config_t	cfg;		/* channel config for this desc */
+	dma_para_t	para;		/* para reg, dedicate channel only */
+	bool		cyclic;		/* cyclic desc, never completes */
+	bool		memcpy;		/* memcpy desc, unmapped when done */
+	dma_addr_t	src;		/* memcpy src, for unmap */
+	dma_addr_t	dst;		/* memcpy dst, for unmap */
+	size_t		len;		/* total bytes */
+	u32		nr_seg;		/* segment cnt */
+	u32		cur_seg;	/* segment the hw is working on */
+	u32		next_seg;	/* next segment to enqueue to sw_dma */
+	struct sw_dma_seg seg[0];
+};
+
+/* dmaengine channel, holds a sw_dma channel while allocated */
+struct sw_dma_chan {
+	struct dma_chan	chan;
+	dma_hdl_t	hdl;		/* sw_dma handle, NULL if not allocated */
+	char		name[MAX_NAME_LEN]; /* owner name passed to sw_dma_request */
+	dma_chan_type_e	type;		/* hw channel type */
+	struct sw_dma_slave slave;	/* slave para from sw_dma_filter */
+	struct dma_slave_config cfg;	/* from DMA_SLAVE_CONFIG */
+	spinlock_t	lock;		/* protect the members below */
+	bool		running;	/* hw channel started since last stop */
+	struct sw_dma_desc *cur;	/* desc in transferring */
+	struct list_head queued;	/* submitted, not started */
+	struct list_head completed;	/* done, callback not called */
+	u32		periods;	/* cyclic periods done, callback not called */
+	struct tasklet_struct tasklet;	/* call client callback */
+};
+
+/*
+ * slave device: private channels for peripherals, got by
+ * dma_request_channel(mask, sw_dma_filter, &slave).
+ * memcpy device: one public channel, so that async_tx/net_dma can use
+ * it without hold all the hw channels.
+ */
+struct sw_dma_engine {
+	struct dma_device	slave;
+	struct dma_device	memcpy;
+	struct sw_dma_chan	slave_chan[DMA_CHAN_TOTAL];
+	struct sw_dma_chan	memcpy_chan;
+};
+static struct sw_dma_engine g_dma_engine;
+
+static inline struct sw_dma_chan *to_sw_dma_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct sw_dma_chan, chan);
+}
+
+static inline struct sw_dma_desc *to_sw_dma_desc(struct dma_async_tx_descriptor *txd)
+{
+	return container_of(txd, struct sw_dma_desc, txd);
+}
+
+/**
+ * sw_dma_filter - dma_request_channel filter for sun7i slave channels
+ * @chan:	dmaengine channel
+ * @param:	struct sw_dma_slave, hw channel type and drq of the peripheral
+ *
+ * Returns true if the channel belongs to sun7i dma, false otherwise.
+ */
+bool sw_dma_filter(struct dma_chan *chan, void *param)
+{
+	struct sw_dma_slave *slave = (struct sw_dma_slave *)param;
+
+	if(chan->device != &g_dma_engine.slave || NULL == slave)
+		return false;
+	to_sw_dma_chan(chan)->slave = *slave;
+	return true;
+}
+EXPORT_SYMBOL(sw_dma_filter);
+
+static u8 __width_to_hw(enum dma_slave_buswidth width)
+{
+	switch(width) {
+	case DMA_SLAVE_BUSWIDTH_1_BYTE:
+		return DATA_WIDTH_8BIT;
+	case DMA_SLAVE_BUSWIDTH_2_BYTES:
+		return DATA_WIDTH_16BIT;
+	default:
+		return DATA_WIDTH_32BIT;
+	}
+}
+
+static u8 __burst_to_hw(u32 burst)
+{
+	if(burst >= 8)
+		return DATA_BRST_8;
+	else if(burst >= 4)
+		return DATA_BRST_4;
+	return DATA_BRST_1;
+}
+
+/**
+ * __desc_config - fill the hw config of a desc
+ * @schan:	dmaengine channel
+ * @desc:	desc to fill
+ * @dir:	transfer direction
+ */
+static void __desc_config(struct sw_dma_chan *schan, struct sw_dma_desc *desc,
+		enum dma_transfer_direction dir)
+{
+	dma_config_t *pcfg = &desc->cfg;
+	bool dedicate = (CHAN_DEDICATE == schan->type);
+	u16 mem_mode = dedicate ? DDMA_ADDR_LINEAR : NDMA_ADDR_INCREMENT;
+	u16 io_mode = dedicate ? DDMA_ADDR_IO : NDMA_ADDR_NOCHANGE;
+	u8 mem_drq_src = dedicate ? D_SRC_SDRAM : N_SRC_SDRAM;
+	u8 mem_drq_dst = dedicate ? D_DST_SDRAM : N_DST_SDRAM;
+
+	memset(pcfg, 0, sizeof(*pcfg));
+	pcfg->bconti_mode = false;
+	pcfg->irq_spt = CHAN_IRQ_FD;
+	desc->para = schan->slave.para;
+
+	switch(dir) {
+	case DMA_MEM_TO_DEV:
+		pcfg->xfer_type.src_data_width = __width_to_hw(schan->cfg.dst_addr_width);
+		pcfg->xfer_type.src_bst_len = __burst_to_hw(schan->cfg.dst_maxburst);
+		pcfg->xfer_type.dst_data_width = __width_to_hw(schan->cfg.dst_addr_width);
+		pcfg->xfer_type.dst_bst_len = __burst_to_hw(schan->cfg.dst_maxburst);
+		pcfg->address_type.src_addr_mode = mem_mode;
+		pcfg->address_type.dst_addr_mode = io_mode;
+		pcfg->src_drq_type = mem_drq_src;
+		pcfg->dst_drq_type = schan->slave.drq;
+		break;
+	case DMA_DEV_TO_MEM:
+		pcfg->xfer_type.src_data_width = __width_to_hw(schan->cfg.src_addr_width);
+		pcfg->xfer_type.src_bst_len = __burst_to_hw(schan->cfg.src_maxburst);
+		pcfg->xfer_type.dst_data_width = __width_to_hw(schan->cfg.src_addr_width);
+		pcfg->xfer_type.dst_bst_len = __burst_to_hw(schan->cfg.src_maxburst);
+		pcfg->address_type.src_addr_mode = io_mode;
+		pcfg->address_type.dst_addr_mode = mem_mode;
+		pcfg->src_drq_type = schan->slave.drq;
+		pcfg->dst_drq_type = mem_drq_dst;
+		break;
+	default: /* DMA_MEM_TO_MEM */
+		pcfg->xfer_type.src_data_width = DATA_WIDTH_32BIT;
+		pcfg->xfer_type.src_bst_len = DATA_BRST_4;
+		pcfg->xfer_type.dst_data_width = DATA_WIDTH_32BIT;
+		pcfg->xfer_type.dst_bst_len = DATA_BRST_4;
+		pcfg->address_type.src_addr_mode = mem_mode;
+		pcfg->address_type.dst_addr_mode = mem_mode;
+		pcfg->src_drq_type = mem_drq_src;
+		pcfg->dst_drq_type = mem_drq_dst;
+		memset(&desc->para, 0, sizeof(desc->para));
+		break;
+	}
+}
+
+/**
+ * __desc_add - add a memory range to desc, split into DMA_BUF_MAX_BCNT pieces
+ * @desc:	desc to add to
+ * @saddr:	src phys addr
+ * @daddr:	dst phys addr
+ * @len:	byte cnt
+ * @sinc:	src addr increase between pieces
+ * @dinc:	dst addr increase between pieces
+ */
+static void __desc_add(struct sw_dma_desc *desc, u32 saddr, u32 daddr, u32 len,
+		bool sinc, bool dinc)
+{
+	struct sw_dma_seg *seg;
+	u32 cnt;
+
+	while(len) {
+		cnt = min_t(u32, len, DMA_BUF_MAX_BCNT);
+		seg = &desc->seg[desc->nr_seg++];
+		seg->saddr = saddr;
+		seg->daddr = daddr;
+		seg->bcnt = cnt;
+		if(sinc)
+			saddr += cnt;
+		if(dinc)
+			daddr += cnt;
+		len -= cnt;
+	}
+}
+
+static dma_cookie_t sw_dma_tx_submit(struct dma_async_tx_descriptor *txd)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(txd->chan);
+	struct sw_dma_desc *desc = to_sw_dma_desc(txd);
+	struct dma_chan *chan = txd->chan;
+	unsigned long flags;
+	dma_cookie_t cookie;
+
+	spin_lock_irqsave(&schan->lock, flags);
+	cookie = chan->cookie + 1;
+	if(cookie < DMA_MIN_COOKIE)
+		cookie = DMA_MIN_COOKIE;
+	txd->cookie = chan->cookie = cookie;
+	list_add_tail(&desc->node, &schan->queued);
+	spin_unlock_irqrestore(&schan->lock, flags);
+	return cookie;
+}
+
+static struct sw_dma_desc *__desc_alloc(struct sw_dma_chan *schan, u32 nr_seg,
+		unsigned long flags)
+{
+	struct sw_dma_desc *desc;
+
+	desc = kzalloc(sizeof(*desc) + nr_seg * sizeof(struct sw_dma_seg), GFP_NOWAIT);
+	if(NULL == desc) {
+		DMA_ERR("%s err: alloc %d segs failed\n", __func__, nr_seg);
+		return NULL;
+	}
+	dma_async_tx_descriptor_init(&desc->txd, &schan->chan);
+	desc->txd.tx_submit = sw_dma_tx_submit;
+	desc->txd.flags = flags;
+	INIT_LIST_HEAD(&desc->node);
+	return desc;
+}
+
+/**
+ * __enqueue_seg - enqueue the next segment of desc to sw_dma
+ * @schan:	dmaengine channel
+ * @desc:	desc in transferring
+ *
+ * cyclic desc wrap to the first segment after the last one.
+ */
+static void __enqueue_seg(struct sw_dma_chan *schan, struct sw_dma_desc *desc)
+{
+	struct sw_dma_seg *seg;
+
+	if(desc->next_seg == desc->nr_seg) {
+		if(!desc->cyclic)
+			return;
+		desc->next_seg = 0;
+	}
+	seg = &desc->seg[desc->next_seg];
+	if(0 != sw_dma_enqueue(schan->hdl, seg->saddr, seg->daddr, seg->bcnt))
+		DMA_ERR("%s err: enqueue seg %d failed\n", __func__, desc->next_seg);
+	desc->next_seg++;
+}
+
+/**
+ * __start_next - start the first queued desc, if the channel is free
+ * @schan:	dmaengine channel
+ *
+ * called with schan->lock held, from issue_pending or the fd callback.
+ * up to SW_DMA_PRELOAD buffers are enqueued here, sw_dma starts the next
+ * buffer itself in the fd irq, and the fd callback tops the ring up.
+ */
+static void __start_next(struct sw_dma_chan *schan)
+{
+	struct sw_dma_desc *desc;
+	u32 i;
+
+	if(NULL != schan->cur || list_empty(&schan->queued))
+		return;
+
+	desc = list_first_entry(&schan->queued, struct sw_dma_desc, node);
+	list_del_init(&desc->node);
+	desc->cur_seg = 0;
+	desc->next_seg = 0;
+	schan->cur = desc;
+
+	sw_dma_config(schan->hdl, &desc->cfg);
+	if(CHAN_DEDICATE == schan->type)
+		sw_dma_ctl(schan->hdl, DMA_OP_SET_PARA_REG, &desc->para);
+	for(i = 0; i < desc->nr_seg && i < SW_DMA_PRELOAD; i++)
+		__enqueue_seg(schan, desc);
+	if(!schan->running) {
+		sw_dma_ctl(schan->hdl, DMA_OP_START, NULL);
+		schan->running = true;
+	}
+}
+
+/**
+ * sw_dma_engine_fd_cb - sw_dma full done callback, one hw buffer done
+ * @dma_hdl:	sw_dma handle
+ * @parg:	dmaengine channel
+ *
+ * run in irq context, without sw_dma channel lock.
+ */
+static void sw_dma_engine_fd_cb(dma_hdl_t dma_hdl, void *parg)
+{
+	struct sw_dma_chan *schan = (struct sw_dma_chan *)parg;
+	struct sw_dma_desc *desc;
+
+	spin_lock(&schan->lock);
+	desc = schan->cur;
+	if(NULL == desc)
+		goto end;
+
+	/* one buffer done, enqueue the next one not yet in sw_dma */
+	__enqueue_seg(schan, desc);
+	if(desc->cyclic) {
+		if(++desc->cur_seg == desc->nr_seg)
+			desc->cur_seg = 0;
+		schan->periods++;
+		tasklet_schedule(&schan->tasklet);
+	} else if(++desc->cur_seg == desc->nr_seg) {
+		schan->chan.completed_cookie = desc->txd.cookie;
+		list_add_tail(&desc->node, &schan->completed);
+		schan->cur = NULL;
+		__start_next(schan);
+		tasklet_schedule(&schan->tasklet);
+	}
+end:
+	spin_unlock(&schan->lock);
+}
+
+static void __desc_unmap(struct sw_dma_chan *schan, struct sw_dma_desc *desc)
+{
+	struct device *dev = schan->chan.device->dev;
+	unsigned long flags = desc->txd.flags;
+
+	if(!desc->memcpy)
+		return;
+	if(!(flags & DMA_COMPL_SKIP_DEST_UNMAP)) {
+		if(flags & DMA_COMPL_DEST_UNMAP_SINGLE)
+			dma_unmap_single(dev, desc->dst, desc->len, DMA_FROM_DEVICE);
+		else
+			dma_unmap_page(dev, desc->dst, desc->len, DMA_FROM_DEVICE);
+	}
+	if(!(flags & DMA_COMPL_SKIP_SRC_UNMAP)) {
+		if(flags & DMA_COMPL_SRC_UNMAP_SINGLE)
+			dma_unmap_single(dev, desc->src, desc->len, DMA_TO_DEVICE);
+		else
+			dma_unmap_page(dev, desc->src, desc->len, DMA_TO_DEVICE);
+	}
+}
+
+/**
+ * sw_dma_engine_tasklet - call client callbacks out of irq context
+ * @data:	dmaengine channel
+ */
+static void sw_dma_engine_tasklet(unsigned long data)
+{
+	struct sw_dma_chan *schan = (struct sw_dma_chan *)data;
+	struct sw_dma_desc *desc, *tmp;
+	dma_async_tx_callback callback = NULL;
+	void *param = NULL;
+	unsigned long flags;
+	LIST_HEAD(list);
+	u32 periods;
+
+	spin_lock_irqsave(&schan->lock, flags);
+	list_splice_tail_init(&schan->completed, &list);
+	periods = schan->periods;
+	schan->periods = 0;
+	if(periods && NULL != schan->cur && schan->cur->cyclic) {
+		callback = schan->cur->txd.callback;
+		param = schan->cur->txd.callback_param;
+	}
+	spin_unlock_irqrestore(&schan->lock, flags);
+
+	while(callback && periods--)
+		callback(param);
+
+	list_for_each_entry_safe(desc, tmp, &list, node) {
+		list_del(&desc->node);
+		__desc_unmap(schan, desc);
+		if(desc->txd.callback)
+			desc->txd.callback(desc->txd.callback_param);
+		kfree(desc);
+	}
+}
+
+static struct dma_async_tx_descriptor *sw_dma_prep_memcpy(struct dma_chan *chan,
+		dma_addr_t dest, dma_addr_t src, size_t len, unsigned long flags)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	struct sw_dma_desc *desc;
+
+	if(0 == len)
+		return NULL;
+	desc = __desc_alloc(schan, DIV_ROUND_UP(len, DMA_BUF_MAX_BCNT), flags);
+	if(NULL == desc)
+		return NULL;
+	__desc_config(schan, desc, DMA_MEM_TO_MEM);
+	__desc_add(desc, src, dest, len, true, true);
+	desc->memcpy = true;
+	desc->src = src;
+	desc->dst = dest;
+	desc->len = len;
+	return &desc->txd;
+}
+
+static struct dma_async_tx_descriptor *sw_dma_prep_slave_sg(struct dma_chan *chan,
+		struct scatterlist *sgl, unsigned int sg_len,
+		enum dma_transfer_direction direction, unsigned long flags,
+		void *context)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	struct sw_dma_desc *desc;
+	struct scatterlist *sg;
+	u32 nr_seg = 0, i;
+
+	if(DMA_MEM_TO_DEV != direction && DMA_DEV_TO_MEM != direction) {
+		DMA_ERR("%s err: direction %d not support\n", __func__, direction);
+		return NULL;
+	}
+	for_each_sg(sgl, sg, sg_len, i)
+		nr_seg += DIV_ROUND_UP(sg_dma_len(sg), DMA_BUF_MAX_BCNT);
+	if(0 == nr_seg)
+		return NULL;
+
+	desc = __desc_alloc(schan, nr_seg, flags);
+	if(NULL == desc)
+		return NULL;
+	__desc_config(schan, desc, direction);
+	for_each_sg(sgl, sg, sg_len, i) {
+		if(DMA_MEM_TO_DEV == direction)
+			__desc_add(desc, sg_dma_address(sg), schan->cfg.dst_addr,
+				sg_dma_len(sg), true, false);
+		else
+			__desc_add(desc, schan->cfg.src_addr, sg_dma_address(sg),
+				sg_dma_len(sg), false, true);
+		desc->len += sg_dma_len(sg);
+	}
+	return &desc->txd;
+}
+
+static struct dma_async_tx_descriptor *sw_dma_prep_cyclic(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_transfer_direction direction, void *context)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	struct sw_dma_desc *desc;
+	u32 nr_seg, i;
+
+	if((DMA_MEM_TO_DEV != direction && DMA_DEV_TO_MEM != direction)
+		|| 0 == period_len || period_len > DMA_BUF_MAX_BCNT
+		|| buf_len % period_len) {
+		DMA_ERR("%s err: para err, dir %d, buf_len %zu, period_len %zu\n",
+			__func__, direction, buf_len, period_len);
+		return NULL;
+	}
+	nr_seg = buf_len / period_len;
+	desc = __desc_alloc(schan, nr_seg, 0);
+	if(NULL == desc)
+		return NULL;
+	__desc_config(schan, desc, direction);
+	for(i = 0; i < nr_seg; i++) {
+		if(DMA_MEM_TO_DEV == direction)
+			__desc_add(desc, buf_addr + i * period_len, schan->cfg.dst_addr,
+				period_len, true, false);
+		else
+			__desc_add(desc, schan->cfg.src_addr, buf_addr + i * period_len,
+				period_len, false, true);
+	}
+	desc->len = buf_len;
+	desc->cyclic = true;
+	/* continuous mode, sw_dma preloads the next period on half done */
+	desc->cfg.bconti_mode = true;
+	return &desc->txd;
+}
+
+/**
+ * __terminate_all - stop the hw channel and drop all descs
+ * @schan:	dmaengine channel
+ */
+static void __terminate_all(struct sw_dma_chan *schan)
+{
+	struct sw_dma_desc *desc, *tmp;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&schan->lock, flags);
+	if(schan->running) {
+		sw_dma_ctl(schan->hdl, DMA_OP_STOP, NULL);
+		schan->running = false;
+	}
+	if(NULL != schan->cur) {
+		list_add_tail(&schan->cur->node, &list);
+		schan->cur = NULL;
+	}
+	list_splice_tail_init(&schan->queued, &list);
+	list_splice_tail_init(&schan->completed, &list);
+	schan->periods = 0;
+	spin_unlock_irqrestore(&schan->lock, flags);
+
+	list_for_each_entry_safe(desc, tmp, &list, node) {
+		list_del(&desc->node);
+		__desc_unmap(schan, desc);
+		kfree(desc);
+	}
+}
+
+static int sw_dma_control(struct dma_chan *chan, enum dma_ctrl_cmd cmd,
+		unsigned long arg)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+
+	switch(cmd) {
+	case DMA_TERMINATE_ALL:
+		__terminate_all(schan);
+		return 0;
+	case DMA_SLAVE_CONFIG:
+		schan->cfg = *(struct dma_slave_config *)arg;
+		return 0;
+	default:
+		return -ENXIO;
+	}
+}
+
+static enum dma_status sw_dma_tx_status(struct dma_chan *chan,
+		dma_cookie_t cookie, struct dma_tx_state *txstate)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	struct sw_dma_desc *desc;
+	enum dma_status ret;
+	unsigned long flags;
+	u32 residue = 0, left = 0, i;
+
+	spin_lock_irqsave(&schan->lock, flags);
+	ret = dma_async_is_complete(cookie, chan->completed_cookie, chan->cookie);
+	if(DMA_SUCCESS != ret && NULL != txstate) {
+		desc = schan->cur;
+		if(NULL != desc && desc->txd.cookie == cookie) {
+			sw_dma_ctl(schan->hdl, DMA_OP_GET_BYTECNT_LEFT, &left);
+			residue = left;
+			for(i = desc->cur_seg + 1; i < desc->nr_seg; i++)
+				residue += desc->seg[i].bcnt;
+		} else {
+			list_for_each_entry(desc, &schan->queued, node)
+				if(desc->txd.cookie == cookie)
+					residue = desc->len;
+		}
+	}
+	dma_set_tx_state(txstate, chan->completed_cookie, chan->cookie, residue);
+	spin_unlock_irqrestore(&schan->lock, flags);
+	return ret;
+}
+
+static void sw_dma_issue_pending(struct dma_chan *chan)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&schan->lock, flags);
+	__start_next(schan);
+	spin_unlock_irqrestore(&schan->lock, flags);
+}
+
+static int sw_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+	dma_cb_t cb;
+
+	/* the memcpy channel has no slave para, use a dedicate channel */
+	schan->type = (chan->device == &g_dma_engine.slave) ?
+			schan->slave.type : CHAN_DEDICATE;
+	snprintf(schan->name, sizeof(schan->name), "%s", dma_chan_name(chan));
+	schan->hdl = sw_dma_request(schan->name, schan->type);
+	if(NULL == schan->hdl) {
+		DMA_ERR("%s err: sw_dma_request %s failed\n", __func__, schan->name);
+		return -EBUSY;
+	}
+	cb.func = sw_dma_engine_fd_cb;
+	cb.parg = schan;
+	sw_dma_ctl(schan->hdl, DMA_OP_SET_FD_CB, &cb);
+
+	chan->cookie = DMA_MIN_COOKIE;
+	chan->completed_cookie = DMA_MIN_COOKIE;
+	schan->running = false;
+	return 1;
+}
+
+static void sw_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct sw_dma_chan *schan = to_sw_dma_chan(chan);
+
+	__terminate_all(schan);
+	tasklet_kill(&schan->tasklet);
+	if(NULL != schan->hdl) {
+		sw_dma_release(schan->hdl);
+		schan->hdl = NULL;
+	}
+	memset(&schan->slave, 0, sizeof(schan->slave));
+	memset(&schan->cfg, 0, sizeof(schan->cfg));
+}
+
+static void __chan_init(struct dma_device *dma_dev, struct sw_dma_chan *schan)
+{
+	schan->chan.device = dma_dev;
+	spin_lock_init(&schan->lock);
+	INIT_LIST_HEAD(&schan->queued);
+	INIT_LIST_HEAD(&schan->completed);
+	tasklet_init(&schan->tasklet, sw_dma_engine_tasklet, (unsigned long)schan);
+	list_add_tail(&schan->chan.device_node, &dma_dev->channels);
+}
+
+static void __dev_init(struct dma_device *dma_dev, struct device *dev)
+{
+	INIT_LIST_HEAD(&dma_dev->channels);
+	dma_dev->dev = dev;
+	dma_dev->device_alloc_chan_resources = sw_dma_alloc_chan_resources;
+	dma_dev->device_free_chan_resources = sw_dma_free_chan_resources;
+	dma_dev->device_prep_dma_memcpy = sw_dma_prep_memcpy;
+	dma_dev->device_control = sw_dma_control;
+	dma_dev->device_tx_status = sw_dma_tx_status;
+	dma_dev->device_issue_pending = sw_dma_issue_pending;
+	dma_cap_set(DMA_MEMCPY, dma_dev->cap_mask);
+}
+
+/**
+ * sw_dma_engine_init - register the dmaengine devices
+ * @dev:	sw_dmac platform device
+ *
+ * Returns 0 if sucess, otherwise failed.
+ */
+int sw_dma_engine_init(struct device *dev)
+{
+	struct sw_dma_engine *pengine = &g_dma_engine;
+	int ret = 0;
+	u32 i;
+
+	memset(pengine, 0, sizeof(*pengine));
+
+	__dev_init(&pengine->slave, dev);
+	pengine->slave.device_prep_slave_sg = sw_dma_prep_slave_sg;
+	pengine->slave.device_prep_dma_cyclic = sw_dma_prep_cyclic;
+	dma_cap_set(DMA_SLAVE, pengine->slave.cap_mask);
+	dma_cap_set(DMA_CYCLIC, pengine->slave.cap_mask);
+	dma_cap_set(DMA_PRIVATE, pengine->slave.cap_mask);
+	for(i = 0; i < DMA_CHAN_TOTAL; i++)
+		__chan_init(&pengine->slave, &pengine->slave_chan[i]);
+
+	__dev_init(&pengine->memcpy, dev);
+	__chan_init(&pengine->memcpy, &pengine->memcpy_chan);
+
+	ret = dma_async_device_register(&pengine->slave);
+	if(ret) {
+		DMA_ERR("%s err: register slave device return %d\n", __func__, ret);
+		return ret;
+	}
+	ret = dma_async_device_register(&pengine->memcpy);
+	if(ret) {
+		DMA_ERR("%s err: register memcpy device return %d\n", __func__, ret);
+		dma_async_device_unregister(&pengine->slave);
+		return ret;
+	}
+	return 0;
+}
+
+/**
+ * sw_dma_engine_exit - unregister the dmaengine devices
+ */
+void sw_dma_engine_exit(void)
+{
+	dma_async_device_unregister(&g_dma_engine.memcpy);
+	dma_async_device_unregister(&g_dma_engine.slave);
+}
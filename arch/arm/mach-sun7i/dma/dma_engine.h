@@ -0,0 +1,27 @@
+/*
+ * arch/arm/mach-sun7i/dma/dma_engine.h
+ * (C) Copyright 2010-2015
+ * Reuuimlla Technology Co., Ltd. <www.reuuimllatech.com>
+ * liugang <liugang@reuuimllatech.com>
+ *
+ * sun7i dmaengine provider header file
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef __DMA_ENGINE_H
+#define __DMA_ENGINE_H
+
+#ifdef CONFIG_SUN7I_DMA_ENGINE
+int sw_dma_engine_init(struct device *dev);
+void sw_dma_engine_exit(void);
+#else
+static inline int sw_dma_engine_init(struct device *dev) { return 0; }
+static inline void sw_dma_engine_exit(void) { }
+#endif
+
+#endif  /* __DMA_ENGINE_H */
@@ -39,6 +39,8 @@
 #include "dma_csp.h"
 #include "dma_interface.h"
 #include "dma_core.h"
+#include "dma_engine.h"
+#include "dma_debugfs.h"
 
 #ifdef DBG_DMA
 #include <linux/delay.h>
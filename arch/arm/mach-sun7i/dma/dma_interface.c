@@ -115,14 +115,19 @@ dma_hdl_t sw_dma_request(char * name, dma_chan_type_e type)
 		}
 	}
 	if(num == i) {
+		g_dma_mgr.req_fail[type]++;
 		usign = __LINE__;
 		goto end;
 	}
 
 	/* init channel */
 	pchan = &g_dma_mgr.chnl[i];
+	if(0 != dma_request_init(pchan)) {
+		pchan = NULL;
+		usign = __LINE__;
+		goto end;
+	}
 	pchan->used = 1;
-	dma_request_init(pchan);
 	if(NULL != name)
 		strcpy(pchan->owner, name);
 
@@ -0,0 +1,516 @@
+/*
+ * arch/arm/mach-sun7i/dma/dma_memcpy.c
+ * (C) Copyright 2010-2015
+ * Reuuimlla Technology Co., Ltd. <www.reuuimllatech.com>
+ * liugang <liugang@reuuimllatech.com>
+ *
+ * sun7i dma memcpy/memset offload, on a private dedicate channel
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#include "dma_include.h"
+#include <linux/completion.h>
+#include <linux/moduleparam.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <asm/cacheflush.h>
+
+/* offload enable, 0 means always copy by cpu */
+static int memcpy_offload = 1;
+module_param(memcpy_offload, int, 0644);
+MODULE_PARM_DESC(memcpy_offload, "use dma for sw_dma_memcpy/sw_dma_memset, 0 to always use cpu");
+
+/* requests smaller than this are done by cpu, dma setup cost is not paid back */
+static int memcpy_threshold = 32 * 1024;
+module_param(memcpy_threshold, int, 0644);
+MODULE_PARM_DESC(memcpy_threshold, "min bytes to use dma, smaller requests are done by cpu");
+
+/* bufs of a job kept in the channel ring, more are enqueued on fd */
+#define COPY_PRELOAD		(2)
+/* max jobs waiting, no alloc in the submit path */
+#define COPY_JOB_CNT		(32)
+
+/* one memcpy/memset request */
+typedef struct {
+	struct list_head list;	/* in free or pending list */
+	u32		dst;	/* dst phys addr */
+	u32		src;	/* src phys addr, unused for memset */
+	u32		val;	/* memset pattern */
+	u32		len;	/* total bytes */
+	u32		off;	/* bytes enqueued to the channel */
+	u32		done;	/* bytes done */
+	bool		bset;	/* memset, not memcpy */
+	dma_cb_t	cb;	/* done callback, called in irq context */
+}copy_job_t;
+
+/* memcpy engine */
+typedef struct {
+	dma_hdl_t	hdl;		/* dedicate channel handle */
+	spinlock_t	lock;		/* protect the members below */
+	bool		running;	/* channel started since requested */
+	copy_job_t	*pcur;		/* job in transferring */
+	struct list_head pending;	/* jobs waiting */
+	struct list_head free;		/* free job slots */
+	copy_job_t	job[COPY_JOB_CNT];
+	u32		*pattern;	/* memset src word, coherent */
+	dma_addr_t	pattern_pa;	/* phys addr of pattern */
+	u32		dma_bytes;	/* statistic: bytes done by dma */
+	u32		cpu_bytes;	/* statistic: bytes done by cpu */
+}copy_engine_t;
+
+static copy_engine_t g_copy;
+
+/**
+ * __copy_lowmem_va - get kernel va of a phys range for cpu fallback
+ * @pa:		phys addr
+ * @len:	byte cnt
+ *
+ * Returns the va if the range is in lowmem linear map, NULL otherwise.
+ */
+static void *__copy_lowmem_va(u32 pa, u32 len)
+{
+	u32 pfn_s = __phys_to_pfn(pa);
+	u32 pfn_e = __phys_to_pfn(pa + len - 1);
+
+	if(!pfn_valid(pfn_s) || !pfn_valid(pfn_e)
+		|| PageHighMem(pfn_to_page(pfn_s)) || PageHighMem(pfn_to_page(pfn_e)))
+		return NULL;
+	return phys_to_virt(pa);
+}
+
+/**
+ * __copy_by_cpu - do the job by cpu, through the lowmem linear map
+ * @dst:	dst phys addr
+ * @src:	src phys addr, for memcpy
+ * @val:	pattern, for memset
+ * @len:	byte cnt
+ * @bset:	memset if true
+ *
+ * dst is flushed after, so it is seen the same as after a dma copy.
+ *
+ * Returns 0 if done, -EFAULT if some addr not in lowmem.
+ */
+static int __copy_by_cpu(u32 dst, u32 src, u32 val, u32 len, bool bset)
+{
+	u32 *pdst = __copy_lowmem_va(dst, len);
+	void *psrc = NULL;
+	u32 i;
+
+	if(NULL == pdst)
+		return -EFAULT;
+	if(bset) {
+		for(i = 0; i < len / 4; i++)
+			pdst[i] = val;
+	} else {
+		psrc = __copy_lowmem_va(src, len);
+		if(NULL == psrc)
+			return -EFAULT;
+		memcpy(pdst, psrc, len);
+	}
+	dmac_flush_range(pdst, (void *)pdst + len);
+	g_copy.cpu_bytes += len;
+	return 0;
+}
+
+/**
+ * __copy_config - config the channel for a memcpy or memset job
+ * @bset:	memset if true
+ *
+ * memset reads the same pattern word again and again, by io addr mode.
+ */
+static void __copy_config(bool bset)
+{
+	dma_config_t cfg;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.xfer_type.src_data_width	= DATA_WIDTH_32BIT;
+	cfg.xfer_type.src_bst_len	= DATA_BRST_4;
+	cfg.xfer_type.dst_data_width	= DATA_WIDTH_32BIT;
+	cfg.xfer_type.dst_bst_len	= DATA_BRST_4;
+	cfg.address_type.src_addr_mode	= bset ? DDMA_ADDR_IO : DDMA_ADDR_LINEAR;
+	cfg.address_type.dst_addr_mode	= DDMA_ADDR_LINEAR;
+	cfg.src_drq_type		= D_SRC_SDRAM;
+	cfg.dst_drq_type		= D_DST_SDRAM;
+	cfg.bconti_mode			= false;
+	cfg.irq_spt			= CHAN_IRQ_FD;
+	sw_dma_config(g_copy.hdl, &cfg);
+}
+
+/**
+ * __copy_enqueue_next - enqueue the next buf of cur job
+ *
+ * called with g_copy.lock held.
+ */
+static void __copy_enqueue_next(void)
+{
+	copy_job_t *pjob = g_copy.pcur;
+	u32 cnt, src;
+
+	if(pjob->off == pjob->len)
+		return;
+	cnt = min_t(u32, pjob->len - pjob->off, DMA_BUF_MAX_BCNT);
+	src = pjob->bset ? (u32)g_copy.pattern_pa : pjob->src + pjob->off;
+	if(0 != sw_dma_enqueue(g_copy.hdl, src, pjob->dst + pjob->off, cnt))
+		DMA_ERR("%s err: enqueue 0x%08x len %d failed\n", __func__, pjob->dst + pjob->off, cnt);
+	pjob->off += cnt;
+}
+
+/**
+ * __copy_start_next - start the first pending job, if channel is free
+ *
+ * called with g_copy.lock held, from submit or the fd callback.
+ */
+static void __copy_start_next(void)
+{
+	copy_job_t *pjob = NULL;
+	u32 i;
+
+	if(NULL != g_copy.pcur || list_empty(&g_copy.pending))
+		return;
+
+	pjob = list_first_entry(&g_copy.pending, copy_job_t, list);
+	list_del(&pjob->list);
+	g_copy.pcur = pjob;
+
+	__copy_config(pjob->bset);
+	if(pjob->bset) {
+		*g_copy.pattern = pjob->val;
+		wmb();
+	}
+	for(i = 0; i < COPY_PRELOAD; i++)
+		__copy_enqueue_next();
+	if(!g_copy.running) {
+		sw_dma_ctl(g_copy.hdl, DMA_OP_START, NULL);
+		g_copy.running = true;
+	}
+}
+
+/**
+ * __copy_fd_cb - channel full done callback, one buf done
+ * @dma_hdl:	dma handle
+ * @parg:	not used
+ */
+static void __copy_fd_cb(dma_hdl_t dma_hdl, void *parg)
+{
+	copy_job_t *pjob = NULL;
+	dma_cb_t cb = {NULL, NULL};
+	unsigned long flags = 0;
+
+	spin_lock_irqsave(&g_copy.lock, flags);
+	pjob = g_copy.pcur;
+	if(NULL == pjob)
+		goto end;
+	pjob->done += min_t(u32, pjob->len - pjob->done, DMA_BUF_MAX_BCNT);
+	if(pjob->done < pjob->len) {
+		__copy_enqueue_next();
+		goto end;
+	}
+
+	/* job done, free it and start the next one */
+	g_copy.dma_bytes += pjob->len;
+	cb = pjob->cb;
+	list_add_tail(&pjob->list, &g_copy.free);
+	g_copy.pcur = NULL;
+	__copy_start_next();
+end:
+	spin_unlock_irqrestore(&g_copy.lock, flags);
+	if(NULL != cb.func)
+		cb.func(dma_hdl, cb.parg);
+}
+
+/**
+ * __copy_queue - queue a memcpy or memset job on the channel
+ * @dst:	dst phys addr
+ * @src:	src phys addr, for memcpy
+ * @val:	pattern, for memset
+ * @len:	byte cnt
+ * @bset:	memset if true
+ * @pcb:	done callback, can be NULL
+ *
+ * Returns 0 if sucess, the err line number if no job slot is free.
+ */
+static u32 __copy_queue(u32 dst, u32 src, u32 val, u32 len, bool bset, dma_cb_t *pcb)
+{
+	copy_job_t *pjob = NULL;
+	unsigned long flags = 0;
+
+	spin_lock_irqsave(&g_copy.lock, flags);
+	if(list_empty(&g_copy.free)) {
+		spin_unlock_irqrestore(&g_copy.lock, flags);
+		return __LINE__;
+	}
+	pjob = list_first_entry(&g_copy.free, copy_job_t, list);
+	list_del(&pjob->list);
+	pjob->dst = dst;
+	pjob->src = src;
+	pjob->val = val;
+	pjob->len = len;
+	pjob->off = 0;
+	pjob->done = 0;
+	pjob->bset = bset;
+	pjob->cb.func = pcb ? pcb->func : NULL;
+	pjob->cb.parg = pcb ? pcb->parg : NULL;
+	list_add_tail(&pjob->list, &g_copy.pending);
+	__copy_start_next();
+	spin_unlock_irqrestore(&g_copy.lock, flags);
+	return 0;
+}
+
+/**
+ * __copy_submit - queue a memcpy or memset job, or do it by cpu
+ * @dst:	dst phys addr
+ * @src:	src phys addr, for memcpy
+ * @val:	pattern, for memset
+ * @len:	byte cnt
+ * @bset:	memset if true
+ * @pcb:	done callback, can be NULL
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+static u32 __copy_submit(u32 dst, u32 src, u32 val, u32 len, bool bset, dma_cb_t *pcb)
+{
+	u32 uret = 0;
+
+	if(0 == len || (len & 0x3) || (dst & 0x3) || (!bset && (src & 0x3))) {
+		uret = __LINE__;
+		goto end;
+	}
+
+	/* small request, or offload disabled, or no channel, try cpu first */
+	if(!memcpy_offload || len < (u32)memcpy_threshold || NULL == g_copy.hdl) {
+		if(0 == __copy_by_cpu(dst, src, val, len, bset)) {
+			if(NULL != pcb && NULL != pcb->func)
+				pcb->func(NULL, pcb->parg);
+			goto end;
+		}
+		if(NULL == g_copy.hdl) {
+			uret = __LINE__;
+			goto end;
+		}
+	}
+
+	uret = __copy_queue(dst, src, val, len, bset, pcb);
+
+end:
+	if(0 != uret)
+		DMA_ERR("%s err, line %d, dst 0x%08x, src 0x%08x, len %d\n", __func__, uret, dst, src, len);
+	return uret;
+}
+
+/**
+ * sw_dma_memcpy - async memcpy between phys addrs
+ * @dst:	dst phys addr, 4 bytes aligned
+ * @src:	src phys addr, 4 bytes aligned
+ * @len:	byte cnt, multiple of 4
+ * @pcb:	done callback, called in irq context, or before return if done
+ *		by cpu. can be NULL
+ *
+ * the caller does the cache maintenance, same as for other dma.
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+u32 sw_dma_memcpy(u32 dst, u32 src, u32 len, dma_cb_t *pcb)
+{
+	return __copy_submit(dst, src, 0, len, false, pcb);
+}
+EXPORT_SYMBOL(sw_dma_memcpy);
+
+/**
+ * sw_dma_memset - async fill phys memory with a 32bit pattern
+ * @dst:	dst phys addr, 4 bytes aligned
+ * @val:	32bit pattern
+ * @len:	byte cnt, multiple of 4
+ * @pcb:	done callback, same as sw_dma_memcpy
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+u32 sw_dma_memset(u32 dst, u32 val, u32 len, dma_cb_t *pcb)
+{
+	return __copy_submit(dst, 0, val, len, true, pcb);
+}
+EXPORT_SYMBOL(sw_dma_memset);
+
+static void __copy_sync_cb(dma_hdl_t dma_hdl, void *parg)
+{
+	complete((struct completion *)parg);
+}
+
+/**
+ * sw_dma_memcpy_sync - memcpy between phys addrs, wait until done
+ * @dst:	dst phys addr
+ * @src:	src phys addr
+ * @len:	byte cnt
+ *
+ * can sleep, not for atomic context.
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+u32 sw_dma_memcpy_sync(u32 dst, u32 src, u32 len)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	dma_cb_t cb;
+	u32 uret = 0;
+
+	cb.func = __copy_sync_cb;
+	cb.parg = &done;
+	uret = sw_dma_memcpy(dst, src, len, &cb);
+	if(0 == uret)
+		wait_for_completion(&done);
+	return uret;
+}
+EXPORT_SYMBOL(sw_dma_memcpy_sync);
+
+/**
+ * sw_dma_memcpy_init - request the dedicate channel for offload
+ *
+ * if failed, all requests fall back to cpu.
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+static int __init sw_dma_memcpy_init(void)
+{
+	dma_cb_t cb;
+	u32 i, uret = 0;
+
+	memset(&g_copy, 0, sizeof(g_copy));
+	spin_lock_init(&g_copy.lock);
+	INIT_LIST_HEAD(&g_copy.pending);
+	INIT_LIST_HEAD(&g_copy.free);
+	for(i = 0; i < COPY_JOB_CNT; i++)
+		list_add_tail(&g_copy.job[i].list, &g_copy.free);
+
+	g_copy.pattern = dma_alloc_coherent(NULL, sizeof(u32), &g_copy.pattern_pa, GFP_KERNEL);
+	if(NULL == g_copy.pattern) {
+		uret = __LINE__;
+		goto end;
+	}
+	g_copy.hdl = sw_dma_request("dma_memcpy", CHAN_DEDICATE);
+	if(NULL == g_copy.hdl) {
+		uret = __LINE__;
+		goto end;
+	}
+	cb.func = __copy_fd_cb;
+	cb.parg = NULL;
+	sw_dma_ctl(g_copy.hdl, DMA_OP_SET_FD_CB, &cb);
+
+end:
+	if(0 != uret) {
+		DMA_ERR("%s err, line %d, memcpy falls back to cpu\n", __func__, uret);
+		if(NULL != g_copy.pattern) {
+			dma_free_coherent(NULL, sizeof(u32), g_copy.pattern, g_copy.pattern_pa);
+			g_copy.pattern = NULL;
+		}
+	}
+	return 0;
+}
+late_initcall(sw_dma_memcpy_init);
+
+#ifdef CONFIG_DEBUG_FS
+/* copy sizes of the bench, the last one is the buffer size */
+static const u32 g_bench_size[] = {
+	4 * 1024, 16 * 1024, 32 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024,
+};
+/* bytes copied per size and engine */
+#define BENCH_BYTES		(16 * 1024 * 1024)
+
+static DEFINE_MUTEX(g_bench_lock);
+
+/**
+ * __copy_bench_dma - one memcpy on the channel, whatever the threshold
+ * @dst:	dst phys addr
+ * @src:	src phys addr
+ * @len:	byte cnt
+ *
+ * the caches are flushed like a caller of sw_dma_memcpy has to.
+ *
+ * Returns 0 if sucess, the err line number if failed.
+ */
+static u32 __copy_bench_dma(u32 dst, u32 src, u32 len)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	dma_cb_t cb;
+	u32 uret = 0;
+
+	dmac_flush_range(phys_to_virt(src), phys_to_virt(src) + len);
+	dmac_flush_range(phys_to_virt(dst), phys_to_virt(dst) + len);
+	cb.func = __copy_sync_cb;
+	cb.parg = &done;
+	uret = __copy_queue(dst, src, 0, len, false, &cb);
+	if(0 == uret)
+		wait_for_completion(&done);
+	return uret;
+}
+
+/**
+ * dma_memcpy_bench_show - memcpy throughput by cpu and by dma, per size
+ * @m:		seq file
+ * @v:		not used
+ *
+ * one line of key=value pairs per size and engine, for scripts. the cpu
+ * numbers include the flush of dst, which the cpu fallback also does.
+ */
+int dma_memcpy_bench_show(struct seq_file *m, void *v)
+{
+	u32 order = get_order(g_bench_size[ARRAY_SIZE(g_bench_size) - 1]);
+	unsigned long src_va = 0, dst_va = 0;
+	u32 src, dst, size, cnt, i, j, uret = 0;
+	ktime_t start;
+	u64 us;
+	int engine;
+
+	src_va = __get_free_pages(GFP_KERNEL, order);
+	dst_va = __get_free_pages(GFP_KERNEL, order);
+	if(!src_va || !dst_va) {
+		seq_printf(m, "test=memcpy error=nomem\n");
+		goto end;
+	}
+	memset((void *)src_va, 0x5a, PAGE_SIZE << order);
+	src = virt_to_phys((void *)src_va);
+	dst = virt_to_phys((void *)dst_va);
+
+	mutex_lock(&g_bench_lock);
+	for(i = 0; i < ARRAY_SIZE(g_bench_size); i++) {
+		size = g_bench_size[i];
+		cnt = BENCH_BYTES / size;
+		for(engine = 0; engine < 2; engine++) {
+			if(1 == engine && NULL == g_copy.hdl) {
+				seq_printf(m, "test=memcpy engine=dma size=%u error=nochan\n", size);
+				continue;
+			}
+			start = ktime_get();
+			for(j = 0; j < cnt && 0 == uret; j++) {
+				if(0 == engine)
+					uret = __copy_by_cpu(dst, src, 0, size, false);
+				else
+					uret = __copy_bench_dma(dst, src, size);
+			}
+			us = ktime_to_us(ktime_sub(ktime_get(), start));
+			if(0 != uret) {
+				seq_printf(m, "test=memcpy engine=%s size=%u error=%u\n",
+					engine ? "dma" : "cpu", size, uret);
+				uret = 0;
+				continue;
+			}
+			seq_printf(m, "test=memcpy engine=%s size=%u count=%u us=%llu mbps=%llu\n",
+				engine ? "dma" : "cpu", size, cnt, us,
+				us ? div64_u64((u64)size * cnt, us) : 0);
+		}
+	}
+	mutex_unlock(&g_bench_lock);
+
+end:
+	if(src_va)
+		free_pages(src_va, order);
+	if(dst_va)
+		free_pages(dst_va, order);
+	return 0;
+}
+#endif
@@ -0,0 +1,149 @@
+/*
+ *  linux/arch/arm/mach-sun7i/dram_stat.c
+ *
+ *  Copyright (C) 2012-2016 Allwinner Ltd.
+ *  All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * dram/ports in debugfs: the host port setup of each master of the
+ * dram controller, and how busy its port is. The controller has no
+ * documented traffic counters, so a read samples the port FIFO status
+ * register for sample_ms and reports the share of samples in which
+ * the FIFO of a port held requests. A master that saturates the dram
+ * shows up with a FIFO that never drains.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/math64.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <mach/platform.h>
+#include <mach/dram.h>
+
+#define DRAM_STAT_CFSR		(SW_VA_DRAM_IO_BASE + 0x234)
+
+/* the longest a read may spin, ms */
+#define DRAM_STAT_MAX_MS	2000
+
+static const struct {
+	__dram_host_port_e port;
+	const char *name;
+} dram_stat_ports[] = {
+	{ DRAM_HOST_CPU,	"cpu" },
+	{ DRAM_HOST_GPU,	"gpu" },
+	{ DRAM_HOST_BE,		"de_be" },
+	{ DRAM_HOST_FE,		"de_fe" },
+	{ DRAM_HOST_CSI,	"csi" },
+	{ DRAM_HOST_TSDM,	"tsdm" },
+	{ DRAM_HOST_VE,		"ve" },
+	{ DRAM_HOST_USB1,	"usb1" },
+	{ DRAM_HOST_NDMA,	"ndma" },
+	{ DRAM_HOST_ATH,	"ath" },
+	{ DRAM_HOST_IEP,	"iep" },
+	{ DRAM_HOST_SDHC,	"sdhc" },
+	{ DRAM_HOST_DDMA,	"ddma" },
+	{ DRAM_HOST_GPS,	"gps" },
+};
+
+static u32 dram_stat_sample_ms = 100;
+static struct dentry *dram_stat_root;
+static DEFINE_MUTEX(dram_stat_lock);
+
+/* samples in which the FIFO of each port was not empty */
+static u32 dram_stat_busy[32];
+
+static u32 dram_stat_sample(u32 ms)
+{
+	ktime_t end = ktime_add_us(ktime_get(), ms * 1000);
+	u32 samples = 0;
+	u32 empty;
+	int i;
+
+	memset(dram_stat_busy, 0, sizeof(dram_stat_busy));
+
+	do {
+		empty = readl((void __iomem *)DRAM_STAT_CFSR);
+		for (i = 0; i < ARRAY_SIZE(dram_stat_ports); i++)
+			if (!(empty & (1 << dram_stat_ports[i].port)))
+				dram_stat_busy[dram_stat_ports[i].port]++;
+		samples++;
+
+		if (!(samples & 0x3ff))
+			cond_resched();
+	} while (ktime_to_ns(ktime_sub(end, ktime_get())) > 0);
+
+	return samples;
+}
+
+static int dram_stat_show(struct seq_file *m, void *v)
+{
+	u32 ms = min_t(u32, dram_stat_sample_ms, DRAM_STAT_MAX_MS);
+	__dram_host_cfg_reg_t cfg;
+	u32 samples, permille;
+	int i;
+
+	if (!ms)
+		ms = 1;
+
+	mutex_lock(&dram_stat_lock);
+	samples = dram_stat_sample(ms);
+
+	seq_printf(m, "%u samples in %u ms\n\n", samples, ms);
+	seq_printf(m, "%-4s %-6s %-3s %-4s %-4s %-4s %8s\n",
+		   "port", "master", "acs", "prio", "wait", "cmd", "busy");
+	for (i = 0; i < ARRAY_SIZE(dram_stat_ports); i++) {
+		*(u32 *)&cfg = readl((void __iomem *)DRAM_HOST_CFG_BASE +
+				     4 * dram_stat_ports[i].port);
+		permille = div_u64((u64)dram_stat_busy[dram_stat_ports[i].port]
+				   * 1000, samples);
+		seq_printf(m, "%-4d %-6s %-3u %-4u %-4u %-4u %5u.%u%%\n",
+			   dram_stat_ports[i].port, dram_stat_ports[i].name,
+			   cfg.AcsEn, cfg.PrioLevel, cfg.WaitState, cfg.CmdNum,
+			   permille / 10, permille % 10);
+	}
+	mutex_unlock(&dram_stat_lock);
+
+	return 0;
+}
+
+static int dram_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dram_stat_show, inode->i_private);
+}
+
+static const struct file_operations dram_stat_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dram_stat_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dram_stat_init(void)
+{
+	dram_stat_root = debugfs_create_dir("dram", NULL);
+	if (IS_ERR_OR_NULL(dram_stat_root)) {
+		dram_stat_root = NULL;
+		return -ENOENT;
+	}
+
+	if (!debugfs_create_file("ports", 0444, dram_stat_root, NULL,
+				 &dram_stat_fops) ||
+	    !debugfs_create_u32("sample_ms", 0644, dram_stat_root,
+				&dram_stat_sample_ms)) {
+		debugfs_remove_recursive(dram_stat_root);
+		dram_stat_root = NULL;
+		return -ENOENT;
+	}
+
+	return 0;
+}
+late_initcall(dram_stat_init);
@@ -18,16 +18,14 @@
 #include <mach/platform.h>
 #include <mach/hardware.h>
 
+#include "core.h"
 
 
 static cpumask_t dead_cpus;
 
-#define IS_WFI_MODE(cpu)    (readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + CPUX_STATUS(cpu)) & (1<<2))
-
 int platform_cpu_kill(unsigned int cpu)
 {
     int k;
-    u32 pwr_reg;
     int tmp_cpu;
 
     if (cpu == 0)
@@ -42,29 +40,7 @@ int platform_cpu_kill(unsigned int cpu)
     for (k = 0; k < 1000; k++) {
         if (cpumask_test_cpu(cpu, &dead_cpus) && IS_WFI_MODE(cpu)) {
 
-            /* step8: deassert cpu core reset */
-            writel(0, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + CPUX_RESET_CTL(cpu));
-
-            /* step8: deassert DBGPWRDUP signal */
-            pwr_reg = readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_DBGCTL1);
-            pwr_reg &= ~(1<<cpu);
-            writel(pwr_reg, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_DBGCTL1);
-
-            /* step9: set up power-off signal */
-            pwr_reg = readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWROFF_REG);
-            pwr_reg |= 1;
-            writel(pwr_reg, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWROFF_REG);
-            mdelay(1);
-
-            /* step10: active the power output clamp */
-            writel(0x01, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x03, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x07, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x0f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x1f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x3f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0x7f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
-            writel(0xff, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+            sun7i_cpu_power_down(cpu);
             pr_info("[hotplug]: cpu%d is killed!\n", cpu);
 
             return 1;
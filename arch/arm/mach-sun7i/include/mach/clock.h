@@ -18,6 +18,8 @@
 #include <linux/string.h>
 #include <linux/spinlock.h>
 #include <linux/clocksource.h>
+#include <linux/notifier.h>
+#include <linux/bitops.h>
 
 #define CCU_LOCK_INIT(lock)     spin_lock_init(lock)
 #define CCU_LOCK_DEINIT(lock)   do{} while(0)
@@ -250,8 +252,45 @@ typedef struct clk {
     struct clk_ops      *ops;       /* clock operation handle */
     int                 enable;     /* enable count, when it down to 0, it will be disalbe */
     spinlock_t          lock;       /* to synchronize the clock setting */
+    unsigned long       rate_cache; /* rate read at generation rate_gen */
+    unsigned int        rate_gen;   /* clock tree generation of rate_cache, 0 if empty */
 } __ccu_clk_t;
 
+/* one change of a clk_apply_batch() sequence */
+typedef enum __AW_CLK_BATCH_TYPE {
+    CLK_BATCH_RATE      = 0,
+    CLK_BATCH_PARENT    = 1,
+
+} __aw_clk_batch_type_e;
+
+struct clk_batch_op {
+    struct clk          *clk;
+    int                 type;       /* CLK_BATCH_RATE or CLK_BATCH_PARENT */
+    unsigned long       rate;       /* for CLK_BATCH_RATE */
+    struct clk          *parent;    /* for CLK_BATCH_PARENT */
+};
+
+int clk_apply_batch(const struct clk_batch_op *ops, int count);
+
+#ifndef CONFIG_COMMON_CLK
+/*
+ * Rate change notifiers as in the common clock framework, see
+ * include/linux/clk.h. A notifier on a clock also hears about changes
+ * of the clocks above it, e.g. of the pll it runs from.
+ */
+#define PRE_RATE_CHANGE         BIT(0)
+#define POST_RATE_CHANGE        BIT(1)
+#define ABORT_RATE_CHANGE       BIT(2)
+
+struct clk_notifier_data {
+    struct clk          *clk;
+    unsigned long       old_rate;
+    unsigned long       new_rate;
+};
+
+int clk_notifier_register(struct clk *clk, struct notifier_block *nb);
+int clk_notifier_unregister(struct clk *clk, struct notifier_block *nb);
+#endif
 int clk_reset(struct clk *clk, int reset);
 const char *clk_name(struct clk *clk);
 cycle_t aw_clksrc_read(struct clocksource *cs);
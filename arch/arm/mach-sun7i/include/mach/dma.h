@@ -185,7 +185,9 @@ typedef struct {
 	 */
 	xferunit_t	xfer_type;	/* dsta width and burst length */
 	addrtype_t	address_type;	/* address type */
-	bool		bconti_mode;	/* continue mode, true is continue mode, false not */
+	bool		bconti_mode;	/* continue mode, true is continue mode, false not. bufs enqueued
+					 * while running are loaded to hw on half done, back to back
+					 */
 	u8		src_drq_type;	/* src drq type */
 	u8		dst_drq_type;	/* dst drq type */
 	/*
@@ -209,6 +211,7 @@ typedef enum {
 	DMA_OP_SET_SECURITY,  		/* set security */
 	DMA_OP_SET_HD_CB,		/* set half done callback */
 	DMA_OP_SET_FD_CB,		/* set full done callback */
+	DMA_OP_GET_UNDERRUN_CNT,	/* get underrun cnt, continuous mode: hw restarted the old buf */
 	/*
 	 * only for dedicate dma below
 	 */
@@ -238,6 +241,13 @@ typedef enum {
 	CHAN_DEDICATE,		/* dedicate channel, id 8~15 */
 }dma_chan_type_e;
 
+/* slave para for dmaengine, passed to dma_request_channel with sw_dma_filter */
+struct sw_dma_slave {
+	dma_chan_type_e	type;	/* hw channel type, normal or dedicate */
+	u8		drq;	/* peripheral drq type, eg: N_DST_IIS0_TX, D_SRC_SPI0_RX */
+	dma_para_t	para;	/* para reg, for dedicate channel only */
+};
+
 /* dma export fuction */
 dma_hdl_t sw_dma_request(char * name, dma_chan_type_e type);
 u32 sw_dma_release(dma_hdl_t dma_hdl);
@@ -247,5 +257,13 @@ u32 sw_dma_ctl(dma_hdl_t dma_hdl, dma_op_type_e op, void *parg);
 int sw_dma_getposition(dma_hdl_t dma_hdl, u32 *psrc, u32 *pdst);
 void sw_dma_dump_chan(dma_hdl_t dma_hdl);
 
+/* memcpy/memset offload, phys addr, done callback called in irq context */
+u32 sw_dma_memcpy(u32 dst, u32 src, u32 len, dma_cb_t *pcb);
+u32 sw_dma_memset(u32 dst, u32 val, u32 len, dma_cb_t *pcb);
+u32 sw_dma_memcpy_sync(u32 dst, u32 src, u32 len);
+
+struct dma_chan;
+bool sw_dma_filter(struct dma_chan *chan, void *param);
+
 #endif /* __SW_DMA_H */
 
@@ -53,6 +53,8 @@ void dram_exit_power_down(void);
 void dram_hostport_on_off(unsigned int port_idx, unsigned int on);
 unsigned int dram_hostport_check_ahb_fifo_status(unsigned int port_idx);
 void dram_hostport_setup(unsigned int port, unsigned int prio, unsigned int wait_cycle, unsigned int cmd_num);
+void dram_hostport_save(void);
+void dram_hostport_restore(void);
 int dram_power_save_process(int standby_mode);
 unsigned int dram_power_up_process(void);
 
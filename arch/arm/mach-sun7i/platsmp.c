@@ -30,12 +30,14 @@ extern void sun7i_secondary_startup(void);
 
 static DEFINE_SPINLOCK(boot_lock);
 
-void __cpuinit enable_aw_cpu(int cpu)
+/*
+ * power a secondary core up and let it start at the physical address
+ * paddr. Also used by cpuidle to bring a core back from power-down.
+ */
+void sun7i_cpu_power_up(int cpu, unsigned long paddr)
 {
-    long paddr;
     u32 pwr_reg;
 
-    paddr = virt_to_phys(sun7i_secondary_startup);
     writel(paddr, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_P_REG0);
 
     /* step1: Assert nCOREPORESET LOW and hold L1RSTDISABLE LOW.
@@ -80,6 +82,44 @@ void __cpuinit enable_aw_cpu(int cpu)
     writel(pwr_reg, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_DBGCTL1);
 }
 
+/*
+ * cut the power of a secondary core, which must be in WFI with its
+ * caches flushed and out of coherency already.
+ */
+void sun7i_cpu_power_down(int cpu)
+{
+    u32 pwr_reg;
+
+    /* step8: deassert cpu core reset */
+    writel(0, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + CPUX_RESET_CTL(cpu));
+
+    /* step8: deassert DBGPWRDUP signal */
+    pwr_reg = readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_DBGCTL1);
+    pwr_reg &= ~(1<<cpu);
+    writel(pwr_reg, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPUCFG_DBGCTL1);
+
+    /* step9: set up power-off signal */
+    pwr_reg = readl(IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWROFF_REG);
+    pwr_reg |= 1;
+    writel(pwr_reg, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWROFF_REG);
+    mdelay(1);
+
+    /* step10: active the power output clamp */
+    writel(0x01, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x03, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x07, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x0f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x1f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x3f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0x7f, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+    writel(0xff, IO_ADDRESS(SW_PA_CPUCFG_IO_BASE) + AW_CPU1_PWR_CLAMP);
+}
+
+void __cpuinit enable_aw_cpu(int cpu)
+{
+    sun7i_cpu_power_up(cpu, virt_to_phys(sun7i_secondary_startup));
+}
+
 void __init smp_init_cpus(void)
 {
     unsigned int i, ncores;
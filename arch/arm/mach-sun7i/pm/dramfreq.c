@@ -0,0 +1,450 @@
+/*
+ *  linux/arch/arm/mach-sun7i/pm/dramfreq.c
+ *
+ *  Copyright (C) 2012-2016 Allwinner Ltd.
+ *  All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runtime dram clock scaling with devfreq. The controller has no
+ * dynamic frequency change, so a switch is the resume path of standby:
+ * the standby code runs from sram with the other core parked, puts the
+ * dram into self-refresh and initialises the controller again at the
+ * new clock, keeping the contents. The masters stall meanwhile.
+ *
+ * The "sunxi_dram" governor picks the clock from two things: a floor
+ * from the scanout bandwidth the display driver reports, and the load,
+ * the share of samples in which a host port FIFO held requests. A
+ * switch starts at the next vblank of a screen that is on. It takes
+ * longer than the blanking, mostly for the lock time of the pll, so it
+ * costs up to one frame of scanout; steps down are held off for
+ * hold_ms after each switch to keep them rare.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/devfreq.h>
+#include <linux/stop_machine.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/suspend.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/io.h>
+#include <linux/sunxi_dramfreq.h>
+#include <asm/cacheflush.h>
+#include "pm.h"
+
+#define DRAMFREQ_CFSR		(SW_VA_DRAM_IO_BASE + 0x234)
+#define DRAMFREQ_HPCR		(SW_VA_DRAM_IO_BASE + 0x250)
+
+#define DRAMFREQ_STEPS		4
+#define DRAMFREQ_POLL_MS	100
+#define DRAMFREQ_SAMPLES	256
+/* a frame at 24Hz and some */
+#define DRAMFREQ_VBLANK_MS	50
+
+/* the sram code, see aw_pm_enter() */
+extern char *standby_bin_start;
+extern char *standby_bin_end;
+
+static unsigned int min_mhz;
+module_param(min_mhz, uint, 0444);
+MODULE_PARM_DESC(min_mhz, "lowest dram clock in MHz, 0: the lowest the dram type allows");
+
+static unsigned int up_threshold = 40;
+module_param(up_threshold, uint, 0644);
+MODULE_PARM_DESC(up_threshold, "load in percent above which the clock goes to the maximum");
+
+static unsigned int down_differential = 15;
+module_param(down_differential, uint, 0644);
+MODULE_PARM_DESC(down_differential, "load in percent below up_threshold to settle at");
+
+static unsigned int scanout_share = 25;
+module_param(scanout_share, uint, 0644);
+MODULE_PARM_DESC(scanout_share, "largest share of the peak dram bandwidth in percent the scanout may take");
+
+static unsigned int hold_ms = 2000;
+module_param(hold_ms, uint, 0644);
+MODULE_PARM_DESC(hold_ms, "time after a switch before the clock may go down again, ms");
+
+static struct platform_device *dramfreq_pdev;
+static struct devfreq *dramfreq_devfreq;
+
+/* MHz, ascending, the last one is the clock of the boot loader */
+static unsigned int dramfreq_table[DRAMFREQ_STEPS];
+static int dramfreq_num;
+static unsigned int dramfreq_cur;
+static unsigned int dramfreq_bus_bytes;
+static unsigned long dramfreq_last_switch;
+
+/* parameter block for the sram code, one per switch */
+static struct aw_pm_info dramfreq_info;
+
+/* KB/s of both screens, from the display driver */
+static unsigned int dramfreq_scanout_kbps;
+static struct work_struct dramfreq_scanout_work;
+
+static int dramfreq_vblank_wait;
+static int dramfreq_vblank_seen;
+static DECLARE_COMPLETION(dramfreq_vblank);
+
+struct dramfreq_switch {
+	int cpu;
+	atomic_t parked;
+	int done;
+	int ret;
+};
+
+/* DDR3 below 300MHz runs the DLL out of spec, DDR2 below 125MHz */
+static unsigned int dramfreq_type_min(const standy_dram_para_t *para)
+{
+	return para->dram_type == 3 ? 312 : 144;
+}
+
+/* the CAS write latency of DDR3 follows the clock period */
+static unsigned int dramfreq_emr2(const standy_dram_para_t *para,
+				  unsigned int mhz)
+{
+	unsigned int cwl;
+
+	if (para->dram_type != 3)
+		return para->dram_emr2;
+
+	if (mhz <= 400)
+		cwl = 5;
+	else if (mhz <= 533)
+		cwl = 6;
+	else
+		cwl = 7;
+
+	return (para->dram_emr2 & ~(0x7 << 3)) | ((cwl - 5) << 3);
+}
+
+/* the pll runs in 24MHz steps */
+static void dramfreq_table_init(const standy_dram_para_t *para)
+{
+	unsigned int lo, hi, mhz;
+	int i;
+
+	hi = para->dram_clk;
+	lo = max(min_mhz, dramfreq_type_min(para));
+	lo = roundup(lo, 24);
+
+	dramfreq_num = 0;
+	if (lo >= hi) {
+		dramfreq_table[dramfreq_num++] = hi;
+		return;
+	}
+
+	for (i = 0; i < DRAMFREQ_STEPS - 1; i++) {
+		mhz = rounddown(lo + (hi - lo) * i / (DRAMFREQ_STEPS - 1), 24);
+		if (mhz < lo)
+			mhz = lo;
+		if (dramfreq_num && mhz <= dramfreq_table[dramfreq_num - 1])
+			continue;
+		dramfreq_table[dramfreq_num++] = mhz;
+	}
+	dramfreq_table[dramfreq_num++] = hi;
+}
+
+/* the lowest step that is at least mhz, the boot clock at most */
+static unsigned int dramfreq_step_up(unsigned int mhz)
+{
+	int i;
+
+	for (i = 0; i < dramfreq_num - 1; i++)
+		if (dramfreq_table[i] >= mhz)
+			break;
+
+	return dramfreq_table[i];
+}
+
+/* the clock the scanout needs at most scanout_share of */
+static unsigned int dramfreq_scanout_mhz(void)
+{
+	u64 kbps = ACCESS_ONCE(dramfreq_scanout_kbps);
+	unsigned int share = clamp(scanout_share, 1U, 100U);
+
+	/* bytes per cycle: both edges of the bus */
+	return div_u64(kbps * 1024 * 100, (u64)share * 2 * dramfreq_bus_bytes *
+		       1000000);
+}
+
+/* share of 1/256 in which a host port FIFO was not empty */
+static unsigned int dramfreq_load(void)
+{
+	u32 used = 0, empty;
+	unsigned int busy = 0;
+	int i;
+
+	for (i = 0; i < 32; i++)
+		if (readl((void __iomem *)DRAMFREQ_HPCR + 4 * i) & 0x1)
+			used |= 1U << i;
+
+	for (i = 0; i < DRAMFREQ_SAMPLES; i++) {
+		empty = readl((void __iomem *)DRAMFREQ_CFSR);
+		if ((empty & used) != used)
+			busy++;
+	}
+
+	return busy;
+}
+
+static int dramfreq_stop(void *data)
+{
+	struct dramfreq_switch *sw = data;
+	normal_standby_func standby = (normal_standby_func)SRAM_FUNC_START;
+
+	if (smp_processor_id() != sw->cpu) {
+		/* nothing of this core may be written back while dram is down */
+		flush_cache_all();
+		atomic_inc(&sw->parked);
+		while (!ACCESS_ONCE(sw->done))
+			cpu_relax();
+		return 0;
+	}
+
+	while (atomic_read(&sw->parked) < num_online_cpus() - 1)
+		cpu_relax();
+
+	/* delay_us() of the sram code counts pmu cycles */
+	backup_perfcounter();
+	init_perfcounters(0, 0);
+	flush_cache_all();
+
+	sw->ret = standby(&dramfreq_info);
+
+	restore_perfcounter();
+	smp_wmb();
+	ACCESS_ONCE(sw->done) = 1;
+
+	return sw->ret;
+}
+
+void sunxi_dramfreq_vblank(int sel)
+{
+	if (xchg(&dramfreq_vblank_wait, 0))
+		complete(&dramfreq_vblank);
+	ACCESS_ONCE(dramfreq_vblank_seen) = 1;
+}
+EXPORT_SYMBOL(sunxi_dramfreq_vblank);
+
+static int dramfreq_switch(unsigned int mhz)
+{
+	const standy_dram_para_t *para = aw_pm_dram_para();
+	struct dramfreq_switch sw;
+	int ret;
+
+	if (!para)
+		return -ENODEV;
+
+	memcpy(&dramfreq_info.dram_para, para, sizeof(dramfreq_info.dram_para));
+	dramfreq_info.dram_para.dram_clk = mhz;
+	dramfreq_info.dram_para.dram_emr2 = dramfreq_emr2(para, mhz);
+	dramfreq_info.dram_cal.valid = 0;
+	dramfreq_info.dram_freq = mhz;
+
+	memcpy((void *)SRAM_FUNC_START, (void *)&standby_bin_start,
+	       (int)&standby_bin_end - (int)&standby_bin_start);
+
+	/* start at the top of a blanking if a screen is on */
+	if (ACCESS_ONCE(dramfreq_scanout_kbps) && dramfreq_vblank_seen) {
+		INIT_COMPLETION(dramfreq_vblank);
+		xchg(&dramfreq_vblank_wait, 1);
+		if (!wait_for_completion_timeout(&dramfreq_vblank,
+				msecs_to_jiffies(DRAMFREQ_VBLANK_MS))) {
+			/* the screens went off */
+			xchg(&dramfreq_vblank_wait, 0);
+			dramfreq_vblank_seen = 0;
+		}
+	}
+
+	sw.cpu = 0;
+	atomic_set(&sw.parked, 0);
+	sw.done = 0;
+	sw.ret = 0;
+	ret = stop_machine(dramfreq_stop, &sw, cpu_online_mask);
+
+	if (ret) {
+		pr_err("dramfreq: re-init at %u MHz failed\n", mhz);
+		return -EIO;
+	}
+
+	dramfreq_cur = mhz;
+	dramfreq_last_switch = jiffies;
+
+	return 0;
+}
+
+static int dramfreq_target(struct device *dev, unsigned long *freq, u32 flags)
+{
+	unsigned int mhz = dramfreq_step_up(*freq / 1000000);
+	int ret = 0;
+
+	if (mhz != dramfreq_cur)
+		ret = dramfreq_switch(mhz);
+
+	*freq = (unsigned long)dramfreq_cur * 1000000;
+
+	return ret;
+}
+
+static int dramfreq_get_dev_status(struct device *dev,
+				   struct devfreq_dev_status *stat)
+{
+	stat->current_frequency = (unsigned long)dramfreq_cur * 1000000;
+	stat->busy_time = dramfreq_load();
+	stat->total_time = DRAMFREQ_SAMPLES;
+
+	return 0;
+}
+
+static int dramfreq_governor_target(struct devfreq *df, unsigned long *freq)
+{
+	struct devfreq_dev_status stat;
+	unsigned int floor, mhz, load, settle;
+	int ret;
+
+	ret = df->profile->get_dev_status(df->dev.parent, &stat);
+	if (ret)
+		return ret;
+
+	load = stat.busy_time * 100 / stat.total_time;
+	settle = up_threshold > down_differential ?
+		 up_threshold - down_differential : 1;
+
+	if (load >= up_threshold)
+		mhz = dramfreq_table[dramfreq_num - 1];
+	else
+		mhz = dramfreq_cur * load / settle;
+
+	floor = dramfreq_scanout_mhz();
+	mhz = dramfreq_step_up(max(mhz, floor));
+
+	/* down only after hold_ms; up, and at once for the scanout, always */
+	if (mhz < dramfreq_cur &&
+	    time_before(jiffies, dramfreq_last_switch + msecs_to_jiffies(hold_ms)))
+		mhz = dramfreq_cur;
+
+	*freq = (unsigned long)mhz * 1000000;
+	if (df->min_freq && *freq < df->min_freq)
+		*freq = df->min_freq;
+	if (df->max_freq && *freq > df->max_freq)
+		*freq = df->max_freq;
+
+	return 0;
+}
+
+static const struct devfreq_governor dramfreq_governor = {
+	.name = "sunxi_dram",
+	.get_target_freq = dramfreq_governor_target,
+};
+
+static struct devfreq_dev_profile dramfreq_profile = {
+	.polling_ms = DRAMFREQ_POLL_MS,
+	.target = dramfreq_target,
+	.get_dev_status = dramfreq_get_dev_status,
+};
+
+/* a new layer may need more right away, don't wait for the poll */
+static void dramfreq_scanout_work_fn(struct work_struct *work)
+{
+	struct devfreq *df = dramfreq_devfreq;
+	unsigned long freq;
+
+	if (!df)
+		return;
+
+	mutex_lock(&df->lock);
+	freq = (unsigned long)dramfreq_step_up(dramfreq_scanout_mhz()) * 1000000;
+	if (df->max_freq && freq > df->max_freq)
+		freq = df->max_freq;
+	if (freq > (unsigned long)dramfreq_cur * 1000000 &&
+	    !dramfreq_target(df->dev.parent, &freq, 0))
+		df->previous_freq = freq;
+	mutex_unlock(&df->lock);
+}
+
+void sunxi_dramfreq_scanout(unsigned int kbps)
+{
+	unsigned int old = xchg(&dramfreq_scanout_kbps, kbps);
+
+	if (dramfreq_devfreq && kbps > old)
+		queue_work(system_freezable_wq, &dramfreq_scanout_work);
+}
+EXPORT_SYMBOL(sunxi_dramfreq_scanout);
+
+/* standby brings the dram back at the clock of the boot loader */
+static int dramfreq_pm_notify(struct notifier_block *nb, unsigned long event,
+			      void *unused)
+{
+	struct devfreq *df = dramfreq_devfreq;
+
+	if (event != PM_POST_SUSPEND || !df)
+		return NOTIFY_DONE;
+
+	mutex_lock(&df->lock);
+	dramfreq_cur = dramfreq_table[dramfreq_num - 1];
+	dramfreq_last_switch = jiffies;
+	df->previous_freq = (unsigned long)dramfreq_cur * 1000000;
+	mutex_unlock(&df->lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block dramfreq_pm_nb = {
+	.notifier_call = dramfreq_pm_notify,
+};
+
+static int __init dramfreq_init(void)
+{
+	const standy_dram_para_t *para = aw_pm_dram_para();
+	int i;
+
+	if (!para || !para->dram_bus_width) {
+		pr_info("dramfreq: no dram_para, the clock stays fixed\n");
+		return -ENODEV;
+	}
+
+	dramfreq_table_init(para);
+	if (dramfreq_num < 2) {
+		pr_info("dramfreq: %u MHz is the lowest already\n", para->dram_clk);
+		return -ENODEV;
+	}
+	dramfreq_cur = para->dram_clk;
+	dramfreq_bus_bytes = para->dram_bus_width / 8;
+	dramfreq_last_switch = jiffies;
+	INIT_WORK(&dramfreq_scanout_work, dramfreq_scanout_work_fn);
+
+	dramfreq_pdev = platform_device_register_simple("sunxi-dramfreq", -1,
+							NULL, 0);
+	if (IS_ERR(dramfreq_pdev))
+		return PTR_ERR(dramfreq_pdev);
+
+	dramfreq_profile.initial_freq = (unsigned long)dramfreq_cur * 1000000;
+	dramfreq_devfreq = devfreq_add_device(&dramfreq_pdev->dev,
+					      &dramfreq_profile,
+					      &dramfreq_governor, NULL);
+	if (IS_ERR(dramfreq_devfreq)) {
+		pr_err("dramfreq: devfreq_add_device failed (%ld)\n",
+		       PTR_ERR(dramfreq_devfreq));
+		dramfreq_devfreq = NULL;
+		platform_device_unregister(dramfreq_pdev);
+		return -ENODEV;
+	}
+	dramfreq_devfreq->min_freq = (unsigned long)dramfreq_table[0] * 1000000;
+	dramfreq_devfreq->max_freq = (unsigned long)dramfreq_cur * 1000000;
+	register_pm_notifier(&dramfreq_pm_nb);
+
+	pr_info("dramfreq: steps");
+	for (i = 0; i < dramfreq_num; i++)
+		pr_cont(" %u", dramfreq_table[i]);
+	pr_cont(" MHz\n");
+
+	return 0;
+}
+late_initcall(dramfreq_init);
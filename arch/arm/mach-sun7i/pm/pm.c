@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/major.h>
 #include <linux/device.h>
+#include <linux/ktime.h>
 #include <asm/uaccess.h>
 #include <asm/delay.h>
 #include <linux/delay.h>
@@ -73,6 +74,35 @@ static int standby_timeout = 0;
 
 static int suspend_freq = SUSPEND_FREQ;
 
+/* reuse the dram training of the last standby while dram_para is the same */
+static int dram_fast_resume = 1;
+static standy_dram_para_t dram_cal_para;
+
+/*
+ * time stamps of the platform callbacks, the sleep itself is between
+ * prepare_late and wake, timekeeping is suspended in enter.
+ */
+enum {
+    PM_PHASE_BEGIN,
+    PM_PHASE_PREPARE,
+    PM_PHASE_PREPARE_LATE,
+    PM_PHASE_WAKE,
+    PM_PHASE_FINISH,
+    PM_PHASE_END,
+    PM_PHASE_NUM
+};
+static ktime_t pm_phase_time[PM_PHASE_NUM];
+
+static inline void pm_phase_stamp(int phase)
+{
+    pm_phase_time[phase] = ktime_get();
+}
+
+static inline unsigned int pm_phase_us(int from, int to)
+{
+    return (unsigned int)ktime_us_delta(pm_phase_time[to], pm_phase_time[from]);
+}
+
 extern char *standby_bin_start;
 extern char *standby_bin_end;
 
@@ -177,6 +207,8 @@ int aw_pm_begin(suspend_state_t state)
     struct cpufreq_policy *policy;
 
     PM_DBG("%d state begin:%d\n", state,debug_mask);
+    memset(pm_phase_time, 0, sizeof(pm_phase_time));
+    pm_phase_stamp(PM_PHASE_BEGIN);
 
     //set freq max
 #ifdef CONFIG_CPU_FREQ_USR_EVNT_NOTIFY
@@ -238,6 +270,7 @@ out:
 int aw_pm_prepare(void)
 {
     PM_DBG("prepare\n");
+    pm_phase_stamp(PM_PHASE_PREPARE);
 
     return 0;
 }
@@ -261,6 +294,7 @@ int aw_pm_prepare(void)
 int aw_pm_prepare_late(void)
 {
     PM_DBG("prepare_late\n");
+    pm_phase_stamp(PM_PHASE_PREPARE_LATE);
 
     return 0;
 }
@@ -313,8 +347,14 @@ static int aw_pm_enter(suspend_state_t state)
             standby_info.standby_para.event_enable = (SUSPEND_WAKEUP_SRC_EXINT | SUSPEND_WAKEUP_SRC_ALARM | SUSPEND_WAKEUP_SRC_TIMEOFF);
             standby_info.standby_para.time_off = standby_timeout;
         }
+        /* the cached dram training only holds for the parameters it was made with */
+        if (!dram_fast_resume ||
+            memcmp(&dram_cal_para, &standby_info.dram_para, sizeof(dram_cal_para)))
+            standby_info.dram_cal.valid = 0;
         /* goto sram and run */
         standby(&standby_info);
+        if (standby_info.dram_cal.valid)
+            memcpy(&dram_cal_para, &standby_info.dram_para, sizeof(dram_cal_para));
 
     dogMode = pm_enable_watchdog();
 
@@ -348,6 +388,7 @@ static int aw_pm_enter(suspend_state_t state)
 */
 static void aw_pm_wake(void)
 {
+    pm_phase_stamp(PM_PHASE_WAKE);
     PM_DBG("platform wakeup, wakesource is:0x%x\n", standby_info.standby_para.event);
 }
 
@@ -367,6 +408,7 @@ static void aw_pm_wake(void)
 */
 void aw_pm_finish(void)
 {
+    pm_phase_stamp(PM_PHASE_FINISH);
     PM_DBG("platform wakeup finish\n");
 }
 
@@ -411,7 +453,18 @@ void aw_pm_end(void)
         cpufreq_update_policy(0);
     }
     pm_disable_watchdog(dogMode);
-    
+
+    pm_phase_stamp(PM_PHASE_END);
+    /* the transition was aborted if it didn't get to wake */
+    if((debug_mask&PM_STANDBY_PRINT_RESUME) && pm_phase_time[PM_PHASE_WAKE].tv64){
+        printk("[pm]suspend: devices %uus, late %uus; resume: early %uus, devices %uus; dram %s\n",
+               pm_phase_us(PM_PHASE_BEGIN, PM_PHASE_PREPARE),
+               pm_phase_us(PM_PHASE_PREPARE, PM_PHASE_PREPARE_LATE),
+               pm_phase_us(PM_PHASE_WAKE, PM_PHASE_FINISH),
+               pm_phase_us(PM_PHASE_FINISH, PM_PHASE_END),
+               standby_info.dram_cal.fast ? "cached" : "trained");
+    }
+
     if(unlikely(debug_mask&PM_STANDBY_PRINT_REG)){
         printk("after dev suspend, line:%d\n", __LINE__);
         show_reg(SW_VA_CCM_IO_BASE, (CCU_REG_LENGTH)*4, "ccu");
@@ -558,6 +611,12 @@ static int fetch_and_save_dram_para(standy_dram_para_t *pstandby_dram_para)
 	return 0;
 }
 
+/* dram parameter of the boot loader, NULL if sys_config has none */
+const standy_dram_para_t *aw_pm_dram_para(void)
+{
+	return standby_info.dram_para.dram_clk ? &standby_info.dram_para : NULL;
+}
+
 /*
 *********************************************************************************************************
 *                           aw_pm_init
@@ -648,5 +707,6 @@ module_param_named(standby_axp_enable, standby_axp_enable, int, S_IRUGO | S_IWUS
 module_param_named(standby_timeout, standby_timeout, int, S_IRUGO | S_IWUSR | S_IWGRP);
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 module_param_named(suspend_freq, suspend_freq, int, S_IRUGO | S_IWUSR | S_IWGRP);
+module_param_named(dram_fast_resume, dram_fast_resume, int, S_IRUGO | S_IWUSR | S_IWGRP);
 module_init(aw_pm_init);
 module_exit(aw_pm_exit);
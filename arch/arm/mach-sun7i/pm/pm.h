@@ -110,6 +110,9 @@ struct aw_mem_para{
 typedef  int (*super_standby_func)(void);
 typedef  int (*normal_standby_func)(struct aw_pm_info *arg);
 
+/*pm.c*/
+extern const standy_dram_para_t *aw_pm_dram_para(void);
+
 /*mem_mmu_pc_asm.S*/
 extern unsigned int save_sp_nommu(void);
 extern unsigned int save_sp(void);
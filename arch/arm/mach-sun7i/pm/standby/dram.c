@@ -530,3 +530,38 @@ void dram_hostport_setup(__u32 port, __u32 prio, __u32 wait_cycle, __u32 cmd_num
 	DRAMC_hostport_setup(port, prio, wait_cycle, cmd_num);
 }
 
+/*
+ * host port setup around a dram re-init in normal operation, the init
+ * writes its own defaults into the HPCRs.
+ */
+static __u32 hpcr_backup[32];
+
+void dram_hostport_save(void)
+{
+	__u32 i;
+	__u32 used = 0;
+
+	for(i=0; i<32; i++)
+	{
+		hpcr_backup[i] = mctl_read_w(SDR_HPCR + (i<<2));
+		if(hpcr_backup[i] & 0x1)
+			used |= 0x1U<<i;
+		DRAMC_hostport_on_off(i, 0x0);
+	}
+
+	//wait for the FIFOs of the enabled ports to drain
+	i = 0x100000;
+	while(((mctl_read_w(SDR_CFSR) & used) != used) && --i);
+}
+
+
+void dram_hostport_restore(void)
+{
+	__u32 i;
+
+	for(i=0; i<32; i++)
+	{
+		mctl_write_w(SDR_HPCR + (i<<2), hpcr_backup[i]);
+	}
+}
+
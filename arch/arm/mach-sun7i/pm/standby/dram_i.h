@@ -99,6 +99,7 @@ extern void mctl_enable_dllx(__u32 phase);
 extern void mctl_disable_dll(void);
 extern void DRAMC_hostport_on_off(__u32 port_idx, __u32 on);
 extern __s32 init_DRAM(standy_dram_para_t *boot0_para);
+extern __s32 init_DRAM_cal(standy_dram_para_t *para, struct aw_dram_cal *cal);
 
 
 #endif  //__DRAM_REG_H__
@@ -298,7 +298,12 @@ void mctl_setup_dram_clock(__u32 clk)
     
 }
 
-__s32 DRAMC_init(__dram_para_t *para)
+/*
+ * cal: calibration of an earlier full init with the same parameters,
+ * used instead of the zq calibration and the read pipe scan; NULL for
+ * a full init.
+ */
+static __s32 __DRAMC_init(__dram_para_t *para, struct aw_dram_cal *cal)
 {
     __u32 reg_val;
 	__u32 hold_flag = 0;
@@ -364,7 +369,13 @@ __s32 DRAMC_init(__dram_para_t *para)
     DRAMC_clock_output_en(1);
     
     hold_flag = mctl_read_w(SDR_DPCR);
-    if(hold_flag == 0) //normal branch
+    if((hold_flag == 0) && cal)
+    {
+        //zq value of the last calibration, manual mode
+        reg_val = (cal->zq & 0xfffff) | (0x1<<28) | (para->dram_zq<<20);
+        mctl_write_w(SDR_ZQCR0, reg_val);
+    }
+    else if(hold_flag == 0) //normal branch
     {
         //set odt impendance divide ratio
         reg_val=((para->dram_zq)>>8)&0xfffff;
@@ -507,7 +518,13 @@ __s32 DRAMC_init(__dram_para_t *para)
     //scan read pipe value
     mctl_itm_enable();
     
-    if(hold_flag == 0)//normal branch
+    if((hold_flag == 0) && cal)
+    {
+        //read pipe values of the last scan
+        mctl_write_w(SDR_RSLR0, cal->rslr0);
+        mctl_write_w(SDR_RDQSGR, cal->rdqsgr);
+    }
+    else if(hold_flag == 0)//normal branch
     {
     	ret_val = DRAMC_scan_readpipe();
     	
@@ -535,6 +552,11 @@ __s32 DRAMC_init(__dram_para_t *para)
     return DRAMC_get_dram_size();
 }
 
+__s32 DRAMC_init(__dram_para_t *para)
+{
+    return __DRAMC_init(para, 0);
+}
+
 
 
 __s32 DRAMC_scan_readpipe(void)
@@ -727,6 +749,72 @@ __s32 init_DRAM(standy_dram_para_t *boot0_para)
 }
 
 
+/*
+*********************************************************************************************************
+*                                   DRAM INIT WITH CACHED CALIBRATION
+*
+* Description: re-init dram after standby, with the training result of the last full init
+*              if there is one, else with a full init that fills it in.
+*
+* Arguments  : para     dram parameter;
+*              cal      calibration cache, valid is cleared when it doesn't hold;
+*
+* Returns    : dram size, 0 for fail;
+*
+* Note       : the test pattern goes to the start of dram, the training area the caller
+*              restores afterwards.
+*********************************************************************************************************
+*/
+/* start of the training area standby.c saves and restores */
+#define DRAM_BASE_ADDR      0xc0000000
+
+static __u32 dram_test_pattern[4] = {0x5a5aa5a5, 0xa5a55a5a, 0x00ff00ff, 0xff00ff00};
+
+static __s32 mctl_check_pattern(void)
+{
+    volatile __u32 *addr = (volatile __u32 *)DRAM_BASE_ADDR;
+    __u32 i;
+
+    for(i = 0; i < 4; i++)
+        addr[i] = dram_test_pattern[i];
+    for(i = 0; i < 4; i++)
+    {
+        if(addr[i] != dram_test_pattern[i])
+            return -1;
+    }
+
+    return 0;
+}
+
+__s32 init_DRAM_cal(standy_dram_para_t *para, struct aw_dram_cal *cal)
+{
+    __s32 ret_val;
+
+    cal->fast = 0;
+    if(cal->valid)
+    {
+        ret_val = __DRAMC_init(para, cal);
+        if(ret_val && (mctl_check_pattern() == 0))
+        {
+            cal->fast = 1;
+            return ret_val;
+        }
+        cal->valid = 0;
+    }
+
+    ret_val = init_DRAM(para);
+    if(ret_val && !mctl_read_w(SDR_DPCR))
+    {
+        cal->zq     = mctl_read_w(SDR_ZQSR) & 0xfffff;
+        cal->rslr0  = mctl_read_w(SDR_RSLR0);
+        cal->rdqsgr = mctl_read_w(SDR_RDQSGR);
+        cal->valid  = 1;
+    }
+
+    return ret_val;
+}
+
+
 __s32 dram_exit(void)
 {
     return 0;
@@ -22,6 +22,9 @@ extern unsigned int save_sp(void);
 extern void restore_sp(unsigned int sp);
 extern void mem_flush_tlb(void);
 extern void mem_preload_tlb(void);
+extern __s32 init_DRAM_cal(standy_dram_para_t *para, struct aw_dram_cal *cal);
+extern void dram_hostport_save(void);
+extern void dram_hostport_restore(void);
 extern char *__bss_start;
 extern char *__bss_end;
 extern char *__standby_start;
@@ -29,6 +32,7 @@ extern char *__standby_end;
 
 static __u32 sp_backup;
 static void standby(void);
+static int dram_freq_change(struct aw_pm_info *arg);
 static __u32 dcdc2, dcdc3;
 static struct pll_factor_t orig_pll;
 static struct pll_factor_t local_pll;
@@ -59,6 +63,10 @@ int main(struct aw_pm_info *arg)
 {
     char    *tmpPtr;
 
+    /* dram clock change in normal operation */
+    if(arg && arg->dram_freq)
+        return dram_freq_change(arg);
+
     tmpPtr = (char *)&__bss_start;
     printk("normal standby start!\n");
     printk("__bss_start:%x!\n",&__bss_start);
@@ -140,7 +148,7 @@ int main(struct aw_pm_info *arg)
     /* restore dram */
     //dram_power_up_process();
 	//mctl_self_refresh_exit();
-    init_DRAM(&pm_info.dram_para);
+    init_DRAM_cal(&pm_info.dram_para, &pm_info.dram_cal);
     
     /* disable watch-dog    */
     standby_tmr_disable_watchdog();
@@ -172,11 +180,58 @@ int main(struct aw_pm_info *arg)
 
     /* report which wake source wakeup system */
     arg->standby_para.event = pm_info.standby_para.event;
+    /* keep the dram training result for the next standby */
+    standby_memcpy(&arg->dram_cal, &pm_info.dram_cal, sizeof(pm_info.dram_cal));
 
     return 0;
 }
 
 
+/*
+*********************************************************************************************************
+*                                     DRAM CLOCK CHANGE
+*
+* Description: re-init the dram at the clock in arg->dram_para, the contents stay in self-refresh.
+*
+* Arguments  : arg  dram parameter and calibration cache from the kernel.
+*
+* Returns    : 0 for success, -1 if the init failed;
+*
+* Note       : the kernel parks the other core and cleans the caches first. The masters stall
+*              while their host port is off.
+*********************************************************************************************************
+*/
+static int dram_freq_change(struct aw_pm_info *arg)
+{
+    char    *tmpPtr = (char *)&__bss_start;
+    __s32   ret;
+
+    mem_flush_tlb();
+    mem_preload_tlb();
+
+    do{*tmpPtr ++ = 0;}while(tmpPtr <= (char *)&__bss_end);
+
+    standby_memcpy(&pm_info, arg, sizeof(pm_info));
+    standby_memcpy((char *)dram_traning_area_back, (char *)DRAM_BASE_ADDR, DRAM_TRANING_SIZE);
+    /* delay_us() counts cycles of the current cpu clock */
+    change_runtime_env(1);
+
+    sp_backup = save_sp();
+
+    dram_hostport_save();
+    dram_power_save_process(0);
+    ret = init_DRAM_cal(&pm_info.dram_para, &pm_info.dram_cal);
+    dram_hostport_restore();
+
+    restore_sp(sp_backup);
+
+    standby_memcpy((char *)DRAM_BASE_ADDR, (char *)dram_traning_area_back, DRAM_TRANING_SIZE);
+    standby_memcpy(&arg->dram_cal, &pm_info.dram_cal, sizeof(pm_info.dram_cal));
+
+    return ret ? 0 : -1;
+}
+
+
 /*
 *********************************************************************************************************
 *                                     SYSTEM PWM ENTER STANDBY MODE
@@ -3,6 +3,9 @@
 #include <linux/rfkill.h>
 #include <linux/delay.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 #include <plat/sys_config.h>
 
 #define RF_MSG(...)     do {printk("[rfkill]: "__VA_ARGS__);} while(0)
@@ -27,11 +30,35 @@ static const char bt_name[] = "bcm40183";
 static struct rfkill *sw_rfkill;
 static int bt_used;
 
+/*
+ * The module needs 10ms after its lines switch. That runs on a
+ * delayed work: the next toggle waits for it, a toggle from userspace
+ * returns only once it is over since hciattach talks to the chip
+ * right away, the one rfkill makes on resume doesn't.
+ */
+#define BT_SETTLE_MS	10
+
+static DECLARE_COMPLETION(bt_settled);
+static struct delayed_work bt_settle_work;
+static ktime_t bt_power_start;
+static int bt_resuming;
+
+static void bt_settle(struct work_struct *work)
+{
+	RF_MSG("power settled after %lld us\n",
+	       ktime_us_delta(ktime_get(), bt_power_start));
+	complete_all(&bt_settled);
+}
+
 static int rfkill_set_power(void *data, bool blocked)
 {
 	unsigned int mod_sel = wifi_pm_get_mod_type();
     
 	RF_MSG("rfkill set power %d\n", blocked);
+
+	wait_for_completion(&bt_settled);
+	INIT_COMPLETION(bt_settled);
+	bt_power_start = ktime_get();
     
 	switch (mod_sel)
 	{
@@ -69,8 +96,10 @@ static int rfkill_set_power(void *data, bool blocked)
         default:
 		RF_MSG("no bt module matched !!\n");
 	}
-    
-	msleep(10);
+
+	schedule_delayed_work(&bt_settle_work, msecs_to_jiffies(BT_SETTLE_MS));
+	if (!bt_resuming)
+		wait_for_completion(&bt_settled);
 	return 0;
 }
 
@@ -103,12 +132,34 @@ static int sw_rfkill_remove(struct platform_device *pdev)
 	return 0;
 }
 
+#ifdef CONFIG_PM
+/* the rfkill child restores its state between these two */
+static int sw_rfkill_resume(struct device *dev)
+{
+	bt_resuming = 1;
+	return 0;
+}
+
+static void sw_rfkill_complete(struct device *dev)
+{
+	bt_resuming = 0;
+}
+
+static const struct dev_pm_ops sw_rfkill_pm_ops = {
+	.resume = sw_rfkill_resume,
+	.complete = sw_rfkill_complete,
+};
+#endif
+
 static struct platform_driver sw_rfkill_driver = {
 	.probe = sw_rfkill_probe,
 	.remove = sw_rfkill_remove,
 	.driver = { 
 		.name = "sunxi-rfkill",
 		.owner = THIS_MODULE,
+#ifdef CONFIG_PM
+		.pm = &sw_rfkill_pm_ops,
+#endif
 	},
 };
 
@@ -131,6 +182,9 @@ static int __init sw_rfkill_init(void)
 		return 0;
 	}
 
+	INIT_DELAYED_WORK(&bt_settle_work, bt_settle);
+	complete_all(&bt_settled);
+
 	platform_device_register(&sw_rfkill_dev);
 	return platform_driver_register(&sw_rfkill_driver);
 }
@@ -144,6 +198,7 @@ static void __exit sw_rfkill_exit(void)
 
 	platform_device_unregister(&sw_rfkill_dev);
 	platform_driver_unregister(&sw_rfkill_driver);
+	flush_delayed_work_sync(&bt_settle_work);
 }
 
 module_init(sw_rfkill_init);
@@ -5,6 +5,10 @@
 #include <plat/sys_config.h>
 #include <mach/gpio.h>
 #include <linux/proc_fs.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
 #include "wifi_pm.h"
 
 #define wifi_pm_msg(...)    do {printk("[wifi_pm]: "__VA_ARGS__);} while(0)
@@ -24,6 +28,51 @@ static char* wifi_mod[] = {" ",
 			   "rtl8723au",  /* 10 - RTL8723AU */
 };
 
+/*
+ * Power sequencing. The module's power() only switches its lines, the
+ * settle time after that runs on a delayed work instead of a delay in
+ * the caller. The work rescans the sdio slot if that was asked for and
+ * completes wifi_pm_settled; whoever has to talk to the module sleeps
+ * on it in wifi_pm_power_wait(). A transition waits for the previous
+ * one to settle before it starts.
+ */
+static DECLARE_COMPLETION(wifi_pm_settled);
+static DEFINE_MUTEX(wifi_pm_lock);
+static struct delayed_work wifi_pm_settle_work;
+static ktime_t wifi_pm_power_start;
+static int wifi_pm_rescan_id = -1;
+static s64 wifi_pm_settle_us;
+static s64 wifi_pm_ready_us;
+
+static void wifi_pm_settle(struct work_struct *work)
+{
+	wifi_pm_settle_us = ktime_us_delta(ktime_get(), wifi_pm_power_start);
+	if (wifi_pm_rescan_id >= 0)
+		sunximmc_rescan_card(wifi_pm_rescan_id, 1);
+	complete_all(&wifi_pm_settled);
+}
+
+static void wifi_pm_sequence(int on, int rescan_id)
+{
+	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
+	int power = on;
+
+	mutex_lock(&wifi_pm_lock);
+	wait_for_completion(&wifi_pm_settled);
+	INIT_COMPLETION(wifi_pm_settled);
+
+	wifi_pm_power_start = ktime_get();
+	wifi_pm_ready_us = 0;
+	wifi_pm_rescan_id = on ? rescan_id : -1;
+	ops->power(1, &power);
+	if (!on && rescan_id >= 0)
+		sunximmc_rescan_card(rescan_id, 0);
+
+	schedule_delayed_work(&wifi_pm_settle_work,
+			      msecs_to_jiffies(ops->settle_ms));
+	mutex_unlock(&wifi_pm_lock);
+}
+
 int wifi_pm_get_mod_type(void)
 {
 	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
@@ -48,13 +97,13 @@ int wifi_pm_gpio_ctrl(char* name, int level)
 }
 EXPORT_SYMBOL(wifi_pm_gpio_ctrl);
 
+/* returns once the lines are switched, see wifi_pm_power_wait() */
 void wifi_pm_power(int on)
 {
 	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
-	int power = on;
 
 	if (ops->wifi_used && ops->power)
-		return ops->power(1, &power);
+		return wifi_pm_sequence(on, -1);
 	else {
 		wifi_pm_msg("No select wifi, please check your config !!\n");
 		return;
@@ -62,6 +111,41 @@ void wifi_pm_power(int on)
 }
 EXPORT_SYMBOL(wifi_pm_power);
 
+/* power an sdio module, the slot is rescanned once it has settled */
+void wifi_pm_power_sdio(int on, unsigned int sdio_id)
+{
+	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
+
+	if (ops->wifi_used && ops->power)
+		return wifi_pm_sequence(on, sdio_id);
+	else {
+		wifi_pm_msg("No select wifi, please check your config !!\n");
+		return;
+	}
+}
+EXPORT_SYMBOL(wifi_pm_power_sdio);
+
+int wifi_pm_power_wait(unsigned int timeout_ms)
+{
+	if (!wait_for_completion_timeout(&wifi_pm_settled,
+					 msecs_to_jiffies(timeout_ms)))
+		return -ETIMEDOUT;
+	return 0;
+}
+EXPORT_SYMBOL(wifi_pm_power_wait);
+
+/* the driver saw the module answer, report how long that took */
+void wifi_pm_power_ready(void)
+{
+	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
+
+	wifi_pm_ready_us = ktime_us_delta(ktime_get(), wifi_pm_power_start);
+	wifi_pm_msg("%s ready %lld ms after power on (settled at %lld ms)\n",
+		    ops->mod_name, wifi_pm_ready_us / 1000,
+		    wifi_pm_settle_us / 1000);
+}
+EXPORT_SYMBOL(wifi_pm_power_ready);
+
 #ifdef CONFIG_PROC_FS
 static int wifi_pm_power_stat(char *page, char **start, off_t off, int count, int *eof, void *data)
 {
@@ -73,6 +157,8 @@ static int wifi_pm_power_stat(char *page, char **start, off_t off, int count, in
 		ops->power(0, &power);
 
 	p += sprintf(p, "%s : power state %s\n", ops->mod_name, power ? "on" : "off");
+	p += sprintf(p, "settled %lld ms, ready %lld ms after the last power on\n",
+		     wifi_pm_settle_us / 1000, wifi_pm_ready_us / 1000);
 	return p - page;
 }
 
@@ -83,7 +169,7 @@ static int wifi_pm_power_ctrl(struct file *file, const char __user *buffer, unsi
     
 	power = power ? 1 : 0;
 	if (ops->power)
-		ops->power(1, &power);
+		wifi_pm_sequence(power, -1);
 	else
 		wifi_pm_msg("No power control for %s\n", ops->mod_name);
 	return sizeof(power);	
@@ -239,6 +325,8 @@ static int __init wifi_pm_init(void)
 	struct wifi_pm_ops *ops = &wifi_select_pm_ops;
 
 	memset(ops, 0, sizeof(struct wifi_pm_ops));
+	INIT_DELAYED_WORK(&wifi_pm_settle_work, wifi_pm_settle);
+	complete_all(&wifi_pm_settled);
 	wifi_pm_get_res();
 	if (!ops->wifi_used)
 		return 0;
@@ -254,6 +342,7 @@ static void __exit wifi_pm_exit(void)
 		return;
 
 	platform_driver_unregister(&wifi_pm_driver);
+	flush_delayed_work_sync(&wifi_pm_settle_work);
 	memset(ops, 0, sizeof(struct wifi_pm_ops));
 }
 
@@ -12,6 +12,8 @@ struct wifi_pm_ops {
 	int   sdio_id;
 	int   usb_id;
 	int   module_sel;
+	/* time to settle after a power transition, ms */
+	unsigned int settle_ms;
 	int   (*gpio_ctrl)(char* name, int level);	
 	void  (*standby)(int in);
 	void  (*power)(int mode, int *updown);
@@ -25,6 +27,6 @@ struct wifi_pm_ops {
 void ap6xxx_gpio_init(void);
 
 extern struct wifi_pm_ops wifi_select_pm_ops;
-extern void sw_mci_rescan_card(unsigned id, unsigned insert);
+extern void sunximmc_rescan_card(unsigned id, unsigned insert);
 
 #endif
@@ -78,14 +78,12 @@ static int ap6xxx_gpio_read(char* name)
 
 void ap6xxx_power(int mode, int *updown)
 {
+	/* the 100ms settle time is waited for by wifi_pm */
 	if (mode) {
-		if (*updown) {
+		if (*updown)
 			ap6xxx_gpio_ctrl("ap6xxx_wl_regon", 1);
-			mdelay(100);
-		} else {
+		else
 			ap6xxx_gpio_ctrl("ap6xxx_wl_regon", 0);
-			mdelay(100);
-		}
 		pr_info("sdio wifi power state: %s\n", *updown ? "on" : "off");
 	} else {
 		*updown = ap6xxx_gpio_read("ap6xxx_wl_regon");
@@ -147,4 +145,5 @@ void ap6xxx_gpio_init(void)
 
 	ops->gpio_ctrl	= ap6xxx_gpio_ctrl;
 	ops->power = ap6xxx_power;
+	ops->settle_ms = 100;
 }
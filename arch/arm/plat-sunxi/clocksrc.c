@@ -150,22 +150,43 @@ cycle_t aw_clksrc_read(struct clocksource *cs)
 }
 EXPORT_SYMBOL(aw_clksrc_read);
 
-u32 aw_sched_clock_read(void)
+/*
+ * The 64bits counter has to be latched and polled under a lock for
+ * every read. Timer2 instead runs free on the 24M osc, counting down
+ * from 0xffffffff, and its current value is a single register read.
+ * It backs sched_clock and the clocksource timekeeping reads for
+ * gettimeofday; the generic code extends its 32 bits.
+ */
+static cycle_t aw_free_tmr_read(struct clocksource *cs)
 {
-	u32 lower;
-	unsigned long flags;
-
-	spin_lock_irqsave(&clksrc_lock, flags);
+	return ~TMR_REG_TMR_CUR(AW_FREE_TMR);
+}
 
-	/* latch 64bit counter and wait ready for read */
-	TMR_REG_CNT64_CTL |= (1 << 1);
-	while (TMR_REG_CNT64_CTL & (1 << 1)) {}
+/* also on resume, the timer block may have lost power */
+static void aw_free_tmr_start(struct clocksource *cs)
+{
+	/* continuous, no pre-scale, osc24M, reload 0xffffffff */
+	TMR_REG_TMR_CTL(AW_FREE_TMR) = 0;
+	__delay(50);
+	TMR_REG_TMR_INTV(AW_FREE_TMR) = 0xffffffff;
+	TMR_REG_TMR_CTL(AW_FREE_TMR) = (0b01 << 2) | (1 << 1);
+	while (TMR_REG_TMR_CTL(AW_FREE_TMR) & (1 << 1)) {}
+	TMR_REG_TMR_CTL(AW_FREE_TMR) |= (1 << 0);
+}
 
-	/* read the low 32bits counter */
-	lower = TMR_REG_CNT64_LO;
-	spin_unlock_irqrestore(&clksrc_lock, flags);
+static struct clocksource aw_free_tmr_clksrc =
+{
+    .name = "aw_free_timer2",
+    .rating = 350,                  /* above the latched 64bits counter */
+    .read = aw_free_tmr_read,
+    .resume = aw_free_tmr_start,
+    .mask = CLOCKSOURCE_MASK(32),
+    .flags = CLOCK_SOURCE_IS_CONTINUOUS,
+};
 
-	return lower;
+u32 notrace aw_sched_clock_read(void)
+{
+	return ~TMR_REG_TMR_CUR(AW_FREE_TMR);
 }
 
 /*
@@ -341,6 +362,9 @@ int __init aw_clksrc_init(void)
 		while (TMR_REG_CNT64_CTL & (1 << 0)) {}
 	}
 
+	aw_free_tmr_start(NULL);
+	clocksource_register_hz(&aw_free_tmr_clksrc, AW_HPET_CLOCK_SOURCE_HZ);
+
 	CLKSRC_DBG("register all-winners clock source!\n");
 	/* calculate the mult by shift  */
 	aw_clocksrc.mult = clocksource_hz2mult(AW_HPET_CLOCK_SOURCE_HZ,
@@ -35,6 +35,9 @@
 #define TMR_REG_TMR_INTV(x)	__tmr_x_reg((x), 0x04)
 #define TMR_REG_TMR_CUR(x)	__tmr_x_reg((x), 0x08)
 
+/* free running timer for sched_clock, timer0/1 are the clock events */
+#define AW_FREE_TMR		2
+
 #ifndef CONFIG_ARCH_SUN7I
 #define TMR_REG_CNT64_CTL       __tmr_reg(0xa0)
 #define TMR_REG_CNT64_LO        __tmr_reg(0xa4)
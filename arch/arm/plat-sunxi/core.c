@@ -37,6 +37,9 @@
 #include <linux/bootmem.h>
 #include <linux/export.h>
 #include <linux/clkdev.h>
+#include <linux/cpu.h>
+#include <linux/irq.h>
+#include <linux/mutex.h>
 
 #include <asm/arch_timer.h>
 #include <asm/sched_clock.h>
@@ -180,14 +183,40 @@ static int __init reserve_ve_param(char *s)
 early_param("sunxi_ve_mem_reserve", reserve_ve_param);
 #endif
 
+#if IS_ENABLED(CONFIG_ION_SUNXI) && !defined(CONFIG_CMA)
+/* The ION block is used by:
+ *
+ * - the VE window carveout heap of the sunxi ion device,
+ *   drivers/gpu/ion/sunxi
+ *
+ * With CMA the ion heaps allocate from the CMA area instead.
+ */
+
+#define RESERVE_ION_MEM 1
+
+unsigned long ion_start;
+unsigned long ion_size = SZ_64M;
+EXPORT_SYMBOL(ion_start);
+EXPORT_SYMBOL(ion_size);
+
+static int __init reserve_ion_param(char *s)
+{
+	unsigned long size;
+	if (kstrtoul(s, 0, &size) == 0)
+		ion_size = size * SZ_1M;
+	return 0;
+}
+early_param("sunxi_ion_mem_reserve", reserve_ion_param);
+#endif
+
 static void reserve_sys(void)
 {
 	memblock_reserve(SYS_CONFIG_MEMBASE, SYS_CONFIG_MEMSIZE);
 	pr_reserve_info("SYS ", SYS_CONFIG_MEMBASE, SYS_CONFIG_MEMSIZE);
 }
 
-#if defined RESERVE_VE_MEM || defined CONFIG_FB_SUNXI_RESERVED_MEM || \
-	IS_ENABLED(CONFIG_SUNXI_G2D)
+#if defined RESERVE_VE_MEM || defined RESERVE_ION_MEM || \
+	defined CONFIG_FB_SUNXI_RESERVED_MEM || IS_ENABLED(CONFIG_SUNXI_G2D)
 static void reserve_mem(unsigned long *start, unsigned long *size,
 			const char *desc)
 {
@@ -226,6 +255,10 @@ static void __init sw_core_reserve(void)
 #if !defined(CONFIG_CMA) && defined(RESERVE_VE_MEM)
 	reserve_mem(&ve_start, &ve_size, "VE  ");
 #endif
+#ifdef RESERVE_ION_MEM
+	/* right after VE, so it is inside the VE window too */
+	reserve_mem(&ion_start, &ion_size, "ION ");
+#endif
 #if IS_ENABLED(CONFIG_SUNXI_G2D)
 	reserve_mem(&g2d_start, &g2d_size, "G2D ");
 #endif
@@ -356,6 +389,147 @@ static void __init gic_init_irq(void)
  * Global vars definitions
  *
  */
+/*
+ * All the io controller irqs start out on cpu0. Drivers with a heavy
+ * irq load place theirs in a slot, see SUNXI_IRQ_SLOT_*, and the slot
+ * picks the cpu. The same cpu is given as hint, so irqbalance keeps the
+ * split. "sunxi_no_irq_spread" on the command line leaves them alone.
+ *
+ * Taking a cpu down moves its irqs to cpu0 for good, so the spread
+ * irqs are remembered and go back once their cpu is online again. An
+ * irq whose cpu is offline when it is spread waits on cpu0 the same way.
+ */
+#define SUNXI_IRQ_SPREAD_MAX	16
+
+static struct sunxi_irq_spread_slot {
+	unsigned int irq;
+	unsigned int cpu;
+	bool parked;		/* on cpu0 until cpu is back */
+	bool used;
+} sunxi_irq_spread_tbl[SUNXI_IRQ_SPREAD_MAX];
+static DEFINE_MUTEX(sunxi_irq_spread_lock);
+
+static bool sunxi_irq_spread_on = true;
+
+static int __init no_irq_spread_param(char *s)
+{
+	sunxi_irq_spread_on = false;
+	return 0;
+}
+early_param("sunxi_no_irq_spread", no_irq_spread_param);
+
+static void sunxi_irq_spread_apply(struct sunxi_irq_spread_slot *slot)
+{
+	slot->parked = !cpu_online(slot->cpu);
+	if (slot->parked)
+		return;
+
+	if (irq_set_affinity(slot->irq, cpumask_of(slot->cpu)))
+		pr_debug("irq %u: affinity not set\n", slot->irq);
+}
+
+void sunxi_irq_spread(unsigned int irq, unsigned int slot)
+{
+	struct sunxi_irq_spread_slot *s = NULL;
+	unsigned int cpu;
+	int i;
+
+	if (!sunxi_irq_spread_on || num_possible_cpus() < 2)
+		return;
+
+	cpu = slot % num_possible_cpus();
+	irq_set_affinity_hint(irq, cpumask_of(cpu));
+
+	mutex_lock(&sunxi_irq_spread_lock);
+	for (i = 0; i < SUNXI_IRQ_SPREAD_MAX; i++) {
+		if (sunxi_irq_spread_tbl[i].used &&
+		    sunxi_irq_spread_tbl[i].irq == irq) {
+			s = &sunxi_irq_spread_tbl[i];
+			break;
+		}
+		if (!s && !sunxi_irq_spread_tbl[i].used)
+			s = &sunxi_irq_spread_tbl[i];
+	}
+	if (s) {
+		s->irq = irq;
+		s->cpu = cpu;
+		s->used = true;
+		sunxi_irq_spread_apply(s);
+	} else if (cpu_online(cpu)) {
+		/* not followed across hotplug */
+		irq_set_affinity(irq, cpumask_of(cpu));
+	}
+	mutex_unlock(&sunxi_irq_spread_lock);
+}
+EXPORT_SYMBOL(sunxi_irq_spread);
+
+/* before free_irq(), which doesn't want a hint left behind */
+void sunxi_irq_unspread(unsigned int irq)
+{
+	int i;
+
+	irq_set_affinity_hint(irq, NULL);
+
+	mutex_lock(&sunxi_irq_spread_lock);
+	for (i = 0; i < SUNXI_IRQ_SPREAD_MAX; i++)
+		if (sunxi_irq_spread_tbl[i].used &&
+		    sunxi_irq_spread_tbl[i].irq == irq)
+			sunxi_irq_spread_tbl[i].used = false;
+	mutex_unlock(&sunxi_irq_spread_lock);
+}
+EXPORT_SYMBOL(sunxi_irq_unspread);
+
+#ifdef CONFIG_HOTPLUG_CPU
+static int __cpuinit sunxi_irq_spread_cpu_notify(struct notifier_block *nb,
+						 unsigned long action,
+						 void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+	struct sunxi_irq_spread_slot *s;
+	struct irq_data *d;
+	int i;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DOWN_PREPARE:
+		mutex_lock(&sunxi_irq_spread_lock);
+		for (i = 0; i < SUNXI_IRQ_SPREAD_MAX; i++) {
+			s = &sunxi_irq_spread_tbl[i];
+			if (!s->used || s->cpu != cpu)
+				continue;
+			/* left alone if the user moved it elsewhere */
+			d = irq_get_irq_data(s->irq);
+			if (d && cpumask_test_cpu(cpu, d->affinity))
+				s->parked = true;
+		}
+		mutex_unlock(&sunxi_irq_spread_lock);
+		break;
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		mutex_lock(&sunxi_irq_spread_lock);
+		for (i = 0; i < SUNXI_IRQ_SPREAD_MAX; i++) {
+			s = &sunxi_irq_spread_tbl[i];
+			if (s->used && s->parked && s->cpu == cpu)
+				sunxi_irq_spread_apply(s);
+		}
+		mutex_unlock(&sunxi_irq_spread_lock);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __cpuinitdata sunxi_irq_spread_cpu_nb = {
+	.notifier_call = sunxi_irq_spread_cpu_notify,
+};
+
+static int __init sunxi_irq_spread_init(void)
+{
+	register_hotcpu_notifier(&sunxi_irq_spread_cpu_nb);
+	return 0;
+}
+core_initcall(sunxi_irq_spread_init);
+#endif
+
 static void sun4i_restart(char mode, const char *cmd)
 {
 	/* use watch-dog to reset system */
@@ -113,13 +113,26 @@ struct platform_device sw_pdev_nand =
 	.dev = {}
 };
 
-#ifndef CONFIG_ARCH_SUN7I
+/* perf takes the n-th irq resource for the n-th cpu */
 static struct resource sunxi_pmu_resources[] = {
+#ifdef CONFIG_ARCH_SUN7I
+	{
+		.start	= SW_INT_IRQNO_CPU0_PMU,
+		.end	= SW_INT_IRQNO_CPU0_PMU,
+		.flags	= IORESOURCE_IRQ,
+	},
+	{
+		.start	= SW_INT_IRQNO_CPU1_PMU,
+		.end	= SW_INT_IRQNO_CPU1_PMU,
+		.flags	= IORESOURCE_IRQ,
+	},
+#else
 	{
 		.start	= SW_INT_IRQNO_PLE_PFM,
 		.end	= SW_INT_IRQNO_PLE_PFM,
 		.flags	= IORESOURCE_IRQ,
 	},
+#endif
 };
 
 struct platform_device sunxi_pmu_device = {
@@ -128,7 +141,6 @@ struct platform_device sunxi_pmu_device = {
 	.resource	= sunxi_pmu_resources,
 	.num_resources	= ARRAY_SIZE(sunxi_pmu_resources),
 };
-#endif
 
 #if defined(CONFIG_MALI_DRM) || defined(CONFIG_MALI_DRM_MODULE)
 static struct platform_device sunxi_device_mali_drm = {
@@ -143,9 +155,7 @@ static struct platform_device *sw_pdevs[] __initdata = {
 #endif
 	&sw_pdev_dmac,
 	&sw_pdev_nand,
-#ifndef CONFIG_ARCH_SUN7I
 	&sunxi_pmu_device,
-#endif
 #if defined(CONFIG_MALI_DRM) || defined(CONFIG_MALI_DRM_MODULE)
 	&sunxi_device_mali_drm,
 #endif
@@ -28,6 +28,7 @@
 #include <linux/interrupt.h>
 #include <linux/device.h>
 #include <linux/slab.h>
+#include <linux/hardirq.h>
 #include <linux/errno.h>
 #include <linux/io.h>
 #include <asm/memory.h>
@@ -415,6 +416,27 @@ sw_dma_canload(struct sw_dma_chan *chan)
 	return 0;
 }
 
+/* sw_dma_getbuf
+ *
+ * get a buffer from the channel pool, called with irq disabled.
+ * only if the pool is empty, alloc from the kmem cache.
+*/
+
+static inline struct sw_dma_buf *
+sw_dma_getbuf(struct sw_dma_chan *chan)
+{
+	struct sw_dma_buf *buf = chan->buf_free;
+
+	if (buf != NULL) {
+		chan->buf_free = buf->next;
+		return buf;
+	}
+
+	if (chan->stats != NULL)
+		chan->stats->pool_miss++;
+	return kmem_cache_alloc(dma_kmem, GFP_ATOMIC);
+}
+
 /* sw_dma_enqueue
  *
  * queue an given buffer for dma transfer.
@@ -445,10 +467,13 @@ int sw_dma_enqueue(unsigned int channel, void *id,
 	pr_debug("%s: id=%p, data=%08x, size=%d\n",
 		 __func__, id, (unsigned int)data, size);
 
-	buf = kmem_cache_alloc(dma_kmem, GFP_ATOMIC);
+	local_irq_save(flags);
+
+	buf = sw_dma_getbuf(chan);
 	if (buf == NULL) {
 		pr_debug("%s: out of memory (%ld alloc)\n",
 			 __func__, (long)sizeof(*buf));
+		local_irq_restore(flags);
 		return -ENOMEM;
 	}
 
@@ -458,8 +483,6 @@ int sw_dma_enqueue(unsigned int channel, void *id,
 	buf->data  = buf->ptr = data;
 	buf->size  = size;
 
-	local_irq_save(flags);
-
 	if (chan->curr == NULL) {
 		/* we've got nothing loaded... */
 		pr_debug("%s: buffer %p queued onto empty channel\n",
@@ -486,6 +509,10 @@ int sw_dma_enqueue(unsigned int channel, void *id,
 
 	/* check to see if we can load a buffer */
 	if (chan->state == SW_DMA_RUNNING) {
+		/* continuous mode, the hw takes the loaded buffer on restart */
+		if ((chan->dcon & SW_NDMA_CONF_CONTI) || (chan->dcon & SW_DDMA_CONF_CONTI))
+			chan->chained = 1;
+
 		if (chan->load_state == SW_DMALOAD_1LOADED && 1) {
 			if (sw_dma_waitforload(chan, __LINE__) == 0) {
 				printk(KERN_ERR "dma%d: loadbuffer:"
@@ -514,14 +541,20 @@ int sw_dma_enqueue(unsigned int channel, void *id,
 EXPORT_SYMBOL(sw_dma_enqueue);
 
 static inline void
-sw_dma_freebuf(struct sw_dma_buf *buf)
+sw_dma_freebuf(struct sw_dma_chan *chan, struct sw_dma_buf *buf)
 {
 	int magicok = (buf->magic == BUF_MAGIC);
 
 	buf->magic = -1;
 
 	if (magicok) {
-		kmem_cache_free(dma_kmem, buf);
+		if (chan->buf_pool != NULL && buf >= chan->buf_pool &&
+		    buf < chan->buf_pool + SW_DMA_BUF_POOL) {
+			buf->next = chan->buf_free;
+			chan->buf_free = buf;
+		} else {
+			kmem_cache_free(dma_kmem, buf);
+		}
 	} else {
 		printk("sw_dma_freebuf: buff %p with bad magic\n", buf);
 	}
@@ -602,6 +635,12 @@ void exec_pending_chan(int chan_nr, unsigned long pend_bits)
 		 * want to reload here, and then worry about the buffer
 		 * callback */
 
+		/* continuous mode with buffers chained, but nothing loaded
+		 * in time: the hw has restarted the old buffer */
+		if (chan->chained && chan->stats != NULL &&
+		    ((chan->dcon & SW_NDMA_CONF_CONTI) || (chan->dcon & SW_DDMA_CONF_CONTI)))
+			chan->stats->underruns++;
+
 		pr_debug("L%d, loadstate SW_DMALOAD_1RUNNING -> SW_DMALOAD_NONE\n", __LINE__);
 		chan->load_state = SW_DMALOAD_NONE;
 		break;
@@ -672,7 +711,7 @@ void exec_pending_chan(int chan_nr, unsigned long pend_bits)
 			sw_dma_buffdone(chan, buf, SW_RES_OK);
 
 		/* free resouces */
-		sw_dma_freebuf(buf);
+		sw_dma_freebuf(chan, buf);
 		/* modify by yemao, 2011-07-28
 		 * check load state after call dma callback, because some relative states may be changed
 		 * in callback operation. if there is another buffer loaded in dma queue, run it and
@@ -794,19 +833,36 @@ int sw_dma_request(unsigned int channel,
 			void *dev)
 {
 	struct sw_dma_chan *chan;
+	struct sw_dma_buf *pool = NULL;
 	unsigned long flags, temp;
+	int i;
 
 	pr_debug("dma%d: sw_request_dma: client=%s, dev=%p\n",
 		 channel, client->name, dev);
 
+	/* alloc the buffer pool out of irq disabled section, kept after free */
+	if (!in_atomic())
+		pool = kcalloc(SW_DMA_BUF_POOL, sizeof(*pool), GFP_KERNEL);
+
 	local_irq_save(flags);
 
 	chan = sw_dma_map_channel(channel);
 	if (chan == NULL) {
 		local_irq_restore(flags);
+		kfree(pool);
 		return -EBUSY;
 	}
 
+	if (chan->buf_pool == NULL && pool != NULL) {
+		chan->buf_pool = pool;
+		chan->buf_free = NULL;
+		for (i = 0; i < SW_DMA_BUF_POOL; i++) {
+			pool[i].next = chan->buf_free;
+			chan->buf_free = &pool[i];
+		}
+		pool = NULL;
+	}
+
 	dbg_showchan(chan);
 
 	chan->client = client;
@@ -819,6 +875,7 @@ int sw_dma_request(unsigned int channel,
 	local_irq_restore(flags);
 
 	chan->dev_id = dev;
+	kfree(pool);
 
 	/* need to setup */
 
@@ -897,6 +954,7 @@ static int sw_dma_dostop(struct sw_dma_chan *chan)
 
 	/* should stop do this, or should we wait for flush? */
 	chan->state      = SW_DMA_IDLE;
+	chan->chained    = 0;
 	pr_debug("L%d, loadstate %d -> SW_DMALOAD_NONE\n", __LINE__, chan->load_state);
 	chan->load_state = SW_DMALOAD_NONE;
 
@@ -956,7 +1014,7 @@ static int sw_dma_flush(struct sw_dma_chan *chan)
 			       __func__, buf, buf->next);
 
 			sw_dma_buffdone(chan, buf, SW_RES_ABORT);
-			sw_dma_freebuf(buf);
+			sw_dma_freebuf(chan, buf);
 		}
 	}
 
@@ -1303,6 +1361,76 @@ int sw_dma_getcurposition(unsigned int channel, dma_addr_t *src, dma_addr_t *dst
 
 EXPORT_SYMBOL(sw_dma_getcurposition);
 
+/* sw_dma_getrunposition
+ *
+ * get the position inside the buffer the channel is transferring now,
+ * from the byte counter instead of the address registers, which already
+ * hold the next buffer in continuous mode. the side that is not memory
+ * reads back the device address.
+*/
+
+int sw_dma_getrunposition(unsigned int channel, dma_addr_t *src, dma_addr_t *dst)
+{
+	struct sw_dma_chan *chan = lookup_dma_channel(channel);
+	struct sw_dma_buf *buf;
+	unsigned long flags;
+	unsigned long left;
+	dma_addr_t pos;
+
+	if (chan == NULL)
+		return -EINVAL;
+
+	local_irq_save(flags);
+
+	buf = chan->curr;
+	if (buf == NULL) {
+		local_irq_restore(flags);
+		return -EAGAIN;
+	}
+
+	left = dma_rdreg(chan, SW_DMA_DCNT);
+
+	/* the buffer is done but its irq hasn't run, the counter may already
+	 * be the one of the next buffer */
+	if ((readl(dma_base + SW_DMA_DIRQPD) & (2 << (chan->number<<1))) ||
+	    left > buf->size)
+		left = 0;
+
+	pos = __virt_to_bus(buf->data) + buf->size - left;
+
+	if (chan->addr_reg == dma_regaddr(chan, SW_DMA_DDST)) {
+		*src = dma_rdreg(chan, SW_DMA_DSRC);
+		*dst = pos;
+	} else {
+		*src = pos;
+		*dst = dma_rdreg(chan, SW_DMA_DDST);
+	}
+
+	local_irq_restore(flags);
+
+	return 0;
+}
+
+EXPORT_SYMBOL(sw_dma_getrunposition);
+
+/* sw_dma_getunderruns
+ *
+ * returns how often the channel restarted an old buffer in continuous mode
+*/
+
+int sw_dma_getunderruns(unsigned int channel, unsigned long *cnt)
+{
+	struct sw_dma_chan *chan = lookup_dma_channel(channel);
+
+	if (chan == NULL || chan->stats == NULL)
+		return -EINVAL;
+
+	*cnt = chan->stats->underruns;
+	return 0;
+}
+
+EXPORT_SYMBOL(sw_dma_getunderruns);
+
 /* kmem cache implementation */
 
 static void sw_dma_cache_ctor(void *p)
@@ -309,6 +309,9 @@ struct sw_dma_buf {
 
 struct sw_dma_chan;
 
+/* buffers preallocated for each channel, enqueue falls back to kmem cache beyond */
+#define SW_DMA_BUF_POOL		(64)
+
 /* sw_dma_cbfn_t
  *
  * buffer callback routine type
@@ -327,6 +330,8 @@ struct sw_dma_stats {
 	unsigned long		timeout_shortest;
 	unsigned long		timeout_avg;
 	unsigned long		timeout_failed;
+	unsigned long		underruns;	/* continuous mode, hw restarted an old buffer */
+	unsigned long		pool_miss;	/* buffer pool empty, fell back to kmem cache */
 };
 
 struct sw_dma_map;
@@ -342,6 +347,7 @@ struct sw_dma_chan {
 	unsigned char		 in_use;      /* channel allocated */
 	unsigned char		 irq_claimed; /* irq claimed for channel */
 	unsigned char		 irq_enabled; /* irq enabled for channel */
+	unsigned char		 chained;     /* buffer enqueued while running in continuous mode */
 
 	/* channel state */
 
@@ -377,6 +383,10 @@ struct sw_dma_chan {
 	struct sw_dma_buf	*next;		/* next buffer to load */
 	struct sw_dma_buf	*end;		/* end of queue */
 
+	/* buffers preallocated at request, so enqueue does not alloc */
+	struct sw_dma_buf	*buf_pool;	/* SW_DMA_BUF_POOL entries */
+	struct sw_dma_buf	*buf_free;	/* free list in buf_pool */
+
 	/* system device */
 	struct device	dev;
 	void * dev_id;
@@ -519,5 +529,8 @@ extern int sw_dma_set_buffdone_fn(unsigned int, sw_dma_cbfn_t rtn);
 extern int sw_dma_set_halfdone_fn(unsigned int, sw_dma_cbfn_t rtn);
 extern int sw_dma_getcurposition(unsigned int channel,
 				   dma_addr_t *src, dma_addr_t *dest);
+extern int sw_dma_getrunposition(unsigned int channel,
+				   dma_addr_t *src, dma_addr_t *dest);
+extern int sw_dma_getunderruns(unsigned int channel, unsigned long *cnt);
 
 #endif /* __ASM_ARCH_DMA_H */
@@ -158,6 +158,40 @@ static inline int sunxi_dma_getcurposition(struct sunxi_dma_params *dma,
 #endif
 }
 
+/*
+ * Where the channel is inside the buffer it transfers now. sun7i only
+ * reports the start minus the bytes left, so the caller passes the
+ * length of its segments to add back.
+ */
+static inline int sunxi_dma_getrunposition(struct sunxi_dma_params *dma,
+	unsigned int len, dma_addr_t *src, dma_addr_t *dest)
+{
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	return sw_dma_getrunposition(dma->channel, src, dest);
+#else
+	int ret = sw_dma_getposition(dma->dma_hdl, src, dest);
+
+	*src += len;
+	*dest += len;
+	return ret;
+#endif
+}
+
+static inline int sunxi_dma_getunderruns(struct sunxi_dma_params *dma,
+	unsigned long *cnt)
+{
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	return sw_dma_getunderruns(dma->channel, cnt);
+#else
+	u32 val = 0;
+
+	if (sw_dma_ctl(dma->dma_hdl, DMA_OP_GET_UNDERRUN_CNT, &val) != 0)
+		return -EIO;
+	*cnt = val;
+	return 0;
+#endif
+}
+
 static inline int sunxi_dma_request(struct sunxi_dma_params *dma,
 	int dedicated)
 {
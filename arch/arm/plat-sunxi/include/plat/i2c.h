@@ -199,6 +199,9 @@ Foscl is clock SCL;standard mode:100KHz or fast mode:400KHz
 #define I2C3_TRANSFER_SPEED     (100000)
 #define I2C4_TRANSFER_SPEED     (100000)
 
+/* fast-mode plus, twi_speed in the script is clamped to it */
+#define I2C_MAX_TRANSFER_SPEED  (1000000)
+
 struct sunxi_i2c_platform_data {
 	int 		 bus_num;
 	unsigned int frequency;
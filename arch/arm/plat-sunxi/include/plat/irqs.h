@@ -191,6 +191,9 @@
 #define SW_INT_IRQNO_GMAC		(85 + SW_INT_START)
 #define SW_INT_IRQNO_TWI3		(88 + SW_INT_START)
 #define SW_INT_IRQNO_TWI4		(89 + SW_INT_START)
+/* performance monitors of the Cortex-A7 cores, each one raises its own */
+#define SW_INT_IRQNO_CPU0_PMU		(120 + SW_INT_START)
+#define SW_INT_IRQNO_CPU1_PMU		(121 + SW_INT_START)
 #ifdef CONFIG_ARCH_SUN7I
 #define SW_INT_END				  (127 + SW_INT_START)
 #else
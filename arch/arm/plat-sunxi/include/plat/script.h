@@ -115,30 +115,19 @@ static inline void *sunxi_property_value(const struct sunxi_property *o)
 /**
  * sunxi_find_section() - search for a section by name
  */
-static inline const struct sunxi_section *sunxi_find_section(const char *name)
-{
-	int i;
-	const struct sunxi_section *section;
-	sunxi_for_each_section(section, i)
-		if (strncmp(name, section->name, sizeof(section->name)) == 0)
-			return section;
-	return NULL;
-}
+const struct sunxi_section *sunxi_find_section(const char *name);
 
 /**
  * sunxi_find_property() - search for a property by name in a section
  */
-static inline const struct sunxi_property *sunxi_find_property(
+const struct sunxi_property *sunxi_find_property(
 		const struct sunxi_section *sp,
-		const char *name)
-{
-	int i;
-	const struct sunxi_property *prop;
-	sunxi_for_each_property(sp, prop, i)
-		if (strncmp(name, prop->name, sizeof(prop->name)) == 0)
-			return prop;
-	return NULL;
-}
+		const char *name);
+
+/**
+ * sunxi_section_gpio_count() - number of gpio properties of a section
+ */
+int sunxi_section_gpio_count(const struct sunxi_section *sp);
 
 /**
  * sunxi_find_property2() - search for a (section, property) by name
@@ -123,4 +123,28 @@ extern int gpio_set_one_pin_driver_level(unsigned p_handler, unsigned set_driver
 extern int gpio_read_one_pin_value(unsigned p_handler, const char *gpio_name);
 extern int gpio_write_one_pin_value(unsigned p_handler, unsigned value_to_gpio, const char *gpio_name);
 
+/*
+ * Bank level access, many pins of a port with one register access.
+ * port is numbered as in the script, 1 for PA. The set/clear/write
+ * calls are atomic against each other and gpio_write_one_pin_value(),
+ * they only touch the pins in mask; the pins have to be outputs
+ * already, see sunxi_pio_set_mode().
+ */
+extern u32 sunxi_pio_read(unsigned port);
+extern int sunxi_pio_write(unsigned port, u32 mask, u32 val);
+extern int sunxi_pio_set_mode(unsigned port, u32 mask, unsigned mode);
+
+static inline int sunxi_pio_set(unsigned port, u32 mask)
+{
+	return sunxi_pio_write(port, mask, mask);
+}
+
+static inline int sunxi_pio_clear(unsigned port, u32 mask)
+{
+	return sunxi_pio_write(port, mask, 0);
+}
+
+/* port and pin of a gpiolib number of the gpio-sunxi chip */
+extern int sunxi_gpio_to_pio(unsigned gpio, unsigned *port, unsigned *pin);
+
 #endif
@@ -176,4 +176,17 @@ struct sw_chip_id
 
 int sw_get_chip_id(struct sw_chip_id *);
 
+/*
+ * cpu slots of the io irqs, slot modulo the cpus present gives the cpu:
+ * usbc1 and emac on cpu1, usbc2 and sata on cpu0, sdc0 on cpu1...
+ * EHCI and OHCI of a port share the slot of their usbc.
+ */
+#define SUNXI_IRQ_SLOT_USB(usbc_no)	(usbc_no)
+#define SUNXI_IRQ_SLOT_EMAC		1
+#define SUNXI_IRQ_SLOT_SATA		0
+#define SUNXI_IRQ_SLOT_MMC(id)		((id) + 1)
+
+void sunxi_irq_spread(unsigned int irq, unsigned int slot);
+void sunxi_irq_unspread(unsigned int irq);
+
 #endif
@@ -29,15 +29,173 @@
 const struct sunxi_script *sunxi_script_base = NULL;
 EXPORT_SYMBOL(sunxi_script_base);
 
-void sunxi_script_init(const struct sunxi_script *base)
+/*
+ * Hash index of the script, built by sunxi_script_init(). That runs
+ * from the reserve callback, before any allocator, so the tables are
+ * static and sized for the whole SYS_CONFIG_MEMSIZE of script. Both hold
+ * word offsets into the script, 0 is an empty slot; that fits u16 since
+ * the script is at most 64K and offset 0 is the header. Probing is
+ * linear. A script that doesn't fit keeps the plain linear search.
+ */
+#define SCRIPT_SECTIONS_MAX	1024
+#define SCRIPT_SECTION_SLOTS	2048
+#define SCRIPT_PROPERTY_SLOTS	4096
+
+static u16 script_section_slot[SCRIPT_SECTION_SLOTS];
+static u16 script_property_slot[SCRIPT_PROPERTY_SLOTS];
+static u16 script_gpio_count[SCRIPT_SECTIONS_MAX];
+static bool script_indexed;
+
+#define SCRIPT_WORDS(p)	((u16)(((const u32 *)(p)) - (const u32 *)sunxi_script_base))
+#define SCRIPT_AT(off)	((const void *)((const u32 *)sunxi_script_base + (off)))
+
+/* FNV-1a over the name, which needs no NUL within its 32 bytes */
+static u32 script_hash(const char *name, size_t len)
+{
+	u32 h = 2166136261u;
+
+	while (len-- && *name)
+		h = (h ^ (u8)*name++) * 16777619u;
+	return h;
+}
+
+static u32 script_property_hash(unsigned int sec, const char *name)
+{
+	return script_hash(name, 32) ^ (sec * 0x9e3779b1u);
+}
+
+static bool __init script_build_index(void)
+{
+	const struct sunxi_section *sp;
+	const struct sunxi_property *pp;
+	unsigned int nprops = 0, sec, i;
+	int j, k;
+
+	/* gpio_init() hands the same script in again */
+	memset(script_section_slot, 0, sizeof(script_section_slot));
+	memset(script_property_slot, 0, sizeof(script_property_slot));
+	memset(script_gpio_count, 0, sizeof(script_gpio_count));
+
+	if (sunxi_script_base->count > SCRIPT_SECTIONS_MAX)
+		return false;
+
+	sunxi_for_each_section(sp, j)
+		nprops += sp->count;
+	/* keep the tables at most 3/4 full */
+	if (sunxi_script_base->count > SCRIPT_SECTION_SLOTS / 4 * 3 ||
+	    nprops > SCRIPT_PROPERTY_SLOTS / 4 * 3)
+		return false;
+
+	sec = 0;
+	sunxi_for_each_section(sp, j) {
+		i = script_hash(sp->name, sizeof(sp->name));
+		while (script_section_slot[i % SCRIPT_SECTION_SLOTS])
+			i++;
+		script_section_slot[i % SCRIPT_SECTION_SLOTS] = SCRIPT_WORDS(sp);
+
+		sunxi_for_each_property(sp, pp, k) {
+			i = script_property_hash(sec, pp->name);
+			while (script_property_slot[i % SCRIPT_PROPERTY_SLOTS])
+				i++;
+			script_property_slot[i % SCRIPT_PROPERTY_SLOTS] =
+				SCRIPT_WORDS(pp);
+			if (sunxi_property_type(pp) == SUNXI_PROP_TYPE_GPIO)
+				script_gpio_count[sec]++;
+		}
+		sec++;
+	}
+
+	return true;
+}
+
+void __init sunxi_script_init(const struct sunxi_script *base)
 {
 	sunxi_script_base = base;
 	pr_debug("base: 0x%p\n", base);
 	pr_debug("version: %u.%u.%u count: %u\n",
 		base->version[0], base->version[1], base->version[2],
 		base->count);
+
+	script_indexed = false;
+	script_indexed = script_build_index();
+	if (!script_indexed)
+		pr_warn("too large to index, using linear lookups\n");
+}
+
+const struct sunxi_section *sunxi_find_section(const char *name)
+{
+	const struct sunxi_section *section;
+	unsigned int i;
+	u16 off;
+	int n;
+
+	if (!script_indexed) {
+		sunxi_for_each_section(section, n)
+			if (strncmp(name, section->name,
+				    sizeof(section->name)) == 0)
+				return section;
+		return NULL;
+	}
+
+	i = script_hash(name, sizeof(section->name));
+	while ((off = script_section_slot[i++ % SCRIPT_SECTION_SLOTS])) {
+		section = SCRIPT_AT(off);
+		if (strncmp(name, section->name, sizeof(section->name)) == 0)
+			return section;
+	}
+	return NULL;
+}
+EXPORT_SYMBOL(sunxi_find_section);
+
+const struct sunxi_property *sunxi_find_property(
+		const struct sunxi_section *sp,
+		const char *name)
+{
+	const struct sunxi_property *prop, *first;
+	unsigned int i;
+	u16 off;
+	int n;
+
+	if (!sp)
+		return NULL;
+
+	if (!script_indexed) {
+		sunxi_for_each_property(sp, prop, n)
+			if (strncmp(name, prop->name, sizeof(prop->name)) == 0)
+				return prop;
+		return NULL;
+	}
+
+	first = sp->count ? sunxi_get_first_property(sp) : NULL;
+	i = script_property_hash(sp - sunxi_script_base->section, name);
+	while ((off = script_property_slot[i++ % SCRIPT_PROPERTY_SLOTS])) {
+		prop = SCRIPT_AT(off);
+		/* same name in another section */
+		if (!first || prop < first || prop >= first + sp->count)
+			continue;
+		if (strncmp(name, prop->name, sizeof(prop->name)) == 0)
+			return prop;
+	}
+	return NULL;
+}
+EXPORT_SYMBOL(sunxi_find_property);
+
+int sunxi_section_gpio_count(const struct sunxi_section *sp)
+{
+	const struct sunxi_property *pp;
+	int i, count = 0;
+
+	if (!sp)
+		return 0;
+	if (script_indexed)
+		return script_gpio_count[sp - sunxi_script_base->section];
+
+	sunxi_for_each_property(sp, pp, i)
+		if (sunxi_property_type(pp) == SUNXI_PROP_TYPE_GPIO)
+			count++;
+	return count;
 }
-EXPORT_SYMBOL(sunxi_script_init);
+EXPORT_SYMBOL(sunxi_section_gpio_count);
 
 const struct sunxi_property *sunxi_find_property_fmt(
 		const struct sunxi_section *sp,
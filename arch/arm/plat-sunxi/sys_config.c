@@ -27,6 +27,7 @@
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/io.h>
+#include <linux/spinlock.h>
 #include <mach/memory.h>
 #include <mach/platform.h>
 #include <plat/script.h>
@@ -128,22 +129,11 @@ int script_parser_mainkey_count(void)
 
 int script_parser_mainkey_get_gpio_count(char *main_name)
 {
-	const struct sunxi_section *sp;
-	const struct sunxi_property *pp;
-	int    i, gpio_count = 0;
-
 	if (main_name == NULL)
 		return SCRIPT_PARSER_KEYNAME_NULL;
 
-	sp = sunxi_find_section(main_name);
-	if (sp) {
-		sunxi_for_each_property(sp, pp, i) {
-			if (SUNXI_PROP_TYPE_GPIO == sunxi_property_type(pp))
-				gpio_count++;
-		}
-	}
-
-	return gpio_count;
+	/* counted once when the script was indexed */
+	return sunxi_section_gpio_count(sunxi_find_section(main_name));
 }
 
 int script_parser_mainkey_get_gpio_cfg(char *main_name, void *gpio_cfg, int gpio_count)
@@ -214,6 +204,11 @@ typedef struct {
 	int data;
 } gpio_status_set_t;
 
+/* the data registers have no set/clear aliases, writers read-modify-write */
+static DEFINE_SPINLOCK(sunxi_pio_lock);
+
+#define SUNXI_PIO_PORTS		(PIN_PHY_GROUP_I + 1)
+
 typedef struct {
 	char    gpio_name[32];
 	int port;
@@ -1216,11 +1211,15 @@ __s32  gpio_write_one_pin_value(u32 p_handler, __u32 value_to_gpio,
 	reg_val  = PIO_REG_CFG_VALUE(port, port_num_func);
 	func_val = (reg_val >> ((port_num - (port_num_func<<3))<<2)) & 0x07;
 	if (func_val == 1) {
+		unsigned long flags;
+
 		tmp_group_data_addr = PIO_REG_DATA(port);
+		spin_lock_irqsave(&sunxi_pio_lock, flags);
 		reg_val = *tmp_group_data_addr;
 		reg_val &= ~(1 << port_num);
 		reg_val |=  (value_to_gpio << port_num);
 		*tmp_group_data_addr = reg_val;
+		spin_unlock_irqrestore(&sunxi_pio_lock, flags);
 
 		return EGPIO_SUCCESS;
 	}
@@ -1228,3 +1227,78 @@ __s32  gpio_write_one_pin_value(u32 p_handler, __u32 value_to_gpio,
 	return EGPIO_FAIL;
 }
 EXPORT_SYMBOL(gpio_write_one_pin_value);
+
+/*
+ * sunxi_pio_read
+ * Description:
+ *	data register of a port, one bit per pin
+ */
+u32 sunxi_pio_read(unsigned port)
+{
+	if (WARN_ON_ONCE(port < 1 || port > SUNXI_PIO_PORTS))
+		return 0;
+
+	return readl((void __iomem *)PIO_REG_DATA(port));
+}
+EXPORT_SYMBOL(sunxi_pio_read);
+
+/*
+ * sunxi_pio_write
+ * Description:
+ *	drive the pins of mask to their bits in val, with one write
+ */
+int sunxi_pio_write(unsigned port, u32 mask, u32 val)
+{
+	void __iomem *reg;
+	unsigned long flags;
+	u32 reg_val;
+
+	if (port < 1 || port > SUNXI_PIO_PORTS)
+		return -EINVAL;
+
+	reg = (void __iomem *)PIO_REG_DATA(port);
+	spin_lock_irqsave(&sunxi_pio_lock, flags);
+	reg_val = readl(reg);
+	writel((reg_val & ~mask) | (val & mask), reg);
+	spin_unlock_irqrestore(&sunxi_pio_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(sunxi_pio_write);
+
+/*
+ * sunxi_pio_set_mode
+ * Description:
+ *	switch the pins of mask to a function, 0 input and 1 output;
+ *	one write per config register of eight pins
+ */
+int sunxi_pio_set_mode(unsigned port, u32 mask, unsigned mode)
+{
+	unsigned long flags;
+	u32 reg_val, clr, set;
+	int i, pin;
+
+	if (port < 1 || port > SUNXI_PIO_PORTS || mode > 7)
+		return -EINVAL;
+
+	spin_lock_irqsave(&sunxi_pio_lock, flags);
+	for (i = 0; i < 4; i++) {
+		clr = 0;
+		set = 0;
+		for (pin = 0; pin < 8; pin++) {
+			if (!(mask & (1U << (i * 8 + pin))))
+				continue;
+			clr |= 0x07 << (pin << 2);
+			set |= mode << (pin << 2);
+		}
+		if (!clr)
+			continue;
+		reg_val = readl((void __iomem *)PIO_REG_CFG(port, i));
+		writel((reg_val & ~clr) | set,
+		       (void __iomem *)PIO_REG_CFG(port, i));
+	}
+	spin_unlock_irqrestore(&sunxi_pio_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(sunxi_pio_set_mode);
@@ -83,6 +83,8 @@ enum {
 	HOST_IRQ_STAT		= 0x08, /* interrupt status */
 	HOST_PORTS_IMPL		= 0x0c, /* bitmap of implemented ports */
 	HOST_VERSION		= 0x10, /* AHCI spec. version compliancy */
+	HOST_CCC_CTL		= 0x14, /* Command Completion Coalescing Control */
+	HOST_CCC_PORTS		= 0x18, /* Command Completion Coalescing Ports */
 	HOST_EM_LOC		= 0x1c, /* Enclosure Management location */
 	HOST_EM_CTL		= 0x20, /* Enclosure Management Control */
 	HOST_CAP2		= 0x24, /* host capabilities, extended */
@@ -92,6 +94,15 @@ enum {
 	HOST_IRQ_EN		= (1 << 1),  /* global IRQ enable */
 	HOST_AHCI_EN		= (1 << 31), /* AHCI enabled */
 
+	/* HOST_CCC_CTL bits */
+	HOST_CCC_EN		= (1 << 0),  /* coalescing enable */
+	HOST_CCC_INT_SHIFT	= 3,	     /* HOST_IRQ_STAT bit used, RO */
+	HOST_CCC_INT_MASK	= (0x1f << 3),
+	HOST_CCC_CC_SHIFT	= 8,	     /* completions per interrupt */
+	HOST_CCC_CC_MASK	= (0xff << 8),
+	HOST_CCC_TV_SHIFT	= 16,	     /* timeout in ms */
+	HOST_CCC_TV_MASK	= (0xffff << 16),
+
 	/* HOST_CAP bits */
 	HOST_CAP_SXS		= (1 << 5),  /* Supports External SATA */
 	HOST_CAP_EMS		= (1 << 6),  /* Enclosure Management support */
@@ -302,6 +313,8 @@ struct ahci_host_priv {
 	u32 			em_loc; /* enclosure management location */
 	u32			em_buf_sz;	/* EM buffer size in byte */
 	u32			em_msg_type;	/* EM message type */
+	u32			ccc_irq;	/* HOST_IRQ_STAT bit of CCC */
+	u32			ccc_ports;	/* ports whose completions are coalesced */
 };
 
 extern int ahci_ignore_sss;
@@ -343,6 +356,7 @@ void ahci_set_em_messages(struct ahci_host_priv *hpriv,
 			  struct ata_port_info *pi);
 int ahci_reset_em(struct ata_host *host);
 irqreturn_t ahci_interrupt(int irq, void *dev_instance);
+void ahci_poll_ports(struct ata_host *host, u32 port_mask);
 void ahci_print_info(struct ata_host *host, const char *scc_s);
 
 static inline void __iomem *__ahci_port_base(struct ata_host *host,
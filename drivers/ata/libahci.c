@@ -560,7 +560,15 @@ static int ahci_scr_write(struct ata_link *link, unsigned int sc_reg, u32 val)
 	return -EINVAL;
 }
 
+/*
+ * Vendor specific PxDMACR: [7:0] is the TX/RX transaction size and
+ * [15:8] the TX/RX AHB burst limit, both log2 of dwords. The reset value
+ * of the transaction size is too small for the A20 AHB, so set both
+ * fields before the engine starts.
+ */
 #define SW_AHCI_PORT_DMA		0x70
+#define SW_AHCI_PORT_DMA_MASK		0xffff
+#define SW_AHCI_PORT_DMA_VAL		0x4433
 void ahci_start_engine(struct ata_port *ap)
 {
 	void __iomem *port_mmio = ahci_port_base(ap);
@@ -568,8 +576,8 @@ void ahci_start_engine(struct ata_port *ap)
 
 	/*Setup DMA before Start DMA, by danielwang*/
 	tmp = readl(port_mmio + SW_AHCI_PORT_DMA);
-	tmp &= ~0xff00;
-	tmp |= 0x4400;
+	tmp &= ~SW_AHCI_PORT_DMA_MASK;
+	tmp |= SW_AHCI_PORT_DMA_VAL;
 	writel(tmp, port_mmio + SW_AHCI_PORT_DMA);
 
 	/* start DMA */
@@ -1750,27 +1758,10 @@ static void ahci_port_intr(struct ata_port *ap)
 	}
 }
 
-irqreturn_t ahci_interrupt(int irq, void *dev_instance)
+/* called with host->lock held */
+static unsigned int ahci_handle_port_intr(struct ata_host *host, u32 irq_masked)
 {
-	struct ata_host *host = dev_instance;
-	struct ahci_host_priv *hpriv;
 	unsigned int i, handled = 0;
-	void __iomem *mmio;
-	u32 irq_stat, irq_masked;
-
-	VPRINTK("ENTER\n");
-
-	hpriv = host->private_data;
-	mmio = hpriv->mmio;
-
-	/* sigh.  0xffffffff is a valid return from h/w */
-	irq_stat = readl(mmio + HOST_IRQ_STAT);
-	if (!irq_stat)
-		return IRQ_NONE;
-
-	irq_masked = irq_stat & hpriv->port_map;
-
-	spin_lock(&host->lock);
 
 	for (i = 0; i < host->n_ports; i++) {
 		struct ata_port *ap;
@@ -1792,6 +1783,53 @@ irqreturn_t ahci_interrupt(int irq, void *dev_instance)
 		handled = 1;
 	}
 
+	return handled;
+}
+
+/*
+ * Process the pending events of @port_mask without an interrupt, for
+ * completions the HBA may have held back while coalescing was changed.
+ */
+void ahci_poll_ports(struct ata_host *host, u32 port_mask)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	ahci_handle_port_intr(host, port_mask);
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+EXPORT_SYMBOL_GPL(ahci_poll_ports);
+
+irqreturn_t ahci_interrupt(int irq, void *dev_instance)
+{
+	struct ata_host *host = dev_instance;
+	struct ahci_host_priv *hpriv;
+	unsigned int handled;
+	void __iomem *mmio;
+	u32 irq_stat, irq_masked;
+
+	VPRINTK("ENTER\n");
+
+	hpriv = host->private_data;
+	mmio = hpriv->mmio;
+
+	/* sigh.  0xffffffff is a valid return from h/w */
+	irq_stat = readl(mmio + HOST_IRQ_STAT);
+	if (!irq_stat)
+		return IRQ_NONE;
+
+	irq_masked = irq_stat & hpriv->port_map;
+
+	/* a coalesced completion interrupt stands for all coalesced ports */
+	if (irq_stat & hpriv->ccc_irq)
+		irq_masked |= hpriv->ccc_ports;
+
+	spin_lock(&host->lock);
+
+	handled = ahci_handle_port_intr(host, irq_masked);
+	if (irq_stat & hpriv->ccc_irq)
+		handled = 1;
+
 	/* HOST_IRQ_STAT behaves as level triggered latch meaning that
 	 * it should be cleared after all the port events are cleared;
 	 * otherwise, it will raise a spurious interrupt after each
@@ -36,10 +36,12 @@
 #include <linux/platform_device.h>
 #include <linux/libata.h>
 #include <linux/ahci_platform.h>
+#include <linux/ktime.h>
 #include "ahci.h"
 
 #include <linux/clk.h>
 #include <plat/sys_config.h>
+#include <plat/system.h>
 #include "sw_ahci_platform.h"
 
 static struct scsi_host_template ahci_platform_sht = {
@@ -51,6 +53,18 @@ static char* sw_ahci_mclk_name = "sata";
 static char* sw_ahci_para_name = "sata_para";
 static char* sw_ahci_used_name = "sata_used";
 static char* sw_ahci_gpio_name = "sata_power_en";
+static char* sw_ahci_pmp_name = "sata_pmp";
+static char* sw_ahci_fbs_name = "sata_fbs";
+static char* sw_ahci_lpm_name = "sata_lpm";
+
+/*
+ * Link power policy the ports start with, from sata_para.sata_lpm:
+ * 0 keeps the link up, 1 lets the HBA drop it to partial and 2 to
+ * slumber when the port goes idle. The HBA wakes the link by itself
+ * when the next command is issued, so the PHY is not touched again.
+ * It can still be changed per port through link_power_management_policy.
+ */
+static enum ata_lpm_policy sw_ahci_lpm_policy = ATA_LPM_MAX_POWER;
 
 static struct resource sw_ahci_resources[] = {
 	[0] = {
@@ -241,13 +255,227 @@ err2:
 	return;// rc;
 }
 
+/*
+ * Command completion coalescing: with ccc_count set, the HBA raises one
+ * interrupt per ccc_count completions or ccc_timeout ms, whichever comes
+ * first. Both are tunable in sysfs, and port_stats shows per port how
+ * many completions each interrupt carried and how long they waited.
+ */
+static unsigned int sw_ahci_ccc_count;
+static unsigned int sw_ahci_ccc_timeout = 1;
+
+struct sw_ahci_port_stats {
+	u64		issue_ns[ATA_MAX_QUEUE];
+	unsigned int	qc_active;
+	unsigned long	irqs;
+	unsigned long	completions;
+	u64		lat_total_us;
+	u32		lat_max_us;
+};
+
+static struct sw_ahci_port_stats *sw_ahci_stats;
+
+static int sw_ahci_set_ccc(struct ata_host *host)
+{
+	struct ahci_host_priv *hpriv = host->private_data;
+	void __iomem *mmio = hpriv->mmio;
+	unsigned long flags;
+	u32 ctl, ports;
+
+	if (!(hpriv->cap & HOST_CAP_CCC))
+		return -EOPNOTSUPP;
+
+	spin_lock_irqsave(&host->lock, flags);
+	ports = hpriv->ccc_ports;
+
+	/* CC and TV may only be changed while coalescing is disabled */
+	ctl = readl(mmio + HOST_CCC_CTL) & ~HOST_CCC_EN;
+	writel(ctl, mmio + HOST_CCC_CTL);
+	hpriv->ccc_irq = 0;
+	hpriv->ccc_ports = 0;
+
+	if (sw_ahci_ccc_count) {
+		writel(hpriv->port_map, mmio + HOST_CCC_PORTS);
+		ctl &= ~(HOST_CCC_TV_MASK | HOST_CCC_CC_MASK);
+		ctl |= (sw_ahci_ccc_timeout << HOST_CCC_TV_SHIFT) |
+		       (sw_ahci_ccc_count << HOST_CCC_CC_SHIFT) | HOST_CCC_EN;
+		writel(ctl, mmio + HOST_CCC_CTL);
+
+		ctl = readl(mmio + HOST_CCC_CTL);
+		hpriv->ccc_irq = 1 << ((ctl & HOST_CCC_INT_MASK) >> HOST_CCC_INT_SHIFT);
+		hpriv->ccc_ports = hpriv->port_map;
+	}
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	/* pick up completions held back by the old setting */
+	if (ports)
+		ahci_poll_ports(host, ports);
+
+	return 0;
+}
+
+static unsigned int sw_ahci_qc_issue(struct ata_queued_cmd *qc)
+{
+	sw_ahci_stats[qc->ap->port_no].issue_ns[qc->tag] = ktime_to_ns(ktime_get());
+
+	return ahci_ops.qc_issue(qc);
+}
+
+static irqreturn_t sw_ahci_interrupt(int irq, void *dev_instance)
+{
+	struct ata_host *host = dev_instance;
+	struct ahci_host_priv *hpriv = host->private_data;
+	struct sw_ahci_port_stats *st;
+	irqreturn_t ret;
+	u32 irq_stat, done;
+	u64 now, lat;
+	int i, tag;
+
+	irq_stat = readl(hpriv->mmio + HOST_IRQ_STAT);
+	for (i = 0; i < host->n_ports; i++)
+		sw_ahci_stats[i].qc_active = host->ports[i]->qc_active;
+
+	ret = ahci_interrupt(irq, dev_instance);
+	if (ret == IRQ_NONE)
+		return ret;
+
+	now = ktime_to_ns(ktime_get());
+	if (irq_stat & hpriv->ccc_irq)
+		irq_stat |= hpriv->ccc_ports;
+
+	for (i = 0; i < host->n_ports; i++) {
+		st = &sw_ahci_stats[i];
+		if (irq_stat & (1 << i))
+			st->irqs++;
+
+		done = st->qc_active & ~host->ports[i]->qc_active;
+		while (done) {
+			tag = __ffs(done);
+			done &= ~(1 << tag);
+
+			lat = div_u64(now - st->issue_ns[tag], 1000);
+			st->lat_total_us += lat;
+			if (lat > st->lat_max_us)
+				st->lat_max_us = lat;
+			st->completions++;
+		}
+	}
+
+	return ret;
+}
+
+static struct ata_port_operations sw_ahci_ops = {
+	.inherits	= &ahci_ops,
+	.qc_issue	= sw_ahci_qc_issue,
+};
+
+static ssize_t sw_ahci_ccc_show(struct device *dev, char *buf, unsigned int val)
+{
+	return sprintf(buf, "%u\n", val);
+}
+
+static ssize_t sw_ahci_ccc_store(struct device *dev, const char *buf, size_t count,
+				 unsigned int *val, unsigned int min, unsigned int max)
+{
+	unsigned long tmp, old = *val;
+	int rc;
+
+	if (strict_strtoul(buf, 0, &tmp) || tmp < min || tmp > max)
+		return -EINVAL;
+
+	*val = tmp;
+	rc = sw_ahci_set_ccc(dev_get_drvdata(dev));
+	if (rc) {
+		*val = old;
+		return rc;
+	}
+
+	return count;
+}
+
+static ssize_t ccc_count_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	return sw_ahci_ccc_show(dev, buf, sw_ahci_ccc_count);
+}
+
+static ssize_t ccc_count_store(struct device *dev, struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	return sw_ahci_ccc_store(dev, buf, count, &sw_ahci_ccc_count, 0, 255);
+}
+
+static ssize_t ccc_timeout_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	return sw_ahci_ccc_show(dev, buf, sw_ahci_ccc_timeout);
+}
+
+static ssize_t ccc_timeout_store(struct device *dev, struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	return sw_ahci_ccc_store(dev, buf, count, &sw_ahci_ccc_timeout, 1, 65535);
+}
+
+static ssize_t port_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct ata_host *host = dev_get_drvdata(dev);
+	struct sw_ahci_port_stats *st;
+	ssize_t len = 0;
+	u64 avg;
+	int i;
+
+	for (i = 0; i < host->n_ports; i++) {
+		st = &sw_ahci_stats[i];
+		avg = st->completions ? div_u64(st->lat_total_us, st->completions) : 0;
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "port%d: irqs %lu completions %lu avg_lat %llu us max_lat %u us\n",
+				 i, st->irqs, st->completions, avg, st->lat_max_us);
+	}
+
+	return len;
+}
+
+/* any write clears the counters */
+static ssize_t port_stats_store(struct device *dev, struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct ata_host *host = dev_get_drvdata(dev);
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&host->lock, flags);
+	for (i = 0; i < host->n_ports; i++) {
+		sw_ahci_stats[i].irqs = 0;
+		sw_ahci_stats[i].completions = 0;
+		sw_ahci_stats[i].lat_total_us = 0;
+		sw_ahci_stats[i].lat_max_us = 0;
+	}
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR(ccc_count, S_IRUGO | S_IWUSR, ccc_count_show, ccc_count_store);
+static DEVICE_ATTR(ccc_timeout, S_IRUGO | S_IWUSR, ccc_timeout_show, ccc_timeout_store);
+static DEVICE_ATTR(port_stats, S_IRUGO | S_IWUSR, port_stats_show, port_stats_store);
+
+static struct attribute *sw_ahci_attrs[] = {
+	&dev_attr_ccc_count.attr,
+	&dev_attr_ccc_timeout.attr,
+	&dev_attr_port_stats.attr,
+	NULL
+};
+
+static const struct attribute_group sw_ahci_attr_group = {
+	.attrs = sw_ahci_attrs,
+};
+
 static struct ata_port_info sw_ahci_port_info = {
-	.flags = AHCI_FLAG_COMMON,
+	.flags = AHCI_FLAG_COMMON | ATA_FLAG_NO_DIPM,
 	//.link_flags = ,
 	.pio_mask = ATA_PIO4,
 	//.mwdma_mask = ,
 	.udma_mask = ATA_UDMA6,
-	.port_ops = &ahci_ops,
+	.port_ops = &sw_ahci_ops,
 	.private_data = (void*)(AHCI_HFLAG_32BIT_ONLY | AHCI_HFLAG_NO_MSI
 							| AHCI_HFLAG_NO_PMP | AHCI_HFLAG_YES_NCQ),
 };
@@ -364,6 +592,12 @@ static int __init sw_ahci_probe(struct platform_device *pdev)
 
 	host->private_data = hpriv;
 
+	sw_ahci_stats = devm_kzalloc(dev, n_ports * sizeof(*sw_ahci_stats), GFP_KERNEL);
+	if (!sw_ahci_stats) {
+		rc = -ENOMEM;
+		goto err0;
+	}
+
 	if (!(hpriv->cap & HOST_CAP_SSS) || ahci_ignore_sss)
 		host->flags |= ATA_HOST_PARALLEL_SCAN;
 	else
@@ -385,6 +619,8 @@ static int __init sw_ahci_probe(struct platform_device *pdev)
 		/* disabled/not-implemented port */
 		if (!(hpriv->port_map & (1 << i)))
 			ap->ops = &ata_dummy_port_ops;
+
+		ap->target_lpm_policy = sw_ahci_lpm_policy;
 	}
 
 	rc = ahci_reset_controller(host);
@@ -394,11 +630,16 @@ static int __init sw_ahci_probe(struct platform_device *pdev)
 	ahci_init_controller(host);
 	ahci_print_info(host, "platform");
 
-	rc = ata_host_activate(host, irq, ahci_interrupt, IRQF_SHARED,
+	rc = ata_host_activate(host, irq, sw_ahci_interrupt, IRQF_SHARED,
 			       &ahci_platform_sht);
 	if (rc)
 		goto err0;
 
+	sunxi_irq_spread(irq, SUNXI_IRQ_SLOT_SATA);
+
+	if (sysfs_create_group(&dev->kobj, &sw_ahci_attr_group))
+		dev_warn(dev, "failed to create sysfs attributes\n");
+
 	return 0;
 err0:
 	if (pdata && pdata->exit)
@@ -412,6 +653,8 @@ static int __devexit sw_ahci_remove(struct platform_device *pdev)
 	struct ahci_platform_data *pdata = dev->platform_data;
 	struct ata_host *host = dev_get_drvdata(dev);
 
+	sysfs_remove_group(&dev->kobj, &sw_ahci_attr_group);
+	sunxi_irq_unspread(platform_get_irq(pdev, 0));
 	ata_host_detach(host);
 
 	if (pdata && pdata->exit)
@@ -451,6 +694,7 @@ static int sw_ahci_resume(struct device *dev)
 {
 	struct ata_host *host = dev_get_drvdata(dev);
 	struct ahci_host_priv *hpriv = host->private_data;
+	int i;
 
 	printk("sw_ahci_platform: sw_ahci_resume\n"); //danielwang
 
@@ -459,6 +703,24 @@ static int sw_ahci_resume(struct device *dev)
 
 	ahci_hardware_recover_for_controller_resume(host);
 
+	/* the controller reset dropped the coalescing setting too */
+	if (sw_ahci_ccc_count)
+		sw_ahci_set_ccc(host);
+
+	/* the controller reset dropped ALPE/ASP, let EH set the policy again */
+	for (i = 0; i < host->n_ports; i++) {
+		struct ata_port *ap = host->ports[i];
+		unsigned long flags;
+
+		if (ap->target_lpm_policy <= ATA_LPM_MAX_POWER)
+			continue;
+
+		spin_lock_irqsave(ap->lock, flags);
+		ap->link.lpm_policy = ATA_LPM_UNKNOWN;
+		ata_port_schedule_eh(ap);
+		spin_unlock_irqrestore(ap->lock, flags);
+	}
+
 	return 0;
 }
 
@@ -486,7 +748,9 @@ static struct platform_driver sw_ahci_driver = {
 
 static int __init sw_ahci_init(void)
 {
-	int rc, ctrl = 0;
+	int rc, ctrl = 0, pmp = 0, fbs = 0, lpm = 0;
+	unsigned long hflags = (unsigned long)sw_ahci_port_info.private_data;
+
 	script_parser_fetch(sw_ahci_para_name,
 			sw_ahci_used_name, &ctrl, sizeof(int));
 	if (!ctrl) {
@@ -494,6 +758,28 @@ static int __init sw_ahci_init(void)
 		return -ENODEV;
 	}
 
+	/*
+	 * The soft reset of a directly attached disk fails with PMP on, so
+	 * port multipliers are only supported when the board asks for them.
+	 * FBS is used if the port reports FBSCP, sata_fbs forces it on for
+	 * boards whose multiplier is known to work with it.
+	 */
+	script_parser_fetch(sw_ahci_para_name,
+			sw_ahci_pmp_name, &pmp, sizeof(int));
+	script_parser_fetch(sw_ahci_para_name,
+			sw_ahci_fbs_name, &fbs, sizeof(int));
+	if (pmp) {
+		hflags &= ~AHCI_HFLAG_NO_PMP;
+		if (fbs)
+			hflags |= AHCI_HFLAG_YES_FBS;
+	}
+	sw_ahci_port_info.private_data = (void *)hflags;
+
+	script_parser_fetch(sw_ahci_para_name,
+			sw_ahci_lpm_name, &lpm, sizeof(int));
+	if (lpm >= 0 && lpm <= ATA_LPM_MIN_POWER - ATA_LPM_MAX_POWER)
+		sw_ahci_lpm_policy = ATA_LPM_MAX_POWER + lpm;
+
 	rc = platform_device_register(&sw_ahci_device);
 	if (rc)
 		return rc;
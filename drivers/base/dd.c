@@ -23,6 +23,7 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/ktime.h>
 #include <linux/pm_runtime.h>
 
 #include "base.h"
@@ -266,6 +267,8 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
+	int probe_err = 0;
+	ktime_t calltime = ktime_get();
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
@@ -296,6 +299,7 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	goto done;
 
 probe_failed:
+	probe_err = ret;
 	devres_release_all(dev);
 	driver_sysfs_remove(dev);
 	dev->driver = NULL;
@@ -322,6 +326,8 @@ probe_failed:
 	 */
 	ret = 0;
 done:
+	boot_time_record('p', ktime_to_ns(ktime_sub(ktime_get(), calltime)) >> 10,
+			 probe_err, "%s %s", drv->name, dev_name(dev));
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
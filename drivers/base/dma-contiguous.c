@@ -363,6 +363,7 @@ error:
 	mutex_unlock(&cma_mutex);
 	return NULL;
 }
+EXPORT_SYMBOL_GPL(dma_alloc_from_contiguous);
 
 /**
  * dma_release_from_contiguous() - release allocated pages
@@ -399,3 +400,4 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 
 	return true;
 }
+EXPORT_SYMBOL_GPL(dma_release_from_contiguous);
@@ -40,6 +40,10 @@
 #include <linux/dma-mapping.h>
 #include <linux/cpufreq.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
+#include <linux/sort.h>
 #include "../src/include/nand_type.h"
 #include "../src/include/nand_drv_cfg.h"
 #include "../src/include/nand_format.h"
@@ -90,11 +94,20 @@ struct attribute prompt_attr = {
     .mode = S_IRWXUGO
 };
 
+struct attribute bench_attr = {
+    .name = "nand_bench",
+    .mode = S_IRUGO | S_IWUSR
+};
+
 static struct attribute *def_attrs[] = {
     &prompt_attr,
+    &bench_attr,
     NULL
 };
 
+static ssize_t nand_bench_store(const char *buf, size_t count);
+static ssize_t nand_bench_show(char *buf);
+
 
 struct sysfs_ops obj_test_sysops =
 {
@@ -1046,9 +1059,12 @@ static void nand_test_run(struct nand_test_card *test, int testcase)
 }
 
 
-/* do nothing */
+/* report the last benchmark, nothing for the test cases */
 static ssize_t nand_test_show(struct kobject *kobject,struct attribute *attr, char *buf)
 {
+    if (attr == &bench_attr)
+        return nand_bench_show(buf);
+
     return 0;
 }
 
@@ -1060,6 +1076,9 @@ static ssize_t nand_test_store(struct kobject *kobject,struct attribute *attr, c
     struct nand_test_card *test;
     int testcase;
 
+    if (attr == &bench_attr)
+        return nand_bench_store(buf, count);
+
     testcase = simple_strtol(buf, NULL, 10);  // get test case number     >> grace
 
     test = kzalloc(sizeof(struct nand_test_card), GFP_KERNEL);
@@ -1084,6 +1103,230 @@ static ssize_t nand_test_store(struct kobject *kobject,struct attribute *attr, c
     return count;
 }
 
+
+/*
+ * FTL benchmark, it overwrites the data on the disk:
+ *
+ *   echo "<workload> [logic|cache]" > /sys/nand/nand_bench
+ *   cat /sys/nand/nand_bench
+ *
+ * runs bench_ops requests of bench_sectors sectors each. "logic" calls
+ * LML_Read/LML_Write directly, "cache" goes through the NAND write cache
+ * the block driver sits on, which is the block layer path with the nand
+ * block device left out because this driver owns the flash instead.
+ * The final flush is counted in the throughput but not in the latency.
+ */
+enum {
+    BENCH_SEQ_READ,
+    BENCH_SEQ_WRITE,
+    BENCH_RAND_READ,
+    BENCH_RAND_WRITE,
+    BENCH_MIXED,
+    BENCH_SYNC,
+    BENCH_CNT
+};
+
+static const char * const nand_bench_names[BENCH_CNT] = {
+    "seqread", "seqwrite", "randread", "randwrite", "mixed", "sync"
+};
+
+static unsigned int bench_sectors = 8;
+module_param(bench_sectors, uint, 0644);
+MODULE_PARM_DESC(bench_sectors, "Sectors per benchmark request");
+static unsigned int bench_ops = 1024;
+module_param(bench_ops, uint, 0644);
+MODULE_PARM_DESC(bench_ops, "Requests per benchmark run");
+static unsigned int bench_read_pct = 70;
+module_param(bench_read_pct, uint, 0644);
+MODULE_PARM_DESC(bench_read_pct, "Percent of reads in the mixed workload");
+
+#define BENCH_MAX_OPS     (65536)
+
+struct nand_bench_result {
+    int workload;
+    int cache;
+    unsigned int ops;
+    unsigned int sectors;
+    unsigned int errors;
+    u64 total_ns;
+    u32 p50_us;
+    u32 p99_us;
+    u32 max_us;
+    u32 merges;
+    u32 erases;
+};
+
+static struct nand_bench_result bench_result = { .workload = -1 };
+
+static int nand_bench_cmp(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int nand_bench_transfer(int cache, unsigned start, unsigned nsector, u8 *buf, int write)
+{
+    int ret;
+
+    if (write) {
+        ret = cache ? NAND_CacheWrite(start, nsector, buf) : LML_Write(start, nsector, buf);
+    } else {
+        LML_FlushPageCache();
+        ret = cache ? NAND_CacheRead(start, nsector, buf) : LML_Read(start, nsector, buf);
+    }
+
+    return ret ? -EIO : 0;
+}
+
+static int nand_bench_flush(int cache)
+{
+    if (cache)
+        return NAND_CacheFlush() ? -EIO : 0;
+
+    return LML_FlushPageCache() < 0 ? -EIO : 0;
+}
+
+static int nand_bench_run(int workload, int cache)
+{
+    struct nand_bench_result *r = &bench_result;
+    unsigned int i, nsector, slots, start = 0;
+    ktime_t t0, t1, begin;
+    u32 *lat;
+    u8 *buf;
+    int write, ret = 0;
+
+    nsector = clamp_t(unsigned int, bench_sectors, 1, MAX_SECTORS);
+    slots = DiskSize / nsector;
+    if (!slots || !bench_ops)
+        return -EINVAL;
+
+    memset(r, 0, sizeof(*r));
+    r->workload = -1;
+    r->ops = min_t(unsigned int, bench_ops, BENCH_MAX_OPS);
+
+    buf = kmalloc(nsector * 512, GFP_KERNEL);
+    lat = kmalloc(r->ops * sizeof(u32), GFP_KERNEL);
+    if (!buf || !lat) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    memset(buf, 0x5a, nsector * 512);
+
+#ifndef NAND_CACHE_RW
+    if (cache && NAND_CacheOpen()) {
+        ret = -ENOMEM;
+        goto out;
+    }
+#endif
+
+    r->merges = LML_GetMergeCnt();
+    r->erases = LML_GetEraseCnt();
+
+    begin = ktime_get();
+    for (i = 0; i < r->ops; i++) {
+        switch (workload) {
+        case BENCH_SEQ_READ:
+        case BENCH_SEQ_WRITE:
+            start = (i % slots) * nsector;
+            write = (workload == BENCH_SEQ_WRITE);
+            break;
+        case BENCH_MIXED:
+            start = (random32() % slots) * nsector;
+            write = (random32() % 100) >= bench_read_pct;
+            break;
+        default:
+            start = (random32() % slots) * nsector;
+            write = (workload != BENCH_RAND_READ);
+            break;
+        }
+
+        t0 = ktime_get();
+        ret = nand_bench_transfer(cache, start, nsector, buf, write);
+        if (!ret && write && (workload == BENCH_SYNC))
+            ret = nand_bench_flush(cache);
+        t1 = ktime_get();
+
+        if (ret)
+            r->errors++;
+        lat[i] = (u32)ktime_us_delta(t1, t0);
+        cond_resched();
+    }
+    ret = nand_bench_flush(cache);
+    r->total_ns = ktime_to_ns(ktime_sub(ktime_get(), begin));
+
+    r->merges = LML_GetMergeCnt() - r->merges;
+    r->erases = LML_GetEraseCnt() - r->erases;
+
+#ifndef NAND_CACHE_RW
+    if (cache)
+        NAND_CacheClose();
+#endif
+
+    sort(lat, r->ops, sizeof(u32), nand_bench_cmp, NULL);
+    r->p50_us = lat[r->ops / 2];
+    r->p99_us = lat[min(r->ops - 1, r->ops * 99 / 100)];
+    r->max_us = lat[r->ops - 1];
+    r->sectors = nsector;
+    r->cache = cache;
+    r->workload = workload;
+
+out:
+    kfree(lat);
+    kfree(buf);
+    return ret;
+}
+
+static ssize_t nand_bench_show(char *buf)
+{
+    struct nand_bench_result *r = &bench_result;
+    u64 ns, kbps, iops;
+
+    if (r->workload < 0)
+        return sprintf(buf, "no benchmark run, workloads:"
+                       " seqread seqwrite randread randwrite mixed sync\n");
+
+    ns = max_t(u64, r->total_ns, 1);
+    kbps = div64_u64((u64)r->ops * r->sectors * 512 * 1000000000ULL / 1024, ns);
+    iops = div64_u64((u64)r->ops * 1000000000ULL, ns);
+
+    return sprintf(buf,
+                   "workload: %s (%s)\n"
+                   "requests: %u x %u sectors, %u errors\n"
+                   "throughput: %llu.%02llu MB/s, %llu IOPS\n"
+                   "latency: p50 %u us, p99 %u us, max %u us\n"
+                   "merges: %u, erases: %u\n",
+                   nand_bench_names[r->workload], r->cache ? "cache" : "logic",
+                   r->ops, r->sectors, r->errors,
+                   kbps / 1024, (kbps % 1024) * 100 / 1024, iops,
+                   r->p50_us, r->p99_us, r->max_us,
+                   r->merges, r->erases);
+}
+
+static ssize_t nand_bench_store(const char *buf, size_t count)
+{
+    char name[16], layer[8] = "logic";
+    int i, ret;
+
+    if (sscanf(buf, "%15s %7s", name, layer) < 1)
+        return -EINVAL;
+
+    for (i = 0; i < BENCH_CNT; i++) {
+        if (!strcmp(name, nand_bench_names[i]))
+            break;
+    }
+    if (i == BENCH_CNT || (strcmp(layer, "logic") && strcmp(layer, "cache")))
+        return -EINVAL;
+
+    mutex_lock(&nand_test_lock);
+    ret = nand_bench_run(i, !strcmp(layer, "cache"));
+    mutex_unlock(&nand_test_lock);
+
+    printk(KERN_INFO NAND_TEST "benchmark %s (%s) done, ret %d\n", name, layer, ret);
+
+    return ret < 0 ? ret : count;
+}
+
 struct kobject kobj;
 
 
@@ -209,6 +209,7 @@ __s32 NFC_RandomDisable(void);
 __s32 NFC_Init(NFC_INIT_INFO * nand_info);
 void NFC_Exit(void);
 __s32 NFC_Read(NFC_CMD_LIST * rcmd, void * mainbuf, void * sparebuf, __u8 dma_wait_mode, __u8 page_mode);
+__s32 NFC_ReadPlane(NFC_CMD_LIST * rcmd, void * mainbuf, void * sparebuf, __u8 dma_wait_mode);
 __s32 NFC_Read_1K(NFC_CMD_LIST * rcmd, void * mainbuf, void * sparebuf, __u8 dma_wait_mode, __u8 page_mode);
 __s32 NFC_Read_Seq(NFC_CMD_LIST * rcmd, void * mainbuf, void * sparebuf, __u8 dma_wait_mode, __u8 page_mode);
 __s32 NFC_Read_Spare(NFC_CMD_LIST * rcmd, void * mainbuf, void * sparebuf, __u8 dma_wait_mode, __u8 page_mode);
@@ -228,6 +229,7 @@ __s32 NFC_GetStatus(NFC_CMD_LIST * scmd);
 __s32 NFC_CheckRbReady(__u32 rb);
 __s32 NFC_ChangMode(NFC_INIT_INFO * nand_info);
 __s32 NFC_SetEccMode(__u8 ecc_mode);
+__u32 NFC_GetEccBitCnt(__u32 *bit_limit);
 __s32 NFC_ResetChip(NFC_CMD_LIST * reset_cmd);
 __u32 NFC_QueryINT(void);
 void NFC_EnableInt(__u8 minor_int);
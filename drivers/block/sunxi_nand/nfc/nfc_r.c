@@ -45,6 +45,10 @@ __u8 lsb_mode_reg_num;
 
 __u32 ddr_param[8];
 
+/* worst corrected bit count of one ecc block since NFC_GetEccBitCnt() */
+static __u32 ecc_bit_cnt;
+static __u32 ecc_bit_limit = 16;
+
 const	__s16 param0x30low[16][2] ={{0xF0,0XF0},
 									{0xE0,0XE0},
 									{0xD0,0XD0},
@@ -221,6 +225,13 @@ __s32 _check_ecc(__u32 eblock_cnt)
 	ecc_cnt[14] = (__u8)((cfg>>16)&0xff);
 	ecc_cnt[15] = (__u8)((cfg>>24)&0xff);
 
+	ecc_bit_limit = max_ecc_bit_cnt;
+	for (i = 0; i < eblock_cnt; i++)
+	{
+		if (ecc_cnt[i] > ecc_bit_cnt)
+			ecc_bit_cnt = ecc_cnt[i];
+	}
+
 	for (i = 0; i < eblock_cnt; i++)
 	{
 		if((max_ecc_bit_cnt - 4) <= ecc_cnt[i])
@@ -230,6 +241,26 @@ __s32 _check_ecc(__u32 eblock_cnt)
 	return 0;
 }
 
+/*******************************************************************************
+*								NFC_GetEccBitCnt
+*
+* Description 	: get the worst corrected bit count of one ecc block read since
+*				  the last call, and clear it.
+* Arguments	: *bit_limit	-- returns the bits the current ecc mode can correct, may be NULL.
+* Returns		: the corrected bit count.
+* Notes		: ecc blocks which are not correctable are not counted.
+********************************************************************************/
+__u32 NFC_GetEccBitCnt(__u32 *bit_limit)
+{
+	__u32 cnt = ecc_bit_cnt;
+
+	ecc_bit_cnt = 0;
+	if (bit_limit)
+		*bit_limit = ecc_bit_limit;
+
+	return cnt;
+}
+
 void _disable_ecc(void)
 {
 	__u32 cfg = NFC_READ_REG(NFC_REG_ECC_CTL);
@@ -287,7 +318,12 @@ void _set_addr(__u8 *addr, __u8 cnt)
 	NFC_WRITE_REG(NFC_REG_ADDR_HIGH, addr_high);
 }
 
-__s32 _read_in_page_mode(NFC_CMD_LIST  *rcmd,void *mainbuf,void *sparebuf,__u8 dma_wait_mode)
+/*
+ * load = 0 reads out a page register which an earlier multi-plane read
+ * command has already filled, so neither the read confirm command nor
+ * the wait for R/B is sent.
+ */
+static __s32 _read_page_data(NFC_CMD_LIST  *rcmd,void *mainbuf,void *sparebuf,__u8 dma_wait_mode,__u8 load)
 {
 	__s32 ret;
 	__s32 i;
@@ -352,7 +388,9 @@ __s32 _read_in_page_mode(NFC_CMD_LIST  *rcmd,void *mainbuf,void *sparebuf,__u8 d
 	/*set sequence mode*/
 	//cfg |= 0x1<<25;
 	cfg |= ( (read_addr_cmd->addr_cycle - 1) << 16);
-	cfg |= (NFC_SEND_ADR | NFC_DATA_TRANS | NFC_SEND_CMD1 | NFC_SEND_CMD2 | NFC_WAIT_FLAG | NFC_DATA_SWAP_METHOD);
+	cfg |= (NFC_SEND_ADR | NFC_DATA_TRANS | NFC_SEND_CMD1 | NFC_DATA_SWAP_METHOD);
+	if (load)
+		cfg |= (NFC_SEND_CMD2 | NFC_WAIT_FLAG);
 	cfg |= ((__u32)0x2 << 30);//page command
 
 	if (pagesize/1024 == 1)
@@ -384,6 +422,11 @@ __s32 _read_in_page_mode(NFC_CMD_LIST  *rcmd,void *mainbuf,void *sparebuf,__u8 d
 	return ret;
 }
 
+__s32 _read_in_page_mode(NFC_CMD_LIST  *rcmd,void *mainbuf,void *sparebuf,__u8 dma_wait_mode)
+{
+	return _read_page_data(rcmd, mainbuf, sparebuf, dma_wait_mode, 1);
+}
+
 /*******************************************************************************
 *								NFC_Read
 *
@@ -419,6 +462,35 @@ __s32 NFC_Read(NFC_CMD_LIST  *rcmd, void *mainbuf, void *sparebuf, __u8 dma_wait
 }
 
 
+/*******************************************************************************
+*								NFC_ReadPlane
+*
+* Description 	: read out one plane page which has been loaded by a multi-plane read command.
+* Arguments	: *rcmd	-- the data output command sequence list head, same layout as NFC_Read.
+*			  *mainbuf	-- point to data buffer address, 	it must be four bytes align.
+*                     *sparebuf	-- point to spare buffer address.
+*                     dma_wait_mode	-- how to deal when dma start, 0 = wait till dma finish,
+							    1 = dma interrupt was set and now sleep till interrupt occurs.
+* Returns		: 0 = success.
+			  1 = success & ecc limit.
+			  -1 = too much ecc err.
+********************************************************************************/
+__s32 NFC_ReadPlane(NFC_CMD_LIST  *rcmd, void *mainbuf, void *sparebuf, __u8 dma_wait_mode)
+{
+	__s32 ret;
+
+	_enter_nand_critical();
+
+	ret = _read_page_data(rcmd, mainbuf, sparebuf, dma_wait_mode, 0);
+
+	/*switch to ahb*/
+	NFC_WRITE_REG(NFC_REG_CTL, (NFC_READ_REG(NFC_REG_CTL)) & (~NFC_RAM_METHOD));
+
+	_exit_nand_critical();
+
+	return ret;
+}
+
 /*finish the comand list */
 __s32 nfc_set_cmd_register(NFC_CMD_LIST *cmd)
 {
@@ -39,6 +39,11 @@
 #include <linux/delay.h>
 #include <linux/clk.h>
 #include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/rcupdate.h>
+#include <linux/async.h>
 
 #include "../src/include/nand_type.h"
 #include "../src/include/nand_drv_cfg.h"
@@ -81,18 +86,13 @@
 #define TIMEOUT 				1			// per second
 
 #define NAND_CACHE_FLUSH_EVERY_SEC
-//#define NAND_BIO_ALIGN
 #define NAND_CACHE_RW
 #define USE_SYS_PIN
 //#define USE_SYS_CLK
 
-/**
-*USE_BIO_MERGE level description:
-*1	:	merge bvc in one bio
-*2	:	merge bvc in one bio and merge bios in one request
-*/
-#define USE_BIO_MERGE			2
-#define NAND_TEST_TICK			0
+/* scatterlist entries per request, and the bounce buffer for misaligned ones */
+#define NAND_MAX_SEGS			128
+#define NAND_BOUNCE_SIZE		PAGE_SIZE
 
 #ifdef NAND_CACHE_FLUSH_EVERY_SEC
 static int after_write = 0;
@@ -105,6 +105,39 @@ struct collect_ops{
 };
 struct collect_ops collect_arg;
 
+/*
+ * Once writes go idle the collect thread merges log blocks ahead of
+ * time: it starts when the current zone has fewer than gc_low empty log
+ * items and keeps going, one merge per hold of the ops mutex, until
+ * gc_high are empty or a new write arrives.
+ */
+static unsigned int gc_low = 2;
+module_param(gc_low, uint, 0644);
+MODULE_PARM_DESC(gc_low, "Start background merges below this many empty log blocks (0 disables)");
+static unsigned int gc_high = 4;
+module_param(gc_high, uint, 0644);
+MODULE_PARM_DESC(gc_high, "Stop background merges at this many empty log blocks");
+static unsigned int gc_merges;
+module_param(gc_merges, uint, 0444);
+MODULE_PARM_DESC(gc_merges, "Log block merges done by the background collector");
+static unsigned int gc_errors;
+module_param(gc_errors, uint, 0444);
+MODULE_PARM_DESC(gc_errors, "Failed background merges");
+
+/*
+ * Blocks the logic layer queued for read-reclaim are rewritten by the
+ * collect thread too, rr_pages pages per hold of the ops mutex and at
+ * most one step per rr_interval ms, and only while no write is pending.
+ */
+static unsigned int rr_pages = 4;
+module_param(rr_pages, uint, 0644);
+MODULE_PARM_DESC(rr_pages, "Pages rewritten per background read-reclaim step (0 disables)");
+static unsigned int rr_interval = 20;
+module_param(rr_interval, uint, 0644);
+MODULE_PARM_DESC(rr_interval, "Minimum ms between background read-reclaim steps");
+
+static void nand_background_gc(void);
+static void nand_background_reclaim(void);
 #endif
 
 
@@ -116,6 +149,17 @@ static struct clk *ahb_nand_clk = NULL;
 static struct clk *mod_nand_clk = NULL;
 #endif
 static int nand_flush(struct nand_blk_dev *dev);
+static void nand_flush_pages(unsigned int keep);
+
+/* the background flusher starts trimming at three quarters dirty */
+static inline int nand_cache_high(void)
+{
+#ifdef NAND_CACHE_RW
+	return NAND_CacheDirtyCount() > NAND_CacheSize() * 3 / 4;
+#else
+	return 0;
+#endif
+}
 
 spinlock_t     nand_rb_lock;
 
@@ -133,32 +177,13 @@ static irqreturn_t nand_rb_interrupt(int irq, void *dev_id)
 
 
 
-#if USE_BIO_MERGE==0
-static int cache_align_page_request(struct nand_blk_ops * nandr, struct nand_blk_dev * dev, struct request * req)
+static int nand_transfer(struct nand_blk_dev * dev, unsigned long start,unsigned long nsector, char *buf, int cmd)
 {
-	unsigned long start,nsector;
-	char *buf;
 	__s32 ret;
 
-	int cmd = rq_data_dir(req);
-
 	if(dev->disable_access || ( (cmd == WRITE) && (dev->readonly) ) \
 		|| ((cmd == READ) && (dev->writeonly))){
 		dbg_err("can not access this part\n");
-
-		return -EIO;
-	}
-
-
-	//for2.6.36
-	buf = req->buffer;
-	start = blk_rq_pos(req);
-	nsector = blk_rq_cur_bytes(req)>>9;
-
-	if ( (start + nsector) > get_capacity(req->rq_disk))
-	{
-		dbg_err("over the limit of disk\n");
-
 		return -EIO;
 	}
 	start += dev->off_size;
@@ -166,21 +191,18 @@ static int cache_align_page_request(struct nand_blk_ops * nandr, struct nand_blk
 	switch(cmd) {
 
 	case READ:
-
 		dbg_inf("READ:%lu from %lu\n",nsector,start);
 
 		#ifndef NAND_CACHE_RW
 			LML_FlushPageCache();
-  		ret = LML_Read(start, nsector, buf);
+  			ret = LML_Read(start, nsector, buf);
 		#else
-			//printk("Rs %lu %lu \n",start, nsector);
-      LML_FlushPageCache();
+      		LML_FlushPageCache();
 			ret = NAND_CacheRead(start, nsector, buf);
-			//printk("Rs %lu %lu \n",start, nsector);
 		#endif
 		if (ret)
 		{
-			dbg_err("cache_align_page_request:read err\n");
+			dbg_err("nand_transfer:read err\n");
 			return -EIO;
 
 		}
@@ -188,18 +210,15 @@ static int cache_align_page_request(struct nand_blk_ops * nandr, struct nand_blk
 
 
 	case WRITE:
-
 		dbg_inf("WRITE:%lu from %lu\n",nsector,start);
 		#ifndef NAND_CACHE_RW
 			ret = LML_Write(start, nsector, buf);
 		#else
-			//printk("Ws %lu %lu \n",start, nsector);
 			ret = NAND_CacheWrite(start, nsector, buf);
-			//printk("We %lu %lu \n",start, nsector);
 		#endif
 		if (ret)
 		{
-			dbg_err("cache_align_page_request:write err\n");
+			dbg_err("nand_transfer:write err\n");
 			return -EIO;
 		}
 		return 0;
@@ -210,155 +229,213 @@ static int cache_align_page_request(struct nand_blk_ops * nandr, struct nand_blk
 	}
 
 }
-#endif
 
-//for 2.6.29
-#ifdef NAND_BIO_ALIGN
-static int nand_blk_phys_contig_segment(struct request_queue *q, struct bio *bio, struct bio *nxt)
+/*
+ * The NFC maps each page buffer with dma_map_single(), so a segment that
+ * does not start and end on a cache line would share lines with its
+ * neighbours. Only those go through the bounce buffer, one page at a time.
+ */
+static int nand_transfer_sg(struct nand_blk_ops *nandr, struct nand_blk_dev *dev,
+			    unsigned long start, struct scatterlist *sg, int cmd)
 {
-	//if (!(q->queue_flags & (1 << QUEUE_FLAG_CLUSTER)))
-	//	return 0;
-
-	if (!BIOVEC_PHYS_MERGEABLE(__BVEC_END(bio), __BVEC_START(nxt)))
-		return 0;
-	if (bio->bi_size + nxt->bi_size > q->limits.max_segment_size)
-		return 0;
+	char *buf = sg_virt(sg);
+	unsigned int done, chunk;
+	int ret = 0;
 
-	/*
-	 * bio and nxt are contigous in memory, check if the queue allows
-	 * these two to be merged into one
-	 */
-	if (BIO_SEG_BOUNDARY(q, bio, nxt))
-		return 1;
+	if (!(((unsigned long)buf | sg->length) & (L1_CACHE_BYTES - 1))) {
+		down(&nandr->nand_ops_mutex);
+		ret = nand_transfer(dev, start, sg->length >> 9, buf, cmd);
+		up(&nandr->nand_ops_mutex);
+		return ret;
+	}
 
-	return 0;
+	for (done = 0; done < sg->length && !ret; done += chunk) {
+		chunk = min_t(unsigned int, sg->length - done, NAND_BOUNCE_SIZE);
+		down(&nandr->nand_ops_mutex);
+		if (cmd == WRITE)
+			memcpy(nandr->bounce, buf + done, chunk);
+		ret = nand_transfer(dev, start + (done >> 9), chunk >> 9,
+				    nandr->bounce, cmd);
+		if (!ret && cmd == READ)
+			memcpy(buf + done, nandr->bounce, chunk);
+		up(&nandr->nand_ops_mutex);
+	}
+	return ret;
 }
-/* Compute maximal contiguous buffer size. */
-static int nand_buffer_chain_size(struct request *req)
+
+/*
+ * The block layer has already merged the bios and their physically
+ * contiguous bvecs; hand each resulting segment straight to the logic
+ * layer, which DMAs whole pages into it. The ops mutex is taken per
+ * segment, so the background cache flush can slip in between.
+ */
+static int nand_blk_do_request(struct nand_blk_ops *nandr, struct request *req)
 {
-	struct bio *bio,*prevbio = NULL;
-	struct bio_vec *bv;
-	int i;
-	unsigned long size = 0;
-	char *base=bio_data(req->bio);
-	unsigned int phys_size = 0;
-	struct request_queue *q = req->q;
+	struct nand_blk_dev *dev = req->rq_disk->private_data;
+	struct scatterlist *sg;
+	unsigned long start = blk_rq_pos(req);
+	int cmd = rq_data_dir(req);
+	int nsg, i;
+	int ret = 0;
 
-      __rq_for_each_bio(bio, req) {
+	if (req->cmd_type != REQ_TYPE_FS)
+		return -EIO;
 
-		if(prevbio){
-			int pseg = phys_size + prevbio->bi_size + bio->bi_size;
-			if (!nand_blk_phys_contig_segment(q, prevbio, bio) || pseg > q->limits.max_segment_size){
-				break;
-			}
-		}
+	if ((start + blk_rq_sectors(req)) > get_capacity(req->rq_disk)) {
+		dbg_err("over the limit of disk\n");
+		return -EIO;
+	}
 
-		bio_for_each_segment(bv, bio, i) {
-                   if (page_address(bv->bv_page) + bv->bv_offset != base + size){
-				break;
-             	}
-                   size += bv->bv_len;
-              }
-		prevbio = bio;
+	if (req->cmd_flags & REQ_DISCARD) {
+		if (dev->disable_access || dev->readonly)
+			return -EIO;
+		down(&nandr->nand_ops_mutex);
+		ret = LML_Discard(start + dev->off_size, blk_rq_sectors(req));
+		#ifdef NAND_CACHE_RW
+		NAND_CacheReadAheadDrop();
+		#endif
+		up(&nandr->nand_ops_mutex);
+		return ret ? -EIO : 0;
 	}
-	//return size>>9;
-	return size;
-}
 
-static void reset(struct request *req)
-{
-	//req->current_nr_sectors = req->hard_cur_sectors = nand_buffer_chain_size(req);
-	nand_buffer_chain_size(req);
+	sg_init_table(nandr->sg, NAND_MAX_SEGS);
+	nsg = blk_rq_map_sg(nandr->rq, req, nandr->sg);
+	for_each_sg(nandr->sg, sg, nsg, i) {
+		ret = nand_transfer_sg(nandr, dev, start, sg, cmd);
+		if (ret)
+			break;
+		start += sg->length >> 9;
+	}
 
-}
-#endif
+	#ifdef NAND_CACHE_FLUSH_EVERY_SEC
+	if (cmd == WRITE)
+		after_write = 1;
+	if ((req->cmd_flags & REQ_SYNC) || (cmd == WRITE && nand_cache_high()) ||
+	    (cmd == READ && rr_pages && LML_ReadReclaimPending()))
+		wake_up_interruptible(&collect_arg.wait);
+	#endif
 
-#if USE_BIO_MERGE
-#define nand_bio_kmap(bio,idx,kmtype)	\
-	(page_address(bio_iovec_idx((bio), (idx))->bv_page) +	bio_iovec_idx((bio), (idx))->bv_offset)
+	return ret;
+}
 
+/*
+ * Read ahead of a sequential stream while the queue is empty, one step
+ * per hold of the ops mutex, so a new request waits a few page reads
+ * at most.
+ */
+static int nand_read_ahead_pending(void)
+{
+#ifdef NAND_CACHE_RW
+	return NAND_CacheReadAheadPending();
+#else
+	return 0;
+#endif
+}
 
+static void nand_read_ahead(struct nand_blk_ops *nandr)
+{
+#ifdef NAND_CACHE_RW
+	down(&nandr->nand_ops_mutex);
+	IS_IDLE = 0;
+	LML_FlushPageCache();
+	NAND_CacheReadAhead();
+	IS_IDLE = 1;
+	up(&nandr->nand_ops_mutex);
+#endif
+}
 
+/*
+ * All partitions share the disk queue, the thread and the FTL, so the
+ * thread takes every request off the queue into a FIFO per partition
+ * and serves the one whose head is due first. A read is due
+ * read_expire ms after it was queued, a write write_expire ms: reads
+ * of one partition overtake a backlog of writes to another, and a
+ * write waits no more than write_expire for them. The order within a
+ * partition is kept.
+ */
+static unsigned int read_expire = 50;
+module_param(read_expire, uint, 0644);
+MODULE_PARM_DESC(read_expire, "ms a read may wait behind other partitions");
+static unsigned int write_expire = 500;
+module_param(write_expire, uint, 0644);
+MODULE_PARM_DESC(write_expire, "ms a write may wait behind other partitions");
+
+static inline int nand_nparts(struct nand_blk_ops *nandr)
+{
+	return 1 << nandr->minorbits;
+}
 
-static int nand_transfer(struct nand_blk_dev * dev, unsigned long start,unsigned long nsector, char *buf, int cmd)
+/* called with the queue lock held */
+static void nand_sched_fill(struct nand_blk_ops *nandr)
 {
-	__s32 ret;
+	struct request *req;
+	struct hd_struct *part;
+	int partno;
+
+	while ((req = blk_fetch_request(nandr->rq))) {
+		partno = 0;
+		if (req->rq_disk) {
+			rcu_read_lock();
+			part = disk_map_sector_rcu(req->rq_disk, blk_rq_pos(req));
+			partno = part->partno;
+			rcu_read_unlock();
+		}
+		if (partno >= nand_nparts(nandr))
+			partno = 0;
 
-	if(dev->disable_access || ( (cmd == WRITE) && (dev->readonly) ) \
-		|| ((cmd == READ) && (dev->writeonly))){
-		dbg_err("can not access this part\n");
-		return -EIO;
+		req->special = &nandr->parts[partno];
+		list_add_tail(&req->queuelist, &nandr->parts[partno].fifo);
 	}
-	//printk("[N]start=%lx,nsec=%lx,buffer=%p,cmd=%d\n",start,nsector,buf,cmd);
-	start += dev->off_size;
-
-	switch(cmd) {
-
-	case READ:
-        //printk("R %lu %lu 0x%x \n",start, nsector, (__u32)buf);
-		dbg_inf("READ:%lu from %lu\n",nsector,start);
+}
 
-		#ifndef NAND_CACHE_RW
-			LML_FlushPageCache();
-  			ret = LML_Read(start, nsector, buf);
-		#else
-			//printk("Rs %lu %lu \n",start, nsector);
-      		LML_FlushPageCache();
-			ret = NAND_CacheRead(start, nsector, buf);
-			//printk("Rs %lu %lu \n",start, nsector);
-		#endif
-		if (ret)
-		{
-			dbg_err("cache_align_page_request:read err\n");
-			return -EIO;
+/* called with the queue lock held */
+static struct request *nand_sched_next(struct nand_blk_ops *nandr)
+{
+	struct request *req, *best = NULL;
+	unsigned long due, best_due = 0;
+	int i;
 
+	for (i = 0; i < nand_nparts(nandr); i++) {
+		if (list_empty(&nandr->parts[i].fifo))
+			continue;
+		req = list_first_entry(&nandr->parts[i].fifo, struct request,
+				       queuelist);
+		due = req->start_time + msecs_to_jiffies(rq_data_dir(req) ==
+				READ ? read_expire : write_expire);
+		if (!best || time_before(due, best_due)) {
+			best = req;
+			best_due = due;
 		}
-		return 0;
-
+	}
 
-	case WRITE:
-        //printk("W %lu %lu 0x%x \n",start, nsector, (__u32)buf);
-		dbg_inf("WRITE:%lu from %lu\n",nsector,start);
-		#ifndef NAND_CACHE_RW
-			ret = LML_Write(start, nsector, buf);
-		#else
-			//printk("Ws %lu %lu \n",start, nsector);
-			ret = NAND_CacheWrite(start, nsector, buf);
-			//printk("We %lu %lu \n",start, nsector);
-		#endif
-		if (ret)
-		{
-			dbg_err("cache_align_page_request:write err\n");
-			return -EIO;
-		}
-		return 0;
+	if (best)
+		list_del_init(&best->queuelist);
+	return best;
+}
 
-	default:
-		dbg_err("Unknown request \n");
-		return -EIO;
+/* called with the queue lock held */
+static void nand_sched_done(struct request *req)
+{
+	struct nand_blk_part *part = req->special;
+	unsigned int ms = jiffies_to_msecs(jiffies - req->start_time);
+
+	if (rq_data_dir(req) == READ) {
+		part->reads++;
+		part->read_ms += ms;
+		part->read_max_ms = max(part->read_max_ms, ms);
+	} else {
+		part->writes++;
+		part->write_ms += ms;
+		part->write_max_ms = max(part->write_max_ms, ms);
 	}
-
+	req->special = NULL;
 }
-#endif
-#if NAND_TEST_TICK
-static unsigned long nand_rw_time = 0;
-#endif
+
 static int nand_blktrans_thread(void *arg)
 {
 	struct nand_blk_ops *nandr = arg;
 	struct request_queue *rq = nandr->rq;
 	struct request *req = NULL;
-#if NAND_TEST_TICK
-	unsigned long tick=0;
-#endif
-#if USE_BIO_MERGE
-	struct req_iterator rq_iter;
-	struct bio_vec *bvec;
-	unsigned long long sector = ULLONG_MAX;
-	unsigned long rq_len = 0;
-	char *buffer=NULL;
-	int rw_flag = 0;
-#endif
 
 	/* we might get involved when memory gets low, so use PF_MEMALLOC */
 	current->flags |= PF_MEMALLOC | PF_NOFREEZE;
@@ -376,15 +453,17 @@ static int nand_blktrans_thread(void *arg)
 	spin_lock_irq(rq->queue_lock);
 
 	while (!nandr->quit) {
-
-		struct nand_blk_dev *dev;
-	#if USE_BIO_MERGE == 0
-		int res = 0;
-	#endif
+		int res;
 		DECLARE_WAITQUEUE(wait, current);
 
-		if (!req && !(req = blk_fetch_request(rq))) {
-			//printk("[N]wait req\n");
+		nand_sched_fill(nandr);
+		if (!(req = nand_sched_next(nandr))) {
+			if (nand_read_ahead_pending()) {
+				spin_unlock_irq(rq->queue_lock);
+				nand_read_ahead(nandr);
+				spin_lock_irq(rq->queue_lock);
+				continue;
+			}
 			add_wait_queue(&nandr->thread_wq, &wait);
 			set_current_state(TASK_INTERRUPTIBLE);
 			spin_unlock_irq(rq->queue_lock);
@@ -394,204 +473,18 @@ static int nand_blktrans_thread(void *arg)
 			continue;
 		}
 
-		dev = req->rq_disk->private_data;
-	#if USE_BIO_MERGE==1
-		//spin_unlock_irq(rq->queue_lock);
-		IS_IDLE = 0;
-		//printk("[N]request start\n");
-		__rq_for_each_bio(rq_iter.bio,req){
-			if(!bio_segments(rq_iter.bio)){
-				continue;
-			}
-			//printk("[N]start bio,count=%d\n",(rq_iter.bio)->bi_vcnt);
-			sector = (rq_iter.bio)->bi_sector;
-			buffer = nand_bio_kmap(rq_iter.bio, (rq_iter.bio)->bi_idx, KM_USER0);
-			bio_for_each_segment(bvec, rq_iter.bio, rq_iter.i){
-				if(rq_iter.i<(rq_iter.bio)->bi_vcnt-1){
-					if(nand_bio_kmap(rq_iter.bio, rq_iter.i+1, KM_USER0) == nand_bio_kmap(rq_iter.bio, rq_iter.i, KM_USER0)+ bvec->bv_len){
-						rq_len += bvec->bv_len;
-						//printk("[N]go on\n");
-					}else{
-						rq_len += bvec->bv_len;
-						spin_unlock_irq(rq->queue_lock);
-						down(&nandr->nand_ops_mutex);
-						#if NAND_TEST_TICK
-						tick = jiffies;
-						nand_transfer(dev, sector, rq_len>>9, buffer, bio_data_dir(rq_iter.bio));
-						nand_rw_time += jiffies - tick;
-						#else
-						nand_transfer(dev, sector, rq_len>>9, buffer, bio_data_dir(rq_iter.bio));
-						#endif
-						up(&nandr->nand_ops_mutex);
-						spin_lock_irq(rq->queue_lock);
-						sector += rq_len>>9;
-						rq_len = 0;
-						buffer = nand_bio_kmap(rq_iter.bio, rq_iter.i+1, KM_USER0);
-					}
-				}else{
-					rq_len += bvec->bv_len;
-					spin_unlock_irq(rq->queue_lock);
-					down(&nandr->nand_ops_mutex);
-					#if NAND_TEST_TICK
-					tick = jiffies;
-					nand_transfer(dev, sector,  rq_len>>9, buffer, bio_data_dir(rq_iter.bio));
-					nand_rw_time += jiffies - tick;
-					#else
-					nand_transfer(dev, sector,  rq_len>>9, buffer, bio_data_dir(rq_iter.bio));
-					#endif
-					up(&nandr->nand_ops_mutex);
-					spin_lock_irq(rq->queue_lock);
-					rq_len=0;
-				}
-			}
-			//printk("[N]end bio...\n");
-		}
-		//printk("[N]request finished\n");
-		#if NAND_TEST_TICK
-		printk("[N]ticks=%ld\n",nand_rw_time);
-		#endif
-
-		//printk("req flags=%x\n",req->cmd_flags);
-		#ifdef NAND_CACHE_FLUSH_EVERY_SEC
-		if(req->cmd_flags&REQ_WRITE)
-			after_write = 1;
-		if(req->cmd_flags&REQ_SYNC){
-			wake_up_interruptible(&collect_arg.wait);
-		}
-		#endif
-
-		//spin_lock_irq(rq->queue_lock);
-		__blk_end_request_all(req,0);
-		req = NULL;
-	#elif USE_BIO_MERGE==2
-		//IS_IDLE = 0;
-
-		rw_flag = req->cmd_flags&REQ_WRITE;
-
-		__rq_for_each_bio(rq_iter.bio,req){
-			if(!bio_segments(rq_iter.bio)){
-				continue;
-			}
-			if(unlikely(sector == ULLONG_MAX)){
-				/*new bio, no data exists*/
-				sector = (rq_iter.bio)->bi_sector;
-			}else{
-				/*last bio data exists*/
-				if((rq_iter.bio)->bi_sector == (sector + (rq_len>>9))){
-					//printk("[N]bio merge\n");
-				}else{
-					/*flush last bio data here*/
-					spin_unlock_irq(rq->queue_lock);
-					down(&nandr->nand_ops_mutex);
-				#if NAND_TEST_TICK
-					tick = jiffies;
-					nand_transfer(dev, sector,  rq_len>>9, buffer, rw_flag);
-					nand_rw_time += jiffies - tick;
-				#else
-					nand_transfer(dev, sector, rq_len>>9, buffer, rw_flag);
-				#endif
-					up(&nandr->nand_ops_mutex);
-					spin_lock_irq(rq->queue_lock);
-					/*update new bio*/
-					sector = (rq_iter.bio)->bi_sector;
-					buffer = 0;
-					rq_len = 0;
-				}
-			}
-
-			bio_for_each_segment(bvec, rq_iter.bio, rq_iter.i){
-				if(1){
-					if(nand_bio_kmap(rq_iter.bio, rq_iter.i, KM_USER0) == buffer + rq_len){
-						/*merge vec*/
-						rq_len += bvec->bv_len;
-						//printk("[N]merge bvc\n");
-					}else{
-						/*flush previous data*/
-						if(rq_len){
-							spin_unlock_irq(rq->queue_lock);
-							down(&nandr->nand_ops_mutex);
-						#if NAND_TEST_TICK
-							tick = jiffies;
-							nand_transfer(dev, sector,  rq_len>>9, buffer, rw_flag);
-							nand_rw_time += jiffies - tick;
-						#else
-							nand_transfer(dev, sector, rq_len>>9, buffer, rw_flag);
-						#endif
-							up(&nandr->nand_ops_mutex);
-							spin_lock_irq(rq->queue_lock);
-						}
-						/*update new*/
-						sector += rq_len>>9;
-						buffer = nand_bio_kmap(rq_iter.bio, rq_iter.i, KM_USER0);
-						rq_len = bvec->bv_len;
-					}
-				}
-			}
-		}
-
-		if(rq_len){
-			spin_unlock_irq(rq->queue_lock);
-			down(&nandr->nand_ops_mutex);
-		#if NAND_TEST_TICK
-			tick = jiffies;
-			nand_transfer(dev, sector,  rq_len>>9, buffer, rw_flag);
-			nand_rw_time += jiffies - tick;
-		#else
-			nand_transfer(dev, sector, rq_len>>9, buffer, rw_flag);
-		#endif
-			up(&nandr->nand_ops_mutex);
-			spin_lock_irq(rq->queue_lock);
-			sector = ULLONG_MAX;
-			rq_len = 0;
-			buffer = NULL;
-		}
-
-		#if NAND_TEST_TICK
-		printk("[N]ticks=%ld\n",nand_rw_time);
-		#endif
-
-		#ifdef NAND_CACHE_FLUSH_EVERY_SEC
-		if(rw_flag == REQ_WRITE)
-			after_write = 1;
-		if(req->cmd_flags&REQ_SYNC){
-			wake_up_interruptible(&collect_arg.wait);
-		}
-		#endif
-
-		//spin_lock_irq(rq->queue_lock);
-		__blk_end_request_all(req,0);
-		req = NULL;
-	#else
-		nandr = dev->nandr;
 		spin_unlock_irq(rq->queue_lock);
-		down(&nandr->nand_ops_mutex);
 		IS_IDLE = 0;
-
-		#ifdef NAND_BIO_ALIGN
-			reset(req);
-		#endif
-		#if NAND_TEST_TICK
-		tick = jiffies;
-		res = cache_align_page_request(nandr, dev, req);
-		nand_rw_time += jiffies - tick;
-		#else
-		res = cache_align_page_request(nandr, dev, req);
-		#endif
-		up(&nandr->nand_ops_mutex);
+		res = nand_blk_do_request(nandr, req);
 		IS_IDLE = 1;
 		spin_lock_irq(rq->queue_lock);
 
-		if(!__blk_end_request_cur(req, res)){
-			req = NULL;
-			#if NAND_TEST_TICK
-			printk("[N]ticks=%ld\n",nand_rw_time);
-			#endif
-		}
-	#endif
-
+		nand_sched_done(req);
+		__blk_end_request_all(req, res);
 	}
 
-	if(req)
+	nand_sched_fill(nandr);
+	while ((req = nand_sched_next(nandr)))
 		__blk_end_request_all(req, -EIO);
 	spin_unlock_irq(rq->queue_lock);
 
@@ -830,15 +723,23 @@ static int collect_thread(void *tmparg)
 	}
 #else
 	while (!arg->quit){
-		ret = wait_event_interruptible(arg->wait,after_write);
+		ret = wait_event_interruptible(arg->wait, after_write ||
+				(rr_pages && LML_ReadReclaimPending()));
 		if(ret==0){
 			do{
 				after_write = 0;
-				ssleep(arg->timeout);
+				/* under sustained writes, trim the cache back to half full */
+				if (wait_event_interruptible_timeout(arg->wait,
+						nand_cache_high(), arg->timeout * HZ) > 0) {
+					nand_flush_pages(NAND_CacheSize() / 2);
+					after_write = 1;
+				}
 			}while(after_write);
 			//IS_IDLE = 1;
 			nand_flush(NULL);
 			//IS_IDLE = 1;
+			nand_background_gc();
+			nand_background_reclaim();
 		}
 	}
 #endif
@@ -883,9 +784,34 @@ int nand_blk_register(struct nand_blk_ops *nandr)
 		return ret;
 	}
 
+	blk_queue_max_segments(nandr->rq, NAND_MAX_SEGS);
+
+	/* discarded logical pages are skipped when their block is merged */
+	queue_flag_set_unlocked(QUEUE_FLAG_DISCARD, nandr->rq);
+	blk_queue_max_discard_sectors(nandr->rq, UINT_MAX);
+	nandr->rq->limits.discard_granularity = SECTOR_CNT_OF_LOGIC_PAGE << 9;
+	nandr->sg = kmalloc(sizeof(struct scatterlist) * NAND_MAX_SEGS, GFP_KERNEL);
+	nandr->bounce = kmalloc(NAND_BOUNCE_SIZE, GFP_KERNEL);
+	nandr->parts = kcalloc(nand_nparts(nandr), sizeof(*nandr->parts),
+			       GFP_KERNEL);
+	if (!nandr->sg || !nandr->bounce || !nandr->parts) {
+		kfree(nandr->sg);
+		kfree(nandr->bounce);
+		kfree(nandr->parts);
+		blk_cleanup_queue(nandr->rq);
+		unregister_blkdev(nandr->major, nandr->name);
+		up(&nand_mutex);
+		return -ENOMEM;
+	}
+	for (ret = 0; ret < nand_nparts(nandr); ret++)
+		INIT_LIST_HEAD(&nandr->parts[ret].fifo);
+
 	nandr->rq->queuedata = nandr;
 	ret = kernel_thread(nand_blktrans_thread, nandr, CLONE_KERNEL);
 	if (ret < 0) {
+		kfree(nandr->sg);
+		kfree(nandr->bounce);
+		kfree(nandr->parts);
 		blk_cleanup_queue(nandr->rq);
 		unregister_blkdev(nandr->major, nandr->name);
 		up(&nand_mutex);
@@ -935,6 +861,9 @@ void nand_blk_unregister(struct nand_blk_ops *nandr)
 
 	//devfs_remove(nandr->name);
 	blk_cleanup_queue(nandr->rq);
+	kfree(nandr->sg);
+	kfree(nandr->bounce);
+	kfree(nandr->parts);
 
 	unregister_blkdev(nandr->major, nandr->name);
 
@@ -962,21 +891,195 @@ static struct nand_blk_ops mytr = {
 };
 
 
-static int nand_flush(struct nand_blk_dev *dev)
+/*
+ * Write the cache back one page per hold of the ops mutex, so a read
+ * queued behind a background flush waits for one page program rather
+ * than for the whole cache. Stops once no more than keep pages are dirty.
+ */
+static void nand_flush_pages(unsigned int keep)
 {
-	if (0 == down_trylock(&mytr.nand_ops_mutex))
-	{
+#ifdef NAND_CACHE_RW
+	int more = 1;
+
+	while (more && NAND_CacheDirtyCount() > keep) {
+		down(&mytr.nand_ops_mutex);
 		IS_IDLE = 0;
-	#ifdef NAND_CACHE_RW
-		NAND_CacheFlush();
-	#else
-		LML_FlushPageCache();
-	#endif
+		more = NAND_CacheFlushOne();
+		IS_IDLE = 1;
 		up(&mytr.nand_ops_mutex);
+	}
+#endif
+}
+
+#ifdef NAND_CACHE_FLUSH_EVERY_SEC
+static void nand_background_gc(void)
+{
+	unsigned int mark = gc_low;
+	int ret;
+
+	while (mark && !after_write && !collect_arg.quit) {
+		down(&mytr.nand_ops_mutex);
+		IS_IDLE = 0;
+		ret = LML_BackgroundMerge(mark);
 		IS_IDLE = 1;
+		up(&mytr.nand_ops_mutex);
 
-		dbg_inf("nand_flush \n");
+		if (ret <= 0) {
+			if (ret < 0)
+				gc_errors++;
+			break;
+		}
+		gc_merges++;
+		mark = max(gc_low, gc_high);
+		cond_resched();
 	}
+}
+
+static void nand_background_reclaim(void)
+{
+	int ret;
+
+	while (rr_pages && !after_write && !collect_arg.quit) {
+		down(&mytr.nand_ops_mutex);
+		IS_IDLE = 0;
+		ret = LML_ReadReclaimRun(rr_pages);
+		IS_IDLE = 1;
+		up(&mytr.nand_ops_mutex);
+
+		if (ret <= 0)
+			break;
+		wait_event_interruptible_timeout(collect_arg.wait,
+				after_write || collect_arg.quit,
+				msecs_to_jiffies(rr_interval));
+	}
+}
+#endif
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *nand_debugfs;
+
+static int nand_reclaim_show(struct seq_file *m, void *v)
+{
+	struct __ReclaimStat_t stat;
+	struct __ReclaimItem_t item;
+	unsigned int i;
+
+	if (down_interruptible(&mytr.nand_ops_mutex))
+		return -ERESTARTSYS;
+	LML_ReadReclaimState(&stat, 0, NULL);
+	seq_printf(m, "queued: %u\ndropped: %u\ndone: %u\npages: %u\nerrors: %u\n",
+		   stat.Queued, stat.Dropped, stat.Done, stat.Pages, stat.Errors);
+	seq_printf(m, "ecc limit: %u bits\n", stat.BitLimit);
+	if (stat.Cur.BitCnt)
+		seq_printf(m, "current: zone %u block %u bits %u page %u\n",
+			   stat.Cur.ZoneNum, stat.Cur.BlockNum,
+			   stat.Cur.BitCnt, stat.Cur.NextPage);
+	seq_printf(m, "pending: %u\n", stat.QueueLen);
+	for (i = 0; !LML_ReadReclaimState(NULL, i, &item); i++)
+		seq_printf(m, "  zone %u block %u bits %u\n",
+			   item.ZoneNum, item.BlockNum, item.BitCnt);
+	up(&mytr.nand_ops_mutex);
+
+	return 0;
+}
+
+static int nand_reclaim_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nand_reclaim_show, inode->i_private);
+}
+
+static const struct file_operations nand_reclaim_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nand_reclaim_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* per partition: requests served and ms from queued to completed */
+static int nand_sched_show(struct seq_file *m, void *v)
+{
+	struct gendisk *gd = mytr.dev.blkcore_priv;
+	struct nand_blk_part part;
+	char name[BDEVNAME_SIZE];
+	int i;
+
+	seq_printf(m, "read_expire %u ms, write_expire %u ms\n\n",
+		   read_expire, write_expire);
+	seq_printf(m, "%-8s %8s %6s %6s %8s %6s %6s\n", "part",
+		   "reads", "avg", "max", "writes", "avg", "max");
+	for (i = 0; gd && i < nand_nparts(&mytr); i++) {
+		spin_lock_irq(&mytr.queue_lock);
+		part = mytr.parts[i];
+		spin_unlock_irq(&mytr.queue_lock);
+		if (!part.reads && !part.writes)
+			continue;
+		/* disk_name() is not exported to modules */
+		if (i)
+			snprintf(name, sizeof(name), "%s%d", gd->disk_name, i);
+		else
+			strlcpy(name, gd->disk_name, sizeof(name));
+
+		seq_printf(m, "%-8s %8lu %6lu %6u %8lu %6lu %6u\n",
+			   name,
+			   part.reads, part.reads ? part.read_ms / part.reads : 0,
+			   part.read_max_ms, part.writes,
+			   part.writes ? part.write_ms / part.writes : 0,
+			   part.write_max_ms);
+	}
+
+	return 0;
+}
+
+static int nand_sched_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nand_sched_show, inode->i_private);
+}
+
+static const struct file_operations nand_sched_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nand_sched_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void nand_debugfs_init(void)
+{
+	nand_debugfs = debugfs_create_dir("nand", NULL);
+	if (IS_ERR_OR_NULL(nand_debugfs)) {
+		nand_debugfs = NULL;
+		return;
+	}
+	debugfs_create_file("read_reclaim", 0444, nand_debugfs, NULL,
+			    &nand_reclaim_fops);
+	debugfs_create_file("sched", 0444, nand_debugfs, NULL,
+			    &nand_sched_fops);
+}
+
+static void nand_debugfs_exit(void)
+{
+	debugfs_remove_recursive(nand_debugfs);
+	nand_debugfs = NULL;
+}
+#else
+static inline void nand_debugfs_init(void) {}
+static inline void nand_debugfs_exit(void) {}
+#endif
+
+static int nand_flush(struct nand_blk_dev *dev)
+{
+#ifdef NAND_CACHE_RW
+	nand_flush_pages(0);
+#else
+	down(&mytr.nand_ops_mutex);
+	IS_IDLE = 0;
+	LML_FlushPageCache();
+	IS_IDLE = 1;
+	up(&mytr.nand_ops_mutex);
+#endif
+
+	dbg_inf("nand_flush \n");
 	return 0;
 }
 
@@ -1341,11 +1444,16 @@ static int __init init_blklayer(void)
 		NAND_CacheOpen();
 	#endif
 
-	return nand_blk_register(&mytr);
+	ret = nand_blk_register(&mytr);
+	if (!ret)
+		nand_debugfs_init();
+
+	return ret;
 }
 
 static void  __exit exit_blklayer(void)
 {
+	nand_debugfs_exit();
 	nand_flush(NULL);
 	nand_blk_unregister(&mytr);
 	#ifdef NAND_CACHE_RW
@@ -1459,7 +1567,9 @@ static struct platform_driver nand_driver = {
  *
  ****************************************************************************/
 
-static int __init nand_init(void)
+static int nand_ready;
+
+static int __init nand_do_init(void)
 {
 	s32 ret;
 	int nand_used = 0;
@@ -1491,10 +1601,29 @@ static int __init nand_init(void)
 		dbg_err("platform_driver_register fail \n");
 		return -1;
 	}
+	nand_ready = 1;
 	printk("[NAND]nand driver, ok.\n");
 	return 0;
 }
 
+#ifdef CONFIG_SUNXI_ASYNC_INIT
+static void __init nand_init_async(void *data, async_cookie_t cookie)
+{
+	nand_do_init();
+}
+#endif
+
+/* the scan of the flash takes long and nothing but the root mount needs it */
+static int __init nand_init(void)
+{
+#ifdef CONFIG_SUNXI_ASYNC_INIT
+	async_schedule(nand_init_async, NULL);
+	return 0;
+#else
+	return nand_do_init();
+#endif
+}
+
 static void __exit nand_exit(void)
 {
     s32 ret;
@@ -1512,6 +1641,8 @@ static void __exit nand_exit(void)
         printk("nand driver is disabled \n");
         return ;
     }
+	if (!nand_ready)
+		return;
 
 	printk("[NAND]nand driver : bye bye\n");
 	platform_driver_unregister(&nand_driver);
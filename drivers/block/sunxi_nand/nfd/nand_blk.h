@@ -21,6 +21,7 @@
  */
 
 #include <linux/semaphore.h>
+#include <linux/list.h>
 
 struct nand_blk_ops;
 struct list_head;
@@ -42,6 +43,14 @@ struct nand_blk_dev{
 	int disable_access;
 	void *blkcore_priv;
 };
+/* the requests of one partition (0 is the whole disk) and their latency */
+struct nand_blk_part{
+	struct list_head fifo;
+	unsigned long reads, writes;
+	unsigned long read_ms, write_ms;	/* queued to completed, summed */
+	unsigned int read_max_ms, write_max_ms;
+};
+
 struct nand_blk_ops{
 	/* blk device ID */
 	char *name;
@@ -67,6 +76,9 @@ struct nand_blk_ops{
 	struct request_queue *rq;
 	spinlock_t queue_lock;
 	struct semaphore nand_ops_mutex;
+	struct scatterlist *sg;		/* segments of the request in flight */
+	char *bounce;			/* for segments the DMA cannot take */
+	struct nand_blk_part *parts;	/* 1 << minorbits, under queue_lock */
 
 	struct nand_blk_dev dev;
 	struct module *owner;
@@ -80,7 +80,7 @@
 #define CFG_SUPPORT_MULTI_PLANE_PROGRAM         (1)
 
 //define the switch that if need support multi-plane read
-#define CFG_SUPPORT_MULTI_PLANE_READ            (0)
+#define CFG_SUPPORT_MULTI_PLANE_READ            (1)
 
 //define the switch that if need support internal inter-leave
 #define CFG_SUPPORT_INT_INTERLEAVE              (0)
@@ -216,6 +216,41 @@ __s32 LML_Write(__u32 nLba, __u32 nLength, void* pBuf);
 __s32 LML_FlushPageCache(void);
 
 
+/*
+************************************************************************************************************************
+*                       NAND FLASH LOGIC MANAGE LAYER BACKGROUND MERGE
+*
+*Description: Merge one log block ahead of time if the current zone is short of empty log items.
+*
+*Arguments  : nFreeMark     the count of the empty log items that should be kept.
+*
+*Return     : merge result;
+*               = 1     a log block has been merged;
+*               = 0     nothing to do;
+*               = -1    merge failed.
+************************************************************************************************************************
+*/
+__s32 LML_BackgroundMerge(__u32 nFreeMark);
+
+
+/*
+************************************************************************************************************************
+*                       NAND FLASH LOGIC MANAGE LAYER DISCARD
+*
+*Description: Mark the logical pages which are fully covered by the sectors as discarded.
+*
+*Arguments  : nSectNum      the number of the first sector which is discarded;
+*             nSectorCnt    the count of the sectors which are discarded.
+*
+*Return     : discard result;
+*               = 0     discard successful;
+*               = -1    discard failed.
+************************************************************************************************************************
+*/
+__s32 LML_Discard(__u32 nSectNum, __u32 nSectorCnt);
+__u32 LML_PageDiscarded(__u32 nZone, __u32 nBlk, __u32 nPage);
+
+
 /*
 ************************************************************************************************************************
 *                       NAND FLASH LOGIC MANAGE LAYER PAGE READ
@@ -276,6 +311,27 @@ __s32 LML_PageWrite(__u32 nPage, __u32 nBitmap, void* pBuf);
 __s32 LML_ReadReclaim(__u32 nPage);
 
 
+/*
+************************************************************************************************************************
+*                       NAND FLASH LOGIC MANAGE LAYER READ-RECLAIM QUEUE
+*
+*Description: Queue the logical blocks whose pages are read with many ecc corrected bits, and move
+*             their data to new physical blocks in the background, before the ecc can not correct it.
+*
+*Notes      : LML_ReadReclaimCheck() is called with every page read, LML_ReadReclaimRun() rewrites
+*             some pages of the worst block in the queue and returns 1, or returns 0 when the queue is
+*             empty and -1 when failed, LML_ReadReclaimReset() is called when a merge moved the data.
+************************************************************************************************************************
+*/
+__s32 LML_ReadReclaimInit(__u32 nBlkCnt);
+void LML_ReadReclaimExit(void);
+void LML_ReadReclaimCheck(__u32 nZone, __u32 nBlk, __u32 nBitCnt, __u32 nBitLimit);
+void LML_ReadReclaimReset(__u32 nZone, __u32 nBlk);
+__s32 LML_ReadReclaimRun(__u32 nPageCnt);
+__u32 LML_ReadReclaimPending(void);
+__s32 LML_ReadReclaimState(struct __ReclaimStat_t *pStat, __u32 nIndex, struct __ReclaimItem_t *pItem);
+
+
 /*
 ************************************************************************************************************************
 *                   NAND FLASH LOGIC MANAGE LAYER WEAR-LEVELLING
@@ -352,6 +408,10 @@ __s32 LML_BadBlkManage(struct __SuperPhyBlkType_t *pBadBlk, __u32 nZoneNum, __u3
 */
 __s32 LML_MergeLogBlk(__u32 nMode, __u32 nLogicBlk);
 
+//the count of the log block merges and the super block erases since load, for benchmarks
+__u32 LML_GetMergeCnt(void);
+__u32 LML_GetEraseCnt(void);
+
 /*
 ************************************************************************************************************************
 *                       NAND FLASH LOGIC MANAGE LAYER ERASE SUPER BLOCK
@@ -550,6 +610,7 @@ __s32 BMM_GetFreeBlk(__u32 nType, struct __SuperPhyBlkType_t *pFreeBlk);
 __s32 BMM_SetFreeBlk(struct __SuperPhyBlkType_t *pFreeBlk);
 __s32 BMM_GetLogBlk(__u32 nLogicBlk, struct __LogBlkType_t *pLogBlk);
 __s32 BMM_SetLogBlk(__u32 nLogicBlk, struct __LogBlkType_t *pLogBlk);
+__s32 BMM_MergeLogBlkAhead(__u32 nFreeMark);
 __u32 PMM_GetLogPage(__u32 nBlk, __u32 nPage, __u8 nMode);
 void PMM_ClearCurMapTbl(void);
 __u32 PMM_GetCurMapPage(__u16 nLogicalPage);
@@ -559,7 +620,13 @@ __s32 LML_VirtualPageWrite( struct __PhysicOpPara_t *pVirtualPage);
 __s32 LML_VirtualPageRead(struct __PhysicOpPara_t *pVirtualPage);
 
 __s32 NAND_CacheFlush(void);
+__s32 NAND_CacheFlushOne(void);
+__u32 NAND_CacheDirtyCount(void);
+__u32 NAND_CacheSize(void);
 __s32 NAND_CacheRead(__u32 blk, __u32 nblk, void *buf);
+__u32 NAND_CacheReadAheadPending(void);
+__s32 NAND_CacheReadAhead(void);
+void NAND_CacheReadAheadDrop(void);
 __s32 NAND_CacheWrite(__u32 blk, __u32 nblk, void *buf);
 __s32 NAND_CacheOpen(void);
 __s32 NAND_CacheClose(void);
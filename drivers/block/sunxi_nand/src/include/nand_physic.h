@@ -324,6 +324,21 @@ __s32 PHY_PageCopyback(struct __PhysicOpPara_t *pSrcPage, struct __PhysicOpPara_
 __s32 PHY_SynchBank(__u32 nBank, __u32 bMode);
 
 
+/*
+************************************************************************************************************************
+*                       GET NAND FLASH ECC BIT COUNT
+*
+*Description: Get the worst count of the bits corrected by the ECC in one ecc block, counted from
+*             the pages read after last call, and clear the count.
+*
+*Arguments  : pBitLimit the pointer to return the count of bits the ECC can correct, may be NULL.
+*
+*Return     : the count of the corrected bits.
+************************************************************************************************************************
+*/
+__u32 PHY_GetEccBitCnt(__u32 *pBitLimit);
+
+
 __s32 PHY_GetDefaultParam(__u32 bank);
 __s32 PHY_SetDefaultParam(__u32 bank);
 
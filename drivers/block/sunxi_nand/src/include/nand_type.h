@@ -210,10 +210,10 @@ struct __PageMapTblCache_t
 {
     __u8        ZoneNum;                            //the zone number which the page mapping table is belonged to
     __u8        LogBlkPst;                          //the position of the log block in the log block table
-    __u16       AccessCnt;                          //the counter that the page mapping table has been accessed
-	struct __PageMapTblItem_t *PageMapTbl;          //the pointer to the page mapping table
     __u8        DirtyFlag;                          //the flag that marks if the page mapping table need be writen back to nand flash
-    __u8        Reserved[3];                        //reserved for 32bit align
+    __u8        Reserved;                           //reserved for 32bit align
+    __u32       AccessStamp;                        //the value of the access timer when the page mapping table was accessed last time
+	struct __PageMapTblItem_t *PageMapTbl;          //the pointer to the page mapping table
 };
 
 //define the page mapping table cache management parameter type
@@ -221,6 +221,8 @@ struct __PageMapTblCachePool_t
 {
     struct __PageMapTblCache_t *ActPageMapTbl;                              //the poninter to the active page mapping table
     struct __PageMapTblCache_t PageMapTblCachePool[PAGE_MAP_TBL_CACHE_CNT]; //the pool of the page mapping table cache
+    __u16       PageMapTblIndex[MAX_ZONE_CNT][MAX_LOG_BLK_CNT];             //the cache position of the page mapping table of every log block, a hint checked against the cache
+    __u32       AccessTimer;                                                //the timer of the access time for the page mapping table LRU
 };
 
 
@@ -257,6 +259,31 @@ struct __LogicCtlPar_t
 };
 
 
+//define the read-reclaim queue item type
+struct __ReclaimItem_t
+{
+    __u16       BlockNum;                           //the number of the logical block in the zone which need be rewritten
+    __u16       NextPage;                           //the number of the next page in the logical block which need be rewritten
+    __u8        ZoneNum;                            //the number of the zone which the logical block is belonged to
+    __u8        BitCnt;                             //the worst count of the ecc corrected bits read from the block, 0 marks empty
+    __u8        Reserved[2];                        //reserved for 32bit align
+};
+
+
+//define the read-reclaim statistic type
+struct __ReclaimStat_t
+{
+    __u32       Queued;                             //the count of the blocks put into the read-reclaim queue
+    __u32       Dropped;                            //the count of the blocks dropped because the queue is full
+    __u32       Done;                               //the count of the blocks whose data has been moved
+    __u32       Pages;                              //the count of the pages rewritten by the read-reclaim
+    __u32       Errors;                             //the count of the read-reclaim steps failed
+    __u32       BitLimit;                           //the count of the bits the ecc can correct
+    __u32       QueueLen;                           //the count of the blocks waiting in the read-reclaim queue
+    struct __ReclaimItem_t Cur;                     //the block which is being rewritten
+};
+
+
 //define the nand flash physical information parameter type
 struct __NandPhyInfoPar_t
 {
@@ -26,8 +26,18 @@
 //#define CACHE_DBG
 
 #define NAND_W_CACHE_EN
-#define N_NAND_W_CACHE  8
 
+/*
+ * The write cache is set associative: a logic page always lands in set
+ * (page % sets), which keeps lookups to NAND_W_CACHE_WAYS compares and
+ * spreads sequential pages over all sets. The number of sets is a power
+ * of two set at load time, the default gives 32 cached pages.
+ */
+#define NAND_W_CACHE_WAYS	4
+
+static unsigned int w_cache_sets = 8;
+module_param(w_cache_sets, uint, 0444);
+MODULE_PARM_DESC(w_cache_sets, "NAND write cache sets of 4 pages (power of 2)");
 
 typedef struct
 {
@@ -42,9 +52,76 @@ typedef struct
 
 __u32 g_w_access_cnt;
 
-__nand_cache_t nand_w_cache[N_NAND_W_CACHE];
+__u32 n_nand_w_cache;
+__nand_cache_t *nand_w_cache;
 __nand_cache_t nand_r_cache;
 
+/*
+ * Read-ahead. A read that starts where the last one ended continues a
+ * stream; while a stream runs, the block thread reads the ra_window
+ * logic pages after its position into a ring of page buffers whenever
+ * the queue is empty, see NAND_CacheReadAhead(). A step stops at the
+ * end of the logic block, whose pages live in one physical block (or
+ * one interleaved set of them), and holds the ops mutex for at most
+ * NAND_RA_STEP page reads.
+ */
+#define NAND_RA_STEP		4
+
+static unsigned int ra_max = 16;
+module_param(ra_max, uint, 0444);
+MODULE_PARM_DESC(ra_max, "NAND read-ahead buffer in logic pages (0 disables)");
+static unsigned int ra_window = 8;
+module_param(ra_window, uint, 0644);
+MODULE_PARM_DESC(ra_window, "Logic pages read ahead of a sequential stream (0 disables)");
+static unsigned int ra_hits;
+module_param(ra_hits, uint, 0444);
+MODULE_PARM_DESC(ra_hits, "Logic pages served from the read-ahead buffer");
+static unsigned int ra_misses;
+module_param(ra_misses, uint, 0444);
+MODULE_PARM_DESC(ra_misses, "Logic pages a sequential stream had to read from nand");
+static unsigned int ra_reads;
+module_param(ra_reads, uint, 0444);
+MODULE_PARM_DESC(ra_reads, "Logic pages read ahead");
+
+static struct
+{
+	__u8	**data;		/* page p is in data[p % ra_max] */
+	__u32	start;		/* pages start to end - 1 are held */
+	__u32	end;
+	__u32	next_sec;	/* where the stream goes on */
+	__u32	seq;		/* reads in a row that went on from the last */
+} nand_ra;
+
+static void _ra_drop(void)
+{
+	nand_ra.start = 0;
+	nand_ra.end = 0;
+}
+
+static int _ra_has(__u32 page)
+{
+	return nand_ra.data && page >= nand_ra.start && page < nand_ra.end;
+}
+
+static __nand_cache_t *_w_cache_set(__u32 page)
+{
+	return &nand_w_cache[(page & (w_cache_sets - 1)) * NAND_W_CACHE_WAYS];
+}
+
+static __nand_cache_t *_w_cache_find(__u32 page)
+{
+	__nand_cache_t *set = _w_cache_set(page);
+	__u32 i;
+
+	for (i = 0; i < NAND_W_CACHE_WAYS; i++)
+	{
+		if (set[i].hit_page == page)
+			return &set[i];
+	}
+
+	return NULL;
+}
+
 __u32 _get_valid_bits(__u32 secbitmap)
 {
 	__u32 validbit = 0;
@@ -72,65 +149,84 @@ __u32 _get_first_valid_bit(__u32 secbitmap)
 	return firstbit;
 }
 
-__s32 _flush_w_cache(void)
+static void _flush_w_cache_entry(__nand_cache_t *c)
 {
-	__u32	i;
-
-	for(i = 0; i < N_NAND_W_CACHE; i++)
+	if(c->hit_page != 0xffffffff)
 	{
-		if(nand_w_cache[i].hit_page != 0xffffffff)
-		{
-			if(nand_w_cache[i].secbitmap != FULL_BITMAP_OF_LOGIC_PAGE)
-				LML_PageRead(nand_w_cache[i].hit_page,(nand_w_cache[i].secbitmap ^ FULL_BITMAP_OF_LOGIC_PAGE)&FULL_BITMAP_OF_LOGIC_PAGE,nand_w_cache[i].data);
-
-			LML_PageWrite(nand_w_cache[i].hit_page,FULL_BITMAP_OF_LOGIC_PAGE,nand_w_cache[i].data);
-			nand_w_cache[i].hit_page = 0xffffffff;
-			nand_w_cache[i].secbitmap = 0;
-			nand_w_cache[i].access_count = 0;
+		if(c->secbitmap != FULL_BITMAP_OF_LOGIC_PAGE)
+			LML_PageRead(c->hit_page,(c->secbitmap ^ FULL_BITMAP_OF_LOGIC_PAGE)&FULL_BITMAP_OF_LOGIC_PAGE,c->data);
 
-			/*disable read cache with current page*/
-			if (nand_r_cache.hit_page == nand_w_cache[i].hit_page){
-					nand_r_cache.hit_page = 0xffffffff;
-					nand_r_cache.secbitmap = 0;
-			}
+		LML_PageWrite(c->hit_page,FULL_BITMAP_OF_LOGIC_PAGE,c->data);
 
+		/*disable read cache with current page*/
+		if (nand_r_cache.hit_page == c->hit_page){
+				nand_r_cache.hit_page = 0xffffffff;
+				nand_r_cache.secbitmap = 0;
 		}
+		if (_ra_has(c->hit_page))
+			_ra_drop();
+
+		c->hit_page = 0xffffffff;
+		c->secbitmap = 0;
+		c->access_count = 0;
 	}
+}
 
+/*
+ * Write back the dirty page with the lowest logic page number. Logic pages
+ * are programmed in order into the log block of their data block, so
+ * writing back in ascending order keeps the log blocks sequential and
+ * avoids the merges that out-of-order pages force.
+ */
+__s32 NAND_CacheFlushOne(void)
+{
+	__nand_cache_t *c = NULL;
+	__u32	i;
 
-	return 0;
+	for(i = 0; i < n_nand_w_cache; i++)
+	{
+		if(nand_w_cache[i].hit_page == 0xffffffff)
+			continue;
+		if(!c || nand_w_cache[i].hit_page < c->hit_page)
+			c = &nand_w_cache[i];
+	}
 
+	if(!c)
+		return 0;
+
+	_flush_w_cache_entry(c);
+	return 1;
 }
 
-__s32 _flush_w_cache_simple(__u32 i)
+__s32 _flush_w_cache(void)
 {
-	if(nand_w_cache[i].hit_page != 0xffffffff)
-	{
-		if(nand_w_cache[i].secbitmap != FULL_BITMAP_OF_LOGIC_PAGE)
-			LML_PageRead(nand_w_cache[i].hit_page,(nand_w_cache[i].secbitmap ^ FULL_BITMAP_OF_LOGIC_PAGE)&FULL_BITMAP_OF_LOGIC_PAGE,nand_w_cache[i].data);
+	while(NAND_CacheFlushOne())
+		;
 
-		LML_PageWrite(nand_w_cache[i].hit_page,FULL_BITMAP_OF_LOGIC_PAGE,nand_w_cache[i].data);
-		nand_w_cache[i].hit_page = 0xffffffff;
-		nand_w_cache[i].secbitmap = 0;
-		nand_w_cache[i].access_count = 0;
+	return 0;
+}
 
-		/*disable read cache with current page*/
-		if (nand_r_cache.hit_page == nand_w_cache[i].hit_page){
-				nand_r_cache.hit_page = 0xffffffff;
-				nand_r_cache.secbitmap = 0;
-		}
+/*count of dirty pages, the block layer flushes early when it runs high*/
+__u32 NAND_CacheDirtyCount(void)
+{
+	__u32	i, n = 0;
 
+	for(i = 0; i < n_nand_w_cache; i++)
+	{
+		if(nand_w_cache[i].hit_page != 0xffffffff)
+			n++;
 	}
 
-	return 0;
-
+	return n;
 }
 
+__u32 NAND_CacheSize(void)
+{
+	return n_nand_w_cache;
+}
 
 __s32 NAND_CacheFlush(void)
 {
-	//__u32	i;
-
 	_flush_w_cache();
 
 	return 0;
@@ -139,23 +235,23 @@ __s32 NAND_CacheFlush(void)
 
 void _get_data_from_cache(__u32 blk, __u32 nblk, void *buf)
 {
-	__u32 i;
+	__nand_cache_t *c = NULL;
 	__u32 sec;
 	__u32 page,SecBitmap,SecWithinPage;
+	__u32 last = 0xffffffff;
 
 	for(sec = blk; sec < blk + nblk; sec++)
 	{
 		SecWithinPage = sec % SECTOR_CNT_OF_LOGIC_PAGE;
 		SecBitmap = (1 << SecWithinPage);
 		page = sec / SECTOR_CNT_OF_LOGIC_PAGE;
-		for (i = 0; i < N_NAND_W_CACHE; i++)
+		if (page != last)
 		{
-			if ((nand_w_cache[i].hit_page == page) && (nand_w_cache[i].secbitmap & SecBitmap))
-			{
-				MEMCPY((__u8 *)buf + (sec - blk) * 512, nand_w_cache[i].data + SecWithinPage * 512,512);
-				break;
-			}
+			c = _w_cache_find(page);
+			last = page;
 		}
+		if (c && (c->secbitmap & SecBitmap))
+			MEMCPY((__u8 *)buf + (sec - blk) * 512, c->data + SecWithinPage * 512,512);
 	}
 }
 
@@ -164,6 +260,20 @@ void _get_one_page(__u32 page,__u32 SecBitmap,__u8 *data)
 	__u32 i;
 	__u8 *tmp = data;
 
+	if(_ra_has(page))
+	{
+		__u8 *ra = nand_ra.data[page % ra_max];
+
+		for(i = 0;i < SECTOR_CNT_OF_LOGIC_PAGE; i++)
+		{
+			if(SecBitmap & (1<<i))
+				MEMCPY(tmp + (i<<9),ra + (i<<9),512);
+		}
+		ra_hits++;
+		return;
+	}
+	if(nand_ra.seq)
+		ra_misses++;
 
 	if(page == nand_r_cache.hit_page)
 	{
@@ -214,6 +324,13 @@ __s32 NAND_CacheRead(__u32 blk, __u32 nblk, void *buf)
 	page 		= 0xffffffff;
 	pdata		= (__u8 *)buf;
 
+	/*a read that goes on from the last one keeps the stream*/
+	if (blk == nand_ra.next_sec)
+		nand_ra.seq++;
+	else
+		nand_ra.seq = 0;
+	nand_ra.next_sec = blk + nblk;
+
 	/*combind sectors to pages*/
 	while(nSector)
 	{
@@ -250,91 +367,103 @@ __s32 NAND_CacheRead(__u32 blk, __u32 nblk, void *buf)
 
 }
 
-__s32 _fill_nand_cache(__u32 page, __u32 secbitmap, __u8 *pdata)
+/*a sequential stream runs and the window ahead of it is not full*/
+__u32 NAND_CacheReadAheadPending(void)
 {
-	__u8	hit;
-	__u8	i;
-	__u8 	pos = 0xff;
+	__u32 pos = nand_ra.next_sec / SECTOR_CNT_OF_LOGIC_PAGE;
 
-	g_w_access_cnt++;
+	if (!nand_ra.data || !ra_window || !nand_ra.seq)
+		return 0;
 
-	hit = 0;
+	return nand_ra.end < pos + min(ra_window, ra_max);
+}
 
-	for (i = 0; i < N_NAND_W_CACHE; i++)
-	{
-		/*merge data if cache hit*/
-		if (nand_w_cache[i].hit_page == page){
-			hit = 1;
-			MEMCPY(nand_w_cache[i].data + 512 * _get_first_valid_bit(secbitmap),pdata, 512 * _get_valid_bits(secbitmap));
-			nand_w_cache[i].secbitmap |= secbitmap;
-			nand_w_cache[i].access_count = g_w_access_cnt;
-			pos = i;
-			break;
-		}
-	}
+/*
+ * One read-ahead step, called with the ops mutex held. The pages the
+ * stream is past are given up; a stream that left the window starts a
+ * new one at its position.
+ */
+__s32 NAND_CacheReadAhead(void)
+{
+	__u32 pos = nand_ra.next_sec / SECTOR_CNT_OF_LOGIC_PAGE;
+	__u32 want, blk_end, page;
+
+	if (!NAND_CacheReadAheadPending())
+		return 0;
+
+	if (pos < nand_ra.start || pos > nand_ra.end)
+		nand_ra.end = pos;
+	nand_ra.start = pos;
 
-	/*post data if cache miss*/
-	if (!hit)
+	want = pos + min(ra_window, ra_max);
+	blk_end = (nand_ra.end / PAGE_CNT_OF_LOGIC_BLK + 1) * PAGE_CNT_OF_LOGIC_BLK;
+	if (want > blk_end)
+		want = blk_end;
+	if (want > nand_ra.end + NAND_RA_STEP)
+		want = nand_ra.end + NAND_RA_STEP;
+
+	for (page = nand_ra.end; page < want; page++)
 	{
-		/*find cache to post*/
-		for (i = 0; i < N_NAND_W_CACHE; i++)
+		/*LML_Read checks the disk end and queues read-reclaim*/
+		if (LML_Read(page * SECTOR_CNT_OF_LOGIC_PAGE, SECTOR_CNT_OF_LOGIC_PAGE,
+			     nand_ra.data[page % ra_max]))
 		{
-			if (nand_w_cache[i].hit_page == 0xffffffff)
-			{
-				pos = i;
-				break;
-			}
+			/*give the stream up, it would only fail again*/
+			nand_ra.seq = 0;
+			break;
 		}
+		nand_ra.end = page + 1;
+		ra_reads++;
+	}
 
-		if (pos == 0xff)
-		{
-			__u32 access_cnt = nand_w_cache[0].access_count;
-			pos = 0;
-
-			for (i = 1; i < N_NAND_W_CACHE; i++)
-			{
-				if (access_cnt > nand_w_cache[i].access_count)
-				{
-					pos = i;
-					access_cnt = nand_w_cache[i].access_count;
-				}
+	return 1;
+}
 
-				if((nand_w_cache[i].hit_page == page-1)&&(page>0))
-				{
-				    pos = i;
-				    break;
-				}
-			}
+/*pages were written or discarded behind the logic cache*/
+void NAND_CacheReadAheadDrop(void)
+{
+	_ra_drop();
+}
 
-			if(nand_w_cache[pos].secbitmap != FULL_BITMAP_OF_LOGIC_PAGE)
-				LML_PageRead(nand_w_cache[pos].hit_page,nand_w_cache[pos].secbitmap ^ FULL_BITMAP_OF_LOGIC_PAGE,nand_w_cache[pos].data);
+__s32 _fill_nand_cache(__u32 page, __u32 secbitmap, __u8 *pdata)
+{
+	__nand_cache_t *set = _w_cache_set(page);
+	__nand_cache_t *c;
+	__u32	i;
 
-			LML_PageWrite(nand_w_cache[pos].hit_page, FULL_BITMAP_OF_LOGIC_PAGE, nand_w_cache[pos].data);
-			nand_w_cache[pos].access_count = 0;
+	g_w_access_cnt++;
 
-			//add by penggang
-			/*disable read cache with current page*/
-			if (nand_r_cache.hit_page == nand_w_cache[pos].hit_page){
-				nand_r_cache.hit_page = 0xffffffff;
-				nand_r_cache.secbitmap = 0;
+	/*merge data if cache hit*/
+	c = _w_cache_find(page);
+	if (!c)
+	{
+		/*take a free way, or evict the least recently used one*/
+		for (i = 0; i < NAND_W_CACHE_WAYS; i++)
+		{
+			if (set[i].hit_page == 0xffffffff)
+			{
+				c = &set[i];
+				break;
 			}
-
+			if (!c || set[i].access_count < c->access_count)
+				c = &set[i];
 		}
 
-		/*merge data*/
-		MEMCPY(nand_w_cache[pos].data + 512 * _get_first_valid_bit(secbitmap),pdata, 512 * _get_valid_bits(secbitmap));
-		nand_w_cache[pos].hit_page = page;
-		nand_w_cache[pos].secbitmap = secbitmap;
-		nand_w_cache[pos].access_count = g_w_access_cnt;
-
+		_flush_w_cache_entry(c);
+		c->hit_page = page;
+		c->secbitmap = 0;
 	}
 
+	MEMCPY(c->data + 512 * _get_first_valid_bit(secbitmap),pdata, 512 * _get_valid_bits(secbitmap));
+	c->secbitmap |= secbitmap;
+	c->access_count = g_w_access_cnt;
+
 	if (g_w_access_cnt == 0)
 	{
-		for (i = 0; i < N_NAND_W_CACHE; i++)
+		for (i = 0; i < n_nand_w_cache; i++)
 			nand_w_cache[i].access_count = 0;
 		g_w_access_cnt = 1;
-		nand_w_cache[pos].access_count = g_w_access_cnt;
+		c->access_count = g_w_access_cnt;
 	}
 
 	return 0;
@@ -345,9 +474,8 @@ __s32 NAND_CacheWrite(__u32 blk, __u32 nblk, void *buf)
 	__u32	nSector,StartSec;
 	__u32	page;
 	__u32	SecBitmap,SecWithinPage;
-	__u32	i;
+	__nand_cache_t *c;
 	__u8 	*pdata;
-	//__u32  hit = 0;
 
 	nSector 	= nblk;
 	StartSec 	= blk;
@@ -355,6 +483,11 @@ __s32 NAND_CacheWrite(__u32 blk, __u32 nblk, void *buf)
 	page 		= 0xffffffff;
 	pdata		= (__u8 *)buf;
 
+	/*the read-ahead pages would go stale*/
+	if (nand_ra.end > blk / SECTOR_CNT_OF_LOGIC_PAGE &&
+	    nand_ra.start <= (blk + nblk - 1) / SECTOR_CNT_OF_LOGIC_PAGE)
+		_ra_drop();
+
 	/*combind sectors to pages*/
 	while(nSector)
 	{
@@ -370,21 +503,16 @@ __s32 NAND_CacheWrite(__u32 blk, __u32 nblk, void *buf)
 			if(SecBitmap == FULL_BITMAP_OF_LOGIC_PAGE)
 			{
 				/*disable write cache with current page*/
-				for (i = 0; i < N_NAND_W_CACHE; i++)
+				c = _w_cache_find(page);
+				if (c)
 				{
-					if(nand_w_cache[i].hit_page == page)
-					{
-						nand_w_cache[i].hit_page = 0xffffffff;
-						nand_w_cache[i].secbitmap = 0;
-						//hit=1;
-					}
-					else if((nand_w_cache[i].hit_page == page-1)&&(page>0))
-					{
-					    _flush_w_cache_simple(i);
-					}
-
-
+					c->hit_page = 0xffffffff;
+					c->secbitmap = 0;
+					c->access_count = 0;
 				}
+				/*keep the log block in order: the previous page goes first*/
+				if (page > 0 && (c = _w_cache_find(page - 1)))
+					_flush_w_cache_entry(c);
 				/*disable read cache with current page*/
 				if (nand_r_cache.hit_page == page){
 					nand_r_cache.hit_page = 0xffffffff;
@@ -425,7 +553,14 @@ __s32 NAND_CacheOpen(void)
 
 	g_w_access_cnt = 0;
 
-	for(i = 0; i < N_NAND_W_CACHE; i++)
+	if (!w_cache_sets || (w_cache_sets & (w_cache_sets - 1)))
+		w_cache_sets = 8;
+	n_nand_w_cache = w_cache_sets * NAND_W_CACHE_WAYS;
+	nand_w_cache = MALLOC(n_nand_w_cache * sizeof(__nand_cache_t));
+	if (!nand_w_cache)
+		return -1;
+
+	for(i = 0; i < n_nand_w_cache; i++)
 	{
 		nand_w_cache[i].size = 512 * SECTOR_CNT_OF_LOGIC_PAGE;
 		nand_w_cache[i].data = MALLOC(nand_w_cache[i].size);
@@ -440,6 +575,26 @@ __s32 NAND_CacheOpen(void)
 	nand_r_cache.secbitmap = 0;
 	nand_r_cache.access_count = 0;
 
+	memset(&nand_ra, 0, sizeof(nand_ra));
+	if (ra_max)
+	{
+		nand_ra.data = MALLOC(ra_max * sizeof(__u8 *));
+		for (i = 0; nand_ra.data && i < ra_max; i++)
+		{
+			nand_ra.data[i] = MALLOC(512 * SECTOR_CNT_OF_LOGIC_PAGE);
+			if (!nand_ra.data[i])
+				break;
+		}
+		/*read-ahead is optional, go on without it*/
+		if (nand_ra.data && i < ra_max)
+		{
+			while (i--)
+				FREE(nand_ra.data[i], 512 * SECTOR_CNT_OF_LOGIC_PAGE);
+			FREE(nand_ra.data, ra_max * sizeof(__u8 *));
+			nand_ra.data = NULL;
+		}
+	}
+
 	return 0;
 }
 
@@ -450,9 +605,20 @@ __s32 NAND_CacheClose(void)
 	NAND_CacheFlush();
 
 	#ifdef NAND_W_CACHE_EN
-		for(i = 0; i < N_NAND_W_CACHE; i++)
+		for(i = 0; i < n_nand_w_cache; i++)
 			FREE(nand_w_cache[i].data,nand_w_cache[i].size);
+		FREE(nand_w_cache, n_nand_w_cache * sizeof(__nand_cache_t));
+		nand_w_cache = NULL;
+		n_nand_w_cache = 0;
 	#endif
 	FREE(nand_r_cache.data,nand_r_cache.size);
+
+	if (nand_ra.data)
+	{
+		for (i = 0; i < ra_max; i++)
+			FREE(nand_ra.data[i], 512 * SECTOR_CNT_OF_LOGIC_PAGE);
+		FREE(nand_ra.data, ra_max * sizeof(__u8 *));
+		nand_ra.data = NULL;
+	}
 	return 0;
 }
@@ -32,6 +32,15 @@ static struct __GlobalLogicPageType_t  CachePage;
 //define the parameter for manage the logical page read and write
 static struct __LogicCtlPar_t LogicalCtl;
 
+//define the bitmap of the logical pages whose data has been discarded, kept in ram only
+static __u32 *DiscardBitmap;
+static __u32 DiscardPageCnt;
+
+/* all super block erases done through the logic layer */
+static unsigned int erase_cnt;
+module_param(erase_cnt, uint, 0444);
+MODULE_PARM_DESC(erase_cnt, "NAND super block erases since load");
+
 
 
 /*
@@ -628,6 +637,8 @@ __s32 LML_VirtualBlkErase(__u32 nZone, __u32 nSuperBlk)
     __s32 i, result = 0;
     struct __PhysicOpPara_t tmpPhyBlk;
 
+    erase_cnt++;
+
     #if CFG_SUPPORT_WEAR_LEVELLING
 
     //increase the erase counter of super block
@@ -740,6 +751,9 @@ __s32 LML_PageRead(__u32 nPage, __u32 nBitmap, void* pBuf)
     struct __LogicPageType_t tmpLogicPage;
     struct __PhysicOpPara_t tmpPhyPage;
     struct __LogBlkType_t tmpLogBlk;
+    #if CFG_SUPPORT_READ_RECLAIM
+    __u32 tmpBitCnt, tmpBitLimit;
+    #endif
 
     _CalculateLogicPagePar(&tmpLogicPage, nPage, nBitmap);
 
@@ -823,6 +837,11 @@ __s32 LML_PageRead(__u32 nPage, __u32 nBitmap, void* pBuf)
     tmpPhyPage.MDataPtr = pBuf;
     tmpPhyPage.SDataPtr = NULL;
 
+    #if CFG_SUPPORT_READ_RECLAIM
+    //clear the ecc bit count of the reads done by other modules
+    PHY_GetEccBitCnt(NULL);
+    #endif
+
     //get data from physical page with the physical operation
     result = LML_VirtualPageRead(&tmpPhyPage);
     if(result < 0)
@@ -831,6 +850,16 @@ __s32 LML_PageRead(__u32 nPage, __u32 nBitmap, void* pBuf)
         return -1;
     }
 
+    #if CFG_SUPPORT_READ_RECLAIM
+    tmpBitCnt = PHY_GetEccBitCnt(&tmpBitLimit);
+    if(result == ECC_LIMIT)
+    {
+        //the page may be read by read-retry, its bit count is not known
+        tmpBitCnt = tmpBitLimit;
+    }
+    LML_ReadReclaimCheck(tmpLogicPage.ZoneNum, tmpLogicPage.BlockNum, tmpBitCnt, tmpBitLimit);
+    #endif
+
     return result;
 }
 
@@ -870,6 +899,12 @@ __s32 LML_PageWrite(__u32 nPage, __u32 nBitmap, void* pBuf)
     //calculate the pamater for the logical page
     _CalculateLogicPagePar(&tmpLogicPage, nPage, nBitmap);
 
+    //the page holds valid data again
+    if(DiscardBitmap && (nPage < DiscardPageCnt))
+    {
+        DiscardBitmap[nPage >> 5] &= ~(1 << (nPage & 0x1f));
+    }
+
     //check if access the same zone area as last access
     if(tmpLogicPage.ZoneNum != LogicalCtl.ZoneNum)
     {
@@ -1083,6 +1118,132 @@ __s32 LML_FlushPageCache(void)
 }
 
 
+/*
+************************************************************************************************************************
+*                       NAND FLASH LOGIC MANAGE LAYER DISCARD
+*
+*Description: Mark the logical pages which are fully covered by the sectors as discarded, so
+*             the merge need not copy their data.
+*
+*Arguments  : nSectNum      the number of the first sector which is discarded;
+*             nSectorCnt    the count of the sectors which are discarded.
+*
+*Return     : discard result;
+*               = 0     discard successful;
+*               = -1    discard failed.
+*
+*Notes      : the bitmap is not saved to nand flash, a discarded page which has not been
+*             merged yet keeps its old data after power on, which is allowed for discard.
+************************************************************************************************************************
+*/
+__s32 LML_Discard(__u32 nSectNum, __u32 nSectorCnt)
+{
+    __u32   tmpPage, tmpEndPage;
+
+    if(!DiscardBitmap || !nSectorCnt)
+    {
+        return 0;
+    }
+
+    if(((nSectNum + nSectorCnt) > LogicalCtl.DiskCap) || (nSectNum + nSectorCnt < nSectNum))
+    {
+        LOGICCTL_ERR("[LOGICCTL_ERR] LML_Discard, discard beyond disk, sector 0x%x, count 0x%x\n", nSectNum, nSectorCnt);
+        return -1;
+    }
+
+    //the cached page may be one of the discarded pages, write it first
+    if(LML_FlushPageCache() < 0)
+    {
+        return -1;
+    }
+
+    //only the whole logical pages can be discarded
+    tmpPage = (nSectNum + SECTOR_CNT_OF_LOGIC_PAGE - 1) / SECTOR_CNT_OF_LOGIC_PAGE;
+    tmpEndPage = (nSectNum + nSectorCnt) / SECTOR_CNT_OF_LOGIC_PAGE;
+
+    for(; (tmpPage < tmpEndPage) && (tmpPage < DiscardPageCnt); tmpPage++)
+    {
+        DiscardBitmap[tmpPage >> 5] |= 1 << (tmpPage & 0x1f);
+    }
+
+    return 0;
+}
+
+
+/*
+************************************************************************************************************************
+*                       CHECK IF THE LOGICAL PAGE IS DISCARDED
+*
+*Description: Check if the data of the logical page has been discarded.
+*
+*Arguments  : nZone     the number of the zone which the logical block belonged to;
+*             nBlk      the number of the logical block in the zone;
+*             nPage     the number of the page in the logical block.
+*
+*Return     : = 1   the page is discarded, need not be copied;
+*             = 0   the page holds valid data.
+************************************************************************************************************************
+*/
+__u32 LML_PageDiscarded(__u32 nZone, __u32 nBlk, __u32 nPage)
+{
+    __u32   tmpPage;
+
+    if(!DiscardBitmap)
+    {
+        return 0;
+    }
+
+    tmpPage = (nZone * DATA_BLK_CNT_OF_ZONE + nBlk) * PAGE_CNT_OF_LOGIC_BLK + nPage;
+    if(tmpPage >= DiscardPageCnt)
+    {
+        return 0;
+    }
+
+    return (DiscardBitmap[tmpPage >> 5] >> (tmpPage & 0x1f)) & 1;
+}
+
+
+/*
+************************************************************************************************************************
+*                       NAND FLASH LOGIC MANAGE LAYER BACKGROUND MERGE
+*
+*Description: Merge one log block of the zone accessed last time ahead of the writes which
+*             would need it, the caller holds the nand ops lock and calls it when idle.
+*
+*Arguments  : nFreeMark     the count of the empty log items that should be kept.
+*
+*Return     : merge result;
+*               = 1     a log block has been merged;
+*               = 0     nothing to do;
+*               = -1    merge failed.
+************************************************************************************************************************
+*/
+__s32 LML_BackgroundMerge(__u32 nFreeMark)
+{
+    __s32   result;
+
+    //no zone has been accessed yet
+    if(LogicalCtl.ZoneNum == 0xff)
+    {
+        return 0;
+    }
+
+    result = LML_FlushPageCache();
+    if(result < 0)
+    {
+        LOGICCTL_ERR("[LOGICCTL_ERR] Flush page cache failed when do background merge! Error:0x%x\n", result);
+        return -1;
+    }
+
+    result = BMM_MergeLogBlkAhead(nFreeMark);
+
+    //the log block of the logical block accessed last time may have been merged
+    LogicalCtl.LogicBlkNum = 0xffff;
+
+    return result;
+}
+
+
 /*
 ************************************************************************************************************************
 *                           NAND FLASH LOGIC MANAGE LAYER READ
@@ -1382,6 +1543,21 @@ __s32 LML_Init(void)
     //request buffer for process spare area data
     MEMSET(LML_SPARE_BUF, 0xff, SECTOR_CNT_OF_SUPER_PAGE * 4);
 
+    //request the discard bitmap, discard is ignored if there is no memory for it
+    DiscardPageCnt = LogicalCtl.DiskCap / SECTOR_CNT_OF_LOGIC_PAGE;
+    DiscardBitmap = (__u32 *)MALLOC((DiscardPageCnt + 31) / 32 * sizeof(__u32));
+    if(DiscardBitmap)
+    {
+        MEMSET(DiscardBitmap, 0, (DiscardPageCnt + 31) / 32 * sizeof(__u32));
+    }
+    else
+    {
+        LOGICCTL_ERR("[LOGICCTL_ERR] Request memory for discard bitmap failed, discard is disabled!\n");
+    }
+
+    //the read-reclaim queue is disabled if there is no memory for the ecc history
+    LML_ReadReclaimInit((DiscardPageCnt + PAGE_CNT_OF_LOGIC_BLK - 1) / PAGE_CNT_OF_LOGIC_BLK);
+
     //init the mapping tabel manage module
     result = BMM_InitMapTblCache();
     if(result < 0)
@@ -1428,10 +1604,21 @@ __s32 LML_Exit(void)
 
     FREE(NandDriverInfo.PageCachePool->PageCache1,SECTOR_CNT_OF_LOGIC_PAGE * SECTOR_SIZE);
 	FREE(NandDriverInfo.PageCachePool->PageCache2,SECTOR_CNT_OF_LOGIC_PAGE * SECTOR_SIZE);
+    if(DiscardBitmap)
+    {
+        FREE(DiscardBitmap, (DiscardPageCnt + 31) / 32 * sizeof(__u32));
+        DiscardBitmap = NULL;
+    }
+    LML_ReadReclaimExit();
 
     return 0;
 }
 
+__u32 LML_GetEraseCnt(void)
+{
+    return erase_cnt;
+}
+
 // 2010-12-04 modified
 __u32 NAND_GetDiskSize(void)
 {
@@ -98,9 +98,12 @@ __s32 PMM_InitMapTblCache(void)
 
     PAGE_MAP_CACHE_POOL = &PageMapTblCachePool;
 
+    MEMSET(PAGE_MAP_CACHE_POOL->PageMapTblIndex, 0xff, sizeof(PAGE_MAP_CACHE_POOL->PageMapTblIndex));
+    PAGE_MAP_CACHE_POOL->AccessTimer = 0;
+
     for(i = 0; i<PAGE_MAP_TBL_CACHE_CNT; i++)
     {
-        PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessCnt = 0;
+        PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessStamp = 0;
         PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].DirtyFlag = 0;
         PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].LogBlkPst = 0xff;
         PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].ZoneNum = 0xff;
@@ -120,7 +123,8 @@ __s32 PMM_InitMapTblCache(void)
 ************************************************************************************************************************
 *                      CALCUALTE PAGE MAPPING TABLE ACCESS COUNT
 *
-*Description: Calculate page mapping table access count for table cache switch.
+*Description: Calculate page mapping table access count for table cache switch, stamp the
+*             current table with the access timer instead of aging every table in the pool.
 *
 *Arguments  : none.
 *
@@ -129,14 +133,7 @@ __s32 PMM_InitMapTblCache(void)
 */
 static void _CalPageTblAccessCount(void)
 {
-    __u32   i;
-
-    for(i=0; i<PAGE_MAP_TBL_CACHE_CNT; i++)
-    {
-        PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessCnt++;
-    }
-
-    PAGE_MAP_CACHE->AccessCnt = 0;
+    PAGE_MAP_CACHE->AccessStamp = ++PAGE_MAP_CACHE_POOL->AccessTimer;
 }
 
 
@@ -170,19 +167,22 @@ __s32 PMM_ExitMapTblCache(void)
 static __s32 _page_map_tbl_cache_hit(__u32 nLogBlkPst)
 {
     __u32 i;
+    struct __PageMapTblCache_t *cache;
 
-    for(i=0; i<PAGE_MAP_TBL_CACHE_CNT; i++)
-    {
-        if((PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].ZoneNum == CUR_MAP_ZONE)\
-            && (PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].LogBlkPst == nLogBlkPst))
-        {
+    /*the index is only a hint, tables dropped by merge or write back are caught by the tag check*/
+    i = PAGE_MAP_CACHE_POOL->PageMapTblIndex[CUR_MAP_ZONE][nLogBlkPst];
+    if (i >= PAGE_MAP_TBL_CACHE_CNT)
+        return NAND_OP_FALSE;
 
-            PAGE_MAP_CACHE = &(PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i]);
-            return NAND_OP_TRUE;
-        }
+    cache = &(PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i]);
+    if ((cache->ZoneNum != CUR_MAP_ZONE) || (cache->LogBlkPst != nLogBlkPst))
+    {
+        PAGE_MAP_CACHE_POOL->PageMapTblIndex[CUR_MAP_ZONE][nLogBlkPst] = 0xffff;
+        return NAND_OP_FALSE;
     }
 
-    return NAND_OP_FALSE;
+    PAGE_MAP_CACHE = cache;
+    return NAND_OP_TRUE;
 
 }
 
@@ -190,31 +190,25 @@ static __s32 _page_map_tbl_cache_hit(__u32 nLogBlkPst)
 static __u32 _find_page_tbl_post_location(void)
 {
     __u32   i, location = 0;
-    __u16   access_cnt;
+    __u32   age, oldest = 0;
 
-    /*try to find clear cache*/
     for(i=0; i<PAGE_MAP_TBL_CACHE_CNT; i++)
     {
+        /*try to find clear cache*/
         if(PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].ZoneNum == 0xff)
         {
             return i;
         }
-    }
 
-    /*try to find least used cache recently*/
-    access_cnt = PAGE_MAP_CACHE_POOL->PageMapTblCachePool[0].AccessCnt;
-
-    for (i = 1; i < PAGE_MAP_TBL_CACHE_CNT; i++){
-        if (access_cnt < PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessCnt){
+        /*try to find least used cache recently*/
+        age = PAGE_MAP_CACHE_POOL->AccessTimer - PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessStamp;
+        if (age >= oldest)
+        {
             location = i;
-            access_cnt = PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessCnt;
+            oldest = age;
         }
     }
 
-    /*clear access counter*/
-    for (i = 0; i < PAGE_MAP_TBL_CACHE_CNT; i++)
-        PAGE_MAP_CACHE_POOL->PageMapTblCachePool[i].AccessCnt = 0;
-
     return location;
 
 }
@@ -328,6 +322,10 @@ static __s32 _rebuild_page_map_tbl(__u32 nLogBlkPst)
         //status = UserData[0].PageStatus;
         logicpagenum = UserData[0].LogicPageNum;
 
+        /*log pages are programmed in order, nothing is mapped past the first erased page*/
+        if ((UserData[0].PageStatus == 0xff) && (logicpagenum == 0xffff))
+            break;
+
         //if(((!TablePage || (status == 0x55))) && (logicpagenum != 0xffff) && (logicpagenum < PAGE_CNT_OF_SUPER_BLK)) /*legal page*/
 		if((logicpagenum != 0xffff) && (logicpagenum < PAGE_CNT_OF_SUPER_BLK)) /*legal page*/
 		{
@@ -412,7 +410,7 @@ static __s32 _read_page_map_tbl(__u32 nLogBlkPst)
 /*post current zone map table in cache*/
 static __s32 _page_map_tbl_cache_post(__u32 nLogBlkPst)
 {
-    __u8 poisition;
+    __u32 poisition;
     __u8 i;
 
     struct __BlkMapTblCache_t *TmpBmt = BLK_MAP_CACHE;
@@ -460,6 +458,7 @@ static __s32 _page_map_tbl_cache_post(__u32 nLogBlkPst)
 
     PAGE_MAP_CACHE->ZoneNum = CUR_MAP_ZONE;
     PAGE_MAP_CACHE->LogBlkPst = nLogBlkPst;
+    PAGE_MAP_CACHE_POOL->PageMapTblIndex[CUR_MAP_ZONE][nLogBlkPst] = poisition;
 
     return NAND_OP_TRUE;
 }
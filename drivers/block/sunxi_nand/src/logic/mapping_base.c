@@ -351,6 +351,108 @@ __s32 BMM_SetLogBlk(__u32 nLogicBlk, struct __LogBlkType_t *pLogBlk)
 }
 
 
+/*
+************************************************************************************************************************
+*                       GET POSITION OF THE LOG BLOCK TO MERGE
+*
+*Description: Choose the log block which should be merged to make an empty log item, a full
+*             log block is prefered, else the log block which is accessed least recently.
+*
+*Arguments  : none.
+*
+*Return     : Log block position;
+*               >= 0    the position of the log block in log block table.
+*               = -1    there is no log block;
+************************************************************************************************************************
+*/
+static __s32 _GetMergeLogPst(void)
+{
+    __s32   i, tmpPst = -1;
+    __u16   tmpLogAccessAge = 0xffff;
+
+    //check if there is some full log block
+    for(i=0; i<LOG_BLK_CNT_OF_ZONE; i++)
+    {
+        if((LOG_BLK_TBL[i].LogicBlkNum != 0xffff) && (LOG_BLK_TBL[i].LastUsedPage == PAGE_CNT_OF_SUPER_BLK-1))
+        {
+            return i;
+        }
+    }
+
+    //there is no full log block, look for an oldest log block to merge
+    for(i=0; i<LOG_BLK_CNT_OF_ZONE; i++)
+    {
+        if((LOG_BLK_TBL[i].LogicBlkNum != 0xffff) && (LOG_ACCESS_AGE[i] < tmpLogAccessAge))
+        {
+            tmpLogAccessAge = LOG_ACCESS_AGE[i];
+            tmpPst = i;
+        }
+    }
+
+    return tmpPst;
+}
+
+
+/*
+************************************************************************************************************************
+*                       MERGE A LOG BLOCK AHEAD OF TIME
+*
+*Description: Merge one log block of the current zone if there are fewer empty items than
+*             required in the log block table, so a later write need not merge in line.
+*
+*Arguments  : nFreeMark     the count of the empty log items that should be kept.
+*
+*Return     : merge result;
+*               = 1     a log block has been merged;
+*               = 0     there are enough empty log items, nothing to do;
+*               =-1     merge log block failed.
+************************************************************************************************************************
+*/
+__s32 BMM_MergeLogBlkAhead(__u32 nFreeMark)
+{
+    __s32   i, result, tmpPst;
+    __u32   tmpFreeCnt = 0;
+
+    for(i=0; i<LOG_BLK_CNT_OF_ZONE; i++)
+    {
+        if(LOG_BLK_TBL[i].LogicBlkNum == 0xffff)
+        {
+            tmpFreeCnt++;
+        }
+    }
+
+    if(tmpFreeCnt >= nFreeMark)
+    {
+        return 0;
+    }
+
+    tmpPst = _GetMergeLogPst();
+    if(tmpPst < 0)
+    {
+        return 0;
+    }
+
+    //the block mapping table will be modified by the merge
+    BMM_SetDirtyFlag();
+
+    result = PMM_SwitchMapTbl(tmpPst);
+    if(result < 0)
+    {
+        MAPPING_ERR("[MAPPING_ERR] Switch page mapping table failed when merge log block ahead! Err:0x%x\n", result);
+        return -1;
+    }
+
+    result = LML_MergeLogBlk(NORMAL_MERGE_MODE, LOG_BLK_TBL[tmpPst].LogicBlkNum);
+    if(result < 0)
+    {
+        MAPPING_ERR("[MAPPING_ERR] Merge log block failed when merge log block ahead! Err:0x%x\n", result);
+        return -1;
+    }
+
+    return 1;
+}
+
+
 /*
 ************************************************************************************************************************
 *                       CREATE A NEW LOG BLOCK
@@ -368,7 +470,6 @@ __s32 BMM_SetLogBlk(__u32 nLogicBlk, struct __LogBlkType_t *pLogBlk)
 static __s32 _CreateNewLogBlk(__u32 nBlk, __u32 *pLogPst)
 {
     __s32   i, result, tmpPst=-1;
-    __u16   tmpLogAccessAge = 0xffff;
     struct __SuperPhyBlkType_t tmpFreeBlk;
     struct __PhysicOpPara_t tmpPhyPage;
     struct __NandUserData_t tmpSpare[2];
@@ -396,28 +497,7 @@ static __s32 _CreateNewLogBlk(__u32 nBlk, __u32 *pLogPst)
     //there is no empty item in the log block table, need merge a log block
     if(tmpPst == -1)
     {
-        //check if there is some full log block
-        for(i=0; i<LOG_BLK_CNT_OF_ZONE; i++)
-        {
-            if(LOG_BLK_TBL[i].LastUsedPage == PAGE_CNT_OF_SUPER_BLK-1)
-            {
-                tmpPst = i;
-                break;
-            }
-        }
-
-        if(tmpPst == -1)
-        {
-            //there is no full log block, look for an oldest log block to merge
-            for(i=0; i<LOG_BLK_CNT_OF_ZONE; i++)
-            {
-                if(LOG_ACCESS_AGE[i] < tmpLogAccessAge)
-                {
-                    tmpLogAccessAge = LOG_ACCESS_AGE[i];
-                    tmpPst = i;
-                }
-            }
-        }
+        tmpPst = _GetMergeLogPst();
 
         //switch the page mapping table for merge the log block
         result = PMM_SwitchMapTbl(tmpPst);
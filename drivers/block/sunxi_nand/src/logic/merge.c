@@ -20,10 +20,16 @@
  * MA 02111-1307 USA
  */
 
+#include <linux/module.h>
 #include "../include/nand_logic.h"
 
 extern struct __NandDriverGlobal_t     NandDriverInfo;
 
+/* all log block merges, foreground and background */
+static unsigned int merge_cnt;
+module_param(merge_cnt, uint, 0444);
+MODULE_PARM_DESC(merge_cnt, "NAND log block merges since load");
+
 __s32 _copy_page0(__u32 SrcBlk,__u16 SrcDataPage,__u32 DstBlk,__u8 SeqPlus)
 {
     __u8 seq;
@@ -89,6 +95,10 @@ __s32  _log2data_swap_merge(__u32 nlogical)
 
     /*copy data from data block to log block*/
     for (SuperPage = LastUsedPage + 1; SuperPage < PAGE_CNT_OF_SUPER_BLK; SuperPage++){
+        /*discarded data need not be copied, page 0 carries the block info*/
+        if (SuperPage && LML_PageDiscarded(CUR_MAP_ZONE, nlogical, SuperPage))
+            continue;
+
         /*set source and destinate address*/
         LML_CalculatePhyOpPar(&SrcParam,CUR_MAP_ZONE, DataBlk.PhyBlkNum, SuperPage);
         LML_CalculatePhyOpPar(&DstParam,CUR_MAP_ZONE, LogBlk.PhyBlk.PhyBlkNum, SuperPage);
@@ -353,6 +363,10 @@ __s32  _free2data_simple_merge(__u32 nlogical)
     /*copy data from data block or log block to free block*/
     for (SuperPage = 0; SuperPage < PAGE_CNT_OF_LOGIC_BLK; SuperPage++)
     {
+        /*discarded data need not be copied, page 0 carries the block info*/
+        if (SuperPage && LML_PageDiscarded(CUR_MAP_ZONE, nlogical, SuperPage))
+            continue;
+
         /*set source address and destination address*/
         DstPage = SuperPage;
         DstBlk = FreeBlk.PhyBlkNum;
@@ -479,22 +493,37 @@ void _get_page_map_tbl_info(__u32 nlogical,__u8 *InOrder, __u16 *nValidPage)
 *               = -1    do bad block manage failed.
 ************************************************************************************************************************
 */
+__u32 LML_GetMergeCnt(void)
+{
+    return merge_cnt;
+}
+
+
 __s32 LML_MergeLogBlk(__u32 nMode, __u32 nlogical)
 {
     __u8 InOrder;
     __u16 nValidPage;
+    __s32 result;
 
+    merge_cnt++;
     _get_page_map_tbl_info(nlogical,&InOrder,&nValidPage);
 
     if (InOrder)
-        return (_log2data_swap_merge(nlogical));
+        result = _log2data_swap_merge(nlogical);
     else{
+        /*move merge keeps the data block, so it does not finish a read-reclaim*/
         if ( (nMode == SPECIAL_MERGE_MODE) && (nValidPage < PAGE_CNT_OF_SUPER_BLK/(INTERLEAVE_BANK_CNT+1)))
             return (_free2log_move_merge(nlogical));
         else
-            return (_free2data_simple_merge(nlogical));
+            result = _free2data_simple_merge(nlogical);
     }
 
+    #if CFG_SUPPORT_READ_RECLAIM
+    if (result == NAND_OP_TRUE)
+        LML_ReadReclaimReset(CUR_MAP_ZONE, nlogical);
+    #endif
+
+    return result;
 }
 
 
@@ -20,10 +20,22 @@
  * MA 02111-1307 USA
  */
 
+#include <linux/module.h>
 #include "../include/nand_logic.h"
 
 extern struct __NandDriverGlobal_t     NandDriverInfo;
 
+#define RECLAIM_QUEUE_LEN       32
+
+static unsigned int rr_threshold = 60;
+module_param(rr_threshold, uint, 0644);
+MODULE_PARM_DESC(rr_threshold, "Queue a block for read-reclaim once a read from it corrects this percent of the ECC limit (0 disables)");
+
+static __u8 *EccHistory;                                //the worst corrected bit count read from every logical block
+static __u32 EccHistoryCnt;                             //the count of the logical blocks in the history
+static struct __ReclaimItem_t ReclaimQueue[RECLAIM_QUEUE_LEN];  //the read-reclaim queue, a max-heap on the bit count
+static struct __ReclaimStat_t ReclaimStat;
+
 /*
 ************************************************************************************************************************
 *                       NAND FLASH LOGIC MANAGE LAYER READ-RECLAIM
@@ -78,3 +90,364 @@ __s32 LML_ReadReclaim(__u32 nPage)
 }
 
 
+static void _SwapReclaimItem(__u32 nPst0, __u32 nPst1)
+{
+    struct __ReclaimItem_t tmpItem;
+
+    tmpItem = ReclaimQueue[nPst0];
+    ReclaimQueue[nPst0] = ReclaimQueue[nPst1];
+    ReclaimQueue[nPst1] = tmpItem;
+}
+
+
+static void _SiftUpReclaimItem(__u32 nPst)
+{
+    while(nPst && (ReclaimQueue[(nPst - 1) / 2].BitCnt < ReclaimQueue[nPst].BitCnt))
+    {
+        _SwapReclaimItem(nPst, (nPst - 1) / 2);
+        nPst = (nPst - 1) / 2;
+    }
+}
+
+
+static void _SiftDownReclaimItem(__u32 nPst)
+{
+    __u32 tmpChild;
+
+    while((tmpChild = nPst * 2 + 1) < ReclaimStat.QueueLen)
+    {
+        if((tmpChild + 1 < ReclaimStat.QueueLen) && (ReclaimQueue[tmpChild + 1].BitCnt > ReclaimQueue[tmpChild].BitCnt))
+        {
+            tmpChild++;
+        }
+
+        if(ReclaimQueue[tmpChild].BitCnt <= ReclaimQueue[nPst].BitCnt)
+        {
+            break;
+        }
+
+        _SwapReclaimItem(nPst, tmpChild);
+        nPst = tmpChild;
+    }
+}
+
+
+static void _RemoveReclaimItem(__u32 nPst)
+{
+    ReclaimStat.QueueLen--;
+    if(nPst == ReclaimStat.QueueLen)
+    {
+        return;
+    }
+
+    ReclaimQueue[nPst] = ReclaimQueue[ReclaimStat.QueueLen];
+    _SiftDownReclaimItem(nPst);
+    _SiftUpReclaimItem(nPst);
+}
+
+
+static __s32 _FindReclaimItem(__u32 nZone, __u32 nBlk)
+{
+    __u32 i;
+
+    for(i=0; i<ReclaimStat.QueueLen; i++)
+    {
+        if((ReclaimQueue[i].ZoneNum == nZone) && (ReclaimQueue[i].BlockNum == nBlk))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+/*
+************************************************************************************************************************
+*                       READ-RECLAIM CHECK ECC BIT COUNT
+*
+*Description: Record the ecc corrected bit count of a page read from the logical block, queue the
+*             block for read-reclaim if the count comes near the limit of the ecc.
+*
+*Arguments  : nZone     the number of the zone which the logical block is belonged to;
+*             nBlk      the number of the logical block in the zone;
+*             nBitCnt   the worst count of the bits corrected in one ecc block of the page;
+*             nBitLimit the count of the bits the ecc can correct.
+*
+*Return     : none.
+*
+*Notes      : the block queued with the greatest bit count is rewritten first, if the queue is full,
+*             the block with the least bit count is dropped, its history is not updated, so it can be
+*             queued again by the next read.
+************************************************************************************************************************
+*/
+void LML_ReadReclaimCheck(__u32 nZone, __u32 nBlk, __u32 nBitCnt, __u32 nBitLimit)
+{
+    __u32 i, tmpBlk, tmpMinPst;
+    __s32 tmpPst;
+
+    tmpBlk = nZone * DATA_BLK_CNT_OF_ZONE + nBlk;
+    if(!EccHistory || !rr_threshold || (tmpBlk >= EccHistoryCnt))
+    {
+        return;
+    }
+
+    if(nBitCnt > 0xff)
+    {
+        nBitCnt = 0xff;
+    }
+
+    //the block has been read with the same error level before, nothing new
+    if(nBitCnt <= EccHistory[tmpBlk])
+    {
+        return;
+    }
+
+    ReclaimStat.BitLimit = nBitLimit;
+    if(nBitCnt * 100 < nBitLimit * rr_threshold)
+    {
+        EccHistory[tmpBlk] = nBitCnt;
+        return;
+    }
+
+    //the block is being rewritten now
+    if(ReclaimStat.Cur.BitCnt && (ReclaimStat.Cur.ZoneNum == nZone) && (ReclaimStat.Cur.BlockNum == nBlk))
+    {
+        EccHistory[tmpBlk] = nBitCnt;
+        ReclaimStat.Cur.BitCnt = nBitCnt;
+        return;
+    }
+
+    //the block is in the queue already, raise its priority
+    tmpPst = _FindReclaimItem(nZone, nBlk);
+    if(tmpPst >= 0)
+    {
+        EccHistory[tmpBlk] = nBitCnt;
+        ReclaimQueue[tmpPst].BitCnt = nBitCnt;
+        _SiftUpReclaimItem(tmpPst);
+        return;
+    }
+
+    if(ReclaimStat.QueueLen == RECLAIM_QUEUE_LEN)
+    {
+        //the item with the least bit count is one of the leaves
+        tmpMinPst = RECLAIM_QUEUE_LEN / 2;
+        for(i=tmpMinPst + 1; i<RECLAIM_QUEUE_LEN; i++)
+        {
+            if(ReclaimQueue[i].BitCnt < ReclaimQueue[tmpMinPst].BitCnt)
+            {
+                tmpMinPst = i;
+            }
+        }
+
+        ReclaimStat.Dropped++;
+        if(ReclaimQueue[tmpMinPst].BitCnt >= nBitCnt)
+        {
+            return;
+        }
+
+        EccHistory[ReclaimQueue[tmpMinPst].ZoneNum * DATA_BLK_CNT_OF_ZONE + ReclaimQueue[tmpMinPst].BlockNum] = 0;
+        _RemoveReclaimItem(tmpMinPst);
+    }
+
+    EccHistory[tmpBlk] = nBitCnt;
+    ReclaimQueue[ReclaimStat.QueueLen].ZoneNum = nZone;
+    ReclaimQueue[ReclaimStat.QueueLen].BlockNum = nBlk;
+    ReclaimQueue[ReclaimStat.QueueLen].NextPage = 0;
+    ReclaimQueue[ReclaimStat.QueueLen].BitCnt = nBitCnt;
+    _SiftUpReclaimItem(ReclaimStat.QueueLen++);
+    ReclaimStat.Queued++;
+
+    LOGICCTL_DBG("[LOGICCTL_DBG] read-reclaim queue zone 0x%x block 0x%x, ecc bits %d/%d\n", nZone, nBlk, nBitCnt, nBitLimit);
+}
+
+
+/*
+************************************************************************************************************************
+*                       READ-RECLAIM RESET BLOCK
+*
+*Description: Clear the read-reclaim state of the logical block, because its data has been moved to
+*             a new physical block.
+*
+*Arguments  : nZone     the number of the zone which the logical block is belonged to;
+*             nBlk      the number of the logical block in the zone.
+*
+*Return     : none.
+************************************************************************************************************************
+*/
+void LML_ReadReclaimReset(__u32 nZone, __u32 nBlk)
+{
+    __u32 tmpBlk;
+    __s32 tmpPst;
+
+    tmpBlk = nZone * DATA_BLK_CNT_OF_ZONE + nBlk;
+    if(!EccHistory || (tmpBlk >= EccHistoryCnt))
+    {
+        return;
+    }
+
+    EccHistory[tmpBlk] = 0;
+
+    if(ReclaimStat.Cur.BitCnt && (ReclaimStat.Cur.ZoneNum == nZone) && (ReclaimStat.Cur.BlockNum == nBlk))
+    {
+        ReclaimStat.Cur.BitCnt = 0;
+        ReclaimStat.Done++;
+    }
+
+    tmpPst = _FindReclaimItem(nZone, nBlk);
+    if(tmpPst >= 0)
+    {
+        _RemoveReclaimItem(tmpPst);
+        ReclaimStat.Done++;
+    }
+}
+
+
+/*
+************************************************************************************************************************
+*                       READ-RECLAIM RUN
+*
+*Description: Rewrite some pages of the logical block which has the greatest ecc bit count in the
+*             read-reclaim queue.
+*
+*Arguments  : nPageCnt  the most count of the pages which can be rewritten in this step.
+*
+*Return     : read-reclaim result;
+*               = 1     some pages have been rewritten;
+*               = 0     the queue is empty, nothing to do;
+*               = -1    read-reclaim failed.
+*
+*Notes      : the pages are rewritten to the log block of the logical block, the data block is
+*             released by the next merge, which clears the read-reclaim state of the block.
+************************************************************************************************************************
+*/
+__s32 LML_ReadReclaimRun(__u32 nPageCnt)
+{
+    __s32 result;
+    __u32 tmpPage, tmpFirstPage;
+
+    if(!ReclaimStat.Cur.BitCnt)
+    {
+        if(!ReclaimStat.QueueLen)
+        {
+            return 0;
+        }
+
+        ReclaimStat.Cur = ReclaimQueue[0];
+        _RemoveReclaimItem(0);
+    }
+
+    //flush the page cache to nand flash first, because need use the buffer
+    result = LML_FlushPageCache();
+    if(result < 0)
+    {
+        ReclaimStat.Errors++;
+        return -1;
+    }
+
+    tmpFirstPage = (ReclaimStat.Cur.ZoneNum * DATA_BLK_CNT_OF_ZONE + ReclaimStat.Cur.BlockNum) * PAGE_CNT_OF_LOGIC_BLK;
+    while(nPageCnt && ReclaimStat.Cur.BitCnt && (ReclaimStat.Cur.NextPage < PAGE_CNT_OF_LOGIC_BLK))
+    {
+        tmpPage = ReclaimStat.Cur.NextPage++;
+
+        //the discarded page need not be kept
+        if(LML_PageDiscarded(ReclaimStat.Cur.ZoneNum, ReclaimStat.Cur.BlockNum, tmpPage))
+        {
+            continue;
+        }
+
+        result = LML_PageRead(tmpFirstPage + tmpPage, FULL_BITMAP_OF_LOGIC_PAGE, LML_WRITE_PAGE_CACHE);
+        if(result >= 0)
+        {
+            result = LML_PageWrite(tmpFirstPage + tmpPage, FULL_BITMAP_OF_LOGIC_PAGE, LML_WRITE_PAGE_CACHE);
+        }
+        if(result < 0)
+        {
+            LOGICCTL_ERR("[LOGICCTL_ERR] read-reclaim rewrite page 0x%x failed! Error:0x%x\n", tmpFirstPage + tmpPage, result);
+            ReclaimStat.Cur.BitCnt = 0;
+            ReclaimStat.Errors++;
+            return -1;
+        }
+
+        ReclaimStat.Pages++;
+        nPageCnt--;
+    }
+
+    //all the pages are rewritten, a merge in the middle finishes the block too
+    if(ReclaimStat.Cur.BitCnt && (ReclaimStat.Cur.NextPage >= PAGE_CNT_OF_LOGIC_BLK))
+    {
+        EccHistory[tmpFirstPage / PAGE_CNT_OF_LOGIC_BLK] = 0;
+        ReclaimStat.Cur.BitCnt = 0;
+        ReclaimStat.Done++;
+    }
+
+    return 1;
+}
+
+
+__u32 LML_ReadReclaimPending(void)
+{
+    return ReclaimStat.QueueLen + (ReclaimStat.Cur.BitCnt ? 1 : 0);
+}
+
+
+/*
+************************************************************************************************************************
+*                       READ-RECLAIM GET STATE
+*
+*Description: Get the statistic of the read-reclaim and the item in the read-reclaim queue.
+*
+*Arguments  : pStat     the pointer to the statistic, may be NULL;
+*             nIndex    the index of the item in the queue;
+*             pItem     the pointer to the item, may be NULL.
+*
+*Return     : = 0       get state successful;
+*             = -1      the index is beyond the queue.
+************************************************************************************************************************
+*/
+__s32 LML_ReadReclaimState(struct __ReclaimStat_t *pStat, __u32 nIndex, struct __ReclaimItem_t *pItem)
+{
+    if(pStat)
+    {
+        *pStat = ReclaimStat;
+    }
+
+    if(nIndex >= ReclaimStat.QueueLen)
+    {
+        return -1;
+    }
+
+    if(pItem)
+    {
+        *pItem = ReclaimQueue[nIndex];
+    }
+
+    return 0;
+}
+
+
+__s32 LML_ReadReclaimInit(__u32 nBlkCnt)
+{
+    MEMSET(&ReclaimStat, 0, sizeof(struct __ReclaimStat_t));
+
+    EccHistoryCnt = nBlkCnt;
+    EccHistory = (__u8 *)MALLOC(EccHistoryCnt);
+    if(!EccHistory)
+    {
+        LOGICCTL_ERR("[LOGICCTL_ERR] Request memory for ecc history failed, read-reclaim queue is disabled!\n");
+        return -1;
+    }
+    MEMSET(EccHistory, 0, EccHistoryCnt);
+
+    return 0;
+}
+
+
+void LML_ReadReclaimExit(void)
+{
+    if(EccHistory)
+    {
+        FREE(EccHistory, EccHistoryCnt);
+        EccHistory = NULL;
+    }
+}
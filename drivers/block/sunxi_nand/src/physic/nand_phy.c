@@ -767,15 +767,24 @@ __s32 _read_sectors(struct boot_physical_param *readop,__u8 dma_wait_mode)
 /*********************************************************************
 **************************two plane read operation***********************
 ***********************************************************************/
+/*
+ * Load every plane with one 0x60..0x60..0x30 sequence, so the array read
+ * time is paid once per super page instead of once per plane, then take
+ * each plane out of its page register with 0x00+5addr and 05/e0 random
+ * data output. Any error falls back to the single plane read from the
+ * failing plane on, which also handles read retry and clear pages.
+ */
 __s32 _two_plane_read(struct __PhysicOpPara_t *pPageAdr,__u8 dma_wait_mode)
 {
 	__u8 addr[2][5];
-	__s32 ret;
+	__u8 sparebuf[4*16];
+	__s32 ret, plane_ret;
 	__u32 chip;
 	__u32 rb;
 	__u32 list_len,i,plane_cnt;
 	__u32 bitmap_in_single_page;
 	__u32 block_in_chip;
+	__u8 *data_buf;
 
 	NFC_CMD_LIST cmd_list[8];
 	struct boot_physical_param readop;
@@ -792,7 +801,9 @@ __s32 _two_plane_read(struct __PhysicOpPara_t *pPageAdr,__u8 dma_wait_mode)
 		PHY_ERR("PHY_PageRead : beyond block of per chip  count\n");
 		return -ERR_INVALIDPHYADDR;
 	}
-	plane_cnt = SUPPORT_MULTI_PROGRAM ? PLANE_CNT_OF_DIE : 1;
+	plane_cnt = PLANE_CNT_OF_DIE;
+	if (plane_cnt > 2)
+		plane_cnt = 2;
 
 	/*create cmd list*/
 	/*send 0x60+3addr - 0x60 + 3addr - 0x30 for samsung 4k page*/
@@ -806,32 +817,93 @@ __s32 _two_plane_read(struct __PhysicOpPara_t *pPageAdr,__u8 dma_wait_mode)
 		cmd_list[i].next = &(cmd_list[i+1]);
 	}
 	rb = _cal_real_rb(chip);
-	NFC_SelectChip(chip);
-	NFC_SelectRb(rb);
 	ret = _wait_rb_ready(chip);
 	if (ret)
 		return ret;
+	NFC_SelectChip(chip);
+	NFC_SelectRb(rb);
 
-	ret = NFC_Read(cmd_list, NULL, NULL, 0,NFC_NORMAL_MODE);
+	/*the copyback read path sends a bare command list and waits for it*/
+	ret = NFC_CopyBackRead(cmd_list);
 
-	/*send 0x00 +5addr --(05+2addr-e0...)*/
-	for (i = 0; i < plane_cnt; i++){
-		/*init single page operation param*/
+	for (i = 0; (i < plane_cnt) && !ret; i++){
+		bitmap_in_single_page = FULL_BITMAP_OF_SINGLE_PAGE &
+			(pPageAdr->SectBitmap >> (i*SECTOR_CNT_OF_SINGLE_PAGE));
+		if (!bitmap_in_single_page)
+			continue;
+
+		/*send 0x00 +5addr --(05+2addr-e0...)*/
+		_cal_addr_in_chip(block_in_chip+i*MULTI_PLANE_BLOCK_OFFSET, pPageAdr->PageNum,0,addr[i],5);
+		_add_cmd_list(cmd_list,0x00,5,addr[i],NFC_NO_DATA_FETCH,NFC_IGNORE,NFC_IGNORE,NFC_NO_WAIT_RB);
+		_add_cmd_list(cmd_list + 1,0x05,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE);
+		_add_cmd_list(cmd_list + 2,0xe0,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE);
+		_add_cmd_list(cmd_list + 3,0x30,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE,NFC_IGNORE);
+		cmd_list[0].next = &(cmd_list[1]);
+		cmd_list[1].next = &(cmd_list[2]);
+		cmd_list[2].next = &(cmd_list[3]);
+
+		if (bitmap_in_single_page == FULL_BITMAP_OF_SINGLE_PAGE)
+			data_buf = (__u8 *)(pPageAdr->MDataPtr) + 512*SECTOR_CNT_OF_SINGLE_PAGE*i;
+		else
+			data_buf = PageCachePool.TmpPageCache;
+
+		if (SUPPORT_RANDOM){
+			NFC_SetRandomSeed(_cal_random_seed(pPageAdr->PageNum));
+			NFC_RandomEnable();
+		}
+		plane_ret = NFC_ReadPlane(cmd_list, data_buf, sparebuf, dma_wait_mode);
+		if (SUPPORT_RANDOM)
+			NFC_RandomDisable();
+		if (plane_ret < 0)
+			break;
+		if (dma_wait_mode)
+			_pending_dma_irq_sem();
+
+		if (data_buf == PageCachePool.TmpPageCache){
+			__u32 k;
+
+			for (k = 0; k < SECTOR_CNT_OF_SINGLE_PAGE; k++){
+				if (bitmap_in_single_page & ((__u64)1 << k))
+					MEMCPY((__u8 *)(pPageAdr->MDataPtr) + 512*(SECTOR_CNT_OF_SINGLE_PAGE*i + k),
+					       data_buf + k*512, 512);
+			}
+		}
+		if (pPageAdr->SDataPtr)
+			MEMCPY((__u8 *)(pPageAdr->SDataPtr) + 4*SECTOR_CNT_OF_SINGLE_PAGE*i, sparebuf, 2 * 4);
+
+		if ((plane_ret == ECC_LIMIT) && !SUPPORT_READ_RETRY)
+			ret = ECC_LIMIT;
+	}
+	NFC_DeSelectChip(chip);
+	NFC_DeSelectRb(rb);
+
+	if (ret < 0)
+		i = 0;
+	if (i == plane_cnt)
+		return ret;
+
+	/*fall back to single plane read for the planes left*/
+	ret = (ret == ECC_LIMIT) ? ECC_LIMIT : 0;
+	for (; i < plane_cnt; i++){
 		readop.chip = chip;
-		readop.block = block_in_chip+ i*MULTI_PLANE_BLOCK_OFFSET;
+		readop.block = block_in_chip + i*MULTI_PLANE_BLOCK_OFFSET;
 		readop.page = pPageAdr->PageNum;
 		readop.mainbuf = (__u8 *)(pPageAdr->MDataPtr) + 512*SECTOR_CNT_OF_SINGLE_PAGE*i;
 		if (pPageAdr->SDataPtr)
 			readop.oobbuf = (__u8 *)(pPageAdr->SDataPtr) + 4*SECTOR_CNT_OF_SINGLE_PAGE*i;
-
+		else
+			readop.oobbuf = NULL;
 
 		bitmap_in_single_page = FULL_BITMAP_OF_SINGLE_PAGE &
 			(pPageAdr->SectBitmap >> (i*SECTOR_CNT_OF_SINGLE_PAGE));
 		readop.sectorbitmap = bitmap_in_single_page;
-		ret |= _read_sectors(&readop,dma_wait_mode);
+		if (!bitmap_in_single_page)
+			continue;
+		if (bitmap_in_single_page == FULL_BITMAP_OF_SINGLE_PAGE)
+			ret |= _read_single_page(&readop,dma_wait_mode);
+		else
+			ret |= _read_sectors(&readop,dma_wait_mode);
 	}
-	NFC_DeSelectChip(chip);
-	NFC_DeSelectRb(rb);
 	return ret;
 }
 /*
@@ -860,7 +932,7 @@ __s32  PHY_PageRead(struct __PhysicOpPara_t *pPageAdr)
 	struct boot_physical_param readop;
 
 	/*create cmd list*/
-	if (SUPPORT_MULTI_READ){
+	if (SUPPORT_MULTI_READ && (PLANE_CNT_OF_DIE > 1)){
 	/*two plane read */
 		ret = _two_plane_read(pPageAdr,SUPPORT_DMA_IRQ);
 		goto PHY_PageRead_exit;
@@ -1687,6 +1759,23 @@ PHY_PageCopyback_exit:
 	return ret;
 }
 
+/*
+************************************************************************************************************************
+*                           GET ECC BIT COUNT
+*
+*Description: get the worst count of the bits corrected in one ecc block by the page reads since
+*             last call, the read-reclaim uses it to find the blocks which are going weak.
+*
+*Arguments  : pBitLimit     return the count of bits the ecc can correct, may be NULL.
+*
+*Return     : the count of the corrected bits.
+************************************************************************************************************************
+*/
+__u32 PHY_GetEccBitCnt(__u32 *pBitLimit)
+{
+	return NFC_GetEccBitCnt(pBitLimit);
+}
+
 __s32 PHY_ScanDDRParam(void)
 {
 	__u32 i, j, k,chip = 0;
@@ -22,12 +22,20 @@
 
 #include "g2d.h"
 #include <linux/clk.h>
+#include <linux/eventfd.h>
 #include <linux/interrupt.h>
+#include <linux/workqueue.h>
 #include <mach/clock.h>
 #include "g2d_driver_i.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/g2d.h>
+
 struct clk *g2d_ahbclk,*g2d_dramclk,*g2d_mclk,*g2d_src;
 extern __g2d_drv_t	 g2d_ext_hd;
+extern __g2d_info_t	 para;
+
+static __u32 g2d_batch_chain_next(void);
 
 /* Arbitrarily pick 240MHz (TODO: confirm what is the real limit) */
 #define G2D_CLOCK_SPEED_LIMIT 240000000
@@ -99,6 +107,9 @@ irqreturn_t g2d_handle_irq(int irq, void *dev_id)
     if(irq_flag & G2D_FINISH_IRQ)
     {
 		mixer_clear_init();
+		/* the next op of a batch run was started right away */
+		if (g2d_batch_chain_next())
+			return IRQ_HANDLED;
 		g2d_ext_hd.finish_flag = 1;
 		wake_up(&g2d_ext_hd.queue);
     }
@@ -137,10 +148,9 @@ int g2d_wait_cmd_finish(void)
 	return 0;
 }
 
-int g2d_blit(g2d_blt * para)
+/* check and clip to the images, returns 1 when nothing is left to do */
+static __s32 g2d_blit_clip(g2d_blt *para)
 {
-	__s32 err = 0;
-
 	/* check the parameter valid */
     if(((para->src_rect.x < 0)&&((-para->src_rect.x) > para->src_rect.w)) ||
        ((para->src_rect.y < 0)&&((-para->src_rect.y) > para->src_rect.h)) ||
@@ -159,7 +169,7 @@ int g2d_blit(g2d_blt * para)
 		if((para->src_rect.w == 0) || (para->src_rect.h == 0))
 		{
 			printk(KERN_DEBUG "User requested g2d blit on zero region\n");
-			return err;
+			return 1;
 		}
 		if(((para->src_rect.x < 0)&&((-para->src_rect.x) < para->src_rect.w)))
 		{
@@ -202,16 +212,28 @@ int g2d_blit(g2d_blt * para)
 		}
 	}
 
+	return 0;
+}
+
+int g2d_blit(g2d_blt * para)
+{
+	__s32 err = g2d_blit_clip(para);
+
+	if (err)
+		return err < 0 ? err : 0;
+
+	trace_g2d_blit(para->flag, para->src_image.format,
+		       para->dst_image.format, para->src_rect.w, para->src_rect.h);
 	g2d_ext_hd.finish_flag = 0;
 	err = mixer_blt(para);
+	trace_g2d_blit_done(err);
 
 	return err;
 }
 
-int g2d_fill(g2d_fillrect * para)
+/* check and clip to the images, returns 1 when nothing is left to do */
+static __s32 g2d_fill_clip(g2d_fillrect *para)
 {
-	__s32 err = 0;
-
 	/* check the parameter valid */
 	if(((para->dst_rect.x < 0)&&((-para->dst_rect.x)>para->dst_rect.w)) ||
 	   ((para->dst_rect.y < 0)&&((-para->dst_rect.y)>para->dst_rect.h)) ||
@@ -226,7 +248,7 @@ int g2d_fill(g2d_fillrect * para)
 		if((para->dst_rect.w == 0) || (para->dst_rect.h == 0))
 		{
 			printk(KERN_DEBUG "User requested g2d fill on zero region\n");
-			return err;
+			return 1;
 		}
 		if(((para->dst_rect.x < 0)&&((-para->dst_rect.x) < para->dst_rect.w)))
 		{
@@ -248,16 +270,25 @@ int g2d_fill(g2d_fillrect * para)
 		}
 	}
 
+	return 0;
+}
+
+int g2d_fill(g2d_fillrect * para)
+{
+	__s32 err = g2d_fill_clip(para);
+
+	if (err)
+		return err < 0 ? err : 0;
+
 	g2d_ext_hd.finish_flag = 0;
 	err = mixer_fillrectangle(para);
 
 	return err;
 }
 
-int g2d_stretchblit(g2d_stretchblt * para)
+/* check and clip to the images, returns 1 when nothing is left to do */
+static __s32 g2d_stretchblit_clip(g2d_stretchblt *para)
 {
-	__s32 err = 0;
-
 	/* check the parameter valid */
     if(((para->src_rect.x < 0)&&((-para->src_rect.x) > para->src_rect.w)) ||
        ((para->src_rect.y < 0)&&((-para->src_rect.y) > para->src_rect.h)) ||
@@ -277,7 +308,7 @@ int g2d_stretchblit(g2d_stretchblt * para)
 		   (para->src_rect.w == 0) || (para->src_rect.h == 0))
 		{
 			printk(KERN_DEBUG "User requested g2d stretchblit on zero region\n");
-			return err;
+			return 1;
 		}
 		if(((para->src_rect.x < 0)&&((-para->src_rect.x) < para->src_rect.w)))
 		{
@@ -318,12 +349,106 @@ int g2d_stretchblit(g2d_stretchblt * para)
 		}
 	}
 
+	return 0;
+}
+
+int g2d_stretchblit(g2d_stretchblt * para)
+{
+	__s32 err = g2d_stretchblit_clip(para);
+
+	if (err)
+		return err < 0 ? err : 0;
+
 	g2d_ext_hd.finish_flag = 0;
 	err = mixer_stretchblt(para);
 
 	return err;
 }
 
+static __u32 g2d_format_tiled(g2d_data_fmt format)
+{
+	return format == G2D_FMT_PYUV420UVC_MB32 ||
+		format == G2D_FMT_PYUV422UVC_MB32;
+}
+
+static void g2d_convert_to_stretch(g2d_convert *para, g2d_stretchblt *stre)
+{
+	memset(stre, 0, sizeof(g2d_stretchblt));
+	stre->flag = G2D_BLT_NONE;
+	stre->src_image = para->src_image;
+	stre->src_rect = para->src_rect;
+	stre->dst_image = para->dst_image;
+	stre->dst_rect = para->dst_rect;
+}
+
+/* check and clip to the images, returns 1 when nothing is left to do */
+static __s32 g2d_convert_clip(g2d_convert *para)
+{
+	g2d_stretchblt stre;
+	__s32 ret;
+
+	if (g2d_format_tiled(para->dst_image.format))
+		return -EINVAL;
+
+	g2d_convert_to_stretch(para, &stre);
+	ret = g2d_stretchblit_clip(&stre);
+	if (ret)
+		return ret;
+	para->src_rect = stre.src_rect;
+	para->dst_rect = stre.dst_rect;
+
+	/* the scaler writeback has no output stride */
+	if (g2d_format_tiled(para->src_image.format) &&
+	    (para->dst_rect.x != 0 || para->dst_rect.w != para->dst_image.w ||
+	     (para->dst_image.format != G2D_FMT_ARGB_AYUV8888 &&
+	      para->dst_image.format != G2D_FMT_XRGB8888))) {
+		printk("invalid tiled convert parameter setting");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static DEFINE_MUTEX(g2d_tiled_lock);
+static int (*g2d_tiled_convert)(g2d_convert *para);
+
+void g2d_set_tiled_convert(int (*func)(g2d_convert *para))
+{
+	mutex_lock(&g2d_tiled_lock);
+	g2d_tiled_convert = func;
+	mutex_unlock(&g2d_tiled_lock);
+}
+EXPORT_SYMBOL(g2d_set_tiled_convert);
+
+/* on a clipped op */
+static __s32 g2d_convert_run(g2d_convert *para)
+{
+	g2d_stretchblt stre;
+	__s32 err;
+
+	if (g2d_format_tiled(para->src_image.format)) {
+		mutex_lock(&g2d_tiled_lock);
+		err = g2d_tiled_convert ? g2d_tiled_convert(para) : -ENODEV;
+		mutex_unlock(&g2d_tiled_lock);
+		return err;
+	}
+
+	g2d_convert_to_stretch(para, &stre);
+	g2d_ext_hd.finish_flag = 0;
+
+	return mixer_stretchblt(&stre);
+}
+
+int g2d_convert(g2d_convert *para)
+{
+	__s32 err = g2d_convert_clip(para);
+
+	if (err)
+		return err < 0 ? err : 0;
+
+	return g2d_convert_run(para);
+}
+
 int g2d_set_palette_table(g2d_palette *para)
 {
 
@@ -338,3 +463,400 @@ int g2d_set_palette_table(g2d_palette *para)
 	return 0;
 }
 
+/*
+ * Batched submission. G2D_CMD_BATCH checks and copies a list of ops into
+ * g2d_ring and returns; g2d_batch_work runs the queued batches in order,
+ * holding the engine lock for a whole batch. Fills and plain copies take
+ * one engine pass, a run of those is started back to back from
+ * g2d_handle_irq without waking the worker, anything else goes through
+ * the blocking mixer calls. Completion of a batch is signalled on its
+ * eventfd, or can be waited for with G2D_CMD_BATCH_WAIT.
+ */
+#define G2D_RING_SIZE		512	/* ops, power of 2 */
+#define G2D_BATCH_MAX		32	/* batches, power of 2 */
+#define G2D_OP_TIMEOUT_MS	50
+#define G2D_OP_NOP		0xff	/* clipped away */
+
+struct g2d_batch_slot {
+	__u32			 first;		/* ring index of the first op */
+	__u32			 count;
+	struct eventfd_ctx	*efd;
+	struct g2d_file_data	*data;		/* owner, for dma-buf syncs */
+};
+
+/* ring and batch indexes are free running */
+static g2d_op			 g2d_ring[G2D_RING_SIZE];
+static __u32			 g2d_ring_head, g2d_ring_tail;
+static struct g2d_batch_slot	 g2d_batches[G2D_BATCH_MAX];
+static __s32			 g2d_batch_result[G2D_BATCH_MAX];
+static __u32			 g2d_batch_head, g2d_batch_tail;
+static struct mutex		 g2d_batch_lock;	/* submitters */
+static wait_queue_head_t	 g2d_batch_wait_queue;
+static struct workqueue_struct	*g2d_batch_wq;
+static struct work_struct	 g2d_batch_work_item;
+
+/* single pass ops left to start from the irq, [next, end) */
+static DEFINE_SPINLOCK(g2d_chain_lock);
+static __u32			 g2d_chain_next, g2d_chain_end;
+
+static __u32 g2d_op_single_pass(g2d_op *op)
+{
+	if (op->type == G2D_OP_FILLRECT)
+		return 1;
+	if (op->type == G2D_OP_BITBLT)
+		return mixer_blt_single_pass(&op->u.blt);
+
+	return 0;
+}
+
+static void g2d_op_start(g2d_op *op)
+{
+	if (op->type == G2D_OP_FILLRECT)
+		mixer_fillrectangle_start(&op->u.fill);
+	else
+		mixer_blt_start(&op->u.blt);
+}
+
+static __s32 g2d_op_run(g2d_op *op)
+{
+	g2d_ext_hd.finish_flag = 0;
+
+	switch (op->type) {
+	case G2D_OP_BITBLT:
+		return mixer_blt(&op->u.blt);
+	case G2D_OP_FILLRECT:
+		return mixer_fillrectangle(&op->u.fill);
+	case G2D_OP_STRETCHBLT:
+		return mixer_stretchblt(&op->u.stretch);
+	case G2D_OP_CONVERT:
+		return g2d_convert_run(&op->u.convert);
+	default:
+		return 0;
+	}
+}
+
+static __s32 g2d_op_clip(g2d_op *op)
+{
+	__s32 ret;
+
+	switch (op->type) {
+	case G2D_OP_BITBLT:
+		ret = g2d_blit_clip(&op->u.blt);
+		break;
+	case G2D_OP_FILLRECT:
+		ret = g2d_fill_clip(&op->u.fill);
+		break;
+	case G2D_OP_STRETCHBLT:
+		ret = g2d_stretchblit_clip(&op->u.stretch);
+		break;
+	case G2D_OP_CONVERT:
+		ret = g2d_convert_clip(&op->u.convert);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (ret > 0)
+		op->type = G2D_OP_NOP;
+
+	return ret < 0 ? ret : 0;
+}
+
+/* called from the finish irq, returns 1 when another op was started */
+static __u32 g2d_batch_chain_next(void)
+{
+	__u32 started = 0;
+
+	spin_lock(&g2d_chain_lock);
+	if (g2d_chain_next != g2d_chain_end) {
+		g2d_op_start(&g2d_ring[g2d_chain_next & (G2D_RING_SIZE - 1)]);
+		g2d_chain_next++;
+		started = 1;
+	}
+	spin_unlock(&g2d_chain_lock);
+
+	return started;
+}
+
+/* run the single pass ops [first, end) from the irq */
+static __s32 g2d_batch_chain(__u32 first, __u32 end)
+{
+	unsigned long flags;
+	long timeout = msecs_to_jiffies(G2D_OP_TIMEOUT_MS * (end - first));
+
+	spin_lock_irqsave(&g2d_chain_lock, flags);
+	g2d_ext_hd.finish_flag = 0;
+	g2d_chain_next = first + 1;
+	g2d_chain_end = end;
+	g2d_op_start(&g2d_ring[first & (G2D_RING_SIZE - 1)]);
+	spin_unlock_irqrestore(&g2d_chain_lock, flags);
+
+	timeout = wait_event_timeout(g2d_ext_hd.queue,
+				     g2d_ext_hd.finish_flag == 1, timeout);
+
+	spin_lock_irqsave(&g2d_chain_lock, flags);
+	g2d_chain_next = g2d_chain_end;
+	spin_unlock_irqrestore(&g2d_chain_lock, flags);
+
+	if (timeout == 0) {
+		mixer_clear_init();
+		printk("wait g2d batch irq pending flag timeout\n");
+		g2d_ext_hd.finish_flag = 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void g2d_batch_work(struct work_struct *work)
+{
+	struct g2d_batch_slot *batch;
+	__u32 i, j, end;
+	__s32 err, pm_err;
+
+	while (g2d_batch_tail != ACCESS_ONCE(g2d_batch_head)) {
+		smp_rmb();
+		batch = &g2d_batches[g2d_batch_tail & (G2D_BATCH_MAX - 1)];
+		i = batch->first;
+		end = batch->first + batch->count;
+		pm_err = g2d_pm_get();
+		err = pm_err;
+
+		mutex_lock(&para.mutex);
+		while (i != end && !err) {
+			if (!g2d_op_single_pass(&g2d_ring[i & (G2D_RING_SIZE - 1)])) {
+				err = g2d_op_run(&g2d_ring[i & (G2D_RING_SIZE - 1)]);
+				i++;
+				continue;
+			}
+			for (j = i + 1; j != end; j++)
+				if (!g2d_op_single_pass(&g2d_ring[j & (G2D_RING_SIZE - 1)]))
+					break;
+			err = g2d_batch_chain(i, j);
+			i = j;
+		}
+		mutex_unlock(&para.mutex);
+		if (!pm_err)
+			g2d_pm_put();
+
+		for (i = batch->first; i != end; i++)
+			g2d_dmabuf_sync_op(batch->data,
+					   &g2d_ring[i & (G2D_RING_SIZE - 1)], 0);
+
+		if (batch->efd) {
+			eventfd_signal(batch->efd, 1);
+			eventfd_ctx_put(batch->efd);
+			batch->efd = NULL;
+		}
+
+		g2d_batch_result[g2d_batch_tail & (G2D_BATCH_MAX - 1)] = err;
+		smp_wmb();
+		g2d_ring_tail = end;
+		g2d_batch_tail++;
+		wake_up_interruptible(&g2d_batch_wait_queue);
+	}
+}
+
+int g2d_batch_submit(struct g2d_file_data *data, g2d_batch *para_batch)
+{
+	struct g2d_batch_slot *batch;
+	struct eventfd_ctx *efd = NULL;
+	__u32 i, head;
+	__s32 ret;
+
+	if (para_batch->count == 0 || para_batch->count > G2D_RING_SIZE)
+		return -EINVAL;
+
+	if (para_batch->eventfd >= 0) {
+		efd = eventfd_ctx_fdget(para_batch->eventfd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	mutex_lock(&g2d_batch_lock);
+
+	ret = wait_event_interruptible(g2d_batch_wait_queue,
+		(g2d_ring_head - ACCESS_ONCE(g2d_ring_tail) + para_batch->count <=
+		 G2D_RING_SIZE) &&
+		(g2d_batch_head - ACCESS_ONCE(g2d_batch_tail) < G2D_BATCH_MAX));
+	if (ret)
+		goto out;
+
+	head = g2d_ring_head;
+	for (i = 0; i < para_batch->count; i++) {
+		g2d_op *op = &g2d_ring[(head + i) & (G2D_RING_SIZE - 1)];
+
+		if (copy_from_user(op, &para_batch->ops[i], sizeof(g2d_op))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		ret = g2d_op_clip(op);
+		if (ret)
+			goto out;
+		g2d_dmabuf_sync_op(data, op, 1);
+	}
+
+	batch = &g2d_batches[g2d_batch_head & (G2D_BATCH_MAX - 1)];
+	batch->first = head;
+	batch->count = para_batch->count;
+	batch->efd = efd;
+	batch->data = data;
+	efd = NULL;
+	para_batch->seq = g2d_batch_head;
+
+	smp_wmb();
+	g2d_ring_head = head + para_batch->count;
+	g2d_batch_head++;
+
+	queue_work(g2d_batch_wq, &g2d_batch_work_item);
+
+out:
+	mutex_unlock(&g2d_batch_lock);
+	if (efd)
+		eventfd_ctx_put(efd);
+
+	return ret;
+}
+
+/* returns the result of batch seq once it is done */
+int g2d_batch_wait(__u32 seq)
+{
+	__s32 ret;
+
+	if ((__s32)(seq - ACCESS_ONCE(g2d_batch_head)) >= 0)
+		return -EINVAL;
+
+	ret = wait_event_interruptible(g2d_batch_wait_queue,
+			(__s32)(ACCESS_ONCE(g2d_batch_tail) - seq) > 0);
+	if (ret)
+		return ret;
+
+	smp_rmb();
+	return g2d_batch_result[seq & (G2D_BATCH_MAX - 1)];
+}
+
+/* wait for everything queued so far, e.g. before the clocks go off */
+void g2d_batch_flush(void)
+{
+	flush_workqueue(g2d_batch_wq);
+}
+
+int g2d_batch_init(void)
+{
+	mutex_init(&g2d_batch_lock);
+	init_waitqueue_head(&g2d_batch_wait_queue);
+	INIT_WORK(&g2d_batch_work_item, g2d_batch_work);
+
+	g2d_batch_wq = create_singlethread_workqueue("g2d");
+	if (!g2d_batch_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void g2d_batch_exit(void)
+{
+	destroy_workqueue(g2d_batch_wq);
+}
+
+/*
+ * In kernel users such as the sunxi fb. fbcon draws from atomic context
+ * (printk), so these poll the engine instead of sleeping and never
+ * wait for the engine lock: -EBUSY tells the caller to use the cpu.
+ */
+#define G2D_KERNEL_TIMEOUT_US	100000
+
+__u32 g2d_kernel_ready;
+
+static int g2d_kernel_run(g2d_op *op)
+{
+	__u32 timeout = G2D_KERNEL_TIMEOUT_US;
+	int ret = 0;
+
+	if (!g2d_kernel_ready || in_interrupt())
+		return -EBUSY;
+	if (!mutex_trylock(&para.mutex))
+		return -EBUSY;
+
+	/* can't wait for a runtime resume here, hold the clocks directly */
+	g2d_clk_on();
+	g2d_ext_hd.finish_flag = 0;
+	/* earlier cpu drawing may still sit in the write buffer */
+	wmb();
+	g2d_op_start(op);
+
+	/* the irq handler may see the finish first */
+	while (!ACCESS_ONCE(g2d_ext_hd.finish_flag)) {
+		if (mixer_get_irq() & G2D_FINISH_IRQ) {
+			mixer_clear_init();
+			break;
+		}
+		if (--timeout == 0) {
+			mixer_clear_init();
+			printk("wait g2d kernel op finish timeout\n");
+			ret = -ETIMEDOUT;
+			break;
+		}
+		udelay(1);
+	}
+	g2d_ext_hd.finish_flag = 1;
+
+	g2d_clk_off();
+	mutex_unlock(&para.mutex);
+
+	return ret;
+}
+
+int g2d_kernel_fill(g2d_fillrect *para_fill)
+{
+	g2d_op op;
+	__s32 ret;
+
+	op.type = G2D_OP_FILLRECT;
+	op.u.fill = *para_fill;
+	ret = g2d_fill_clip(&op.u.fill);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	return g2d_kernel_run(&op);
+}
+EXPORT_SYMBOL(g2d_kernel_fill);
+
+/* only blits that take a single engine pass, anything else is -EBUSY */
+int g2d_kernel_blit(g2d_blt *para_blt)
+{
+	g2d_op op;
+	__s32 ret;
+
+	if (!mixer_blt_single_pass(para_blt))
+		return -EBUSY;
+
+	op.type = G2D_OP_BITBLT;
+	op.u.blt = *para_blt;
+	ret = g2d_blit_clip(&op.u.blt);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	return g2d_kernel_run(&op);
+}
+EXPORT_SYMBOL(g2d_kernel_blit);
+
+/* unlike the above this waits for the engine like the ioctls do */
+int g2d_kernel_convert(g2d_convert *para_conv)
+{
+	__s32 ret;
+
+	if (!g2d_kernel_ready)
+		return -ENODEV;
+
+	ret = g2d_pm_get();
+	if (ret)
+		return ret;
+	mutex_lock(&para.mutex);
+	ret = g2d_convert(para_conv);
+	mutex_unlock(&para.mutex);
+	g2d_pm_put();
+
+	return ret;
+}
+EXPORT_SYMBOL(g2d_kernel_convert);
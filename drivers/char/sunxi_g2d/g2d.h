@@ -36,16 +36,48 @@ typedef struct
 
 }g2d_dev_t;
 
+struct g2d_file_data;
+
 int g2d_openclk(void);
 int g2d_closeclk(void);
 int g2d_clk_on(void);
 int g2d_clk_off(void);
+int g2d_pm_get(void);
+void g2d_pm_put(void);
 irqreturn_t g2d_handle_irq(int irq, void *dev_id);
 int g2d_init(g2d_init_para *para);
 int g2d_blit(g2d_blt * para);
 int g2d_fill(g2d_fillrect * para);
 int g2d_stretchblit(g2d_stretchblt * para);
+int g2d_convert(g2d_convert *para);
 int g2d_set_palette_table(g2d_palette *para);
 int g2d_wait_cmd_finish(void);
+int g2d_batch_submit(struct g2d_file_data *data, g2d_batch *para_batch);
+int g2d_batch_wait(__u32 seq);
+void g2d_batch_flush(void);
+int g2d_batch_init(void);
+void g2d_batch_exit(void);
+
+extern __u32 g2d_kernel_ready;
+
+#ifdef CONFIG_SUNXI_G2D_DMABUF
+int g2d_dmabuf_import(struct g2d_file_data *data, int fd,
+		      __u32 *addr, __u32 *size);
+int g2d_dmabuf_release(struct g2d_file_data *data, __u32 addr);
+void g2d_dmabuf_release_all(struct g2d_file_data *data);
+void g2d_dmabuf_sync_image(struct g2d_file_data *data, g2d_image *image,
+			   int for_device);
+void g2d_dmabuf_sync_op(struct g2d_file_data *data, g2d_op *op,
+			int for_device);
+#else
+static inline void g2d_dmabuf_sync_image(struct g2d_file_data *data,
+					 g2d_image *image, int for_device)
+{
+}
+static inline void g2d_dmabuf_sync_op(struct g2d_file_data *data,
+				      g2d_op *op, int for_device)
+{
+}
+#endif
 
 #endif/* __G2D_H__ */
@@ -568,10 +568,10 @@ __u32 mixer_set_rotate_reg(__u32 flag){
 	return rot;
 }
 
-__s32 mixer_fillrectangle(g2d_fillrect *para){
+/* program and start a fill, completion is signalled by the finish irq */
+void mixer_fillrectangle_start(g2d_fillrect *para){
 	__u32 reg_val = 0;
 	__u64 addr_val;
-	__s32 result = 0;
 
 	mixer_reg_init();/* initial mixer register */
 
@@ -628,20 +628,22 @@ __s32 mixer_fillrectangle(g2d_fillrect *para){
 	/* start */
 	write_wvalue(G2D_CONTROL_REG, 0);
 	write_wvalue(G2D_CONTROL_REG, 0x303);
-	result = g2d_wait_cmd_finish();
+}
 
-	return result;
+__s32 mixer_fillrectangle(g2d_fillrect *para){
+	mixer_fillrectangle_start(para);
+
+	return g2d_wait_cmd_finish();
 }
 
 /*
  * Special fast path for just a simple copy/conversion between
  * ARGB8888, XRGB8888 and RGB565 formats.
  */
-static __s32 mixer_simple_blt(g2d_blt *para)
+static void mixer_simple_blt(g2d_blt *para)
 {
 	__u32 reg_val;
 	__u64 addr_val;
-	__s32 result = 0;
 
 	/* Initial setup, clear all G2D hardware registers */
 	mixer_reg_init();
@@ -721,10 +723,24 @@ static __s32 mixer_simple_blt(g2d_blt *para)
 	/* Start */
 	write_wvalue(G2D_CONTROL_REG, 0x0);
 	write_wvalue(G2D_CONTROL_REG, 0x303);
-	/* Wait for completion */
-	result = g2d_wait_cmd_finish();
+}
 
-	return result;
+/* Common formats are handled with a special fast path, in one pass */
+__u32 mixer_blt_single_pass(g2d_blt *para)
+{
+	return para->flag == G2D_BLT_NONE &&
+		(para->src_image.format == G2D_FMT_ARGB_AYUV8888 ||
+		 para->src_image.format == G2D_FMT_XRGB8888 ||
+		 para->src_image.format == G2D_FMT_RGB565) &&
+		(para->dst_image.format == G2D_FMT_ARGB_AYUV8888 ||
+		 para->dst_image.format == G2D_FMT_XRGB8888 ||
+		 para->dst_image.format == G2D_FMT_RGB565);
+}
+
+/* program and start a single pass blit, see mixer_blt_single_pass() */
+void mixer_blt_start(g2d_blt *para)
+{
+	mixer_simple_blt(para);
 }
 
 __s32 mixer_blt(g2d_blt *para){
@@ -734,15 +750,11 @@ __s32 mixer_blt(g2d_blt *para){
 	__s32 result = 0;
 	__u32 i,j;
 
-	/* Common formats are handled with a special fast path */
-	if (para->flag == G2D_BLT_NONE &&
-			(para->src_image.format == G2D_FMT_ARGB_AYUV8888 ||
-			 para->src_image.format == G2D_FMT_XRGB8888 ||
-			 para->src_image.format == G2D_FMT_RGB565) &&
-			(para->dst_image.format == G2D_FMT_ARGB_AYUV8888 ||
-			 para->dst_image.format == G2D_FMT_XRGB8888 ||
-			 para->dst_image.format == G2D_FMT_RGB565))
-		return mixer_simple_blt(para);
+	if (mixer_blt_single_pass(para)) {
+		mixer_simple_blt(para);
+		/* Wait for completion */
+		return g2d_wait_cmd_finish();
+	}
 
 	mixer_reg_init();/* initial mixer register */
 	if((para->dst_image.format>0x16)&&(para->dst_image.format<0x1A)&&(para->dst_image.pixel_seq == G2D_SEQ_VUVU)){
@@ -102,6 +102,10 @@ typedef enum {
 	G2D_FMT_2BPP_PALETTE	= (0x1F),
 	G2D_FMT_1BPP_PALETTE	= (0x20),
 
+	/* cedar MB32 tiled output, G2D_CMD_CONVERT source only */
+	G2D_FMT_PYUV420UVC_MB32	= (0x21),
+	G2D_FMT_PYUV422UVC_MB32	= (0x22),
+
 }g2d_data_fmt;
 
 typedef enum {
@@ -241,6 +245,61 @@ typedef struct {
 
 }g2d_palette;
 
+/* operation types for G2D_CMD_BATCH */
+typedef enum {
+	G2D_OP_BITBLT			=	0x0,
+	G2D_OP_FILLRECT			=	0x1,
+	G2D_OP_STRETCHBLT		=	0x2,
+	G2D_OP_CONVERT			=	0x3,
+}g2d_op_type;
+
+/*
+ * Format conversion and scaling of src_rect into dst_rect, e.g. NV12
+ * (G2D_FMT_PYUV420UVC) or cedar tiled output to ARGB8888. Tiled sources
+ * go through the display scaler's writeback, which writes whole lines:
+ * dst_rect must then span the width of dst_image and dst_image must be
+ * ARGB8888 or XRGB8888.
+ */
+typedef struct {
+	g2d_image			 src_image;
+	g2d_rect			 src_rect;
+
+	g2d_image			 dst_image;
+	g2d_rect			 dst_rect;
+
+}g2d_convert;
+
+typedef struct {
+	g2d_op_type		 type;
+	union {
+		g2d_blt			 blt;
+		g2d_fillrect	 fill;
+		g2d_stretchblt	 stretch;
+		g2d_convert		 convert;
+	}u;
+
+}g2d_op;
+
+typedef struct {
+	g2d_op			*ops;
+	__u32			 count;
+	__s32			 eventfd;	/* signalled when the batch is done, -1 for none */
+	__u32			 seq;		/* out: batch number for G2D_CMD_BATCH_WAIT */
+
+}g2d_batch;
+
+/*
+ * G2D_CMD_DMABUF_IMPORT: fd in; addr and size out. addr is the physical
+ * address to use in g2d_image.addr, the buffer stays pinned until
+ * G2D_CMD_DMABUF_RELEASE with that addr or until /dev/g2d is closed.
+ */
+typedef struct {
+	__s32			 fd;
+	__u32			 addr;
+	__u32			 size;
+
+}g2d_dmabuf;
+
 #endif	/* __G2D_BSP_DRV_H */
 
 typedef struct {
@@ -252,6 +311,9 @@ typedef struct {
 __u32	mixer_reg_init(void);
 __s32	mixer_blt(g2d_blt *para);
 __s32	mixer_fillrectangle(g2d_fillrect *para);
+void	mixer_fillrectangle_start(g2d_fillrect *para);
+__u32	mixer_blt_single_pass(g2d_blt *para);
+void	mixer_blt_start(g2d_blt *para);
 __s32	mixer_stretchblt(g2d_stretchblt *para);
 __s32	mixer_maskblt(g2d_maskblt *para);
 __u32	mixer_set_palette(g2d_palette *para);
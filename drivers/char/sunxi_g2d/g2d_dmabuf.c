@@ -0,0 +1,218 @@
+/*
+ * drivers/char/sunxi_g2d/g2d_dmabuf.c
+ *
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * dma-buf surfaces: buffers from other exporters are attached to the
+ * g2d device and pinned per open file, so their physical address can be
+ * used in g2d_image. The engine has no MMU, so they must be contiguous.
+ * The mapping stays for the life of the import; around each op the
+ * touched buffers are synced for the device and, once the op is done,
+ * for the cpu, through the attachment's scatterlist.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
+
+#include "g2d_driver_i.h"
+#include "g2d.h"
+
+struct g2d_dmabuf_import {
+	struct list_head list;
+	struct dma_buf *buf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	__u32 addr;
+	__u32 size;
+};
+
+extern __g2d_info_t para;
+
+int g2d_dmabuf_import(struct g2d_file_data *data, int fd,
+		      __u32 *addr, __u32 *size)
+{
+	struct g2d_dmabuf_import *imp;
+	int ret;
+
+	imp = kzalloc(sizeof(struct g2d_dmabuf_import), GFP_KERNEL);
+	if (!imp)
+		return -ENOMEM;
+
+	imp->buf = dma_buf_get(fd);
+	if (IS_ERR(imp->buf)) {
+		ret = PTR_ERR(imp->buf);
+		goto err_free;
+	}
+
+	imp->attach = dma_buf_attach(imp->buf, para.dev);
+	if (IS_ERR(imp->attach)) {
+		ret = PTR_ERR(imp->attach);
+		goto err_put;
+	}
+
+	/* g2d reads sources and writes destinations, either way round */
+	imp->sgt = dma_buf_map_attachment(imp->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR_OR_NULL(imp->sgt)) {
+		ret = imp->sgt ? PTR_ERR(imp->sgt) : -ENOMEM;
+		goto err_detach;
+	}
+
+	if (imp->sgt->nents != 1) {
+		WARNING("dma-buf fd %d is not contiguous (%d chunks)\n",
+			fd, imp->sgt->nents);
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	imp->addr = sg_phys(imp->sgt->sgl);
+	imp->size = imp->buf->size;
+
+	mutex_lock(&data->dmabuf_lock);
+	list_add(&imp->list, &data->dmabuf_imports);
+	mutex_unlock(&data->dmabuf_lock);
+
+	*addr = imp->addr;
+	*size = imp->size;
+
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(imp->buf, imp->attach);
+err_put:
+	dma_buf_put(imp->buf);
+err_free:
+	kfree(imp);
+	return ret;
+}
+
+static void g2d_dmabuf_put_import(struct g2d_dmabuf_import *imp)
+{
+	list_del(&imp->list);
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_BIDIRECTIONAL);
+	dma_buf_detach(imp->buf, imp->attach);
+	dma_buf_put(imp->buf);
+	kfree(imp);
+}
+
+int g2d_dmabuf_release(struct g2d_file_data *data, __u32 addr)
+{
+	struct g2d_dmabuf_import *imp;
+	int ret = -ENOENT;
+
+	/* queued batches may still use it */
+	g2d_batch_flush();
+
+	mutex_lock(&data->dmabuf_lock);
+	list_for_each_entry(imp, &data->dmabuf_imports, list) {
+		if (imp->addr == addr) {
+			g2d_dmabuf_put_import(imp);
+			ret = 0;
+			break;
+		}
+	}
+	mutex_unlock(&data->dmabuf_lock);
+
+	return ret;
+}
+
+void g2d_dmabuf_release_all(struct g2d_file_data *data)
+{
+	struct g2d_dmabuf_import *imp, *tmp;
+
+	mutex_lock(&data->dmabuf_lock);
+	list_for_each_entry_safe(imp, tmp, &data->dmabuf_imports, list)
+		g2d_dmabuf_put_import(imp);
+	mutex_unlock(&data->dmabuf_lock);
+}
+
+static struct g2d_dmabuf_import *
+g2d_dmabuf_find(struct g2d_file_data *data, __u32 addr)
+{
+	struct g2d_dmabuf_import *imp;
+
+	list_for_each_entry(imp, &data->dmabuf_imports, list)
+		if (addr >= imp->addr && addr - imp->addr < imp->size)
+			return imp;
+
+	return NULL;
+}
+
+/* sync every imported buffer the planes of image live in */
+void g2d_dmabuf_sync_image(struct g2d_file_data *data, g2d_image *image,
+			   int for_device)
+{
+	struct g2d_dmabuf_import *imp, *last = NULL;
+	int i;
+
+	mutex_lock(&data->dmabuf_lock);
+	for (i = 0; i < 3; i++) {
+		if (!image->addr[i])
+			continue;
+		imp = g2d_dmabuf_find(data, image->addr[i]);
+		if (!imp || imp == last)
+			continue;
+		if (for_device)
+			dma_sync_sg_for_device(para.dev, imp->sgt->sgl,
+					       imp->sgt->nents,
+					       DMA_BIDIRECTIONAL);
+		else
+			dma_sync_sg_for_cpu(para.dev, imp->sgt->sgl,
+					    imp->sgt->nents,
+					    DMA_BIDIRECTIONAL);
+		last = imp;
+	}
+	mutex_unlock(&data->dmabuf_lock);
+}
+
+/*
+ * Before an op all its surfaces go to the device, after it only the
+ * destination has to come back to the cpu.
+ */
+void g2d_dmabuf_sync_op(struct g2d_file_data *data, g2d_op *op,
+			int for_device)
+{
+	switch (op->type) {
+	case G2D_OP_BITBLT:
+		if (for_device)
+			g2d_dmabuf_sync_image(data, &op->u.blt.src_image, 1);
+		g2d_dmabuf_sync_image(data, &op->u.blt.dst_image, for_device);
+		break;
+	case G2D_OP_FILLRECT:
+		g2d_dmabuf_sync_image(data, &op->u.fill.dst_image, for_device);
+		break;
+	case G2D_OP_STRETCHBLT:
+		if (for_device)
+			g2d_dmabuf_sync_image(data, &op->u.stretch.src_image, 1);
+		g2d_dmabuf_sync_image(data, &op->u.stretch.dst_image,
+				      for_device);
+		break;
+	case G2D_OP_CONVERT:
+		if (for_device)
+			g2d_dmabuf_sync_image(data, &op->u.convert.src_image, 1);
+		g2d_dmabuf_sync_image(data, &op->u.convert.dst_image,
+				      for_device);
+		break;
+	default:
+		break;
+	}
+}
@@ -21,13 +21,15 @@
  */
 
 #include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 #include"g2d_driver_i.h"
 #include<linux/g2d_driver.h>
 #include"g2d.h"
 
-#ifdef CONFIG_HAS_EARLYSUSPEND
-#include <linux/earlysuspend.h>
-#endif
 #define G2D_BYTE_ALIGN(x) ( ( (x + (4*1024-1)) >> 12) << 12)             /* alloc based on 4K byte */
 static struct g2d_alloc_struct boot_heap_head,boot_heap_tail;
 static struct info_mem g2d_mem[MAX_G2D_MEM_INDEX];
@@ -332,25 +334,222 @@ int g2d_mmap(struct file *file, struct vm_area_struct * vma)
 	return 0;
 }
 
-static int g2d_open(struct inode *inode, struct file *file)
+/*
+ * The engine clocks follow runtime pm: every user of the engine holds a
+ * reference while it runs, and the clocks go off once G2D has been idle
+ * for the autosuspend delay (power/autosuspend_delay_ms in sysfs), so
+ * animations keep it clocked between frames and idle screens don't.
+ * Nothing needs reprogramming on the way back up, every op starts with
+ * mixer_reg_init().
+ */
+#define G2D_AUTOSUSPEND_MS	100
+
+static DEFINE_SPINLOCK(g2d_pm_lock);
+static struct {
+	__u32	resumes;
+	__u32	suspends;
+	__u32	wakes;		/* users that had to wait for a resume */
+	s64		wake_last_us;
+	s64		wake_max_us;
+	s64		wake_total_us;
+} g2d_pm_stat;
+
+int g2d_pm_get(void)
 {
+#ifdef CONFIG_PM_RUNTIME
+	ktime_t start = ktime_get();
+	unsigned long flags;
+	s64 delta;
+	int ret;
+
+	ret = pm_runtime_get_sync(para.dev);
+	if (ret < 0) {
+		pm_runtime_put_noidle(para.dev);
+		ERR("g2d resume failed %d\n", ret);
+		return ret;
+	}
+	/* 0 when the clocks had to come up first */
+	if (ret == 0) {
+		delta = ktime_us_delta(ktime_get(), start);
+		spin_lock_irqsave(&g2d_pm_lock, flags);
+		g2d_pm_stat.wakes++;
+		g2d_pm_stat.wake_last_us = delta;
+		g2d_pm_stat.wake_total_us += delta;
+		if (delta > g2d_pm_stat.wake_max_us)
+			g2d_pm_stat.wake_max_us = delta;
+		spin_unlock_irqrestore(&g2d_pm_lock, flags);
+	}
+#else
 	g2d_clk_on();
+#endif
 	return 0;
 }
 
-static int g2d_release(struct inode *inode, struct file *file)
+void g2d_pm_put(void)
 {
+#ifdef CONFIG_PM_RUNTIME
+	pm_runtime_mark_last_busy(para.dev);
+	pm_runtime_put_autosuspend(para.dev);
+#else
 	g2d_clk_off();
+#endif
+}
+
+#ifdef CONFIG_PM_RUNTIME
+static int g2d_runtime_suspend(struct device *dev)
+{
+	g2d_clk_off();
+	g2d_pm_stat.suspends++;
+	return 0;
+}
+
+static int g2d_runtime_resume(struct device *dev)
+{
+	g2d_clk_on();
+	g2d_pm_stat.resumes++;
+	return 0;
+}
+#endif
+
+static struct dentry *g2d_debugfs;
+
+static int g2d_pm_show(struct seq_file *m, void *v)
+{
+	unsigned long flags;
+	__u32 wakes;
+	s64 last, max, total;
+
+	spin_lock_irqsave(&g2d_pm_lock, flags);
+	wakes = g2d_pm_stat.wakes;
+	last = g2d_pm_stat.wake_last_us;
+	max = g2d_pm_stat.wake_max_us;
+	total = g2d_pm_stat.wake_total_us;
+	spin_unlock_irqrestore(&g2d_pm_lock, flags);
+
+#ifdef CONFIG_PM_RUNTIME
+	seq_printf(m, "state: %s\nautosuspend delay: %d ms\n",
+		   pm_runtime_suspended(para.dev) ? "suspended" : "active",
+		   para.dev->power.autosuspend_delay);
+#endif
+	seq_printf(m, "resumes: %u\nsuspends: %u\n",
+		   g2d_pm_stat.resumes, g2d_pm_stat.suspends);
+	seq_printf(m, "wake latency: last %lld us, max %lld us, avg %lld us"
+		   " over %u wakes\n", last, max,
+		   wakes ? div_s64(total, wakes) : 0, wakes);
+
+	return 0;
+}
+
+static int g2d_pm_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, g2d_pm_show, inode->i_private);
+}
+
+static const struct file_operations g2d_pm_fops = {
+	.owner		= THIS_MODULE,
+	.open		= g2d_pm_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void g2d_debugfs_init(void)
+{
+	g2d_debugfs = debugfs_create_dir("g2d", NULL);
+	if (IS_ERR_OR_NULL(g2d_debugfs)) {
+		g2d_debugfs = NULL;
+		return;
+	}
+	debugfs_create_file("pm", 0444, g2d_debugfs, NULL, &g2d_pm_fops);
+}
+
+static void g2d_debugfs_exit(void)
+{
+	debugfs_remove_recursive(g2d_debugfs);
+	g2d_debugfs = NULL;
+}
+
+static int g2d_open(struct inode *inode, struct file *file)
+{
+	struct g2d_file_data *data =
+		kzalloc(sizeof(struct g2d_file_data), GFP_KERNEL);
+
+	if (!data)
+		return -ENOMEM;
+
+#ifdef CONFIG_SUNXI_G2D_DMABUF
+	mutex_init(&data->dmabuf_lock);
+	INIT_LIST_HEAD(&data->dmabuf_imports);
+#endif
+	file->private_data = data;
+
+	return 0;
+}
+
+static int g2d_release(struct inode *inode, struct file *file)
+{
+	struct g2d_file_data *data = file->private_data;
+
+	/* queued batches still need the imports */
+	g2d_batch_flush();
+
+#ifdef CONFIG_SUNXI_G2D_DMABUF
+	g2d_dmabuf_release_all(data);
+#endif
+	kfree(data);
+	file->private_data = NULL;
+
 	return 0;
 }
 
 long g2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
+	struct g2d_file_data *data = file->private_data;
+	__u32	engine;
 	__s32	ret = 0;
 
+	/* batches take the engine lock when they run, not when queued */
+	if (cmd == G2D_CMD_BATCH) {
+		g2d_batch batch_para;
+		if(copy_from_user(&batch_para, (g2d_batch *)arg, sizeof(g2d_batch)))
+			return -EFAULT;
+		ret = g2d_batch_submit(data, &batch_para);
+		if (ret == 0 && put_user(batch_para.seq, &((g2d_batch *)arg)->seq))
+			ret = -EFAULT;
+		return ret;
+	}
+	if (cmd == G2D_CMD_BATCH_WAIT)
+		return g2d_batch_wait(arg);
+
+#ifdef CONFIG_SUNXI_G2D_DMABUF
+	if (cmd == G2D_CMD_DMABUF_IMPORT) {
+		g2d_dmabuf dmabuf_para;
+		if(copy_from_user(&dmabuf_para, (g2d_dmabuf *)arg, sizeof(g2d_dmabuf)))
+			return -EFAULT;
+		ret = g2d_dmabuf_import(data, dmabuf_para.fd, &dmabuf_para.addr,
+					&dmabuf_para.size);
+		if (ret)
+			return ret;
+		if(copy_to_user((g2d_dmabuf *)arg, &dmabuf_para, sizeof(g2d_dmabuf))) {
+			g2d_dmabuf_release(data, dmabuf_para.addr);
+			return -EFAULT;
+		}
+		return 0;
+	}
+	if (cmd == G2D_CMD_DMABUF_RELEASE)
+		return g2d_dmabuf_release(data, arg);
+#endif
+
 	if(!mutex_trylock(&para.mutex)) {
 			mutex_lock(&para.mutex);
 	}
+	/* memory management doesn't touch the engine */
+	engine = cmd < G2D_CMD_MEM_REQUEST;
+	if (engine) {
+		ret = g2d_pm_get();
+		if (ret)
+			goto err_noput;
+	}
 	switch (cmd) {
 
 	/* Proceed to the operation */
@@ -360,9 +559,12 @@ long g2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		{
 			kfree(&blit_para);
 			ret = -EFAULT;
-			goto err_noput;
+			break;
 		}
+		g2d_dmabuf_sync_image(data, &blit_para.src_image, 1);
+		g2d_dmabuf_sync_image(data, &blit_para.dst_image, 1);
 	    ret = g2d_blit(&blit_para);
+		g2d_dmabuf_sync_image(data, &blit_para.dst_image, 0);
     	break;
 	}
 	case G2D_CMD_FILLRECT:{
@@ -371,9 +573,11 @@ long g2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		{
 			kfree(&fill_para);
 			ret = -EFAULT;
-			goto err_noput;
+			break;
 		}
+		g2d_dmabuf_sync_image(data, &fill_para.dst_image, 1);
 	    ret = g2d_fill(&fill_para);
+		g2d_dmabuf_sync_image(data, &fill_para.dst_image, 0);
     	break;
 	}
 	case G2D_CMD_STRETCHBLT:{
@@ -382,18 +586,34 @@ long g2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		{
 			kfree(&stre_para);
 			ret = -EFAULT;
-			goto err_noput;
+			break;
 		}
+		g2d_dmabuf_sync_image(data, &stre_para.src_image, 1);
+		g2d_dmabuf_sync_image(data, &stre_para.dst_image, 1);
 	    ret = g2d_stretchblit(&stre_para);
+		g2d_dmabuf_sync_image(data, &stre_para.dst_image, 0);
     	break;
 	}
+	case G2D_CMD_CONVERT:{
+		g2d_convert conv_para;
+		if(copy_from_user(&conv_para, (g2d_convert *)arg, sizeof(g2d_convert)))
+		{
+			ret = -EFAULT;
+			break;
+		}
+		g2d_dmabuf_sync_image(data, &conv_para.src_image, 1);
+		g2d_dmabuf_sync_image(data, &conv_para.dst_image, 1);
+		ret = g2d_convert(&conv_para);
+		g2d_dmabuf_sync_image(data, &conv_para.dst_image, 0);
+		break;
+	}
 	case G2D_CMD_PALETTE_TBL:{
 		g2d_palette pale_para;
 		if(copy_from_user(&pale_para, (g2d_palette *)arg, sizeof(g2d_palette)))
 		{
 			kfree(&pale_para);
 			ret = -EFAULT;
-			goto err_noput;
+			break;
 		}
 	    ret = g2d_set_palette_table(&pale_para);
     	break;
@@ -430,6 +650,8 @@ long g2d_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	}
 
+	if (engine)
+		g2d_pm_put();
 err_noput:
 	mutex_unlock(&para.mutex);
 
@@ -507,6 +729,23 @@ static int g2d_probe(struct platform_device *pdev)
 
 	drv_g2d_init();
 	mutex_init(&info->mutex);
+	ret = g2d_batch_init();
+	if (ret)
+	{
+		ERR("failed to create the batch workqueue\n");
+		free_irq(info->irq, info);
+		goto relaese_regs;
+	}
+
+#ifdef CONFIG_PM_RUNTIME
+	pm_runtime_set_suspended(&pdev->dev);
+	pm_runtime_set_autosuspend_delay(&pdev->dev, G2D_AUTOSUSPEND_MS);
+	pm_runtime_use_autosuspend(&pdev->dev);
+	pm_runtime_enable(&pdev->dev);
+#endif
+	g2d_debugfs_init();
+
+	g2d_kernel_ready = 1;
 	return 0;
 
 	relaese_regs:
@@ -525,6 +764,18 @@ static int g2d_remove(struct platform_device *pdev)
 {
 	__g2d_info_t *info = platform_get_drvdata(pdev);
 
+	g2d_kernel_ready = 0;
+	g2d_batch_exit();
+	g2d_debugfs_exit();
+
+#ifdef CONFIG_PM_RUNTIME
+	pm_runtime_disable(&pdev->dev);
+	pm_runtime_dont_use_autosuspend(&pdev->dev);
+	if (!pm_runtime_status_suspended(&pdev->dev))
+		g2d_clk_off();
+	pm_runtime_set_suspended(&pdev->dev);
+#endif
+
 	/* power down */
 	g2d_closeclk();
 
@@ -539,57 +790,50 @@ static int g2d_remove(struct platform_device *pdev)
 	return 0;
 }
 
-static int g2d_suspend(struct platform_device *pdev, pm_message_t state)
+#ifdef CONFIG_PM
+/* runtime pm holds the clocks only while G2D is busy or about to idle */
+static int g2d_suspend(struct device *dev)
 {
-	g2d_clk_off();
+	g2d_batch_flush();
+#ifdef CONFIG_PM_RUNTIME
+	if (!pm_runtime_status_suspended(dev))
+		g2d_clk_off();
+#endif
 	INFO("g2d_suspend succesfully.\n");
 
 	return 0;
 }
 
-static int g2d_resume(struct platform_device *pdev)
+static int g2d_resume(struct device *dev)
 {
 	INFO("%s. \n", __func__);
-	g2d_clk_on();
+#ifdef CONFIG_PM_RUNTIME
+	if (!pm_runtime_status_suspended(dev))
+		g2d_clk_on();
+#endif
 	INFO("g2d_resume succesfully.\n");
 
 	return 0;
 }
 
-#ifdef CONFIG_HAS_EARLYSUSPEND
-void g2d_early_suspend(struct early_suspend *h)
-{
-//    g2d_suspend(NULL, PMSG_SUSPEND);
-}
-
-void g2d_late_resume(struct early_suspend *h)
-{
-//    g2d_resume(NULL);
-}
-
-static struct early_suspend g2d_early_suspend_handler =
-{
-    .level   = EARLY_SUSPEND_LEVEL_DISABLE_FB,
-	.suspend = g2d_early_suspend,
-	.resume = g2d_late_resume,
+static const struct dev_pm_ops g2d_pm_ops = {
+	.suspend	= g2d_suspend,
+	.resume		= g2d_resume,
+	SET_RUNTIME_PM_OPS(g2d_runtime_suspend, g2d_runtime_resume, NULL)
 };
+#define G2D_PM_OPS	(&g2d_pm_ops)
+#else
+#define G2D_PM_OPS	NULL
 #endif
 
-
 static struct platform_driver g2d_driver = {
 	.probe          = g2d_probe,
 	.remove         = g2d_remove,
-#ifndef CONFIG_HAS_EARLYSUSPEND
-	.suspend        = g2d_suspend,
-	.resume         = g2d_resume,
-#else
-	.suspend        = NULL,
-	.resume         = NULL,
-#endif
 	.driver			=
 	{
 		.owner		= THIS_MODULE,
 		.name		= "g2d",
+		.pm			= G2D_PM_OPS,
 	},
 };
 
@@ -622,9 +866,6 @@ int __init g2d_module_init(void)
 		ret = platform_driver_register(&g2d_driver);
 	}
 
-#ifdef CONFIG_HAS_EARLYSUSPEND
-    register_early_suspend(&g2d_early_suspend_handler);
-#endif
 	INFO("Module initialized.major:%d\n", MAJOR(devid));
 	return ret;
 }
@@ -634,9 +875,6 @@ static void __exit g2d_module_exit(void)
 	INFO("g2d_module_exit\n");
 	kfree(g2d_ext_hd.g2d_finished_sem);
 
-#ifdef CONFIG_HAS_EARLYSUSPEND
-    unregister_early_suspend(&g2d_early_suspend_handler);
-#endif
 
 	platform_driver_unregister(&g2d_driver);
 	platform_device_unregister(&g2d_device);
@@ -56,6 +56,15 @@ typedef struct
 
 }__g2d_info_t;
 
+/* per open file of /dev/g2d */
+struct g2d_file_data
+{
+#ifdef CONFIG_SUNXI_G2D_DMABUF
+	struct mutex		 dmabuf_lock;
+	struct list_head	 dmabuf_imports;
+#endif
+};
+
 typedef struct
 {
     __u32				 mid;
@@ -18,6 +18,10 @@
 #include <linux/types.h>
 #include <linux/errno.h>
 #include <linux/slab.h>
+#include <linux/bitops.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/includes.h>
 #include "sunxi_physmem_i.h"
@@ -28,265 +32,264 @@
 
 #define	MEMORY_GAP_MIN      0x10000
 
-#define IS_LIST_EMPTY(listh)            ((bool)((listh)->next == listh))
-#define LIST_REACH_END(listh, entry)    ((bool)(listh == entry))
-#define NEXT_PHYS_ADDR(pnode)           (pnode->phys_addr + pnode->size)
-
 #define SW_VE_MEM_BASE                    (PLAT_PHYS_OFFSET + SZ_64M)
 #define SW_VE_MEM_SIZE                    (SZ_64M)
 
 static struct sunxi_mem_allocator	*g_allocator = NULL;
 static DEFINE_SPINLOCK(sunxi_memlock);
 
-inline static void __sunxi_init_list_head(struct mem_list * listh)
+/* free list of a block, [2^n, 2^(n+1)) units go on list n */
+inline static int __sunxi_class(u32 units)
 {
-	listh->next = listh->prev = listh;
+	return fls(units) - 1;
 }
 
-inline static struct mem_list * __sunxi_first_node(struct mem_list * listh)
+inline static void __sunxi_mark_block(struct sunxi_mem_allocator *this, u32 idx, u32 units)
 {
-	return listh->next;
+	this->blks[idx].units = units;
+	this->blks[idx + units - 1].head = idx;
 }
 
-inline static void __sunxi_remove_node(struct mem_list * pnode)
+static void __sunxi_link_free(struct sunxi_mem_allocator *this, u32 idx)
 {
-	pnode->prev->next = pnode->next;
-	pnode->next->prev = pnode->prev;
-	pnode->next = NULL;
-	pnode->prev = NULL;
+	struct sxm_blk *blk = &this->blks[idx];
+	int n = __sunxi_class(blk->units);
+
+	blk->free = 1;
+	list_add(&blk->list, &this->free_lists[n]);
+	this->free_count[n]++;
+	__set_bit(n, &this->free_map);
 }
 
-inline static void __sunxi_insert_node_before(struct mem_list * pnew_node, struct mem_list * pexisting_node)
+static void __sunxi_unlink_free(struct sunxi_mem_allocator *this, u32 idx)
 {
-	pexisting_node->prev->next = pnew_node;
-	pnew_node->prev = pexisting_node->prev;
-	pnew_node->next = pexisting_node;
-	pexisting_node->prev = pnew_node;
+	struct sxm_blk *blk = &this->blks[idx];
+	int n = __sunxi_class(blk->units);
+
+	blk->free = 0;
+	list_del(&blk->list);
+	if(0 == --this->free_count[n])
+		__clear_bit(n, &this->free_map);
 }
 
 static u32 sunxi_init(struct sunxi_mem_allocator *this, u32 size, u32 va, u32 pa)
 {
-	u32	uret = 0;
-	struct mem_list * pnode;
+	int i;
 
-	this->normal_size = size;
-
-	this->node_free_listh = this->create_new_node(this, 0, 0, 0);
-	if(NULL == this->node_free_listh) {
-		uret = __LINE__;
-		goto end;
+	this->nr_units = size / MEMORY_GAP_MIN;
+	/* u16 boundary tags, and the whole pool must have a class */
+	if(0 == this->nr_units || this->nr_units > 0xffff) {
+		SXM_ERR("%s err, bad pool size 0x%08x\n", __func__, size);
+		return __LINE__;
 	}
-	__sunxi_init_list_head(this->node_free_listh);
 
-	this->free_listh = this->create_new_node(this, 0, 0, 0);
-	if(NULL == this->free_listh) {
-		uret = __LINE__;
-		goto end;
+	this->blks = kzalloc(this->nr_units * sizeof(struct sxm_blk), GFP_KERNEL);
+	if(NULL == this->blks) {
+		SXM_ERR("%s err, line %d\n", __func__, __LINE__);
+		return __LINE__;
 	}
 
-	__sunxi_init_list_head(this->free_listh);
+	for(i = 0; i < SXM_CLASSES; i++)
+		INIT_LIST_HEAD(&this->free_lists[i]);
+	this->free_map = 0;
+	memset(this->free_count, 0, sizeof(this->free_count));
+	memset(&this->stats, 0, sizeof(this->stats));
 
-	this->inuse_listh = this->create_new_node(this, 0, 0, 0);
-	if (NULL == this->inuse_listh) {
-		uret = __LINE__;
-		goto end;
-	}
+	this->virt_base = va;
+	this->phys_base = pa;
+	this->total_size = this->nr_units * MEMORY_GAP_MIN;
+	this->normal_size = this->total_size;
 
-	__sunxi_init_list_head(this->inuse_listh);
+	__sunxi_mark_block(this, 0, this->nr_units);
+	__sunxi_link_free(this, 0);
 
-	pnode = this->create_new_node(this, this->normal_size, va, pa);
-
-	__sunxi_insert_node_before(pnode, __sunxi_first_node(this->free_listh));
-
-end:
-	if(0 != uret)
-		SXM_ERR("%s err, line %d\n", __func__, uret);
-
-	return uret;
+	return 0;
 }
 
 static void sunxi_deinit(struct sunxi_mem_allocator *this)
 {
-	if(NULL != this->inuse_listh) {
-		this->free_list(this, &this->inuse_listh);
-		this->inuse_listh = NULL;
-	}
-
-	if(NULL != this->free_listh) {
-		this->free_list(this, &this->free_listh);
-		this->free_listh = NULL;
-	}
-
-	if(NULL != this->node_free_listh) {
-		this->free_list(this, &this->node_free_listh);
-		this->node_free_listh = NULL;
-	}
+	kfree(this->blks);
+	this->blks = NULL;
+	this->nr_units = 0;
+	this->normal_size = 0;
 }
 
-static struct mem_list * sunxi_create_new_node(struct sunxi_mem_allocator *this,
-			u32 size, u32 virt_addr, u32 phys_addr)
+/*
+ * Best fit among the blocks of the class of the size, which may be too
+ * small, else the first block of the next non-empty class, which always
+ * fits. The split-off rest stays free, so the waste is bounded by the
+ * 64K granularity.
+ */
+static int sunxi_find_free_block(struct sunxi_mem_allocator *this, u32 units)
 {
-	struct mem_list * pnode = NULL;
-
-	if((size == 0) || IS_LIST_EMPTY(this->node_free_listh))	{
-		pnode = (struct mem_list *)kmalloc(sizeof(*pnode), GFP_ATOMIC);
-		if(NULL == pnode) {
-			SXM_ERR_FUN_LINE;
-			return NULL;
+	struct sxm_blk *blk, *best = NULL;
+	int n = __sunxi_class(units);
+
+	if(test_bit(n, &this->free_map)) {
+		list_for_each_entry(blk, &this->free_lists[n], list) {
+			if(blk->units >= units && (NULL == best || blk->units < best->units)) {
+				best = blk;
+				if(blk->units == units)
+					break;
+			}
 		}
-	} else {
-		pnode = __sunxi_first_node(this->node_free_listh);
-		__sunxi_remove_node(pnode);
+		if(NULL != best)
+			return best - this->blks;
 	}
 
-	if(pnode != NULL) {
-		pnode->virt_addr = virt_addr;
-		pnode->phys_addr = phys_addr;
-		pnode->size 	= size;
-		pnode->next 	= NULL;
-		pnode->prev	= NULL;
-	}
-
-	return pnode;
-}
+	n = find_next_bit(&this->free_map, SXM_CLASSES, n + 1);
+	if(n >= SXM_CLASSES)
+		return -1;
 
-static bool sunxi_delete_node(struct sunxi_mem_allocator *this, struct mem_list * pnode)
-{
-	__sunxi_insert_node_before(pnode, __sunxi_first_node(this->node_free_listh));
-	return true;
+	blk = list_first_entry(&this->free_lists[n], struct sxm_blk, list);
+	return blk - this->blks;
 }
 
-static struct mem_list * sunxi_find_free_block(struct sunxi_mem_allocator *this, u32 size)
+bool sunxi_allocate(struct sunxi_mem_allocator *this, const u32 size_to_alloc,
+		u32* const pvirt_adr, u32* const pphy_adr)
 {
-	struct mem_list * pnode = __sunxi_first_node(this->free_listh);
+	u32 	units, rest;
+	int	idx;
 
-	while(!LIST_REACH_END(this->free_listh, pnode))	{
-		if (size <= pnode->size) {
-			__sunxi_remove_node(pnode);
-			return (pnode);
-		}
-		pnode = pnode->next;
+	units = (size_to_alloc + (MEMORY_GAP_MIN - 1)) / MEMORY_GAP_MIN;
+	if(0 == units || units > this->nr_units) {
+		this->stats.fails++;
+		return false;
 	}
 
-	return (NULL);
-}
-
-static bool sunxi_add_node_to_freelist(struct sunxi_mem_allocator *this, struct mem_list * pnode)
-{
-	struct mem_list * pnode_temp = __sunxi_first_node(this->free_listh);
-
-	struct mem_list * pnode_prev = NULL;
-	struct mem_list * pnode_next = NULL;
-
-	u32 cur_paddr = pnode->phys_addr;
-	u32 next_paddr = NEXT_PHYS_ADDR(pnode);
+	idx = sunxi_find_free_block(this, units);
+	if(idx < 0) {
+		this->stats.fails++;
+		if(this->normal_size >= units * MEMORY_GAP_MIN)
+			this->stats.fails_frag++;
+		return false;
+	}
 
-	while(!LIST_REACH_END(this->free_listh, pnode_temp)) {
-		if(cur_paddr == NEXT_PHYS_ADDR(pnode_temp))
-			pnode_prev = pnode_temp;
-		else if(next_paddr == pnode_temp->phys_addr)
-			pnode_next = pnode_temp;
+	__sunxi_unlink_free(this, idx);
 
-		if((pnode_prev == NULL) || (pnode_next == NULL))
-			pnode_temp = pnode_temp->next;
-		else
-			break;
+	rest = this->blks[idx].units - units;
+	if(rest) {
+		__sunxi_mark_block(this, idx + units, rest);
+		__sunxi_link_free(this, idx + units);
 	}
+	__sunxi_mark_block(this, idx, units);
 
-	if(pnode_prev != NULL)	{
-		__sunxi_remove_node(pnode_prev);
+	this->normal_size -= units * MEMORY_GAP_MIN;
+	this->stats.allocs++;
 
-		pnode->size = pnode->size + pnode_prev->size;
-		pnode->virt_addr = pnode_prev->virt_addr;
-		pnode->phys_addr = pnode_prev->phys_addr;
-		this->delete_node(this, pnode_prev);
-	}
+	*pvirt_adr = this->virt_base + idx * MEMORY_GAP_MIN;
+	*pphy_adr = this->phys_base + idx * MEMORY_GAP_MIN;
+	return true;
+}
 
-	if(pnode_next != NULL) {
-		__sunxi_remove_node(pnode_next);
+/* O(1): the tag of the block is found from the address, then merged with free neighbours */
+void sunxi_free(struct sunxi_mem_allocator *this, const u32 virtAddr, const u32 physAddr)
+{
+	u32 	idx, units, next, prev;
 
-		pnode->size = pnode->size + pnode_next->size;
-		this->delete_node(this, pnode_next);
-	}
+	if(physAddr < this->phys_base || (physAddr - this->phys_base) % MEMORY_GAP_MIN)
+		goto bad;
 
-	pnode_temp = __sunxi_first_node(this->free_listh);
+	idx = (physAddr - this->phys_base) / MEMORY_GAP_MIN;
+	if(idx >= this->nr_units || 0 == this->blks[idx].units || this->blks[idx].free)
+		goto bad;
 
-	while(!LIST_REACH_END(this->free_listh, pnode_temp)) {
-		if(pnode->size <= pnode_temp->size)
-			break;
-		pnode_temp = pnode_temp->next;
-	}
+	units = this->blks[idx].units;
+	this->normal_size += units * MEMORY_GAP_MIN;
+	this->stats.frees++;
 
-	__sunxi_insert_node_before(pnode, pnode_temp);
-	return true;
-}
+	next = idx + units;
+	if(next < this->nr_units && this->blks[next].free) {
+		__sunxi_unlink_free(this, next);
+		units += this->blks[next].units;
+		this->blks[next].units = 0;
+	}
 
-static bool sunxi_free_list(struct sunxi_mem_allocator *this, struct mem_list **pphead)
-{
-	struct mem_list * pcur;
-	struct mem_list * pnext;
-
-	if(*pphead != NULL) {
-		pcur = (*pphead)->next;
-		while(pcur != *pphead) {
-			pnext = pcur->next;
-			kfree(pcur);
-			pcur = pnext;
+	if(idx > 0) {
+		prev = this->blks[idx - 1].head;
+		if(this->blks[prev].free) {
+			__sunxi_unlink_free(this, prev);
+			units += this->blks[prev].units;
+			this->blks[idx].units = 0;
+			idx = prev;
 		}
-		kfree(*pphead);
-		*pphead = NULL;
 	}
 
-	return true;
+	__sunxi_mark_block(this, idx, units);
+	__sunxi_link_free(this, idx);
+	return;
+
+bad:
+	this->stats.bad_frees++;
+	SXM_ERR("%s err, 0x%08x was not allocated\n", __func__, physAddr);
 }
 
-bool sunxi_allocate(struct sunxi_mem_allocator *this, const u32 size_to_alloc,
-		u32* const pvirt_adr, u32* const pphy_adr)
+#ifdef CONFIG_DEBUG_FS
+static int sunxi_mem_stats_show(struct seq_file *m, void *unused)
 {
-	u32 	size;
-	struct mem_list *pnode = NULL;
-
-	size = (size_to_alloc + (MEMORY_GAP_MIN - 1)) & (~(MEMORY_GAP_MIN - 1));
-	pnode = this->find_free_block(this, size);
-	if(pnode == NULL)
-		return false;
+	struct sunxi_mem_allocator *this = g_allocator;
+	struct sxm_stats stats;
+	u32	count[SXM_CLASSES];
+	u32	total, rest, largest = 0, blocks = 0;
+	struct sxm_blk *blk;
+	unsigned long	flags;
+	int	n;
 
-	if(pnode->size - size >= MEMORY_GAP_MIN) {
-		struct mem_list * pnew_node = this->create_new_node(this,
-					pnode->size - size,
-					pnode->virt_addr + size,
-					pnode->phys_addr + size);
-		this->add_node_to_freelist(this, pnew_node);
+	if(NULL == this)
+		return 0;
 
-		pnode->size = size;
+	spin_lock_irqsave(&sunxi_memlock, flags);
+	total = this->total_size;
+	rest = this->normal_size;
+	stats = this->stats;
+	memcpy(count, this->free_count, sizeof(count));
+	if(this->free_map) {
+		n = fls(this->free_map) - 1;
+		list_for_each_entry(blk, &this->free_lists[n], list)
+			largest = max_t(u32, largest, blk->units * MEMORY_GAP_MIN);
 	}
+	spin_unlock_irqrestore(&sunxi_memlock, flags);
 
-	__sunxi_insert_node_before(pnode, __sunxi_first_node(this->inuse_listh));
-	this->normal_size -= size;
+	for(n = 0; n < SXM_CLASSES; n++)
+		blocks += count[n];
+
+	seq_printf(m, "total:       %u KB\n", total >> 10);
+	seq_printf(m, "free:        %u KB\n", rest >> 10);
+	seq_printf(m, "largest:     %u KB\n", largest >> 10);
+	seq_printf(m, "free blocks: %u\n", blocks);
+	/* per mille of the free memory not in the largest block */
+	seq_printf(m, "frag:        %u\n", rest ? (u32)(1000 - div_u64((u64)largest * 1000, rest)) : 0);
+	seq_printf(m, "allocs:      %u\n", stats.allocs);
+	seq_printf(m, "frees:       %u\n", stats.frees);
+	seq_printf(m, "fails:       %u (%u fragmented)\n", stats.fails, stats.fails_frag);
+	seq_printf(m, "bad frees:   %u\n", stats.bad_frees);
+	seq_printf(m, "free blocks by size:\n");
+	for(n = 0; n < SXM_CLASSES; n++)
+		if(count[n])
+			seq_printf(m, "  >= %6u KB: %u\n", (MEMORY_GAP_MIN << n) >> 10, count[n]);
 
-	*pvirt_adr = pnode->virt_addr;
-	*pphy_adr = pnode->phys_addr;
-	return true;
+	return 0;
 }
 
-void sunxi_free(struct sunxi_mem_allocator *this, const u32 virtAddr, const u32 physAddr)
+static int sunxi_mem_stats_open(struct inode *inode, struct file *file)
 {
-	u32 dwsize;
-
-	struct mem_list * pnode = __sunxi_first_node(this->inuse_listh);
-
-	while(!LIST_REACH_END(this->inuse_listh, pnode)) {
-		if((pnode->virt_addr ==  virtAddr) &&
-			(pnode->phys_addr ==  physAddr)) {
-			dwsize = pnode->size;
-			__sunxi_remove_node(pnode);
-			this->add_node_to_freelist(this, pnode);
-			this->normal_size += dwsize;
-			return;
-		}
-		pnode = pnode->next;
-	}
+	return single_open(file, sunxi_mem_stats_show, NULL);
+}
+
+static const struct file_operations sunxi_mem_stats_fops = {
+	.open		= sunxi_mem_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init sunxi_mem_debugfs_init(void)
+{
+	debugfs_create_file("sunxi_physmem", S_IRUGO, NULL, NULL, &sunxi_mem_stats_fops);
 }
+#else
+static inline void sunxi_mem_debugfs_init(void) { }
+#endif
 
 int __init sunxi_mem_allocator_init(void)
 {
@@ -294,7 +297,7 @@ int __init sunxi_mem_allocator_init(void)
 	u32 	buf_vaddr = BUFFER_VADDR;
 	u32 	buf_paddr = BUFFER_PADDR;
 
-	g_allocator = kmalloc(sizeof(struct sunxi_mem_allocator), GFP_KERNEL);
+	g_allocator = kzalloc(sizeof(struct sunxi_mem_allocator), GFP_KERNEL);
 	if(NULL == g_allocator) {
 		SXM_ERR("%s err: out of memory, line %d\n", __func__, __LINE__);
 		return -ENOMEM;
@@ -305,18 +308,16 @@ int __init sunxi_mem_allocator_init(void)
 	g_allocator->allocate 	= sunxi_allocate;
 	g_allocator->free 	= sunxi_free;
 
-	g_allocator->add_node_to_freelist = sunxi_add_node_to_freelist;
-	g_allocator->delete_node 	= sunxi_delete_node;
-	g_allocator->create_new_node 	= sunxi_create_new_node;
-	g_allocator->find_free_block 	= sunxi_find_free_block;
-	g_allocator->free_list 		= sunxi_free_list;
-
 	if(0 != g_allocator->init(g_allocator, buf_size, buf_vaddr, buf_paddr)) {
 		SXM_ERR("%s err, line %d, size 0x%08x, vaddr 0x%08x, paddr 0x%08x\n",
 			__func__, __LINE__, buf_size, buf_vaddr, buf_paddr);
+		kfree(g_allocator);
+		g_allocator = NULL;
 		return -ENOMEM;
 	}
 
+	sunxi_mem_debugfs_init();
+
 	SXM_DBG("%s success, line %d\n", __func__, __LINE__);
 	return 0;
 }
@@ -371,4 +372,3 @@ u32 sunxi_mem_get_rest_size(void)
 	return ret;
 }
 EXPORT_SYMBOL(sunxi_mem_get_rest_size);
-
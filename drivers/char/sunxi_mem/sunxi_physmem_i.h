@@ -17,6 +17,7 @@
 #define __SUNXI_PHYSMEM_I_H
 
 #include <linux/spinlock.h>
+#include <linux/list.h>
 
 /*
  * sxm print macro
@@ -53,12 +54,29 @@
 #define SUNMM_UNLOCK(lock, flag)	spin_unlock_irqrestore((lock), (flag))
 #endif
 
-struct mem_list {
-	u32	   	virt_addr;
-	u32	   	phys_addr;
-	u32	   	size;
-	struct mem_list *next;
-	struct mem_list *prev;
+/*
+ * The pool is managed in units of MEMORY_GAP_MIN. Every block, free or
+ * in use, has a boundary tag at its first unit (size, free flag, list
+ * node) and the index of its first unit at its last unit, so the
+ * neighbours of a block are found in O(1) when it is freed. Free
+ * blocks sit on segregated lists, list n holding the blocks of
+ * [2^n, 2^(n+1)) units, with a bitmap of the non-empty lists.
+ */
+#define SXM_CLASSES			16
+
+struct sxm_blk {
+	u16	   	units;		/* at the first unit, 0 elsewhere */
+	u16	   	head;		/* at the last unit, index of the first */
+	u8	   	free;
+	struct list_head list;		/* on a free list */
+};
+
+struct sxm_stats {
+	u32	   	allocs;
+	u32	   	frees;
+	u32	   	fails;		/* no free block large enough */
+	u32	   	fails_frag;	/* ... although enough was free */
+	u32	   	bad_frees;
 };
 
 struct sunxi_mem_allocator {
@@ -69,17 +87,16 @@ struct sunxi_mem_allocator {
 		u32* const pvirt_adr, u32* const pphy_adr);
 	void (*free)(struct sunxi_mem_allocator *this, const u32 virtAddr, const u32 physAddr);
 
-	bool 		(*add_node_to_freelist)(struct sunxi_mem_allocator *this, struct mem_list * pNode);
-	bool 		(*delete_node)(struct sunxi_mem_allocator *this, struct mem_list * pNode);
-	struct mem_list * (*create_new_node)(struct sunxi_mem_allocator *this, u32 size,
-					u32 virt_addr, u32 phys_addr);
-	struct mem_list * (*find_free_block)(struct sunxi_mem_allocator *this, u32 size);
-	bool 		(*free_list)(struct sunxi_mem_allocator *this, struct mem_list * *ppHead);
-
-	u32	   	normal_size;
-	struct mem_list *node_free_listh;
-	struct mem_list *free_listh;
-	struct mem_list *inuse_listh;
+	u32	   	normal_size;	/* free bytes */
+	u32	   	total_size;
+	u32	   	virt_base;
+	u32	   	phys_base;
+	u32	   	nr_units;
+	struct sxm_blk	*blks;
+	struct list_head free_lists[SXM_CLASSES];
+	unsigned long	free_map;	/* bit n: free_lists[n] not empty */
+	u32	   	free_count[SXM_CLASSES];
+	struct sxm_stats stats;
 };
 
 struct sunxi_mem_des {
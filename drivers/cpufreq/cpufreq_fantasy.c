@@ -58,6 +58,16 @@
 #define IOWAIT_FREQ_STEP_LIMIT3     (816000)   /* frequency limited to  816Mhz when iowait is [30, 40)  */
 #define IOWAIT_FREQ_STEP_LIMIT4     (1008000)  /* frequency limited to 1008Mhz when iowait is [40, 100) */
 
+#define FANTASY_PLAYBACK_FREQ       (600000)   /* frequency floor while userspace reports media playback    */
+#define FANTASY_INPUT_BOOST_FREQ    (816000)   /* frequency floor after an input event, 0 for the max burst */
+#define FANTASY_INPUT_BOOST_MS      (1000)     /* how long the input floor is held                          */
+
+#define FANTASY_HOTPLUG_UP_LOAD     (85)       /* average load of the online cpus to plug one more          */
+#define FANTASY_HOTPLUG_DOWN_LOAD   (30)       /* average load of the online cpus to unplug one             */
+#define FANTASY_HOTPLUG_UP_SAMPLES  (2)        /* samples above the up load before a cpu is plugged         */
+#define FANTASY_HOTPLUG_DOWN_SAMPLES (10)      /* samples below the down load before a cpu is unplugged     */
+#define FANTASY_HOTPLUG_MIN_ONLINE  (3000)     /* ms a cpu stays online at least once it was plugged        */
+
 
 enum cpufreq_fantasy_step {
     CPUFREQ_FANTASY_STEP1,      /* step1 for fantasy policy, adjust cpu frequency to the maximum value      */
@@ -103,16 +113,60 @@ static struct cpu_dbs_info_s {
     struct mutex timer_mutex;                   /* mutex for timer operation        */
     enum cpufreq_fantasy_step step;             /* policy state machine             */
     struct delayed_work work;                   /* timer proc for workqueue         */
+    unsigned long boost_until;                  /* jiffies the input floor ends     */
 } fantasy_dbs_info;
 
 
 static struct dbs_tuners {
     unsigned int sampling_rate; /* cpu loading statistic frequency                                  */
     unsigned int io_is_busy;    /* flag to mark that if io wait time should be count in idle time   */
+    unsigned int playback;      /* userspace hint, media playback is active                         */
+    unsigned int playback_freq; /* frequency floor during playback                                  */
+    unsigned int input_boost_freq;  /* frequency floor after an input event                         */
+    unsigned int input_boost_ms;    /* duration of the input floor                                  */
+    unsigned int hotplug;           /* let the governor plug and unplug cpus                        */
+    unsigned int hotplug_up_load;
+    unsigned int hotplug_down_load;
+    unsigned int hotplug_up_samples;
+    unsigned int hotplug_down_samples;
+    unsigned int hotplug_min_online_ms;
 } dbs_tuners_ins = {
     .sampling_rate = TRANSITION_LATENCY_LIMIT,      /* default sample rate is                       */
+    .playback_freq = FANTASY_PLAYBACK_FREQ,
+    .input_boost_freq = FANTASY_INPUT_BOOST_FREQ,
+    .input_boost_ms = FANTASY_INPUT_BOOST_MS,
+#ifdef CONFIG_HOTPLUG_CPU
+    .hotplug = 1,
+#endif
+    .hotplug_up_load = FANTASY_HOTPLUG_UP_LOAD,
+    .hotplug_down_load = FANTASY_HOTPLUG_DOWN_LOAD,
+    .hotplug_up_samples = FANTASY_HOTPLUG_UP_SAMPLES,
+    .hotplug_down_samples = FANTASY_HOTPLUG_DOWN_SAMPLES,
+    .hotplug_min_online_ms = FANTASY_HOTPLUG_MIN_ONLINE,
 };
 
+#ifdef CONFIG_HOTPLUG_CPU
+/* load tracking of every online cpu, for the hotplug decision */
+struct fantasy_cpu_load {
+    cputime64_t prev_idle;
+    cputime64_t prev_wall;
+    unsigned long online_since;                 /* jiffies the cpu was first seen online */
+    int tracked;
+};
+static DEFINE_PER_CPU(struct fantasy_cpu_load, fantasy_cpu_load);
+
+static struct fantasy_hotplug {
+    unsigned int up_cnt;                        /* consecutive samples above the up load    */
+    unsigned int down_cnt;                      /* consecutive samples below the down load  */
+    int request;                                /* 1 to plug a cpu, -1 to unplug one        */
+    int stopped;
+    unsigned int plugged;
+    unsigned int unplugged;
+    unsigned int held;                          /* unplugs put off by playback or input     */
+    struct work_struct work;
+} fantasy_hp;
+#endif
+
 static struct workqueue_struct    *kfantasy_wq;     /* work queue for process cpu dynamic frequency */
 
 static DEFINE_MUTEX(dbs_mutex); /* mutex for protect dbs start/stop                                 */
@@ -242,16 +296,21 @@ static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu, cputime64_t
 *
 *********************************************************************************************************
 */
-static inline cputime64_t get_cpu_idle_time(cputime64_t *wall)
+static inline cputime64_t get_cpu_idle_time_of(unsigned int cpu, cputime64_t *wall)
 {
-    u64 idle_time = get_cpu_idle_time_us(fantasy_dbs_info.cur_policy->cpu, wall);
+    u64 idle_time = get_cpu_idle_time_us(cpu, wall);
 
     if (idle_time == -1ULL)
-        return get_cpu_idle_time_jiffy(fantasy_dbs_info.cur_policy->cpu, wall);
+        return get_cpu_idle_time_jiffy(cpu, wall);
 
     return idle_time;
 }
 
+static inline cputime64_t get_cpu_idle_time(cputime64_t *wall)
+{
+    return get_cpu_idle_time_of(fantasy_dbs_info.cur_policy->cpu, wall);
+}
+
 
 /*
 *********************************************************************************************************
@@ -301,6 +360,221 @@ static inline cputime64_t get_cpu_iowait_time(cputime64_t *wall)
 }
 
 
+/*
+*********************************************************************************************************
+*                           fantasy_set_freq
+*
+*Description: set cpu frequency, but not below the floor of the playback and input hints.
+*
+*Arguments  : policy    cpu frequency policy crrent using.
+*             target    target frequency;
+*             relation  relation to the target frequency;
+*
+*Return     : result of __cpufreq_driver_target.
+*
+*Notes      : the floors are limited by policy->max, scaling_max_freq still wins.
+*
+*********************************************************************************************************
+*/
+static inline int fantasy_boosted(void)
+{
+    return dbs_tuners_ins.input_boost_freq &&
+        time_before(jiffies, fantasy_dbs_info.boost_until);
+}
+
+static unsigned int fantasy_floor(struct cpufreq_policy *policy)
+{
+    unsigned int floor = 0;
+
+    if (dbs_tuners_ins.playback)
+        floor = dbs_tuners_ins.playback_freq;
+    if (fantasy_boosted() && floor < dbs_tuners_ins.input_boost_freq)
+        floor = dbs_tuners_ins.input_boost_freq;
+
+    return min(floor, policy->max);
+}
+
+static int fantasy_set_freq(struct cpufreq_policy *policy, unsigned int target, unsigned int relation)
+{
+    unsigned int floor = fantasy_floor(policy);
+
+    if (target < floor) {
+        target = floor;
+        relation = CPUFREQ_RELATION_L;
+    }
+
+    return __cpufreq_driver_target(policy, target, relation);
+}
+
+
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+*********************************************************************************************************
+*                           fantasy_hotplug_work
+*
+*Description: plug or unplug a cpu as requested by fantasy_hotplug_check.
+*
+*Arguments  : work  fantasy_hp.work;
+*
+*Return     : none
+*
+*Notes      : runs on cpu0, which is never unplugged, and outside of timer_mutex: cpu_down goes
+*             through the cpufreq hotplug notifier, which takes the policy lock.
+*
+*********************************************************************************************************
+*/
+static void fantasy_hotplug_work(struct work_struct *work)
+{
+    int request = xchg(&fantasy_hp.request, 0);
+    unsigned int cpu;
+
+    if (fantasy_hp.stopped)
+        return;
+
+    if (request > 0) {
+        cpu = cpumask_next_zero(0, cpu_online_mask);
+        if (cpu < nr_cpu_ids && cpu_present(cpu) && !cpu_up(cpu)) {
+            FANTASY_DBG("cpu%u plugged\n", cpu);
+            fantasy_hp.plugged++;
+        }
+    } else if (request < 0) {
+        for (cpu = nr_cpu_ids - 1; cpu > 0; cpu--)
+            if (cpu_online(cpu))
+                break;
+        if (cpu > 0 && !cpu_down(cpu)) {
+            FANTASY_DBG("cpu%u unplugged\n", cpu);
+            fantasy_hp.unplugged++;
+        }
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                           fantasy_hotplug_check
+*
+*Description: decide on cpu hotplug from the average load of the online cpus.
+*
+*Arguments  : none
+*
+*Return     : none
+*
+*Notes      : a cpu is plugged after hotplug_up_samples samples above hotplug_up_load, and unplugged
+*             after hotplug_down_samples samples below hotplug_down_load, once it has been online
+*             for hotplug_min_online_ms. No cpu is unplugged during playback or an input boost, an
+*             unplug costs a few ms on the remaining core and shows as a dropped frame.
+*
+*********************************************************************************************************
+*/
+static void fantasy_hotplug_check(void)
+{
+    struct fantasy_cpu_load *load;
+    cputime64_t cur_idle_time, cur_wall_time;
+    unsigned int idle_time, wall_time;
+    unsigned int load_sum = 0, online = 0, last = 0, avg;
+    int fresh = 0;
+    int cpu;
+
+    if (!dbs_tuners_ins.hotplug)
+        return;
+
+    for_each_present_cpu(cpu) {
+        load = &per_cpu(fantasy_cpu_load, cpu);
+        if (!cpu_online(cpu)) {
+            load->tracked = 0;
+            continue;
+        }
+
+        cur_idle_time = get_cpu_idle_time_of(cpu, &cur_wall_time);
+        if (!load->tracked) {
+            /* just came up, from here or from userspace */
+            load->prev_idle = cur_idle_time;
+            load->prev_wall = cur_wall_time;
+            load->online_since = jiffies;
+            load->tracked = 1;
+            fresh = 1;
+            continue;
+        }
+
+        wall_time = (unsigned int)(cur_wall_time - load->prev_wall);
+        idle_time = (unsigned int)(cur_idle_time - load->prev_idle);
+        load->prev_wall = cur_wall_time;
+        load->prev_idle = cur_idle_time;
+
+        if (wall_time && wall_time >= idle_time)
+            load_sum += (wall_time - idle_time) * 100 / wall_time;
+        online++;
+        last = cpu;
+    }
+
+    /* the set of cpus changed, start counting again */
+    if (fresh || !online) {
+        fantasy_hp.up_cnt = 0;
+        fantasy_hp.down_cnt = 0;
+        return;
+    }
+
+    avg = load_sum / online;
+    FANTASY_DBG("%u cpus online, average load %u\n", online, avg);
+
+    if (avg >= dbs_tuners_ins.hotplug_up_load && online < num_present_cpus()) {
+        fantasy_hp.down_cnt = 0;
+        if (++fantasy_hp.up_cnt < dbs_tuners_ins.hotplug_up_samples)
+            return;
+        fantasy_hp.up_cnt = 0;
+        fantasy_hp.request = 1;
+    }
+    else if (avg < dbs_tuners_ins.hotplug_down_load && online > 1) {
+        fantasy_hp.up_cnt = 0;
+        if (++fantasy_hp.down_cnt < dbs_tuners_ins.hotplug_down_samples)
+            return;
+        if (dbs_tuners_ins.playback || fantasy_boosted()) {
+            fantasy_hp.held++;
+            return;
+        }
+        if (time_before(jiffies, per_cpu(fantasy_cpu_load, last).online_since +
+                        msecs_to_jiffies(dbs_tuners_ins.hotplug_min_online_ms)))
+            return;
+        fantasy_hp.down_cnt = 0;
+        fantasy_hp.request = -1;
+    }
+    else {
+        fantasy_hp.up_cnt = 0;
+        fantasy_hp.down_cnt = 0;
+        return;
+    }
+
+    queue_work_on(0, kfantasy_wq, &fantasy_hp.work);
+}
+
+
+static void fantasy_hotplug_start(void)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        per_cpu(fantasy_cpu_load, cpu).tracked = 0;
+    fantasy_hp.up_cnt = 0;
+    fantasy_hp.down_cnt = 0;
+    fantasy_hp.request = 0;
+    fantasy_hp.stopped = 0;
+}
+
+static void fantasy_hotplug_stop(void)
+{
+    /*
+     * not waiting for the work here, the policy lock is held and the work may be in cpu_down
+     * waiting for it; the work only touches fantasy_hp, module exit waits for it.
+     */
+    fantasy_hp.stopped = 1;
+}
+#else
+static inline void fantasy_hotplug_check(void) { }
+static inline void fantasy_hotplug_start(void) { }
+static inline void fantasy_hotplug_stop(void) { }
+#endif
+
+
 /*
 *********************************************************************************************************
 *                           do_dbs_timer
@@ -333,7 +607,7 @@ static void do_dbs_timer(struct work_struct *work)
             FANTASY_DBG("step1 : set cpu frequency to max value (%d)\n", fantasy_dbs_info.cur_policy->max);
             if(freq_cur != fantasy_dbs_info.cur_policy->max) {
                 /* adjust cpu frequncy to the maximum value */
-                __cpufreq_driver_target(fantasy_dbs_info.cur_policy, fantasy_dbs_info.cur_policy->max, CPUFREQ_RELATION_H);
+                fantasy_set_freq(fantasy_dbs_info.cur_policy, fantasy_dbs_info.cur_policy->max, CPUFREQ_RELATION_H);
             }
             fantasy_dbs_info.step = CPUFREQ_FANTASY_STEP2;
             break;
@@ -342,7 +616,7 @@ static void do_dbs_timer(struct work_struct *work)
         case CPUFREQ_FANTASY_STEP2: {
             /* adjust cpu frequncy to the maximum value */
             FANTASY_DBG("step2 : set cpu frequency to second max value\n");
-            __cpufreq_driver_target(fantasy_dbs_info.cur_policy, freq_cur-1000, CPUFREQ_RELATION_L);
+            fantasy_set_freq(fantasy_dbs_info.cur_policy, freq_cur-1000, CPUFREQ_RELATION_L);
             fantasy_dbs_info.step = CPUFREQ_FANTASY_STEP3;
             break;
         }
@@ -442,14 +716,14 @@ static void do_dbs_timer(struct work_struct *work)
                 }
 
                 /* set target frequency */
-                __cpufreq_driver_target(fantasy_dbs_info.cur_policy, freq_target, CPUFREQ_RELATION_L);
+                fantasy_set_freq(fantasy_dbs_info.cur_policy, freq_target, CPUFREQ_RELATION_L);
                 FANTASY_DBG("set cpu frequency to %d\n", freq_target);
             }
             else if(idle_rate < FANTASY_CPUFREQ_IDLE_MIN_RATE(freq_cur)) {
 			   	FANTASY_DBG("min idle rate is:%d\n", FANTASY_CPUFREQ_IDLE_MIN_RATE(freq_cur));
 
                 /* adjust cpu frequncy to the maximum value */
-                __cpufreq_driver_target(fantasy_dbs_info.cur_policy, fantasy_dbs_info.cur_policy->max, CPUFREQ_RELATION_H);
+                fantasy_set_freq(fantasy_dbs_info.cur_policy, fantasy_dbs_info.cur_policy->max, CPUFREQ_RELATION_H);
                 FANTASY_DBG("set cpu frequency to %d\n", fantasy_dbs_info.cur_policy->max);
                 fantasy_dbs_info.step = CPUFREQ_FANTASY_STEP2;
                 break;
@@ -493,7 +767,7 @@ static void do_dbs_timer(struct work_struct *work)
                 }
 
                 /* set target frequency */
-                __cpufreq_driver_target(fantasy_dbs_info.cur_policy, freq_target, CPUFREQ_RELATION_L);
+                fantasy_set_freq(fantasy_dbs_info.cur_policy, freq_target, CPUFREQ_RELATION_L);
                 FANTASY_DBG("set cpu frequency to %d\n", freq_target);
             }
 
@@ -507,7 +781,10 @@ static void do_dbs_timer(struct work_struct *work)
         }
     }
 
-    queue_delayed_work(kfantasy_wq, &fantasy_dbs_info.work, delay);
+    fantasy_hotplug_check();
+
+    /* stay on the policy cpu, the others may be unplugged from here */
+    queue_delayed_work_on(fantasy_dbs_info.cur_policy->cpu, kfantasy_wq, &fantasy_dbs_info.work, delay);
     mutex_unlock(&fantasy_dbs_info.timer_mutex);
 }
 
@@ -532,7 +809,7 @@ static void dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
     int delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
     /* init workqueue for process cpu frequency */
     INIT_DELAYED_WORK_DEFERRABLE(&dbs_info->work, do_dbs_timer);
-    queue_delayed_work(kfantasy_wq, &dbs_info->work, delay);
+    queue_delayed_work_on(dbs_info->cur_policy->cpu, kfantasy_wq, &dbs_info->work, delay);
 }
 
 
@@ -556,6 +833,113 @@ static void dbs_timer_exit(struct cpu_dbs_info_s *dbs_info)
 }
 
 
+/*
+ * tuners in /sys/devices/system/cpu/cpufreq/fantasy, while the governor runs. A media player writes
+ * 1 to playback when it starts and 0 when it stops.
+ */
+#define show_one(file_name, object)                                             \
+static ssize_t show_##file_name                                                 \
+(struct kobject *kobj, struct attribute *attr, char *buf)                       \
+{                                                                               \
+    return sprintf(buf, "%u\n", dbs_tuners_ins.object);                         \
+}
+
+#define store_one(file_name, object, min, max)                                  \
+static ssize_t store_##file_name                                                \
+(struct kobject *kobj, struct attribute *attr, const char *buf, size_t count)   \
+{                                                                               \
+    unsigned int input;                                                         \
+                                                                                \
+    if (sscanf(buf, "%u", &input) != 1 || input < (min) || input > (max))       \
+        return -EINVAL;                                                         \
+    dbs_tuners_ins.object = input;                                              \
+    return count;                                                               \
+}
+
+show_one(playback, playback);
+show_one(playback_freq, playback_freq);
+show_one(input_boost_freq, input_boost_freq);
+show_one(input_boost_ms, input_boost_ms);
+store_one(playback_freq, playback_freq, 0, UINT_MAX);
+store_one(input_boost_freq, input_boost_freq, 0, UINT_MAX);
+store_one(input_boost_ms, input_boost_ms, 0, 10000);
+
+static ssize_t store_playback(struct kobject *kobj, struct attribute *attr,
+                              const char *buf, size_t count)
+{
+    struct cpufreq_policy *policy = fantasy_dbs_info.cur_policy;
+    unsigned int input;
+
+    if (sscanf(buf, "%u", &input) != 1)
+        return -EINVAL;
+
+    mutex_lock(&fantasy_dbs_info.timer_mutex);
+    dbs_tuners_ins.playback = !!input;
+    /* raise to the floor now, not at the next sample */
+    if (dbs_tuners_ins.playback && policy->cur < fantasy_floor(policy))
+        fantasy_set_freq(policy, policy->cur, CPUFREQ_RELATION_L);
+    mutex_unlock(&fantasy_dbs_info.timer_mutex);
+
+    return count;
+}
+
+define_one_global_rw(playback);
+define_one_global_rw(playback_freq);
+define_one_global_rw(input_boost_freq);
+define_one_global_rw(input_boost_ms);
+
+#ifdef CONFIG_HOTPLUG_CPU
+show_one(hotplug, hotplug);
+show_one(hotplug_up_load, hotplug_up_load);
+show_one(hotplug_down_load, hotplug_down_load);
+show_one(hotplug_up_samples, hotplug_up_samples);
+show_one(hotplug_down_samples, hotplug_down_samples);
+show_one(hotplug_min_online_ms, hotplug_min_online_ms);
+store_one(hotplug, hotplug, 0, 1);
+store_one(hotplug_up_load, hotplug_up_load, 1, 100);
+store_one(hotplug_down_load, hotplug_down_load, 0, 99);
+store_one(hotplug_up_samples, hotplug_up_samples, 1, 100);
+store_one(hotplug_down_samples, hotplug_down_samples, 1, 1000);
+store_one(hotplug_min_online_ms, hotplug_min_online_ms, 0, 60000);
+
+static ssize_t show_hotplug_stats(struct kobject *kobj, struct attribute *attr, char *buf)
+{
+    return sprintf(buf, "plugged: %u\nunplugged: %u\nheld: %u\n",
+                   fantasy_hp.plugged, fantasy_hp.unplugged, fantasy_hp.held);
+}
+
+define_one_global_rw(hotplug);
+define_one_global_rw(hotplug_up_load);
+define_one_global_rw(hotplug_down_load);
+define_one_global_rw(hotplug_up_samples);
+define_one_global_rw(hotplug_down_samples);
+define_one_global_rw(hotplug_min_online_ms);
+define_one_global_ro(hotplug_stats);
+#endif
+
+static struct attribute *dbs_attributes[] = {
+    &playback.attr,
+    &playback_freq.attr,
+    &input_boost_freq.attr,
+    &input_boost_ms.attr,
+#ifdef CONFIG_HOTPLUG_CPU
+    &hotplug.attr,
+    &hotplug_up_load.attr,
+    &hotplug_down_load.attr,
+    &hotplug_up_samples.attr,
+    &hotplug_down_samples.attr,
+    &hotplug_min_online_ms.attr,
+    &hotplug_stats.attr,
+#endif
+    NULL
+};
+
+static struct attribute_group dbs_attr_group = {
+    .attrs = dbs_attributes,
+    .name = "fantasy",
+};
+
+
 /*
 *********************************************************************************************************
 *                           cpufreq_governor_dbs
@@ -576,14 +960,24 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy, unsigned int even
     unsigned int    cpu = policy->cpu;
     struct cpu_dbs_info_s *this_dbs_info = &fantasy_dbs_info;
     unsigned int    latency;
+    int             rc;
 
     switch (event){
         case CPUFREQ_GOV_START: {
             mutex_lock(&dbs_mutex);
 
+            /* init mutex for protecting timer process, the tuners take it too */
+            mutex_init(&this_dbs_info->timer_mutex);
+
             /* set cpu policy */
             this_dbs_info->cur_policy = policy;
 
+            rc = sysfs_create_group(cpufreq_global_kobject, &dbs_attr_group);
+            if (rc) {
+                mutex_unlock(&dbs_mutex);
+                return rc;
+            }
+
             /* initialise cpu idle time */
             this_dbs_info->prev_cpu_idle = get_cpu_idle_time(&this_dbs_info->prev_cpu_wall);
 
@@ -600,11 +994,9 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy, unsigned int even
 
             /* set if io wait should be counted in cpu idle */
             dbs_tuners_ins.io_is_busy = IOWAIT_IS_BUSY;
+            fantasy_hotplug_start();
             mutex_unlock(&dbs_mutex);
 
-            /* init mutex for protecting timer process */
-            mutex_init(&this_dbs_info->timer_mutex);
-
             /* init tuners state machine */
             fantasy_dbs_info.step = CPUFREQ_FANTASY_STEP1;
 
@@ -614,6 +1006,8 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy, unsigned int even
         }
 
         case CPUFREQ_GOV_STOP: {
+            sysfs_remove_group(cpufreq_global_kobject, &dbs_attr_group);
+            fantasy_hotplug_stop();
             /* delete timer */
             dbs_timer_exit(this_dbs_info);
             mutex_lock(&dbs_mutex);
@@ -636,6 +1030,18 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy, unsigned int even
 
         #ifdef CONFIG_CPU_FREQ_USR_EVNT_NOTIFY
         case CPUFREQ_GOV_USRENET: {
+            if (dbs_tuners_ins.input_boost_freq) {
+                /* hold the input floor for a while, the load decides above it */
+                fantasy_dbs_info.boost_until = jiffies + msecs_to_jiffies(dbs_tuners_ins.input_boost_ms);
+                /* a sample is running if the lock is taken, it sees the floor */
+                if (!mutex_trylock(&this_dbs_info->timer_mutex))
+                    break;
+                if (policy->cur < fantasy_floor(policy))
+                    fantasy_set_freq(policy, policy->cur, CPUFREQ_RELATION_L);
+                mutex_unlock(&this_dbs_info->timer_mutex);
+                break;
+            }
+
             /* cpu frequency limitation has changed, adjust current frequency */
             if(!mutex_trylock(&this_dbs_info->timer_mutex)) {
                 FANTASY_DBG("CPUFREQ_GOV_USRENET try to lock mutex failed!\n");
@@ -680,6 +1086,9 @@ static int __init cpufreq_gov_dbs_init(void)
         printk(KERN_ERR "Creation of kfantasy failed\n");
         return -EFAULT;
     }
+#ifdef CONFIG_HOTPLUG_CPU
+    INIT_WORK(&fantasy_hp.work, fantasy_hotplug_work);
+#endif
     /* register cpu frequency governor into cpu-freq core */
     err = cpufreq_register_governor(&cpufreq_gov_fantasy);
     if (err) {
@@ -708,6 +1117,9 @@ static void __exit cpufreq_gov_dbs_exit(void)
 {
     /* unregister cpu frequency governor */
     cpufreq_unregister_governor(&cpufreq_gov_fantasy);
+#ifdef CONFIG_HOTPLUG_CPU
+    cancel_work_sync(&fantasy_hp.work);
+#endif
     /* destroy work queue */
     destroy_workqueue(kfantasy_wq);
 }
@@ -37,6 +37,13 @@
 #include <linux/scatterlist.h> 
 #include <linux/interrupt.h> 
 #include <linux/delay.h> 
+#include <linux/dma-mapping.h> 
+#include <linux/workqueue.h> 
+#include <linux/completion.h> 
+#include <linux/ktime.h> 
+#include <linux/random.h> 
+#include <crypto/algapi.h> 
+#include <asm/unaligned.h> 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_MD5 
 #include <crypto/md5.h> 
 #define SUNXI_SS_HASH_COMMON 
@@ -47,9 +54,17 @@
 #endif 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_AES 
 #include <crypto/aes.h> 
+#define SUNXI_SS_CIPHER_COMMON 
+#endif 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_DES 
+#include <crypto/des.h> 
+#define SUNXI_SS_CIPHER_COMMON 
 #endif 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_PRNG 
 #include <crypto/internal/rng.h> 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_HWRNG 
+#include <linux/hw_random.h> 
+#endif 
  
 struct prng_context { 
         u8 seed[192/8]; 
@@ -87,15 +102,19 @@ struct prng_context {
  
 #define DMA_MAGIC_RX 0x03030300 
 #define DMA_MAGIC_TX 0x03030303 
+#define SUNXI_SS_QUEUE_LEN 50 
 /*#define SUNXI_SS_WAIT_QUEUE*/ 
  
 static int use_dma; 
 module_param_named(use_dma, use_dma, int, S_IRUGO | S_IWUSR); 
+/* measure at boot the size under which the generic ciphers are faster */ 
+static int calibrate = 1; 
+module_param_named(calibrate, calibrate, int, S_IRUGO); 
 /* We use DMA only if we are forced to do so (use_dma=1) or if we think DMA 
  * will produce better performance (use_dma=2) 
  * The final driver certainly use only the last mode */ 
  
-/* TODO check for alignment ? */ 
+/* the segments must also be word aligned, see sunxi_aes_use_dma() */ 
 #define USE_DMA(len) ((use_dma == 1) || (use_dma == 2 && len > 1024)) 
  
 static struct sunxi_ss_ctx { 
@@ -105,19 +124,20 @@ static struct sunxi_ss_ctx {
         struct clk *ssclk; 
         struct device *dev; 
         struct resource *res; 
-        u64 byte_count; /* number of bytes "uploaded" to the device */ 
-        u32 waiting; /* a word waiting to be uploaded to the device */ 
-        unsigned int nbwait; /* number of bytes to be uploaded in the waiting word */ 
         void *buf_in; /* pointer to data to be uploaded to the device */ 
         size_t buf_in_size; 
-        void *buf_out; 
-        size_t buf_out_size; 
         u32 method;/* MD5/SHA1/AES*/ 
         int rxdma_init, txdma_init, rxdma_start, txdma_start; 
+        int rxdma_left, txdma_left; /* segments still queued on the DMA */ 
+        struct completion rxdma_done, txdma_done; 
+        struct crypto_queue queue; /* requests waiting for the SS */ 
+        spinlock_t queue_lock; 
+        struct workqueue_struct *wq; 
+        struct work_struct work; 
+        struct work_struct calib_work; 
 } _ss_ctx, *ss_ctx = &_ss_ctx; 
  
 static DEFINE_MUTEX(lock); 
-static DEFINE_MUTEX(bufout_lock); 
 #ifdef SUNXI_SS_WAIT_QUEUE 
 DECLARE_WAIT_QUEUE_HEAD(dma_queue); 
 #endif 
@@ -125,7 +145,13 @@ DECLARE_WAIT_QUEUE_HEAD(dma_queue);
 struct sunxi_req_ctx { 
         u8 key[AES_KEY_MAX_LENGTH * 8]; 
         u32 keylen; 
-        u32 mode; 
+        u32 mode; /* SUNXI_OP_* and SUNXI_SS_ECB/CBC, set from sunxi_cipher_alg */ 
+        struct crypto_blkcipher *fallback; /* for requests under the threshold */ 
+}; 
+ 
+/* per request context for ablkcipher */ 
+struct sunxi_aes_reqctx { 
+        u32 mode; /* SUNXI_SS_ENCRYPTION or SUNXI_SS_DECRYPTION */ 
 }; 
  
 /*============================================================================*/ 
@@ -148,13 +174,20 @@ static struct sunxi_dma_params ssrx_dma = {
  
 /*============================================================================*/ 
 /*============================================================================*/ 
+/* called for each buffer done, the channel is done with the last one */ 
 static void ssrx_dma_buffdone(struct sunxi_dma_params *dma, void *arg) 
 { 
 #ifdef DEBUG_SS_DMA 
         dev_info(ss_ctx->dev, "DMA RX done\n"); 
 #endif 
+        if (ss_ctx->rxdma_left > 1) { 
+                ss_ctx->rxdma_left--; 
+                return; 
+        } 
+        ss_ctx->rxdma_left = 0; 
         ss_ctx->rxdma_start = 0; 
         /*atomic_set(&ss_ctx->rxdma_start, 0);*/ 
+        complete(&ss_ctx->rxdma_done); 
 #ifdef SUNXI_SS_WAIT_QUEUE 
         wake_up_interruptible(&dma_queue); 
 #endif 
@@ -167,8 +200,14 @@ static void sstx_dma_buffdone(struct sunxi_dma_params *dma, void *arg)
 #ifdef DEBUG_SS_DMA 
         dev_info(ss_ctx->dev, "DMA TX done\n"); 
 #endif 
+        if (ss_ctx->txdma_left > 1) { 
+                ss_ctx->txdma_left--; 
+                return; 
+        } 
+        ss_ctx->txdma_left = 0; 
         ss_ctx->txdma_start = 0; 
         /*atomic_set(&ss_ctx->txdma_start, 0);*/ 
+        complete(&ss_ctx->txdma_done); 
 #ifdef SUNXI_SS_WAIT_QUEUE 
         wake_up_interruptible(&dma_queue); 
 #endif 
@@ -227,33 +266,51 @@ static int ss_sunxi_release_dma(struct sunxi_dma_params *sdma)
 /*============================================================================*/ 
 /* prepare the DMA and send data */ 
 /* notice the fact D_DST_SS_TX is an error, we send on RX 
- * same comment for the ss_dma_recv() who read from TX 
+ * same comment for the TX channel who read from D_SRC_SS_RX 
  * This is due to a typo/error in user manual 
  * TODO change the DMA header for correcting this */ 
+static dma_config_t ss_send_hwconf = { 
+        .xfer_type = { 
+                .src_data_width = DATA_WIDTH_32BIT, 
+                .src_bst_len    = DATA_BRST_1, 
+                .dst_data_width = DATA_WIDTH_32BIT, 
+                .dst_bst_len    = DATA_BRST_1 
+        }, 
+        .address_type = { 
+                .src_addr_mode  = DDMA_ADDR_LINEAR, 
+                .dst_addr_mode  = DDMA_ADDR_IO 
+        }, 
+        .bconti_mode    = false, 
+        .src_drq_type   = D_SRC_SDRAM, 
+        .dst_drq_type   = D_DST_SS_TX, 
+        .irq_spt        = CHAN_IRQ_FD 
+}; 
+ 
+static dma_config_t ss_recv_hwconf = { 
+        .xfer_type = { 
+                .src_data_width = DATA_WIDTH_32BIT, 
+                .src_bst_len    = DATA_BRST_1, 
+                .dst_data_width = DATA_WIDTH_32BIT, 
+                .dst_bst_len    = DATA_BRST_1 
+        }, 
+        .address_type = { 
+                .src_addr_mode  = DDMA_ADDR_IO, 
+                .dst_addr_mode  = DDMA_ADDR_LINEAR 
+        }, 
+        .bconti_mode    = false, 
+        .src_drq_type   = D_SRC_SS_RX, 
+        .dst_drq_type   = D_DST_SDRAM, 
+        .irq_spt        = CHAN_IRQ_FD 
+}; 
+ 
 static int ss_dma_send(dma_addr_t buff_addr, __u32 len, int start) 
 { 
         int ret; 
-        dma_config_t ss_hwconf = { 
-                .xfer_type = { 
-                        .src_data_width = DATA_WIDTH_32BIT, 
-                        .src_bst_len    = DATA_BRST_1, 
-                        .dst_data_width = DATA_WIDTH_32BIT, 
-                        .dst_bst_len    = DATA_BRST_1 
-                }, 
-                .address_type = { 
-                        .src_addr_mode  = DDMA_ADDR_LINEAR, 
-                        .dst_addr_mode  = DDMA_ADDR_IO 
-                }, 
-                .bconti_mode    = false, 
-                .src_drq_type   = D_SRC_SDRAM, 
-                .dst_drq_type   = D_DST_SS_TX, 
-                .irq_spt        = CHAN_IRQ_FD 
-        }; 
         /* value sended for DMA_OP_SET_PARA_REG 
          * 0x7f077f07 for nand and 0x03030303 for emac 
          * For the moment I put the same value of emac, must investigate more 
          * */ 
-        ret = sunxi_dma_config(&ssrx_dma, &ss_hwconf, DMA_MAGIC_RX); 
+        ret = sunxi_dma_config(&ssrx_dma, &ss_send_hwconf, DMA_MAGIC_RX); 
         if (ret != 0) 
                 return ret; 
         ret = sunxi_dma_enqueue(&ssrx_dma, buff_addr, len, 0); 
@@ -276,49 +333,39 @@ static int ss_dma_send(dma_addr_t buff_addr, __u32 len, int start)
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* prepare the DMA for receiving data from the device */ 
-static int ss_dma_recv(dma_addr_t buff_addr, __u32 len) 
+/* queue the mapped segments of sg, up to nbytes, on dma 
+ * The DMA core starts each one from the interrupt of the previous one, so a 
+ * whole scatterlist moves without coming back to the caller. 
+ * The length of every segment is or'ed in lenbits for sunxi_ss_trigger(). 
+ * Return the number of segments queued or the error */ 
+static int ss_dma_queue_sg(struct sunxi_dma_params *dma, dma_config_t *conf, 
+                unsigned int magic, struct scatterlist *sg, int nents, 
+                unsigned int nbytes, int read, unsigned int *lenbits) 
 { 
-        int ret; 
-        dma_config_t ss_rx_hwconf = { 
-                .xfer_type = { 
-                        .src_data_width = DATA_WIDTH_32BIT, 
-                        .src_bst_len    = DATA_BRST_1, 
-                        .dst_data_width = DATA_WIDTH_32BIT, 
-                        .dst_bst_len    = DATA_BRST_1 
-                }, 
-                .address_type = { 
-                        .src_addr_mode  = DDMA_ADDR_IO, 
-                        .dst_addr_mode  = DDMA_ADDR_LINEAR 
-                }, 
-                .bconti_mode    = false, 
-                .src_drq_type   = D_SRC_SS_RX, 
-                .dst_drq_type   = D_DST_SDRAM, 
-                .irq_spt        = CHAN_IRQ_FD 
-        }; 
-        ret = sunxi_dma_config(&sstx_dma, &ss_rx_hwconf, DMA_MAGIC_TX); 
+        unsigned int len; 
+        int i, ret; 
+ 
+        ret = sunxi_dma_config(dma, conf, magic); 
         if (ret != 0) { 
                 dev_err(ss_ctx->dev, "sunxi_dma_config() error\n"); 
-                return ret; 
-        } 
-        /* TODO a DEFINE must be done for this 1 */ 
-        ret = sunxi_dma_enqueue(&sstx_dma, buff_addr, len, 1); 
-        if (ret != 0) { 
-                dev_err(ss_ctx->dev, "sunxi_dma_enqueue() error\n"); 
-                return ret; 
+                return -EIO; 
         } 
+        for (i = 0; i < nents && nbytes > 0; i++) { 
+                len = min_t(unsigned int, sg_dma_len(sg), nbytes); 
+                ret = sunxi_dma_enqueue(dma, sg_dma_address(sg), len, read); 
+                if (ret != 0) { 
+                        dev_err(ss_ctx->dev, "sunxi_dma_enqueue() error\n"); 
+                        return -EIO; 
+                } 
 #ifdef DEBUG_SS_DMA 
-        dev_info(ss_ctx->dev, "TX DMA started from=%x len=%u\n", 
-                        buff_addr, len); 
+                dev_info(ss_ctx->dev, "%s DMA queued %x len=%u\n", 
+                                read ? "TX" : "RX", sg_dma_address(sg), len); 
 #endif 
-        ss_ctx->txdma_start = 1; 
-        ret = sunxi_dma_start(&sstx_dma); 
-        if (ret != 0) { 
-                dev_err(ss_ctx->dev, "ERROR sunxi_dma_start()\n"); 
-                ss_ctx->txdma_start = 0; 
-                return ret; 
+                *lenbits |= len; 
+                nbytes -= len; 
+                sg = sg_next(sg); 
         } 
-        return 0; 
+        return i; 
 } 
  
 /*============================================================================*/ 
@@ -339,6 +386,25 @@ static int sg_count(struct scatterlist *sg_list, int nbytes)
         return sg_nents; 
 } 
  
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* the DMA moves words, so every segment used by the request must start on a 
+ * word and all but the last must end on one */ 
+static int sg_aligned(struct scatterlist *sg, unsigned int nbytes) 
+{ 
+        while (nbytes > 0 && sg != NULL) { 
+                if (!IS_ALIGNED(sg->offset, 4)) 
+                        return 0; 
+                if (sg->length >= nbytes) 
+                        return 1; 
+                if (!IS_ALIGNED(sg->length, 4)) 
+                        return 0; 
+                nbytes -= sg->length; 
+                sg = scatterwalk_sg_next(sg); 
+        } 
+        return 1; 
+} 
+ 
 /*============================================================================*/ 
 /*============================================================================*/ 
 /* This function try to calculate the good value to be set on trigger register 
@@ -382,326 +448,203 @@ static void sunxi_ss_trigger(const size_t len_r, const size_t len_t,
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* sunxi_ss_send: sends 32 bits through the FIFO 
- * 
- * It maintains a count of the number of free spaces on the queue 
- * to keep a decent speed. 
- * TODO reset the value after a DMA ? 
- */ 
-static void sunxi_ss_send(struct sunxi_ss_ctx *ctx, u32 value) 
+/* Request queue 
+ * All requests are queued and handled one by one by sunxi_ss_queue_worker() 
+ * since there is only one SS. The caller never sleeps on the device, it get 
+ * -EINPROGRESS and its callback is called when the request is done. 
+ * -EBUSY could be returned when the queue is full. */ 
+static int sunxi_ss_enqueue(struct crypto_async_request *req) 
 { 
-        static int spaces; 
-        u32 tmp; 
- 
-/*        dev_info(ss_ctx->dev, "DEBUG %s space=%d value=0x%08x\n", __func__, spaces, value);*/ 
- 
-        if (spaces < 1) { 
-                /* Wait until there are free spaces, then take note of 
-                 * how many of them there are */ 
-                do { 
-                        tmp = ioread32(ctx->base + SUNXI_SS_FCSR); 
-                } while ((tmp & SUNXI_RXFIFO_FREE) == 0); 
-                spaces = SUNXI_RXFIFO_SPACES(tmp); 
-                if (spaces < 1) { 
-                        dev_info(ss_ctx->dev, "DEBUG ERROR %s space=%d\n", __func__, spaces); 
-                        return; 
-                } 
-        } 
+        unsigned long flags; 
+        int ret; 
  
-        iowrite32(value, ctx->base + SUNXI_SS_RXFIFO); 
-        spaces--; 
+        spin_lock_irqsave(&ss_ctx->queue_lock, flags); 
+        ret = crypto_enqueue_request(&ss_ctx->queue, req); 
+        spin_unlock_irqrestore(&ss_ctx->queue_lock, flags); 
+        queue_work(ss_ctx->wq, &ss_ctx->work); 
+        return ret; 
 } 
  
 #ifdef SUNXI_SS_HASH_COMMON 
+#define SUNXI_HASH_BLOCK_SIZE 64 
+#define SUNXI_HASH_UPDATE 1 
+#define SUNXI_HASH_FINAL 2 
+/* max size of one DMA transfer, must be a multiple of SUNXI_HASH_BLOCK_SIZE */ 
+#define SUNXI_HASH_DMA_MAX (64 * 1024) 
+#define SUNXI_SS_DMA_WAIT_MS 1000 
+ 
+/* The SS cannot keep the state of several hashs, so the partial digest is 
+ * read back after each update and reloaded with SUNXI_IV_ARBITRARY. 
+ * Only whole blocks are sent to the device, the remaining bytes wait in buf */ 
+struct sunxi_hash_reqctx { 
+        u32 mode; /* SUNXI_OP_MD5 or SUNXI_OP_SHA1 */ 
+        u32 op; /* SUNXI_HASH_UPDATE and/or SUNXI_HASH_FINAL */ 
+        u64 byte_count; /* number of bytes already hashed by the device */ 
+        u32 hash[5]; /* partial digest */ 
+        u32 buf[SUNXI_HASH_BLOCK_SIZE / 4]; /* data waiting for a whole block */ 
+        unsigned int len; /* number of bytes in buf */ 
+}; 
+ 
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* sunxi_hash_init: initialize request context 
- * Activate the SS, and configure it for MD5 or SHA1 
- */ 
-static int sunxi_hash_init(struct ahash_request *areq) 
+/* be sure that buf_in could handle len bytes, must be called with lock held */ 
+static int sunxi_ss_bufin(size_t len) 
 { 
-        const char *hash_type; 
-        u32 tmp = 0; 
-        mutex_lock(&lock); 
- 
-        hash_type = crypto_tfm_alg_name(areq->base.tfm); 
- 
-        ss_ctx->byte_count = 0; 
-        ss_ctx->nbwait = 0; 
-        ss_ctx->waiting = 0; 
- 
-        /* Enable and configure SS for MD5 or SHA1, using IVs on hardware */ 
-        ss_ctx->method = SUNXI_OP_MD5; 
-        tmp |= SUNXI_OP_MD5; 
-        if (strcmp(hash_type, "sha1") == 0) { 
-                tmp = SUNXI_OP_SHA1; 
-                ss_ctx->method = SUNXI_OP_SHA1; 
+        if (ss_ctx->buf_in != NULL && len <= ss_ctx->buf_in_size) 
+                return 0; 
+        kfree(ss_ctx->buf_in); 
+        ss_ctx->buf_in = kmalloc(len, GFP_KERNEL); 
+        if (ss_ctx->buf_in == NULL) { 
+                ss_ctx->buf_in_size = 0; 
+                dev_err(ss_ctx->dev, "Unable to allocate pages.\n"); 
+                return -ENOMEM; 
         } 
-        tmp |= SUNXI_IV_CONSTANTS; 
-        tmp |= SUNXI_SS_ENABLED; 
- 
-        iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
- 
+        ss_ctx->buf_in_size = len; 
         return 0; 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* 
- * sunxi_hash_update: update hash engine 
- * 
- * Could be used for both SHA1 and MD5 
- * This function take data from scatterlist (areq->src) and copy it in buf_in 
- * Then we get by step of 32bits the data and put then in the SS. 
- * The remaining data is stored in ss_ctx->waiting 
- */ 
-static int sunxi_hash_update(struct ahash_request *areq) 
+/* sunxi_hash_push: send nwords 32 bits words through the FIFO 
+ * Keep a count of the free spaces of the FIFO to keep a decent speed. */ 
+static void sunxi_hash_push(const u32 *data, unsigned int nwords) 
 { 
-        size_t i; 
-        size_t bufcnt; 
-        size_t nb_in_sg; 
-        size_t off; 
-        unsigned int total; 
-        int count; 
-        struct scatterlist *sg; 
-        int ret; 
-        u32 v; 
- 
-        u8 *waiting = (u8 *)&(ss_ctx->waiting); 
- 
-        if (areq->nbytes == 0) 
-                return 0; 
+        unsigned int spaces = 0; 
  
-        total = areq->nbytes; 
-        nb_in_sg = sg_count(areq->src, areq->nbytes); 
- 
-/*        dev_info(ss_ctx->dev, "DEBUG total=%d nbsg=%d\n", total, nb_in_sg);*/ 
- 
-        /* this a try to do a direct access of data from SG in CPU mode 
-         * strange it works... */ 
-        if (total % 4 == 0 && USE_DMA(total) == 0 && ss_ctx->nbwait == 0) { 
-                /* taken from code of sg_copy_buffer at lib/scatterlist.c */ 
-                unsigned int offset = 0; 
-                struct sg_mapping_iter miter; 
-                unsigned long flags; 
-                unsigned int sg_flags = SG_MITER_ATOMIC; 
- 
-                sg_flags |= SG_MITER_FROM_SG; 
- 
-                sg_miter_start(&miter, areq->src, nb_in_sg, sg_flags); 
- 
-                local_irq_save(flags); 
-                while (sg_miter_next(&miter) && offset < total) { 
-                        unsigned int len, toff; 
-                        len = min(miter.length, total - offset); 
-                        toff = 0; 
-                        while (toff < len) { 
-                                v = *(u32 *)(miter.addr + toff); 
-                                sunxi_ss_send(ss_ctx, v); 
-                                toff += 4; 
-                        } 
-                        ss_ctx->byte_count += len; 
-                        offset += len; 
+        while (nwords > 0) { 
+                if (spaces == 0) { 
+                        spaces = SUNXI_RXFIFO_SPACES(ioread32(ss_ctx->base + 
+                                                SUNXI_SS_FCSR)); 
+                        continue; 
                 } 
-                sg_miter_stop(&miter); 
-                local_irq_restore(flags); 
-                return 0; 
+                iowrite32(*data++, ss_ctx->base + SUNXI_SS_RXFIFO); 
+                spaces--; 
+                nwords--; 
         } 
+} 
  
-        off = 0; 
-        /* DMA stuff */ 
-        /* for the moment only use DMA if we could send all data in one DMA */ 
-        /* TODO move all this to another function for solving lines > 80 column:) */ 
-        if (total > 3 && total % 4 == 0 && USE_DMA(total) && 
-                        ss_ctx->nbwait == 0) { 
-#ifdef DEBUG_SS_DMA 
-                dev_info(ss_ctx->dev, "Lets go for DMA\n"); 
-#endif 
-                if (ss_ctx->rxdma_init == 0) 
-                        ss_sunxi_prepare_dma(DMA_TO_DEVICE); 
-                if (ss_ctx->rxdma_init == 1) { 
-                        /* enable DRQ */ 
-                        iowrite32(SUNXI_SS_ICS_DRA_ENABLE, 
-                                        ss_ctx->base + SUNXI_SS_ICSR); 
- 
-                        /* TODO better error handling */ 
-                        count = dma_map_sg(ss_ctx->dev, areq->src, nb_in_sg, DMA_TO_DEVICE); 
-                        if (count < 0) { 
-                                dev_err(ss_ctx->dev, "dma_map_sg error\n"); 
-                                iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                                mutex_unlock(&lock); 
-                                return -1; 
-                        } 
-/*                        dev_info(ss_ctx->dev, "DMA count=%d nbsg=%u\n", count, nb_in_sg);*/ 
-                        for_each_sg(areq->src, sg, count, i) { 
-                                if (sg_dma_len(sg) % 4 != 0) { 
-                                        /* TODO */ 
-                                        dev_err(ss_ctx->dev, "DMA TODO dma_len non 4\n"); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                                        mutex_unlock(&lock); 
-                                        return -EINVAL; 
-                                } 
-                                ret = ss_dma_send(sg_dma_address(sg), sg_dma_len(sg), 1); 
-                                if (ret != 0) { 
-                                        dev_err(ss_ctx->dev, "DMA ss_dma_send error\n"); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                                        mutex_unlock(&lock); 
-                                        return ret; 
-                                } 
-#ifdef SUNXI_SS_WAIT_QUEUE 
-                                wait_event_interruptible_timeout(dma_queue, 
-                                                (ss_ctx->rxdma_start != 1), 
-                                                HZ * 10); 
-#endif 
-#define SUNXI_SS_DMA_TIMEOUT (1000 * 1000) 
-                                for (ret = 0; ret < SUNXI_SS_DMA_TIMEOUT; ret++) { 
-                                        if (ss_ctx->rxdma_start == 0) 
-                                                break; 
-                                        usleep_range(1, 2); 
-                                } 
-                                if (ret >= SUNXI_SS_DMA_TIMEOUT) 
-                                        dev_warn(ss_ctx->dev, 
-                                                        "DMA wait timeout=\n"); 
-#ifdef DEBUG_SS_DMA 
-                                dev_info(ss_ctx->dev, "DMA ended\n"); 
-#endif 
-                                ret = sunxi_dma_stop(&ssrx_dma); 
-                                if (ret != 0) 
-                                        dev_err(ss_ctx->dev, "DMA could not be stopped\n"); 
-#ifdef DEBUG_SS_DMA 
-                                else 
-                                        dev_info(ss_ctx->dev, "DMA stopped\n"); 
-#endif 
-                        } 
-                        off = total; 
-                        ss_ctx->byte_count += total; 
-                        dma_unmap_sg(ss_ctx->dev, areq->src, nb_in_sg, DMA_TO_DEVICE); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                } 
-                return 0; 
-        } 
-        /* end DMA */ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* sunxi_hash_push_dma: send len bytes of buf with the RX DMA 
+ * len must be a multiple of SUNXI_HASH_BLOCK_SIZE */ 
+static int sunxi_hash_push_dma(void *buf, size_t len) 
+{ 
+        dma_addr_t addr; 
+        size_t off, chunk; 
+        int ret = 0; 
  
-        if (ss_ctx->buf_in == NULL) { 
-                ss_ctx->buf_in = kmalloc(areq->nbytes, GFP_KERNEL); 
-                ss_ctx->buf_in_size = areq->nbytes; 
-        } else { 
-                if (areq->nbytes > ss_ctx->buf_in_size) { 
-                        kfree(ss_ctx->buf_in); 
-                        ss_ctx->buf_in = kmalloc(areq->nbytes, GFP_KERNEL); 
-                        ss_ctx->buf_in_size = areq->nbytes; 
-                } 
-        } 
-        if (ss_ctx->buf_in == NULL) { 
-                dev_err(ss_ctx->dev, "Unable to allocate pages.\n"); 
-                iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                mutex_unlock(&lock); 
-                return -ENOMEM; 
-        } 
+        if (ss_ctx->rxdma_init == 0) 
+                ss_sunxi_prepare_dma(DMA_TO_DEVICE); 
+        if (ss_ctx->rxdma_init == 0) 
+                return -ENODEV; 
  
-        bufcnt = sg_copy_to_buffer(areq->src, nb_in_sg, ss_ctx->buf_in, total); 
-        if (!bufcnt) { 
-                mutex_unlock(&lock); 
-                return -EINVAL; 
+        addr = dma_map_single(ss_ctx->dev, buf, len, DMA_TO_DEVICE); 
+        if (dma_mapping_error(ss_ctx->dev, addr)) { 
+                dev_err(ss_ctx->dev, "dma_map_single error\n"); 
+                return -ENOMEM; 
         } 
+        /* enable DRQ */ 
+        iowrite32(SUNXI_SS_ICS_DRA_ENABLE, ss_ctx->base + SUNXI_SS_ICSR); 
  
-        while (bufcnt - off > 3) { 
-                /* TODO memcpy ? */ 
-                /*waiting[0] = ((u8 *)ss_ctx->buf_in)[off]; 
-                waiting[1] = ((u8 *)ss_ctx->buf_in)[off + 1]; 
-                waiting[2] = ((u8 *)ss_ctx->buf_in)[off + 2]; 
-                waiting[3] = ((u8 *)ss_ctx->buf_in)[off + 3];*/ 
-                ss_ctx->waiting = *(u32 *)(ss_ctx->buf_in + off); 
-                sunxi_ss_send(ss_ctx, ss_ctx->waiting); 
-                /*sunxi_ss_send(ss_ctx, *(u32 *)(ss_ctx->buf_in + off));*/ 
-                off += 4; 
-                ss_ctx->byte_count += 4; 
-                ss_ctx->waiting = 0; 
-        } 
-        if (bufcnt == off) 
-                return 0; 
-        if (bufcnt - off < 4) { 
-                /* copy it in the waiting buffer */ 
-                for (i = 0; i < bufcnt - off; i++) { 
-                        waiting[ss_ctx->nbwait] = ((u8 *)ss_ctx->buf_in)[off + i]; 
-                        ss_ctx->nbwait++; 
-                        if (ss_ctx->nbwait == 4) { 
-                                /* now we have 4 bytes to send */ 
-                                ss_ctx->nbwait = 0; 
-                                /*dev_info(ss_ctx->dev, "Sending %x\n", ss_ctx->waiting);*/ 
-                                sunxi_ss_send(ss_ctx, ss_ctx->waiting); 
-                                ss_ctx->waiting = 0; 
-                                ss_ctx->byte_count += 4; 
-                        } 
+        for (off = 0; off < len && ret == 0; off += chunk) { 
+                chunk = min_t(size_t, len - off, SUNXI_HASH_DMA_MAX); 
+                INIT_COMPLETION(ss_ctx->rxdma_done); 
+                ret = ss_dma_send(addr + off, chunk, 1); 
+                if (ret != 0) { 
+                        dev_err(ss_ctx->dev, "DMA ss_dma_send error\n"); 
+                        break; 
+                } 
+                if (wait_for_completion_timeout(&ss_ctx->rxdma_done, 
+                                msecs_to_jiffies(SUNXI_SS_DMA_WAIT_MS)) == 0) { 
+                        dev_warn(ss_ctx->dev, "DMA wait timeout\n"); 
+                        ret = -ETIMEDOUT; 
                 } 
-                /*dev_info(ss_ctx->dev, "DEBUG %s remains %d bytes\n", __func__, 
-                                ss_ctx->nbwait);*/ 
+                if (sunxi_dma_stop(&ssrx_dma) != 0) 
+                        dev_err(ss_ctx->dev, "DMA could not be stopped\n"); 
         } 
-        return 0; 
+ 
+        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
+        dma_unmap_single(ss_ctx->dev, addr, len, DMA_TO_DEVICE); 
+        return ret; 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* 
- * sunxi_hash_final: finalize hashing operation 
+/* sunxi_hash_handle: do the update and/or final part of a queued request 
  * 
- * If we have some remaining bytes, send it. 
- * Then ask the SS for finalizing the hash 
+ * Called from the queue worker. The pending bytes and the new data are 
+ * gathered in buf_in, whole blocks are sent by DMA (large requests) or 
+ * FIFO, the remaining bytes are kept for the next update. 
+ * On final, the padding is build here since the SS does not do it. 
  */ 
-static int sunxi_hash_final(struct ahash_request *areq) 
+static int sunxi_hash_handle(struct ahash_request *areq) 
 { 
+        struct sunxi_hash_reqctx *op = ahash_request_ctx(areq); 
+        u32 pad[2 * SUNXI_HASH_BLOCK_SIZE / 4]; 
+        u8 *pad8 = (u8 *)pad; 
+        unsigned int nbytes, total, blocks, padlen, i; 
+        u64 bits; 
         u32 v; 
-        unsigned int i; 
-        int zeros; 
-        unsigned int index, padlen; 
-        __be64 bits; 
+        int ret = 0; 
  
-/*        dev_info(ss_ctx->dev, "DEBUG %s base=%p buf_in=%p nbwait=%d\n", 
-                        __func__, ss_ctx->base, ss_ctx->buf_in, ss_ctx->nbwait); 
-*/ 
-        if (ss_ctx->nbwait > 0) { 
-                /*dev_info(ss_ctx->dev, "We have %d remaining bytes to send\n", 
-                                ss_ctx->nbwait);*/ 
-                ss_ctx->waiting |= ((1 << 7) << (ss_ctx->nbwait * 8)); 
-                sunxi_ss_send(ss_ctx, ss_ctx->waiting); 
-        } else 
-                sunxi_ss_send(ss_ctx, (1 << 7)); 
+        nbytes = (op->op & SUNXI_HASH_UPDATE) ? areq->nbytes : 0; 
+        total = op->len + nbytes; 
+        blocks = total & ~(SUNXI_HASH_BLOCK_SIZE - 1); 
  
-        /* number of space to pad to obtain 64o minus 8(size) minus 4 (final 1) 
-         * example len=0 
-         * example len=56 
-         * */ 
+        mutex_lock(&lock); 
  
-        /* we have already send 4 more byte of which nbwait data */ 
-        index = (ss_ctx->byte_count + 4) & 0x3f; 
-        ss_ctx->byte_count += ss_ctx->nbwait; 
-        if (index > 56) 
-                zeros = (120 - index) / 4; 
-        else 
-                zeros = (56 - index) / 4; 
-/*        dev_info(ss_ctx->dev, "DEBUG zeros=%d index=%u\n", zeros, index);*/ 
-        if (ss_ctx->method == SUNXI_OP_SHA1) { 
-                index = ss_ctx->byte_count & 0x3f; 
-                padlen = (index < 56) ? (56 - index) : ((64+56) - index); 
-                zeros = (padlen - 1) / 4; 
-        } 
-        /* This should not happen, TODO set a unlikely() ? */ 
-        if (zeros > 64 || zeros < 0) { 
-                dev_err(ss_ctx->dev, "ERROR DEBUG too many zeros len=%u\n", 
-                                ss_ctx->byte_count); 
-                zeros = 0; 
-        } 
-        for (i = 0; i < zeros; i++) 
-                sunxi_ss_send(ss_ctx, 0); 
- 
-        /* send the lenght */ 
-        if (ss_ctx->method == SUNXI_OP_SHA1) { 
-                bits = cpu_to_be64(ss_ctx->byte_count << 3); 
-                sunxi_ss_send(ss_ctx, bits & 0xffffffff); 
-                sunxi_ss_send(ss_ctx, (bits >> 32) & 0xffffffff); 
-        } else { 
-                sunxi_ss_send(ss_ctx, (ss_ctx->byte_count << 3) & 0xffffffff); 
-                sunxi_ss_send(ss_ctx, (ss_ctx->byte_count >> 29) & 0xffffffff); 
+        ret = sunxi_ss_bufin(total + 1); 
+        if (ret != 0) 
+                goto out; 
+        memcpy(ss_ctx->buf_in, op->buf, op->len); 
+        if (nbytes > 0 && sg_copy_to_buffer(areq->src, 
+                                sg_count(areq->src, nbytes), 
+                                ss_ctx->buf_in + op->len, nbytes) != nbytes) { 
+                ret = -EINVAL; 
+                goto out; 
+        } 
+ 
+        if (blocks > 0 || (op->op & SUNXI_HASH_FINAL)) { 
+                v = op->mode | SUNXI_SS_ENABLED; 
+                if (op->byte_count > 0) { 
+                        /* continue from the partial digest */ 
+                        v |= SUNXI_IV_ARBITRARY; 
+                        for (i = 0; i < 5; i++) 
+                                iowrite32(op->hash[i], 
+                                        ss_ctx->base + SUNXI_SS_IV0 + i * 4); 
+                } 
+                iowrite32(v, ss_ctx->base + SUNXI_SS_CTL); 
+        } 
+ 
+        if (blocks > 0) { 
+                if (USE_DMA(blocks)) 
+                        ret = sunxi_hash_push_dma(ss_ctx->buf_in, blocks); 
+                else 
+                        sunxi_hash_push(ss_ctx->buf_in, blocks / 4); 
+                if (ret != 0) 
+                        goto out_disable; 
+                op->byte_count += blocks; 
+        } 
+        op->len = total - blocks; 
+        memcpy(op->buf, ss_ctx->buf_in + blocks, op->len); 
+ 
+        if (op->op & SUNXI_HASH_FINAL) { 
+                /* 0x80, zeros, then the length in bits on 8 bytes */ 
+                memcpy(pad8, op->buf, op->len); 
+                pad8[op->len] = 0x80; 
+                padlen = (op->len < 56) ? 64 : 128; 
+                memset(pad8 + op->len + 1, 0, padlen - 8 - op->len - 1); 
+                bits = (op->byte_count + op->len) << 3; 
+                if (op->mode == SUNXI_OP_SHA1) 
+                        put_unaligned_be64(bits, pad8 + padlen - 8); 
+                else 
+                        put_unaligned_le64(bits, pad8 + padlen - 8); 
+                sunxi_hash_push(pad, padlen / 4); 
+                op->byte_count += padlen; 
+                op->len = 0; 
+        } else if (blocks == 0) { 
+                /* nothing sent to the device */ 
+                goto out; 
         } 
  
         /* stop the hashing */ 
@@ -720,7 +663,10 @@ static int sunxi_hash_final(struct ahash_request *areq)
                 dev_err(ss_ctx->dev, "SUNXI_SS_TIMEOUT %d>%d\n", 
                                 i, SUNXI_SS_TIMEOUT); 
  
-        if (ss_ctx->method == SUNXI_OP_SHA1) { 
+        if ((op->op & SUNXI_HASH_FINAL) == 0) { 
+                for (i = 0; i < 5; i++) 
+                        op->hash[i] = ioread32(ss_ctx->base + SUNXI_SS_MD0 + i * 4); 
+        } else if (op->mode == SUNXI_OP_SHA1) { 
                 for (i = 0; i < 5; i++) { 
                         v = cpu_to_be32(ioread32(ss_ctx->base + SUNXI_SS_MD0 + i * 4)); 
                         memcpy(areq->result + i * 4, &v, 4); 
@@ -729,27 +675,85 @@ static int sunxi_hash_final(struct ahash_request *areq)
                 for (i = 0; i < 4; i++) { 
                         v = ioread32(ss_ctx->base + SUNXI_SS_MD0 + i * 4); 
                         memcpy(areq->result + i * 4, &v, 4); 
-                        /*memcpy_fromio(areq->result + i * 4, 
-                          ss_ctx->base + SUNXI_SS_MD0 + i * 4, 4);*/ 
                 } 
         } 
+out_disable: 
         iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
+out: 
         mutex_unlock(&lock); 
+        return ret; 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* sunxi_hash_init: initialize request context 
+ * The SS is only used when the request is handled by the queue worker. 
+ */ 
+static int sunxi_hash_init(struct ahash_request *areq) 
+{ 
+        struct sunxi_hash_reqctx *op = ahash_request_ctx(areq); 
+        const char *hash_type; 
+ 
+        hash_type = crypto_tfm_alg_name(areq->base.tfm); 
+ 
+        memset(op, 0, sizeof(struct sunxi_hash_reqctx)); 
+        op->mode = SUNXI_OP_MD5; 
+        if (strcmp(hash_type, "sha1") == 0) 
+                op->mode = SUNXI_OP_SHA1; 
         return 0; 
 } 
  
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* 
+ * sunxi_hash_update: update hash engine 
+ * 
+ * Could be used for both SHA1 and MD5 
+ * If there is not enough data for a whole block, we just keep it in the 
+ * request context, otherwise the request is queued. 
+ */ 
+static int sunxi_hash_update(struct ahash_request *areq) 
+{ 
+        struct sunxi_hash_reqctx *op = ahash_request_ctx(areq); 
+ 
+        if (areq->nbytes == 0) 
+                return 0; 
+ 
+        if (op->len + areq->nbytes < SUNXI_HASH_BLOCK_SIZE) { 
+                sg_copy_to_buffer(areq->src, sg_count(areq->src, areq->nbytes), 
+                                (u8 *)op->buf + op->len, areq->nbytes); 
+                op->len += areq->nbytes; 
+                return 0; 
+        } 
+ 
+        op->op = SUNXI_HASH_UPDATE; 
+        return sunxi_ss_enqueue(&areq->base); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* 
+ * sunxi_hash_final: finalize hashing operation 
+ * 
+ * Queue the request for sending the remaining bytes and the padding. 
+ */ 
+static int sunxi_hash_final(struct ahash_request *areq) 
+{ 
+        struct sunxi_hash_reqctx *op = ahash_request_ctx(areq); 
+ 
+        op->op = SUNXI_HASH_FINAL; 
+        return sunxi_ss_enqueue(&areq->base); 
+} 
+ 
 /*============================================================================*/ 
 /*============================================================================*/ 
 /*sunxi_hash_finup: finalize hashing operation */ 
 static int sunxi_hash_finup(struct ahash_request *areq) 
 { 
-        int err; 
+        struct sunxi_hash_reqctx *op = ahash_request_ctx(areq); 
  
-        err = sunxi_hash_update(areq); 
-        if (err != 0) 
-                return err; 
- 
-        return sunxi_hash_final(areq); 
+        op->op = SUNXI_HASH_UPDATE | SUNXI_HASH_FINAL; 
+        return sunxi_ss_enqueue(&areq->base); 
 } 
  
 /*============================================================================*/ 
@@ -763,11 +767,31 @@ static int sunxi_hash_digest(struct ahash_request *areq)
         if (err != 0) 
                 return err; 
  
-        err = sunxi_hash_update(areq); 
-        if (err != 0) 
-                return err; 
+        return sunxi_hash_finup(areq); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* the whole state is in the request context */ 
+static int sunxi_hash_export(struct ahash_request *areq, void *out) 
+{ 
+        memcpy(out, ahash_request_ctx(areq), sizeof(struct sunxi_hash_reqctx)); 
+        return 0; 
+} 
+ 
+static int sunxi_hash_import(struct ahash_request *areq, const void *in) 
+{ 
+        memcpy(ahash_request_ctx(areq), in, sizeof(struct sunxi_hash_reqctx)); 
+        return 0; 
+} 
  
-        return sunxi_hash_final(areq); 
+/*============================================================================*/ 
+/*============================================================================*/ 
+static int sunxi_hash_cra_init(struct crypto_tfm *tfm) 
+{ 
+        crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm), 
+                        sizeof(struct sunxi_hash_reqctx)); 
+        return 0; 
 } 
  
 /*============================================================================*/ 
@@ -778,18 +802,22 @@ static struct ahash_alg sunxi_md5_alg = {
         .final = sunxi_hash_final, 
         .finup = sunxi_hash_finup, 
         .digest = sunxi_hash_digest, 
+        .export = sunxi_hash_export, 
+        .import = sunxi_hash_import, 
         .halg = { 
                 .digestsize = MD5_DIGEST_SIZE, 
+                .statesize = sizeof(struct sunxi_hash_reqctx), 
                 .base = { 
                         .cra_name = "md5", 
                         .cra_driver_name = "sunxi-md5", 
                         .cra_priority = 100, 
-                        .cra_flags = CRYPTO_ALG_TYPE_AHASH, 
+                        .cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC, 
                         .cra_blocksize = MD5_BLOCK_SIZE, 
                         /*.cra_ctxsize = sizeof(struct sunxi_req_ctx),*/ 
                         .cra_ctxsize = 0, 
                         .cra_module = THIS_MODULE, 
-                        .cra_type = &crypto_ahash_type 
+                        .cra_type = &crypto_ahash_type, 
+                        .cra_init = sunxi_hash_cra_init 
                 } 
         } 
 }; 
@@ -800,22 +828,89 @@ static struct ahash_alg sunxi_sha1_alg = {
         .final = sunxi_hash_final, 
         .finup = sunxi_hash_finup, 
         .digest = sunxi_hash_digest, 
+        .export = sunxi_hash_export, 
+        .import = sunxi_hash_import, 
         .halg = { 
                 .digestsize = SHA1_DIGEST_SIZE, 
+                .statesize = sizeof(struct sunxi_hash_reqctx), 
                 .base = { 
                         .cra_name = "sha1", 
                         .cra_driver_name = "sunxi-sha1", 
                         .cra_priority = 100, 
-                        .cra_flags = CRYPTO_ALG_TYPE_AHASH, 
+                        .cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC, 
 /*                        .cra_blocksize = SHA1_BLOCK_SIZE,*/ 
                         .cra_ctxsize = sizeof(struct sunxi_req_ctx), 
                         .cra_module = THIS_MODULE, 
-                        .cra_type = &crypto_ahash_type 
+                        .cra_type = &crypto_ahash_type, 
+                        .cra_init = sunxi_hash_cra_init 
                 } 
         } 
 }; 
 #endif /* ifdef SUNXI_SS_HASH_COMMON */ 
  
+#ifdef SUNXI_SS_CIPHER_COMMON 
+/* a cipher algorithm with the SS method and chaining mode it uses */ 
+struct sunxi_cipher_alg { 
+        u32 mode; 
+        /* requests smaller than this are done by the fallback */ 
+        unsigned int threshold; 
+        struct device_attribute attr; /* sysfs access to threshold */ 
+        char attr_name[CRYPTO_MAX_ALG_NAME]; 
+        struct crypto_alg alg; 
+}; 
+ 
+static inline struct sunxi_cipher_alg *sunxi_cipher_alg_of( 
+                struct crypto_ablkcipher *tfm) 
+{ 
+        return container_of(crypto_ablkcipher_tfm(tfm)->__crt_alg, 
+                        struct sunxi_cipher_alg, alg); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* method, mode and AES keysize bits of SUNXI_SS_CTL */ 
+static u32 sunxi_cipher_ctl(struct sunxi_req_ctx *op) 
+{ 
+        u32 tmp = op->mode; 
+ 
+        if ((op->mode & (7 << 4)) != SUNXI_OP_AES) 
+                return tmp; 
+        switch (op->keylen) { 
+        case 128 / 8: 
+                tmp |= SUNXI_AES_128BITS; 
+                break; 
+        case 192 / 8: 
+                tmp |= SUNXI_AES_192BITS; 
+                break; 
+        case 256 / 8: 
+                tmp |= SUNXI_AES_256BITS; 
+                break; 
+        } 
+        return tmp; 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* give the key to the fallback, called at the end of each setkey */ 
+static int sunxi_fallback_setkey(struct crypto_ablkcipher *tfm, const u8 *key, 
+                unsigned int keylen) 
+{ 
+        struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
+        int ret; 
+ 
+        if (op->fallback == NULL) 
+                return 0; 
+        crypto_blkcipher_clear_flags(op->fallback, CRYPTO_TFM_REQ_MASK); 
+        crypto_blkcipher_set_flags(op->fallback, 
+                        crypto_ablkcipher_get_flags(tfm) & CRYPTO_TFM_REQ_MASK); 
+        ret = crypto_blkcipher_setkey(op->fallback, key, keylen); 
+        if (ret != 0) 
+                crypto_ablkcipher_set_flags(tfm, 
+                                crypto_blkcipher_get_flags(op->fallback) & 
+                                CRYPTO_TFM_RES_MASK); 
+        return ret; 
+} 
+ 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_AES 
 /*============================================================================*/ 
 /*============================================================================*/ 
@@ -832,284 +927,151 @@ static int sunxi_aes_setkey(struct crypto_ablkcipher *tfm, const u8 *key,
         } 
         op->keylen = keylen; 
         memcpy(op->key, key, keylen); 
-        return 0; 
+        return sunxi_fallback_setkey(tfm, key, keylen); 
 } 
+#endif /* CONFIG_CRYPTO_DEV_SUNXI_SS_AES */ 
  
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_DES 
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* Experimental function with kmap_atomic() */ 
-static int sunxi_aes_poll_kmap_atomic(struct ablkcipher_request *areq, int flag) 
+/* check and set the DES key, weak keys are refused if asked */ 
+static int sunxi_des_setkey(struct crypto_ablkcipher *tfm, const u8 *key, 
+                unsigned int keylen) 
 { 
-        u32 tmp, value; 
-        size_t ir, it; 
-        struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
         struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
-        u32 tx_cnt = 0; 
-        u32 rx_cnt = 0; 
-        void *dst_addr; 
-        void *src_addr; 
-        struct scatterlist *in_sg; 
-        struct scatterlist *out_sg; 
-        size_t len_rx = 0, len_tx = 0; 
-        unsigned long flags; 
-        int antibug = 0; 
+        u32 tmp[DES_EXPKEY_WORDS]; 
  
-        tmp = 0; 
-        tmp |= SUNXI_SS_CBC; 
-        tmp |= SUNXI_OP_AES; 
-        tmp |= SUNXI_KEYSELECT_KEYN; 
-        tmp |= SUNXI_SS_ENABLED; 
-        tmp |= flag; 
-        switch (op->keylen) { 
-        case 128 / 8: 
-                tmp |= SUNXI_AES_128BITS; 
-                break; 
-        case 192 / 8: 
-                tmp |= SUNXI_AES_192BITS; 
-                break; 
-        case 256 / 8: 
-                tmp |= SUNXI_AES_256BITS; 
-                break; 
+        if (keylen != DES_KEY_SIZE) { 
+                dev_err(ss_ctx->dev, "Invalid keylen %u\n", keylen); 
+                crypto_ablkcipher_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN); 
+                return -EINVAL; 
         } 
-        iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
- 
-        in_sg = areq->src; 
-        out_sg = areq->dst; 
- 
-        ir = 0; 
-        it = 0; 
-        do { 
-                if (rx_cnt == 0 || tx_cnt == 0) { 
-                        tmp = ioread32(ss_ctx->base + SUNXI_SS_FCSR); 
-                        rx_cnt = SUNXI_RXFIFO_SPACES(tmp); 
-                        tx_cnt = SUNXI_TXFIFO_SPACES(tmp); 
-                } 
-                if (rx_cnt > 0 && len_rx < areq->nbytes && in_sg != NULL) { 
-                        antibug = 0; 
-                        local_irq_save(flags); 
-                        src_addr = kmap_atomic(sg_page(in_sg)); 
-                        do { 
-                                value = *(u32 *)(src_addr + in_sg->offset + ir); 
-                                iowrite32(value, ss_ctx->base + SUNXI_SS_RXFIFO); 
-                                ir += 4; 
-                                len_rx += 4; 
-                                rx_cnt--; 
-                                antibug++; 
-                        } while (rx_cnt > 0 && antibug < 6); 
-                        kunmap_atomic(src_addr); 
-                        local_irq_restore(flags); 
-                } 
-                if (tx_cnt > 0 && len_tx < areq->nbytes && out_sg != NULL && 
-                                len_tx < len_rx) { 
-                        antibug = 0; 
-                        local_irq_save(flags); 
-                        dst_addr = kmap_atomic(sg_page(out_sg)); 
-                        do { 
-                                value = ioread32(ss_ctx->base + SUNXI_SS_TXFIFO); 
-                                *(u32 *)(dst_addr + out_sg->offset + it) = value; 
-                                it += 4; 
-                                len_tx += 4; 
-                                tx_cnt--; 
-                                antibug++; 
-                        } while (tx_cnt > 0 && antibug < 5); 
-                        kunmap_atomic(dst_addr); 
-                        local_irq_restore(flags); 
-                } 
-                if (in_sg != NULL && ir >= in_sg->length) { 
-                        in_sg = sg_next(in_sg); 
-                        ir = 0; 
-                } 
-                if (out_sg != NULL && it >= out_sg->length) { 
-                        out_sg = sg_next(out_sg); 
-                        it = 0; 
-                } 
-        } while (out_sg != NULL); 
- 
-        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-        mutex_unlock(&lock); 
-        return 0; 
+        if (des_ekey(tmp, key) == 0 && 
+                        (crypto_ablkcipher_get_flags(tfm) & CRYPTO_TFM_REQ_WEAK_KEY)) { 
+                crypto_ablkcipher_set_flags(tfm, CRYPTO_TFM_RES_WEAK_KEY); 
+                return -EINVAL; 
+        } 
+        op->keylen = keylen; 
+        memcpy(op->key, key, keylen); 
+        return sunxi_fallback_setkey(tfm, key, keylen); 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-/* Experimental function with kmap() */ 
-static int sunxi_aes_poll_kmap(struct ablkcipher_request *areq, int flag) 
+/* check and set the 3DES key */ 
+static int sunxi_des3_setkey(struct crypto_ablkcipher *tfm, const u8 *key, 
+                unsigned int keylen) 
 { 
-        u32 tmp, value; 
-        size_t ir, it; 
-        struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
         struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
-        u32 tx_cnt = 0; 
-        u32 rx_cnt = 0; 
-        void *dst_addr; 
-        void *src_addr; 
-        struct scatterlist *in_sg; 
-        struct scatterlist *out_sg; 
-        size_t len_rx = 0, len_tx = 0; 
  
-        tmp = 0; 
-        tmp |= SUNXI_SS_CBC; 
-        tmp |= SUNXI_OP_AES; 
-        tmp |= SUNXI_KEYSELECT_KEYN; 
-        tmp |= SUNXI_SS_ENABLED; 
-        tmp |= flag; 
-        switch (op->keylen) { 
-        case 128 / 8: 
-                tmp |= SUNXI_AES_128BITS; 
-                break; 
-        case 192 / 8: 
-                tmp |= SUNXI_AES_192BITS; 
-                break; 
-        case 256 / 8: 
-                tmp |= SUNXI_AES_256BITS; 
-                break; 
+        if (keylen != 3 * DES_KEY_SIZE) { 
+                dev_err(ss_ctx->dev, "Invalid keylen %u\n", keylen); 
+                crypto_ablkcipher_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN); 
+                return -EINVAL; 
         } 
-        iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
+        op->keylen = keylen; 
+        memcpy(op->key, key, keylen); 
+        return sunxi_fallback_setkey(tfm, key, keylen); 
+} 
+#endif /* CONFIG_CRYPTO_DEV_SUNXI_SS_DES */ 
  
-        in_sg = areq->src; 
-        out_sg = areq->dst; 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* get the next word of a request from the source scatterlist 
+ * The word is read in place from the mapped page, only a word that is not 
+ * aligned or that straddles two segments is gathered byte by byte. */ 
+static u32 sunxi_sg_get_word(struct sg_mapping_iter *mi, size_t *off) 
+{ 
+        u32 v = 0; 
+        size_t n = 0, chunk; 
  
-        src_addr = kmap(sg_page(in_sg)); 
-        dst_addr = kmap(sg_page(out_sg)); 
-        dev_info(ss_ctx->dev, "DEBUG KMAP %p %p %p %p %d\n", src_addr, dst_addr, 
-                        sg_page(in_sg), sg_page(out_sg), out_sg->offset); 
-        if (src_addr == NULL || dst_addr == NULL) { 
-                dev_err(ss_ctx->dev, "KMAP error\n"); 
-                goto end; 
+        if (*off >= mi->length) { 
+                if (!sg_miter_next(mi)) 
+                        return 0; 
+                *off = 0; 
         } 
-        ir = 0; 
-        it = 0; 
-        do { 
-                if (rx_cnt == 0 || tx_cnt == 0) { 
-                        tmp = ioread32(ss_ctx->base + SUNXI_SS_FCSR); 
-                        rx_cnt = SUNXI_RXFIFO_SPACES(tmp); 
-                        tx_cnt = SUNXI_TXFIFO_SPACES(tmp); 
-                } 
-                if (rx_cnt > 0 && len_rx < areq->nbytes && in_sg != NULL) { 
-                        /*src_addr = kmap_atomic(sg_page(in_sg));*/ 
-                        value = *(u32 *)(src_addr + in_sg->offset + ir); 
-                        /*kunmap_atomic(src_addr);*/ 
-                        iowrite32(value, ss_ctx->base + SUNXI_SS_RXFIFO); 
-                        ir += 4; 
-                        len_rx += 4; 
-                        rx_cnt--; 
-                } 
-                if (tx_cnt > 0 && len_tx < areq->nbytes && out_sg != NULL && 
-                                len_tx < len_rx) { 
-                        value = ioread32(ss_ctx->base + SUNXI_SS_TXFIFO); 
-                        /*dst_addr = kmap_atomic(sg_page(out_sg));*/ 
-                        *(u32 *)(dst_addr + out_sg->offset + it) = value; 
-                        /*kunmap_atomic(dst_addr);*/ 
-                        it += 4; 
-                        len_tx += 4; 
-                        tx_cnt--; 
-                } 
-                if (in_sg != NULL && ir >= in_sg->length) { 
-                        kunmap(src_addr); 
-                        in_sg = sg_next(in_sg); 
-                        ir = 0; 
-                        if (in_sg != NULL) { 
-                                src_addr = kmap(sg_page(in_sg)); 
-                                if (src_addr == NULL) { 
-                                        dev_err(ss_ctx->dev, "KMAP src error\n"); 
-                                        goto end; 
-                                } 
-                        } 
-                } 
-                if (out_sg != NULL && it >= out_sg->length) { 
-                        kunmap(dst_addr); 
-                        out_sg = sg_next(out_sg); 
-                        it = 0; 
-                        if (out_sg != NULL) { 
-                                dst_addr = kmap(sg_page(out_sg)); 
-                                if (dst_addr == NULL) { 
-                                        dev_err(ss_ctx->dev, "KMAP dst error\n"); 
-                                        goto end; 
-                                } 
-                        } 
+        if (likely(*off + 4 <= mi->length && 
+                                IS_ALIGNED((unsigned long)mi->addr + *off, 4))) { 
+                v = *(u32 *)(mi->addr + *off); 
+                *off += 4; 
+                return v; 
+        } 
+        while (n < 4) { 
+                if (*off >= mi->length) { 
+                        if (!sg_miter_next(mi)) 
+                                break; 
+                        *off = 0; 
                 } 
-        } while (out_sg != NULL); 
+                chunk = min(4 - n, mi->length - *off); 
+                memcpy((u8 *)&v + n, mi->addr + *off, chunk); 
+                n += chunk; 
+                *off += chunk; 
+        } 
+        return v; 
+} 
  
-end: 
-        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-        mutex_unlock(&lock); 
-        return 0; 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* put the next word of a request in the destination scatterlist, the same 
+ * way sunxi_sg_get_word() get them */ 
+static void sunxi_sg_put_word(struct sg_mapping_iter *mi, size_t *off, u32 v) 
+{ 
+        size_t n = 0, chunk; 
+ 
+        if (*off >= mi->length) { 
+                if (!sg_miter_next(mi)) 
+                        return; 
+                *off = 0; 
+        } 
+        if (likely(*off + 4 <= mi->length && 
+                                IS_ALIGNED((unsigned long)mi->addr + *off, 4))) { 
+                *(u32 *)(mi->addr + *off) = v; 
+                *off += 4; 
+                return; 
+        } 
+        while (n < 4) { 
+                if (*off >= mi->length) { 
+                        if (!sg_miter_next(mi)) 
+                                break; 
+                        *off = 0; 
+                } 
+                chunk = min(4 - n, mi->length - *off); 
+                memcpy(mi->addr + *off, (u8 *)&v + n, chunk); 
+                n += chunk; 
+                *off += chunk; 
+        } 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
 /* Pure CPU way of doing AES with SS 
- * All my tries to read/write directly SG fails, so this is the reasons of the 
- * use of two in/out buffer 
- * SGsrc -> buf_in -> SS -> buf_out -> SGdst */ 
+ * The FIFO are fed from and emptied to the pages of the scatterlists, which 
+ * are mapped one time each by the sg_miter, there is no copy of the request 
+ * SGsrc -> SS -> SGdst 
+ * The miters are not atomic, the queue worker can be preempted between two 
+ * words, src and dst could be the same page since dst lags behind src. */ 
 static int sunxi_aes_poll(struct ablkcipher_request *areq, int flag) 
 { 
-        u32 tmp, value; 
-        size_t nb_in_sg_tx, nb_in_sg_rx; 
+        u32 tmp; 
         size_t ir, it; 
+        size_t off_in = 0, off_out = 0; 
         struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
         struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
+        struct sg_mapping_iter mi_in, mi_out; 
         u32 tx_cnt = 0; 
         u32 rx_cnt = 0; 
  
-        tmp = 0; 
-        tmp |= SUNXI_SS_CBC; 
-        tmp |= SUNXI_OP_AES; 
-        tmp |= SUNXI_KEYSELECT_KEYN; 
-        tmp |= SUNXI_SS_ENABLED; 
-        tmp |= flag; 
-        switch (op->keylen) { 
-        case 128 / 8: 
-                tmp |= SUNXI_AES_128BITS; 
-                break; 
-        case 192 / 8: 
-                tmp |= SUNXI_AES_192BITS; 
-                break; 
-        case 256 / 8: 
-                tmp |= SUNXI_AES_256BITS; 
-                break; 
-        } 
-        iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
- 
-        nb_in_sg_rx = sg_count(areq->src, areq->nbytes); 
-        nb_in_sg_tx = sg_count(areq->dst, areq->nbytes); 
- 
-        if (ss_ctx->buf_in == NULL) { 
-                ss_ctx->buf_in = kmalloc(areq->nbytes, GFP_KERNEL); 
-                ss_ctx->buf_in_size = areq->nbytes; 
-        } else { 
-                if (areq->nbytes > ss_ctx->buf_in_size) { 
-                        kfree(ss_ctx->buf_in); 
-                        ss_ctx->buf_in = kmalloc(areq->nbytes, GFP_KERNEL); 
-                        ss_ctx->buf_in_size = areq->nbytes; 
-                } 
-        } 
-        if (ss_ctx->buf_in == NULL) { 
-                dev_err(ss_ctx->dev, "Unable to allocate pages.\n"); 
-                iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                mutex_unlock(&lock); 
-                return -ENOMEM; 
-        } 
-        mutex_lock(&bufout_lock); 
-        if (ss_ctx->buf_out == NULL) { 
-                ss_ctx->buf_out = kmalloc(areq->nbytes, GFP_KERNEL); 
-                ss_ctx->buf_out_size = areq->nbytes; 
-        } else { 
-                if (areq->nbytes > ss_ctx->buf_out_size) { 
-                        kfree(ss_ctx->buf_out); 
-                        ss_ctx->buf_out = kmalloc(areq->nbytes, GFP_KERNEL); 
-                        ss_ctx->buf_out_size = areq->nbytes; 
-                } 
-        } 
-        mutex_unlock(&bufout_lock); 
-        if (ss_ctx->buf_in == NULL || ss_ctx->buf_out == NULL) { 
-                dev_err(ss_ctx->dev, "Unable to allocate pages.\n"); 
-                iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                mutex_unlock(&lock); 
-                return -ENOMEM; 
-        } 
- 
-        sg_copy_to_buffer(areq->src, nb_in_sg_rx, ss_ctx->buf_in, areq->nbytes); 
+        tmp = 0; 
+        tmp |= sunxi_cipher_ctl(op); 
+        tmp |= SUNXI_KEYSELECT_KEYN; 
+        tmp |= SUNXI_SS_ENABLED; 
+        tmp |= flag; 
+        iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
+ 
+        sg_miter_start(&mi_in, areq->src, sg_count(areq->src, areq->nbytes), 
+                        SG_MITER_FROM_SG); 
+        sg_miter_start(&mi_out, areq->dst, sg_count(areq->dst, areq->nbytes), 
+                        SG_MITER_TO_SG); 
  
         ir = 0; 
         it = 0; 
@@ -1122,8 +1084,8 @@ static int sunxi_aes_poll(struct ablkcipher_request *areq, int flag)
                 } 
                 if (rx_cnt > 0 && ir < areq->nbytes) { 
                         do { 
-                                value = *(u32 *)(ss_ctx->buf_in + ir); 
-                                iowrite32(value, ss_ctx->base + SUNXI_SS_RXFIFO); 
+                                iowrite32(sunxi_sg_get_word(&mi_in, &off_in), 
+                                                ss_ctx->base + SUNXI_SS_RXFIFO); 
                                 ir += 4; 
                                 rx_cnt--; 
                         } while (rx_cnt > 0 && ir < areq->nbytes); 
@@ -1132,68 +1094,49 @@ static int sunxi_aes_poll(struct ablkcipher_request *areq, int flag)
                         do { 
                                 if (ir <= it) 
                                         dev_info(ss_ctx->dev, "DEBUG ANORMAL %u %u\n", ir, it); 
-                                value = ioread32(ss_ctx->base + SUNXI_SS_TXFIFO); 
-                                *(u32 *)(ss_ctx->buf_out + it) = value; 
+                                sunxi_sg_put_word(&mi_out, &off_out, 
+                                                ioread32(ss_ctx->base + SUNXI_SS_TXFIFO)); 
                                 it += 4; 
                                 tx_cnt--; 
                         } while (tx_cnt > 0 && it < areq->nbytes); 
                 } 
         } while (it < areq->nbytes); 
  
+        sg_miter_stop(&mi_in); 
+        sg_miter_stop(&mi_out); 
+ 
         iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
         mutex_unlock(&lock); 
- 
-        /* a simple optimization, since we dont need the hardware for this copy 
-         * we release the lock and do the copy. With that we gain 5/10% perf 
-         * TODO: do the same thing for buf_in */ 
-        mutex_lock(&bufout_lock); 
-        sg_copy_from_buffer(areq->dst, nb_in_sg_tx, ss_ctx->buf_out, 
-                        areq->nbytes); 
- 
-        mutex_unlock(&bufout_lock); 
         return 0; 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
 /* Do the AES with DMA 
- * Sgsrc -DMARX-> SS -DMATX-> SGdst */ 
+ * Sgsrc -DMARX-> SS -DMATX-> SGdst 
+ * The scatterlists are mapped as they are and all their segments are queued 
+ * at once on each channel, the DMA core chains them from its interrupt. 
+ * The caller checked with sg_aligned() that the DMA can move them. 
+ * The FIFO trigger can not change between two segments any more, so it is 
+ * chosen for the largest power of two dividing all of them. */ 
 static int sunxi_aes_dma(struct ablkcipher_request *areq, int flag) 
 { 
-        size_t nb_in_sg_tx, nb_in_sg_rx; 
-        size_t i; 
+        int nb_in_sg_tx, nb_in_sg_rx; 
         int txcount, rxcount, ret; 
-        u32 v, tmp; 
-        int antibug = 0; 
-        unsigned int tx_len = 0, rx_len = 0, len; 
-        struct scatterlist *sgt, *sgr; 
-        int rtm = 0, ttm = 0; 
-        int nbsgr = 0, nbsgt = 0; 
-        dma_addr_t pos_src, pos_dst; 
+        unsigned int len_rx = 0, len_tx = 0; 
+        u32 tmp; 
         struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
         struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
-        char trig_rx, trig_tx; 
+        char trig_rx = 0, trig_tx = 0; 
  
 #ifdef DEBUG_SS_DMA 
-        dev_info(ss_ctx->dev, "%s %d bytes=%d\n", __func__, aes_mode, areq->nbytes); 
+        dev_info(ss_ctx->dev, "%s %d bytes=%d\n", __func__, flag, areq->nbytes); 
 #endif 
         tmp = 0; 
-        tmp |= SUNXI_SS_CBC; 
-        tmp |= SUNXI_OP_AES; 
+        tmp |= sunxi_cipher_ctl(op); 
         tmp |= SUNXI_KEYSELECT_KEYN; 
         tmp |= SUNXI_SS_ENABLED; 
         tmp |= flag; 
-        switch (op->keylen) { 
-        case 128 / 8: 
-                tmp |= SUNXI_AES_128BITS; 
-                break; 
-        case 192 / 8: 
-                tmp |= SUNXI_AES_192BITS; 
-                break; 
-        case 256 / 8: 
-                tmp |= SUNXI_AES_256BITS; 
-                break; 
-        } 
         iowrite32(tmp, ss_ctx->base + SUNXI_SS_CTL); 
  
         /* enable DRQ */ 
@@ -1205,265 +1148,101 @@ static int sunxi_aes_dma(struct ablkcipher_request *areq, int flag)
                 ss_sunxi_prepare_dma(DMA_FROM_DEVICE); 
         if (ss_ctx->txdma_init == 0 || ss_ctx->rxdma_init == 0) { 
                 dev_err(ss_ctx->dev, "DMA init error\n"); 
-                iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                mutex_unlock(&lock); 
-                return -1; 
+                ret = -ENODEV; 
+                goto ss_dma_off; 
         } 
  
         nb_in_sg_rx = sg_count(areq->src, areq->nbytes); 
         nb_in_sg_tx = sg_count(areq->dst, areq->nbytes); 
  
         if (areq->src == areq->dst) { 
-#ifdef DEBUG_SS_DMA 
-                dev_info(ss_ctx->dev, "Need bidirectionnal DMA\n"); 
-#endif 
                 rxcount = dma_map_sg(ss_ctx->dev, areq->src, nb_in_sg_rx, 
                                 DMA_BIDIRECTIONAL); 
                 txcount = rxcount; 
-                if (rxcount < 0) { 
+                if (rxcount == 0) { 
                         dev_err(ss_ctx->dev, "dma_map_sg of AES src error\n"); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                        mutex_unlock(&lock); 
-                        return -1; 
+                        ret = -ENOMEM; 
+                        goto ss_dma_off; 
                 } 
         } else { 
                 rxcount = dma_map_sg(ss_ctx->dev, areq->src, nb_in_sg_rx, 
                                 DMA_TO_DEVICE); 
-                if (rxcount < 0) { 
+                if (rxcount == 0) { 
                         dev_err(ss_ctx->dev, "dma_map_sg of AES src error\n"); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                        mutex_unlock(&lock); 
-                        return -1; 
+                        ret = -ENOMEM; 
+                        goto ss_dma_off; 
                 } 
                 txcount = dma_map_sg(ss_ctx->dev, areq->dst, nb_in_sg_tx, 
                                 DMA_FROM_DEVICE); 
-                if (txcount < 0) { 
+                if (txcount == 0) { 
                         dev_err(ss_ctx->dev, "dma_map_sg of AES dst error\n"); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                        mutex_unlock(&lock); 
-                        return -1; 
+                        dma_unmap_sg(ss_ctx->dev, areq->src, nb_in_sg_rx, 
+                                        DMA_TO_DEVICE); 
+                        ret = -ENOMEM; 
+                        goto ss_dma_off; 
                 } 
-/*                dma_sync_sg_for_device(ss_ctx->dev, areq->src, nb_in_sg_rx, 
-                                DMA_TO_DEVICE);*/ 
         } 
 #ifdef DEBUG_SS_DMA 
-        dev_info(ss_ctx->dev, "RX DMA cnt=%d nbsg=%u\n", rxcount, nb_in_sg_rx); 
-        dev_info(ss_ctx->dev, "TX DMA cnt=%d nbsg=%u\n", txcount, nb_in_sg_tx); 
+        dev_info(ss_ctx->dev, "RX DMA cnt=%d nbsg=%d\n", rxcount, nb_in_sg_rx); 
+        dev_info(ss_ctx->dev, "TX DMA cnt=%d nbsg=%d\n", txcount, nb_in_sg_tx); 
 #endif 
  
-/*#define DEBUG_DMA_P*/ 
-        /* now we can start DMA 
-         * We begin with the first SG of source and destination 
-         * After each SG finished start the next SG 
-         * */ 
+        INIT_COMPLETION(ss_ctx->rxdma_done); 
+        INIT_COMPLETION(ss_ctx->txdma_done); 
  
-        sgr = areq->src; 
-        sgt = areq->dst; 
-#ifdef DEBUG_DMA_P 
-/*        for_each_sg(areq->src, sg, rxcount, i) { 
-                rx_len += sg_dma_len(sg); 
-                dev_info(ss_ctx->dev, "RX DMA hwaddr=%p\n", sg_dma_address(sg)); 
-                dev_info(ss_ctx->dev, "RX DMA len=%d sum=%u\n", sg_dma_len(sg), 
-                                rx_len); 
-        } 
-        for_each_sg(areq->dst, sg, txcount, i) { 
-                tx_len += sg_dma_len(sg); 
-                dev_info(ss_ctx->dev, "TX DMA hwaddr=%p\n", sg_dma_address(sg)); 
-                dev_info(ss_ctx->dev, "TX DMA len=%d sum=%u\n", sg_dma_len(sg), 
-                                tx_len); 
-        } 
-        dev_info(ss_ctx->dev, "SG lens nbytes=%u rx=%u tx=%u\n", areq->nbytes, 
-                        rx_len, tx_len);*/ 
-#endif 
+        /* TODO a DEFINE must be done for this 1 */ 
+        ret = ss_dma_queue_sg(&sstx_dma, &ss_recv_hwconf, DMA_MAGIC_TX, 
+                        areq->dst, txcount, areq->nbytes, 1, &len_tx); 
+        if (ret < 0) 
+                goto ss_dma_stop; 
+        ss_ctx->txdma_left = ret; 
+        ret = ss_dma_queue_sg(&ssrx_dma, &ss_send_hwconf, DMA_MAGIC_RX, 
+                        areq->src, rxcount, areq->nbytes, 0, &len_rx); 
+        if (ret < 0) 
+                goto ss_dma_stop; 
+        ss_ctx->rxdma_left = ret; 
  
         /* calculate trigger */ 
-        sunxi_ss_trigger(sg_dma_len(sgr), sg_dma_len(sgt), &trig_rx, &trig_tx, 
-                        CHANGE_TRIG_RX | CHANGE_TRIG_TX); 
+        sunxi_ss_trigger(len_rx & -len_rx, len_tx & -len_tx, &trig_rx, 
+                        &trig_tx, CHANGE_TRIG_RX | CHANGE_TRIG_TX); 
+        /* the TX DMA stalls on short segments with the default trigger */ 
+        if ((len_tx & -len_tx) <= 8) { 
+                iowrite32(0x301, ss_ctx->base + SUNXI_SS_FCSR); 
+                trig_rx = 0x03; 
+                trig_tx = 0x01; 
+        } 
  
-        tx_len = 0; 
-        rx_len = 0; 
-        ret = ss_dma_recv(sg_dma_address(sgt), sg_dma_len(sgt)); 
+        ss_ctx->txdma_start = 1; 
+        ret = sunxi_dma_start(&sstx_dma); 
         if (ret != 0) { 
-                dev_err(ss_ctx->dev, "DMA ss_dma_recv error\n"); 
-                goto ss_dma_end; 
+                dev_err(ss_ctx->dev, "ERROR sunxi_dma_start()\n"); 
+                ss_ctx->txdma_start = 0; 
+                goto ss_dma_stop; 
         } 
-        ret = ss_dma_send(sg_dma_address(sgr), sg_dma_len(sgr), 1); 
+        ss_ctx->rxdma_start = 1; 
+        ret = sunxi_dma_start(&ssrx_dma); 
         if (ret != 0) { 
-                dev_err(ss_ctx->dev, "DMA ss_dma_send error\n"); 
-                goto ss_dma_end; 
+                dev_err(ss_ctx->dev, "ERROR sunxi_dma_start\n"); 
+                ss_ctx->rxdma_start = 0; 
+                goto ss_dma_stop; 
+        } 
+ 
+        /* the last word out of the SS comes after the last word in */ 
+        if (wait_for_completion_timeout(&ss_ctx->txdma_done, 
+                        msecs_to_jiffies(SUNXI_SS_DMA_WAIT_MS)) == 0) { 
+                dev_warn(ss_ctx->dev, "DMA wait timeout, %d RX and %d TX segments left\n", 
+                                ss_ctx->rxdma_left, ss_ctx->txdma_left); 
+                ret = -ETIMEDOUT; 
         } 
-        /* Now we have both DMA started, we wait for completion of any, advance to next SG and start another DMA 
-         * while some SG are available. */ 
-        do { 
-                if (ss_ctx->txdma_start == 0) { 
-                        ret = sunxi_dma_stop(&sstx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, "TX DMA could not be stopped\n"); 
-                        tx_len += sg_dma_len(sgt); 
-#ifdef DEBUG_DMA_P 
-                        dev_info(ss_ctx->dev, "Detected TX end, enqueue %d / %d done=%u\n", 
-                                        nbsgt, nb_in_sg_tx, tx_len); 
-#endif 
-                        sgt = sg_next(sgt); 
-                        nbsgt++; 
-                        if (nbsgt < nb_in_sg_tx) { 
-                                len = sg_dma_len(sgt); 
-                                if (tx_len + len > areq->nbytes) { 
-                                        len = areq->nbytes - tx_len; 
-                                        dev_info(ss_ctx->dev, "DEBUG minimizing TX from %u to %u\n", sg_dma_len(sgt), len); 
-                                } 
-                                sunxi_ss_trigger(0, len, &trig_rx, &trig_tx, CHANGE_TRIG_TX); 
-                                if (len <= 8) { 
-#ifdef DEBUG_DMA_P 
-                                        dev_info(ss_ctx->dev, "Evil hack at %d/%d len=%u\n", 
-                                                        nbsgt, nb_in_sg_tx, len); 
-#endif 
-                                        iowrite32(0x301, ss_ctx->base + SUNXI_SS_FCSR); 
-                                        trig_rx = 0x03; 
-                                        trig_tx = 0x01; 
-                                } 
-                                ret = ss_dma_recv(sg_dma_address(sgt), len); 
-                                if (ret != 0) { 
-                                        dev_err(ss_ctx->dev, "DMA ss_dma_recv error\n"); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                                        mutex_unlock(&lock); 
-                                        return ret; 
-                                } 
-                                ttm = 0; 
-                        } else { 
-                                ss_ctx->txdma_start = -1; 
-#ifdef DEBUG_DMA_P 
-                                dev_info(ss_ctx->dev, "No more TX to do\n"); 
-#endif 
-                        } 
-                } 
-                if (ss_ctx->rxdma_start == 0) { 
-                        ret = sunxi_dma_stop(&ssrx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, 
-                                                "RX DMA could not be stopped\n"); 
-                        rx_len += sg_dma_len(sgr); 
-#ifdef DEBUG_DMA_P 
-                        dev_info(ss_ctx->dev, "Detected RX end, enqueue %d / %d done=%u\n", nbsgr, nb_in_sg_rx, rx_len); 
-#endif 
-                        sgr = sg_next(sgr); 
-                        nbsgr++; 
-                        if (nbsgr < nb_in_sg_rx) { 
-#ifdef DEBUG_DMA_P 
-                                dev_info(ss_ctx->dev, "More RX to do %p %u\n", sg_dma_address(sgr), sg_dma_len(sgr)); 
-#endif 
-                                len = sg_dma_len(sgr); 
-                                if (rx_len + len > areq->nbytes) { 
-                                        len = areq->nbytes - rx_len; 
-/*                                        dev_info(ss_ctx->dev, "DEBUG minimizing from %u to %u\n", sg_dma_len(sgr), len);*/ 
-                                } 
-                                sunxi_ss_trigger(len, 0, &trig_rx, &trig_tx, CHANGE_TRIG_RX); 
-                                ret = ss_dma_send(sg_dma_address(sgr), len, 1); 
-                                if (ret != 0) { 
-                                        dev_err(ss_ctx->dev, "DMA ss_dma_send error\n"); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
-                                        iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
-                                        mutex_unlock(&lock); 
-                                        return ret; 
-                                } 
-                                rtm = 0; 
-                        } else { 
-                                ss_ctx->rxdma_start = -1; 
-#ifdef DEBUG_DMA_P 
-                                dev_info(ss_ctx->dev, "No more RX to do\n"); 
-#endif 
-                        } 
-                } 
-                /* without waitqueue we use lots of CPU in this do while for nothing */ 
-#ifdef SUNXI_SS_WAIT_QUEUE 
-                ret = wait_event_interruptible_timeout(dma_queue, (ss_ctx->rxdma_start != 1 || ss_ctx->txdma_start != 1), HZ * 10); 
-                /*dev_info(ss_ctx->dev, "wait_event_interruptible_timeout %d start=%d %d\n", ret, ss_ctx->rxdma_start, ss_ctx->txdma_start);*/ 
-#endif 
-/*                usleep_range(1, 2);*/ 
-                rtm++; 
-                ttm++; 
-                /* the four if blocks that follow are here only to debug DMA problems */ 
-                if (rtm > 1000 * 1000 && ss_ctx->rxdma_start == 1 && antibug == 0) { 
-                        dev_info(ss_ctx->dev, "RX timeout at %d/%d rxlen=%u txlen=%u req=%u\n", nbsgr, nb_in_sg_rx, rx_len, tx_len, areq->nbytes); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_FCSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_FCSR %x\n", v); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_ICSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_ICSR %x\n", v); 
-                        sunxi_dma_getcurposition(&ssrx_dma, &pos_src, &pos_dst); 
-                        dev_info(ss_ctx->dev, "Curpos %x %x start=%x\n", pos_src, pos_dst, sg_dma_address(sgr)); 
-                        iowrite32(0x101, ss_ctx->base + SUNXI_SS_FCSR); 
-                        trig_rx = 0x01; 
-                        trig_tx = 0x01; 
-                        antibug = 1; 
-                        rtm = 0; 
-                        dev_info(ss_ctx->dev, "DEBUG try antibug RX\n"); 
-                } 
-                if (rtm > 1000 * 1000 && ss_ctx->rxdma_start == 1) { 
-                        dev_info(ss_ctx->dev, "RX timeout at %d/%d rxlen=%u txlen=%u req=%u\n", nbsgr, nb_in_sg_rx, rx_len, tx_len, areq->nbytes); 
-                        nbsgr = nb_in_sg_rx; 
-                        nbsgt = nb_in_sg_tx; 
-                        ret = sunxi_dma_stop(&ssrx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, "RX DMA could not be stopped\n"); 
-                        ret = sunxi_dma_stop(&sstx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, "TX DMA could not be stopped\n"); 
-                        break; 
-                } 
-                if (ttm > 1000 * 1000 * 10 && ss_ctx->txdma_start == 1 && antibug == 0) { 
-                        dev_info(ss_ctx->dev, "TX timeout at %d/%d rxlen=%u txlen=%u req=%u\n", nbsgt, nb_in_sg_tx, rx_len, tx_len, areq->nbytes); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_FCSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_FCSR %x\n", v); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_ICSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_ICSR %x\n", v); 
-                        sunxi_dma_getcurposition(&sstx_dma, &pos_src, &pos_dst); 
-                        dev_info(ss_ctx->dev, "Curpos %x %x start=%x %x diff=%x\n", pos_src, 
-                                        pos_dst, sg_dma_address(sgt), 
-                                        ss_ctx->base + SUNXI_SS_TXFIFO, 
-                                        pos_dst - sg_dma_address(sgt)); 
-                        iowrite32(0x101, ss_ctx->base + SUNXI_SS_FCSR); 
-                        trig_rx = 0x01; 
-                        trig_tx = 0x01; 
-                        antibug = 1; 
-                        ttm = 0; 
-                        dev_info(ss_ctx->dev, "DEBUG try antibug TX\n"); 
-                } 
-                if (ttm > 1000 * 1000 * 10 && ss_ctx->txdma_start == 1) { 
-                        dev_info(ss_ctx->dev, "TX timeout at %d/%d rxlen=%u txlen=%u req=%u\n", nbsgt, nb_in_sg_tx, rx_len, tx_len, areq->nbytes); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_FCSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_FCSR %x\n", v); 
-                        v = ioread32(ss_ctx->base + SUNXI_SS_ICSR); 
-                        dev_info(ss_ctx->dev, "DEBUG SUNXI_SS_ICSR %x\n", v); 
- 
-                        for (i = 0; i < 5; i++) { 
-                                sunxi_dma_getcurposition(&sstx_dma, &pos_src, &pos_dst); 
-                                dev_info(ss_ctx->dev, "Curpos %d %x %x start=%x %x diff=%x\n", 
-                                                i, pos_src, pos_dst, 
-                                                sg_dma_address(sgt), 
-                                                ss_ctx->base + SUNXI_SS_TXFIFO, 
-                                                pos_dst - sg_dma_address(sgt)); 
-                                usleep_range(10, 15); 
-                        } 
- 
-                        nbsgr = nb_in_sg_rx; 
-                        nbsgt = nb_in_sg_tx; 
-                        ret = sunxi_dma_stop(&ssrx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, "RX DMA could not be stopped\n"); 
-                        ret = sunxi_dma_stop(&sstx_dma); 
-                        if (ret != 0) 
-                                dev_err(ss_ctx->dev, "TX DMA could not be stopped\n"); 
-                        break; 
-                } 
-        } while (nbsgr < nb_in_sg_rx || nbsgt < nb_in_sg_tx); 
  
-        ret = 0; 
-ss_dma_end: 
+ss_dma_stop: 
+        if (sunxi_dma_stop(&ssrx_dma) != 0) 
+                dev_err(ss_ctx->dev, "RX DMA could not be stopped\n"); 
+        if (sunxi_dma_stop(&sstx_dma) != 0) 
+                dev_err(ss_ctx->dev, "TX DMA could not be stopped\n"); 
+ss_dma_unmap: 
+        ss_ctx->rxdma_left = 0; 
+        ss_ctx->txdma_left = 0; 
         if (areq->src == areq->dst) { 
                 dma_sync_sg_for_cpu(ss_ctx->dev, areq->src, nb_in_sg_rx, 
                                 DMA_BIDIRECTIONAL); 
@@ -1477,6 +1256,7 @@ ss_dma_end:
                 dma_unmap_sg(ss_ctx->dev, areq->dst, nb_in_sg_tx, 
                                 DMA_FROM_DEVICE); 
         } 
+ss_dma_off: 
         iowrite32(0, ss_ctx->base + SUNXI_SS_ICSR); 
         iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
         mutex_unlock(&lock); 
@@ -1485,7 +1265,16 @@ ss_dma_end:
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-static int sunxi_aes_cbc_encrypt(struct ablkcipher_request *areq) 
+/* DMA is worth it and the DMA can move every segment */ 
+static int sunxi_aes_use_dma(struct ablkcipher_request *areq) 
+{ 
+        return USE_DMA(areq->nbytes) && sg_aligned(areq->src, areq->nbytes) && 
+                sg_aligned(areq->dst, areq->nbytes); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+static int sunxi_aes_do_encrypt(struct ablkcipher_request *areq) 
 { 
         u32 v; 
         int i; 
@@ -1495,31 +1284,24 @@ static int sunxi_aes_cbc_encrypt(struct ablkcipher_request *areq)
  
         BUG_ON(ivsize && !areq->info); 
  
-        if (ivsize < 4) 
-                dev_info(ss_ctx->dev, "DEBUG IV size %d\n", ivsize); 
- 
         mutex_lock(&lock); 
  
         ss_ctx->method = SUNXI_SS_ENCRYPTION; 
  
-        if (areq->info == NULL) 
-                dev_info(ss_ctx->dev, "DEBUG IV null\n"); 
- 
-        /* if the function becomes used by other method than CBC, test it here */ 
+        for (i = 0; i < op->keylen; i += 4) { 
+                v = *(u32 *)(op->key + i); 
+                iowrite32(v, ss_ctx->base + SUNXI_SS_KEY0 + i); 
+        } 
+        /* no IV for ECB */ 
         if (areq->info != NULL) { 
-                for (i = 0; i < op->keylen; i += 4) { 
-                        v = *(u32 *)(op->key + i); 
-                        iowrite32(v, ss_ctx->base + SUNXI_SS_KEY0 + i); 
-                } 
-                for (i = 0; i < 4; i++) { 
+                for (i = 0; i < ivsize / 4; i++) { 
                         v = *(u32 *)(areq->info + i * 4); 
                         iowrite32(v, ss_ctx->base + SUNXI_SS_IV0 + i * 4); 
                 } 
         } 
-        op->mode |= SUNXI_SS_ENCRYPTION; 
  
         /* DMA */ 
-        if (USE_DMA(areq->nbytes)) 
+        if (sunxi_aes_use_dma(areq)) 
                 return sunxi_aes_dma(areq, SUNXI_SS_ENCRYPTION); 
         else 
                 return sunxi_aes_poll(areq, SUNXI_SS_ENCRYPTION); 
@@ -1527,7 +1309,7 @@ static int sunxi_aes_cbc_encrypt(struct ablkcipher_request *areq)
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-static int sunxi_aes_cbc_decrypt(struct ablkcipher_request *areq) 
+static int sunxi_aes_do_decrypt(struct ablkcipher_request *areq) 
 { 
         u32 v; 
         int i; 
@@ -1537,42 +1319,112 @@ static int sunxi_aes_cbc_decrypt(struct ablkcipher_request *areq)
  
         BUG_ON(ivsize && !areq->info); 
  
-        if (ivsize < 4) 
-                dev_info(ss_ctx->dev, "DEBUG IV size %d\n", ivsize); 
- 
         mutex_lock(&lock); 
         ss_ctx->method = SUNXI_SS_DECRYPTION; 
  
 /*#ifdef DEBUG_DMA_P*/ 
 /*        dev_info(ss_ctx->dev, "%s %d %d %p %x\n", __func__, areq->nbytes, op->keylen, op, op->key[0]);*/ 
 /*#endif*/ 
-        if (areq->info == NULL) 
-                dev_info(ss_ctx->dev, "DEBUG IV null\n"); 
- 
-        if (areq->info != NULL) {/* TODO add test CBC */ 
-                for (i = 0; i < op->keylen; i += 4) { 
-                        v = *(u32 *)(op->key + i); 
-                        iowrite32(v, ss_ctx->base + SUNXI_SS_KEY0 + i); 
-                } 
-                for (i = 0; i < 4; i++) { 
+        for (i = 0; i < op->keylen; i += 4) { 
+                v = *(u32 *)(op->key + i); 
+                iowrite32(v, ss_ctx->base + SUNXI_SS_KEY0 + i); 
+        } 
+        /* no IV for ECB */ 
+        if (areq->info != NULL) { 
+                for (i = 0; i < ivsize / 4; i++) { 
                         v = *(u32 *)(areq->info + i * 4); 
                         iowrite32(v, ss_ctx->base + SUNXI_SS_IV0 + i * 4); 
                 } 
         } 
-        op->mode |= SUNXI_SS_DECRYPTION; 
  
-        if (USE_DMA(areq->nbytes)) 
+        if (sunxi_aes_use_dma(areq)) 
                 return sunxi_aes_dma(areq, SUNXI_SS_DECRYPTION); 
         else 
                 return sunxi_aes_poll(areq, SUNXI_SS_DECRYPTION); 
 } 
  
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* called by the queue worker */ 
+static int sunxi_aes_handle(struct ablkcipher_request *areq) 
+{ 
+        struct sunxi_aes_reqctx *rctx = ablkcipher_request_ctx(areq); 
+ 
+        if (rctx->mode == SUNXI_SS_DECRYPTION) 
+                return sunxi_aes_do_decrypt(areq); 
+        return sunxi_aes_do_encrypt(areq); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* small requests are done synchronously by the generic implementation */ 
+static int sunxi_ss_fallback(struct ablkcipher_request *areq, int encrypt) 
+{ 
+        struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
+        struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
+        struct blkcipher_desc desc; 
+ 
+        desc.tfm = op->fallback; 
+        desc.info = areq->info; 
+        desc.flags = areq->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP; 
+        if (encrypt) 
+                return crypto_blkcipher_encrypt_iv(&desc, areq->dst, 
+                                areq->src, areq->nbytes); 
+        return crypto_blkcipher_decrypt_iv(&desc, areq->dst, 
+                        areq->src, areq->nbytes); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+static int sunxi_ss_cipher_encrypt(struct ablkcipher_request *areq) 
+{ 
+        struct sunxi_aes_reqctx *rctx = ablkcipher_request_ctx(areq); 
+        struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
+        struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
+ 
+        if (op->fallback != NULL && 
+                        areq->nbytes < sunxi_cipher_alg_of(tfm)->threshold) 
+                return sunxi_ss_fallback(areq, 1); 
+ 
+        rctx->mode = SUNXI_SS_ENCRYPTION; 
+        return sunxi_ss_enqueue(&areq->base); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+static int sunxi_ss_cipher_decrypt(struct ablkcipher_request *areq) 
+{ 
+        struct sunxi_aes_reqctx *rctx = ablkcipher_request_ctx(areq); 
+        struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(areq); 
+        struct sunxi_req_ctx *op = crypto_ablkcipher_ctx(tfm); 
+ 
+        if (op->fallback != NULL && 
+                        areq->nbytes < sunxi_cipher_alg_of(tfm)->threshold) 
+                return sunxi_ss_fallback(areq, 0); 
+ 
+        rctx->mode = SUNXI_SS_DECRYPTION; 
+        return sunxi_ss_enqueue(&areq->base); 
+} 
+ 
 /*============================================================================*/ 
 /*============================================================================*/ 
 static int sunxi_aes_init(struct crypto_tfm *tfm) 
 { 
         struct sunxi_req_ctx *op = crypto_tfm_ctx(tfm); 
+        struct sunxi_cipher_alg *salg = container_of(tfm->__crt_alg, 
+                        struct sunxi_cipher_alg, alg); 
         memset(op, 0, sizeof(struct sunxi_req_ctx)); 
+        op->mode = salg->mode; 
+        tfm->crt_ablkcipher.reqsize = sizeof(struct sunxi_aes_reqctx); 
+ 
+        /* without fallback, all requests go to the SS */ 
+        op->fallback = crypto_alloc_blkcipher(salg->alg.cra_name, 0, 
+                        CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK); 
+        if (IS_ERR(op->fallback)) { 
+                dev_warn(ss_ctx->dev, "no fallback for %s\n", 
+                                salg->alg.cra_name); 
+                op->fallback = NULL; 
+        } 
         return 0; 
 } 
  
@@ -1580,81 +1432,340 @@ static int sunxi_aes_init(struct crypto_tfm *tfm)
 /*============================================================================*/ 
 static void sunxi_aes_exit(struct crypto_tfm *tfm) 
 { 
+        struct sunxi_req_ctx *op = crypto_tfm_ctx(tfm); 
+ 
+        if (op->fallback != NULL) 
+                crypto_free_blkcipher(op->fallback); 
+        op->fallback = NULL; 
 } 
  
 /*============================================================================*/ 
 /*============================================================================*/ 
-static struct crypto_alg sunxi_aes_alg = { 
-        .cra_name = "cbc(aes)", 
-        .cra_driver_name = "sunxi-cbc-aes", 
-        .cra_priority = 100, 
-        .cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER, 
-        .cra_blocksize   = AES_BLOCK_SIZE, 
-        .cra_ctxsize = sizeof(struct sunxi_req_ctx), 
-        .cra_module = THIS_MODULE, 
-        .cra_type = &crypto_ablkcipher_type, 
-        .cra_init = sunxi_aes_init, 
-        .cra_exit = sunxi_aes_exit, 
-        .cra_u.ablkcipher = { 
-                .min_keysize    = AES_MIN_KEY_SIZE, 
-                .max_keysize    = AES_MAX_KEY_SIZE, 
-                .ivsize         = AES_BLOCK_SIZE, 
-                .setkey         = sunxi_aes_setkey, 
-                .encrypt        = sunxi_aes_cbc_encrypt, 
-                .decrypt        = sunxi_aes_cbc_decrypt, 
-        } 
+/* all ciphers are above the generic and ARM assembler implementations */ 
+#define SUNXI_SS_CIPHER_PRIORITY 300 
+ 
+#define SUNXI_CIPHER_ALG(_name, _drv, _mode, _bsize, _min, _max, _iv, _setkey) \ 
+{ \ 
+        .mode = (_mode), \ 
+        .alg = { \ 
+                .cra_name = _name, \ 
+                .cra_driver_name = _drv, \ 
+                .cra_priority = SUNXI_SS_CIPHER_PRIORITY, \ 
+                .cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC | \ 
+                        CRYPTO_ALG_NEED_FALLBACK, \ 
+                .cra_blocksize = (_bsize), \ 
+                .cra_ctxsize = sizeof(struct sunxi_req_ctx), \ 
+                .cra_module = THIS_MODULE, \ 
+                .cra_type = &crypto_ablkcipher_type, \ 
+                .cra_init = sunxi_aes_init, \ 
+                .cra_exit = sunxi_aes_exit, \ 
+                .cra_u.ablkcipher = { \ 
+                        .min_keysize    = (_min), \ 
+                        .max_keysize    = (_max), \ 
+                        .ivsize         = (_iv), \ 
+                        .setkey         = (_setkey), \ 
+                        .encrypt        = sunxi_ss_cipher_encrypt, \ 
+                        .decrypt        = sunxi_ss_cipher_decrypt, \ 
+                } \ 
+        } \ 
+} 
+ 
+static struct sunxi_cipher_alg sunxi_cipher_algs[] = { 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_AES 
+        SUNXI_CIPHER_ALG("cbc(aes)", "sunxi-cbc-aes", 
+                        SUNXI_OP_AES | SUNXI_SS_CBC, AES_BLOCK_SIZE, 
+                        AES_MIN_KEY_SIZE, AES_MAX_KEY_SIZE, AES_BLOCK_SIZE, 
+                        sunxi_aes_setkey), 
+        SUNXI_CIPHER_ALG("ecb(aes)", "sunxi-ecb-aes", 
+                        SUNXI_OP_AES | SUNXI_SS_ECB, AES_BLOCK_SIZE, 
+                        AES_MIN_KEY_SIZE, AES_MAX_KEY_SIZE, 0, 
+                        sunxi_aes_setkey), 
+#endif 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_DES 
+        SUNXI_CIPHER_ALG("cbc(des)", "sunxi-cbc-des", 
+                        SUNXI_OP_DES | SUNXI_SS_CBC, DES_BLOCK_SIZE, 
+                        DES_KEY_SIZE, DES_KEY_SIZE, DES_BLOCK_SIZE, 
+                        sunxi_des_setkey), 
+        SUNXI_CIPHER_ALG("ecb(des)", "sunxi-ecb-des", 
+                        SUNXI_OP_DES | SUNXI_SS_ECB, DES_BLOCK_SIZE, 
+                        DES_KEY_SIZE, DES_KEY_SIZE, 0, 
+                        sunxi_des_setkey), 
+        SUNXI_CIPHER_ALG("cbc(des3_ede)", "sunxi-cbc-des3", 
+                        SUNXI_OP_3DES | SUNXI_SS_CBC, DES3_EDE_BLOCK_SIZE, 
+                        DES3_EDE_KEY_SIZE, DES3_EDE_KEY_SIZE, DES3_EDE_BLOCK_SIZE, 
+                        sunxi_des3_setkey), 
+        SUNXI_CIPHER_ALG("ecb(des3_ede)", "sunxi-ecb-des3", 
+                        SUNXI_OP_3DES | SUNXI_SS_ECB, DES3_EDE_BLOCK_SIZE, 
+                        DES3_EDE_KEY_SIZE, DES3_EDE_KEY_SIZE, 0, 
+                        sunxi_des3_setkey), 
+#endif 
 }; 
  
-#endif /* CONFIG_CRYPTO_DEV_SUNXI_SS_AES */ 
  
-#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_PRNG 
 /*============================================================================*/ 
 /*============================================================================*/ 
-static int sunxi_ss_rng_get_random(struct crypto_rng *tfm, u8 *rdata, 
-                unsigned int dlen) 
+/* sysfs access to the fallback threshold of each cipher, 0 disable it */ 
+static ssize_t sunxi_threshold_show(struct device *dev, 
+                struct device_attribute *attr, char *buf) 
 { 
-        struct prng_context *ctx = crypto_tfm_ctx((struct crypto_tfm *) tfm); 
-        unsigned int i; 
-        u32 mode = 0; 
-        u32 v; 
+        struct sunxi_cipher_alg *salg = container_of(attr, 
+                        struct sunxi_cipher_alg, attr); 
  
-        if (dlen == 0 || rdata == NULL) 
-                return 0; 
+        return sprintf(buf, "%u\n", salg->threshold); 
+} 
  
-        mode |= SUNXI_OP_PRNG; 
-        mode |= SUNXI_PRNG_ONESHOT; 
-        mode |= SUNXI_SS_ENABLED; 
+static ssize_t sunxi_threshold_store(struct device *dev, 
+                struct device_attribute *attr, const char *buf, size_t count) 
+{ 
+        struct sunxi_cipher_alg *salg = container_of(attr, 
+                        struct sunxi_cipher_alg, attr); 
+        unsigned int val; 
+        int ret; 
  
-        dev_info(ss_ctx->dev, "DEBUG %s dlen=%u\n", __func__, dlen); 
+        ret = kstrtouint(buf, 0, &val); 
+        if (ret != 0) 
+                return ret; 
+        salg->threshold = val; 
+        return count; 
+} 
  
-        mutex_lock(&lock); 
-        iowrite32(mode, ss_ctx->base + SUNXI_SS_CTL); 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* Calibration 
+ * For each cipher, the SS and the generic implementation are timed on 
+ * requests from SUNXI_SS_CALIB_MIN to SUNXI_SS_CALIB_MAX bytes, the threshold 
+ * is the first size where the SS is faster. 
+ * Done from a work since it waits for the SS queue. */ 
+#define SUNXI_SS_CALIB_MIN 16 
+#define SUNXI_SS_CALIB_MAX 4096 
+#define SUNXI_SS_CALIB_LOOPS 16 
  
-        for (i = 0; i < ctx->slen; i += 4) { 
-                v = *(u32 *)(ctx->seed + i); 
-                dev_info(ss_ctx->dev, "DEBUG Seed%d %x\n", i, v); 
+struct sunxi_calib_result { 
+        struct completion completion; 
+        int err; 
+}; 
+ 
+static void sunxi_calib_done(struct crypto_async_request *req, int err) 
+{ 
+        struct sunxi_calib_result *res = req->data; 
+ 
+        if (err == -EINPROGRESS) 
+                return; 
+        res->err = err; 
+        complete(&res->completion); 
+} 
+ 
+/* return the time in ns of SUNXI_SS_CALIB_LOOPS requests by the SS */ 
+static s64 sunxi_calib_ss(struct ablkcipher_request *req, 
+                struct sunxi_calib_result *res) 
+{ 
+        ktime_t start = ktime_get(); 
+        int i, ret; 
+ 
+        for (i = 0; i < SUNXI_SS_CALIB_LOOPS; i++) { 
+                ret = crypto_ablkcipher_encrypt(req); 
+                if (ret == -EINPROGRESS || ret == -EBUSY) { 
+                        wait_for_completion(&res->completion); 
+                        INIT_COMPLETION(res->completion); 
+                        ret = res->err; 
+                } 
+                if (ret != 0) 
+                        return -1; 
         } 
+        return ktime_to_ns(ktime_sub(ktime_get(), start)); 
+} 
  
-        for (i = 0; i < ctx->slen && i < 192/8 && i < 16; i += 4) { 
-                v = *(u32 *)(ctx->seed + i); 
-                dev_info(ss_ctx->dev, "DEBUG Seed%d %x\n", i, v); 
-                iowrite32(v, ss_ctx->base + SUNXI_SS_KEY0 + i); 
+/* return the time in ns of SUNXI_SS_CALIB_LOOPS requests by the fallback */ 
+static s64 sunxi_calib_sw(struct blkcipher_desc *desc, struct scatterlist *sg, 
+                unsigned int len) 
+{ 
+        ktime_t start = ktime_get(); 
+        int i; 
+ 
+        for (i = 0; i < SUNXI_SS_CALIB_LOOPS; i++) 
+                if (crypto_blkcipher_encrypt_iv(desc, sg, sg, len) != 0) 
+                        return -1; 
+        return ktime_to_ns(ktime_sub(ktime_get(), start)); 
+} 
+ 
+static int sunxi_calib_alg(struct sunxi_cipher_alg *salg, void *buf) 
+{ 
+        struct crypto_ablkcipher *tfm; 
+        struct crypto_blkcipher *sw; 
+        struct ablkcipher_request *req; 
+        struct blkcipher_desc desc; 
+        struct sunxi_calib_result res; 
+        struct scatterlist sg; 
+        u8 key[AES_KEY_MAX_LENGTH]; 
+        u8 iv[AES_KEY_MAX_LENGTH]; 
+        unsigned int keylen = salg->alg.cra_ablkcipher.min_keysize; 
+        unsigned int len; 
+        s64 tss, tsw; 
+        int ret; 
+ 
+        tfm = crypto_alloc_ablkcipher(salg->alg.cra_driver_name, 0, 0); 
+        if (IS_ERR(tfm)) 
+                return PTR_ERR(tfm); 
+        sw = crypto_alloc_blkcipher(salg->alg.cra_name, 0, 
+                        CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK); 
+        if (IS_ERR(sw)) { 
+                ret = PTR_ERR(sw); 
+                goto out_tfm; 
+        } 
+        req = ablkcipher_request_alloc(tfm, GFP_KERNEL); 
+        if (req == NULL) { 
+                ret = -ENOMEM; 
+                goto out_sw; 
         } 
  
-        mode |= SUNXI_PRNG_START; 
-        iowrite32(mode, ss_ctx->base + SUNXI_SS_CTL); 
-        for (i = 0; i < 4; i++) { 
-                v = ioread32(ss_ctx->base + SUNXI_SS_CTL); 
-                dev_info(ss_ctx->dev, "DEBUG CTL %x %x\n", mode, v); 
+        get_random_bytes(key, sizeof(key)); 
+        ret = crypto_ablkcipher_setkey(tfm, key, keylen); 
+        if (ret == 0) 
+                ret = crypto_blkcipher_setkey(sw, key, keylen); 
+        if (ret != 0) 
+                goto out_req; 
+ 
+        init_completion(&res.completion); 
+        ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG, 
+                        sunxi_calib_done, &res); 
+        desc.tfm = sw; 
+        desc.info = iv; 
+        desc.flags = CRYPTO_TFM_REQ_MAY_SLEEP; 
+ 
+        /* the SS must do all requests while measuring */ 
+        salg->threshold = 0; 
+        for (len = SUNXI_SS_CALIB_MIN; len <= SUNXI_SS_CALIB_MAX; len *= 2) { 
+                sg_init_one(&sg, buf, len); 
+                ablkcipher_request_set_crypt(req, &sg, &sg, len, iv); 
+                tss = sunxi_calib_ss(req, &res); 
+                tsw = sunxi_calib_sw(&desc, &sg, len); 
+                if (tss < 0 || tsw < 0) { 
+                        ret = -EIO; 
+                        break; 
+                } 
+                if (tss <= tsw) 
+                        break; 
         } 
-        for (i = 0; i < dlen && i < 160 / 8; i += 4) { 
-                v = ioread32(ss_ctx->base + SUNXI_SS_MD0 + i); 
-                *(u32 *)(rdata + i) = v; 
-                dev_info(ss_ctx->dev, "DEBUG MD%d %x\n", i, v); 
+        if (ret == 0) 
+                salg->threshold = min_t(unsigned int, len, SUNXI_SS_CALIB_MAX); 
+        dev_info(ss_ctx->dev, "%s fallback under %u bytes\n", 
+                        salg->alg.cra_name, salg->threshold); 
+ 
+out_req: 
+        ablkcipher_request_free(req); 
+out_sw: 
+        crypto_free_blkcipher(sw); 
+out_tfm: 
+        crypto_free_ablkcipher(tfm); 
+        return ret; 
+} 
+ 
+static void sunxi_ss_calibrate(struct work_struct *work) 
+{ 
+        void *buf; 
+        int i; 
+ 
+        buf = kzalloc(SUNXI_SS_CALIB_MAX, GFP_KERNEL); 
+        if (buf == NULL) 
+                return; 
+        for (i = 0; i < ARRAY_SIZE(sunxi_cipher_algs); i++) 
+                if (sunxi_calib_alg(&sunxi_cipher_algs[i], buf) != 0) 
+                        dev_warn(ss_ctx->dev, "calibration of %s failed\n", 
+                                        sunxi_cipher_algs[i].alg.cra_name); 
+        kfree(buf); 
+} 
+#endif /* SUNXI_SS_CIPHER_COMMON */ 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* sunxi_ss_queue_worker: handle all queued requests 
+ * The requests are completed from here, so memory could be allocated with 
+ * GFP_KERNEL whatever the context of the caller was. */ 
+static void sunxi_ss_queue_worker(struct work_struct *work) 
+{ 
+        struct crypto_async_request *req, *backlog; 
+        unsigned long flags; 
+        int err; 
+ 
+        for (;;) { 
+                spin_lock_irqsave(&ss_ctx->queue_lock, flags); 
+                backlog = crypto_get_backlog(&ss_ctx->queue); 
+                req = crypto_dequeue_request(&ss_ctx->queue); 
+                spin_unlock_irqrestore(&ss_ctx->queue_lock, flags); 
+                if (req == NULL) 
+                        return; 
+ 
+                if (backlog != NULL) 
+                        backlog->complete(backlog, -EINPROGRESS); 
+ 
+                err = -EINVAL; 
+                switch (crypto_tfm_alg_type(req->tfm)) { 
+#ifdef SUNXI_SS_HASH_COMMON 
+                case CRYPTO_ALG_TYPE_AHASH: 
+                        err = sunxi_hash_handle(ahash_request_cast(req)); 
+                        break; 
+#endif 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+                case CRYPTO_ALG_TYPE_ABLKCIPHER: 
+                        err = sunxi_aes_handle(ablkcipher_request_cast(req)); 
+                        break; 
+#endif 
+                } 
+ 
+                local_bh_disable(); 
+                req->complete(req, err); 
+                local_bh_enable(); 
         } 
+} 
+ 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_PRNG 
+/*============================================================================*/ 
+/*============================================================================*/ 
+#define SUNXI_SS_SEED_WORDS (192 / 32) 
+#define SUNXI_SS_PRNG_WORDS (160 / 32) 
  
+/* sunxi_ss_prng_generate: get nwords of random data 
+ * The PRNG is used in continue mode, it gives 160 bits at each step in the 
+ * TX FIFO, then the seed is updated from the key registers. */ 
+static void sunxi_ss_prng_generate(u32 *seed, u32 *data, unsigned int nwords) 
+{ 
+        unsigned int i, n; 
+ 
+        mutex_lock(&lock); 
+        iowrite32(SUNXI_OP_PRNG | SUNXI_PRNG_CONTINUE | SUNXI_SS_ENABLED, 
+                        ss_ctx->base + SUNXI_SS_CTL); 
+        while (nwords > 0) { 
+                for (i = 0; i < SUNXI_SS_SEED_WORDS; i++) 
+                        iowrite32(seed[i], ss_ctx->base + SUNXI_SS_KEY0 + i * 4); 
+                n = min_t(unsigned int, nwords, SUNXI_SS_PRNG_WORDS); 
+                for (i = 0; i < n; i++) 
+                        *data++ = ioread32(ss_ctx->base + SUNXI_SS_TXFIFO); 
+                nwords -= n; 
+                for (i = 0; i < SUNXI_SS_SEED_WORDS; i++) 
+                        seed[i] = ioread32(ss_ctx->base + SUNXI_SS_KEY0 + i * 4); 
+        } 
         iowrite32(0, ss_ctx->base + SUNXI_SS_CTL); 
         mutex_unlock(&lock); 
+} 
+ 
+/*============================================================================*/ 
+/*============================================================================*/ 
+static int sunxi_ss_rng_get_random(struct crypto_rng *tfm, u8 *rdata, 
+                unsigned int dlen) 
+{ 
+        struct prng_context *ctx = crypto_tfm_ctx((struct crypto_tfm *) tfm); 
+        u32 data[16]; 
+        unsigned int len, done; 
+ 
+        if (dlen == 0 || rdata == NULL) 
+                return 0; 
+ 
+        for (done = 0; done < dlen; done += len) { 
+                len = min_t(unsigned int, dlen - done, sizeof(data)); 
+                sunxi_ss_prng_generate((u32 *)ctx->seed, data, 
+                                DIV_ROUND_UP(len, 4)); 
+                memcpy(rdata + done, data, len); 
+        } 
         return dlen; 
 } 
  
@@ -1691,6 +1802,97 @@ static struct crypto_alg sunxi_ss_prng = {
                 .seedsize = 192/8 
         } 
 }; 
+ 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_HWRNG 
+/*============================================================================*/ 
+/*============================================================================*/ 
+/* hwrng provider 
+ * Reads are served from buf, a work refill it in bulk when it is 
+ * under SUNXI_SS_RNG_LOW bytes, so /dev/hwrng readers never poll the SS. */ 
+#define SUNXI_SS_RNG_BUF 4096 
+#define SUNXI_SS_RNG_LOW (SUNXI_SS_RNG_BUF / 4) 
+ 
+static struct sunxi_ss_rng { 
+        u32 seed[SUNXI_SS_SEED_WORDS]; 
+        u8 buf[SUNXI_SS_RNG_BUF]; 
+        unsigned int pos; /* first unread byte of buf */ 
+        unsigned int len; /* number of valid bytes in buf */ 
+        u32 fill[SUNXI_SS_RNG_BUF / 4]; /* only used by the refill work */ 
+        spinlock_t lock; 
+        wait_queue_head_t wait; 
+        struct work_struct refill; 
+} sunxi_rng; 
+ 
+static void sunxi_ss_rng_refill(struct work_struct *work) 
+{ 
+        struct sunxi_ss_rng *r = &sunxi_rng; 
+        unsigned long flags; 
+        unsigned int n; 
+ 
+        sunxi_ss_prng_generate(r->seed, r->fill, SUNXI_SS_RNG_BUF / 4); 
+ 
+        spin_lock_irqsave(&r->lock, flags); 
+        memmove(r->buf, r->buf + r->pos, r->len - r->pos); 
+        r->len -= r->pos; 
+        r->pos = 0; 
+        n = SUNXI_SS_RNG_BUF - r->len; 
+        memcpy(r->buf + r->len, r->fill, n); 
+        r->len += n; 
+        spin_unlock_irqrestore(&r->lock, flags); 
+ 
+        wake_up_interruptible(&r->wait); 
+} 
+ 
+static int sunxi_ss_hwrng_read(struct hwrng *rng, void *data, size_t max, 
+                bool wait) 
+{ 
+        struct sunxi_ss_rng *r = &sunxi_rng; 
+        unsigned long flags; 
+        size_t len; 
+        int low; 
+ 
+        for (;;) { 
+                spin_lock_irqsave(&r->lock, flags); 
+                len = min_t(size_t, max, r->len - r->pos); 
+                memcpy(data, r->buf + r->pos, len); 
+                r->pos += len; 
+                low = (r->len - r->pos < SUNXI_SS_RNG_LOW); 
+                spin_unlock_irqrestore(&r->lock, flags); 
+ 
+                if (low) 
+                        queue_work(ss_ctx->wq, &r->refill); 
+                if (len > 0 || !wait) 
+                        return len; 
+                if (wait_event_interruptible(r->wait, r->len > r->pos)) 
+                        return -ERESTARTSYS; 
+        } 
+} 
+ 
+static struct hwrng sunxi_ss_hwrng = { 
+        .name = "sunxi-ss", 
+        .read = sunxi_ss_hwrng_read, 
+}; 
+ 
+static int sunxi_ss_hwrng_register(void) 
+{ 
+        struct sunxi_ss_rng *r = &sunxi_rng; 
+ 
+        get_random_bytes(r->seed, sizeof(r->seed)); 
+        r->pos = 0; 
+        r->len = 0; 
+        spin_lock_init(&r->lock); 
+        init_waitqueue_head(&r->wait); 
+        INIT_WORK(&r->refill, sunxi_ss_rng_refill); 
+        queue_work(ss_ctx->wq, &r->refill); 
+        return hwrng_register(&sunxi_ss_hwrng); 
+} 
+ 
+static void sunxi_ss_hwrng_unregister(void) 
+{ 
+        hwrng_unregister(&sunxi_ss_hwrng); 
+        cancel_work_sync(&sunxi_rng.refill); 
+} 
+#endif /* CONFIG_CRYPTO_DEV_SUNXI_SS_HWRNG */ 
 #endif /* CRYPTO_DEV_SUNXI_SS_PRNG */ 
  
  
@@ -1718,6 +1920,9 @@ static int __init sunxi_ss_probe(struct platform_device *pdev)
         int err; 
         unsigned long cr; 
         struct clk *parent; 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+        int i; 
+#endif 
  
         memset(ss_ctx, 0, sizeof(struct sunxi_ss_ctx)); 
  
@@ -1832,17 +2037,29 @@ static int __init sunxi_ss_probe(struct platform_device *pdev)
  
         ss_ctx->buf_in = NULL; 
         ss_ctx->buf_in_size = 0; 
-        ss_ctx->buf_out = NULL; 
-        ss_ctx->buf_out_size = 0; 
         ss_ctx->rxdma_init = 0; 
         ss_ctx->txdma_init = 0; 
         ss_ctx->rxdma_start = 0; 
         ss_ctx->txdma_start = 0; 
+        ss_ctx->rxdma_left = 0; 
+        ss_ctx->txdma_left = 0; 
         ss_ctx->dev = &pdev->dev; 
  
 /*        TODO does I need this ?*/ 
 /*        mutex_init(&lock); */ 
  
+        init_completion(&ss_ctx->rxdma_done); 
+        init_completion(&ss_ctx->txdma_done); 
+        spin_lock_init(&ss_ctx->queue_lock); 
+        crypto_init_queue(&ss_ctx->queue, SUNXI_SS_QUEUE_LEN); 
+        INIT_WORK(&ss_ctx->work, sunxi_ss_queue_worker); 
+        ss_ctx->wq = create_singlethread_workqueue("sunxi-ss"); 
+        if (ss_ctx->wq == NULL) { 
+                dev_err(&pdev->dev, "Cannot create workqueue\n"); 
+                err = -ENOMEM; 
+                goto label_error_clock; 
+        } 
+ 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_PRNG 
         err = crypto_register_alg(&sunxi_ss_prng); 
         if (err) { 
@@ -1868,13 +2085,43 @@ static int __init sunxi_ss_probe(struct platform_device *pdev)
         } else 
                 dev_info(&pdev->dev, "Registred SHA1\n"); 
 #endif 
-#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_AES 
-        err = crypto_register_alg(&sunxi_aes_alg); 
-        if (err) { 
-                dev_err(&pdev->dev, "crypto_register_alg error for AES\n"); 
-                goto label_error_aes; 
-        } else 
-                dev_info(&pdev->dev, "Registred AES\n"); 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+        for (i = 0; i < ARRAY_SIZE(sunxi_cipher_algs); i++) { 
+                err = crypto_register_alg(&sunxi_cipher_algs[i].alg); 
+                if (err) { 
+                        dev_err(&pdev->dev, "crypto_register_alg error for %s\n", 
+                                        sunxi_cipher_algs[i].alg.cra_name); 
+                        goto label_error_cipher; 
+                } 
+                dev_info(&pdev->dev, "Registred %s\n", 
+                                sunxi_cipher_algs[i].alg.cra_name); 
+        } 
+        for (i = 0; i < ARRAY_SIZE(sunxi_cipher_algs); i++) { 
+                struct sunxi_cipher_alg *salg = &sunxi_cipher_algs[i]; 
+ 
+                /* "sunxi-cbc-aes" gives "cbc-aes_threshold" */ 
+                snprintf(salg->attr_name, sizeof(salg->attr_name), 
+                                "%s_threshold", salg->alg.cra_driver_name + 6); 
+                sysfs_attr_init(&salg->attr.attr); 
+                salg->attr.attr.name = salg->attr_name; 
+                salg->attr.attr.mode = S_IRUGO | S_IWUSR; 
+                salg->attr.show = sunxi_threshold_show; 
+                salg->attr.store = sunxi_threshold_store; 
+                if (device_create_file(&pdev->dev, &salg->attr) != 0) 
+                        dev_warn(&pdev->dev, "Cannot create %s\n", 
+                                        salg->attr_name); 
+        } 
+        INIT_WORK(&ss_ctx->calib_work, sunxi_ss_calibrate); 
+        if (calibrate) 
+                schedule_work(&ss_ctx->calib_work); 
+#endif 
+ 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_HWRNG 
+        /* not fatal, the crypto API users still work without it */ 
+        if (sunxi_ss_hwrng_register() != 0) 
+                dev_err(&pdev->dev, "Fail to register hwrng\n"); 
+        else 
+                dev_info(&pdev->dev, "Registred hwrng\n"); 
 #endif 
  
 #ifdef SUNXI_SS_WAIT_QUEUE 
@@ -1890,9 +2137,10 @@ static int __init sunxi_ss_probe(struct platform_device *pdev)
                 dev_info(&pdev->dev, "Options: Optimal mode\n"); 
         return 0; 
  
-#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_AES 
-label_error_aes: 
-        crypto_unregister_alg(&sunxi_aes_alg); 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+label_error_cipher: 
+        while (--i >= 0) 
+                crypto_unregister_alg(&sunxi_cipher_algs[i].alg); 
 #endif 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_SHA1 
 label_error_sha1: 
@@ -1906,6 +2154,7 @@ label_error_md5:
 label_error_prng: 
         crypto_unregister_alg(&sunxi_ss_prng); 
 #endif 
+        destroy_workqueue(ss_ctx->wq); 
 label_error_clock: 
         if (ss_ctx->ssclk != NULL) { 
                 clk_disable_unprepare(ss_ctx->ssclk); 
@@ -1926,21 +2175,38 @@ label_error_mem:
 /*============================================================================*/ 
 static int __exit sunxi_ss_remove(struct platform_device *pdev) 
 { 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+        int i; 
+#endif 
+ 
         dev_info(&pdev->dev, "%s\n", __func__); 
  
+#ifdef SUNXI_SS_CIPHER_COMMON 
+        cancel_work_sync(&ss_ctx->calib_work); 
+        for (i = 0; i < ARRAY_SIZE(sunxi_cipher_algs); i++) 
+                device_remove_file(&pdev->dev, &sunxi_cipher_algs[i].attr); 
+#endif 
+#ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_HWRNG 
+        sunxi_ss_hwrng_unregister(); 
+#endif 
         crypto_unregister_ahash(&sunxi_md5_alg); 
         crypto_unregister_ahash(&sunxi_sha1_alg); 
 #ifdef CONFIG_CRYPTO_DEV_SUNXI_SS_PRNG 
         crypto_unregister_alg(&sunxi_ss_prng); 
 #endif 
-        crypto_unregister_alg(&sunxi_aes_alg); 
+#ifdef SUNXI_SS_CIPHER_COMMON 
+        for (i = 0; i < ARRAY_SIZE(sunxi_cipher_algs); i++) 
+                crypto_unregister_alg(&sunxi_cipher_algs[i].alg); 
+#endif 
         dev_info(&pdev->dev, "%s after crypto_unregister\n", __func__); 
  
+        /* wait for the queued requests */ 
+        flush_workqueue(ss_ctx->wq); 
+        destroy_workqueue(ss_ctx->wq); 
+ 
         if (ss_ctx->buf_in != NULL) 
                 kfree(ss_ctx->buf_in); 
                 /*free_pages((unsigned long)ss_ctx->buf_in, 0);*/ 
-        if (ss_ctx->buf_out != NULL) 
-                kfree(ss_ctx->buf_out); 
         if (ss_ctx->rxdma_init == 1) 
                 ss_sunxi_release_dma(&ssrx_dma); 
         if (ss_ctx->txdma_init == 1) 
@@ -25,6 +25,7 @@
 #include <linux/platform_device.h>
 #include <linux/interrupt.h>
 #include <linux/irq.h>
+#include <linux/irqdomain.h>
 #include <linux/errno.h>
 #include <linux/gpio.h>
 #include <linux/io.h>
@@ -39,6 +40,7 @@
 
 static struct gpio_eint_data *gpio_eint_list;
 static u32 gpio_eint_count;
+static struct sunxi_gpio_chip *sunxi_gpio;
 
 static inline struct sunxi_gpio_chip *to_sunxi_gpio(struct gpio_chip *chip)
 {
@@ -76,6 +78,7 @@ static int sunxi_find_gpio_irq(struct gpio_chip *chip, unsigned offset)
 
 /* Check if GPIO can be EINT source and return its virtual irq */
 /* number. These irq numbers handled by separate virtual irq chip */
+/* The eint line of each pin is looked up once, at probe time     */
 static int sunxi_gpio_to_irq(struct gpio_chip *chip, unsigned offset)
 {
 	int eint;
@@ -84,10 +87,10 @@ static int sunxi_gpio_to_irq(struct gpio_chip *chip, unsigned offset)
 	if ((offset > chip->ngpio - 1) || (offset < 0))
 		return -EINVAL;
 
-	eint = sunxi_find_gpio_irq(chip, offset);
+	eint = sgpio->data[offset].eint;
 
-	if ((sgpio->irq_base >= 0) && (eint >= 0))
-		return sgpio->irq_base + eint;
+	if (sgpio->domain && (eint >= 0))
+		return irq_find_mapping(sgpio->domain, eint);
 
 	return -EINVAL;
 }
@@ -116,9 +119,9 @@ static int sunxi_gpio_get(struct gpio_chip *chip, unsigned gpio)
 				    sgpio->data[gpio].eint_mux);
 		spin_unlock_irqrestore(&sgpio->irq_lock, flags);
 	} else {
-		/* "normal" pin read */
-		ret = gpio_read_one_pin_value(sgpio->data[gpio].gpio_handler,
-						sgpio->data[gpio].pin_name);
+		/* "normal" pin read, input or output */
+		ret = (sunxi_pio_read(sgpio->data[gpio].info.port) >>
+		       sgpio->data[gpio].info.port_num) & 1;
 	}
 
 	return ret;
@@ -127,13 +130,36 @@ static int sunxi_gpio_get(struct gpio_chip *chip, unsigned gpio)
 /* Set gpio pin value */
 static void sunxi_gpio_set(struct gpio_chip *chip, unsigned gpio, int val)
 {
-	int ret;
 	struct sunxi_gpio_chip *sgpio = to_sunxi_gpio(chip);
-	ret = gpio_write_one_pin_value(sgpio->data[gpio].gpio_handler,
-					val, sgpio->data[gpio].pin_name);
-	return;
+	u32 mask = 1 << sgpio->data[gpio].info.port_num;
+
+	/* like gpio_write_one_pin_value(), only drives outputs */
+	if (sgpio->data[gpio].info.mul_sel == SUNXI_GPIO_OUTPUT)
+		sunxi_pio_write(sgpio->data[gpio].info.port, mask,
+				val ? mask : 0);
 }
 
+/*
+ * For the bank API of plat/sys_config.h: which port and pin a gpio of
+ * this chip is. The caller has to have requested it.
+ */
+int sunxi_gpio_to_pio(unsigned gpio, unsigned *port, unsigned *pin)
+{
+	struct sunxi_gpio_chip *sgpio = sunxi_gpio;
+	unsigned offset;
+
+	if (!sgpio || gpio < sgpio->chip.base)
+		return -EINVAL;
+	offset = gpio - sgpio->chip.base;
+	if (offset >= sgpio->chip.ngpio)
+		return -EINVAL;
+
+	*port = sgpio->data[offset].info.port;
+	*pin = sgpio->data[offset].info.port_num;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_gpio_to_pio);
+
 /* Set gpio pin input mode */
 static int sunxi_gpio_direction_in(struct gpio_chip *chip, unsigned gpio)
 {
@@ -196,15 +222,16 @@ static int sunxi_gpio_request(struct gpio_chip *chip, unsigned offset)
 	}
 
 	/* Save eint in gpio data for irq -> gpio conversion */
-	eint = sunxi_find_gpio_irq(chip, offset);
+	eint = sgpio->data[offset].eint;
 	sgpio->data[offset].eint_mux = -1;
+
+	/* Set gpio input mode (gpiolib initial mode) */
+	spin_lock_irqsave(&sgpio->irq_lock, flags);
 	if (eint >= 0) {
 		sgpio->data[offset].eint_mux = gpio_eint_list[eint].mux;
 		gpio_eint_list[eint].gpio = offset;
+		sgpio->eint_owned |= 1 << eint;
 	}
-
-	/* Set gpio input mode (gpiolib initial mode) */
-	spin_lock_irqsave(&sgpio->irq_lock, flags);
 	SUNXI_SET_GPIO_MODE(sgpio->gaddr, sgpio->data[offset].info.port,
 			    sgpio->data[offset].info.port_num,
 			    SUNXI_GPIO_INPUT);
@@ -217,6 +244,7 @@ static int sunxi_gpio_request(struct gpio_chip *chip, unsigned offset)
 static void sunxi_gpio_free(struct gpio_chip *chip, unsigned offset)
 {
 	int eint = 0;
+	unsigned long flags;
 	struct sunxi_gpio_chip *sgpio = to_sunxi_gpio(chip);
 	if ((offset > chip->ngpio - 1) || (offset < 0))
 		return;
@@ -224,9 +252,13 @@ static void sunxi_gpio_free(struct gpio_chip *chip, unsigned offset)
 	gpio_release(sgpio->data[offset].gpio_handler, 1);
 
 	/* Mark irq unused (for irq_handler) */
-	eint = sunxi_gpio_to_irq(chip, offset) - sgpio->irq_base;
-	if (eint >= 0)
+	eint = sgpio->data[offset].eint;
+	if (eint >= 0) {
+		spin_lock_irqsave(&sgpio->irq_lock, flags);
 		gpio_eint_list[eint].gpio = -1;
+		sgpio->eint_owned &= ~(1 << eint);
+		spin_unlock_irqrestore(&sgpio->irq_lock, flags);
+	}
 }
 
 static struct gpio_chip template_chip = {
@@ -246,7 +278,7 @@ static int sunxi_gpio_irq_set_type(struct irq_data *d, unsigned int type)
 	unsigned long flags;
 	unsigned int int_mode = POSITIVE_EDGE;
 	struct sunxi_gpio_chip *sgpio = irq_data_get_irq_chip_data(d);
-	int offset = d->irq - sgpio->irq_base;
+	int offset = irqd_to_hwirq(d);
 
 	if (type == IRQ_TYPE_LEVEL_LOW)
 		int_mode = LOW_LEVEL;
@@ -261,14 +293,27 @@ static int sunxi_gpio_irq_set_type(struct irq_data *d, unsigned int type)
 	SUNXI_SET_GPIO_IRQ_TYPE(sgpio->gaddr, offset, int_mode);
 	spin_unlock_irqrestore(&sgpio->irq_lock, flags);
 
+	/* level lines stay masked until a threaded handler is done */
+	if (type & IRQ_TYPE_LEVEL_MASK)
+		__irq_set_handler_locked(d->irq, handle_level_irq);
+	else
+		__irq_set_handler_locked(d->irq, handle_edge_irq);
+
 	return 0;
 }
 
+static void sunxi_gpio_irq_ack(struct irq_data *d)
+{
+	struct sunxi_gpio_chip *sgpio = irq_data_get_irq_chip_data(d);
+
+	SUNXI_CLEAR_EINT(sgpio->gaddr, irqd_to_hwirq(d));
+}
+
 static void sunxi_gpio_irq_mask_ack(struct irq_data *d)
 {
 	unsigned long flags;
 	struct sunxi_gpio_chip *sgpio = irq_data_get_irq_chip_data(d);
-	int offset = d->irq - sgpio->irq_base;
+	int offset = irqd_to_hwirq(d);
 	spin_lock_irqsave(&sgpio->irq_lock, flags);
 	SUNXI_MASK_GPIO_IRQ(sgpio->gaddr, offset);
 	SUNXI_CLEAR_EINT(sgpio->gaddr, offset);
@@ -279,7 +324,7 @@ static void sunxi_gpio_irq_mask(struct irq_data *d)
 {
 	unsigned long flags;
 	struct sunxi_gpio_chip *sgpio = irq_data_get_irq_chip_data(d);
-	int offset = d->irq - sgpio->irq_base;
+	int offset = irqd_to_hwirq(d);
 	spin_lock_irqsave(&sgpio->irq_lock, flags);
 	SUNXI_MASK_GPIO_IRQ(sgpio->gaddr, offset);
 	spin_unlock_irqrestore(&sgpio->irq_lock, flags);
@@ -290,7 +335,7 @@ static void sunxi_gpio_irq_unmask(struct irq_data *d)
 	int gpio;
 	unsigned long flags;
 	struct sunxi_gpio_chip *sgpio = irq_data_get_irq_chip_data(d);
-	int offset = d->irq - sgpio->irq_base;
+	int offset = irqd_to_hwirq(d);
 
 	spin_lock_irqsave(&sgpio->irq_lock, flags);
 
@@ -312,6 +357,7 @@ static void sunxi_gpio_irq_unmask(struct irq_data *d)
 /* IRQ_CHIP with EINT_NUM interrupts to demux single A1X PIO irq line */
 static struct irq_chip sunxi_gpio_irq_chip = {
 	.name			= "gpio-sunxi",
+	.irq_ack		= sunxi_gpio_irq_ack,
 	.irq_mask		= sunxi_gpio_irq_mask,
 	.irq_mask_ack		= sunxi_gpio_irq_mask_ack,
 	.irq_unmask		= sunxi_gpio_irq_unmask,
@@ -395,26 +441,33 @@ static void __devinit sunxi_gpio_eint_probe(void)
 	}
 }
 
-/* IRQ handler - redirect interrupts to virtual irq chip */
+/*
+ * IRQ handler - redirect interrupts to virtual irq chip. The PIO line
+ * is shared with drivers that still poll the eint status themselves,
+ * so only lines requested through gpiolib are handled here, and only
+ * the pending ones: each is one ffs and one domain lookup. The flow
+ * handler of the line acks it; with request_threaded_irq() the
+ * handlers run in their own threads and a busy line doesn't hold up
+ * the others.
+ */
 static irqreturn_t sunxi_gpio_irq_handler(int irq, void *devid)
 {
 	__u32 status = 0;
 	int i = 0;
 	struct sunxi_gpio_chip *sgpio = devid;
-	status = readl(sgpio->gaddr + PIO_INT_STAT_OFFSET);
-
-	for (i = 0; i < EINT_NUM; i++) {
-		if ((status & (1 << i)) &&
-		    (gpio_eint_list[i].gpio >= 0)) {
-			status &= ~(1 << i);
-			SUNXI_CLEAR_EINT(sgpio->gaddr, i);
-			generic_handle_irq(sgpio->irq_base + i);
-		}
-	}
+	status = readl(sgpio->gaddr + PIO_INT_STAT_OFFSET) &
+		 readl(sgpio->gaddr + PIO_INT_CTRL_OFFSET) &
+		 sgpio->eint_owned;
 
-	if (status)
+	if (!status)
 		return IRQ_NONE;
 
+	while (status) {
+		i = __ffs(status);
+		status &= ~(1 << i);
+		generic_handle_irq(irq_find_mapping(sgpio->domain, i));
+	}
+
 	return IRQ_HANDLED;
 }
 
@@ -430,11 +483,16 @@ static int __devinit sunxi_gpio_irq_init(struct sunxi_gpio_chip *sgpio)
 	for (irq = base; irq < base + EINT_NUM; irq++) {
 		irq_set_chip_data(irq, sgpio);
 		irq_set_chip(irq, &sunxi_gpio_irq_chip);
-		irq_set_handler(irq, handle_simple_irq);
+		irq_set_handler(irq, handle_edge_irq);
 		irq_modify_status(irq, IRQ_NOREQUEST | IRQ_NOAUTOEN,
 				  IRQ_NOPROBE);
 	}
 
+	sgpio->domain = irq_domain_add_legacy(NULL, EINT_NUM, base, 0,
+					      &irq_domain_simple_ops, sgpio);
+	if (!sgpio->domain)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -447,6 +505,11 @@ static void sunxi_gpio_irq_remove(struct sunxi_gpio_chip *sgpio)
 	if (base < 0)
 		return;
 
+	if (sgpio->domain) {
+		irq_domain_remove(sgpio->domain);
+		sgpio->domain = NULL;
+	}
+
 	for (irq = base; irq < base + EINT_NUM; irq++) {
 		irq_set_handler(irq, NULL);
 		irq_set_chip(irq, NULL);
@@ -562,6 +625,8 @@ static int __devinit sunxi_gpio_probe(struct platform_device *pdev)
 
 	/* configure EINTs for the detected SoC */
 	sunxi_gpio_eint_probe();
+	for (i = 0; i < gpio_num; i++)
+		gpio_data[i].eint = sunxi_find_gpio_irq(&sunxi_chip->chip, i);
 
 	/* This needs additional system irq numbers (NR_IRQ=NR_IRQ+EINT_NUM) */
 	if (EINT_NUM > 0) {
@@ -574,7 +639,11 @@ static int __devinit sunxi_gpio_probe(struct platform_device *pdev)
 		pr_info("GPIO irq support disabled in this platform\n");
 
 	spin_lock_init(&sunxi_chip->irq_lock);
-	sunxi_gpio_irq_init(sunxi_chip);
+	if (sunxi_gpio_irq_init(sunxi_chip)) {
+		pr_err("Couldn't set up the eint domain. GPIO irq support disabled\n");
+		sunxi_gpio_irq_remove(sunxi_chip);
+		sunxi_chip->irq_base = -1;
+	}
 
 	if (sunxi_chip->irq_base >= 0) {
 		err = request_irq(GPIO_IRQ_NO, sunxi_gpio_irq_handler,
@@ -590,6 +659,7 @@ static int __devinit sunxi_gpio_probe(struct platform_device *pdev)
 		goto irqhdl;
 
 	platform_set_drvdata(pdev, sunxi_chip);
+	sunxi_gpio = sunxi_chip;
 	return 0;
 
 irqhdl:
@@ -613,6 +683,7 @@ static int __devexit sunxi_gpio_remove(struct platform_device *pdev)
 	int ret = 0;
 	struct sunxi_gpio_chip *sunxi_chip = platform_get_drvdata(pdev);
 	pr_info("sunxi_gpio driver exit\n");
+	sunxi_gpio = NULL;
 
 	ret = gpiochip_remove(&sunxi_chip->chip);
 	if (ret < 0)
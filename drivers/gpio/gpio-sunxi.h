@@ -43,6 +43,7 @@ struct sunxi_gpio_data {
 	unsigned gpio_handler;
 	script_gpio_set_t info;
 	int eint_mux;
+	int eint;		/* line in gpio_eint_list, -1: none */
 	char pin_name[16];
 };
 
@@ -51,6 +52,8 @@ struct sunxi_gpio_chip {
 	struct sunxi_gpio_data *data;
 	struct device *dev;
 	int irq_base;
+	struct irq_domain *domain;	/* eint line -> irq */
+	u32 eint_owned;			/* lines requested through us */
 	int gpio_num;
 	void __iomem *gaddr;
 	spinlock_t irq_lock;
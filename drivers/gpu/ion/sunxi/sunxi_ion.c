@@ -0,0 +1,234 @@
+/*
+ * drivers/gpu/ion/sunxi/sunxi_ion.c
+ *
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * The ion device of sunxi, see include/linux/sunxi_ion.h for the heaps.
+ * Buffers are dma-bufs, so disp, g2d, cedar and ump take them like any
+ * other exporter's; disp, g2d and cedar need contiguous ones.
+ *
+ * With CMA the VE and scanout heaps both allocate from the CMA area,
+ * which core.c keeps in the first 256MB. The VE heap checks every
+ * buffer against the window anyway, the area may be larger than that.
+ */
+
+#include <linux/err.h>
+#include <linux/ion.h>
+#include <linux/sunxi_ion.h>
+#include <linux/platform_device.h>
+#include <linux/dma-mapping.h>
+#include <linux/slab.h>
+#include <linux/module.h>
+#include <mach/hardware.h>
+#include "../ion_priv.h"
+
+/* the VE only reaches the first 256MB of dram */
+#define SUNXI_ION_VE_LIMIT	(SW_PA_SDRAM_START + SZ_256M)
+
+#ifndef CONFIG_CMA
+extern unsigned long ion_start;
+extern unsigned long ion_size;
+#endif
+
+static struct ion_device *sunxi_ion_idev;
+static struct ion_heap *sunxi_ion_heaps[3];
+static int sunxi_ion_nr_heaps;
+
+#ifdef CONFIG_CMA
+static struct ion_heap_ops sunxi_ion_ve_ops;
+static int (*sunxi_ion_cma_allocate)(struct ion_heap *heap,
+				     struct ion_buffer *buffer,
+				     unsigned long len, unsigned long align,
+				     unsigned long flags);
+
+/* a cma buffer the VE can't reach goes back right away */
+static int sunxi_ion_ve_allocate(struct ion_heap *heap,
+				 struct ion_buffer *buffer, unsigned long len,
+				 unsigned long align, unsigned long flags)
+{
+	ion_phys_addr_t addr;
+	size_t size;
+	int ret;
+
+	ret = sunxi_ion_cma_allocate(heap, buffer, len, align, flags);
+	if (ret)
+		return ret;
+
+	if (heap->ops->phys(heap, buffer, &addr, &size) ||
+	    addr + size > SUNXI_ION_VE_LIMIT) {
+		heap->ops->free(buffer);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+#endif
+
+static struct ion_platform_heap sunxi_ion_heap_data[] = {
+	{
+		.type	= ION_HEAP_TYPE_SYSTEM,
+		.id	= SUNXI_ION_HEAP_SYSTEM,
+		.name	= "system",
+	},
+#ifdef CONFIG_CMA
+	{
+		.type	= ION_HEAP_TYPE_DMA,
+		.id	= SUNXI_ION_HEAP_VE,
+		.name	= "ve",
+	},
+	{
+		.type	= ION_HEAP_TYPE_DMA,
+		.id	= SUNXI_ION_HEAP_SCANOUT,
+		.name	= "scanout",
+	},
+#else
+	{
+		.type	= ION_HEAP_TYPE_CARVEOUT,
+		.id	= SUNXI_ION_HEAP_VE,
+		.name	= "ve",
+	},
+#endif
+};
+
+static struct ion_platform_data sunxi_ion_pdata = {
+	.nr	= ARRAY_SIZE(sunxi_ion_heap_data),
+	.heaps	= sunxi_ion_heap_data,
+};
+
+static u64 sunxi_ion_dmamask = DMA_BIT_MASK(32);
+
+static struct platform_device sunxi_ion_device = {
+	.name	= "ion-sunxi",
+	.id	= -1,
+	.dev	= {
+		.dma_mask		= &sunxi_ion_dmamask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+		.platform_data		= &sunxi_ion_pdata,
+	},
+};
+
+struct ion_client *sunxi_ion_client_create(const char *name)
+{
+	if (!sunxi_ion_idev)
+		return ERR_PTR(-ENODEV);
+
+	return ion_client_create(sunxi_ion_idev, name);
+}
+EXPORT_SYMBOL(sunxi_ion_client_create);
+
+static int sunxi_ion_probe(struct platform_device *pdev)
+{
+	struct ion_platform_data *pdata = pdev->dev.platform_data;
+	struct ion_device *idev;
+	int err;
+	int i;
+
+	idev = ion_device_create(NULL);
+	if (IS_ERR_OR_NULL(idev))
+		return idev ? PTR_ERR(idev) : -ENOMEM;
+
+	for (i = 0; i < pdata->nr; i++) {
+		struct ion_platform_heap *heap_data = &pdata->heaps[i];
+		struct ion_heap *heap;
+
+		if (heap_data->type == ION_HEAP_TYPE_DMA)
+			heap_data->priv = &pdev->dev;
+#ifndef CONFIG_CMA
+		if (heap_data->type == ION_HEAP_TYPE_CARVEOUT) {
+			if (!ion_size ||
+			    ion_start + ion_size > SUNXI_ION_VE_LIMIT) {
+				pr_warn("ion-sunxi: no carveout in the VE window, "
+					"%s heap disabled\n", heap_data->name);
+				continue;
+			}
+			heap_data->base = ion_start;
+			heap_data->size = ion_size;
+		}
+#endif
+
+		heap = ion_heap_create(heap_data);
+		if (IS_ERR_OR_NULL(heap)) {
+			err = heap ? PTR_ERR(heap) : -ENOMEM;
+			goto err;
+		}
+#ifdef CONFIG_CMA
+		if (heap_data->id == SUNXI_ION_HEAP_VE) {
+			sunxi_ion_ve_ops = *heap->ops;
+			sunxi_ion_cma_allocate = heap->ops->allocate;
+			sunxi_ion_ve_ops.allocate = sunxi_ion_ve_allocate;
+			heap->ops = &sunxi_ion_ve_ops;
+		}
+#endif
+		ion_device_add_heap(idev, heap);
+		sunxi_ion_heaps[sunxi_ion_nr_heaps++] = heap;
+	}
+
+	sunxi_ion_idev = idev;
+	platform_set_drvdata(pdev, idev);
+	return 0;
+
+err:
+	ion_device_destroy(idev);
+	while (sunxi_ion_nr_heaps)
+		ion_heap_destroy(sunxi_ion_heaps[--sunxi_ion_nr_heaps]);
+	return err;
+}
+
+static int sunxi_ion_remove(struct platform_device *pdev)
+{
+	struct ion_device *idev = platform_get_drvdata(pdev);
+
+	sunxi_ion_idev = NULL;
+	ion_device_destroy(idev);
+	while (sunxi_ion_nr_heaps)
+		ion_heap_destroy(sunxi_ion_heaps[--sunxi_ion_nr_heaps]);
+	return 0;
+}
+
+static struct platform_driver sunxi_ion_driver = {
+	.probe	= sunxi_ion_probe,
+	.remove	= sunxi_ion_remove,
+	.driver	= {
+		.name	= "ion-sunxi",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init sunxi_ion_init(void)
+{
+	int ret;
+
+	ret = platform_device_register(&sunxi_ion_device);
+	if (ret)
+		return ret;
+
+	ret = platform_driver_register(&sunxi_ion_driver);
+	if (ret)
+		platform_device_unregister(&sunxi_ion_device);
+	return ret;
+}
+
+static void __exit sunxi_ion_exit(void)
+{
+	platform_driver_unregister(&sunxi_ion_driver);
+	platform_device_unregister(&sunxi_ion_device);
+}
+
+module_init(sunxi_ion_init);
+module_exit(sunxi_ion_exit);
+
+MODULE_DESCRIPTION("sunxi ion heaps");
+MODULE_LICENSE("GPL");
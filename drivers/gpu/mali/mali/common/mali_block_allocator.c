@@ -11,6 +11,7 @@
 #include "mali_kernel_memory_engine.h"
 #include "mali_block_allocator.h"
 #include "mali_osk.h"
+#include "mali_session.h"
 
 #define MALI_BLOCK_SIZE (256UL * 1024UL)  /* 256 kB, remember to keep the ()s */
 
@@ -225,6 +226,9 @@ static mali_physical_memory_allocation_result block_allocator_allocate(void* ctx
 		ret_allocation->engine = engine;
 		ret_allocation->descriptor = descriptor;
 
+		mali_session_stats_memory((struct mali_session_data *)descriptor->mali_addr_mapping_info,
+		                          MALI_SESSION_MEM_DEDICATED, ret_allocation->mapping_length);
+
 		alloc_info->ctx = info;
 		alloc_info->handle = ret_allocation;
 		alloc_info->release = block_allocator_release;
@@ -261,6 +265,8 @@ static void block_allocator_release(void * ctx, void * handle)
 
 	/* unmap */
 	mali_allocation_engine_unmap_physical(allocation->engine, allocation->descriptor, allocation->start_offset, allocation->mapping_length, (_mali_osk_mem_mapregion_flags_t)0);
+	mali_session_stats_memory((struct mali_session_data *)allocation->descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_DEDICATED, -(s32)allocation->mapping_length);
 
 	while (block)
 	{
@@ -592,6 +592,7 @@ _mali_osk_errcode_t mali_group_start_gp_job(struct mali_group *group, struct mal
 
 		group->gp_running_job = job;
 		group->state = MALI_GROUP_STATE_WORKING;
+		group->job_start_ns = _mali_osk_time_get_ns();
 
 		/* Setup the timeout timer value and save the job id for the job running on the gp core */
 		_mali_osk_timer_mod(group->timeout_timer, _mali_osk_time_mstoticks(mali_max_job_runtime));
@@ -711,6 +712,7 @@ _mali_osk_errcode_t mali_group_start_pp_job(struct mali_group *group, struct mal
 		group->pp_running_job = job;
 		group->pp_running_sub_job = sub_job;
 		group->state = MALI_GROUP_STATE_WORKING;
+		group->job_start_ns = _mali_osk_time_get_ns();
 
 		/* Setup the timeout timer value and save the job id for the job running on the pp core */
 		_mali_osk_timer_mod(group->timeout_timer, _mali_osk_time_mstoticks(mali_max_job_runtime));
@@ -743,6 +745,7 @@ struct mali_gp_job *mali_group_resume_gp_with_new_heap(struct mali_group *group,
 	_mali_osk_profiling_add_event(MALI_PROFILING_EVENT_TYPE_RESUME|MALI_PROFILING_MAKE_EVENT_CHANNEL_GP(0), 0, 0, 0, 0, 0);
 
 	group->state = MALI_GROUP_STATE_WORKING;
+	group->job_start_ns = _mali_osk_time_get_ns();
 
 	return group->gp_running_job;
 }
@@ -1149,6 +1152,8 @@ static void mali_group_mmu_page_fault(struct mali_group *group)
 {
 	MALI_ASSERT_GROUP_LOCKED(group);
 
+	mali_session_stats_mmu_fault(group->session);
+
 	if (NULL != group->pp_core)
 	{
 		struct mali_pp_job *pp_job_to_return;
@@ -1385,6 +1390,10 @@ static void mali_group_post_process_job_gp(struct mali_group *group, mali_bool s
 		return;
 	}
 
+	/* a suspended job is accounted again when it finishes after the resume */
+	mali_session_stats_job(mali_gp_job_get_session(group->gp_running_job), MALI_FALSE,
+	                       _mali_osk_time_get_ns() - group->job_start_ns, !suspend);
+
 	mali_gp_update_performance_counters(group->gp_core, group->gp_running_job, suspend);
 
 #if defined(CONFIG_MALI400_PROFILING)
@@ -1687,6 +1696,10 @@ static void mali_group_post_process_job_pp(struct mali_group *group)
 
 	if (NULL != group->pp_running_job)
 	{
+		/* the job count goes up in the scheduler, once all sub jobs are done */
+		mali_session_stats_job(mali_pp_job_get_session(group->pp_running_job), MALI_TRUE,
+		                       _mali_osk_time_get_ns() - group->job_start_ns, MALI_FALSE);
+
 		if (MALI_TRUE == mali_group_is_virtual(group))
 		{
 			struct mali_group *child;
@@ -80,6 +80,8 @@ struct mali_group
 
 	_mali_osk_timer_t           *timeout_timer;
 	mali_bool                   core_timed_out;
+
+	u64                         job_start_ns;   /* start of the running job, for session stats */
 };
 
 /** @brief Create a new Mali group object
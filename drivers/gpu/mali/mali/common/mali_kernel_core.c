@@ -1109,6 +1109,8 @@ _mali_osk_errcode_t _mali_ukk_open(void **context)
 
 	*context = (void*)session;
 
+	session->pid = _mali_osk_get_pid();
+
 	/* Add session to the list of all sessions. */
 	mali_session_add(session);
 
@@ -11,6 +11,7 @@
 #include "mali_kernel_common.h"
 #include "mali_kernel_memory_engine.h"
 #include "mali_osk.h"
+#include "mali_session.h"
 
 typedef struct os_allocation
 {
@@ -187,6 +188,8 @@ static mali_physical_memory_allocation_result os_allocator_allocate(void* ctx, m
 			allocation->engine = engine;         /* Necessary to make the engine's unmap call */
 			allocation->descriptor = descriptor; /* Necessary to make the engine's unmap call */
 			info->num_pages_allocated += pages_allocated;
+			mali_session_stats_memory((struct mali_session_data *)descriptor->mali_addr_mapping_info,
+			                          MALI_SESSION_MEM_OS, pages_allocated * _MALI_OSK_CPU_PAGE_SIZE);
 
 			MALI_DEBUG_PRINT(6, ("%d out of %d pages now allocated\n", info->num_pages_allocated, info->num_pages_max));
 
@@ -234,6 +237,8 @@ static void os_allocator_release(void * ctx, void * handle)
 
 	MALI_DEBUG_ASSERT( allocation->num_pages <= info->num_pages_allocated);
 	info->num_pages_allocated -= allocation->num_pages;
+	mali_session_stats_memory((struct mali_session_data *)descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_OS, -(s32)(allocation->num_pages * _MALI_OSK_CPU_PAGE_SIZE));
 
 	mali_allocation_engine_unmap_physical( engine, descriptor, allocation->offset_start, _MALI_OSK_CPU_PAGE_SIZE*allocation->num_pages, _MALI_OSK_MEM_MAPREGION_FLAG_OS_ALLOCATED_PHYSADDR );
 
@@ -517,6 +517,9 @@ static mali_physical_memory_allocation_result ump_memory_commit(void* ctx, mali_
 	ret_allocation->ump_mem = ump_mem;
 	ret_allocation->size_allocated = *offset - ret_allocation->initial_offset;
 
+	mali_session_stats_memory((struct mali_session_data *)descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_UMP, ret_allocation->size_allocated);
+
 	alloc_info->ctx = NULL;
 	alloc_info->handle = ret_allocation;
 	alloc_info->next = NULL;
@@ -546,6 +549,8 @@ static void ump_memory_release(void * ctx, void * handle)
 										   allocation->size_allocated,
 										   (_mali_osk_mem_mapregion_flags_t)0
 										   );
+	mali_session_stats_memory((struct mali_session_data *)allocation->descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_UMP, -(s32)allocation->size_allocated);
 	_mali_osk_free( allocation );
 
 
@@ -731,6 +736,9 @@ static mali_physical_memory_allocation_result external_memory_commit(void* ctx,
 
 	ret_allocation->size = *offset - ret_allocation->initial_offset;
 
+	mali_session_stats_memory((struct mali_session_data *)descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_EXTERNAL, ret_allocation->size);
+
 	return MALI_MEM_ALLOC_FINISHED;
 }
 
@@ -750,6 +758,8 @@ static void external_memory_release(void * ctx, void * handle)
 										   allocation->size,
 										   (_mali_osk_mem_mapregion_flags_t)0
 										   );
+	mali_session_stats_memory((struct mali_session_data *)allocation->descriptor->mali_addr_mapping_info,
+	                          MALI_SESSION_MEM_EXTERNAL, -(s32)allocation->size);
 
 	_mali_osk_free( allocation );
 
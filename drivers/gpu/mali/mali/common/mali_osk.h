@@ -200,6 +200,7 @@ typedef enum
 {
 	_MALI_OSK_LOCK_ORDER_LAST = 0,
 
+	_MALI_OSK_LOCK_ORDER_SESSION_STATS,
 	_MALI_OSK_LOCK_ORDER_SESSION_PENDING_JOBS,
 	_MALI_OSK_LOCK_ORDER_PM_EXECUTE,
 	_MALI_OSK_LOCK_ORDER_UTILIZATION,
@@ -1636,6 +1637,14 @@ u64 _mali_osk_time_get_ns( void );
  * @return the number of leading zeros.
  */
 u32 _mali_osk_clz( u32 val );
+
+/** @brief Divide a 64-bit value with a 32-bit divisor
+ *
+ * @param value dividend, replaced by the quotient
+ * @param divisor 32-bit divisor
+ * @return the remainder
+ */
+u32 _mali_osk_divmod64( u64 *value, u32 divisor );
 /** @} */ /* end group _mali_osk_math */
 
 /** @defgroup _mali_osk_wait_queue OSK Wait Queue functionality
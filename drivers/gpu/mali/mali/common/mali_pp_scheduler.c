@@ -659,6 +659,8 @@ void mali_pp_scheduler_job_done(struct mali_group *group, struct mali_pp_job *jo
 		/* Remove job from session list */
 		_mali_osk_list_del(&job->session_list);
 
+		mali_session_stats_job(session, MALI_TRUE, 0, MALI_TRUE);
+
 		MALI_DEBUG_PRINT(4, ("Mali PP scheduler: All parts completed for %s job %u (0x%08X)\n",
 		                     mali_pp_job_is_virtual(job) ? "virtual" : "physical",
 		                     mali_pp_job_get_id(job), job));
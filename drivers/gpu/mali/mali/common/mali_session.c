@@ -16,6 +16,9 @@ _MALI_OSK_LIST_HEAD(mali_sessions);
 
 _mali_osk_lock_t *mali_sessions_lock;
 
+/* Protects the stats of all sessions, taken innermost from job completion and memory commit */
+static _mali_osk_lock_t *mali_session_stats_lock = NULL;
+
 _mali_osk_errcode_t mali_session_initialize(void)
 {
 	_MALI_OSK_INIT_LIST_HEAD(&mali_sessions);
@@ -24,12 +27,23 @@ _mali_osk_errcode_t mali_session_initialize(void)
 
 	if (NULL == mali_sessions_lock) return _MALI_OSK_ERR_NOMEM;
 
+	mali_session_stats_lock = _mali_osk_lock_init(_MALI_OSK_LOCKFLAG_SPINLOCK_IRQ | _MALI_OSK_LOCKFLAG_NONINTERRUPTABLE | _MALI_OSK_LOCKFLAG_ORDERED, 0, _MALI_OSK_LOCK_ORDER_SESSION_STATS);
+	if (NULL == mali_session_stats_lock)
+	{
+		_mali_osk_lock_term(mali_sessions_lock);
+		mali_sessions_lock = NULL;
+		return _MALI_OSK_ERR_NOMEM;
+	}
+
 	return _MALI_OSK_ERR_OK;
 }
 
 void mali_session_terminate(void)
 {
+	_mali_osk_lock_term(mali_session_stats_lock);
+	mali_session_stats_lock = NULL;
 	_mali_osk_lock_term(mali_sessions_lock);
+	mali_sessions_lock = NULL;
 }
 
 void mali_session_add(struct mali_session_data *session)
@@ -45,3 +59,86 @@ void mali_session_remove(struct mali_session_data *session)
 	_mali_osk_list_delinit(&session->link);
 	mali_session_unlock();
 }
+
+void mali_session_stats_job(struct mali_session_data *session, mali_bool pp, u64 busy_ns, mali_bool completed)
+{
+	MALI_DEBUG_ASSERT_POINTER(session);
+
+	_mali_osk_lock_wait(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+	if (pp)
+	{
+		session->stats.pp_busy_ns += busy_ns;
+		if (completed) session->stats.pp_jobs++;
+	}
+	else
+	{
+		session->stats.gp_busy_ns += busy_ns;
+		if (completed) session->stats.gp_jobs++;
+	}
+	_mali_osk_lock_signal(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+void mali_session_stats_mmu_fault(struct mali_session_data *session)
+{
+	if (NULL == session) return;
+
+	_mali_osk_lock_wait(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+	session->stats.mmu_faults++;
+	_mali_osk_lock_signal(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+void mali_session_stats_memory(struct mali_session_data *session, mali_session_mem_type type, s32 bytes)
+{
+	/* memory not committed on behalf of a session, e.g. page tables */
+	if (NULL == session) return;
+
+	MALI_DEBUG_ASSERT(type < MALI_SESSION_MEM_TYPES);
+
+	_mali_osk_lock_wait(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+	session->stats.mem_committed[type] += bytes;
+	_mali_osk_lock_signal(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+u32 mali_session_stats_dump(char *buf, u32 size)
+{
+	struct mali_session_data *session, *tmp;
+	struct mali_session_stats stats;
+	u32 pid;
+	u32 n = 0;
+
+	if (NULL == mali_sessions_lock) return 0;
+
+	n += _mali_osk_snprintf(buf + n, size - n,
+	                        "%6s %8s %10s %8s %10s %6s %8s %8s %8s %8s\n",
+	                        "pid", "gp_jobs", "gp_busy_ms", "pp_jobs", "pp_busy_ms",
+	                        "faults", "os_kb", "ded_kb", "ump_kb", "ext_kb");
+
+	mali_session_lock();
+	MALI_SESSION_FOREACH(session, tmp, link)
+	{
+		if (n >= size) break;
+
+		_mali_osk_lock_wait(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+		stats = session->stats;
+		pid = session->pid;
+		_mali_osk_lock_signal(mali_session_stats_lock, _MALI_OSK_LOCKMODE_RW);
+
+		/* ns to ms */
+		_mali_osk_divmod64(&stats.gp_busy_ns, 1000000);
+		_mali_osk_divmod64(&stats.pp_busy_ns, 1000000);
+
+		n += _mali_osk_snprintf(buf + n, size - n,
+		                        "%6u %8u %10u %8u %10u %6u %8u %8u %8u %8u\n",
+		                        pid,
+		                        stats.gp_jobs, (u32)stats.gp_busy_ns,
+		                        stats.pp_jobs, (u32)stats.pp_busy_ns,
+		                        stats.mmu_faults,
+		                        stats.mem_committed[MALI_SESSION_MEM_OS] / 1024,
+		                        stats.mem_committed[MALI_SESSION_MEM_DEDICATED] / 1024,
+		                        stats.mem_committed[MALI_SESSION_MEM_UMP] / 1024,
+		                        stats.mem_committed[MALI_SESSION_MEM_EXTERNAL] / 1024);
+	}
+	mali_session_unlock();
+
+	return n < size ? n : size;
+}
@@ -16,6 +16,27 @@
 #include "mali_osk.h"
 #include "mali_osk_list.h"
 
+/** Kinds of memory committed to a session, see mali_session_stats_memory() */
+typedef enum
+{
+	MALI_SESSION_MEM_OS,        /**< Pages from the OS memory allocator */
+	MALI_SESSION_MEM_DEDICATED, /**< Blocks of dedicated Mali memory */
+	MALI_SESSION_MEM_UMP,       /**< Attached UMP memory */
+	MALI_SESSION_MEM_EXTERNAL,  /**< Mapped external memory and dma-bufs */
+	MALI_SESSION_MEM_TYPES
+} mali_session_mem_type;
+
+/** Per session statistics, protected by the session stats lock */
+struct mali_session_stats
+{
+	u32 gp_jobs;                                /**< GP jobs completed */
+	u32 pp_jobs;                                /**< PP jobs completed, all sub jobs done */
+	u64 gp_busy_ns;                             /**< Time the GP core ran jobs of this session */
+	u64 pp_busy_ns;                             /**< Time PP cores ran jobs of this session, summed over cores */
+	u32 mmu_faults;                             /**< MMU page faults and bus errors */
+	u32 mem_committed[MALI_SESSION_MEM_TYPES];  /**< Bytes currently committed per kind of memory */
+};
+
 struct mali_session_data
 {
 	_mali_osk_notification_queue_t * ioctl_queue;
@@ -34,6 +55,9 @@ struct mali_session_data
 	_MALI_OSK_LIST_HEAD(link); /**< Link for list of all sessions */
 
 	_MALI_OSK_LIST_HEAD(job_list); /**< List of all jobs on this session */
+
+	u32 pid; /**< Process which opened the session */
+	struct mali_session_stats stats; /**< Statistics for per process profiling */
 };
 
 _mali_osk_errcode_t mali_session_initialize(void);
@@ -56,6 +80,18 @@ MALI_STATIC_INLINE void mali_session_unlock(void)
 
 void mali_session_add(struct mali_session_data *session);
 void mali_session_remove(struct mali_session_data *session);
+
+/** @brief Account a finished job run, busy_ns is the time the core spent on it
+ *
+ * @param completed MALI_TRUE when the job is done, MALI_FALSE for a suspended GP
+ * job or a PP sub job which is not the last one
+ */
+void mali_session_stats_job(struct mali_session_data *session, mali_bool pp, u64 busy_ns, mali_bool completed);
+void mali_session_stats_mmu_fault(struct mali_session_data *session);
+/** @brief Account bytes committed (positive) or released (negative) to a session */
+void mali_session_stats_memory(struct mali_session_data *session, mali_session_mem_type type, s32 bytes);
+/** @brief Print the statistics of all sessions into buf, returns the number of characters written */
+u32 mali_session_stats_dump(char *buf, u32 size);
 #define MALI_SESSION_FOREACH(session, tmp, link) \
 	_MALI_OSK_LIST_FOREACHENTRY(session, tmp, &mali_sessions, struct mali_session_data, link)
 
@@ -38,6 +38,7 @@ struct mali_dma_buf_attachment {
 	spinlock_t map_lock;
 	mali_bool is_mapped;
 	wait_queue_head_t wait_queue;
+	u32 committed; /* bytes in the session stats, 0 until committed */
 };
 
 void mali_dma_buf_release(void *ctx, void *handle)
@@ -64,6 +65,8 @@ void mali_dma_buf_release(void *ctx, void *handle)
 	dma_buf_detach(mem->buf, mem->attachment);
 	dma_buf_put(mem->buf);
 
+	mali_session_stats_memory(mem->session, MALI_SESSION_MEM_EXTERNAL, -(s32)mem->committed);
+
 	_mali_osk_free(mem);
 }
 
@@ -289,6 +292,9 @@ static mali_physical_memory_allocation_result mali_dma_buf_commit(void* ctx, mal
 		alloc_info->next = NULL;
 		alloc_info->release = mali_dma_buf_release;
 
+		mem->committed = descriptor->size;
+		mali_session_stats_memory(session, MALI_SESSION_MEM_EXTERNAL, mem->committed);
+
 		return MALI_MEM_ALLOC_FINISHED;
 	}
 
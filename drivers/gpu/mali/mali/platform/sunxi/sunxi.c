@@ -19,12 +19,22 @@
 #ifdef CONFIG_PM_RUNTIME
 #include <linux/pm_runtime.h>
 #endif
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
 #include <asm/io.h>
 #include <linux/mali/mali_utgard.h>
 #include "mali_kernel_common.h"
+#include "mali_session.h"
 
 #include <linux/module.h>
 #include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/thermal.h>
+#include <linux/sunxi_thermal.h>
 #include <mach/irqs.h>
 #include <mach/clock.h>
 #include <plat/sys_config.h>
@@ -42,6 +52,222 @@ MODULE_PARM_DESC(mali_clk_div, "Clock divisor for mali");
 
 struct clk *h_ahb_mali, *h_mali_clk, *h_ve_pll;
 int mali_clk_flag=0;
+/* clocks off while runtime suspended, mali_clk_flag stays set */
+static int mali_clk_gated;
+
+/* the load comes from the utilization timer of the mali core */
+#if defined(CONFIG_PM_DEVFREQ) && defined(CONFIG_DEVFREQ_GOV_SIMPLE_ONDEMAND) && \
+	USING_GPU_UTILIZATION
+#define MALI_SUNXI_DVFS
+#endif
+
+#ifdef MALI_SUNXI_DVFS
+/*
+ * GPU DVFS: the ve pll is shared with the video engine, so only the
+ * mali divider moves. The divider from mali_clk_div gives the top
+ * rate, larger ones the lower steps. devfreq polls the utilization
+ * the mali core reports every MALI_DVFS_INTERVAL ms.
+ */
+static int mali_dvfs = 1;
+module_param(mali_dvfs, int, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(mali_dvfs, "Scale the mali clock with the GPU load");
+
+#define MALI_DVFS_INTERVAL	100
+#define MALI_DVFS_STEPS		4
+
+static unsigned long mali_dvfs_freq[MALI_DVFS_STEPS];	/* ascending */
+static int mali_dvfs_num;
+static struct devfreq *mali_devfreq;
+/* of 256, from the mali utilization timer */
+static unsigned int mali_dvfs_util;
+/* steps below the top one the thermal zone holds the clock at */
+static unsigned long mali_cool_state;
+
+static struct devfreq_simple_ondemand_data mali_dvfs_ondemand = {
+	.upthreshold = 80,
+	.downdifferential = 20,
+};
+
+static void mali_dvfs_utilization(unsigned int utilization)
+{
+	ACCESS_ONCE(mali_dvfs_util) = utilization;
+}
+
+static void mali_dvfs_table_init(unsigned long pll_rate)
+{
+	int div[MALI_DVFS_STEPS] = {
+		mali_clk_div * 4, mali_clk_div * 2, mali_clk_div + 1, mali_clk_div
+	};
+	int i, last = 0;
+
+	mali_dvfs_num = 0;
+	for (i = 0; i < MALI_DVFS_STEPS; i++) {
+		/* the divider is 4 bits */
+		if (div[i] > 16)
+			div[i] = 16;
+		if (div[i] == last)
+			continue;
+		last = div[i];
+		mali_dvfs_freq[mali_dvfs_num++] = pll_rate / div[i];
+	}
+}
+
+static int mali_dvfs_target(struct device *dev, unsigned long *freq, u32 flags)
+{
+	unsigned long rate;
+	int i;
+
+	/* the lowest step above freq, or the highest one below */
+	if (flags & DEVFREQ_FLAG_LEAST_UPPER_BOUND) {
+		for (i = 0; i < mali_dvfs_num - 1; i++)
+			if (mali_dvfs_freq[i] >= *freq)
+				break;
+	} else {
+		for (i = mali_dvfs_num - 1; i > 0; i--)
+			if (mali_dvfs_freq[i] <= *freq)
+				break;
+	}
+	if (i > mali_dvfs_num - 1 - (int)mali_cool_state)
+		i = mali_dvfs_num - 1 - (int)mali_cool_state;
+
+	rate = mali_dvfs_freq[i];
+	if (rate != clk_get_rate(h_mali_clk)) {
+		if (clk_set_rate(h_mali_clk, rate)) {
+			MALI_PRINT(("try to set mali clock %lu failed!\n", rate));
+			return -EIO;
+		}
+	}
+	*freq = clk_get_rate(h_mali_clk);
+
+	return 0;
+}
+
+static int mali_dvfs_get_dev_status(struct device *dev,
+				    struct devfreq_dev_status *stat)
+{
+	stat->current_frequency = clk_get_rate(h_mali_clk);
+	stat->total_time = 256;
+	stat->busy_time = ACCESS_ONCE(mali_dvfs_util);
+	if (stat->busy_time > stat->total_time)
+		stat->busy_time = stat->total_time;
+
+	return 0;
+}
+
+static struct devfreq_dev_profile mali_dvfs_profile = {
+	.polling_ms = MALI_DVFS_INTERVAL,
+	.target = mali_dvfs_target,
+	.get_dev_status = mali_dvfs_get_dev_status,
+};
+
+#ifdef CONFIG_THERMAL
+/*
+ * cooling device of the SoC thermal zone. The cap works in
+ * mali_dvfs_target, below whatever devfreq and its max_freq ask for.
+ */
+static struct thermal_cooling_device *mali_cool_dev;
+
+static int mali_cool_get_max_state(struct thermal_cooling_device *cdev,
+				   unsigned long *state)
+{
+	*state = mali_dvfs_num - 1;
+	return 0;
+}
+
+static int mali_cool_get_cur_state(struct thermal_cooling_device *cdev,
+				   unsigned long *state)
+{
+	*state = mali_cool_state;
+	return 0;
+}
+
+static int mali_cool_set_cur_state(struct thermal_cooling_device *cdev,
+				   unsigned long state)
+{
+	unsigned long freq;
+
+	if (state >= mali_dvfs_num)
+		return -EINVAL;
+
+	/* down to the cap right away, back up from the next poll */
+	mutex_lock(&mali_devfreq->lock);
+	mali_cool_state = state;
+	freq = clk_get_rate(h_mali_clk);
+	mali_dvfs_target(mali_devfreq->dev.parent, &freq, 0);
+	mutex_unlock(&mali_devfreq->lock);
+
+	return 0;
+}
+
+static const struct thermal_cooling_device_ops mali_cool_ops = {
+	.get_max_state = mali_cool_get_max_state,
+	.get_cur_state = mali_cool_get_cur_state,
+	.set_cur_state = mali_cool_set_cur_state,
+};
+
+static void mali_cool_init(void)
+{
+	mali_cool_dev = thermal_cooling_device_register(SUNXI_COOLING_GPU, NULL,
+							&mali_cool_ops);
+	if (IS_ERR(mali_cool_dev)) {
+		MALI_PRINT(("mali: no thermal cooling (%ld)\n",
+			    PTR_ERR(mali_cool_dev)));
+		mali_cool_dev = NULL;
+	}
+}
+
+static void mali_cool_exit(void)
+{
+	if (mali_cool_dev) {
+		thermal_cooling_device_unregister(mali_cool_dev);
+		mali_cool_dev = NULL;
+	}
+	mali_cool_state = 0;
+}
+#else
+static inline void mali_cool_init(void) { }
+static inline void mali_cool_exit(void) { }
+#endif
+
+static void mali_dvfs_init(struct device *dev)
+{
+	if (!mali_dvfs || !h_ve_pll || IS_ERR(h_ve_pll))
+		return;
+
+	mali_dvfs_table_init(clk_get_rate(h_ve_pll));
+	if (mali_dvfs_num < 2)
+		return;
+
+	mali_dvfs_profile.initial_freq = clk_get_rate(h_mali_clk);
+	mali_devfreq = devfreq_add_device(dev, &mali_dvfs_profile,
+					  &devfreq_simple_ondemand,
+					  &mali_dvfs_ondemand);
+	if (IS_ERR_OR_NULL(mali_devfreq)) {
+		MALI_PRINT(("mali: devfreq not available, clock stays fixed\n"));
+		mali_devfreq = NULL;
+		return;
+	}
+	mali_devfreq->min_freq = mali_dvfs_freq[0];
+	mali_devfreq->max_freq = mali_dvfs_freq[mali_dvfs_num - 1];
+
+	pr_info("mali: dvfs %lu - %lu Hz in %d steps\n", mali_dvfs_freq[0],
+		mali_dvfs_freq[mali_dvfs_num - 1], mali_dvfs_num);
+
+	mali_cool_init();
+}
+
+static void mali_dvfs_exit(void)
+{
+	mali_cool_exit();
+	if (mali_devfreq) {
+		devfreq_remove_device(mali_devfreq);
+		mali_devfreq = NULL;
+	}
+}
+#else
+static inline void mali_dvfs_init(struct device *dev) { }
+static inline void mali_dvfs_exit(void) { }
+#endif
 
 
 _mali_osk_errcode_t mali_platform_init(void)
@@ -126,13 +352,243 @@ _mali_osk_errcode_t mali_platform_deinit(void)
 	{
 		//MALI_PRINT(("disable mali clock\n"));
 		mali_clk_flag = 0;
-	       clk_disable(h_mali_clk);
-	       clk_disable(h_ahb_mali);
+		if (!mali_clk_gated)
+		{
+			clk_disable(h_mali_clk);
+			clk_disable(h_ahb_mali);
+		}
+		mali_clk_gated = 0;
 	}
 
     MALI_SUCCESS;
 }
 
+/*
+ * Clock gating while the GPU is runtime suspended. The mali core
+ * powers its groups down through the built-in PMU and takes a runtime
+ * reference for every job; once the autosuspend delay passes without
+ * one, the core and bus clocks go off too. A20 has no power switch for
+ * the GPU beyond that PMU. The pm_domain wraps the driver's own
+ * callbacks, so the clocks are on whenever the driver touches the
+ * registers.
+ */
+static DEFINE_SPINLOCK(mali_gate_lock);
+static ktime_t mali_gate_start;
+static u64 mali_gated_ns;		/* not counting a gate in progress */
+static unsigned long mali_gate_count;
+
+static void mali_clk_gate(void)
+{
+	unsigned long flags;
+
+	if (!mali_clk_flag || mali_clk_gated)
+		return;
+
+	clk_disable(h_mali_clk);
+	clk_disable(h_ahb_mali);
+
+	spin_lock_irqsave(&mali_gate_lock, flags);
+	mali_clk_gated = 1;
+	mali_gate_start = ktime_get();
+	mali_gate_count++;
+	spin_unlock_irqrestore(&mali_gate_lock, flags);
+}
+
+static void mali_clk_ungate(void)
+{
+	unsigned long flags;
+
+	if (!mali_clk_gated)
+		return;
+
+	if (clk_enable(h_ahb_mali))
+		MALI_PRINT(("try to enable mali ahb failed!\n"));
+	if (clk_enable(h_mali_clk))
+		MALI_PRINT(("try to enable mali clock failed!\n"));
+
+	spin_lock_irqsave(&mali_gate_lock, flags);
+	mali_clk_gated = 0;
+	mali_gated_ns += ktime_to_ns(ktime_sub(ktime_get(), mali_gate_start));
+	spin_unlock_irqrestore(&mali_gate_lock, flags);
+}
+
+#ifdef CONFIG_PM_RUNTIME
+static int mali_sunxi_runtime_suspend(struct device *dev)
+{
+	int ret;
+
+	ret = pm_generic_runtime_suspend(dev);
+	if (ret)
+		return ret;
+
+	mali_clk_gate();
+	return 0;
+}
+
+static int mali_sunxi_runtime_resume(struct device *dev)
+{
+	mali_clk_ungate();
+	return pm_generic_runtime_resume(dev);
+}
+
+/* system sleep finds the clocks on, as the driver expects */
+static int mali_sunxi_suspend(struct device *dev)
+{
+	int ret;
+
+	mali_clk_ungate();
+	ret = pm_generic_suspend(dev);
+	if (ret)
+		return ret;
+
+	mali_clk_gate();
+	return 0;
+}
+
+static int mali_sunxi_resume(struct device *dev)
+{
+	mali_clk_ungate();
+	return pm_generic_resume(dev);
+}
+
+static int mali_sunxi_freeze(struct device *dev)
+{
+	mali_clk_ungate();
+	return pm_generic_freeze(dev);
+}
+
+static int mali_sunxi_thaw(struct device *dev)
+{
+	mali_clk_ungate();
+	return pm_generic_thaw(dev);
+}
+
+static struct dev_pm_domain mali_sunxi_pm_domain = {
+	.ops = {
+		.runtime_suspend = mali_sunxi_runtime_suspend,
+		.runtime_resume = mali_sunxi_runtime_resume,
+		.runtime_idle = pm_generic_runtime_idle,
+		.suspend = mali_sunxi_suspend,
+		.resume = mali_sunxi_resume,
+		.freeze = mali_sunxi_freeze,
+		.thaw = mali_sunxi_thaw,
+		.poweroff = mali_sunxi_suspend,
+		.restore = mali_sunxi_resume,
+	},
+};
+#endif
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *mali_gate_debugfs;
+
+static int mali_gate_show(struct seq_file *m, void *unused)
+{
+	unsigned long flags, count;
+	u64 ns;
+	int gated;
+
+	spin_lock_irqsave(&mali_gate_lock, flags);
+	gated = mali_clk_gated;
+	count = mali_gate_count;
+	ns = mali_gated_ns;
+	if (gated)
+		ns += ktime_to_ns(ktime_sub(ktime_get(), mali_gate_start));
+	spin_unlock_irqrestore(&mali_gate_lock, flags);
+
+	seq_printf(m, "gated: %d\n", gated);
+	seq_printf(m, "gate_count: %lu\n", count);
+	seq_printf(m, "gated_ms: %llu\n", div_u64(ns, NSEC_PER_MSEC));
+	return 0;
+}
+
+static int mali_gate_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mali_gate_show, NULL);
+}
+
+static const struct file_operations mali_gate_fops = {
+	.open = mali_gate_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void mali_gate_debugfs_init(void)
+{
+	mali_gate_debugfs = debugfs_create_file("mali_sunxi_gate", S_IRUGO,
+						NULL, NULL, &mali_gate_fops);
+}
+
+static void mali_gate_debugfs_exit(void)
+{
+	debugfs_remove(mali_gate_debugfs);
+	mali_gate_debugfs = NULL;
+}
+#else
+static inline void mali_gate_debugfs_init(void) { }
+static inline void mali_gate_debugfs_exit(void) { }
+#endif
+
+/*
+ * Per process GPU statistics: GP/PP jobs and busy time, MMU faults and
+ * the memory committed by kind, one line per open session. The sysfs
+ * file holds what fits a page, debugfs has room for more sessions.
+ */
+static ssize_t mali_proc_stats_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	return mali_session_stats_dump(buf, PAGE_SIZE);
+}
+
+static DEVICE_ATTR(proc_stats, S_IRUGO, mali_proc_stats_show, NULL);
+
+#ifdef CONFIG_DEBUG_FS
+#define MALI_STATS_DEBUGFS_SIZE	(4 * PAGE_SIZE)
+
+static struct dentry *mali_stats_debugfs;
+
+static int mali_stats_show(struct seq_file *m, void *unused)
+{
+	char *buf;
+
+	buf = kmalloc(MALI_STATS_DEBUGFS_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	mali_session_stats_dump(buf, MALI_STATS_DEBUGFS_SIZE);
+	seq_puts(m, buf);
+	kfree(buf);
+	return 0;
+}
+
+static int mali_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mali_stats_show, NULL);
+}
+
+static const struct file_operations mali_stats_fops = {
+	.open = mali_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void mali_stats_debugfs_init(void)
+{
+	mali_stats_debugfs = debugfs_create_file("mali_sunxi_procs", S_IRUGO,
+						 NULL, NULL, &mali_stats_fops);
+}
+
+static void mali_stats_debugfs_exit(void)
+{
+	debugfs_remove(mali_stats_debugfs);
+	mali_stats_debugfs = NULL;
+}
+#else
+static inline void mali_stats_debugfs_init(void) { }
+static inline void mali_stats_debugfs_exit(void) { }
+#endif
+
 static void mali_platform_device_release(struct device *device);
 
 static struct resource mali_gpu_resources_m400_mp1[] =
@@ -157,11 +613,18 @@ static struct platform_device mali_gpu_device =
 	.name = MALI_GPU_NAME_UTGARD,
 	.id = 0,
 	.dev.release = mali_platform_device_release,
+#ifdef CONFIG_PM_RUNTIME
+	.dev.pm_domain = &mali_sunxi_pm_domain,
+#endif
 };
 
 static struct mali_gpu_device_data mali_gpu_data =
 {
 	.shared_mem_size = 256 * 1024 * 1024, /* 256MB */
+#ifdef MALI_SUNXI_DVFS
+	.utilization_interval = MALI_DVFS_INTERVAL,
+	.utilization_handler = mali_dvfs_utilization,
+#endif
 };
 
 int mali_platform_device_register(void)
@@ -207,6 +670,11 @@ int mali_platform_device_register(void)
 #endif
 				pm_runtime_enable(&(mali_gpu_device.dev));
 #endif
+				mali_dvfs_init(&mali_gpu_device.dev);
+				mali_gate_debugfs_init();
+				mali_stats_debugfs_init();
+				if (device_create_file(&mali_gpu_device.dev, &dev_attr_proc_stats))
+					MALI_PRINT_ERROR(("Failed to create proc_stats sysfs file\n"));
 
 				return 0;
 			}
@@ -222,6 +690,10 @@ void mali_platform_device_unregister(void)
 {
 	MALI_DEBUG_PRINT(4, ("mali_platform_device_unregister() called\n"));
 
+	device_remove_file(&mali_gpu_device.dev, &dev_attr_proc_stats);
+	mali_stats_debugfs_exit();
+	mali_gate_debugfs_exit();
+	mali_dvfs_exit();
 	platform_device_unregister(&mali_gpu_device);
 	mali_platform_deinit();
 }
@@ -50,6 +50,8 @@ typedef enum
 	_UMP_IOC_LOCK,
 	_UMP_IOC_UNLOCK,
 	_UMP_IOC_PHYS_ADDR_GET,
+	_UMP_IOC_DMABUF_EXPORT,
+	_UMP_IOC_DMABUF_IMPORT,
 }_ump_uk_functions;
 
 typedef enum
@@ -118,6 +120,19 @@ typedef struct _ump_uk_size_get_s
 	u32 size;                               /**< Returned size; output */
 } _ump_uk_size_get_s;
 
+/**
+ * DMABUF_EXPORT ([in] u32 secure_id, [in] flags, [out] fd, [out] size )
+ * DMABUF_IMPORT ([in] fd, [out] u32 secure_id, [out] size )
+ */
+typedef struct _ump_uk_dmabuf_s
+{
+	void *ctx;                              /**< [in,out] user-kernel context (trashed on output) */
+	u32 secure_id;                          /**< Input to DD on export, returned on import */
+	s32 fd;                                 /**< Returned on export, input to DD on import */
+	u32 flags;                              /**< O_CLOEXEC for the exported fd; input */
+	u32 size;                               /**< Returned size; output */
+} _ump_uk_dmabuf_s;
+
 /**
  * PHYS_ADDR_GET ([in] u32 secure_id, [out]phys_addr )
  */
@@ -48,6 +48,9 @@ extern "C"
 
 #define UMP_IOC_PHYS_ADDR_GET _IOWR(UMP_IOCTL_NR,  _UMP_IOC_PHYS_ADDR_GET, _ump_uk_phys_addr_get_s)
 
+#define UMP_IOC_DMABUF_EXPORT _IOWR(UMP_IOCTL_NR,  _UMP_IOC_DMABUF_EXPORT, _ump_uk_dmabuf_s)
+#define UMP_IOC_DMABUF_IMPORT _IOWR(UMP_IOCTL_NR,  _UMP_IOC_DMABUF_IMPORT, _ump_uk_dmabuf_s)
+
 #ifdef __cplusplus
 }
 #endif
@@ -372,6 +372,16 @@ static int ump_file_ioctl(struct inode *inode, struct file *filp, unsigned int c
 			err = ump_phys_addr_get_wrapper((u32 __user *)argument, session_data);
 			break;
 
+#ifdef CONFIG_DMA_SHARED_BUFFER
+		case UMP_IOC_DMABUF_EXPORT:
+			err = ump_dmabuf_export_wrapper((u32 __user *)argument, session_data);
+			break;
+
+		case UMP_IOC_DMABUF_IMPORT:
+			err = ump_dmabuf_import_wrapper((u32 __user *)argument, session_data);
+			break;
+#endif
+
 		default:
 			DBG_MSG(1, ("No handler for IOCTL. cmd: 0x%08x, arg: 0x%08lx\n", cmd, arg));
 			err = -EFAULT;
@@ -11,8 +11,13 @@
 #ifndef __UMP_KERNEL_LINUX_H__
 #define __UMP_KERNEL_LINUX_H__
 
+#include "ump_kernel_types.h"
+
 int ump_kernel_device_initialize(void);
 void ump_kernel_device_terminate(void);
 
+/* the device dma-bufs are imported through */
+extern struct ump_device ump_device;
+
 
 #endif /* __UMP_KERNEL_H__ */
@@ -21,6 +21,16 @@
 #include "ump_ukk.h"
 #include "ump_kernel_common.h"
 
+#ifdef CONFIG_DMA_SHARED_BUFFER
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include "ump_kernel_linux.h"
+#endif
+
 /*
  * IOCTL operation; Allocate UMP memory
  */
@@ -74,3 +84,408 @@ int ump_allocate_wrapper(u32 __user * argument, struct ump_session_data  * sessi
 
 	return 0; /* success */
 }
+
+#ifdef CONFIG_DMA_SHARED_BUFFER
+/*
+ * dma-buf export and import, so that UMP memory reaches disp, cedar and
+ * g2d and their buffers reach Mali without a copy.
+ *
+ * An exported dma-buf holds a reference on the UMP memory until its
+ * last fd and importer are gone. An imported dma-buf stays attached
+ * and mapped to the UMP device for as long as the new secure ID lives,
+ * which, like an allocation, is until RELEASE or the session is closed.
+ */
+
+/* the page at byte offset of the memory, NULL past the end */
+static struct page *ump_dmabuf_page(ump_dd_mem *mem, unsigned long offset)
+{
+	unsigned long i, pfn;
+
+	for (i = 0; i < mem->nr_blocks; i++)
+	{
+		if (offset < mem->block_array[i].size)
+		{
+			pfn = (mem->block_array[i].addr + offset) >> PAGE_SHIFT;
+			return pfn_valid(pfn) ? pfn_to_page(pfn) : NULL;
+		}
+		offset -= mem->block_array[i].size;
+	}
+
+	return NULL;
+}
+
+static struct sg_table *ump_dmabuf_map(struct dma_buf_attachment *attach,
+                                       enum dma_data_direction dir)
+{
+	ump_dd_mem *mem = attach->dmabuf->priv;
+	struct scatterlist *sg;
+	struct sg_table *sgt;
+	unsigned long i, pfn;
+
+	sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (NULL == sgt)
+	{
+		return ERR_PTR(-ENOMEM);
+	}
+
+	if (0 != sg_alloc_table(sgt, mem->nr_blocks, GFP_KERNEL))
+	{
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+	{
+		pfn = mem->block_array[i].addr >> PAGE_SHIFT;
+		/* memory outside of the kernel's map can't go in a scatterlist */
+		if (!pfn_valid(pfn))
+		{
+			sg_free_table(sgt);
+			kfree(sgt);
+			return ERR_PTR(-EINVAL);
+		}
+		sg_set_page(sg, pfn_to_page(pfn), mem->block_array[i].size, 0);
+	}
+
+	if (0 == dma_map_sg(attach->dev, sgt->sgl, sgt->nents, dir))
+	{
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void ump_dmabuf_unmap(struct dma_buf_attachment *attach,
+                             struct sg_table *sgt, enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void ump_dmabuf_release(struct dma_buf *buf)
+{
+	ump_dd_reference_release((ump_dd_handle)buf->priv);
+}
+
+static void *ump_dmabuf_kmap(struct dma_buf *buf, unsigned long pgnum)
+{
+	struct page *page = ump_dmabuf_page(buf->priv, pgnum << PAGE_SHIFT);
+
+	return page ? kmap(page) : NULL;
+}
+
+static void ump_dmabuf_kunmap(struct dma_buf *buf, unsigned long pgnum, void *vaddr)
+{
+	struct page *page = ump_dmabuf_page(buf->priv, pgnum << PAGE_SHIFT);
+
+	if (page)
+	{
+		kunmap(page);
+	}
+}
+
+static void *ump_dmabuf_kmap_atomic(struct dma_buf *buf, unsigned long pgnum)
+{
+	struct page *page = ump_dmabuf_page(buf->priv, pgnum << PAGE_SHIFT);
+
+	return page ? kmap_atomic(page) : NULL;
+}
+
+static void ump_dmabuf_kunmap_atomic(struct dma_buf *buf, unsigned long pgnum, void *vaddr)
+{
+	kunmap_atomic(vaddr);
+}
+
+static int ump_dmabuf_mmap(struct dma_buf *buf, struct vm_area_struct *vma)
+{
+	ump_dd_mem *mem = buf->priv;
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long addr = vma->vm_start;
+	unsigned long i, size;
+
+	if (offset + (vma->vm_end - vma->vm_start) > mem->size_bytes)
+	{
+		return -EINVAL;
+	}
+
+	/* the same caching as the UMP mapping of the memory */
+	if (0 == mem->is_cached)
+	{
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	}
+
+	for (i = 0; i < mem->nr_blocks && addr < vma->vm_end; i++)
+	{
+		if (offset >= mem->block_array[i].size)
+		{
+			offset -= mem->block_array[i].size;
+			continue;
+		}
+
+		size = min(mem->block_array[i].size - offset, vma->vm_end - addr);
+		if (remap_pfn_range(vma, addr, (mem->block_array[i].addr + offset) >> PAGE_SHIFT,
+		                    size, vma->vm_page_prot))
+		{
+			return -EAGAIN;
+		}
+		addr += size;
+		offset = 0;
+	}
+
+	return 0;
+}
+
+static const struct dma_buf_ops ump_dmabuf_ops =
+{
+	.map_dma_buf = ump_dmabuf_map,
+	.unmap_dma_buf = ump_dmabuf_unmap,
+	.release = ump_dmabuf_release,
+	.kmap_atomic = ump_dmabuf_kmap_atomic,
+	.kunmap_atomic = ump_dmabuf_kunmap_atomic,
+	.kmap = ump_dmabuf_kmap,
+	.kunmap = ump_dmabuf_kunmap,
+	.mmap = ump_dmabuf_mmap,
+};
+
+/*
+ * IOCTL operation; Export UMP memory as a dma-buf
+ */
+int ump_dmabuf_export_wrapper(u32 __user * argument, struct ump_session_data  * session_data)
+{
+	_ump_uk_dmabuf_s user_interaction;
+	ump_dd_handle handle;
+	ump_dd_mem *mem;
+	struct dma_buf *buf;
+	int fd;
+
+	if (NULL == argument || NULL == session_data)
+	{
+		MSG_ERR(("NULL parameter in ump_ioctl_dmabuf_export()\n"));
+		return -ENOTTY;
+	}
+
+	if (0 != copy_from_user(&user_interaction, argument, sizeof(user_interaction)))
+	{
+		MSG_ERR(("copy_from_user() in ump_ioctl_dmabuf_export()\n"));
+		return -EFAULT;
+	}
+
+	/* the reference taken here belongs to the dma-buf */
+	handle = ump_dd_handle_create_from_secure_id(user_interaction.secure_id);
+	if (UMP_DD_HANDLE_INVALID == handle)
+	{
+		DBG_MSG(1, ("Invalid secure ID %u in ump_ioctl_dmabuf_export()\n", user_interaction.secure_id));
+		return -ENOENT;
+	}
+	mem = (ump_dd_mem *)handle;
+
+	buf = dma_buf_export(mem, &ump_dmabuf_ops, mem->size_bytes, O_RDWR);
+	if (IS_ERR(buf))
+	{
+		ump_dd_reference_release(handle);
+		return PTR_ERR(buf);
+	}
+
+	fd = dma_buf_fd(buf, user_interaction.flags & O_CLOEXEC);
+	if (fd < 0)
+	{
+		/* the release drops the reference */
+		dma_buf_put(buf);
+		return fd;
+	}
+
+	user_interaction.ctx = NULL;
+	user_interaction.fd = fd;
+	user_interaction.size = mem->size_bytes;
+	if (0 != copy_to_user(argument, &user_interaction, sizeof(user_interaction)))
+	{
+		/* the fd is out already, it is the caller's to close */
+		MSG_ERR(("copy_to_user() failed in ump_ioctl_dmabuf_export()\n"));
+		return -EFAULT;
+	}
+
+	DBG_MSG(3, ("UMP memory ID %u exported as dma-buf fd %d\n", mem->secure_id, fd));
+	return 0;
+}
+
+typedef struct ump_dmabuf_import
+{
+	struct dma_buf *buf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+} ump_dmabuf_import;
+
+static void ump_dmabuf_import_release(void * ctx, struct ump_dd_mem * descriptor)
+{
+	ump_dmabuf_import *import = ctx;
+
+	dma_buf_unmap_attachment(import->attach, import->sgt, DMA_BIDIRECTIONAL);
+	dma_buf_detach(import->buf, import->attach);
+	dma_buf_put(import->buf);
+	kfree(import);
+
+	_mali_osk_free(descriptor->block_array);
+	descriptor->block_array = NULL;
+}
+
+/* physically contiguous runs of the mapped buffer, NULL on unaligned ones */
+static ump_dd_physical_block *ump_dmabuf_blocks(struct sg_table *sgt, unsigned long *num)
+{
+	ump_dd_physical_block *blocks;
+	struct scatterlist *sg;
+	unsigned long n = 0;
+	dma_addr_t addr;
+	unsigned int len;
+	int i;
+
+	blocks = kcalloc(sgt->nents, sizeof(ump_dd_physical_block), GFP_KERNEL);
+	if (NULL == blocks)
+	{
+		return NULL;
+	}
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+	{
+		addr = sg_dma_address(sg);
+		len = sg_dma_len(sg);
+		if ((addr & ~PAGE_MASK) || (len & ~PAGE_MASK))
+		{
+			kfree(blocks);
+			return NULL;
+		}
+
+		if (n > 0 && blocks[n - 1].addr + blocks[n - 1].size == addr)
+		{
+			blocks[n - 1].size += len;
+			continue;
+		}
+		blocks[n].addr = addr;
+		blocks[n].size = len;
+		n++;
+	}
+
+	*num = n;
+	return blocks;
+}
+
+/*
+ * IOCTL operation; Import a dma-buf as UMP memory
+ */
+int ump_dmabuf_import_wrapper(u32 __user * argument, struct ump_session_data  * session_data)
+{
+	_ump_uk_dmabuf_s user_interaction;
+	ump_session_memory_list_element *session_memory_element;
+	ump_dmabuf_import *import;
+	ump_dd_physical_block *blocks;
+	unsigned long num_blocks = 0;
+	ump_dd_handle handle;
+	ump_dd_mem *mem;
+	int err;
+
+	if (NULL == argument || NULL == session_data)
+	{
+		MSG_ERR(("NULL parameter in ump_ioctl_dmabuf_import()\n"));
+		return -ENOTTY;
+	}
+
+	if (0 != copy_from_user(&user_interaction, argument, sizeof(user_interaction)))
+	{
+		MSG_ERR(("copy_from_user() in ump_ioctl_dmabuf_import()\n"));
+		return -EFAULT;
+	}
+
+	session_memory_element = _mali_osk_calloc(1, sizeof(ump_session_memory_list_element));
+	import = kzalloc(sizeof(ump_dmabuf_import), GFP_KERNEL);
+	if (NULL == session_memory_element || NULL == import)
+	{
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	import->buf = dma_buf_get(user_interaction.fd);
+	if (IS_ERR(import->buf))
+	{
+		err = PTR_ERR(import->buf);
+		goto err_free;
+	}
+
+	import->attach = dma_buf_attach(import->buf, ump_device.mdev);
+	if (IS_ERR(import->attach))
+	{
+		err = PTR_ERR(import->attach);
+		goto err_put;
+	}
+
+	import->sgt = dma_buf_map_attachment(import->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR_OR_NULL(import->sgt))
+	{
+		err = import->sgt ? PTR_ERR(import->sgt) : -ENOMEM;
+		goto err_detach;
+	}
+
+	blocks = ump_dmabuf_blocks(import->sgt, &num_blocks);
+	if (NULL == blocks)
+	{
+		DBG_MSG(1, ("dma-buf fd %d is not page aligned, not imported\n", user_interaction.fd));
+		err = -EINVAL;
+		goto err_unmap;
+	}
+
+	handle = ump_dd_handle_create_from_phys_blocks(blocks, num_blocks);
+	kfree(blocks);
+	if (UMP_DD_HANDLE_INVALID == handle)
+	{
+		err = -ENOMEM;
+		goto err_unmap;
+	}
+
+	/* the attachment goes with the last reference of the memory */
+	mem = (ump_dd_mem *)handle;
+	mem->ctx = import;
+	mem->release_func = ump_dmabuf_import_release;
+
+	session_memory_element->mem = mem;
+	_mali_osk_lock_wait(session_data->lock, _MALI_OSK_LOCKMODE_RW);
+	_mali_osk_list_add(&(session_memory_element->list), &(session_data->list_head_session_memory_list));
+	_mali_osk_lock_signal(session_data->lock, _MALI_OSK_LOCKMODE_RW);
+
+	user_interaction.ctx = NULL;
+	user_interaction.secure_id = mem->secure_id;
+	user_interaction.size = mem->size_bytes;
+	if (0 != copy_to_user(argument, &user_interaction, sizeof(user_interaction)))
+	{
+		_ump_uk_release_s release_args;
+
+		MSG_ERR(("copy_to_user() failed in ump_ioctl_dmabuf_import()\n"));
+
+		release_args.ctx = (void *) session_data;
+		release_args.secure_id = mem->secure_id;
+		if (_MALI_OSK_ERR_OK != _ump_ukk_release(&release_args))
+		{
+			MSG_ERR(("_ump_ukk_release() also failed when trying to release imported memory in ump_ioctl_dmabuf_import()\n"));
+		}
+
+		return -EFAULT;
+	}
+
+	DBG_MSG(3, ("dma-buf fd %d imported as UMP memory ID %u\n", user_interaction.fd, mem->secure_id));
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(import->attach, import->sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(import->buf, import->attach);
+err_put:
+	dma_buf_put(import->buf);
+err_free:
+	kfree(import);
+	if (NULL != session_memory_element)
+	{
+		_mali_osk_free(session_memory_element);
+	}
+	return err;
+}
+#endif /* CONFIG_DMA_SHARED_BUFFER */
@@ -26,6 +26,10 @@ extern "C"
 
 
 int ump_allocate_wrapper(u32 __user * argument, struct ump_session_data  * session_data);
+#ifdef CONFIG_DMA_SHARED_BUFFER
+int ump_dmabuf_export_wrapper(u32 __user * argument, struct ump_session_data  * session_data);
+int ump_dmabuf_import_wrapper(u32 __user * argument, struct ump_session_data  * session_data);
+#endif
 
 
 #ifdef __cplusplus
@@ -15,6 +15,8 @@
 #include <linux/slab.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
 #include <asm/uaccess.h>
 #include "umplock_ioctl.h"
 #include <linux/sched.h>
@@ -28,19 +30,41 @@ typedef struct lock_cmd_priv
 	u32 pid;			  /*process id*/
 }_lock_cmd_priv;
 
+/* how a reference holds the item lock */
+#define UMPLOCK_HELD_NONE   0
+#define UMPLOCK_HELD_SHARED 1
+#define UMPLOCK_HELD_EXCL   2
+
+/* item lock state: number of shared holders, or taken exclusively */
+#define UMPLOCK_STATE_EXCL  (-1)
+
 typedef struct lock_ref
 {
 	int ref_count;
 	u32 pid;
+	int held;
 }_lock_ref;
 
+/*
+ * The item lock is shared for texture and cpu read usage, so several
+ * consumers of a buffer don't serialise, and exclusive for renderable
+ * and cpu write usage. Waiting writers keep new readers out.
+ *
+ * references[] is protected by ref_lock, not by the global
+ * item_list_lock, and items are looked up without the latter: the
+ * array is static and the secure id is checked again under ref_lock.
+ * The global lock is only taken to add and remove items and clients.
+ */
 typedef struct umplock_item
 {
 	u32 secure_id;
 	/*u32 references;*/
 	_lock_access_usage usage;
 	_lock_ref references[MAX_PIDS]; 
-	struct semaphore item_lock;
+	spinlock_t ref_lock;
+	atomic_t state;
+	atomic_t writers_waiting;
+	wait_queue_head_t wait;
 } umplock_item;
 
 typedef struct umplock_device_private
@@ -80,7 +104,14 @@ static umplock_device_private device;
 
 void umplock_init_locklist( void )
 {
+	int i;
+
 	memset(&device.items, 0, sizeof(umplock_item)*MAX_ITEMS);
+	for ( i=0; i<MAX_ITEMS; i++ )
+	{
+		spin_lock_init(&device.items[i].ref_lock);
+		init_waitqueue_head(&device.items[i].wait);
+	}
 	atomic_set(&device.sessions, 0);
 }
 
@@ -173,7 +204,7 @@ int umplock_find_item( u32 secure_id )
 	int i;
 	for ( i=0; i<MAX_ITEMS; i++ )
 	{
-		if ( device.items[i].secure_id == secure_id ) return i;
+		if ( ACCESS_ONCE(device.items[i].secure_id) == secure_id ) return i;
 	}
 	
 	return -1;
@@ -190,47 +221,127 @@ int umplock_find_slot( void )
 	return -1;
 }
 
-static int umplock_find_item_by_pid( _lock_cmd_priv *lock_cmd, int *item_slot, int *ref_slot)
+static int umplock_find_client_valid(u32 pid)
 {
-	_lock_item_s *lock_item;
-	int i,j;
-	
-	lock_item = (_lock_item_s *)&lock_cmd->msg;
-
-	i = umplock_find_item(lock_item->secure_id);
+	int i;
 
-	if ( i < 0)
+	if(pid == 0)
 		return -1;
 	
-	for(j=0; j<MAX_PIDS; j++)
+	for(i=0; i<MAX_PIDS; i++)
 	{
-		if(device.items[i].references[j].pid == lock_cmd->pid)
-		{
-			*item_slot = i;
-			*ref_slot = j;
-			return 0;
-		}
+		if(ACCESS_ONCE(device.pids[i]) == pid) return i;
 	}
-	return -1 ;
+
+	return -1;
 }
 
-static int umplock_find_client_valid(u32 pid)
+/* reference slot of pid on the item, called with the item's ref_lock */
+static int umplock_find_ref( umplock_item *item, u32 pid )
 {
-	int i;
+	int j;
 
-	if(pid == 0)
-		return -1;
-	
-	for(i=0; i<MAX_PIDS; i++)
+	for ( j=0; j<MAX_PIDS; j++ )
 	{
-		if(device.pids[i] == pid) return i;
+		if ( item->references[j].pid == pid ) return j;
 	}
 
 	return -1;
 }
+
+/*
+ * Item of the secure id with the ref_lock taken and the reference slot
+ * of pid in *ref_slot, NULL if there is none.
+ */
+static umplock_item *umplock_get_ref( u32 secure_id, u32 pid, int *ref_slot )
+{
+	umplock_item *item;
+	int i;
+
+	if ( secure_id == 0 ) return NULL;
+
+	i = umplock_find_item( secure_id );
+	if ( i < 0 ) return NULL;
+
+	item = &device.items[i];
+	spin_lock(&item->ref_lock);
+	/* the item may have been zapped meanwhile */
+	if ( item->secure_id == secure_id )
+	{
+		*ref_slot = umplock_find_ref( item, pid );
+		if ( *ref_slot >= 0 ) return item;
+	}
+	spin_unlock(&item->ref_lock);
+
+	return NULL;
+}
+
+static int umplock_usage_shared( _lock_access_usage usage )
+{
+	return usage == _LOCK_ACCESS_TEXTURE || usage == _LOCK_ACCESS_CPU_READ;
+}
+
+static int umplock_trylock( umplock_item *item, int held )
+{
+	int state;
+
+	if ( held == UMPLOCK_HELD_EXCL )
+	{
+		return atomic_cmpxchg(&item->state, 0, UMPLOCK_STATE_EXCL) == 0;
+	}
+
+	do
+	{
+		state = atomic_read(&item->state);
+		if ( state < 0 || atomic_read(&item->writers_waiting) ) return 0;
+	} while ( atomic_cmpxchg(&item->state, state, state + 1) != state );
+
+	return 1;
+}
+
+static int umplock_lock( umplock_item *item, int held )
+{
+	int ret;
+
+	/* uncontended, no sleeping and no global lock */
+	if ( umplock_trylock(item, held) ) return 0;
+
+	if ( held == UMPLOCK_HELD_SHARED )
+	{
+		return wait_event_interruptible(item->wait, umplock_trylock(item, held));
+	}
+
+	atomic_inc(&item->writers_waiting);
+	/* the exclusive trylock doesn't look at writers_waiting */
+	ret = wait_event_interruptible(item->wait, umplock_trylock(item, held));
+	atomic_dec(&item->writers_waiting);
+	if ( ret )
+	{
+		/* readers held back for this writer may go now */
+		wake_up_all(&item->wait);
+	}
+
+	return ret;
+}
+
+static void umplock_unlock( umplock_item *item, int held )
+{
+	if ( held == UMPLOCK_HELD_EXCL )
+	{
+		atomic_set(&item->state, 0);
+	}
+	else if ( atomic_dec_return(&item->state) != 0 )
+	{
+		return;
+	}
+
+	smp_mb();
+	if ( waitqueue_active(&item->wait) ) wake_up_all(&item->wait);
+}
 /** IOCTLs **/
 static int do_umplock_create( _lock_cmd_priv *lock_cmd)
 {
+	umplock_item *item;
 	int i_index,ref_index;
 	int ret;
 	_lock_item_s *lock_item = (_lock_item_s *)&lock_cmd->msg;
@@ -243,38 +354,44 @@ static int do_umplock_create( _lock_cmd_priv *lock_cmd)
 	else printk( KERN_DEBUG "UMPLOCK: C 0x%x CPU\n", lock_item->secure_id );
 	#endif
 
-	mutex_lock(&device.item_list_lock);
 	ret = umplock_find_client_valid( lock_cmd->pid );	
-	mutex_unlock(&device.item_list_lock);
 	if( ret < 0 )
 	{
 		/*lock request from an invalid client pid, do nothing*/
 		return 0;
 	}
 
-	mutex_lock(&device.item_list_lock);
-
-	ret = umplock_find_item_by_pid( lock_cmd, &i_index, &ref_index );
-	if ( ret >= 0 )
+	item = umplock_get_ref( lock_item->secure_id, lock_cmd->pid, &ref_index );
+	if ( item )
 	{
-		if (device.items[i_index].references[ref_index].ref_count == 0)
-			device.items[i_index].references[ref_index].ref_count = 1;
+		if (item->references[ref_index].ref_count == 0)
+			item->references[ref_index].ref_count = 1;
+		spin_unlock(&item->ref_lock);
+		return 0;
 	}
-	else if ( (i_index = umplock_find_item( lock_item->secure_id)) >= 0 )
+
+	mutex_lock(&device.item_list_lock);
+
+	if ( (i_index = umplock_find_item( lock_item->secure_id)) >= 0 )
 	{
-		for ( ref_index = 0; ref_index < MAX_PIDS; ref_index++)
+		item = &device.items[i_index];
+		spin_lock(&item->ref_lock);
+		ref_index = umplock_find_ref( item, lock_cmd->pid );
+		if ( ref_index < 0 )
 		{
-			if (device.items[i_index].references[ref_index].pid == 0) break;
+			ref_index = umplock_find_ref( item, 0 );
 		}
-		if ( ref_index < MAX_PIDS )
+		if ( ref_index >= 0 )
 		{
-			device.items[i_index].references[ref_index].pid = lock_cmd->pid;
-			device.items[i_index].references[ref_index].ref_count = 1;
+			item->references[ref_index].pid = lock_cmd->pid;
+			if (item->references[ref_index].ref_count == 0)
+				item->references[ref_index].ref_count = 1;
 		}
 		else
 		{
 			printk( KERN_ERR "UMPLOCK: whoops, item ran out of available reference slot\n" );
 		}
+		spin_unlock(&item->ref_lock);
 	}
 	else
 	{
@@ -282,11 +399,15 @@ static int do_umplock_create( _lock_cmd_priv *lock_cmd)
 
 		if ( i_index >= 0 )
 		{
-			device.items[i_index].secure_id = lock_item->secure_id;
-			device.items[i_index].usage = lock_item->usage;
-			device.items[i_index].references[0].pid = lock_cmd->pid;
-			device.items[i_index].references[0].ref_count = 1;
-			sema_init(&device.items[i_index].item_lock, 1);
+			item = &device.items[i_index];
+			spin_lock(&item->ref_lock);
+			item->usage = lock_item->usage;
+			item->references[0].pid = lock_cmd->pid;
+			item->references[0].ref_count = 1;
+			item->references[0].held = UMPLOCK_HELD_NONE;
+			/* visible to the lookups without the global lock from here */
+			item->secure_id = lock_item->secure_id;
+			spin_unlock(&item->ref_lock);
 		}
 		else
 		{
@@ -300,92 +421,105 @@ static int do_umplock_create( _lock_cmd_priv *lock_cmd)
 
 static int do_umplock_process( _lock_cmd_priv *lock_cmd )
 {
-	int ret, i_index, ref_index, ref_count;
+	umplock_item *item;
+	int ret, ref_index, held;
 	_lock_item_s *lock_item = (_lock_item_s *)&lock_cmd->msg;
 
-	mutex_lock(&device.item_list_lock);
 	ret = umplock_find_client_valid( lock_cmd->pid );	
-	mutex_unlock(&device.item_list_lock);
 	if( ret < 0 )
 	{
 		/*lock request from an invalid client pid, do nothing*/
 		return 0;
 	}
 	
-	mutex_lock(&device.item_list_lock);
-	ret = umplock_find_item_by_pid( lock_cmd, &i_index, &ref_index );
-	ref_count = device.items[i_index].references[ref_index].ref_count;
-	mutex_unlock(&device.item_list_lock);
-	if ( ret >= 0 )
+	item = umplock_get_ref( lock_item->secure_id, lock_cmd->pid, &ref_index );
+	if ( item == NULL )
 	{
-		if (ref_count == 1)
-		{
-			if ( down_interruptible(&device.items[i_index].item_lock) )
-			{
-				return -ERESTARTSYS;
-			}
-		}
+		return 0;
+	}
+
+	/* nested, the lock is already held by this client */
+	if ( item->references[ref_index].ref_count != 1 )
+	{
+		item->references[ref_index].ref_count++;
+		spin_unlock(&item->ref_lock);
+		return 0;
+	}
+	spin_unlock(&item->ref_lock);
 
-		mutex_lock(&device.item_list_lock);
-		device.items[i_index].references[ref_index].ref_count++;
-		mutex_unlock(&device.item_list_lock);
+	held = umplock_usage_shared(lock_item->usage) ? UMPLOCK_HELD_SHARED : UMPLOCK_HELD_EXCL;
+	if ( umplock_lock(item, held) )
+	{
+		return -ERESTARTSYS;
+	}
 
-		#if 0
-		if ( lock_item->usage == 1 ) printk( KERN_DEBUG "UMPLOCK:  P 0x%x GPU SURFACE\n", lock_item->secure_id );
-		else if ( lock_item->usage == 2 ) printk( KERN_DEBUG "UMPLOCK:  P 0x%x GPU TEXTURE\n", lock_item->secure_id );
-		else printk( KERN_DEBUG "UMPLOCK:  P 0x%x CPU\n", lock_item->secure_id );
-		#endif
+	spin_lock(&item->ref_lock);
+	if ( item->secure_id == lock_item->secure_id && item->references[ref_index].pid == lock_cmd->pid )
+	{
+		item->references[ref_index].held = held;
+		item->references[ref_index].ref_count++;
+		held = UMPLOCK_HELD_NONE;
 	}
+	spin_unlock(&item->ref_lock);
+
+	/* zapped while waiting */
+	if ( held != UMPLOCK_HELD_NONE )
+	{
+		umplock_unlock(item, held);
+	}
+
+	#if 0
+	if ( lock_item->usage == 1 ) printk( KERN_DEBUG "UMPLOCK:  P 0x%x GPU SURFACE\n", lock_item->secure_id );
+	else if ( lock_item->usage == 2 ) printk( KERN_DEBUG "UMPLOCK:  P 0x%x GPU TEXTURE\n", lock_item->secure_id );
+	else printk( KERN_DEBUG "UMPLOCK:  P 0x%x CPU\n", lock_item->secure_id );
+	#endif
 
 	return 0;
 }
 
 static int do_umplock_release( _lock_cmd_priv *lock_cmd )
 {
-	int i_index,ref_index, ref_count;
+	umplock_item *item;
+	int ref_index, held;
 	int ret;
 	_lock_item_s *lock_item = (_lock_item_s *)&lock_cmd->msg;
 
-	mutex_lock(&device.item_list_lock);
 	ret = umplock_find_client_valid( lock_cmd->pid );	
-	mutex_unlock(&device.item_list_lock);
 	if( ret < 0 )
 	{
 		/*lock request from an invalid client pid, do nothing*/
 		return 0;
 	}
 	
-	i_index = ref_index = -1;
-
-	mutex_lock(&device.item_list_lock);
-	ret = umplock_find_item_by_pid( lock_cmd, &i_index, &ref_index );
-	mutex_unlock(&device.item_list_lock);
+	item = umplock_get_ref( lock_item->secure_id, lock_cmd->pid, &ref_index );
+	if ( item == NULL )
+	{
+		return 0;
+	}
 
-	if ( ret >= 0 )
+	held = UMPLOCK_HELD_NONE;
+	if ( item->references[ref_index].ref_count > 0 )
+	{
+		item->references[ref_index].ref_count--;
+	}
+	if ( item->references[ref_index].ref_count == 1 )
 	{
-		mutex_lock(&device.item_list_lock);
-		device.items[i_index].references[ref_index].ref_count--;
-		ref_count = device.items[i_index].references[ref_index].ref_count;
-		mutex_unlock(&device.item_list_lock);
+		held = item->references[ref_index].held;
+		item->references[ref_index].held = UMPLOCK_HELD_NONE;
+		item->references[ref_index].ref_count = 0;
+		item->references[ref_index].pid = 0;
+	}
+	spin_unlock(&item->ref_lock);
 
-		#if 0
-		if ( lock_item->usage == 1 ) printk( KERN_DEBUG "UMPLOCK:   R 0x%x GPU SURFACE\n", lock_item->secure_id );
-		else if ( lock_item->usage == 2 ) printk( KERN_DEBUG "UMPLOCK:   R 0x%x GPU TEXTURE\n", lock_item->secure_id );
-		else printk( KERN_DEBUG "UMPLOCK:   R 0x%x CPU\n", lock_item->secure_id );
-		#endif
-        if ( ref_count == 1 )
-		{
-			if ( 0 == down_trylock(&device.items[i_index].item_lock) )
-			{
-				//printk( KERN_ERR "UMPLOCK: semaphore for secure id 0x%x was not taken\n", lock_item->secure_id );
-			}
-			up( &device.items[i_index].item_lock );
+	#if 0
+	if ( lock_item->usage == 1 ) printk( KERN_DEBUG "UMPLOCK:   R 0x%x GPU SURFACE\n", lock_item->secure_id );
+	else if ( lock_item->usage == 2 ) printk( KERN_DEBUG "UMPLOCK:   R 0x%x GPU TEXTURE\n", lock_item->secure_id );
+	else printk( KERN_DEBUG "UMPLOCK:   R 0x%x CPU\n", lock_item->secure_id );
+	#endif
 
-			mutex_lock(&device.item_list_lock);
-			device.items[i_index].references[ref_index].ref_count = 0;
-			device.items[i_index].references[ref_index].pid = 0;
-			mutex_unlock(&device.item_list_lock);
-		}
+	if ( held != UMPLOCK_HELD_NONE )
+	{
+		umplock_unlock(item, held);
 	}
 	return 0;
 }
@@ -400,9 +534,13 @@ static int do_umplock_zap( void )
 	
 	for ( i=0; i<MAX_ITEMS; i++ )
 	{
+		spin_lock(&device.items[i].ref_lock);
 		device.items[i].secure_id = 0;
 		memset(&device.items[i].references, 0, sizeof(_lock_ref)*MAX_PIDS);
-		sema_init(&device.items[i].item_lock, 1);
+		atomic_set(&device.items[i].state, 0);
+		spin_unlock(&device.items[i].ref_lock);
+		/* waiters find the lock free and the item gone */
+		wake_up_all(&device.items[i].wait);
 	}
 	mutex_unlock(&device.item_list_lock);
 
@@ -422,18 +560,22 @@ static int do_umplock_dump( void )
 	mutex_lock(&device.item_list_lock);
 	for (i = 0; i < MAX_ITEMS; i++)
 	{
+		spin_lock(&device.items[i].ref_lock);
 		for (j = 0; j < MAX_PIDS; j++)
 		{
 			if (device.items[i].secure_id != 0 && device.items[i].references[j].pid != 0)
 			{
-				printk("item[%d]->secure_id=%d\t reference[%d].ref_count=%d.pid=%d\n",
+				printk("item[%d]->secure_id=%d\t state=%d\t reference[%d].ref_count=%d.pid=%d.held=%d\n",
 					i,
 					device.items[i].secure_id,
+					atomic_read(&device.items[i].state),
 					j,
 					device.items[i].references[j].ref_count,
-					device.items[i].references[j].pid);
+					device.items[i].references[j].pid,
+					device.items[i].references[j].held);
 			}
 		}
+		spin_unlock(&device.items[i].ref_lock);
 	}
 	mutex_unlock(&device.item_list_lock);
 
@@ -471,13 +613,12 @@ int do_umplock_client_add (_lock_cmd_priv *lock_cmd )
 int do_umplock_client_delete (_lock_cmd_priv *lock_cmd )
 {
 	int p_index=-1, i_index=-1,ref_index=-1;
-	int ret;
+	umplock_item *item;
+	int ref_count;
 	_lock_item_s *lock_item;
 	lock_item = (_lock_item_s *)&lock_cmd->msg;
 	
-	mutex_lock(&device.item_list_lock);
 	p_index = umplock_find_client_valid( lock_cmd->pid );
-	mutex_unlock(&device.item_list_lock);
 	/*lock item pid is not valid.*/
 	if ( p_index<0 )
 		return 0;
@@ -486,18 +627,18 @@ int do_umplock_client_delete (_lock_cmd_priv *lock_cmd )
 	/*walk through umplock item list and release reference attached to this client*/
 	for(i_index = 0; i_index< MAX_ITEMS; i_index++ )
 	{
-		lock_item->secure_id = device.items[i_index].secure_id;
-		mutex_lock(&device.item_list_lock);
+		lock_item->secure_id = ACCESS_ONCE(device.items[i_index].secure_id);
 		/*find the item index and reference slot for the lock_item*/
-		ret = umplock_find_item_by_pid(lock_cmd, &i_index, &ref_index);
-		mutex_unlock(&device.item_list_lock);
-		
-		if(ret < 0)
+		item = umplock_get_ref( lock_item->secure_id, lock_cmd->pid, &ref_index );
+		if ( item == NULL )
 		{
 			/*client has no reference on this umplock item, skip*/
 			continue;
 		}
-		while(device.items[i_index].references[ref_index].ref_count)
+		ref_count = item->references[ref_index].ref_count;
+		spin_unlock(&item->ref_lock);
+
+		while ( ref_count-- > 0 )
 		{
 			/*release references on this client*/
 			do_umplock_release(lock_cmd);
@@ -32,12 +32,15 @@
 #include <linux/hwmon.h>
 #include <linux/input-polldev.h>
 #include <linux/device.h>
+#include <linux/workqueue.h>
+#include <linux/io.h>
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
 
 #include <mach/system.h>
 #include <mach/hardware.h>
+#include <mach/irqs.h>
 #include <plat/sys_config.h>
 
 /*
@@ -79,9 +82,36 @@
 
 #define MODE_CHANGE_DELAY_MS 100
 
+/* the PIO external interrupts, as the ctp drivers use them */
+#define PIO_BASE_ADDRESS	(0x01c20800)
+#define PIO_RANGE_SIZE		(0x400)
+#define PIO_INT_CFG_OFFSET(n)	(0x200 + ((n) / 8) * 4)
+#define PIO_INT_CTRL_OFFSET	(0x210)
+#define PIO_INT_STAT_OFFSET	(0x214)
+#define PIO_INT_NEGATIVE_EDGE	(0x1)
+
 static struct device *hwmon_dev;
 static struct i2c_client *mma7660_i2c_client;
 
+/*
+ * The chip is only active while the input device is open. With a
+ * gsensor_int1 pin in the fex the chip interrupts on portrait/landscape
+ * and front/back changes, or on every sample with irq_every_sample,
+ * instead of being polled. It has no fifo, each interrupt is one report.
+ */
+static bool irq_every_sample;
+module_param(irq_every_sample, bool, 0444);
+MODULE_PARM_DESC(irq_every_sample, "with gsensor_int1, interrupt on every sample (16Hz)");
+
+static struct input_dev *mma7660_input;
+static DEFINE_MUTEX(mma7660_lock);
+static int mma7660_opened;
+
+static void __iomem *gpio_addr;
+static unsigned gpio_int_hdle;
+static int gpio_int_num;
+static struct work_struct mma7660_irq_work;
+
 struct mma7660_data_s {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
@@ -304,25 +334,63 @@ static int mma7660_init_client(struct i2c_client *client)
 		MMA7660_MODE, MK_MMA7660_MODE(0, 0, 0, 0, 0, 0, 0)); //enter standby
 	assert(result==0);
 
-	result = i2c_smbus_write_byte_data(client, 
-		MMA7660_SR, MK_MMA7660_SR(2, 2, 1)); 
+	if(gpio_int_hdle && irq_every_sample)
+		result = i2c_smbus_write_byte_data(client,
+			MMA7660_SR, MK_MMA7660_SR(2, 2, 3));
+	else
+		result = i2c_smbus_write_byte_data(client,
+			MMA7660_SR, MK_MMA7660_SR(2, 2, 1));
 	assert(result==0);
 
-	result = i2c_smbus_write_byte_data(client, 
-		MMA7660_INTSU, MK_MMA7660_INTSU(0, 0, 0, 0, 1, 0, 1, 1)); 
+	if(gpio_int_hdle && irq_every_sample)
+		result = i2c_smbus_write_byte_data(client,
+			MMA7660_INTSU, MK_MMA7660_INTSU(0, 0, 0, 1, 0, 0, 0, 0));
+	else
+		result = i2c_smbus_write_byte_data(client,
+			MMA7660_INTSU, MK_MMA7660_INTSU(0, 0, 0, 0, 1, 0, 1, 1));
 	assert(result==0);
 
-	result = i2c_smbus_write_byte_data(client, 
-		MMA7660_SPCNT, 0xA0); 
+	result = i2c_smbus_write_byte_data(client,
+		MMA7660_SPCNT, 0xA0);
 	assert(result==0);
 
-	result = i2c_smbus_write_byte_data(client, 
-		MMA7660_MODE, MK_MMA7660_MODE(0, 1, 0, 0, 0, 0, 1)); 
+	/* stays in standby until the input device is opened */
+	return result;
+}
+
+/* active while opened and not early suspended */
+static void mma7660_update_mode(void)
+{
+	int active = mma7660_opened;
+	int result;
+
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	if(mma7660_data.suspend_indator)
+		active = 0;
+#endif
+	if(active)
+		result = i2c_smbus_write_byte_data(mma7660_i2c_client,
+			MMA7660_MODE, MK_MMA7660_MODE(0, 1, 0, 0, 0, 0, 1));
+	else
+		result = i2c_smbus_write_byte_data(mma7660_i2c_client,
+			MMA7660_MODE, MK_MMA7660_MODE(0, 0, 0, 0, 0, 0, 0));
 	assert(result==0);
+}
 
-	mdelay(MODE_CHANGE_DELAY_MS);
+static void mma7660_start(void)
+{
+	mutex_lock(&mma7660_lock);
+	mma7660_opened = 1;
+	mma7660_update_mode();
+	mutex_unlock(&mma7660_lock);
+}
 
-	return result;
+static void mma7660_stop(void)
+{
+	mutex_lock(&mma7660_lock);
+	mma7660_opened = 0;
+	mma7660_update_mode();
+	mutex_unlock(&mma7660_lock);
 }
 
 static struct input_polled_dev *mma7660_idev;
@@ -343,11 +411,11 @@ static void report_abs(void)
 	//pr_info("xyz[0] = 0x%hx, xyz[1] = 0x%hx, xyz[2] = 0x%hx. \n", xyz[0], xyz[1], xyz[2]);
 	//pr_info("x[0] = 0x%hx, y[1] = 0x%hx, z[2] = 0x%hx. \n", x, y, z);
 	
-	input_report_abs(mma7660_idev->input, ABS_X, x);
-	input_report_abs(mma7660_idev->input, ABS_Y, y);
-	input_report_abs(mma7660_idev->input, ABS_Z, z);
+	input_report_abs(mma7660_input, ABS_X, x);
+	input_report_abs(mma7660_input, ABS_Y, y);
+	input_report_abs(mma7660_input, ABS_Z, z);
 
-	input_sync(mma7660_idev->input);
+	input_sync(mma7660_input);
 }
 
 static void mma7660_dev_poll(struct input_polled_dev *dev)
@@ -361,6 +429,107 @@ static void mma7660_dev_poll(struct input_polled_dev *dev)
 #endif
 } 
 
+static void mma7660_poll_open(struct input_polled_dev *dev)
+{
+	mma7660_start();
+}
+
+static void mma7660_poll_close(struct input_polled_dev *dev)
+{
+	mma7660_stop();
+}
+
+/*
+ * gsensor_int1 - the optional interrupt pin, muxed to its EINT function
+ * by the fex. Without it the device is polled.
+ */
+static int mma7660_irq_init(void)
+{
+	user_gpio_set_t gpio_int_info[1];
+	u32 reg_val;
+	int reg_num;
+
+	gpio_int_hdle = gpio_request_ex("gsensor_para", "gsensor_int1");
+	if(!gpio_int_hdle)
+		return -ENODEV;
+	gpio_get_one_pin_status(gpio_int_hdle, gpio_int_info, "gsensor_int1", 1);
+	gpio_int_num = gpio_int_info[0].port_num;
+
+	gpio_addr = ioremap(PIO_BASE_ADDRESS, PIO_RANGE_SIZE);
+	if(!gpio_addr) {
+		gpio_release(gpio_int_hdle, 2);
+		gpio_int_hdle = 0;
+		return -EIO;
+	}
+
+	/* active low, push-pull: falling edge */
+	reg_num = gpio_int_num % 8;
+	reg_val = readl(gpio_addr + PIO_INT_CFG_OFFSET(gpio_int_num));
+	reg_val &= ~(7 << (reg_num * 4));
+	reg_val |= PIO_INT_NEGATIVE_EDGE << (reg_num * 4);
+	writel(reg_val, gpio_addr + PIO_INT_CFG_OFFSET(gpio_int_num));
+	writel(1 << gpio_int_num, gpio_addr + PIO_INT_STAT_OFFSET);
+
+	pr_info("%s: interrupt on EINT%d\n", __func__, gpio_int_num);
+	return 0;
+}
+
+static void mma7660_irq_free(void)
+{
+	if(!gpio_int_hdle)
+		return;
+	iounmap(gpio_addr);
+	gpio_release(gpio_int_hdle, 2);
+	gpio_int_hdle = 0;
+}
+
+static void mma7660_irq_enable(int enable)
+{
+	u32 reg_val;
+
+	reg_val = readl(gpio_addr + PIO_INT_CTRL_OFFSET);
+	if(enable)
+		reg_val |= 1 << gpio_int_num;
+	else
+		reg_val &= ~(1 << gpio_int_num);
+	writel(reg_val, gpio_addr + PIO_INT_CTRL_OFFSET);
+}
+
+static irqreturn_t mma7660_interrupt(int irq, void *dev_id)
+{
+	u32 reg_val;
+
+	/* the PIO line is shared with the other EINT users */
+	reg_val = readl(gpio_addr + PIO_INT_STAT_OFFSET);
+	if(!(reg_val & (1 << gpio_int_num)))
+		return IRQ_NONE;
+	writel(1 << gpio_int_num, gpio_addr + PIO_INT_STAT_OFFSET);
+
+	schedule_work(&mma7660_irq_work);
+	return IRQ_HANDLED;
+}
+
+static void mma7660_irq_work_func(struct work_struct *work)
+{
+	/* reading TILT releases the interrupt pin */
+	i2c_smbus_read_byte_data(mma7660_i2c_client, MMA7660_TILT);
+	report_abs();
+}
+
+static int mma7660_input_open(struct input_dev *dev)
+{
+	mma7660_start();
+	mma7660_irq_enable(1);
+	return 0;
+}
+
+static void mma7660_input_close(struct input_dev *dev)
+{
+	mma7660_irq_enable(0);
+	cancel_work_sync(&mma7660_irq_work);
+	mma7660_stop();
+}
+
 /*
  * I2C init/probing/exit functions
  */
@@ -380,6 +549,8 @@ static int __devinit mma7660_probe(struct i2c_client *client,
  					 I2C_FUNC_SMBUS_BYTE_DATA);
 	assert(result);
 
+	mma7660_irq_init();
+
 	/* Initialize the MMA7660 chip */
 	result = mma7660_init_client(client);
 	assert(result==0);
@@ -389,17 +560,32 @@ static int __devinit mma7660_probe(struct i2c_client *client,
 
 	dev_info(&client->dev, "build time %s %s\n", __DATE__, __TIME__);
   
-	/*input poll device register */
-	mma7660_idev = input_allocate_polled_device();
-	if (!mma7660_idev) {
-		dev_err(&client->dev, "alloc poll device failed!\n");
-		result = -ENOMEM;
-		return result;
+	if (gpio_int_hdle) {
+		/*input device register, reports from the interrupt */
+		idev = input_allocate_device();
+		if (!idev) {
+			dev_err(&client->dev, "alloc input device failed!\n");
+			mma7660_irq_free();
+			return -ENOMEM;
+		}
+		idev->open = mma7660_input_open;
+		idev->close = mma7660_input_close;
+	} else {
+		/*input poll device register */
+		mma7660_idev = input_allocate_polled_device();
+		if (!mma7660_idev) {
+			dev_err(&client->dev, "alloc poll device failed!\n");
+			result = -ENOMEM;
+			return result;
+		}
+		mma7660_idev->open = mma7660_poll_open;
+		mma7660_idev->close = mma7660_poll_close;
+		mma7660_idev->poll = mma7660_dev_poll;
+		mma7660_idev->poll_interval = POLL_INTERVAL;
+		mma7660_idev->poll_interval_max = POLL_INTERVAL_MAX;
+		idev = mma7660_idev->input;
 	}
-	mma7660_idev->poll = mma7660_dev_poll;
-	mma7660_idev->poll_interval = POLL_INTERVAL;
-	mma7660_idev->poll_interval_max = POLL_INTERVAL_MAX;
-	idev = mma7660_idev->input;
+	mma7660_input = idev;
 	idev->name = MMA7660_DRV_NAME;
 	idev->id.bustype = BUS_I2C;
 	idev->evbit[0] = BIT_MASK(EV_ABS);
@@ -408,12 +594,30 @@ static int __devinit mma7660_probe(struct i2c_client *client,
 	input_set_abs_params(idev, ABS_Y, -512, 512, INPUT_FUZZ, INPUT_FLAT);
 	input_set_abs_params(idev, ABS_Z, -512, 512, INPUT_FUZZ, INPUT_FLAT);
 	
-	result = input_register_polled_device(mma7660_idev);
+	if (gpio_int_hdle) {
+		INIT_WORK(&mma7660_irq_work, mma7660_irq_work_func);
+		result = request_irq(SW_INT_IRQNO_PIO, mma7660_interrupt,
+				     IRQF_SHARED, MMA7660_DRV_NAME, &mma7660_data);
+		if (result) {
+			dev_err(&client->dev, "request irq failed!\n");
+			input_free_device(idev);
+			mma7660_irq_free();
+			return result;
+		}
+		result = input_register_device(idev);
+		if (result) {
+			free_irq(SW_INT_IRQNO_PIO, &mma7660_data);
+			input_free_device(idev);
+			mma7660_irq_free();
+		}
+	} else {
+		result = input_register_polled_device(mma7660_idev);
+	}
 	if (result) {
 		dev_err(&client->dev, "register poll device failed!\n");
 		return result;
 	}
-	result = sysfs_create_group(&mma7660_idev->input->dev.kobj, &mma7660_attribute_group);
+	result = sysfs_create_group(&mma7660_input->dev.kobj, &mma7660_attribute_group);
 	//result = device_create_file(&mma7660_idev->input->dev, &dev_attr_enable);
 	//result = device_create_file(&mma7660_idev->input->dev, &dev_attr_value);
 
@@ -441,29 +645,32 @@ static int __devexit mma7660_remove(struct i2c_client *client)
 
 	hwmon_device_unregister(hwmon_dev);
 
+	if (gpio_int_hdle) {
+		free_irq(SW_INT_IRQNO_PIO, &mma7660_data);
+		mma7660_irq_free();
+	}
+
 	return result;
 }
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static void mma7660_early_suspend(struct early_suspend *h)
 {
-	int result;
 	printk(KERN_INFO "mma7660 early suspend\n");
+	mutex_lock(&mma7660_lock);
 	mma7660_data.suspend_indator = 1;
-	result = i2c_smbus_write_byte_data(mma7660_i2c_client, 
-		MMA7660_MODE, MK_MMA7660_MODE(0, 0, 0, 0, 0, 0, 0));
-	assert(result==0);
+	mma7660_update_mode();
+	mutex_unlock(&mma7660_lock);
 	return;
 }
 
 static void mma7660_late_resume(struct early_suspend *h)
 {
-	int result;
 	printk(KERN_INFO "mma7660 late resume\n");
+	mutex_lock(&mma7660_lock);
 	mma7660_data.suspend_indator = 0;
-	result = i2c_smbus_write_byte_data(mma7660_i2c_client, 
-		MMA7660_MODE, MK_MMA7660_MODE(0, 1, 0, 0, 0, 0, 1));
-	assert(result==0);
+	mma7660_update_mode();
+	mutex_unlock(&mma7660_lock);
 	return;
 }
 #endif /* CONFIG_HAS_EARLYSUSPEND */
@@ -516,7 +723,7 @@ static int __init mma7660_init(void)
 static void __exit mma7660_exit(void)
 {
 	printk(KERN_INFO "remove mma7660 i2c driver.\n");
-	sysfs_remove_group(&mma7660_idev->input->dev.kobj, &mma7660_attribute_group);
+	sysfs_remove_group(&mma7660_input->dev.kobj, &mma7660_attribute_group);
 	i2c_del_driver(&mma7660_driver);
 }
 
@@ -29,6 +29,7 @@
 #include <linux/clk.h>
 #include <linux/slab.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 
 #include <asm/irq.h>
 
@@ -87,6 +88,16 @@ struct sunxi_i2c {
 	unsigned int     bus_freq;
 	unsigned int     gpio_hdle;
 
+	/* divider of the last bus_freq/apb clock pair, searched only when one changes */
+	unsigned int     clk_freq;
+	unsigned int     clk_rate;
+	unsigned int     clk_n;
+	unsigned int     clk_m;
+
+	/* good transfers, for the throughput sysfs file */
+	u64              xfer_bytes;
+	u64              xfer_ns;
+
 	void __iomem	 *base_addr;
 
 	unsigned long		iobase; // for remove
@@ -121,6 +132,15 @@ static void* __iomem gpio_addr = NULL;
 
 static int twi_used_mask = 0;
 
+/*
+ * Transfers whose bytes take no longer than this on the wire run polled,
+ * which is cheaper than one interrupt per byte plus the wakeup. 0 turns
+ * polling off.
+ */
+static unsigned int poll_us = 100;
+module_param(poll_us, uint, 0644);
+MODULE_PARM_DESC(poll_us, "Poll transfers up to this many microseconds on the bus");
+
 /* clear the interrupt flag */
 static inline void aw_twi_clear_irq_flag(void *base_addr)
 {
@@ -278,7 +298,8 @@ static inline void twi_clk_write_reg(unsigned int clk_n, unsigned int clk_m, voi
 * clk_in: apb clk clock
 * sclk_req: freqence to set in HZ
 */
-static void aw_twi_set_clock(unsigned int clk_in, unsigned int sclk_req, void *base_addr)
+static void aw_twi_calc_clock(unsigned int clk_in, unsigned int sclk_req,
+			      unsigned int *n, unsigned int *m)
 {
 	unsigned int clk_m = 0;
 	unsigned int clk_n = 0;
@@ -318,9 +339,8 @@ static void aw_twi_set_clock(unsigned int clk_in, unsigned int sclk_req, void *b
 	}
 
 set_clk:
-	twi_clk_write_reg(clk_n, clk_m, base_addr);
-
-	return;
+	*n = clk_n;
+	*m = clk_m;
 }
 
 static inline void aw_twi_soft_reset(void *base_addr)
@@ -805,6 +825,8 @@ static int i2c_sunxi_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int nu
 	struct sunxi_i2c *i2c = (struct sunxi_i2c *)adap->algo_data;
 	int ret = AWXX_I2C_FAIL;
 	int i   = 0;
+	int j;
+	ktime_t start = ktime_get();
 
 	if(i2c->suspend_flag) {
 		i2c_dbg("[i2c-%d] has already suspend, dev addr:%x!\n", i2c->adap.nr, msgs->addr);
@@ -814,6 +836,12 @@ static int i2c_sunxi_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int nu
 	for(i = adap->retries; i >= 0; i--) {
 		ret = i2c_sunxi_do_xfer(i2c, msgs, num);
 
+		if(ret == num) {
+			for (j = 0; j < num; j++)
+				i2c->xfer_bytes += msgs[j].len;
+			i2c->xfer_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+			goto out;
+		}
 		if(ret != AWXX_I2C_RETRY) {
 			goto out;
 		}
@@ -827,14 +855,65 @@ out:
 	return ret;
 }
 
+/* a whole i2c_msg array is short enough for polling */
+static int i2c_sunxi_poll_msgs(struct sunxi_i2c *i2c, struct i2c_msg *msgs, int num)
+{
+	unsigned int bytes = 0;
+	int i;
+
+	if (!poll_us || !i2c->bus_freq)
+		return 0;
+
+	for (i = 0; i < num; i++) {
+		/* address byte, two of them for 10 bit */
+		bytes += msgs[i].len + ((msgs[i].flags & I2C_M_TEN) ? 2 : 1);
+	}
+	/* 9 clocks per byte with the ack */
+	return bytes * 9 <= poll_us * (i2c->bus_freq / 1000) / 1000;
+}
+
+/*
+ * run the state machine of the irq handler by polling the irq flag.
+ * jiffies may not move here (the caller can have interrupts off),
+ * so the timeout is counted in microseconds of waiting.
+ */
+static void i2c_sunxi_poll_xfer(struct sunxi_i2c *i2c)
+{
+	unsigned int wait_us = jiffies_to_usecs(i2c->adap.timeout);
+
+	while (i2c->status != I2C_XFER_IDLE) {
+		if (aw_twi_query_irq_flag(i2c->base_addr)) {
+			i2c_sunxi_core_process(i2c);
+			continue;
+		}
+		udelay(1);
+		if (!--wait_us) {
+			/* leave msg_num set, the caller sees the timeout */
+			aw_twi_soft_reset(i2c->base_addr);
+			i2c->status = I2C_XFER_IDLE;
+			break;
+		}
+	}
+}
+
 static int i2c_sunxi_do_xfer(struct sunxi_i2c *i2c, struct i2c_msg *msgs, int num)
 {
 	unsigned long timeout = 0;
+	unsigned long flags;
 	int ret = AWXX_I2C_FAIL;
+	/*
+	 * callers that can't sleep (i2c_transfer() from atomic context or
+	 * with interrupts off, e.g. a PMIC write in a dvfs step) always poll
+	 */
+	int poll = in_atomic() || irqs_disabled() ||
+		   i2c_sunxi_poll_msgs(i2c, msgs, num);
 	//int i = 0, j =0;
 
-	aw_twi_soft_reset(i2c->base_addr);
-	udelay(100);
+	/* an idle controller needs no reset, that saves 100us per transfer */
+	if (TWI_STAT_IDLE != aw_twi_query_irq_status(i2c->base_addr)) {
+		aw_twi_soft_reset(i2c->base_addr);
+		udelay(100);
+	}
 
 	/* test the bus is free,already protect by the semaphore at DEV layer */
 	while( TWI_STAT_IDLE != aw_twi_query_irq_status(i2c->base_addr)&&
@@ -851,16 +930,17 @@ static int i2c_sunxi_do_xfer(struct sunxi_i2c *i2c, struct i2c_msg *msgs, int nu
 	//i2c_dbg("bus num = %d\n", i2c->adap.nr);
 	//i2c_dbg("bus name = %s\n", i2c->adap.name);
 	/* may conflict with xfer_complete */
-	spin_lock_irq(&i2c->lock);
+	spin_lock_irqsave(&i2c->lock, flags);
 	i2c->msg     = msgs;
 	i2c->msg_num = num;
 	i2c->msg_ptr = 0;
 	i2c->msg_idx = 0;
 	i2c->status  = I2C_XFER_START;
-    aw_twi_enable_irq(i2c->base_addr);  /* enable irq */
+	if (!poll)
+		aw_twi_enable_irq(i2c->base_addr);  /* enable irq */
 	aw_twi_disable_ack(i2c->base_addr); /* disabe ACK */
 	aw_twi_set_EFR(i2c->base_addr, 0);  /* set the special function register,default:0. */
-	spin_unlock_irq(&i2c->lock);
+	spin_unlock_irqrestore(&i2c->lock, flags);
 /*
 	for(i =0 ; i < num; i++){
 		for(j = 0; j < msgs->len; j++){
@@ -881,8 +961,13 @@ static int i2c_sunxi_do_xfer(struct sunxi_i2c *i2c, struct i2c_msg *msgs, int nu
 	}
 
 	i2c->status  = I2C_XFER_RUNNING;
-	/* sleep and wait, do the transfer at interrupt handler ,timeout = 5*HZ */
-	timeout = wait_event_timeout(i2c->wait, i2c->msg_num == 0, i2c->adap.timeout);
+	if (poll) {
+		i2c_sunxi_poll_xfer(i2c);
+		timeout = (i2c->msg_num == 0);
+	} else {
+		/* sleep and wait, do the transfer at interrupt handler ,timeout = 5*HZ */
+		timeout = wait_event_timeout(i2c->wait, i2c->msg_num == 0, i2c->adap.timeout);
+	}
 	/* return code,if(msg_idx == num) succeed */
 	ret = i2c->msg_idx;
 
@@ -911,6 +996,16 @@ static const struct i2c_algorithm i2c_sunxi_algorithm = {
 	.functionality	  = i2c_sunxi_functionality,
 };
 
+static void i2c_sunxi_set_clock(struct sunxi_i2c *i2c, unsigned int apb_clk)
+{
+	if (i2c->clk_rate != apb_clk || i2c->clk_freq != i2c->bus_freq) {
+		aw_twi_calc_clock(apb_clk, i2c->bus_freq, &i2c->clk_n, &i2c->clk_m);
+		i2c->clk_rate = apb_clk;
+		i2c->clk_freq = i2c->bus_freq;
+	}
+	twi_clk_write_reg(i2c->clk_n, i2c->clk_m, i2c->base_addr);
+}
+
 static int i2c_sunxi_clk_init(struct sunxi_i2c *i2c)
 {
 	int ret = 0;
@@ -933,7 +1028,7 @@ static int i2c_sunxi_clk_init(struct sunxi_i2c *i2c)
 		i2c_dbg("get i2c source clock frequency failed!\n");
 		return -1;
 	}
-	aw_twi_set_clock(apb_clk, i2c->bus_freq, i2c->base_addr);
+	i2c_sunxi_set_clock(i2c, apb_clk);
 
 	return 0;
 
@@ -981,6 +1076,84 @@ static void i2c_sunxi_hw_exit(struct sunxi_i2c *i2c)
 
 }
 
+static ssize_t i2c_sunxi_speed_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct sunxi_i2c *i2c = platform_get_drvdata(to_platform_device(dev));
+
+	return sprintf(buf, "%u\n", i2c->bus_freq);
+}
+
+/* change the bus speed, takes effect between two transfers */
+static ssize_t i2c_sunxi_speed_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct sunxi_i2c *i2c = platform_get_drvdata(to_platform_device(dev));
+	unsigned long freq;
+
+	if (strict_strtoul(buf, 0, &freq) || !freq ||
+	    freq > I2C_MAX_TRANSFER_SPEED)
+		return -EINVAL;
+
+	i2c_lock_adapter(&i2c->adap);
+	i2c->bus_freq = freq;
+	i2c_sunxi_set_clock(i2c, clk_get_rate(i2c->clk));
+	i2c_unlock_adapter(&i2c->adap);
+
+	return count;
+}
+
+static DEVICE_ATTR(speed, 0644, i2c_sunxi_speed_show, i2c_sunxi_speed_store);
+
+/* payload bytes of good transfers and the time spent in them */
+static ssize_t i2c_sunxi_throughput_show(struct device *dev,
+					 struct device_attribute *attr, char *buf)
+{
+	struct sunxi_i2c *i2c = platform_get_drvdata(to_platform_device(dev));
+	u64 bytes, us, rate = 0;
+
+	i2c_lock_adapter(&i2c->adap);
+	bytes = i2c->xfer_bytes;
+	us = i2c->xfer_ns;
+	i2c_unlock_adapter(&i2c->adap);
+
+	do_div(us, NSEC_PER_USEC);
+	if (us) {
+		rate = bytes * USEC_PER_SEC;
+		do_div(rate, us);
+	}
+
+	return sprintf(buf, "%llu bytes in %llu us, %llu bytes/s\n",
+		       bytes, us, rate);
+}
+
+static DEVICE_ATTR(throughput, 0444, i2c_sunxi_throughput_show, NULL);
+
+static struct attribute *i2c_sunxi_attrs[] = {
+	&dev_attr_speed.attr,
+	&dev_attr_throughput.attr,
+	NULL,
+};
+
+static const struct attribute_group i2c_sunxi_attr_group = {
+	.attrs = i2c_sunxi_attrs,
+};
+
+/* twi_speed in twiN_para overrides the default speed of the bus */
+static unsigned int i2c_sunxi_get_cfg_speed(int bus_num, unsigned int freq)
+{
+	char twi_para[16];
+	int speed;
+
+	sprintf(twi_para, "twi%d_para", bus_num);
+	if (script_parser_fetch(twi_para, "twi_speed", &speed, sizeof(int)) ||
+	    speed <= 0)
+		return freq;
+
+	return min_t(unsigned int, speed, I2C_MAX_TRANSFER_SPEED);
+}
+
 static int i2c_sunxi_probe(struct platform_device *dev)
 {
 	struct sunxi_i2c *i2c = NULL;
@@ -1017,7 +1190,7 @@ static int i2c_sunxi_probe(struct platform_device *dev)
 	i2c->adap.retries = 2;
 	i2c->adap.timeout = 5*HZ;
 	i2c->adap.class   = I2C_CLASS_HWMON | I2C_CLASS_SPD;
-	i2c->bus_freq     = pdata->frequency;
+	i2c->bus_freq     = i2c_sunxi_get_cfg_speed(pdata->bus_num, pdata->frequency);
 	i2c->irq 		  = irq;
 	i2c->bus_num      = pdata->bus_num;
 	i2c->status       = I2C_XFER_IDLE;
@@ -1083,6 +1256,9 @@ static int i2c_sunxi_probe(struct platform_device *dev)
 
 	platform_set_drvdata(dev, i2c);
 
+	if (sysfs_create_group(&dev->dev.kobj, &i2c_sunxi_attr_group))
+		pr_warning("twi%d: no sysfs attributes\n", i2c->bus_num);
+
 	i2c_dbg(KERN_INFO "I2C: %s: AW16XX I2C adapter\n",
 	       dev_name(&i2c->adap.dev));
 
@@ -1116,6 +1292,7 @@ static int __exit i2c_sunxi_remove(struct platform_device *dev)
 {
 	struct sunxi_i2c *i2c = platform_get_drvdata(dev);
 
+	sysfs_remove_group(&dev->dev.kobj, &i2c_sunxi_attr_group);
 	platform_set_drvdata(dev, NULL);
 
 	i2c_del_adapter(&i2c->adap);
@@ -43,6 +43,11 @@
 #include <mach/hardware.h>
 #include <plat/sys_config.h>
 
+#ifdef CONFIG_THERMAL
+#include <linux/thermal.h>
+#include <linux/sunxi_thermal.h>
+#endif
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
     #include <linux/pm.h>
     #include <linux/earlysuspend.h>
@@ -87,16 +92,20 @@
 
 
 #define FILTER_EN              (1<<2)
-#define FILTER_TYPE            (0x01<<0)
+#define FILTER_TYPE            (tp_filter_type<<0)   //0: 4/2, 1: 5/3, 2: 8/4, 3: 16/8 median/average
 
 #define TP_DATA_IRQ_EN         (1<<16)
 #define TP_DATA_XY_CHANGE      (tp_exchange_x_y<<13)       //tp_exchange_x_y
-#define TP_FIFO_TRIG_LEVEL     (1<<8)
+#define TP_FIFO_TRIG_LEVEL     ((2*tp_fifo_pairs-1)<<8) //irq at level+1 words
 #define TP_FIFO_FLUSH          (1<<4)
 #define TP_UP_IRQ_EN           (1<<1)
 #define TP_DOWN_IRQ_EN         (1<<0)
 
+#define TEMP_ENABLE            (1<<16)
+#define TEMP_PERIOD(x)         ((x)<<0)     //in 4096 adc clocks, 488: 0.5s
+
 #define FIFO_DATA_PENDING      (1<<16)
+#define FIFO_DATA_CNT(x)       (((x)>>8)&0x1f)
 #define TP_UP_PENDING          (1<<1)
 #define TP_DOWN_PENDING        (1<<0)
 
@@ -107,6 +116,9 @@ struct sun4i_ts_data {
 	int irq;
 	char phys[32];
 	int ignore_fifo_data;
+#ifdef CONFIG_THERMAL
+	struct thermal_zone_device *tz;
+#endif
 #ifdef CONFIG_HAS_EARLYSUSPEND
     struct early_suspend early_suspend;
 #endif
@@ -117,6 +129,111 @@ static int tp_press_threshold_enable = 0;
 static int tp_press_threshold = 0; //usded to adjust sensitivity of touch
 static int tp_sensitive_level = 0; //used to adjust sensitivity of pen down detection
 static int tp_exchange_x_y = 0;
+static int tp_filter_type = 2; //hardware median/averaging filter size
+static int tp_fifo_pairs = 4;  //x,y pairs per data interrupt
+static int tp_input_used = 0;  //0: only the temperature sensor is used
+
+#ifdef CONFIG_THERMAL
+/*
+ * The temperature sensor of the SoC sits in this controller; it is
+ * the thermal zone of the chip, with one passive trip and one critical
+ * one. The passive trip steps the sunxi cooling devices (cpufreq, mali
+ * and VE clock caps, see linux/sunxi_thermal.h) one state at a time:
+ * with tc1 = tc2 = 1 the passive cooling of the thermal core goes a
+ * state up each passive poll while above the trip and not cooling
+ * down, and a state down again once the temperature falls.
+ */
+#define TEMP_POLL_MS           (2000)
+#define TEMP_PASSIVE_MS        (1000)
+#define TEMP_TRIP_PASSIVE      (0)
+#define TEMP_TRIP_CRITICAL     (1)
+#define TEMP_PASSIVE_DEFAULT   (85)         //degrees C
+#define TEMP_CRITICAL_DEFAULT  (110)
+
+static int tp_temp_trip[2] = { TEMP_PASSIVE_DEFAULT, TEMP_CRITICAL_DEFAULT };
+
+static int sun4i_ts_get_temp(struct thermal_zone_device *tz, unsigned long *temp)
+{
+	u32 raw = readl(TP_BASSADDRESS + TEMP_DATA) & 0xfff;
+	long mc;
+
+	/* nothing until the first conversion, one period after tp_init */
+	if (!raw)
+		return -EAGAIN;
+
+	mc = (long)raw * 100 - 144700;
+	*temp = mc > 0 ? mc : 0;
+	return 0;
+}
+
+static int sun4i_ts_get_trip_type(struct thermal_zone_device *tz, int trip,
+				  enum thermal_trip_type *type)
+{
+	if (trip == TEMP_TRIP_PASSIVE)
+		*type = THERMAL_TRIP_PASSIVE;
+	else if (trip == TEMP_TRIP_CRITICAL)
+		*type = THERMAL_TRIP_CRITICAL;
+	else
+		return -EINVAL;
+	return 0;
+}
+
+static int sun4i_ts_get_trip_temp(struct thermal_zone_device *tz, int trip,
+				  unsigned long *temp)
+{
+	if (trip < 0 || trip >= ARRAY_SIZE(tp_temp_trip))
+		return -EINVAL;
+	*temp = tp_temp_trip[trip] * 1000;
+	return 0;
+}
+
+static int sun4i_ts_get_crit_temp(struct thermal_zone_device *tz,
+				  unsigned long *temp)
+{
+	return sun4i_ts_get_trip_temp(tz, TEMP_TRIP_CRITICAL, temp);
+}
+
+static int sun4i_ts_is_cooling(struct thermal_cooling_device *cdev)
+{
+	return !strcmp(cdev->type, SUNXI_COOLING_CPU) ||
+	       !strcmp(cdev->type, SUNXI_COOLING_GPU) ||
+	       !strcmp(cdev->type, SUNXI_COOLING_VE);
+}
+
+static int sun4i_ts_bind(struct thermal_zone_device *tz,
+			 struct thermal_cooling_device *cdev)
+{
+	if (!sun4i_ts_is_cooling(cdev))
+		return 0;
+	return thermal_zone_bind_cooling_device(tz, TEMP_TRIP_PASSIVE, cdev);
+}
+
+static int sun4i_ts_unbind(struct thermal_zone_device *tz,
+			   struct thermal_cooling_device *cdev)
+{
+	if (!sun4i_ts_is_cooling(cdev))
+		return 0;
+	return thermal_zone_unbind_cooling_device(tz, TEMP_TRIP_PASSIVE, cdev);
+}
+
+static const struct thermal_zone_device_ops sun4i_ts_tz_ops = {
+	.bind          = sun4i_ts_bind,
+	.unbind        = sun4i_ts_unbind,
+	.get_temp      = sun4i_ts_get_temp,
+	.get_trip_type = sun4i_ts_get_trip_type,
+	.get_trip_temp = sun4i_ts_get_trip_temp,
+	.get_crit_temp = sun4i_ts_get_crit_temp,
+};
+#endif
+
+//the data and up irqs, only when the panel is used
+static u32 tp_irq_config(void)
+{
+    if (!tp_input_used)
+        return 0;
+    //TP_INT_FIFOC: 0x00010712, 4 pairs per data irq by default
+    return TP_DATA_IRQ_EN|TP_FIFO_TRIG_LEVEL|TP_FIFO_FLUSH|TP_UP_IRQ_EN;
+}
 
 //停用设备
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -128,7 +245,12 @@ static void sun4i_ts_suspend(struct early_suspend *h)
     #ifdef PRINT_SUSPEND_INFO
         printk("enter earlysuspend: sun4i_ts_suspend. \n");
     #endif
+    #ifdef CONFIG_THERMAL
+    //the screen is off but the system runs, so the sensor has to go on
+    writel(0,TP_BASSADDRESS + TP_INT_FIFOC);
+    #else
     writel(0,TP_BASSADDRESS + TP_CTRL1);
+    #endif
 	return ;
 }
 
@@ -141,7 +263,11 @@ static void sun4i_ts_resume(struct early_suspend *h)
     #ifdef PRINT_SUSPEND_INFO
         printk("enter laterresume: sun4i_ts_resume. \n");
     #endif
+    #ifdef CONFIG_THERMAL
+    writel(tp_irq_config(),TP_BASSADDRESS + TP_INT_FIFOC);
+    #else
     writel(STYLUS_UP_DEBOUNCE|STYLUS_UP_DEBOUCE_EN|TP_MODE_EN,TP_BASSADDRESS + TP_CTRL1);
+    #endif
 	return ;
 }
 #else
@@ -186,16 +312,14 @@ static int  tp_init(void)
     }
 
 
-    //TP_CTRL3: 0x05
+    //TP_CTRL3: 0x06 by default, 8 sample median and averaging
     writel(FILTER_EN|FILTER_TYPE,TP_BASSADDRESS + TP_CTRL3);
 
-    #ifdef TP_TEMP_DEBUG
-        //TP_INT_FIFOC: 0x00010313
-        writel(TP_DATA_IRQ_EN|TP_FIFO_TRIG_LEVEL|TP_FIFO_FLUSH|TP_UP_IRQ_EN|0x40000, TP_BASSADDRESS + TP_INT_FIFOC);
-        writel(0x10fff, TP_BASSADDRESS + TP_TPR);
-    #else
-        //TP_INT_FIFOC: 0x00010313
-        writel(TP_DATA_IRQ_EN|TP_FIFO_TRIG_LEVEL|TP_FIFO_FLUSH|TP_UP_IRQ_EN, TP_BASSADDRESS + TP_INT_FIFOC);
+    writel(tp_irq_config(), TP_BASSADDRESS + TP_INT_FIFOC);
+
+    #ifdef CONFIG_THERMAL
+        //TEMP_DATA follows the sensor every 0.5s, get_temp just reads it
+        writel(TEMP_ENABLE|TEMP_PERIOD(488), TP_BASSADDRESS + TP_TPR);
     #endif
     //TP_CTRL1: 0x00000070 -> 0x00000030
 
@@ -204,32 +328,59 @@ static int  tp_init(void)
     return (0);
 }
 
+/*
+ * The fifo raises the data irq once tp_fifo_pairs filtered x,y pairs
+ * are in, and they go out as one frame at their mean. On up the pairs
+ * below the trigger level are drained first, so a short tap still
+ * gets its position.
+ */
+static void sun4i_ts_report_fifo(struct sun4i_ts_data *ts_data, u32 reg_val)
+{
+	unsigned int pairs = FIFO_DATA_CNT(reg_val) / 2;
+	unsigned int n = 0;
+	u32 x = 0, y = 0;
+
+	while (pairs--) {
+		u32 px = readl(TP_BASSADDRESS + TP_DATA);
+		u32 py = readl(TP_BASSADDRESS + TP_DATA);
+
+		/* The 1st location reported after an up event is unreliable */
+		if (ts_data->ignore_fifo_data) {
+			ts_data->ignore_fifo_data = 0;
+			continue;
+		}
+		x += px;
+		y += py;
+		n++;
+	}
+
+	if (!n)
+		return;
+
+	/* pr_err("motion: %dx%d\n", x / n, y / n); */
+	input_report_abs(ts_data->input, ABS_X, x / n);
+	input_report_abs(ts_data->input, ABS_Y, y / n);
+	/*
+	 * The hardware has a separate down status bit, but
+	 * that gets set before we get the first location,
+	 * resulting in reporting a click on the old location.
+	 */
+	input_report_key(ts_data->input, BTN_TOUCH, 1);
+	input_sync(ts_data->input);
+}
+
 static irqreturn_t sun4i_isr_tp(int irq, void *dev_id)
 {
 	struct sun4i_ts_data *ts_data = dev_id;
 	u32 reg_val;
-	u32 x, y;
 
 	reg_val  = readl(TP_BASSADDRESS + TP_INT_FIFOS);
 
-	if (reg_val & FIFO_DATA_PENDING) {
-		x = readl(TP_BASSADDRESS + TP_DATA);
-		y = readl(TP_BASSADDRESS + TP_DATA);
-		/* The 1st location reported after an up event is unreliable */
-		if (!ts_data->ignore_fifo_data) {
-			/* pr_err("motion: %dx%d\n", x, y); */
-			input_report_abs(ts_data->input, ABS_X, x);
-			input_report_abs(ts_data->input, ABS_Y, y);
-			/*
-			 * The hardware has a separate down status bit, but
-			 * that gets set before we get the first location,
-			 * resulting in reporting a click on the old location.
-			 */
-			input_report_key(ts_data->input, BTN_TOUCH, 1);
-			input_sync(ts_data->input);
-		} else
-			ts_data->ignore_fifo_data = 0;
-	}
+	if (!tp_input_used)
+		goto out;
+
+	if (reg_val & (FIFO_DATA_PENDING | TP_UP_PENDING))
+		sun4i_ts_report_fifo(ts_data, reg_val);
 
 	if (reg_val & TP_UP_PENDING) {
 		/* pr_err("up\n"); */
@@ -238,6 +389,7 @@ static irqreturn_t sun4i_isr_tp(int irq, void *dev_id)
 		input_sync(ts_data->input);
 	}
 
+out:
         writel(reg_val, TP_BASSADDRESS + TP_INT_FIFOS);
 
 	return IRQ_HANDLED;
@@ -328,9 +480,11 @@ static int __devinit sun4i_ts_probe(struct platform_device *pdev)
 
 	//printk("Input request \n");
 	/* All went ok, so register to the input system */
-	err = input_register_device(ts_data->input);
-	if (err)
-		goto err_out3;
+	if (tp_input_used) {
+		err = input_register_device(ts_data->input);
+		if (err)
+			goto err_out3;
+	}
 
 	#ifdef CONFIG_TOUCHSCREEN_SUN4I_DEBUG
         printk("tp init\n");
@@ -338,6 +492,20 @@ static int __devinit sun4i_ts_probe(struct platform_device *pdev)
 
     tp_init();
 
+#ifdef CONFIG_THERMAL
+    ts_data->tz = thermal_zone_device_register("sunxi-soc", ARRAY_SIZE(tp_temp_trip),
+                                     ts_data, &sun4i_ts_tz_ops, 1, 1,
+                                     TEMP_PASSIVE_MS, TEMP_POLL_MS);
+    if (IS_ERR(ts_data->tz)) {
+        dev_err(&pdev->dev, "Cannot register the thermal zone, %ld\n",
+                PTR_ERR(ts_data->tz));
+        ts_data->tz = NULL;
+    } else {
+        printk("sun4i-ts: thermal zone, passive %d C, critical %d C\n",
+               tp_temp_trip[TEMP_TRIP_PASSIVE], tp_temp_trip[TEMP_TRIP_CRITICAL]);
+    }
+#endif
+
     #ifdef CONFIG_TOUCHSCREEN_SUN4I_DEBUG
 	    printk( "sun4i-ts.c: sun4i_ts_probe: end\n");
     #endif
@@ -373,7 +541,14 @@ static int __devexit sun4i_ts_remove(struct platform_device *pdev)
 	#ifdef CONFIG_HAS_EARLYSUSPEND
 	    unregister_early_suspend(&ts_data->early_suspend);
 	#endif
-	input_unregister_device(ts_data->input);
+#ifdef CONFIG_THERMAL
+	if (ts_data->tz)
+		thermal_zone_device_unregister(ts_data->tz);
+#endif
+	if (tp_input_used) {
+		input_unregister_device(ts_data->input);
+		ts_data->input = NULL;	/* freed by the input core */
+	}
 	free_irq(ts_data->irq, pdev);
 	sun4i_ts_data_free(ts_data);
 	platform_set_drvdata(pdev, NULL);
@@ -432,6 +607,7 @@ struct platform_device sun4i_ts_device = {
 static int __init sun4i_ts_init(void)
 {
   int device_used = 0;
+  int val = 0;
   int ret = -1;
 
 #ifdef CONFIG_TOUCHSCREEN_SUN4I_DEBUG
@@ -441,10 +617,29 @@ static int __init sun4i_ts_init(void)
 	//config rtp
 	if(SCRIPT_PARSER_OK != script_parser_fetch("rtp_para", "rtp_used", &device_used, sizeof(device_used)/sizeof(int))){
 	    pr_err("sun4i_ts_init: script_parser_fetch err. \n");
+#ifndef CONFIG_THERMAL
 	    goto script_parser_fetch_err;
+#else
+	    device_used = 0;
+#endif
 	}
 	printk("rtp_used == %d. \n", device_used);
+
+#ifdef CONFIG_THERMAL
+	/* optional, degrees C */
+	if(SCRIPT_PARSER_OK == script_parser_fetch("rtp_para", "rtp_temp_passive", &val, 1))
+		tp_temp_trip[TEMP_TRIP_PASSIVE] = val;
+	if(SCRIPT_PARSER_OK == script_parser_fetch("rtp_para", "rtp_temp_critical", &val, 1))
+		tp_temp_trip[TEMP_TRIP_CRITICAL] = val;
+	if(tp_temp_trip[TEMP_TRIP_PASSIVE] >= tp_temp_trip[TEMP_TRIP_CRITICAL]){
+		printk("sun4i-ts: rtp_temp_passive must be below rtp_temp_critical. \n");
+		tp_temp_trip[TEMP_TRIP_PASSIVE] = TEMP_PASSIVE_DEFAULT;
+		tp_temp_trip[TEMP_TRIP_CRITICAL] = TEMP_CRITICAL_DEFAULT;
+	}
+#endif
+
 	if(1 == device_used){
+            tp_input_used = 1;
 
             if(SCRIPT_PARSER_OK != script_parser_fetch("rtp_para", "rtp_press_threshold_enable", &tp_press_threshold_enable, 1)){
                 pr_err("sun4i_ts_init: script_parser_fetch err rtp_press_threshold_enable. \n");
@@ -492,8 +687,28 @@ static int __init sun4i_ts_init(void)
                 goto script_parser_fetch_err;
             }
 
+            /* optional, the defaults are kept when these are missing */
+            if(SCRIPT_PARSER_OK == script_parser_fetch("rtp_para", "rtp_filter_type", &val, 1)){
+                if(val >= 0 && val <= 3)
+                    tp_filter_type = val;
+                else
+                    printk("sun4i-ts: only rtp_filter_type between 0 and 3 is supported. \n");
+            }
+            if(SCRIPT_PARSER_OK == script_parser_fetch("rtp_para", "rtp_fifo_pairs", &val, 1)){
+                if(val >= 1 && val <= 16)
+                    tp_fifo_pairs = val;
+                else
+                    printk("sun4i-ts: only rtp_fifo_pairs between 1 and 16 is supported. \n");
+            }
+            printk("sun4i-ts: rtp_filter_type is %d, rtp_fifo_pairs is %d.\n", tp_filter_type, tp_fifo_pairs);
+
 	}else{
+#ifndef CONFIG_THERMAL
 		goto script_parser_fetch_err;
+#else
+		//no panel, the controller still has the temperature sensor
+		printk("sun4i-ts: temperature sensor only. \n");
+#endif
 	}
 
 	platform_device_register(&sun4i_ts_device);
@@ -131,7 +131,7 @@ s32 ACE_HwReq(__ace_module_type_e module, __ace_request_mode_e mode, __u32 timeo
     if (ACE_MODULE_CE == module || ACE_MODULE_PNG == module || ACE_MODULE_TSCC == module ) {
         //request semphore
         if (ACE_REQUEST_MODE_NOWAIT == mode) {
-            if (down_trylock(&pSemAceCe)== 0) {     //the resource is available or not
+            if (down_trylock(&pSemAceCe) != 0) {     //the resource is available or not
                  return ACE_FAIL;
 	    	}
 	    } else if (ACE_REQUEST_MODE_WAIT == mode) {
@@ -153,8 +153,8 @@ EXPORT_SYMBOL_GPL(ACE_HwReq);
 
 __s32 ACE_HwRel(__ace_module_type_e module)
 {
-	if (module == ACE_MODULE_CE) {
-        //release semphore
+	if (ACE_MODULE_CE == module || ACE_MODULE_PNG == module || ACE_MODULE_TSCC == module) {
+        //release semphore, PNG and TSCC run on the CE
 	    up(&pSemAceCe);
         ACE_EnableModule(ACE_MODULE_CE, ACE_MODULE_DISABLE);
     } else if(module == ACE_MODULE_AE) {
@@ -62,6 +62,11 @@ static int ace_dev_open(struct inode *inode, struct file *filp){
 
 static int ace_dev_release(struct inode *inode, struct file *filp){
     int status = 0;
+    long clk_refs = (long)filp->private_data;
+
+    /* the clock references this file didn't close */
+    while (clk_refs-- > 0)
+        ACE_ClkClose();
 
     return status;
 }
@@ -94,13 +99,113 @@ static irqreturn_t ace_interrupt(int irq, void *dev)
 /* 200MHz is the limit for ACE_CLK_REG (see the A10 User Manual) */
 #define ACE_CLOCK_SPEED_LIMIT 200000000
 
+/*
+ * The clocks are on from the first ACE_ClkOpen() to the last
+ * ACE_ClkClose(). Kernel users and the files of the char device share
+ * the count, and a file that goes away drops what it still holds.
+ */
+static DEFINE_MUTEX(ace_clk_lock);
+
+/* rate 0: the fastest the limit allows from pll5p */
+static int ace_clk_on(unsigned long rate)
+{
+	int pll5_div;
+
+	ace_moduleclk = clk_get(NULL,"ace");
+	ace_pll5_pclk = clk_get(NULL, "sdram_pll_p");
+	if (clk_set_parent(ace_moduleclk, ace_pll5_pclk)) {
+		printk("try to set parent of ace_moduleclk to ace_pll5clk failed!\n");
+	}
+	if (!rate) {
+		rate = clk_get_rate(ace_pll5_pclk);
+		pll5_div = DIV_ROUND_UP(rate, ACE_CLOCK_SPEED_LIMIT);
+		rate /= pll5_div;
+	}
+	if(clk_set_rate(ace_moduleclk, rate)) {
+		printk("try to set ace_moduleclk rate failed!!!\n");
+		goto out;
+	}
+	if(clk_reset(ace_moduleclk, 1)){
+		printk("try to reset ace_moduleclkfailed!!!\n");
+		goto out;
+	}
+	if(clk_reset(ace_moduleclk, 0)){
+		printk("try to reset ace_moduleclkfailed!!!\n");
+		goto out;
+	}
+	if (-1 == clk_enable(ace_moduleclk)) {
+		printk("ace_moduleclk failed; \n");
+		goto out;
+	}
+
+	/*geting dram clk for ace!*/
+	dram_aceclk = clk_get(NULL, "sdram_ace");
+	if (-1 == clk_enable(dram_aceclk)) {
+		printk("dram_moduleclk failed; \n");
+		goto out1;
+	}
+	/* getting ahb clk for ace! */
+	ahb_aceclk = clk_get(NULL,"ahb_ace");
+	if (-1 == clk_enable(ahb_aceclk)) {
+		printk("ahb_aceclk failed; \n");
+		goto out2;
+	}
+	return 0;
+
+out2:
+	clk_put(ahb_aceclk);
+	clk_disable(dram_aceclk);
+out1:
+	clk_put(dram_aceclk);
+	clk_disable(ace_moduleclk);
+out:
+	clk_put(ace_moduleclk);
+	clk_put(ace_pll5_pclk);
+	return -EIO;
+}
+
+static void ace_clk_off(void)
+{
+	clk_disable(ahb_aceclk);
+	clk_put(ahb_aceclk);
+	clk_disable(dram_aceclk);
+	clk_put(dram_aceclk);
+	clk_disable(ace_moduleclk);
+	clk_put(ace_moduleclk);
+	clk_put(ace_pll5_pclk);
+}
+
+__s32 ACE_ClkOpen(void)
+{
+	int ret = 0;
+
+	mutex_lock(&ace_clk_lock);
+	if (ref_count == 0)
+		ret = ace_clk_on(0);
+	if (ret == 0)
+		ref_count++;
+	mutex_unlock(&ace_clk_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ACE_ClkOpen);
+
+__s32 ACE_ClkClose(void)
+{
+	mutex_lock(&ace_clk_lock);
+	if (ref_count > 0 && --ref_count == 0)
+		ace_clk_off();
+	mutex_unlock(&ace_clk_lock);
+
+	return ACE_OK;
+}
+EXPORT_SYMBOL_GPL(ACE_ClkClose);
+
 static long ace_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int 				ret_val = 0;
 	unsigned long       test_arg;
-	int pll5_div;
 	__ace_req_e 		mpara;
-	unsigned long rate;
 	switch (cmd){
 		case ACE_DEV_HWREQ:
 			test_arg = copy_from_user(&mpara, (__ace_req_e *)arg,
@@ -134,67 +239,15 @@ static long ace_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg
 			ae_interrupt_sta = 0;
 			return ae_interrupt_value;
 		case ACE_DEV_CLK_OPEN:
-			/* ace_moduleclk */
-			ace_moduleclk = clk_get(NULL,"ace");
-			ace_pll5_pclk = clk_get(NULL, "sdram_pll_p");
-			if (clk_set_parent(ace_moduleclk, ace_pll5_pclk)) {
-				printk("try to set parent of ace_moduleclk to ace_pll5clk failed!\n");
-			}
-			rate = clk_get_rate(ace_pll5_pclk);
-			pll5_div = DIV_ROUND_UP(rate, ACE_CLOCK_SPEED_LIMIT);
-			if(clk_set_rate(ace_moduleclk, rate / pll5_div)) {
-				printk("try to set ace_moduleclk rate failed!!!\n");
-				 goto out;
-			}
-			if(clk_reset(ace_moduleclk, 1)){
-				printk("try to reset ace_moduleclkfailed!!!\n");
-				 goto out;
-			}
-			if(clk_reset(ace_moduleclk, 0)){
-				printk("try to reset ace_moduleclkfailed!!!\n");
-				 goto out;
-			}
-			if (-1 == clk_enable(ace_moduleclk)) {
-				printk("ace_moduleclk failed; \n");
-				goto out;
-			}
-
-			/*geting dram clk for ace!*/
-			dram_aceclk = clk_get(NULL, "sdram_ace");
-
-			if (-1 == clk_enable(dram_aceclk)) {
-				printk("dram_moduleclk failed; \n");
-				 goto out1;
-			}
-			/* getting ahb clk for ace! */
-			ahb_aceclk = clk_get(NULL,"ahb_ace");
-			if (-1 == clk_enable(ahb_aceclk)) {
-				printk("ahb_aceclk failed; \n");
-				goto out2;
-			}
-			ref_count++;
-			goto out;
-			out2:
-				clk_disable(dram_aceclk);
-			out1:
-				clk_disable(ace_moduleclk);
-			out:
+			ret_val = ACE_ClkOpen();
+			if (ret_val == 0)
+				filp->private_data = (void *)((long)filp->private_data + 1);
 			break;
 		case ACE_DEV_CLK_CLOSE:
-			clk_disable(ace_moduleclk);
-			//释放ace_moduleclk时钟句柄
-			clk_put(ace_moduleclk);
-			//释放ace_pll5_pclk时钟句柄
-			clk_put(ace_pll5_pclk);
-
-			clk_disable(dram_aceclk);
-			//释放dram_aceclk时钟句柄
-			clk_put(dram_aceclk);
-
-			clk_disable(ahb_aceclk);
-			//释放ahb_aceclk时钟句柄
-			clk_put(ahb_aceclk);
-			ref_count--;
+			if ((long)filp->private_data > 0) {
+				filp->private_data = (void *)((long)filp->private_data - 1);
+				ACE_ClkClose();
+			}
 			break;
 		default:
 			break;
@@ -238,19 +291,12 @@ static int acedev_mmap(struct file *filp, struct vm_area_struct *vma)
 
 static int snd_sw_ace_suspend(struct platform_device *pdev,pm_message_t state)
 {
-	suspend_acerate = clk_get_rate(ace_moduleclk);
-	clk_disable(dram_aceclk);
-	//释放dram_aceclk时钟句柄
-	clk_put(dram_aceclk);
-
-	clk_disable(ace_moduleclk);
-	//释放ace_moduleclk时钟句柄
-	clk_put(ace_moduleclk);
-	clk_disable(ahb_aceclk);
-	//释放ahb_aceclk时钟句柄
-	clk_put(ahb_aceclk);
-	//释放ace_pll5_pclk时钟句柄
-	clk_put(ace_pll5_pclk);
+	mutex_lock(&ace_clk_lock);
+	if (ref_count) {
+		suspend_acerate = clk_get_rate(ace_moduleclk);
+		ace_clk_off();
+	}
+	mutex_unlock(&ace_clk_lock);
 
 	/*for clk test*/
 #ifdef ACE_DEBUG
@@ -266,54 +312,13 @@ static int snd_sw_ace_suspend(struct platform_device *pdev,pm_message_t state)
 
 static int snd_sw_ace_resume(struct platform_device *pdev)
 {
-	if(ref_count == 0){
-		return 0;
-	}
-	/* ace_moduleclk */
-	ace_moduleclk = clk_get(NULL,"ace");
-	ace_pll5_pclk = clk_get(NULL, "sdram_pll_p");
-	if (clk_set_parent(ace_moduleclk, ace_pll5_pclk)) {
-		printk("try to set parent of ace_moduleclk to ace_pll5clk failed!\n");
-		goto out;
-	}
-
-	if(clk_set_rate(ace_moduleclk, suspend_acerate)) {
-	   	printk("try to set ace_moduleclk rate failed!!!\n");
-	   	goto out;
-	}
-	if(clk_reset(ace_moduleclk, 1)){
-	   	printk("try to reset ace_moduleclkfailed!!!\n");
-	   	goto out;
-	}
-	if(clk_reset(ace_moduleclk, 0)){
-	   	printk("try to reset ace_moduleclkfailed!!!\n");
-	   	goto out;
-	}
-	if (-1 == clk_enable(ace_moduleclk)) {
-	   printk("ace_moduleclk failed; \n");
-	   goto out;
-	}
-
-	/*geting dram clk for ace!*/
-	dram_aceclk = clk_get(NULL, "sdram_ace");
-
-	if (-1 == clk_enable(dram_aceclk)) {
-	   	printk("dram_moduleclk failed; \n");
-	   	goto out1;
-	}
-	/* getting ahb clk for ace! */
-	ahb_aceclk = clk_get(NULL,"ahb_ace");
-	if (-1 == clk_enable(ahb_aceclk)) {
-	   	printk("ahb_aceclk failed; \n");
-	   	goto out2;
+	mutex_lock(&ace_clk_lock);
+	if (ref_count && ace_clk_on(suspend_acerate)) {
+		printk("[ace_drv] clocks not back after resume\n");
+		ref_count = 0;
 	}
-	goto out;
+	mutex_unlock(&ace_clk_lock);
 
-	out2:
-		clk_disable(dram_aceclk);
-	out1:
-		clk_disable(ace_moduleclk);
-	out:
 	return 0;
 }
 
@@ -62,5 +62,7 @@ __s32 ACE_Exit(void);
 s32 ACE_HwReq(__ace_module_type_e module, __ace_request_mode_e mode, __u32 timeout);
 __s32 ACE_HwRel(u32 hHWRes);
 __u32 ACE_GetClk(void);
+__s32 ACE_ClkOpen(void);
+__s32 ACE_ClkClose(void);
 
 #endif	/* __ACE_HAL_H__ */
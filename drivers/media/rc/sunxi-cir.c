@@ -29,14 +29,19 @@
 #define DRIVER_NAME                "sunxi-cir"
 #define DRIVER_VERS                "1.1"
 
-/* RC5 protocol has min pulse width, so sample=8us */
-/* JVC has minimum packet period so idle=30ms */
+/* RC5 protocol has min pulse width, so sample=8us.        */
+/* The idle threshold ends the packet and with it decoding: */
+/* 12ms is above every space inside a NEC/RC5/RC6/Sony      */
+/* frame, and keeps key-to-input under 20ms. JVC checks a   */
+/* 18ms trailer and needs idle_ms=20 (the old 30 works too) */
 #define IR_CLOCK_RATE                8000000      /* ir clock rate (Hz) */
 #define IR_SAMPLE_CLK_SEL        (0x0 << 0)   /* ir clk div (DIV = 64 << SEL) */
 #define IR_RXFILT_VAL                (1)          /* Pulse threshold = 8us */
-#define IR_RXIDLE_VAL                (29)         /* Idle threshold = 30ms */
-#define IR_DRIVER_TIMEOUT        (30)         /* Same as above (30ms)  */
+#define IR_IDLE_MS                (12)         /* default idle_ms */
+#define IR_IDLE_UNIT                (128)        /* idle threshold in 128 samples */
 #define IR_FIFO_SIZE                (16)         /* FIFO len is 16 bytes  */
+#define IR_FIFO_LEVEL                (12)         /* RAI at 12, 4 left = >32us */
+#define IR_BATCH_MAX                (128)        /* samples before a forced handle */
 #define IR_INVERT_INPUT                (1)          /* 1 - invert, 0 - not invert  */
 #define VALUE_MASK                0x80         /* Bit15 - value (pulse/space) */
 #define PERIOD_MASK                0x7f         /* Bits0:14 - sample duration  */
@@ -79,12 +84,27 @@
 
 #define SUCCESS                        (0)          /* for functions "return" op */
 
+static unsigned int idle_ms = IR_IDLE_MS;
+module_param(idle_ms, uint, 0444);
+MODULE_PARM_DESC(idle_ms, "silence that ends a packet, ms (4-250)");
+
+static char *keymap = RC_MAP_EMPTY;
+module_param(keymap, charp, 0444);
+MODULE_PARM_DESC(keymap, "rc keymap loaded at probe, e.g. rc-rc6-mce");
+
+/* Idle threshold register value: (val + 1) * 128 samples */
+static unsigned int ir_idle_val(void)
+{
+        return DIV_ROUND_UP(idle_ms * (CIR_SAMPLE_HZ / 1000), IR_IDLE_UNIT) - 1;
+}
+
 struct sunxi_ir_chip {
         struct rc_dev *rcdev;
         struct device *dev;
         void __iomem *gaddr;
         unsigned gpio_hdle;
         spinlock_t irq_lock;
+        unsigned batched;       /* stored, decoders not woken yet */
         struct clk *apb_ir_clk;
         struct clk *ir_clk;
 };
@@ -139,7 +159,7 @@ static int ir_setup(struct sunxi_ir_chip *ir_chip)
         /* Config IR Smaple Register */
         tmp = IR_SAMPLE_CLK_SEL;            /* Fsample divider */
         tmp |= (IR_RXFILT_VAL & 0x3f) << 2; /* Set Filter Threshold */
-        tmp |= (IR_RXIDLE_VAL & 0xff) << 8; /* Set Idle Threshold */
+        tmp |= (ir_idle_val() & 0xff) << 8; /* Set Idle Threshold */
         writel(tmp, ir_chip->gaddr + IR_SPLCFG_REG);
 
         /* Set up signal inversion */
@@ -148,9 +168,10 @@ static int ir_setup(struct sunxi_ir_chip *ir_chip)
         /* Clear All Rx Interrupt Status */
         writel(0xff, ir_chip->gaddr + IR_RXINTS_REG);
 
-        /* Enable rx interrupt & set RAL = FIFOsz/2; */
+        /* Enable rx interrupt & set RAL = IR_FIFO_LEVEL; the idle */
+        /* threshold ends the packet, which drains the rest       */
         tmp = RPEI_EN | RISI_EN | RAI_EN;
-        tmp |= ((IR_FIFO_SIZE >> 1) - 1) << 8;
+        tmp |= (IR_FIFO_LEVEL - 1) << 8;
         writel(tmp, ir_chip->gaddr + IR_RXINTE_REG);
 
         /* Enable IR Module */
@@ -207,23 +228,33 @@ static irqreturn_t sunxi_ir_irq(int irq, void *devid)
         /* Status bits 7:15 - number of fifo samples available */
         scnt = (intsta >> 8) & 0xff;
 
-        /* Read all data from FIFO buffer */
+        /* Read all data from FIFO buffer. The samples are only */
+        /* queued here, the decoders run once the packet ends   */
         init_ir_raw_event(&rawir);
         for (i = 0; i < scnt; i++) {
                 gval = (u8)(readl(ir_chip->gaddr + IR_RXDAT_REG));
                 rawir.pulse = ((gval & VALUE_MASK) != 0);
                 rawir.duration = (gval & PERIOD_MASK) * CIR_SAMPLE_PERIOD;
                 ir_raw_event_store_with_filter(ir_chip->rcdev, &rawir);
-                ir_raw_event_handle(ir_chip->rcdev);
         }
+        ir_chip->batched += scnt;
 
-        /* Set idle on END_OF_PACKET event */
-        if (intsta & IR_RXINTS_RXPE)
+        /* Set idle on END_OF_PACKET event and hand the frame over */
+        if (intsta & IR_RXINTS_RXPE) {
                 ir_raw_event_set_idle(ir_chip->rcdev, true);
+                ir_raw_event_handle(ir_chip->rcdev);
+                ir_chip->batched = 0;
+        } else if (ir_chip->batched >= IR_BATCH_MAX) {
+                /* a long repeat train, don't let rc-core's fifo fill */
+                ir_raw_event_handle(ir_chip->rcdev);
+                ir_chip->batched = 0;
+        }
 
         /* FIFO Overflow hardware event */
-        if (intsta & IR_RXINTS_RXOF)
+        if (intsta & IR_RXINTS_RXOF) {
                 ir_raw_event_reset(ir_chip->rcdev);
+                ir_chip->batched = 0;
+        }
 
         spin_unlock_irqrestore(&ir_chip->irq_lock, flags);
         return IRQ_HANDLED;
@@ -252,10 +283,11 @@ static int __devinit sunxi_ir_probe(struct platform_device *pdev)
         ir_chip->rcdev->input_name = DRIVER_NAME;
         ir_chip->rcdev->driver_type = RC_DRIVER_IR_RAW;
         ir_chip->rcdev->input_id.bustype = BUS_HOST;
-        ir_chip->rcdev->map_name = RC_MAP_EMPTY;
+        ir_chip->rcdev->map_name = keymap;
         ir_chip->rcdev->allowed_protos = RC_TYPE_ALL;
         ir_chip->rcdev->rx_resolution = CIR_SAMPLE_PERIOD;
-        ir_chip->rcdev->timeout = MS_TO_NS(IR_DRIVER_TIMEOUT);
+        idle_ms = clamp_t(unsigned int, idle_ms, 4, 250);
+        ir_chip->rcdev->timeout = MS_TO_NS(idle_ms);
         ir_chip->rcdev->change_protocol = change_protocol;
 
         err = rc_register_device(ir_chip->rcdev);
@@ -1,5 +1,5 @@
 /*
- * drivers/media/video/sun4i_csi/csi1/sun4i_csi_reg.c
+ * drivers/media/video/sun4i_csi/csi/sun4i_csi_reg.c
  *
  * (C) Copyright 2007-2012
  * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
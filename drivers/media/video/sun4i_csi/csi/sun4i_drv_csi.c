@@ -1,5 +1,5 @@
 /*
- * drivers/media/video/sun4i_csi/csi0/sun4i_drv_csi.c
+ * drivers/media/video/sun4i_csi/csi/sun4i_drv_csi.c
  *
  * (C) Copyright 2007-2012
  * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
@@ -48,7 +48,7 @@
 #include <linux/interrupt.h>
 #include <linux/i2c.h>
 #include <media/v4l2-subdev.h>
-#include <media/videobuf-dma-contig.h>
+#include <media/videobuf2-dma-contig.h>
 #include <linux/moduleparam.h>
 
 #include <plat/sys_config.h>
@@ -67,7 +67,6 @@
 	KERNEL_VERSION(CSI_MAJOR_VERSION, CSI_MINOR_VERSION, CSI_RELEASE)
 #define CSI_MODULE_NAME "sun4i_csi"
 
-//#define USE_DMA_CONTIG
 
 //#define AJUST_DRAM_PRIORITY
 #define REGS_pBASE					(0x01C00000)	 	      // register base addr
@@ -84,42 +83,69 @@
 #define MAX_WIDTH  (4096)
 #define MAX_HEIGHT (4096)
 
-static unsigned video_nr = 0;
-static unsigned first_flag = 0;
-
-
-static char ccm[I2C_NAME_SIZE] = "";
-static uint i2c_addr = 0xff;
-
-static char ccm_b[I2C_NAME_SIZE] = "";
-static uint i2c_addr_b = 0xff;
+#define CSI_NR_PORTS 2
 
+/* the base minor, csi1 takes the one after csi0 */
+static unsigned video_nr = 0;
 
-static struct ccm_config ccm_cfg[NUM_INPUTS] = {
-	{
-		.i2c_addr = 0xff,
+/* what differs between the two interfaces */
+static const struct csi_port {
+	const char *para;		/* sys_config section */
+	const char *ahb_clk;
+	const char *module_clk;
+	const char *dram_clk;
+	int isp;			/* wants the shared csi_isp clock */
+} csi_ports[CSI_NR_PORTS] = {
+	[0] = {
+		.para		= "csi0_para",
+		.ahb_clk	= "ahb_csi0",
+		.module_clk	= "csi0",
+		.dram_clk	= "sdram_csi0",
+		.isp		= 1,
 	},
-	{
-		.i2c_addr = 0xff,
+	[1] = {
+		.para		= "csi1_para",
+		.ahb_clk	= "ahb_csi1",
+		.module_clk	= "csi1",
+		.dram_clk	= "sdram_csi1",
 	},
 };
 
-module_param_string(ccm, ccm, sizeof(ccm), S_IRUGO|S_IWUSR);
-module_param(i2c_addr,uint, S_IRUGO|S_IWUSR);
-module_param_string(ccm_b, ccm_b, sizeof(ccm_b), S_IRUGO|S_IWUSR);
-module_param(i2c_addr_b,uint, S_IRUGO|S_IWUSR);
-
-static struct i2c_board_info  dev_sensor[] =  {
-	{
-		//I2C_BOARD_INFO(ccm, i2c_addr),
-		.platform_data	= NULL,
+/* sensor override at insmod, per interface */
+static struct csi_ccm_param {
+	char ccm[I2C_NAME_SIZE];
+	uint i2c_addr;
+	char ccm_b[I2C_NAME_SIZE];
+	uint i2c_addr_b;
+} ccm_param[CSI_NR_PORTS] = {
+	[0] = {
+		.i2c_addr	= 0xff,
+		.i2c_addr_b	= 0xff,
 	},
-	{
-		//I2C_BOARD_INFO(ccm, i2c_addr),
-		.platform_data	= NULL,
+	[1] = {
+		.i2c_addr	= 0xff,
+		.i2c_addr_b	= 0xff,
 	},
 };
 
+module_param_string(ccm, ccm_param[0].ccm, I2C_NAME_SIZE, S_IRUGO|S_IWUSR);
+module_param_named(i2c_addr, ccm_param[0].i2c_addr, uint, S_IRUGO|S_IWUSR);
+module_param_string(ccm_b, ccm_param[0].ccm_b, I2C_NAME_SIZE, S_IRUGO|S_IWUSR);
+module_param_named(i2c_addr_b, ccm_param[0].i2c_addr_b, uint, S_IRUGO|S_IWUSR);
+module_param_string(csi1_ccm, ccm_param[1].ccm, I2C_NAME_SIZE, S_IRUGO|S_IWUSR);
+module_param_named(csi1_i2c_addr, ccm_param[1].i2c_addr, uint, S_IRUGO|S_IWUSR);
+module_param_string(csi1_ccm_b, ccm_param[1].ccm_b, I2C_NAME_SIZE, S_IRUGO|S_IWUSR);
+module_param_named(csi1_i2c_addr_b, ccm_param[1].i2c_addr_b, uint, S_IRUGO|S_IWUSR);
+
+/*
+ * The csi_isp clock is one for both interfaces, the first user sets it
+ * up and the last one lets it go.
+ */
+static DEFINE_MUTEX(csi_isp_lock);
+static struct clk *csi_isp_clk;
+static int csi_isp_users;
+static int csi_isp_enabled;
+
 //ccm support format
 static struct csi_fmt formats[] = {
 	{
@@ -266,7 +292,19 @@ void static inline bsp_csi_set_buffer_address(struct csi_dev *dev,__csi_buf_t bu
     W(dev->regs+CSI_REG_BUF_0_A + (buf<<2), addr);
 }
 
-static inline void csi_set_addr(struct csi_dev *dev,struct csi_buffer *buffer)
+/* the address set the frame in progress is written to */
+static inline __csi_double_buf_t bsp_csi_double_buffer_cur(struct csi_dev *dev)
+{
+    return (R(dev->regs+CSI_REG_BUF_CTRL) & (0x1<<1)) ? CSI_BUF_B : CSI_BUF_A;
+}
+
+/*
+ * Program buffer into one of the ping-pong address sets. The hardware
+ * only reads a set when a frame starts, so the other set can be changed
+ * while a frame is written.
+ */
+static inline void csi_set_addr(struct csi_dev *dev,struct csi_buffer *buffer,
+				__csi_double_buf_t slot)
 {
 
 	struct csi_buffer *buf = buffer;
@@ -274,7 +312,7 @@ static inline void csi_set_addr(struct csi_dev *dev,struct csi_buffer *buffer)
 
 	csi_dbg(3,"buf ptr=%p\n",buf);
 
-	addr_org = videobuf_to_dma_contig((struct videobuf_buffer *)buf);
+	addr_org = vb2_dma_contig_plane_dma_addr(&buf->vb, 0);
 
 
 	if(dev->fmt->input_fmt==CSI_RAW){
@@ -320,26 +358,111 @@ static inline void csi_set_addr(struct csi_dev *dev,struct csi_buffer *buffer)
 		}
 	}
 
-	bsp_csi_set_buffer_address(dev, CSI_BUF_0_A, dev->csi_buf_addr.y);
-	bsp_csi_set_buffer_address(dev, CSI_BUF_0_B, dev->csi_buf_addr.y);
-	bsp_csi_set_buffer_address(dev, CSI_BUF_1_A, dev->csi_buf_addr.cb);
-	bsp_csi_set_buffer_address(dev, CSI_BUF_1_B, dev->csi_buf_addr.cb);
-	bsp_csi_set_buffer_address(dev, CSI_BUF_2_A, dev->csi_buf_addr.cr);
-	bsp_csi_set_buffer_address(dev, CSI_BUF_2_B, dev->csi_buf_addr.cr);
+	bsp_csi_set_buffer_address(dev, CSI_BUF_0_A + slot, dev->csi_buf_addr.y);
+	bsp_csi_set_buffer_address(dev, CSI_BUF_1_A + slot, dev->csi_buf_addr.cb);
+	bsp_csi_set_buffer_address(dev, CSI_BUF_2_A + slot, dev->csi_buf_addr.cr);
 
+	csi_dbg(3,"slot %c\n", slot == CSI_BUF_A ? 'A' : 'B');
 	csi_dbg(3,"csi_buf_addr_y=%x\n",  dev->csi_buf_addr.y);
 	csi_dbg(3,"csi_buf_addr_cb=%x\n", dev->csi_buf_addr.cb);
 	csi_dbg(3,"csi_buf_addr_cr=%x\n", dev->csi_buf_addr.cr);
 
 }
 
+static int csi_isp_get(struct csi_dev *dev)
+{
+	struct clk *src;
+	int ret = 0;
+
+	mutex_lock(&csi_isp_lock);
+	if (csi_isp_users++)
+		goto out;
+
+	src = clk_get(NULL,"video_pll0");
+	if (src == NULL) {
+		csi_err("get csi_isp source clk error!\n");
+		ret = -1;
+		goto err;
+	}
+
+	csi_isp_clk = clk_get(NULL,"csi_isp");
+	if (csi_isp_clk == NULL) {
+		csi_err("get csi_isp clk error!\n");
+		clk_put(src);
+		ret = -1;
+		goto err;
+	}
+
+	ret = clk_set_parent(csi_isp_clk, src);
+	clk_put(src);
+	if (ret == -1) {
+		csi_err(" csi_isp set parent failed \n");
+		goto err_put;
+	}
+
+	ret = clk_set_rate(csi_isp_clk, CSI_ISP_RATE);
+	if (ret == -1) {
+		csi_err("set csi_isp clock error\n");
+		goto err_put;
+	}
+	goto out;
+
+err_put:
+	clk_put(csi_isp_clk);
+	csi_isp_clk = NULL;
+err:
+	csi_isp_users--;
+out:
+	if (!ret)
+		dev->csi_isp_clk = csi_isp_clk;
+	mutex_unlock(&csi_isp_lock);
+	return ret;
+}
+
+static void csi_isp_put(struct csi_dev *dev)
+{
+	if (!dev->csi_isp_clk)
+		return;
+
+	mutex_lock(&csi_isp_lock);
+	if (!--csi_isp_users) {
+		clk_put(csi_isp_clk);
+		csi_isp_clk = NULL;
+	}
+	mutex_unlock(&csi_isp_lock);
+	dev->csi_isp_clk = NULL;
+}
+
+/* the clock runs while either interface has it enabled */
+static void csi_isp_enable(struct csi_dev *dev)
+{
+	if (!dev->csi_isp_clk)
+		return;
+
+	mutex_lock(&csi_isp_lock);
+	if (!csi_isp_enabled++)
+		clk_enable(csi_isp_clk);
+	mutex_unlock(&csi_isp_lock);
+}
+
+static void csi_isp_disable(struct csi_dev *dev)
+{
+	if (!dev->csi_isp_clk)
+		return;
+
+	mutex_lock(&csi_isp_lock);
+	if (!--csi_isp_enabled)
+		clk_disable(csi_isp_clk);
+	mutex_unlock(&csi_isp_lock);
+}
+
 static int csi_clk_get(struct csi_dev *dev)
 {
 	int ret;
 
-	dev->csi_ahb_clk=clk_get(NULL, "ahb_csi0");
+	dev->csi_ahb_clk=clk_get(NULL, csi_ports[dev->id].ahb_clk);
 	if (dev->csi_ahb_clk == NULL) {
-       	csi_err("get csi0 ahb clk error!\n");
+       	csi_err("get csi%d ahb clk error!\n", dev->id);
 		return -1;
     }
 
@@ -347,7 +470,7 @@ static int csi_clk_get(struct csi_dev *dev)
 	{
 		dev->csi_clk_src=clk_get(NULL,"hosc");
 		if (dev->csi_clk_src == NULL) {
-       	csi_err("get csi0 hosc source clk error!\n");
+       	csi_err("get csi%d hosc source clk error!\n", dev->id);
 			return -1;
     }
   }
@@ -355,14 +478,14 @@ static int csi_clk_get(struct csi_dev *dev)
   {
 		dev->csi_clk_src=clk_get(NULL,"video_pll1");
 		if (dev->csi_clk_src == NULL) {
-       	csi_err("get csi0 video pll1 source clk error!\n");
+       	csi_err("get csi%d video pll1 source clk error!\n", dev->id);
 			return -1;
     }
 	}
 
-	dev->csi_module_clk=clk_get(NULL,"csi0");
+	dev->csi_module_clk=clk_get(NULL, csi_ports[dev->id].module_clk);
 	if(dev->csi_module_clk == NULL) {
-       	csi_err("get csi0 module clk error!\n");
+       	csi_err("get csi%d module clk error!\n", dev->id);
 		return -1;
     }
 
@@ -376,39 +499,16 @@ static int csi_clk_get(struct csi_dev *dev)
 
 	ret = clk_set_rate(dev->csi_module_clk,dev->ccm_info->mclk);
 	if (ret == -1) {
-        csi_err("set csi0 module clock error\n");
+        csi_err("set csi%d module clock error\n", dev->id);
 		return -1;
    	}
 
-	dev->csi_isp_src_clk=clk_get(NULL,"video_pll0");
-	if (dev->csi_isp_src_clk == NULL) {
-       	csi_err("get csi_isp source clk error!\n");
-		return -1;
-    }
-
-  dev->csi_isp_clk=clk_get(NULL,"csi_isp");
-	if(dev->csi_isp_clk == NULL) {
-       	csi_err("get csi_isp clk error!\n");
-		return -1;
-    }
-
-	ret = clk_set_parent(dev->csi_isp_clk, dev->csi_isp_src_clk);
-	if (ret == -1) {
-        csi_err(" csi_isp set parent failed \n");
-	    return -1;
-    }
-
-	clk_put(dev->csi_isp_src_clk);
-
-  ret = clk_set_rate(dev->csi_isp_clk, CSI_ISP_RATE);
-	if (ret == -1) {
-        csi_err("set csi_isp clock error\n");
+	if (csi_ports[dev->id].isp && csi_isp_get(dev))
 		return -1;
-   	}
 
-	dev->csi_dram_clk = clk_get(NULL, "sdram_csi0");
+	dev->csi_dram_clk = clk_get(NULL, csi_ports[dev->id].dram_clk);
 	if (dev->csi_dram_clk == NULL) {
-       	csi_err("get csi0 dram clk error!\n");
+       	csi_err("get csi%d dram clk error!\n", dev->id);
 		return -1;
     }
 
@@ -420,7 +520,7 @@ static int csi_clk_out_set(struct csi_dev *dev)
 	int ret;
 	ret = clk_set_rate(dev->csi_module_clk, dev->ccm_info->mclk);
 	if (ret == -1) {
-		csi_err("set csi0 module clock error\n");
+		csi_err("set csi%d module clock error\n", dev->id);
 		return -1;
 	}
 
@@ -441,7 +541,7 @@ static int csi_clk_enable(struct csi_dev *dev)
 {
 	clk_enable(dev->csi_ahb_clk);
 //	clk_enable(dev->csi_module_clk);
-	clk_enable(dev->csi_isp_clk);
+	csi_isp_enable(dev);
 	clk_enable(dev->csi_dram_clk);
 
 	return 0;
@@ -451,7 +551,7 @@ static int csi_clk_disable(struct csi_dev *dev)
 {
 	clk_disable(dev->csi_ahb_clk);
 //	clk_disable(dev->csi_module_clk);
-	clk_disable(dev->csi_isp_clk);
+	csi_isp_disable(dev);
 	clk_disable(dev->csi_dram_clk);
 
 	return 0;
@@ -468,6 +568,8 @@ static int csi_clk_release(struct csi_dev *dev)
 	clk_put(dev->csi_dram_clk);
     dev->csi_dram_clk = NULL;
 
+	csi_isp_put(dev);
+
 	return 0;
 }
 
@@ -484,7 +586,6 @@ static void inline csi_start_generating(struct csi_dev *dev)
 
 static void inline csi_stop_generating(struct csi_dev *dev)
 {
-	 first_flag = 0;
 	 clear_bit(0, &dev->generating);
 	 return;
 }
@@ -510,63 +611,54 @@ void static inline bsp_csi_int_clear_status(struct csi_dev *dev,__csi_int_t inte
 
 static irqreturn_t csi_isr(int irq, void *priv)
 {
-	struct csi_buffer *buf;
+	struct csi_buffer *buf, *next;
 	struct csi_dev *dev = (struct csi_dev *)priv;
 	struct csi_dmaqueue *dma_q = &dev->vidq;
-//	__csi_int_status_t * status;
+	__csi_double_buf_t done;
+	u32 status;
 
 	csi_dbg(3,"csi_isr\n");
-	bsp_csi_int_disable(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
+	status = R(dev->regs+CSI_REG_INT_STATUS) &
+		 (CSI_INT_FRAME_DONE | CSI_INT_VSYNC_TRIG);
+	bsp_csi_int_clear_status(dev, status);
 
 	spin_lock(&dev->slock);
 
-	if (first_flag == 0) {
-		first_flag=1;
-		goto set_next_addr;
-	}
-
-	if (list_empty(&dma_q->active)) {
-		csi_err("No active queue to serve\n");
-		goto unlock;
-	}
-
-	buf = list_entry(dma_q->active.next,struct csi_buffer, vb.queue);
-	csi_dbg(3,"buf ptr=%p\n",buf);
-
-	/* Nobody is waiting on this buffer*/
-
-	if (!waitqueue_active(&buf->vb.done)) {
-		csi_dbg(1," Nobody is waiting on this buffer,buf = 0x%p\n",buf);
-	}
-
-	list_del(&buf->vb.queue);
-
-	do_gettimeofday(&buf->vb.ts);
-	buf->vb.field_count++;
-
-	dev->ms += jiffies_to_msecs(jiffies - dev->jiffies);
-	dev->jiffies = jiffies;
-
-	buf->vb.state = VIDEOBUF_DONE;
-	wake_up(&buf->vb.done);
-
-	//judge if the frame queue has been written to the last
-	if (list_empty(&dma_q->active)) {
-		csi_dbg(1,"No more free frame\n");
-		goto unlock;
-	}
+	/*
+	 * A frame done and the vsync of the next frame can both be pending
+	 * when the irq was late, the done frame goes with the older vsync.
+	 */
+	if (status & CSI_INT_FRAME_DONE) {
+		/* the hardware has already moved on to the other set */
+		done = bsp_csi_double_buffer_cur(dev) == CSI_BUF_A ?
+		       CSI_BUF_B : CSI_BUF_A;
+		buf = dev->slot[done];
+
+		if (buf && !list_empty(&dma_q->active)) {
+			/* a frame of latency to refill the done set */
+			next = list_entry(dma_q->active.next,struct csi_buffer, list);
+			list_del(&next->list);
+			dev->slot[done] = next;
+			csi_set_addr(dev, next, done);
+
+			csi_dbg(3,"buf ptr=%p\n",buf);
+			buf->vb.v4l2_buf.timestamp = dev->vsync_ts;
+			buf->vb.v4l2_buf.sequence = dma_q->frame;
+			vb2_buffer_done(&buf->vb, VB2_BUF_STATE_DONE);
+		} else {
+			/* keep the buffer in the set, the hardware overwrites it */
+			dev->frames_dropped++;
+			csi_dbg(1,"No free frame, frame %d dropped\n", dma_q->frame);
+		}
+		dma_q->frame++;
 
-	if ((&dma_q->active) == dma_q->active.next->next) {
-		csi_dbg(1,"No more free frame on next time\n");
-		goto unlock;
+		dev->ms += jiffies_to_msecs(jiffies - dev->jiffies);
+		dev->jiffies = jiffies;
 	}
 
+	if (status & CSI_INT_VSYNC_TRIG)
+		do_gettimeofday(&dev->vsync_ts);
 
-set_next_addr:
-	buf = list_entry(dma_q->active.next->next,struct csi_buffer, vb.queue);
-	csi_set_addr(dev,buf);
-
-unlock:
 	spin_unlock(&dev->slock);
 //	bsp_csi_int_get_status(dev, status);
 //	if((status->buf_0_overflow) || (status->buf_1_overflow) || (status->buf_2_overflow))
@@ -582,20 +674,15 @@ unlock:
 //		bsp_csi_int_clear_status(dev,CSI_INT_HBLANK_OVERFLOW);
 //		csi_err("hblank overflow\n");
 //	}
-	bsp_csi_int_clear_status(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-	bsp_csi_int_enable(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-
 	return IRQ_HANDLED;
 }
 
 /*
  * Videobuf operations
  */
-static int buffer_setup(struct videobuf_queue *vq, unsigned int *count, unsigned int *size)
+static unsigned int csi_frame_size(struct csi_dev *dev)
 {
-	struct csi_dev *dev = vq->priv_data;
-
-	csi_dbg(1,"buffer_setup\n");
+	unsigned int size;
 
 	if(dev->fmt->input_fmt == CSI_RAW)
 	{
@@ -604,20 +691,16 @@ static int buffer_setup(struct videobuf_queue *vq, unsigned int *count, unsigned
 			case	V4L2_PIX_FMT_YVYU:
 			case	V4L2_PIX_FMT_UYVY:
 			case	V4L2_PIX_FMT_VYUY:
-				*size = dev->width * dev->height * 2;
+				size = dev->width * dev->height * 2;
 				break;
 			default:
-				*size = dev->width * dev->height;
+				size = dev->width * dev->height;
 				break;
 		}
 	}
 	else if(dev->fmt->input_fmt == CSI_BAYER)
 	{
-		*size = dev->width * dev->height;
-	}
-	else if(dev->fmt->input_fmt == CSI_CCIR656)
-	{
-		//TODO
+		size = dev->width * dev->height;
 	}
 	else if(dev->fmt->input_fmt == CSI_YUV422)
 	{
@@ -625,62 +708,66 @@ static int buffer_setup(struct videobuf_queue *vq, unsigned int *count, unsigned
 			case 	CSI_PLANAR_YUV422:
 			case	CSI_UV_CB_YUV422:
 			case 	CSI_MB_YUV422:
-				*size = dev->width * dev->height * 2;
+				size = dev->width * dev->height * 2;
 				break;
 
 			case CSI_PLANAR_YUV420:
 			case CSI_UV_CB_YUV420:
 			case CSI_MB_YUV420:
-				*size = dev->width * dev->height * 3/2;
+				size = dev->width * dev->height * 3/2;
 				break;
 
 			default:
-				*size = dev->width * dev->height * 2;
+				size = dev->width * dev->height * 2;
 				break;
 		}
 	}
 	else
 	{
-		*size = dev->width * dev->height * 2;
+		//TODO: CSI_CCIR656
+		size = dev->width * dev->height * 2;
 	}
 
-	dev->frame_size = *size;
+	return size;
+}
 
-	if (*count < 3) {
-		*count = 3;
+static int queue_setup(struct vb2_queue *vq, const struct v4l2_format *fmt,
+		       unsigned int *nbuffers, unsigned int *nplanes,
+		       unsigned int sizes[], void *alloc_ctxs[])
+{
+	struct csi_dev *dev = vb2_get_drv_priv(vq);
+	unsigned int size;
+
+	csi_dbg(1,"queue_setup\n");
+
+	size = csi_frame_size(dev);
+	dev->frame_size = size;
+
+	if (*nbuffers < 3) {
+		*nbuffers = 3;
 		csi_err("buffer count is invalid, set to 3\n");
-	} else if(*count > 5) {
-		*count = 5;
+	} else if(*nbuffers > 5) {
+		*nbuffers = 5;
 		csi_err("buffer count is invalid, set to 5\n");
 	}
 
-	while (*size * *count > CSI_MAX_FRAME_MEM) {
-		(*count)--;
+	while (size * *nbuffers > CSI_MAX_FRAME_MEM) {
+		(*nbuffers)--;
 	}
-	csi_print("%s, buffer count=%d, size=%d\n", __func__,*count, *size);
 
-	return 0;
-}
+	*nplanes = 1;
+	sizes[0] = size;
+	alloc_ctxs[0] = dev->alloc_ctx;
 
-static void free_buffer(struct videobuf_queue *vq, struct csi_buffer *buf)
-{
-	csi_dbg(1,"%s, state: %i\n", __func__, buf->vb.state);
+	csi_print("%s, buffer count=%d, size=%d\n", __func__,*nbuffers, size);
 
-#ifdef USE_DMA_CONTIG
-	videobuf_dma_contig_free(vq, &buf->vb);
-#endif
-
-	csi_dbg(1,"free_buffer: freed\n");
-
-	buf->vb.state = VIDEOBUF_NEEDS_INIT;
+	return 0;
 }
 
-static int buffer_prepare(struct videobuf_queue *vq, struct videobuf_buffer *vb,
-						  enum v4l2_field field)
+static int buffer_prepare(struct vb2_buffer *vb)
 {
-	struct csi_dev *dev = vq->priv_data;
+	struct csi_dev *dev = vb2_get_drv_priv(vb->vb2_queue);
 	struct csi_buffer *buf = container_of(vb, struct csi_buffer, vb);
-	int rc;
 
 	csi_dbg(1,"buffer_prepare\n");
 
@@ -691,61 +778,102 @@ static int buffer_prepare(struct videobuf_queue *vq, struct videobuf_buffer *vb,
 		return -EINVAL;
 	}
 
-	buf->vb.size = dev->frame_size;
-
-	if (0 != buf->vb.baddr && buf->vb.bsize < buf->vb.size) {
+	if (vb2_plane_size(vb, 0) < dev->frame_size) {
+		csi_err("buffer too small (%lu < %u)\n",
+			vb2_plane_size(vb, 0), dev->frame_size);
 		return -EINVAL;
 	}
 
-	/* These properties only change when queue is idle, see s_fmt */
-	buf->fmt       = dev->fmt;
-	buf->vb.width  = dev->width;
-	buf->vb.height = dev->height;
-	buf->vb.field  = field;
-
-	if (VIDEOBUF_NEEDS_INIT == buf->vb.state) {
-		rc = videobuf_iolock(vq, &buf->vb, NULL);
-		if (rc < 0) {
-			goto fail;
-		}
-	}
+	vb2_set_plane_payload(vb, 0, dev->frame_size);
+	vb->v4l2_buf.field = dev->field;
 
-	vb->boff= videobuf_to_dma_contig(vb);
-	buf->vb.state = VIDEOBUF_PREPARED;
+	/* These properties only change when queue is idle, see s_fmt */
+	buf->fmt = dev->fmt;
 
 	return 0;
-
-fail:
-	free_buffer(vq, buf);
-	return rc;
 }
 
-static void buffer_queue(struct videobuf_queue *vq, struct videobuf_buffer *vb)
+static void buffer_queue(struct vb2_buffer *vb)
 {
-	struct csi_dev *dev = vq->priv_data;
+	struct csi_dev *dev = vb2_get_drv_priv(vb->vb2_queue);
 	struct csi_buffer *buf = container_of(vb, struct csi_buffer, vb);
 	struct csi_dmaqueue *vidq = &dev->vidq;
+	unsigned long flags;
 
 	csi_dbg(1,"buffer_queue\n");
-	buf->vb.state = VIDEOBUF_QUEUED;
-	list_add_tail(&buf->vb.queue, &vidq->active);
+	spin_lock_irqsave(&dev->slock, flags);
+	list_add_tail(&buf->list, &vidq->active);
+	spin_unlock_irqrestore(&dev->slock, flags);
+}
+
+static int start_streaming(struct vb2_queue *vq, unsigned int count)
+{
+	struct csi_dev *dev = vb2_get_drv_priv(vq);
+	struct csi_dmaqueue *dma_q = &dev->vidq;
+	struct csi_buffer *buf;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dev->slock, flags);
+	/* both address sets need a buffer */
+	if (dma_q->active.next == dma_q->active.prev) {
+		spin_unlock_irqrestore(&dev->slock, flags);
+		csi_err("two buffers must be queued before stream on\n");
+		return -EINVAL;
+	}
+
+	for (i = CSI_BUF_A; i <= CSI_BUF_B; i++) {
+		buf = list_entry(dma_q->active.next,struct csi_buffer, list);
+		list_del(&buf->list);
+		dev->slot[i] = buf;
+		csi_set_addr(dev, buf, i);
+	}
+	dev->frames_dropped = 0;
+	do_gettimeofday(&dev->vsync_ts);
+	spin_unlock_irqrestore(&dev->slock, flags);
+
+	bsp_csi_double_buffer_enable(dev);
+	bsp_csi_int_clear_status(dev,CSI_INT_FRAME_DONE | CSI_INT_VSYNC_TRIG);
+	bsp_csi_int_enable(dev, CSI_INT_FRAME_DONE | CSI_INT_VSYNC_TRIG);
+	bsp_csi_capture_video_start(dev);
+
+	csi_start_generating(dev);
+	return 0;
 }
 
-static void buffer_release(struct videobuf_queue *vq,
-			   struct videobuf_buffer *vb)
+static int stop_streaming(struct vb2_queue *vq)
 {
-	struct csi_buffer *buf  = container_of(vb, struct csi_buffer, vb);
+	struct csi_dev *dev = vb2_get_drv_priv(vq);
+	struct csi_dmaqueue *dma_q = &dev->vidq;
+	unsigned long flags;
+
+	csi_stop_generating(dev);
 
-	csi_dbg(1,"buffer_release\n");
+	bsp_csi_int_disable(dev,CSI_INT_FRAME_DONE | CSI_INT_VSYNC_TRIG);
+	bsp_csi_int_clear_status(dev,CSI_INT_FRAME_DONE | CSI_INT_VSYNC_TRIG);
+	bsp_csi_capture_video_stop(dev);
+	bsp_csi_double_buffer_disable(dev);
+
+	if (dev->frames_dropped)
+		csi_print("%u of %d frames dropped, no buffer queued\n",
+			  dev->frames_dropped, dma_q->frame);
 
-	free_buffer(vq, buf);
+	/* videobuf2 takes the buffers back itself */
+	spin_lock_irqsave(&dev->slock, flags);
+	INIT_LIST_HEAD(&dma_q->active);
+	dev->slot[CSI_BUF_A] = NULL;
+	dev->slot[CSI_BUF_B] = NULL;
+	spin_unlock_irqrestore(&dev->slock, flags);
+
+	return 0;
 }
 
-static struct videobuf_queue_ops csi_video_qops = {
-	.buf_setup    = buffer_setup,
-	.buf_prepare  = buffer_prepare,
-	.buf_queue    = buffer_queue,
-	.buf_release  = buffer_release,
+static struct vb2_ops csi_video_qops = {
+	.queue_setup		= queue_setup,
+	.buf_prepare		= buffer_prepare,
+	.buf_queue		= buffer_queue,
+	.start_streaming	= start_streaming,
+	.stop_streaming		= stop_streaming,
 };
 
 /*
@@ -790,7 +918,7 @@ static int vidioc_g_fmt_vid_cap(struct file *file, void *priv,
 
 	f->fmt.pix.width        = dev->width;
 	f->fmt.pix.height       = dev->height;
-	f->fmt.pix.field        = dev->vb_vidq.field;
+	f->fmt.pix.field        = dev->field;
 	f->fmt.pix.pixelformat  = dev->fmt->fourcc;
 	f->fmt.pix.bytesperline = (f->fmt.pix.width * dev->fmt->depth) >> 3;
 	f->fmt.pix.sizeimage    = f->fmt.pix.height * f->fmt.pix.bytesperline;
@@ -848,7 +976,6 @@ static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
 					struct v4l2_format *f)
 {
 	struct csi_dev *dev = video_drvdata(file);
-	struct videobuf_queue *q = &dev->vb_vidq;
 	int ret,width_buf,height_buf,width_len;
 	struct v4l2_mbus_framefmt ccm_fmt;//linux-3.0
 	struct csi_fmt *csi_fmt;
@@ -860,7 +987,10 @@ static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
 		return -EBUSY;
 	}
 
-	mutex_lock(&q->vb_lock);
+	if (vb2_is_busy(&dev->vb_vidq)) {
+		csi_err("%s buffers are allocated\n", __func__);
+		return -EBUSY;
+	}
 
 	ret = vidioc_try_fmt_vid_cap(file, priv, f);
 	if (ret < 0) {
@@ -887,7 +1017,7 @@ static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
 
 	//save the current format info
 	dev->fmt = csi_fmt;
-	dev->vb_vidq.field = f->fmt.pix.field;
+	dev->field = f->fmt.pix.field;
 	dev->width  = f->fmt.pix.width;
 	dev->height = f->fmt.pix.height;
 
@@ -955,7 +1085,6 @@ static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
 
 	ret = 0;
 out:
-	mutex_unlock(&q->vb_lock);
 	return ret;
 }
 
@@ -966,47 +1095,43 @@ static int vidioc_reqbufs(struct file *file, void *priv,
 
 	csi_dbg(0,"vidioc_reqbufs\n");
 
-	return videobuf_reqbufs(&dev->vb_vidq, p);
+	return vb2_reqbufs(&dev->vb_vidq, p);
 }
 
 static int vidioc_querybuf(struct file *file, void *priv, struct v4l2_buffer *p)
 {
 	struct csi_dev *dev = video_drvdata(file);
 
-	return videobuf_querybuf(&dev->vb_vidq, p);
+	return vb2_querybuf(&dev->vb_vidq, p);
 }
 
 static int vidioc_qbuf(struct file *file, void *priv, struct v4l2_buffer *p)
 {
 	struct csi_dev *dev = video_drvdata(file);
 
-	return videobuf_qbuf(&dev->vb_vidq, p);
+	return vb2_qbuf(&dev->vb_vidq, p);
 }
 
 static int vidioc_dqbuf(struct file *file, void *priv, struct v4l2_buffer *p)
 {
 	struct csi_dev *dev = video_drvdata(file);
 
-	return videobuf_dqbuf(&dev->vb_vidq, p, file->f_flags & O_NONBLOCK);
+	return vb2_dqbuf(&dev->vb_vidq, p, file->f_flags & O_NONBLOCK);
 }
 
-#ifdef CONFIG_VIDEO_V4L1_COMPAT
-static int vidiocgmbuf(struct file *file, void *priv, struct video_mbuf *mbuf)
+static int vidioc_expbuf(struct file *file, void *priv,
+			 struct v4l2_exportbuffer *e)
 {
 	struct csi_dev *dev = video_drvdata(file);
 
-	return videobuf_cgmbuf(&dev->vb_vidq, mbuf, 8);
+	return vb2_expbuf(&dev->vb_vidq, e);
 }
-#endif
 
 
 static int vidioc_streamon(struct file *file, void *priv, enum v4l2_buf_type i)
 {
 	struct csi_dev *dev = video_drvdata(file);
 	struct csi_dmaqueue *dma_q = &dev->vidq;
-	struct csi_buffer *buf;
-
-	int ret;
 
 	csi_dbg(0,"video stream on\n");
 	if (i != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
@@ -1025,20 +1150,7 @@ static int vidioc_streamon(struct file *file, void *priv, enum v4l2_buf_type i)
 	dma_q->frame = 0;
 	dma_q->ini_jiffies = jiffies;
 
-	ret = videobuf_streamon(&dev->vb_vidq);
-	if (ret) {
-		return ret;
-	}
-
-	buf = list_entry(dma_q->active.next,struct csi_buffer, vb.queue);
-	csi_set_addr(dev,buf);
-
-	bsp_csi_int_clear_status(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-	bsp_csi_int_enable(dev, CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-	bsp_csi_capture_video_start(dev);
-
-	csi_start_generating(dev);
-	return 0;
+	return vb2_streamon(&dev->vb_vidq, i);
 }
 
 
@@ -1050,13 +1162,15 @@ static int vidioc_streamoff(struct file *file, void *priv, enum v4l2_buf_type i)
 
 	csi_dbg(0,"video stream off\n");
 
+	if (i != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+		return -EINVAL;
+	}
+
 	if (!csi_is_generating(dev)) {
 		csi_err("stream has been already off\n");
 		return 0;
 	}
 
-	csi_stop_generating(dev);
-
 	/* Resets frame counters */
 	dev->ms = 0;
 	dev->jiffies = jiffies;
@@ -1064,22 +1178,10 @@ static int vidioc_streamoff(struct file *file, void *priv, enum v4l2_buf_type i)
 	dma_q->frame = 0;
 	dma_q->ini_jiffies = jiffies;
 
-	bsp_csi_int_disable(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-	bsp_csi_int_clear_status(dev,CSI_INT_FRAME_DONE);//CSI_INT_FRAME_DONE
-	bsp_csi_capture_video_stop(dev);
-
-	if (i != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
-		return -EINVAL;
-	}
-
-	ret = videobuf_streamoff(&dev->vb_vidq);
+	/* stops the hardware through stop_streaming() */
+	ret = vb2_streamoff(&dev->vb_vidq, i);
 	if (ret!=0) {
-		csi_err("videobu_streamoff error!\n");
-		return ret;
-	}
-
-	if (ret!=0) {
-		csi_err("videobuf_mmap_free error!\n");
+		csi_err("vb2_streamoff error!\n");
 		return ret;
 	}
 
@@ -1087,6 +1189,15 @@ static int vidioc_streamoff(struct file *file, void *priv, enum v4l2_buf_type i)
 }
 
 
+static int vidioc_log_status(struct file *file, void *priv)
+{
+	struct csi_dev *dev = video_drvdata(file);
+
+	csi_print("frames %d, dropped %u (no buffer queued)\n",
+		  dev->vidq.frame, dev->frames_dropped);
+	return 0;
+}
+
 static int vidioc_enum_input(struct file *file, void *priv,
 				struct v4l2_input *inp)
 {
@@ -1310,8 +1421,8 @@ static ssize_t csi_read(struct file *file, char __user *data, size_t count, loff
 
 //	csi_start_generating(dev);
 	if(csi_is_generating(dev)) {
-		return videobuf_read_stream(&dev->vb_vidq, data, count, ppos, 0,
-					file->f_flags & O_NONBLOCK);
+		return vb2_read(&dev->vb_vidq, data, count, ppos,
+				file->f_flags & O_NONBLOCK);
 	} else {
 		csi_err("csi is not generating!\n");
 		return -EINVAL;
@@ -1321,11 +1432,11 @@ static ssize_t csi_read(struct file *file, char __user *data, size_t count, loff
 static unsigned int csi_poll(struct file *file, struct poll_table_struct *wait)
 {
 	struct csi_dev *dev = video_drvdata(file);
-	struct videobuf_queue *q = &dev->vb_vidq;
+	struct vb2_queue *q = &dev->vb_vidq;
 
 //	csi_start_generating(dev);
 	if(csi_is_generating(dev)) {
-		return videobuf_poll_stream(file, q, wait);
+		return vb2_poll(q, file, wait);
 	} else {
 		csi_err("csi is not generating!\n");
 		return -EINVAL;
@@ -1428,8 +1539,8 @@ static int csi_close(struct file *file)
 	csi_reset_enable(dev);
 
 
-	videobuf_stop(&dev->vb_vidq);
-	videobuf_mmap_free(&dev->vb_vidq);
+	/* stops streaming and frees the buffers not exported elsewhere */
+	vb2_queue_release(&dev->vb_vidq);
 
 	dev->opened=0;
 	csi_stop_generating(dev);
@@ -1464,7 +1575,7 @@ static int csi_mmap(struct file *file, struct vm_area_struct *vma)
 
 	csi_dbg(0,"mmap called, vma=0x%08lx\n", (unsigned long)vma);
 
-	ret = videobuf_mmap_mapper(&dev->vb_vidq, vma);
+	ret = vb2_mmap(&dev->vb_vidq, vma);
 
 	csi_dbg(0,"vma start=0x%08lx, size=%ld, ret=%d\n",
 		(unsigned long)vma->vm_start,
@@ -1493,6 +1604,8 @@ static const struct v4l2_ioctl_ops csi_ioctl_ops = {
 	.vidioc_querybuf          = vidioc_querybuf,
 	.vidioc_qbuf              = vidioc_qbuf,
 	.vidioc_dqbuf             = vidioc_dqbuf,
+	.vidioc_expbuf            = vidioc_expbuf,
+	.vidioc_log_status        = vidioc_log_status,
 	.vidioc_enum_input        = vidioc_enum_input,
 	.vidioc_g_input           = vidioc_g_input,
 	.vidioc_s_input           = vidioc_s_input,
@@ -1504,9 +1617,6 @@ static const struct v4l2_ioctl_ops csi_ioctl_ops = {
 	.vidioc_g_parm		 			  = vidioc_g_parm,
 	.vidioc_s_parm		  			= vidioc_s_parm,
 
-#ifdef CONFIG_VIDEO_V4L1_COMPAT
-	.vidiocgmbuf              = vidiocgmbuf,
-#endif
 };
 
 static struct video_device csi_template = {
@@ -1521,95 +1631,95 @@ static int fetch_config(struct csi_dev *dev)
 	int input_num,ret;
 
 	/* fetch device quatity issue */
-	ret = script_parser_fetch("csi0_para","csi_dev_qty", &dev->dev_qty , sizeof(int));
+	ret = script_parser_fetch(csi_ports[dev->id].para,"csi_dev_qty", &dev->dev_qty , sizeof(int));
 	if (ret) {
 		csi_err("fetch csi_dev_qty from sys_config failed\n");
 	}
 
 	/* fetch standby mode */
-	ret = script_parser_fetch("csi0_para","csi_stby_mode", &dev->stby_mode , sizeof(int));
+	ret = script_parser_fetch(csi_ports[dev->id].para,"csi_stby_mode", &dev->stby_mode , sizeof(int));
 	if (ret) {
 		csi_err("fetch csi_stby_mode from sys_config failed\n");
 	}
 
 	for(input_num=0; input_num<dev->dev_qty; input_num++)
 	{
-		dev->ccm_cfg[input_num] = &ccm_cfg[input_num];
+		dev->ccm_cfg[input_num] = &dev->ccm_data[input_num];
 		csi_dbg(0,"dev->ccm_cfg[%d] = %p\n",input_num,dev->ccm_cfg[input_num]);
 	}
 
 	if(dev->dev_qty > 0)
 	{
-		dev->ccm_cfg[0]->i2c_addr = i2c_addr;
-		strcpy(dev->ccm_cfg[0]->ccm,ccm);
+		dev->ccm_cfg[0]->i2c_addr = ccm_param[dev->id].i2c_addr;
+		strcpy(dev->ccm_cfg[0]->ccm,ccm_param[dev->id].ccm);
 
 		/* fetch i2c and module name*/
-		ret = script_parser_fetch("csi0_para","csi_twi_id", &dev->ccm_cfg[0]->twi_id , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_twi_id", &dev->ccm_cfg[0]->twi_id , sizeof(int));
 		if (ret) {
 		}
 
 		ret = strcmp(dev->ccm_cfg[0]->ccm,"");
 		if((dev->ccm_cfg[0]->i2c_addr == 0xff) && (ret == 0))	//when insmod without parm
 		{
-			ret = script_parser_fetch("csi0_para","csi_twi_addr", &dev->ccm_cfg[0]->i2c_addr , sizeof(int));
+			ret = script_parser_fetch(csi_ports[dev->id].para,"csi_twi_addr", &dev->ccm_cfg[0]->i2c_addr , sizeof(int));
 			if (ret) {
 				csi_err("fetch csi_twi_addr from sys_config failed\n");
 			}
 
-			ret = script_parser_fetch("csi0_para","csi_mname", (int *)&dev->ccm_cfg[0]->ccm , I2C_NAME_SIZE*sizeof(char));
+			ret = script_parser_fetch(csi_ports[dev->id].para,"csi_mname", (int *)&dev->ccm_cfg[0]->ccm , I2C_NAME_SIZE*sizeof(char));
 			if (ret) {
 				csi_err("fetch csi_mname from sys_config failed\n");
 			}
 		}
 
 		/* fetch interface issue*/
-		ret = script_parser_fetch("csi0_para","csi_if", &dev->ccm_cfg[0]->interface , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_if", &dev->ccm_cfg[0]->interface , sizeof(int));
 		if (ret) {
 			csi_err("fetch csi_if from sys_config failed\n");
 		}
 
 		/* fetch power issue*/
 
-		ret = script_parser_fetch("csi0_para","csi_iovdd", (int *)&dev->ccm_cfg[0]->iovdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_iovdd", (int *)&dev->ccm_cfg[0]->iovdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_iovdd from sys_config failed\n");
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_avdd", (int *)&dev->ccm_cfg[0]->avdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_avdd", (int *)&dev->ccm_cfg[0]->avdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_avdd from sys_config failed\n");
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_dvdd", (int *)&dev->ccm_cfg[0]->dvdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_dvdd", (int *)&dev->ccm_cfg[0]->dvdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_dvdd from sys_config failed\n");
 		}
 
 		/* fetch flip issue */
-		ret = script_parser_fetch("csi0_para","csi_vflip", &dev->ccm_cfg[0]->vflip , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_vflip", &dev->ccm_cfg[0]->vflip , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 vflip from sys_config failed\n");
+			csi_err("fetch csi%d vflip from sys_config failed\n", dev->id);
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_hflip", &dev->ccm_cfg[0]->hflip , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_hflip", &dev->ccm_cfg[0]->hflip , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 hflip from sys_config failed\n");
+			csi_err("fetch csi%d hflip from sys_config failed\n", dev->id);
 		}
 
 		/* fetch flash light issue */
-		ret = script_parser_fetch("csi0_para","csi_flash_pol", &dev->ccm_cfg[0]->flash_pol , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_flash_pol", &dev->ccm_cfg[0]->flash_pol , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 csi_flash_pol from sys_config failed\n");
+			csi_err("fetch csi%d csi_flash_pol from sys_config failed\n", dev->id);
 		}
 	}
 
 	if(dev->dev_qty > 1)
 	{
-		dev->ccm_cfg[1]->i2c_addr = i2c_addr_b;
-		strcpy(dev->ccm_cfg[1]->ccm,ccm_b);
+		dev->ccm_cfg[1]->i2c_addr = ccm_param[dev->id].i2c_addr_b;
+		strcpy(dev->ccm_cfg[1]->ccm,ccm_param[dev->id].ccm_b);
 
 		/* fetch i2c and module name*/
-		ret = script_parser_fetch("csi0_para","csi_twi_id_b", &dev->ccm_cfg[1]->twi_id , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_twi_id_b", &dev->ccm_cfg[1]->twi_id , sizeof(int));
 		if (ret) {
 			csi_err("fetch csi_twi_id_b from sys_config failed\n");
 		}
@@ -1617,54 +1727,54 @@ static int fetch_config(struct csi_dev *dev)
 		ret = strcmp(dev->ccm_cfg[1]->ccm,"");
 		if((dev->ccm_cfg[1]->i2c_addr == 0xff) && (ret == 0))	//when insmod without parm
 		{
-			ret = script_parser_fetch("csi0_para","csi_twi_addr_b", &dev->ccm_cfg[1]->i2c_addr , sizeof(int));
+			ret = script_parser_fetch(csi_ports[dev->id].para,"csi_twi_addr_b", &dev->ccm_cfg[1]->i2c_addr , sizeof(int));
 			if (ret) {
 				csi_err("fetch csi_twi_addr_b from sys_config failed\n");
 			}
 
-			ret = script_parser_fetch("csi0_para","csi_mname_b", (int *)&dev->ccm_cfg[1]->ccm , I2C_NAME_SIZE*sizeof(char));
+			ret = script_parser_fetch(csi_ports[dev->id].para,"csi_mname_b", (int *)&dev->ccm_cfg[1]->ccm , I2C_NAME_SIZE*sizeof(char));
 			if (ret) {
 				csi_err("fetch csi_mname_b from sys_config failed\n");;
 			}
 		}
 
 		/* fetch interface issue*/
-		ret = script_parser_fetch("csi0_para","csi_if_b", &dev->ccm_cfg[1]->interface , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_if_b", &dev->ccm_cfg[1]->interface , sizeof(int));
 		if (ret) {
 			csi_err("fetch csi_if_b from sys_config failed\n");
 		}
 
 		/* fetch power issue*/
-		ret = script_parser_fetch("csi0_para","csi_iovdd_b", (int *)&dev->ccm_cfg[1]->iovdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_iovdd_b", (int *)&dev->ccm_cfg[1]->iovdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_iovdd_b from sys_config failed\n");
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_avdd_b", (int *)&dev->ccm_cfg[1]->avdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_avdd_b", (int *)&dev->ccm_cfg[1]->avdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_avdd_b from sys_config failed\n");
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_dvdd_b", (int *)&dev->ccm_cfg[1]->dvdd_str , 32*sizeof(char));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_dvdd_b", (int *)&dev->ccm_cfg[1]->dvdd_str , 32*sizeof(char));
 		if (ret) {
 			csi_err("fetch csi_dvdd_b from sys_config failed\n");
 		}
 
 		/* fetch flip issue */
-		ret = script_parser_fetch("csi0_para","csi_vflip_b", &dev->ccm_cfg[1]->vflip , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_vflip_b", &dev->ccm_cfg[1]->vflip , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 vflip_b from sys_config failed\n");
+			csi_err("fetch csi%d vflip_b from sys_config failed\n", dev->id);
 		}
 
-		ret = script_parser_fetch("csi0_para","csi_hflip_b", &dev->ccm_cfg[1]->hflip , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_hflip_b", &dev->ccm_cfg[1]->hflip , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 hflip_b from sys_config failed\n");
+			csi_err("fetch csi%d hflip_b from sys_config failed\n", dev->id);
 		}
 
 		/* fetch flash light issue */
-		ret = script_parser_fetch("csi0_para","csi_flash_pol_b", &dev->ccm_cfg[1]->flash_pol , sizeof(int));
+		ret = script_parser_fetch(csi_ports[dev->id].para,"csi_flash_pol_b", &dev->ccm_cfg[1]->flash_pol , sizeof(int));
 		if (ret) {
-			csi_err("fetch csi0 csi_flash_pol_b from sys_config failed\n");
+			csi_err("fetch csi%d csi_flash_pol_b from sys_config failed\n", dev->id);
 		}
 	}
 
@@ -1692,10 +1802,15 @@ static int csi_probe(struct platform_device *pdev)
 	struct resource *res;
 	struct video_device *vfd;
 	struct i2c_adapter *i2c_adap;
+	struct i2c_board_info dev_sensor[MAX_NUM_INPUTS];
 	int ret = 0;
 	int input_num;
 
 	csi_dbg(0,"csi_probe\n");
+	if (pdev->id < 0 || pdev->id >= CSI_NR_PORTS)
+		return -ENODEV;
+	memset(dev_sensor, 0, sizeof(dev_sensor));
+
 	/*request mem for dev*/
 	dev = kzalloc(sizeof(struct csi_dev), GFP_KERNEL);
 	if (!dev) {
@@ -1748,9 +1863,9 @@ static int csi_probe(struct platform_device *pdev)
 	}
 
     /*pin resource*/
-	dev->csi_pin_hd = gpio_request_ex("csi0_para",NULL);
+	dev->csi_pin_hd = gpio_request_ex(csi_ports[dev->id].para,NULL);
 	if (dev->csi_pin_hd==-1) {
-		csi_err("csi0 pin request error!\n");
+		csi_err("csi%d pin request error!\n", dev->id);
 		ret = -ENXIO;
 		goto err_irq;
 	}
@@ -1920,8 +2035,9 @@ reg_sd:
 	*vfd = csi_template;
 	vfd->v4l2_dev = &dev->v4l2_dev;
 
-	dev_set_name(&vfd->dev, "csi-0");
-	ret = video_register_device(vfd, VFL_TYPE_GRABBER, video_nr);
+	dev_set_name(&vfd->dev, "csi-%d", dev->id);
+	ret = video_register_device(vfd, VFL_TYPE_GRABBER,
+				    video_nr == -1 ? -1 : video_nr + dev->id);
 	if (ret < 0) {
 		goto rel_vdev;
 	}
@@ -1931,18 +2047,31 @@ reg_sd:
 	/* Now that everything is fine, let's add it to device list */
 	list_add_tail(&dev->csi_devlist, &csi_devlist);
 
-	if (video_nr != -1) {
-		video_nr++;
-	}
 	dev->vfd = vfd;
 
 	csi_print("V4L2 device registered as %s\n",video_device_node_name(vfd));
 
 	/*initial video buffer queue*/
-	videobuf_queue_dma_contig_init(&dev->vb_vidq, &csi_video_qops,
-			NULL, &dev->slock, V4L2_BUF_TYPE_VIDEO_CAPTURE,
-			V4L2_FIELD_NONE,//default format, can be changed by s_fmt
-			sizeof(struct csi_buffer), dev,NULL);//linux-3.0
+	if (!dev->pdev->dev.coherent_dma_mask)
+		dev->pdev->dev.coherent_dma_mask = DMA_BIT_MASK(32);
+	dev->alloc_ctx = vb2_dma_contig_init_ctx(&dev->pdev->dev);
+	if (IS_ERR(dev->alloc_ctx)) {
+		ret = PTR_ERR(dev->alloc_ctx);
+		goto rel_vdev;
+	}
+
+	dev->field = V4L2_FIELD_NONE;//default format, can be changed by s_fmt
+	dev->vb_vidq.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	dev->vb_vidq.io_modes = VB2_MMAP | VB2_USERPTR | VB2_READ;
+	dev->vb_vidq.drv_priv = dev;
+	dev->vb_vidq.buf_struct_size = sizeof(struct csi_buffer);
+	dev->vb_vidq.ops = &csi_video_qops;
+	dev->vb_vidq.mem_ops = &vb2_dma_contig_memops;
+	ret = vb2_queue_init(&dev->vb_vidq);
+	if (ret) {
+		vb2_dma_contig_cleanup_ctx(dev->alloc_ctx);
+		goto rel_vdev;
+	}
 
 	/* init video dma queues */
 	INIT_LIST_HEAD(&dev->vidq.active);
@@ -1990,6 +2119,7 @@ static int csi_release(void)
 
 		v4l2_info(&dev->v4l2_dev, "unregistering %s\n", video_device_node_name(dev->vfd));
 		video_unregister_device(dev->vfd);
+		vb2_dma_contig_cleanup_ctx(dev->alloc_ctx);
 		csi_clk_release(dev);
 		v4l2_device_unregister(&dev->v4l2_dev);
 		free_irq(dev->irq, dev);
@@ -2140,30 +2270,66 @@ static struct resource csi0_resource[] = {
 	},
 };
 
-static struct platform_device csi_device[] = {
+static struct resource csi1_resource[] = {
+	[0] = {
+		.start	= CSI1_REGS_BASE,
+		.end	= CSI1_REGS_BASE + CSI1_REG_SIZE - 1,
+		.flags	= IORESOURCE_MEM,
+	},
+	[1] = {
+		.start	= SW_INTC_IRQNO_CSI1,
+		.end	= SW_INTC_IRQNO_CSI1,
+		.flags	= IORESOURCE_IRQ,
+	},
+};
+
+static struct platform_device csi_device[CSI_NR_PORTS] = {
 	[0] = {
 	.name           	= "sun4i_csi",
   .id             	= 0,
 	.num_resources		= ARRAY_SIZE(csi0_resource),
   .resource       	= csi0_resource,
 	.dev.release      = csi_dev_release,
-	}
+	},
+	[1] = {
+	.name           	= "sun4i_csi",
+  .id             	= 1,
+	.num_resources		= ARRAY_SIZE(csi1_resource),
+  .resource       	= csi1_resource,
+	.dev.release      = csi_dev_release,
+	},
 };
 
+/* interfaces built in and enabled in sys_config */
+static int csi_registered[CSI_NR_PORTS];
+
+static int csi_port_used(int id)
+{
+	int csi_used = 0;
+
+	if (id == 0 && !IS_ENABLED(CONFIG_CSI0_SUN4I))
+		return 0;
+	if (id == 1 && !IS_ENABLED(CONFIG_CSI1_SUN4I))
+		return 0;
+
+	if (script_parser_fetch(csi_ports[id].para,"csi_used", &csi_used , sizeof(int))) {
+		csi_err("fetch csi%d csi_used from sys_config failed\n", id);
+		return 0;
+	}
+
+	return csi_used;
+}
+
 static int __init csi_init(void)
 {
-	u32 ret;
-	int csi_used;
+	int ret, id, used = 0;
 	csi_print("Welcome to CSI driver\n");
 	csi_print("csi_init\n");
 
-	ret = script_parser_fetch("csi0_para","csi_used", &csi_used , sizeof(int));
-	if (ret) {
-		csi_err("fetch csi_used from sys_config failed\n");
-		return -1;
-	}
+	for (id = 0; id < CSI_NR_PORTS; id++)
+		used |= csi_port_used(id) << id;
 
-	if(!csi_used)
+	if(!used)
 	{
 		csi_err("csi_used=0,csi driver is not enabled!\n");
 		return 0;
@@ -2176,30 +2342,36 @@ static int __init csi_init(void)
 		return -1;
 	}
 
-	ret = platform_device_register(&csi_device[0]);
-	if (ret) {
-		csi_err("platform device register failed\n");
-		return -1;
+	for (id = 0; id < CSI_NR_PORTS; id++) {
+		if (!(used & (1 << id)))
+			continue;
+
+		ret = platform_device_register(&csi_device[id]);
+		if (ret) {
+			csi_err("csi%d platform device register failed\n", id);
+			continue;
+		}
+		csi_registered[id] = 1;
 	}
 	return 0;
 }
 
 static void __exit csi_exit(void)
 {
-	int csi_used,ret;
+	int id, used = 0;
 
 	csi_print("csi_exit\n");
 
-	ret = script_parser_fetch("csi0_para","csi_used", &csi_used , sizeof(int));
-	if (ret) {
-		csi_err("fetch csi_used from sys_config failed\n");
-		return;
-	}
+	for (id = 0; id < CSI_NR_PORTS; id++)
+		used |= csi_port_used(id) << id;
 
-	if(csi_used)
+	if(used)
 	{
 		csi_release();
-		platform_device_unregister(&csi_device[0]);
+		for (id = 0; id < CSI_NR_PORTS; id++) {
+			if (csi_registered[id])
+				platform_device_unregister(&csi_device[id]);
+		}
 		platform_driver_unregister(&csi_driver);
 	}
 }
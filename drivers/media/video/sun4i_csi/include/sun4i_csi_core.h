@@ -28,7 +28,7 @@
 #define _SUN4I_CSI_CORE_H_
 
 #include <linux/types.h>
-#include <media/videobuf-core.h>
+#include <media/videobuf2-core.h>
 #include <media/v4l2-device.h>
 #include <linux/videodev2.h>
 #include <linux/i2c.h>
@@ -274,7 +274,8 @@ struct csi_size{
 
 /* buffer for one video frame */
 struct csi_buffer {
-	struct videobuf_buffer vb;
+	struct vb2_buffer     vb;
+	struct list_head      list;
 	struct csi_fmt        *fmt;
 };
 
@@ -334,7 +335,14 @@ struct csi_dev {
 	unsigned int            width;
 	unsigned int            height;
 	unsigned int						frame_size;
-	struct videobuf_queue   vb_vidq;
+	struct vb2_queue        vb_vidq;
+	void                    *alloc_ctx;
+	enum v4l2_field         field;
+
+	/* ping-pong address sets, indexed by __csi_double_buf_t */
+	struct csi_buffer       *slot[2];
+	struct timeval          vsync_ts;		/* start of the frame being written */
+	unsigned int            frames_dropped;	/* no buffer was queued to refill a set */
 
 	/*working state*/
 	unsigned long 		   	generating;
@@ -346,8 +354,7 @@ struct csi_dev {
 	struct clk				*csi_ahb_clk;
 	struct clk				*csi_module_clk;
 	struct clk				*csi_dram_clk;
-	struct clk				*csi_isp_src_clk;
-	struct clk				*csi_isp_clk;
+	struct clk				*csi_isp_clk;		/* shared, NULL unless this port uses it */
 	int						irq;
 	void __iomem			*regs;
 	struct resource			*regs_res;
@@ -374,6 +381,7 @@ struct csi_dev {
 	int module_flag;
 	__csi_subdev_info_t *ccm_info;  /*current config*/
 	struct ccm_config *ccm_cfg[MAX_NUM_INPUTS];
+	struct ccm_config ccm_data[MAX_NUM_INPUTS];
 };
 
 void  bsp_csi_open(struct csi_dev *dev);
@@ -49,6 +49,7 @@
 #include <linux/wait.h>
 #include <linux/poll.h>
 #include <linux/spinlock.h>
+#include <linux/timer.h>
 
 #include "sunxi_cedar.h"
 
@@ -68,6 +69,15 @@
 #  define _info(fmt, args...)
 #endif
 
+/* AVS_CNT1 in the timer block behind the ccmu, as cedar_dev drives it */
+#define AVS_CNT_CTL		(0xc80)
+#define AVS_CNT1		(0xc88)
+#define AVS_CNT_DIV		(0xc8c)
+#define AVS_CNT_SRC_HZ		(24000000)
+
+/* AVS_CNT1 wraps after 11 hours at the usual 100kHz */
+#define AVS_PAGE_REFRESH	(3600 * HZ)
+
 int avs_dev_major = AVSDEV_MAJOR;
 int avs_dev_minor = AVSDEV_MINOR;
 module_param(avs_dev_major, int, S_IRUGO);
@@ -102,6 +112,9 @@ struct avs_dev {
 
 	struct iomap_para iomap_addrs;   /* io remap addrs                     */
     struct iomap_resource iomap_res; /* io remap resources                 */
+
+	struct avs_counter_page *page;   /* mmap'able 64 bit counter state     */
+	struct timer_list page_timer;    /* keeps page->hi across wraps        */
 };
 struct avs_dev *avs_devp;
 
@@ -156,6 +169,43 @@ static void avs_iomem_unregister(struct avs_dev *devp)
 	}
 }
 
+/*
+ * Refresh the counter page, with devp->lock held. seq is odd while the
+ * fields are inconsistent, the readers in userspace retry then.
+ */
+static void avs_page_update(struct avs_dev *devp, int reset)
+{
+	struct avs_counter_page *page = devp->page;
+	u32 cnt, ctl;
+
+	cnt = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT1);
+	ctl = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
+
+	page->seq++;
+	smp_wmb();
+	if (reset)
+		page->hi = 0;
+	else if (cnt < page->last)
+		page->hi++;
+	page->last = cnt;
+	page->running = (ctl & (1<<1)) && !(ctl & (1<<9));
+	page->div = (readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_DIV) >> 16) + 1;
+	page->rate = AVS_CNT_SRC_HZ / page->div;
+	smp_wmb();
+	page->seq++;
+}
+
+static void avs_page_timer(unsigned long data)
+{
+	struct avs_dev *devp = (struct avs_dev *)data;
+
+	spin_lock(&devp->lock);
+	avs_page_update(devp, 0);
+	spin_unlock(&devp->lock);
+
+	mod_timer(&devp->page_timer, jiffies + AVS_PAGE_REFRESH);
+}
+
 /*
  * ioctl function
  * including : wait video engine done,
@@ -178,53 +228,58 @@ long avsdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
     switch (cmd)
     {
         case IOCTL_GETVALUE_AVS2:
-			spin_lock(lock);
+			spin_lock_bh(lock);
 
-            v = readl(devp->iomap_addrs.regs_ccmu + 0xc40);
+            v = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT1);
+            avs_page_update(devp, 0);
 
-			spin_unlock(lock);
+			spin_unlock_bh(lock);
 			return v;
 
         case IOCTL_CONFIG_AVS2:
-			spin_lock(lock);
+			spin_lock_bh(lock);
 
-            v = readl(devp->iomap_addrs.regs_ccmu + 0xc44);
+            v = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_DIV);
             v = 239<<16 | (v&0xffff);
-            writel(v, devp->iomap_addrs.regs_ccmu + 0xc44);
-            v = readl(devp->iomap_addrs.regs_ccmu + 0xc38);
+            writel(v, devp->iomap_addrs.regs_ccmu + AVS_CNT_DIV);
+            v = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
             v |= 1<<9 | 1<<1;
-            writel(v, devp->iomap_addrs.regs_ccmu + 0xc38);
-            writel(0, devp->iomap_addrs.regs_ccmu + 0xc40);
+            writel(v, devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
+            writel(0, devp->iomap_addrs.regs_ccmu + AVS_CNT1);
+            avs_page_update(devp, 1);
 
-			spin_unlock(lock);
+			spin_unlock_bh(lock);
             break;
 
         case IOCTL_RESET_AVS2:
-			spin_lock(lock);
+			spin_lock_bh(lock);
 
-            writel(0, devp->iomap_addrs.regs_ccmu + 0xc40);
+            writel(0, devp->iomap_addrs.regs_ccmu + AVS_CNT1);
+            avs_page_update(devp, 1);
 
-			spin_unlock(lock);
+			spin_unlock_bh(lock);
             break;
 
         case IOCTL_PAUSE_AVS2:
-			spin_lock(lock);
+			spin_lock_bh(lock);
 
-            v = readl(devp->iomap_addrs.regs_ccmu + 0xc38);
+            v = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
             v |= 1<<9;
-            writel(v, devp->iomap_addrs.regs_ccmu + 0xc38);
+            writel(v, devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
+            avs_page_update(devp, 0);
 
-			spin_unlock(lock);
+			spin_unlock_bh(lock);
             break;
 
         case IOCTL_START_AVS2:
-			spin_lock(lock);
+			spin_lock_bh(lock);
 
-            v = readl(devp->iomap_addrs.regs_ccmu + 0xc38);
+            v = readl(devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
             v &= ~(1<<9);
-            writel(v, devp->iomap_addrs.regs_ccmu + 0xc38);
+            writel(v, devp->iomap_addrs.regs_ccmu + AVS_CNT_CTL);
+            avs_page_update(devp, 0);
 
-			spin_unlock(lock);
+			spin_unlock_bh(lock);
             break;
 
         default:
@@ -297,6 +352,17 @@ static int avsdev_mmap(struct file *filp, struct vm_area_struct *vma)
 
 	addrs = avs_devp->iomap_addrs;
 
+    /* the counter page, read only */
+    if (vma->vm_pgoff == AVS_COUNTER_PAGE_OFFSET) {
+        if (vma->vm_end - vma->vm_start > PAGE_SIZE || (vma->vm_flags & VM_WRITE))
+            return -EINVAL;
+        vma->vm_flags &= ~VM_MAYWRITE;
+        vma->vm_flags |= VM_RESERVED;
+        return remap_pfn_range(vma, vma->vm_start,
+                               virt_to_phys(avs_devp->page) >> PAGE_SHIFT,
+                               PAGE_SIZE, vma->vm_page_prot);
+    }
+
     if(VAddr == (unsigned int)addrs.regs_ccmu) {
         temp_pfn = CCMU_REGS_pBASE >> 12;
         io_ram = 1;
@@ -372,7 +438,15 @@ static int __init avsdev_init(void)
 	}
 	memset(avs_devp, 0, sizeof(struct avs_dev));
 
-	sema_init(&avs_devp->sem, 0);
+	sema_init(&avs_devp->sem, 1);
+
+	avs_devp->page = (struct avs_counter_page *)get_zeroed_page(GFP_KERNEL);
+	if (avs_devp->page == NULL) {
+		kfree(avs_devp);
+		return -ENOMEM;
+	}
+	SetPageReserved(virt_to_page(avs_devp->page));
+	avs_devp->page->cnt_offset = AVS_CNT1;
 
 	/* request resources and ioremap */
 	printk("[tt]-----      register iomem      ----\n");
@@ -381,6 +455,10 @@ static int __init avsdev_init(void)
 	/* init lock for protect ioctl access */
 	spin_lock_init(&avs_devp->lock);
 
+	setup_timer(&avs_devp->page_timer, avs_page_timer, (unsigned long)avs_devp);
+	if (avs_devp->iomap_addrs.regs_ccmu)
+		avs_page_timer((unsigned long)avs_devp);
+
 	devno = MKDEV(avs_dev_major, avs_dev_minor);
 	cdev_init(&avs_devp->cdev, &avsdev_fops);
 	avs_devp->cdev.owner = THIS_MODULE;
@@ -403,6 +481,8 @@ static void __exit avsdev_exit(void)
 	dev_t dev;
 	dev = MKDEV(avs_dev_major, avs_dev_minor);
 
+	del_timer_sync(&avs_devp->page_timer);
+
 	/* Unregister iomem and iounmap */
 	avs_iomem_unregister(avs_devp);
 
@@ -415,6 +495,8 @@ static void __exit avsdev_exit(void)
 	unregister_chrdev_region(dev, 1);
 
 	if (avs_devp) {
+		ClearPageReserved(virt_to_page(avs_devp->page));
+		free_page((unsigned long)avs_devp->page);
 		kfree(avs_devp);
 	}
 }
@@ -36,6 +36,13 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-buf.h>
+#include <linux/ktime.h>
+#include <linux/devfreq.h>
+#include <linux/thermal.h>
+#include <linux/sunxi_thermal.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <asm/uaccess.h>
 #include <asm/io.h>
 #include <asm/dma.h>
@@ -47,6 +54,9 @@
 #include <mach/clock.h>
 #include "sunxi_cedar.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/cedar.h>
+
 #define DRV_VERSION "0.01alpha"
 
 #undef USE_CEDAR_ENGINE
@@ -85,12 +95,12 @@ static void *ve_start_virt;
 extern unsigned long ve_start;
 extern unsigned long ve_size;
 extern int flush_clean_user_range(long start, long end);
+static struct platform_device sw_device_cedar;
 struct iomap_para{
 	volatile char* regs_macc;
 	volatile char* regs_avs;
 };
 
-static DECLARE_WAIT_QUEUE_HEAD(wait_ve);
 struct cedar_dev {
 	struct cdev cdev;	             /* char device struct                 */
 	struct device *dev;              /* ptr to class device struct         */
@@ -115,6 +125,408 @@ struct cedar_dev *cedar_devp;
 
 u32 int_sta=0,int_value;
 
+/*
+ * One context per open handle: its own VE interrupt result, and its
+ * place in the VE scheduler. Handles that never use IOCTL_VE_ACQUIRE
+ * behave as before, every VE interrupt wakes all of them while nobody
+ * owns the VE.
+ */
+struct cedar_ctx {
+	struct list_head list;		/* on cedar_ctx_list */
+	wait_queue_head_t wq;		/* IOCTL_WAIT_VE and poll */
+	u32 irq_flag;
+	u32 irq_value;
+
+	unsigned int type;		/* CEDARV_SESSION_* */
+	unsigned int period_us;		/* 0: best effort */
+	u32 waiting;			/* in IOCTL_VE_ACQUIRE */
+	ktime_t deadline;		/* of the pending acquire */
+	ktime_t start;			/* when it got the VE */
+	u64 vruntime_ns;		/* VE time used, best effort only */
+
+	struct list_head frames;	/* IOCTL_FRAME_ALLOC */
+	struct list_head imports;	/* IOCTL_FRAME_IMPORT */
+
+	u32 *regs;			/* VE registers while preempted */
+	const struct cedar_ve_window *saved;	/* NULL: nothing to restore */
+
+	/* for debugfs cedar/sessions */
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	int job_busy;			/* in IOCTL_WAIT_VE, no irq yet */
+	ktime_t job_start;
+	u32 jobs;			/* VE runs that ended in an irq */
+	u32 timeouts;			/* IOCTL_WAIT_VE that timed out */
+	u32 frames;			/* IOCTL_VE_RELEASE */
+	ktime_t frame_start;		/* IOCTL_VE_ACQUIRE of this frame */
+	u64 frame_ns;			/* acquire to release, all frames */
+	u64 frame_max_ns;
+	u64 hw_ns;			/* IOCTL_WAIT_VE to irq, all jobs */
+	u64 hw_max_ns;
+	u64 wait_ns;			/* waiting in IOCTL_VE_ACQUIRE */
+};
+
+/*
+ * The part of the macc register space that describes a job of one
+ * engine. Trigger, status and sram data ports are left alone: writing
+ * them back would start the engine, ack interrupts or push data.
+ */
+struct cedar_ve_window {
+	u32 mode;			/* value of macc + 0 bits 3:0 */
+	u32 start;
+	u32 end;
+	u32 skip[3];
+};
+
+static const struct cedar_ve_window cedar_ve_windows[] = {
+	{ 0x0, 0x100, 0x200, { 0x118, 0x11c, 0 } },	/* mpeg124 */
+	{ 0x1, 0x200, 0x300, { 0x224, 0x228, 0x2e4 } },	/* h264 */
+	{ 0xb, 0xb00, 0xc00, { 0xb18, 0xb1c, 0xbe4 } },	/* avc enc */
+};
+
+/* longest a handle may keep the VE while others wait */
+#define CEDAR_HOLD_MAX_MS	500
+
+static LIST_HEAD(cedar_ctx_list);
+static DEFINE_SPINLOCK(cedar_sched_lock);
+static DECLARE_WAIT_QUEUE_HEAD(cedar_sched_wait);
+static struct cedar_ctx *ve_owner;
+static u64 cedar_min_vruntime;
+
+/*
+ * VE load for the clock governor: time from IOCTL_WAIT_VE to the VE
+ * interrupt, and the smallest deadline slack reported since the last
+ * poll. All under cedar_sched_lock.
+ */
+static int cedar_busy;
+static ktime_t cedar_busy_since;
+static u64 cedar_busy_ns;
+static int cedar_slack_min_us = INT_MAX;
+static u32 cedar_slack_frames;
+
+static void cedar_slack_report(int slack_us)
+{
+	if (slack_us < cedar_slack_min_us)
+		cedar_slack_min_us = slack_us;
+	cedar_slack_frames++;
+}
+
+static const struct cedar_ve_window *cedar_ve_window(void)
+{
+	u32 mode = readl(cedar_devp->iomap_addrs.regs_macc) & 0xf;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cedar_ve_windows); i++)
+		if (cedar_ve_windows[i].mode == mode)
+			return &cedar_ve_windows[i];
+	return NULL;
+}
+
+static int cedar_ve_skip(const struct cedar_ve_window *win, u32 off)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(win->skip); i++)
+		if (win->skip[i] && win->skip[i] == off)
+			return 1;
+	return 0;
+}
+
+/* called with cedar_sched_lock held and the VE idle */
+static void cedar_ctx_save(struct cedar_ctx *ctx,
+			   const struct cedar_ve_window *win)
+{
+	volatile char *macc = cedar_devp->iomap_addrs.regs_macc;
+	u32 off;
+
+	ctx->regs[0] = readl(macc);
+	for (off = win->start; off < win->end; off += 4)
+		if (!cedar_ve_skip(win, off))
+			ctx->regs[off >> 2] = readl(macc + off);
+	ctx->saved = win;
+}
+
+/* called with cedar_sched_lock held */
+static void cedar_ctx_restore(struct cedar_ctx *ctx)
+{
+	const struct cedar_ve_window *win = ctx->saved;
+	volatile char *macc = cedar_devp->iomap_addrs.regs_macc;
+	u32 off;
+
+	/* select the engine first, its registers are banked behind it */
+	writel(ctx->regs[0], macc);
+	for (off = win->start; off < win->end; off += 4)
+		if (!cedar_ve_skip(win, off))
+			writel(ctx->regs[off >> 2], macc + off);
+	ctx->saved = NULL;
+}
+
+/* hand the VE to the next waiter, called with cedar_sched_lock held */
+static void cedar_sched_pick(void)
+{
+	struct cedar_ctx *ctx, *best = NULL;
+
+	list_for_each_entry(ctx, &cedar_ctx_list, list) {
+		if (!ctx->waiting)
+			continue;
+		if (!best) {
+			best = ctx;
+		} else if (ctx->period_us && best->period_us) {
+			if (ktime_to_ns(ktime_sub(ctx->deadline, best->deadline)) < 0)
+				best = ctx;
+		} else if (ctx->period_us) {
+			/* deadline sessions go before best effort ones */
+			best = ctx;
+		} else if (!best->period_us &&
+			   ctx->vruntime_ns < best->vruntime_ns) {
+			best = ctx;
+		}
+	}
+
+	ve_owner = best;
+	if (best) {
+		best->waiting = 0;
+		best->irq_flag = 0;
+		best->start = ktime_get();
+		if (best->saved)
+			cedar_ctx_restore(best);
+		wake_up_interruptible_all(&cedar_sched_wait);
+	}
+}
+
+/* called with cedar_sched_lock held */
+static void cedar_sched_put(struct cedar_ctx *ctx)
+{
+	u64 used = ktime_to_ns(ktime_sub(ktime_get(), ctx->start));
+
+	if (!ctx->period_us) {
+		ctx->vruntime_ns += used;
+		if (ctx->vruntime_ns > cedar_min_vruntime)
+			cedar_min_vruntime = ctx->vruntime_ns;
+	}
+	ve_owner = NULL;
+	cedar_sched_pick();
+}
+
+/* block until ctx owns the VE, ctx->waiting is set */
+static int __cedar_ve_wait(struct cedar_ctx *ctx)
+{
+	unsigned long flags;
+	struct cedar_ctx *owner;
+	long left;
+
+	for (;;) {
+		left = wait_event_interruptible_timeout(cedar_sched_wait,
+				ACCESS_ONCE(ve_owner) == ctx,
+				msecs_to_jiffies(CEDAR_HOLD_MAX_MS));
+		if (left > 0)
+			return 0;
+
+		spin_lock_irqsave(&cedar_sched_lock, flags);
+		if (ve_owner == ctx) {
+			spin_unlock_irqrestore(&cedar_sched_lock, flags);
+			return 0;
+		}
+		if (left < 0) {
+			ctx->waiting = 0;
+			/* the interrupted job is given up */
+			ctx->saved = NULL;
+			spin_unlock_irqrestore(&cedar_sched_lock, flags);
+			return left;
+		}
+		/* an owner that never releases can't starve everybody */
+		owner = ve_owner;
+		if (owner && ktime_to_ms(ktime_sub(ktime_get(), owner->start)) >=
+		    CEDAR_HOLD_MAX_MS) {
+			printk("cedar: VE held for over %d ms, handing it on\n",
+			       CEDAR_HOLD_MAX_MS);
+			cedar_sched_put(owner);
+		}
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+	}
+}
+
+static int cedar_ve_wait(struct cedar_ctx *ctx)
+{
+	ktime_t start = ktime_get();
+	int ret = __cedar_ve_wait(ctx);
+
+	ctx->wait_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	return ret;
+}
+
+static int cedar_ve_acquire(struct cedar_ctx *ctx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	if (ve_owner == ctx) {
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+		return 0;
+	}
+	ctx->frame_start = ktime_get();
+	ctx->waiting = 1;
+	if (ctx->period_us)
+		ctx->deadline = ktime_add_us(ktime_get(), ctx->period_us);
+	else if (ctx->vruntime_ns < cedar_min_vruntime)
+		/* don't let a newly busy session make up for lost time */
+		ctx->vruntime_ns = cedar_min_vruntime;
+	if (!ve_owner)
+		cedar_sched_pick();
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	return cedar_ve_wait(ctx);
+}
+
+/*
+ * Is a session waiting that must run before the rest of ctx's job?
+ * Only deadline sessions preempt, best effort ones wait for the frame
+ * boundary. Called with cedar_sched_lock held.
+ */
+static int cedar_sched_preempt(struct cedar_ctx *ctx)
+{
+	struct cedar_ctx *w;
+
+	list_for_each_entry(w, &cedar_ctx_list, list) {
+		if (!w->waiting || !w->period_us)
+			continue;
+		if (!ctx->period_us ||
+		    ktime_to_ns(ktime_sub(w->deadline, ctx->deadline)) < 0)
+			return 1;
+	}
+	return 0;
+}
+
+static int cedar_ve_yield(struct cedar_ctx *ctx)
+{
+	const struct cedar_ve_window *win;
+	unsigned long flags;
+	int ret;
+
+	/* the image spans the whole macc page, indexed by offset */
+	if (!ctx->regs) {
+		ctx->regs = kzalloc(4096, GFP_KERNEL);
+		if (!ctx->regs)
+			return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	if (ve_owner != ctx) {
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+		return -EPERM;
+	}
+	win = cedar_ve_window();
+	if (!win || !cedar_sched_preempt(ctx)) {
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+		return 0;
+	}
+	cedar_ctx_save(ctx, win);
+	cedar_sched_put(ctx);
+	/* back in the queue with the deadline of the job it is in */
+	ctx->waiting = 1;
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	ret = cedar_ve_wait(ctx);
+	return ret ? ret : 1;
+}
+
+static int cedar_ve_release(struct cedar_ctx *ctx)
+{
+	unsigned long flags;
+	int ret = 0;
+	u64 ns;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	if (ve_owner == ctx) {
+		if (ctx->period_us)
+			cedar_slack_report(ktime_us_delta(ctx->deadline,
+							  ktime_get()));
+		ns = ktime_to_ns(ktime_sub(ktime_get(), ctx->frame_start));
+		ctx->frame_ns += ns;
+		if (ns > ctx->frame_max_ns)
+			ctx->frame_max_ns = ns;
+		ctx->frames++;
+		cedar_sched_put(ctx);
+	} else {
+		ret = -EPERM;
+	}
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	return ret;
+}
+
+/* wait for the VE interrupt of the job ctx started, 1: irq, 0: timeout */
+static int cedar_ve_wait_irq(struct cedar_ctx *ctx, unsigned long timeout)
+{
+	unsigned long flags;
+
+	ctx->irq_value = 0;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	if(ctx->irq_flag)
+		ctx->irq_value = 1;
+	else {
+		ctx->job_busy = 1;
+		ctx->job_start = ktime_get();
+		if (!cedar_busy) {
+			cedar_busy = 1;
+			cedar_busy_since = ctx->job_start;
+		}
+	}
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	if (!wait_event_interruptible_timeout(ctx->wq, ctx->irq_flag, timeout)) {
+		spin_lock_irqsave(&cedar_sched_lock, flags);
+		ctx->job_busy = 0;
+		ctx->timeouts++;
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+	}
+	ctx->irq_flag = 0;
+	return ctx->irq_value;
+}
+
+/* called with cedar_sched_lock held */
+static void cedar_ctx_job_done(struct cedar_ctx *ctx, ktime_t now)
+{
+	u64 ns;
+
+	if (!ctx->job_busy)
+		return;
+	ns = ktime_to_ns(ktime_sub(now, ctx->job_start));
+	ctx->hw_ns += ns;
+	if (ns > ctx->hw_max_ns)
+		ctx->hw_max_ns = ns;
+	ctx->jobs++;
+	ctx->job_busy = 0;
+}
+
+/* deliver a VE interrupt to its owner, or to everybody if there is none */
+static void cedar_ctx_irq(void)
+{
+	struct cedar_ctx *ctx;
+	ktime_t now = ktime_get();
+
+	spin_lock(&cedar_sched_lock);
+	if (cedar_busy) {
+		cedar_busy_ns += ktime_to_ns(ktime_sub(now, cedar_busy_since));
+		cedar_busy = 0;
+	}
+	if (ve_owner) {
+		cedar_ctx_job_done(ve_owner, now);
+		ve_owner->irq_value = 1;
+		ve_owner->irq_flag = 1;
+		wake_up_interruptible(&ve_owner->wq);
+	} else {
+		list_for_each_entry(ctx, &cedar_ctx_list, list) {
+			cedar_ctx_job_done(ctx, now);
+			ctx->irq_value = 1;
+			ctx->irq_flag = 1;
+			wake_up_interruptible(&ctx->wq);
+		}
+	}
+	spin_unlock(&cedar_sched_lock);
+}
+
 /*
  * Video engine interrupt service routine
  * To wake up ve wait queue
@@ -167,8 +579,7 @@ static irqreturn_t VideoEngineInterupt(int irq, void *dev)
 
     cedar_devp->irq_value = 1;	//hx modify 2011-8-1 16:08:47
     cedar_devp->irq_flag = 1;
-    //any interrupt will wake up wait queue
-    wake_up_interruptible(&wait_ve);        //ioctl
+    cedar_ctx_irq();
 
     return IRQ_HANDLED;
 }
@@ -179,11 +590,11 @@ static irqreturn_t VideoEngineInterupt(int irq, void *dev)
 unsigned int cedardev_poll(struct file *filp, struct poll_table_struct *wait)
 {
 	int mask = 0;
-	struct cedar_dev *devp = filp->private_data;
+	struct cedar_ctx *ctx = filp->private_data;
 
-	poll_wait(filp, &devp->wq, wait);
-	if (devp->irq_flag == 1) {
-		devp->irq_flag = 0;
+	poll_wait(filp, &ctx->wq, wait);
+	if (ctx->irq_flag == 1) {
+		ctx->irq_flag = 0;
 		mask |= POLLIN | POLLRDNORM;
 	}
 	return mask;
@@ -428,6 +839,14 @@ static void restore_context(void)
 		writel(g_ctx_reg0, 0xf1c20e00);
 }
 
+/* VE clock limits, in Hz */
+#define VE_RATE_MAX	320000000
+#define VE_RATE_MIN	100000000
+
+/* the ceiling of the thermal zone, and the clock last asked for in MHz */
+static int ve_rate_cap = VE_RATE_MAX;
+static int ve_freq_req = 300;
+
 static long __set_ve_freq (int arg)
 {
 	/*
@@ -436,11 +855,13 @@ static long __set_ve_freq (int arg)
 	** tests show it can't run reliably at even 408MHz.  Keeping the
 	** sun4i max setting seems best until more information is available.
 	*/
-	int max_rate = 320000000;
-	int min_rate = 100000000;
+	int max_rate = ACCESS_ONCE(ve_rate_cap);
+	int min_rate = VE_RATE_MIN;
 	int arg_rate = arg * 1000000;	/* arg_rate is specified in MHz */
 	int divisor;
 
+	ve_freq_req = arg;
+
 	if (arg_rate > max_rate)
 		arg_rate = max_rate;
 	if (arg_rate < min_rate)
@@ -479,6 +900,227 @@ static long __set_ve_freq (int arg)
 	return 0;
 }
 
+#ifdef CONFIG_VIDEO_DECODER_SUNXI_DEVFREQ
+/*
+ * VE clock governor. The clock follows the busy ratio, aiming to keep
+ * the VE below CEDAR_DF_UPTHRESHOLD percent busy, but deadline slack
+ * wins: a missed frame goes straight to the top clock, and a frame
+ * finishing with less than CEDAR_DF_SLACK_US to spare never lets the
+ * clock go down.
+ */
+#define CEDAR_DF_POLL_MS	50
+#define CEDAR_DF_UPTHRESHOLD	80
+#define CEDAR_DF_SLACK_US	2000
+
+/* passed to the governor as devfreq_dev_status.private_data */
+struct cedar_devfreq_load {
+	int slack_min_us;
+	u32 frames;			/* that reported slack */
+};
+
+static struct devfreq *cedar_devfreq;
+static struct cedar_devfreq_load cedar_df_load;
+static ktime_t cedar_df_last;
+
+static int cedar_devfreq_target(struct device *dev, unsigned long *freq,
+				u32 flags)
+{
+	long ret = __set_ve_freq(DIV_ROUND_UP(*freq, 1000000));
+
+	*freq = clk_get_rate(ve_moduleclk);
+	return ret;
+}
+
+static int cedar_devfreq_status(struct device *dev,
+				struct devfreq_dev_status *stat)
+{
+	unsigned long flags;
+	ktime_t now;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	now = ktime_get();
+	if (cedar_busy) {
+		cedar_busy_ns += ktime_to_ns(ktime_sub(now, cedar_busy_since));
+		cedar_busy_since = now;
+	}
+	stat->busy_time = div_u64(cedar_busy_ns, NSEC_PER_USEC);
+	stat->total_time = ktime_us_delta(now, cedar_df_last);
+	cedar_busy_ns = 0;
+	cedar_df_last = now;
+
+	cedar_df_load.slack_min_us = cedar_slack_min_us;
+	cedar_df_load.frames = cedar_slack_frames;
+	cedar_slack_min_us = INT_MAX;
+	cedar_slack_frames = 0;
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	stat->current_frequency = clk_get_rate(ve_moduleclk);
+	stat->private_data = &cedar_df_load;
+	return 0;
+}
+
+static int cedar_governor_target(struct devfreq *df, unsigned long *freq)
+{
+	struct devfreq_dev_status stat;
+	struct cedar_devfreq_load *load;
+	unsigned long max = df->max_freq ? df->max_freq : VE_RATE_MAX;
+	unsigned long cur;
+	u64 target;
+	int err;
+
+	err = df->profile->get_dev_status(df->dev.parent, &stat);
+	if (err)
+		return err;
+	load = stat.private_data;
+	cur = stat.current_frequency;
+
+	if ((load->frames && load->slack_min_us < 0) ||
+	    !stat.total_time || !cur) {
+		*freq = max;
+		return 0;
+	}
+
+	target = div_u64((u64)stat.busy_time * cur * 100,
+			 stat.total_time * CEDAR_DF_UPTHRESHOLD);
+	if (load->frames && load->slack_min_us < CEDAR_DF_SLACK_US &&
+	    target < cur + cur / 4)
+		target = cur + cur / 4;
+
+	if (target > max)
+		target = max;
+	if (df->min_freq && target < df->min_freq)
+		target = df->min_freq;
+	*freq = target;
+	return 0;
+}
+
+static const struct devfreq_governor cedar_devfreq_governor = {
+	.name = "cedar_deadline",
+	.get_target_freq = cedar_governor_target,
+};
+
+static struct devfreq_dev_profile cedar_devfreq_profile = {
+	.polling_ms = CEDAR_DF_POLL_MS,
+	.target = cedar_devfreq_target,
+	.get_dev_status = cedar_devfreq_status,
+};
+
+static void cedar_devfreq_init(struct device *dev)
+{
+	cedar_df_last = ktime_get();
+	cedar_devfreq_profile.initial_freq = clk_get_rate(ve_moduleclk);
+	cedar_devfreq = devfreq_add_device(dev, &cedar_devfreq_profile,
+					   &cedar_devfreq_governor, NULL);
+	if (IS_ERR(cedar_devfreq)) {
+		printk("cedar: no VE clock governor (%ld)\n",
+		       PTR_ERR(cedar_devfreq));
+		cedar_devfreq = NULL;
+	}
+}
+
+static void cedar_devfreq_exit(void)
+{
+	if (cedar_devfreq)
+		devfreq_remove_device(cedar_devfreq);
+}
+#else
+static inline void cedar_devfreq_init(struct device *dev) {}
+static inline void cedar_devfreq_exit(void) {}
+#endif
+
+#ifdef CONFIG_THERMAL
+/*
+ * cooling device of the SoC thermal zone: state n moves the ceiling of
+ * __set_ve_freq n dividers of the ve pll below the top rate, as long
+ * as the VE still gets VE_RATE_MIN.
+ */
+static struct thermal_cooling_device *cedar_cool_dev;
+static unsigned long cedar_cool_state;
+
+static int cedar_cool_div(void)
+{
+	return DIV_ROUND_UP(pll4clk_rate, VE_RATE_MAX);
+}
+
+static int cedar_cool_get_max_state(struct thermal_cooling_device *cdev,
+				    unsigned long *state)
+{
+	int div = cedar_cool_div();
+	unsigned long n = 0;
+
+	while (div + n + 1 <= 8 && pll4clk_rate / (div + n + 1) >= VE_RATE_MIN)
+		n++;
+	*state = n;
+	return 0;
+}
+
+static int cedar_cool_get_cur_state(struct thermal_cooling_device *cdev,
+				    unsigned long *state)
+{
+	*state = cedar_cool_state;
+	return 0;
+}
+
+static int cedar_cool_set_cur_state(struct thermal_cooling_device *cdev,
+				    unsigned long state)
+{
+	unsigned long max_state;
+
+	cedar_cool_get_max_state(cdev, &max_state);
+	if (state > max_state)
+		return -EINVAL;
+
+	cedar_cool_state = state;
+	ve_rate_cap = state ? pll4clk_rate / (cedar_cool_div() + state) :
+		VE_RATE_MAX;
+	/* the clock asked for last, under the new ceiling */
+	return __set_ve_freq(ve_freq_req);
+}
+
+static const struct thermal_cooling_device_ops cedar_cool_ops = {
+	.get_max_state = cedar_cool_get_max_state,
+	.get_cur_state = cedar_cool_get_cur_state,
+	.set_cur_state = cedar_cool_set_cur_state,
+};
+
+static void cedar_cool_init(void)
+{
+	cedar_cool_dev = thermal_cooling_device_register(SUNXI_COOLING_VE, NULL,
+							 &cedar_cool_ops);
+	if (IS_ERR(cedar_cool_dev)) {
+		printk("cedar: no thermal cooling (%ld)\n",
+		       PTR_ERR(cedar_cool_dev));
+		cedar_cool_dev = NULL;
+	}
+}
+
+static void cedar_cool_exit(void)
+{
+	if (cedar_cool_dev)
+		thermal_cooling_device_unregister(cedar_cool_dev);
+}
+#else
+static inline void cedar_cool_init(void) {}
+static inline void cedar_cool_exit(void) {}
+#endif
+
+/*
+ * IOCTL_SET_VE_FREQ. With the governor running, the clock a player asks
+ * for becomes the ceiling the governor works under, from its next poll.
+ */
+static long cedar_set_ve_freq(int mhz)
+{
+#ifdef CONFIG_VIDEO_DECODER_SUNXI_DEVFREQ
+	if (cedar_devfreq) {
+		mutex_lock(&cedar_devfreq->lock);
+		cedar_devfreq->max_freq = (unsigned long)mhz * 1000000;
+		mutex_unlock(&cedar_devfreq->lock);
+		return 0;
+	}
+#endif
+	return __set_ve_freq(mhz);
+}
+
 /*
  * ioctl function
  * including : wait video engine done,
@@ -492,7 +1134,7 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	long   ret = 0;
 	unsigned int v;
 	int ve_timeout = 0;
-	struct cedar_dev *devp;
+	struct cedar_ctx *ctx;
 #ifdef USE_CEDAR_ENGINE
 	int rel_taskid = 0;
 	struct __cedarv_task task_ret;
@@ -500,7 +1142,7 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 #endif
 	unsigned long flags;
 
-	devp = filp->private_data;
+	ctx = filp->private_data;
 
 	switch (cmd)
 	{
@@ -537,10 +1179,12 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 			enable_cedar_hw_clk();
 
+			trace_cedar_engine_req(task_ptr->t.ID, task_ptr->is_first_task);
 			return task_ptr->is_first_task;//插入run_task_list链表中的任务是第一个任务，返回1，不是第一个任务返回0. hx modify 2011-7-28 16:59:16！！！
 		#else
 			enable_cedar_hw_clk();
 			cedar_devp->ref_count++;
+			trace_cedar_engine_req(-1, 0);
 			break;
 		#endif
     	case IOCTL_ENGINE_REL:
@@ -550,9 +1194,11 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			*	利用任务的id号进行任务的删除操作。返回值意义：找不到对应ID，返回-1;找到对应ID，返回0。
 			*/
 			ret = cedardev_del_task(rel_taskid);
+			trace_cedar_engine_rel(rel_taskid, ret);
 		#else
 			disable_cedar_hw_clk();
 			cedar_devp->ref_count--;
+			trace_cedar_engine_rel(-1, 0);
 		#endif
 			return ret;
 		case IOCTL_ENGINE_CHECK_DELAY:
@@ -597,20 +1243,74 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
         	}
 			break;
         case IOCTL_WAIT_VE:
-            //wait_event_interruptible(wait_ve, cedar_devp->irq_flag);
             ve_timeout = (int)arg;
-            cedar_devp->irq_value = 0;
+	        /*返回1，表示中断返回，返回0，表示timeout返回*/
+			trace_cedar_wait_ve(ve_timeout);
+			ret = cedar_ve_wait_irq(ctx, ve_timeout*HZ);
+			trace_cedar_wait_ve_done(ret);
+			return ret;
 
-            spin_lock_irqsave(&cedar_spin_lock, flags);
-            if(cedar_devp->irq_flag)
-            	cedar_devp->irq_value = 1;
-            spin_unlock_irqrestore(&cedar_spin_lock, flags);
+	case IOCTL_SET_SESSION:
+	{
+		struct cedarv_session session;
+		if (copy_from_user(&session, (void __user*)arg, sizeof(struct cedarv_session)))
+			return -EFAULT;
+		if (session.type > CEDARV_SESSION_ENCODE)
+			return -EINVAL;
+		spin_lock_irqsave(&cedar_sched_lock, flags);
+		ctx->type = session.type;
+		ctx->period_us = session.period_us;
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+		break;
+	}
 
-            wait_event_interruptible_timeout(wait_ve, cedar_devp->irq_flag, ve_timeout*HZ);
-            //printk("%s,%d,ve_timeout:%d,cedar_devp->irq_value:%d\n", __func__, __LINE__, ve_timeout, cedar_devp->irq_value);
-	        cedar_devp->irq_flag = 0;
-	        /*返回1，表示中断返回，返回0，表示timeout返回*/
-			return cedar_devp->irq_value;
+	case IOCTL_VE_ACQUIRE:
+		return cedar_ve_acquire(ctx);
+
+	case IOCTL_VE_RELEASE:
+		return cedar_ve_release(ctx);
+
+	case IOCTL_VE_YIELD:
+		return cedar_ve_yield(ctx);
+
+	case IOCTL_FRAME_ALLOC:
+	{
+		struct cedarv_frame_alloc req;
+		if (copy_from_user(&req, (void __user*)arg, sizeof(struct cedarv_frame_alloc)))
+			return -EFAULT;
+		ret = cedar_frame_alloc(&sw_device_cedar.dev, &ctx->frames, &req);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user*)arg, &req, sizeof(struct cedarv_frame_alloc)))
+			return -EFAULT;
+		break;
+	}
+
+	case IOCTL_FRAME_SYNC:
+	{
+		struct cedarv_frame_sync req;
+		if (copy_from_user(&req, (void __user*)arg, sizeof(struct cedarv_frame_sync)))
+			return -EFAULT;
+		return cedar_frame_sync(&req);
+	}
+
+	case IOCTL_FRAME_IMPORT:
+	{
+		struct cedarv_frame_import req;
+		if (copy_from_user(&req, (void __user*)arg, sizeof(struct cedarv_frame_import)))
+			return -EFAULT;
+		ret = cedar_frame_import(&sw_device_cedar.dev, &ctx->imports, &req);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user*)arg, &req, sizeof(struct cedarv_frame_import))) {
+			cedar_frame_unimport(&ctx->imports, req.phys);
+			return -EFAULT;
+		}
+		break;
+	}
+
+	case IOCTL_FRAME_UNIMPORT:
+		return cedar_frame_unimport(&ctx->imports, (unsigned int)arg);
 
 		case IOCTL_ENABLE_VE:
             clk_enable(ve_moduleclk);
@@ -628,7 +1328,13 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		break;
 
 		case IOCTL_SET_VE_FREQ:
-			return __set_ve_freq((int) arg);
+			return cedar_set_ve_freq((int) arg);
+
+	case IOCTL_VE_SLACK:
+		spin_lock_irqsave(&cedar_sched_lock, flags);
+		cedar_slack_report((int)arg);
+		spin_unlock_irqrestore(&cedar_sched_lock, flags);
+		break;
         case IOCTL_GETVALUE_AVS2:
 			/* Return AVS1 counter value */
             return readl(cedar_devp->iomap_addrs.regs_avs + 0x88);
@@ -788,35 +1494,161 @@ long cedardev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
     return ret;
 }
 
+static struct cedar_ctx *cedar_ctx_create(void)
+{
+	struct cedar_ctx *ctx;
+	unsigned long flags;
+	int first;
+
+	ctx = kzalloc(sizeof(struct cedar_ctx), GFP_KERNEL);
+	if (!ctx)
+		return NULL;
+	init_waitqueue_head(&ctx->wq);
+	INIT_LIST_HEAD(&ctx->frames);
+	INIT_LIST_HEAD(&ctx->imports);
+	ctx->pid = task_tgid_vnr(current);
+	get_task_comm(ctx->comm, current);
+	ctx->vruntime_ns = cedar_min_vruntime;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	first = list_empty(&cedar_ctx_list);
+	list_add_tail(&ctx->list, &cedar_ctx_list);
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	/* playback is about to start, free up frame memory ahead of it */
+	if (first)
+		cedar_frame_drain_start(&sw_device_cedar.dev);
+
+	return ctx;
+}
+
+static void cedar_ctx_destroy(struct cedar_ctx *ctx)
+{
+	unsigned long flags;
+	int last;
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	list_del(&ctx->list);
+	ctx->waiting = 0;
+	if (ve_owner == ctx)
+		cedar_sched_put(ctx);
+	last = list_empty(&cedar_ctx_list);
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	cedar_frame_release_all(&ctx->frames);
+	cedar_frame_unimport_all(&ctx->imports);
+	if (last)
+		cedar_frame_drain_stop();
+	kfree(ctx->regs);
+	kfree(ctx);
+}
+
 static int cedardev_open(struct inode *inode, struct file *filp)
 {
-	struct cedar_dev *devp;
-	devp = container_of(inode->i_cdev, struct cedar_dev, cdev);
-	filp->private_data = devp;
-	if (down_interruptible(&devp->sem)) {
-		return -ERESTARTSYS;
-	}
-	/* init other resource here */
-    devp->irq_flag = 0;
-	up(&devp->sem);
+	struct cedar_ctx *ctx;
+
+	ctx = cedar_ctx_create();
+	if (!ctx)
+		return -ENOMEM;
+
+	filp->private_data = ctx;
 	nonseekable_open(inode, filp);
 	return 0;
 }
 
 static int cedardev_release(struct inode *inode, struct file *filp)
 {
-	struct cedar_dev *devp;
-
-	devp = filp->private_data;
-	if (down_interruptible(&devp->sem)) {
-		return -ERESTARTSYS;
-	}
-	/* release other resource here */
-    devp->irq_flag = 1;
-	up(&devp->sem);
+	cedar_ctx_destroy(filp->private_data);
 	return 0;
 }
 
+/*
+ * In-kernel VE clients, a V4L2 mem2mem decoder say, get a session like
+ * an open handle of /dev/cedar_dev: scheduled against the userspace
+ * ones, with its own interrupt delivery. The VE clocks stay on while
+ * kernel sessions or IOCTL_ENGINE_REQ holders are around.
+ */
+struct cedar_ctx *cedar_ve_session_open(const char *name, unsigned int type,
+					unsigned int period_us)
+{
+	struct cedar_ctx *ctx;
+
+	if (type > CEDARV_SESSION_ENCODE)
+		return ERR_PTR(-EINVAL);
+
+	ctx = cedar_ctx_create();
+	if (!ctx)
+		return ERR_PTR(-ENOMEM);
+	ctx->type = type;
+	ctx->period_us = period_us;
+	ctx->pid = 0;
+	strlcpy(ctx->comm, name, sizeof(ctx->comm));
+
+	enable_cedar_hw_clk();
+	cedar_devp->ref_count++;
+	return ctx;
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_open);
+
+void cedar_ve_session_close(struct cedar_ctx *ctx)
+{
+	cedar_ctx_destroy(ctx);
+	if (--cedar_devp->ref_count == 0)
+		disable_cedar_hw_clk();
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_close);
+
+/* IOCTL_VE_ACQUIRE, IOCTL_VE_RELEASE and IOCTL_WAIT_VE for kernel sessions */
+int cedar_ve_session_acquire(struct cedar_ctx *ctx)
+{
+	return cedar_ve_acquire(ctx);
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_acquire);
+
+int cedar_ve_session_release(struct cedar_ctx *ctx)
+{
+	return cedar_ve_release(ctx);
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_release);
+
+int cedar_ve_session_wait(struct cedar_ctx *ctx, unsigned long timeout)
+{
+	return cedar_ve_wait_irq(ctx, timeout);
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_wait);
+
+/*
+ * Pin a dma-buf, from the CSI or disp writeback say, as encoder input
+ * or frame. The session holds its own reference until unimported or
+ * closed.
+ */
+int cedar_ve_session_import(struct cedar_ctx *ctx, struct dma_buf *buf,
+			    unsigned int *phys)
+{
+	int ret;
+
+	get_dma_buf(buf);
+	ret = cedar_frame_import_buf(&sw_device_cedar.dev, &ctx->imports,
+				     buf, phys);
+	if (ret)
+		dma_buf_put(buf);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_import);
+
+int cedar_ve_session_unimport(struct cedar_ctx *ctx, unsigned int phys)
+{
+	return cedar_frame_unimport(&ctx->imports, phys);
+}
+EXPORT_SYMBOL_GPL(cedar_ve_session_unimport);
+
+/* the macc registers, to be touched only while owning the VE */
+void __iomem *cedar_ve_regs(void)
+{
+	return (void __iomem *)cedar_devp->iomap_addrs.regs_macc;
+}
+EXPORT_SYMBOL_GPL(cedar_ve_regs);
+
 void cedardev_vma_open(struct vm_area_struct *vma)
 {
 }
@@ -894,6 +1726,92 @@ static int snd_sw_cedar_resume(struct platform_device *pdev)
 	return 0;
 }
 
+static struct dentry *cedar_debugfs;
+
+static int cedar_sessions_show(struct seq_file *m, void *v)
+{
+	static const char *types[] = { "decode", "encode" };
+	struct cedar_ctx *ctx;
+	unsigned long flags;
+
+	seq_printf(m, "ve clock: %lu Hz\n", clk_get_rate(ve_moduleclk));
+	seq_printf(m, "%-6s %-16s %-6s %8s %10s %10s %8s %10s %10s %10s %8s\n",
+		   "pid", "comm", "type", "jobs", "hw avg us", "hw max us",
+		   "frames", "frm avg us", "frm max us", "wait ms", "timeouts");
+
+	spin_lock_irqsave(&cedar_sched_lock, flags);
+	list_for_each_entry(ctx, &cedar_ctx_list, list) {
+		seq_printf(m, "%-6d %-16s %-6s %8u %10llu %10llu %8u %10llu %10llu %10llu %8u%s\n",
+			   ctx->pid, ctx->comm, types[ctx->type], ctx->jobs,
+			   ctx->jobs ? div_u64(div_u64(ctx->hw_ns, ctx->jobs),
+						 NSEC_PER_USEC) : 0,
+			   div_u64(ctx->hw_max_ns, NSEC_PER_USEC), ctx->frames,
+			   ctx->frames ? div_u64(div_u64(ctx->frame_ns, ctx->frames),
+						   NSEC_PER_USEC) : 0,
+			   div_u64(ctx->frame_max_ns, NSEC_PER_USEC),
+			   div_u64(ctx->wait_ns, NSEC_PER_MSEC), ctx->timeouts,
+			   ctx == ve_owner ? " owner" : "");
+	}
+	spin_unlock_irqrestore(&cedar_sched_lock, flags);
+
+	return 0;
+}
+
+static int cedar_sessions_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cedar_sessions_show, inode->i_private);
+}
+
+static const struct file_operations cedar_sessions_fops = {
+	.owner		= THIS_MODULE,
+	.open		= cedar_sessions_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#ifdef CONFIG_VIDEO_DECODER_SUNXI_FRAMES
+static int cedar_cma_drain_show(struct seq_file *m, void *v)
+{
+	cedar_frame_drain_show(m);
+	return 0;
+}
+
+static int cedar_cma_drain_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cedar_cma_drain_show, inode->i_private);
+}
+
+static const struct file_operations cedar_cma_drain_fops = {
+	.owner		= THIS_MODULE,
+	.open		= cedar_cma_drain_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static void cedar_debugfs_init(void)
+{
+	cedar_debugfs = debugfs_create_dir("cedar", NULL);
+	if (IS_ERR_OR_NULL(cedar_debugfs)) {
+		cedar_debugfs = NULL;
+		return;
+	}
+	debugfs_create_file("sessions", 0444, cedar_debugfs, NULL,
+			    &cedar_sessions_fops);
+#ifdef CONFIG_VIDEO_DECODER_SUNXI_FRAMES
+	debugfs_create_file("cma_drain", 0444, cedar_debugfs, NULL,
+			    &cedar_cma_drain_fops);
+#endif
+}
+
+static void cedar_debugfs_exit(void)
+{
+	debugfs_remove_recursive(cedar_debugfs);
+	cedar_debugfs = NULL;
+}
+
 static struct file_operations cedardev_fops = {
     .owner   = THIS_MODULE,
     .mmap    = cedardev_mmap,
@@ -907,6 +1825,10 @@ static struct file_operations cedardev_fops = {
 /*data relating*/
 static struct platform_device sw_device_cedar = {
 	.name = "sunxi-cedar",
+	.dev = {
+		/* frames are checked against the real VE window */
+		.coherent_dma_mask = DMA_BIT_MASK(32),
+	},
 };
 
 /*method relating*/
@@ -1059,6 +1981,9 @@ static int __init cedardev_init(void)
 	*/
     setup_timer(&cedar_devp->cedar_engine_timer, cedar_engine_for_events, (unsigned long)cedar_devp);
 	setup_timer(&cedar_devp->cedar_engine_timer_rel, cedar_engine_for_timer_rel, (unsigned long)cedar_devp);
+	cedar_devfreq_init(&sw_device_cedar.dev);
+	cedar_cool_init();
+	cedar_debugfs_init();
 	printk("[cedar dev]: install end!!!\n");
 	return 0;
 }
@@ -1069,6 +1994,9 @@ static void __exit cedardev_exit(void)
 	dev_t dev;
 	dev = MKDEV(g_dev_major, g_dev_minor);
 
+	cedar_debugfs_exit();
+	cedar_cool_exit();
+	cedar_devfreq_exit();
     free_irq(VE_IRQ_NO, NULL);
 	iounmap(cedar_devp->iomap_addrs.regs_macc);
 	iounmap(cedar_devp->iomap_addrs.regs_avs);
@@ -66,6 +66,18 @@ enum IOCTL_CMD {
 
 	IOCTL_READ_REG = 0x300,
 	IOCTL_WRITE_REG,
+
+	/* per open handle VE scheduling, see struct cedarv_session */
+	IOCTL_SET_SESSION = 0x400,
+	IOCTL_VE_ACQUIRE,
+	IOCTL_VE_RELEASE,
+	IOCTL_VE_YIELD,
+	IOCTL_VE_SLACK,
+
+	IOCTL_FRAME_ALLOC = 0x500,
+	IOCTL_FRAME_SYNC,
+	IOCTL_FRAME_IMPORT,
+	IOCTL_FRAME_UNIMPORT,
 };
 
 struct cedarv_env_infomation{
@@ -103,11 +115,131 @@ struct cedarv_engine_task_info {
 	unsigned int total_time;
 };
 
+#define CEDARV_SESSION_DECODE	0
+#define CEDARV_SESSION_ENCODE	1
+
+/*
+ * IOCTL_SET_SESSION: describe what this handle runs. A session with a
+ * frame period gets the VE earliest deadline first, its deadline being
+ * IOCTL_VE_ACQUIRE time plus the period; sessions without a period
+ * (background transcodes, thumbnails) share what is left by the VE time
+ * they have used. IOCTL_VE_ACQUIRE blocks until the handle owns the VE,
+ * IOCTL_VE_RELEASE hands it on; while a handle owns it, VE interrupts
+ * only wake that handle's IOCTL_WAIT_VE and poll.
+ *
+ * IOCTL_VE_YIELD: the owner calls it between slices, with the VE idle.
+ * If a session with an earlier deadline is waiting, the registers of
+ * the running mpeg, h264 or avc encode job are saved, the VE is handed
+ * over and the call blocks until it comes back with the registers
+ * restored; it then returns 1. It returns 0 when there was no reason
+ * to give the VE away.
+ *
+ * IOCTL_VE_SLACK: report how many microseconds before its deadline the
+ * last frame was done, negative when it was late, for the VE clock
+ * governor. Sessions with a period get this at IOCTL_VE_RELEASE
+ * without asking.
+ */
+struct cedarv_session {
+	unsigned int type;		/* CEDARV_SESSION_* */
+	unsigned int period_us;		/* frame interval, 0 for best effort */
+};
+
+/*
+ * IOCTL_FRAME_ALLOC: allocate a reference or output frame on its own,
+ * instead of carving it out of the phymem_start region. It comes back
+ * as a dma-buf fd that can be mmapped or handed to disp and g2d, and
+ * its physical address, which lies inside the window the VE can reach.
+ * The memory goes away when the last user of the dma-buf drops it; a
+ * frame nobody took over is freed when the allocating handle is closed.
+ *
+ * Frames are mapped write-combined, which suits decoded pictures the
+ * cpu never reads. Bitstream buffers the cpu fills should be allocated
+ * with CEDARV_FRAME_CACHED (up to 4MB) and bracketed with
+ * IOCTL_FRAME_SYNC, which only cleans or invalidates the given bytes.
+ */
+#define CEDARV_FRAME_CACHED	0x1
+
+struct cedarv_frame_alloc {
+	unsigned int size;		/* in: bytes */
+	unsigned int flags;		/* in: CEDARV_FRAME_*, O_CLOEXEC */
+	int fd;				/* out: dma-buf */
+	unsigned int phys;		/* out: physical address */
+};
+
+#define CEDARV_SYNC_START	0x0	/* before the cpu touches it */
+#define CEDARV_SYNC_END		0x1	/* before the VE touches it again */
+#define CEDARV_SYNC_READ	0x2	/* cpu reads the range */
+#define CEDARV_SYNC_WRITE	0x4	/* cpu writes the range */
+
+struct cedarv_frame_sync {
+	int fd;				/* from IOCTL_FRAME_ALLOC */
+	unsigned int offset;
+	unsigned int len;
+	unsigned int flags;		/* CEDARV_SYNC_* */
+};
+
+/*
+ * IOCTL_FRAME_IMPORT: pin a dma-buf from another exporter, an ion heap
+ * or disp say, for the VE and return its physical address. It must be
+ * contiguous and inside the VE window, the SUNXI_ION_HEAP_VE heap gives
+ * out such buffers. It stays pinned until IOCTL_FRAME_UNIMPORT with the
+ * physical address, or until the handle is closed.
+ */
+struct cedarv_frame_import {
+	int fd;				/* in: dma-buf */
+	unsigned int size;		/* out: bytes */
+	unsigned int phys;		/* out: physical address */
+};
+
 struct cedarv_regop {
 	unsigned int addr;
 	unsigned int value;
 };
 
+/*
+ * avs_dev: mmap offset 0 gives a read-only page that extends AVS_CNT1
+ * to 64 bits without an ioctl per read. The kernel refreshes it on
+ * every counter ioctl of avs_dev and at least hourly, well within a
+ * wrap. A reader takes seq, skipping odd values, reads hi and last,
+ * then the raw counter at cnt_offset of the register mapping, and
+ * retries if seq changed meanwhile; a raw value below last means one
+ * more wrap:
+ *
+ *	value = ((__u64)(hi + (cnt < last)) << 32) | cnt;
+ *
+ * rate is the count frequency for div, as read at the last update.
+ * Resetting the counter through cedar_dev instead of avs_dev looks
+ * like a wrap to the page.
+ */
+#define AVS_COUNTER_PAGE_OFFSET	0
+
+struct avs_counter_page {
+	unsigned int seq;		/* odd while the kernel updates */
+	unsigned int hi;		/* wraps since the last reset */
+	unsigned int last;		/* AVS_CNT1 at the last update */
+	unsigned int running;		/* enabled and not paused */
+	unsigned int div;		/* AVS_CNT1 divisor, N + 1 */
+	unsigned int rate;		/* counts per second */
+	unsigned int cnt_offset;	/* AVS_CNT1 in the ccmu register page */
+};
+
+#ifdef __KERNEL__
+/* in-kernel VE sessions, see sunxi_cedar.c */
+struct cedar_ctx;
+struct dma_buf;
+
+extern struct cedar_ctx *cedar_ve_session_open(const char *name, unsigned int type,
+					       unsigned int period_us);
+extern void cedar_ve_session_close(struct cedar_ctx *ctx);
+extern int cedar_ve_session_acquire(struct cedar_ctx *ctx);
+extern int cedar_ve_session_release(struct cedar_ctx *ctx);
+extern int cedar_ve_session_wait(struct cedar_ctx *ctx, unsigned long timeout);
+extern int cedar_ve_session_import(struct cedar_ctx *ctx, struct dma_buf *buf,
+				   unsigned int *phys);
+extern int cedar_ve_session_unimport(struct cedar_ctx *ctx, unsigned int phys);
+extern void __iomem *cedar_ve_regs(void);
+#endif
+
 /*--------------------------------------------------------------------------------*/
 #define REGS_pBASE			(0x01C00000)	 	      // register base addr
 
@@ -139,4 +271,68 @@ struct cedarv_regop {
 #define SRAM_REG_ADDR_CFG   (SRAM_REGS_BASE + SRAM_REG_o_CFG) // SRAM MAP Cfg Reg 0
 /*--------------------------------------------------------------------------------*/
 
+#ifdef __KERNEL__
+struct seq_file;
+
+#ifdef CONFIG_VIDEO_DECODER_SUNXI_FRAMES
+int cedar_frame_alloc(struct device *dev, struct list_head *frames,
+		      struct cedarv_frame_alloc *req);
+void cedar_frame_release_all(struct list_head *frames);
+int cedar_frame_sync(struct cedarv_frame_sync *req);
+int cedar_frame_import(struct device *dev, struct list_head *imports,
+		       struct cedarv_frame_import *req);
+int cedar_frame_import_buf(struct device *dev, struct list_head *imports,
+			   struct dma_buf *buf, unsigned int *phys);
+int cedar_frame_unimport(struct list_head *imports, unsigned int phys);
+void cedar_frame_unimport_all(struct list_head *imports);
+void cedar_frame_drain_start(struct device *dev);
+void cedar_frame_drain_stop(void);
+void cedar_frame_drain_show(struct seq_file *m);
+#else
+static inline int cedar_frame_alloc(struct device *dev,
+				    struct list_head *frames,
+				    struct cedarv_frame_alloc *req)
+{
+	return -ENOTTY;
+}
+static inline void cedar_frame_release_all(struct list_head *frames)
+{
+}
+static inline int cedar_frame_sync(struct cedarv_frame_sync *req)
+{
+	return -ENOTTY;
+}
+static inline int cedar_frame_import(struct device *dev,
+				     struct list_head *imports,
+				     struct cedarv_frame_import *req)
+{
+	return -ENOTTY;
+}
+static inline int cedar_frame_import_buf(struct device *dev,
+					 struct list_head *imports,
+					 struct dma_buf *buf,
+					 unsigned int *phys)
+{
+	return -ENOTTY;
+}
+static inline int cedar_frame_unimport(struct list_head *imports,
+				       unsigned int phys)
+{
+	return -ENOTTY;
+}
+static inline void cedar_frame_unimport_all(struct list_head *imports)
+{
+}
+static inline void cedar_frame_drain_start(struct device *dev)
+{
+}
+static inline void cedar_frame_drain_stop(void)
+{
+}
+static inline void cedar_frame_drain_show(struct seq_file *m)
+{
+}
+#endif
+#endif
+
 #endif
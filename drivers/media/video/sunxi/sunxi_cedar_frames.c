@@ -0,0 +1,667 @@
+/*
+ * drivers/media/video/sunxi/sunxi_cedar_frames.c
+ *
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Decoder frames from CMA, exported as dma-bufs. The VE works on
+ * physical addresses and doesn't hold a dma-buf reference of its own,
+ * so the allocating handle keeps one on every frame until it is
+ * closed; after that a frame lives as long as an fd or an importer
+ * (disp, g2d) still has it.
+ *
+ * Frames are write-combined dma memory by default. Cached ones come
+ * from the DMA zone, which on sunxi is the VE window, and the cpu side
+ * is only made coherent for the bytes named in IOCTL_FRAME_SYNC.
+ *
+ * Buffers of other exporters, the sunxi ion heaps mostly, are imported
+ * by attaching them to the cedar device; the mapping pins them until
+ * the handle lets go.
+ *
+ * Getting a frame out of CMA means migrating whatever movable pages
+ * sit in the range first, which is what makes the first frames of a
+ * playback slow. So when a session opens, a worker already takes
+ * cma_drain_mb out of the area in chunks and holds them; the frame
+ * allocations then give back a chunk just before they ask, and find it
+ * free. Whatever isn't used within cma_drain_hold_ms, or when the last
+ * session closes, goes back to the page allocator.
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/dma-contiguous.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <mach/hardware.h>
+#include "sunxi_cedar.h"
+
+/* the VE only reaches the first 256MB of dram */
+#define CEDAR_FRAME_LIMIT	(SW_PA_SDRAM_START + SZ_256M)
+
+/* all frames of all handles together */
+static unsigned int frame_pool_mb = 96;
+module_param(frame_pool_mb, uint, 0644);
+MODULE_PARM_DESC(frame_pool_mb, "Most memory given out as frames, in MB");
+
+/* taken out of CMA ahead of the frames of a new session */
+static unsigned int cma_drain_mb = 32;
+module_param(cma_drain_mb, uint, 0644);
+MODULE_PARM_DESC(cma_drain_mb, "CMA drained when a session opens, in MB, 0 disables");
+
+static unsigned int cma_drain_hold_ms = 10000;
+module_param(cma_drain_hold_ms, uint, 0644);
+MODULE_PARM_DESC(cma_drain_hold_ms, "How long drained CMA waits for frames, in ms");
+
+#define CEDAR_DRAIN_CHUNK	SZ_4M
+#define CEDAR_DRAIN_PAGES	(CEDAR_DRAIN_CHUNK >> PAGE_SHIFT)
+#define CEDAR_DRAIN_MAX		(SZ_256M / CEDAR_DRAIN_CHUNK)
+
+struct cedar_drain {
+	struct device *dev;
+	struct work_struct work;
+	struct delayed_work expire;
+	int stop;			/* the last session closed */
+
+	/* chunks in the order they were taken, lowest first mostly */
+	struct page *chunks[CEDAR_DRAIN_MAX];
+	unsigned int first, nr;
+	size_t credit;			/* given back, not yet allocated */
+
+	/* for debugfs cedar/cma_drain */
+	u32 runs;
+	u32 taken;			/* chunks taken, all runs */
+	u32 given;			/* given back for frames */
+	u32 failed;			/* runs that ran out of CMA */
+	u64 chunk_ns, chunk_max_ns;	/* migration per chunk */
+	u64 last_run_ns;
+	u32 allocs;			/* uncached frame allocations */
+	u64 alloc_ns, alloc_max_ns;
+};
+
+static struct cedar_drain cedar_drain;
+static DEFINE_MUTEX(cedar_drain_lock);
+
+struct cedar_frame {
+	struct list_head list;		/* on the allocating handle */
+	struct device *dev;
+	struct dma_buf *buf;
+	void *virt;
+	dma_addr_t phys;
+	size_t size;
+	int cached;			/* CEDARV_FRAME_CACHED */
+};
+
+struct cedar_import {
+	struct list_head list;		/* on the importing handle */
+	struct dma_buf *buf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	dma_addr_t phys;
+};
+
+static DEFINE_MUTEX(cedar_frames_lock);
+static size_t cedar_frames_total;
+
+static struct sg_table *cedar_frame_map(struct dma_buf_attachment *attach,
+					enum dma_data_direction dir)
+{
+	struct cedar_frame *frame = attach->dmabuf->priv;
+	struct sg_table *sgt;
+
+	sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sg_set_page(sgt->sgl, pfn_to_page(__phys_to_pfn(frame->phys)),
+		    frame->size, 0);
+
+	if (!dma_map_sg(attach->dev, sgt->sgl, sgt->nents, dir)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void cedar_frame_unmap(struct dma_buf_attachment *attach,
+			      struct sg_table *sgt,
+			      enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void cedar_frame_release(struct dma_buf *buf)
+{
+	struct cedar_frame *frame = buf->priv;
+
+	mutex_lock(&cedar_frames_lock);
+	cedar_frames_total -= frame->size;
+	mutex_unlock(&cedar_frames_lock);
+
+	if (frame->cached)
+		free_pages_exact(frame->virt, frame->size);
+	else
+		dma_free_writecombine(frame->dev, frame->size, frame->virt,
+				      frame->phys);
+	kfree(frame);
+}
+
+static int cedar_frame_begin_cpu(struct dma_buf *buf, size_t start,
+				 size_t len, enum dma_data_direction dir)
+{
+	struct cedar_frame *frame = buf->priv;
+
+	if (frame->cached)
+		dma_sync_single_for_cpu(frame->dev, frame->phys + start, len,
+					dir);
+	return 0;
+}
+
+static void cedar_frame_end_cpu(struct dma_buf *buf, size_t start,
+				size_t len, enum dma_data_direction dir)
+{
+	struct cedar_frame *frame = buf->priv;
+
+	if (frame->cached)
+		dma_sync_single_for_device(frame->dev, frame->phys + start,
+					   len, dir);
+	else
+		/* drain the write buffer before the VE reads */
+		wmb();
+}
+
+static void *cedar_frame_kmap(struct dma_buf *buf, unsigned long pgnum)
+{
+	struct cedar_frame *frame = buf->priv;
+
+	return frame->virt + (pgnum << PAGE_SHIFT);
+}
+
+static void *cedar_frame_kmap_atomic(struct dma_buf *buf, unsigned long pgnum)
+{
+	return cedar_frame_kmap(buf, pgnum);
+}
+
+static int cedar_frame_mmap(struct dma_buf *buf, struct vm_area_struct *vma)
+{
+	struct cedar_frame *frame = buf->priv;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (!frame->cached)
+		return dma_mmap_writecombine(frame->dev, vma, frame->virt,
+					     frame->phys, frame->size);
+
+	if ((vma->vm_pgoff << PAGE_SHIFT) + size > frame->size)
+		return -EINVAL;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       __phys_to_pfn(frame->phys) + vma->vm_pgoff,
+			       size, vma->vm_page_prot);
+}
+
+static const struct dma_buf_ops cedar_frame_ops = {
+	.map_dma_buf = cedar_frame_map,
+	.unmap_dma_buf = cedar_frame_unmap,
+	.release = cedar_frame_release,
+	.begin_cpu_access = cedar_frame_begin_cpu,
+	.end_cpu_access = cedar_frame_end_cpu,
+	.kmap_atomic = cedar_frame_kmap_atomic,
+	.kmap = cedar_frame_kmap,
+	.mmap = cedar_frame_mmap,
+};
+
+static void cedar_drain_put(struct cedar_drain *d)
+{
+	dma_release_from_contiguous(d->dev, d->chunks[d->first],
+				    CEDAR_DRAIN_PAGES);
+	d->first++;
+	if (!--d->nr)
+		d->first = 0;
+}
+
+static void cedar_drain_work(struct work_struct *work)
+{
+	struct cedar_drain *d = container_of(work, struct cedar_drain, work);
+	unsigned int want = min_t(unsigned int, cma_drain_mb / 4,
+				  CEDAR_DRAIN_MAX);
+	ktime_t run = ktime_get();
+	unsigned int i;
+
+	for (i = 0; i < want; i++) {
+		struct page *page;
+		ktime_t start = ktime_get();
+		u64 ns;
+
+		page = dma_alloc_from_contiguous(d->dev, CEDAR_DRAIN_PAGES, 0);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		mutex_lock(&cedar_drain_lock);
+		if (!page || d->stop || d->first + d->nr == CEDAR_DRAIN_MAX) {
+			mutex_unlock(&cedar_drain_lock);
+			if (page)
+				dma_release_from_contiguous(d->dev, page,
+							    CEDAR_DRAIN_PAGES);
+			else
+				d->failed++;
+			break;
+		}
+		d->chunks[d->first + d->nr++] = page;
+		d->taken++;
+		d->chunk_ns += ns;
+		if (ns > d->chunk_max_ns)
+			d->chunk_max_ns = ns;
+		mutex_unlock(&cedar_drain_lock);
+	}
+
+	d->last_run_ns = ktime_to_ns(ktime_sub(ktime_get(), run));
+	pr_debug("cedar: drained %u MB of CMA in %llu ms\n", i * 4,
+		 div_u64(d->last_run_ns, NSEC_PER_MSEC));
+}
+
+static void cedar_drain_expire(struct work_struct *work)
+{
+	struct cedar_drain *d = &cedar_drain;
+
+	mutex_lock(&cedar_drain_lock);
+	/* a drain still running stops after its current chunk */
+	d->stop = 1;
+	while (d->nr)
+		cedar_drain_put(d);
+	d->credit = 0;
+	mutex_unlock(&cedar_drain_lock);
+}
+
+/* a session opened, get the frame memory ready in the background */
+void cedar_frame_drain_start(struct device *dev)
+{
+	struct cedar_drain *d = &cedar_drain;
+
+	if (!cma_drain_mb || !dev_get_cma_area(dev))
+		return;
+
+	mutex_lock(&cedar_drain_lock);
+	if (!d->dev) {
+		d->dev = dev;
+		INIT_WORK(&d->work, cedar_drain_work);
+		INIT_DELAYED_WORK(&d->expire, cedar_drain_expire);
+	}
+	d->stop = 0;
+	d->runs++;
+	mutex_unlock(&cedar_drain_lock);
+
+	queue_work(system_long_wq, &d->work);
+	cancel_delayed_work(&d->expire);
+	schedule_delayed_work(&d->expire, msecs_to_jiffies(cma_drain_hold_ms));
+}
+
+/* the last session closed */
+void cedar_frame_drain_stop(void)
+{
+	struct cedar_drain *d = &cedar_drain;
+
+	if (!d->dev)
+		return;
+
+	mutex_lock(&cedar_drain_lock);
+	d->stop = 1;
+	mutex_unlock(&cedar_drain_lock);
+
+	cancel_work_sync(&d->work);
+	cancel_delayed_work_sync(&d->expire);
+	cedar_drain_expire(NULL);
+}
+
+/* give back drained chunks so that size bytes are free in the area */
+static void cedar_drain_take(size_t size)
+{
+	struct cedar_drain *d = &cedar_drain;
+
+	mutex_lock(&cedar_drain_lock);
+	while (d->credit < size && d->nr) {
+		cedar_drain_put(d);
+		d->credit += CEDAR_DRAIN_CHUNK;
+		d->given++;
+	}
+	d->credit = d->credit > size ? d->credit - size : 0;
+	mutex_unlock(&cedar_drain_lock);
+}
+
+void cedar_frame_drain_show(struct seq_file *m)
+{
+	struct cedar_drain *d = &cedar_drain;
+
+	mutex_lock(&cedar_drain_lock);
+	seq_printf(m, "runs: %u, failed: %u\n", d->runs, d->failed);
+	seq_printf(m, "held: %u MB, chunks taken: %u, given to frames: %u\n",
+		   d->nr * (CEDAR_DRAIN_CHUNK / SZ_1M), d->taken, d->given);
+	seq_printf(m, "migration per 4MB chunk: avg %llu us, max %llu us\n",
+		   d->taken ? div_u64(div_u64(d->chunk_ns, d->taken),
+				      NSEC_PER_USEC) : 0,
+		   div_u64(d->chunk_max_ns, NSEC_PER_USEC));
+	seq_printf(m, "last drain: %llu ms\n",
+		   div_u64(d->last_run_ns, NSEC_PER_MSEC));
+	seq_printf(m, "frame allocations: %u, avg %llu us, max %llu us\n",
+		   d->allocs, d->allocs ? div_u64(div_u64(d->alloc_ns, d->allocs),
+						  NSEC_PER_USEC) : 0,
+		   div_u64(d->alloc_max_ns, NSEC_PER_USEC));
+	mutex_unlock(&cedar_drain_lock);
+}
+
+/*
+ * Allocate a frame for the handle owning frames, fills in req->fd and
+ * req->phys.
+ */
+int cedar_frame_alloc(struct device *dev, struct list_head *frames,
+		      struct cedarv_frame_alloc *req)
+{
+	struct cedar_frame *frame;
+	size_t size = PAGE_ALIGN(req->size);
+	int ret;
+
+	if (!size)
+		return -EINVAL;
+	/* cached frames come from the page allocator */
+	if ((req->flags & CEDARV_FRAME_CACHED) &&
+	    size > (PAGE_SIZE << (MAX_ORDER - 1)))
+		return -EINVAL;
+
+	mutex_lock(&cedar_frames_lock);
+	if (cedar_frames_total + size > (size_t)frame_pool_mb * SZ_1M) {
+		mutex_unlock(&cedar_frames_lock);
+		return -ENOMEM;
+	}
+	cedar_frames_total += size;
+	mutex_unlock(&cedar_frames_lock);
+
+	frame = kzalloc(sizeof(struct cedar_frame), GFP_KERNEL);
+	if (!frame) {
+		ret = -ENOMEM;
+		goto err_unaccount;
+	}
+	frame->dev = dev;
+	frame->size = size;
+	frame->cached = !!(req->flags & CEDARV_FRAME_CACHED);
+
+	if (frame->cached) {
+		frame->virt = alloc_pages_exact(size, GFP_KERNEL | GFP_DMA |
+						__GFP_ZERO);
+		if (frame->virt) {
+			frame->phys = virt_to_phys(frame->virt);
+			/* no dirty zeroes may land on VE output later */
+			dma_sync_single_for_device(dev, frame->phys, size,
+						   DMA_TO_DEVICE);
+		}
+	} else {
+		ktime_t start = ktime_get();
+		u64 ns;
+
+		cedar_drain_take(size);
+		frame->virt = dma_alloc_writecombine(dev, size, &frame->phys,
+						     GFP_KERNEL);
+
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		mutex_lock(&cedar_drain_lock);
+		cedar_drain.allocs++;
+		cedar_drain.alloc_ns += ns;
+		if (ns > cedar_drain.alloc_max_ns)
+			cedar_drain.alloc_max_ns = ns;
+		mutex_unlock(&cedar_drain_lock);
+	}
+	if (!frame->virt) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+	if (frame->phys + size > CEDAR_FRAME_LIMIT) {
+		printk(KERN_NOTICE "cedar: frame at 0x%08x is above the VE window\n",
+		       frame->phys);
+		ret = -ENOMEM;
+		goto err_dma;
+	}
+
+	frame->buf = dma_buf_export(frame, &cedar_frame_ops, size, O_RDWR);
+	if (IS_ERR(frame->buf)) {
+		ret = PTR_ERR(frame->buf);
+		goto err_dma;
+	}
+
+	/* one reference for the handle, the fd gets the other */
+	get_dma_buf(frame->buf);
+	req->fd = dma_buf_fd(frame->buf, req->flags & O_CLOEXEC);
+	if (req->fd < 0) {
+		ret = req->fd;
+		/* both references go, the release frees the frame */
+		dma_buf_put(frame->buf);
+		dma_buf_put(frame->buf);
+		return ret;
+	}
+	req->phys = frame->phys;
+
+	mutex_lock(&cedar_frames_lock);
+	list_add(&frame->list, frames);
+	mutex_unlock(&cedar_frames_lock);
+
+	return 0;
+
+err_dma:
+	if (frame->cached)
+		free_pages_exact(frame->virt, size);
+	else
+		dma_free_writecombine(dev, size, frame->virt, frame->phys);
+err_free:
+	kfree(frame);
+err_unaccount:
+	mutex_lock(&cedar_frames_lock);
+	cedar_frames_total -= size;
+	mutex_unlock(&cedar_frames_lock);
+	return ret;
+}
+
+/* the handle is closed, drop its reference on every frame it allocated */
+void cedar_frame_release_all(struct list_head *frames)
+{
+	struct cedar_frame *frame, *tmp;
+	LIST_HEAD(drop);
+
+	mutex_lock(&cedar_frames_lock);
+	list_splice_init(frames, &drop);
+	mutex_unlock(&cedar_frames_lock);
+
+	list_for_each_entry_safe(frame, tmp, &drop, list) {
+		list_del(&frame->list);
+		dma_buf_put(frame->buf);
+	}
+}
+
+/* IOCTL_FRAME_SYNC: make a range of a frame coherent for cpu or VE */
+int cedar_frame_sync(struct cedarv_frame_sync *req)
+{
+	struct dma_buf *buf;
+	enum dma_data_direction dir;
+	int ret = 0;
+
+	switch (req->flags & (CEDARV_SYNC_READ | CEDARV_SYNC_WRITE)) {
+	case CEDARV_SYNC_READ:
+		dir = DMA_FROM_DEVICE;
+		break;
+	case CEDARV_SYNC_WRITE:
+		dir = DMA_TO_DEVICE;
+		break;
+	case CEDARV_SYNC_READ | CEDARV_SYNC_WRITE:
+		dir = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	buf = dma_buf_get(req->fd);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	if (buf->ops != &cedar_frame_ops ||
+	    req->offset > buf->size || req->len > buf->size - req->offset) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (req->flags & CEDARV_SYNC_END)
+		dma_buf_end_cpu_access(buf, req->offset, req->len, dir);
+	else
+		ret = dma_buf_begin_cpu_access(buf, req->offset, req->len, dir);
+
+out:
+	dma_buf_put(buf);
+	return ret;
+}
+
+/*
+ * Pin a contiguous dma-buf inside the VE window, taking over the
+ * caller's reference to buf on success.
+ */
+int cedar_frame_import_buf(struct device *dev, struct list_head *imports,
+			   struct dma_buf *buf, unsigned int *phys)
+{
+	struct cedar_import *imp;
+	int ret;
+
+	imp = kzalloc(sizeof(struct cedar_import), GFP_KERNEL);
+	if (!imp)
+		return -ENOMEM;
+	imp->buf = buf;
+
+	imp->attach = dma_buf_attach(imp->buf, dev);
+	if (IS_ERR(imp->attach)) {
+		ret = PTR_ERR(imp->attach);
+		goto err_free;
+	}
+
+	/* reference frames are read, output frames written */
+	imp->sgt = dma_buf_map_attachment(imp->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR_OR_NULL(imp->sgt)) {
+		ret = imp->sgt ? PTR_ERR(imp->sgt) : -ENOMEM;
+		goto err_detach;
+	}
+
+	if (imp->sgt->nents != 1) {
+		printk(KERN_NOTICE "cedar: dma-buf %p is not contiguous\n", buf);
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+	imp->phys = sg_phys(imp->sgt->sgl);
+	if (imp->phys + imp->buf->size > CEDAR_FRAME_LIMIT) {
+		printk(KERN_NOTICE "cedar: dma-buf at 0x%08x is above the VE window\n",
+		       imp->phys);
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	mutex_lock(&cedar_frames_lock);
+	list_add(&imp->list, imports);
+	mutex_unlock(&cedar_frames_lock);
+
+	*phys = imp->phys;
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(imp->buf, imp->attach);
+err_free:
+	kfree(imp);
+	return ret;
+}
+
+/* IOCTL_FRAME_IMPORT */
+int cedar_frame_import(struct device *dev, struct list_head *imports,
+		       struct cedarv_frame_import *req)
+{
+	struct dma_buf *buf;
+	int ret;
+
+	buf = dma_buf_get(req->fd);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	req->size = buf->size;
+	ret = cedar_frame_import_buf(dev, imports, buf, &req->phys);
+	if (ret)
+		dma_buf_put(buf);
+	return ret;
+}
+
+static void cedar_frame_put_import(struct cedar_import *imp)
+{
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_BIDIRECTIONAL);
+	dma_buf_detach(imp->buf, imp->attach);
+	dma_buf_put(imp->buf);
+	kfree(imp);
+}
+
+/* IOCTL_FRAME_UNIMPORT */
+int cedar_frame_unimport(struct list_head *imports, unsigned int phys)
+{
+	struct cedar_import *imp, *found = NULL;
+
+	mutex_lock(&cedar_frames_lock);
+	list_for_each_entry(imp, imports, list) {
+		if (imp->phys == phys) {
+			list_del(&imp->list);
+			found = imp;
+			break;
+		}
+	}
+	mutex_unlock(&cedar_frames_lock);
+
+	if (!found)
+		return -ENOENT;
+
+	cedar_frame_put_import(found);
+	return 0;
+}
+
+void cedar_frame_unimport_all(struct list_head *imports)
+{
+	struct cedar_import *imp, *tmp;
+	LIST_HEAD(drop);
+
+	mutex_lock(&cedar_frames_lock);
+	list_splice_init(imports, &drop);
+	mutex_unlock(&cedar_frames_lock);
+
+	list_for_each_entry_safe(imp, tmp, &drop, list) {
+		list_del(&imp->list);
+		cedar_frame_put_import(imp);
+	}
+}
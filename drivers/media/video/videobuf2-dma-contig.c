@@ -13,6 +13,8 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
 
 #include <media/videobuf2-core.h>
 #include <media/videobuf2-dma-contig.h>
@@ -111,6 +113,95 @@ static int vb2_dma_contig_mmap(void *buf_priv, struct vm_area_struct *vma)
 				  &vb2_common_vm_ops, &buf->handler);
 }
 
+#ifdef CONFIG_ARM
+/*
+ * dma-buf exporting. A coherent buffer is a single chunk, and without
+ * dma_get_sgtable() in this tree its pages come from dma_to_pfn().
+ */
+static struct sg_table *vb2_dc_dmabuf_map(struct dma_buf_attachment *attach,
+					  enum dma_data_direction dir)
+{
+	struct vb2_dc_buf *buf = attach->dmabuf->priv;
+	struct sg_table *sgt;
+
+	sgt = kzalloc(sizeof *sgt, GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sg_set_page(sgt->sgl,
+		    pfn_to_page(dma_to_pfn(buf->conf->dev, buf->dma_addr)),
+		    PAGE_ALIGN(buf->size), 0);
+
+	if (!dma_map_sg(attach->dev, sgt->sgl, sgt->nents, dir)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void vb2_dc_dmabuf_unmap(struct dma_buf_attachment *attach,
+				struct sg_table *sgt,
+				enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void vb2_dc_dmabuf_release(struct dma_buf *dbuf)
+{
+	/* drop the reference taken by vb2_dma_contig_get_dmabuf() */
+	vb2_dma_contig_put(dbuf->priv);
+}
+
+static void *vb2_dc_dmabuf_kmap(struct dma_buf *dbuf, unsigned long pgnum)
+{
+	struct vb2_dc_buf *buf = dbuf->priv;
+
+	return buf->vaddr + pgnum * PAGE_SIZE;
+}
+
+static int vb2_dc_dmabuf_mmap(struct dma_buf *dbuf, struct vm_area_struct *vma)
+{
+	return vb2_dma_contig_mmap(dbuf->priv, vma);
+}
+
+static struct dma_buf_ops vb2_dc_dmabuf_ops = {
+	.map_dma_buf = vb2_dc_dmabuf_map,
+	.unmap_dma_buf = vb2_dc_dmabuf_unmap,
+	.kmap = vb2_dc_dmabuf_kmap,
+	.kmap_atomic = vb2_dc_dmabuf_kmap,
+	.mmap = vb2_dc_dmabuf_mmap,
+	.release = vb2_dc_dmabuf_release,
+};
+
+static struct dma_buf *vb2_dma_contig_get_dmabuf(void *buf_priv)
+{
+	struct vb2_dc_buf *buf = buf_priv;
+	struct dma_buf *dbuf;
+
+	/* only buffers allocated here, not user pointers */
+	if (!buf->conf)
+		return ERR_PTR(-EINVAL);
+
+	dbuf = dma_buf_export(buf, &vb2_dc_dmabuf_ops, buf->size, O_RDWR);
+	if (IS_ERR(dbuf))
+		return dbuf;
+
+	/* dmabuf keeps reference to vb2 buffer */
+	atomic_inc(&buf->refcount);
+
+	return dbuf;
+}
+#endif
+
 static void *vb2_dma_contig_get_userptr(void *alloc_ctx, unsigned long vaddr,
 					unsigned long size, int write)
 {
@@ -158,6 +249,9 @@ const struct vb2_mem_ops vb2_dma_contig_memops = {
 	.get_userptr	= vb2_dma_contig_get_userptr,
 	.put_userptr	= vb2_dma_contig_put_userptr,
 	.num_users	= vb2_dma_contig_num_users,
+#ifdef CONFIG_ARM
+	.get_dmabuf	= vb2_dma_contig_get_dmabuf,
+#endif
 };
 EXPORT_SYMBOL_GPL(vb2_dma_contig_memops);
 
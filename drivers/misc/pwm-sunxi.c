@@ -50,6 +50,10 @@
 #include <linux/limits.h> 
 #include <linux/pwm.h> 
 #include <linux/kdev_t.h> 
+#include <linux/hrtimer.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/sunxi_pwm.h>
 #include <plat/system.h>
 #include <plat/sys_config.h>
 
@@ -73,9 +77,34 @@ unsigned int get_active_cycles(struct sun4i_pwm_available_channel *chan);
 unsigned long convert_string_to_microseconds(const char *buf); 
 int pwm_set_period_and_duty(struct sun4i_pwm_available_channel *chan); 
 void fixup_duty(struct sun4i_pwm_available_channel *chan); 
+static struct sun4i_pwm_wave *pwm_wave_get(struct sun4i_pwm_available_channel *chan);
+static void pwm_wave_free(struct sun4i_pwm_available_channel *chan);
  
  
 static DEFINE_MUTEX(sysfs_lock); 
+
+/*
+ * Waveform mode. The PWM has neither a DMA request nor an interrupt,
+ * so an hrtimer at the sample rate moves the samples from a ring into
+ * the period register. The PWM takes a new duty at the end of the
+ * carrier period running, the output never glitches.
+ */
+#define PWM_WAVE_FIFO_SIZE	8192	/* bytes, 4096 samples */
+#define PWM_WAVE_MAX_RATE	48000
+#define PWM_WAVE_DEF_CYCLES	256
+
+struct sun4i_pwm_wave {
+	struct sun4i_pwm_available_channel *chan;
+	struct hrtimer timer;
+	ktime_t interval;
+	struct kfifo fifo;			/* u16 samples */
+	spinlock_t lock;			/* serializes the producers */
+	wait_queue_head_t wait;			/* writers waiting for room */
+	unsigned int rate;
+	unsigned int cycles;			/* of the carrier period */
+	int running;
+	unsigned long underruns;		/* ticks with an empty ring */
+};
 static struct class pwm_class; 
  
 void *PWM_CTRL_REG_BASE = NULL; 
@@ -104,6 +133,9 @@ static ssize_t pwm_run_show(struct device *dev,struct device_attribute *attr, ch
 static ssize_t pwm_duty_percent_show(struct device *dev,struct device_attribute *attr, char *buf); 
 static ssize_t pwm_pulse_show(struct device *dev,struct device_attribute *attr, char *buf); 
 static ssize_t pwm_pin_show(struct device *dev,struct device_attribute *attr, char *buf); 
+static ssize_t pwm_wave_rate_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t pwm_wave_cycles_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t pwm_wave_underruns_show(struct device *dev, struct device_attribute *attr, char *buf);
  
 static ssize_t pwm_polarity_store(struct device *dev,struct device_attribute *attr, const char *buf, size_t size); 
 static ssize_t pwm_period_store(struct device *dev,struct device_attribute *attr, const char *buf, size_t size); 
@@ -111,6 +143,9 @@ static ssize_t pwm_duty_store(struct device *dev,struct device_attribute *attr,
 static ssize_t pwm_run_store(struct device *dev,struct device_attribute *attr, const char *buf, size_t size); 
 static ssize_t pwm_duty_percent_store(struct device *dev,struct device_attribute *attr, const char *buf, size_t size); 
 static ssize_t pwm_pulse_store(struct device *dev,struct device_attribute *attr, const char *buf, size_t size); 
+static ssize_t pwm_wave_rate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t pwm_wave_cycles_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t pwm_wave_write(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count);
  
 static DEVICE_ATTR(polarity, 0644,pwm_polarity_show, pwm_polarity_store); 
 static DEVICE_ATTR(period, 0644, pwm_period_show, pwm_period_store); 
@@ -119,6 +154,9 @@ static DEVICE_ATTR(run, 0644, pwm_run_show, pwm_run_store);
 static DEVICE_ATTR(duty_percent, 0644, pwm_duty_percent_show, pwm_duty_percent_store); 
 static DEVICE_ATTR(pulse, 0644, pwm_pulse_show, pwm_pulse_store); 
 static DEVICE_ATTR(pin, 0644, pwm_pin_show, NULL); 
+static DEVICE_ATTR(waveform_rate, 0644, pwm_wave_rate_show, pwm_wave_rate_store);
+static DEVICE_ATTR(waveform_cycles, 0644, pwm_wave_cycles_show, pwm_wave_cycles_store);
+static DEVICE_ATTR(waveform_underruns, 0444, pwm_wave_underruns_show, NULL);
  
 static const struct attribute *pwm_attrs[] = { 
 	&dev_attr_polarity.attr, 
@@ -128,12 +166,21 @@ static const struct attribute *pwm_attrs[] = {
 	&dev_attr_duty_percent.attr, 
 	&dev_attr_pulse.attr, 
 	&dev_attr_pin.attr, 
+	&dev_attr_waveform_rate.attr,
+	&dev_attr_waveform_cycles.attr,
+	&dev_attr_waveform_underruns.attr,
 	NULL, 
 }; 
  
 static const struct attribute_group pwm_attr_group = { 
 	.attrs = (struct attribute **) pwm_attrs 
 }; 
+
+/* samples for the waveform mode, native endian u16 */
+static struct bin_attribute pwm_wave_bin_attr = {
+	.attr = { .name = "waveform", .mode = 0200 },
+	.write = pwm_wave_write,
+};
  
 struct device *pwm0; 
 struct device *pwm1; 
@@ -179,6 +226,10 @@ static int __init sunxi_pwm_init(void)
 		if (err)
 			pr_err("pwm-sunxi: sysfs_create_group(pwm0) err %d\n",
 			       err);
+		err = sysfs_create_bin_file(&pwm0->kobj, &pwm_wave_bin_attr);
+		if (err)
+			pr_err("pwm-sunxi: waveform file of pwm0 err %d\n",
+			       err);
 
 		err = script_parser_fetch("pwm0_para", "pwm_period", &init_period,sizeof(init_period)/sizeof(int));
 		if (err) {
@@ -224,6 +275,10 @@ static int __init sunxi_pwm_init(void)
 		if (err)
 			pr_err("pwm-sunxi: sysfs_create_group(pwm1) err %d\n",
 			       err);
+		err = sysfs_create_bin_file(&pwm1->kobj, &pwm_wave_bin_attr);
+		if (err)
+			pr_err("pwm-sunxi: waveform file of pwm1 err %d\n",
+			       err);
 
 		err = script_parser_fetch("pwm1_para", "pwm_period", &init_period,sizeof(init_period)/sizeof(int));
 		if (err) {
@@ -255,13 +310,19 @@ void sunxi_pwm_exit(void)
 { 
 	void *timer_base = ioremap(SW_PA_TIMERC_IO_BASE, 0x400); 
 	void *PWM_CTRL_REG_BASE = timer_base + 0x200; 
+	int i;
+
+	for (i = 0; i < SUN4I_MAX_HARDWARE_PWM_CHANNELS; i++)
+		pwm_wave_free(&pwm_available_chan[i]);
 
 	if (pwm0) {
+		sysfs_remove_bin_file(&pwm0->kobj, &pwm_wave_bin_attr);
 		device_destroy(&pwm_class, pwm0->devt);
 		writel(pwm_available_chan[0].pin_backup.initializer,
 		       pwm_available_chan[0].pin_addr);
 	}
 	if (pwm1) {
+		sysfs_remove_bin_file(&pwm1->kobj, &pwm_wave_bin_attr);
 		device_destroy(&pwm_class, pwm1->devt);
 		writel(pwm_available_chan[1].pin_backup.initializer,
 		       pwm_available_chan[1].pin_addr);
@@ -650,6 +711,10 @@ int pwm_set_period_and_duty(struct sun4i_pwm_available_channel *chan) {
  
 ssize_t pwm_set_mode(unsigned int enable, struct sun4i_pwm_available_channel *chan) { 
 	ssize_t status = 0; 
+
+	/* the waveform owns the channel until it stops */
+	if (chan->wave && chan->wave->running)
+		return -EBUSY;
 	if(enable == NO_ENABLE_CHANGE) { 
 		switch (chan->channel) { 
 		case 0: 
@@ -850,6 +915,7 @@ struct pwm_device *pwm_request(int pwm_id, const char *label)
 		if (pwm->chan->use_count == 0) { 
 			pwm->chan->use_count++; 
 			pwm->chan->name = label; 
+			pwm_wave_get(pwm->chan);
 		} else 
 			pwm = ERR_PTR(-EBUSY); 
 	} else 
@@ -904,6 +970,296 @@ void pwm_free(struct pwm_device *pwm)
 EXPORT_SYMBOL(pwm_free); 
  
  
+static enum hrtimer_restart pwm_wave_tick(struct hrtimer *timer)
+{
+	struct sun4i_pwm_wave *wave =
+		container_of(timer, struct sun4i_pwm_wave, timer);
+	struct sun4i_pwm_available_channel *chan = wave->chan;
+	union sun4i_pwm_period_u period;
+	u16 sample;
+
+	/* a busy period register still holds the last sample, retry */
+	if (!(readl(chan->ctrl_addr) & PWM_CH_PERIOD_BUSY(chan->channel))) {
+		if (kfifo_out(&wave->fifo, &sample, sizeof(sample)) ==
+		    sizeof(sample)) {
+			period.initializer = 0;
+			period.s.pwm_entire_cycles = wave->cycles;
+			period.s.pwm_active_cycles = min_t(unsigned int, sample,
+							   wave->cycles);
+			writel(period.initializer, chan->period_reg_addr);
+		} else {
+			/* the output keeps the last duty */
+			wave->underruns++;
+		}
+
+		if (kfifo_avail(&wave->fifo) >= PWM_WAVE_FIFO_SIZE / 2 &&
+		    waitqueue_active(&wave->wait))
+			wake_up(&wave->wait);
+	}
+
+	hrtimer_forward_now(timer, wave->interval);
+	return HRTIMER_RESTART;
+}
+
+static struct sun4i_pwm_wave *pwm_wave_get(struct sun4i_pwm_available_channel *chan)
+{
+	struct sun4i_pwm_wave *wave;
+
+	mutex_lock(&sysfs_lock);
+	wave = chan->wave;
+	if (wave)
+		goto out;
+
+	wave = kzalloc(sizeof(*wave), GFP_KERNEL);
+	if (!wave)
+		goto out;
+	if (kfifo_alloc(&wave->fifo, PWM_WAVE_FIFO_SIZE, GFP_KERNEL)) {
+		kfree(wave);
+		wave = NULL;
+		goto out;
+	}
+
+	wave->chan = chan;
+	wave->cycles = PWM_WAVE_DEF_CYCLES;
+	spin_lock_init(&wave->lock);
+	init_waitqueue_head(&wave->wait);
+	hrtimer_init(&wave->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	wave->timer.function = pwm_wave_tick;
+	chan->wave = wave;
+out:
+	mutex_unlock(&sysfs_lock);
+	return wave;
+}
+
+static int pwm_wave_start(struct sun4i_pwm_available_channel *chan,
+			  unsigned int rate, unsigned int cycles)
+{
+	struct sun4i_pwm_wave *wave = pwm_wave_get(chan);
+	enum sun4i_pwm_prescale prescale = PRESCALE_DIV1;
+	unsigned long clk = A10CLK;
+	int ret;
+
+	if (!wave)
+		return -ENOMEM;
+
+	/* the A10 can't bypass the prescaler */
+	if (sunxi_is_sun4i()) {
+		prescale = PRESCALE_DIV120;
+		clk = A10CLK / 120;
+	}
+	if (!rate || rate > PWM_WAVE_MAX_RATE || cycles < 2 ||
+	    cycles > MAX_CYCLES || clk / cycles < rate)
+		return -EINVAL;
+
+	mutex_lock(&sysfs_lock);
+	if (wave->running) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	/* pin and clock gate as for the static mode, then the carrier */
+	ret = pwm_set_mode(PWM_CTRL_ENABLE, chan);
+	if (ret)
+		goto out;
+	chan->ctrl_current.initializer = readl(chan->ctrl_addr);
+	if (chan->channel == 0)
+		chan->ctrl_current.s.ch0_prescaler = prescale;
+	else
+		chan->ctrl_current.s.ch1_prescaler = prescale;
+	writel(chan->ctrl_current.initializer, chan->ctrl_addr);
+
+	wave->rate = rate;
+	wave->cycles = cycles;
+	wave->underruns = 0;
+	wave->interval = ktime_set(0, NSEC_PER_SEC / rate);
+	wave->running = 1;
+	hrtimer_start(&wave->timer, wave->interval, HRTIMER_MODE_REL);
+out:
+	mutex_unlock(&sysfs_lock);
+	return ret;
+}
+
+static void pwm_wave_stop(struct sun4i_pwm_available_channel *chan)
+{
+	struct sun4i_pwm_wave *wave = chan->wave;
+
+	if (!wave)
+		return;
+
+	mutex_lock(&sysfs_lock);
+	if (wave->running) {
+		hrtimer_cancel(&wave->timer);
+		wave->running = 0;
+		kfifo_reset_out(&wave->fifo);
+		wake_up(&wave->wait);
+
+		/* back to the static period and duty */
+		pwm_set_mode(NO_ENABLE_CHANGE, chan);
+	}
+	mutex_unlock(&sysfs_lock);
+}
+
+static void pwm_wave_free(struct sun4i_pwm_available_channel *chan)
+{
+	struct sun4i_pwm_wave *wave = chan->wave;
+
+	if (!wave)
+		return;
+
+	pwm_wave_stop(chan);
+	chan->wave = NULL;
+	kfifo_free(&wave->fifo);
+	kfree(wave);
+}
+
+static unsigned int pwm_wave_queue(struct sun4i_pwm_wave *wave,
+				   const void *buf, unsigned int len)
+{
+	/* all sizes are even, so is the room in the ring */
+	return kfifo_in_spinlocked(&wave->fifo, buf, len & ~1, &wave->lock);
+}
+
+static ssize_t pwm_wave_rate_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	const struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n",
+		       chan->wave && chan->wave->running ? chan->wave->rate : 0);
+}
+
+/* samples per second, 0 stops */
+static ssize_t pwm_wave_rate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+	struct sun4i_pwm_wave *wave;
+	unsigned long rate;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &rate);
+	if (ret)
+		return ret;
+
+	if (!rate) {
+		pwm_wave_stop(chan);
+		return size;
+	}
+
+	wave = pwm_wave_get(chan);
+	if (!wave)
+		return -ENOMEM;
+	ret = pwm_wave_start(chan, rate, wave->cycles);
+
+	return ret ? ret : size;
+}
+
+static ssize_t pwm_wave_cycles_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	const struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n",
+		       chan->wave ? chan->wave->cycles : PWM_WAVE_DEF_CYCLES);
+}
+
+/* cycles of the carrier period, the full scale of a sample */
+static ssize_t pwm_wave_cycles_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+	struct sun4i_pwm_wave *wave;
+	unsigned long cycles;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &cycles);
+	if (ret)
+		return ret;
+	if (cycles < 2 || cycles > MAX_CYCLES)
+		return -EINVAL;
+
+	wave = pwm_wave_get(chan);
+	if (!wave)
+		return -ENOMEM;
+
+	mutex_lock(&sysfs_lock);
+	if (wave->running)
+		ret = -EBUSY;
+	else
+		wave->cycles = cycles;
+	mutex_unlock(&sysfs_lock);
+
+	return ret ? ret : size;
+}
+
+static ssize_t pwm_wave_underruns_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	const struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lu\n", chan->wave ? chan->wave->underruns : 0);
+}
+
+/*
+ * Blocks for room while the waveform runs. A stopped channel only
+ * takes what fits, to fill the ring up before the start.
+ */
+static ssize_t pwm_wave_write(struct file *filp, struct kobject *kobj, struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct sun4i_pwm_available_channel *chan = dev_get_drvdata(dev);
+	struct sun4i_pwm_wave *wave = pwm_wave_get(chan);
+	unsigned int len;
+
+	if (!wave)
+		return -ENOMEM;
+	if (count < sizeof(u16))
+		return -EINVAL;
+
+	if (wait_event_interruptible(wave->wait,
+				     kfifo_avail(&wave->fifo) || !wave->running))
+		return -ERESTARTSYS;
+
+	len = pwm_wave_queue(wave, buf, count);
+
+	return len ? len : -EAGAIN;
+}
+
+int sunxi_pwm_wave_start(struct pwm_device *pwm, unsigned int rate,
+			 unsigned int cycles)
+{
+	if (pwm == NULL)
+		return -EINVAL;
+
+	return pwm_wave_start(pwm->chan, rate, cycles);
+}
+EXPORT_SYMBOL(sunxi_pwm_wave_start);
+
+void sunxi_pwm_wave_stop(struct pwm_device *pwm)
+{
+	if (pwm == NULL)
+		return;
+
+	pwm_wave_stop(pwm->chan);
+}
+EXPORT_SYMBOL(sunxi_pwm_wave_stop);
+
+/* atomic context is fine, the ring is set up by pwm_request() */
+unsigned int sunxi_pwm_wave_queue(struct pwm_device *pwm, const u16 *samples,
+				  unsigned int count)
+{
+	if (pwm == NULL || !pwm->chan->wave)
+		return 0;
+
+	return pwm_wave_queue(pwm->chan->wave, samples,
+			      count * sizeof(u16)) / sizeof(u16);
+}
+EXPORT_SYMBOL(sunxi_pwm_wave_queue);
+
+unsigned int sunxi_pwm_wave_space(struct pwm_device *pwm)
+{
+	if (pwm == NULL || !pwm->chan->wave)
+		return 0;
+
+	return kfifo_avail(&pwm->chan->wave->fifo) / sizeof(u16);
+}
+EXPORT_SYMBOL(sunxi_pwm_wave_space);
+
 module_init(sunxi_pwm_init); 
 module_exit(sunxi_pwm_exit); 
  
@@ -41,7 +41,8 @@ enum sun4i_pwm_prescale {
 	PRESCALE_DIV24k  = 0x09, 
 	PRESCALE_DIV36k  = 0x0a, 
 	PRESCALE_DIV48k  = 0x0b, 
-	PRESCALE_DIV72k  = 0x0c 
+	PRESCALE_DIV72k  = 0x0c,
+	PRESCALE_DIV1    = 0x0f   /* 24mhz as it is, not on the A10 */
 }; 
  
  
@@ -73,6 +74,9 @@ struct sun4i_pwm_ctrl {
 #define PWM_CTRL_DISABLE 0 
  
 #define MAX_CYCLES 0x0ffff /* max cycle count possible for period active and entire */ 
+
+/* control register: the period register of the chan still takes a write */
+#define PWM_CH_PERIOD_BUSY(ch) (1 << (28 + (ch)))
 struct sun4i_pwm_period { 
 #if MAX_CYCLES > 0x0ff 
 	unsigned int pwm_active_cycles:16;        /* duty cycle */ 
@@ -185,6 +189,7 @@ struct sun4i_pwm_available_channel{
 	union sun4i_ioreg_cfg_u pin_current;       /* current pin register */ 
 	const char *pin_name;                      /* name of the pin */ 
 	const char *name;                          /* name of the pwm device from the pwm i/f */ 
+	struct sun4i_pwm_wave *wave;               /* waveform mode, see pwm-sunxi.c */
 }; 
  
 /* 
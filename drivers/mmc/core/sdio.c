@@ -967,8 +967,13 @@ static int mmc_sdio_resume(struct mmc_host *host)
 		}
 	}
 
-	if (!err && host->sdio_irqs)
-		wake_up_process(host->sdio_irq_thread);
+	if (!err && host->sdio_irqs) {
+		/* a card interrupt of the suspend shows up once unmasked */
+		if (host->caps2 & MMC_CAP2_SDIO_IRQ_NOTHREAD)
+			host->ops->enable_sdio_irq(host, 1);
+		else
+			wake_up_process(host->sdio_irq_thread);
+	}
 	mmc_release_host(host);
 
 	/*
@@ -38,13 +38,16 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 	/*
 	 * Optimization, if there is only 1 function interrupt registered
 	 * and we know an IRQ was signaled then call irq handler directly.
-	 * Otherwise do the full probe.
+	 * Otherwise do the full probe. Only hosts running the handlers
+	 * from their own irq thread take the shortcut, ksdioirqd always
+	 * probes.
 	 */
-//	func = card->sdio_single_irq;
-//	if (func && host->sdio_irq_pending) {
-//		func->irq_handler(func);
-//		return 1;
-//	}
+	func = card->sdio_single_irq;
+	if (func && host->sdio_irq_pending &&
+	    (host->caps2 & MMC_CAP2_SDIO_IRQ_NOTHREAD)) {
+		func->irq_handler(func);
+		return 1;
+	}
 
 	ret = mmc_io_rw_direct(card, 0, 0, SDIO_CCCR_INTx, 0, &pending);
 	if (ret) {
@@ -79,6 +82,29 @@ static int process_sdio_pending_irqs(struct mmc_host *host)
 	return ret;
 }
 
+/**
+ *	sdio_run_irqs - run the handlers of a signalled SDIO card interrupt
+ *	@host: host that saw the card interrupt
+ *
+ *	For MMC_CAP2_SDIO_IRQ_NOTHREAD hosts, which get no ksdioirqd and
+ *	call this from a thread of their own after masking the interrupt.
+ *	The interrupt is unmasked again once the handlers ran. The caller
+ *	must be able to sleep and must not hold the host claimed.
+ */
+void sdio_run_irqs(struct mmc_host *host)
+{
+	mmc_claim_host(host);
+	if (host->sdio_irqs) {
+		host->sdio_irq_pending = true;
+		process_sdio_pending_irqs(host);
+		host->sdio_irq_pending = false;
+		if (host->sdio_irqs)
+			host->ops->enable_sdio_irq(host, 1);
+	}
+	mmc_release_host(host);
+}
+EXPORT_SYMBOL_GPL(sdio_run_irqs);
+
 static int sdio_irq_thread(void *_host)
 {
 	struct mmc_host *host = _host;
@@ -178,6 +204,12 @@ static int sdio_card_irq_get(struct mmc_card *card)
 	WARN_ON(!host->claimed);
 
 	if (!host->sdio_irqs++) {
+		if (host->caps2 & MMC_CAP2_SDIO_IRQ_NOTHREAD) {
+			mmc_host_clk_hold(host);
+			host->ops->enable_sdio_irq(host, 1);
+			mmc_host_clk_release(host);
+			return 0;
+		}
 		atomic_set(&host->sdio_irq_thread_abort, 0);
 		host->sdio_irq_thread =
 			kthread_run(sdio_irq_thread, host, "ksdioirqd/%s",
@@ -200,8 +232,14 @@ static int sdio_card_irq_put(struct mmc_card *card)
 	BUG_ON(host->sdio_irqs < 1);
 
 	if (!--host->sdio_irqs) {
-		atomic_set(&host->sdio_irq_thread_abort, 1);
-		kthread_stop(host->sdio_irq_thread);
+		if (host->caps2 & MMC_CAP2_SDIO_IRQ_NOTHREAD) {
+			mmc_host_clk_hold(host);
+			host->ops->enable_sdio_irq(host, 0);
+			mmc_host_clk_release(host);
+		} else {
+			atomic_set(&host->sdio_irq_thread_abort, 1);
+			kthread_stop(host->sdio_irq_thread);
+		}
 	}
 
 	return 0;
@@ -29,6 +29,7 @@
 #include <linux/scatterlist.h>
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
+#include <linux/pm_runtime.h>
 #include <linux/regulator/consumer.h>
 
 #include <linux/mmc/host.h>
@@ -39,6 +40,7 @@
 
 #include <asm/cacheflush.h>
 #include <asm/uaccess.h>
+#include <asm/unaligned.h>
 
 #include <plat/system.h>
 #include <plat/sys_config.h>
@@ -49,8 +51,63 @@
 
 #include "sunxi-mci.h"
 
-#if defined CONFIG_MMC_SUNXI || defined CONFIG_MMC_SUNXI_MODULE
-#error Only one of the old and new SUNXI MMC drivers may be selected
+#define CREATE_TRACE_POINTS
+#include <trace/events/sunxi_mmc.h>
+
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+
+/* Cheap timestamp for the latency histogram, in 1.024 usecs units */
+static inline u32 sw_mci_dbg_stamp(void)
+{
+	return (u32)(sched_clock() >> 10);
+}
+
+static inline void sw_mci_dbg_start(struct sunxi_mmc_host *smc_host,
+				    struct mmc_request *mrq)
+{
+	struct sw_mci_stats *st = &smc_host->stats;
+
+	st->start = sw_mci_dbg_stamp();
+	st->cmds[mrq->cmd->opcode & 0x3f]++;
+	if (mrq->data) {
+		st->dma_reqs++;
+		if (mrq->data->host_cookie & SW_MCI_COOKIE_PRE)
+			st->dma_premapped++;
+	}
+}
+
+static inline void sw_mci_dbg_done(struct sunxi_mmc_host *smc_host,
+				   struct mmc_request *mrq, u32 polled)
+{
+	struct sw_mci_stats *st = &smc_host->stats;
+	u32 lat = sw_mci_dbg_stamp() - st->start;
+	u32 sum = smc_host->int_sum;
+
+	st->lat[min_t(int, lat ? fls(lat) - 1 : 0, SDC_HIST_BUCKETS - 1)]++;
+	if (polled)
+		st->polled_cmds++;
+	else
+		st->irq_cmds++;
+	if (sum & (SDXC_RespCRCErr | SDXC_DataCRCErr))
+		st->crc_errs++;
+	else if (sum & (SDXC_RespTimeout | SDXC_DataTimeout))
+		st->timeouts++;
+	else if (sum & SDXC_IntErrBit)
+		st->other_errs++;
+	else if (mrq->data && (mrq->data->flags & MMC_DATA_WRITE))
+		st->bytes_written += mrq->data->blocks * mrq->data->blksz;
+	else if (mrq->data)
+		st->bytes_read += mrq->data->blocks * mrq->data->blksz;
+}
+#else
+static inline void sw_mci_dbg_start(struct sunxi_mmc_host *smc_host,
+				    struct mmc_request *mrq) { }
+static inline void sw_mci_dbg_done(struct sunxi_mmc_host *smc_host,
+				   struct mmc_request *mrq, u32 polled) { }
 #endif
 
 #define sw_host_num (sunxi_is_sun5i() ? 3 : 4)
@@ -290,12 +347,53 @@ s32 sw_mci_oclk_onoff(struct sunxi_mmc_host* smc_host, u32 oclk_en, u32 pwr_save
 	return 0;
 }
 
+static void sw_mci_finalize_request(struct sunxi_mmc_host *smc_host, u32 polled);
+
+/*
+ * Commands without data or busy signalling (CMD13 and friends) finish in
+ * a few microseconds at normal bus rates. Spin for them with interrupts
+ * masked and complete the request inline; only arm the IRQ if the card is
+ * slower than SDC_CMD_POLL_US.
+ */
+static void sw_mci_poll_cmd(struct sunxi_mmc_host* smc_host, u32 imask)
+{
+	unsigned long iflags;
+	u32 rint = 0;
+	u32 i;
+
+	for (i=0; i<SDC_CMD_POLL_US; i++) {
+		rint = mci_readl(smc_host, REG_RINTR);
+		if (rint & (SDXC_CmdDone|SDXC_IntErrBit))
+			break;
+		udelay(1);
+	}
+
+	spin_lock_irqsave(&smc_host->lock, iflags);
+	if (!(rint & (SDXC_CmdDone|SDXC_IntErrBit))) {
+		/* the raw status is level, a late completion still interrupts */
+		mci_writew(smc_host, REG_IMASK, imask);
+		spin_unlock_irqrestore(&smc_host->lock, iflags);
+		return;
+	}
+	smc_host->int_sum |= rint;
+	smc_host->error = rint & SDXC_IntErrBit;
+	smc_host->wait = SDC_WAIT_FINALIZE;
+	smc_host->state = SDC_STATE_CMDDONE;
+	mci_writel(smc_host, REG_RINTR, rint & ~SDXC_SDIOInt);
+	spin_unlock_irqrestore(&smc_host->lock, iflags);
+
+	sw_mci_finalize_request(smc_host, 1);
+}
+
 static void sw_mci_send_cmd(struct sunxi_mmc_host* smc_host, struct mmc_command* cmd)
 {
 	u32 imask = SDXC_IntErrBit;
 	u32 cmd_val = SDXC_Start|(cmd->opcode&0x3f);
 	unsigned long iflags;
 	u32 wait = SDC_WAIT_NONE;
+	u32 poll = !cmd->data && !(cmd->flags & MMC_RSP_BUSY)
+		&& cmd->opcode != MMC_GO_IDLE_STATE
+		&& cmd->opcode != SD_SWITCH_VOLTAGE;
 
 	wait = SDC_WAIT_CMD_DONE;
 	if (cmd->opcode == MMC_GO_IDLE_STATE) {
@@ -336,8 +434,11 @@ static void sw_mci_send_cmd(struct sunxi_mmc_host* smc_host, struct mmc_command*
 
 			if (cmd->data->flags & MMC_DATA_WRITE)
 				cmd_val |= SDXC_Write;
-			else
+			else if (!smc_host->pio)
 				wait |= SDC_WAIT_DMA_DONE;
+			if (smc_host->pio)
+				imask |= cmd->data->flags & MMC_DATA_WRITE
+					? SDXC_TxDataReq : SDXC_RxDataReq;
 		} else
 			imask |= SDXC_CmdDone;
 
@@ -349,17 +450,23 @@ static void sw_mci_send_cmd(struct sunxi_mmc_host* smc_host, struct mmc_command*
 	spin_lock_irqsave(&smc_host->lock, iflags);
 	smc_host->wait = wait;
 	smc_host->state = SDC_STATE_SENDCMD;
-	mci_writew(smc_host, REG_IMASK, imask);
+	mci_writew(smc_host, REG_IMASK, poll ? 0 : imask);
 	mci_writel(smc_host, REG_CARG, cmd->arg);
 	mci_writel(smc_host, REG_CMDR, cmd_val);
 	smp_wmb();
 	spin_unlock_irqrestore(&smc_host->lock, iflags);
+
+	if (poll)
+		sw_mci_poll_cmd(smc_host, imask);
 }
 
-static void sw_mci_init_idma_des(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+static void sw_mci_init_idma_des(struct sunxi_mmc_host* smc_host, struct mmc_data* data,
+				 u32 tbl)
 {
-	struct sunxi_mmc_idma_des* pdes = (struct sunxi_mmc_idma_des*)smc_host->sg_cpu;
-	struct sunxi_mmc_idma_des* pdes_pa = (struct sunxi_mmc_idma_des*)smc_host->sg_dma;
+	struct sunxi_mmc_idma_des* pdes = (struct sunxi_mmc_idma_des*)
+			(smc_host->sg_cpu + tbl * SW_MCI_DES_TABLE_SIZE);
+	struct sunxi_mmc_idma_des* pdes_pa = (struct sunxi_mmc_idma_des*)
+			(smc_host->sg_dma + tbl * SW_MCI_DES_TABLE_SIZE);
 	u32 des_idx = 0;
 	u32 buff_frag_num = 0;
 	u32 remain;
@@ -407,18 +514,26 @@ static void sw_mci_init_idma_des(struct sunxi_mmc_host* smc_host, struct mmc_dat
 	return;
 }
 
-static int sw_mci_prepare_dma(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+/*
+ * Map the buffers of a request and build its descriptors in a free table.
+ * Called from pre_req while the previous request is still on the bus, or
+ * from the request itself when pre_req was not used or failed.
+ */
+static int sw_mci_map_dma(struct sunxi_mmc_host* smc_host, struct mmc_data* data, u32 pre)
 {
 	u32 dma_len;
 	u32 i;
-	u32 temp;
+	u32 tbl;
+	u32 des_num = 0;
+	unsigned long iflags;
 	struct scatterlist *sg;
+	enum dma_data_direction dir = (data->flags & MMC_DATA_WRITE)
+					? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 
 	if (smc_host->sg_cpu == NULL)
 		return -ENOMEM;
 
-	dma_len = dma_map_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len,
-			(data->flags & MMC_DATA_WRITE) ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+	dma_len = dma_map_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len, dir);
 	if (dma_len == 0) {
 		SMC_ERR(smc_host, "no dma map memory\n");
 		return -ENOMEM;
@@ -426,14 +541,58 @@ static int sw_mci_prepare_dma(struct sunxi_mmc_host* smc_host, struct mmc_data*
 
 	for_each_sg(data->sg, sg, data->sg_len, i) {
 		if (sg->offset & 3 || sg->length & 3) {
-			SMC_ERR(smc_host, "unaligned scatterlist: os %x length %d\n",
+			SMC_DBG(smc_host, "unaligned scatterlist: os %x length %d\n",
 				sg->offset, sg->length);
+			dma_unmap_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len, dir);
 			return -EINVAL;
 		}
+		des_num += DIV_ROUND_UP(sg->length, SDXC_DES_BUFFER_MAX_LEN);
+	}
+	if (des_num > SW_MCI_DES_PER_TABLE) {
+		SMC_DBG(smc_host, "too many descriptors: %d\n", des_num);
+		dma_unmap_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len, dir);
+		return -EINVAL;
 	}
 
-	sw_mci_init_idma_des(smc_host, data);
+	spin_lock_irqsave(&smc_host->lock, iflags);
+	tbl = ffz(smc_host->des_used);
+	if (tbl >= SW_MCI_DES_TABLES) {
+		spin_unlock_irqrestore(&smc_host->lock, iflags);
+		SMC_ERR(smc_host, "no free descriptor table\n");
+		dma_unmap_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len, dir);
+		return -EBUSY;
+	}
+	smc_host->des_used |= 1 << tbl;
+	spin_unlock_irqrestore(&smc_host->lock, iflags);
+
+	sw_mci_init_idma_des(smc_host, data, tbl);
+	data->host_cookie = (tbl + 1) | (pre ? SW_MCI_COOKIE_PRE : 0);
+	return 0;
+}
+
+static void sw_mci_unmap_dma(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+{
+	u32 tbl = (data->host_cookie & SW_MCI_COOKIE_TABLE) - 1;
+	unsigned long iflags;
+
+	if (!data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len,
+			data->flags & MMC_DATA_WRITE ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+	spin_lock_irqsave(&smc_host->lock, iflags);
+	smc_host->des_used &= ~(1 << tbl);
+	spin_unlock_irqrestore(&smc_host->lock, iflags);
+	data->host_cookie = 0;
+}
+
+static void sw_mci_prepare_dma(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+{
+	u32 tbl = (data->host_cookie & SW_MCI_COOKIE_TABLE) - 1;
+	u32 temp;
+
 	temp = mci_readl(smc_host, REG_GCTRL);
+	temp &= ~SDXC_ACCESS_BY_AHB;
 	temp |= SDXC_DMAEnb;
 	mci_writel(smc_host, REG_GCTRL, temp);
 	temp |= SDXC_DMAReset;
@@ -450,10 +609,83 @@ static int sw_mci_prepare_dma(struct sunxi_mmc_host* smc_host, struct mmc_data*
 	mci_writel(smc_host, REG_IDIE, temp);
 
 	//write descriptor address to register
-	mci_writel(smc_host, REG_DLBA, smc_host->sg_dma);
+	mci_writel(smc_host, REG_DLBA, smc_host->sg_dma + tbl * SW_MCI_DES_TABLE_SIZE);
 	mci_writel(smc_host, REG_FTRGL, smc_host->pdata->dma_tl);
+}
 
-	return 0;
+/*
+ * Scatterlists the IDMAC cannot take, buffers at odd addresses or of odd
+ * lengths as SDIO function drivers hand them down, go through the FIFO
+ * instead, the way the old sunxi-host driver could. The IRQ handler
+ * moves what the FIFO holds or has room for on every data request.
+ */
+static void sw_mci_prepare_pio(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+{
+	u32 temp;
+
+	temp = mci_readl(smc_host, REG_GCTRL);
+	temp &= ~SDXC_DMAEnb;
+	temp |= SDXC_ACCESS_BY_AHB | SDXC_FIFOReset;
+	mci_writel(smc_host, REG_GCTRL, temp);
+	mci_writel(smc_host, REG_FTRGL, smc_host->pdata->dma_tl);
+
+	smc_host->pio = 1;
+	smc_host->pio_count = 0;
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+	smc_host->stats.pio_reqs++;
+#endif
+}
+
+/* called from the IRQ handler with the host lock held */
+static void sw_mci_pio_xfer(struct sunxi_mmc_host* smc_host, struct mmc_data* data)
+{
+	u32 total = data->blksz * data->blocks;
+	u32 write = data->flags & MMC_DATA_WRITE;
+	u32 buf[SDXC_FIFO_SIZE];
+	struct sg_mapping_iter miter;
+	u32 words, len, skip, done, n, i;
+
+	while (smc_host->pio_count < total) {
+		words = SDXC_FIFO_LEVEL(mci_readl(smc_host, REG_STAS));
+		if (write)
+			words = SDXC_FIFO_SIZE - words;
+		if (!words)
+			break;
+		len = min(words << 2, total - smc_host->pio_count);
+		words = DIV_ROUND_UP(len, 4);
+
+		if (!write)
+			for (i = 0; i < words; i++)
+				buf[i] = mci_readl(smc_host, REG_FIFO);
+
+		sg_miter_start(&miter, data->sg, data->sg_len, SG_MITER_ATOMIC |
+			       (write ? SG_MITER_FROM_SG : SG_MITER_TO_SG));
+		skip = smc_host->pio_count;
+		done = 0;
+		while (done < len && sg_miter_next(&miter)) {
+			if (skip >= miter.length) {
+				skip -= miter.length;
+				continue;
+			}
+			n = min(miter.length - skip, len - done);
+			if (write)
+				memcpy((u8 *)buf + done, miter.addr + skip, n);
+			else
+				memcpy(miter.addr + skip, (u8 *)buf + done, n);
+			done += n;
+			skip = 0;
+		}
+		sg_miter_stop(&miter);
+
+		if (write)
+			for (i = 0; i < words; i++)
+				mci_writel(smc_host, REG_FIFO, buf[i]);
+		smc_host->pio_count += len;
+	}
+
+	if (smc_host->pio_count >= total)
+		mci_writew(smc_host, REG_IMASK, mci_readw(smc_host, REG_IMASK)
+			   & ~(SDXC_TxDataReq|SDXC_RxDataReq));
 }
 
 int sw_mci_send_manual_stop(struct sunxi_mmc_host* smc_host, struct mmc_request* req)
@@ -532,6 +764,12 @@ s32 sw_mci_request_done(struct sunxi_mmc_host* smc_host)
 		}
 			
 		sw_mci_dump_errinfo(smc_host);
+		/* CRC errors at a tuned timing: do not trust the sample point */
+		if ((smc_host->int_sum & (SDXC_RespCRCErr|SDXC_DataCRCErr))
+				&& smc_host->tune_cur >= 0) {
+			smc_host->tune_cache[smc_host->tune_cur].valid = 0;
+			smc_host->tune_cur = -1;
+		}
 		if (req->data)
 			SMC_ERR(smc_host, "In data %s operation\n",
 				req->data->flags & MMC_DATA_WRITE ? "write" : "read");
@@ -558,12 +796,14 @@ out:
 		mci_writel(smc_host, REG_DMAC, 0);
 		temp = mci_readl(smc_host, REG_GCTRL);
 		mci_writel(smc_host, REG_GCTRL, temp|SDXC_DMAReset);
-		temp &= ~SDXC_DMAEnb;
+		temp &= ~(SDXC_DMAEnb|SDXC_ACCESS_BY_AHB);
 		mci_writel(smc_host, REG_GCTRL, temp);
+		smc_host->pio = 0;
 		temp |= SDXC_FIFOReset;
 		mci_writel(smc_host, REG_GCTRL, temp);
-		dma_unmap_sg(mmc_dev(smc_host->mmc), data->sg, data->sg_len,
-				data->flags & MMC_DATA_WRITE ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		/* buffers mapped by pre_req are released in post_req */
+		if (!(data->host_cookie & SW_MCI_COOKIE_PRE))
+			sw_mci_unmap_dma(smc_host, data);
 	}
 
 	mci_writew(smc_host, REG_IMASK, 0);
@@ -579,6 +819,9 @@ out:
 
 	if (req->data  && (smc_host->int_sum & SDXC_IntErrBit)) {
 		SMC_MSG(smc_host, "found data error, need to send stop command\n");
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+		smc_host->stats.manual_stops++;
+#endif
 		sw_mci_send_manual_stop(smc_host, req);
 	}
 
@@ -732,8 +975,9 @@ static int sw_mci_resource_request(struct sunxi_mmc_host *smc_host)
 	}
 
 	/* alloc idma descriptor structure */
-	smc_host->sg_cpu = dma_alloc_writecombine(NULL, PAGE_SIZE,
-					&smc_host->sg_dma, GFP_KERNEL);
+	smc_host->sg_cpu = dma_alloc_writecombine(NULL,
+				SW_MCI_DES_TABLES * SW_MCI_DES_TABLE_SIZE,
+				&smc_host->sg_dma, GFP_KERNEL);
 	if (smc_host->sg_cpu == NULL) {
 		SMC_ERR(smc_host, "alloc dma des failed\n");
 		goto free_mclk;
@@ -750,7 +994,8 @@ static int sw_mci_resource_request(struct sunxi_mmc_host *smc_host)
 
 	return 0;
 free_sgbuff:
-	dma_free_coherent(NULL, PAGE_SIZE, smc_host->sg_cpu, smc_host->sg_dma);
+	dma_free_coherent(NULL, SW_MCI_DES_TABLES * SW_MCI_DES_TABLE_SIZE,
+			  smc_host->sg_cpu, smc_host->sg_dma);
 	smc_host->sg_cpu = NULL;
 	smc_host->sg_dma = 0;
 free_mclk:
@@ -777,7 +1022,7 @@ static int sw_mci_resource_release(struct sunxi_mmc_host *smc_host)
 	}
 	/* free idma descriptor structrue */
 	if (smc_host->sg_cpu) {
-		dma_free_coherent(NULL, PAGE_SIZE,
+		dma_free_coherent(NULL, SW_MCI_DES_TABLES * SW_MCI_DES_TABLE_SIZE,
 				  smc_host->sg_cpu, smc_host->sg_dma);
 		smc_host->sg_cpu = NULL;
 		smc_host->sg_dma = 0;
@@ -836,7 +1081,7 @@ static void sw_mci_restore_io(struct sunxi_mmc_host* smc_host)
 	SMC_DBG(smc_host, "mmc %d resume pins\n", smc_host->pdev->id);
 }
 
-static void sw_mci_finalize_request(struct sunxi_mmc_host *smc_host)
+static void sw_mci_finalize_request(struct sunxi_mmc_host *smc_host, u32 polled)
 {
 	struct mmc_request* mrq = smc_host->mrq;
 	unsigned long iflags;
@@ -855,6 +1100,7 @@ static void sw_mci_finalize_request(struct sunxi_mmc_host *smc_host)
 	spin_unlock_irqrestore(&smc_host->lock, iflags);
 
 	sw_mci_request_done(smc_host);
+	sw_mci_dbg_done(smc_host, mrq, polled);
 	if (smc_host->error) {
 		mrq->cmd->error = -ETIMEDOUT;
 		if (mrq->data)
@@ -865,6 +1111,9 @@ static void sw_mci_finalize_request(struct sunxi_mmc_host *smc_host)
 		if (mrq->data)
 			mrq->data->bytes_xfered = (mrq->data->blocks * mrq->data->blksz);
 	}
+	trace_sunxi_mci_finalize(smc_host->pdev->id, mrq->cmd->opcode,
+				 smc_host->error, smc_host->int_sum,
+				 mrq->data ? mrq->data->bytes_xfered : 0, polled);
 
 	smc_host->mrq = NULL;
 	smc_host->error = 0;
@@ -954,6 +1203,7 @@ static int sw_mci_card_present(struct mmc_host *mmc)
 static irqreturn_t sw_mci_irq(int irq, void *dev_id)
 {
 	struct sunxi_mmc_host *smc_host = dev_id;
+	irqreturn_t ret = IRQ_HANDLED;
 	u32 sdio_int = 0;
 	u32 raw_int;
 	u32 msk_int;
@@ -980,6 +1230,9 @@ static irqreturn_t sw_mci_irq(int irq, void *dev_id)
 
 	if (msk_int & SDXC_SDIOInt) {
 		sdio_int = 1;
+		/* the card holds it until its handler ran, masked till then */
+		mci_writel(smc_host, REG_IMASK,
+			   mci_readl(smc_host, REG_IMASK) & ~SDXC_SDIOInt);
 		mci_writel(smc_host, REG_RINTR, SDXC_SDIOInt);
 		goto sdio_out;
 	}
@@ -996,6 +1249,8 @@ static irqreturn_t sw_mci_irq(int irq, void *dev_id)
 		smc_host->state = SDC_STATE_CMDDONE;
 		goto irq_out;
 	}
+	if (smc_host->pio)
+		sw_mci_pio_xfer(smc_host, smc_host->mrq->data);
 	if (idma_int & (SDXC_IDMACTransmitInt|SDXC_IDMACReceiveInt))
 		smc_host->dma_done = 1;
 	if (msk_int & (SDXC_AutoCMDDone|SDXC_DataOver|SDXC_CmdDone|SDXC_VolChgDone))
@@ -1016,22 +1271,60 @@ irq_out:
 	if (smc_host->wait == SDC_WAIT_FINALIZE) {
 		smp_wmb();
 		mci_writew(smc_host, REG_IMASK, 0);
-		tasklet_schedule(&smc_host->tasklet);
+		ret = IRQ_WAKE_THREAD;
 	}
 
 sdio_out:
 	spin_unlock(&smc_host->lock);
 
-	if (sdio_int)
-		mmc_signal_sdio_irq(smc_host->mmc);
+	if (sdio_int) {
+		if (smc_host->sdio_task) {
+			set_bit(0, &smc_host->sdio_pending);
+			wake_up_process(smc_host->sdio_task);
+		} else
+			mmc_signal_sdio_irq(smc_host->mmc);
+	}
 
-	return IRQ_HANDLED;
+	return ret;
 }
 
-static void sw_mci_tasklet(unsigned long data)
+/*
+ * SDIO card interrupts of an io host go straight from sw_mci_irq to
+ * this thread, which runs the function handlers through the core with
+ * MMC_CAP2_SDIO_IRQ_NOTHREAD: no ksdioirqd in between, and no CMD52 to
+ * read CCCR_INTx when only one function has a handler, as with the
+ * Wi-Fi of the AP6xxx modules. It runs at the priority of the irq
+ * threads, so its handler is not stuck behind other RT tasks either.
+ */
+static int sw_mci_sdio_thread(void *data)
 {
-	struct sunxi_mmc_host *smc_host = (struct sunxi_mmc_host *) data;
-	sw_mci_finalize_request(smc_host);
+	struct sunxi_mmc_host *smc_host = data;
+	struct sched_param param = { .sched_priority = MAX_USER_RT_PRIO / 2 };
+
+	sched_setscheduler(current, SCHED_FIFO, &param);
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+		if (!test_and_clear_bit(0, &smc_host->sdio_pending)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+		sdio_run_irqs(smc_host->mmc);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static irqreturn_t sw_mci_irq_thread(int irq, void *dev_id)
+{
+	struct sunxi_mmc_host *smc_host = dev_id;
+
+	sw_mci_finalize_request(smc_host, 0);
+	return IRQ_HANDLED;
 }
 
 static void sw_mci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
@@ -1058,6 +1351,9 @@ static void sw_mci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 		pwr_mode[ios->power_mode], vdd[ios->signal_voltage],
 		1 << ios->bus_width, timing[ios->timing], drv_type[ios->drv_type]);
 
+	/* set_ios is not always called with the host claimed */
+	pm_runtime_get_sync(&smc_host->pdev->dev);
+
 	/* Set the power state */
 	switch (ios->power_mode) {
 		case MMC_POWER_ON:
@@ -1101,6 +1397,7 @@ static void sw_mci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 				clk_disable(smc_host->hclk);
 				sw_mci_hold_io(smc_host);
 				smc_host->power_on = 0;
+				smc_host->tune_cur = -1;
 				smc_host->ferror = 0;
 				last_clock[id] = 0;
 			}
@@ -1145,7 +1442,9 @@ static void sw_mci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 		else
 			smc_host->mod_clk = ios->clock;
 		smc_host->card_clk = ios->clock;
-		if (smc_host->mod_clk > 45000000)
+		/* SDIO cards run high speed at the full 50MHz */
+		if (smc_host->mod_clk > 45000000 &&
+		    !(smc_host->io_flag && ios->timing == MMC_TIMING_SD_HS))
 			smc_host->mod_clk = 45000000;
 		sw_mci_set_clk(smc_host, smc_host->card_clk);
 		last_clock[id] = ios->clock;
@@ -1154,6 +1453,9 @@ static void sw_mci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 		last_clock[id] = 0;
 		sw_mci_update_clk(smc_host);
 	}
+
+	pm_runtime_mark_last_busy(&smc_host->pdev->dev);
+	pm_runtime_put_autosuspend(&smc_host->pdev->dev);
 }
 
 static void sw_mci_enable_sdio_irq(struct mmc_host *mmc, int enable)
@@ -1203,11 +1505,22 @@ static void sw_mci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	}
 
 	smc_host->mrq = mrq;
+	sw_mci_dbg_start(smc_host, mrq);
+	trace_sunxi_mci_request(smc_host->pdev->id, cmd->opcode, cmd->arg,
+				data ? data->blocks : 0, data ? data->blksz : 0,
+				data ? !!(data->flags & MMC_DATA_WRITE) : 0);
 	if (data) {
 		byte_cnt = data->blksz * data->blocks;
 		mci_writel(smc_host, REG_BLKSZ, data->blksz);
 		mci_writel(smc_host, REG_BCNTR, byte_cnt);
-		ret = sw_mci_prepare_dma(smc_host, data);
+		ret = 0;
+		smc_host->pio = 0;
+		if (!data->host_cookie)
+			ret = sw_mci_map_dma(smc_host, data, 0);
+		if (ret == -EINVAL) {
+			sw_mci_prepare_pio(smc_host, data);
+			ret = 0;
+		}
 		if (ret < 0) {
 			SMC_ERR(smc_host, "smc %d prepare DMA failed\n", smc_host->pdev->id);
 			cmd->error = ret;
@@ -1216,10 +1529,59 @@ static void sw_mci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 			mmc_request_done(smc_host->mmc, mrq);
 			return;
 		}
+		if (!smc_host->pio)
+			sw_mci_prepare_dma(smc_host, data);
 	}
 	sw_mci_send_cmd(smc_host, cmd);
 }
 
+/*
+ * The core claims the host around every burst of requests; hold a runtime
+ * PM reference for as long as it is claimed.
+ */
+static int sw_mci_enable(struct mmc_host *mmc)
+{
+	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+
+	pm_runtime_get_sync(&smc_host->pdev->dev);
+	return 0;
+}
+
+static int sw_mci_disable(struct mmc_host *mmc)
+{
+	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+
+	/* the card a fresh tuning result belongs to is known by now */
+	if (smc_host->tune_pending.valid && mmc->card)
+		sw_mci_tune_commit(smc_host, mmc->card->raw_cid);
+
+	pm_runtime_mark_last_busy(&smc_host->pdev->dev);
+	pm_runtime_put_autosuspend(&smc_host->pdev->dev);
+	return 0;
+}
+
+static void sw_mci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			   bool is_first_req)
+{
+	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data || data->host_cookie)
+		return;
+	/* on failure the request maps its buffers itself when it starts */
+	if (sw_mci_map_dma(smc_host, data, 1) < 0)
+		data->host_cookie = 0;
+}
+
+static void sw_mci_post_req(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (data && (data->host_cookie & SW_MCI_COOKIE_PRE))
+		sw_mci_unmap_dma(smc_host, data);
+}
+
 static int sw_mci_do_voltage_switch(struct mmc_host *mmc, struct mmc_ios *ios)
 {
 	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
@@ -1285,42 +1647,121 @@ static int sw_mci_do_voltage_switch(struct mmc_host *mmc, struct mmc_ios *ios)
 		return 0;
 }
 
+/* standard tuning block patterns for 4 and 8 bit buses */
+static const char sw_mci_tuning_blk_4b[] = {
+	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
+	0xc3, 0x3c, 0xcc, 0xff, 0xfe, 0xff, 0xfe, 0xef,
+	0xff, 0xdf, 0xff, 0xdd, 0xff, 0xfb, 0xff, 0xfb,
+	0xbf, 0xff, 0x7f, 0xff, 0x77, 0xf7, 0xbd, 0xef,
+	0xff, 0xf0, 0xff, 0xf0, 0x0f, 0xfc, 0xcc, 0x3c,
+	0xcc, 0x33, 0xcc, 0xcf, 0xff, 0xef, 0xff, 0xee,
+	0xff, 0xfd, 0xff, 0xfd, 0xdf, 0xff, 0xbf, 0xff,
+	0xbb, 0xff, 0xf7, 0xff, 0xf7, 0x7f, 0x7b, 0xde
+};
+static const char sw_mci_tuning_blk_8b[] = {
+	0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00,
+	0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc, 0xcc,
+	0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff, 0xff,
+	0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee, 0xff,
+	0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd, 0xdd,
+	0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff, 0xbb,
+	0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff, 0xff,
+	0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee, 0xff,
+	0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
+	0x00, 0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc,
+	0xcc, 0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff,
+	0xff, 0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee,
+	0xff, 0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd,
+	0xdd, 0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff,
+	0xbb, 0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff,
+	0xff, 0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee
+};
+
+/*
+ * Send one tuning block at the current sample point and compare it with
+ * the standard pattern. Returns 0 on a match, -EILSEQ if the data came
+ * back wrong, or the transfer error.
+ */
+static int sw_mci_send_tuning(struct mmc_host *mmc, u32 opcode, char* rcv_pattern)
+{
+	struct mmc_command cmd = {0};
+	struct mmc_data data = {0};
+	struct mmc_request mrq = {0};
+	struct scatterlist sg;
+	const char* std_pattern = sw_mci_tuning_blk_4b;
+
+	cmd.opcode = opcode;
+	cmd.arg = 0;
+	cmd.flags = MMC_RSP_R1 | MMC_CMD_ADTC;
+	data.blksz = 64;
+	if (opcode == MMC_SEND_TUNING_BLOCK_HS200
+			&& mmc->ios.bus_width == MMC_BUS_WIDTH_8) {
+		data.blksz = 128;
+		std_pattern = sw_mci_tuning_blk_8b;
+	}
+	data.blocks = 1;
+	data.flags = MMC_DATA_READ;
+	data.sg = &sg;
+	data.sg_len = 1;
+	sg_init_one(&sg, rcv_pattern, data.blksz);
+
+	mrq.cmd = &cmd;
+	mrq.data = &data;
+
+	mmc_wait_for_req(mmc, &mrq);
+	if (cmd.error)
+		return cmd.error;
+	if (data.error)
+		return data.error;
+	return memcmp(rcv_pattern, std_pattern, data.blksz) ? -EILSEQ : 0;
+}
+
+static struct sw_mci_tune_cache* sw_mci_tune_lookup(struct sunxi_mmc_host *smc_host,
+				u32 *cid, u32 timing, u32 clock)
+{
+	struct sw_mci_tune_cache *tc;
+	u32 i;
+
+	for (i=0; i<SDC_TUNE_CACHE_NUM; i++) {
+		tc = &smc_host->tune_cache[i];
+		if (tc->timing == timing && tc->clock == clock
+				&& !memcmp(tc->cid, cid, sizeof(tc->cid)))
+			return tc;
+	}
+	return NULL;
+}
+
+/*
+ * On first insertion tuning runs before the core has published the card,
+ * so the result waits in tune_pending until the CID is known.
+ */
+static void sw_mci_tune_commit(struct sunxi_mmc_host *smc_host, u32 *cid)
+{
+	struct sw_mci_tune_cache *pend = &smc_host->tune_pending;
+	struct sw_mci_tune_cache *tc;
+
+	tc = sw_mci_tune_lookup(smc_host, cid, pend->timing, pend->clock);
+	if (!tc) {
+		tc = &smc_host->tune_cache[smc_host->tune_next];
+		smc_host->tune_next = (smc_host->tune_next + 1) % SDC_TUNE_CACHE_NUM;
+	}
+	*tc = *pend;
+	memcpy(tc->cid, cid, sizeof(tc->cid));
+	smc_host->tune_cur = tc - smc_host->tune_cache;
+	pend->valid = 0;
+}
+
 /*
  * Here we execute a tuning operation to find the sample window of MMC host.
  * Then we select the best sampling point in the host for DDR50, SDR50, and
- * SDR104 modes.
+ * SDR104 modes. A card seen before at the same timing and clock reuses its
+ * sample point after one check block; the sweep only runs again once a CRC
+ * error has dropped the cached entry.
  */
 static int sw_mci_execute_tuning(struct mmc_host *mmc, u32 opcode)
 {
-	static const char tuning_blk_4b[] = {
-		0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
-		0xc3, 0x3c, 0xcc, 0xff, 0xfe, 0xff, 0xfe, 0xef,
-		0xff, 0xdf, 0xff, 0xdd, 0xff, 0xfb, 0xff, 0xfb,
-		0xbf, 0xff, 0x7f, 0xff, 0x77, 0xf7, 0xbd, 0xef,
-		0xff, 0xf0, 0xff, 0xf0, 0x0f, 0xfc, 0xcc, 0x3c,
-		0xcc, 0x33, 0xcc, 0xcf, 0xff, 0xef, 0xff, 0xee,
-		0xff, 0xfd, 0xff, 0xfd, 0xdf, 0xff, 0xbf, 0xff,
-		0xbb, 0xff, 0xf7, 0xff, 0xf7, 0x7f, 0x7b, 0xde
-	};
-	static const char tuning_blk_8b[] = {
-		0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00,
-		0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc, 0xcc,
-		0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff, 0xff,
-		0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee, 0xff,
-		0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd, 0xdd,
-		0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff, 0xbb,
-		0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff, 0xff,
-		0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee, 0xff,
-		0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
-		0x00, 0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc,
-		0xcc, 0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff,
-		0xff, 0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee,
-		0xff, 0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd,
-		0xdd, 0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff,
-		0xbb, 0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff,
-		0xff, 0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee
-	};
 	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+	struct sw_mci_tune_cache *tc = NULL;
 	u32 sample_min = 1;
 	u32 sample_max = 0;
 	u32 sample_bak = smc_host->sclk_dly;
@@ -1329,7 +1770,6 @@ static int sw_mci_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	u32 loops = 64;
 	u32 tuning_done = 0;
 	char* rcv_pattern = (char*)kmalloc(128, GFP_KERNEL|GFP_DMA);
-	char* std_pattern = NULL;
 	int err = 0;
 
 	if (!rcv_pattern) {
@@ -1337,6 +1777,26 @@ static int sw_mci_execute_tuning(struct mmc_host *mmc, u32 opcode)
 				smc_host->pdev->id);
 		return -EIO;
 	}
+
+	smc_host->tune_cur = -1;
+	if (mmc->card)
+		tc = sw_mci_tune_lookup(smc_host, mmc->card->raw_cid,
+					mmc->ios.timing, smc_host->card_clk);
+	if (tc && tc->valid) {
+		sw_mci_set_clk_dly(smc_host, smc_host->oclk_dly, tc->sclk_dly);
+		if (!sw_mci_send_tuning(mmc, opcode, rcv_pattern)) {
+			SMC_MSG(smc_host, "sdc%d reuse tuned sample point %d\n",
+				smc_host->pdev->id, tc->sclk_dly);
+			smc_host->tune_cur = tc - smc_host->tune_cache;
+			smc_host->tune_cached = 1;
+			kfree(rcv_pattern);
+			return 0;
+		}
+		SMC_MSG(smc_host, "sdc%d cached sample point %d failed, sweep again\n",
+			smc_host->pdev->id, tc->sclk_dly);
+		tc->valid = 0;
+	}
+
 	SMC_MSG(smc_host, "sdc%d executes tuning operation\n", smc_host->pdev->id);
 	/*
 	 * The Host Controller needs tuning only in case of SDR104 mode
@@ -1345,70 +1805,31 @@ static int sw_mci_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	 * timeout of 150ms occurs.
 	 */
 	do {
-		struct mmc_command cmd = {0};
-		struct mmc_data data = {0};
-		struct mmc_request mrq = {0};
-		struct scatterlist sg;
-
 		sw_mci_set_clk_dly(smc_host, smc_host->oclk_dly, sample_dly);
-		cmd.opcode = opcode;
-		cmd.arg = 0;
-		cmd.flags = MMC_RSP_R1 | MMC_CMD_ADTC;
-		if (opcode == MMC_SEND_TUNING_BLOCK_HS200) {
-			if (mmc->ios.bus_width == MMC_BUS_WIDTH_8) {
-				sg.length = 128;
-				data.blksz = 128;
-				std_pattern = (char*)tuning_blk_8b;
-			} else if (mmc->ios.bus_width == MMC_BUS_WIDTH_4) {
-				sg.length = 64;
-				data.blksz = 64;
-				std_pattern = (char*)tuning_blk_4b;
-			}
-		} else {
-			sg.length = 64;
-			data.blksz = 64;
-			std_pattern = (char*)tuning_blk_4b;
-		}
-		data.blocks = 1;
-		data.flags = MMC_DATA_READ;
-		data.sg = &sg;
-		data.sg_len = 1;
-		sg_init_one(&sg, rcv_pattern, sg.length);
-
-		mrq.cmd = &cmd;
-		mrq.data = &data;
-
-		mmc_wait_for_req(mmc, &mrq);
+		err = sw_mci_send_tuning(mmc, opcode, rcv_pattern);
 		/*
 		 * If no error happened in the transmission, compare data with
 		 * the tuning pattern. If there is no error, record the minimal
 		 * and the maximal value of the sampling clock delay to find
 		 * the best sampling point in the sampling window.
 		 */
-		if (!cmd.error && !data.error) {
-			if (!memcmp(rcv_pattern, std_pattern, data.blksz)) {
-				SMC_MSG(smc_host, "sdc%d tuning ok, sclk_dly %d\n",
-					smc_host->pdev->id, sample_dly);
-				if (!sample_win)
-					sample_min = sample_dly;
-				sample_win++;
-				if (sample_dly == 7) {
-					SMC_MSG(smc_host, "sdc%d tuning reach to max sclk_dly 7\n",
-						smc_host->pdev->id);
-					tuning_done = 1;
-					sample_max = sample_dly;
-					break;
-				}
-			} else if (sample_win) {
-				SMC_MSG(smc_host, "sdc%d tuning data failed, sclk_dly %d\n",
-					smc_host->pdev->id, sample_dly);
+		if (!err) {
+			SMC_MSG(smc_host, "sdc%d tuning ok, sclk_dly %d\n",
+				smc_host->pdev->id, sample_dly);
+			if (!sample_win)
+				sample_min = sample_dly;
+			sample_win++;
+			if (sample_dly == 7) {
+				SMC_MSG(smc_host, "sdc%d tuning reach to max sclk_dly 7\n",
+					smc_host->pdev->id);
 				tuning_done = 1;
-				sample_max = sample_dly-1;
+				sample_max = sample_dly;
 				break;
 			}
 		} else if (sample_win) {
-			SMC_MSG(smc_host, "sdc%d tuning trans fail, sclk_dly %d\n",
-				smc_host->pdev->id, sample_dly);
+			SMC_MSG(smc_host, "sdc%d tuning %s failed, sclk_dly %d\n",
+				smc_host->pdev->id, err == -EILSEQ ? "data" : "trans",
+				sample_dly);
 			tuning_done = 1;
 			sample_max = sample_dly-1;
 			break;
@@ -1425,6 +1846,15 @@ static int sw_mci_execute_tuning(struct mmc_host *mmc, u32 opcode)
 		SMC_MSG(smc_host, "sdc%d sample_window:[%d, %d], sample_point %d\n",
 				smc_host->pdev->id, sample_min, sample_max, sample_dly);
 		sw_mci_set_clk_dly(smc_host, smc_host->oclk_dly, sample_dly);
+		smc_host->tune_cached = 0;
+		smc_host->tune_win_min = sample_min;
+		smc_host->tune_win_max = sample_max;
+		smc_host->tune_pending.timing = mmc->ios.timing;
+		smc_host->tune_pending.clock = smc_host->card_clk;
+		smc_host->tune_pending.sclk_dly = sample_dly;
+		smc_host->tune_pending.valid = 1;
+		if (mmc->card)
+			sw_mci_tune_commit(smc_host, mmc->card->raw_cid);
 		err = 0;
 	} else {
 		SMC_ERR(smc_host, "sdc%d cannot find a sample point\n", smc_host->pdev->id);
@@ -1483,8 +1913,21 @@ int sw_mci_check_r1_ready(struct mmc_host* mmc, unsigned ms)
 }
 EXPORT_SYMBOL_GPL(sw_mci_check_r1_ready);
 
+/* for the SDIO drivers written against the old sunxi-host: 1 if ready */
+int sunximmc_check_r1_ready(struct mmc_host *mmc)
+{
+	struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+
+	return !(mci_readl(smc_host, REG_STAS) & SDXC_CardDataBusy);
+}
+EXPORT_SYMBOL_GPL(sunximmc_check_r1_ready);
+
 static struct mmc_host_ops sw_mci_ops = {
+	.enable		= sw_mci_enable,
+	.disable	= sw_mci_disable,
 	.request	= sw_mci_request,
+	.pre_req	= sw_mci_pre_req,
+	.post_req	= sw_mci_post_req,
 	.set_ios	= sw_mci_set_ios,
 	.get_ro		= sw_mci_get_ro,
 	.get_cd		= sw_mci_card_present,
@@ -1534,6 +1977,21 @@ static int sw_mci_proc_hostinfo(char *page, char **start, off_t off,
 	p += sprintf(p, " Read Only : %d\n", smc_host->read_only);
 	p += sprintf(p, " State     : %s\n", state[smc_host->state]);
 	p += sprintf(p, " Regulator : %s\n", smc_host->pdata->regulator);
+	if (smc_host->tune_cur >= 0)
+		p += sprintf(p, " Tuning    : timing %d clk %d sclk_dly %d (%s)\n",
+			smc_host->tune_cache[smc_host->tune_cur].timing,
+			smc_host->tune_cache[smc_host->tune_cur].clock,
+			smc_host->tune_cache[smc_host->tune_cur].sclk_dly,
+			smc_host->tune_cached ? "cached" : "swept");
+	else if (smc_host->tune_pending.valid)
+		p += sprintf(p, " Tuning    : timing %d clk %d sclk_dly %d (swept)\n",
+			smc_host->tune_pending.timing, smc_host->tune_pending.clock,
+			smc_host->tune_pending.sclk_dly);
+	else
+		p += sprintf(p, " Tuning    : none\n");
+	if (!smc_host->tune_cached && (smc_host->tune_cur >= 0 || smc_host->tune_pending.valid))
+		p += sprintf(p, " Tune Win  : [%d, %d]\n",
+			smc_host->tune_win_min, smc_host->tune_win_max);
 
 	return p - page;
 }
@@ -1733,6 +2191,146 @@ void sw_mci_procfs_remove(struct sunxi_mmc_host *smc_host) { }
 
 #endif	//PROC_FS
 
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+/* debugfs layout: sunxi-mmc/<device>/{stats,registers} */
+static struct dentry *sw_mci_dbgfs_root;
+
+static int sw_mci_dbg_stats_show(struct seq_file *seq, void *v)
+{
+	struct sunxi_mmc_host *smc_host = seq->private;
+	struct sw_mci_stats *st = &smc_host->stats;
+	int i;
+
+	seq_printf(seq, "bytes read:       %llu\n", st->bytes_read);
+	seq_printf(seq, "bytes written:    %llu\n", st->bytes_written);
+	seq_printf(seq, "data requests:    %lu\n", st->dma_reqs);
+	seq_printf(seq, "  pre-mapped:     %lu\n", st->dma_premapped);
+	seq_printf(seq, "  through pio:    %lu\n", st->pio_reqs);
+	seq_printf(seq, "polled commands:  %lu\n", st->polled_cmds);
+	seq_printf(seq, "irq commands:     %lu\n", st->irq_cmds);
+	seq_printf(seq, "crc errors:       %lu\n", st->crc_errs);
+	seq_printf(seq, "timeouts:         %lu\n", st->timeouts);
+	seq_printf(seq, "other errors:     %lu\n", st->other_errs);
+	seq_printf(seq, "manual stops:     %lu\n", st->manual_stops);
+
+	seq_printf(seq, "\ncommands by opcode:\n");
+	for (i = 0; i < ARRAY_SIZE(st->cmds); i++)
+		if (st->cmds[i])
+			seq_printf(seq, "  CMD%-2d %lu\n", i, st->cmds[i]);
+
+	seq_printf(seq, "\nrequest to completion latency:\n");
+	for (i = 0; i < SDC_HIST_BUCKETS; i++) {
+		if (i == SDC_HIST_BUCKETS - 1)
+			seq_printf(seq, "  >= %-6u usecs %lu\n", 1U << i, st->lat[i]);
+		else
+			seq_printf(seq, "  < %-7u usecs %lu\n", 2U << i, st->lat[i]);
+	}
+
+	return 0;
+}
+
+static int sw_mci_dbg_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sw_mci_dbg_stats_show, inode->i_private);
+}
+
+/* Any write clears the counters and the histogram */
+static ssize_t sw_mci_dbg_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *seq = file->private_data;
+	struct sunxi_mmc_host *smc_host = seq->private;
+
+	memset(&smc_host->stats, 0, sizeof(struct sw_mci_stats));
+
+	return count;
+}
+
+static const struct file_operations sw_mci_dbg_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = sw_mci_dbg_stats_open,
+	.read = seq_read,
+	.write = sw_mci_dbg_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int sw_mci_dbg_regs_show(struct seq_file *seq, void *v)
+{
+	struct sunxi_mmc_host *smc_host = seq->private;
+	u32 i;
+
+	for (i=0; i<0x100; i+=4) {
+		if (!(i&0xf))
+			seq_printf(seq, "%s0x%08x : ", i ? "\n" : "",
+				   (u32)(smc_host->reg_base + i));
+		seq_printf(seq, "%08x ", readl(smc_host->reg_base + i));
+	}
+	seq_printf(seq, "\n");
+
+	return 0;
+}
+
+static int sw_mci_dbg_regs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sw_mci_dbg_regs_show, inode->i_private);
+}
+
+static const struct file_operations sw_mci_dbg_regs_fops = {
+	.owner = THIS_MODULE,
+	.open = sw_mci_dbg_regs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void sw_mci_debugfs_attach(struct sunxi_mmc_host *smc_host)
+{
+	struct device *dev = &smc_host->pdev->dev;
+	struct dentry *entry;
+
+	if (!sw_mci_dbgfs_root)
+		sw_mci_dbgfs_root = debugfs_create_dir("sunxi-mmc", NULL);
+	if (!sw_mci_dbgfs_root || IS_ERR(sw_mci_dbgfs_root)) {
+		sw_mci_dbgfs_root = NULL;
+		return;
+	}
+
+	smc_host->dbgfs_dir = debugfs_create_dir(dev_name(dev), sw_mci_dbgfs_root);
+	if (!smc_host->dbgfs_dir || IS_ERR(smc_host->dbgfs_dir)) {
+		smc_host->dbgfs_dir = NULL;
+		goto err;
+	}
+
+	entry = debugfs_create_file("stats", S_IRUGO | S_IWUSR,
+				smc_host->dbgfs_dir, smc_host, &sw_mci_dbg_stats_fops);
+	if (!entry || IS_ERR(entry))
+		goto err;
+	entry = debugfs_create_file("registers", S_IRUGO,
+				smc_host->dbgfs_dir, smc_host, &sw_mci_dbg_regs_fops);
+	if (!entry || IS_ERR(entry))
+		goto err;
+	return;
+
+err:
+	SMC_MSG(smc_host, "%s: failed to create debugfs entries.\n", dev_name(dev));
+	debugfs_remove_recursive(smc_host->dbgfs_dir);
+	smc_host->dbgfs_dir = NULL;
+}
+
+static void sw_mci_debugfs_remove(struct sunxi_mmc_host *smc_host)
+{
+	debugfs_remove_recursive(smc_host->dbgfs_dir);
+	smc_host->dbgfs_dir = NULL;
+}
+
+#else
+
+static void sw_mci_debugfs_attach(struct sunxi_mmc_host *smc_host) { }
+static void sw_mci_debugfs_remove(struct sunxi_mmc_host *smc_host) { }
+
+#endif	//CONFIG_MMC_SUNXI_DEBUG_FS
+
 static int __devinit sw_mci_probe(struct platform_device *pdev)
 {
 	struct sunxi_mmc_host *smc_host = NULL;
@@ -1754,9 +2352,9 @@ static int __devinit sw_mci_probe(struct platform_device *pdev)
 	smc_host->cd_mode = smc_host->pdata->cdmode;
 	smc_host->io_flag = smc_host->pdata->isiodev ? 1 : 0;
 	smc_host->debuglevel = CONFIG_MMC_PRE_DBGLVL_SUNXI;
+	smc_host->tune_cur = -1;
 
 	spin_lock_init(&smc_host->lock);
-	tasklet_init(&smc_host->tasklet, sw_mci_tasklet, (unsigned long) smc_host);
 
 	if (sw_mci_resource_request(smc_host)) {
 		SMC_ERR(smc_host, "%s: Failed to get resouce.\n", dev_name(&pdev->dev));
@@ -1774,14 +2372,17 @@ static int __devinit sw_mci_probe(struct platform_device *pdev)
 	sw_mci_init_host(smc_host);
 
 	sw_mci_procfs_attach(smc_host);
+	sw_mci_debugfs_attach(smc_host);
 
 	smc_host->irq = SMC_IRQNO(pdev->id);
-	if (request_irq(smc_host->irq, sw_mci_irq, 0, DRIVER_NAME, smc_host)) {
+	if (request_threaded_irq(smc_host->irq, sw_mci_irq, sw_mci_irq_thread,
+				 0, DRIVER_NAME, smc_host)) {
 		SMC_ERR(smc_host, "Failed to request smc card interrupt.\n");
 		ret = -ENOENT;
 		goto probe_free_resource;
 	}
 	disable_irq(smc_host->irq);
+	sunxi_irq_spread(smc_host->irq, SUNXI_IRQ_SLOT_MMC(pdev->id));
 
 	if (smc_host->cd_mode == CARD_ALWAYS_PRESENT) {
 		smc_host->present = 1;
@@ -1819,11 +2420,25 @@ static int __devinit sw_mci_probe(struct platform_device *pdev)
 	mmc->max_blk_count	= 8192;
 	mmc->max_blk_size	= 4096;
 	mmc->max_req_size	= mmc->max_blk_size * mmc->max_blk_count;
-	mmc->max_seg_size	= mmc->max_req_size;
-	mmc->max_segs	    	= 128;
+	mmc->max_segs	    	= 256;
+	/* keep a full request inside one descriptor table */
+	mmc->max_seg_size	= SW_MCI_DES_PER_TABLE / mmc->max_segs
+				  * SDXC_DES_BUFFER_MAX_LEN;
 	if (smc_host->io_flag)
 		mmc->pm_flags = MMC_PM_IGNORE_PM_NOTIFY;
 
+	if (smc_host->io_flag && (mmc->caps & MMC_CAP_SDIO_IRQ)) {
+		smc_host->sdio_task = kthread_create(sw_mci_sdio_thread, smc_host,
+						     "sdio_irq/sdc%d", pdev->id);
+		if (IS_ERR(smc_host->sdio_task)) {
+			SMC_ERR(smc_host, "no sdio irq thread, using ksdioirqd\n");
+			smc_host->sdio_task = NULL;
+		} else {
+			mmc->caps2 |= MMC_CAP2_SDIO_IRQ_NOTHREAD;
+			wake_up_process(smc_host->sdio_task);
+		}
+	}
+
 	ret = mmc_add_host(mmc);
 	if (ret) {
 		SMC_ERR(smc_host, "Failed to add mmc host.\n");
@@ -1831,6 +2446,11 @@ static int __devinit sw_mci_probe(struct platform_device *pdev)
 	}
 	platform_set_drvdata(pdev, mmc);
 
+	pm_runtime_set_active(&pdev->dev);
+	pm_runtime_set_autosuspend_delay(&pdev->dev, SDC_AUTOSUSPEND_MS);
+	pm_runtime_use_autosuspend(&pdev->dev);
+	pm_runtime_enable(&pdev->dev);
+
 	mutex_lock(&sw_host_rescan_mutex);
 	if (sw_host_rescan_pending[pdev->id]) {
 		smc_host->present = 1;
@@ -1846,9 +2466,14 @@ static int __devinit sw_mci_probe(struct platform_device *pdev)
 	goto probe_out;
 
 probe_free_irq:
-	if (smc_host->irq)
+	if (smc_host->sdio_task)
+		kthread_stop(smc_host->sdio_task);
+	if (smc_host->irq) {
+		sunxi_irq_unspread(smc_host->irq);
 		free_irq(smc_host->irq, smc_host);
+	}
 probe_free_resource:
+	sw_mci_debugfs_remove(smc_host);
 	sw_mci_resource_release(smc_host);
 probe_free_host:
 	mmc_free_host(mmc);
@@ -1865,11 +2490,16 @@ static int __devexit sw_mci_remove(struct platform_device *pdev)
 
 	sw_mci_exit_host(smc_host);
 
+	sw_mci_debugfs_remove(smc_host);
 	sw_mci_procfs_remove(smc_host);
 	mmc_remove_host(mmc);
+	pm_runtime_disable(&pdev->dev);
+	pm_runtime_dont_use_autosuspend(&pdev->dev);
 
-	tasklet_disable(&smc_host->tasklet);
+	sunxi_irq_unspread(smc_host->irq);
 	free_irq(smc_host->irq, smc_host);
+	if (smc_host->sdio_task)
+		kthread_stop(smc_host->sdio_task);
 	if (smc_host->cd_mode == CARD_DETECT_BY_GPIO_POLL)
 		del_timer(&smc_host->cd_timer);
 #if 0
@@ -1915,6 +2545,55 @@ void sw_mci_regs_restore(struct sunxi_mmc_host* smc_host)
 	mci_writel(smc_host, REG_DMAC , bak_regs->idmacc  );
 }
 
+#ifdef CONFIG_PM_RUNTIME
+/*
+ * Only the module clock is gated: the controller registers sit on the AHB
+ * clock and keep the bus width, timing and card clock divider, so coming
+ * back is a clock enable and one update-clock command rather than a full
+ * sw_mci_set_clk().
+ */
+static int sw_mci_runtime_suspend(struct device *dev)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct sunxi_mmc_host *smc_host;
+
+	if (!mmc)
+		return 0;
+	smc_host = mmc_priv(mmc);
+	if (!smc_host->power_on || smc_host->clk_gated)
+		return 0;
+	/* SDIO in-band interrupts need the card clock */
+	if (mmc->sdio_irqs)
+		return -EBUSY;
+
+	smc_host->bak_regs.clkc = mci_readl(smc_host, REG_CLKCR);
+	sw_mci_oclk_onoff(smc_host, 0, 0);
+	clk_disable(smc_host->mclk);
+	smc_host->clk_gated = 1;
+	return 0;
+}
+
+static int sw_mci_runtime_resume(struct device *dev)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct sunxi_mmc_host *smc_host;
+
+	if (!mmc)
+		return 0;
+	smc_host = mmc_priv(mmc);
+	if (!smc_host->clk_gated)
+		return 0;
+
+	/* put back the tuned phase in case the gate cleared it */
+	sw_mci_set_clk_dly(smc_host, smc_host->oclk_dly, smc_host->sclk_dly);
+	clk_enable(smc_host->mclk);
+	mci_writel(smc_host, REG_CLKCR, smc_host->bak_regs.clkc);
+	sw_mci_update_clk(smc_host);
+	smc_host->clk_gated = 0;
+	return 0;
+}
+#endif
+
 static int sw_mci_suspend(struct device *dev)
 {
 	struct platform_device *pdev = to_platform_device(dev);
@@ -1923,8 +2602,12 @@ static int sw_mci_suspend(struct device *dev)
 
 	if (mmc) {
 		struct sunxi_mmc_host *smc_host = mmc_priv(mmc);
+		/* the clock handling below expects mclk running */
+		pm_runtime_get_sync(dev);
 		ret = mmc_suspend_host(mmc);
 		smc_host->suspend = ret ? 0 : 1;
+		if (ret)
+			pm_runtime_put_autosuspend(dev);
 		if (!ret && mmc_card_keep_power(mmc)) {
 			sw_mci_regs_save(smc_host);
 			/* gate clock for lower power */
@@ -1957,6 +2640,8 @@ static int sw_mci_resume(struct device *dev)
 			sw_mci_cd_cb((unsigned long)smc_host);
 		ret = mmc_resume_host(mmc);
 		smc_host->suspend = ret ? 1 : 0;
+		pm_runtime_mark_last_busy(dev);
+		pm_runtime_put_autosuspend(dev);
 		SMC_MSG(NULL, "smc %d resume\n", pdev->id);
 	}
 
@@ -1966,6 +2651,7 @@ static int sw_mci_resume(struct device *dev)
 static const struct dev_pm_ops sw_mci_pm = {
 	.suspend	= sw_mci_suspend,
 	.resume		= sw_mci_resume,
+	SET_RUNTIME_PM_OPS(sw_mci_runtime_suspend, sw_mci_runtime_resume, NULL)
 };
 #define sw_mci_pm_ops &sw_mci_pm
 
@@ -2011,7 +2697,7 @@ static struct sunxi_mmc_platform_data sw_mci_pdata[4] = {
 			#endif
 			| MMC_CAP_SDIO_IRQ
 			| MMC_CAP_SET_XPC_330 | MMC_CAP_DRIVER_TYPE_A,
-		.caps2 = MMC_CAP2_HS200_1_8V_SDR,
+		.caps2 = MMC_CAP2_HS200_1_8V_SDR | MMC_CAP2_CACHE_CTRL,
 		.f_min = 400000,
 		.f_max = 120000000,
 		.f_ddr_max = 50000000,
@@ -2028,7 +2714,7 @@ static struct sunxi_mmc_platform_data sw_mci_pdata[4] = {
 			| MMC_CAP_8_BIT_DATA
 			| MMC_CAP_SDIO_IRQ
 			| MMC_CAP_SET_XPC_330 | MMC_CAP_DRIVER_TYPE_A,
-		.caps2 = MMC_CAP2_HS200_1_8V_SDR,
+		.caps2 = MMC_CAP2_HS200_1_8V_SDR | MMC_CAP2_CACHE_CTRL,
 		.f_min = 400000,
 		.f_max = 120000000,
 		.f_ddr_max = 50000000,
@@ -2198,15 +2884,19 @@ static int __init sw_mci_init(void)
 					sdc_used, boot_card, io_used);
 	/* register boot card firstly */
 	for (i = 0; i < sw_host_num; i++) {
-		if (boot_card & (1 << i))
+		if (boot_card & (1 << i)) {
 			platform_device_register(&sw_mci_device[i]);
+			device_enable_async_suspend(&sw_mci_device[i].dev);
+		}
 	}
-	/* register other cards */
+	/* register other cards, the hosts don't depend on each other */
 	for (i = 0; i < sw_host_num; i++) {
 		if (boot_card & (1 << i))
 			continue;
-		if (sdc_used & (1 << i))
+		if (sdc_used & (1 << i)) {
 			platform_device_register(&sw_mci_device[i]);
+			device_enable_async_suspend(&sw_mci_device[i].dev);
+		}
 	}
 
 	return platform_driver_register(&sw_mci_driver);
@@ -2216,6 +2906,9 @@ static void __exit sw_mci_exit(void)
 {
 	SMC_MSG(NULL, "sw_mci_exit\n");
 	platform_driver_unregister(&sw_mci_driver);
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+	debugfs_remove(sw_mci_dbgfs_root);
+#endif
 }
 
 
@@ -195,6 +195,7 @@
 #define SDXC_DataFSMBusy	BIT(10)
 #define SDXC_DMAReq		BIT(31)
 #define SDXC_FIFO_SIZE		(16)
+#define SDXC_FIFO_LEVEL(stas)	(((stas) >> 17) & 0x1f)	/* in words */
 /* Function select */
 #define SDXC_CEATAOn		(0xceaaU << 16)
 #define SDXC_SendIrqRsp		BIT(0)
@@ -250,6 +251,17 @@ struct sunxi_mmc_idma_des {
 	u32	buf_addr_ptr2;
 };
 
+/*
+ * Two IDMA descriptor tables, the next request is built while one runs.
+ * Each holds 512 descriptors, so 256 segments of up to 64KiB fit in one.
+ */
+#define SW_MCI_DES_TABLES	(2)
+#define SW_MCI_DES_TABLE_SIZE	(2 * PAGE_SIZE)
+#define SW_MCI_DES_PER_TABLE	(SW_MCI_DES_TABLE_SIZE / sizeof(struct sunxi_mmc_idma_des))
+/* mmc_data.host_cookie: descriptor table + 1, and whether pre_req mapped it */
+#define SW_MCI_COOKIE_TABLE	(0xff)
+#define SW_MCI_COOKIE_PRE	(0x100)
+
 struct sunxi_mmc_ctrl_regs {
 	u32 gctrl;
 	u32 clkc;
@@ -261,6 +273,37 @@ struct sunxi_mmc_ctrl_regs {
 	u32 idmacc;
 };
 
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+/* log2 buckets of request to completion latency, in usecs */
+#define SDC_HIST_BUCKETS	(16)
+struct sw_mci_stats {
+	unsigned long cmds[64];		/* by opcode */
+	u64 bytes_read;
+	u64 bytes_written;
+	unsigned long dma_reqs;		/* data requests */
+	unsigned long dma_premapped;	/* ... mapped ahead by pre_req */
+	unsigned long pio_reqs;		/* ... moved through the FIFO by the CPU */
+	unsigned long polled_cmds;	/* completed without an interrupt */
+	unsigned long irq_cmds;
+	unsigned long crc_errs;
+	unsigned long timeouts;
+	unsigned long other_errs;
+	unsigned long manual_stops;
+	unsigned long lat[SDC_HIST_BUCKETS];
+	u32 start;			/* stamp of the request in flight */
+};
+#endif
+
+/* tuned sample point of one card at one timing and clock */
+struct sw_mci_tune_cache {
+	u32 cid[4];
+	u32 timing;
+	u32 clock;
+	u32 sclk_dly;
+	u32 valid;
+};
+#define SDC_TUNE_CACHE_NUM	(4)
+
 struct sunxi_mmc_platform_data {
 	/* predefine information */
 	u32 ocr_avail;
@@ -295,7 +338,6 @@ struct sunxi_mmc_host {
 	/* IO mapping base */
 	void __iomem 	*reg_base;
 	spinlock_t 	lock;
-	struct tasklet_struct tasklet;
 
 	/* clock management */
 	struct clk 	*hclk;
@@ -323,8 +365,11 @@ struct sunxi_mmc_host {
 
 	volatile u32 	trans_done:1;
 	volatile u32 	dma_done:1;
+	volatile u32 	pio:1;		/* data of this request through the FIFO */
+	u32		pio_count;	/* bytes moved so far */
 	dma_addr_t	sg_dma;
 	void		*sg_cpu;
+	u32		des_used;	/* SW_MCI_DES_TABLES in use */
 
 	struct mmc_request *mrq;
 	volatile u32	error;
@@ -341,6 +386,11 @@ struct sunxi_mmc_host {
 #define SDC_WAIT_SWITCH1V8	(1<<7)
 #define SDC_WAIT_FINALIZE	(1<<8)
 	volatile u32	state;
+/* spin this long for a short command before falling back to the IRQ */
+#define SDC_CMD_POLL_US		(30)
+/* default idle time before runtime PM gates the module clock */
+#define SDC_AUTOSUSPEND_MS	(50)
+
 #define SDC_STATE_IDLE		(0)
 #define SDC_STATE_SENDCMD	(1)
 #define SDC_STATE_CMDDONE	(2)
@@ -358,6 +408,11 @@ struct sunxi_mmc_host {
 	u32 read_only:8;
 	u32 io_flag:8;
 	u32 suspend:8;
+	u32 clk_gated;		/* mclk gated by runtime PM */
+
+	/* runs the SDIO card interrupts of an io host, see sw_mci_sdio_thread */
+	struct task_struct *sdio_task;
+	unsigned long	sdio_pending;
 
 	u32 debuglevel;
 #ifdef CONFIG_PROC_FS
@@ -372,6 +427,20 @@ struct sunxi_mmc_host {
 
 	/* backup register structrue */
 	struct sunxi_mmc_ctrl_regs bak_regs;
+
+	/* tuning results per card CID */
+	struct sw_mci_tune_cache tune_cache[SDC_TUNE_CACHE_NUM];
+	struct sw_mci_tune_cache tune_pending;
+	s32 tune_cur;		/* entry in use, -1 if none */
+	u32 tune_next;		/* entry to replace next */
+	u32 tune_cached;	/* last tuning reused the cache */
+	u32 tune_win_min;
+	u32 tune_win_max;
+
+#ifdef CONFIG_MMC_SUNXI_DEBUG_FS
+	struct dentry *dbgfs_dir;
+	struct sw_mci_stats stats;
+#endif
 };
 
 #define SMC_MSG(d, ...) \
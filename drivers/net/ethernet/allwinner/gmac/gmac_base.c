@@ -67,8 +67,7 @@ int gdma_init(void __iomem *ioaddr, int pbl, u32 dma_tx,
 	writel(GDMA_DEF_INTR, ioaddr + GDMA_INTR_ENA);
 
 	/* Write the base address of Rx/Tx descriptor lists into registers */
-	writel(dma_tx, ioaddr + GDMA_XMT_LIST);
-	writel(dma_rx, ioaddr + GDMA_RCV_LIST);
+	dma_set_desc_lists(ioaddr, dma_tx, dma_rx);
 
 	return 0;
 }
@@ -333,57 +332,71 @@ void core_dump_regs(void __iomem *ioaddr)
 	}
 }
 
+/* The upper 6 bits of the calculated CRC are used to index the contents
+ * of the hash table: the most significant one selects the register
+ * (H/L), the other 5 bits the bit within the register. */
+static inline int gmac_hash_bit(const unsigned char *addr)
+{
+	return bitrev32(~crc32_le(~0, addr, ETH_ALEN)) >> 26;
+}
+
+/*
+ * Unicast addresses get the perfect filter entries first. Multicast
+ * groups use the remaining entries while they fit, so nothing else gets
+ * through, then the 64-bit hash table. All-multi is only used when asked
+ * for or when the groups set every bit of the hash table anyway.
+ */
 void core_set_filter(struct net_device *dev)
 {
 	void __iomem *ioaddr = (void __iomem *) dev->base_addr;
 	unsigned int value = 0;
+	u32 mc_filter[2] = { 0, 0 };
+	struct netdev_hw_addr *ha;
+	int reg = 1;
 
 	pr_debug(KERN_INFO "%s: # mcasts %d, # unicast %d\n",
 		 __func__, netdev_mc_count(dev), netdev_uc_count(dev));
 
-	if (dev->flags & IFF_PROMISC)
+	if (dev->flags & IFF_PROMISC) {
 		value = GMAC_FRAME_FILTER_PR;
-	else if ((netdev_mc_count(dev) > HASH_TABLE_SIZE)
-		   || (dev->flags & IFF_ALLMULTI)) {
-		value = GMAC_FRAME_FILTER_PM;	/* pass all multi */
-		writel(0xffffffff, ioaddr + GMAC_HASH_HIGH);
-		writel(0xffffffff, ioaddr + GMAC_HASH_LOW);
-	} else if (!netdev_mc_empty(dev)) {
-		u32 mc_filter[2];
-		struct netdev_hw_addr *ha;
+		goto out;
+	}
 
+	/* Handle multiple unicast addresses (perfect filtering) */
+	if (netdev_uc_count(dev) > GMAC_PERFECT_FILTERS)
+		/* Switch to promiscuous mode if more addresses than the
+		   perfect filter entries are required */
+		value |= GMAC_FRAME_FILTER_PR;
+	else
+		netdev_for_each_uc_addr(ha, dev)
+			gmac_set_umac_addr(ioaddr, ha->addr, reg++);
+
+	if (dev->flags & IFF_ALLMULTI) {
+		value |= GMAC_FRAME_FILTER_PM;	/* pass all multi */
+	} else if (netdev_mc_count(dev) <= GMAC_PERFECT_FILTERS - (reg - 1)) {
+		netdev_for_each_mc_addr(ha, dev)
+			gmac_set_umac_addr(ioaddr, ha->addr, reg++);
+	} else {
 		/* Hash filter for multicast */
-		value = GMAC_FRAME_FILTER_HMC;
-
-		memset(mc_filter, 0, sizeof(mc_filter));
 		netdev_for_each_mc_addr(ha, dev) {
-			/* The upper 6 bits of the calculated CRC are used to
-			   index the contens of the hash table */
-			int bit_nr =
-			    bitrev32(~crc32_le(~0, ha->addr, 6)) >> 26;
-			/* The most significant bit determines the register to
-			 * use (H/L) while the other 5 bits determine the bit
-			 * within the register. */
+			int bit_nr = gmac_hash_bit(ha->addr);
+
 			mc_filter[bit_nr >> 5] |= 1 << (bit_nr & 31);
 		}
-		writel(mc_filter[0], ioaddr + GMAC_HASH_LOW);
-		writel(mc_filter[1], ioaddr + GMAC_HASH_HIGH);
+
+		if ((mc_filter[0] & mc_filter[1]) == 0xffffffff)
+			value |= GMAC_FRAME_FILTER_PM;
+		else
+			value |= GMAC_FRAME_FILTER_HMC;
 	}
 
-	/* Handle multiple unicast addresses (perfect filtering)*/
-	if (netdev_uc_count(dev) > GMAC_MAX_UNICAST_ADDRESSES)
-		/* Switch to promiscuous mode is more than 8 addrs
-		   are required */
-		value |= GMAC_FRAME_FILTER_PR;
-	else {
-		int reg = 1;
-		struct netdev_hw_addr *ha;
+out:
+	/* Disable the entries left over from a previous, larger list */
+	for (; reg < GMAC_MAX_UNICAST_ADDRESSES; reg++)
+		writel(0, ioaddr + GMAC_ADDR_HI(reg));
 
-		netdev_for_each_uc_addr(ha, dev) {
-			gmac_set_umac_addr(ioaddr, ha->addr, reg);
-			reg++;
-		}
-	}
+	writel(mc_filter[0], ioaddr + GMAC_HASH_LOW);
+	writel(mc_filter[1], ioaddr + GMAC_HASH_HIGH);
 
 #ifdef FRAME_FILTER_DEBUG
 	/* Enable Receive all mode (to debug filtering_fail errors) */
@@ -419,12 +432,32 @@ void core_flow_ctrl(void __iomem *ioaddr, unsigned int duplex,
 	writel(flow, ioaddr + GMAC_FLOW_CTRL);
 }
 
-void core_irq_status(void __iomem *ioaddr)
+void core_irq_status(void __iomem *ioaddr, struct gmac_extra_stats *x)
 {
 	u32 intr_status = readl(ioaddr + GMAC_INT_STATUS);
 
 	if (intr_status & RGMII_IRQ)
 		readl(ioaddr + GMAC_RGMII_STATUS);
+
+	/* Reading the PMT register clears the wake-up status */
+	if (intr_status & PMT_IRQ) {
+		readl(ioaddr + GMAC_PMT);
+		x->pmt_irq_n++;
+	}
+}
+
+/* Arm the power management block with WAKE_* bits, or disarm it with 0.
+ * In power down the MAC drops every frame until a wake-up event. */
+void core_pmt(void __iomem *ioaddr, unsigned long mode)
+{
+	u32 pmt = 0;
+
+	if (mode & WAKE_MAGIC)
+		pmt |= PMT_PD | PMT_MPE;
+	if (mode & WAKE_UCAST)
+		pmt |= PMT_PD | PMT_WFE | PMT_GU;
+
+	writel(pmt, ioaddr + GMAC_PMT);
 }
 
 void gmac_set_umac_addr(void __iomem *ioaddr, unsigned char *addr, unsigned int reg_n)
@@ -432,6 +465,9 @@ void gmac_set_umac_addr(void __iomem *ioaddr, unsigned char *addr, unsigned int
 	unsigned long data;
 
 	data = (addr[5] << 8) | addr[4];
+	/* Only the additional entries have an enable bit */
+	if (reg_n)
+		data |= GMAC_ADDR_AE;
 	writel(data, ioaddr + GMAC_ADDR_HI(reg_n));
 	data = (addr[3] << 24) | (addr[2] << 16) | (addr[1] << 8) | addr[0];
 	writel(data, ioaddr + GMAC_ADDR_LO(reg_n));
@@ -17,6 +17,26 @@ static inline void dma_dis_irq(void __iomem *ioaddr)
 	writel(0, ioaddr + GDMA_INTR_ENA);
 }
 
+/* Delay the RX interrupt of descriptors that have RDES1 dis_ic set */
+static inline void dma_rx_watchdog(void __iomem *ioaddr, u32 riwt)
+{
+	writel(riwt & GDMA_RX_WDT_MASK, ioaddr + GDMA_RX_WDT);
+}
+
+/* Base address of the Rx/Tx descriptor lists, only while the DMA is stopped */
+static inline void dma_set_desc_lists(void __iomem *ioaddr, u32 dma_tx,
+				      u32 dma_rx)
+{
+	writel(dma_tx, ioaddr + GDMA_XMT_LIST);
+	writel(dma_rx, ioaddr + GDMA_RCV_LIST);
+}
+
+/* Rewind the transmit DMA to the start of its ring, DMA stopped */
+static inline void dma_set_tx_list(void __iomem *ioaddr, u32 dma_tx)
+{
+	writel(dma_tx, ioaddr + GDMA_XMT_LIST);
+}
+
 static inline void dma_start_tx(void __iomem *ioaddr)
 {
 	u32 value = readl(ioaddr + GDMA_OP_MODE);
@@ -56,7 +76,8 @@ int core_en_rx_coe(void __iomem *ioaddr);
 void core_set_filter(struct net_device *dev);
 void core_flow_ctrl(void __iomem *ioaddr, unsigned int duplex,
 					unsigned int fc, unsigned int pause_time);
-void core_irq_status(void __iomem *ioaddr);
+void core_irq_status(void __iomem *ioaddr, struct gmac_extra_stats *x);
+void core_pmt(void __iomem *ioaddr, unsigned long mode);
 void core_dump_regs(void __iomem *ioaddr);
 
 void gmac_set_umac_addr(void __iomem *ioaddr, unsigned char *addr,
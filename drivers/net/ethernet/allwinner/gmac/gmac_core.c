@@ -21,6 +21,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/ip.h>
+#include <linux/ipv6.h>
 #include <linux/tcp.h>
 #include <linux/skbuff.h>
 #include <linux/ethtool.h>
@@ -32,10 +33,12 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/prefetch.h>
+#include <linux/log2.h>
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/ctype.h>
 #include <linux/gpio.h>
+#include <net/sch_generic.h>
 
 #include <plat/sys_config.h>
 #include <plat/platform.h>
@@ -45,6 +48,7 @@
 #ifdef CONFIG_GMAC_DEBUG_FS
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/sched.h>
 #endif
 
 #include "sunxi_gmac.h"
@@ -129,10 +133,24 @@ module_param(tmrate, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(tmrate, "External timer freq. (default: 256Hz)");
 #endif
 
-#define DMA_BUFFER_SIZE	BUF_SIZE_2KiB
-static int buf_sz = DMA_BUFFER_SIZE;
-module_param(buf_sz, int, S_IRUGO | S_IWUSR);
-MODULE_PARM_DESC(buf_sz, "DMA buffer size");
+/* Each RX descriptor is backed by half a page that is mapped once and
+ * flipped between halves; only the headers are copied into a freshly
+ * allocated skb, the payload is attached as page frags. Jumbo frames
+ * span several descriptors, one frag each, so no high order allocation
+ * is ever needed. */
+#define GMAC_RX_PAGE_BUF	(PAGE_SIZE / 2)
+#define GMAC_RX_HDR_LEN		128
+
+/* Largest MTU; the MAC runs with jumbo frames enabled (GMAC_CTL_JE) */
+#define GMAC_JUMBO_MTU		9000
+#define GMAC_MAX_FRAME(mtu)	((mtu) + ETH_HLEN + VLAN_HLEN + ETH_FCS_LEN)
+
+/* Frames up to this size are copied into a new skb and the DMA buffer
+ * is given back to the ring right away. */
+#define GMAC_RX_COPYBREAK	256
+static int copybreak = GMAC_RX_COPYBREAK;
+module_param(copybreak, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(copybreak, "Maximum size of RX frame copied to a new skb");
 
 static int gmac_used;
 
@@ -144,7 +162,64 @@ static irqreturn_t gmac_interrupt(int irq, void *dev_id);
 
 #ifdef CONFIG_GMAC_DEBUG_FS
 static int gmac_init_fs(struct net_device *dev);
-static void gmac_exit_fs(void);
+static void gmac_exit_fs(struct net_device *dev);
+
+/* Cheap timestamp for the latency histograms, in 1.024 usecs units */
+static inline u32 gmac_dbg_stamp(void)
+{
+	return (u32)(sched_clock() >> 10);
+}
+
+static inline void gmac_dbg_hist(unsigned long *hist, u32 val)
+{
+	hist[min_t(int, val ? fls(val) - 1 : 0, GMAC_HIST_BUCKETS - 1)]++;
+}
+
+static inline void gmac_dbg_irq(struct gmac_priv *priv)
+{
+	if (!priv->irq_stamp)
+		priv->irq_stamp = gmac_dbg_stamp() | 1;
+}
+
+static inline void gmac_dbg_poll(struct gmac_priv *priv, int work_done,
+				 int budget)
+{
+	struct gmac_ring_stats *rs = &priv->rstats;
+
+	rs->napi_polls++;
+	if (priv->irq_stamp) {
+		gmac_dbg_hist(rs->irq_lat, gmac_dbg_stamp() - priv->irq_stamp);
+		priv->irq_stamp = 0;
+	}
+	gmac_dbg_hist(rs->poll_pkts, work_done);
+	if (work_done >= budget)
+		rs->napi_budget_hit++;
+}
+
+static inline void gmac_dbg_tx_post(struct gmac_priv *priv,
+				    unsigned int entry)
+{
+	priv->tx_stamp[entry] = gmac_dbg_stamp();
+}
+
+static inline void gmac_dbg_tx_done(struct gmac_priv *priv,
+				    unsigned int entry)
+{
+	gmac_dbg_hist(priv->rstats.tx_lat,
+		      gmac_dbg_stamp() - priv->tx_stamp[entry]);
+}
+
+#define GMAC_RSTAT_INC(priv, field)	((priv)->rstats.field++)
+#else
+static inline void gmac_dbg_irq(struct gmac_priv *priv) {}
+static inline void gmac_dbg_poll(struct gmac_priv *priv, int work_done,
+				 int budget) {}
+static inline void gmac_dbg_tx_post(struct gmac_priv *priv,
+				    unsigned int entry) {}
+static inline void gmac_dbg_tx_done(struct gmac_priv *priv,
+				    unsigned int entry) {}
+
+#define GMAC_RSTAT_INC(priv, field)	do { } while (0)
 #endif
 
 #if defined(XMIT_DEBUG) || defined(RX_DEBUG)
@@ -164,11 +239,124 @@ static void print_pkt(unsigned char *buf, int len)
 /* minimum number of free TX descriptors required to wake up TX process */
 #define GMAC_TX_THRESH(x)	(x->dma_tx_size/4)
 
+static int tx_thresh;
+module_param(tx_thresh, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_thresh, "Free TX descriptors to wake the queue (0: ring/4)");
+
+/* Upper bound of frames posted before the doorbell is rung anyway */
+#define GMAC_TX_KICK_BATCH	16
+
+/* TSO emulation: every segment gets its own copy of the headers, taken
+ * from a coherent area with one slot per TX descriptor, and the payload
+ * is mapped in place. Larger super-frames are segmented in software. */
+#define GMAC_TSO_HDR_SIZE	128
+#define GMAC_TSO_MAX_SEGS	48
+#define GMAC_TX_BUF_MAX		(BUF_SIZE_2KiB - 1)
+
+/* Interrupt coalescing defaults. With the adaptive mode the rx-usecs and
+ * rx-frames values form the high-throughput profile, the low-latency one
+ * raises an interrupt for every received frame. */
+#define GMAC_COAL_RX_USECS	64
+#define GMAC_COAL_RX_FRAMES	16
+#define GMAC_COAL_TX_USECS	1000
+#define GMAC_COAL_TX_FRAMES	16
+#define GMAC_COAL_SAMPLE	32	/* polls per adaptive decision */
+#define GMAC_COAL_BULK_PPP	8	/* packets per poll to go bulk */
+#define GMAC_COAL_LAT_PPP	2	/* packets per poll to go back */
+#define GMAC_AHB_DEF_RATE	150000000
+
 static inline u32 gmac_tx_avail(struct gmac_priv *priv)
 {
 	return priv->dirty_tx + priv->dma_tx_size - priv->cur_tx - 1;
 }
 
+#ifdef CONFIG_GMAC_PTP
+#include <linux/net_tstamp.h>
+
+/* Ask for the TX timestamp of a frame; entry is its last descriptor */
+static inline void gmac_tx_hwtstamp_arm(struct gmac_priv *priv,
+		struct sk_buff *skb, dma_desc_t *first, dma_desc_t *last,
+		unsigned int entry)
+{
+	if (likely(!(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP)) ||
+	    !priv->hwts_tx_en || priv->ts_tx_pending)
+		return;
+
+	skb_shinfo(skb)->tx_flags |= SKBTX_IN_PROGRESS;
+	desc_enable_tx_timestamp(first);
+	priv->ts_tx_entry = entry;
+	priv->ts_tx_desc2 = last->desc2;
+	priv->ts_tx_desc3 = last->desc3;
+	priv->ts_tx_pending = 1;
+}
+
+/* Give the last descriptor back its buffer and chain pointer */
+static inline int gmac_tx_hwtstamp_restore(struct gmac_priv *priv,
+					   dma_desc_t *p, unsigned int entry)
+{
+	if (likely(!priv->ts_tx_pending) || entry != priv->ts_tx_entry)
+		return 0;
+
+	p->desc2 = priv->ts_tx_desc2;
+	p->desc3 = priv->ts_tx_desc3;
+	smp_wmb();
+	priv->ts_tx_pending = 0;
+	return 1;
+}
+
+static inline void gmac_tx_hwtstamp(struct gmac_priv *priv, dma_desc_t *p,
+				    unsigned int entry, struct sk_buff *skb)
+{
+	struct skb_shared_hwtstamps shhwtstamps;
+	u64 ns;
+
+	if (likely(!priv->ts_tx_pending) || entry != priv->ts_tx_entry)
+		return;
+
+	if (desc_get_tx_timestamp_status(p) && skb) {
+		ns = gmac_ptp_desc_ns(priv, p);
+		memset(&shhwtstamps, 0, sizeof(shhwtstamps));
+		shhwtstamps.hwtstamp = ns_to_ktime(ns);
+		skb_tstamp_tx(skb, &shhwtstamps);
+	}
+	gmac_tx_hwtstamp_restore(priv, p, entry);
+}
+
+static inline void gmac_rx_hwtstamp(struct gmac_priv *priv, dma_desc_t *p,
+				    struct sk_buff *skb)
+{
+	if (!priv->hwts_rx_en || !desc_get_rx_timestamp_status(p))
+		return;
+
+	skb_hwtstamps(skb)->hwtstamp = ns_to_ktime(gmac_ptp_desc_ns(priv, p));
+}
+
+/* While the timestamp unit runs the DMA writes over every desc3 */
+static inline void gmac_rx_refill_desc3(struct gmac_priv *priv,
+					unsigned int entry)
+{
+	if (priv->ptp_clock)
+		gmac_refill_desc3(priv->dma_rx + entry, priv->dma_rx_phy +
+				  ((entry + 1) % priv->dma_rx_size) *
+				  sizeof(dma_desc_t));
+}
+#else
+static inline void gmac_tx_hwtstamp_arm(struct gmac_priv *priv,
+		struct sk_buff *skb, dma_desc_t *first, dma_desc_t *last,
+		unsigned int entry) {}
+static inline int gmac_tx_hwtstamp_restore(struct gmac_priv *priv,
+					   dma_desc_t *p, unsigned int entry)
+{
+	return 0;
+}
+static inline void gmac_tx_hwtstamp(struct gmac_priv *priv, dma_desc_t *p,
+				    unsigned int entry, struct sk_buff *skb) {}
+static inline void gmac_rx_hwtstamp(struct gmac_priv *priv, dma_desc_t *p,
+				    struct sk_buff *skb) {}
+static inline void gmac_rx_refill_desc3(struct gmac_priv *priv,
+					unsigned int entry) {}
+#endif
+
 /**
  * gmac_clk_ctl
  * @flag: 0--disable, 1--enable.
@@ -383,20 +571,68 @@ static void display_ring(dma_desc_t *p, int size)
 	}
 }
 
-static int gmac_set_bfsize(int mtu, int bufsize)
+/**
+ * gmac_rx_alloc_page
+ * @priv: private driver structure
+ * @buf: RX page slot to fill
+ * @gfp: allocation flags
+ * Description: allocate a page for an empty RX slot and map it for the
+ * whole of its ring lifetime. Both halves of the page are used by the
+ * DMA in turn, see gmac_rx_page_skb().
+ */
+static int gmac_rx_alloc_page(struct gmac_priv *priv,
+			      struct gmac_rx_page *buf, gfp_t gfp)
 {
-	int ret = bufsize;
+	struct page *page;
+	dma_addr_t dma;
 
-	if (mtu >= BUF_SIZE_4KiB)
-		ret = BUF_SIZE_8KiB;
-	else if (mtu >= BUF_SIZE_2KiB)
-		ret = BUF_SIZE_4KiB;
-	else if (mtu >= DMA_BUFFER_SIZE)
-		ret = BUF_SIZE_2KiB;
-	else
-		ret = DMA_BUFFER_SIZE;
+	page = alloc_page(gfp | __GFP_COLD);
+	if (unlikely(page == NULL))
+		return -ENOMEM;
 
-	return ret;
+	dma = dma_map_page(priv->device, page, 0, PAGE_SIZE, DMA_FROM_DEVICE);
+	if (unlikely(dma_mapping_error(priv->device, dma))) {
+		__free_page(page);
+		return -ENOMEM;
+	}
+
+	buf->page = page;
+	buf->dma = dma;
+	buf->page_offset = 0;
+	priv->xstats.rx_page_alloc++;
+
+	return 0;
+}
+
+/* Free the memory of the rings, also on a partially allocated set */
+static void gmac_free_ring_mem(struct gmac_priv *priv)
+{
+	/* Free the region of consistent memory previously allocated for
+	 * the DMA */
+	if (priv->dma_tx)
+		dma_free_coherent(NULL,
+				  priv->dma_tx_size * sizeof(dma_desc_t),
+				  priv->dma_tx, priv->dma_tx_phy);
+	if (priv->dma_rx)
+		dma_free_coherent(NULL,
+				  priv->dma_rx_size * sizeof(dma_desc_t),
+				  priv->dma_rx, priv->dma_rx_phy);
+	if (priv->tso_hdrs)
+		dma_free_coherent(NULL,
+				  priv->dma_tx_size * GMAC_TSO_HDR_SIZE,
+				  priv->tso_hdrs, priv->tso_hdrs_phy);
+	kfree(priv->rx_page);
+	kfree(priv->tx_skbuff);
+#ifdef CONFIG_GMAC_DEBUG_FS
+	kfree(priv->tx_stamp);
+	priv->tx_stamp = NULL;
+#endif
+
+	priv->dma_tx = NULL;
+	priv->dma_rx = NULL;
+	priv->tso_hdrs = NULL;
+	priv->rx_page = NULL;
+	priv->tx_skbuff = NULL;
 }
 
 /**
@@ -406,25 +642,15 @@ static int gmac_set_bfsize(int mtu, int bufsize)
  * and allocates the socket buffers. It suppors the chained and ring
  * modes.
  */
-static void init_dma_desc_rings(struct net_device *ndev)
+static int init_dma_desc_rings(struct net_device *ndev)
 {
 	int i;
 	struct gmac_priv *priv = netdev_priv(ndev);
-	struct sk_buff *skb;
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
-	unsigned int bfsize;
 	int dis_ic = 0;
-	int des3_as_data_buf = 0;
-
-	/* Set the max buffer size according to the DESC mode
-	 * and the MTU. Note that RING mode allows 16KiB bsize. */
-	bfsize = gmac_set_16kib_bfsize(ndev->mtu);
 
-	if (bfsize == BUF_SIZE_16KiB)
-		des3_as_data_buf = 1;
-	else
-		bfsize = gmac_set_bfsize(ndev->mtu, priv->dma_buf_sz);
+	BUILD_BUG_ON(GMAC_RX_PAGE_BUF < GMAC_RX_BUF_LEN);
 
 #ifdef CONFIG_GMAC_TIMER
 	/* Disable interrupts on completion for the reception if timer is on */
@@ -433,27 +659,40 @@ static void init_dma_desc_rings(struct net_device *ndev)
 #endif
 
 	DBG(probe, INFO, "gmac: txsize %d, rxsize %d, bfsize %d\n",
-	    txsize, rxsize, bfsize);
+	    txsize, rxsize, GMAC_RX_BUF_LEN);
 
-	priv->rx_skbuff_dma = kmalloc(rxsize * sizeof(dma_addr_t), GFP_KERNEL);
-	priv->rx_skbuff		= kmalloc(sizeof(struct sk_buff *) * rxsize, GFP_KERNEL);
+	priv->rx_page = kzalloc(sizeof(struct gmac_rx_page) * rxsize, GFP_KERNEL);
 	priv->dma_rx =
 	    (dma_desc_t *)dma_alloc_coherent(NULL,
 						  rxsize * sizeof(dma_desc_t),
 						  &priv->dma_rx_phy,
 						  GFP_KERNEL);
 
-	priv->tx_skbuff = kmalloc(sizeof(struct sk_buff *) * txsize,
+	priv->tx_skbuff = kzalloc(sizeof(struct sk_buff *) * txsize,
 				       GFP_KERNEL);
+#ifdef CONFIG_GMAC_DEBUG_FS
+	priv->tx_stamp = kzalloc(sizeof(u32) * txsize, GFP_KERNEL);
+#endif
 	priv->dma_tx =
 	    (dma_desc_t *)dma_alloc_coherent(NULL,
 						  txsize * sizeof(dma_desc_t),
 						  &priv->dma_tx_phy,
 						  GFP_KERNEL);
 
-	if ((priv->dma_rx == NULL) || (priv->dma_tx == NULL)) {
+	priv->tso_hdrs = dma_alloc_coherent(NULL,
+					    txsize * GMAC_TSO_HDR_SIZE,
+					    &priv->tso_hdrs_phy, GFP_KERNEL);
+
+	if ((priv->dma_rx == NULL) || (priv->dma_tx == NULL) ||
+	    (priv->tso_hdrs == NULL) || (priv->rx_page == NULL) ||
+	    (priv->tx_skbuff == NULL)
+#ifdef CONFIG_GMAC_DEBUG_FS
+	    || (priv->tx_stamp == NULL)
+#endif
+	    ) {
 		pr_err("%s:ERROR allocating the DMA Tx/Rx desc\n", __func__);
-		return;
+		gmac_free_ring_mem(priv);
+		return -ENOMEM;
 	}
 
 	DBG(probe, INFO, "gmac (%s) DMA desc: virt addr (Rx %p, "
@@ -462,34 +701,19 @@ static void init_dma_desc_rings(struct net_device *ndev)
 	    (unsigned int)priv->dma_rx_phy, (unsigned int)priv->dma_tx_phy);
 
 	/* RX INITIALIZATION */
-	DBG(probe, INFO, "gmac: SKB addresses:\n"
-			 "skb\t\tskb data\tdma data\n");
-
 	for (i = 0; i < rxsize; i++) {
 		dma_desc_t *p = priv->dma_rx + i;
+		struct gmac_rx_page *buf = priv->rx_page + i;
 
-		skb = __netdev_alloc_skb(ndev, bfsize + NET_IP_ALIGN,
-					 GFP_KERNEL);
-		if (unlikely(skb == NULL)) {
-			pr_err("%s: Rx init fails; skb is NULL\n", __func__);
+		if (gmac_rx_alloc_page(priv, buf, GFP_KERNEL)) {
+			pr_err("%s: Rx init fails; no page\n", __func__);
 			break;
 		}
-		skb_reserve(skb, NET_IP_ALIGN);
-		priv->rx_skbuff[i] = skb;
-		priv->rx_skbuff_dma[i] = dma_map_single(priv->device, skb->data,
-						bfsize, DMA_FROM_DEVICE);
-
-		p->desc2 = priv->rx_skbuff_dma[i];
-
-		gmac_init_desc3(des3_as_data_buf, p);
-
-		DBG(probe, INFO, "[%p]\t[%p]\t[%x]\n", priv->rx_skbuff[i],
-			priv->rx_skbuff[i]->data, priv->rx_skbuff_dma[i]);
+		p->desc2 = buf->dma + buf->page_offset;
 	}
 	priv->cur_rx = 0;
 	priv->dirty_rx = (unsigned int)(i - rxsize);
-	priv->dma_buf_sz = bfsize;
-	buf_sz = bfsize;
+	priv->rx_skb = NULL;
 
 	/* TX INITIALIZATION */
 	for (i = 0; i < txsize; i++) {
@@ -504,6 +728,9 @@ static void init_dma_desc_rings(struct net_device *ndev)
 
 	priv->dirty_tx = 0;
 	priv->cur_tx = 0;
+	priv->posted_tx = 0;
+	priv->tx_unkicked = 0;
+	netdev_reset_queue(priv->ndev);
 
 	/* Clear the Rx/Tx descriptors */
 	desc_init_rx(priv->dma_rx, rxsize, dis_ic);
@@ -515,6 +742,8 @@ static void init_dma_desc_rings(struct net_device *ndev)
 		printk("TX descriptor ring:\n");
 		display_ring(priv->dma_tx, txsize);
 	}
+
+	return 0;
 }
 
 static void dma_free_rx_skbufs(struct gmac_priv *priv)
@@ -522,26 +751,49 @@ static void dma_free_rx_skbufs(struct gmac_priv *priv)
 	int i;
 
 	for (i = 0; i < priv->dma_rx_size; i++) {
-		if (priv->rx_skbuff[i]) {
-			dma_unmap_single(priv->device, priv->rx_skbuff_dma[i],
-					 priv->dma_buf_sz, DMA_FROM_DEVICE);
-			dev_kfree_skb_any(priv->rx_skbuff[i]);
+		struct gmac_rx_page *buf = priv->rx_page + i;
+
+		if (buf->page) {
+			dma_unmap_page(priv->device, buf->dma, PAGE_SIZE,
+				       DMA_FROM_DEVICE);
+			put_page(buf->page);
+			buf->page = NULL;
 		}
-		priv->rx_skbuff[i] = NULL;
+	}
+
+	/* Frame interrupted halfway through its descriptors */
+	if (priv->rx_skb) {
+		dev_kfree_skb_any(priv->rx_skb);
+		priv->rx_skb = NULL;
 	}
 }
 
+/* The TSO header slots live in coherent memory and are never mapped */
+static inline int gmac_tx_is_tso_hdr(struct gmac_priv *priv, u32 addr)
+{
+	return addr >= priv->tso_hdrs_phy &&
+	       addr < priv->tso_hdrs_phy +
+		      priv->dma_tx_size * GMAC_TSO_HDR_SIZE;
+}
+
+static void gmac_tx_unmap(struct gmac_priv *priv, dma_desc_t *p)
+{
+	if (p->desc2 && !gmac_tx_is_tso_hdr(priv, p->desc2))
+		dma_unmap_single(priv->device, p->desc2,
+				 desc_get_tx_len(p), DMA_TO_DEVICE);
+	p->desc2 = 0;
+}
+
 static void dma_free_tx_skbufs(struct gmac_priv *priv)
 {
 	int i;
 
+	/* Every segment of a frame holds its own mapping, the skb
+	 * itself is only attached to the last one. */
 	for (i = 0; i < priv->dma_tx_size; i++) {
+		gmac_tx_hwtstamp_restore(priv, priv->dma_tx + i, i);
+		gmac_tx_unmap(priv, priv->dma_tx + i);
 		if (priv->tx_skbuff[i] != NULL) {
-			dma_desc_t *p = priv->dma_tx + i;
-			if (p->desc2)
-				dma_unmap_single(priv->device, p->desc2,
-						 desc_get_tx_len(p),
-						 DMA_TO_DEVICE);
 			dev_kfree_skb_any(priv->tx_skbuff[i]);
 			priv->tx_skbuff[i] = NULL;
 		}
@@ -551,20 +803,12 @@ static void dma_free_tx_skbufs(struct gmac_priv *priv)
 static void free_dma_desc_resources(struct gmac_priv *priv)
 {
 	/* Release the DMA TX/RX socket buffers */
-	dma_free_rx_skbufs(priv);
-	dma_free_tx_skbufs(priv);
+	if (priv->rx_page)
+		dma_free_rx_skbufs(priv);
+	if (priv->tx_skbuff)
+		dma_free_tx_skbufs(priv);
 
-	/* Free the region of consistent memory previously allocated for
-	 * the DMA */
-	dma_free_coherent(NULL,
-			  priv->dma_tx_size * sizeof(dma_desc_t),
-			  priv->dma_tx, priv->dma_tx_phy);
-	dma_free_coherent(NULL,
-			  priv->dma_rx_size * sizeof(dma_desc_t),
-			  priv->dma_rx, priv->dma_rx_phy);
-	kfree(priv->rx_skbuff_dma);
-	kfree(priv->rx_skbuff);
-	kfree(priv->tx_skbuff);
+	gmac_free_ring_mem(priv);
 }
 
 /**
@@ -594,17 +838,26 @@ static void gmac_dma_operation_mode(struct gmac_priv *priv)
 /**
  * gmac_tx:
  * @priv: private driver structure
+ * @budget: maximum number of frames to reclaim
  * Description: it reclaims resources after transmission completes.
+ * This only runs from gmac_poll(), so it is the single consumer of the
+ * ring and needs no lock against gmac_xmit(): it only walks descriptors
+ * that gmac_xmit() has published through posted_tx.
  */
-static void gmac_tx(struct gmac_priv *priv)
+static int gmac_tx(struct gmac_priv *priv, int budget)
 {
 	unsigned int txsize = priv->dma_tx_size;
+	unsigned int dirty_tx = priv->dirty_tx;
+	unsigned int posted_tx = ACCESS_ONCE(priv->posted_tx);
+	unsigned int bytes_compl = 0;
+	int count = 0;
 
-	spin_lock(&priv->tx_lock);
+	/* Read the descriptors only after posted_tx */
+	smp_rmb();
 
-	while (priv->dirty_tx != priv->cur_tx) {
+	while (dirty_tx != posted_tx) {
 		int last;
-		unsigned int entry = priv->dirty_tx % txsize;
+		unsigned int entry = dirty_tx % txsize;
 		struct sk_buff *skb = priv->tx_skbuff[entry];
 		dma_desc_t *p = priv->dma_tx + entry;
 
@@ -624,47 +877,127 @@ static void gmac_tx(struct gmac_priv *priv)
 				priv->xstats.tx_pkt_n++;
 			} else
 				priv->ndev->stats.tx_errors++;
+			gmac_dbg_tx_done(priv, entry);
+			count++;
 		}
 		TX_DBG("%s: curr %d, dirty %d\n", __func__,
-			priv->cur_tx, priv->dirty_tx);
+			posted_tx, dirty_tx);
 
-		if (likely(p->desc2))
-			dma_unmap_single(priv->device, p->desc2,
-					 desc_get_tx_len(p),
-					 DMA_TO_DEVICE);
+		gmac_tx_hwtstamp(priv, p, entry, skb);
+		gmac_tx_unmap(priv, p);
 		gmac_clean_desc3(p);
 
 		if (likely(skb != NULL)) {
-			/*
-			 * If there's room in the queue (limit it to size)
-			 * we add this skb back into the pool,
-			 * if it's the right size.
-			 */
-			if ((skb_queue_len(&priv->rx_recycle) <
-				priv->dma_rx_size) &&
-				skb_recycle_check(skb, priv->dma_buf_sz))
-				__skb_queue_head(&priv->rx_recycle, skb);
-			else
-				dev_kfree_skb(skb);
-
+			bytes_compl += skb->len;
+			dev_kfree_skb(skb);
 			priv->tx_skbuff[entry] = NULL;
 		}
 
 		desc_release_tx(p);
 
-		entry = (++priv->dirty_tx) % txsize;
+		dirty_tx++;
+		if (last && count >= budget)
+			break;
 	}
+
+	/* Publish the free space before looking at the queue state,
+	 * pairs with the barrier in gmac_xmit(). */
+	smp_mb();
+	priv->dirty_tx = dirty_tx;
+	netdev_completed_queue(priv->ndev, count, bytes_compl);
+	smp_mb();
+
 	if (unlikely(netif_queue_stopped(priv->ndev) &&
-		     gmac_tx_avail(priv) > GMAC_TX_THRESH(priv))) {
+		     gmac_tx_avail(priv) >= priv->tx_wake_need)) {
 		netif_tx_lock(priv->ndev);
 		if (netif_queue_stopped(priv->ndev) &&
-		     gmac_tx_avail(priv) > GMAC_TX_THRESH(priv)) {
+		     gmac_tx_avail(priv) >= priv->tx_wake_need) {
 			TX_DBG("%s: restart transmit\n", __func__);
 			netif_wake_queue(priv->ndev);
 		}
 		netif_tx_unlock(priv->ndev);
 	}
-	spin_unlock(&priv->tx_lock);
+
+	return count;
+}
+
+/* The AHB clock drives the DMA watchdog and the timestamp unit */
+static unsigned long gmac_ahb_rate(struct gmac_priv *priv)
+{
+	unsigned long rate = 0;
+
+#ifdef CONFIG_GMAC_CLK_SYS
+	rate = clk_get_rate(priv->gmac_ahb_clk);
+#endif
+	if (!rate)
+		rate = GMAC_AHB_DEF_RATE;
+
+	return rate;
+}
+
+/**
+ * gmac_usec2riwt
+ * @priv: private driver structure
+ * @usec: RX interrupt delay in microseconds
+ * Description: convert a delay to the RI watchdog units (256 AHB cycles).
+ * Zero usecs still programs the smallest step so descriptors that were
+ * armed with dis_ic set cannot lose their interrupt.
+ */
+static u32 gmac_usec2riwt(struct gmac_priv *priv, u32 usec)
+{
+	unsigned long rate = gmac_ahb_rate(priv);
+	u32 riwt;
+
+	riwt = (usec * (rate / 1000000)) / 256;
+
+	return clamp_t(u32, riwt, 1, GDMA_RX_WDT_MASK);
+}
+
+/**
+ * gmac_set_rx_coalesce
+ * @priv: private driver structure
+ * Description: program the RX coalescing parameters. The number of frames
+ * per interrupt is applied to the descriptors as they are refilled.
+ */
+void gmac_set_rx_coalesce(struct gmac_priv *priv)
+{
+	dma_rx_watchdog(priv->ioaddr, gmac_usec2riwt(priv, priv->rx_coal_usecs));
+
+	if (!priv->rx_coal_usecs)
+		priv->rx_coal_cur_frames = 1;
+	else if (!priv->rx_coal_adaptive)
+		priv->rx_coal_cur_frames = priv->rx_coal_frames;
+
+	priv->rx_coal_polls = 0;
+	priv->rx_coal_pkts = 0;
+}
+
+/**
+ * gmac_rx_coal_adapt
+ * @priv: private driver structure
+ * @work_done: frames received by this poll
+ * Description: move between the low-latency and the high-throughput RX
+ * coalescing profiles according to the average packets per poll.
+ */
+static void gmac_rx_coal_adapt(struct gmac_priv *priv, int work_done)
+{
+	unsigned int ppp;
+
+	if (!priv->rx_coal_adaptive || !priv->rx_coal_usecs || !work_done)
+		return;
+
+	priv->rx_coal_pkts += work_done;
+	if (++priv->rx_coal_polls < GMAC_COAL_SAMPLE)
+		return;
+
+	ppp = priv->rx_coal_pkts / priv->rx_coal_polls;
+	priv->rx_coal_polls = 0;
+	priv->rx_coal_pkts = 0;
+
+	if (ppp >= GMAC_COAL_BULK_PPP)
+		priv->rx_coal_cur_frames = priv->rx_coal_frames;
+	else if (ppp <= GMAC_COAL_LAT_PPP)
+		priv->rx_coal_cur_frames = 1;
 }
 
 static inline void gmac_enable_irq(struct gmac_priv *priv)
@@ -706,11 +1039,23 @@ static int gmac_has_work(struct gmac_priv *priv)
 static inline void _gmac_schedule(struct gmac_priv *priv)
 {
 	if (likely(gmac_has_work(priv))) {
+		gmac_dbg_irq(priv);
 		gmac_disable_irq(priv);
 		napi_schedule(&priv->napi);
 	}
 }
 
+/* TX frames without IC set are reclaimed from here at the latest */
+static void gmac_tx_coal_timer(unsigned long data)
+{
+	struct gmac_priv *priv = (struct gmac_priv *)data;
+
+	if (ACCESS_ONCE(priv->tx_unkicked))
+		dma_en_tx(priv->ioaddr);
+
+	_gmac_schedule(priv);
+}
+
 #ifdef CONFIG_GMAC_TIMER
 void gmac_schedule(struct net_device *dev)
 {
@@ -745,6 +1090,9 @@ static void gmac_tx_err(struct gmac_priv *priv)
 	desc_init_tx(priv->dma_tx, priv->dma_tx_size);
 	priv->dirty_tx = 0;
 	priv->cur_tx = 0;
+	priv->posted_tx = 0;
+	priv->tx_unkicked = 0;
+	netdev_reset_queue(priv->ndev);
 	dma_start_tx(priv->ioaddr);
 
 	priv->ndev->stats.tx_errors++;
@@ -767,8 +1115,12 @@ static void gmac_dma_interrupt(struct gmac_priv *priv)
 			dma_oper_mode(priv->ioaddr, tc, SF_DMA_MODE);
 			priv->xstats.threshold = tc;
 		}
-	} else if (unlikely(status == tx_hard_error))
-		gmac_tx_err(priv);
+	} else if (unlikely(status == tx_hard_error)) {
+		/* The ring is reset from gmac_poll() */
+		priv->tx_err_pending = 1;
+		gmac_disable_irq(priv);
+		napi_schedule(&priv->napi);
+	}
 }
 
 static void gmac_check_ether_addr(struct gmac_priv *priv)
@@ -810,6 +1162,88 @@ static void gmac_check_ether_addr(struct gmac_priv *priv)
 	pr_info("gmac: device MAC address %pM\n", priv->ndev->dev_addr);
 }
 
+static void gmac_set_tx_thresh(struct gmac_priv *priv)
+{
+	priv->tx_wake_thresh = tx_thresh > 0 ?
+		min_t(unsigned int, tx_thresh, priv->dma_tx_size / 2) :
+		GMAC_TX_THRESH(priv);
+	priv->tx_wake_need = priv->tx_wake_thresh + 1;
+}
+
+/**
+ * gmac_set_ring_size
+ * @ndev: net device structure
+ * @rx_size: new number of RX descriptors
+ * @tx_size: new number of TX descriptors
+ * Description: reallocate the descriptor rings. On a running interface
+ * the queue, NAPI, the DMA and the MAC are quiesced first so nothing
+ * references the old rings anymore; the PHY and the IRQ line are left
+ * alone and the link stays up. If the new rings cannot be allocated the
+ * old sizes are restored. Called with the RTNL held.
+ */
+int gmac_set_ring_size(struct net_device *ndev, unsigned int rx_size,
+		       unsigned int tx_size)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+	unsigned int old_rx = priv->dma_rx_size;
+	unsigned int old_tx = priv->dma_tx_size;
+	int ret;
+
+	if (!netif_running(ndev)) {
+		priv->dma_rx_size = rx_size;
+		priv->dma_tx_size = tx_size;
+		return 0;
+	}
+
+	netif_tx_disable(ndev);
+	napi_disable(&priv->napi);
+	del_timer_sync(&priv->tx_coal_timer);
+
+	gmac_disable_irq(priv);
+	gmac_set_tx_rx(priv->ioaddr, false);
+	dma_stop_tx(priv->ioaddr);
+	dma_stop_rx(priv->ioaddr);
+
+	free_dma_desc_resources(priv);
+
+	priv->dma_rx_size = rx_size;
+	priv->dma_tx_size = tx_size;
+	ret = init_dma_desc_rings(ndev);
+	if (ret < 0) {
+		pr_warning("%s: cannot allocate %u/%u descriptors, "
+			   "keeping %u/%u\n", ndev->name, rx_size, tx_size,
+			   old_rx, old_tx);
+		priv->dma_rx_size = old_rx;
+		priv->dma_tx_size = old_tx;
+		if (init_dma_desc_rings(ndev) < 0) {
+			pr_err("%s: no memory for the rings, closing\n",
+			       ndev->name);
+			napi_enable(&priv->napi);
+			dev_close(ndev);
+			return -ENOMEM;
+		}
+	}
+
+	dma_set_desc_lists(priv->ioaddr, priv->dma_tx_phy, priv->dma_rx_phy);
+
+	/* Keep the thresholds within the new rings */
+	gmac_set_tx_thresh(priv);
+	priv->tx_count_frames = 0;
+	priv->tx_coal_frames = min(priv->tx_coal_frames, priv->dma_tx_size / 2);
+	priv->rx_coal_frames = min(priv->rx_coal_frames, priv->dma_rx_size / 2);
+	gmac_set_rx_coalesce(priv);
+
+	dma_start_tx(priv->ioaddr);
+	dma_start_rx(priv->ioaddr);
+	gmac_set_tx_rx(priv->ioaddr, true);
+
+	napi_enable(&priv->napi);
+	gmac_enable_irq(priv);
+	netif_wake_queue(ndev);
+
+	return ret;
+}
+
 /**
  *  gmac_open - open entry point of the driver
  *  @dev : pointer to the device structure.
@@ -842,10 +1276,9 @@ static int gmac_open(struct net_device *ndev)
 	}
 
 	/* Create and initialize the TX/RX descriptors chains. */
-	priv->dma_tx_size = GMAC_ALIGN(dma_txsize);
-	priv->dma_rx_size = GMAC_ALIGN(dma_rxsize);
-	priv->dma_buf_sz = GMAC_ALIGN(buf_sz);
-	init_dma_desc_rings(ndev);
+	ret = init_dma_desc_rings(ndev);
+	if (ret < 0)
+		goto ring_error;
 
 	/* DMA initialization and SW reset */
 	ret = gdma_init(priv->ioaddr, priv->plat->pbl,
@@ -861,6 +1294,13 @@ static int gmac_open(struct net_device *ndev)
 	/* Initialize the MAC Core */
 	core_init(priv->ioaddr);
 
+#ifdef CONFIG_GMAC_PTP
+	/* The DMA reset stopped the system time */
+	ret = gmac_ptp_register(priv, gmac_ahb_rate(priv));
+	if (ret)
+		pr_debug("%s: no PTP clock (%d)\n", ndev->name, ret);
+#endif
+
 	/* Request the IRQ lines */
 	ret = request_irq(ndev->irq, gmac_interrupt,
 			 IRQF_SHARED, ndev->name, ndev);
@@ -876,9 +1316,21 @@ static int gmac_open(struct net_device *ndev)
 	/* Set the HW DMA mode and the COE */
 	gmac_dma_operation_mode(priv);
 
+	gmac_set_tx_thresh(priv);
+
+	/* Interrupt coalescing */
+	priv->tx_count_frames = 0;
+	setup_timer(&priv->tx_coal_timer, gmac_tx_coal_timer,
+		    (unsigned long)priv);
+	gmac_set_rx_coalesce(priv);
+
 	/* Extra statistics */
 	memset(&priv->xstats, 0, sizeof(struct gmac_extra_stats));
 	priv->xstats.threshold = tc;
+#ifdef CONFIG_GMAC_DEBUG_FS
+	memset(&priv->rstats, 0, sizeof(struct gmac_ring_stats));
+	priv->irq_stamp = 0;
+#endif
 
 #ifdef CONFIG_GMAC_DEBUG_FS
 	ret = gmac_init_fs(ndev);
@@ -900,15 +1352,18 @@ static int gmac_open(struct net_device *ndev)
 		phy_start(ndev->phydev);
 
 	napi_enable(&priv->napi);
-	skb_queue_head_init(&priv->rx_recycle);
 	netif_start_queue(ndev);
 
 	return 0;
 
 open_error:
+#ifdef CONFIG_GMAC_PTP
+	gmac_ptp_unregister(priv);
+#endif
+	free_dma_desc_resources(priv);
+ring_error:
 	if (ndev->phydev)
 		phy_disconnect(ndev->phydev);
-	free_dma_desc_resources(priv);
 out_err:
 	gmac_clk_ctl(priv, 0);
 
@@ -941,7 +1396,7 @@ static int gmac_release(struct net_device *ndev)
 		kfree(priv->tm);
 #endif
 	napi_disable(&priv->napi);
-	skb_queue_purge(&priv->rx_recycle);
+	del_timer_sync(&priv->tx_coal_timer);
 
 	/* Free the IRQ lines */
 	free_irq(ndev->irq, ndev);
@@ -953,13 +1408,17 @@ static int gmac_release(struct net_device *ndev)
 	/* Release and free the Rx/Tx resources */
 	free_dma_desc_resources(priv);
 
+#ifdef CONFIG_GMAC_PTP
+	gmac_ptp_unregister(priv);
+#endif
+
 	/* Disable the MAC Rx/Tx */
 	gmac_set_tx_rx(priv->ioaddr, false);
 
 	netif_carrier_off(ndev);
 
 #ifdef CONFIG_GMAC_DEBUG_FS
-	gmac_exit_fs();
+	gmac_exit_fs(ndev);
 #endif
 	gmac_mdio_unregister(ndev);
 	gmac_clk_ctl(priv, 0);
@@ -967,6 +1426,269 @@ static int gmac_release(struct net_device *ndev)
 	return 0;
 }
 
+/**
+ * gmac_tx_kick_needed
+ * @priv: private driver structure
+ * @dev: net device structure
+ * Description: the TX poll demand is only needed once per burst. While
+ * the qdisc still holds frames that it is going to hand to gmac_xmit()
+ * right away the doorbell is deferred to the last frame of the burst,
+ * bounded by GMAC_TX_KICK_BATCH. Deferred frames are also kicked from
+ * gmac_poll() and from the TX coalescing timer.
+ */
+static inline int gmac_tx_kick_needed(struct gmac_priv *priv,
+				      struct net_device *dev)
+{
+	struct Qdisc *q = ACCESS_ONCE(netdev_get_tx_queue(dev, 0)->qdisc);
+
+	if (priv->tx_unkicked + 1 >= GMAC_TX_KICK_BATCH ||
+	    netif_xmit_stopped(netdev_get_tx_queue(dev, 0)))
+		return 1;
+
+	return !q || !qdisc_qlen(q) || qdisc_is_throttled(q);
+}
+
+/**
+ *  gmac_tx_stop_queue:
+ *  @priv : private driver structure
+ *  @need : free descriptors the pending frame requires
+ *  Description : stop the queue until gmac_tx() has reclaimed enough
+ *  descriptors. It returns -EBUSY if the ring is still too full after
+ *  the queue has been stopped.
+ */
+static int gmac_tx_stop_queue(struct gmac_priv *priv, unsigned int need)
+{
+	GMAC_RSTAT_INC(priv, tx_ring_full);
+	netif_stop_queue(priv->ndev);
+	priv->tx_wake_need = max(need, priv->tx_wake_thresh + 1);
+
+	/* gmac_tx() may have freed space before seeing the stop */
+	smp_mb();
+	if (likely(gmac_tx_avail(priv) < need))
+		return -EBUSY;
+
+	netif_start_queue(priv->ndev);
+	return 0;
+}
+
+/* Number of descriptors used by the buffers of a non TSO frame */
+static unsigned int gmac_tx_count_desc(struct sk_buff *skb)
+{
+	unsigned int i, n = DIV_ROUND_UP(skb_headlen(skb), GMAC_TX_BUF_MAX);
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
+		n += DIV_ROUND_UP(skb_frag_size(&skb_shinfo(skb)->frags[i]),
+				  GMAC_TX_BUF_MAX);
+
+	return n;
+}
+
+/* Fill the next TX descriptor with one buffer of the frame. The first
+ * descriptor is handed over to the DMA last, by gmac_xmit(). */
+static dma_desc_t *gmac_tx_put_buf(struct gmac_priv *priv, dma_addr_t addr,
+				   unsigned int len, int cic, int *is_first)
+{
+	unsigned int entry;
+	dma_desc_t *desc;
+
+	if (!*is_first)
+		priv->cur_tx++;
+	entry = priv->cur_tx % priv->dma_tx_size;
+	desc = priv->dma_tx + entry;
+	priv->tx_skbuff[entry] = NULL;
+
+	desc->desc2 = addr;
+	desc_prepare_tx(desc, *is_first, len, cic);
+	if (!*is_first) {
+		wmb();
+		desc_set_tx_own(desc);
+	}
+	*is_first = 0;
+
+	return desc;
+}
+
+/* Worst case number of descriptors used by gmac_tso_xmit(): one header
+ * per segment, and the payload chunks split at segment, fragment and
+ * buffer size boundaries. */
+static inline unsigned int gmac_tso_count_desc(struct sk_buff *skb)
+{
+	return 2 * skb_shinfo(skb)->gso_segs + skb_shinfo(skb)->nr_frags +
+		1 + skb->len / GMAC_TX_BUF_MAX;
+}
+
+static void gmac_tso_build_hdr(struct sk_buff *skb, char *hdr,
+			       unsigned int hdr_len, unsigned int seg_len,
+			       u16 ip_id, u32 seq, int first, int last)
+{
+	struct tcphdr *th = (struct tcphdr *)(hdr + skb_transport_offset(skb));
+
+	memcpy(hdr, skb->data, hdr_len);
+
+	if (skb->protocol == htons(ETH_P_IP)) {
+		struct iphdr *iph = (struct iphdr *)(hdr +
+						     skb_network_offset(skb));
+
+		iph->tot_len = htons(hdr_len - skb_network_offset(skb) +
+				     seg_len);
+		iph->id = htons(ip_id);
+		/* Inserted by the checksum engine */
+		iph->check = 0;
+	} else {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)(hdr +
+							  skb_network_offset(skb));
+
+		ip6h->payload_len = htons(hdr_len - skb_network_offset(skb) -
+					  sizeof(struct ipv6hdr) + seg_len);
+	}
+
+	th->seq = htonl(seq);
+	th->check = 0;
+	if (!first)
+		th->cwr = 0;
+	if (!last) {
+		th->fin = 0;
+		th->psh = 0;
+	}
+}
+
+/**
+ *  gmac_tso_xmit:
+ *  @priv : private driver structure
+ *  @skb : the TSO super-frame
+ *  Description : the GMAC has no segmentation offload, but it inserts the
+ *  IP and TCP checksums of every frame. Each MSS sized segment is built as
+ *  a header descriptor pointing to a private copy of the headers followed
+ *  by descriptors pointing straight into the skb payload, so the data is
+ *  never copied. The OWN bit of the very first descriptor is left to the
+ *  caller. It returns the last descriptor used, priv->cur_tx points to it.
+ */
+static dma_desc_t *gmac_tso_xmit(struct gmac_priv *priv, struct sk_buff *skb)
+{
+	unsigned int txsize = priv->dma_tx_size;
+	unsigned int hdr_len = skb_transport_offset(skb) + tcp_hdrlen(skb);
+	unsigned int mss = skb_shinfo(skb)->gso_size;
+	unsigned int headlen = skb_headlen(skb);
+	unsigned int lin_off = hdr_len, frag_off = 0;
+	unsigned int left = skb->len - hdr_len;
+	u32 seq = ntohl(tcp_hdr(skb)->seq);
+	u16 ip_id = 0;
+	dma_desc_t *desc = NULL;
+	int frag_idx = 0, first = 1;
+
+	if (skb->protocol == htons(ETH_P_IP))
+		ip_id = ntohs(ip_hdr(skb)->id);
+
+	while (left > 0) {
+		unsigned int seg_len = min(left, mss);
+		unsigned int entry;
+
+		if (!first)
+			priv->cur_tx++;
+		entry = priv->cur_tx % txsize;
+		desc = priv->dma_tx + entry;
+		priv->tx_skbuff[entry] = NULL;
+
+		gmac_tso_build_hdr(skb, priv->tso_hdrs +
+				   entry * GMAC_TSO_HDR_SIZE, hdr_len,
+				   seg_len, ip_id++, seq, first,
+				   left == seg_len);
+		desc->desc2 = priv->tso_hdrs_phy + entry * GMAC_TSO_HDR_SIZE;
+		desc_prepare_tx(desc, 1, hdr_len, cic_full);
+		if (!first) {
+			wmb();
+			desc_set_tx_own(desc);
+		}
+
+		left -= seg_len;
+		seq += seg_len;
+
+		while (seg_len > 0) {
+			unsigned int len;
+
+			entry = (++priv->cur_tx) % txsize;
+			desc = priv->dma_tx + entry;
+			priv->tx_skbuff[entry] = NULL;
+
+			if (lin_off < headlen) {
+				len = min3(seg_len, headlen - lin_off,
+					   (unsigned int)GMAC_TX_BUF_MAX);
+				desc->desc2 = dma_map_single(priv->device,
+							     skb->data + lin_off,
+							     len, DMA_TO_DEVICE);
+				lin_off += len;
+			} else {
+				const skb_frag_t *frag =
+					&skb_shinfo(skb)->frags[frag_idx];
+
+				len = min3(seg_len,
+					   skb_frag_size(frag) - frag_off,
+					   (unsigned int)GMAC_TX_BUF_MAX);
+				desc->desc2 = skb_frag_dma_map(priv->device,
+							       frag, frag_off,
+							       len,
+							       DMA_TO_DEVICE);
+				frag_off += len;
+				if (frag_off == skb_frag_size(frag)) {
+					frag_idx++;
+					frag_off = 0;
+				}
+			}
+			desc_prepare_tx(desc, 0, len, cic_full);
+			seg_len -= len;
+
+			/* Close the segment, the caller closes the last one */
+			if (!seg_len && left) {
+				desc_close_tx(desc);
+				desc_clear_tx_ic(desc);
+			}
+			wmb();
+			desc_set_tx_own(desc);
+		}
+		first = 0;
+	}
+
+	return desc;
+}
+
+static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev);
+
+/**
+ *  gmac_tso_fallback:
+ *  @priv : private driver structure
+ *  @skb : the TSO super-frame
+ *  Description : segment in software the super-frames which would use
+ *  too large a part of the ring and queue the segments one by one.
+ */
+static netdev_tx_t gmac_tso_fallback(struct gmac_priv *priv,
+				     struct sk_buff *skb)
+{
+	struct net_device *ndev = priv->ndev;
+	struct sk_buff *segs, *nskb;
+
+	priv->xstats.tx_tso_fallback++;
+	segs = skb_gso_segment(skb, ndev->features &
+			       ~(NETIF_F_TSO | NETIF_F_TSO6));
+	if (IS_ERR(segs) || !segs) {
+		ndev->stats.tx_dropped++;
+		goto out;
+	}
+
+	do {
+		nskb = segs;
+		segs = segs->next;
+		nskb->next = NULL;
+		if (gmac_xmit(nskb, ndev) != NETDEV_TX_OK) {
+			dev_kfree_skb_any(nskb);
+			ndev->stats.tx_dropped++;
+		}
+	} while (segs);
+
+out:
+	dev_kfree_skb_any(skb);
+	return NETDEV_TX_OK;
+}
+
 /**
  *  gmac_xmit:
  *  @skb : the socket buffer
@@ -978,23 +1700,34 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	struct gmac_priv *priv = netdev_priv(dev);
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int entry;
-	int i, csum_insertion = 0;
+	int i, csum_insertion = cic_dis;
 	int nfrags = skb_shinfo(skb)->nr_frags;
+	unsigned int ndesc;
 	dma_desc_t *desc, *first;
 	unsigned int nopaged_len = skb_headlen(skb);
+	unsigned int off, len;
+	int is_tso = skb_is_gso(skb);
+	int is_first = 1;
+
+	ndesc = gmac_tx_count_desc(skb);
+	if (is_tso) {
+		ndesc = gmac_tso_count_desc(skb);
+		if (unlikely(ndesc > txsize / 2 ||
+			     skb_transport_offset(skb) + tcp_hdrlen(skb) >
+			     GMAC_TSO_HDR_SIZE))
+			return gmac_tso_fallback(priv, skb);
+	}
 
-	if (unlikely(gmac_tx_avail(priv) < nfrags + 1)) {
-		if (!netif_queue_stopped(dev)) {
-			netif_stop_queue(dev);
-			/* This is a hard error, log it. */
+	if (unlikely(gmac_tx_avail(priv) < ndesc)) {
+		/* Jumbo and TSO frames may legitimately not fit in the
+		 * room left for a maximally fragmented one. */
+		if (!netif_queue_stopped(dev) && ndesc <= MAX_SKB_FRAGS + 1)
 			pr_err("%s: BUG! Tx Ring full when queue awake\n",
 				__func__);
-		}
-		return NETDEV_TX_BUSY;
+		if (gmac_tx_stop_queue(priv, ndesc))
+			return NETDEV_TX_BUSY;
 	}
 
-	spin_lock(&priv->tx_lock);
-
 	entry = priv->cur_tx % txsize;
 
 #ifdef XMIT_DEBUG
@@ -1006,7 +1739,8 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		       !skb_is_gso(skb) ? "isn't" : "is");
 #endif
 
-	csum_insertion = (skb->ip_summed == CHECKSUM_PARTIAL);
+	if (skb->ip_summed == CHECKSUM_PARTIAL)
+		csum_insertion = cic_full;
 
 	desc = priv->dma_tx + entry;
 	first = desc;
@@ -1018,42 +1752,74 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		       skb->len, nopaged_len, nfrags, skb->ip_summed);
 #endif
 
-	priv->tx_skbuff[entry] = skb;
+	priv->tx_skbuff[entry] = NULL;
 
-	if (gmac_is_jumbo_frm(skb->len)) {
-		entry = gmac_jumbo_frm(priv, skb, csum_insertion);
-		desc = priv->dma_tx + entry;
-	} else {
-		desc->desc2 = dma_map_single(priv->device, skb->data,
-								nopaged_len, DMA_TO_DEVICE);
-		desc_prepare_tx(desc, 1, nopaged_len, csum_insertion);
+	if (is_tso) {
+		desc = gmac_tso_xmit(priv, skb);
+		priv->xstats.tx_tso_frames++;
+		priv->xstats.tx_tso_segs += skb_shinfo(skb)->gso_segs;
+		goto close;
+	}
+
+	/* A buffer holds at most GMAC_TX_BUF_MAX bytes, so the linear part
+	 * of jumbo frames and page sized frags take several descriptors. */
+	for (off = 0; off < nopaged_len; off += len) {
+		len = min_t(unsigned int, nopaged_len - off, GMAC_TX_BUF_MAX);
+		desc = gmac_tx_put_buf(priv, dma_map_single(priv->device,
+				       skb->data + off, len, DMA_TO_DEVICE),
+				       len, csum_insertion, &is_first);
 	}
 
 	for (i = 0; i < nfrags; i++) {
 		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
-		int len = skb_frag_size(frag);
-
-		entry = (++priv->cur_tx) % txsize;
-		desc = priv->dma_tx + entry;
-
-		TX_DBG("\t[entry %d] segment len: %d\n", entry, len);
-		desc->desc2 = skb_frag_dma_map(priv->device, frag, 0,
-									len, DMA_TO_DEVICE);
-		priv->tx_skbuff[entry] = NULL;
-		desc_prepare_tx(desc, 0, len, csum_insertion);
-		wmb();
-		desc_set_tx_own(desc);
+		unsigned int size = skb_frag_size(frag);
+
+		TX_DBG("\t[entry %d] segment len: %d\n",
+		       priv->cur_tx % txsize, size);
+		for (off = 0; off < size; off += len) {
+			len = min_t(unsigned int, size - off, GMAC_TX_BUF_MAX);
+			desc = gmac_tx_put_buf(priv, skb_frag_dma_map(
+					       priv->device, frag, off, len,
+					       DMA_TO_DEVICE),
+					       len, csum_insertion, &is_first);
+		}
 	}
 
+close:
+	/* The skb is released with the last segment, once the DMA is done
+	 * with all the buffers it points to. */
+	priv->tx_skbuff[priv->cur_tx % txsize] = skb;
+	gmac_dbg_tx_post(priv, priv->cur_tx % txsize);
+	if (!is_tso)
+		gmac_tx_hwtstamp_arm(priv, skb, first, desc,
+				     priv->cur_tx % txsize);
+
 	/* Interrupt on completition only for the latest segment */
 	desc_close_tx(desc);
 
+	/* Coalesce the TX interrupts unless the queue is about to stop;
+	 * the timer bounds the time until the frame gets reclaimed. */
+	priv->tx_count_frames += is_tso ? skb_shinfo(skb)->gso_segs : 1;
+	if (likely(priv->tx_coal_frames > priv->tx_count_frames &&
+		   gmac_tx_avail(priv) > (MAX_SKB_FRAGS + 2))) {
+		desc_clear_tx_ic(desc);
+		if (!timer_pending(&priv->tx_coal_timer))
+			mod_timer(&priv->tx_coal_timer, jiffies +
+				  usecs_to_jiffies(priv->tx_coal_usecs));
+	} else
+		priv->tx_count_frames = 0;
+
 #ifdef CONFIG_GMAC_TIMER
 	/* Clean IC while using timer */
 	if (likely(priv->tm->enable))
 		desc_clear_tx_ic(desc);
 #endif
 
+	/* Account the frame before gmac_tx() can complete it */
+	dev->stats.tx_bytes += skb->len;
+	netdev_sent_queue(dev, skb->len);
+	skb_tx_timestamp(skb);
+
 	wmb();
 
 	/* To avoid raise condition */
@@ -1061,6 +1827,10 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	priv->cur_tx++;
 
+	/* Let gmac_tx() see the whole frame at once */
+	smp_wmb();
+	priv->posted_tx = priv->cur_tx;
+
 #ifdef XMIT_DEBUG
 	if (netif_msg_pktdata(priv)) {
 		pr_info("gmac xmit: current=%d, dirty=%d, entry=%d, "
@@ -1075,16 +1845,18 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	if (unlikely(gmac_tx_avail(priv) <= (MAX_SKB_FRAGS + 1))) {
 		TX_DBG("%s: stop transmitted packets\n", __func__);
-		netif_stop_queue(dev);
+		gmac_tx_stop_queue(priv, priv->tx_wake_thresh + 1);
 	}
 
-	dev->stats.tx_bytes += skb->len;
-
-	skb_tx_timestamp(skb);
-
-	dma_en_tx(priv->ioaddr);
-
-	spin_unlock(&priv->tx_lock);
+	if (gmac_tx_kick_needed(priv, dev)) {
+		dma_en_tx(priv->ioaddr);
+		priv->tx_unkicked = 0;
+	} else {
+		priv->tx_unkicked++;
+		if (!timer_pending(&priv->tx_coal_timer))
+			mod_timer(&priv->tx_coal_timer, jiffies +
+				  usecs_to_jiffies(priv->tx_coal_usecs));
+	}
 
 	return NETDEV_TX_OK;
 }
@@ -1092,38 +1864,135 @@ static netdev_tx_t gmac_xmit(struct sk_buff *skb, struct net_device *dev)
 static inline void gmac_rx_refill(struct gmac_priv *priv)
 {
 	unsigned int rxsize = priv->dma_rx_size;
-	int bfsize = priv->dma_buf_sz;
 	dma_desc_t *p = priv->dma_rx;
 
 	for (; priv->cur_rx - priv->dirty_rx > 0; priv->dirty_rx++) {
 		unsigned int entry = priv->dirty_rx % rxsize;
-		if (likely(priv->rx_skbuff[entry] == NULL)) {
-			struct sk_buff *skb;
+		struct gmac_rx_page *buf = priv->rx_page + entry;
 
-			skb = __skb_dequeue(&priv->rx_recycle);
-			if (skb == NULL)
-				skb = netdev_alloc_skb_ip_align(priv->ndev,
-								bfsize);
+		if (unlikely(buf->page == NULL) &&
+		    gmac_rx_alloc_page(priv, buf, GFP_ATOMIC)) {
+			GMAC_RSTAT_INC(priv, rx_refill_fail);
+			break;
+		}
 
-			if (unlikely(skb == NULL))
-				break;
+		/* Hand the half page back to the DMA */
+		dma_sync_single_range_for_device(priv->device, buf->dma,
+				buf->page_offset, GMAC_RX_BUF_LEN,
+				DMA_FROM_DEVICE);
+		(p + entry)->desc2 = buf->dma + buf->page_offset;
+		gmac_rx_refill_desc3(priv, entry);
 
-			priv->rx_skbuff[entry] = skb;
-			priv->rx_skbuff_dma[entry] =
-			    dma_map_single(priv->device, skb->data, bfsize,
-					   DMA_FROM_DEVICE);
+		desc_set_rx_ic(p + entry,
+			       !(priv->dirty_rx % priv->rx_coal_cur_frames));
+		wmb();
+		desc_set_rx_own(p + entry);
+	}
+}
+}
 
-			(p + entry)->desc2 = priv->rx_skbuff_dma[entry];
+/**
+ * gmac_rx_copy_skb
+ * @priv: private driver structure
+ * @dma: DMA address of the RX buffer mapping
+ * @offset: offset of the frame inside the mapping
+ * @va: CPU address of the frame
+ * @frame_len: length of the frame
+ * Description: copy a small frame into a new skb so the RX buffer can
+ * stay mapped in the ring. Only the received bytes are synced.
+ */
+static struct sk_buff *gmac_rx_copy_skb(struct gmac_priv *priv,
+		dma_addr_t dma, unsigned int offset, void *va, int frame_len)
+{
+	struct sk_buff *skb;
 
-				gmac_refill_desc3(bfsize, p + entry);
+	skb = netdev_alloc_skb_ip_align(priv->ndev, frame_len);
+	if (unlikely(skb == NULL))
+		return NULL;
 
-			RX_DBG(KERN_INFO "\trefill entry #%d\n", entry);
-		}
-		wmb();
-		desc_set_rx_own(p + entry);
+	dma_sync_single_range_for_cpu(priv->device, dma, offset, frame_len,
+				      DMA_FROM_DEVICE);
+	skb_copy_to_linear_data(skb, va, frame_len);
+	skb_put(skb, frame_len);
+	priv->xstats.rx_copybreak_n++;
+
+	return skb;
+}
+
+/**
+ * gmac_rx_add_frag
+ * @priv: private driver structure
+ * @skb: frame being built
+ * @buf: RX page slot holding the data
+ * @offset: start of the data within the half page
+ * @len: length of the data
+ * Description: attach the data as the next page frag of @skb. If the
+ * stack released the other half of the page we keep the mapping and flip
+ * to it, otherwise the page is left to the stack and a new one gets
+ * allocated by gmac_rx_refill(). The caller synced the data for the CPU.
+ */
+static void gmac_rx_add_frag(struct gmac_priv *priv, struct sk_buff *skb,
+			     struct gmac_rx_page *buf, unsigned int offset,
+			     unsigned int len)
+{
+	skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, buf->page,
+			buf->page_offset + offset, len, GMAC_RX_PAGE_BUF);
+
+	if (likely(page_count(buf->page) == 1 &&
+		   page_to_nid(buf->page) == numa_node_id())) {
+		/* One reference for the stack, one kept by the ring */
+		get_page(buf->page);
+		buf->page_offset ^= GMAC_RX_PAGE_BUF;
+		priv->xstats.rx_page_flip++;
+	} else {
+		dma_unmap_page(priv->device, buf->dma, PAGE_SIZE,
+			       DMA_FROM_DEVICE);
+		buf->page = NULL;
 	}
 }
 
+/**
+ * gmac_rx_page_skb
+ * @priv: private driver structure
+ * @buf: RX page slot holding the first buffer of the frame
+ * @len: length of the data in this buffer
+ * Description: build the skb for a received frame. The headers are
+ * copied into a small linear skb, the rest of the buffer is attached as
+ * a page frag, see gmac_rx_add_frag().
+ */
+static struct sk_buff *gmac_rx_page_skb(struct gmac_priv *priv,
+					struct gmac_rx_page *buf, int len)
+{
+	struct sk_buff *skb;
+	unsigned char *va;
+	unsigned int hlen;
+
+	va = page_address(buf->page) + buf->page_offset;
+
+	/* Small frame: the half page stays in place */
+	if (len <= copybreak)
+		return gmac_rx_copy_skb(priv, buf->dma, buf->page_offset,
+					va, len);
+
+	dma_sync_single_range_for_cpu(priv->device, buf->dma,
+				      buf->page_offset, len,
+				      DMA_FROM_DEVICE);
+	prefetch(va);
+
+	skb = netdev_alloc_skb_ip_align(priv->ndev, GMAC_RX_HDR_LEN);
+	if (unlikely(skb == NULL))
+		return NULL;
+
+	hlen = min_t(unsigned int, len, GMAC_RX_HDR_LEN);
+	memcpy(__skb_put(skb, hlen), va, hlen);
+
+	/* The frame fitted in the header: the half page stays in place */
+	if (len > hlen)
+		gmac_rx_add_frag(priv, skb, buf, hlen, len - hlen);
+
+	return skb;
+}
+
 static int gmac_rx(struct gmac_priv *priv, int limit)
 {
 	unsigned int rxsize = priv->dma_rx_size;
@@ -1132,6 +2001,9 @@ static int gmac_rx(struct gmac_priv *priv, int limit)
 	unsigned int count = 0;
 	dma_desc_t *p = priv->dma_rx + entry;
 	dma_desc_t *p_next;
+	struct net_device_stats *stats = &priv->ndev->stats;
+	/* Jumbo frame still waiting for its last descriptor */
+	struct sk_buff *skb = priv->rx_skb;
 
 #ifdef RX_DEBUG
 	if (netif_msg_hw(priv)) {
@@ -1142,7 +2014,8 @@ static int gmac_rx(struct gmac_priv *priv, int limit)
 
 	count = 0;
 	while (!desc_get_rx_own(p)) {
-		int status;
+		struct gmac_rx_page *buf = priv->rx_page + entry;
+		int status, frame_len, len;
 
 		if (count >= limit)
 			break;
@@ -1153,67 +2026,134 @@ static int gmac_rx(struct gmac_priv *priv, int limit)
 		p_next = priv->dma_rx + next_entry;
 		prefetch(p_next);
 
+		if (unlikely(!buf->page)) {
+			pr_err("%s: Inconsistent Rx descriptor chain\n",
+				priv->ndev->name);
+			stats->rx_dropped++;
+			break;
+		}
+
+		if (desc_get_rx_fs(p) && unlikely(skb)) {
+			/* The end of the previous frame got lost */
+			dev_kfree_skb(skb);
+			skb = NULL;
+			stats->rx_length_errors++;
+			stats->rx_errors++;
+		}
+
+		if (!desc_get_rx_ls(p)) {
+			/* Full buffer of a jumbo frame, the status is only
+			 * valid in the last descriptor. */
+			len = GMAC_RX_BUF_LEN;
+			if (desc_get_rx_fs(p)) {
+				skb = gmac_rx_page_skb(priv, buf, len);
+				if (unlikely(!skb))
+					stats->rx_dropped++;
+			} else if (likely(skb)) {
+				if (unlikely(skb->len + len >
+					     GMAC_MAX_FRAME(priv->ndev->mtu))) {
+					dev_kfree_skb(skb);
+					skb = NULL;
+					stats->rx_length_errors++;
+					stats->rx_errors++;
+					goto next;
+				}
+				dma_sync_single_range_for_cpu(priv->device,
+						buf->dma, buf->page_offset,
+						len, DMA_FROM_DEVICE);
+				gmac_rx_add_frag(priv, skb, buf, 0, len);
+			}
+			goto next;
+		}
+
 		/* read the status of the incoming frame */
-		status = (desc_get_rx_status(&priv->ndev->stats,
-						    &priv->xstats, p));
-		if (unlikely(status == discard_frame))
-			priv->ndev->stats.rx_errors++;
-		else {
-			struct sk_buff *skb;
-			int frame_len;
-
-			frame_len = desc_get_rx_frame_len(p);
+		status = (desc_get_rx_status(stats, &priv->xstats, p));
+		if (unlikely(status == discard_frame)) {
+			stats->rx_errors++;
+			if (skb) {
+				dev_kfree_skb(skb);
+				skb = NULL;
+			}
+			goto next;
+		}
+
+		/* Length of the whole frame, FCS included */
+		frame_len = desc_get_rx_frame_len(p);
+#ifdef RX_DEBUG
+		if (frame_len > ETH_FRAME_LEN)
+			pr_debug("\tRX frame size %d, COE status: %d\n",
+				frame_len, status);
+
+		if (netif_msg_hw(priv))
+			pr_debug("\tdesc: %p [entry %d] buff=0x%x\n",
+				p, entry, p->desc2);
+#endif
+		if (desc_get_rx_fs(p)) {
 			/* ACS is set; GMAC core strips PAD/FCS for IEEE 802.3
 			 * Type frames (LLC/LLC-SNAP) */
 			if (unlikely(status != llc_snap))
 				frame_len -= ETH_FCS_LEN;
-#ifdef RX_DEBUG
-			if (frame_len > ETH_FRAME_LEN)
-				pr_debug("\tRX frame size %d, COE status: %d\n",
-					frame_len, status);
 
-			if (netif_msg_hw(priv))
-				pr_debug("\tdesc: %p [entry %d] buff=0x%x\n",
-					p, entry, p->desc2);
-#endif
-			skb = priv->rx_skbuff[entry];
+			skb = gmac_rx_page_skb(priv, buf, frame_len);
 			if (unlikely(!skb)) {
-				pr_err("%s: Inconsistent Rx descriptor chain\n",
-					priv->ndev->name);
-				priv->ndev->stats.rx_dropped++;
-				break;
+				stats->rx_dropped++;
+				goto next;
 			}
-			prefetch(skb->data - NET_IP_ALIGN);
-			priv->rx_skbuff[entry] = NULL;
+		} else {
+			/* Its first buffer was dropped */
+			if (unlikely(!skb))
+				goto next;
 
-			skb_put(skb, frame_len);
-			dma_unmap_single(priv->device,
-					 priv->rx_skbuff_dma[entry],
-					 priv->dma_buf_sz, DMA_FROM_DEVICE);
-#ifdef RX_DEBUG
-			if (netif_msg_pktdata(priv)) {
-				pr_info(" frame received (%dbytes)", frame_len);
-				print_pkt(skb->data, frame_len);
+			len = frame_len - skb->len;
+			if (unlikely(len < 0 || len > GMAC_RX_BUF_LEN)) {
+				dev_kfree_skb(skb);
+				skb = NULL;
+				stats->rx_length_errors++;
+				stats->rx_errors++;
+				goto next;
 			}
-#endif
-			skb->protocol = eth_type_trans(skb, priv->ndev);
-
-			if (unlikely(!priv->rx_coe)) {
-				/* No RX COE for old mac10/100 devices */
-				skb_checksum_none_assert(skb);
-				netif_receive_skb(skb);
-			} else {
-				skb->ip_summed = CHECKSUM_UNNECESSARY;
-				napi_gro_receive(&priv->napi, skb);
+			if (len) {
+				dma_sync_single_range_for_cpu(priv->device,
+						buf->dma, buf->page_offset,
+						len, DMA_FROM_DEVICE);
+				gmac_rx_add_frag(priv, skb, buf, 0, len);
 			}
 
-			priv->ndev->stats.rx_packets++;
-			priv->ndev->stats.rx_bytes += frame_len;
+			if (unlikely(status != llc_snap))
+				frame_len -= ETH_FCS_LEN;
+			/* The FCS may straddle the last two buffers */
+			pskb_trim(skb, frame_len);
+		}
+
+#ifdef RX_DEBUG
+		if (netif_msg_pktdata(priv)) {
+			pr_info(" frame received (%dbytes)", frame_len);
+			print_pkt(skb->data, skb_headlen(skb));
 		}
+#endif
+		gmac_rx_hwtstamp(priv, p, skb);
+		skb->protocol = eth_type_trans(skb, priv->ndev);
+
+		/* The IPC engine stays enabled, its verdict is only
+		 * trusted while RXCSUM is on and for TCP/UDP/ICMP
+		 * over IP frames without checksum errors. */
+		if (likely(status == good_frame &&
+			   (priv->ndev->features & NETIF_F_RXCSUM)))
+			skb->ip_summed = CHECKSUM_UNNECESSARY;
+		else
+			skb_checksum_none_assert(skb);
+		napi_gro_receive(&priv->napi, skb);
+		skb = NULL;
+
+		stats->rx_packets++;
+		stats->rx_bytes += frame_len;
+next:
 		entry = next_entry;
 		p = p_next;	/* use prefetched values */
 	}
 
+	priv->rx_skb = skb;
+
 	gmac_rx_refill(priv);
 
 	priv->xstats.rx_pkt_n += count;
@@ -1228,16 +2168,37 @@ static int gmac_rx(struct gmac_priv *priv, int limit)
  *	      all interfaces.
  *  Description :
  *   This function implements the the reception process.
- *   Also it runs the TX completion thread
+ *   Also it runs the TX completion thread, the TX reclaim is bounded by
+ *   the same budget.
  */
 static int gmac_poll(struct napi_struct *napi, int budget)
 {
 	struct gmac_priv *priv = container_of(napi, struct gmac_priv, napi);
 	int work_done = 0;
+	int tx_done;
 
 	priv->xstats.poll_n++;
-	gmac_tx(priv);
+
+	if (unlikely(priv->tx_err_pending)) {
+		priv->tx_err_pending = 0;
+		netif_tx_lock(priv->ndev);
+		gmac_tx_err(priv);
+		netif_tx_unlock(priv->ndev);
+	}
+
+	/* Frames whose doorbell was deferred by gmac_xmit() */
+	if (ACCESS_ONCE(priv->tx_unkicked))
+		dma_en_tx(priv->ioaddr);
+
+	tx_done = gmac_tx(priv, budget);
 	work_done = gmac_rx(priv, budget);
+	gmac_rx_coal_adapt(priv, work_done);
+
+	/* Stay in polling mode while the TX reclaim is behind */
+	if (tx_done >= budget)
+		work_done = budget;
+
+	gmac_dbg_poll(priv, work_done, budget);
 
 	if (work_done < budget) {
 		napi_complete(napi);
@@ -1258,8 +2219,11 @@ static void gmac_tx_timeout(struct net_device *ndev)
 {
 	struct gmac_priv *priv = netdev_priv(ndev);
 
-	/* Clear Tx resources and restart transmitting again */
-	gmac_tx_err(priv);
+	/* Clear Tx resources and restart transmitting again; this is done
+	 * by gmac_poll() so the reclaim never sees a ring being reset. */
+	priv->tx_err_pending = 1;
+	gmac_disable_irq(priv);
+	napi_schedule(&priv->napi);
 }
 
 /* Configuration changes (passed on by ifconfig) */
@@ -1309,24 +2273,18 @@ static void gmac_set_rx_mode(struct net_device *ndev)
  *  @new_mtu : the new MTU size for the device.
  *  Description: the Maximum Transfer Unit (MTU) is used by the network layer
  *  to drive packet transmission. Ethernet has an MTU of 1500 octets
- *  (ETH_DATA_LEN). This value can be changed with ifconfig.
+ *  (ETH_DATA_LEN). This value can be changed with ifconfig. The RX buffers
+ *  do not depend on it, frames larger than one buffer span several
+ *  descriptors, so it can also be changed on a running interface.
  *  Return value:
  *  0 on success and an appropriate (-)ve integer as defined in errno.h
  *  file on failure.
  */
 static int gmac_change_mtu(struct net_device *ndev, int new_mtu)
 {
-	int max_mtu;
-
-	if (netif_running(ndev)) {
-		pr_err("%s: must be stopped to change its MTU\n", ndev->name);
-		return -EBUSY;
-	}
-
-	max_mtu = SKB_MAX_HEAD(NET_SKB_PAD + NET_IP_ALIGN);
-
-	if ((new_mtu < 46) || (new_mtu > max_mtu)) {
-		pr_err("%s: invalid MTU, max MTU is: %d\n", ndev->name, max_mtu);
+	if ((new_mtu < 46) || (new_mtu > GMAC_JUMBO_MTU)) {
+		pr_err("%s: invalid MTU, max MTU is: %d\n", ndev->name,
+		       GMAC_JUMBO_MTU);
 		return -EINVAL;
 	}
 
@@ -1353,6 +2311,14 @@ static netdev_features_t gmac_fix_features(struct net_device *ndev,
 	if (priv->plat->bugged_jumbo && (ndev->mtu > ETH_DATA_LEN))
 		features &= ~NETIF_F_ALL_CSUM;
 
+	/* The TSO emulation relies on SG and on the checksum insertion */
+	if (!(features & NETIF_F_SG))
+		features &= ~NETIF_F_ALL_TSO;
+	if (!(features & NETIF_F_IP_CSUM))
+		features &= ~NETIF_F_TSO;
+	if (!(features & NETIF_F_IPV6_CSUM))
+		features &= ~NETIF_F_TSO6;
+
 	return features;
 }
 
@@ -1367,7 +2333,7 @@ static irqreturn_t gmac_interrupt(int irq, void *dev_id)
 	}
 
 	/* To handle GMAC own interrupts */
-	core_irq_status((void __iomem *) dev->base_addr);
+	core_irq_status((void __iomem *) dev->base_addr, &priv->xstats);
 
 	gmac_dma_interrupt(priv);
 
@@ -1402,6 +2368,11 @@ static int gmac_ioctl(struct net_device *ndev, struct ifreq *rq, int cmd)
 	if (!netif_running(ndev))
 		return -EINVAL;
 
+#ifdef CONFIG_GMAC_PTP
+	if (cmd == SIOCSHWTSTAMP)
+		return gmac_hwtstamp_ioctl(ndev, rq);
+#endif
+
 	if (!ndev->phydev)
 		return -EINVAL;
 
@@ -1411,8 +2382,8 @@ static int gmac_ioctl(struct net_device *ndev, struct ifreq *rq, int cmd)
 }
 
 #ifdef CONFIG_GMAC_DEBUG_FS
+/* debugfs layout: sunxi_gmac/<ifname>/{descriptors_status,ring_stats} */
 static struct dentry *gmac_fs_dir;
-static struct dentry *gmac_rings_status;
 
 static int gmac_sysfs_ring_read(struct seq_file *seq, void *v)
 {
@@ -1425,29 +2396,29 @@ static int gmac_sysfs_ring_read(struct seq_file *seq, void *v)
 	struct net_device *dev = seq->private;
 	struct gmac_priv *priv = netdev_priv(dev);
 
-	seq_printk(seq, "=======================\n");
-	seq_printk(seq, " RX descriptor ring\n");
-	seq_printk(seq, "=======================\n");
+	seq_printf(seq, "=======================\n");
+	seq_printf(seq, " RX descriptor ring\n");
+	seq_printf(seq, "=======================\n");
 
 	for (i = 0; i < priv->dma_rx_size; i++) {
 		struct tmp_s *x = (struct tmp_s *)(priv->dma_rx + i);
-		seq_printk(seq, "[%d] DES0=0x%x DES1=0x%x BUF1=0x%x BUF2=0x%x",
+		seq_printf(seq, "[%d] DES0=0x%x DES1=0x%x BUF1=0x%x BUF2=0x%x",
 			   i, (unsigned int)(x->a),
 			   (unsigned int)((x->a) >> 32), x->b, x->c);
-		seq_printk(seq, "\n");
+		seq_printf(seq, "\n");
 	}
 
-	seq_printk(seq, "\n");
-	seq_printk(seq, "=======================\n");
-	seq_printk(seq, "  TX descriptor ring\n");
-	seq_printk(seq, "=======================\n");
+	seq_printf(seq, "\n");
+	seq_printf(seq, "=======================\n");
+	seq_printf(seq, "  TX descriptor ring\n");
+	seq_printf(seq, "=======================\n");
 
 	for (i = 0; i < priv->dma_tx_size; i++) {
 		struct tmp_s *x = (struct tmp_s *)(priv->dma_tx + i);
-		seq_printk(seq, "[%d] DES0=0x%x DES1=0x%x BUF1=0x%x BUF2=0x%x",
+		seq_printf(seq, "[%d] DES0=0x%x DES1=0x%x BUF1=0x%x BUF2=0x%x",
 			   i, (unsigned int)(x->a),
 			   (unsigned int)((x->a) >> 32), x->b, x->c);
-		seq_printk(seq, "\n");
+		seq_printf(seq, "\n");
 	}
 
 	return 0;
@@ -1463,41 +2434,123 @@ static const struct file_operations gmac_rings_status_fops = {
 	.open = gmac_sysfs_ring_open,
 	.read = seq_read,
 	.llseek = seq_lseek,
-	.release = seq_release,
+	.release = single_release,
 };
 
+static void gmac_dbg_show_hist(struct seq_file *seq, const char *name,
+			       const char *unit, unsigned long *hist)
+{
+	int i;
+
+	seq_printf(seq, "\n%s:\n", name);
+	for (i = 0; i < GMAC_HIST_BUCKETS; i++) {
+		if (i == GMAC_HIST_BUCKETS - 1)
+			seq_printf(seq, "  >= %-6u %-5s %lu\n", 1U << i, unit,
+				   hist[i]);
+		else
+			seq_printf(seq, "  < %-7u %-5s %lu\n", 2U << i, unit,
+				   hist[i]);
+	}
+}
+
+static int gmac_ring_stats_read(struct seq_file *seq, void *v)
+{
+	struct net_device *dev = seq->private;
+	struct gmac_priv *priv = netdev_priv(dev);
+	struct gmac_ring_stats *rs = &priv->rstats;
+
+	seq_printf(seq, "RX ring: %u entries, cur %u, dirty %u\n",
+		   priv->dma_rx_size, priv->cur_rx, priv->dirty_rx);
+	seq_printf(seq, "  refill failures:  %lu\n", rs->rx_refill_fail);
+	seq_printf(seq, "  napi polls:       %lu\n", rs->napi_polls);
+	seq_printf(seq, "  polls at budget:  %lu\n", rs->napi_budget_hit);
+	seq_printf(seq, "TX ring: %u entries, cur %u, dirty %u, free %u\n",
+		   priv->dma_tx_size, priv->cur_tx, priv->dirty_tx,
+		   gmac_tx_avail(priv));
+	seq_printf(seq, "  ring full stalls: %lu\n", rs->tx_ring_full);
+
+	gmac_dbg_show_hist(seq, "packets per NAPI poll", "pkts",
+			   rs->poll_pkts);
+	gmac_dbg_show_hist(seq, "IRQ to poll latency", "usecs", rs->irq_lat);
+	gmac_dbg_show_hist(seq, "xmit to reclaim latency", "usecs",
+			   rs->tx_lat);
+
+	return 0;
+}
+
+static int gmac_ring_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, gmac_ring_stats_read, inode->i_private);
+}
+
+/* Any write clears the counters and the histograms */
+static ssize_t gmac_ring_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *seq = file->private_data;
+	struct gmac_priv *priv = netdev_priv(seq->private);
+
+	memset(&priv->rstats, 0, sizeof(struct gmac_ring_stats));
+
+	return count;
+}
+
+static const struct file_operations gmac_ring_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = gmac_ring_stats_open,
+	.read = seq_read,
+	.write = gmac_ring_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
 static int gmac_init_fs(struct net_device *dev)
 {
-	/* Create debugfs entries */
-	gmac_fs_dir = debugfs_create_dir(GMAC_RESOURCE_NAME, NULL);
+	struct gmac_priv *priv = netdev_priv(dev);
+	struct dentry *entry;
 
-	if (!gmac_fs_dir || IS_ERR(gmac_fs_dir)) {
+	if (!gmac_fs_dir || IS_ERR(gmac_fs_dir))
+		return -ENOMEM;
+
+	priv->dbgfs_dir = debugfs_create_dir(dev->name, gmac_fs_dir);
+	if (!priv->dbgfs_dir || IS_ERR(priv->dbgfs_dir)) {
 		pr_err("ERROR %s, debugfs create directory failed\n",
-		       GMAC_RESOURCE_NAME);
+		       dev->name);
+		priv->dbgfs_dir = NULL;
 
 		return -ENOMEM;
 	}
 
 	/* Entry to report DMA RX/TX rings */
-	gmac_rings_status = debugfs_create_file("descriptors_status",
-					   S_IRUGO, gmac_fs_dir, dev,
-					   &gmac_rings_status_fops);
+	entry = debugfs_create_file("descriptors_status", S_IRUGO,
+				    priv->dbgfs_dir, dev,
+				    &gmac_rings_status_fops);
+	if (!entry || IS_ERR(entry))
+		goto err;
+
+	/* Entry to report the per-ring counters and histograms */
+	entry = debugfs_create_file("ring_stats", S_IRUGO | S_IWUSR,
+				    priv->dbgfs_dir, dev,
+				    &gmac_ring_stats_fops);
+	if (!entry || IS_ERR(entry))
+		goto err;
 
-	if (!gmac_rings_status || IS_ERR(gmac_rings_status)) {
-		pr_info("ERROR creating gmac ring debugfs file\n");
-		debugfs_remove(gmac_fs_dir);
+	return 0;
 
-		return -ENOMEM;
-	}
+err:
+	pr_info("ERROR creating gmac ring debugfs file\n");
+	debugfs_remove_recursive(priv->dbgfs_dir);
+	priv->dbgfs_dir = NULL;
 
-	return 0;
+	return -ENOMEM;
 }
 
-static void gmac_exit_fs(void)
+static void gmac_exit_fs(struct net_device *dev)
 {
-	debugfs_remove(gmac_rings_status);
-	debugfs_remove(gmac_fs_dir);
+	struct gmac_priv *priv = netdev_priv(dev);
+
+	debugfs_remove_recursive(priv->dbgfs_dir);
+	priv->dbgfs_dir = NULL;
 }
 #endif /* CONFIG_GMAC_DEBUG_FS */
 
@@ -1575,8 +2628,11 @@ struct gmac_priv *gmac_dvr_probe(struct device *device,
 	ndev->netdev_ops = &gmac_netdev_ops;
 
 	ndev->hw_features = NETIF_F_SG | NETIF_F_IP_CSUM
-						| NETIF_F_IPV6_CSUM | NETIF_F_RXCSUM;
+						| NETIF_F_IPV6_CSUM | NETIF_F_RXCSUM
+						| NETIF_F_TSO | NETIF_F_TSO6;
 	ndev->features |= ndev->hw_features | NETIF_F_HIGHDMA;
+	/* Bound the ring usage of a single TSO frame */
+	ndev->gso_max_segs = GMAC_TSO_MAX_SEGS;
 	ndev->watchdog_timeo = msecs_to_jiffies(watchdog);
 #ifdef GMAC_VLAN_TAG_USED
 	/* Gmac support receive VLAN tag detection */
@@ -1587,10 +2643,27 @@ struct gmac_priv *gmac_dvr_probe(struct device *device,
 	if (flow_ctrl)
 		priv->flow_ctrl = FLOW_AUTO;	/* RX/TX pause on */
 
+	priv->rx_coal_usecs = GMAC_COAL_RX_USECS;
+	priv->rx_coal_frames = GMAC_COAL_RX_FRAMES;
+	priv->rx_coal_cur_frames = 1;
+	priv->rx_coal_adaptive = 1;
+	priv->tx_coal_usecs = GMAC_COAL_TX_USECS;
+	priv->tx_coal_frames = GMAC_COAL_TX_FRAMES;
+
+	/* Ring sizes, ethtool -G can change them later on */
+	priv->dma_tx_size = clamp_t(unsigned int,
+				    roundup_pow_of_two(GMAC_ALIGN(dma_txsize)),
+				    GMAC_MIN_RING_SIZE, GMAC_MAX_RING_SIZE);
+	priv->dma_rx_size = clamp_t(unsigned int,
+				    roundup_pow_of_two(GMAC_ALIGN(dma_rxsize)),
+				    GMAC_MIN_RING_SIZE, GMAC_MAX_RING_SIZE);
+
 	netif_napi_add(ndev, &priv->napi, gmac_poll, 64);
 
 	spin_lock_init(&priv->lock);
-	spin_lock_init(&priv->tx_lock);
+
+	/* Magic packet and unicast wake-up through the PMT block */
+	device_set_wakeup_capable(device, 1);
 
 	gmac_check_ether_addr(priv);
 	ret = register_netdev(ndev);
@@ -1632,59 +2705,91 @@ int gmac_dvr_remove(struct net_device *ndev)
 }
 
 #ifdef CONFIG_PM
+/* Suspend keeps the descriptor rings and the mapped RX pages in place:
+ * the DMA is only stopped, so resume does not have to reallocate and
+ * refill anything. Frames still queued for TX are dropped, the PHY and,
+ * with WoL armed, the MAC receiver stay up to watch for wake-up events. */
 int gmac_suspend(struct net_device *ndev)
 {
 	struct gmac_priv *priv = netdev_priv(ndev);
-	int dis_ic = 0;
+	int wol;
 
 	if (!ndev || !netif_running(ndev))
 		return 0;
 
+	wol = device_may_wakeup(priv->device) && priv->wolopts;
+
 	if (ndev->phydev)
 		phy_stop(ndev->phydev);
 
-	spin_lock(&priv->lock);
-
 	netif_device_detach(ndev);
-	netif_stop_queue(ndev);
-
+	netif_tx_disable(ndev);
 	napi_disable(&priv->napi);
+	del_timer_sync(&priv->tx_coal_timer);
+
+	spin_lock(&priv->lock);
 
-	/* Stop TX/RX DMA */
+	gmac_disable_irq(priv);
 	dma_stop_tx(priv->ioaddr);
 	dma_stop_rx(priv->ioaddr);
-	/* Clear the Rx/Tx descriptors */
-	desc_init_rx(priv->dma_rx, priv->dma_rx_size,
-				     dis_ic);
+
+	/* The RX ring is left as it is, its position survives the stop */
+	dma_free_tx_skbufs(priv);
 	desc_init_tx(priv->dma_tx, priv->dma_tx_size);
+	priv->dirty_tx = 0;
+	priv->cur_tx = 0;
+	priv->posted_tx = 0;
+	priv->tx_unkicked = 0;
+	netdev_reset_queue(priv->ndev);
 
-	gmac_set_tx_rx(priv->ioaddr, false);
+	if (wol)
+		core_pmt(priv->ioaddr, priv->wolopts);
+	else
+		gmac_set_tx_rx(priv->ioaddr, false);
 
 	spin_unlock(&priv->lock);
+
+	if (wol)
+		enable_irq_wake(ndev->irq);
+
 	return 0;
 }
 
 int gmac_resume(struct net_device *ndev)
 {
 	struct gmac_priv *priv = netdev_priv(ndev);
+	int wol;
 
 	if (!netif_running(ndev))
 		return 0;
 
+	wol = device_may_wakeup(priv->device) && priv->wolopts;
+	if (wol)
+		disable_irq_wake(ndev->irq);
+
 	spin_lock(&priv->lock);
 
-	netif_device_attach(ndev);
+	/* Leave power down; a wake-up frame already cleared it */
+	if (wol)
+		core_pmt(priv->ioaddr, 0);
+
+	dma_set_tx_list(priv->ioaddr, priv->dma_tx_phy);
 
 	/* Enable the MAC and DMA */
 	gmac_set_tx_rx(priv->ioaddr, true);
 	dma_start_tx(priv->ioaddr);
 	dma_start_rx(priv->ioaddr);
 
-	napi_enable(&priv->napi);
+	spin_unlock(&priv->lock);
 
-	netif_start_queue(ndev);
+	/* Pick up whatever the ring received before the stop */
+	napi_enable(&priv->napi);
+	local_bh_disable();
+	gmac_enable_irq(priv);
+	_gmac_schedule(priv);
+	local_bh_enable();
 
-	spin_unlock(&priv->lock);
+	netif_device_attach(ndev);
 
 	if (ndev->phydev)
 		phy_start(ndev->phydev);
@@ -1736,6 +2841,13 @@ static int __init gmac_init(void)
 	}
 #endif
 
+#ifdef CONFIG_GMAC_DEBUG_FS
+	gmac_fs_dir = debugfs_create_dir(GMAC_RESOURCE_NAME, NULL);
+	if (!gmac_fs_dir || IS_ERR(gmac_fs_dir))
+		pr_warning("%s: debugfs create directory failed\n",
+			   GMAC_RESOURCE_NAME);
+#endif
+
 	platform_device_register(&gmac_device);
 	return platform_driver_register(&gmac_driver);
 }
@@ -1748,6 +2860,9 @@ static void __exit gmac_remove(void)
 	}
 	platform_driver_unregister(&gmac_driver);
 	platform_device_unregister(&gmac_device);
+#ifdef CONFIG_GMAC_DEBUG_FS
+	debugfs_remove_recursive(gmac_fs_dir);
+#endif
 }
 
 module_init(gmac_init);
@@ -64,40 +64,74 @@ int desc_get_tx_len(dma_desc_t *p)
 	return p->desc1.tx.buf1_size;
 }
 
+/* Decode the RX checksum engine (IPC) result.
+ *
+ * bits 5 7 0 | Frame status
+ * ----------------------------------------------------------
+ *      0 0 0 | IEEE 802.3 Type frame (length < 1536 octects)
+ *      1 0 0 | IPv4/6 No CSUM errorS.
+ *      1 0 1 | IPv4/6 CSUM PAYLOAD error
+ *      1 1 0 | IPv4/6 CSUM IP HR error
+ *      1 1 1 | IPv4/6 IP PAYLOAD AND HEADER errorS
+ *      0 0 1 | IPv4/6 unsupported IP PAYLOAD
+ *      0 1 1 | COE bypassed.. no IPv4/6 frame
+ *      0 1 0 | Reserved.
+ *
+ * Frames with a checksum error are not dropped here, the stack
+ * verifies them again in software.
+ */
+static int desc_rx_coe_status(dma_desc_t *p)
+{
+	u32 status = (p->desc0.rx.frm_type << 2) |
+		     (p->desc0.rx.ipch_err << 1) | p->desc0.rx.chsum_err;
+
+	if (status == 0x0)
+		return llc_snap;
+	if (status == 0x4)
+		return good_frame;
+
+	return csum_none;
+}
+
 /* This function verifies if each incoming frame has some errors
- * and, if required, updates the multicast statistics.
- * In case of success, it returns good_frame because the GMAC device
- * is supposed to be able to compute the csum in HW. */
+ * and, if required, updates the multicast statistics. The status is
+ * only valid in the last descriptor of a frame.
+ * In case of success, it returns good_frame when the GMAC device
+ * validated the checksum, csum_none when the stack has to do it. */
 int desc_get_rx_status(void *data, struct gmac_extra_stats *x, dma_desc_t *p)
 {
 	int ret = good_frame;
 	struct net_device_stats *stats = (struct net_device_stats *)data;
 
-	if (unlikely(p->desc0.rx.last_desc == 0)) {
-		pr_warning("ndesc Error: Oversized Ethernet "
-			   "frame spanned multiple buffers\n");
-		stats->rx_length_errors++;
-		return discard_frame;
-	}
-
+	/* The summary also reports checksum errors, those alone do not
+	 * make the frame bad. */
 	if (unlikely(p->desc0.rx.err_sum)) {
-		if (unlikely(p->desc0.rx.desc_err))
+		if (unlikely(p->desc0.rx.desc_err)) {
 			x->rx_desc++;
+			ret = discard_frame;
+		}
 		if (unlikely(p->desc0.rx.sou_filter))
 			x->sa_filter_fail++;
-		if (unlikely(p->desc0.rx.over_err))
+		if (unlikely(p->desc0.rx.over_err)) {
 			x->overflow_error++;
+			ret = discard_frame;
+		}
 		if (unlikely(p->desc0.rx.ipch_err))
 			x->ipc_csum_error++;
 		if (unlikely(p->desc0.rx.late_coll)) {
 			x->rx_collision++;
 			stats->collisions++;
+			ret = discard_frame;
 		}
 		if (unlikely(p->desc0.rx.crc_err)) {
 			x->rx_crc++;
 			stats->rx_crc_errors++;
+			ret = discard_frame;
+		}
+		if (unlikely(p->desc0.rx.recv_wt)) {
+			x->rx_watchdog++;
+			ret = discard_frame;
 		}
-		ret = discard_frame;
 	}
 	if (unlikely(p->desc0.rx.dribbling))
 		x->dribbling_bit++;
@@ -114,7 +148,10 @@ int desc_get_rx_status(void *data, struct gmac_extra_stats *x, dma_desc_t *p)
 	if (p->desc0.rx.vlan_tag)
 		x->vlan_tag++;
 #endif
-	return ret;
+	if (unlikely(ret == discard_frame))
+		return ret;
+
+	return desc_rx_coe_status(p);
 }
 
 void desc_init_rx(dma_desc_t *p, unsigned int ring_size,
@@ -123,7 +160,7 @@ void desc_init_rx(dma_desc_t *p, unsigned int ring_size,
 	int i;
 	for (i = 0; i < ring_size; i++) {
 		p->desc0.rx.own = 1;
-		p->desc1.rx.buf1_size = BUF_SIZE_2KiB - 1;
+		p->desc1.rx.buf1_size = GMAC_RX_BUF_LEN;
 
 		desc_rx_set_on_ring_chain(p, (i == ring_size - 1));
 
@@ -163,6 +200,11 @@ void desc_set_rx_own(dma_desc_t *p)
 	p->desc0.rx.own = 1;
 }
 
+void desc_set_rx_ic(dma_desc_t *p, int ic)
+{
+	p->desc1.rx.dis_ic = !ic;
+}
+
 int desc_get_tx_ls(dma_desc_t *p)
 {
 	return p->desc1.tx.last_seg;
@@ -176,13 +218,13 @@ void desc_release_tx(dma_desc_t *p)
 	desc_end_tx_desc(p, ter);
 }
 
-void desc_prepare_tx(dma_desc_t *p, int is_fs, int len, int csum_flag)
+void desc_prepare_tx(dma_desc_t *p, int is_fs, int len, int cic)
 {
 	p->desc1.tx.first_sg = is_fs;
 	norm_set_tx_desc_len(p, len);
 
-	if (likely(csum_flag))
-		p->desc1.tx.cic = cic_full;
+	/* Checksum insertion control, see enum csum_insertion */
+	p->desc1.tx.cic = cic;
 }
 
 void desc_clear_tx_ic(dma_desc_t *p)
@@ -201,71 +243,33 @@ int desc_get_rx_frame_len(dma_desc_t *p)
 	return p->desc0.rx.frm_len;
 }
 
-#if defined(CONFIG_GMAC_RING)
-unsigned int gmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
+int desc_get_rx_fs(dma_desc_t *p)
 {
-	struct gmac_priv *priv = (struct gmac_priv *) p;
-	unsigned int txsize = priv->dma_tx_size;
-	unsigned int entry = priv->cur_tx % txsize;
-	dma_desc_t *desc = priv->dma_tx + entry;
-	unsigned int nopaged_len = skb_headlen(skb);
-	unsigned int bmax, len;
-
-	bmax = BUF_SIZE_2KiB;
-
-	len = nopaged_len - bmax;
-
-	if (nopaged_len > BUF_SIZE_8KiB) {
-
-		desc->desc2 = dma_map_single(priv->device, skb->data,
-					    bmax, DMA_TO_DEVICE);
-		desc->desc3 = desc->desc2 + BUF_SIZE_4KiB;
-		desc_prepare_tx(desc, 1, bmax, csum);
-
-		entry = (++priv->cur_tx) % txsize;
-		desc = priv->dma_tx + entry;
-
-		desc->desc2 = dma_map_single(priv->device, skb->data + bmax,
-					    len, DMA_TO_DEVICE);
-		desc->desc3 = desc->desc2 + BUF_SIZE_4KiB;
-		desc_prepare_tx(desc, 0, len, csum);
-		desc_set_tx_own(desc);
-		priv->tx_skbuff[entry] = NULL;
-	} else {
-		desc->desc2 = dma_map_single(priv->device, skb->data,
-					    nopaged_len, DMA_TO_DEVICE);
-		desc->desc3 = desc->desc2 + BUF_SIZE_4KiB;
-		desc_prepare_tx(desc, 1, nopaged_len, csum);
-	}
-
-	return entry;
+	return p->desc0.rx.first_desc;
 }
 
-unsigned int gmac_is_jumbo_frm(int len)
+int desc_get_rx_ls(dma_desc_t *p)
 {
-	unsigned int ret = 0;
-
-	if (len >= BUF_SIZE_4KiB)
-		ret = 1;
+	return p->desc0.rx.last_desc;
+}
 
-	return ret;
+void desc_enable_tx_timestamp(dma_desc_t *p)
+{
+	p->desc1.tx.ttse = 1;
 }
 
-void gmac_refill_desc3(int bfsize, dma_desc_t *p)
+int desc_get_tx_timestamp_status(dma_desc_t *p)
 {
-	/* Fill DES3 in case of RING mode */
-	if (bfsize >= BUF_SIZE_8KiB)
-		p->desc3 = p->desc2 + BUF_SIZE_8KiB;
+	return p->desc0.tx.ttss;
 }
 
-/* In ring mode we need to fill the desc3 because it is used
- * as buffer */
-void gmac_init_desc3(int desc3_as_data_buf, dma_desc_t *p)
+/* A frame without a valid snapshot gets all ones */
+int desc_get_rx_timestamp_status(dma_desc_t *p)
 {
-	if (unlikely(desc3_as_data_buf))
-		p->desc3 = p->desc2 + BUF_SIZE_8KiB;
+	return p->desc2 != 0xffffffff || p->desc3 != 0xffffffff;
 }
 
+#if defined(CONFIG_GMAC_RING)
 void gmac_init_dma_chain(dma_desc_t *des, dma_addr_t phy_addr,
 				  unsigned int size)
 {
@@ -277,81 +281,21 @@ void gmac_clean_desc3(dma_desc_t *p)
 		p->desc3 = 0;
 }
 
-int gmac_set_16kib_bfsize(int mtu)
+/* desc3 is the unused second buffer, its size is zero */
+void gmac_refill_desc3(dma_desc_t *p, dma_addr_t next)
 {
-	int ret = 0;
-	if (unlikely(mtu >= BUF_SIZE_8KiB))
-		ret = BUF_SIZE_16KiB;
-	return ret;
 }
 
 #else
 
-unsigned int gmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
-{
-	struct gmac_priv *priv = (struct gmac_priv *) p;
-	unsigned int txsize = priv->dma_tx_size;
-	unsigned int entry = priv->cur_tx % txsize;
-	dma_desc_t *desc = priv->dma_tx + entry;
-	unsigned int nopaged_len = skb_headlen(skb);
-	unsigned int bmax;
-	unsigned int i = 1, len;
-
-	bmax = BUF_SIZE_2KiB;
-
-	len = nopaged_len - bmax;
-
-	desc->desc2 = dma_map_single(priv->device, skb->data,
-				    bmax, DMA_TO_DEVICE);
-	desc_prepare_tx(desc, 1, bmax, csum);
-
-	while (len != 0) {
-		entry = (++priv->cur_tx) % txsize;
-		desc = priv->dma_tx + entry;
-
-		if (len > bmax) {
-			desc->desc2 = dma_map_single(priv->device,
-						    (skb->data + bmax * i),
-						    bmax, DMA_TO_DEVICE);
-			desc_prepare_tx(desc, 0, bmax, csum);
-			desc_set_tx_own(desc);
-			priv->tx_skbuff[entry] = NULL;
-			len -= bmax;
-			i++;
-		} else {
-			desc->desc2 = dma_map_single(priv->device,
-						    (skb->data + bmax * i), len,
-						    DMA_TO_DEVICE);
-			desc_prepare_tx(desc, 0, len, csum);
-			desc_set_tx_own(desc);
-			priv->tx_skbuff[entry] = NULL;
-			len = 0;
-		}
-	}
-	return entry;
-}
-
-unsigned int gmac_is_jumbo_frm(int len)
-{
-	unsigned int ret = 0;
-
-	if (len > BUF_SIZE_2KiB) {
-		ret = 1;
-	}
-
-	return ret;
-}
-
-void gmac_refill_desc3(int bfsize, dma_desc_t *p)
-{
-}
-
-void gmac_init_desc3(int desc3_as_data_buf, dma_desc_t *p)
+void gmac_clean_desc3(dma_desc_t *p)
 {
 }
 
-void gmac_clean_desc3(dma_desc_t *p)
+/* Put back the chain pointer a timestamp was written over */
+void gmac_refill_desc3(dma_desc_t *p, dma_addr_t next)
 {
+	p->desc3 = (unsigned int)next;
 }
 
 void gmac_init_dma_chain(dma_desc_t *des, dma_addr_t phy_addr,
@@ -373,22 +317,4 @@ void gmac_init_dma_chain(dma_desc_t *des, dma_addr_t phy_addr,
 	p->desc3 = (unsigned int)phy_addr;
 }
 
-int gmac_set_16kib_bfsize(int mtu)
-{
-	/* Not supported */
-	return 0;
-}
-
-#if 0
-const struct gmac_ring_mode_ops ring_mode_ops = {
-	.is_jumbo_frm = gmac_is_jumbo_frm,
-	.jumbo_frm = gmac_jumbo_frm,
-	.refill_desc3 = gmac_refill_desc3,
-	.init_desc3 = gmac_init_desc3,
-	.init_dma_chain = gmac_init_dma_chain,
-	.clean_desc3 = gmac_clean_desc3,
-	.set_16kib_bfsize = gmac_set_16kib_bfsize,
-};
-#endif
-
 #endif
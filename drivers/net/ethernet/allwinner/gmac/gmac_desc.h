@@ -10,6 +10,11 @@
 #define BUF_SIZE_4KiB 4096
 #define BUF_SIZE_2KiB 2048
 
+/* RX buffer size: it has to fit in the 11 bits of buf1_size and stay a
+ * multiple of the bus width, frames that do not fit in one buffer span
+ * several descriptors. */
+#define GMAC_RX_BUF_LEN	(BUF_SIZE_2KiB - 8)
+
 typedef union {
 	struct {
 		/* TDES0 */
@@ -107,7 +112,8 @@ typedef struct dma_desc {
 #ifdef CONFIG_GMAC_RING
 static inline void desc_rx_set_on_ring_chain(dma_desc_t *p, int end)
 {
-	p->desc1.rx.buf2_size = BUF_SIZE_2KiB - 1;
+	/* desc3 holds no buffer, the DMA moves on to the next descriptor */
+	p->desc1.rx.buf2_size = 0;
 	if (end)
 		p->desc1.rx.end_ring = 1;
 }
@@ -158,7 +164,7 @@ int desc_get_tx_own(dma_desc_t *p);
 void desc_set_tx_own(dma_desc_t *p);
 int desc_get_tx_ls(dma_desc_t *p);
 void desc_release_tx(dma_desc_t *p);
-void desc_prepare_tx(dma_desc_t *p, int is_fs, int len, int csum_flag);
+void desc_prepare_tx(dma_desc_t *p, int is_fs, int len, int cic);
 void desc_clear_tx_ic(dma_desc_t *p);
 void desc_close_tx(dma_desc_t *p);
 
@@ -166,14 +172,20 @@ int desc_get_rx_status(void *data, struct gmac_extra_stats *x, dma_desc_t *p);
 void desc_init_rx(dma_desc_t *p, unsigned int ring_size, int disable_rx_ic);
 int desc_get_rx_own(dma_desc_t *p);
 void desc_set_rx_own(dma_desc_t *p);
+void desc_set_rx_ic(dma_desc_t *p, int ic);
 int desc_get_rx_frame_len(dma_desc_t *p);
+int desc_get_rx_fs(dma_desc_t *p);
+int desc_get_rx_ls(dma_desc_t *p);
 
-unsigned int gmac_jumbo_frm(void *p, struct sk_buff *skb, int csum);
-unsigned int gmac_is_jumbo_frm(int len);
-void gmac_refill_desc3(int bfsize, dma_desc_t *p);
-void gmac_init_desc3(int desc3_as_data_buf, dma_desc_t *p);
 void gmac_init_dma_chain(dma_desc_t *des, dma_addr_t phy_addr, unsigned int size);
 void gmac_clean_desc3(dma_desc_t *p);
-int gmac_set_16kib_bfsize(int mtu);
+void gmac_refill_desc3(dma_desc_t *p, dma_addr_t next);
+
+/* With timestamping on, the DMA writes the timestamp of a frame into
+ * desc2 and desc3 of its last descriptor: the sub-seconds and the
+ * seconds. */
+void desc_enable_tx_timestamp(dma_desc_t *p);
+int desc_get_tx_timestamp_status(dma_desc_t *p);
+int desc_get_rx_timestamp_status(dma_desc_t *p);
 
 #endif //__GMAC_DESC_H__
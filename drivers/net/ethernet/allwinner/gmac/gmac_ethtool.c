@@ -21,6 +21,7 @@
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
 #include <linux/interrupt.h>
+#include <linux/log2.h>
 #include <linux/mii.h>
 #include <linux/phy.h>
 #include <asm/io.h>
@@ -88,6 +89,13 @@ static const struct gmac_stats gmac_gstrings_stats[] = {
 	GMAC_STAT(poll_n),
 	GMAC_STAT(sched_timer_n),
 	GMAC_STAT(normal_irq_n),
+	GMAC_STAT(pmt_irq_n),
+	GMAC_STAT(rx_page_alloc),
+	GMAC_STAT(rx_page_flip),
+	GMAC_STAT(rx_copybreak_n),
+	GMAC_STAT(tx_tso_frames),
+	GMAC_STAT(tx_tso_segs),
+	GMAC_STAT(tx_tso_fallback),
 };
 #define GMAC_STATS_LEN ARRAY_SIZE(gmac_gstrings_stats)
 
@@ -234,6 +242,82 @@ gmac_set_pauseparam(struct net_device *netdev,
 	return ret;
 }
 
+static int gmac_get_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *ec)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+
+	ec->rx_coalesce_usecs = priv->rx_coal_usecs;
+	ec->rx_max_coalesced_frames = priv->rx_coal_frames;
+	ec->tx_coalesce_usecs = priv->tx_coal_usecs;
+	ec->tx_max_coalesced_frames = priv->tx_coal_frames;
+	ec->use_adaptive_rx_coalesce = priv->rx_coal_adaptive;
+
+	return 0;
+}
+
+static int gmac_set_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *ec)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+
+	if (!ec->rx_max_coalesced_frames || !ec->tx_max_coalesced_frames)
+		return -EINVAL;
+
+	if (ec->rx_max_coalesced_frames > priv->dma_rx_size / 2 ||
+	    ec->tx_max_coalesced_frames > priv->dma_tx_size / 2)
+		return -EINVAL;
+
+	/* Frames without TX IC are only reclaimed by the timer */
+	if (ec->tx_max_coalesced_frames > 1 && !ec->tx_coalesce_usecs)
+		return -EINVAL;
+
+	priv->rx_coal_usecs = ec->rx_coalesce_usecs;
+	priv->rx_coal_frames = ec->rx_max_coalesced_frames;
+	priv->rx_coal_adaptive = !!ec->use_adaptive_rx_coalesce;
+	priv->tx_coal_usecs = ec->tx_coalesce_usecs;
+	priv->tx_coal_frames = ec->tx_max_coalesced_frames;
+	gmac_set_rx_coalesce(priv);
+
+	return 0;
+}
+
+static void gmac_get_ringparam(struct net_device *ndev,
+			       struct ethtool_ringparam *ring)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+
+	ring->rx_max_pending = GMAC_MAX_RING_SIZE;
+	ring->tx_max_pending = GMAC_MAX_RING_SIZE;
+	ring->rx_pending = priv->dma_rx_size;
+	ring->tx_pending = priv->dma_tx_size;
+}
+
+static int gmac_set_ringparam(struct net_device *ndev,
+			      struct ethtool_ringparam *ring)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+	unsigned int rx_size, tx_size;
+
+	if (ring->rx_mini_pending || ring->rx_jumbo_pending)
+		return -EINVAL;
+
+	if (ring->rx_pending < GMAC_MIN_RING_SIZE ||
+	    ring->rx_pending > GMAC_MAX_RING_SIZE ||
+	    ring->tx_pending < GMAC_MIN_RING_SIZE ||
+	    ring->tx_pending > GMAC_MAX_RING_SIZE)
+		return -EINVAL;
+
+	/* The ring indexes wrap around modulo the size */
+	rx_size = roundup_pow_of_two(ring->rx_pending);
+	tx_size = roundup_pow_of_two(ring->tx_pending);
+
+	if (rx_size == priv->dma_rx_size && tx_size == priv->dma_tx_size)
+		return 0;
+
+	return gmac_set_ring_size(ndev, rx_size, tx_size);
+}
+
 static void gmac_get_ethtool_stats(struct net_device *ndev,
 				 struct ethtool_stats *dummy, u64 *data)
 {
@@ -279,6 +363,34 @@ static void gmac_get_strings(struct net_device *ndev, u32 stringset, u8 *data)
 	}
 }
 
+#define GMAC_WOL_SUPPORTED	(WAKE_MAGIC | WAKE_UCAST)
+
+static void gmac_get_wol(struct net_device *ndev, struct ethtool_wolinfo *wol)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+
+	spin_lock_irq(&priv->lock);
+	wol->supported = GMAC_WOL_SUPPORTED;
+	wol->wolopts = priv->wolopts;
+	spin_unlock_irq(&priv->lock);
+}
+
+static int gmac_set_wol(struct net_device *ndev, struct ethtool_wolinfo *wol)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+
+	if (wol->wolopts & ~GMAC_WOL_SUPPORTED)
+		return -EINVAL;
+
+	device_set_wakeup_enable(priv->device, !!wol->wolopts);
+
+	spin_lock_irq(&priv->lock);
+	priv->wolopts = wol->wolopts;
+	spin_unlock_irq(&priv->lock);
+
+	return 0;
+}
+
 static const struct ethtool_ops gmac_ethtool_ops = {
 	.begin = gmac_check_if_running,
 	.get_drvinfo = gmac_ethtool_getdrvinfo,
@@ -291,10 +403,14 @@ static const struct ethtool_ops gmac_ethtool_ops = {
 	.get_link = ethtool_op_get_link,
 	.get_pauseparam = gmac_get_pauseparam,
 	.set_pauseparam = gmac_set_pauseparam,
+	.get_coalesce = gmac_get_coalesce,
+	.set_coalesce = gmac_set_coalesce,
+	.get_ringparam = gmac_get_ringparam,
+	.set_ringparam = gmac_set_ringparam,
 	.get_ethtool_stats = gmac_get_ethtool_stats,
 	.get_strings = gmac_get_strings,
-	//.get_wol = gmac_get_wol,
-	//.set_wol = gmac_set_wol,
+	.get_wol = gmac_get_wol,
+	.set_wol = gmac_set_wol,
 	.get_sset_count	= gmac_get_sset_count,
 };
 
@@ -59,6 +59,13 @@ struct gmac_extra_stats {
 	unsigned long poll_n;
 	unsigned long sched_timer_n;
 	unsigned long normal_irq_n;
+	unsigned long pmt_irq_n;
+	unsigned long rx_page_alloc;
+	unsigned long rx_page_flip;
+	unsigned long rx_copybreak_n;
+	unsigned long tx_tso_frames;
+	unsigned long tx_tso_segs;
+	unsigned long tx_tso_fallback;
 };
 
 void gmac_set_ethtool_ops(struct net_device *netdev);
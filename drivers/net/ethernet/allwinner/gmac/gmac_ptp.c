@@ -0,0 +1,313 @@
+/*
+ * gmac_ptp.c: IEEE 1588 timestamps and PTP clock of the sunxi GMAC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * The system time runs from the AHB clock in fine update mode: the
+ * addend accumulator overflows at about half the clock rate and adds
+ * the sub-second increment each time. Frequency corrections only
+ * change the addend.
+ *
+ * The driver uses the normal descriptors, which carry IEEE 1588-2002
+ * timestamps. The RX side snapshots PTP v1 event messages over UDP,
+ * any TX frame can be stamped.
+ */
+
+#include <linux/delay.h>
+#include <linux/io.h>
+#include <linux/net_tstamp.h>
+#include <linux/uaccess.h>
+#include "sunxi_gmac.h"
+
+/* The addend stays close to 2^31, so a few percent are no problem */
+#define GMAC_PTP_MAX_ADJ	62500000
+
+/* Wait for the timestamp unit to take an update, ptp_lock held */
+static int gmac_ptp_wait(void __iomem *ioaddr, u32 bit)
+{
+	int limit = 100;
+
+	while (readl(ioaddr + GMAC_TS_CTL) & bit) {
+		if (!limit--)
+			return -EBUSY;
+		udelay(1);
+	}
+
+	return 0;
+}
+
+static int gmac_ptp_cmd(void __iomem *ioaddr, u32 bit)
+{
+	writel(readl(ioaddr + GMAC_TS_CTL) | bit, ioaddr + GMAC_TS_CTL);
+
+	return gmac_ptp_wait(ioaddr, bit);
+}
+
+static u32 gmac_ptp_ns_to_subsec(struct gmac_priv *priv, u32 ns)
+{
+	if (priv->ptp_digital)
+		return ns;
+
+	return div_u64((u64)ns << 31, NSEC_PER_SEC);
+}
+
+static u64 gmac_ptp_to_ns(struct gmac_priv *priv, u32 sec, u32 subsec)
+{
+	u64 ns = subsec & TS_SUBSEC_MASK;
+
+	if (!priv->ptp_digital)
+		ns = (ns * NSEC_PER_SEC) >> 31;
+
+	return (u64)sec * NSEC_PER_SEC + ns;
+}
+
+/* Timestamp the DMA wrote into the last descriptor of a frame */
+u64 gmac_ptp_desc_ns(struct gmac_priv *priv, dma_desc_t *p)
+{
+	return gmac_ptp_to_ns(priv, p->desc3, p->desc2);
+}
+
+static int gmac_ptp_adjfreq(struct ptp_clock_info *ptp, s32 ppb)
+{
+	struct gmac_priv *priv = container_of(ptp, struct gmac_priv, ptp_info);
+	unsigned long flags;
+	u32 addend, diff;
+	int ret;
+
+	diff = div_u64((u64)priv->ptp_addend * abs(ppb), NSEC_PER_SEC);
+	addend = ppb < 0 ? priv->ptp_addend - diff : priv->ptp_addend + diff;
+
+	spin_lock_irqsave(&priv->ptp_lock, flags);
+	writel(addend, priv->ioaddr + GMAC_TS_ADDEND);
+	ret = gmac_ptp_cmd(priv->ioaddr, TS_CTL_ADDREG);
+	spin_unlock_irqrestore(&priv->ptp_lock, flags);
+
+	return ret;
+}
+
+static int gmac_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
+{
+	struct gmac_priv *priv = container_of(ptp, struct gmac_priv, ptp_info);
+	struct timespec ts;
+	unsigned long flags;
+	u32 subsec;
+	int ret;
+
+	ts = ns_to_timespec(delta < 0 ? -delta : delta);
+	subsec = gmac_ptp_ns_to_subsec(priv, ts.tv_nsec);
+	if (delta < 0)
+		subsec |= TS_SUBSEC_ADDSUB;
+
+	spin_lock_irqsave(&priv->ptp_lock, flags);
+	writel(ts.tv_sec, priv->ioaddr + GMAC_TS_SEC_UPD);
+	writel(subsec, priv->ioaddr + GMAC_TS_SUBSEC_UPD);
+	ret = gmac_ptp_cmd(priv->ioaddr, TS_CTL_UPDT);
+	spin_unlock_irqrestore(&priv->ptp_lock, flags);
+
+	return ret;
+}
+
+static int gmac_ptp_gettime(struct ptp_clock_info *ptp, struct timespec *ts)
+{
+	struct gmac_priv *priv = container_of(ptp, struct gmac_priv, ptp_info);
+	u32 sec, subsec, sec2;
+
+	/* Read the sub-seconds again if they wrapped in between */
+	sec = readl(priv->ioaddr + GMAC_TS_SEC);
+	subsec = readl(priv->ioaddr + GMAC_TS_SUBSEC);
+	sec2 = readl(priv->ioaddr + GMAC_TS_SEC);
+	if (sec2 != sec) {
+		subsec = readl(priv->ioaddr + GMAC_TS_SUBSEC);
+		sec = sec2;
+	}
+
+	*ts = ns_to_timespec(gmac_ptp_to_ns(priv, sec, subsec));
+
+	return 0;
+}
+
+static int gmac_ptp_settime(struct ptp_clock_info *ptp,
+			    const struct timespec *ts)
+{
+	struct gmac_priv *priv = container_of(ptp, struct gmac_priv, ptp_info);
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&priv->ptp_lock, flags);
+	writel(ts->tv_sec, priv->ioaddr + GMAC_TS_SEC_UPD);
+	writel(gmac_ptp_ns_to_subsec(priv, ts->tv_nsec),
+	       priv->ioaddr + GMAC_TS_SUBSEC_UPD);
+	ret = gmac_ptp_cmd(priv->ioaddr, TS_CTL_INIT);
+	spin_unlock_irqrestore(&priv->ptp_lock, flags);
+
+	return ret;
+}
+
+static int gmac_ptp_enable(struct ptp_clock_info *ptp,
+			   struct ptp_clock_request *rq, int on)
+{
+	return -EOPNOTSUPP;
+}
+
+static struct ptp_clock_info gmac_ptp_clock_info = {
+	.owner		= THIS_MODULE,
+	.name		= "sunxi_gmac",
+	.max_adj	= GMAC_PTP_MAX_ADJ,
+	.adjfreq	= gmac_ptp_adjfreq,
+	.adjtime	= gmac_ptp_adjtime,
+	.gettime	= gmac_ptp_gettime,
+	.settime	= gmac_ptp_settime,
+	.enable		= gmac_ptp_enable,
+};
+
+/* Cores without the feature register still may have the unit */
+static int gmac_ptp_present(void __iomem *ioaddr)
+{
+	u32 feat = readl(ioaddr + GDMA_HW_FEATURE);
+
+	if (feat)
+		return !!(feat & HW_FEAT_TSVER1);
+
+	writel(TS_SSINC_MASK, ioaddr + GMAC_TS_SSINC);
+
+	return readl(ioaddr + GMAC_TS_SSINC) == TS_SSINC_MASK;
+}
+
+/**
+ * gmac_ptp_register
+ * @priv: private driver structure
+ * @rate: rate of the clock the system time runs from
+ * Description: start the system time from the wall clock and register
+ * the PTP clock. It has to run again after each reset of the GMAC.
+ */
+int gmac_ptp_register(struct gmac_priv *priv, unsigned long rate)
+{
+	void __iomem *ioaddr = priv->ioaddr;
+	struct timespec now;
+	u32 unit, ssinc;
+	int ret;
+
+	priv->hwts_tx_en = 0;
+	priv->hwts_rx_en = 0;
+
+	if (!gmac_ptp_present(ioaddr))
+		return -EOPNOTSUPP;
+
+	spin_lock_init(&priv->ptp_lock);
+
+	/* Only some cores roll the sub-seconds over at 10^9 */
+	writel(TS_CTL_ENA | TS_CTL_CFUPDT | TS_CTL_CTRLSSR,
+	       ioaddr + GMAC_TS_CTL);
+	priv->ptp_digital = !!(readl(ioaddr + GMAC_TS_CTL) & TS_CTL_CTRLSSR);
+	unit = priv->ptp_digital ? NSEC_PER_SEC : 1U << 31;
+
+	/* Sub-seconds per update, at half the clock rate */
+	ssinc = div_u64(2ULL * unit + rate - 1, rate);
+	if (ssinc > TS_SSINC_MASK) {
+		ret = -ERANGE;
+		goto err;
+	}
+	writel(ssinc, ioaddr + GMAC_TS_SSINC);
+
+	priv->ptp_addend = div64_u64((u64)unit << 32, (u64)ssinc * rate);
+	writel(priv->ptp_addend, ioaddr + GMAC_TS_ADDEND);
+	ret = gmac_ptp_cmd(ioaddr, TS_CTL_ADDREG);
+	if (ret)
+		goto err;
+
+	priv->ptp_info = gmac_ptp_clock_info;
+	getnstimeofday(&now);
+	ret = gmac_ptp_settime(&priv->ptp_info, &now);
+	if (ret)
+		goto err;
+
+	priv->ptp_clock = ptp_clock_register(&priv->ptp_info);
+	if (IS_ERR(priv->ptp_clock)) {
+		ret = PTR_ERR(priv->ptp_clock);
+		priv->ptp_clock = NULL;
+		goto err;
+	}
+
+	pr_info("%s: PTP clock registered, %s rollover\n",
+		priv->ndev->name, priv->ptp_digital ? "digital" : "binary");
+	return 0;
+
+err:
+	writel(0, ioaddr + GMAC_TS_CTL);
+	return ret;
+}
+
+void gmac_ptp_unregister(struct gmac_priv *priv)
+{
+	if (!priv->ptp_clock)
+		return;
+
+	ptp_clock_unregister(priv->ptp_clock);
+	priv->ptp_clock = NULL;
+	priv->hwts_tx_en = 0;
+	priv->hwts_rx_en = 0;
+	writel(0, priv->ioaddr + GMAC_TS_CTL);
+}
+
+/**
+ * gmac_hwtstamp_ioctl
+ * @ndev: net device structure
+ * @ifr: the hwtstamp_config from user space
+ * Description: SIOCSHWTSTAMP. The system time always runs; this only
+ * decides which frames the driver reports the stamps of.
+ */
+int gmac_hwtstamp_ioctl(struct net_device *ndev, struct ifreq *ifr)
+{
+	struct gmac_priv *priv = netdev_priv(ndev);
+	struct hwtstamp_config config;
+	int tx_en, rx_en;
+
+	if (!priv->ptp_clock)
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&config, ifr->ifr_data, sizeof(config)))
+		return -EFAULT;
+
+	/* reserved for future extensions */
+	if (config.flags)
+		return -EINVAL;
+
+	switch (config.tx_type) {
+	case HWTSTAMP_TX_OFF:
+		tx_en = 0;
+		break;
+	case HWTSTAMP_TX_ON:
+		tx_en = 1;
+		break;
+	default:
+		return -ERANGE;
+	}
+
+	switch (config.rx_filter) {
+	case HWTSTAMP_FILTER_NONE:
+		rx_en = 0;
+		break;
+	case HWTSTAMP_FILTER_PTP_V1_L4_EVENT:
+	case HWTSTAMP_FILTER_PTP_V1_L4_SYNC:
+	case HWTSTAMP_FILTER_PTP_V1_L4_DELAY_REQ:
+		config.rx_filter = HWTSTAMP_FILTER_PTP_V1_L4_EVENT;
+		rx_en = 1;
+		break;
+	default:
+		return -ERANGE;
+	}
+
+	priv->hwts_tx_en = tx_en;
+	priv->hwts_rx_en = rx_en;
+
+	return copy_to_user(ifr->ifr_data, &config, sizeof(config)) ?
+		-EFAULT : 0;
+}
@@ -34,13 +34,45 @@
 #define GMAC_GMII_ADDR		(0x10) /* MII Address */
 #define GMAC_GMII_DATA		(0x14) /* MII Data */
 #define GMAC_FLOW_CTRL		(0x18) /* Flow Control */
+#define GMAC_PMT			(0x2c) /* PMT Control and Status */
 #define GMAC_INT_STATUS		(0x38) /* Interrupt status register */
 #define GMAC_INT_MASK		(0x3c) /* interrupt mask register */
 #define GMAC_ADDR_HI(reg)	(0x40 + (reg<<3)) /* upper 16bits of MAC address */
 #define GMAC_ADDR_LO(reg)	(0x44 + (reg<<3)) /* lower 32bits of MAC address */
+#define GMAC_ADDR_AE		0x80000000 /* Address enable, entries 1 and up */
 #define GMAC_RGMII_STATUS	(0xD8) /* S/R-GMII status */
 
+/* IEEE 1588 timestamp unit */
+#define GMAC_TS_CTL			(0x700) /* Timestamp Control */
+#define GMAC_TS_SSINC		(0x704) /* Sub-Second Increment */
+#define GMAC_TS_SEC			(0x708) /* System Time - Seconds */
+#define GMAC_TS_SUBSEC		(0x70C) /* System Time - Sub-Seconds */
+#define GMAC_TS_SEC_UPD		(0x710) /* System Time - Seconds Update */
+#define GMAC_TS_SUBSEC_UPD	(0x714) /* System Time - Sub-Seconds Update */
+#define GMAC_TS_ADDEND		(0x718) /* Timestamp Addend */
+
+/* GMAC_TS_CTL value */
+#define TS_CTL_ENA			0x00000001 /* Timestamp Enable */
+#define TS_CTL_CFUPDT		0x00000002 /* Fine (0: Coarse) Update */
+#define TS_CTL_INIT			0x00000004 /* Initialize the System Time */
+#define TS_CTL_UPDT			0x00000008 /* Update the System Time */
+#define TS_CTL_ADDREG		0x00000020 /* Update the Addend Register */
+#define TS_CTL_CTRLSSR		0x00000200 /* Digital (0: Binary) Rollover */
+
+#define TS_SUBSEC_ADDSUB	0x80000000 /* Subtract the update from the time */
+#define TS_SUBSEC_MASK		0x7FFFFFFF
+#define TS_SSINC_MASK		0x000000FF
+
 #define RGMII_IRQ			0x00000001
+#define PMT_IRQ				0x00000008
+
+/* GMAC_PMT value */
+#define PMT_PD				0x00000001 /* Power Down */
+#define PMT_MPE				0x00000002 /* Magic Packet Enable */
+#define PMT_WFE				0x00000004 /* Wake-Up Frame Enable */
+#define PMT_MPR				0x00000020 /* Magic Packet Received */
+#define PMT_WFR				0x00000040 /* Wake-Up Frame Received */
+#define PMT_GU				0x00000200 /* Global Unicast */
 
 /* GMAC_CONTROL value */
 #define GMAC_CTL_TC			0x01000000 /* Transmit Configuration in RGMII */
@@ -106,10 +138,16 @@
 #define GDMA_OP_MODE		(0x1018) /* DMA Operational Mode */
 #define GDMA_INTR_ENA		(0x101c) /* Interrupt Enable */
 #define GDMA_MISSED_FRAME	(0x1020) /* Missed Frame and Buffer Overflow Counter */
+#define GDMA_RX_WDT		(0x1024) /* Receive Interrupt Watchdog Timer */
 #define GDMA_CUR_TX_DESC	(0x1048) /* Current Host Transmit Descriptor */
 #define GDMA_CUR_RX_DESC	(0x104C) /* Current Host Received Descriptor */
 #define GDMA_CUR_TX_BUF		(0x1050) /* Current Host Transmit Buffer Address */
 #define GDMA_CUR_RX_BUF		(0x1054) /* Current Host Received Buffer Address */
+#define GDMA_HW_FEATURE		(0x1058) /* HW Feature, reads 0 on older cores */
+
+/* GDMA_HW_FEATURE value */
+#define HW_FEAT_TSVER1		0x00001000 /* IEEE 1588-2002 timestamps */
+#define HW_FEAT_TSVER2		0x00002000 /* IEEE 1588-2008 Advanced timestamps */
 
 /*	GDMA_BUS_MODE value */
 #define SOFT_RESET			0x00000001 /* Software reset gdma */
@@ -234,6 +272,9 @@ enum rtc_control {
 
 #define SF_DMA_MODE		1
 
+/* GDMA_RX_WDT value: RI watchdog in units of 256 AHB clock cycles */
+#define GDMA_RX_WDT_MASK	0x000000ff
+
 /* Flow Control defines */
 #define FLOW_OFF	0
 #define FLOW_RX		1
@@ -243,6 +284,8 @@ enum rtc_control {
 #define HASH_TABLE_SIZE 64
 #define PAUSE_TIME 0x200
 #define GMAC_MAX_UNICAST_ADDRESSES	8
+/* Perfect filter entries left once entry 0 holds the device address */
+#define GMAC_PERFECT_FILTERS	(GMAC_MAX_UNICAST_ADDRESSES - 1)
 
 /******************************************************************************
  *
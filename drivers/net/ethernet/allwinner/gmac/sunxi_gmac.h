@@ -26,6 +26,7 @@
 #include <linux/phy.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/ptp_clock_kernel.h>
 #include <plat/sys_config.h>
 
 #include "gmac_reg.h"
@@ -34,6 +35,10 @@
 
 #define GMAC_RESOURCE_NAME	"sunxi_gmac"
 
+/* Descriptor ring sizes are powers of two within these bounds */
+#define GMAC_MIN_RING_SIZE	64
+#define GMAC_MAX_RING_SIZE	1024
+
 enum rx_frame_status { /* IPC status */
 	good_frame = 0,
 	discard_frame = 1,
@@ -41,6 +46,25 @@ enum rx_frame_status { /* IPC status */
 	llc_snap = 4,
 };
 
+#ifdef CONFIG_GMAC_DEBUG_FS
+/* log2 buckets: [0] < 2, [n] in [2^n, 2^(n+1)), the last one open ended */
+#define GMAC_HIST_BUCKETS	16
+
+struct gmac_ring_stats {
+	/* RX ring */
+	unsigned long rx_refill_fail;
+	unsigned long napi_polls;
+	unsigned long napi_budget_hit;
+	unsigned long poll_pkts[GMAC_HIST_BUCKETS];
+	/* Delay between the DMA interrupt and the NAPI poll (usecs) */
+	unsigned long irq_lat[GMAC_HIST_BUCKETS];
+	/* TX ring */
+	unsigned long tx_ring_full;
+	/* Delay between gmac_xmit() and the reclaim of the frame (usecs) */
+	unsigned long tx_lat[GMAC_HIST_BUCKETS];
+};
+#endif
+
 struct gmac_plat_data {
 	int bus_id;
 	int phy_addr;
@@ -70,6 +94,13 @@ struct gmac_mdio_bus_data {
 	int probed_phy_irq;
 };
 
+/* RX buffer backed by one half of a page that stays DMA-mapped */
+struct gmac_rx_page {
+	struct page *page;
+	dma_addr_t dma;
+	unsigned int page_offset;
+};
+
 #if 0
 /* DMA HW capabilities */
 struct dma_features {
@@ -111,18 +142,24 @@ struct gmac_priv {
 	struct sk_buff **tx_skbuff;
 	unsigned int cur_tx;
 	unsigned int dirty_tx;
+	unsigned int posted_tx;
+	unsigned int tx_unkicked;
+	unsigned int tx_wake_thresh;
+	unsigned int tx_wake_need;
+	int tx_err_pending;
 	unsigned int dma_tx_size;
+	/* Per-entry TCP/IP headers for the TSO emulation */
+	char *tso_hdrs;
+	dma_addr_t tso_hdrs_phy;
 
 	dma_desc_t *dma_rx ;
 	dma_addr_t dma_rx_phy;
 	unsigned int cur_rx;
 	unsigned int dirty_rx;
 	unsigned int dma_rx_size;
-	struct sk_buff **rx_skbuff;
-	dma_addr_t *rx_skbuff_dma;
-	struct sk_buff_head rx_recycle;
-
-	unsigned int dma_buf_sz;
+	struct gmac_rx_page *rx_page;
+	/* Frame spanning several descriptors, until its last one */
+	struct sk_buff *rx_skb;
 
 	struct net_device *ndev;
 	struct device *device;
@@ -146,11 +183,32 @@ struct gmac_priv {
 	struct gmac_extra_stats xstats;
 	struct napi_struct napi;
 
+#ifdef CONFIG_GMAC_DEBUG_FS
+	struct dentry *dbgfs_dir;
+	struct gmac_ring_stats rstats;
+	u32 irq_stamp;
+	u32 *tx_stamp;
+#endif
+
+	/* Interrupt coalescing */
+	struct timer_list tx_coal_timer;
+	unsigned int tx_coal_frames;
+	unsigned int tx_coal_usecs;
+	unsigned int tx_count_frames;
+	unsigned int rx_coal_usecs;
+	unsigned int rx_coal_frames;
+	unsigned int rx_coal_cur_frames;
+	int rx_coal_adaptive;
+	unsigned int rx_coal_polls;
+	unsigned int rx_coal_pkts;
+
 	int tx_coe;
 	int rx_coe;
 	int no_csum_insertion;
 	unsigned int flow_ctrl;
 	unsigned int pause;
+	/* WAKE_* events armed for suspend */
+	u32 wolopts;
 
 	int oldlink;
 	int speed;
@@ -159,9 +217,27 @@ struct gmac_priv {
 	struct mii_bus *mii;
 	int mii_irq[PHY_MAX_ADDR];
 
+#ifdef CONFIG_GMAC_PTP
+	struct ptp_clock *ptp_clock;
+	struct ptp_clock_info ptp_info;
+	/* Serializes the updates of the system time and the addend */
+	spinlock_t ptp_lock;
+	u32 ptp_addend;
+	/* Sub-seconds count ns, otherwise units of 2^-31 s */
+	int ptp_digital;
+	int hwts_tx_en;
+	int hwts_rx_en;
+	/* The frame waiting for its TX timestamp, one at a time. The DMA
+	 * writes the stamp over desc2 and desc3 of the last descriptor,
+	 * they are saved here until gmac_tx() reclaims it. */
+	int ts_tx_pending;
+	unsigned int ts_tx_entry;
+	u32 ts_tx_desc2;
+	u32 ts_tx_desc3;
+#endif
+
 	u32 msg_enable;
 	spinlock_t lock;
-	spinlock_t tx_lock;
 	struct gmac_plat_data *plat;
 	//struct dma_features dma_cap;
 };
@@ -173,6 +249,17 @@ int gmac_freeze(struct net_device *ndev);
 int gmac_restore(struct net_device *ndev);
 #endif /* CONFIG_PM */
 
+void gmac_set_rx_coalesce(struct gmac_priv *priv);
+int gmac_set_ring_size(struct net_device *ndev, unsigned int rx_size,
+		       unsigned int tx_size);
+
+#ifdef CONFIG_GMAC_PTP
+int gmac_ptp_register(struct gmac_priv *priv, unsigned long rate);
+void gmac_ptp_unregister(struct gmac_priv *priv);
+int gmac_hwtstamp_ioctl(struct net_device *ndev, struct ifreq *ifr);
+u64 gmac_ptp_desc_ns(struct gmac_priv *priv, dma_desc_t *p);
+#endif
+
 int gmac_mdio_unregister(struct net_device *ndev);
 int gmac_mdio_register(struct net_device *ndev);
 int gmac_dvr_remove(struct net_device *ndev);
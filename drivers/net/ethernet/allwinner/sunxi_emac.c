@@ -38,6 +38,7 @@
 #include <linux/delay.h>
 #include <linux/io.h>
 #include <linux/workqueue.h>
+#include <linux/sched.h>
 
 #include <asm/cacheflush.h>
 #include <asm/irq.h>
@@ -55,7 +56,13 @@
 #define SUNXI_EMAC_PHY	0x100 /* PHY address 0x01 */
 #define CARDNAME	"sunxi_emac"
 #define DRV_VERSION	"1.01"
-#define DMA_CPU_TRRESHOLD 2000
+/* Room for a full frame with VLAN tag and CRC, in whole words */
+#define SUNXI_EMAC_RX_BUF_LEN	1536
+/* Frames per NAPI poll; every one is copied out of the RX FIFO by the CPU */
+#define SUNXI_EMAC_NAPI_WEIGHT	16
+/* SUNXI_EMAC_INT_CTL_REG bits */
+#define SUNXI_EMAC_INT_TX	(0xf << 0)
+#define SUNXI_EMAC_INT_RX	(0x1 << 8)
 /* bit_flags */
 #define SUNXI_EMAC_TX_TIMEOUT_PENDING		0
 
@@ -68,6 +75,12 @@ static unsigned char mac_addr[6] = {0x00};
 static char *mac_addr_param = ":";
 module_param(watchdog, int, 0400);
 MODULE_PARM_DESC(watchdog, "transmit timeout in milliseconds");
+static int rx_dma_thresh = 512;
+module_param(rx_dma_thresh, int, 0644);
+MODULE_PARM_DESC(rx_dma_thresh, "RX frames longer than this are read by DMA");
+static int tx_dma_thresh = 512;
+module_param(tx_dma_thresh, int, 0644);
+MODULE_PARM_DESC(tx_dma_thresh, "TX frames longer than this are written by DMA");
 
 
 /* SUNXI_EMAC register address locking.
@@ -94,6 +107,25 @@ MODULE_PARM_DESC(watchdog, "transmit timeout in milliseconds");
 
 
 /* Structure/enum declaration ------------------------------- */
+
+/* Driver counters for ethtool -S */
+struct sunxi_emac_xstats {
+	unsigned long	rx_fifo_resync;		/* bad header, FIFO flushed */
+	unsigned long	rx_alloc_fail;
+	unsigned long	rx_stack_drop;
+	unsigned long	rx_pio_frames;
+	unsigned long	rx_dma_frames;
+	unsigned long	rx_dma_fail;
+	u64		rx_dma_wait_ns;
+	unsigned long	tx_pio_frames;
+	unsigned long	tx_dma_frames;
+	unsigned long	tx_dma_fail;
+	u64		tx_dma_wait_ns;
+	unsigned long	tx_abort;
+	unsigned long	tx_timeout_resets;
+	unsigned long	lock_contended;
+};
+
 typedef struct sunxi_emac_board_info {
 
 	void __iomem	*emac_vbase;	/* mac I/O base address */
@@ -132,6 +164,28 @@ typedef struct sunxi_emac_board_info {
 
 	struct mii_if_info mii;
 	u32		msg_enable;
+
+	struct napi_struct napi;
+	/* Frame being moved out of the RX FIFO by DMA, and the skb
+	 * waiting to take the next one */
+	struct sk_buff	*rx_dma_skb;
+	struct sk_buff	*rx_spare_skb;
+	int		rx_dma_len;
+	dma_addr_t	rx_dma_buf;
+	int		rx_dma_done;
+
+	/* Frame being moved into a TX FIFO channel by DMA */
+	int		tx_dma_ok;
+	struct sk_buff	*tx_dma_skb;
+	int		tx_dma_len;
+	dma_addr_t	tx_dma_buf;
+	unsigned long	tx_dma_chan;
+
+	/* sched_clock() when the RX/TX DMA was started */
+	unsigned long long rx_dma_stamp;
+	unsigned long long tx_dma_stamp;
+	struct sunxi_emac_xstats xstats;
+
 	user_gpio_set_t *mos_gpio;
 	u32 mos_pin_handler;
 } sunxi_emac_board_info_t;
@@ -145,6 +199,14 @@ typedef struct sunxi_emac_board_info {
 	}						\
 } while (0)
 
+/* Take db->lock, counting the times someone else had it */
+#define sunxi_emac_lock(db, flags) do {				\
+	if (!spin_trylock_irqsave(&(db)->lock, flags)) {	\
+		(db)->xstats.lock_contended++;			\
+		spin_lock_irqsave(&(db)->lock, flags);		\
+	}							\
+} while (0)
+
 static inline sunxi_emac_board_info_t *to_sunxi_emac_board(struct net_device *dev)
 {
 	return netdev_priv(dev);
@@ -152,8 +214,9 @@ static inline sunxi_emac_board_info_t *to_sunxi_emac_board(struct net_device *de
 
 static int  sunxi_emac_phy_read(struct net_device *dev, int phyaddr_unused, int reg);
 static void sunxi_emac_phy_write(struct net_device *dev, int phyaddr_unused, int reg, int value);
-static void sunxi_emac_rx(struct net_device *dev);
 static void read_random_macaddr(unsigned char *mac, struct net_device *ndev);
+static void sunxi_emac_rx_dma_drop(sunxi_emac_board_info_t *db);
+static void sunxi_emac_tx_dma_drop(sunxi_emac_board_info_t *db);
 
 static struct sunxi_dma_params emacrx_dma = {
 	.client.name	= "EMACRX_DMA",
@@ -163,12 +226,24 @@ static struct sunxi_dma_params emacrx_dma = {
 	.dma_addr	= 0x01C0B04C,
 };
 
-static int emacrx_completed_flag = 1;
+static struct sunxi_dma_params emactx_dma = {
+	.client.name	= "EMACTX_DMA",
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	.channel	= DMACH_DEMACT,
+#endif
+	.dma_addr	= 0x01C0B024,
+};
 
 void emacrx_dma_buffdone(struct sunxi_dma_params *dma, void *arg)
 {
 	struct net_device *dev = arg;
-	sunxi_emac_rx(dev);
+	sunxi_emac_board_info_t *db = netdev_priv(dev);
+
+	/* The poll hands the frame up and carries on with the FIFO */
+	db->xstats.rx_dma_wait_ns += sched_clock() - db->rx_dma_stamp;
+	db->rx_dma_done = 1;
+	smp_wmb();
+	napi_schedule(&db->napi);
 }
 
 int emacrx_dma_inblk(dma_addr_t buff_addr, __u32 len)
@@ -219,6 +294,54 @@ int emacrx_dma_inblk(dma_addr_t buff_addr, __u32 len)
 	return 0;
 }
 
+int emactx_dma_outblk(dma_addr_t buff_addr, __u32 len)
+{
+	int ret;
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	struct dma_hw_conf emac_hwconf = {
+		.xfer_type = DMAXFER_D_SWORD_S_SWORD,
+		.hf_irq = SW_DMA_IRQ_FULL,
+		.cmbk = 0x03030303,
+		.dir = SW_DMA_WDEV,
+		.to = emactx_dma.dma_addr,
+		.address_type = DMAADDRT_D_IO_S_LN,
+		.drqdst_type = DRQ_TYPE_EMAC
+	};
+
+	ret = sw_dma_setflags(emactx_dma.channel, SW_DMAF_AUTOSTART);
+	if (ret != 0)
+		return ret;
+#else
+	dma_config_t emac_hwconf = {
+		.xfer_type = {
+			.src_data_width = DATA_WIDTH_32BIT,
+			.src_bst_len	= DATA_BRST_4,
+			.dst_data_width = DATA_WIDTH_32BIT,
+			.dst_bst_len	= DATA_BRST_4
+		},
+		.address_type = {
+			.src_addr_mode  = DDMA_ADDR_LINEAR,
+			.dst_addr_mode  = DDMA_ADDR_IO
+		},
+		.bconti_mode	= false,
+		.src_drq_type   = D_SRC_SRAM,
+		.dst_drq_type   = D_DST_EMAC_TX,
+		.irq_spt	= CHAN_IRQ_FD
+	};
+#endif
+	ret = sunxi_dma_config(&emactx_dma, &emac_hwconf, 0x03030303);
+	if (ret != 0)
+		return ret;
+	ret = sunxi_dma_enqueue(&emactx_dma, buff_addr, len, 0);
+	if (ret != 0)
+		return ret;
+	ret = sunxi_dma_start(&emactx_dma);
+	if (ret != 0)
+		return ret;
+
+	return 0;
+}
+
 /* SUNXI_EMAC network board routine ---------------------------- */
 
 static void
@@ -323,6 +446,71 @@ static u32 sunxi_emac_get_link(struct net_device *dev)
 	return mii_link_ok(&dm->mii);
 }
 
+struct sunxi_emac_stats {
+	char stat_string[ETH_GSTRING_LEN];
+	int sizeof_stat;
+	int stat_offset;
+};
+
+#define SUNXI_EMAC_STAT(m)	\
+	{ #m, FIELD_SIZEOF(struct sunxi_emac_xstats, m),	\
+	offsetof(sunxi_emac_board_info_t, xstats.m)}
+
+static const struct sunxi_emac_stats sunxi_emac_gstrings_stats[] = {
+	SUNXI_EMAC_STAT(rx_fifo_resync),
+	SUNXI_EMAC_STAT(rx_alloc_fail),
+	SUNXI_EMAC_STAT(rx_stack_drop),
+	SUNXI_EMAC_STAT(rx_pio_frames),
+	SUNXI_EMAC_STAT(rx_dma_frames),
+	SUNXI_EMAC_STAT(rx_dma_fail),
+	SUNXI_EMAC_STAT(rx_dma_wait_ns),
+	SUNXI_EMAC_STAT(tx_pio_frames),
+	SUNXI_EMAC_STAT(tx_dma_frames),
+	SUNXI_EMAC_STAT(tx_dma_fail),
+	SUNXI_EMAC_STAT(tx_dma_wait_ns),
+	SUNXI_EMAC_STAT(tx_abort),
+	SUNXI_EMAC_STAT(tx_timeout_resets),
+	SUNXI_EMAC_STAT(lock_contended),
+};
+#define SUNXI_EMAC_STATS_LEN ARRAY_SIZE(sunxi_emac_gstrings_stats)
+
+static void sunxi_emac_get_ethtool_stats(struct net_device *dev,
+		struct ethtool_stats *dummy, u64 *data)
+{
+	sunxi_emac_board_info_t *dm = to_sunxi_emac_board(dev);
+	int i;
+
+	for (i = 0; i < SUNXI_EMAC_STATS_LEN; i++) {
+		char *p = (char *)dm + sunxi_emac_gstrings_stats[i].stat_offset;
+		data[i] = (sunxi_emac_gstrings_stats[i].sizeof_stat ==
+			   sizeof(u64)) ? (*(u64 *)p) : (*(unsigned long *)p);
+	}
+}
+
+static int sunxi_emac_get_sset_count(struct net_device *dev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return SUNXI_EMAC_STATS_LEN;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void sunxi_emac_get_strings(struct net_device *dev, u32 stringset,
+		u8 *data)
+{
+	int i;
+
+	if (stringset != ETH_SS_STATS)
+		return;
+
+	for (i = 0; i < SUNXI_EMAC_STATS_LEN; i++)
+		memcpy(data + i * ETH_GSTRING_LEN,
+		       sunxi_emac_gstrings_stats[i].stat_string,
+		       ETH_GSTRING_LEN);
+}
+
 static const struct ethtool_ops sunxi_emac_ethtool_ops = {
 	.get_drvinfo		= sunxi_emac_get_drvinfo,
 	.get_settings		= sunxi_emac_get_settings,
@@ -331,6 +519,9 @@ static const struct ethtool_ops sunxi_emac_ethtool_ops = {
 	.set_msglevel		= sunxi_emac_set_msglevel,
 	.nway_reset		= sunxi_emac_nway_reset,
 	.get_link		= sunxi_emac_get_link,
+	.get_ethtool_stats	= sunxi_emac_get_ethtool_stats,
+	.get_sset_count		= sunxi_emac_get_sset_count,
+	.get_strings		= sunxi_emac_get_strings,
 };
 
 static void emac_gpio_pin_function(sunxi_emac_board_info_t *db, int cfg0, int pin,
@@ -943,7 +1134,7 @@ sunxi_emac_init_sunxi_emac(struct net_device *dev)
 	/* enable RX/TX0/RX Hlevel interrup */
 	reg_val = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
 	/*reg_val |= (0x1<<0) | (0x01<<8)| (0x1<<17);*/
-	reg_val |= (0xf<<0) | (0x01<<8);
+	reg_val |= SUNXI_EMAC_INT_TX | SUNXI_EMAC_INT_RX;
 	writel(reg_val, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
 
 	/* Init Driver variable */
@@ -971,8 +1162,13 @@ static void sunxi_emac_timeout_work(struct work_struct *work)
 
 	if (netif_msg_timer(db))
 		dev_err(db->dev, "tx time out, resetting emac\n");
+	db->xstats.tx_timeout_resets++;
 
+	napi_disable(&db->napi);
+	sunxi_emac_rx_dma_drop(db);
+	sunxi_emac_tx_dma_drop(db);
 	sunxi_emac_reset(db);
+	napi_enable(&db->napi);
 	sunxi_emac_init_sunxi_emac(db->ndev);
 	/* We can accept TX packets again */
 	db->ndev->trans_start = jiffies;
@@ -980,10 +1176,100 @@ static void sunxi_emac_timeout_work(struct work_struct *work)
 	clear_bit(SUNXI_EMAC_TX_TIMEOUT_PENDING, &db->bit_flags);
 }
 
+/* Switch the TX FIFO between CPU and DMA writes, db->lock held */
+static void sunxi_emac_tx_dma_mode(sunxi_emac_board_info_t *db, int dma)
+{
+	unsigned int reg_val;
+
+	reg_val = readl(db->emac_vbase + SUNXI_EMAC_TX_MODE_REG);
+	if (dma)
+		reg_val |= (0x1<<1);
+	else
+		reg_val &= (~(0x1<<1));
+	writel(reg_val, db->emac_vbase + SUNXI_EMAC_TX_MODE_REG);
+}
+
+/* Send a filled TX FIFO channel, db->lock held */
+static void sunxi_emac_tx_start(struct net_device *dev,
+				sunxi_emac_board_info_t *db,
+				unsigned long channal, int len)
+{
+	/* TX control: First packet immediately send, second packet queue */
+	if (channal == 0) {
+		/* set TX len */
+		writel(len, db->emac_vbase + SUNXI_EMAC_TX_PL0_REG);
+		/* start translate from fifo to phy */
+		writel(readl(db->emac_vbase + SUNXI_EMAC_TX_CTL0_REG) | 1, db->emac_vbase + SUNXI_EMAC_TX_CTL0_REG);
+	} else {
+		/* set TX len */
+		writel(len, db->emac_vbase + SUNXI_EMAC_TX_PL1_REG);
+		/* start translate from fifo to phy */
+		writel(readl(db->emac_vbase + SUNXI_EMAC_TX_CTL1_REG) | 1, db->emac_vbase + SUNXI_EMAC_TX_CTL1_REG);
+	}
+
+	dev->trans_start = jiffies;	/* save the time stamp */
+}
+
+/*
+ *  The TX DMA has filled its channel: send it and let the stack
+ *  refill the other one.
+ */
+void emactx_dma_buffdone(struct sunxi_dma_params *dma, void *arg)
+{
+	struct net_device *dev = arg;
+	sunxi_emac_board_info_t *db = netdev_priv(dev);
+	struct sk_buff *skb;
+	dma_addr_t buf;
+	int len;
+	unsigned long flags;
+
+	sunxi_emac_lock(db, flags);
+	skb = db->tx_dma_skb;
+	buf = db->tx_dma_buf;
+	len = db->tx_dma_len;
+	if (skb) {
+		db->xstats.tx_dma_wait_ns += sched_clock() - db->tx_dma_stamp;
+		db->xstats.tx_dma_frames++;
+		db->tx_dma_skb = NULL;
+		sunxi_emac_tx_dma_mode(db, 0);
+		sunxi_emac_tx_start(dev, db, db->tx_dma_chan, skb->len);
+		if ((db->tx_fifo_stat & 3) != 3)
+			netif_wake_queue(dev);
+	}
+	spin_unlock_irqrestore(&db->lock, flags);
+
+	if (skb) {
+		dma_unmap_single(NULL, buf, len, DMA_TO_DEVICE);
+		dev_kfree_skb_any(skb);
+	}
+}
+
+/* Give up on a frame still owned by the TX DMA */
+static void sunxi_emac_tx_dma_drop(sunxi_emac_board_info_t *db)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	sunxi_emac_lock(db, flags);
+	skb = db->tx_dma_skb;
+	db->tx_dma_skb = NULL;
+	spin_unlock_irqrestore(&db->lock, flags);
+
+	if (!skb)
+		return;
+
+	sunxi_dma_stop(&emactx_dma);
+	dma_unmap_single(NULL, db->tx_dma_buf, db->tx_dma_len, DMA_TO_DEVICE);
+	dev_kfree_skb(skb);
+}
+
 #define PINGPANG_BUF 1
 /*
  *  Hardware start transmission.
  *  Send a packet to media from the upper layer.
+ *  Only this path fills the TX FIFO, so db->lock is held just to claim
+ *  and to kick the channel. Long frames are written by the TX DMA and
+ *  the queue stays stopped until it is done.
  */
 static int
 sunxi_emac_start_xmit(struct sk_buff *skb, struct net_device *dev)
@@ -991,6 +1277,7 @@ sunxi_emac_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	unsigned long channal;
 	unsigned long flags;
 	sunxi_emac_board_info_t *db = netdev_priv(dev);
+	int use_dma;
 
 #if PINGPANG_BUF
 	if ((channal = (db->tx_fifo_stat & 3)) == 3)
@@ -1004,37 +1291,48 @@ sunxi_emac_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	channal = 0;
 #endif
 
-	spin_lock_irqsave(&db->lock, flags);
-
-	writel(channal, db->emac_vbase + SUNXI_EMAC_TX_INS_REG);
-
-	(db->outblk)(db->emac_vbase + SUNXI_EMAC_TX_IO_DATA_REG, skb->data, skb->len);
-	dev->stats.tx_bytes += skb->len;
+	use_dma = db->tx_dma_ok && skb->len > tx_dma_thresh;
 
+	sunxi_emac_lock(db, flags);
 	db->tx_fifo_stat |= 1 << channal;
-	/* TX control: First packet immediately send, second packet queue */
-	if (channal == 0) {
-		/* set TX len */
-		writel(skb->len, db->emac_vbase + SUNXI_EMAC_TX_PL0_REG);
-		/* start translate from fifo to phy */
-		writel(readl(db->emac_vbase + SUNXI_EMAC_TX_CTL0_REG) | 1, db->emac_vbase + SUNXI_EMAC_TX_CTL0_REG);
-
-		dev->trans_start = jiffies;	/* save the time stamp */
-	} else if (channal == 1) {
-		/* set TX len */
-		writel(skb->len, db->emac_vbase + SUNXI_EMAC_TX_PL1_REG);
-		/* start translate from fifo to phy */
-		writel(readl(db->emac_vbase + SUNXI_EMAC_TX_CTL1_REG) | 1, db->emac_vbase + SUNXI_EMAC_TX_CTL1_REG);
-
-		dev->trans_start = jiffies;	/* save the time stamp */
+	if (use_dma) {
+		db->tx_dma_skb = skb;
+		db->tx_dma_chan = channal;
+		sunxi_emac_tx_dma_mode(db, 1);
 	}
-
-	if ((db->tx_fifo_stat & 3) == 3) {
-		/* Second packet */
+	if (use_dma || (db->tx_fifo_stat & 3) == 3)
 		netif_stop_queue(dev);
+	spin_unlock_irqrestore(&db->lock, flags);
+
+	writel(channal, db->emac_vbase + SUNXI_EMAC_TX_INS_REG);
+	dev->stats.tx_bytes += skb->len;
+
+	if (use_dma) {
+		/* The FIFO takes whole words */
+		db->tx_dma_len = ALIGN(skb->len, 4);
+		db->tx_dma_buf = dma_map_single(NULL, skb->data,
+						db->tx_dma_len, DMA_TO_DEVICE);
+		db->tx_dma_stamp = sched_clock();
+		if (emactx_dma_outblk(db->tx_dma_buf, db->tx_dma_len) == 0)
+			return 0;
+
+		printk(KERN_ERR "[emac] emactx_dma_outblk failed, using cpu to fill fifo!\n");
+		db->xstats.tx_dma_fail++;
+		dma_unmap_single(NULL, db->tx_dma_buf, db->tx_dma_len,
+				 DMA_TO_DEVICE);
+		sunxi_emac_lock(db, flags);
+		db->tx_dma_skb = NULL;
+		sunxi_emac_tx_dma_mode(db, 0);
+		spin_unlock_irqrestore(&db->lock, flags);
 	}
 
+	(db->outblk)(db->emac_vbase + SUNXI_EMAC_TX_IO_DATA_REG, skb->data, skb->len);
 
+	sunxi_emac_lock(db, flags);
+	db->xstats.tx_pio_frames++;
+	sunxi_emac_tx_start(dev, db, channal, skb->len);
+	if (use_dma && (db->tx_fifo_stat & 3) != 3)
+		netif_wake_queue(dev);
 	spin_unlock_irqrestore(&db->lock, flags);
 
 	/* free this SKB */
@@ -1070,7 +1368,9 @@ static void sunxi_emac_tx_done(struct net_device *dev, sunxi_emac_board_info_t *
 		dev->trans_start = jiffies;
 	}
 #endif
-	netif_wake_queue(dev);
+	/* The FIFO data port stays busy until the TX DMA is done */
+	if (!db->tx_dma_skb)
+		netif_wake_queue(dev);
 }
 
 struct sunxi_emac_rxhdr {
@@ -1080,179 +1380,306 @@ struct sunxi_emac_rxhdr {
 
 char dbg_dump_buf[0x4000];
 #define DBG_LAST_MAX 6
+
+/* Switch the RX FIFO between CPU and DMA reads */
+static void sunxi_emac_rx_dma_mode(sunxi_emac_board_info_t *db, int dma)
+{
+	unsigned long flags;
+	unsigned int reg_val;
+
+	sunxi_emac_lock(db, flags);
+	reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
+	if (dma)
+		reg_val |= (0x1<<2);
+	else
+		reg_val &= (~(0x1<<2));
+	writel(reg_val, db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
+	spin_unlock_irqrestore(&db->lock, flags);
+}
+
+/* Give up on a frame still owned by the RX DMA, NAPI disabled */
+static void sunxi_emac_rx_dma_drop(sunxi_emac_board_info_t *db)
+{
+	if (!db->rx_dma_skb)
+		return;
+
+	sunxi_dma_stop(&emacrx_dma);
+	dma_unmap_single(NULL, db->rx_dma_buf, db->rx_dma_len,
+			 DMA_FROM_DEVICE);
+	dev_kfree_skb(db->rx_dma_skb);
+	db->rx_dma_skb = NULL;
+}
+
+/* Pass a received frame to the upper layer */
+static void sunxi_emac_rx_pass(struct net_device *dev, struct sk_buff *skb)
+{
+	sunxi_emac_board_info_t *db = netdev_priv(dev);
+
+	skb->protocol = eth_type_trans(skb, dev);
+	if (napi_gro_receive(&db->napi, skb) == GRO_DROP)
+		db->xstats.rx_stack_drop++;
+	dev->stats.rx_packets++;
+}
+
+/* Take back the frame the RX DMA has finished, FIFO back in CPU mode */
+static struct sk_buff *sunxi_emac_rx_dma_complete(sunxi_emac_board_info_t *db)
+{
+	struct sk_buff *skb = db->rx_dma_skb;
+
+	db->rx_dma_skb = NULL;
+	dma_unmap_single(NULL, db->rx_dma_buf, db->rx_dma_len,
+			 DMA_FROM_DEVICE);
+	sunxi_emac_rx_dma_mode(db, 0);
+
+	skb_put(skb, db->rx_dma_len - 4);
+	db->ndev->stats.rx_bytes += db->rx_dma_len;
+	db->xstats.rx_dma_frames++;
+
+	return skb;
+}
+
 /*
- *  Received a packet and pass to upper layer
+ *  Pull the next frame out of the RX FIFO.
+ *  Returns -1 when the FIFO is empty or was flushed, 1 when the frame was
+ *  queued to the RX DMA in the spare skb, 0 otherwise with the frame read
+ *  by the CPU in *pskb, or *pskb NULL when it had to be dropped.
  */
-static void
-sunxi_emac_rx(struct net_device *dev)
+static int
+sunxi_emac_rx_fifo(struct net_device *dev, struct sk_buff **pskb)
 {
 	sunxi_emac_board_info_t *db = netdev_priv(dev);
 	struct sunxi_emac_rxhdr rxhdr;
 	struct sk_buff *skb;
-	static struct sk_buff *skb_last; /*todo: change static variate to member of sunxi_emac_board_info_t. bingge */
 	u8 *rdptr;
 	bool GoodPacket;
 	int RxLen;
-	static int RxLen_last;
-	static dma_addr_t mapped_buf;
 	unsigned int RxStatus;
 	unsigned int reg_val, Rxcount, ret;
+	unsigned long flags;
 
-	/* Check packet ready or not */
-	while (1) {
-		/* race warning: the first packet might arrive with
-		   the interrupts disabled, but the second will fix
-		   it */
-		Rxcount = readl(db->emac_vbase + SUNXI_EMAC_RX_FBC_REG);
-
-		if (netif_msg_rx_status(db))
-			dev_dbg(db->dev, "RXCount: %x\n", Rxcount);
-
-		if ((skb_last != NULL) && (RxLen_last > 0)) {
-			dma_unmap_single(NULL, mapped_buf, RxLen_last,
-					 DMA_FROM_DEVICE);
-			dev->stats.rx_bytes += RxLen_last;
-
-			/* Pass to upper layer */
-			skb_last->protocol = eth_type_trans(skb_last, dev);
-			netif_rx(skb_last);
-			dev->stats.rx_packets++;
-			skb_last = NULL;
-			RxLen_last = 0;
-
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-			reg_val &= (~(0x1<<2));
-			writel(reg_val, db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-		}
+	*pskb = NULL;
 
-		if (!Rxcount) {
-			emacrx_completed_flag = 1;
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
-			reg_val |= (0xf<<0) | (0x01<<8);
-			writel(reg_val, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
+	Rxcount = readl(db->emac_vbase + SUNXI_EMAC_RX_FBC_REG);
 
-			/* had one stuck? */
-			Rxcount = readl(db->emac_vbase + SUNXI_EMAC_RX_FBC_REG);
-			if (!Rxcount)
-				return;
-		}
+	if (netif_msg_rx_status(db))
+		dev_dbg(db->dev, "RXCount: %x\n", Rxcount);
 
-		reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG);
-		if (netif_msg_rx_status(db))
-			dev_dbg(db->dev, "receive header: %x\n", reg_val);
-		if (reg_val != 0x0143414d) {
-			/* disable RX */
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_CTL_REG);
-			writel(reg_val & (~(1<<2)), db->emac_vbase + SUNXI_EMAC_CTL_REG);
+	if (!Rxcount)
+		return -1;
 
-			/* Flush RX FIFO */
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-			writel(reg_val | (1<<3), db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
+	reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG);
+	if (netif_msg_rx_status(db))
+		dev_dbg(db->dev, "receive header: %x\n", reg_val);
+	if (reg_val != 0x0143414d) {
+		sunxi_emac_lock(db, flags);
 
-			while (readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG)&(0x1<<3));
+		/* disable RX */
+		reg_val = readl(db->emac_vbase + SUNXI_EMAC_CTL_REG);
+		writel(reg_val & (~(1<<2)), db->emac_vbase + SUNXI_EMAC_CTL_REG);
 
-			/* enable RX */
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_CTL_REG);
-			writel(reg_val | (1<<2), db->emac_vbase + SUNXI_EMAC_CTL_REG);
-			reg_val = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
-			reg_val |= (0xf<<0) | (0x01<<8);
-			writel(reg_val, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
+		/* Flush RX FIFO */
+		reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
+		writel(reg_val | (1<<3), db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
 
-			emacrx_completed_flag = 1;
+		while (readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG)&(0x1<<3));
 
-			return;
-		}
+		/* enable RX */
+		reg_val = readl(db->emac_vbase + SUNXI_EMAC_CTL_REG);
+		writel(reg_val | (1<<2), db->emac_vbase + SUNXI_EMAC_CTL_REG);
+
+		spin_unlock_irqrestore(&db->lock, flags);
+		db->xstats.rx_fifo_resync++;
+		return -1;
+	}
 
-		/* A packet ready now  & Get status/length */
-		GoodPacket = true;
+	/* A packet ready now  & Get status/length */
+	GoodPacket = true;
 
-		(db->inblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, &rxhdr, sizeof(rxhdr));
+	(db->inblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, &rxhdr, sizeof(rxhdr));
 
-		if (netif_msg_rx_status(db))
-			dev_dbg(db->dev, "rxhdr: %x\n", *((int *)(&rxhdr)));
+	if (netif_msg_rx_status(db))
+		dev_dbg(db->dev, "rxhdr: %x\n", *((int *)(&rxhdr)));
 
-		RxLen = rxhdr.RxLen;
-		RxStatus = rxhdr.RxStatus;
+	RxLen = rxhdr.RxLen;
+	RxStatus = rxhdr.RxStatus;
 
-		if (netif_msg_rx_status(db))
-			dev_dbg(db->dev, "RX: status %02x, length %04x\n",
-					RxStatus, RxLen);
+	if (netif_msg_rx_status(db))
+		dev_dbg(db->dev, "RX: status %02x, length %04x\n",
+				RxStatus, RxLen);
 
-		/* Packet Status check */
-		if (RxLen < 0x40) {
-			GoodPacket = false;
+	/* Packet Status check */
+	if (RxLen < 0x40) {
+		GoodPacket = false;
+		if (netif_msg_rx_err(db))
+			dev_dbg(db->dev, "RX: Bad Packet (runt)\n");
+	}
+
+	/* RxStatus is identical to RSR register. */
+	if (0 & RxStatus & (SUNXI_EMAC_CRCERR | SUNXI_EMAC_LENERR)) {
+		GoodPacket = false;
+		if (RxStatus & SUNXI_EMAC_CRCERR) {
+			if (netif_msg_rx_err(db))
+				dev_dbg(db->dev, "crc error\n");
+			dev->stats.rx_crc_errors++;
+		}
+		if (RxStatus & SUNXI_EMAC_LENERR) {
 			if (netif_msg_rx_err(db))
-				dev_dbg(db->dev, "RX: Bad Packet (runt)\n");
+				dev_dbg(db->dev, "length error\n");
+			dev->stats.rx_length_errors++;
 		}
+	}
+
+	if (!GoodPacket) {
+		/* need to dump the packet's data */
+		(db->dumpblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, RxLen);
+		return 0;
+	}
 
-		/* RxStatus is identical to RSR register. */
-		if (0 & RxStatus & (SUNXI_EMAC_CRCERR | SUNXI_EMAC_LENERR)) {
-			GoodPacket = false;
-			if (RxStatus & SUNXI_EMAC_CRCERR) {
-				if (netif_msg_rx_err(db))
-					dev_dbg(db->dev, "crc error\n");
-				dev->stats.rx_crc_errors++;
-			}
-			if (RxStatus & SUNXI_EMAC_LENERR) {
-				if (netif_msg_rx_err(db))
-					dev_dbg(db->dev, "length error\n");
-				dev->stats.rx_length_errors++;
-			}
+	if (netif_msg_rx_status(db))
+		dev_dbg(db->dev, "RxLen %x\n", RxLen);
+
+	/* Long frames go to the DMA, which fills the spare skb while the
+	 * caller hands the previous frame up */
+	if (RxLen > rx_dma_thresh && RxLen <= SUNXI_EMAC_RX_BUF_LEN &&
+	    db->rx_spare_skb) {
+		skb = db->rx_spare_skb;
+		sunxi_emac_rx_dma_mode(db, 1);
+		db->rx_dma_buf = dma_map_single(NULL, skb->data, RxLen,
+						DMA_FROM_DEVICE);
+		db->rx_dma_len = RxLen;
+		db->rx_dma_done = 0;
+		db->rx_dma_skb = skb;
+		db->rx_dma_stamp = sched_clock();
+		ret = emacrx_dma_inblk(db->rx_dma_buf, RxLen);
+		if (ret == 0) {
+			db->rx_spare_skb = NULL;
+			return 1;
 		}
 
-		/* Move data from SUNXI_EMAC */
-		if (GoodPacket && ((skb = dev_alloc_skb(RxLen + 4)) != NULL)) {
-			skb_reserve(skb, 2);
-			rdptr = (u8 *) skb_put(skb, RxLen - 4);
-
-			/* Read received packet from RX SRAM */
-			if (netif_msg_rx_status(db))
-				dev_dbg(db->dev, "RxLen %x\n", RxLen);
-
-			if (RxLen > DMA_CPU_TRRESHOLD) {
-				reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-				reg_val |= (0x1<<2);
-				writel(reg_val, db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-				mapped_buf = dma_map_single(NULL, rdptr, RxLen,
-							    DMA_FROM_DEVICE);
-				ret = emacrx_dma_inblk(mapped_buf, RxLen);
-				if (ret != 0) {
-					printk(KERN_ERR "[emac] sunxi_emac_inblk_dma failed,ret=%d, using cpu to read fifo!\n", ret);
-					dma_unmap_single(NULL, mapped_buf,
-							 RxLen,
-							 DMA_FROM_DEVICE);
-					reg_val = readl(db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-					reg_val &= (~(0x1<<2));
-					writel(reg_val, db->emac_vbase + SUNXI_EMAC_RX_CTL_REG);
-
-					(db->inblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, rdptr, RxLen);
-
-					dev->stats.rx_bytes += RxLen;
-
-					/* Pass to upper layer */
-					skb->protocol = eth_type_trans(skb, dev);
-					netif_rx(skb);
-					dev->stats.rx_packets++;
-				} else {
-					RxLen_last = RxLen;
-					skb_last = skb;
-					break;
-				}
-			} else {
-				(db->inblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, rdptr, RxLen);
-
-				dev->stats.rx_bytes += RxLen;
-
-				/* Pass to upper layer */
-				skb->protocol = eth_type_trans(skb, dev);
-				netif_rx(skb);
-				dev->stats.rx_packets++;
-			}
-		} else {
-			/* need to dump the packet's data */
-			(db->dumpblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, RxLen);
+		printk(KERN_ERR "[emac] sunxi_emac_inblk_dma failed,ret=%d, using cpu to read fifo!\n", ret);
+		db->xstats.rx_dma_fail++;
+		db->rx_dma_skb = NULL;
+		dma_unmap_single(NULL, db->rx_dma_buf, RxLen,
+				 DMA_FROM_DEVICE);
+		sunxi_emac_rx_dma_mode(db, 0);
+	}
+
+	/* Short frames cost less to copy than to set a DMA up for */
+	skb = dev_alloc_skb(RxLen + 4);
+	if (skb == NULL) {
+		db->xstats.rx_alloc_fail++;
+		(db->dumpblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, RxLen);
+		return 0;
+	}
+	skb_reserve(skb, 2);
+	rdptr = (u8 *) skb_put(skb, RxLen - 4);
+
+	/* Read received packet from RX SRAM */
+	(db->inblk)(db->emac_vbase + SUNXI_EMAC_RX_IO_DATA_REG, rdptr, RxLen);
+	dev->stats.rx_bytes += RxLen;
+	db->xstats.rx_pio_frames++;
+
+	*pskb = skb;
+	return 0;
+}
+
+/*
+ *  Received packets are passed to the upper layer, at most budget of them.
+ *  While a frame is in the RX DMA the FIFO is left alone; once it is done
+ *  the next frame is started first, and then the finished one is passed up.
+ */
+static int
+sunxi_emac_rx(struct net_device *dev, int budget)
+{
+	sunxi_emac_board_info_t *db = netdev_priv(dev);
+	struct sk_buff *done, *skb;
+	int received = 0;
+	int ret;
+
+	while (received < budget) {
+		done = NULL;
+		if (db->rx_dma_skb) {
+			if (!db->rx_dma_done)
+				break;
+			smp_rmb();
+			done = sunxi_emac_rx_dma_complete(db);
 		}
+
+		ret = -1;
+		skb = NULL;
+		if (received + (done != NULL) < budget)
+			ret = sunxi_emac_rx_fifo(dev, &skb);
+
+		if (done) {
+			sunxi_emac_rx_pass(dev, done);
+			received++;
+		}
+
+		if (ret == 0) {
+			/* Dropped frames count against the budget as well */
+			if (skb)
+				sunxi_emac_rx_pass(dev, skb);
+			received++;
+		}
+
+		if (!db->rx_spare_skb)
+			db->rx_spare_skb = netdev_alloc_skb_ip_align(dev,
+						SUNXI_EMAC_RX_BUF_LEN);
+
+		if (ret < 0)
+			break;
+	}
+
+	return received;
+}
+
+static void sunxi_emac_rx_irq(sunxi_emac_board_info_t *db, int enable)
+{
+	unsigned long flags;
+	unsigned int reg_val;
+
+	sunxi_emac_lock(db, flags);
+	reg_val = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
+	if (enable)
+		reg_val |= SUNXI_EMAC_INT_RX;
+	else
+		reg_val &= ~SUNXI_EMAC_INT_RX;
+	writel(reg_val, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
+	spin_unlock_irqrestore(&db->lock, flags);
+}
+
+/*
+ *  NAPI poll, the RX interrupt stays masked until the FIFO is drained
+ */
+static int sunxi_emac_poll(struct napi_struct *napi, int budget)
+{
+	sunxi_emac_board_info_t *db =
+		container_of(napi, sunxi_emac_board_info_t, napi);
+	int work_done;
+
+	work_done = sunxi_emac_rx(db->ndev, budget);
+	if (work_done >= budget)
+		return work_done;
+
+	napi_complete(napi);
+
+	if (db->rx_dma_skb) {
+		/* The DMA completion reschedules us, unless it already
+		 * fired while the poll was still running */
+		if (db->rx_dma_done)
+			napi_reschedule(napi);
+		return work_done;
 	}
+
+	sunxi_emac_rx_irq(db, 1);
+
+	/* had one stuck? A frame that arrived before the unmask does
+	 * not raise the interrupt */
+	if (readl(db->emac_vbase + SUNXI_EMAC_RX_FBC_REG) &&
+	    napi_reschedule(napi))
+		sunxi_emac_rx_irq(db, 0);
+
+	return work_done;
 }
 
 static irqreturn_t sunxi_emac_interrupt(int irq, void *dev_id)
@@ -1261,7 +1688,7 @@ static irqreturn_t sunxi_emac_interrupt(int irq, void *dev_id)
 	sunxi_emac_board_info_t *db = netdev_priv(dev);
 	int int_status;
 	unsigned long flags;
-	unsigned int reg_val;
+	unsigned int int_mask;
 
 #if 0
 	int tmp1, tmp2;
@@ -1274,9 +1701,10 @@ static irqreturn_t sunxi_emac_interrupt(int irq, void *dev_id)
 	/* A real interrupt coming */
 
 	/* holders of db->lock must always block IRQs */
-	spin_lock_irqsave(&db->lock, flags);
+	sunxi_emac_lock(db, flags);
 
 	/* Disable all interrupts */
+	int_mask = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
 	writel(0, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);					/* Disable all interrupt */
 
 	/* Got SUNXI_EMAC interrupt status */
@@ -1293,30 +1721,27 @@ static irqreturn_t sunxi_emac_interrupt(int irq, void *dev_id)
 #endif
 
 	/* Received the coming packet */
-	if ((int_status & 0x100) && (emacrx_completed_flag == 1)) {
-		/* carrier lost */
-		emacrx_completed_flag = 0;
-		sunxi_emac_rx(dev);
+	if ((int_status & SUNXI_EMAC_INT_RX) && napi_schedule_prep(&db->napi)) {
+		int_mask &= ~SUNXI_EMAC_INT_RX;
+		__napi_schedule(&db->napi);
 	}
 
 	/* Transmit Interrupt check */
 	if (int_status & (0x01 | 0x02))
 		sunxi_emac_tx_done(dev, db, int_status);
 
-	if (int_status & (0x04 | 0x08))
+	if (int_status & (0x04 | 0x08)) {
+		db->xstats.tx_abort++;
 		printk(KERN_INFO " ab : %x\n", int_status);
+	}
 
 #if 0
 	if (int_status & (1<<18)) /* carrier lost */
 		printk(KERN_INFO "eth net carrier lost\n");
 #endif
 
-	/* Re-enable interrupt mask */
-	if (emacrx_completed_flag == 1) {
-		reg_val = readl(db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
-		reg_val |= (0xf<<0) | (0x01<<8);
-		writel(reg_val, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
-	}
+	/* Re-enable interrupt mask, RX stays off while NAPI runs */
+	writel(int_mask, db->emac_vbase + SUNXI_EMAC_INT_CTL_REG);
 	spin_unlock_irqrestore(&db->lock, flags);
 
 	return IRQ_HANDLED;
@@ -1348,6 +1773,10 @@ static int sunxi_emac_open(struct net_device *dev)
 	if (request_irq(dev->irq, &sunxi_emac_interrupt, IRQF_SHARED,
 			dev->name, dev))
 		return -EAGAIN;
+	sunxi_irq_spread(dev->irq, SUNXI_IRQ_SLOT_EMAC);
+
+	db->rx_spare_skb = netdev_alloc_skb_ip_align(dev, SUNXI_EMAC_RX_BUF_LEN);
+	napi_enable(&db->napi);
 
 	/* Initialize SUNXI_EMAC board */
 	sunxi_emac_reset(db);
@@ -1373,7 +1802,7 @@ static int sunxi_emac_phy_read(struct net_device *dev, int phyaddr_unused, int r
 
 	mutex_lock(&db->addr_lock);
 
-	spin_lock_irqsave(&db->lock, flags);
+	sunxi_emac_lock(db, flags);
 	/* issue the phy address and reg */
 	writel(SUNXI_EMAC_PHY | reg, db->emac_vbase + SUNXI_EMAC_MAC_MADR_REG);
 	/* pull up the phy io line */
@@ -1391,7 +1820,7 @@ static int sunxi_emac_phy_read(struct net_device *dev, int phyaddr_unused, int r
 	}
 
 	/* push down the phy io line and read data */
-	spin_lock_irqsave(&db->lock, flags);
+	sunxi_emac_lock(db, flags);
 	/* push down the phy io line */
 	writel(0x0, db->emac_vbase + SUNXI_EMAC_MAC_MCMD_REG);
 	/* and write data */
@@ -1415,7 +1844,7 @@ static void sunxi_emac_phy_write(struct net_device *dev,
 
 	mutex_lock(&db->addr_lock);
 
-	spin_lock_irqsave(&db->lock, flags);
+	sunxi_emac_lock(db, flags);
 	/* issue the phy address and reg */
 	writel(SUNXI_EMAC_PHY | reg, db->emac_vbase + SUNXI_EMAC_MAC_MADR_REG);
 	/* pull up the phy io line */
@@ -1432,7 +1861,7 @@ static void sunxi_emac_phy_write(struct net_device *dev,
 		}
 	}
 
-	spin_lock_irqsave(&db->lock, flags);
+	sunxi_emac_lock(db, flags);
 	/* push down the phy io line */
 	writel(0x0, db->emac_vbase + SUNXI_EMAC_MAC_MCMD_REG);
 	/* and write data */
@@ -1482,9 +1911,17 @@ static int sunxi_emac_stop(struct net_device *ndev)
 
 	netif_stop_queue(ndev);
 	netif_carrier_off(ndev);
+	napi_disable(&db->napi);
 
 	/* free interrupt */
+	sunxi_irq_unspread(ndev->irq);
 	free_irq(ndev->irq, ndev);
+	sunxi_emac_rx_dma_drop(db);
+	sunxi_emac_tx_dma_drop(db);
+	if (db->rx_spare_skb) {
+		dev_kfree_skb(db->rx_spare_skb);
+		db->rx_spare_skb = NULL;
+	}
 
 	sunxi_emac_shutdown(ndev);
 
@@ -1538,6 +1975,14 @@ static int __devinit sunxi_emac_probe(struct platform_device *pdev)
 	}
 	sunxi_dma_set_callback(&emacrx_dma, emacrx_dma_buffdone, ndev);
 
+	/* Without its DMA channel TX falls back to the CPU */
+	if (sunxi_dma_request(&emactx_dma, 1) < 0) {
+		printk(KERN_WARNING "no dma for emac tx, using cpu\n");
+	} else {
+		sunxi_dma_set_callback(&emactx_dma, emactx_dma_buffdone, ndev);
+		db->tx_dma_ok = 1;
+	}
+
 	db->debug_level = 0;
 	db->dev = &pdev->dev;
 	db->ndev = ndev;
@@ -1654,6 +2099,7 @@ static int __devinit sunxi_emac_probe(struct platform_device *pdev)
 	ndev->netdev_ops	= &sunxi_emac_netdev_ops;
 	ndev->watchdog_timeo	= msecs_to_jiffies(watchdog);
 	ndev->ethtool_ops	= &sunxi_emac_ethtool_ops;
+	netif_napi_add(ndev, &db->napi, sunxi_emac_poll, SUNXI_EMAC_NAPI_WEIGHT);
 
 	db->msg_enable       = 0xffffffff & (~NETIF_MSG_TX_DONE) & (~NETIF_MSG_INTR) & (~NETIF_MSG_RX_STATUS);
 	db->mii.phy_id_mask  = 0x1f;
@@ -1725,6 +2171,11 @@ static int sunxi_emac_drv_suspend(struct platform_device *dev, pm_message_t stat
 		if (mii_link_ok(&db->mii))
 			netif_carrier_off(ndev);
 		netif_device_detach(ndev);
+		if (netif_running(ndev)) {
+			napi_disable(&db->napi);
+			sunxi_emac_rx_dma_drop(db);
+			sunxi_emac_tx_dma_drop(db);
+		}
 		sunxi_emac_shutdown(ndev);
 		/* endif */
 	}
@@ -1739,6 +2190,8 @@ static int sunxi_emac_drv_resume(struct platform_device *dev)
 	if (ndev) {
 		/* if (netif_running(ndev)) */
 		sunxi_emac_reset(db);
+		if (netif_running(ndev))
+			napi_enable(&db->napi);
 		sunxi_emac_init_sunxi_emac(ndev);
 		netif_device_attach(ndev);
 		if (mii_link_ok(&db->mii))
@@ -1751,11 +2204,14 @@ static int sunxi_emac_drv_resume(struct platform_device *dev)
 static int __devexit sunxi_emac_drv_remove(struct platform_device *pdev)
 {
 	struct net_device *ndev = platform_get_drvdata(pdev);
+	sunxi_emac_board_info_t *db = netdev_priv(ndev);
 
 	platform_set_drvdata(pdev, NULL);
 
 	unregister_netdev(ndev);
-	sunxi_emac_release_board(pdev, (sunxi_emac_board_info_t *) netdev_priv(ndev));
+	if (db->tx_dma_ok)
+		sunxi_dma_release(&emactx_dma);
+	sunxi_emac_release_board(pdev, db);
 	free_netdev(ndev);		/* free device structure */
 
 	dev_dbg(&pdev->dev, "released and freed device\n");
@@ -42,6 +42,8 @@
 
 extern void sunximmc_rescan_card(unsigned id, unsigned insert);
 extern void wifi_pm_power(int on);
+extern void wifi_pm_power_sdio(int on, unsigned int sdio_id);
+extern int wifi_pm_power_wait(unsigned int timeout_ms);
 
 #ifdef CUSTOMER_HW
 #include <mach/gpio.h>
@@ -146,8 +148,8 @@ dhd_customer_gpio_wlan_ctrl(int onoff)
 #endif /* CUSTOMER_HW */
 #if defined(CUSTOMER_HW2)
 			wifi_set_power(0, 0);
-#endif
 			mdelay(100);
+#endif
 			WL_ERROR(("=========== WLAN placed in RESET ========\n"));
 		break;
 
@@ -156,11 +158,14 @@ dhd_customer_gpio_wlan_ctrl(int onoff)
 				__FUNCTION__));
 #ifdef CUSTOMER_HW
 			wifi_pm_power(1);
+			/* the bus is brought up right after this */
+			if (wifi_pm_power_wait(500))
+				WL_ERROR(("%s: wifi power did not settle\n", __FUNCTION__));
 #endif /* CUSTOMER_HW */
 #if defined(CUSTOMER_HW2)
 			wifi_set_power(1, 0);
-#endif
 			mdelay(100);
+#endif
 			WL_ERROR(("=========== WLAN going back to live  ========\n"));
 		break;
 
@@ -168,8 +173,7 @@ dhd_customer_gpio_wlan_ctrl(int onoff)
 			WL_TRACE(("%s: call customer specific GPIO to turn off WL_REG_ON\n",
 				__FUNCTION__));
 #ifdef CUSTOMER_HW
-			wifi_pm_power(0);
-			sunximmc_rescan_card(sdc_id, 0);
+			wifi_pm_power_sdio(0, sdc_id);
 #endif /* CUSTOMER_HW */
 			WL_ERROR(("=========== WLAN placed in POWER OFF ========\n"));
 		break;
@@ -178,11 +182,12 @@ dhd_customer_gpio_wlan_ctrl(int onoff)
 			WL_TRACE(("%s: call customer specific GPIO to turn on WL_REG_ON\n",
 				__FUNCTION__));
 #ifdef CUSTOMER_HW
-			wifi_pm_power(1);
-			sunximmc_rescan_card(sdc_id, 1);
-			/* Lets customer power to get stable */
-#endif /* CUSTOMER_HW */
+			/* the slot is rescanned once the power is stable, the
+			 * caller waits for the card on dhd_chipup_sem */
+			wifi_pm_power_sdio(1, sdc_id);
+#else
 			mdelay(100);
+#endif /* CUSTOMER_HW */
 			WL_ERROR(("=========== WLAN placed in POWER ON ========\n"));
 		break;
 	}
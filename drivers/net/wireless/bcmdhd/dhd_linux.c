@@ -99,6 +99,10 @@ static histo_t vi_d1, vi_d2, vi_d3, vi_d4;
 #if defined(PKT_FILTER_SUPPORT)
 #endif /* PKT_FILTER_SUPPORT */
 
+#ifdef CUSTOMER_HW
+extern void wifi_pm_power_ready(void);
+#endif
+
 #if defined(SOFTAP)
 extern bool ap_cfg_running;
 extern bool ap_fw_loaded;
@@ -4448,6 +4452,9 @@ dhd_module_init(void)
 		if (down_timeout(&dhd_chipup_sem,
 			msecs_to_jiffies(POWERUP_WAIT_MS)) == 0) {
 			dhd_bus_unreg_sdio_notify();
+#ifdef CUSTOMER_HW
+			wifi_pm_power_ready();
+#endif
 			chip_up = 1;
 			break;
 		}
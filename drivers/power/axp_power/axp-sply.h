@@ -359,6 +359,8 @@ struct axp_charger {
 	/*monitor*/
 	struct delayed_work work;
 	unsigned int interval;
+	/* current period, interval or longer while nothing changes */
+	unsigned int poll;
 
 	/*battery info*/
 	struct power_supply_info *battery_info;
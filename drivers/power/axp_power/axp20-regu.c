@@ -16,6 +16,8 @@
 #include <linux/regulator/driver.h>
 #include <linux/regulator/machine.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/delay.h>
 
 #include "axp-regu.h"
 
@@ -28,6 +30,77 @@ static inline struct device *to_axp_dev(struct regulator_dev *rdev)
 	return rdev_get_dev(rdev)->parent->parent;
 }
 
+/*
+ * Shadow of the voltage registers, 0x23 (DCDC2) to 0x29 (LDO3). Nothing
+ * but this driver writes them while the system runs, so a set is one
+ * i2c write and a get none at all. They are read again after resume,
+ * the standby code programs DCDC2 itself.
+ */
+#define AXP20_VOL_FIRST		POWER20_DC2OUT_VOL
+#define AXP20_VOL_REGS		(POWER20_LDO3OUT_VOL - POWER20_DC2OUT_VOL + 1)
+
+static DEFINE_MUTEX(axp20_vol_lock);
+static uint8_t axp20_vol_shadow[AXP20_VOL_REGS];
+static unsigned long axp20_vol_valid;
+
+/* DCDC2 ramps 25mV per 15.625us with voltage ramp control on */
+#define AXP20_DC2_VRC_EN	(1 << 2)
+#define AXP20_DC2_VRC_SLOW	(1 << 0)
+#define AXP20_DC2_STEP_NS	15625
+
+static int __axp20_vol_get(struct device *axp_dev, int reg, uint8_t *val)
+{
+	int i = reg - AXP20_VOL_FIRST;
+	int ret;
+
+	if (!test_bit(i, &axp20_vol_valid)) {
+		ret = axp_read(axp_dev, reg, &axp20_vol_shadow[i]);
+		if (ret)
+			return ret;
+		set_bit(i, &axp20_vol_valid);
+	}
+	*val = axp20_vol_shadow[i];
+	return 0;
+}
+
+static int axp20_vol_read(struct device *axp_dev, int reg, uint8_t *val)
+{
+	int ret;
+
+	mutex_lock(&axp20_vol_lock);
+	ret = __axp20_vol_get(axp_dev, reg, val);
+	mutex_unlock(&axp20_vol_lock);
+	return ret;
+}
+
+/* *old gets the field as it was before, for the ramp time */
+static int axp20_vol_update(struct device *axp_dev, int reg, uint8_t val,
+			    uint8_t mask, uint8_t *old)
+{
+	int i = reg - AXP20_VOL_FIRST;
+	uint8_t reg_val;
+	int ret;
+
+	mutex_lock(&axp20_vol_lock);
+	ret = __axp20_vol_get(axp_dev, reg, &reg_val);
+	if (ret)
+		goto out;
+
+	if (old)
+		*old = reg_val & mask;
+	if ((reg_val & mask) != val) {
+		reg_val = (reg_val & ~mask) | val;
+		ret = axp_write(axp_dev, reg, reg_val);
+		if (ret)
+			clear_bit(i, &axp20_vol_valid);
+		else
+			axp20_vol_shadow[i] = reg_val;
+	}
+out:
+	mutex_unlock(&axp20_vol_lock);
+	return ret;
+}
+
 static inline int check_range(struct axp_regulator_info *info,
 				int min_uV, int max_uV)
 {
@@ -45,7 +118,8 @@ static int axp_set_voltage(struct regulator_dev *rdev, int min_uV, int max_uV,
 {
 	struct axp_regulator_info *info = rdev_get_drvdata(rdev);
 	struct device *axp_dev = to_axp_dev(rdev);
-	uint8_t val, mask;
+	uint8_t val, mask, old;
+	int ret;
 
 	if (rdev_get_id(rdev) == AXP20_ID_BUCK3) {
 		pr_err("somebody is trying to set dcdc3 range to (%d, %d) uV\n",
@@ -64,7 +138,23 @@ static int axp_set_voltage(struct regulator_dev *rdev, int min_uV, int max_uV,
 	val <<= info->vol_shift;
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
 
-	return axp_update(axp_dev, info->vol_reg, val, mask);
+	ret = axp20_vol_update(axp_dev, info->vol_reg, val, mask, &old);
+	if (ret)
+		return ret;
+
+	/*
+	 * DCDC2 ramps to the new value by itself; when it goes up the
+	 * caller mustn't go faster before it got there.
+	 */
+	if (rdev_get_id(rdev) == AXP20_ID_BUCK2 && val > old) {
+		unsigned int us = DIV_ROUND_UP((val - old) * AXP20_DC2_STEP_NS,
+					       1000);
+
+		udelay(us);
+		pr_debug("axp20: dcdc2 %d uV, settled in %u us\n",
+			 info->min_uV + info->step_uV * val, us);
+	}
+	return 0;
 }
 
 static int axp_get_voltage(struct regulator_dev *rdev)
@@ -74,7 +164,7 @@ static int axp_get_voltage(struct regulator_dev *rdev)
 	uint8_t val, mask;
 	int ret;
 
-	ret = axp_read(axp_dev, info->vol_reg, &val);
+	ret = axp20_vol_read(axp_dev, info->vol_reg, &val);
 	if (ret)
 		return ret;
   
@@ -153,7 +243,7 @@ static int axp_set_ldo4_voltage(struct regulator_dev *rdev, int min_uV, int max_
 	
 	val <<= info->vol_shift;
 	mask = ((1 << info->vol_nbits) - 1)  << info->vol_shift;
-	return axp_update(axp_dev, info->vol_reg, val, mask);
+	return axp20_vol_update(axp_dev, info->vol_reg, val, mask, NULL);
 }
 
 static int axp_get_ldo4_voltage(struct regulator_dev *rdev)
@@ -163,7 +253,7 @@ static int axp_get_ldo4_voltage(struct regulator_dev *rdev)
 	uint8_t val, mask;
 	int ret;
 
-	ret = axp_read(axp_dev, info->vol_reg, &val);
+	ret = axp20_vol_read(axp_dev, info->vol_reg, &val);
 	if (ret)
 		return ret;
   
@@ -454,6 +544,12 @@ static int __devinit axp_regulator_probe(struct platform_device *pdev)
 		return PTR_ERR(rdev);
 	}
 	platform_set_drvdata(pdev, rdev);
+
+	/* let the pmic step DCDC2, fast slope */
+	if (ri->desc.id == AXP20_ID_BUCK2)
+		axp_update(to_axp_dev(rdev), POWER20_LDO3_DC2_DVM,
+			   AXP20_DC2_VRC_EN,
+			   AXP20_DC2_VRC_EN | AXP20_DC2_VRC_SLOW);
 	
 	if(ri->desc.id == AXP20_ID_BUCK2 ||ri->desc.id == AXP20_ID_BUCK3){
 		ret = axp_regu_create_attrs(pdev);
@@ -473,10 +569,27 @@ static int __devexit axp_regulator_remove(struct platform_device *pdev)
 	return 0;
 }
 
+#ifdef CONFIG_PM
+static int axp_regulator_resume(struct device *dev)
+{
+	mutex_lock(&axp20_vol_lock);
+	axp20_vol_valid = 0;
+	mutex_unlock(&axp20_vol_lock);
+	return 0;
+}
+
+static const struct dev_pm_ops axp_regulator_pm_ops = {
+	.resume	= axp_regulator_resume,
+};
+#endif
+
 static struct platform_driver axp_regulator_driver = {
 	.driver	= {
 		.name	= "axp20-regulator",
 		.owner	= THIS_MODULE,
+#ifdef CONFIG_PM
+		.pm	= &axp_regulator_pm_ops,
+#endif
 	},
 	.probe		= axp_regulator_probe,
 	.remove		= axp_regulator_remove,
@@ -51,6 +51,18 @@ static int pmu_earlysuspend_chgcur = 0;
 struct axp_adc_res adc;
 static int count_rdc = 0;
 static int count_dis = 0;
+
+/*
+ * The monitor samples every 10s while the gauge is moving. Without a
+ * battery, or with one that is full on external power, the period
+ * doubles on each run up to poll_max; plug, unplug and charger irqs go
+ * back to 10s.
+ */
+#define AXP20_POLL_MS	(10 * 1000)
+static unsigned int poll_max = 60;
+module_param(poll_max, uint, 0644);
+MODULE_PARM_DESC(poll_max, "longest monitor period when nothing changes, s");
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static struct early_suspend axp_early_suspend;
 int early_suspend_flag = 0;
@@ -536,6 +548,13 @@ static int axp_battery_event(struct notifier_block *nb, unsigned long event,
     	axp_clr_bits(charger->master,0x32,0x38);
     }
 
+    if(event & (AXP20_IRQ_BATIN|AXP20_IRQ_BATRE|AXP20_IRQ_ACIN|AXP20_IRQ_ACRE
+               |AXP20_IRQ_USBIN|AXP20_IRQ_USBRE|AXP20_IRQ_CHAST|AXP20_IRQ_CHAOV)) {
+        charger->poll = charger->interval;
+        cancel_delayed_work(&charger->work);
+        schedule_delayed_work(&charger->work, charger->poll);
+    }
+
     if(event & AXP20_IRQ_PEKLO) {
     	axp_presslong(charger);
     }
@@ -1138,6 +1157,7 @@ static void axp_charging_monitor(struct work_struct *work)
     int Cur_CoulombCounter;
     int cap_index_p,var;
 	int gpio_adp_val,ret;
+    int changed;
 
     charger = container_of(work, struct axp_charger, work.work);
 
@@ -1418,7 +1438,8 @@ static void axp_charging_monitor(struct work_struct *work)
 		DBG_PSY_MSG("pmu_shutdown_chgcur               = %d\n",pmu_shutdown_chgcur);
 
     /* if battery volume changed, inform uevent */
-    if(charger->rest_vol - pre_rest_vol){
+    changed = charger->rest_vol != pre_rest_vol;
+    if(changed){
         DBG_PSY_MSG("battery vol change: %d->%d \n", pre_rest_vol, charger->rest_vol);
         pre_rest_vol = charger->rest_vol;
         axp_write(charger->master,AXP20_DATA_BUFFER1,charger->rest_vol | 0x80);
@@ -1429,7 +1450,14 @@ static void axp_charging_monitor(struct work_struct *work)
     }
 
     /* reschedule for the next time */
-    schedule_delayed_work(&charger->work, charger->interval);
+    if(charger->bat_det == 0 ||
+       (charger->rest_vol == 100 && !charger->is_on && charger->ext_valid && !changed))
+        charger->poll = min_t(unsigned int, charger->poll * 2,
+                              max_t(unsigned int, msecs_to_jiffies(poll_max * 1000),
+                                    charger->interval));
+    else
+        charger->poll = charger->interval;
+    schedule_delayed_work(&charger->work, charger->poll);
 }
 
 static int axp_battery_probe(struct platform_device *pdev)
@@ -1753,9 +1781,10 @@ static int axp_battery_probe(struct platform_device *pdev)
   }
   Total_Cap = charger->rest_vol * AXP20_VOL_MAX;
 
-  charger->interval = msecs_to_jiffies(10 * 1000);
+  charger->interval = msecs_to_jiffies(AXP20_POLL_MS);
+  charger->poll = charger->interval;
   INIT_DELAYED_WORK(&charger->work, axp_charging_monitor);
-  schedule_delayed_work(&charger->work, charger->interval);
+  schedule_delayed_work(&charger->work, charger->poll);
 
   var = script_parser_fetch("pmu_para", "pmu_used2", &pmu_used2, sizeof(int));
   if (var)
@@ -1992,7 +2021,8 @@ static int axp20_resume(struct platform_device *dev)
 
 	charger->disvbat = 0;
 	charger->disibat = 0;
-    schedule_delayed_work(&charger->work, charger->interval);
+    charger->poll = charger->interval;
+    schedule_delayed_work(&charger->work, charger->poll);
 
     return 0;
 }
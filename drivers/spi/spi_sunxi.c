@@ -16,7 +16,6 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/spinlock.h>
-#include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/delay.h>
 #include <linux/errno.h>
@@ -24,6 +23,7 @@
 #include <linux/clk.h>
 #include <linux/spi/spi.h>
 #include <linux/platform_device.h>
+#include <linux/dma-mapping.h>
 #include <mach/gpio.h>
 
 #include <linux/spi/spi.h>
@@ -35,7 +35,6 @@
 #include <mach/irqs.h>
 #include <plat/sys_config.h>
 #include <mach/spi.h>
-#include <asm/cacheflush.h>
 
 #define SUNXI_SPI_DEBUG
 
@@ -112,10 +111,6 @@ struct sunxi_spi {
 
 	int result; /* 0: succeed -1:fail */
 
-	struct workqueue_struct *workqueue;
-	struct work_struct work;
-
-	struct list_head queue; /* spi messages */
 	spinlock_t lock;
 
 	struct completion done;  /* wakup another spi transfer */
@@ -287,7 +282,8 @@ void aw_spi_set_clk(u32 spi_clk, u32 ahb_clk, void *base_addr)
 {
     u32 reg_val = 0;
     u32 N = 0;
-    u32 div_clk = (ahb_clk>>1)/spi_clk;
+    /* round the divider up, the device's max speed must not be exceeded */
+    u32 div_clk = DIV_ROUND_UP(ahb_clk>>1, spi_clk);
 
     //spi_msg("set spi clock %d, mclk %d\n", spi_clk, ahb_clk);
     reg_val = readl(base_addr + SPI_CLK_RATE_REG);
@@ -305,16 +301,8 @@ void aw_spi_set_clk(u32 spi_clk, u32 ahb_clk, void *base_addr)
     }
     else /* CDR1 */
     {
-        //search 2^N
-        while(1)
-        {
-            if(div_clk == 1)
-            {
-                break;
-            }
-            div_clk >>= 1;//divide by 2
-            N++;
-        };
+        //search the smallest 2^N not below div_clk
+        N = fls(div_clk - 1);
         reg_val &= ~(SPI_CLKCTL_CDR1|SPI_CLKCTL_DRS);
         reg_val |= (N<<8);
         //spi_msg("CDR1 - n = %d \n", N);
@@ -506,18 +494,18 @@ void aw_spi_set_sample_delay(u32 on_off, void *base_addr)
 {
     u32 reg_val = readl(base_addr+SPI_CTL_REG);
     reg_val &= ~SPI_CTL_MASTER_SDC;
-    reg_val |= on_off;
+    if (on_off)
+        reg_val |= SPI_CTL_MASTER_SDC;
     writel(reg_val, base_addr + SPI_CTL_REG);
 }
 
 
 static int spi_sunxi_get_cfg_csbitmap(int bus_num);
+static int spi_sunxi_get_cfg_rt(int bus_num);
 
-/* flush d-cache */
-static void spi_sunxi_cleanflush_dcache_region(void *addr, __u32 len)
-{
-	__cpuc_flush_dcache_area(addr, len + (1 << 5) * 2 - 2);
-}
+static unsigned int sample_delay_hz = SPI_SAMPLE_DELAY_FREQUENCY;
+module_param(sample_delay_hz, uint, 0644);
+MODULE_PARM_DESC(sample_delay_hz, "SCLK above which the master samples with a delay");
 
 
 /* ------------------------------- dma operation start----------------------------- */
@@ -679,6 +667,8 @@ static int spi_sunxi_config_dma(struct sunxi_spi *aw_spi, enum sw_dmadir dma_dir
 	    spi_wrn("[spi-%d]: unknow dma direction = %d \n", bus_num, dma_dir);
 	    return -1;
 	}
+	/* the buffdone callback drops the drq of this direction */
+	aw_spi->dma_dir = dma_dir;
     #else
     //write
     if (dma_dir == SW_DMA_WDEV) {
@@ -717,13 +707,13 @@ static int spi_sunxi_config_dma(struct sunxi_spi *aw_spi, enum sw_dmadir dma_dir
     ret += sw_dma_ctrl((dma_dir == SW_DMA_WDEV) ? aw_spi->dma_tx_id : aw_spi->dma_rx_id, SW_DMAOP_FLUSH);
 	#endif
 
-    /* 1. flush d-cache */
-    spi_sunxi_cleanflush_dcache_region((void *)buf, len);
+    /*
+     * enqueue dma transfer, the buffer is already mapped for the device.
+     * --FIXME--: buf: virtual address, not physical address.
+     */
      #if defined CONFIG_SUN4I_SPI_NDMA || defined CONFIG_SUN5I_SPI_NDMA
-    /* 2. enqueue dma transfer, --FIXME--: buf: virtual address, not physical address. */
     ret += sw_dma_enqueue(aw_spi->dma_id, (void *)aw_spi, (dma_addr_t)buf, len);
 	#else
-    /* 2. enqueue dma transfer, --FIXME--: buf: virtual address, not physical address. */
     ret += sw_dma_enqueue((dma_dir == SW_DMA_WDEV) ? aw_spi->dma_tx_id : aw_spi->dma_rx_id, (void *)aw_spi, (dma_addr_t)buf, len);
 	#endif
     return ret;
@@ -740,8 +730,11 @@ static int spi_sunxi_start_dma(struct sunxi_spi *aw_spi, unsigned int dma_id)
     return ret;
 }
 
-/* request dma channel and set callback function */
-static int spi_sunxi_prepare_dma(struct sunxi_spi *aw_spi, enum sw_dmadir dma_dir)
+/*
+ * request the dma channels and set the callback functions,
+ * done once at probe, the transfers only configure and enqueue.
+ */
+static int spi_sunxi_request_dma(struct sunxi_spi *aw_spi)
 {
     int ret = 0;
     int bus_num   = aw_spi->master->bus_num;
@@ -755,50 +748,54 @@ static int spi_sunxi_prepare_dma(struct sunxi_spi *aw_spi, enum sw_dmadir dma_di
     /* make sure the queue safe */
 	ret += sw_dma_setflags(aw_spi->dma_id, 0); // set flag ??? dma run status, mainly usd
 	#else
-	if (dma_dir == SW_DMA_WDEV) {
-	    aw_spi->dma_tx_hdle = sw_dma_request(aw_spi->dma_tx_id, &spi_dma_client[bus_num], NULL);
-		if(aw_spi->dma_tx_hdle < 0) {
-		    spi_wrn("[spi-%d]: request dma tx failed!\n", bus_num);
-		    return aw_spi->dma_tx_hdle;
-		}
-		ret = sw_dma_set_buffdone_fn(aw_spi->dma_tx_hdle, spi_sunxi_dma_tx_cb);
-	    /* make sure the queue safe */
-		ret += sw_dma_setflags(aw_spi->dma_tx_id, 0); // set flag ??? dma run status, mainly usd
-    }
-	else if (dma_dir == SW_DMA_RDEV) {
-	    aw_spi->dma_rx_hdle = sw_dma_request(aw_spi->dma_rx_id, &spi_dma_client[bus_num], NULL);
-		if(aw_spi->dma_rx_hdle < 0) {
-		    spi_wrn("[spi-%d]: request dma rx failed!\n", bus_num);
-		    return aw_spi->dma_rx_hdle;
-		}
-		ret = sw_dma_set_buffdone_fn(aw_spi->dma_rx_hdle, spi_sunxi_dma_rx_cb);
-	    /* make sure the queue safe */
-		ret += sw_dma_setflags(aw_spi->dma_rx_id, 0); // set flag ??? dma run status, mainly usd
+    aw_spi->dma_tx_hdle = sw_dma_request(aw_spi->dma_tx_id, &spi_dma_client[bus_num], NULL);
+	if(aw_spi->dma_tx_hdle < 0) {
+	    spi_wrn("[spi-%d]: request dma tx failed!\n", bus_num);
+	    return aw_spi->dma_tx_hdle;
 	}
-	else {
-		spi_wrn("[spi-%d]: unknow dma direction = %d\n", bus_num, dma_dir);
-	    return -1;
+	ret = sw_dma_set_buffdone_fn(aw_spi->dma_tx_hdle, spi_sunxi_dma_tx_cb);
+    /* make sure the queue safe */
+	ret += sw_dma_setflags(aw_spi->dma_tx_id, 0); // set flag ??? dma run status, mainly usd
+
+    aw_spi->dma_rx_hdle = sw_dma_request(aw_spi->dma_rx_id, &spi_dma_client[bus_num], NULL);
+	if(aw_spi->dma_rx_hdle < 0) {
+	    spi_wrn("[spi-%d]: request dma rx failed!\n", bus_num);
+	    sw_dma_free(aw_spi->dma_tx_id, &spi_dma_client[bus_num]);
+	    aw_spi->dma_tx_hdle = -1;
+	    return aw_spi->dma_rx_hdle;
 	}
+	ret += sw_dma_set_buffdone_fn(aw_spi->dma_rx_hdle, spi_sunxi_dma_rx_cb);
+	ret += sw_dma_setflags(aw_spi->dma_rx_id, 0);
 	#endif
     //spi_msg("[spi-%d] request dma handle = %d, dmaid %d\n", bus_num, aw_spi->dma_hdle, aw_spi->dma_id);
     return ret;
 }
 
-/* release dma channel, and set queue status to idle. */
-static int spi_sunxi_release_dma(struct sunxi_spi *aw_spi)
+/* stop the channels after a transfer, and set queue status to idle. */
+static int spi_sunxi_stop_dma(struct sunxi_spi *aw_spi)
 {
     int ret = 0;
     #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
-    ret  = sw_dma_ctrl(aw_spi->dma_id, SW_DMAOP_STOP); /* first stop */
+    ret  = sw_dma_ctrl(aw_spi->dma_id, SW_DMAOP_STOP);
     ret += sw_dma_setflags(aw_spi->dma_id, 0);
+	#else
+    ret  = sw_dma_ctrl(aw_spi->dma_tx_id, SW_DMAOP_STOP);
+    ret += sw_dma_ctrl(aw_spi->dma_rx_id, SW_DMAOP_STOP);
+    ret += sw_dma_setflags(aw_spi->dma_tx_id, 0);
+    ret += sw_dma_setflags(aw_spi->dma_rx_id, 0);
+	#endif
+    return ret;
+}
+
+/* release dma channel, at remove. */
+static int spi_sunxi_release_dma(struct sunxi_spi *aw_spi)
+{
+    int ret = spi_sunxi_stop_dma(aw_spi); /* first stop */
+    #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
     ret += sw_dma_free(aw_spi->dma_id, &spi_dma_client[aw_spi->master->bus_num]);
     //spi_msg("[spi-%d] release dma,ret = %d \n", aw_spi->master->bus_num, ret);
     aw_spi->dma_hdle = -1;
 	#else
-    ret  = sw_dma_ctrl(aw_spi->dma_tx_id, SW_DMAOP_STOP); /* first stop */
-    ret += sw_dma_ctrl(aw_spi->dma_rx_id, SW_DMAOP_STOP); /* first stop */
-    ret += sw_dma_setflags(aw_spi->dma_tx_id, 0);
-    ret += sw_dma_setflags(aw_spi->dma_rx_id, 0);
     ret += sw_dma_free(aw_spi->dma_tx_id, &spi_dma_client[aw_spi->master->bus_num]);
     ret += sw_dma_free(aw_spi->dma_rx_id, &spi_dma_client[aw_spi->master->bus_num]);
     //spi_msg("[spi-%d] release dma,ret = %d \n", aw_spi->master->bus_num, ret);
@@ -888,7 +885,14 @@ static int spi_sunxi_xfer_setup(struct spi_device *spi, struct spi_transfer *t)
    	if(config->max_speed_hz > SPI_MAX_FREQUENCY) {
 	    return -EINVAL;
 	}
+    /* the module clock starts at 100MHz, raise it for a faster device */
+    if(config->max_speed_hz > clk_get_rate(aw_spi->mclk) / 2) {
+        if(clk_set_rate(aw_spi->mclk, config->max_speed_hz * 2))
+            spi_wrn("[spi-%d]: can't raise mclk for %u Hz\n", spi->master->bus_num, config->max_speed_hz);
+    }
     aw_spi_set_clk(config->max_speed_hz, clk_get_rate(aw_spi->mclk), base_addr);
+    /* the data lags the clock at high speed, sample it late */
+    aw_spi_set_sample_delay(config->max_speed_hz > sample_delay_hz, base_addr);
     /*
      *  master : set POL,PHA,SSOPL,LMTF,DDB,DHB; default: SSCTL=0,SMC=1,TBW=0.
      *  set bit width-default: 8 bits
@@ -903,29 +907,71 @@ static int spi_sunxi_xfer_setup(struct spi_device *spi, struct spi_transfer *t)
 
 
 /*
- * > 64 : cpu ;  =< 64 : dma
+ * bursts that fit the fifos go by the cpu, polling TC here is cheaper
+ * than taking the irq and a wakeup for a few bytes.
+ */
+static int spi_sunxi_xfer_pio(struct sunxi_spi *aw_spi, const unsigned char *tx_buf, unsigned tx_len,
+                                unsigned char *rx_buf, unsigned rx_len)
+{
+	void __iomem* base_addr = aw_spi->base_addr;
+	unsigned int poll_time = 0xfffff;
+	unsigned int status;
+
+	for(; tx_len > 0; --tx_len) {
+	    writeb(*tx_buf++, base_addr + SPI_TXDATA_REG);
+	}
+    aw_spi_start_xfer(base_addr);
+	while(rx_len && (--poll_time > 0)) {
+		/* rxFIFO counter */
+	    if(aw_spi_query_rxfifo(base_addr)){
+	        *rx_buf++ =  readb(base_addr + SPI_RXDATA_REG);//fetch data
+	        --rx_len;
+	        poll_time = 0xffff;
+	    }
+	}
+	if(rx_len) {
+	    spi_wrn("cpu rx data time out!\n");
+	    return -ETIMEDOUT;
+	}
+
+	/* the burst counter runs out after the last byte left the txFIFO */
+	poll_time = 0xfffff;
+	do {
+	    status = aw_spi_qry_irq_pending(base_addr);
+	} while(!(status & (SPI_STAT_TC|SPI_STAT_ERR)) && (--poll_time > 0));
+	aw_spi_clr_irq_pending(status, base_addr);
+
+	if(status & SPI_STAT_ERR) {
+	    aw_spi_restore_state(1, base_addr);
+	    spi_wrn("master mode error: txFIFO overflow/rxFIFO underrun or overflow\n");
+	    return -EIO;
+	}
+	if(!(status & SPI_STAT_TC)) {
+	    spi_wrn("cpu tx data time out!\n");
+	    return -ETIMEDOUT;
+	}
+	return 0;
+}
+
+/*
+ * one exchange of bc bursts, the first tx_len of them sent from tx_buf and
+ * rx_len received into rx_buf. a full duplex transfer has tx and rx over
+ * the same bursts; for a tx-then-rx pair the rx bursts follow the tx ones
+ * and DHB drops what comes in while the tx part goes out.
+ * =< 64 : cpu ;  > 64 : dma
  * wait for done completion in this function, wakup in the irq hanlder
  */
-static int spi_sunxi_xfer(struct spi_device *spi, struct spi_transfer *t)
+static int spi_sunxi_xfer_burst(struct spi_device *spi, const unsigned char *tx_buf, unsigned tx_len,
+                                unsigned char *rx_buf, unsigned rx_len, unsigned bc, int is_dma_mapped)
 {
 	struct sunxi_spi *aw_spi = spi_master_get_devdata(spi->master);
+	struct device *dev = &aw_spi->pdev->dev;
 	void __iomem* base_addr = aw_spi->base_addr;
-	unsigned long flags = 0;
-	unsigned tx_len = 0;	/* number of bytes receieved */
-	unsigned rx_len = 0;	/* number of bytes sent */
-	unsigned char *rx_buf = (unsigned char *)t->rx_buf;
-	unsigned char *tx_buf = (unsigned char *)t->tx_buf;
+	int tx_dma = tx_len > BULK_DATA_BOUNDARY;
+	int rx_dma = rx_len > BULK_DATA_BOUNDARY;
+	dma_addr_t tx_map = 0, rx_map = 0;
 	int ret = 0;
 
-    //spi_msg("Begin transfer, txbuf %p, rxbuf %p, len %d\n", t->tx_buf, t->rx_buf, t->len);
-	if (!t->tx_buf && !t->rx_buf && t->len)
-		return -EINVAL;
-	if (t->tx_buf)
-		tx_len = t->len;
-	if (t->rx_buf)
-		rx_len = t->len;
-    //hex_dump("spi_regs:", base_addr, 0x60, 2);
-
     /* write 1 to clear 0 */
     aw_spi_clr_irq_pending(SPI_STAT_MASK, base_addr);
     /* disable all DRQ */
@@ -934,7 +980,33 @@ static int spi_sunxi_xfer(struct spi_device *spi, struct spi_transfer *t)
     /* reset tx/rx fifo */
     aw_spi_reset_fifo(base_addr);
 
-    aw_spi_set_bc_wtc(t->len, tx_len, base_addr);
+    aw_spi_set_bc_wtc(bc, tx_len, base_addr);
+
+	if (!tx_dma && !rx_dma)
+		return spi_sunxi_xfer_pio(aw_spi, tx_buf, tx_len, rx_buf, rx_len);
+
+    #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
+	if (tx_dma && rx_dma) { /* dma full duplex not possible in normal dma mode */
+	    spi_wrn("Full duplex not supported for normal dma!\n");
+		return -EINVAL;
+	}
+    #endif
+
+	/* the caller may have mapped the buffers already, see spi_message.is_dma_mapped */
+	if (!is_dma_mapped) {
+		if (tx_dma) {
+			tx_map = dma_map_single(dev, (void *)tx_buf, tx_len, DMA_TO_DEVICE);
+			if (dma_mapping_error(dev, tx_map))
+				return -ENOMEM;
+		}
+		if (rx_dma) {
+			rx_map = dma_map_single(dev, rx_buf, rx_len, DMA_FROM_DEVICE);
+			if (dma_mapping_error(dev, rx_map)) {
+				ret = -ENOMEM;
+				goto unmap_tx;
+			}
+		}
+	}
 
     /*
      * 1. Tx/Rx error irq,process in IRQ;
@@ -942,90 +1014,41 @@ static int spi_sunxi_xfer(struct spi_device *spi, struct spi_transfer *t)
      */
     aw_spi_enable_irq(SPI_INTEN_TC|SPI_INTEN_ERR, base_addr);
 
-	if (t->len > BULK_DATA_BOUNDARY) { /* dma */
-        #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
-		if (tx_len && rx_len) /* dma full duplex not possible in normal dma mode */
-		{
-		    aw_spi_disable_irq(SPI_INTEN_TC|SPI_INTEN_ERR, base_addr);
-		    spi_wrn("Full duplex not supported for normal dma!\n");
-			return EINVAL;
-		}
-        aw_spi_sel_dma_type(0, base_addr);
-        #else
-        aw_spi_sel_dma_type(1, base_addr);
-        #endif
-
-		if(tx_len) {
-			/* txFIFO 1/4 empty dma request enable,when 16 or less than 16 bytes. */
-            aw_spi_enable_dma_irq(SPI_DRQEN_THE, base_addr);
-		}
-
-		if(rx_len) {
-    		/* rxFIFO 1/4 full dma request enable,when 16 or more than 16 bytes */
-            aw_spi_enable_dma_irq(SPI_DRQEN_RHF, base_addr);
-		}
-
-		if (rx_len) {
-			ret = spi_sunxi_prepare_dma(aw_spi, SW_DMA_RDEV);
-    		if(ret < 0) {
-    			aw_spi_disable_irq(SPI_INTEN_TC|SPI_INTEN_ERR, base_addr);
-				aw_spi_disable_dma_irq(SPI_DRQEN_RHF, base_addr);
-				if (tx_len)
-					aw_spi_disable_dma_irq(SPI_DRQEN_THE, base_addr);
-    			return -EINVAL;
-    		}
-			spi_sunxi_config_dma(aw_spi, SW_DMA_RDEV, (void *)rx_buf, rx_len);
-	        #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
-			spi_sunxi_start_dma(aw_spi, aw_spi->dma_id);
-			#else
-			spi_sunxi_start_dma(aw_spi, aw_spi->dma_rx_id);
-			#endif
-		}
+    #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
+    aw_spi_sel_dma_type(0, base_addr);
+    #else
+    aw_spi_sel_dma_type(1, base_addr);
+    #endif
 
-		if (tx_len) {
-			ret = spi_sunxi_prepare_dma(aw_spi, SW_DMA_WDEV);
-			if(ret < 0) {
-			    aw_spi_disable_irq(SPI_INTEN_TC|SPI_INTEN_ERR, base_addr);
-			    aw_spi_disable_dma_irq(SPI_DRQEN_THE, base_addr);
-				if (rx_len)
-					aw_spi_disable_dma_irq(SPI_DRQEN_RHF, base_addr);
-				return -EINVAL;
-			}
-			spi_sunxi_config_dma(aw_spi, SW_DMA_WDEV, (void *)tx_buf, tx_len);
-	        #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
-			spi_sunxi_start_dma(aw_spi, aw_spi->dma_id);
-			#else
-			spi_sunxi_start_dma(aw_spi, aw_spi->dma_tx_id);
-			#endif
-		}
+	if (rx_dma) {
+		/* rxFIFO 1/4 full dma request enable,when 16 or more than 16 bytes */
+        aw_spi_enable_dma_irq(SPI_DRQEN_RHF, base_addr);
+		spi_sunxi_config_dma(aw_spi, SW_DMA_RDEV, rx_buf, rx_len);
+        #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
+		spi_sunxi_start_dma(aw_spi, aw_spi->dma_id);
+		#else
+		spi_sunxi_start_dma(aw_spi, aw_spi->dma_rx_id);
+		#endif
+	}
 
-	    aw_spi_start_xfer(base_addr);
-	} else { /* no dma */
-		unsigned int poll_time = 0xfffff;
-		//spi_msg(" tx -> by ahb\n");
-		spin_lock_irqsave(&aw_spi->lock, flags);
+	if (tx_dma) {
+		/* txFIFO 1/4 empty dma request enable,when 16 or less than 16 bytes. */
+        aw_spi_enable_dma_irq(SPI_DRQEN_THE, base_addr);
+		spi_sunxi_config_dma(aw_spi, SW_DMA_WDEV, (void *)tx_buf, tx_len);
+        #if defined(CONFIG_SUN4I_SPI_NDMA) || defined(CONFIG_SUN5I_SPI_NDMA)
+		spi_sunxi_start_dma(aw_spi, aw_spi->dma_id);
+		#else
+		spi_sunxi_start_dma(aw_spi, aw_spi->dma_tx_id);
+		#endif
+	} else {
+		/* the tx part in front of a dma rx fits the txFIFO */
 		for(; tx_len > 0; --tx_len) {
 		    writeb(*tx_buf++, base_addr + SPI_TXDATA_REG);
 		}
-		spin_unlock_irqrestore(&aw_spi->lock, flags);
-	    aw_spi_start_xfer(base_addr);
-		if (rx_len) {
-			while(rx_len && (--poll_time >0)) {
-				/* rxFIFO counter */
-			    if(aw_spi_query_rxfifo(base_addr)){
-			        *rx_buf++ =  readb(base_addr + SPI_RXDATA_REG);//fetch data
-			        --rx_len;
-			        poll_time = 0xffff;
-			    }
-			}
-		} else {
-            while(aw_spi_query_txfifo(base_addr)&&(--poll_time > 0) );/* txFIFO counter */
-		}
-		if(poll_time <= 0) {
-		    spi_wrn("cpu tx data time out!\n");
-		}
 	}
 
+    aw_spi_start_xfer(base_addr);
+
 	/* wait for xfer complete in the isr. */
 	wait_for_completion(&aw_spi->done);
     /* get the isr return code */
@@ -1033,89 +1056,138 @@ static int spi_sunxi_xfer(struct spi_device *spi, struct spi_transfer *t)
         spi_wrn("[spi-%d]: xfer failed... \n", aw_spi->master->bus_num);
         ret = -1;
     }
-    /* release dma resource */
-	if (t->len > BULK_DATA_BOUNDARY)
-		spi_sunxi_release_dma(aw_spi);
+	spi_sunxi_stop_dma(aw_spi);
+
+	if (rx_map)
+		dma_unmap_single(dev, rx_map, rx_len, DMA_FROM_DEVICE);
+unmap_tx:
+	if (tx_map)
+		dma_unmap_single(dev, tx_map, tx_len, DMA_TO_DEVICE);
 	return ret;
 }
 
-/* spi core xfer process */
-static void spi_sunxi_work(struct work_struct *work)
+static int spi_sunxi_xfer(struct spi_device *spi, struct spi_transfer *t, int is_dma_mapped)
+{
+    //spi_msg("Begin transfer, txbuf %p, rxbuf %p, len %d\n", t->tx_buf, t->rx_buf, t->len);
+	if (!t->tx_buf && !t->rx_buf && t->len)
+		return -EINVAL;
+	if (!t->len)
+		return 0;
+	return spi_sunxi_xfer_burst(spi, t->tx_buf, t->tx_buf ? t->len : 0,
+	                            t->rx_buf, t->rx_buf ? t->len : 0, t->len, is_dma_mapped);
+}
+
+/*
+ * a tx-only transfer followed by an rx-only one (flash command and data,
+ * a display register read) runs as one burst with cs held: BC covers both,
+ * WTC the tx part. it needs DHB, and the tx part has to fit the txFIFO.
+ */
+static struct spi_transfer *spi_sunxi_xfer_pair(struct spi_device *spi, struct spi_message *msg,
+                                                struct spi_transfer *t)
+{
+	struct spi_transfer *next;
+
+	if (list_is_last(&t->transfer_list, &msg->transfers))
+		return NULL;
+	next = list_entry(t->transfer_list.next, struct spi_transfer, transfer_list);
+
+	if (!t->tx_buf || t->rx_buf || !t->len || t->len > SPI_FIFO_DEPTH)
+		return NULL;
+	if (!next->rx_buf || next->tx_buf || !next->len)
+		return NULL;
+	if (t->cs_change || t->delay_usecs)
+		return NULL;
+	/* the next one would need its own xfer_setup */
+	if (next->bits_per_word || next->speed_hz || next->interbyte_usecs)
+		return NULL;
+	if (spi->mode & SPI_RECEIVE_ALL_ACTIVE_)
+		return NULL;
+	if (t->len + next->len > SPI_TRANSFER_SIZE)
+		return NULL;
+	return next;
+}
+
+/*
+ * spi core xfer process, called from the message pump of the spi core
+ * one message at a time; the pump can run with real-time priority.
+ */
+static int spi_sunxi_transfer_one_message(struct spi_master *master, struct spi_message *msg)
 {
-	struct sunxi_spi *aw_spi = container_of(work, struct sunxi_spi, work);
+	struct sunxi_spi *aw_spi = spi_master_get_devdata(master);
+	/* get spi device from this message */
+	struct spi_device  *spi = msg->spi;
+	struct spi_transfer *t  = NULL;
+	/* set default value,no need to change cs,keep select until spi transfer require to change cs. */
+	unsigned int cs_change = 1;
+	/* set to force xfer_setup on first transfer. */
+	int status = -1;
+
 	spin_lock_irq(&aw_spi->lock);
 	aw_spi->busy = SPI_BUSY;
-	/*
-     * get from messages queue, and then do with them,
-	 * if message queue is empty ,then return and set status to free,
-	 * otherwise process them.
-	 */
-	while (!list_empty(&aw_spi->queue)) {
-		struct spi_message *msg = NULL;
-		struct spi_device  *spi = NULL;
-		struct spi_transfer *t  = NULL;
-		unsigned int cs_change = 0;
-		int status;
-		/* get message from message queue in sunxi_spi. */
-		msg = container_of(aw_spi->queue.next, struct spi_message, queue);
-		/* then delete from the message queue,now it is alone.*/
-		list_del_init(&msg->queue);
-		spin_unlock_irq(&aw_spi->lock);
-		/* get spi device from this message */
-		spi = msg->spi;
-		/* set default value,no need to change cs,keep select until spi transfer require to change cs. */
-		cs_change = 1;
-		/* set to force xfer_setup on first transfer. */
-		status = -1;
-		/* search the spi transfer in this message, deal with it alone. */
-		list_for_each_entry (t, &msg->transfers, transfer_list) {
-			if ((status == -1) || t->bits_per_word || t->speed_hz || t->interbyte_usecs) { /* xfer_setup if first transfer or overrides provided. */
-				status = spi_sunxi_xfer_setup(spi, t);/* set the value every spi transfer */
-//				spi_msg(" xfer setup \n");
-				if (status < 0)
-					break;/* fail, quit */
-			}
-			/* first active the cs */
-			if (cs_change) {
-				aw_spi->cs_control(spi, 1);
-			}
-			/* update the new cs value */
-			cs_change = t->cs_change;
-			/*
-             * do transfer
-			 * > 64 : cpu ;  =< 64 : dma
-			 * wait for done completion in this function, wakup in the irq hanlder
-			 */
-			status = spi_sunxi_xfer(spi, t);
-			if (status)
-				break;/* fail quit, zero means succeed */
-			/* accmulate the value in the message */
-			msg->actual_length += t->len;
-			/* may be need to delay */
-			if (t->delay_usecs)
-				udelay(t->delay_usecs);
-			/* if zero ,keep active,otherwise deactived. */
-			if (cs_change) {
-				aw_spi->cs_control(spi, 0);
-			}
+	spin_unlock_irq(&aw_spi->lock);
+
+	msg->actual_length = 0;
+	/* search the spi transfer in this message, deal with it alone. */
+	list_for_each_entry (t, &msg->transfers, transfer_list) {
+		struct spi_transfer *next;
+
+		if ((status == -1) || t->bits_per_word || t->speed_hz || t->interbyte_usecs) { /* xfer_setup if first transfer or overrides provided. */
+			status = spi_sunxi_xfer_setup(spi, t);/* set the value every spi transfer */
+//			spi_msg(" xfer setup \n");
+			if (status < 0)
+				break;/* fail, quit */
+		}
+		/* first active the cs */
+		if (cs_change) {
+			aw_spi->cs_control(spi, 1);
 		}
 		/*
-		 * spi message complete,succeed or failed
-		 * return value
+         * do transfer, a tx-then-rx pair in one burst
+		 * =< 64 : cpu ;  > 64 : dma
+		 * wait for done completion in this function, wakup in the irq hanlder
 		 */
-		msg->status = status;
-		/* wakup the uplayer caller,complete one message */
-		msg->complete(msg->context);
-		/* fail or need to change cs */
-		if (status || !cs_change) {
+		next = spi_sunxi_xfer_pair(spi, msg, t);
+		if (next) {
+			status = spi_sunxi_xfer_burst(spi, t->tx_buf, t->len, next->rx_buf, next->len,
+			                              t->len + next->len, msg->is_dma_mapped);
+			if (!status) {
+				msg->actual_length += t->len;
+				t = next;
+			}
+		} else {
+			status = spi_sunxi_xfer(spi, t, msg->is_dma_mapped);
+		}
+		/* update the new cs value */
+		cs_change = t->cs_change;
+		if (status)
+			break;/* fail quit, zero means succeed */
+		/* accmulate the value in the message */
+		msg->actual_length += t->len;
+		/* may be need to delay */
+		if (t->delay_usecs)
+			udelay(t->delay_usecs);
+		/* if zero ,keep active,otherwise deactived. */
+		if (cs_change) {
 			aw_spi->cs_control(spi, 0);
 		}
-		spin_lock_irq(&aw_spi->lock);
 	}
+	/* fail or need to change cs */
+	if (status || !cs_change) {
+		aw_spi->cs_control(spi, 0);
+	}
+
+	spin_lock_irq(&aw_spi->lock);
 	/* set spi to free */
 	aw_spi->busy = SPI_FREE;
 	spin_unlock_irq(&aw_spi->lock);
-	return;
+
+	/*
+	 * spi message complete,succeed or failed
+	 * return value, and wakup the uplayer caller
+	 */
+	msg->status = status;
+	spi_finalize_current_message(master);
+	return 0;
 }
 
 /* wake up the sleep thread, and give the result code */
@@ -1150,26 +1222,7 @@ static irqreturn_t spi_sunxi_isr(int irq, void *dev_id)
 	return IRQ_NONE;
 }
 
-/* interface 1 */
-static int spi_sunxi_transfer(struct spi_device *spi, struct spi_message *msg)
-{
-	struct sunxi_spi *aw_spi = spi_master_get_devdata(spi->master);
-	unsigned long flags;
-	msg->actual_length = 0;
-	msg->status = -EINPROGRESS;
-
-	spin_lock_irqsave(&aw_spi->lock, flags);
-    /* add msg to the sunxi_spi queue */
-	list_add_tail(&msg->queue, &aw_spi->queue);
-    /* add work to the workqueue,schedule the cpu. */
-	queue_work(aw_spi->workqueue, &aw_spi->work);
-	spin_unlock_irqrestore(&aw_spi->lock, flags);
-
-    /* return immediately and wait for completion in the uplayer caller. */
-	return 0;
-}
-
-/* interface 2, setup the frequency and default status */
+/* interface 1, setup the frequency and default status */
 static int spi_sunxi_setup(struct spi_device *spi)
 {
 	struct sunxi_spi *aw_spi = spi_master_get_devdata(spi->master);
@@ -1213,7 +1266,7 @@ static int spi_sunxi_setup(struct spi_device *spi)
 	return 0;
 }
 
-/* interface 3 */
+/* interface 2 */
 static void spi_sunxi_cleanup(struct spi_device *spi)
 {
     if(spi->controller_data) {
@@ -1497,7 +1550,9 @@ static int __devinit spi_sunxi_probe(struct platform_device *pdev)
 	master->bus_num         = pdev->id;
 	master->setup           = spi_sunxi_setup;
 	master->cleanup         = spi_sunxi_cleanup;
-	master->transfer        = spi_sunxi_transfer;
+	master->transfer_one_message = spi_sunxi_transfer_one_message;
+	/* spi_rt in spiN_para: message pump with real-time priority */
+	master->rt              = spi_sunxi_get_cfg_rt(pdev->id) ? true : false;
 	master->num_chipselect  = pdata->num_cs;
     //master->dma_alignment   = 8; //  should be set to 32  ??
     //master->flags           = SPI_MASTER_HALF_DUPLEX; // temporay not support duplex
@@ -1545,10 +1600,10 @@ static int __devinit spi_sunxi_probe(struct platform_device *pdev)
 		goto err4;
 	}
 
-	aw_spi->workqueue = create_singlethread_workqueue(dev_name(master->dev.parent));
-	if (aw_spi->workqueue == NULL) {
-		spi_wrn("Unable to create workqueue\n");
-		ret = -ENOMEM;
+	/* the channels stay with the bus, the transfers only enqueue */
+	ret = spi_sunxi_request_dma(aw_spi);
+	if (ret < 0) {
+		spi_wrn("Unable to request dma\n");
 		goto err5;
 	}
 
@@ -1564,8 +1619,6 @@ static int __devinit spi_sunxi_probe(struct platform_device *pdev)
 
 	spin_lock_init(&aw_spi->lock);
 	init_completion(&aw_spi->done);
-	INIT_WORK(&aw_spi->work, spi_sunxi_work);/* banding the process handler */
-	INIT_LIST_HEAD(&aw_spi->queue);
 
 	if (spi_register_master(master)) {
 		spi_wrn("cannot register SPI master\n");
@@ -1582,7 +1635,7 @@ static int __devinit spi_sunxi_probe(struct platform_device *pdev)
 	#endif
 	return 0;
 err6:
-	destroy_workqueue(aw_spi->workqueue);
+	spi_sunxi_release_dma(aw_spi);
 err5:
 	clk_disable(aw_spi->hclk);
 err4:
@@ -1604,18 +1657,11 @@ static int spi_sunxi_remove(struct platform_device *pdev)
 	struct spi_master *master = spi_master_get(platform_get_drvdata(pdev));
 	struct sunxi_spi *aw_spi = spi_master_get_devdata(master);
 	struct resource	*mem_res;
-	unsigned long flags;
-
-	spin_lock_irqsave(&aw_spi->lock, flags);
-	aw_spi->busy |= SPI_FREE;
-	spin_unlock_irqrestore(&aw_spi->lock, flags);
-
-	while (aw_spi->busy & SPI_BUSY)
-		msleep(10);
 
-	spi_sunxi_hw_exit(aw_spi);
+	/* stops the message pump once the queue ran empty */
 	spi_unregister_master(master);
-	destroy_workqueue(aw_spi->workqueue);
+	spi_sunxi_hw_exit(aw_spi);
+	spi_sunxi_release_dma(aw_spi);
 
 	clk_disable(aw_spi->hclk);
 	clk_put(aw_spi->hclk);
@@ -1636,15 +1682,18 @@ static int spi_sunxi_suspend(struct platform_device *pdev, pm_message_t state)
 	struct spi_master *master = spi_master_get(platform_get_drvdata(pdev));
 	struct sunxi_spi *aw_spi = spi_master_get_devdata(master);
 	unsigned long flags;
+	int ret;
+
+	/* waits for the message in flight */
+	ret = spi_master_suspend(master);
+	if (ret)
+		return ret;
 	printk("[spi-%d]: suspend okay.. \n", master->bus_num);
 
 	spin_lock_irqsave(&aw_spi->lock, flags);
 	aw_spi->busy |= SPI_SUSPND;
 	spin_unlock_irqrestore(&aw_spi->lock, flags);
 
-	while (aw_spi->busy & SPI_BUSY)
-		msleep(10);
-
 	/* Disable the clock */
 	clk_disable(aw_spi->hclk);
 	return 0;
@@ -1664,7 +1713,7 @@ static int spi_sunxi_resume(struct platform_device *pdev)
 	spin_lock_irqsave(&aw_spi->lock, flags);
 	aw_spi->busy = SPI_FREE;
 	spin_unlock_irqrestore(&aw_spi->lock, flags);
-	return 0;
+	return spi_master_resume(master);
 }
 #else
 #define spi_sunxi_suspend	NULL
@@ -1687,6 +1736,9 @@ static struct platform_driver __refdata spi_sunxi_driver = {
 };
 
 /* ---------------- spi resouce and platform data start ---------------------- */
+/* the buffers are mapped for the dma through the spi platform devices */
+static u64 sunxi_spi_dmamask = DMA_BIT_MASK(32);
+
 struct sunxi_spi_platform_data sunxi_spi0_pdata = {
 #if defined CONFIG_ARCH_SUN4I
 	.cs_bitmap	= 0x3,
@@ -1738,6 +1790,8 @@ static struct platform_device sunxi_spi0_device = {
 	.resource	= sunxi_spi0_resources,
 	.dev		= {
 		.platform_data = &sunxi_spi0_pdata,
+		.dma_mask = &sunxi_spi_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
 	},
 };
 
@@ -1792,6 +1846,8 @@ static struct platform_device sunxi_spi1_device = {
 	.resource	= sunxi_spi1_resources,
 	.dev		= {
 		.platform_data = &sunxi_spi1_pdata,
+		.dma_mask = &sunxi_spi_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
 	},
 };
 
@@ -1841,6 +1897,8 @@ static struct platform_device sunxi_spi2_device = {
 	.resource	= sunxi_spi2_resources,
 	.dev		= {
 		.platform_data = &sunxi_spi2_pdata,
+		.dma_mask = &sunxi_spi_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
 	},
 };
 
@@ -1887,6 +1945,8 @@ static struct platform_device sunxi_spi3_device = {
 	.resource	= sunxi_spi3_resources,
 	.dev		= {
 		.platform_data = &sunxi_spi3_pdata,
+		.dma_mask = &sunxi_spi_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
 	},
 };
 #endif
@@ -2004,6 +2064,20 @@ static int spi_sunxi_get_cfg_csbitmap(int bus_num)
     return value;
 }
 
+static int spi_sunxi_get_cfg_rt(int bus_num)
+{
+    int value = 0;
+#if defined CONFIG_ARCH_SUN4I
+    char *main_name[] = {"spi0_para", "spi1_para", "spi2_para", "spi3_para"};
+#elif defined CONFIG_ARCH_SUN5I
+    char *main_name[] = {"spi0_para", "spi1_para", "spi2_para"};
+#endif
+    /* optional, a missing key means normal priority */
+    if(script_parser_fetch(main_name[bus_num], "spi_rt", &value, sizeof(int)) != SCRIPT_PARSER_OK)
+        return 0;
+    return value;
+}
+
 /* get configuration in the script */
 #define SPI0_USED_MASK 0x1
 #define SPI1_USED_MASK 0x2
@@ -30,6 +30,8 @@
 #include <linux/highmem.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
+#include <linux/sched.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
 
@@ -71,6 +73,105 @@ static void zram_stat64_inc(struct zram *zram, u64 *v)
 	zram_stat64_add(zram, v, 1);
 }
 
+static int zram_lzo_compress(const unsigned char *src, unsigned char *dst,
+			     size_t *dst_len, void *workmem)
+{
+	return lzo1x_1_compress(src, PAGE_SIZE, dst, dst_len, workmem);
+}
+
+static int zram_lzo_decompress(const unsigned char *src, size_t src_len,
+			       unsigned char *dst, size_t *dst_len)
+{
+	return lzo1x_decompress_safe(src, src_len, dst, dst_len);
+}
+
+#ifdef CONFIG_ZRAM_LZ4
+static int zram_lz4_compress(const unsigned char *src, unsigned char *dst,
+			     size_t *dst_len, void *workmem)
+{
+	return lz4_compress(src, PAGE_SIZE, dst, dst_len, workmem);
+}
+
+static int zram_lz4_decompress(const unsigned char *src, size_t src_len,
+			       unsigned char *dst, size_t *dst_len)
+{
+	return lz4_decompress_unknownoutputsize(src, src_len, dst, dst_len);
+}
+#endif
+
+/* the first one is the default */
+const struct zram_backend zram_backends[] = {
+	{
+		.name		= "lzo",
+		.workmem_size	= LZO1X_MEM_COMPRESS,
+		.compress	= zram_lzo_compress,
+		.decompress	= zram_lzo_decompress,
+	},
+#ifdef CONFIG_ZRAM_LZ4
+	{
+		.name		= "lz4",
+		.workmem_size	= LZ4_MEM_COMPRESS,
+		.compress	= zram_lz4_compress,
+		.decompress	= zram_lz4_decompress,
+	},
+#endif
+	{ }
+};
+
+const struct zram_backend *zram_find_backend(const char *name)
+{
+	const struct zram_backend *backend;
+
+	for (backend = zram_backends; backend->name; backend++)
+		if (sysfs_streq(name, backend->name))
+			return backend;
+
+	return NULL;
+}
+
+static struct zram_stream *zram_stream_get(struct zram *zram)
+{
+	struct zram_stream *zstrm;
+
+	for (;;) {
+		spin_lock(&zram->stream_lock);
+		if (!list_empty(&zram->idle_streams)) {
+			zstrm = list_first_entry(&zram->idle_streams,
+						 struct zram_stream, list);
+			list_del(&zstrm->list);
+			spin_unlock(&zram->stream_lock);
+			return zstrm;
+		}
+		spin_unlock(&zram->stream_lock);
+
+		wait_event(zram->stream_wait,
+			   !list_empty(&zram->idle_streams));
+	}
+}
+
+static void zram_stream_put(struct zram *zram, struct zram_stream *zstrm)
+{
+	spin_lock(&zram->stream_lock);
+	list_add(&zstrm->list, &zram->idle_streams);
+	spin_unlock(&zram->stream_lock);
+
+	wake_up(&zram->stream_wait);
+}
+
+static int zram_decompress(struct zram *zram, const unsigned char *src,
+			   size_t src_len, unsigned char *dst)
+{
+	size_t clen = PAGE_SIZE;
+	u64 start = local_clock();
+	int ret;
+
+	ret = zram->backend->decompress(src, src_len, dst, &clen);
+	zram_stat64_add(zram, &zram->stats.decompr_time,
+			local_clock() - start);
+
+	return ret;
+}
+
 static int zram_test_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
 {
@@ -207,7 +308,6 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset, struct bio *bio)
 {
 	int ret;
-	size_t clen;
 	struct page *page;
 	struct zobj_header *zheader;
 	unsigned char *user_mem, *cmem, *uncmem = NULL;
@@ -245,13 +345,11 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	user_mem = kmap_atomic(page);
 	if (!is_partial_io(bvec))
 		uncmem = user_mem;
-	clen = PAGE_SIZE;
 
 	cmem = zs_map_object(zram->mem_pool, zram->table[index].handle);
 
-	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader),
-				    zram->table[index].size,
-				    uncmem, &clen);
+	ret = zram_decompress(zram, cmem + sizeof(*zheader),
+			      zram->table[index].size, uncmem);
 
 	if (is_partial_io(bvec)) {
 		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
@@ -263,10 +361,10 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	kunmap_atomic(user_mem);
 
 	/* Should NEVER happen. Return bio error if it does. */
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 		zram_stat64_inc(zram, &zram->stats.failed_reads);
-		return ret;
+		return -EIO;
 	}
 
 	flush_dcache_page(page);
@@ -277,7 +375,6 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
 {
 	int ret;
-	size_t clen = PAGE_SIZE;
 	struct zobj_header *zheader;
 	unsigned char *cmem;
 
@@ -287,43 +384,49 @@ static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
 		return 0;
 	}
 
-	cmem = zs_map_object(zram->mem_pool, zram->table[index].handle);
-
 	/* Page is stored uncompressed since it's incompressible */
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
+		cmem = kmap_atomic(zram->table[index].handle);
 		memcpy(mem, cmem, PAGE_SIZE);
 		kunmap_atomic(cmem);
 		return 0;
 	}
 
-	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader),
-				    zram->table[index].size,
-				    mem, &clen);
+	cmem = zs_map_object(zram->mem_pool, zram->table[index].handle);
+	ret = zram_decompress(zram, cmem + sizeof(*zheader),
+			      zram->table[index].size, mem);
 	zs_unmap_object(zram->mem_pool, zram->table[index].handle);
 
 	/* Should NEVER happen. Return bio error if it does. */
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 		zram_stat64_inc(zram, &zram->stats.failed_reads);
-		return ret;
+		return -EIO;
 	}
 
 	return 0;
 }
 
+/*
+ * Compresses into an idle stream without the table lock, so writers on
+ * different cpus run in parallel; the lock is only taken to swap the
+ * new object into the table. Partial writes are a read-modify-write of
+ * the page and come in with the lock held for writing instead.
+ */
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			   int offset)
 {
-	int ret;
-	u32 store_offset;
-	size_t clen;
-	void *handle;
+	int ret = 0;
+	size_t clen = 0;
+	void *handle = NULL;
+	u8 flags = 0;
+	u64 start;
 	struct zobj_header *zheader;
+	struct zram_stream *zstrm;
 	struct page *page, *page_store;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 
 	page = bvec->bv_page;
-	src = zram->compress_buffer;
 
 	if (is_partial_io(bvec)) {
 		/*
@@ -343,13 +446,8 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		}
 	}
 
-	/*
-	 * System overwrites unused sectors. Free memory associated
-	 * with this sector now.
-	 */
-	if (zram->table[index].handle ||
-	    zram_test_flag(zram, index, ZRAM_ZERO))
-		zram_free_page(zram, index);
+	zstrm = zram_stream_get(zram);
+	src = zstrm->buffer;
 
 	user_mem = kmap_atomic(page);
 
@@ -363,21 +461,23 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		kunmap_atomic(user_mem);
 		if (is_partial_io(bvec))
 			kfree(uncmem);
-		zram_stat_inc(&zram->stats.pages_zero);
-		zram_set_flag(zram, index, ZRAM_ZERO);
-		ret = 0;
-		goto out;
+		zram_stream_put(zram, zstrm);
+		flags = BIT(ZRAM_ZERO);
+		goto update;
 	}
 
-	ret = lzo1x_1_compress(uncmem, PAGE_SIZE, src, &clen,
-			       zram->compress_workmem);
+	start = local_clock();
+	ret = zram->backend->compress(uncmem, src, &clen, zstrm->workmem);
+	zram_stat64_add(zram, &zram->stats.compr_time, local_clock() - start);
 
 	kunmap_atomic(user_mem);
 	if (is_partial_io(bvec))
 			kfree(uncmem);
 
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
+		zram_stream_put(zram, zstrm);
 		pr_err("Compression failed! err=%d\n", ret);
+		ret = -EIO;
 		goto out;
 	}
 
@@ -387,6 +487,7 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	 * errors which has side effect of hanging the system.
 	 */
 	if (unlikely(clen > max_zpage_size)) {
+		zram_stream_put(zram, zstrm);
 		clen = PAGE_SIZE;
 		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
 		if (unlikely(!page_store)) {
@@ -396,17 +497,19 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			goto out;
 		}
 
-		store_offset = 0;
-		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
-		zram_stat_inc(&zram->stats.pages_expand);
+		flags = BIT(ZRAM_UNCOMPRESSED);
 		handle = page_store;
 		src = kmap_atomic(page);
 		cmem = kmap_atomic(page_store);
-		goto memstore;
+		memcpy(cmem, src, clen);
+		kunmap_atomic(cmem);
+		kunmap_atomic(src);
+		goto update;
 	}
 
 	handle = zs_malloc(zram->mem_pool, clen + sizeof(*zheader));
 	if (!handle) {
+		zram_stream_put(zram, zstrm);
 		pr_info("Error allocating memory for compressed "
 			"page: %u, size=%zu\n", index, clen);
 		ret = -ENOMEM;
@@ -414,33 +517,47 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	}
 	cmem = zs_map_object(zram->mem_pool, handle);
 
-memstore:
 #if 0
 	/* Back-reference needed for memory defragmentation */
-	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
-		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
-	}
+	zheader = (struct zobj_header *)cmem;
+	zheader->table_idx = index;
+	cmem += sizeof(*zheader);
 #endif
 
 	memcpy(cmem, src, clen);
+	zs_unmap_object(zram->mem_pool, handle);
+	zram_stream_put(zram, zstrm);
 
-	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
-		kunmap_atomic(cmem);
-		kunmap_atomic(src);
-	} else {
-		zs_unmap_object(zram->mem_pool, handle);
-	}
+update:
+	if (!is_partial_io(bvec))
+		down_write(&zram->lock);
+
+	/*
+	 * System overwrites unused sectors. Free memory associated
+	 * with this sector now.
+	 */
+	if (zram->table[index].handle ||
+	    zram_test_flag(zram, index, ZRAM_ZERO))
+		zram_free_page(zram, index);
 
 	zram->table[index].handle = handle;
 	zram->table[index].size = clen;
+	zram->table[index].flags |= flags;
 
 	/* Update stats */
-	zram_stat64_add(zram, &zram->stats.compr_size, clen);
-	zram_stat_inc(&zram->stats.pages_stored);
-	if (clen <= PAGE_SIZE / 2)
-		zram_stat_inc(&zram->stats.good_compress);
+	if (flags & BIT(ZRAM_ZERO)) {
+		zram_stat_inc(&zram->stats.pages_zero);
+	} else {
+		if (flags & BIT(ZRAM_UNCOMPRESSED))
+			zram_stat_inc(&zram->stats.pages_expand);
+		else if (clen <= PAGE_SIZE / 2)
+			zram_stat_inc(&zram->stats.good_compress);
+		zram_stat64_add(zram, &zram->stats.compr_size, clen);
+		zram_stat_inc(&zram->stats.pages_stored);
+	}
+
+	if (!is_partial_io(bvec))
+		up_write(&zram->lock);
 
 	return 0;
 
@@ -459,10 +576,12 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 		down_read(&zram->lock);
 		ret = zram_bvec_read(zram, bvec, index, offset, bio);
 		up_read(&zram->lock);
-	} else {
+	} else if (is_partial_io(bvec)) {
 		down_write(&zram->lock);
 		ret = zram_bvec_write(zram, bvec, index, offset);
 		up_write(&zram->lock);
+	} else {
+		ret = zram_bvec_write(zram, bvec, index, offset);
 	}
 
 	return ret;
@@ -590,12 +709,15 @@ void __zram_reset_device(struct zram *zram)
 
 	zram->init_done = 0;
 
-	/* Free various per-device buffers */
-	kfree(zram->compress_workmem);
-	free_pages((unsigned long)zram->compress_buffer, 1);
-
-	zram->compress_workmem = NULL;
-	zram->compress_buffer = NULL;
+	/* Free the compression streams */
+	for (index = 0; index < zram->num_streams; index++) {
+		kfree(zram->streams[index].workmem);
+		free_pages((unsigned long)zram->streams[index].buffer, 1);
+	}
+	kfree(zram->streams);
+	zram->streams = NULL;
+	zram->num_streams = 0;
+	INIT_LIST_HEAD(&zram->idle_streams);
 
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
@@ -628,6 +750,30 @@ void zram_reset_device(struct zram *zram)
 	up_write(&zram->init_lock);
 }
 
+static int zram_init_streams(struct zram *zram)
+{
+	struct zram_stream *zstrm;
+	unsigned int i, num = num_possible_cpus();
+
+	zram->streams = kcalloc(num, sizeof(*zram->streams), GFP_KERNEL);
+	if (!zram->streams)
+		return -ENOMEM;
+	zram->num_streams = num;
+
+	for (i = 0; i < num; i++) {
+		zstrm = &zram->streams[i];
+		zstrm->workmem = kzalloc(zram->backend->workmem_size,
+					 GFP_KERNEL);
+		zstrm->buffer =
+			(void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
+		if (!zstrm->workmem || !zstrm->buffer)
+			return -ENOMEM;
+		list_add(&zstrm->list, &zram->idle_streams);
+	}
+
+	return 0;
+}
+
 int zram_init_device(struct zram *zram)
 {
 	int ret;
@@ -642,18 +788,9 @@ int zram_init_device(struct zram *zram)
 
 	zram_set_disksize(zram, totalram_pages << PAGE_SHIFT);
 
-	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!zram->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
-		ret = -ENOMEM;
-		goto fail_no_table;
-	}
-
-	zram->compress_buffer =
-		(void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
-	if (!zram->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		ret = -ENOMEM;
+	ret = zram_init_streams(zram);
+	if (ret) {
+		pr_err("Error allocating compression streams!\n");
 		goto fail_no_table;
 	}
 
@@ -670,7 +807,9 @@ int zram_init_device(struct zram *zram)
 	/* zram devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
-	zram->mem_pool = zs_create_pool("zram", GFP_NOIO | __GFP_HIGHMEM);
+	/* named after the disk, for the per device zsmalloc stats */
+	zram->mem_pool = zs_create_pool(zram->disk->disk_name,
+					GFP_NOIO | __GFP_HIGHMEM);
 	if (!zram->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
@@ -680,7 +819,8 @@ int zram_init_device(struct zram *zram)
 	zram->init_done = 1;
 	up_write(&zram->init_lock);
 
-	pr_debug("Initialization done!\n");
+	pr_debug("Initialization done, %u %s streams\n", zram->num_streams,
+		 zram->backend->name);
 	return 0;
 
 fail_no_table:
@@ -715,6 +855,10 @@ static int create_device(struct zram *zram, int device_id)
 	init_rwsem(&zram->lock);
 	init_rwsem(&zram->init_lock);
 	spin_lock_init(&zram->stat64_lock);
+	spin_lock_init(&zram->stream_lock);
+	INIT_LIST_HEAD(&zram->idle_streams);
+	init_waitqueue_head(&zram->stream_wait);
+	zram->backend = &zram_backends[0];
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
@@ -17,6 +17,8 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/list.h>
+#include <linux/wait.h>
 
 #include "../zsmalloc/zsmalloc.h"
 
@@ -51,8 +53,8 @@ static const size_t max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*
  * NOTE: max_zpage_size must be less than or equal to:
- *   ZS_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
- * otherwise, xv_malloc() would always return failure.
+ *   ZS_MAX_ALLOC_SIZE - ZS_HANDLE_SIZE - sizeof(struct zobj_header)
+ * otherwise, zs_malloc() would always return failure.
  */
 
 /*-- End of configurable params */
@@ -99,16 +101,46 @@ struct zram_stats {
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
+	u64 compr_time;		/* ns spent compressing */
+	u64 decompr_time;	/* ns spent decompressing */
+};
+
+/*
+ * A compressor: compress() takes a whole page and writes at most two
+ * pages to dst, both return 0 on success.
+ */
+struct zram_backend {
+	const char *name;
+	size_t workmem_size;
+	int (*compress)(const unsigned char *src, unsigned char *dst,
+			size_t *dst_len, void *workmem);
+	int (*decompress)(const unsigned char *src, size_t src_len,
+			  unsigned char *dst, size_t *dst_len);
+};
+
+/*
+ * Workmem and output buffer of one compression, a device has one per
+ * cpu. Writers take an idle one and compress without holding the
+ * table lock.
+ */
+struct zram_stream {
+	struct list_head list;
+	void *workmem;
+	void *buffer;		/* 2 pages */
 };
 
 struct zram {
 	struct zs_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	const struct zram_backend *backend;
+	struct zram_stream *streams;
+	unsigned int num_streams;
+	struct list_head idle_streams;
+	spinlock_t stream_lock;	/* protect idle_streams */
+	wait_queue_head_t stream_wait;
 	struct table *table;
 	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct rw_semaphore lock; /* protect compression buffers and table
-				   * against concurrent read and writes */
+	struct rw_semaphore lock; /* protect the table against concurrent
+				   * read and writes */
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -131,5 +163,7 @@ extern struct attribute_group zram_disk_attr_group;
 
 extern int zram_init_device(struct zram *zram);
 extern void __zram_reset_device(struct zram *zram);
+extern const struct zram_backend zram_backends[];
+extern const struct zram_backend *zram_find_backend(const char *name);
 
 #endif
@@ -16,6 +16,8 @@
 #include <linux/kernel.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
 
 /*
  * This must be power of 2 and greater than of equal to sizeof(link_free).
@@ -34,13 +36,20 @@
 
 /*
  * Object location (<PFN>, <obj_idx>) is encoded as
- * as single (void *) handle value.
+ * as single unsigned long value, shifted up by OBJ_TAG_BITS.
  *
  * Note that object index <obj_idx> is relative to system
  * page <PFN> it is stored in, so for each sub-page belonging
  * to a zspage, obj_idx starts with 0.
  *
  * This is made more complicated by various memory models and PAE.
+ *
+ * The handle given out by zs_malloc() is the address of a word that
+ * holds this location, so compaction can move the object and update
+ * the word. Bit 0 of the word is the pin bit, held while the object
+ * is mapped or freed. The first word of an allocated object holds the
+ * handle with OBJ_ALLOCATED_TAG set, a free one holds the location of
+ * the next free object, whose bit 0 is clear.
  */
 
 #ifndef MAX_PHYSMEM_BITS
@@ -55,7 +64,10 @@
 #endif
 #endif
 #define _PFN_BITS		(MAX_PHYSMEM_BITS - PAGE_SHIFT)
-#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS)
+#define OBJ_TAG_BITS	1
+#define OBJ_ALLOCATED_TAG	1
+#define HANDLE_PIN_BIT	0
+#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS - OBJ_TAG_BITS)
 #define OBJ_INDEX_MASK	((_AC(1, UL) << OBJ_INDEX_BITS) - 1)
 
 #define MAX(a, b) ((a) >= (b) ? (a) : (b))
@@ -64,6 +76,9 @@
 	MAX(32, (ZS_MAX_PAGES_PER_ZSPAGE << PAGE_SHIFT >> OBJ_INDEX_BITS))
 #define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
 
+/* each object starts with its handle, see above */
+#define ZS_HANDLE_SIZE	(sizeof(unsigned long))
+
 /*
  * On systems with 4K page size, this gives 254 size classes! There is a
  * trader-off here:
@@ -109,6 +124,13 @@ enum fullness_group {
  */
 static const int fullness_threshold_frac = 4;
 
+/*
+ * Default of the compact_threshold parameter: a class is compacted in
+ * the background once its free objects would fill this many zspages,
+ * see zs_free(). With 0 only the shrinker and zs_compact() compact.
+ */
+#define ZS_COMPACT_THRESHOLD	8
+
 struct mapping_area {
 	struct vm_struct *vm;
 	pte_t *vm_ptes[2];
@@ -125,11 +147,16 @@ struct size_class {
 
 	/* Number of PAGE_SIZE sized pages to combine to form a 'zspage' */
 	int zspage_order;
+	int objs_per_zspage;
 
 	spinlock_t lock;
 
 	/* stats */
 	u64 pages_allocated;
+	unsigned long nr_zspages;
+	unsigned long objs_inuse;
+	unsigned long nr_listed[_ZS_NR_FULLNESS_GROUPS];
+	unsigned long pages_compacted;
 
 	struct page *fullness_list[_ZS_NR_FULLNESS_GROUPS];
 };
@@ -141,8 +168,12 @@ struct size_class {
  * This must be power of 2 and less than or equal to ZS_ALIGN
  */
 struct link_free {
-	/* Handle of next free chunk (encodes <PFN, obj_idx>) */
-	void *next;
+	union {
+		/* Location of next free chunk (encodes <PFN, obj_idx>) */
+		unsigned long next;
+		/* Handle of the object, while allocated */
+		unsigned long handle;
+	};
 };
 
 struct zs_pool {
@@ -150,6 +181,13 @@ struct zs_pool {
 
 	gfp_t flags;	/* allocation flags used when growing pool */
 	const char *name;
+
+	struct kmem_cache *handle_cachep;
+	struct shrinker shrinker;
+	struct work_struct compact_work;
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *stat_dentry;
+#endif
 };
 
 #endif
@@ -673,6 +673,7 @@ static void thermal_zone_device_passive(struct thermal_zone_device *tz,
 	struct thermal_cooling_device_instance *instance;
 	struct thermal_cooling_device *cdev;
 	long state, max_state;
+	bool throttled = false;
 
 	/*
 	 * Above Trip?
@@ -719,7 +720,9 @@ static void thermal_zone_device_passive(struct thermal_zone_device *tz,
 	 * -----------
 	 * Implement passive cooling hysteresis to slowly increase performance
 	 * and avoid thrashing around the passive trip point.  Note that we
-	 * assume symmetry.
+	 * assume symmetry. Passive cooling ends once every device bound
+	 * to the trip is back at state 0, the ones with fewer states get
+	 * there first.
 	 */
 	list_for_each_entry(instance, &tz->cooling_devices, node) {
 		if (instance->trip != trip)
@@ -729,9 +732,11 @@ static void thermal_zone_device_passive(struct thermal_zone_device *tz,
 		cdev->ops->get_max_state(cdev, &max_state);
 		if (state > 0)
 			cdev->ops->set_cur_state(cdev, --state);
-		if (state == 0)
-			tz->passive = false;
+		if (state)
+			throttled = true;
 	}
+	if (!throttled)
+		tz->passive = false;
 }
 
 static void thermal_zone_device_check(struct work_struct *work)
@@ -31,6 +31,9 @@
 #include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/init.h>
+#include <linux/tty_flip.h>
+#include <linux/timer.h>
+#include <linux/dma-mapping.h>
 
 #include <asm/io.h>
 #include <asm/ecard.h>
@@ -41,6 +44,9 @@
 #include <plat/sys_config.h>
 #include <mach/platform.h>
 #include <mach/irqs.h>
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+#include <plat/dma_compat.h>
+#endif
 
 #include "8250.h"
 
@@ -53,6 +59,45 @@
 #define UART_HALT           0x29 /* Halt TX register */
 #define UART_FORCE_CFG      (1 << 1)
 #define UART_FORCE_UPDATE   (1 << 2)
+#define UART_USR_BUSY       (1 << 0)
+
+/* reads of the halt register for one forced LCR update */
+#define SW_UART_BUSY_POLL   1000
+/* ticks a missed LCR write is retried on before it is given up */
+#define SW_UART_BUSY_TRIES  10
+
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+/* rx ring, one page of periods kept queued on a continuous channel */
+#define SW_UART_RX_PERIOD	512
+#define SW_UART_RX_PERIODS	8
+#define SW_UART_RX_SIZE		(SW_UART_RX_PERIOD * SW_UART_RX_PERIODS)
+
+struct sw_serial_dma {
+	struct sunxi_dma_params rx;
+	struct sunxi_dma_params tx;
+	char rx_name[16];
+	char tx_name[16];
+	int running;
+
+	/* rx ring */
+	unsigned char *rx_buf;
+	dma_addr_t rx_addr;
+	unsigned int rx_tail;		/* first byte not pushed to the tty */
+	unsigned int rx_done;		/* period the next buffdone is for */
+	struct timer_list rx_timer;
+
+	/* tx chunk, a contiguous part of the xmit circ */
+	dma_addr_t tx_addr;
+	unsigned int tx_len;
+	int tx_started;
+
+	/* statistics */
+	unsigned long rx_bytes;
+	unsigned long tx_bytes;
+	unsigned long overruns;		/* the uart fifo overflowed */
+	unsigned long dropped;		/* the tty buffer was full */
+};
+#endif
 
 struct sw_serial_port {
 	int port_no;
@@ -64,6 +109,17 @@ struct sw_serial_port {
 	struct resource *mmres;
 	u32 irq;
 	struct platform_device *pdev;
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	struct sw_serial_dma *dma;
+#endif
+
+	/* LCR writes the busy uart dropped, retried from a timer */
+	struct timer_list busy_timer;
+	int busy_tries;
+	unsigned long busy_irqs;
+	unsigned long lcr_missed;
+	unsigned long lcr_forced;
+	unsigned long lcr_failed;
 };
 
 static int sw_serial_get_resource(struct sw_serial_port *sport)
@@ -128,15 +184,457 @@ static int sw_serial_put_resource(struct sw_serial_port *sport)
 	return 0;
 }
 
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+/*
+ * The 8250 core of this kernel has no dma hooks, it only knows about
+ * the data irqs. Ports in dma mode keep RDI and THRI out of the IER
+ * behind its back: rx always runs into the ring, and when the core asks
+ * for THRI the pending part of the xmit circ goes out by dma instead;
+ * THRI stays set in up->ier until the circ is empty, so start_tx comes
+ * back here once the tx chunk that runs now has been done.
+ */
+static void sw_serial_dma_rx_push(struct uart_port *p, unsigned int end)
+{
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	struct tty_struct *tty = p->state ? p->state->port.tty : NULL;
+	unsigned int len = end - dma->rx_tail;
+	int cnt = 0;
+
+	if (!len)
+		return;
+	if (tty)
+		cnt = tty_insert_flip_string(tty, dma->rx_buf + dma->rx_tail, len);
+	if (cnt < len) {
+		dma->dropped += len - cnt;
+		p->icount.buf_overrun += len - cnt;
+	}
+	p->icount.rx += cnt;
+	dma->rx_bytes += cnt;
+	dma->rx_tail = end % SW_UART_RX_SIZE;
+}
+
+static void sw_serial_dma_rx_flip(struct uart_port *p, unsigned long flags)
+{
+	struct tty_struct *tty = p->state ? p->state->port.tty : NULL;
+
+	spin_unlock_irqrestore(&p->lock, flags);
+	if (tty)
+		tty_flip_buffer_push(tty);
+}
+
+static void sw_serial_dma_rx_done(struct sunxi_dma_params *params, void *arg)
+{
+	struct uart_port *p = arg;
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	unsigned long flags;
+	unsigned int pos;
+
+	spin_lock_irqsave(&p->lock, flags);
+	if (!dma->running) {
+		spin_unlock_irqrestore(&p->lock, flags);
+		return;
+	}
+
+	pos = dma->rx_done * SW_UART_RX_PERIOD;
+	sw_serial_dma_rx_push(p, pos + SW_UART_RX_PERIOD);
+
+	/* the channel already runs the next period, put this one back */
+	sunxi_dma_enqueue(&dma->rx, dma->rx_addr + pos, SW_UART_RX_PERIOD, 1);
+	dma->rx_done = (dma->rx_done + 1) % SW_UART_RX_PERIODS;
+
+	sw_serial_dma_rx_flip(p, flags);
+}
+
+/*
+ * The uart hands a short burst to the dma on its character timeout,
+ * so the bytes are already in the ring, only no period is done. Push
+ * what there is of the running one every tick.
+ */
+static void sw_serial_dma_rx_timer(unsigned long data)
+{
+	struct uart_port *p = (struct uart_port *)data;
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	dma_addr_t src = 0, dst = 0;
+	unsigned long flags;
+	unsigned int pos;
+
+	spin_lock_irqsave(&p->lock, flags);
+	if (!dma->running) {
+		spin_unlock_irqrestore(&p->lock, flags);
+		return;
+	}
+
+	if (sunxi_dma_getrunposition(&dma->rx, SW_UART_RX_PERIOD,
+				     &src, &dst) == 0) {
+		pos = dst - dma->rx_addr;
+		/* the rest of an earlier period is left to its buffdone */
+		if (pos < SW_UART_RX_SIZE && pos > dma->rx_tail &&
+		    pos / SW_UART_RX_PERIOD ==
+				dma->rx_tail / SW_UART_RX_PERIOD)
+			sw_serial_dma_rx_push(p, pos);
+	}
+	mod_timer(&dma->rx_timer, jiffies + 1);
+
+	sw_serial_dma_rx_flip(p, flags);
+}
+
+/* called with the port lock held */
+static void sw_serial_dma_start_tx(struct uart_port *p)
+{
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	struct uart_8250_port *up = container_of(p, struct uart_8250_port, port);
+	struct circ_buf *xmit = &p->state->xmit;
+
+	if (dma->tx_len || !dma->running)
+		return;
+
+	if (p->x_char && (p->serial_in(p, UART_LSR) & UART_LSR_THRE)) {
+		writel(p->x_char, p->membase + (UART_TX << p->regshift));
+		p->icount.tx++;
+		p->x_char = 0;
+	}
+
+	if (uart_circ_empty(xmit) || uart_tx_stopped(p)) {
+		/* the next start_tx has to write the IER again */
+		up->ier &= ~UART_IER_THRI;
+		return;
+	}
+
+	dma->tx_len = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	dma->tx_addr = dma_map_single(&d->pdev->dev, xmit->buf + xmit->tail,
+				      dma->tx_len, DMA_TO_DEVICE);
+	if (sunxi_dma_enqueue(&dma->tx, dma->tx_addr, dma->tx_len, 0) != 0) {
+		dma_unmap_single(&d->pdev->dev, dma->tx_addr, dma->tx_len,
+				 DMA_TO_DEVICE);
+		dma->tx_len = 0;
+		return;
+	}
+	/* after the first chunk it restarts by itself on enqueue */
+	if (!dma->tx_started) {
+		sunxi_dma_start(&dma->tx);
+		dma->tx_started = 1;
+	}
+}
+
+static void sw_serial_dma_tx_done(struct sunxi_dma_params *params, void *arg)
+{
+	struct uart_port *p = arg;
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	struct circ_buf *xmit = &p->state->xmit;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->lock, flags);
+	if (!dma->tx_len) {
+		spin_unlock_irqrestore(&p->lock, flags);
+		return;
+	}
+
+	dma_unmap_single(&d->pdev->dev, dma->tx_addr, dma->tx_len,
+			 DMA_TO_DEVICE);
+	/* the circ may have been flushed meanwhile */
+	if (!uart_circ_empty(xmit)) {
+		xmit->tail = (xmit->tail + dma->tx_len) & (UART_XMIT_SIZE - 1);
+		p->icount.tx += dma->tx_len;
+		dma->tx_bytes += dma->tx_len;
+	}
+	dma->tx_len = 0;
+
+	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+		uart_write_wakeup(p);
+
+	sw_serial_dma_start_tx(p);
+	spin_unlock_irqrestore(&p->lock, flags);
+}
+
+static void sw_serial_dma_start(struct uart_port *p)
+{
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	dma_config_t rx_conf = {
+		.xfer_type = {
+			.src_data_width = DATA_WIDTH_8BIT,
+			.src_bst_len	= DATA_BRST_1,
+			.dst_data_width = DATA_WIDTH_8BIT,
+			.dst_bst_len	= DATA_BRST_1
+		},
+		.address_type = {
+			.src_addr_mode	= NDMA_ADDR_NOCHANGE,
+			.dst_addr_mode	= NDMA_ADDR_INCREMENT
+		},
+		.src_drq_type	= N_SRC_UART0_RX + d->port_no,
+		.dst_drq_type	= N_DST_SDRAM,
+		.bconti_mode	= true,
+		.irq_spt	= CHAN_IRQ_FD
+	};
+	dma_config_t tx_conf = rx_conf;
+	unsigned long flags;
+	int i;
+
+	tx_conf.address_type.src_addr_mode = NDMA_ADDR_INCREMENT;
+	tx_conf.address_type.dst_addr_mode = NDMA_ADDR_NOCHANGE;
+	tx_conf.src_drq_type = N_SRC_SDRAM;
+	tx_conf.dst_drq_type = N_DST_UART0_TX + d->port_no;
+	tx_conf.bconti_mode = false;
+
+	/* p is the port the 8250 core registered, not the one of probe */
+	dma->rx_timer.data = (unsigned long)p;
+	if (sunxi_dma_set_callback(&dma->rx, sw_serial_dma_rx_done, p) ||
+	    sunxi_dma_set_callback(&dma->tx, sw_serial_dma_tx_done, p) ||
+	    sunxi_dma_config(&dma->rx, &rx_conf, 0) ||
+	    sunxi_dma_config(&dma->tx, &tx_conf, 0)) {
+		pr_err("uart%d: dma config failed, staying on the fifo irqs\n",
+		       d->port_no);
+		return;
+	}
+
+	spin_lock_irqsave(&p->lock, flags);
+	dma->rx_tail = 0;
+	dma->rx_done = 0;
+	for (i = 0; i < SW_UART_RX_PERIODS; i++)
+		sunxi_dma_enqueue(&dma->rx, dma->rx_addr + i * SW_UART_RX_PERIOD,
+				  SW_UART_RX_PERIOD, 1);
+	sunxi_dma_start(&dma->rx);
+	dma->tx_len = 0;
+	dma->tx_started = 0;
+	dma->running = 1;
+	spin_unlock_irqrestore(&p->lock, flags);
+
+	mod_timer(&dma->rx_timer, jiffies + 1);
+}
+
+static void sw_serial_dma_stop(struct uart_port *p)
+{
+	struct sw_serial_port *d = p->private_data;
+	struct sw_serial_dma *dma = d->dma;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->lock, flags);
+	dma->running = 0;
+	sunxi_dma_stop(&dma->rx);
+	sunxi_dma_stop(&dma->tx);
+	if (dma->tx_len) {
+		dma_unmap_single(&d->pdev->dev, dma->tx_addr, dma->tx_len,
+				 DMA_TO_DEVICE);
+		dma->tx_len = 0;
+	}
+	spin_unlock_irqrestore(&p->lock, flags);
+
+	del_timer_sync(&dma->rx_timer);
+}
+
+/* dma mode: the data irqs are off, only line and modem status are left */
+static int sw_serial_dma_handle_irq(struct uart_port *p, unsigned int iir)
+{
+	struct sw_serial_port *d = p->private_data;
+	struct uart_8250_port *up = container_of(p, struct uart_8250_port, port);
+	unsigned long flags;
+	unsigned int lsr;
+
+	if (iir & UART_IIR_NO_INT)
+		return 0;
+
+	spin_lock_irqsave(&p->lock, flags);
+	lsr = p->serial_in(p, UART_LSR);
+	if (lsr & UART_LSR_OE) {
+		p->icount.overrun++;
+		d->dma->overruns++;
+	}
+	if (lsr & UART_LSR_BI)
+		p->icount.brk++;
+	if (lsr & UART_LSR_PE)
+		p->icount.parity++;
+	if (lsr & UART_LSR_FE)
+		p->icount.frame++;
+	serial8250_modem_status(up);
+	spin_unlock_irqrestore(&p->lock, flags);
+
+	return 1;
+}
+
+static ssize_t sw_serial_dma_stats_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct sw_serial_port *d = platform_get_drvdata(to_platform_device(dev));
+	struct sw_serial_dma *dma = d->dma;
+	unsigned long underruns = 0;
+
+	sunxi_dma_getunderruns(&dma->rx, &underruns);
+	return sprintf(buf, "rx %lu tx %lu overruns %lu dropped %lu "
+		       "ring_underruns %lu\n", dma->rx_bytes, dma->tx_bytes,
+		       dma->overruns, dma->dropped, underruns);
+}
+
+static DEVICE_ATTR(dma_stats, S_IRUGO, sw_serial_dma_stats_show, NULL);
+
+static int sw_serial_dma_request(struct sw_serial_port *sport)
+{
+	struct sw_serial_dma *dma;
+	char uart_para[16];
+	int used = 0;
+
+	sprintf(uart_para, "uart_para%d", sport->port_no);
+	if (script_parser_fetch(uart_para, "uart_dma", &used, sizeof(int)) ||
+	    !used)
+		return 0;
+
+	dma = kzalloc(sizeof(struct sw_serial_dma), GFP_KERNEL);
+	if (!dma)
+		return -ENOMEM;
+
+	dma->rx_buf = dma_alloc_coherent(&sport->pdev->dev, SW_UART_RX_SIZE,
+					 &dma->rx_addr, GFP_KERNEL);
+	if (!dma->rx_buf)
+		goto err_free;
+
+	sprintf(dma->rx_name, "uart%d_rx", sport->port_no);
+	sprintf(dma->tx_name, "uart%d_tx", sport->port_no);
+	dma->rx.client.name = dma->rx_name;
+	dma->tx.client.name = dma->tx_name;
+	dma->rx.dma_addr = sport->mmres->start + (UART_RX << 2);
+	dma->tx.dma_addr = sport->mmres->start + (UART_TX << 2);
+
+	if (sunxi_dma_request(&dma->rx, 0) < 0)
+		goto err_coherent;
+	if (sunxi_dma_request(&dma->tx, 0) < 0)
+		goto err_rx;
+
+	setup_timer(&dma->rx_timer, sw_serial_dma_rx_timer, 0);
+	sport->dma = dma;
+	pr_info("uart%d: rx/tx by dma\n", sport->port_no);
+	return 0;
+
+ err_rx:
+	sunxi_dma_release(&dma->rx);
+ err_coherent:
+	dma_free_coherent(&sport->pdev->dev, SW_UART_RX_SIZE, dma->rx_buf,
+			  dma->rx_addr);
+ err_free:
+	kfree(dma);
+	pr_err("uart%d: no dma, using the fifo irqs\n", sport->port_no);
+	return 0;
+}
+
+static void sw_serial_dma_release(struct sw_serial_port *sport)
+{
+	struct sw_serial_dma *dma = sport->dma;
+
+	if (!dma)
+		return;
+	sunxi_dma_release(&dma->tx);
+	sunxi_dma_release(&dma->rx);
+	dma_free_coherent(&sport->pdev->dev, SW_UART_RX_SIZE, dma->rx_buf,
+			  dma->rx_addr);
+	kfree(dma);
+	sport->dma = NULL;
+}
+#endif
+
+/*
+ * Put last_lcr into the LCR while the uart may be busy, with the port
+ * lock held. If a character is on the line the write needs the force
+ * update of the halt register, which is only waited for a bounded
+ * number of reads; -EBUSY leaves it to the caller to try again later.
+ */
+static int sw_serial_fix_lcr(struct uart_port *p)
+{
+	struct sw_serial_port *d = p->private_data;
+	void __iomem *lcr = p->membase + (UART_LCR << p->regshift);
+	void __iomem *halt = p->membase + (UART_HALT << p->regshift);
+	int i;
+
+	if (!(readl(p->membase + (UART_USR << p->regshift)) & UART_USR_BUSY)) {
+		writel(d->last_lcr, lcr);
+		return readl(lcr) == d->last_lcr ? 0 : -EBUSY;
+	}
+
+	d->lcr_forced++;
+	writel(UART_FORCE_CFG, halt);
+	writel(d->last_lcr, lcr);
+	writel(UART_FORCE_CFG | UART_FORCE_UPDATE, halt);
+	for (i = 0; i < SW_UART_BUSY_POLL; i++)
+		if (!(readl(halt) & UART_FORCE_UPDATE))
+			break;
+	writel(0x00, halt);
+	readl(p->membase + (UART_USR << p->regshift));
+
+	return i < SW_UART_BUSY_POLL ? 0 : -EBUSY;
+}
+
+static void sw_serial_busy_timer(unsigned long data)
+{
+	struct uart_port *p = (struct uart_port *)data;
+	struct sw_serial_port *d = p->private_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->lock, flags);
+	if (sw_serial_fix_lcr(p) == 0) {
+		d->busy_tries = 0;
+	} else if (++d->busy_tries < SW_UART_BUSY_TRIES) {
+		mod_timer(&d->busy_timer, jiffies + 1);
+	} else {
+		d->lcr_failed++;
+		d->busy_tries = 0;
+		pr_warn("uart%d: LCR 0x%02x not taken, uart stays busy\n",
+			d->port_no, d->last_lcr);
+	}
+	spin_unlock_irqrestore(&p->lock, flags);
+}
+
+/* p is the port the 8250 core registered, the timer runs on that one */
+static void sw_serial_defer_lcr(struct uart_port *p)
+{
+	struct sw_serial_port *d = p->private_data;
+
+	if (timer_pending(&d->busy_timer))
+		return;
+	d->busy_timer.data = (unsigned long)p;
+	d->busy_tries = 0;
+	mod_timer(&d->busy_timer, jiffies + 1);
+}
+
 static void sw_serial_out32(struct uart_port *p, int offset, int value)
 {
 	struct sw_serial_port *d = p->private_data;
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	int kick = 0;
+
+	if (d->dma && d->dma->running) {
+		if (offset == UART_IER) {
+			kick = value & UART_IER_THRI;
+			value &= ~(UART_IER_RDI | UART_IER_THRI);
+		} else if (offset == UART_FCR && (value & UART_FCR_ENABLE_FIFO)) {
+			value |= UART_FCR_DMA_SELECT;
+		}
+	}
+#endif
 
-	if (offset == UART_LCR)
+	if (offset == UART_LCR) {
 		d->last_lcr = value;
+		writel(value, p->membase + (UART_LCR << p->regshift));
+		/*
+		 * Dropped while a character is on the line. Nothing spins
+		 * here, the busy irq or the timer put last_lcr in later.
+		 */
+		if (readl(p->membase + (UART_LCR << p->regshift)) != value) {
+			d->lcr_missed++;
+			sw_serial_defer_lcr(p);
+		}
+		return;
+	}
 
 	offset <<= p->regshift;
 	writel(value, p->membase + offset);
+
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	if (kick)
+		sw_serial_dma_start_tx(p);
+#endif
 }
 
 static unsigned int sw_serial_in32(struct uart_port *p, int offset)
@@ -150,34 +648,61 @@ static int sw_serial_handle_irq(struct uart_port *p)
 {
 	struct sw_serial_port *d = p->private_data;
 	unsigned int iir = p->serial_in(p, UART_IIR);
+	unsigned long flags;
+	int ret;
+
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	if (d->dma && d->dma->running)
+		ret = sw_serial_dma_handle_irq(p, iir);
+	else
+#endif
+		ret = serial8250_handle_irq(p, iir);
 
-	if (serial8250_handle_irq(p, iir)) {
+	if (ret) {
 		return 1;
 	} else if ((iir & UART_IIR_BUSY) == UART_IIR_BUSY) {
-		if (p->serial_in(p, UART_USR) & 1) {
-			p->serial_out(p, UART_HALT, UART_FORCE_CFG);
-			p->serial_out(p, UART_LCR, d->last_lcr);
-			p->serial_out(p, UART_HALT, UART_FORCE_CFG | UART_FORCE_UPDATE);
-			while(p->serial_in(p, UART_HALT) & UART_FORCE_UPDATE);
-			p->serial_out(p, UART_HALT, 0x00);
-			p->serial_in(p, UART_USR);
-		} else
-			p->serial_out(p, UART_LCR, d->last_lcr);
+		spin_lock_irqsave(&p->lock, flags);
+		d->busy_irqs++;
+		if (sw_serial_fix_lcr(p))
+			sw_serial_defer_lcr(p);
+		spin_unlock_irqrestore(&p->lock, flags);
 		return 1;
 	}
 
 	return 0;
 }
 
+static ssize_t sw_serial_busy_stats_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct sw_serial_port *d = platform_get_drvdata(to_platform_device(dev));
+
+	return sprintf(buf, "busy_irqs %lu lcr_missed %lu lcr_forced %lu "
+		       "lcr_failed %lu\n", d->busy_irqs, d->lcr_missed,
+		       d->lcr_forced, d->lcr_failed);
+}
+
+static DEVICE_ATTR(busy_stats, S_IRUGO, sw_serial_busy_stats_show, NULL);
+
 static void sw_serial_pm(struct uart_port *port, unsigned int state,
 			 unsigned int oldstate)
 {
 	struct sw_serial_port *up = port->private_data;
 
-	if (!state)
+	if (!state) {
 		clk_enable(up->clk);
-	else
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+		if (up->dma && !up->dma->running)
+			sw_serial_dma_start(port);
+#endif
+	} else {
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+		if (up->dma && up->dma->running)
+			sw_serial_dma_stop(port);
+#endif
 		clk_disable(up->clk);
+	}
 }
 
 static int __devinit sw_serial_probe(struct platform_device *dev)
@@ -191,12 +716,18 @@ static int __devinit sw_serial_probe(struct platform_device *dev)
 		return -ENOMEM;
 	sport->port_no = dev->id;
 	sport->pdev = dev;
+	setup_timer(&sport->busy_timer, sw_serial_busy_timer, 0);
 
 	ret = sw_serial_get_resource(sport);
 	if (ret) {
 		printk(KERN_ERR "Failed to get resource\n");
 		goto free_dev;
 	}
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	ret = sw_serial_dma_request(sport);
+	if (ret)
+		goto put_res;
+#endif
 
 	port.private_data = sport;
 	port.irq = sport->irq;
@@ -216,12 +747,24 @@ static int __devinit sw_serial_probe(struct platform_device *dev)
 		sport->irq, sport->mmres->start);
 	ret = serial8250_register_port(&port);
 	if (ret < 0)
-		goto free_dev;
+		goto free_dma;
 
 	sport->line = ret;
 	platform_set_drvdata(dev, sport);
+	if (device_create_file(&dev->dev, &dev_attr_busy_stats))
+		pr_warn("uart%d: no busy_stats attribute\n", sport->port_no);
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	if (sport->dma && device_create_file(&dev->dev, &dev_attr_dma_stats))
+		pr_warn("uart%d: no dma_stats attribute\n", sport->port_no);
+#endif
 	return 0;
 
+ free_dma:
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	sw_serial_dma_release(sport);
+ put_res:
+#endif
+	sw_serial_put_resource(sport);
  free_dev:
 	kfree(sport);
 	sport = NULL;
@@ -234,6 +777,13 @@ static int __devexit sw_serial_remove(struct platform_device *dev)
 
 	pr_info("serial remove\n");
 	serial8250_unregister_port(sport->line);
+	del_timer_sync(&sport->busy_timer);
+	device_remove_file(&dev->dev, &dev_attr_busy_stats);
+#ifdef CONFIG_SERIAL_8250_SUNXI_DMA
+	if (sport->dma)
+		device_remove_file(&dev->dev, &dev_attr_dma_stats);
+	sw_serial_dma_release(sport);
+#endif
 	sw_serial_put_resource(sport);
 
 	platform_set_drvdata(dev, NULL);
@@ -267,6 +817,8 @@ static struct resource sw_uart_res[8][2] = {
 };
 #undef RES
 
+static u64 sw_uart_dmamask = DMA_BIT_MASK(32);
+
 void
 sw_serial_device_release(struct device *dev)
 {
@@ -277,49 +829,65 @@ static struct platform_device sw_uart_dev[] = {
 	[0] = {.name = "sunxi-uart", .id = 0,
 			.num_resources = ARRAY_SIZE(sw_uart_res[0]),
 			.resource = &sw_uart_res[0][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[1] = {.name = "sunxi-uart", .id = 1,
 			.num_resources = ARRAY_SIZE(sw_uart_res[1]),
 			.resource = &sw_uart_res[1][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[2] = {.name = "sunxi-uart", .id = 2,
 			.num_resources = ARRAY_SIZE(sw_uart_res[2]),
 			.resource = &sw_uart_res[2][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[3] = {.name = "sunxi-uart", .id = 3,
 			.num_resources = ARRAY_SIZE(sw_uart_res[3]),
 			.resource = &sw_uart_res[3][0], .dev = {
-			.release = &sw_serial_device_release
+			.release = &sw_serial_device_release,
+			.dma_mask = &sw_uart_dmamask,
+			.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[4] = {.name = "sunxi-uart", .id = 4,
 			.num_resources = ARRAY_SIZE(sw_uart_res[4]),
 			.resource = &sw_uart_res[4][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[5] = {.name = "sunxi-uart", .id = 5,
 			.num_resources = ARRAY_SIZE(sw_uart_res[5]),
 			.resource = &sw_uart_res[5][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[6] = {.name = "sunxi-uart", .id = 6,
 			.num_resources = ARRAY_SIZE(sw_uart_res[6]),
 			.resource = &sw_uart_res[6][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 	[7] = {.name = "sunxi-uart", .id = 7,
 			.num_resources = ARRAY_SIZE(sw_uart_res[7]),
 			.resource = &sw_uart_res[7][0], .dev = {
-					.release = &sw_serial_device_release
+					.release = &sw_serial_device_release,
+					.dma_mask = &sw_uart_dmamask,
+					.coherent_dma_mask = DMA_BIT_MASK(32)
 			}
 	},
 };
@@ -31,8 +31,10 @@
 #include <linux/platform_device.h>
 #include <linux/time.h>
 #include <linux/timer.h>
+#include <linux/log2.h>
 
 #include <plat/sys_config.h>
+#include <plat/system.h>
 #include <linux/clk.h>
 
 #include  <mach/clock.h>
@@ -43,6 +45,25 @@
 static struct sw_hci_hcd *g_sw_ehci[3];
 static u32 ehci_first_probe[3] = { 1, 1, 1 };
 
+/*
+ * Periodic schedule tuning of usb1 and usb2, 0 keeps the ehci-hcd
+ * default. A higher interrupt threshold means fewer interrupts, but
+ * isochronous URBs have to queue that much more data to ride out the
+ * latency. A shorter frame list is fetched from dram less, but limits
+ * how far ahead isochronous URBs can be scheduled.
+ */
+static unsigned int sw_ehci_itc[2];
+module_param_array(sw_ehci_itc, uint, NULL, S_IRUGO);
+MODULE_PARM_DESC(sw_ehci_itc, "usb1,usb2 IRQ threshold, 1-64 microframes");
+
+static unsigned int sw_ehci_frame_list[2];
+module_param_array(sw_ehci_frame_list, uint, NULL, S_IRUGO);
+MODULE_PARM_DESC(sw_ehci_frame_list, "usb1,usb2 frame list size, 256, 512 or 1024");
+
+static unsigned int sw_ehci_periodic_max[2];
+module_param_array(sw_ehci_periodic_max, uint, NULL, S_IRUGO);
+MODULE_PARM_DESC(sw_ehci_periodic_max, "usb1,usb2 periodic usec per microframe, 100-125");
+
 static void sw_start_ehci(struct sw_hci_hcd *sw_ehci)
 {
 	sw_ehci->open_clock(sw_ehci, 0);
@@ -63,9 +84,68 @@ static void sw_stop_ehci(struct sw_hci_hcd *sw_ehci)
 	return;
 }
 
+static inline struct sw_hci_hcd *hcd_to_sw_ehci(struct usb_hcd *hcd)
+{
+	return hcd->self.controller->platform_data;
+}
+
+/* ITC field of USBCMD, microframes as they are */
+static void sw_ehci_set_itc(struct ehci_hcd *ehci, unsigned int uframes)
+{
+	ehci->command &= ~(0xff << 16);
+	ehci->command |= uframes << 16;
+}
+
+/* still halted, the table holds nothing but list ends */
+static int sw_ehci_set_frame_list(struct ehci_hcd *ehci, unsigned int size)
+{
+	struct device *dev = ehci_to_hcd(ehci)->self.controller;
+	__le32 *periodic;
+	dma_addr_t periodic_dma;
+	union ehci_shadow *pshadow;
+	int i;
+
+	if (size == ehci->periodic_size)
+		return 0;
+	if (!HCC_PGM_FRAMELISTLEN(ehci_readl(ehci, &ehci->caps->hcc_params))) {
+		ehci_info(ehci, "frame list length isn't programmable\n");
+		return 0;
+	}
+
+	periodic = dma_alloc_coherent(dev, size * sizeof(__le32),
+				      &periodic_dma, 0);
+	if (!periodic)
+		return -ENOMEM;
+	pshadow = kcalloc(size, sizeof(void *), GFP_KERNEL);
+	if (!pshadow) {
+		dma_free_coherent(dev, size * sizeof(__le32), periodic,
+				  periodic_dma);
+		return -ENOMEM;
+	}
+	for (i = 0; i < size; i++)
+		periodic[i] = EHCI_LIST_END(ehci);
+
+	dma_free_coherent(dev, ehci->periodic_size * sizeof(__le32),
+			  ehci->periodic, ehci->periodic_dma);
+	kfree(ehci->pshadow);
+
+	ehci->periodic = periodic;
+	ehci->periodic_dma = periodic_dma;
+	ehci->pshadow = pshadow;
+	ehci->periodic_size = size;
+
+	ehci->command &= ~(3 << 2);
+	ehci->command |= (size == 1024 ? 0 : size == 512 ? 1 : 2) << 2;
+
+	return 0;
+}
+
 static int sw_ehci_setup(struct usb_hcd *hcd)
 {
 	struct ehci_hcd *ehci = hcd_to_ehci(hcd);
+	struct sw_hci_hcd *sw_ehci = hcd_to_sw_ehci(hcd);
+	int n = sw_ehci->usbc_no - 1;
+	unsigned int v;
 	int ret;
 
 	ret = ehci_setup(hcd);
@@ -76,9 +156,84 @@ static int sw_ehci_setup(struct usb_hcd *hcd)
 	 * disable watchdog. */
 	ehci->need_io_watchdog = 0;
 
+	v = sw_ehci_itc[n];
+	if (v && v <= 64 && is_power_of_2(v))
+		sw_ehci_set_itc(ehci, v);
+
+	v = sw_ehci_frame_list[n];
+	if (v == 256 || v == 512 || v == 1024) {
+		ret = sw_ehci_set_frame_list(ehci, v);
+		if (ret)
+			return ret;
+	}
+
+	v = sw_ehci_periodic_max[n];
+	if (v >= 100 && v <= 125)
+		ehci->uframe_periodic_max = v;
+
+	ehci_info(ehci, "itc %u uframes, frame list %u, periodic %u usec\n",
+		  (ehci->command >> 16) & 0xff, ehci->periodic_size,
+		  ehci->uframe_periodic_max);
+
 	return ret;
 }
 
+static irqreturn_t sw_ehci_irq(struct usb_hcd *hcd)
+{
+	struct ehci_hcd *ehci = hcd_to_ehci(hcd);
+	struct sw_hci_hcd *sw_ehci = hcd_to_sw_ehci(hcd);
+	u32 status;
+
+	status = ehci_readl(ehci, &ehci->regs->status) & INTR_MASK;
+	if (status) {
+		sw_ehci->irq_count++;
+		if (status & STS_INT)
+			sw_ehci->irq_complete++;
+		if (status & (STS_ERR | STS_FATAL))
+			sw_ehci->irq_error++;
+	}
+
+	return ehci_irq(hcd);
+}
+
+/* the threshold may change while the schedule runs */
+static ssize_t sw_ehci_itc_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct ehci_hcd *ehci = hcd_to_ehci(dev_get_drvdata(dev));
+
+	return sprintf(buf, "%u\n", (ehci->command >> 16) & 0xff);
+}
+
+static ssize_t sw_ehci_itc_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct usb_hcd *hcd = dev_get_drvdata(dev);
+	struct ehci_hcd *ehci = hcd_to_ehci(hcd);
+	unsigned long flags;
+	unsigned int uframes;
+	u32 cmd;
+
+	if (kstrtouint(buf, 0, &uframes) || !uframes || uframes > 64 ||
+	    !is_power_of_2(uframes))
+		return -EINVAL;
+
+	spin_lock_irqsave(&ehci->lock, flags);
+	sw_ehci_set_itc(ehci, uframes);
+	if (HC_IS_RUNNING(hcd->state)) {
+		cmd = ehci_readl(ehci, &ehci->regs->command) & ~CMD_IAAD;
+		cmd &= ~(0xff << 16);
+		cmd |= uframes << 16;
+		ehci_writel(ehci, cmd, &ehci->regs->command);
+	}
+	spin_unlock_irqrestore(&ehci->lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR(itc, 0644, sw_ehci_itc_show, sw_ehci_itc_store);
+
 static const struct hc_driver sw_ehci_hc_driver = {
 	.description = hcd_name,
 	.product_desc = "SW USB2.0 'Enhanced' Host Controller (EHCI) Driver",
@@ -87,7 +242,7 @@ static const struct hc_driver sw_ehci_hc_driver = {
 	/*
 	 * generic hardware linkage
 	 */
-	.irq = ehci_irq,
+	.irq = sw_ehci_irq,
 	.flags = HCD_MEMORY | HCD_USB2,
 
 	/*
@@ -150,6 +305,9 @@ static int sw_ehci_hcd_remove(struct platform_device *pdev)
 		" 0x%p\n", SW_EHCI_NAME, sw_ehci->usbc_no, pdev->name, pdev->id,
 		sw_ehci);
 
+	device_remove_file(&pdev->dev, &dev_attr_itc);
+	sw_hci_remove_irq_stats(&pdev->dev);
+	sunxi_irq_unspread(hcd->irq);
 	usb_remove_hcd(hcd);
 
 	iounmap(hcd->regs);
@@ -263,8 +421,15 @@ static int sw_ehci_hcd_probe(struct platform_device *pdev)
 		goto err_add_hcd;
 	}
 
+	sunxi_irq_spread(irq, SUNXI_IRQ_SLOT_USB(sw_ehci->usbc_no));
+
 	platform_set_drvdata(pdev, hcd);
 
+	if (device_create_file(&pdev->dev, &dev_attr_itc) ||
+	    sw_hci_add_irq_stats(&pdev->dev))
+		pr_warn("[%s]: ehci tuning files not created\n",
+			sw_ehci->hci_name);
+
 	pr_debug("[%s]: probe, clock: SW_VA_CCM_AHBMOD_OFFSET(0x%x), SW_VA_CCM_USBCLK_OFFSET(0x%x);"
 	     " usb: 0x800(0x%x), dram:(0x%x, 0x%x)\n",
 	     sw_ehci->hci_name, (u32) readl(SW_VA_CCM_IO_BASE + SW_VA_CCM_AHBMOD_OFFSET),
@@ -35,6 +35,7 @@
 #include <linux/timer.h>
 
 #include <plat/sys_config.h>
+#include <plat/system.h>
 #include <linux/clk.h>
 
 #include  <mach/clock.h>
@@ -83,6 +84,25 @@ static int __devinit sw_ohci_start(struct usb_hcd *hcd)
 	return 0;
 }
 
+static irqreturn_t sw_ohci_irq(struct usb_hcd *hcd)
+{
+	struct ohci_hcd *ohci = hcd_to_ohci(hcd);
+	struct sw_hci_hcd *sw_ohci = hcd->self.controller->platform_data;
+	u32 ints;
+
+	ints = ohci_readl(ohci, &ohci->regs->intrstatus) &
+			ohci_readl(ohci, &ohci->regs->intrenable);
+	if (ints) {
+		sw_ohci->irq_count++;
+		if (ints & OHCI_INTR_WDH)
+			sw_ohci->irq_complete++;
+		if (ints & (OHCI_INTR_SO | OHCI_INTR_UE))
+			sw_ohci->irq_error++;
+	}
+
+	return ohci_irq(hcd);
+}
+
 static const struct hc_driver sw_ohci_hc_driver = {
 	.description = hcd_name,
 	.product_desc = "SW USB2.0 'Open' Host Controller (OHCI) Driver",
@@ -91,7 +111,7 @@ static const struct hc_driver sw_ohci_hc_driver = {
 	/*
 	 * generic hardware linkage
 	 */
-	.irq = ohci_irq,
+	.irq = sw_ohci_irq,
 	.flags = HCD_USB11 | HCD_MEMORY,
 
 	/*
@@ -152,6 +172,8 @@ static int sw_ohci_hcd_remove(struct platform_device *pdev)
 		" 0x%p\n", SW_OHCI_NAME, sw_ohci->usbc_no, pdev->name, pdev->id,
 		sw_ohci);
 
+	sw_hci_remove_irq_stats(&pdev->dev);
+	sunxi_irq_unspread(hcd->irq);
 	usb_remove_hcd(hcd);
 
 	sw_stop_ohc(sw_ohci);
@@ -262,8 +284,13 @@ static int sw_ohci_hcd_probe(struct platform_device *pdev)
 		goto err_add_hcd;
 	}
 
+	sunxi_irq_spread(irq, SUNXI_IRQ_SLOT_USB(sw_ohci->usbc_no));
+
 	platform_set_drvdata(pdev, hcd);
 
+	if (sw_hci_add_irq_stats(&pdev->dev))
+		pr_warn("[%s]: irq_stats not created\n", sw_ohci->hci_name);
+
 	pr_debug("[%s]: probe, clock: SW_VA_CCM_AHBMOD_OFFSET(0x%x), SW_VA_CCM_USBCLK_OFFSET(0x%x);"
 	     " usb: SW_USB_PMU_IRQ_ENABLE(0x%x), dram:(0x%x, 0x%x)\n",
 	     sw_ohci->hci_name, (u32) readl(SW_VA_CCM_IO_BASE + SW_VA_CCM_AHBMOD_OFFSET),
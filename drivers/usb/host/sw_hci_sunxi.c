@@ -43,6 +43,7 @@
 #include <linux/seq_file.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/scatterlist.h>
 
 #include <linux/usb.h>
 #include <linux/usb/hcd.h>
@@ -502,11 +503,27 @@ static void sw_set_vbus(struct sw_hci_hcd *sw_hci, int is_on)
 }
 
 struct temp_buffer {
+	struct list_head list;		/* on the class free list */
+	struct sw_hci_bounce_class *cls; /* NULL when kmalloc'ed for one URB */
 	void *kmalloc_ptr;
 	void *old_buffer;
+	struct scatterlist *old_sg;	/* the list data was gathered from */
+	int old_num_sgs;
 	u8 data[];
 };
 
+/* data size and number of pooled buffers of each class */
+static const struct {
+	size_t size;
+	unsigned int count;
+} bounce_classes[SW_HCI_BOUNCE_CLASSES] = {
+	{ 64, 8 },	/* setup packets, interrupt URBs */
+	{ 512, 16 },	/* full speed bulk packets, small Wi-Fi frames */
+	{ 4096, 4 },	/* Wi-Fi aggregates, DVB transport stream URBs */
+};
+
+static struct dentry *sw_hci_debugfs_root;
+
 static void *alloc_temp_buffer(size_t size, gfp_t mem_flags)
 {
 	struct temp_buffer *temp, *kmalloc_ptr;
@@ -527,13 +544,163 @@ static void *alloc_temp_buffer(size_t size, gfp_t mem_flags)
 	temp = PTR_ALIGN(kmalloc_ptr + 1, SUNXI_USB_DMA_ALIGN) - 1;
 
 	temp->kmalloc_ptr = kmalloc_ptr;
+	temp->cls = NULL;
+	temp->old_sg = NULL;
+	return temp;
+}
+
+static void bounce_init(struct sw_hci_hcd *sw_hci)
+{
+	struct sw_hci_bounce_class *cls;
+	struct temp_buffer *temp;
+	int i, j;
+
+	spin_lock_init(&sw_hci->bounce_lock);
+
+	for (i = 0; i < SW_HCI_BOUNCE_CLASSES; i++) {
+		cls = &sw_hci->bounce[i];
+		cls->size = bounce_classes[i].size;
+		INIT_LIST_HEAD(&cls->free);
+
+		for (j = 0; j < bounce_classes[i].count; j++) {
+			temp = alloc_temp_buffer(cls->size, GFP_KERNEL);
+			if (!temp)
+				break;
+			temp->cls = cls;
+			list_add(&temp->list, &cls->free);
+			cls->count++;
+			cls->idle++;
+		}
+	}
+}
+
+/* the hcds are gone, every pooled buffer is back on its list */
+static void bounce_exit(struct sw_hci_hcd *sw_hci)
+{
+	struct temp_buffer *temp, *tmp;
+	int i;
+
+	for (i = 0; i < SW_HCI_BOUNCE_CLASSES; i++) {
+		list_for_each_entry_safe(temp, tmp, &sw_hci->bounce[i].free,
+					 list) {
+			list_del(&temp->list);
+			kfree(temp->kmalloc_ptr);
+		}
+		sw_hci->bounce[i].count = 0;
+		sw_hci->bounce[i].idle = 0;
+	}
+}
+
+/* the smallest free pooled buffer that fits, else a kmalloc'ed one */
+static struct temp_buffer *get_temp_buffer(struct sw_hci_hcd *sw_hci,
+					   size_t size, gfp_t mem_flags)
+{
+	struct sw_hci_bounce_class *cls;
+	struct temp_buffer *temp = NULL;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&sw_hci->bounce_lock, flags);
+	for (i = 0; i < SW_HCI_BOUNCE_CLASSES; i++) {
+		cls = &sw_hci->bounce[i];
+		if (cls->size < size || list_empty(&cls->free))
+			continue;
+		temp = list_first_entry(&cls->free, struct temp_buffer, list);
+		list_del(&temp->list);
+		cls->idle--;
+		break;
+	}
+	if (!temp)
+		sw_hci->bounce_miss++;
+	spin_unlock_irqrestore(&sw_hci->bounce_lock, flags);
+
+	if (!temp)
+		temp = alloc_temp_buffer(size, mem_flags);
+
 	return temp;
 }
 
-static void sunxi_hcd_free_temp_buffer(struct urb *urb)
+static void put_temp_buffer(struct sw_hci_hcd *sw_hci,
+			    struct temp_buffer *temp)
+{
+	unsigned long flags;
+
+	if (!temp->cls) {
+		kfree(temp->kmalloc_ptr);
+		return;
+	}
+
+	spin_lock_irqsave(&sw_hci->bounce_lock, flags);
+	list_add(&temp->list, &temp->cls->free);
+	temp->cls->idle++;
+	spin_unlock_irqrestore(&sw_hci->bounce_lock, flags);
+}
+
+static int bounce_show(struct seq_file *s, void *unused)
+{
+	struct sw_hci_hcd *sw_hci = s->private;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&sw_hci->bounce_lock, flags);
+	seq_printf(s, "urbs:  %lu\n", sw_hci->bounce_urbs);
+	seq_printf(s, "bytes: %lu\n", sw_hci->bounce_bytes);
+	seq_printf(s, "setup: %lu\n", sw_hci->bounce_setup);
+	seq_printf(s, "miss:  %lu\n", sw_hci->bounce_miss);
+	for (i = 0; i < SW_HCI_BOUNCE_CLASSES; i++)
+		seq_printf(s, "pool %zu: %u/%u free\n", sw_hci->bounce[i].size,
+			   sw_hci->bounce[i].idle, sw_hci->bounce[i].count);
+	spin_unlock_irqrestore(&sw_hci->bounce_lock, flags);
+
+	return 0;
+}
+
+static int bounce_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bounce_show, inode->i_private);
+}
+
+static const struct file_operations bounce_fops = {
+	.open = bounce_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static inline struct sw_hci_hcd *hcd_to_sw_hci(struct usb_hcd *hcd)
+{
+	return dev_get_platdata(hcd->self.controller);
+}
+
+/*
+ * The controller needs the start of a buffer DMA aligned. A buffer that
+ * starts aligned is used as it is whatever its length, the dma mapping
+ * takes care of the cache line its tail ends in.
+ */
+static inline int need_bounce(const void *buf)
+{
+	return ((uintptr_t)buf & (SUNXI_USB_DMA_ALIGN - 1)) != 0;
+}
+
+/* the same goes for each element of a scatter-gather list */
+static int need_bounce_sg(struct urb *urb)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(urb->sg, sg, urb->num_sgs ? : 1, i)
+		if (sg->offset & (SUNXI_USB_DMA_ALIGN - 1))
+			return 1;
+
+	return 0;
+}
+
+static void sunxi_hcd_free_temp_buffer(struct sw_hci_hcd *sw_hci,
+				       struct urb *urb)
 {
 	enum dma_data_direction dir;
 	struct temp_buffer *temp;
+	size_t length;
 
 	if (!(urb->transfer_flags & URB_ALIGNED_TEMP_BUFFER))
 		return;
@@ -542,53 +709,82 @@ static void sunxi_hcd_free_temp_buffer(struct urb *urb)
 
 	temp = container_of(urb->transfer_buffer, struct temp_buffer, data);
 
-	if (dir == DMA_FROM_DEVICE)
-		memcpy(temp->old_buffer, temp->data,
-		       urb->transfer_buffer_length);
+	/* only what the device sent, iso frames are spread over the buffer */
+	length = usb_pipeisoc(urb->pipe) ? urb->transfer_buffer_length :
+			urb->actual_length;
+	if (temp->old_sg) {
+		if (dir == DMA_FROM_DEVICE)
+			sg_copy_from_buffer(temp->old_sg,
+					    temp->old_num_sgs ? : 1,
+					    temp->data, length);
+		urb->sg = temp->old_sg;
+		urb->num_sgs = temp->old_num_sgs;
+		temp->old_sg = NULL;
+	} else if (dir == DMA_FROM_DEVICE) {
+		memcpy(temp->old_buffer, temp->data, length);
+	}
 
 	urb->transfer_buffer = temp->old_buffer;
-	kfree(temp->kmalloc_ptr);
+	put_temp_buffer(sw_hci, temp);
 
 	urb->transfer_flags &= ~URB_ALIGNED_TEMP_BUFFER;
 }
 
-static int sunxi_hcd_alloc_temp_buffer(struct urb *urb, gfp_t mem_flags)
+static int sunxi_hcd_alloc_temp_buffer(struct sw_hci_hcd *sw_hci,
+				       struct urb *urb, gfp_t mem_flags)
 {
 	enum dma_data_direction dir;
 	struct temp_buffer *temp;
+	unsigned long flags;
 
-	if (urb->num_sgs)
-		return 0;
-	if (urb->sg)
-		return 0;
 	if (urb->transfer_buffer_length == 0)
 		return 0;
 	if (urb->transfer_flags & URB_NO_TRANSFER_DMA_MAP)
 		return 0;
 
-	/* sunxi hardware requires transfer buffers to be DMA aligned */
-	if (!((uintptr_t)urb->transfer_buffer & (SUNXI_USB_DMA_ALIGN - 1)))
+	if (urb->sg) {
+		if (!need_bounce_sg(urb))
+			return 0;
+	} else if (!need_bounce(urb->transfer_buffer)) {
 		return 0;
+	}
 
-	/* Allocate a buffer with enough padding for alignment */
-	temp = alloc_temp_buffer(urb->transfer_buffer_length, mem_flags);
+	temp = get_temp_buffer(sw_hci, urb->transfer_buffer_length,
+			       mem_flags);
 	if (!temp)
 		return -ENOMEM;
 
 	dir = usb_urb_dir_in(urb) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
 
 	temp->old_buffer = urb->transfer_buffer;
-	if (dir == DMA_TO_DEVICE)
+	if (urb->sg) {
+		/* gathered into one buffer, the hcd sees a linear URB */
+		if (dir == DMA_TO_DEVICE)
+			sg_copy_to_buffer(urb->sg, urb->num_sgs ? : 1,
+					  temp->data,
+					  urb->transfer_buffer_length);
+		temp->old_sg = urb->sg;
+		temp->old_num_sgs = urb->num_sgs;
+		urb->sg = NULL;
+		urb->num_sgs = 0;
+	} else if (dir == DMA_TO_DEVICE) {
 		memcpy(temp->data, urb->transfer_buffer,
 		       urb->transfer_buffer_length);
+	}
 	urb->transfer_buffer = temp->data;
 
 	urb->transfer_flags |= URB_ALIGNED_TEMP_BUFFER;
 
+	spin_lock_irqsave(&sw_hci->bounce_lock, flags);
+	sw_hci->bounce_urbs++;
+	sw_hci->bounce_bytes += urb->transfer_buffer_length;
+	spin_unlock_irqrestore(&sw_hci->bounce_lock, flags);
+
 	return 0;
 }
 
-static void sunxi_hcd_free_temp_setup(struct urb *urb)
+static void sunxi_hcd_free_temp_setup(struct sw_hci_hcd *sw_hci,
+				      struct urb *urb)
 {
 	struct temp_buffer *temp;
 
@@ -599,24 +795,26 @@ static void sunxi_hcd_free_temp_setup(struct urb *urb)
 			    data);
 
 	urb->setup_packet = temp->old_buffer;
-	kfree(temp->kmalloc_ptr);
+	put_temp_buffer(sw_hci, temp);
 
 	urb->transfer_flags &= ~URB_ALIGNED_TEMP_SETUP;
 }
 
-static int sunxi_hcd_alloc_temp_setup(struct urb *urb, gfp_t mem_flags)
+static int sunxi_hcd_alloc_temp_setup(struct sw_hci_hcd *sw_hci,
+				      struct urb *urb, gfp_t mem_flags)
 {
 	struct temp_buffer *temp;
+	unsigned long flags;
 
 	if (!usb_endpoint_xfer_control(&urb->ep->desc))
 		return 0;
 
 	/* sunxi hardware requires setup packet to be DMA aligned */
-	if (!((uintptr_t)urb->setup_packet & (SUNXI_USB_DMA_ALIGN - 1)))
+	if (!need_bounce(urb->setup_packet))
 		return 0;
 
-	/* Allocate a buffer with enough padding for alignment */
-	temp = alloc_temp_buffer(sizeof(struct usb_ctrlrequest), mem_flags);
+	temp = get_temp_buffer(sw_hci, sizeof(struct usb_ctrlrequest),
+			       mem_flags);
 	if (!temp)
 		return -ENOMEM;
 
@@ -626,28 +824,33 @@ static int sunxi_hcd_alloc_temp_setup(struct urb *urb, gfp_t mem_flags)
 
 	urb->transfer_flags |= URB_ALIGNED_TEMP_SETUP;
 
+	spin_lock_irqsave(&sw_hci->bounce_lock, flags);
+	sw_hci->bounce_setup++;
+	spin_unlock_irqrestore(&sw_hci->bounce_lock, flags);
+
 	return 0;
 }
 
 int sunxi_hcd_map_urb_for_dma(struct usb_hcd *hcd, struct urb *urb,
 				     gfp_t mem_flags)
 {
+	struct sw_hci_hcd *sw_hci = hcd_to_sw_hci(hcd);
 	int ret;
 
-	ret = sunxi_hcd_alloc_temp_buffer(urb, mem_flags);
+	ret = sunxi_hcd_alloc_temp_buffer(sw_hci, urb, mem_flags);
 	if (ret)
 		return ret;
 
-	ret = sunxi_hcd_alloc_temp_setup(urb, mem_flags);
+	ret = sunxi_hcd_alloc_temp_setup(sw_hci, urb, mem_flags);
 	if (ret) {
-		sunxi_hcd_free_temp_buffer(urb);
+		sunxi_hcd_free_temp_buffer(sw_hci, urb);
 		return ret;
 	}
 
 	ret = usb_hcd_map_urb_for_dma(hcd, urb, mem_flags);
 	if (ret) {
-		sunxi_hcd_free_temp_setup(urb);
-		sunxi_hcd_free_temp_buffer(urb);
+		sunxi_hcd_free_temp_setup(sw_hci, urb);
+		sunxi_hcd_free_temp_buffer(sw_hci, urb);
 		return ret;
 	}
 
@@ -657,12 +860,38 @@ EXPORT_SYMBOL_GPL(sunxi_hcd_map_urb_for_dma);
 
 void sunxi_hcd_unmap_urb_for_dma(struct usb_hcd *hcd, struct urb *urb)
 {
+	struct sw_hci_hcd *sw_hci = hcd_to_sw_hci(hcd);
+
 	usb_hcd_unmap_urb_for_dma(hcd, urb);
-	sunxi_hcd_free_temp_setup(urb);
-	sunxi_hcd_free_temp_buffer(urb);
+	sunxi_hcd_free_temp_setup(sw_hci, urb);
+	sunxi_hcd_free_temp_buffer(sw_hci, urb);
 }
 EXPORT_SYMBOL_GPL(sunxi_hcd_unmap_urb_for_dma);
 
+static ssize_t irq_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct sw_hci_hcd *sw_hci = dev_get_platdata(dev);
+
+	return sprintf(buf, "irqs:     %lu\ncomplete: %lu\nerror:    %lu\n",
+		       sw_hci->irq_count, sw_hci->irq_complete,
+		       sw_hci->irq_error);
+}
+
+static DEVICE_ATTR(irq_stats, 0444, irq_stats_show, NULL);
+
+int sw_hci_add_irq_stats(struct device *dev)
+{
+	return device_create_file(dev, &dev_attr_irq_stats);
+}
+EXPORT_SYMBOL_GPL(sw_hci_add_irq_stats);
+
+void sw_hci_remove_irq_stats(struct device *dev)
+{
+	device_remove_file(dev, &dev_attr_irq_stats);
+}
+EXPORT_SYMBOL_GPL(sw_hci_remove_irq_stats);
+
 /*
  *---------------------------------------------------------------
  * EHCI
@@ -838,6 +1067,17 @@ failed1:
 	return -1;
 }
 
+/* bounce pool and its debugfs file, before the hcd can queue URBs */
+static void sw_hci_bounce_register(struct sw_hci_hcd *sw_hci)
+{
+	bounce_init(sw_hci);
+
+	if (!IS_ERR_OR_NULL(sw_hci_debugfs_root))
+		sw_hci->debugfs = debugfs_create_file(sw_hci->hci_name, 0444,
+						      sw_hci_debugfs_root,
+						      sw_hci, &bounce_fops);
+}
+
 static int __init sw_hci_sunxi_init(void)
 {
 /* XXX Should be rewtitten with checks if CONFIG_USB_EHCI_HCD or CONFIG_USB_OHCI_HCD
@@ -863,8 +1103,12 @@ static int __init sw_hci_sunxi_init(void)
 		sw_ehci2.used = 0;
 	}
 
+	sw_hci_debugfs_root = debugfs_create_dir("sw_hci", NULL);
+
 /* XXX '.used' flag is for USB port, not for EHCI or OHCI. So it can be checked this way */
 	if (sw_ehci1.used) {
+		sw_hci_bounce_register(&sw_ehci1);
+		sw_hci_bounce_register(&sw_ohci1);
 		platform_device_register(&sw_usb_ehci_device[0]);
 		platform_device_register(&sw_usb_ohci_device[0]);
 	} else {
@@ -872,6 +1116,8 @@ static int __init sw_hci_sunxi_init(void)
 	}
 
 	if (sw_ehci2.used) {
+		sw_hci_bounce_register(&sw_ehci2);
+		sw_hci_bounce_register(&sw_ohci2);
 		platform_device_register(&sw_usb_ehci_device[1]);
 		platform_device_register(&sw_usb_ohci_device[1]);
 	} else {
@@ -891,6 +1137,9 @@ static void __exit sw_hci_sunxi_exit(void)
 		clock_exit(&sw_ehci1, 0);
 		clock_exit(&sw_ohci1, 1);
 
+		bounce_exit(&sw_ehci1);
+		bounce_exit(&sw_ohci1);
+
 		free_pin(sw_ehci1.drv_vbus_Handle);
 	}
 
@@ -901,9 +1150,14 @@ static void __exit sw_hci_sunxi_exit(void)
 		clock_exit(&sw_ehci2, 0);
 		clock_exit(&sw_ohci2, 1);
 
+		bounce_exit(&sw_ehci2);
+		bounce_exit(&sw_ohci2);
+
 		free_pin(sw_ehci2.drv_vbus_Handle);
 	}
 
+	debugfs_remove_recursive(sw_hci_debugfs_root);
+
 	return;
 }
 
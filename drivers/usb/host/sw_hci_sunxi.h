@@ -88,6 +88,19 @@
 #define SW_SDRAM_BP_HPCR_PRIORITY_LEVEL		2
 #define SW_SDRAM_BP_HPCR_ACCESS_EN		0
 
+/*
+ * Pre-allocated aligned bounce buffers by size, taken before falling
+ * back to kmalloc for URBs whose buffer isn't DMA aligned.
+ */
+#define SW_HCI_BOUNCE_CLASSES	3
+
+struct sw_hci_bounce_class {
+	size_t size;		/* data bytes of each buffer */
+	unsigned int count;	/* buffers owned by the class */
+	unsigned int idle;	/* of those on the free list */
+	struct list_head free;
+};
+
 struct sw_hci_hcd {
 	__u32 usbc_no; /* usb controller number */
 	char hci_name[32]; /* hci name */
@@ -116,10 +129,26 @@ struct sw_hci_hcd {
 	void (*set_power) (struct sw_hci_hcd *sw_hci, int is_on);
 	void (*port_configure) (struct sw_hci_hcd *sw_hci, u32 enable);
 	void (*usb_passby) (struct sw_hci_hcd *sw_hci, u32 enable);
+
+	spinlock_t bounce_lock;
+	struct sw_hci_bounce_class bounce[SW_HCI_BOUNCE_CLASSES];
+	/* bounce statistics, in debugfs */
+	unsigned long bounce_urbs;
+	unsigned long bounce_bytes;
+	unsigned long bounce_setup;
+	unsigned long bounce_miss; /* no pooled buffer, kmalloc'ed */
+	struct dentry *debugfs;
+
+	/* interrupts of the hcd, in the irq_stats sysfs file */
+	unsigned long irq_count;
+	unsigned long irq_complete; /* transfer completions */
+	unsigned long irq_error;
 };
 
 extern int sunxi_hcd_map_urb_for_dma(struct usb_hcd *hcd, struct urb *urb,
 				     gfp_t mem_flags);
 extern void sunxi_hcd_unmap_urb_for_dma(struct usb_hcd *hcd, struct urb *urb);
+extern int sw_hci_add_irq_stats(struct device *dev);
+extern void sw_hci_remove_irq_stats(struct device *dev);
 
 #endif /* __SW_HCI_SUNXI_H__ */
@@ -370,7 +370,8 @@ static void txstate(struct musb *musb, struct musb_request *req)
 
 		/* MUSB_TXCSR_P_ISO is still set correctly */
 
-#if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_UX500_DMA)
+#if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_UX500_DMA) || \
+	defined(CONFIG_USB_SUNXI_MUSB_DMA)
 		{
 			if (request_size < musb_ep->packet_sz)
 				musb_ep->dma->desired_mode = 0;
@@ -565,7 +566,8 @@ void musb_g_tx(struct musb *musb, u8 epnum)
 		if ((request->zero && request->length
 			&& (request->length % musb_ep->packet_sz == 0)
 			&& (request->actual == request->length))
-#if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_UX500_DMA)
+#if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_UX500_DMA) || \
+	defined(CONFIG_USB_SUNXI_MUSB_DMA)
 			|| (is_dma && (!dma->desired_mode ||
 				(request->actual &
 					(musb_ep->packet_sz - 1))))
@@ -794,7 +796,7 @@ static void rxstate(struct musb *musb, struct musb_request *req)
 				if (use_dma)
 					return;
 			}
-#elif defined(CONFIG_USB_UX500_DMA)
+#elif defined(CONFIG_USB_UX500_DMA) || defined(CONFIG_USB_SUNXI_MUSB_DMA)
 			if ((is_buffer_mapped(req)) &&
 				(request->actual < request->length)) {
 
@@ -840,6 +842,12 @@ static void rxstate(struct musb *musb, struct musb_request *req)
 							transfer_size))
 
 					return;
+
+				/* no channel, unload this one by pio */
+				csr &= ~(MUSB_RXCSR_DMAENAB
+					| MUSB_RXCSR_AUTOCLEAR
+					| MUSB_RXCSR_DMAMODE);
+				musb_writew(epio, MUSB_RXCSR, csr);
 			}
 #endif	/* Mentor's DMA */
 
@@ -979,7 +987,7 @@ void musb_g_rx(struct musb *musb, u8 epnum)
 			musb_ep->dma->actual_len, request);
 
 #if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_TUSB_OMAP_DMA) || \
-	defined(CONFIG_USB_UX500_DMA)
+	defined(CONFIG_USB_UX500_DMA) || defined(CONFIG_USB_SUNXI_MUSB_DMA)
 		/* Autoclear doesn't clear RxPktRdy for short packets */
 		if ((dma->desired_mode == 0 && !hw_ep->rx_double_buffered)
 				|| (dma->actual_len
@@ -1019,7 +1027,7 @@ void musb_g_rx(struct musb *musb, u8 epnum)
 			return;
 	}
 #if defined(CONFIG_USB_INVENTRA_DMA) || defined(CONFIG_USB_TUSB_OMAP_DMA) || \
-	defined(CONFIG_USB_UX500_DMA)
+	defined(CONFIG_USB_UX500_DMA) || defined(CONFIG_USB_SUNXI_MUSB_DMA)
 exit:
 #endif
 	/* Analyze request */
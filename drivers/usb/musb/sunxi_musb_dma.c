@@ -0,0 +1,422 @@
+/*
+ * Allwinner SUNXI MUSB DMA support
+ *
+ * The musb core of the sunxi OTG port has no DMA engine of its own. The
+ * endpoint FIFOs raise a DRQ of the dedicated DMA controller instead,
+ * and the single USB0 DRQ is routed to one endpoint at a time through
+ * the vendor0 register. Every hw_ep gets a channel, but only one of them
+ * can run at a time; channel_program() fails for the others and the
+ * host/gadget code falls back to PIO for that transfer.
+ *
+ * Based on the Mentor DMA controller code.
+ *  Copyright 2005 Mentor Graphics Corporation
+ *  Copyright (C) 2005-2007 by Texas Instruments
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ */
+#include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+
+#include <mach/platform.h>
+#include <plat/dma_compat.h>
+
+#include "musb_core.h"
+
+#define SUNXI_MUSB_REG_VEND0		0x0043
+#define SUNXI_MUSB_VEND0_DRQ_SEL	1
+#define SUNXI_MUSB_VEND0_BUS_SEL	0
+
+struct sunxi_musb_dma_controller;
+
+struct sunxi_musb_dma_channel {
+	struct dma_channel		channel;
+	struct sunxi_musb_dma_controller *controller;
+	struct musb_hw_ep		*hw_ep;
+	u32				len;
+	u16				max_packet_sz;
+	u8				transmit;
+	u8				allocated;
+};
+
+struct sunxi_musb_dma_controller {
+	struct dma_controller		controller;
+	struct sunxi_musb_dma_channel	tx_channel[MUSB_C_NUM_EPS];
+	struct sunxi_musb_dma_channel	rx_channel[MUSB_C_NUM_EPS];
+	/* channel the drq is routed to, NULL while the bus is on pio */
+	struct sunxi_musb_dma_channel	*active;
+	struct sunxi_dma_params		dma;
+	struct musb			*musb;
+};
+
+/* route the drq to the channel's endpoint, or back to pio for NULL */
+static void sunxi_musb_dma_select(struct sunxi_musb_dma_controller *controller,
+				  struct sunxi_musb_dma_channel *sunxi_channel)
+{
+	void __iomem *mbase = controller->musb->mregs;
+	u8 epnum;
+	u8 reg_val = 0;
+
+	if (sunxi_channel) {
+		epnum = sunxi_channel->hw_ep->epnum;
+		if (sunxi_channel->transmit)
+			reg_val = ((epnum - 1) << 1) << SUNXI_MUSB_VEND0_DRQ_SEL;
+		else
+			reg_val = ((epnum << 1) - 1) << SUNXI_MUSB_VEND0_DRQ_SEL;
+		reg_val |= 1 << SUNXI_MUSB_VEND0_BUS_SEL;
+	}
+
+	/* drq_sel is a field, not a mask; always write it whole */
+	musb_writeb(mbase, SUNXI_MUSB_REG_VEND0, reg_val);
+}
+
+static void sunxi_musb_dma_halt(struct sunxi_musb_dma_controller *controller)
+{
+	sunxi_dma_stop(&controller->dma);
+	sunxi_dma_flush(&controller->dma);
+	sunxi_musb_dma_select(controller, NULL);
+	controller->active = NULL;
+}
+
+static int sunxi_musb_dma_controller_start(struct dma_controller *c)
+{
+	/* nothing to do */
+	return 0;
+}
+
+static int sunxi_musb_dma_controller_stop(struct dma_controller *c)
+{
+	struct sunxi_musb_dma_controller *controller = container_of(c,
+			struct sunxi_musb_dma_controller, controller);
+
+	if (controller->active) {
+		dev_err(controller->musb->controller,
+			"Stopping DMA controller while channel active\n");
+		controller->active->channel.status = MUSB_DMA_STATUS_FREE;
+		sunxi_musb_dma_halt(controller);
+	}
+
+	return 0;
+}
+
+static struct dma_channel *
+sunxi_musb_dma_channel_allocate(struct dma_controller *c,
+				struct musb_hw_ep *hw_ep, u8 transmit)
+{
+	struct sunxi_musb_dma_controller *controller = container_of(c,
+			struct sunxi_musb_dma_controller, controller);
+	struct sunxi_musb_dma_channel *sunxi_channel;
+	struct dma_channel *channel;
+
+	/* ep0 always uses pio */
+	if (!hw_ep->epnum || hw_ep->epnum >= MUSB_C_NUM_EPS)
+		return NULL;
+
+	if (transmit)
+		sunxi_channel = &controller->tx_channel[hw_ep->epnum];
+	else
+		sunxi_channel = &controller->rx_channel[hw_ep->epnum];
+
+	if (sunxi_channel->allocated)
+		return NULL;
+
+	sunxi_channel->allocated = 1;
+	sunxi_channel->controller = controller;
+	sunxi_channel->hw_ep = hw_ep;
+	sunxi_channel->transmit = transmit;
+
+	channel = &sunxi_channel->channel;
+	channel->private_data = sunxi_channel;
+	channel->status = MUSB_DMA_STATUS_FREE;
+	channel->max_len = 0x100000;
+	/* Tx => mode 1; Rx => mode 0 */
+	channel->desired_mode = transmit;
+	channel->actual_len = 0;
+
+	return channel;
+}
+
+static void sunxi_musb_dma_channel_release(struct dma_channel *channel)
+{
+	struct sunxi_musb_dma_channel *sunxi_channel = channel->private_data;
+	struct sunxi_musb_dma_controller *controller = sunxi_channel->controller;
+
+	if (controller->active == sunxi_channel)
+		sunxi_musb_dma_halt(controller);
+
+	channel->actual_len = 0;
+	sunxi_channel->len = 0;
+	sunxi_channel->allocated = 0;
+
+	channel->status = MUSB_DMA_STATUS_UNKNOWN;
+}
+
+static int sunxi_musb_dma_configure(struct sunxi_musb_dma_channel *sunxi_channel,
+				    u16 packet_sz)
+{
+	struct sunxi_musb_dma_controller *controller = sunxi_channel->controller;
+	u32 usb_cmt_blk_cnt = (((packet_sz >> 2) - 1) << 8) | 0x0f;
+	u32 dram_cmt_blk_cnt = ((packet_sz >> 2) - 1) << 8;
+	u32 cmbk;
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	struct dma_hw_conf conf = {
+		.xfer_type = DMAXFER_D_BWORD_S_BWORD,
+		.hf_irq = SW_DMA_IRQ_FULL,
+	};
+
+	if (sunxi_channel->transmit) {
+		conf.dir = SW_DMA_WDEV;
+		conf.to = controller->dma.dma_addr;
+		conf.address_type = DMAADDRT_D_IO_S_LN;
+		conf.drqsrc_type = D_DRQSRC_SDRAM;
+		conf.drqdst_type = D_DRQDST_USB0;
+	} else {
+		conf.dir = SW_DMA_RDEV;
+		conf.from = controller->dma.dma_addr;
+		conf.address_type = DMAADDRT_D_LN_S_IO;
+		conf.drqsrc_type = D_DRQSRC_USB0;
+		conf.drqdst_type = D_DRQDST_SDRAM;
+	}
+#else
+	dma_config_t conf = {
+		.xfer_type = {
+			.src_data_width = DATA_WIDTH_32BIT,
+			.src_bst_len	= DATA_BRST_4,
+			.dst_data_width = DATA_WIDTH_32BIT,
+			.dst_bst_len	= DATA_BRST_4
+		},
+		.bconti_mode	= false,
+		.irq_spt	= CHAN_IRQ_FD
+	};
+
+	if (sunxi_channel->transmit) {
+		conf.address_type.src_addr_mode = DDMA_ADDR_LINEAR;
+		conf.address_type.dst_addr_mode = DDMA_ADDR_IO;
+		conf.src_drq_type = D_SRC_SDRAM;
+		conf.dst_drq_type = D_DST_USB0;
+	} else {
+		conf.address_type.src_addr_mode = DDMA_ADDR_IO;
+		conf.address_type.dst_addr_mode = DDMA_ADDR_LINEAR;
+		conf.src_drq_type = D_SRC_USB0;
+		conf.dst_drq_type = D_DST_SDRAM;
+	}
+#endif
+
+	/* the fifo side moves one packet per drq */
+	if (sunxi_channel->transmit)
+		cmbk = (usb_cmt_blk_cnt << 16) | dram_cmt_blk_cnt;
+	else
+		cmbk = usb_cmt_blk_cnt | (dram_cmt_blk_cnt << 16);
+
+	return sunxi_dma_config(&controller->dma, &conf, cmbk);
+}
+
+static int sunxi_musb_dma_channel_program(struct dma_channel *channel,
+				u16 packet_sz, u8 mode,
+				dma_addr_t dma_addr, u32 len)
+{
+	struct sunxi_musb_dma_channel *sunxi_channel = channel->private_data;
+	struct sunxi_musb_dma_controller *controller = sunxi_channel->controller;
+	struct musb *musb = controller->musb;
+	u8 epnum = sunxi_channel->hw_ep->epnum;
+
+	dev_dbg(musb->controller, "ep%d-%s pkt_sz %d, dma_addr 0x%x length %d, mode %d\n",
+		epnum, sunxi_channel->transmit ? "Tx" : "Rx",
+		packet_sz, dma_addr, len, mode);
+
+	BUG_ON(channel->status == MUSB_DMA_STATUS_UNKNOWN ||
+		channel->status == MUSB_DMA_STATUS_BUSY);
+
+	/* the drq serves one endpoint at a time, the others use pio */
+	if (controller->active)
+		return false;
+
+	/* the channel moves whole words */
+	if ((dma_addr | len) & 0x03 || !len)
+		return false;
+
+	controller->dma.dma_addr = SW_PA_USB0_IO_BASE + MUSB_FIFO_OFFSET(epnum);
+
+	sunxi_musb_dma_select(controller, sunxi_channel);
+
+	if (sunxi_musb_dma_configure(sunxi_channel, packet_sz) ||
+	    sunxi_dma_enqueue(&controller->dma, dma_addr, len,
+			      !sunxi_channel->transmit)) {
+		sunxi_musb_dma_select(controller, NULL);
+		return false;
+	}
+
+	channel->actual_len = 0;
+	channel->desired_mode = mode;
+	sunxi_channel->max_packet_sz = packet_sz;
+	sunxi_channel->len = len;
+	channel->status = MUSB_DMA_STATUS_BUSY;
+	controller->active = sunxi_channel;
+
+	if (sunxi_dma_start(&controller->dma)) {
+		channel->status = MUSB_DMA_STATUS_FREE;
+		sunxi_musb_dma_halt(controller);
+		return false;
+	}
+
+	return true;
+}
+
+static int sunxi_musb_dma_channel_abort(struct dma_channel *channel)
+{
+	struct sunxi_musb_dma_channel *sunxi_channel = channel->private_data;
+	struct sunxi_musb_dma_controller *controller = sunxi_channel->controller;
+	void __iomem *mbase = controller->musb->mregs;
+	u8 epnum = sunxi_channel->hw_ep->epnum;
+	int offset;
+	u16 csr;
+
+	if (channel->status == MUSB_DMA_STATUS_BUSY) {
+		if (sunxi_channel->transmit) {
+			offset = MUSB_EP_OFFSET(epnum, MUSB_TXCSR);
+
+			/*
+			 * The programming guide says that we must clear
+			 * the DMAENAB bit before the DMAMODE bit...
+			 */
+			csr = musb_readw(mbase, offset);
+			csr &= ~(MUSB_TXCSR_AUTOSET | MUSB_TXCSR_DMAENAB);
+			musb_writew(mbase, offset, csr);
+			csr &= ~MUSB_TXCSR_DMAMODE;
+			musb_writew(mbase, offset, csr);
+		} else {
+			offset = MUSB_EP_OFFSET(epnum, MUSB_RXCSR);
+
+			csr = musb_readw(mbase, offset);
+			csr &= ~(MUSB_RXCSR_AUTOCLEAR |
+				 MUSB_RXCSR_DMAENAB |
+				 MUSB_RXCSR_DMAMODE);
+			musb_writew(mbase, offset, csr);
+		}
+
+		if (controller->active == sunxi_channel)
+			sunxi_musb_dma_halt(controller);
+		channel->status = MUSB_DMA_STATUS_FREE;
+	}
+
+	return 0;
+}
+
+static void sunxi_musb_dma_buffdone(struct sunxi_dma_params *dma, void *dev_id)
+{
+	struct sunxi_musb_dma_controller *controller = dev_id;
+	struct musb *musb = controller->musb;
+	void __iomem *mbase = musb->mregs;
+	struct sunxi_musb_dma_channel *sunxi_channel;
+	struct dma_channel *channel;
+	unsigned long flags;
+	u8 epnum;
+
+	spin_lock_irqsave(&musb->lock, flags);
+
+	sunxi_channel = controller->active;
+	if (!sunxi_channel ||
+	    sunxi_channel->channel.status != MUSB_DMA_STATUS_BUSY) {
+		dev_dbg(musb->controller, "spurious DMA irq\n");
+		goto done;
+	}
+
+	channel = &sunxi_channel->channel;
+	epnum = sunxi_channel->hw_ep->epnum;
+
+	/* free the drq before the completion programs the next transfer */
+	sunxi_musb_dma_select(controller, NULL);
+	controller->active = NULL;
+
+	channel->actual_len = sunxi_channel->len;
+	channel->status = MUSB_DMA_STATUS_FREE;
+
+	dev_dbg(musb->controller, "ep%d-%s dma done, %zu bytes\n", epnum,
+		sunxi_channel->transmit ? "Tx" : "Rx", channel->actual_len);
+
+	/* completed */
+	if ((musb_readb(mbase, MUSB_DEVCTL) & MUSB_DEVCTL_HM)
+		&& sunxi_channel->transmit
+		&& (channel->desired_mode == 0
+		    || (channel->actual_len &
+			(sunxi_channel->max_packet_sz - 1)))) {
+		int offset = MUSB_EP_OFFSET(epnum, MUSB_TXCSR);
+		u16 txcsr;
+
+		/*
+		 * The programming guide says that we must clear
+		 * DMAENAB before DMAMODE.
+		 */
+		musb_ep_select(mbase, epnum);
+		txcsr = musb_readw(mbase, offset);
+		txcsr &= ~(MUSB_TXCSR_DMAENAB | MUSB_TXCSR_AUTOSET);
+		musb_writew(mbase, offset, txcsr);
+		/* Send out the packet */
+		txcsr &= ~MUSB_TXCSR_DMAMODE;
+		txcsr |= MUSB_TXCSR_TXPKTRDY;
+		musb_writew(mbase, offset, txcsr);
+	}
+
+	musb_dma_completion(musb, epnum, sunxi_channel->transmit);
+
+done:
+	spin_unlock_irqrestore(&musb->lock, flags);
+}
+
+void dma_controller_destroy(struct dma_controller *c)
+{
+	struct sunxi_musb_dma_controller *controller = container_of(c,
+			struct sunxi_musb_dma_controller, controller);
+
+	if (!controller)
+		return;
+
+	sunxi_dma_release(&controller->dma);
+	kfree(controller);
+}
+
+struct dma_controller *__init
+dma_controller_create(struct musb *musb, void __iomem *base)
+{
+	struct sunxi_musb_dma_controller *controller;
+	struct device *dev = musb->controller;
+
+	controller = kzalloc(sizeof(*controller), GFP_KERNEL);
+	if (!controller)
+		return NULL;
+
+	controller->musb = musb;
+
+	controller->controller.start = sunxi_musb_dma_controller_start;
+	controller->controller.stop = sunxi_musb_dma_controller_stop;
+	controller->controller.channel_alloc = sunxi_musb_dma_channel_allocate;
+	controller->controller.channel_release = sunxi_musb_dma_channel_release;
+	controller->controller.channel_program = sunxi_musb_dma_channel_program;
+	controller->controller.channel_abort = sunxi_musb_dma_channel_abort;
+
+	controller->dma.client.name = "sunxi_musb_dma";
+#if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+	controller->dma.channel = DMACH_DUSB0;
+#endif
+	if (sunxi_dma_request(&controller->dma, 1) < 0) {
+		dev_err(dev, "dedicated DMA channel request failed\n");
+		kfree(controller);
+		return NULL;
+	}
+
+	if (sunxi_dma_set_callback(&controller->dma, sunxi_musb_dma_buffdone,
+				   controller) != 0) {
+		dev_err(dev, "DMA callback setup failed\n");
+		dma_controller_destroy(&controller->controller);
+		return NULL;
+	}
+
+	/* start out on pio */
+	sunxi_musb_dma_select(controller, NULL);
+
+	return &controller->controller;
+}
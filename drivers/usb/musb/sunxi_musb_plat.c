@@ -19,6 +19,7 @@
 #include <linux/io.h>
 #include <linux/slab.h>
 #include <linux/gpio.h>
+#include <linux/dma-mapping.h>
 #include <linux/usb/musb.h>
 
 #include <plat/sys_config.h>
@@ -203,15 +204,20 @@ static struct resource sunxi_musb_resources[] = {
 /* Can support a maximum ep number, ep0 ~ 5 */
 #define USBC_MAX_EP_NUM		6
 
+/*
+ * 8KB of fifo: ep1 and ep2 are double buffered, so a bulk stream has a
+ * packet on the wire while the next one is loaded, ep3 ~ 5 are left for
+ * interrupt and iso. 64 + 4 * 1024 + 6 * 512 = 7232 bytes.
+ */
 static struct musb_fifo_cfg sunxi_musb_mode_cfg[] = {
 	{ .hw_ep_num =  1, .style = FIFO_TX, .maxpacket = 512,
-		.mode = BUF_SINGLE, },
+		.mode = BUF_DOUBLE, },
 	{ .hw_ep_num =  1, .style = FIFO_RX, .maxpacket = 512,
-		.mode = BUF_SINGLE, },
+		.mode = BUF_DOUBLE, },
 	{ .hw_ep_num =  2, .style = FIFO_TX, .maxpacket = 512,
-		.mode = BUF_SINGLE, },
+		.mode = BUF_DOUBLE, },
 	{ .hw_ep_num =  2, .style = FIFO_RX, .maxpacket = 512,
-		.mode = BUF_SINGLE, },
+		.mode = BUF_DOUBLE, },
 	{ .hw_ep_num =  3, .style = FIFO_TX, .maxpacket = 512,
 		.mode = BUF_SINGLE, },
 	{ .hw_ep_num =  3, .style = FIFO_RX, .maxpacket = 512,
@@ -230,7 +236,11 @@ static struct musb_hdrc_config sunxi_musb_config = {
 	.multipoint	= 1,
 	.dyn_fifo	= 1,
 	.soft_con	= 1,
+#ifdef CONFIG_USB_SUNXI_MUSB_DMA
+	.dma		= 1,
+#else
 	.dma		= 0,
+#endif
 
 	.num_eps	= USBC_MAX_EP_NUM,
 	.ram_bits	= 11,
@@ -260,12 +270,16 @@ static struct musb_hdrc_platform_data sunxi_musb_plat = {
 	.board_data	= &sunxi_musb_board_data,
 };
 
+static u64 sunxi_musb_dmamask = DMA_BIT_MASK(32);
+
 static struct platform_device sunxi_musb_device = {
 	.name	= "sunxi_musb",
 	.id	= -1,
 
 	.dev = {
 		.platform_data = &sunxi_musb_plat,
+		.dma_mask = &sunxi_musb_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
 	},
 
 	.resource = sunxi_musb_resources,
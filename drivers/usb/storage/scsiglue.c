@@ -66,6 +66,13 @@
 #define VENDOR_ID_PENTAX	0x0a17
 #define VENDOR_ID_MOTOROLA	0x22b8
 
+/* Transfer size limit of high-speed devices on hosts that do DMA
+ * straight from the scatter-gather list; 0 keeps the default.
+ */
+static unsigned int hs_max_sectors = 1024;
+module_param(hs_max_sectors, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(hs_max_sectors, "max sectors per command at high speed");
+
 /***********************************************************************
  * Host functions 
  ***********************************************************************/
@@ -133,6 +140,17 @@ static int slave_configure(struct scsi_device *sdev)
 		 * let the queue segment size sort out the real limit.
 		 */
 		blk_queue_max_hw_sectors(sdev->request_queue, 0x7FFFFF);
+	} else if (us->pusb_dev->speed == USB_SPEED_HIGH &&
+		   us->pusb_dev->bus->sg_tablesize && hs_max_sectors) {
+		/* With the 512-byte alignment from slave_alloc the host
+		 * maps every element of the list as it is, nothing gets
+		 * bounced however long the transfer. A command per 120KB
+		 * leaves the bus idle for a good part of the time, so go
+		 * for larger ones.
+		 */
+		if (queue_max_hw_sectors(sdev->request_queue) < hs_max_sectors)
+			blk_queue_max_hw_sectors(sdev->request_queue,
+					      hs_max_sectors);
 	}
 
 	/* Some USB host controllers can't do DMA; they have to use PIO.
@@ -60,10 +60,19 @@ enum {
 	SUBMIT_CMD_URB		= (1 << 7),
 };
 
+/* Bits in uas_cmd_info.flags, changed from urb completions */
+enum {
+	DATA_IN_URB_INFLIGHT,
+	DATA_OUT_URB_INFLIGHT,
+	COMMAND_STATUS,		/* the Sense IU is in */
+	COMMAND_DONE,		/* handed back to the midlayer */
+};
+
 /* Overrides scsi_pointer */
 struct uas_cmd_info {
 	unsigned int state;
 	unsigned int stream;
+	unsigned long flags;
 	struct urb *cmd_urb;
 	/* status_urb is used only if stream support isn't available */
 	struct urb *status_urb;
@@ -107,6 +116,41 @@ static void uas_do_work(struct work_struct *work)
 	}
 }
 
+/*
+ * The status pipe is not ordered against the data pipes, the Sense IU
+ * of a command can complete before its data urb does.  The midlayer
+ * gets the command back only when both are in, the buffer must not be
+ * reused while the data urb is still being unmapped or bounced back.
+ */
+static void uas_try_complete(struct scsi_cmnd *cmnd)
+{
+	struct uas_cmd_info *cmdinfo = (void *)&cmnd->SCp;
+
+	if (!test_bit(COMMAND_STATUS, &cmdinfo->flags) ||
+	    test_bit(DATA_IN_URB_INFLIGHT, &cmdinfo->flags) ||
+	    test_bit(DATA_OUT_URB_INFLIGHT, &cmdinfo->flags))
+		return;
+	if (test_and_set_bit(COMMAND_DONE, &cmdinfo->flags))
+		return;
+
+	/* data urbs still here waited for a READY IU that never came */
+	usb_free_urb(cmdinfo->data_in_urb);
+	cmdinfo->data_in_urb = NULL;
+	usb_free_urb(cmdinfo->data_out_urb);
+	cmdinfo->data_out_urb = NULL;
+
+	cmnd->scsi_done(cmnd);
+}
+
+static void uas_status_done(struct scsi_cmnd *cmnd)
+{
+	struct uas_cmd_info *cmdinfo = (void *)&cmnd->SCp;
+
+	set_bit(COMMAND_STATUS, &cmdinfo->flags);
+	smp_mb();
+	uas_try_complete(cmnd);
+}
+
 static void uas_sense(struct urb *urb, struct scsi_cmnd *cmnd)
 {
 	struct sense_iu *sense_iu = urb->transfer_buffer;
@@ -128,7 +172,7 @@ static void uas_sense(struct urb *urb, struct scsi_cmnd *cmnd)
 	}
 
 	cmnd->result = sense_iu->status;
-	cmnd->scsi_done(cmnd);
+	uas_status_done(cmnd);
 }
 
 static void uas_sense_old(struct urb *urb, struct scsi_cmnd *cmnd)
@@ -152,7 +196,7 @@ static void uas_sense_old(struct urb *urb, struct scsi_cmnd *cmnd)
 	}
 
 	cmnd->result = sense_iu->status;
-	cmnd->scsi_done(cmnd);
+	uas_status_done(cmnd);
 }
 
 static void uas_xfer_data(struct urb *urb, struct scsi_cmnd *cmnd,
@@ -161,7 +205,7 @@ static void uas_xfer_data(struct urb *urb, struct scsi_cmnd *cmnd,
 	struct uas_cmd_info *cmdinfo = (void *)&cmnd->SCp;
 	int err;
 
-	cmdinfo->state = direction;
+	cmdinfo->state |= direction;
 	err = uas_submit_urbs(cmnd, cmnd->device->hostdata, GFP_ATOMIC);
 	if (err) {
 		spin_lock(&uas_work_lock);
@@ -238,13 +282,33 @@ static void uas_stat_cmplt(struct urb *urb)
 
 static void uas_data_cmplt(struct urb *urb)
 {
-	struct scsi_data_buffer *sdb = urb->context;
-	sdb->resid = sdb->length - urb->actual_length;
+	struct scsi_cmnd *cmnd = urb->context;
+	struct uas_cmd_info *cmdinfo = (void *)&cmnd->SCp;
+	struct scsi_data_buffer *sdb;
+	int bit;
+
+	if (usb_pipein(urb->pipe)) {
+		sdb = scsi_in(cmnd);
+		bit = DATA_IN_URB_INFLIGHT;
+	} else {
+		sdb = scsi_out(cmnd);
+		bit = DATA_OUT_URB_INFLIGHT;
+	}
+
+	if (urb->status)
+		sdb->resid = sdb->length;
+	else
+		sdb->resid = sdb->length - urb->actual_length;
 	usb_free_urb(urb);
+
+	clear_bit(bit, &cmdinfo->flags);
+	smp_mb__after_clear_bit();
+	uas_try_complete(cmnd);
 }
 
 static struct urb *uas_alloc_data_urb(struct uas_dev_info *devinfo, gfp_t gfp,
 				unsigned int pipe, u16 stream_id,
+				struct scsi_cmnd *cmnd,
 				struct scsi_data_buffer *sdb,
 				enum dma_data_direction dir)
 {
@@ -254,7 +318,7 @@ static struct urb *uas_alloc_data_urb(struct uas_dev_info *devinfo, gfp_t gfp,
 	if (!urb)
 		goto out;
 	usb_fill_bulk_urb(urb, udev, pipe, NULL, sdb->length, uas_data_cmplt,
-									sdb);
+									cmnd);
 	if (devinfo->use_streams)
 		urb->stream_id = stream_id;
 	urb->num_sgs = udev->bus->sg_tablesize ? sdb->table.nents : 0;
@@ -359,36 +423,44 @@ static int uas_submit_urbs(struct scsi_cmnd *cmnd,
 	if (cmdinfo->state & ALLOC_DATA_IN_URB) {
 		cmdinfo->data_in_urb = uas_alloc_data_urb(devinfo, gfp,
 					devinfo->data_in_pipe, cmdinfo->stream,
-					scsi_in(cmnd), DMA_FROM_DEVICE);
+					cmnd, scsi_in(cmnd), DMA_FROM_DEVICE);
 		if (!cmdinfo->data_in_urb)
 			return SCSI_MLQUEUE_DEVICE_BUSY;
 		cmdinfo->state &= ~ALLOC_DATA_IN_URB;
 	}
 
 	if (cmdinfo->state & SUBMIT_DATA_IN_URB) {
+		set_bit(DATA_IN_URB_INFLIGHT, &cmdinfo->flags);
 		if (usb_submit_urb(cmdinfo->data_in_urb, gfp)) {
+			clear_bit(DATA_IN_URB_INFLIGHT, &cmdinfo->flags);
 			scmd_printk(KERN_INFO, cmnd,
 					"data in urb submission failure\n");
 			return SCSI_MLQUEUE_DEVICE_BUSY;
 		}
+		/* the urb frees itself from now on */
+		cmdinfo->data_in_urb = NULL;
 		cmdinfo->state &= ~SUBMIT_DATA_IN_URB;
 	}
 
 	if (cmdinfo->state & ALLOC_DATA_OUT_URB) {
 		cmdinfo->data_out_urb = uas_alloc_data_urb(devinfo, gfp,
 					devinfo->data_out_pipe, cmdinfo->stream,
-					scsi_out(cmnd), DMA_TO_DEVICE);
+					cmnd, scsi_out(cmnd), DMA_TO_DEVICE);
 		if (!cmdinfo->data_out_urb)
 			return SCSI_MLQUEUE_DEVICE_BUSY;
 		cmdinfo->state &= ~ALLOC_DATA_OUT_URB;
 	}
 
 	if (cmdinfo->state & SUBMIT_DATA_OUT_URB) {
+		set_bit(DATA_OUT_URB_INFLIGHT, &cmdinfo->flags);
 		if (usb_submit_urb(cmdinfo->data_out_urb, gfp)) {
+			clear_bit(DATA_OUT_URB_INFLIGHT, &cmdinfo->flags);
 			scmd_printk(KERN_INFO, cmnd,
 					"data out urb submission failure\n");
 			return SCSI_MLQUEUE_DEVICE_BUSY;
 		}
+		/* the urb frees itself from now on */
+		cmdinfo->data_out_urb = NULL;
 		cmdinfo->state &= ~SUBMIT_DATA_OUT_URB;
 	}
 
@@ -434,6 +506,9 @@ static int uas_queuecommand_lck(struct scsi_cmnd *cmnd,
 
 	cmnd->scsi_done = done;
 
+	cmdinfo->flags = 0;
+	cmdinfo->data_in_urb = NULL;
+	cmdinfo->data_out_urb = NULL;
 	cmdinfo->state = ALLOC_STATUS_URB | SUBMIT_STATUS_URB |
 			ALLOC_CMD_URB | SUBMIT_CMD_URB;
 
@@ -523,6 +598,13 @@ static int uas_eh_bus_reset_handler(struct scsi_cmnd *cmnd)
 static int uas_slave_alloc(struct scsi_device *sdev)
 {
 	sdev->hostdata = (void *)sdev->host->hostdata[0];
+
+	/* The scatter-gather lists go to the host controller as they
+	 * are, see the comment in usb-storage's slave_alloc.  512-byte
+	 * aligned elements also never need bouncing on hosts that
+	 * want their DMA cache line aligned.
+	 */
+	blk_queue_update_dma_alignment(sdev->request_queue, (512 - 1));
 	return 0;
 }
 
@@ -52,6 +52,8 @@ typedef struct sw_udc_ep {
 
 	__u32					dma_working;		/* flag. is dma busy? 		*/
 	__u32 					dma_transfer_len;	/* dma want transfer length */
+	dma_addr_t				dma_addr;			/* streaming mapping of the transfer */
+	__u32					dma_map_len;		/* mapped length, 0 = not mapped */
 }sw_udc_ep_t;
 
 
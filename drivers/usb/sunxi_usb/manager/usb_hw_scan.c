@@ -45,6 +45,7 @@
 #include <asm/system.h>
 #include <asm/unaligned.h>
 #include <mach/irqs.h>
+#include <plat/system.h>
 
 #include  "../include/sw_usb_config.h"
 #include  "usb_manager.h"
@@ -55,6 +56,134 @@ static struct usb_scan_info g_usb_scan_info;
 
 void (*__usb_hw_scan) (struct usb_scan_info *);
 
+/* id/vbus edges settle for this long before the cable state is scanned */
+static unsigned int vbus_id_debounce_ms = 50;
+module_param(vbus_id_debounce_ms, uint, 0644);
+MODULE_PARM_DESC(vbus_id_debounce_ms, "id/vbus edge debounce window in ms");
+
+/* external interrupt block of the pio controller */
+#define  USB_SCAN_PIO_CFG(port, pin)	(SW_VA_PORTC_IO_BASE + ((port) - 1) * 0x24 + (((pin) >> 3) << 2))
+#define  USB_SCAN_PIO_INT_CFG(eint)	(SW_VA_PORTC_IO_BASE + 0x200 + (((eint) >> 3) << 2))
+#define  USB_SCAN_PIO_INT_CTRL			(SW_VA_PORTC_IO_BASE + 0x210)
+#define  USB_SCAN_PIO_INT_STAT			(SW_VA_PORTC_IO_BASE + 0x214)
+
+#define  USB_SCAN_PIO_MUX_INPUT		0
+#define  USB_SCAN_PIO_MUX_EINT			6
+#define  USB_SCAN_EINT_DOUBLE_EDGE		4
+
+static DEFINE_SPINLOCK(usb_scan_pio_lock);
+
+/* eint line of a pin, -1 if it can't interrupt */
+static int usb_scan_eint_no(user_gpio_set_t *gpio_set)
+{
+	u32 port = gpio_set->port;		/* A = 1 */
+	u32 pin  = gpio_set->port_num;
+
+	if(sunxi_is_a10() || sunxi_is_a20()){
+		if(port == 8 && pin <= 21){		/* PH0 - PH21 */
+			return pin;
+		}
+
+		if(port == 9 && pin >= 10 && pin <= 19){	/* PI10 - PI19 */
+			return pin + 12;
+		}
+	}else if(sunxi_is_a10s() || sunxi_is_a13()){
+		if(port == 7 && pin <= 13){		/* PG0 - PG13 */
+			return pin;
+		}
+
+		if(port == 5 && pin <= 1){		/* PE0 - PE1 */
+			return pin + 14;
+		}
+
+		if(port == 2 && pin >= 2 && pin <= 14){	/* PB2 - PB14 */
+			return pin + 14;
+		}
+
+		if(port == 2 && (pin == 19 || pin == 20)){
+			return pin + 10;
+		}
+
+		if(port == 1 && pin == 17){		/* PA17 */
+			return 31;
+		}
+	}
+
+	return -1;
+}
+
+static void usb_scan_set_pio_mux(user_gpio_set_t *gpio_set, u32 mux)
+{
+	unsigned long flags = 0;
+	u32 shift = (gpio_set->port_num & 0x07) << 2;
+	u32 reg_val = 0;
+
+	spin_lock_irqsave(&usb_scan_pio_lock, flags);
+	reg_val = USBC_Readl(USB_SCAN_PIO_CFG(gpio_set->port, gpio_set->port_num));
+	reg_val &= ~(0x07 << shift);
+	reg_val |= mux << shift;
+	USBC_Writel(reg_val, USB_SCAN_PIO_CFG(gpio_set->port, gpio_set->port_num));
+	spin_unlock_irqrestore(&usb_scan_pio_lock, flags);
+}
+
+static void usb_scan_enable_eint(int eint, u32 enable)
+{
+	unsigned long flags = 0;
+	u32 shift = (eint & 0x07) << 2;
+	u32 reg_val = 0;
+
+	spin_lock_irqsave(&usb_scan_pio_lock, flags);
+
+	if(enable){
+		reg_val = USBC_Readl(USB_SCAN_PIO_INT_CFG(eint));
+		reg_val &= ~(0x0f << shift);
+		reg_val |= USB_SCAN_EINT_DOUBLE_EDGE << shift;
+		USBC_Writel(reg_val, USB_SCAN_PIO_INT_CFG(eint));
+
+		USBC_Writel((1 << eint), USB_SCAN_PIO_INT_STAT);
+	}
+
+	reg_val = USBC_Readl(USB_SCAN_PIO_INT_CTRL);
+	if(enable){
+		reg_val |= (1 << eint);
+	}else{
+		reg_val &= ~(1 << eint);
+	}
+	USBC_Writel(reg_val, USB_SCAN_PIO_INT_CTRL);
+
+	spin_unlock_irqrestore(&usb_scan_pio_lock, flags);
+}
+
+static u32 usb_scan_eint_mask(struct usb_scan_info *info)
+{
+	return (1 << info->id_eint) | (1 << info->det_vbus_eint);
+}
+
+static irqreturn_t usb_hw_scan_irq(int irq, void *dev_id)
+{
+	struct usb_scan_info *info = dev_id;
+	u32 status = 0;
+
+	/* the pio line is shared with gpio-sunxi and the touch panels */
+	status = USBC_Readl(USB_SCAN_PIO_INT_STAT) & usb_scan_eint_mask(info);
+	if(!status){
+		return IRQ_NONE;
+	}
+
+	USBC_Writel(status, USB_SCAN_PIO_INT_STAT);
+
+	/* every edge pushes the scan out, it runs once the pins are quiet */
+	mod_timer(&info->debounce_timer, jiffies + msecs_to_jiffies(vbus_id_debounce_ms));
+
+	return IRQ_HANDLED;
+}
+
+static void usb_hw_scan_debounce(unsigned long data)
+{
+	struct usb_scan_info *info = (struct usb_scan_info *)data;
+
+	usb_hw_scan_kick(info->cfg);
+}
 
 /*
 *******************************************************************************
@@ -158,13 +287,32 @@ static __u32 PIODataIn_debounce(__hdle phdle, __u32 *value)
 *
 *******************************************************************************
 */
+/* an eint pin only reads back as input, then goes back to eint */
+static __u32 usb_scan_pin_in(struct usb_scan_info *info, __hdle phdle,
+                             user_gpio_set_t *gpio_set, __u32 *value)
+{
+	__u32 change = 0;
+
+	if(info->irq_enable){
+		usb_scan_set_pio_mux(gpio_set, USB_SCAN_PIO_MUX_INPUT);
+	}
+
+	change = PIODataIn_debounce(phdle, value);
+
+	if(info->irq_enable){
+		usb_scan_set_pio_mux(gpio_set, USB_SCAN_PIO_MUX_EINT);
+	}
+
+	return change;
+}
+
 static u32 get_id_state(struct usb_scan_info *info)
 {
 	enum usb_id_state id_state = USB_DEVICE_MODE;
 	__u32 pin_data = 0;
 
 	if(info->id_hdle){
-		if(!PIODataIn_debounce(info->id_hdle, &pin_data)){
+		if(!usb_scan_pin_in(info, info->id_hdle, &info->id_gpio_set, &pin_data)){
 			if(pin_data){
 				id_state = USB_DEVICE_MODE;
 			}else{
@@ -204,7 +352,7 @@ static u32 get_detect_vbus_state(struct usb_scan_info *info)
 	__u32 pin_data = 0;
 
 	if(info->det_vbus_hdle){
-		if(!PIODataIn_debounce(info->det_vbus_hdle, &pin_data)){
+		if(!usb_scan_pin_in(info, info->det_vbus_hdle, &info->det_vbus_gpio_set, &pin_data)){
 			if(pin_data){
 				det_vbus_state = USB_DET_VBUS_VALID;
 			}else{
@@ -303,7 +451,7 @@ static void do_vbus0_id0(struct usb_scan_info *info)
 	switch(role){
 		case USB_ROLE_NULL:
 			/* delay for vbus is stably */
-			if(info->host_insmod_delay < USB_SCAN_INSMOD_HOST_DRIVER_DELAY){
+			if(info->host_insmod_delay < info->host_insmod_max){
 				info->host_insmod_delay++;
 				break;
 			}
@@ -403,7 +551,7 @@ static void do_vbus1_id0(struct usb_scan_info *info)
 	switch(role){
 		case USB_ROLE_NULL:
 			/* delay for vbus is stably */
-			if(info->host_insmod_delay < USB_SCAN_INSMOD_HOST_DRIVER_DELAY){
+			if(info->host_insmod_delay < info->host_insmod_max){
 				info->host_insmod_delay++;
 				break;
 			}
@@ -457,7 +605,7 @@ static void do_vbus1_id1(struct usb_scan_info *info)
 			if (get_dp_dm_status(info) == 0x00) {
 				/* delay for vbus is stably */
 				if (info->device_insmod_delay <
-					USB_SCAN_INSMOD_DEVICE_DRIVER_DELAY) {
+					info->device_insmod_max) {
 					info->device_insmod_delay++;
 					break;
 				}
@@ -538,6 +686,7 @@ static void vbus_id_hw_scan(struct usb_scan_info *info)
 	__u32 vbus_id_state = 0;
 
 	vbus_id_state = get_vbus_id_state(info);
+	info->vbus_id_state = vbus_id_state;
 
 	DMSG_DBG_MANAGER("vbus_id=%d, role=%d\n", vbus_id_state, get_usb_role());
 
@@ -613,6 +762,106 @@ void usb_hw_scan(struct usb_cfg *cfg)
     __usb_hw_scan(&g_usb_scan_info);
 }
 
+/* the role the last vbus/id state asks for is in place */
+static u32 usb_hw_scan_settled(struct usb_scan_info *info)
+{
+	enum usb_role role = USB_ROLE_NULL;
+
+	switch(info->vbus_id_state){
+		case  0x00:
+		case  0x02:
+			role = USB_ROLE_HOST;
+		break;
+
+		case  0x03:
+			role = USB_ROLE_DEVICE;
+		break;
+
+		default:
+			role = USB_ROLE_NULL;
+	}
+
+	return (get_usb_role() == role);
+}
+
+/*
+ * Sleep until the next scan. With id/vbus on edge interrupts the scan
+ * thread only wakes for a debounced edge, while a role change is still
+ * on its way (dp/dm not idle yet, rmmod failed) it keeps polling.
+ */
+void usb_hw_scan_wait(struct usb_cfg *cfg, u32 ms)
+{
+	struct usb_scan_info *info = &g_usb_scan_info;
+
+	if(info->irq_enable && usb_hw_scan_settled(info)){
+		wait_event_interruptible(info->scan_wait, info->scan_pending);
+	}else{
+		wait_event_interruptible_timeout(info->scan_wait, info->scan_pending,
+		                                 msecs_to_jiffies(ms));
+	}
+
+	info->scan_pending = 0;
+}
+
+void usb_hw_scan_kick(struct usb_cfg *cfg)
+{
+	struct usb_scan_info *info = &g_usb_scan_info;
+
+	info->scan_pending = 1;
+	wake_up_interruptible(&info->scan_wait);
+}
+
+static void usb_hw_scan_irq_init(struct usb_scan_info *info, struct usb_port_info *port_info)
+{
+	int ret = 0;
+
+	if(port_info->id.group_type != GPIO_GROUP_TYPE_PIO
+	   || port_info->det_vbus.group_type != GPIO_GROUP_TYPE_PIO){
+		return;
+	}
+
+	info->id_eint		= usb_scan_eint_no(&info->id_gpio_set);
+	info->det_vbus_eint	= usb_scan_eint_no(&info->det_vbus_gpio_set);
+	if(info->id_eint < 0 || info->det_vbus_eint < 0){
+		DMSG_INFO_MANAGER("id/vbus pin has no eint, polling\n");
+		return;
+	}
+
+	ret = request_irq(SW_INT_IRQNO_PIO, usb_hw_scan_irq, IRQF_SHARED, "usb_vbus_id", info);
+	if(ret != 0){
+		DMSG_PANIC("ERR: request id/vbus irq failed(%d), polling\n", ret);
+		return;
+	}
+
+	info->irq_enable = 1;
+
+	usb_scan_set_pio_mux(&info->id_gpio_set, USB_SCAN_PIO_MUX_EINT);
+	usb_scan_set_pio_mux(&info->det_vbus_gpio_set, USB_SCAN_PIO_MUX_EINT);
+	usb_scan_enable_eint(info->id_eint, 1);
+	usb_scan_enable_eint(info->det_vbus_eint, 1);
+
+	/* the debounce timer already waited for the pins to settle */
+	info->host_insmod_max	= 0;
+	info->device_insmod_max	= 0;
+}
+
+static void usb_hw_scan_irq_exit(struct usb_scan_info *info)
+{
+	if(!info->irq_enable){
+		return;
+	}
+
+	usb_scan_enable_eint(info->id_eint, 0);
+	usb_scan_enable_eint(info->det_vbus_eint, 0);
+	free_irq(SW_INT_IRQNO_PIO, info);
+	del_timer_sync(&info->debounce_timer);
+
+	usb_scan_set_pio_mux(&info->id_gpio_set, USB_SCAN_PIO_MUX_INPUT);
+	usb_scan_set_pio_mux(&info->det_vbus_gpio_set, USB_SCAN_PIO_MUX_INPUT);
+
+	info->irq_enable = 0;
+}
+
 /*
 *******************************************************************************
 *                     usb_hw_scan_init
@@ -641,6 +890,12 @@ __s32 usb_hw_scan_init(struct usb_cfg *cfg)
 	scan_info->cfg 					= cfg;
 	scan_info->id_old_state 		= USB_DEVICE_MODE;
 	scan_info->det_vbus_old_state 	= USB_DET_VBUS_INVALID;
+	scan_info->host_insmod_max		= USB_SCAN_INSMOD_HOST_DRIVER_DELAY;
+	scan_info->device_insmod_max	= USB_SCAN_INSMOD_DEVICE_DRIVER_DELAY;
+	scan_info->id_eint				= -1;
+	scan_info->det_vbus_eint		= -1;
+	init_waitqueue_head(&scan_info->scan_wait);
+	setup_timer(&scan_info->debounce_timer, usb_hw_scan_debounce, (unsigned long)scan_info);
 
 	port_info =&(cfg->port[0]);
 	switch(port_info->port_type){
@@ -735,6 +990,10 @@ __s32 usb_hw_scan_init(struct usb_cfg *cfg)
 							goto failed;
 					}
 
+					scan_info->id_gpio_set		= port_info->id.gpio_set;
+					scan_info->det_vbus_gpio_set	= port_info->det_vbus.gpio_set;
+					usb_hw_scan_irq_init(scan_info, port_info);
+
 					__usb_hw_scan = vbus_id_hw_scan;
 				}
 				break;
@@ -793,6 +1052,8 @@ __s32 usb_hw_scan_exit(struct usb_cfg *cfg)
 {
 	struct usb_scan_info *scan_info = &g_usb_scan_info;
 
+	usb_hw_scan_irq_exit(scan_info);
+
 	if(scan_info->id_hdle){
 		gpio_release(scan_info->id_hdle, 0);
 		scan_info->id_hdle = 0;
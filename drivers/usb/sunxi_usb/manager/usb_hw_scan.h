@@ -54,9 +54,22 @@ typedef struct usb_scan_info{
 
     u32                     device_insmod_delay;    /* debounce time            */
     u32                     host_insmod_delay;    	/* debounce time            */
+    u32                     device_insmod_max;      /* scans before insmod      */
+    u32                     host_insmod_max;        /* scans before insmod      */
+
+    int                     id_eint;                /* id eint, -1 = polled     */
+    int                     det_vbus_eint;          /* vbus eint, -1 = polled   */
+    u32                     irq_enable;             /* id/vbus are edge irqs    */
+    u32                     vbus_id_state;          /* state of the last scan   */
+
+    struct timer_list       debounce_timer;         /* edge -> scan             */
+    wait_queue_head_t       scan_wait;
+    u32                     scan_pending;
 }usb_scan_info_t;
 
 void usb_hw_scan(struct usb_cfg *cfg);
+void usb_hw_scan_wait(struct usb_cfg *cfg, u32 ms);
+void usb_hw_scan_kick(struct usb_cfg *cfg);
 
 __s32 usb_hw_scan_init(struct usb_cfg *cfg);
 __s32 usb_hw_scan_exit(struct usb_cfg *cfg);
@@ -97,7 +97,8 @@ static int usb_hardware_scan_thread(void * pArg)
 
 		DMSG_DBG_MANAGER("\n\n");
 
-		msleep(1000);  /* 1s */
+		/* 1s while polling, otherwise until the next id/vbus edge */
+		usb_hw_scan_wait(cfg, 1000);
 	}
 
 	thread_stopped_flag = 1;
@@ -585,6 +586,7 @@ static void __exit usb_manager_exit(void)
     if(g_usb_cfg.port[0].port_type == USB_PORT_TYPE_OTG
        && g_usb_cfg.port[0].detect_type == USB_DETECT_TYPE_VBUS_ID){
     	thread_run_flag = 0;
+    	usb_hw_scan_kick(&g_usb_cfg);
     	while(!thread_stopped_flag){
     		DMSG_INFO("waitting for usb_hardware_scan_thread stop\n");
     		msleep(10);
@@ -438,8 +438,8 @@ static int dma_write_fifo(struct sw_udc_ep *ep, struct sw_udc_request *req)
 	ep->dma_working	= 1;
 	ep->dma_transfer_len = left_len;
 
-	sw_udc_dma_set_config(ep, req, (__u32)req->req.buf, left_len);
-	sw_udc_dma_start(ep, fifo_reg, (__u32)req->req.buf, left_len);
+	sw_udc_dma_set_config(ep, req, (__u32)req->req.buf + req->req.actual, left_len);
+	sw_udc_dma_start(ep, fifo_reg, (__u32)req->req.buf + req->req.actual, left_len);
 
 	return 0;
 }
@@ -668,8 +668,8 @@ static int dma_read_fifo(struct sw_udc_ep *ep, struct sw_udc_request *req)
 
 	ep->dma_working	= 1;
 	ep->dma_transfer_len = left_len;
-	sw_udc_dma_set_config(ep, req, (__u32)req->req.buf, left_len);
-	sw_udc_dma_start(ep, fifo_reg, (__u32)req->req.buf, left_len);
+	sw_udc_dma_set_config(ep, req, (__u32)req->req.buf + req->req.actual, left_len);
+	sw_udc_dma_start(ep, fifo_reg, (__u32)req->req.buf + req->req.actual, left_len);
 
 	return 0;
 }
@@ -1984,7 +1984,7 @@ void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_u
 	}
 
 	dma_transmit_len = sw_udc_dma_transmit_length(ep, ((ep->bEndpointAddress) & USB_DIR_IN), (__u32)req->req.buf);
-	if(dma_transmit_len < req->req.length){
+	if(dma_transmit_len < (req->req.length - req->req.actual)){
 		DMSG_PANIC("WRN: DMA recieve data not complete, (%d, %d, %d)\n",
 					req->req.length, req->req.actual, dma_transmit_len);
 
@@ -1999,16 +1999,24 @@ void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_u
 
     /* 如果本次传输有数据没有传输完毕，得接着传输 */
 	req->req.actual += dma_transmit_len;
+
+	/* the channel is free again, whatever comes next may use it */
+	ep->dma_working	= 0;
+	ep->dma_transfer_len = 0;
+
 	if(req->req.length > req->req.actual){
 		DMSG_INFO_UDC("dma irq, transfer left data\n");
 
+		/* less than a packet is left, that goes by pio */
+		sw_udc_switch_bus_to_pio(ep, ((ep->bEndpointAddress) & USB_DIR_IN));
+
 		if(((ep->bEndpointAddress & USB_DIR_IN) != 0)
 			&& !USBC_Dev_IsWriteDataReady(dev->sw_udc_io->usb_bsp_hdle, USBC_EP_TYPE_TX)){
 			if(sw_udc_write_fifo(ep, req)){
 				req = NULL;
 				is_complete = 1;
 			}
-		}else if(((ep->bEndpointAddress & USB_DIR_IN) != 0)
+		}else if(((ep->bEndpointAddress & USB_DIR_IN) == 0)
 			&& USBC_Dev_IsReadDataReady(dev->sw_udc_io->usb_bsp_hdle, USBC_EP_TYPE_RX)){
 			if(sw_udc_read_fifo(ep, req)){
 				req = NULL;
@@ -2022,11 +2030,6 @@ void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_u
 
     /* 如果DMA完成的传输了数据，就done */
 
-	if(is_complete){
-		ep->dma_working	= 0;
-		ep->dma_transfer_len = 0;
-	}
-
 	//-------------------------------------------------
 	//发起下一次传输
 	//-------------------------------------------------
@@ -2042,6 +2045,11 @@ void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_u
 				         ep, ep->num,
 				         req_next, &(req_next->req), req_next->req.length, req_next->req.actual);
 
+			/* a dma capable request keeps the bus, it is still routed to this ep */
+			if(!is_sw_udc_dma_capable((req_next->req.length - req_next->req.actual), ep->ep.maxpacket, ep->num)){
+				sw_udc_switch_bus_to_pio(ep, ((ep->bEndpointAddress) & USB_DIR_IN));
+			}
+
 			if(((ep->bEndpointAddress & USB_DIR_IN) != 0)
 				&& !USBC_Dev_IsWriteDataReady(dev->sw_udc_io->usb_bsp_hdle, USBC_EP_TYPE_TX)){
 				sw_udc_write_fifo(ep, req_next);
@@ -2052,6 +2060,11 @@ void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_u
 		}
 	}
 
+	/* nothing was chained onto the channel */
+	if(!sw_udc_dma_is_busy(ep)){
+		sw_udc_switch_bus_to_pio(ep, ((ep->bEndpointAddress) & USB_DIR_IN));
+	}
+
 	USBC_SelectActiveEp(dev->sw_udc_io->usb_bsp_hdle, old_ep_index);
 
 	DMSG_TEST("de\n");
@@ -38,7 +38,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
-#include <asm/cacheflush.h>
+#include <linux/dma-mapping.h>
 
 #include  "sw_udc_config.h"
 #include  "sw_udc_board.h"
@@ -48,11 +48,28 @@
 
 static sw_udc_dma_parg_t sw_udc_dma_para;
 
+/* ep the drq is routed to, NULL while the bus is on pio */
+static struct sw_udc_ep *sw_udc_dma_bus_ep;
+
+/* last channel setup, a request on the same ep doesn't need it again */
+static struct sw_udc_ep *sw_udc_dma_cfg_ep;
+static __u32 sw_udc_dma_cfg_xfer;
+
 extern void sw_udc_dma_completion(struct sw_udc *dev, struct sw_udc_ep *ep, struct sw_udc_request *req);
 
-static void sw_udc_CleanFlushDCacheRegion(void *adr, __u32 bytes)
+static enum dma_data_direction sw_udc_dma_dir(struct sw_udc_ep *ep)
+{
+	return is_tx_ep(ep) ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+}
+
+/* give the buffer back to the cpu once the channel is done with it */
+static void sw_udc_dma_unmap(struct sw_udc_ep *ep)
 {
-	__cpuc_flush_dcache_area(adr, bytes + (1 << 5) * 2 - 2);
+	if(ep->dma_map_len){
+		dma_unmap_single(&ep->dev->gadget.dev, ep->dma_addr,
+		                 ep->dma_map_len, sw_udc_dma_dir(ep));
+		ep->dma_map_len = 0;
+	}
 }
 
 /*
@@ -75,6 +92,16 @@ static void sw_udc_CleanFlushDCacheRegion(void *adr, __u32 bytes)
 */
 void sw_udc_switch_bus_to_dma(struct sw_udc_ep *ep, u32 is_tx)
 {
+	/* still routed here from the previous request */
+	if(sw_udc_dma_bus_ep == ep){
+		return;
+	}
+
+	/* drq_sel is or'ed in, drop the old ep first */
+	if(sw_udc_dma_bus_ep){
+		sw_udc_switch_bus_to_pio(sw_udc_dma_bus_ep, is_tx_ep(sw_udc_dma_bus_ep));
+	}
+
 	if(!is_tx){ /* ep in, rx */
 		USBC_SelectBus(ep->dev->sw_udc_io->usb_bsp_hdle,
 			           USBC_IO_TYPE_DMA,
@@ -87,6 +114,8 @@ void sw_udc_switch_bus_to_dma(struct sw_udc_ep *ep, u32 is_tx)
 					   ep->num);
 	}
 
+	sw_udc_dma_bus_ep = ep;
+
     return;
 }
 
@@ -112,6 +141,8 @@ void sw_udc_switch_bus_to_pio(struct sw_udc_ep *ep, __u32 is_tx)
 {
 	USBC_SelectBus(ep->dev->sw_udc_io->usb_bsp_hdle, USBC_IO_TYPE_PIO, 0, 0);
 
+	sw_udc_dma_bus_ep = NULL;
+
     return;
 }
 
@@ -243,8 +274,15 @@ void sw_udc_dma_set_config(struct sw_udc_ep *ep, struct sw_udc_request *req, __u
 	sw_udc_dma_para.ep    = ep;
 	sw_udc_dma_para.req	= req;
 
+	if(sw_udc_dma_cfg_ep == ep && sw_udc_dma_cfg_xfer == dma_config.xfer_type){
+		return;
+	}
+
 	sw_dma_config(ep->dev->sw_udc_dma.dma_hdle, &dma_config);
 
+	sw_udc_dma_cfg_ep	= ep;
+	sw_udc_dma_cfg_xfer	= dma_config.xfer_type;
+
     return;
 }
 
@@ -272,7 +310,10 @@ void sw_udc_dma_start(struct sw_udc_ep *ep, __u32 fifo, __u32 buffer, __u32 len)
 		      sw_udc_dma_para.ep->num,
 		      fifo, buffer, (u32)phys_to_virt(buffer), len);
 
-	sw_udc_CleanFlushDCacheRegion((void *)buffer, (size_t)len);
+	/* only the bytes of this transfer, the channel takes the virtual address */
+	ep->dma_addr = dma_map_single(&ep->dev->gadget.dev, (void *)buffer,
+	                              len, sw_udc_dma_dir(ep));
+	ep->dma_map_len = len;
 
 	sw_udc_switch_bus_to_dma(ep, is_tx_ep(ep));
 
@@ -307,10 +348,14 @@ void sw_udc_dma_stop(struct sw_udc_ep *ep)
 	sw_dma_ctrl(ep->dev->sw_udc_dma.dma_hdle, SW_DMAOP_STOP);
 
 	sw_udc_switch_bus_to_pio(ep, is_tx_ep(ep));
+	sw_udc_dma_unmap(ep);
 
 	sw_udc_dma_para.ep    			= NULL;
 	sw_udc_dma_para.req				= NULL;
 
+	/* the channel may be reset behind us, set it up again next time */
+	sw_udc_dma_cfg_ep				= NULL;
+
     return;
 }
 
@@ -423,7 +468,11 @@ static void sw_udc_dma_callback(struct sw_dma_chan * ch, void *buf, int size, en
 		  		sw_udc_dma_para.ep->num, sw_udc_dma_para.ep, sw_udc_dma_para.ep->dma_transfer_len);
 
 	if(sw_udc_dma_para.ep){
-		sw_udc_switch_bus_to_pio(sw_udc_dma_para.ep, is_tx_ep(sw_udc_dma_para.ep));
+		/*
+		 * the bus stays on dma, the completion chains the next
+		 * request and only goes back to pio if that one can't use it.
+		 */
+		sw_udc_dma_unmap(ep);
 
 		sw_udc_dma_para.ep = NULL;
 		sw_udc_dma_para.req = NULL;
@@ -463,6 +512,8 @@ __s32 sw_udc_dma_probe(struct sw_udc *dev)
 
 	memset(&sw_udc_dma_para, 0, sizeof(sw_udc_dma_parg_t));
 	sw_udc_dma_para.dev = dev;
+	sw_udc_dma_bus_ep = NULL;
+	sw_udc_dma_cfg_ep = NULL;
 
     /* request dma */
 	strcpy(dev->sw_udc_dma.name, dev->driver_name);
@@ -521,6 +572,8 @@ __s32 sw_udc_dma_remove(struct sw_udc *dev)
 	}
 
 	memset(&sw_udc_dma_para, 0, sizeof(sw_udc_dma_parg_t));
+	sw_udc_dma_bus_ep = NULL;
+	sw_udc_dma_cfg_ep = NULL;
 
 	return 0;
 }
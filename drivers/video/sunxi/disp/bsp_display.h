@@ -83,7 +83,9 @@ typedef struct {
 				struct __disp_video_timing *video_timing);
 	 __s32(*hdmi_get_HPD_status) (void);
 	 __s32(*hdmi_set_pll) (__u32 pll, __u32 clk);
+	 __s32(*hdmi_set_3d_mode) (__disp_3d_out_mode_t mode, __bool enable);
 	 __s32(*disp_int_process) (__u32 sel);
+	void (*vsync_event) (__u32 sel);
 } __disp_bsp_init_para;
 
 extern __s32 BSP_disp_clk_on(__u32 type);
@@ -106,6 +108,8 @@ extern __s32 BSP_disp_get_palette_table(__u32 sel, __u32 *pbuffer,
 extern __s32 BSP_disp_get_screen_height(__u32 sel);
 extern __s32 BSP_disp_get_screen_width(__u32 sel);
 extern __s32 BSP_disp_get_output_type(__u32 sel);
+extern __s32 BSP_disp_get_bandwidth(__u32 sel);
+extern __s32 BSP_disp_get_bandwidth_budget(void);
 extern __s32 BSP_disp_gamma_correction_enable(__u32 sel);
 extern __s32 BSP_disp_gamma_correction_disable(__u32 sel);
 extern __s32 BSP_disp_set_bright(__u32 sel, __u32 bright);
@@ -140,6 +144,7 @@ extern __s32 BSP_disp_layer_set_screen_window(__u32 sel, __u32 hid,
 					      __disp_rect_t *regn);
 extern __s32 BSP_disp_layer_get_screen_window(__u32 sel, __u32 hid,
 					      __disp_rect_t *regn);
+extern __s32 BSP_disp_layer_set_pos(__u32 sel, __u32 hid, __disp_pos_t *pos);
 extern __s32 BSP_disp_layer_set_para(__u32 sel, __u32 hid,
 				     __disp_layer_info_t *layer_para);
 extern __s32 BSP_disp_layer_get_para(__u32 sel, __u32 hid,
@@ -185,6 +190,10 @@ extern __s32 BSP_disp_layer_get_white_exten_level(__u32 sel, __u32 hid);
 extern __s32 BSP_disp_layer_set_black_exten_level(__u32 sel, __u32 hid,
 						  __u32 level);
 extern __s32 BSP_disp_layer_get_black_exten_level(__u32 sel, __u32 hid);
+extern __s32 BSP_disp_layer_commit(__u32 sel, __disp_layer_commit_t *commit,
+				   __u32 count);
+extern __s32 BSP_disp_layer_set_3d(__u32 sel, __u32 hid,
+				   __disp_layer_3d_t *trd);
 
 extern __s32 BSP_disp_scaler_get_smooth(__u32 sel);
 extern __s32 BSP_disp_scaler_set_smooth(__u32 sel, __disp_video_smooth_t mode);
@@ -202,9 +211,15 @@ extern __s32 BSP_disp_hwc_set_palette(__u32 sel, void *palette, __u32 offset,
 
 extern __s32 BSP_disp_video_set_fb(__u32 sel, __u32 hid,
 				   __disp_video_fb_t *in_addr);
+struct eventfd_ctx;
+extern __s32 BSP_disp_video_queue_fb(__u32 sel, __u32 hid,
+				     __disp_video_fb_t *fb, __s64 pts,
+				     struct eventfd_ctx *release);
 extern __s32 BSP_disp_video_get_frame_id(__u32 sel, __u32 hid);
 extern __s32 BSP_disp_video_get_dit_info(__u32 sel, __u32 hid,
 					 __disp_dit_info_t *dit_info);
+extern __s32 BSP_disp_video_set_dit_mode(__u32 sel, __u32 hid,
+					 __disp_video_dit_mode_t mode);
 extern __s32 BSP_disp_video_start(__u32 sel, __u32 hid);
 extern __s32 BSP_disp_video_stop(__u32 sel, __u32 hid);
 
@@ -215,6 +230,7 @@ extern __s32 BSP_disp_lcd_close_befor(__u32 sel);
 extern __s32 BSP_disp_lcd_close_after(__u32 sel);
 extern __lcd_flow_t *BSP_disp_lcd_get_close_flow(__u32 sel);
 extern __s32 BSP_disp_lcd_xy_switch(__u32 sel, __s32 mode);
+extern __s32 BSP_disp_lcd_cpu_update(__u32 sel);
 extern __s32 BSP_disp_set_gamma_table(__u32 sel, __u32 *gamtbl_addr,
 				      __u32 gamtbl_size);
 extern __s32 BSP_disp_lcd_set_bright(__u32 sel, __u32 bright, __u32 from_iep);
@@ -280,6 +296,8 @@ extern __s32 BSP_disp_sprite_block_request(__u32 sel,
 extern __s32 BSP_disp_sprite_block_release(__u32 sel, __s32 hid);
 extern __s32 BSP_disp_sprite_block_set_screen_win(__u32 sel, __s32 hid,
 						  __disp_rect_t *scn_win);
+extern __s32 BSP_disp_sprite_block_set_pos(__u32 sel, __s32 hid,
+					   __disp_pos_t *pos);
 extern __s32 BSP_disp_sprite_block_get_srceen_win(__u32 sel, __s32 hid,
 						  __disp_rect_t *scn_win);
 extern __s32 BSP_disp_sprite_block_set_src_win(__u32 sel, __s32 hid,
@@ -29,6 +29,14 @@ static __u32 de_scal_trd_itl_en;
 static __u32 de_scal_ch0r_offset;
 static __u32 de_scal_ch1r_offset;
 static __u32 de_scal_ch2r_offset;
+/*
+ * FIR table offsets currently loaded in the coefficient RAM of each
+ * scaler, 0 when unknown. Geometry changes that end up on the same table
+ * rows skip reloading the 192 coefficient registers.
+ */
+static __u32 de_scal_coef_key[2];
+#define DE_SCAL_COEF_KEY(ch0h, ch0v, ch1h, ch1v) \
+	(0x80000000 | ((ch0h) << 24) | ((ch0v) << 16) | ((ch1h) << 8) | (ch1v))
 
 
 /*
@@ -37,6 +45,7 @@ static __u32 de_scal_ch2r_offset;
 __s32 DE_SCAL_Set_Reg_Base(__u8 sel, __u32 base)
 {
 	scal_dev[sel] = (__de_scal_dev_t *) base;
+	de_scal_coef_key[sel] = 0;
 
 	return 0;
 }
@@ -536,7 +545,7 @@ __s32 DE_SCAL_Set_Scaling_Coef(__u8 sel, __scal_scan_mod_t *in_scan,
 	__u32 ch0v_fir_coef_ofst, ch0h_fir_coef_ofst, ch1v_fir_coef_ofst,
 	    ch1h_fir_coef_ofst;
 	__s32 fir_ofst_tmp;
-	__u32 i;
+	__u32 i, key;
 
 	in_w0 = in_size->scal_width;
 	in_h0 = in_size->scal_height;
@@ -698,6 +707,12 @@ __s32 DE_SCAL_Set_Scaling_Coef(__u8 sel, __scal_scan_mod_t *in_scan,
 	ch1h_fir_coef_ofst = (ch1h_fir_coef_ofst > (al1_size - 1)) ?
 		(al1_size - 1) : ch1h_fir_coef_ofst;
 
+	key = DE_SCAL_COEF_KEY(ch0h_fir_coef_ofst, ch0v_fir_coef_ofst,
+			       ch1h_fir_coef_ofst, ch1v_fir_coef_ofst);
+	if (key == de_scal_coef_key[sel])
+		return 0;
+	de_scal_coef_key[sel] = key;
+
 	/*
 	 * compute the fir coeficient address for each channel in horizontal and
 	 * vertical direction
@@ -1061,6 +1076,7 @@ __s32 DE_SCAL_Enable(__u8 sel)
 {
 	de_scal_trd_fp_en = 0;
 	de_scal_trd_itl_en = 0;
+	de_scal_coef_key[sel] = 0;
 	scal_dev[sel]->modl_en.bits.en = 0x1;
 	//scal_dev[sel]->field_ctrl.sync_edge= 0x1;
 
@@ -1073,6 +1089,7 @@ __s32 DE_SCAL_Enable(__u8 sel)
 __s32 DE_SCAL_Disable(__u8 sel)
 {
 	scal_dev[sel]->modl_en.bits.en = 0x0;
+	de_scal_coef_key[sel] = 0;
 
 	return 0;
 }
@@ -29,6 +29,11 @@
 #endif
 
 #include <linux/console.h>
+#include <linux/eventfd.h>
+#include <linux/ktime.h>
+#include <linux/poll.h>
+#include <linux/workqueue.h>
+#include <linux/sunxi_dramfreq.h>
 
 #include "drv_disp_i.h"
 #include "dev_disp.h"
@@ -280,10 +285,85 @@ __s32 disp_set_hdmi_func(__disp_hdmi_func *func)
 }
 EXPORT_SYMBOL(disp_set_hdmi_func);
 
+/*
+ * Latest vblank of each screen, read back through disp_read()/disp_poll().
+ */
+static struct {
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	__disp_vsync_event_t last[2];
+} disp_vsync;
+
+/*
+ * Writeback capture ring of each screen. The capture waits for the
+ * scaler, so the vblank only kicks the work; the buffers go FREE ->
+ * FILL -> READY -> USER (DQBUF) -> FREE (QBUF).
+ */
+enum {
+	DISP_CAPTURE_FREE,
+	DISP_CAPTURE_FILL,
+	DISP_CAPTURE_READY,
+	DISP_CAPTURE_USER,
+};
+
+static struct disp_capture_ring {
+	struct file *owner;
+	__disp_capture_ring_t para;
+	int state[DISP_CAPTURE_RING_MAX];
+	__disp_capture_frame_t frame[DISP_CAPTURE_RING_MAX];
+	__u32 next;
+	/* vblank the last capture was kicked at */
+	__u32 kick_frame;
+	__u64 kick_timestamp;
+	__u32 dropped;
+	struct work_struct work;
+} disp_capture[2];
+
+static DEFINE_SPINLOCK(disp_capture_lock);
+/* start and stop, a stop returns only once its work is gone */
+static DEFINE_MUTEX(disp_capture_mutex);
+static DECLARE_WAIT_QUEUE_HEAD(disp_capture_wait);
+static struct workqueue_struct *disp_capture_wq;
+
+static void disp_capture_work(struct work_struct *work);
+
+static void disp_vsync_event(__u32 sel)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+
+	spin_lock(&disp_vsync.lock);
+	disp_vsync.last[sel].frame++;
+	disp_vsync.last[sel].timestamp = ktime_to_ns(ktime_get());
+	spin_unlock(&disp_vsync.lock);
+
+	spin_lock(&disp_capture_lock);
+	if (ring->owner && disp_vsync.last[sel].frame - ring->kick_frame >=
+	    ring->para.interval) {
+		ring->kick_frame = disp_vsync.last[sel].frame;
+		ring->kick_timestamp = disp_vsync.last[sel].timestamp;
+		queue_work(disp_capture_wq, &ring->work);
+	}
+	spin_unlock(&disp_capture_lock);
+
+	sunxi_dramfreq_vblank(sel);
+	wake_up_interruptible(&disp_vsync.wait);
+}
+
 __s32 DRV_DISP_Init(void)
 {
 	__disp_bsp_init_para para;
 
+	spin_lock_init(&disp_vsync.lock);
+	init_waitqueue_head(&disp_vsync.wait);
+	disp_vsync.last[0].sel = 0;
+	disp_vsync.last[1].sel = 1;
+
+	INIT_WORK(&disp_capture[0].work, disp_capture_work);
+	INIT_WORK(&disp_capture[1].work, disp_capture_work);
+	disp_capture_wq = create_singlethread_workqueue("disp_capture");
+	if (!disp_capture_wq)
+		return -ENOMEM;
+
 	init_waitqueue_head(&g_fbi.wait[0]);
 	init_waitqueue_head(&g_fbi.wait[1]);
 	g_fbi.wait_count[0] = 0;
@@ -304,6 +384,7 @@ __s32 DRV_DISP_Init(void)
 	para.base_pioc = (__u32) g_fbi.base_pioc;
 	para.base_pwm = (__u32) g_fbi.base_pwm;
 	para.disp_int_process = DRV_disp_int_process;
+	para.vsync_event = disp_vsync_event;
 
 	memset(&g_disp_drv, 0, sizeof(struct __disp_drv_t));
 
@@ -318,6 +399,7 @@ __s32 DRV_DISP_Exit(void)
 	Fb_Exit();
 	BSP_disp_close();
 	BSP_disp_exit(g_disp_drv.exit_mode);
+	destroy_workqueue(disp_capture_wq);
 
 	return 0;
 }
@@ -417,8 +499,217 @@ struct dev_disp_data {
 	struct  {
 		__u32 layer[SUNXI_DISP_MAX_LAYERS];
 	} layers[2];
+	/* last vblank frame counter handed out by disp_read() */
+	__u32 vsync_frame[2];
+	/* writeback scaler handles of DISP_CMD_SCALER_REQUEST */
+	__u32 scalers[2];
+#ifdef CONFIG_FB_SUNXI_DMABUF
+	struct mutex dmabuf_lock;
+	struct list_head dmabuf_imports;
+#endif
 };
 
+/*
+ * Serializes the memory-to-memory use of the scalers, a request can
+ * otherwise race another file's execute on the same scaler.
+ */
+static DEFINE_MUTEX(disp_scaler_lock);
+
+static int disp_scaler_slot(struct dev_disp_data *data, __u32 handle)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(data->scalers); i++)
+		if (data->scalers[i] == handle)
+			return i;
+	return -1;
+}
+
+static void disp_capture_work(struct work_struct *work)
+{
+	struct disp_capture_ring *ring =
+		container_of(work, struct disp_capture_ring, work);
+	__u32 sel = ring - disp_capture;
+	__disp_capture_screen_para_t para;
+	__disp_capture_frame_t frame;
+	unsigned long flags;
+	__u32 i, idx;
+	__s32 ret;
+
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (!ring->owner) {
+		spin_unlock_irqrestore(&disp_capture_lock, flags);
+		return;
+	}
+	for (i = 0; i < ring->para.count; i++) {
+		idx = (ring->next + i) % ring->para.count;
+		if (ring->state[idx] == DISP_CAPTURE_FREE)
+			break;
+	}
+	if (i == ring->para.count) {
+		ring->dropped++;
+		spin_unlock_irqrestore(&disp_capture_lock, flags);
+		return;
+	}
+	ring->state[idx] = DISP_CAPTURE_FILL;
+	para.screen_size = ring->para.screen_size;
+	para.output_fb = ring->para.output_fb;
+	for (i = 0; i < 3; i++)
+		para.output_fb.addr[i] += ring->para.addr[idx];
+	frame.index = idx;
+	frame.frame = ring->kick_frame;
+	frame.timestamp = ring->kick_timestamp;
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+
+	mutex_lock(&disp_scaler_lock);
+	ret = BSP_disp_capture_screen(sel, &para);
+	mutex_unlock(&disp_scaler_lock);
+
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (ret == 0) {
+		ring->frame[idx] = frame;
+		ring->state[idx] = DISP_CAPTURE_READY;
+		ring->next = (idx + 1) % ring->para.count;
+	} else {
+		ring->state[idx] = DISP_CAPTURE_FREE;
+		ring->dropped++;
+	}
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+
+	if (ret == 0)
+		wake_up_interruptible(&disp_capture_wait);
+}
+
+static int disp_capture_start(struct file *filp, __u32 sel,
+			      __disp_capture_ring_t *para)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+	unsigned long flags;
+	int i;
+
+	if (para->count == 0 || para->count > DISP_CAPTURE_RING_MAX ||
+	    para->interval == 0)
+		return -EINVAL;
+
+	mutex_lock(&disp_capture_mutex);
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (ring->owner) {
+		spin_unlock_irqrestore(&disp_capture_lock, flags);
+		mutex_unlock(&disp_capture_mutex);
+		return -EBUSY;
+	}
+	ring->para = *para;
+	for (i = 0; i < DISP_CAPTURE_RING_MAX; i++)
+		ring->state[i] = DISP_CAPTURE_FREE;
+	ring->next = 0;
+	ring->dropped = 0;
+	ring->kick_frame = disp_vsync.last[sel].frame;
+	ring->owner = filp;
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+	mutex_unlock(&disp_capture_mutex);
+
+	return 0;
+}
+
+static int disp_capture_stop(struct file *filp, __u32 sel)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+	unsigned long flags;
+
+	mutex_lock(&disp_capture_mutex);
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (ring->owner != filp) {
+		spin_unlock_irqrestore(&disp_capture_lock, flags);
+		mutex_unlock(&disp_capture_mutex);
+		return -EINVAL;
+	}
+	ring->owner = NULL;
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+
+	/* the scaler is done with the buffers once this returns */
+	cancel_work_sync(&ring->work);
+	mutex_unlock(&disp_capture_mutex);
+	wake_up_interruptible(&disp_capture_wait);
+
+	return 0;
+}
+
+/* index of the oldest READY buffer, -1 if none, -2 if not the owner */
+static int disp_capture_oldest(struct file *filp, __u32 sel)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+	unsigned long flags;
+	int i, idx = -1;
+
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (ring->owner != filp) {
+		spin_unlock_irqrestore(&disp_capture_lock, flags);
+		return -2;
+	}
+	for (i = 0; i < ring->para.count; i++) {
+		if (ring->state[i] != DISP_CAPTURE_READY)
+			continue;
+		if (idx < 0 ||
+		    (__s32)(ring->frame[i].frame - ring->frame[idx].frame) < 0)
+			idx = i;
+	}
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+
+	return idx;
+}
+
+static int disp_capture_dqbuf(struct file *filp, __u32 sel,
+			      __disp_capture_frame_t *frame)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+	unsigned long flags;
+	int idx, ret;
+
+	for (;;) {
+		idx = disp_capture_oldest(filp, sel);
+		if (idx == -2)
+			return -EINVAL;
+		if (idx >= 0) {
+			spin_lock_irqsave(&disp_capture_lock, flags);
+			/* the ring may have been stopped and restarted */
+			if (ring->owner == filp &&
+			    ring->state[idx] == DISP_CAPTURE_READY) {
+				ring->state[idx] = DISP_CAPTURE_USER;
+				*frame = ring->frame[idx];
+				frame->dropped = ring->dropped;
+				spin_unlock_irqrestore(&disp_capture_lock, flags);
+				return 0;
+			}
+			spin_unlock_irqrestore(&disp_capture_lock, flags);
+			continue;
+		}
+
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(disp_capture_wait,
+					       disp_capture_oldest(filp, sel) != -1);
+		if (ret)
+			return ret;
+	}
+}
+
+static int disp_capture_qbuf(struct file *filp, __u32 sel, __u32 idx)
+{
+	struct disp_capture_ring *ring = &disp_capture[sel];
+	unsigned long flags;
+	int ret = -EINVAL;
+
+	spin_lock_irqsave(&disp_capture_lock, flags);
+	if (ring->owner == filp && idx < ring->para.count &&
+	    ring->state[idx] == DISP_CAPTURE_USER) {
+		ring->state[idx] = DISP_CAPTURE_FREE;
+		ret = 0;
+	}
+	spin_unlock_irqrestore(&disp_capture_lock, flags);
+
+	return ret;
+}
+
 static int disp_open(struct inode *inode, struct file *filp)
 {
 	struct dev_disp_data *data =
@@ -429,6 +720,12 @@ static int disp_open(struct inode *inode, struct file *filp)
 		return -ENOMEM;
 
 	data->version = SUNXI_DISP_VERSION_PENDING;
+	data->vsync_frame[0] = disp_vsync.last[0].frame;
+	data->vsync_frame[1] = disp_vsync.last[1].frame;
+#ifdef CONFIG_FB_SUNXI_DMABUF
+	mutex_init(&data->dmabuf_lock);
+	INIT_LIST_HEAD(&data->dmabuf_imports);
+#endif
 
 	filp->private_data = data;
 
@@ -456,16 +753,90 @@ static int disp_release(struct inode *inode, struct file *filp)
 				BSP_disp_layer_release(j,data->layers[j].layer[i]);
 			}
 
+	disp_capture_stop(filp, 0);
+	disp_capture_stop(filp, 1);
+
+	mutex_lock(&disp_scaler_lock);
+	for (i = 0; i < ARRAY_SIZE(data->scalers); i++)
+		if (data->scalers[i]) {
+			__wrn("scaler allocated at close: %u\n", data->scalers[i]);
+			BSP_disp_scaler_release(data->scalers[i]);
+		}
+	mutex_unlock(&disp_scaler_lock);
+
+#ifdef CONFIG_FB_SUNXI_DMABUF
+	disp_dmabuf_release_all(&data->dmabuf_imports);
+#endif
 	kfree(data);
 	filp->private_data = NULL;
 
 	return 0;
 }
 
+static bool disp_vsync_pending(struct dev_disp_data *data)
+{
+	return data->vsync_frame[0] != disp_vsync.last[0].frame ||
+		data->vsync_frame[1] != disp_vsync.last[1].frame;
+}
+
+/*
+ * Hand out one __disp_vsync_event_t per screen that had a vblank since
+ * the previous read, blocking until there is one unless O_NONBLOCK.
+ */
 static ssize_t disp_read(struct file *filp,
 		char __user *buf, size_t count, loff_t *ppos)
 {
-	return 0;
+	struct dev_disp_data *data = filp->private_data;
+	__disp_vsync_event_t ev[2];
+	unsigned long flags;
+	size_t n = 0;
+	int sel, ret;
+
+	if (count < sizeof(__disp_vsync_event_t))
+		return -EINVAL;
+
+	if (filp->f_flags & O_NONBLOCK) {
+		if (!disp_vsync_pending(data))
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(disp_vsync.wait,
+					       disp_vsync_pending(data));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock_irqsave(&disp_vsync.lock, flags);
+	for (sel = 0; sel < 2; sel++) {
+		if ((n + 1) * sizeof(__disp_vsync_event_t) > count)
+			break;
+		if (data->vsync_frame[sel] == disp_vsync.last[sel].frame)
+			continue;
+		ev[n++] = disp_vsync.last[sel];
+		data->vsync_frame[sel] = disp_vsync.last[sel].frame;
+	}
+	spin_unlock_irqrestore(&disp_vsync.lock, flags);
+
+	if (copy_to_user(buf, ev, n * sizeof(__disp_vsync_event_t)))
+		return -EFAULT;
+
+	return n * sizeof(__disp_vsync_event_t);
+}
+
+static unsigned int disp_poll(struct file *filp, poll_table *wait)
+{
+	struct dev_disp_data *data = filp->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(filp, &disp_vsync.wait, wait);
+	poll_wait(filp, &disp_capture_wait, wait);
+
+	if (disp_vsync_pending(data))
+		mask |= POLLIN | POLLRDNORM;
+	if (disp_capture_oldest(filp, 0) >= 0 ||
+	    disp_capture_oldest(filp, 1) >= 0)
+		mask |= POLLPRI;
+
+	return mask;
 }
 
 static ssize_t disp_write(struct file *filp,
@@ -865,9 +1236,55 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		break;
 
 	case DISP_CMD_CAPTURE_SCREEN:
+		mutex_lock(&disp_scaler_lock);
 		ret = BSP_disp_capture_screen(ubuffer[0],
 					      (__disp_capture_screen_para_t *)
 					      ubuffer[1]);
+		mutex_unlock(&disp_scaler_lock);
+		break;
+
+	case DISP_CMD_CAPTURE_RING_START:
+		{
+			__disp_capture_ring_t para;
+
+			if (ubuffer[0] > 1)
+				return -EINVAL;
+			if (copy_from_user(&para, (void __user *)ubuffer[1],
+					   sizeof(__disp_capture_ring_t))) {
+				__wrn("copy_from_user fail\n");
+				return -EFAULT;
+			}
+			ret = disp_capture_start(filp, ubuffer[0], &para);
+			break;
+		}
+
+	case DISP_CMD_CAPTURE_RING_STOP:
+		if (ubuffer[0] > 1)
+			return -EINVAL;
+		ret = disp_capture_stop(filp, ubuffer[0]);
+		break;
+
+	case DISP_CMD_CAPTURE_RING_DQBUF:
+		{
+			__disp_capture_frame_t frame;
+
+			if (ubuffer[0] > 1)
+				return -EINVAL;
+			ret = disp_capture_dqbuf(filp, ubuffer[0], &frame);
+			if (ret == 0 &&
+			    copy_to_user((void __user *)ubuffer[1], &frame,
+					 sizeof(__disp_capture_frame_t))) {
+				__wrn("copy_to_user fail\n");
+				disp_capture_qbuf(filp, ubuffer[0], frame.index);
+				return -EFAULT;
+			}
+			break;
+		}
+
+	case DISP_CMD_CAPTURE_RING_QBUF:
+		if (ubuffer[0] > 1)
+			return -EINVAL;
+		ret = disp_capture_qbuf(filp, ubuffer[0], ubuffer[1]);
 		break;
 
 	case DISP_CMD_SET_SCREEN_SIZE:
@@ -929,6 +1346,14 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		}
 
 	/* ----layer---- */
+	case DISP_CMD_GET_BANDWIDTH:
+		ret = BSP_disp_get_bandwidth(ubuffer[0]);
+		break;
+
+	case DISP_CMD_GET_BANDWIDTH_BUDGET:
+		ret = BSP_disp_get_bandwidth_budget();
+		break;
+
 	case DISP_CMD_LAYER_REQUEST:
 		ret = BSP_disp_layer_request(ubuffer[0],
 					     (__disp_layer_work_mode_t)
@@ -1256,14 +1681,85 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 							   ubuffer[1]);
 		break;
 
+	case DISP_CMD_LAYER_SET_POS:
+		{
+			__disp_pos_t para;
+
+			para.x = (__s32)ubuffer[2];
+			para.y = (__s32)ubuffer[3];
+			ret = BSP_disp_layer_set_pos(ubuffer[0], ubuffer[1],
+						     &para);
+			break;
+		}
+
+	case DISP_CMD_LAYER_COMMIT:
+		{
+			__disp_layer_commit_t *batch;
+			__u32 count = ubuffer[2];
+
+			if (count == 0 || count > DISP_COMMIT_MAX_LAYERS)
+				return -EINVAL;
+
+			batch = kmalloc(count * sizeof(__disp_layer_commit_t),
+					GFP_KERNEL);
+			if (!batch)
+				return -ENOMEM;
+
+			if (copy_from_user(batch, (void __user *)ubuffer[1],
+					   count *
+					   sizeof(__disp_layer_commit_t))) {
+				__wrn("copy_from_user fail\n");
+				kfree(batch);
+				return -EFAULT;
+			}
+			ret = BSP_disp_layer_commit(ubuffer[0], batch, count);
+			kfree(batch);
+			break;
+		}
+
+	case DISP_CMD_LAYER_SET_3D:
+		{
+			__disp_layer_3d_t para;
+
+			if (copy_from_user(&para, (void __user *)ubuffer[2],
+					   sizeof(__disp_layer_3d_t))) {
+				__wrn("copy_from_user fail\n");
+				return -EFAULT;
+			}
+			ret = BSP_disp_layer_set_3d(ubuffer[0], ubuffer[1],
+						    &para);
+			break;
+		}
+
 	/* ----scaler---- */
 	case DISP_CMD_SCALER_REQUEST:
-		ret = BSP_disp_scaler_request();
-		break;
+		{
+			int slot;
+
+			mutex_lock(&disp_scaler_lock);
+			slot = disp_scaler_slot(filp_data, 0);
+			ret = slot < 0 ? -EBUSY : BSP_disp_scaler_request();
+			if (ret > 0)
+				filp_data->scalers[slot] = ret;
+			mutex_unlock(&disp_scaler_lock);
+			break;
+		}
 
 	case DISP_CMD_SCALER_RELEASE:
-		ret = BSP_disp_scaler_release(ubuffer[1]);
-		break;
+		{
+			int slot;
+
+			mutex_lock(&disp_scaler_lock);
+			slot = ubuffer[1] ? disp_scaler_slot(filp_data, ubuffer[1]) : -1;
+			if (slot < 0) {
+				ret = -EINVAL;
+			} else {
+				ret = BSP_disp_scaler_release(ubuffer[1]);
+				filp_data->scalers[slot] = 0;
+			}
+			mutex_unlock(&disp_scaler_lock);
+			break;
+		}
 
 	case DISP_CMD_SCALER_EXECUTE:
 		{
@@ -1274,7 +1770,12 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 				__wrn("copy_from_user fail\n");
 				return -EFAULT;
 			}
-			ret = BSP_disp_scaler_start(ubuffer[1], &para);
+			mutex_lock(&disp_scaler_lock);
+			if (!ubuffer[1] || disp_scaler_slot(filp_data, ubuffer[1]) < 0)
+				ret = -EINVAL;
+			else
+				ret = BSP_disp_scaler_start(ubuffer[1], &para);
+			mutex_unlock(&disp_scaler_lock);
 			break;
 		}
 
@@ -1366,10 +1867,76 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+	case DISP_CMD_VIDEO_QUEUE_FB:
+		{
+			__disp_video_queue_fb_t para;
+			struct eventfd_ctx *release = NULL;
+
+			if (copy_from_user(&para, (void __user *)ubuffer[2],
+					   sizeof(__disp_video_queue_fb_t))) {
+				__wrn("copy_from_user fail\n");
+				return -EFAULT;
+			}
+			if (para.release_fd >= 0) {
+				release = eventfd_ctx_fdget(para.release_fd);
+				if (IS_ERR(release))
+					return PTR_ERR(release);
+			}
+			ret = BSP_disp_video_queue_fb(ubuffer[0], ubuffer[1],
+						      &para.fb, para.pts,
+						      release);
+			if (ret != DIS_SUCCESS && release)
+				eventfd_ctx_put(release);
+			break;
+		}
+
+#ifdef CONFIG_FB_SUNXI_DMABUF
+	/* ----dma-buf---- */
+	case DISP_CMD_DMABUF_IMPORT:
+		{
+			__disp_dmabuf_import_t para;
+
+			if (copy_from_user(&para, (void __user *)ubuffer[1],
+					   sizeof(__disp_dmabuf_import_t))) {
+				__wrn("copy_from_user fail\n");
+				return -EFAULT;
+			}
+			mutex_lock(&filp_data->dmabuf_lock);
+			ret = disp_dmabuf_import(&filp_data->dmabuf_imports,
+						 para.fd, &para.addr,
+						 &para.size);
+			mutex_unlock(&filp_data->dmabuf_lock);
+			if (ret)
+				break;
+			if (copy_to_user((void __user *)ubuffer[1], &para,
+					 sizeof(__disp_dmabuf_import_t))) {
+				__wrn("copy_to_user fail\n");
+				mutex_lock(&filp_data->dmabuf_lock);
+				disp_dmabuf_release(&filp_data->dmabuf_imports,
+						    para.addr);
+				mutex_unlock(&filp_data->dmabuf_lock);
+				return -EFAULT;
+			}
+			break;
+		}
+
+	case DISP_CMD_DMABUF_RELEASE:
+		mutex_lock(&filp_data->dmabuf_lock);
+		ret = disp_dmabuf_release(&filp_data->dmabuf_imports,
+					  ubuffer[1]);
+		mutex_unlock(&filp_data->dmabuf_lock);
+		break;
+#endif
+
 	case DISP_CMD_VIDEO_GET_FRAME_ID:
 		ret = BSP_disp_video_get_frame_id(ubuffer[0], ubuffer[1]);
 		break;
 
+	case DISP_CMD_VIDEO_SET_DIT_MODE:
+		ret = BSP_disp_video_set_dit_mode(ubuffer[0], ubuffer[1],
+						  ubuffer[2]);
+		break;
+
 	case DISP_CMD_VIDEO_GET_DIT_INFO:
 		{
 			__disp_dit_info_t para;
@@ -1415,6 +1982,10 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 					   (__disp_lcdc_src_t) ubuffer[1]);
 		break;
 
+	case DISP_CMD_LCD_CPUIF_UPDATE:
+		ret = BSP_disp_lcd_cpu_update(ubuffer[0]);
+		break;
+
 	case DISP_CMD_LCD_USER_DEFINED_FUNC:
 		ret =  BSP_disp_lcd_user_defined_func(ubuffer[0], ubuffer[1],
 						      ubuffer[2], ubuffer[3]);
@@ -1658,6 +2229,17 @@ static long disp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+	case DISP_CMD_SPRITE_BLOCK_SET_POS:
+		{
+			__disp_pos_t para;
+
+			para.x = (__s32)ubuffer[2];
+			para.y = (__s32)ubuffer[3];
+			ret = BSP_disp_sprite_block_set_pos(ubuffer[0], ubuffer[1],
+							    &para);
+			break;
+		}
+
 	case DISP_CMD_SPRITE_BLOCK_GET_SCREEN_WINDOW:
 		{
 			__disp_rect_t para;
@@ -1883,6 +2465,7 @@ static const struct file_operations disp_fops = {
 	.release = disp_release,
 	.write = disp_write,
 	.read = disp_read,
+	.poll = disp_poll,
 	.unlocked_ioctl = disp_ioctl,
 	.mmap = disp_mmap,
 };
@@ -41,6 +41,14 @@ int disp_check_fbmem(int sel, int width, int height);
 const struct fb_videomode *hdmi_edid_received(unsigned char *edid, int block, __u8 *vic_support);
 
 __s32 Fb_Init(__u32 from);
+
+#ifdef CONFIG_FB_SUNXI_DMABUF
+int disp_dmabuf_export_fb(struct fb_info *info, __u32 flags);
+int disp_dmabuf_import(struct list_head *imports, int fd,
+		       __u32 *addr, __u32 *size);
+int disp_dmabuf_release(struct list_head *imports, __u32 addr);
+void disp_dmabuf_release_all(struct list_head *imports);
+#endif
 __s32 DRV_lcd_open(__u32 sel);
 __s32 DRV_lcd_close(__u32 sel);
 
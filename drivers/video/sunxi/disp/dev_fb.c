@@ -25,6 +25,9 @@
 #ifdef CONFIG_FB_SUNXI_UMP
 #include <ump/ump_kernel_interface.h>
 #endif
+#ifdef CONFIG_FB_SUNXI_G2D
+#include <linux/g2d_driver.h>
+#endif
 
 #include "drv_disp_i.h"
 #include "dev_disp.h"
@@ -1031,6 +1034,7 @@ static int Fb_pan_display(struct fb_var_screeninfo *var, struct fb_info *info)
 		     (g_fbi.fb_mode[info->node] != FB_MODE_SCREEN0))) {
 			__s32 layer_hdl = g_fbi.layer_hdl[info->node][sel];
 			__disp_layer_info_t layer_para;
+			__disp_rect_t src_win;
 			__u32 buffer_num = 1;
 			__u32 y_offset = 0;
 
@@ -1049,34 +1053,36 @@ static int Fb_pan_display(struct fb_var_screeninfo *var, struct fb_info *info)
 
 			BSP_disp_layer_get_para(sel, layer_hdl, &layer_para);
 
-			if (layer_para.mode == DISP_LAYER_WORK_MODE_SCALER) {
-				layer_para.src_win.x = var->xoffset;
-				layer_para.src_win.y = var->yoffset + y_offset;
-				layer_para.src_win.width = var->xres;
-				layer_para.src_win.height =
-					var->yres / buffer_num;
+			src_win.x = var->xoffset;
+			src_win.y = var->yoffset + y_offset;
+			src_win.width = var->xres;
+			src_win.height = var->yres / buffer_num;
 
+			/*
+			 * A flip normally only moves the source offset; leave
+			 * untouched windows alone so the scaler is not
+			 * reprogrammed, and latch both on the same vblank.
+			 */
+			BSP_disp_cfg_start(sel);
+			if (memcmp(&src_win, &layer_para.src_win,
+				   sizeof(__disp_rect_t)))
 				BSP_disp_layer_set_src_window(sel, layer_hdl,
-							      &(layer_para.
-								src_win));
-			} else {
-				layer_para.src_win.x = var->xoffset;
-				layer_para.src_win.y = var->yoffset + y_offset;
-				layer_para.src_win.width = var->xres;
-				layer_para.src_win.height =
-				    var->yres / buffer_num;
+							      &src_win);
 
+			if (layer_para.mode != DISP_LAYER_WORK_MODE_SCALER &&
+			    (layer_para.scn_win.width != var->xres ||
+			     layer_para.scn_win.height !=
+			     var->yres / buffer_num)) {
 				layer_para.scn_win.width = var->xres;
 				layer_para.scn_win.height =
 					var->yres / buffer_num;
 
-				BSP_disp_layer_set_src_window(sel, layer_hdl,
-							      &(layer_para.
-								src_win));
 				BSP_disp_layer_set_screen_window(sel, layer_hdl,
 								 &(layer_para.
 								   scn_win));
 			}
+			BSP_disp_cfg_finish(sel);
+			BSP_disp_lcd_cpu_update(sel);
 		}
 	}
 
@@ -1161,7 +1167,7 @@ static int Fb_set_par(struct fb_info *info)
 			struct fb_fix_screeninfo *fix = &info->fix;
 			bool mode_changed = false;
 			__s32 layer_hdl = g_fbi.layer_hdl[info->node][sel];
-			__disp_layer_info_t layer_para;
+			__disp_layer_info_t layer_para, old_para;
 			__u32 buffer_num = 1;
 			__u32 y_offset = 0;
 
@@ -1196,6 +1202,7 @@ static int Fb_set_par(struct fb_info *info)
 				y_offset = var->yres / 2;
 
 			BSP_disp_layer_get_para(sel, layer_hdl, &layer_para);
+			old_para = layer_para;
 
 			var_to_disp_fb(&(layer_para.fb), var, fix);
 			layer_para.src_win.x = var->xoffset;
@@ -1209,7 +1216,11 @@ static int Fb_set_par(struct fb_info *info)
 				layer_para.scn_win.height =
 					layer_para.src_win.height;
 			}
-			BSP_disp_layer_set_para(sel, layer_hdl, &layer_para);
+			/* a refresh rate only switch leaves the layer alone */
+			if (memcmp(&layer_para, &old_para,
+				   sizeof(__disp_layer_info_t)))
+				BSP_disp_layer_set_para(sel, layer_hdl,
+							&layer_para);
 		}
 	}
 	return 0;
@@ -1424,6 +1435,24 @@ static int Fb_ioctl(struct fb_info *info, unsigned int cmd, unsigned long arg)
 			break;
 		}
 
+#ifdef CONFIG_FB_SUNXI_DMABUF
+	case FBIOGET_DMABUF:
+		{
+			__disp_fb_dmabuf_export_t para;
+
+			if (copy_from_user(&para, (void __user *)arg,
+					   sizeof(para)))
+				return -EFAULT;
+			para.fd = disp_dmabuf_export_fb(info, para.flags);
+			if (para.fd < 0)
+				return para.fd;
+			if (copy_to_user((void __user *)arg, &para,
+					 sizeof(para)))
+				return -EFAULT;
+			break;
+		}
+#endif
+
 #ifdef CONFIG_FB_SUNXI_UMP
 	case GET_UMP_SECURE_ID_BUF2:	/* flow trough */
 		secure_id_buf_num++;
@@ -1448,6 +1477,161 @@ static int Fb_ioctl(struct fb_info *info, unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+#ifdef CONFIG_FB_SUNXI_G2D
+/*
+ * fillrect and copyarea go to the G2D engine. Small areas (fbcon glyph
+ * cells), other rops and layouts G2D can't do are drawn by the cpu, as
+ * is imageblit: fbcon only hands it mono glyphs from kernel memory.
+ */
+#define DISPFB_G2D_MIN_PIXELS 1024
+
+static int Fb_g2d_image(struct fb_info *info, g2d_image *image)
+{
+	struct fb_var_screeninfo *var = &info->var;
+
+	if (var->bits_per_pixel == 32 && var->red.offset == 16 &&
+	    var->green.offset == 8 && var->blue.offset == 0)
+		image->format = var->transp.length ?
+			G2D_FMT_ARGB_AYUV8888 : G2D_FMT_XRGB8888;
+	else if (var->bits_per_pixel == 16 && var->red.offset == 11 &&
+		 var->green.offset == 5 && var->green.length == 6 &&
+		 var->blue.offset == 0)
+		image->format = G2D_FMT_RGB565;
+	else
+		return -EINVAL;
+
+	image->addr[0] = info->fix.smem_start;
+	image->addr[1] = 0;
+	image->addr[2] = 0;
+	image->w = info->fix.line_length * 8 / var->bits_per_pixel;
+	image->h = var->yres_virtual;
+	image->pixel_seq = G2D_SEQ_NORMAL;
+
+	return 0;
+}
+
+/* the fill color register is ARGB8888 whatever the output format */
+static __u32 Fb_g2d_color(struct fb_info *info, __u32 color)
+{
+	__u32 r, g, b;
+
+	if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		color = ((__u32 *) info->pseudo_palette)[color];
+
+	if (info->var.bits_per_pixel == 32)
+		return info->var.transp.length ? color : color | 0xff000000;
+
+	r = (color >> 11) & 0x1f;
+	g = (color >> 5) & 0x3f;
+	b = color & 0x1f;
+
+	return 0xff000000 | (((r << 3) | (r >> 2)) << 16) |
+		(((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+static void Fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect)
+{
+	g2d_fillrect fill;
+
+	if (info->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (rect->rop != ROP_COPY ||
+	    rect->width * rect->height < DISPFB_G2D_MIN_PIXELS ||
+	    Fb_g2d_image(info, &fill.dst_image))
+		goto cpu;
+
+	fill.flag = G2D_FIL_NONE;
+	fill.dst_rect.x = rect->dx;
+	fill.dst_rect.y = rect->dy;
+	fill.dst_rect.w = rect->width;
+	fill.dst_rect.h = rect->height;
+	fill.color = Fb_g2d_color(info, rect->color);
+	fill.alpha = 0;
+
+	if (g2d_kernel_fill(&fill) == 0)
+		return;
+cpu:
+	cfb_fillrect(info, rect);
+}
+
+static void Fb_copyarea(struct fb_info *info, const struct fb_copyarea *area)
+{
+	g2d_blt blt;
+
+	if (info->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (area->width * area->height < DISPFB_G2D_MIN_PIXELS ||
+	    Fb_g2d_image(info, &blt.src_image))
+		goto cpu;
+
+	/* overlapping copies are fine, mixer picks the scan order */
+	blt.flag = G2D_BLT_NONE;
+	blt.dst_image = blt.src_image;
+	blt.src_rect.x = area->sx;
+	blt.src_rect.y = area->sy;
+	blt.src_rect.w = area->width;
+	blt.src_rect.h = area->height;
+	blt.dst_x = area->dx;
+	blt.dst_y = area->dy;
+	blt.color = 0;
+	blt.alpha = 0;
+
+	if (g2d_kernel_blit(&blt) == 0)
+		return;
+cpu:
+	cfb_copyarea(info, area);
+}
+
+/*
+ * G2D can't read cedar's tiled output, so its tiled conversions are run
+ * on a free scaler in writeback mode. The rects are already checked.
+ */
+static int Fb_g2d_tiled_convert(g2d_convert *para)
+{
+	__disp_scaler_para_t scal;
+	__s32 hdl;
+	__s32 ret;
+
+	memset(&scal, 0, sizeof(__disp_scaler_para_t));
+	scal.input_fb.addr[0] = para->src_image.addr[0];
+	scal.input_fb.addr[1] = para->src_image.addr[1];
+	scal.input_fb.size.width = para->src_image.w;
+	scal.input_fb.size.height = para->src_image.h;
+	scal.input_fb.format =
+		para->src_image.format == G2D_FMT_PYUV420UVC_MB32 ?
+		DISP_FORMAT_YUV420 : DISP_FORMAT_YUV422;
+	scal.input_fb.seq = DISP_SEQ_UVUV;
+	scal.input_fb.mode = DISP_MOD_MB_UV_COMBINED;
+	scal.input_fb.cs_mode = DISP_BT601;
+	scal.source_regn.x = para->src_rect.x;
+	scal.source_regn.y = para->src_rect.y;
+	scal.source_regn.width = para->src_rect.w;
+	scal.source_regn.height = para->src_rect.h;
+
+	/* whole lines, so dst_rect just moves the start address */
+	scal.output_fb.addr[0] = para->dst_image.addr[0] +
+		para->dst_rect.y * para->dst_image.w * 4;
+	scal.output_fb.size.width = para->dst_rect.w;
+	scal.output_fb.size.height = para->dst_rect.h;
+	scal.output_fb.format = DISP_FORMAT_ARGB8888;
+	scal.output_fb.seq = DISP_SEQ_ARGB;
+	scal.output_fb.mode = DISP_MOD_INTERLEAVED;
+	scal.output_fb.cs_mode = DISP_BT601;
+
+	hdl = BSP_disp_scaler_request();
+	if (hdl < 0)
+		return -EBUSY;
+
+	ret = BSP_disp_scaler_start(hdl, &scal);
+	BSP_disp_scaler_release(hdl);
+
+	return ret == DIS_SUCCESS ? 0 : -EIO;
+}
+#endif
+
 static struct fb_ops dispfb_ops = {
 	.owner = THIS_MODULE,
 	.fb_open = Fb_open,
@@ -1459,8 +1643,13 @@ static struct fb_ops dispfb_ops = {
 	.fb_setcolreg = Fb_setcolreg,
 	.fb_setcmap = Fb_setcmap,
 	.fb_blank = Fb_blank,
+#ifdef CONFIG_FB_SUNXI_G2D
+	.fb_fillrect = Fb_fillrect,
+	.fb_copyarea = Fb_copyarea,
+#else
 	.fb_fillrect = cfb_fillrect,
 	.fb_copyarea = cfb_copyarea,
+#endif
 	.fb_imageblit = cfb_imageblit,
 	.fb_cursor = Fb_cursor,
 };
@@ -1859,6 +2048,9 @@ __s32 Fb_Init(__u32 from)
 	mutex_lock(&fb_init_mutex);
 	if (first_time) { /* First call ? */
 		DRV_DISP_Init();
+#ifdef CONFIG_FB_SUNXI_G2D
+		g2d_set_tiled_convert(Fb_g2d_tiled_convert);
+#endif
 
 #ifdef CONFIG_FB_SUNXI_RESERVED_MEM
 		__inf("fbmem: fb_start=%lu, fb_size=%lu\n", fb_start, fb_size);
@@ -2091,6 +2283,10 @@ __s32 Fb_Exit(void)
 {
 	__u8 fb_id = 0;
 
+#ifdef CONFIG_FB_SUNXI_G2D
+	g2d_set_tiled_convert(NULL);
+#endif
+
 	for (fb_id = 0; fb_id < SUNXI_MAX_FB; fb_id++) {
 		if (g_fbi.fbinfo[fb_id] == NULL)
 			continue;
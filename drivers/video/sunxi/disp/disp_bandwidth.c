@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2007-2012 Allwinner Technology Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Scanout memory bandwidth accounting. Each opened layer costs its source
+ * window times bytes per pixel times the refresh rate of its screen; the
+ * sum over both screens is checked against an optional budget, and the
+ * DRAM host ports that feed DE-BE/FE can be raised in priority so that
+ * scanout wins over Cedar and the CPU when the controller is saturated.
+ */
+
+#include <linux/module.h>
+#include <linux/sunxi_dramfreq.h>
+#include "disp_bandwidth.h"
+#include "disp_display.h"
+#include "disp_layer.h"
+
+/* DRAM controller host port configuration registers */
+#define DRAMC_HPCR_OFF 0x250
+#define DRAMC_HPCR_PRIO_SHIFT 2
+#define DRAMC_HPCR_PRIO_MASK (0x3 << DRAMC_HPCR_PRIO_SHIFT)
+
+static unsigned int bw_budget;
+module_param(bw_budget, uint, 0644);
+MODULE_PARM_DESC(bw_budget, "scanout bandwidth budget in MB/s, 0: no limit");
+
+static int dram_ports[4] = { -1, -1, -1, -1 };
+static int dram_ports_num;
+module_param_array(dram_ports, int, &dram_ports_num, 0444);
+MODULE_PARM_DESC(dram_ports,
+	"DRAM host port index of be0,be1,fe0,fe1 to set priority on");
+
+static unsigned int dram_prio = 3;
+module_param(dram_prio, uint, 0444);
+MODULE_PARM_DESC(dram_prio, "DRAM priority level (0-3) for dram_ports");
+
+/* bits per pixel of the data fetched from memory for a layer format */
+static __u32 disp_bw_format_bits(__disp_pixel_fmt_t format)
+{
+	switch (format) {
+	case DISP_FORMAT_1BPP:
+		return 1;
+	case DISP_FORMAT_2BPP:
+		return 2;
+	case DISP_FORMAT_4BPP:
+		return 4;
+	case DISP_FORMAT_8BPP:
+		return 8;
+	case DISP_FORMAT_RGB655:
+	case DISP_FORMAT_RGB565:
+	case DISP_FORMAT_RGB556:
+	case DISP_FORMAT_ARGB1555:
+	case DISP_FORMAT_RGBA5551:
+	case DISP_FORMAT_ARGB4444:
+	case DISP_FORMAT_YUV422:
+		return 16;
+	case DISP_FORMAT_RGB888:
+	case DISP_FORMAT_YUV444:
+		return 24;
+	case DISP_FORMAT_YUV420:
+	case DISP_FORMAT_YUV411:
+		return 12;
+	default:
+		return 32;
+	}
+}
+
+static __u32 disp_bw_refresh(__u32 sel)
+{
+	struct fb_videomode mode;
+
+	if (BSP_disp_get_videomode(sel, &mode) == 0 && mode.refresh)
+		return mode.refresh;
+
+	return 60;
+}
+
+/*
+ * bandwidth of one layer in KB/s
+ */
+__u32 Disp_bw_layer(__u32 sel, __disp_layer_info_t *para)
+{
+	__u64 bytes;
+
+	bytes = (__u64)para->src_win.width * para->src_win.height *
+		disp_bw_format_bits(para->fb.format) * disp_bw_refresh(sel);
+	do_div(bytes, 8 * 1024);
+
+	return (__u32)bytes;
+}
+
+/*
+ * bandwidth of all opened layers of a screen in KB/s
+ */
+__s32 BSP_disp_get_bandwidth(__u32 sel)
+{
+	__u32 i, kbps = 0;
+
+	for (i = 0; i < gdisp.screen[sel].max_layers; i++) {
+		__layer_man_t *layer_man = &gdisp.screen[sel].layer_manage[i];
+
+		if ((layer_man->status & LAYER_USED) &&
+		    (layer_man->status & LAYER_OPENED))
+			kbps += Disp_bw_layer(sel, &layer_man->para);
+	}
+
+	return kbps;
+}
+
+__s32 BSP_disp_get_bandwidth_budget(void)
+{
+	return bw_budget * 1024;
+}
+
+/*
+ * Check a proposed total for screen sel against the budget, counting the
+ * other screen as it is now.
+ */
+__s32 Disp_bw_check(__u32 sel, __u32 kbps)
+{
+	__u32 total = kbps + BSP_disp_get_bandwidth(1 - sel);
+
+	if (bw_budget && total > bw_budget * 1024) {
+		DE_WRN("scanout needs %u KB/s, budget is %u MB/s\n",
+		       total, bw_budget);
+		return DIS_NO_RES;
+	}
+
+	/* the dram clock goes up before the layers do */
+	sunxi_dramfreq_scanout(total);
+
+	return DIS_SUCCESS;
+}
+
+/*
+ * Report the bandwidth of both screens as it is now to the dram clock
+ * scaling, after layers were closed or changed.
+ */
+void Disp_bw_update(void)
+{
+	sunxi_dramfreq_scanout(BSP_disp_get_bandwidth(0) +
+			       BSP_disp_get_bandwidth(1));
+}
+
+__s32 Disp_bw_init(void)
+{
+	void __iomem *hpcr;
+	__u32 i, reg;
+
+	if (!gdisp.init_para.base_sdram)
+		return DIS_FAIL;
+
+	for (i = 0; i < dram_ports_num; i++) {
+		if (dram_ports[i] < 0 || dram_ports[i] > 31)
+			continue;
+
+		hpcr = (void __iomem *)(gdisp.init_para.base_sdram +
+					DRAMC_HPCR_OFF + (dram_ports[i] << 2));
+		reg = readl(hpcr);
+		reg &= ~DRAMC_HPCR_PRIO_MASK;
+		reg |= (dram_prio & 0x3) << DRAMC_HPCR_PRIO_SHIFT;
+		writel(reg, hpcr);
+		DE_INF("dram host port %d priority %u\n", dram_ports[i],
+		       dram_prio & 0x3);
+	}
+
+	return DIS_SUCCESS;
+}
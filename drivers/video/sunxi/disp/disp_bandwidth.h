@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2007-2012 Allwinner Technology Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef __DISP_BANDWIDTH_H__
+#define __DISP_BANDWIDTH_H__
+
+#include "disp_display_i.h"
+
+extern __u32 Disp_bw_layer(__u32 sel, __disp_layer_info_t *para);
+extern __s32 Disp_bw_check(__u32 sel, __u32 kbps);
+extern void Disp_bw_update(void);
+extern __s32 Disp_bw_init(void);
+
+#endif
@@ -27,6 +27,7 @@
 #include "disp_video.h"
 #include "disp_clk.h"
 #include "disp_hdmi.h"
+#include "disp_bandwidth.h"
 
 __disp_dev_t gdisp;
 static bool disp_initialised;
@@ -94,6 +95,8 @@ __s32 BSP_disp_init(__disp_bsp_init_para *para)
 
 	Disp_iep_init(0);
 
+	Disp_bw_init();
+
 	disp_initialised = true;
 
 	return DIS_SUCCESS;
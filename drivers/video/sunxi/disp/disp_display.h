@@ -83,6 +83,10 @@ typedef struct {
 	__bool lcd_io_used[28];
 	user_gpio_set_t lcd_io[28];
 
+	/* tear effect output of a cpu panel, muxed to its EINT */
+	__bool lcd_cpu_te_used;
+	user_gpio_set_t lcd_cpu_te;
+
 	__u32 init_bright;
 } __disp_lcd_cfg_t;
 
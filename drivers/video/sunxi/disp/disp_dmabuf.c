@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2007-2012 Allwinner Technology Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * dma-buf glue: framebuffers are exported so other devices can render
+ * into them, and dma-bufs from other exporters are imported and pinned
+ * so their physical address can be used as a layer or scaler source.
+ * The display engine has no MMU, so imported buffers must be contiguous.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
+
+#include "drv_disp_i.h"
+#include "dev_disp.h"
+#include "dev_fb.h"
+
+struct disp_dmabuf_import {
+	struct list_head list;
+	struct dma_buf *buf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	__u32 addr;
+	__u32 size;
+};
+
+static struct sg_table *disp_dmabuf_map(struct dma_buf_attachment *attach,
+					enum dma_data_direction dir)
+{
+	struct fb_info *info = attach->dmabuf->priv;
+	struct sg_table *sgt;
+
+	sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sg_set_page(sgt->sgl, pfn_to_page(__phys_to_pfn(info->fix.smem_start)),
+		    PAGE_ALIGN(info->fix.smem_len), 0);
+
+	if (!dma_map_sg(attach->dev, sgt->sgl, sgt->nents, dir)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void disp_dmabuf_unmap(struct dma_buf_attachment *attach,
+			      struct sg_table *sgt,
+			      enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void disp_dmabuf_release_fb(struct dma_buf *buf)
+{
+	/* the framebuffer memory lives as long as the fb device */
+}
+
+static void *disp_dmabuf_kmap(struct dma_buf *buf, unsigned long pgnum)
+{
+	struct fb_info *info = buf->priv;
+
+	return phys_to_virt(info->fix.smem_start) + (pgnum << PAGE_SHIFT);
+}
+
+static void *disp_dmabuf_kmap_atomic(struct dma_buf *buf, unsigned long pgnum)
+{
+	return disp_dmabuf_kmap(buf, pgnum);
+}
+
+static int disp_dmabuf_mmap(struct dma_buf *buf, struct vm_area_struct *vma)
+{
+	struct fb_info *info = buf->priv;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if ((vma->vm_pgoff << PAGE_SHIFT) + size >
+	    PAGE_ALIGN(info->fix.smem_len))
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       __phys_to_pfn(info->fix.smem_start) +
+			       vma->vm_pgoff, size, vma->vm_page_prot);
+}
+
+static const struct dma_buf_ops disp_dmabuf_ops = {
+	.map_dma_buf = disp_dmabuf_map,
+	.unmap_dma_buf = disp_dmabuf_unmap,
+	.release = disp_dmabuf_release_fb,
+	.kmap_atomic = disp_dmabuf_kmap_atomic,
+	.kmap = disp_dmabuf_kmap,
+	.mmap = disp_dmabuf_mmap,
+};
+
+/*
+ * Export the memory of a framebuffer, returns a new dma-buf fd.
+ */
+int disp_dmabuf_export_fb(struct fb_info *info, __u32 flags)
+{
+	struct dma_buf *buf;
+	int fd;
+
+	if (!info->fix.smem_start || !info->fix.smem_len)
+		return -ENODEV;
+
+	buf = dma_buf_export(info, &disp_dmabuf_ops,
+			     PAGE_ALIGN(info->fix.smem_len), O_RDWR);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	fd = dma_buf_fd(buf, flags & O_CLOEXEC);
+	if (fd < 0)
+		dma_buf_put(buf);
+
+	return fd;
+}
+
+/*
+ * Attach to and map a dma-buf, and keep it pinned on the caller's list
+ * until disp_dmabuf_release() or disp_dmabuf_release_all().
+ */
+int disp_dmabuf_import(struct list_head *imports, int fd,
+		       __u32 *addr, __u32 *size)
+{
+	struct disp_dmabuf_import *imp;
+	int ret;
+
+	imp = kzalloc(sizeof(struct disp_dmabuf_import), GFP_KERNEL);
+	if (!imp)
+		return -ENOMEM;
+
+	imp->buf = dma_buf_get(fd);
+	if (IS_ERR(imp->buf)) {
+		ret = PTR_ERR(imp->buf);
+		goto err_free;
+	}
+
+	imp->attach = dma_buf_attach(imp->buf, g_fbi.dev);
+	if (IS_ERR(imp->attach)) {
+		ret = PTR_ERR(imp->attach);
+		goto err_put;
+	}
+
+	imp->sgt = dma_buf_map_attachment(imp->attach, DMA_TO_DEVICE);
+	if (IS_ERR_OR_NULL(imp->sgt)) {
+		ret = imp->sgt ? PTR_ERR(imp->sgt) : -ENOMEM;
+		goto err_detach;
+	}
+
+	if (imp->sgt->nents != 1) {
+		__wrn("dma-buf fd %d is not contiguous (%d chunks)\n",
+		      fd, imp->sgt->nents);
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	imp->addr = sg_phys(imp->sgt->sgl);
+	imp->size = imp->buf->size;
+	list_add(&imp->list, imports);
+
+	*addr = imp->addr;
+	*size = imp->size;
+
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_TO_DEVICE);
+err_detach:
+	dma_buf_detach(imp->buf, imp->attach);
+err_put:
+	dma_buf_put(imp->buf);
+err_free:
+	kfree(imp);
+	return ret;
+}
+
+static void disp_dmabuf_put_import(struct disp_dmabuf_import *imp)
+{
+	list_del(&imp->list);
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, DMA_TO_DEVICE);
+	dma_buf_detach(imp->buf, imp->attach);
+	dma_buf_put(imp->buf);
+	kfree(imp);
+}
+
+int disp_dmabuf_release(struct list_head *imports, __u32 addr)
+{
+	struct disp_dmabuf_import *imp;
+
+	list_for_each_entry(imp, imports, list) {
+		if (imp->addr == addr) {
+			disp_dmabuf_put_import(imp);
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void disp_dmabuf_release_all(struct list_head *imports)
+{
+	struct disp_dmabuf_import *imp, *tmp;
+
+	list_for_each_entry_safe(imp, tmp, imports, list)
+		disp_dmabuf_put_import(imp);
+}
@@ -55,6 +55,9 @@ void LCD_vbi_event_proc(__u32 sel, __u32 tcon_index)
 	__u32 cur_line = 0, start_delay = 0;
 	__u32 i = 0;
 
+	if (gdisp.init_para.vsync_event)
+		gdisp.init_para.vsync_event(sel);
+
 	Video_Operation_In_Vblanking(sel, tcon_index);
 
 	cur_line = LCDC_get_cur_line(sel, tcon_index);
@@ -187,6 +187,85 @@ __s32 BSP_disp_hdmi_set_mode(__u32 sel, __disp_tv_mode_t mode)
 	return DIS_SUCCESS;
 }
 
+static const struct {
+	__disp_tv_mode_t mode_2d;
+	__disp_tv_mode_t mode_fp;
+} hdmi_fp_modes[] = {
+	{ DISP_TV_MOD_1080P_24HZ, DISP_TV_MOD_1080P_24HZ_3D_FP },
+	{ DISP_TV_MOD_720P_50HZ, DISP_TV_MOD_720P_50HZ_3D_FP },
+	{ DISP_TV_MOD_720P_60HZ, DISP_TV_MOD_720P_60HZ_3D_FP },
+};
+
+/*
+ * tv mode to use for mode with frame packing on or off,
+ * DISP_TV_MODE_NUM if there is no frame packing variant.
+ */
+static __disp_tv_mode_t hdmi_fp_mode(__disp_tv_mode_t mode, __bool fp)
+{
+	__u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(hdmi_fp_modes); i++) {
+		if (mode == hdmi_fp_modes[i].mode_2d ||
+		    mode == hdmi_fp_modes[i].mode_fp)
+			return fp ? hdmi_fp_modes[i].mode_fp :
+				hdmi_fp_modes[i].mode_2d;
+	}
+
+	return fp ? DISP_TV_MODE_NUM : mode;
+}
+
+/*
+ * Put the hdmi output of screen sel into 3D mode or back to 2D. Side by
+ * side and top bottom keep the 2D timing and only change the infoframe,
+ * frame packing has its own timing and needs a mode switch.
+ */
+__s32 Disp_hdmi_set_3d(__u32 sel, __disp_3d_out_mode_t mode, __bool enable)
+{
+	__disp_tv_mode_t cur = gdisp.screen[sel].hdmi_mode;
+	__disp_tv_mode_t tv_mod;
+	__bool fp = enable && (mode == DISP_3D_OUT_MODE_FP);
+
+	if (enable && mode != DISP_3D_OUT_MODE_TB &&
+	    mode != DISP_3D_OUT_MODE_FP && mode != DISP_3D_OUT_MODE_SSF &&
+	    mode != DISP_3D_OUT_MODE_SSH) {
+		DE_WRN("not supported hdmi 3d mode:%d\n", mode);
+		return DIS_NOT_SUPPORT;
+	}
+
+	tv_mod = hdmi_fp_mode(cur, fp);
+	if (tv_mod == DISP_TV_MODE_NUM) {
+		DE_WRN("no frame packing mode for hdmi mode:%d\n", cur);
+		return DIS_NOT_SUPPORT;
+	}
+
+	if (fp && tv_mod != cur &&
+	    BSP_disp_hdmi_check_support_mode(sel, tv_mod) != 1) {
+		DE_WRN("sink does not support hdmi mode:%d\n", tv_mod);
+		return DIS_NOT_SUPPORT;
+	}
+
+	if (!gdisp.init_para.hdmi_set_3d_mode) {
+		DE_WRN("hdmi_set_3d_mode is NULL\n");
+		return DIS_FAIL;
+	}
+
+	if (gdisp.init_para.hdmi_set_3d_mode(mode, enable) != 0)
+		return DIS_FAIL;
+
+	if (tv_mod != cur) {
+		__bool on = (gdisp.screen[sel].status & HDMI_ON) ?
+			TRUE : FALSE;
+
+		if (on)
+			BSP_disp_hdmi_close(sel);
+		BSP_disp_hdmi_set_mode(sel, tv_mod);
+		if (on)
+			BSP_disp_hdmi_open(sel, 0);
+	}
+
+	return DIS_SUCCESS;
+}
+
 static __u32 fb_videomode_pixclock_to_hdmi_pclk(__u32 pixclock)
 {
 	/*
@@ -295,18 +374,22 @@ __s32 BSP_disp_set_videomode(__u32 sel, const struct fb_videomode *mode)
 			kzalloc(sizeof(struct __disp_video_timing), GFP_KERNEL);
 	__disp_tv_mode_t hdmi_mode = gdisp.screen[sel].hdmi_mode;
 
-	if (!old_video_timing && !new_video_timing)
-		return DIS_FAIL;
-
-	if (!gdisp.init_para.hdmi_set_videomode)
-		return DIS_FAIL;
-
-	if (gdisp.init_para.hdmi_get_video_timing(hdmi_mode,
-			old_video_timing) != 0)
+	if (!old_video_timing || !new_video_timing ||
+	    !gdisp.init_para.hdmi_set_videomode ||
+	    gdisp.init_para.hdmi_get_video_timing(hdmi_mode,
+			old_video_timing) != 0) {
+		kfree(old_video_timing);
+		kfree(new_video_timing);
 		return DIS_FAIL;
+	}
 
 	videomode_to_video_timing(new_video_timing, mode);
 
+	/*
+	 * A refresh rate only change keeps the hdmi link up and only the
+	 * pll and tcon are reprogrammed, the back end and the framebuffer
+	 * layers are left as they are.
+	 */
 	gdisp.init_para.hdmi_set_mode(DISP_TV_MODE_EDID);
 	if (gdisp.init_para.hdmi_set_videomode(new_video_timing) != 0)
 		goto failure;
@@ -314,7 +397,9 @@ __s32 BSP_disp_set_videomode(__u32 sel, const struct fb_videomode *mode)
 	if (disp_clk_cfg(sel, DISP_OUTPUT_TYPE_HDMI, DISP_TV_MODE_EDID) != 0)
 		goto failure;
 
-	if (DE_BE_set_display_size(sel, new_video_timing->INPUTX,
+	if ((new_video_timing->INPUTX != old_video_timing->INPUTX ||
+	     new_video_timing->INPUTY != old_video_timing->INPUTY) &&
+	    DE_BE_set_display_size(sel, new_video_timing->INPUTX,
 			new_video_timing->INPUTY) != 0)
 		goto failure;
 
@@ -411,6 +496,7 @@ __s32 BSP_disp_set_hdmi_func(__disp_hdmi_func *func)
 	gdisp.init_para.hdmi_get_video_timing = func->hdmi_get_video_timing;
 	gdisp.init_para.hdmi_get_HPD_status = func->hdmi_get_HPD_status;
 	gdisp.init_para.hdmi_set_pll = func->hdmi_set_pll;
+	gdisp.init_para.hdmi_set_3d_mode = func->hdmi_set_3d_mode;
 
 	return DIS_SUCCESS;
 }
@@ -24,5 +24,6 @@ __s32 Display_Hdmi_Init(void);
 __s32 Display_Hdmi_Exit(void);
 void videomode_to_video_timing(struct __disp_video_timing *video_timing, const struct fb_videomode *mode);
 int vic_from_videomode(const struct fb_videomode *mode, unsigned vmode_mask);
+__s32 Disp_hdmi_set_3d(__u32 sel, __disp_3d_out_mode_t mode, __bool enable);
 
 #endif
@@ -17,6 +17,8 @@
  * MA 02111-1307 USA
  */
 
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include "disp_iep.h"
 #include "de_iep.h"
 #include "de_iep_tab.h"
@@ -27,12 +29,15 @@
 static __s32 Disp_drc_init(__u32 sel);
 static __s32 Disp_drc_proc(__u32 sel, __u32 tcon_index);
 static __s32 Disp_drc_close_proc(__u32 sel, __u32 tcon_index);
+static void Disp_drc_work(struct work_struct *work);
 
 static __hdle h_iepahbclk, h_iepdramclk, h_iepmclk;
 static __disp_iep_t giep[2]; /* IEP module parameters */
 static __disp_pwrsv_t gpwrsv[2]; /* Power Saving algorithm parameters */
 static __u32 *pttab; /* POINTER of LGC tab */
 static __u32 printf_cnt; /* for test */
+static DEFINE_SPINLOCK(drc_lock); /* histogram snapshot, drc registers */
+static DECLARE_WORK(drc_work, Disp_drc_work);
 
 /* power save core */
 #define SCENE_CHNG_THR 45
@@ -60,37 +65,26 @@ static __u32 printf_cnt; /* for test */
 *  - Add HANG-UP DETECT: When use PWRSAVE_CORE in LOW referential backlight
 * condiction, backlight will flicker. So STOP use PWRSAVE_CORE.
 */
-static inline __s32 PWRSAVE_CORE(__u32 sel)
+static inline __u32 PWRSAVE_CORE(__u32 sel, __u32 *histcnt)
 {
 	__u32 i;
 	__u32 hist_region_num = 8;
-	__u32 histcnt[IEP_LH_INTERVAL_NUM];
 	__u32 hist[IEP_LH_INTERVAL_NUM], p95;
 	__u32 size = 0;
 	__u32 min_adj_index;
-	__u32 lgcaddr;
 	__u32 drc_filter_total = 0, drc_filter_tmp = 0;
 
 	if (BSP_disp_lcd_get_bright(sel) < PWRSAVE_PROC_THRES) {
 		memset(gpwrsv[sel].min_adj_index_hist, 255,
 		       sizeof(__u8) * IEP_LH_PWRSV_NUM);
-		lgcaddr = (__u32) pttab + ((128 - 1) << 9);
-		lgcaddr = __pa(lgcaddr);
-		/* set "gain=1" tab to lgc */
-		DE_IEP_Drc_Set_Lgc_Addr(sel, lgcaddr);
-
-		gdisp.screen[sel].lcd_bright_dimming = 256;
-		BSP_disp_lcd_set_bright(sel, BSP_disp_lcd_get_bright(sel), 1);
-
+		/* "gain=1" tab, no dimming */
+		min_adj_index = 255;
 	} else {
 		p95 = 0;
 
 		hist_region_num = (hist_region_num > 8) ?
 			8 : IEP_LH_INTERVAL_NUM;
 
-		/* read histogram result */
-		DE_IEP_Lh_Get_Cnt_Rec(sel, histcnt);
-
 		for (i = 0; i < IEP_LH_INTERVAL_NUM; i++)
 			size += histcnt[i];
 
@@ -165,12 +159,6 @@ static inline __s32 PWRSAVE_CORE(__u32 sel)
 		min_adj_index = (min_adj_index >= 255) ?
 			255 : ((min_adj_index < hist_thres_pwrsv[0]) ?
 			       hist_thres_pwrsv[0] : min_adj_index);
-		gdisp.screen[sel].lcd_bright_dimming = (min_adj_index + 1);
-
-		BSP_disp_lcd_set_bright(sel, BSP_disp_lcd_get_bright(sel), 1);
-
-		//lgcaddr = (__u32) pwrsv_lgc_tab[min_adj_index - 128];
-		lgcaddr = (__u32) pttab + ((min_adj_index - 128) << 9);
 
 		if (printf_cnt == 120) {
 			__inf("save backlight power: %d percent\n",
@@ -179,14 +167,74 @@ static inline __s32 PWRSAVE_CORE(__u32 sel)
 		} else {
 			printf_cnt++;
 		}
+	}
 
-		/* virtual to physcal addr */
-		lgcaddr = __pa(lgcaddr);
+	return min_adj_index;
+}
 
-		DE_IEP_Drc_Set_Lgc_Addr(sel, lgcaddr);
-	}
+/*
+ * Load the lgc table and backlight dimming for a PWRSAVE_CORE() result.
+ * The drc registers are double buffered and latch at the next vblank.
+ */
+static void PWRSAVE_APPLY(__u32 sel, __u32 min_adj_index)
+{
+	__u32 lgcaddr;
 
-	return 0;
+	//lgcaddr = (__u32) pwrsv_lgc_tab[min_adj_index - 128];
+	lgcaddr = (__u32) pttab + ((min_adj_index - 128) << 9);
+	/* virtual to physcal addr */
+	lgcaddr = __pa(lgcaddr);
+	DE_IEP_Drc_Set_Lgc_Addr(sel, lgcaddr);
+
+	gdisp.screen[sel].lcd_bright_dimming = (min_adj_index + 1);
+	BSP_disp_lcd_set_bright(sel, BSP_disp_lcd_get_bright(sel), 1);
+}
+
+/*
+ * The averaging filter has converged once every history slot holds the
+ * same index; until then it must keep running even on a still picture.
+ */
+static __bool pwrsv_settled(__u32 sel)
+{
+	__u32 i;
+
+	for (i = 1; i < IEP_LH_PWRSV_NUM; i++)
+		if (gpwrsv[sel].min_adj_index_hist[i] !=
+		    gpwrsv[sel].min_adj_index_hist[0])
+			return FALSE;
+
+	return TRUE;
+}
+
+/*
+ * Power save processing, run from a work item on the histogram that
+ * Disp_drc_proc() captured at the last vblank.
+ */
+static void Disp_drc_work(struct work_struct *work)
+{
+	__u32 sel = 0;
+	__u32 histcnt[IEP_LH_INTERVAL_NUM];
+	__u32 bright, min_adj_index;
+	unsigned long flags;
+
+	spin_lock_irqsave(&drc_lock, flags);
+	memcpy(histcnt, gpwrsv[sel].histcnt, sizeof(histcnt));
+	spin_unlock_irqrestore(&drc_lock, flags);
+
+	bright = BSP_disp_lcd_get_bright(sel);
+	if (!memcmp(histcnt, gpwrsv[sel].last_histcnt, sizeof(histcnt)) &&
+	    bright == gpwrsv[sel].last_bright && pwrsv_settled(sel))
+		return;
+
+	memcpy(gpwrsv[sel].last_histcnt, histcnt, sizeof(histcnt));
+	gpwrsv[sel].last_bright = bright;
+
+	min_adj_index = PWRSAVE_CORE(sel, histcnt);
+
+	spin_lock_irqsave(&drc_lock, flags);
+	if (gdisp.screen[sel].iep_status & DRC_USED)
+		PWRSAVE_APPLY(sel, min_adj_index);
+	spin_unlock_irqrestore(&drc_lock, flags);
 }
 
 #define ____SEPARATOR_IEP_BSP____
@@ -718,6 +766,7 @@ __s32 Disp_iep_exit(__u32 sel)
 		return 0;
 
 	if (sel == 0) {
+		cancel_work_sync(&drc_work);
 		iep_clk_exit(sel);
 		kfree(pttab);
 		return 0;
@@ -796,8 +845,11 @@ static __s32 Disp_drc_proc(__u32 sel, __u32 tcon_index)
 				DE_IEP_Set_Demo_Win_Para(sel, top, bot, left,
 							 right);
 			}
-			/* BACKLIGHT Control ALG */
-			PWRSAVE_CORE(sel);
+			/* BACKLIGHT Control ALG, off the vblank irq */
+			spin_lock(&drc_lock);
+			DE_IEP_Lh_Get_Cnt_Rec(sel, gpwrsv[sel].histcnt);
+			spin_unlock(&drc_lock);
+			schedule_work(&drc_work);
 		}
 
 		return 0;
@@ -809,6 +861,7 @@ static __s32 Disp_drc_proc(__u32 sel, __u32 tcon_index)
 static __s32 Disp_drc_close_proc(__u32 sel, __u32 tcon_index)
 {
 	if (sel == 0) {
+		spin_lock(&drc_lock);
 		/* IEP module */
 		DE_IEP_Disable(sel);
 
@@ -822,6 +875,7 @@ static __s32 Disp_drc_close_proc(__u32 sel, __u32 tcon_index)
 
 		gdisp.screen[sel].lcd_bright_dimming = 256;
 		BSP_disp_lcd_set_bright(sel, BSP_disp_lcd_get_bright(sel), 1);
+		spin_unlock(&drc_lock);
 		return 0;
 	} else {
 		return -1;
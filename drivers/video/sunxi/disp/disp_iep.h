@@ -65,6 +65,11 @@ typedef struct {
 typedef struct {
 	__u8 min_adj_index_hist[IEP_LH_PWRSV_NUM];
 	__u32 user_bl;
+
+	/* histogram captured at vblank, and the one last processed */
+	__u32 histcnt[IEP_LH_INTERVAL_NUM];
+	__u32 last_histcnt[IEP_LH_INTERVAL_NUM];
+	__u32 last_bright;
 } __disp_pwrsv_t;
 
 extern __s32 Disp_iep_init(__u32 sel);
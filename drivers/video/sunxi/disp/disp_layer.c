@@ -24,6 +24,8 @@
 #include "disp_scaler.h"
 #include "disp_event.h"
 #include "disp_clk.h"
+#include "disp_bandwidth.h"
+#include "disp_hdmi.h"
 
 static __s32 Layer_Get_Idle_Hid(__u32 sel)
 {
@@ -346,6 +348,8 @@ __s32 BSP_disp_layer_open(__u32 sel, __u32 hid)
 			DE_BE_Layer_Enable(sel, hid, TRUE);
 			BSP_disp_cfg_finish(sel);
 			layer_man->status |= LAYER_OPENED;
+			/* legacy path: over budget only warns */
+			Disp_bw_check(sel, BSP_disp_get_bandwidth(sel));
 		}
 		return DIS_SUCCESS;
 	} else {
@@ -368,6 +372,7 @@ __s32 BSP_disp_layer_close(__u32 sel, __u32 hid)
 			DE_BE_Layer_Enable(sel, hid, FALSE);
 			BSP_disp_cfg_finish(sel);
 			layer_man->status &= ~LAYER_OPENED;
+			Disp_bw_update();
 		}
 		return DIS_SUCCESS;
 	} else {
@@ -641,6 +646,43 @@ __s32 BSP_disp_layer_set_screen_window(__u32 sel, __u32 hid,
 
 }
 
+/*
+ * Move a layer without changing its size. Unlike set_screen_window this
+ * leaves the scaler alone, so a plane move is one BE register write.
+ */
+__s32 BSP_disp_layer_set_pos(__u32 sel, __u32 hid, __disp_pos_t *pos)
+{
+	__layer_man_t *layer_man;
+	__disp_rect_t regn;
+
+	hid = HANDTOID(hid);
+	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
+
+	if (pos == NULL)
+		return DIS_PARA_FAILED;
+
+	layer_man = &gdisp.screen[sel].layer_manage[hid];
+	if (!(layer_man->status & LAYER_USED)) {
+		DE_WRN("layer %d in screen %d not inited!\n", hid, sel);
+		return DIS_OBJ_NOT_INITED;
+	}
+
+	regn = layer_man->para.scn_win;
+	regn.x = pos->x;
+	regn.y = pos->y;
+	if (layer_man->para.mode == DISP_LAYER_WORK_MODE_SCALER &&
+	    gdisp.screen[sel].b_out_interlace == 1)
+		regn.y &= 0xfffffffe;
+
+	BSP_disp_cfg_start(sel);
+	DE_BE_Layer_Set_Screen_Win(sel, hid, &regn);
+	layer_man->para.scn_win.x = regn.x;
+	layer_man->para.scn_win.y = regn.y;
+	BSP_disp_cfg_finish(sel);
+
+	return DIS_SUCCESS;
+}
+
 __s32 BSP_disp_layer_get_screen_window(__u32 sel, __u32 hid,
 				       __disp_rect_t *regn)
 {
@@ -1303,3 +1345,169 @@ __s32 BSP_disp_layer_get_black_exten_level(__u32 sel, __u32 hid)
 	}
 	return DIS_NOT_SUPPORT;
 }
+
+/*
+ * Bandwidth of screen sel once the batch is applied: later entries for
+ * the same layer override earlier ones, like the apply loop does.
+ */
+static __s32 layer_commit_bw_check(__u32 sel, __disp_layer_commit_t *commit,
+				   __u32 count)
+{
+	__u32 hid, i, kbps = 0;
+
+	for (hid = 0; hid < gdisp.screen[sel].max_layers; hid++) {
+		__layer_man_t *layer_man = &gdisp.screen[sel].layer_manage[hid];
+		__disp_layer_info_t para;
+		__bool opened;
+
+		if (!(layer_man->status & LAYER_USED))
+			continue;
+
+		para = layer_man->para;
+		opened = (layer_man->status & LAYER_OPENED) ? TRUE : FALSE;
+
+		for (i = 0; i < count; i++) {
+			if (HANDTOID(commit[i].hid) != hid)
+				continue;
+
+			if (commit[i].flags & DISP_COMMIT_PARA)
+				para = commit[i].para;
+			if (commit[i].flags & DISP_COMMIT_FB)
+				para.fb = commit[i].fb;
+			if (commit[i].flags & DISP_COMMIT_SRC_WIN)
+				para.src_win = commit[i].src_win;
+			if (commit[i].flags & DISP_COMMIT_CLOSE)
+				opened = FALSE;
+			if (commit[i].flags & DISP_COMMIT_OPEN)
+				opened = TRUE;
+		}
+
+		if (opened)
+			kbps += Disp_bw_layer(sel, &para);
+	}
+
+	return Disp_bw_check(sel, kbps);
+}
+
+/*
+ * Apply a batch of layer changes as one update. Every entry is checked
+ * before anything is touched, then the whole batch is written inside a
+ * cfg_start/cfg_finish pair so LCD_vbi_event_proc() only sets the
+ * register ready bits once the last entry is in, and all of it latches
+ * on the same vblank.
+ */
+__s32 BSP_disp_layer_commit(__u32 sel, __disp_layer_commit_t *commit,
+			    __u32 count)
+{
+	__u32 i;
+	__s32 ret = DIS_SUCCESS;
+
+	if (count == 0 || count > DISP_COMMIT_MAX_LAYERS)
+		return DIS_PARA_FAILED;
+
+	for (i = 0; i < count; i++) {
+		__u32 hid = HANDTOID(commit[i].hid);
+		__u32 flags = commit[i].flags;
+
+		HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
+
+		if (!(gdisp.screen[sel].layer_manage[hid].status & LAYER_USED))
+			return DIS_OBJ_NOT_INITED;
+
+		if ((flags & ~DISP_COMMIT_ALL_FLAGS) ||
+		    ((flags & DISP_COMMIT_OPEN) && (flags & DISP_COMMIT_CLOSE)))
+			return DIS_PARA_FAILED;
+	}
+
+	ret = layer_commit_bw_check(sel, commit, count);
+	if (ret != DIS_SUCCESS)
+		return ret;
+
+	BSP_disp_cfg_start(sel);
+
+	for (i = 0; i < count && ret == DIS_SUCCESS; i++) {
+		__disp_layer_commit_t *c = &commit[i];
+
+		if (c->flags & DISP_COMMIT_CLOSE)
+			ret = BSP_disp_layer_close(sel, c->hid);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_PARA))
+			ret = BSP_disp_layer_set_para(sel, c->hid, &c->para);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_FB))
+			ret = BSP_disp_layer_set_framebuffer(sel, c->hid,
+							     &c->fb);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_SRC_WIN))
+			ret = BSP_disp_layer_set_src_window(sel, c->hid,
+							    &c->src_win);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_SCN_WIN))
+			ret = BSP_disp_layer_set_screen_window(sel, c->hid,
+							       &c->scn_win);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_VIDEO_FB))
+			ret = BSP_disp_video_set_fb(sel, c->hid, &c->video_fb);
+		if (ret == DIS_SUCCESS && (c->flags & DISP_COMMIT_OPEN))
+			ret = BSP_disp_layer_open(sel, c->hid);
+
+		if (ret != DIS_SUCCESS)
+			DE_WRN("layer commit entry %d (hid %d) failed: %d\n",
+			       i, c->hid, ret);
+	}
+
+	BSP_disp_cfg_finish(sel);
+	Disp_bw_update();
+
+	return ret;
+}
+
+/*
+ * Switch a scaler mode layer between 2D and 3D in one call. The layer
+ * keeps its scaler and framebuffers, only the 3D modes of the source and
+ * the output change. On HDMI the output is switched along with it, and
+ * a frame packing mode change rescales the screen window to the new
+ * screen height.
+ */
+__s32 BSP_disp_layer_set_3d(__u32 sel, __u32 hid, __disp_layer_3d_t *trd)
+{
+	__layer_man_t *layer_man;
+	__disp_layer_info_t para;
+	__u32 old_height, new_height;
+	__s32 ret;
+
+	hid = HANDTOID(hid);
+	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
+
+	layer_man = &gdisp.screen[sel].layer_manage[hid];
+	if (!(layer_man->status & LAYER_USED))
+		return DIS_OBJ_NOT_INITED;
+
+	if (layer_man->para.mode != DISP_LAYER_WORK_MODE_SCALER) {
+		DE_WRN("3d needs a scaler mode layer\n");
+		return DIS_NOT_SUPPORT;
+	}
+
+	old_height = BSP_disp_get_screen_height(sel);
+
+	if (gdisp.screen[sel].output_type == DISP_OUTPUT_TYPE_HDMI) {
+		ret = Disp_hdmi_set_3d(sel, trd->out_mode, trd->enable);
+		if (ret != DIS_SUCCESS)
+			return ret;
+	}
+
+	new_height = BSP_disp_get_screen_height(sel);
+
+	para = layer_man->para;
+	para.fb.b_trd_src = trd->enable;
+	para.fb.trd_mode = trd->src_mode;
+	if (trd->enable && trd->src_mode == DISP_3D_SRC_MODE_FP)
+		memcpy(para.fb.trd_right_addr, trd->right_addr,
+		       sizeof(para.fb.trd_right_addr));
+	para.b_trd_out = trd->enable;
+	para.out_trd_mode = trd->out_mode;
+
+	if (old_height && new_height != old_height) {
+		para.scn_win.y = para.scn_win.y * (__s32)new_height /
+			(__s32)old_height;
+		para.scn_win.height = para.scn_win.height * new_height /
+			old_height;
+	}
+
+	return BSP_disp_layer_set_para(sel, IDTOHAND(hid), &para);
+}
@@ -31,6 +31,28 @@ static __lcd_flow_t close_flow[2];
 __panel_para_t gpanel_info[2];
 static __lcd_panel_fun_t lcd_panel_fun[2];
 
+/* the PIO external interrupts, as the ctp drivers use them */
+#define PIO_INT_CFG_OFFSET(n)	(0x200 + ((n) / 8) * 4)
+#define PIO_INT_CTRL_OFFSET	(0x210)
+#define PIO_INT_STAT_OFFSET	(0x214)
+#define PIO_INT_POSITIVE_EDGE	(0x0)
+
+/*
+ * A cpu panel with its TE pin in the fex is refreshed on demand: auto
+ * flush is off, and BSP_disp_lcd_cpu_update() has the next TE pulse
+ * start one frame transfer, so the bus is idle while nothing changes
+ * and a transfer never overtakes the panel's scanout.
+ */
+static struct {
+	__hdle hdl;
+	__u32 eint;
+	__bool on;
+	__bool dirty;
+	__u32 flushes;
+} lcd_cpu_te[2];
+
+static DEFINE_SPINLOCK(lcd_cpu_te_lock);
+
 static void
 LCD_get_reg_bases(__reg_bases_t *para)
 {
@@ -625,6 +647,20 @@ LCD_get_sys_config(__u32 sel, __disp_lcd_cfg_t *lcd_cfg)
 		}
 	}
 
+	/* lcd_cpu_te */
+	lcd_cfg->lcd_cpu_te_used = 0;
+	gpio_info = &(lcd_cfg->lcd_cpu_te);
+	ret = script_parser_fetch(primary_key, "lcd_cpu_te", (int *)gpio_info,
+				  sizeof(user_gpio_set_t) / sizeof(int));
+	if (ret < 0) {
+		DE_INF("%s.lcd_cpu_te not exist\n", primary_key);
+	} else {
+		DE_INF("%s.lcd_cpu_te gpio_port=%d,gpio_port_num:%d, "
+		       "mul_sel:%d\n", primary_key, gpio_info->port,
+		       gpio_info->port_num, gpio_info->mul_sel);
+		lcd_cfg->lcd_cpu_te_used = 1;
+	}
+
 	/* init_brightness */
 	sprintf(primary_key, "disp_init");
 	/* This is messed up, the sun6i and sun7i fex files use a different
@@ -1562,6 +1598,125 @@ __s32 BSP_disp_get_output_type(__u32 sel)
 	return (__s32) DISP_OUTPUT_TYPE_NONE;
 }
 
+static irqreturn_t lcd_cpu_te_irq(int irq, void *parg)
+{
+	__u32 sel = (__u32) parg;
+	__u32 base = gdisp.init_para.base_pioc;
+	__u32 bit = 1 << lcd_cpu_te[sel].eint;
+
+	/* the PIO line is shared with the other EINT users */
+	if (!(readl(base + PIO_INT_STAT_OFFSET) & bit))
+		return IRQ_NONE;
+	writel(bit, base + PIO_INT_STAT_OFFSET);
+
+	spin_lock(&lcd_cpu_te_lock);
+	if (lcd_cpu_te[sel].on && lcd_cpu_te[sel].dirty) {
+		lcd_cpu_te[sel].dirty = FALSE;
+		lcd_cpu_te[sel].flushes++;
+		LCD_CPU_DMA_FLUSH(sel, 1);
+	}
+	spin_unlock(&lcd_cpu_te_lock);
+
+	return IRQ_HANDLED;
+}
+
+static void lcd_cpu_te_enable(__u32 sel, __bool enable)
+{
+	__u32 base = gdisp.init_para.base_pioc;
+	__u32 tmp;
+
+	tmp = readl(base + PIO_INT_CTRL_OFFSET);
+	if (enable)
+		tmp |= 1 << lcd_cpu_te[sel].eint;
+	else
+		tmp &= ~(1 << lcd_cpu_te[sel].eint);
+	writel(tmp, base + PIO_INT_CTRL_OFFSET);
+}
+
+static void lcd_cpu_te_start(__u32 sel)
+{
+	__disp_lcd_cfg_t *lcd_cfg = &gdisp.screen[sel].lcd_cfg;
+	__u32 base = gdisp.init_para.base_pioc;
+	__u32 eint, tmp;
+
+	if (gpanel_info[sel].lcd_if != LCDC_LCDIF_CPU ||
+	    !lcd_cfg->lcd_cpu_te_used)
+		return;
+
+	lcd_cpu_te[sel].hdl = OSAL_GPIO_Request(&lcd_cfg->lcd_cpu_te, 1);
+	if (!lcd_cpu_te[sel].hdl) {
+		DE_WRN("lcd%d: request of lcd_cpu_te failed\n", sel);
+		return;
+	}
+	eint = lcd_cfg->lcd_cpu_te.port_num;
+	lcd_cpu_te[sel].eint = eint;
+
+	/* TE goes high at the start of the panel's vblank */
+	tmp = readl(base + PIO_INT_CFG_OFFSET(eint));
+	tmp &= ~(7 << ((eint % 8) * 4));
+	tmp |= PIO_INT_POSITIVE_EDGE << ((eint % 8) * 4);
+	writel(tmp, base + PIO_INT_CFG_OFFSET(eint));
+	writel(1 << eint, base + PIO_INT_STAT_OFFSET);
+
+	if (request_irq(SW_INT_IRQNO_PIO, lcd_cpu_te_irq, IRQF_SHARED,
+			sel ? "sunxi lcd1 te" : "sunxi lcd0 te",
+			(void *)sel)) {
+		DE_WRN("lcd%d: request of the TE irq failed\n", sel);
+		OSAL_GPIO_Release(lcd_cpu_te[sel].hdl, 2);
+		lcd_cpu_te[sel].hdl = 0;
+		return;
+	}
+
+	/* the panel's open flow turned auto flush on, send the first frame */
+	LCD_CPU_AUTO_FLUSH(sel, 0);
+	spin_lock_irq(&lcd_cpu_te_lock);
+	lcd_cpu_te[sel].on = TRUE;
+	lcd_cpu_te[sel].dirty = TRUE;
+	spin_unlock_irq(&lcd_cpu_te_lock);
+	lcd_cpu_te_enable(sel, TRUE);
+
+	DE_INF("lcd%d: TE synchronised updates on EINT%d\n", sel, eint);
+}
+
+static void lcd_cpu_te_stop(__u32 sel)
+{
+	if (!lcd_cpu_te[sel].hdl)
+		return;
+
+	lcd_cpu_te_enable(sel, FALSE);
+	free_irq(SW_INT_IRQNO_PIO, (void *)sel);
+	spin_lock_irq(&lcd_cpu_te_lock);
+	lcd_cpu_te[sel].on = FALSE;
+	spin_unlock_irq(&lcd_cpu_te_lock);
+	DE_INF("lcd%d: %u TE synchronised frames\n", sel,
+	       lcd_cpu_te[sel].flushes);
+
+	OSAL_GPIO_Release(lcd_cpu_te[sel].hdl, 2);
+	lcd_cpu_te[sel].hdl = 0;
+}
+
+/*
+ * Have the next TE pulse send a frame to a cpu panel. Updates until
+ * then are coalesced; panels without TE are auto flushed anyway.
+ */
+__s32 BSP_disp_lcd_cpu_update(__u32 sel)
+{
+	unsigned long flags;
+	__s32 ret = DIS_NOT_SUPPORT;
+
+	if (sel > 1)
+		return DIS_PARA_FAILED;
+
+	spin_lock_irqsave(&lcd_cpu_te_lock, flags);
+	if (lcd_cpu_te[sel].on) {
+		lcd_cpu_te[sel].dirty = TRUE;
+		ret = DIS_SUCCESS;
+	}
+	spin_unlock_irqrestore(&lcd_cpu_te_lock, flags);
+
+	return ret;
+}
+
 __s32 BSP_disp_lcd_open_before(__u32 sel)
 {
 	disp_clk_cfg(sel, DISP_OUTPUT_TYPE_LCD, DIS_NULL);
@@ -1602,6 +1757,7 @@ __s32 BSP_disp_lcd_open_after(__u32 sel)
 	Disp_drc_enable(sel, TRUE);
 
 	Display_set_fb_timing(sel);
+	lcd_cpu_te_start(sel);
 
 	return DIS_SUCCESS;
 }
@@ -1613,6 +1769,8 @@ __lcd_flow_t *BSP_disp_lcd_get_open_flow(__u32 sel)
 
 __s32 BSP_disp_lcd_close_befor(__u32 sel)
 {
+	lcd_cpu_te_stop(sel);
+
 	close_flow[sel].func_num = 0;
 	lcd_panel_fun[sel].cfg_close_flow(sel);
 	/* must close immediately, cause vbi may not come */
@@ -1649,7 +1807,8 @@ __s32 BSP_disp_lcd_xy_switch(__u32 sel, __s32 mode)
 		LCD_CPU_AUTO_FLUSH(sel, 0);
 		LCD_XY_SWAP(sel);
 		(*gdisp.screen[sel].LCD_CPUIF_XY_Swap)(mode);
-		LCD_CPU_AUTO_FLUSH(sel, 1);
+		if (BSP_disp_lcd_cpu_update(sel) != DIS_SUCCESS)
+			LCD_CPU_AUTO_FLUSH(sel, 1);
 	}
 
 	return DIS_SUCCESS;
@@ -199,7 +199,7 @@ static irqreturn_t Scaler_event_proc(int irq, void *parg)
 		if (gdisp.scaler[sel].b_scaler_finished == 1 &&
 		    (&gdisp.scaler[sel].scaler_queue != NULL)) {
 			gdisp.scaler[sel].b_scaler_finished = 2;
-			wake_up_interruptible(&gdisp.scaler[sel].scaler_queue);
+			wake_up(&gdisp.scaler[sel].scaler_queue);
 		} else
 			__wrn("not scaler %d begin in DRV_scaler_finish\n",
 			      sel);
@@ -854,11 +854,29 @@ __s32 BSP_disp_scaler_request(void)
 	return SCALER_IDTOHAND(sel);
 }
 
+/*
+ * A handle of BSP_disp_scaler_request(), not a scaler that is driving
+ * a layer of a screen.
+ */
+static __bool Scaler_Is_Writeback(__u32 sel)
+{
+	if (sel >= (sunxi_is_sun5i() ? 1 : 2))
+		return FALSE;
+
+	return (gdisp.scaler[sel].status & SCALER_USED) &&
+		gdisp.scaler[sel].screen_index == 0xff;
+}
+
 __s32 BSP_disp_scaler_release(__u32 handle)
 {
 	__u32 sel = 0;
 
 	sel = SCALER_HANDTOID(handle);
+	if (!Scaler_Is_Writeback(sel)) {
+		DE_WRN("scaler handle %d is not a writeback scaler\n", handle);
+		return DIS_PARA_FAILED;
+	}
+
 	return Scaler_Release(sel, FALSE);
 }
 
@@ -883,6 +901,10 @@ __s32 BSP_disp_scaler_start(__u32 handle, __disp_scaler_para_t *para)
 	}
 
 	sel = SCALER_HANDTOID(handle);
+	if (!Scaler_Is_Writeback(sel)) {
+		DE_WRN("scaler handle %d is not a writeback scaler\n", handle);
+		return DIS_PARA_FAILED;
+	}
 
 	in_type.fmt = Scaler_sw_para_to_reg1(para->input_fb.format);
 	in_type.mod = para->input_fb.mode;
@@ -1000,19 +1022,17 @@ __s32 BSP_disp_scaler_start(__u32 handle, __disp_scaler_para_t *para)
 		gdisp.scaler[sel].b_scaler_finished = 1;
 		DE_SCAL_Writeback_Enable(sel);
 
-		timeout =
-		    wait_event_interruptible_timeout(gdisp.scaler[sel].
-						     scaler_queue,
-						     gdisp.scaler[sel].
-						     b_scaler_finished == 2,
-						     timeout);
+		/* not interruptible, the scaler writes into the caller's buffer */
+		timeout = wait_event_timeout(gdisp.scaler[sel].scaler_queue,
+					     gdisp.scaler[sel].b_scaler_finished == 2,
+					     timeout);
 		gdisp.scaler[sel].b_scaler_finished = 0;
+		DE_SCAL_Reset(sel);
+		DE_SCAL_Writeback_Disable(sel);
 		if (timeout == 0) {
 			__wrn("wait scaler %d finished timeout\n", sel);
 			return -1;
 		}
-		DE_SCAL_Reset(sel);
-		DE_SCAL_Writeback_Disable(sel);
 	} else {
 		if (para->output_fb.mode == DISP_MOD_INTERLEAVED)
 			ch_num = 1;
@@ -1047,12 +1067,9 @@ __s32 BSP_disp_scaler_start(__u32 handle, __disp_scaler_para_t *para)
 			gdisp.scaler[sel].b_scaler_finished = 1;
 			DE_SCAL_Writeback_Enable(sel);
 
-			timeout =
-			    wait_event_interruptible_timeout(gdisp.scaler[sel].
-							     scaler_queue,
-							     gdisp.scaler[sel].
-							     b_scaler_finished
-							     == 2, timeout);
+			timeout = wait_event_timeout(gdisp.scaler[sel].scaler_queue,
+						     gdisp.scaler[sel].b_scaler_finished == 2,
+						     timeout);
 			gdisp.scaler[sel].b_scaler_finished = 0;
 
 			if (timeout == 0) {
@@ -1095,7 +1112,7 @@ __s32 BSP_disp_capture_screen(__u32 sel, __disp_capture_screen_para_t *para)
 		DE_WRN("request scaler fail in BSP_disp_capture_screen\n");
 		return DIS_FAIL;
 	} else {
-		gdisp.scaler[sel].screen_index = 0xff;
+		gdisp.scaler[scaler_idx].screen_index = 0xff;
 	}
 
 	in_type.fmt = Scaler_sw_para_to_reg1(DISP_FORMAT_ARGB8888);
@@ -1111,6 +1128,7 @@ __s32 BSP_disp_capture_screen(__u32 sel, __disp_capture_screen_para_t *para)
 		} else {
 			DE_WRN("output mode:%d invalid in "
 			       "Display_Scaler_Start\n", para->output_fb.mode);
+			Scaler_Release(scaler_idx, FALSE);
 			return DIS_FAIL;
 		}
 	} else {
@@ -1125,6 +1143,7 @@ __s32 BSP_disp_capture_screen(__u32 sel, __disp_capture_screen_para_t *para)
 			DE_WRN("output para invalid in Display_Scaler_Start, "
 			       "mode:%d,format:%d\n", para->output_fb.mode,
 			       para->output_fb.format);
+			Scaler_Release(scaler_idx, FALSE);
 			return DIS_FAIL;
 		}
 		para->output_fb.br_swap = FALSE;
@@ -1210,19 +1229,17 @@ __s32 BSP_disp_capture_screen(__u32 sel, __disp_capture_screen_para_t *para)
 		gdisp.scaler[scaler_idx].b_scaler_finished = 1;
 		DE_SCAL_Writeback_Enable(scaler_idx);
 
-		timeout =
-		    wait_event_interruptible_timeout(gdisp.scaler[scaler_idx].
-						     scaler_queue,
-						     gdisp.scaler[scaler_idx].
-						     b_scaler_finished == 2,
-						     timeout);
+		timeout = wait_event_timeout(gdisp.scaler[scaler_idx].scaler_queue,
+					     gdisp.scaler[scaler_idx].b_scaler_finished == 2,
+					     timeout);
 		gdisp.scaler[scaler_idx].b_scaler_finished = 0;
 		if (timeout == 0) {
 			__wrn("wait scaler %d finished timeout\n", scaler_idx);
-			return -1;
+			ret = -1;
 		}
 	}
 
+	DE_SCAL_Writeback_Disable(scaler_idx);
 	DE_SCAL_Reset(scaler_idx);
 	Scaler_Release(scaler_idx, FALSE);
 	if (BSP_disp_get_output_type(sel) == DISP_OUTPUT_TYPE_NONE) {
@@ -732,6 +732,31 @@ __s32 BSP_disp_sprite_block_set_screen_win(__u32 sel, __s32 hid,
 
 }
 
+/*
+ * Move a sprite block, size and source are kept.
+ */
+__s32 BSP_disp_sprite_block_set_pos(__u32 sel, __s32 hid, __disp_pos_t *pos)
+{
+	__s32 id = 0;
+	list_head_t *node = NULL;
+
+	id = Sprite_Hid_To_Id(sel, hid);
+	if (gsprite[sel].block_status[id] & SPRITE_BLOCK_USED) {
+		node = List_Find_Sprite_Block(sel, id);
+		if (node == NULL)
+			return DIS_PARA_FAILED;
+
+		if (node->data->enable == TRUE)
+			DE_BE_Sprite_Block_Set_Pos(sel, id, pos->x, pos->y);
+
+		node->data->scn_win.x = pos->x;
+		node->data->scn_win.y = pos->y;
+		return DIS_SUCCESS;
+	} else {
+		return DIS_OBJ_NOT_INITED;
+	}
+}
+
 __s32 BSP_disp_sprite_block_get_srceen_win(__u32 sel, __s32 hid,
 					   __disp_rect_t *scn_win)
 {
@@ -18,14 +18,111 @@
  */
 
 #include <mach/memory.h>
+#include <linux/eventfd.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 #include "disp_video.h"
 #include "disp_display.h"
 #include "disp_event.h"
 #include "disp_scaler.h"
 #include "disp_de.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/sunxi_disp.h>
+
 frame_para_t g_video[2][4];
 
+/* protects g_video_queue and video_new between ioctls and the vblank irq */
+static DEFINE_SPINLOCK(video_queue_lock);
+static video_queue_t g_video_queue[2][4];
+
+static void video_release(struct eventfd_ctx **release)
+{
+	if (*release) {
+		eventfd_signal(*release, 1);
+		eventfd_ctx_put(*release);
+		*release = NULL;
+	}
+}
+
+/*
+ * Move the newest frame that is due into video_new. Frames that were
+ * overtaken before ever reaching the screen are released as dropped.
+ * Called from the vblank irq with video_queue_lock held.
+ */
+static void video_queue_advance(__u32 sel, __u32 id)
+{
+	video_queue_t *q = &g_video_queue[sel][id];
+	__s64 now = ktime_to_ns(ktime_get());
+
+	/* replaced at the previous vblank, no longer scanned out now */
+	video_release(&q->retire);
+
+	/* in kernel dit mode an interlaced frame always gets both fields */
+	if (g_video[sel][id].dit_kernel &&
+	    g_video[sel][id].video_cur.interlace &&
+	    g_video[sel][id].display_cnt == 1)
+		return;
+
+	while (q->count) {
+		video_queue_slot_t *slot = &q->slot[q->head];
+
+		if (slot->pts > now)
+			break;
+
+		video_release(&q->new_release);
+		memcpy(&g_video[sel][id].video_new, &slot->fb,
+		       sizeof(__disp_video_fb_t));
+		q->new_release = slot->release;
+		slot->release = NULL;
+		g_video[sel][id].have_got_frame = TRUE;
+		g_video[sel][id].display_cnt = 0;
+
+		q->head = (q->head + 1) % DISP_VIDEO_QUEUE_LEN;
+		q->count--;
+	}
+}
+
+/*
+ * video_new has just become video_cur. The old current frame stays in
+ * use until the next vblank, or for one more frame as the deinterlacer
+ * reference in kernel dit mode.
+ */
+static void video_queue_swap(__u32 sel, __u32 id)
+{
+	video_queue_t *q = &g_video_queue[sel][id];
+
+	video_release(&q->retire);
+	if (g_video[sel][id].dit_kernel) {
+		q->retire = q->prev_release;
+		q->prev_release = q->cur_release;
+	} else {
+		video_release(&q->prev_release);
+		q->retire = q->cur_release;
+	}
+	q->cur_release = q->new_release;
+	q->new_release = NULL;
+}
+
+static void video_queue_flush(__u32 sel, __u32 id)
+{
+	video_queue_t *q = &g_video_queue[sel][id];
+	unsigned long flags;
+
+	spin_lock_irqsave(&video_queue_lock, flags);
+	while (q->count) {
+		video_release(&q->slot[q->head].release);
+		q->head = (q->head + 1) % DISP_VIDEO_QUEUE_LEN;
+		q->count--;
+	}
+	q->head = 0;
+	video_release(&q->new_release);
+	video_release(&q->cur_release);
+	video_release(&q->prev_release);
+	video_release(&q->retire);
+	spin_unlock_irqrestore(&video_queue_lock, flags);
+}
+
 static __s32 video_enhancement_start(__u32 sel, __u32 id)
 {
 	__u32 scaleuprate;
@@ -153,6 +250,8 @@ static inline __s32 Hal_Set_Frame(__u32 sel, __u32 tcon_index, __u32 id)
 		    g_video[sel][id].video_cur.addr[0];
 		memcpy(&g_video[sel][id].video_cur, &g_video[sel][id].video_new,
 		       sizeof(__disp_video_fb_t));
+
+		video_queue_swap(sel, id);
 	}
 
 	if (gdisp.screen[sel].layer_manage[id].para.mode ==
@@ -213,8 +312,11 @@ static inline __s32 Hal_Set_Frame(__u32 sel, __u32 tcon_index, __u32 id)
 						DIT_MODE_MAF_BOB;
 				}
 
-				if (g_video[sel][id].video_cur.
-				    pre_frame_valid == TRUE) {
+				if ((g_video[sel][id].dit_kernel &&
+				     g_video[sel][id].pre_frame_addr0) ||
+				    (!g_video[sel][id].dit_kernel &&
+				     g_video[sel][id].video_cur.
+				     pre_frame_valid == TRUE)) {
 					g_video[sel][id].tempdiff_en = TRUE;
 					pre_frame_addr = __phys_to_bus(g_video[sel][id].pre_frame_addr0);
 				} else {
@@ -228,7 +330,9 @@ static inline __s32 Hal_Set_Frame(__u32 sel, __u32 tcon_index, __u32 id)
 					g_video[sel][id].dit_mode = DIT_MODE_MAF_BOB;
 					g_video[sel][id].diagintp_en = FALSE;	//todo
 				}
-				g_video[sel][id].tempdiff_en = FALSE;	//todo
+				if (sunxi_is_sun5i() ||
+				    !g_video[sel][id].dit_kernel)
+					g_video[sel][id].tempdiff_en = FALSE;	//todo
 			} else {
 				if (sunxi_is_sun5i())
 					g_video[sel][id].fetch_bot = FALSE;
@@ -393,32 +497,83 @@ __s32 Video_Operation_In_Vblanking(__u32 sel, __u32 tcon_index)
 {
 	__u32 id = 0;
 
+	spin_lock(&video_queue_lock);
 	for (id = 0; id < 4; id++) {
-		if ((g_video[sel][id].enable == TRUE) &&
-		    (g_video[sel][id].have_got_frame == TRUE)) {
+		if (g_video[sel][id].enable != TRUE)
+			continue;
+
+		video_queue_advance(sel, id);
+
+		if (g_video[sel][id].have_got_frame == TRUE) {
 			Hal_Set_Frame(sel, tcon_index, id);
+			trace_sunxi_disp_video_vblank(sel, id,
+					g_video[sel][id].video_cur.id,
+					g_video[sel][id].display_cnt,
+					g_video_queue[sel][id].count);
 		}
 	}
+	spin_unlock(&video_queue_lock);
 
 	return DIS_SUCCESS;
 }
 
 __s32 BSP_disp_video_set_fb(__u32 sel, __u32 hid, __disp_video_fb_t *in_addr)
 {
+	unsigned long flags;
+
 	hid = HANDTOID(hid);
 	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
 
 	if (g_video[sel][hid].enable) {
+		spin_lock_irqsave(&video_queue_lock, flags);
+		video_release(&g_video_queue[sel][hid].new_release);
 		memcpy(&g_video[sel][hid].video_new, in_addr,
 		       sizeof(__disp_video_fb_t));
 		g_video[sel][hid].have_got_frame = TRUE;
 		g_video[sel][hid].display_cnt = 0;
+		spin_unlock_irqrestore(&video_queue_lock, flags);
 
 		return DIS_SUCCESS;
 	} else
 		return DIS_FAIL;
 }
 
+/*
+ * Queue a frame for presentation at pts. On success the queue owns the
+ * release reference; the caller keeps it when DIS_NO_RES is returned
+ * because the queue is full.
+ */
+__s32 BSP_disp_video_queue_fb(__u32 sel, __u32 hid, __disp_video_fb_t *fb,
+			      __s64 pts, struct eventfd_ctx *release)
+{
+	video_queue_t *q;
+	video_queue_slot_t *slot;
+	unsigned long flags;
+
+	hid = HANDTOID(hid);
+	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
+
+	if (!g_video[sel][hid].enable)
+		return DIS_FAIL;
+
+	q = &g_video_queue[sel][hid];
+
+	spin_lock_irqsave(&video_queue_lock, flags);
+	if (q->count == DISP_VIDEO_QUEUE_LEN) {
+		spin_unlock_irqrestore(&video_queue_lock, flags);
+		return DIS_NO_RES;
+	}
+
+	slot = &q->slot[(q->head + q->count) % DISP_VIDEO_QUEUE_LEN];
+	memcpy(&slot->fb, fb, sizeof(__disp_video_fb_t));
+	slot->pts = pts;
+	slot->release = release;
+	q->count++;
+	spin_unlock_irqrestore(&video_queue_lock, flags);
+
+	return DIS_SUCCESS;
+}
+
 /*
  * get the current displaying frame id
  */
@@ -458,12 +613,34 @@ __s32 BSP_disp_video_get_dit_info(__u32 sel, __u32 hid,
 		return DIS_FAIL;
 }
 
+__s32 BSP_disp_video_set_dit_mode(__u32 sel, __u32 hid,
+				  __disp_video_dit_mode_t mode)
+{
+	unsigned long flags;
+
+	hid = HANDTOID(hid);
+	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
+
+	if (mode != DISP_VIDEO_DIT_USER && mode != DISP_VIDEO_DIT_KERNEL)
+		return DIS_PARA_FAILED;
+
+	if (!g_video[sel][hid].enable)
+		return DIS_FAIL;
+
+	spin_lock_irqsave(&video_queue_lock, flags);
+	g_video[sel][hid].dit_kernel = (mode == DISP_VIDEO_DIT_KERNEL);
+	spin_unlock_irqrestore(&video_queue_lock, flags);
+
+	return DIS_SUCCESS;
+}
+
 __s32 BSP_disp_video_start(__u32 sel, __u32 hid)
 {
 	hid = HANDTOID(hid);
 	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
 
 	if (gdisp.screen[sel].layer_manage[hid].status & LAYER_USED) {
+		video_queue_flush(sel, hid);
 		memset(&g_video[sel][hid], 0, sizeof(frame_para_t));
 		g_video[sel][hid].video_cur.id = -1;
 		g_video[sel][hid].enable = TRUE;
@@ -482,6 +659,7 @@ __s32 BSP_disp_video_stop(__u32 sel, __u32 hid)
 	HLID_ASSERT(hid, gdisp.screen[sel].max_layers);
 
 	if (g_video[sel][hid].enable) {
+		video_queue_flush(sel, hid);
 		memset(&g_video[sel][hid], 0, sizeof(frame_para_t));
 
 		video_enhancement_stop(sel, hid);
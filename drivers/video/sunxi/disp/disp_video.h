@@ -50,9 +50,33 @@ typedef struct frame_para {
 	dit_mode_t dit_mode;
 	__bool tempdiff_en;
 	__bool diagintp_en;
+	__bool dit_kernel; /* DISP_VIDEO_DIT_KERNEL */
 
 } frame_para_t;
 
+typedef struct video_queue_slot {
+	__disp_video_fb_t fb;
+	__s64 pts;
+	struct eventfd_ctx *release;
+} video_queue_slot_t;
+
+/*
+ * Frames waiting for their presentation time, plus the release events
+ * of the frames in video_new, video_cur, the deinterlacer reference frame
+ * (kernel dit mode only) and the one replaced at the last vblank (still
+ * read until the next one).
+ */
+typedef struct video_queue {
+	video_queue_slot_t slot[DISP_VIDEO_QUEUE_LEN];
+	__u32 head;
+	__u32 count;
+
+	struct eventfd_ctx *new_release;
+	struct eventfd_ctx *cur_release;
+	struct eventfd_ctx *prev_release;
+	struct eventfd_ctx *retire;
+} video_queue_t;
+
 typedef struct tv_mode_info {
 	__u8 id;
 	__s32 width;
@@ -18,6 +18,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/async.h>
 #include "dev_hdmi.h"
 #include "drv_hdmi_i.h"
 #include "../disp/dev_disp.h"
@@ -25,6 +26,7 @@
 static struct cdev *my_cdev;
 static dev_t devid;
 static struct class *hdmi_class;
+static int hdmi_registered;
 
 hdmi_info_t ghdmi;
 
@@ -84,7 +86,7 @@ hdmi_suspend(struct platform_device *pdev, pm_message_t state)
 static int
 hdmi_resume(struct platform_device *pdev)
 {
-	return 0;
+	return Hdmi_resume();
 }
 
 static struct platform_driver hdmi_driver = {
@@ -140,10 +142,37 @@ static const struct file_operations hdmi_fops = {
 	.mmap = hdmi_mmap,
 };
 
+/* the probe waits for the hot plug line to settle and reads the EDID */
+static int __init hdmi_register(void)
+{
+	int ret;
+
+	ret = platform_device_register(&hdmi_device);
+	if (ret)
+		return ret;
+
+	ret = platform_driver_register(&hdmi_driver);
+	if (ret) {
+		platform_device_unregister(&hdmi_device);
+		return ret;
+	}
+
+	hdmi_registered = 1;
+	return 0;
+}
+
+#ifdef CONFIG_SUNXI_ASYNC_INIT
+static void __init hdmi_register_async(void *data, async_cookie_t cookie)
+{
+	if (hdmi_register())
+		__wrn("hdmi driver register fail\n");
+}
+#endif
+
 static int __init
 hdmi_module_init(void)
 {
-	int ret = 0, err;
+	int err;
 
 	__inf("hdmi_module_init\n");
 
@@ -163,20 +192,22 @@ hdmi_module_init(void)
 		return -1;
 	}
 
-	ret = platform_device_register(&hdmi_device);
-
-	if (ret == 0)
-		ret = platform_driver_register(&hdmi_driver);
-
-	return ret;
+#ifdef CONFIG_SUNXI_ASYNC_INIT
+	async_schedule(hdmi_register_async, NULL);
+	return 0;
+#else
+	return hdmi_register();
+#endif
 }
 
 static void __exit hdmi_module_exit(void)
 {
 	__inf("hdmi_module_exit\n");
 
-	platform_driver_unregister(&hdmi_driver);
-	platform_device_unregister(&hdmi_device);
+	if (hdmi_registered) {
+		platform_driver_unregister(&hdmi_driver);
+		platform_device_unregister(&hdmi_device);
+	}
 
 	class_destroy(hdmi_class);
 
@@ -19,6 +19,7 @@
 
 #include "drv_hdmi_i.h"
 #include "hdmi_core.h"
+#include "hdmi_cec.h"
 #include "dev_hdmi.h"
 #include "../disp/dev_disp.h"
 
@@ -32,8 +33,19 @@ extern void audio_set_hdmi_func(__audio_hdmi_func *hdmi_func);
 
 static DEFINE_MUTEX(HDMI_mutex);
 static struct task_struct *HDMI_task;
+static DECLARE_WAIT_QUEUE_HEAD(HDMI_wait);
+static __bool HDMI_kicked;
 void __iomem *hdmi_base;
 
+/*
+ * Run the main task loop now instead of at the next poll, for state
+ * changes requested by the display and audio drivers.
+ */
+static void hdmi_kick(void)
+{
+	HDMI_kicked = 1;
+	wake_up(&HDMI_wait);
+}
 
 static __s32 Hdmi_enable(__bool enable)
 {
@@ -46,6 +58,7 @@ static __s32 Hdmi_enable(__bool enable)
 		      hdmi_state = HDMI_State_Video_config;
 
 		mutex_unlock(&HDMI_mutex);
+		hdmi_kick();
 	}
 
 	return 0;
@@ -165,6 +178,7 @@ static __s32 Hdmi_set_display_mode(__disp_tv_mode_t mode)
 			hdmi_state = HDMI_State_Video_config;
 
 		mutex_unlock(&HDMI_mutex);
+		hdmi_kick();
 	}
 
 
@@ -180,20 +194,65 @@ static __s32 Hdmi_set_display_videomode(const struct __disp_video_timing *mode)
 
 	if (memcmp(mode, &video_timing[video_timing_edid],
 			sizeof(struct __disp_video_timing)) != 0) {
+		const struct __disp_video_timing *old =
+			&video_timing[video_timing_edid];
+		/* refresh rate only changes keep the link up */
+		__bool in_place = old->INPUTX == mode->INPUTX &&
+			old->INPUTY == mode->INPUTY && old->I == mode->I &&
+			old->AVI_PR == mode->AVI_PR;
+
 		mutex_lock(&HDMI_mutex);
 
 		memcpy(&video_timing[video_timing_edid], mode,
 			   sizeof(struct __disp_video_timing));
 
-		if (hdmi_state > HDMI_State_Video_config)
-			hdmi_state = HDMI_State_Video_config;
+		if (hdmi_state > HDMI_State_Video_config) {
+			if (!in_place || video_timing_update() != 0)
+				hdmi_state = HDMI_State_Video_config;
+		}
 
 		mutex_unlock(&HDMI_mutex);
+		hdmi_kick();
 	}
 
 	return 0;
 }
 
+/*
+ * Side-by-side and top-bottom 3D reuse the 2D timing and only add the
+ * vendor infoframe; frame packing has its own tv modes.
+ */
+static __s32 Hdmi_set_3d_mode(__disp_3d_out_mode_t mode, __bool enable)
+{
+	__s32 structure = HDMI_3D_STRUCTURE_NONE;
+	__s32 ret;
+
+	if (enable) {
+		switch (mode) {
+		case DISP_3D_OUT_MODE_TB:
+			structure = HDMI_3D_STRUCTURE_TB;
+			break;
+		case DISP_3D_OUT_MODE_SSF:
+			structure = HDMI_3D_STRUCTURE_SSF;
+			break;
+		case DISP_3D_OUT_MODE_SSH:
+			structure = HDMI_3D_STRUCTURE_SSH;
+			break;
+		case DISP_3D_OUT_MODE_FP:
+			break;
+		default:
+			__wrn("unsupported hdmi 3d mode %d\n", mode);
+			return -1;
+		}
+	}
+
+	mutex_lock(&HDMI_mutex);
+	ret = hdmi_set_3d_structure(structure);
+	mutex_unlock(&HDMI_mutex);
+
+	return ret;
+}
+
 static __s32 Hdmi_Audio_Enable(__u8 mode, __u8 channel)
 {
 	__s32 audio_en = (channel == 0) ? 0 : 1;
@@ -209,6 +268,7 @@ static __s32 Hdmi_Audio_Enable(__u8 mode, __u8 channel)
 			hdmi_state = HDMI_State_Audio_config;
 
 		mutex_unlock(&HDMI_mutex);
+		hdmi_kick();
 	}
 
 	return 0;
@@ -241,17 +301,25 @@ static __s32 Hdmi_Set_Audio_Para(hdmi_audio_t *audio_para)
 		      audio_info.channel_num);
 	}
 
+	if (audio_para->data_raw != audio_info.data_raw) {
+		change = 1;
+		__inf("data_raw:%d in Hdmi_hal_set_audio_para\n",
+		      audio_para->data_raw);
+	}
+
 	if (change) {
 		mutex_lock(&HDMI_mutex);
 	  
 		audio_info.sample_bit = audio_para->sample_bit;
 		audio_info.sample_rate = audio_para->sample_rate;
 		audio_info.channel_num = audio_para->channel_num;
+		audio_info.data_raw = audio_para->data_raw;
 	  
 		if (hdmi_state > HDMI_State_Audio_config)
 			hdmi_state = HDMI_State_Audio_config;
 
 		mutex_unlock(&HDMI_mutex);
+		hdmi_kick();
 	}
 
 	return 0;
@@ -297,8 +365,20 @@ static __s32 Hdmi_get_HPD_status(void)
 static __s32
 Hdmi_set_pll(__u32 pll, __u32 clk)
 {
+	if (pll == hdmi_pll && clk == hdmi_clk)
+		return 0;
+
+	mutex_lock(&HDMI_mutex);
+
 	hdmi_pll = pll;
 	hdmi_clk = clk;
+
+	/* a running link needs the transmitter divider redone */
+	if (hdmi_state > HDMI_State_Video_config)
+		video_timing_update();
+
+	mutex_unlock(&HDMI_mutex);
+
 	return 0;
 }
 
@@ -306,8 +386,10 @@ static int
 Hdmi_run_thread(void *parg)
 {
 	while (1) {
+		__u32 poll_ms;
+
 		mutex_lock(&HDMI_mutex);
-	  
+
 		hdmi_main_task_loop();
 
 		mutex_unlock(&HDMI_mutex);
@@ -315,16 +397,31 @@ Hdmi_run_thread(void *parg)
 		if (kthread_should_stop())
 			break;
 
-		if (hdmi_state == HDMI_State_Wait_Hpd ||
-		    hdmi_state == HDMI_State_Playback)
-			hdmi_delay_ms(250);
-		else
-			hdmi_delay_ms(1);
+		/*
+		 * The controller has no documented hotplug interrupt, so HPD
+		 * is polled: once per HPD_POLL_MS when idle, faster while a
+		 * level change is debounced. Everything else kicks the thread.
+		 */
+		poll_ms = hdmi_hpd_debouncing() ? HPD_DEBOUNCE_MS : HPD_POLL_MS;
+		wait_event_interruptible_timeout(HDMI_wait,
+				HDMI_kicked || kthread_should_stop(),
+				msecs_to_jiffies(poll_ms));
+		HDMI_kicked = 0;
 	}
 
 	return 0;
 }
 
+__s32 Hdmi_resume(void)
+{
+	mutex_lock(&HDMI_mutex);
+	hdmi_core_resume();
+	mutex_unlock(&HDMI_mutex);
+	hdmi_kick();
+
+	return 0;
+}
+
 __s32 Hdmi_init(struct platform_device *dev)
 {
 	__audio_hdmi_func audio_func;
@@ -337,6 +434,13 @@ __s32 Hdmi_init(struct platform_device *dev)
 	if (err)
 		return err;
 
+	err = hdmi_cec_init();
+	if (err) {
+		__wrn("Unable to register the cec device\n");
+		hdmi_i2c_sunxi_remove(dev);
+		return err;
+	}
+
 	audio_info.channel_num = 2;
 #if 0
 	{ /* for audio test */
@@ -351,8 +455,12 @@ __s32 Hdmi_init(struct platform_device *dev)
 #endif
 
 
-	/* Run main task once, should give EDID information directly */
+	/* Run main task until HPD settled, gives EDID information directly */
 	hdmi_main_task_loop();
+	while (hdmi_hpd_debouncing()) {
+		hdmi_delay_ms(HPD_DEBOUNCE_MS);
+		hdmi_main_task_loop();
+	}
 
 	HDMI_task = kthread_create(Hdmi_run_thread, (void *)0, "hdmi proc");
 	if (IS_ERR(HDMI_task)) {
@@ -384,6 +492,7 @@ __s32 Hdmi_init(struct platform_device *dev)
 	disp_func.hdmi_get_video_timing = hdmi_get_video_timing;
 	disp_func.hdmi_get_HPD_status = Hdmi_get_HPD_status;
 	disp_func.hdmi_set_pll = Hdmi_set_pll;
+	disp_func.hdmi_set_3d_mode = Hdmi_set_3d_mode;
 	disp_set_hdmi_func(&disp_func);
 
 	return 0;
@@ -397,6 +506,7 @@ __s32 Hdmi_exit(struct platform_device *dev)
 		HDMI_task = NULL;
 	}
 
+	hdmi_cec_exit();
 	hdmi_i2c_sunxi_remove(dev);
 
 	return 0;
@@ -54,5 +54,6 @@
 
 __s32 Hdmi_init(struct platform_device *dev);
 __s32 Hdmi_exit(struct platform_device *dev);
+__s32 Hdmi_resume(void);
 
 #endif
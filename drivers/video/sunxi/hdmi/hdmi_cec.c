@@ -17,6 +17,12 @@
  * MA 02111-1307 USA
  */
 
+#include <linux/hrtimer.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
 #include <mach/clock.h>
 #include "hdmi_cec.h"
 #include "hdmi_core.h"
@@ -136,264 +142,572 @@ static __s32 hdmi_cec_send_bit(__u32 data)    /* 1bit */
 
 }
 
-static __s32 hdmi_cec_ack(__u32 data)    /* 1bit */
+#if 0 /* Not used */
+static __s32 hdmi_cec_free(void)
 {
-	__u32 low_time, whole_time;
+	pr_info("hdmi_cec_free!===\n");
+	while (hdmi_cec_read_reg_bit() != 0x1)
+		;
 
-	pr_debug("hdmi_cec_ack===\n");
+	pr_info("loop out!===\n");
 
-	low_time = (data == 1) ?
-			HDMI_CEC_DATA_BIT1_LOW_TIME :
-			HDMI_CEC_DATA_BIT0_LOW_TIIME;
-	whole_time = HDMI_CEC_DATA_BIT_WHOLE_TIME;
+	hdmi_start_timer();
+	pr_info("wait 7 data period===\n");
+	while (hdmi_cec_read_reg_bit() == 0x1) {
+		if (hdmi_calc_time() > 7 * 2400)
+			break;
 
-	while (hdmi_cec_read_reg_bit() == 1)
-		;
+	}
+	pr_info("wait 7 data period end===\n");
 
-	hdmi_cec_write_reg_bit(0);
+	return 0;
+}
+#endif
 
-	hdmi_delay_us(low_time);
+/*
+ * CEC engine
+ *
+ * There is no CEC controller behind HDMI_CEC, only a line driver and
+ * a line sampler, so an hrtimer walks the bit timings instead of busy
+ * waiting in the hdmi thread. Frames in the tx queue are sent once the
+ * signal free time has passed and are retried when the ack is missing.
+ * While the device node is open the idle line is sampled every
+ * CEC_TICK_US for an incoming start bit; frames addressed to us are
+ * acked and, together with broadcasts, put in the rx ring for read().
+ */
 
-	hdmi_cec_write_reg_bit(1);
+#define CEC_MAX_FRAME		16
+#define CEC_TX_QUEUE_LEN	8
+#define CEC_RX_RING_LEN		16
+#define CEC_TX_RETRIES		5
+
+/* time us */
+#define CEC_TICK_US		100
+#define CEC_TX_SAMPLE_US	1050
+/* the falling edge is seen up to CEC_TICK_US late while polling */
+#define CEC_RX_SAMPLE_US	(CEC_TX_SAMPLE_US - CEC_TICK_US / 2)
+#define CEC_RX_ACK_US		(HDMI_CEC_DATA_BIT0_LOW_TIIME - CEC_TICK_US / 2)
+#define CEC_RX_BIT_TIMEOUT_US	2900
+#define CEC_START_LOW_MIN	3400
+#define CEC_START_LOW_MAX	4000
+#define CEC_START_WHOLE_MIN	4200
+#define CEC_START_WHOLE_MAX	4800
+
+/* signal free time, in data bit periods */
+#define CEC_FREE_RETRY		3
+#define CEC_FREE_NEW		5
+#define CEC_FREE_INITIATOR	7
+
+enum hdmi_cec_state {
+	CEC_ST_OFF,		/* timer not running */
+	CEC_ST_IDLE,
+	CEC_ST_TX_LOW,		/* driving the low part of a bit */
+	CEC_ST_TX_ACK,		/* driving the low part of the ack bit */
+	CEC_ST_TX_ACK_SAMPLE,
+	CEC_ST_TX_HIGH,		/* released, waiting for the end of the bit */
+	CEC_ST_RX_START_LOW,
+	CEC_ST_RX_START_HIGH,
+	CEC_ST_RX_SAMPLE,
+	CEC_ST_RX_WAIT_EDGE,
+	CEC_ST_RX_ACK,		/* driving our ack */
+};
+
+struct hdmi_cec_frame {
+	__u8 len;
+	__u8 data[CEC_MAX_FRAME];
+};
+
+static struct {
+	spinlock_t lock;
+	struct hrtimer timer;
+	enum hdmi_cec_state state;
+	ktime_t bit_start;	/* falling edge of the current bit */
+	__u32 bit_whole;
+	__s32 bit;		/* current bit in the frame, 10 per byte */
+	__bool nack;
+	__bool eom;
+	__bool rx_ack;		/* incoming frame is addressed to us */
+	ktime_t idle_since;
+	__u32 free_bits;
+	__u32 retries;
+	struct hdmi_cec_frame rx;
+
+	/* free running counters, the tail of the tx queue is on the wire */
+	struct hdmi_cec_frame tx_queue[CEC_TX_QUEUE_LEN];
+	__s32 tx_result[CEC_TX_QUEUE_LEN];
+	__u32 tx_head, tx_tail;
+	struct hdmi_cec_frame rx_ring[CEC_RX_RING_LEN];
+	__u32 rx_head, rx_tail;
+
+	__u32 users;
+	wait_queue_head_t tx_wait;
+	wait_queue_head_t rx_wait;
+} cec;
+
+/* lock held */
+static void hdmi_cec_engine_kick(void)
+{
+	if (cec.state != CEC_ST_OFF)
+		return;
+
+	cec.state = CEC_ST_IDLE;
+	cec.idle_since = ktime_get();
+	cec.free_bits = CEC_FREE_NEW;
+	hrtimer_start(&cec.timer, ktime_set(0, CEC_TICK_US * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+}
 
-	hdmi_delay_us(whole_time - low_time);
+static void hdmi_cec_idle(ktime_t now, __u32 free_bits)
+{
+	cec.state = CEC_ST_IDLE;
+	cec.idle_since = now;
+	cec.free_bits = free_bits;
+}
 
-	pr_debug("one bit over\n");
+/* pull the line low for the next bit, returns the end of its low time */
+static ktime_t hdmi_cec_tx_bit(ktime_t start)
+{
+	struct hdmi_cec_frame *frame =
+		&cec.tx_queue[cec.tx_tail % CEC_TX_QUEUE_LEN];
+	__u32 byte = cec.bit / 10;
+	__u32 pos = cec.bit % 10;
+	__u32 val;
+
+	if (pos < 8)
+		val = (frame->data[byte] >> (7 - pos)) & 0x1;
+	else if (pos == 8)
+		val = (byte == frame->len - 1);
+	else
+		val = 1; /* ack, the follower stretches it to a 0 */
 
-	return 0;
+	cec.bit_start = start;
+	cec.bit_whole = HDMI_CEC_DATA_BIT_WHOLE_TIME;
+	cec.state = (pos == 9) ? CEC_ST_TX_ACK : CEC_ST_TX_LOW;
+	hdmi_cec_write_reg_bit(0);
 
+	return ktime_add_us(start, val ? HDMI_CEC_DATA_BIT1_LOW_TIME :
+			    HDMI_CEC_DATA_BIT0_LOW_TIIME);
 }
 
-/* active: 1: used while send msg; */
-/*         0: used while receive msg */
-static __s32 hdmi_cec_receive_bit(__bool active, __u32 *data)    /*1bit */
+static ktime_t hdmi_cec_tx_start(ktime_t now)
 {
-	__s32 ret = 0;
+	cec.bit = -1;
+	cec.nack = 0;
+	cec.bit_start = now;
+	cec.bit_whole = HDMI_CEC_START_BIT_WHOLE_TIME;
+	cec.state = CEC_ST_TX_LOW;
 
-	if (active) {
-		hdmi_cec_write_reg_bit(0);
-		hdmi_delay_us(200);
-		hdmi_cec_write_reg_bit(1);
-		hdmi_delay_us(800);
-	} else {
-		while (hdmi_cec_read_reg_bit() == 1)
-			;
-		hdmi_delay_us(1000);
-	}
-	*data = hdmi_cec_read_reg_bit();
+	hdmi_cec_enable(1);
+	hdmi_cec_write_reg_bit(0);
 
-	if (active)
-		hdmi_delay_us(1400);
-	else
-		hdmi_delay_us(1100);
+	return ktime_add_us(now, HDMI_CEC_START_BIT_LOW_TIME);
+}
 
-	return ret;
+static void hdmi_cec_tx_finish(ktime_t now, __bool acked)
+{
+	hdmi_cec_write_reg_bit(1);
+	hdmi_cec_enable(0);
 
+	if (!acked && cec.retries < CEC_TX_RETRIES) {
+		cec.retries++;
+		hdmi_cec_idle(now, CEC_FREE_RETRY);
+		return;
+	}
+
+	cec.tx_result[cec.tx_tail % CEC_TX_QUEUE_LEN] = acked ? 0 : -EIO;
+	cec.tx_tail++;
+	cec.retries = 0;
+	hdmi_cec_idle(now, CEC_FREE_INITIATOR);
+
+	wake_up_interruptible(&cec.tx_wait);
 }
 
-#if 0 /* Not used */
-static __s32 hdmi_cec_free(void)
+static void hdmi_cec_rx_push(void)
 {
-	pr_info("hdmi_cec_free!===\n");
-	while (hdmi_cec_read_reg_bit() != 0x1)
-		;
+	__u32 follower = cec.rx.data[0] & 0xf;
 
-	pr_info("loop out!===\n");
+	if ((follower != cec_logical_addr) &&
+	    (follower != HDMI_CEC_LADDR_BROADCAST))
+		return;
 
-	hdmi_start_timer();
-	pr_info("wait 7 data period===\n");
-	while (hdmi_cec_read_reg_bit() == 0x1) {
-		if (hdmi_calc_time() > 7 * 2400)
-			break;
+	/* drop the oldest frame when nobody reads */
+	if (cec.rx_head - cec.rx_tail == CEC_RX_RING_LEN)
+		cec.rx_tail++;
 
-	}
-	pr_info("wait 7 data period end===\n");
+	cec.rx_ring[cec.rx_head % CEC_RX_RING_LEN] = cec.rx;
+	cec.rx_head++;
 
-	return 0;
+	wake_up_interruptible(&cec.rx_wait);
 }
-#endif
 
-static __s32 hdmi_cec_send_byte(__u32 data, __u32 eom, __u32 *ack)  /* 1byte */
+static enum hrtimer_restart hdmi_cec_timer(struct hrtimer *timer)
 {
-	__u32 i;
-
-	pr_debug("hdmi_cec_send_byte!===\n");
+	ktime_t now = ktime_get();
+	ktime_t next = ktime_add_us(now, CEC_TICK_US);
+	unsigned long flags;
+	__u32 line, byte, pos;
+	s64 elapsed;
+
+	spin_lock_irqsave(&cec.lock, flags);
+
+	line = hdmi_cec_read_reg_bit();
+	elapsed = ktime_us_delta(now, cec.bit_start);
+
+	switch (cec.state) {
+	case CEC_ST_OFF:
+		break;
+
+	case CEC_ST_IDLE:
+		if (!line) {
+			cec.bit_start = now;
+			cec.state = CEC_ST_RX_START_LOW;
+		} else if (cec.tx_head != cec.tx_tail) {
+			if (ktime_us_delta(now, cec.idle_since) >=
+			    cec.free_bits * HDMI_CEC_DATA_BIT_WHOLE_TIME)
+				next = hdmi_cec_tx_start(now);
+		} else if (!cec.users)
+			cec.state = CEC_ST_OFF;
+		break;
+
+	case CEC_ST_TX_LOW:
+		hdmi_cec_write_reg_bit(1);
+		cec.state = CEC_ST_TX_HIGH;
+		next = ktime_add_us(cec.bit_start, cec.bit_whole);
+		break;
 
-	if (cec_enable == 0) {
-		pr_info("cec dont enable\n");
-		return -1;
-	}
+	case CEC_ST_TX_ACK:
+		hdmi_cec_write_reg_bit(1);
+		cec.state = CEC_ST_TX_ACK_SAMPLE;
+		next = ktime_add_us(cec.bit_start, CEC_TX_SAMPLE_US);
+		break;
+
+	case CEC_ST_TX_ACK_SAMPLE:
+		/* a broadcast is refused by pulling its ack low */
+		if ((cec.tx_queue[cec.tx_tail % CEC_TX_QUEUE_LEN].data[0] & 0xf)
+		    == HDMI_CEC_LADDR_BROADCAST)
+			cec.nack = !line;
+		else
+			cec.nack = line;
+		cec.state = CEC_ST_TX_HIGH;
+		next = ktime_add_us(cec.bit_start, cec.bit_whole);
+		break;
+
+	case CEC_ST_TX_HIGH:
+		if (cec.nack) {
+			hdmi_cec_tx_finish(now, 0);
+			break;
+		}
+		cec.bit++;
+		if (cec.bit ==
+		    cec.tx_queue[cec.tx_tail % CEC_TX_QUEUE_LEN].len * 10) {
+			hdmi_cec_tx_finish(now, 1);
+			break;
+		}
+		next = hdmi_cec_tx_bit(ktime_add_us(cec.bit_start,
+						    cec.bit_whole));
+		break;
 
-	pr_debug("data bit");
-	for (i = 0; i < 8; i++) {
-		if (data & 0x80)
-			hdmi_cec_send_bit(1);
+	case CEC_ST_RX_START_LOW:
+		if (!line)
+			break;
+		if (elapsed >= CEC_START_LOW_MIN && elapsed <= CEC_START_LOW_MAX)
+			cec.state = CEC_ST_RX_START_HIGH;
 		else
-			hdmi_cec_send_bit(0);
+			hdmi_cec_idle(now, CEC_FREE_NEW);
+		break;
 
-		data = data << 1;
-	}
+	case CEC_ST_RX_START_HIGH:
+		if (line) {
+			if (elapsed > CEC_START_WHOLE_MAX)
+				hdmi_cec_idle(now, CEC_FREE_NEW);
+			break;
+		}
+		if (elapsed < CEC_START_WHOLE_MIN) {
+			hdmi_cec_idle(now, CEC_FREE_NEW);
+			break;
+		}
+		memset(&cec.rx, 0, sizeof(cec.rx));
+		cec.bit = 0;
+		cec.eom = 0;
+		cec.rx_ack = 0;
+		cec.bit_start = now;
+		cec.state = CEC_ST_RX_SAMPLE;
+		next = ktime_add_us(now, CEC_RX_SAMPLE_US);
+		break;
+
+	case CEC_ST_RX_SAMPLE:
+		byte = cec.bit / 10;
+		pos = cec.bit % 10;
+		if (pos < 8) {
+			cec.rx.data[byte] = (cec.rx.data[byte] << 1) | line;
+			if (pos == 7) {
+				cec.rx.len = byte + 1;
+				if (byte == 0)
+					cec.rx_ack = ((cec.rx.data[0] & 0xf) ==
+						      cec_logical_addr);
+			}
+		} else if (pos == 8)
+			cec.eom = line;
+		else if (cec.eom) {
+			hdmi_cec_rx_push();
+			hdmi_cec_idle(now, CEC_FREE_NEW);
+			break;
+		}
+		cec.state = CEC_ST_RX_WAIT_EDGE;
+		break;
 
-	pr_debug("bit eom\n");
-	hdmi_cec_send_bit(eom);
+	case CEC_ST_RX_WAIT_EDGE:
+		if (line) {
+			if (elapsed > CEC_RX_BIT_TIMEOUT_US)
+				hdmi_cec_idle(now, CEC_FREE_NEW);
+			break;
+		}
+		cec.bit++;
+		if (cec.bit / 10 >= CEC_MAX_FRAME) {
+			hdmi_cec_idle(now, CEC_FREE_NEW);
+			break;
+		}
+		cec.bit_start = now;
+		if (cec.bit % 10 == 9 && cec.rx_ack) {
+			hdmi_cec_enable(1);
+			hdmi_cec_write_reg_bit(0);
+			cec.state = CEC_ST_RX_ACK;
+			next = ktime_add_us(now, CEC_RX_ACK_US);
+		} else {
+			cec.state = CEC_ST_RX_SAMPLE;
+			next = ktime_add_us(now, CEC_RX_SAMPLE_US);
+		}
+		break;
+
+	case CEC_ST_RX_ACK:
+		hdmi_cec_write_reg_bit(1);
+		hdmi_cec_enable(0);
+		if (cec.eom) {
+			hdmi_cec_rx_push();
+			hdmi_cec_idle(now, CEC_FREE_NEW);
+		} else
+			cec.state = CEC_ST_RX_WAIT_EDGE;
+		break;
+	}
 
-	/* hdmi_cec_send_bit(1); */
+	if (cec.state == CEC_ST_OFF) {
+		spin_unlock_irqrestore(&cec.lock, flags);
+		return HRTIMER_NORESTART;
+	}
 
-	/* todo? */
-	pr_debug("receive ack\n");
-	hdmi_cec_receive_bit(1, ack);
+	hrtimer_set_expires(timer, next);
+	spin_unlock_irqrestore(&cec.lock, flags);
 
-	return 0;
+	return HRTIMER_RESTART;
 }
 
-static __s32 hdmi_cec_receive_byte(__u32 *data, __u32 *eom)    /* 1byte */
+static int hdmi_cec_tx_queue(const struct hdmi_cec_frame *frame, __u32 *seq)
 {
-	__u32 i;
-	__u32 data_bit = 0;
-	__u32 data_byte = 0;
+	unsigned long flags;
+	__u32 initiator = frame->data[0] >> 4;
 
-	for (i = 0; i < 8; i++) {
-		hdmi_cec_receive_bit(0, &data_bit);
-		data_byte = data_byte << 1;
-		data_byte |= data_bit;
+	spin_lock_irqsave(&cec.lock, flags);
+
+	if (cec.tx_head - cec.tx_tail == CEC_TX_QUEUE_LEN) {
+		spin_unlock_irqrestore(&cec.lock, flags);
+		return -EBUSY;
 	}
 
-	*data = data_byte;
+	/* we answer as whatever address the last frame was sent from */
+	if (initiator != HDMI_CEC_LADDR_BROADCAST)
+		cec_logical_addr = initiator;
 
-	hdmi_cec_receive_bit(0, eom);
+	cec.tx_queue[cec.tx_head % CEC_TX_QUEUE_LEN] = *frame;
+	*seq = cec.tx_head++;
+	hdmi_cec_engine_kick();
+
+	spin_unlock_irqrestore(&cec.lock, flags);
 
 	return 0;
 }
 
+/* Queue a message for the engine, returns 0 once it is queued. */
 __s32 hdmi_cec_send_msg(struct __hdmi_cec_msg_t *msg)
 {
-	__u32 header_block;
-	enum __hdmi_cec_msg_eom eom;
-	__u32 real_ack = 0;
-	__u32 i;
-	__u32 ack = (msg->follower_addr == HDMI_CEC_LADDR_BROADCAST) ?
-			HDMI_CEC_BROADCAST_MSG_ACK : HDMI_CEC_NORMAL_MSG_ACK;
-
-	header_block = ((msg->initiator_addr & 0xf) << 4)
-			| (msg->follower_addr & 0xf);
-	eom = (msg->opcode_valid) ? HDMI_CEC_MSG_MORE : HDMI_CEC_MSG_END;
+	struct hdmi_cec_frame frame;
+	__u32 i, seq;
+
+	frame.data[0] = ((msg->initiator_addr & 0xf) << 4) |
+		(msg->follower_addr & 0xf);
+	frame.len = 1;
+
+	if (msg->opcode_valid) {
+		frame.data[frame.len++] = msg->opcode;
+		for (i = 0; (i < msg->para_num) && (frame.len < CEC_MAX_FRAME);
+		     i++)
+			frame.data[frame.len++] = msg->para[i];
+	}
 
-	hdmi_cec_enable(1);
-	hdmi_cec_start_bit();                          /* start bit */
-	hdmi_cec_send_byte(header_block, eom, &real_ack);   /* header block */
-
-	if ((real_ack == ack) && (msg->opcode_valid)) {
-		eom = (msg->para_num != 0) ?
-				HDMI_CEC_MSG_MORE : HDMI_CEC_MSG_END;
-		/* data block: opcode */
-		hdmi_cec_send_byte(msg->opcode, eom, &real_ack);
-
-		if (real_ack == ack) {
-			for (i = 0; i < msg->para_num; i++) {
-				eom = (i == (msg->para_num - 1)) ?
-						HDMI_CEC_MSG_END :
-						HDMI_CEC_MSG_MORE;
-				/* data block: parameters */
-				hdmi_cec_send_byte(msg->para[i], eom,
-						&real_ack);
-			}
-		}
+	if (hdmi_cec_tx_queue(&frame, &seq)) {
+		pr_debug("%s queue full\n", __func__);
+		return -1;
 	}
-	hdmi_cec_enable(0);
 
-	pr_debug("%s ack:%d\n", __func__, real_ack);
-	return real_ack;
+	return 0;
 }
 
-static __s32 hdmi_cec_wait_for_start_bit(void)
+/*
+ * Character device: every read() returns one raw frame (header block
+ * first) and needs room for CEC_MAX_FRAME bytes, every write() sends
+ * one raw frame and, unless O_NONBLOCK, returns -EIO when it was not
+ * acked after all retries.
+ */
+static int hdmi_cec_open(struct inode *inode, struct file *file)
 {
-	__u32 i;
-	__s32 ret = 0;
-
-	pr_debug("%s wait for stbit\n", __func__);
-	while (1) {
-		while (hdmi_cec_read_reg_bit() == 1)
-			;
+	unsigned long flags;
 
-		for (i = 0; i < 7; i++) {
-			if (hdmi_cec_read_reg_bit() == 1)
-				break;
+	spin_lock_irqsave(&cec.lock, flags);
+	cec.users++;
+	hdmi_cec_engine_kick();
+	spin_unlock_irqrestore(&cec.lock, flags);
 
-			hdmi_delay_us(500);
-		}
+	return nonseekable_open(inode, file);
+}
 
-		if (i < 7)
-			continue;
+static int hdmi_cec_release(struct inode *inode, struct file *file)
+{
+	unsigned long flags;
 
-		while (hdmi_cec_read_reg_bit() == 0)
-			;
+	/* the timer stops by itself once the bus is idle */
+	spin_lock_irqsave(&cec.lock, flags);
+	cec.users--;
+	spin_unlock_irqrestore(&cec.lock, flags);
 
-		for (i = 0; i < 4; i++) {
-			if (hdmi_cec_read_reg_bit() == 0)
-				break;
+	return 0;
+}
 
-			hdmi_delay_us(100);
+static ssize_t hdmi_cec_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct hdmi_cec_frame frame;
+	unsigned long flags;
+	int ret;
+
+	if (count < CEC_MAX_FRAME)
+		return -EINVAL;
+
+	for (;;) {
+		spin_lock_irqsave(&cec.lock, flags);
+		if (cec.rx_head != cec.rx_tail) {
+			frame = cec.rx_ring[cec.rx_tail % CEC_RX_RING_LEN];
+			cec.rx_tail++;
+			spin_unlock_irqrestore(&cec.lock, flags);
+			break;
 		}
+		spin_unlock_irqrestore(&cec.lock, flags);
 
-		if (i < 4)
-			continue;
-		else
-			break;
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(cec.rx_wait,
+					       cec.rx_head != cec.rx_tail);
+		if (ret)
+			return ret;
 	}
 
-	return ret;
+	if (copy_to_user(buf, frame.data, frame.len))
+		return -EFAULT;
+
+	return frame.len;
 }
 
-__s32 hdmi_cec_receive_msg(struct __hdmi_cec_msg_t *msg)
+static ssize_t hdmi_cec_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
 {
-	__u32 data_byte;
-	__u32 ack;
-	__u32 i;
-	__u32 eom;
-	cec_logical_addr = 0x04;
+	struct hdmi_cec_frame frame;
+	__u32 seq;
+	int ret;
 
-	memset(msg, 0, sizeof(struct __hdmi_cec_msg_t));
+	if (count < 1 || count > CEC_MAX_FRAME)
+		return -EINVAL;
 
-	hdmi_cec_wait_for_start_bit();
+	if (copy_from_user(frame.data, buf, count))
+		return -EFAULT;
+	frame.len = count;
 
-	hdmi_cec_receive_byte(&data_byte, &eom);
+	while (hdmi_cec_tx_queue(&frame, &seq)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
 
-	msg->initiator_addr = (data_byte >> 4) & 0x0f;
-	msg->follower_addr = data_byte & 0x0f;
+		ret = wait_event_interruptible(cec.tx_wait,
+			cec.tx_head - cec.tx_tail < CEC_TX_QUEUE_LEN);
+		if (ret)
+			return ret;
+	}
 
-	if ((msg->follower_addr == cec_logical_addr)
-			|| (msg->follower_addr == HDMI_CEC_LADDR_BROADCAST)) {
-		ack = (msg->follower_addr == cec_logical_addr) ? 0 : 1;
-		hdmi_cec_ack(ack);
+	if (file->f_flags & O_NONBLOCK)
+		return count;
 
-		if (!eom) {
-			hdmi_cec_receive_byte(&data_byte, &eom);
-			msg->opcode = data_byte;
-			msg->opcode_valid = 1;
+	/* an interrupted writer leaves the frame queued */
+	ret = wait_event_interruptible(cec.tx_wait,
+				       (__s32)(cec.tx_tail - seq) > 0);
+	if (ret)
+		return ret;
 
-			hdmi_cec_ack(ack);
+	if (cec.tx_result[seq % CEC_TX_QUEUE_LEN])
+		return -EIO;
 
-			while (!eom) {
-				hdmi_cec_receive_byte(&data_byte, &eom);
-				msg->para[msg->para_num] = data_byte;
-				msg->para_num++;
+	return count;
+}
 
-				hdmi_cec_ack(ack);
-			}
-		}
+static unsigned int hdmi_cec_poll(struct file *file, poll_table *wait)
+{
+	unsigned int mask = 0;
 
-		pr_debug("%s %d, %d\n", __func__,
-				msg->initiator_addr, msg->follower_addr);
-	} else
-		hdmi_cec_ack(1);
+	poll_wait(file, &cec.rx_wait, wait);
+	poll_wait(file, &cec.tx_wait, wait);
 
-	if (msg->opcode_valid)
-		pr_debug("%s op: 0x%x\n", __func__, msg->opcode);
+	if (cec.rx_head != cec.rx_tail)
+		mask |= POLLIN | POLLRDNORM;
+	if (cec.tx_head - cec.tx_tail < CEC_TX_QUEUE_LEN)
+		mask |= POLLOUT | POLLWRNORM;
 
-	for (i = 0; i < msg->para_num; i++)
-		pr_debug("%s para[%d]: 0x%x\n", __func__, i, msg->para[i]);
+	return mask;
+}
 
-	return 0;
+static const struct file_operations hdmi_cec_fops = {
+	.owner = THIS_MODULE,
+	.open = hdmi_cec_open,
+	.release = hdmi_cec_release,
+	.read = hdmi_cec_read,
+	.write = hdmi_cec_write,
+	.poll = hdmi_cec_poll,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice hdmi_cec_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "hdmi_cec",
+	.fops = &hdmi_cec_fops,
+};
+
+__s32 hdmi_cec_init(void)
+{
+	spin_lock_init(&cec.lock);
+	init_waitqueue_head(&cec.tx_wait);
+	init_waitqueue_head(&cec.rx_wait);
+	hrtimer_init(&cec.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cec.timer.function = hdmi_cec_timer;
+	cec.state = CEC_ST_OFF;
+
+	cec_enable = 0;
+	cec_logical_addr = HDMI_CEC_LADDR_PAYER1;
+
+	return misc_register(&hdmi_cec_dev);
+}
+
+void hdmi_cec_exit(void)
+{
+	misc_deregister(&hdmi_cec_dev);
+	hrtimer_cancel(&cec.timer);
+
+	hdmi_cec_write_reg_bit(1);
+	hdmi_cec_enable(0);
 }
 
 #if 0 /* Not used */
@@ -757,14 +1071,6 @@ __s32 hdmi_cec_test(void)
 
 }
 
-#if 0 /* Not used */
-static __s32 hdmi_cec_init(void)
-{
-	cec_enable = 0;
-	cec_logical_addr = HDMI_CEC_LADDR_PAYER1;
-	return 0;
-}
-#endif
 
 void hdmi_cec_task_loop(void)
 {
@@ -24,6 +24,9 @@
 #include "hdmi_cec.h"
 #include "hdmi_core.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/sunxi_hdmi.h>
+
 static char *audio;
 module_param(audio, charp, 0444);
 MODULE_PARM_DESC(audio,
@@ -37,9 +40,11 @@ __bool video_enable;
 static __bool audio_edid;
 static __bool audio_enable = 1;
 __s32 video_mode = HDMI720P_50;
+__s32 video_3d_structure = HDMI_3D_STRUCTURE_NONE;
 HDMI_AUDIO_INFO audio_info;
 __u8 Device_Support_VIC[HDMI_DEVICE_SUPPORT_VIC_SIZE];
 static __s32 HPD;
+static __s32 hpd_samples;
 static int audio_devs_registered;
 
 __u32 hdmi_pll = AW_SYS_CLK_PLL3;
@@ -106,24 +111,58 @@ __s32 hdmi_core_initial(void)
 	return 0;
 }
 
+/*
+ * HPD is sampled once per main loop pass, the debounced level only
+ * follows after HPD_DEBOUNCE_SAMPLES equal samples in a row.
+ */
 static __s32
 main_Hpd_Check(void)
 {
-	__s32 i, times;
-	times = 0;
+	__s32 level = (readl(HDMI_HPD) & 0x01) ? 1 : 0;
 
-	for (i = 0; i < 3; i++) {
-		hdmi_delay_ms(10);
-		if (readl(HDMI_HPD) & 0x01)
-			times++;
+	if (level == HPD) {
+		hpd_samples = 0;
+		return HPD;
 	}
-	if (times == 3)
-		return 1;
-	else
-		return 0;
+
+	if (++hpd_samples < HPD_DEBOUNCE_SAMPLES)
+		return HPD;
+
+	hpd_samples = 0;
+	return level;
 }
 
-__s32 hdmi_main_task_loop(void)
+/*
+ * Non zero while an HPD change is being debounced, the main loop should
+ * then be run again after HPD_DEBOUNCE_MS.
+ */
+__s32 hdmi_hpd_debouncing(void)
+{
+	return hpd_samples;
+}
+
+/*
+ * Bring the controller back after resume. With the sink still plugged in
+ * the EDID parsed before suspend is kept and only video is reconfigured,
+ * otherwise the state machine starts over from hotplug detection.
+ */
+void hdmi_core_resume(void)
+{
+	writel(0x80000000, HDMI_CTRL); /* start hdmi controller */
+	if (sunxi_is_sun7i())
+		writel(0xe0000000, HDMI_TX_DRIVER); /* power enable */
+
+	hpd_samples = 0;
+	if (HPD && (readl(HDMI_HPD) & 0x01) &&
+	    hdmi_state > HDMI_State_EDID_Parse) {
+		hdmi_state = HDMI_State_Wait_Video_config;
+	} else {
+		HPD = 0;
+		hdmi_state = HDMI_State_Wait_Hpd;
+	}
+}
+
+static __s32 hdmi_main_task_step(void)
 {
 	int rc, i;
 
@@ -205,6 +244,18 @@ __s32 hdmi_main_task_loop(void)
 	}
 }
 
+__s32 hdmi_main_task_loop(void)
+{
+	__s32 old_state = hdmi_state;
+	__s32 ret;
+
+	ret = hdmi_main_task_step();
+	if (hdmi_state != old_state)
+		trace_sunxi_hdmi_state(old_state, hdmi_state, HPD);
+
+	return ret;
+}
+
 __s32 Hpd_Check(void)
 {
 	if (HPD == 0)
@@ -292,35 +343,86 @@ static __s32 get_audio_info(__s32 sample_rate)
 	return 0;
 }
 
-__s32 video_config(__s32 vic)
+/*
+ * The vendor specific infoframe carries the 3D structure. Frame packing
+ * timings always send it, 2D timings only when a side-by-side or
+ * top-bottom structure was selected with hdmi_set_3d_structure().
+ */
+static void vendor_infoframe_config(__s32 vic)
 {
-	__s32 vic_tab, clk_div, reg_val, dw = 0;
-	const struct __disp_video_timing *timing;
+	__s32 structure = video_3d_structure;
+	__u32 i, sum = 0;
 
-	__inf("video_config, video_mode:%d\n", vic);
+	if ((vic == HDMI1080P_24_3D_FP) || (vic == HDMI720P_50_3D_FP) ||
+	    (vic == HDMI720P_60_3D_FP))
+		structure = HDMI_3D_STRUCTURE_FP;
 
-	vic_tab = get_video_info(vic);
-	if (vic_tab == -1)
+	writeb(0x81, HDMI_VENDOR_INFOFRAME);
+	writeb(0x01, HDMI_VENDOR_INFOFRAME + 1);
+	writeb(6, HDMI_VENDOR_INFOFRAME + 2);	/* length */
+
+	writeb(0x03, HDMI_VENDOR_INFOFRAME + 4); /* pb1-3:24bit ieee id */
+	writeb(0x0c, HDMI_VENDOR_INFOFRAME + 5);
+	writeb(0x00, HDMI_VENDOR_INFOFRAME + 6);
+	writeb(0x40, HDMI_VENDOR_INFOFRAME + 7); /* pb4 */
+	/* pb5:3d structure, 3d meta not present */
+	if (structure == HDMI_3D_STRUCTURE_NONE)
+		writeb(0x00, HDMI_VENDOR_INFOFRAME + 8);
+	else
+		writeb(structure << 4, HDMI_VENDOR_INFOFRAME + 8);
+
+	/* pb6:extra data for 3d, side by side half uses odd/left odd/right */
+	writeb(0x00, HDMI_VENDOR_INFOFRAME + 9);
+	/* pb7: matadata type=0,len=8 */
+	for (i = 10; i <= 18; i++)
+		writeb(0x00, HDMI_VENDOR_INFOFRAME + i);
+
+	for (i = 0; i <= 18; i++)
+		if (i != 3)
+			sum += readb(HDMI_VENDOR_INFOFRAME + i);
+	sum &= 0xff;
+	writeb(sum ? 0x100 - sum : 0, HDMI_VENDOR_INFOFRAME + 3); /* pb0 */
+
+	/* packet config */
+	if (structure == HDMI_3D_STRUCTURE_NONE) {
+		writel(0x0000f321, HDMI_PACKET_CONFIG);
+		writel(0x0000000f, HDMI_PACKET_CONFIG + 4);
+	} else {
+		writel(0x00005321, HDMI_PACKET_CONFIG);
+		writel(0x0000000f, HDMI_PACKET_CONFIG + 4);
+	}
+}
+
+/*
+ * Select the 3D structure signalled for 2D timings. Only the infoframe
+ * changes, so when video is already configured the link is left running.
+ */
+__s32 hdmi_set_3d_structure(__s32 structure)
+{
+	__s32 vic_tab;
+
+	if (structure == video_3d_structure)
 		return 0;
 
-	timing = &video_timing[vic_tab];
-	vic = timing->VIC;
+	video_3d_structure = structure;
 
-	if ((vic == HDMI1440_480I) || (vic == HDMI1440_576I))
-		dw = 1; /* Double Width */
+	if (hdmi_state <= HDMI_State_Video_config)
+		return 0;
 
-	writel(0x00000000, HDMI_CTRL);
-	writel(0x00000000, HDMI_AUDIO_CTRL); /* disable audio output */
-	writel(0x00000000, HDMI_VIDEO_CTRL); /* disable video output */
-	/* interrupt mask and clear all interrupt */
-	writel(0xffffffff, HDMI_INT_CTRL);
+	vic_tab = get_video_info(video_mode);
+	if (vic_tab == -1)
+		return -1;
 
-	reg_val = 0x00000000;
-	if (dw)
-		reg_val |= 0x00000001; /* repetition */
-	if (timing->I)
-		reg_val |= 0x00000010; /* interlace */
-	writel(reg_val, HDMI_VIDEO_CTRL);
+	vendor_infoframe_config(video_timing[vic_tab].VIC);
+
+	return 0;
+}
+
+static void video_timing_regs_config(const struct __disp_video_timing *timing,
+				     __s32 dw)
+{
+	__s32 vic = timing->VIC;
+	__u32 reg_val;
 
 	/* active H */
 	writew((timing->INPUTX << dw) - 1, HDMI_VIDEO_H);
@@ -353,8 +455,11 @@ __s32 video_config(__s32 vic)
 	if (timing->VSYNC)
 		reg_val |= 0x02; /* Positive Vsync */
 	writew(reg_val, HDMI_VIDEO_POLARITY);
+}
 
-	writew(0x03e0, HDMI_TX_CLOCK); /* TX clock sequence */
+static void avi_infoframe_config(const struct __disp_video_timing *timing)
+{
+	__u32 reg_val;
 
 	/* avi packet */
 	writeb(0x82, HDMI_AVI_INFOFRAME);
@@ -415,62 +520,15 @@ __s32 video_config(__s32 vic)
 		reg_val = 0x100 - reg_val;
 
 	writeb(reg_val, HDMI_AVI_INFOFRAME + 3); /* checksum */
+}
 
-	/* gcp packet */
-	writel(0x00000003, HDMI_QCP_PACKET);
-	writel(0x00000000, HDMI_QCP_PACKET + 4);
-
-	/* vendor infoframe */
-	writeb(0x81, HDMI_VENDOR_INFOFRAME);
-	writeb(0x01, HDMI_VENDOR_INFOFRAME + 1);
-	writeb(6, HDMI_VENDOR_INFOFRAME + 2);	/* length */
-
-	writeb(0x29, HDMI_VENDOR_INFOFRAME + 3); /* pb0:checksum */
-	writeb(0x03, HDMI_VENDOR_INFOFRAME + 4); /* pb1-3:24bit ieee id */
-	writeb(0x0c, HDMI_VENDOR_INFOFRAME + 5);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 6);
-	writeb(0x40, HDMI_VENDOR_INFOFRAME + 7); /* pb4 */
-	/* pb5:3d meta not present, frame packing */
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 8);
-
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 9); /* pb6:extra data for 3d */
-	/* pb7: matadata type=0,len=8 */
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 10);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 11);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 12);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 13);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 14);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 15);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 16);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 17);
-	writeb(0x00, HDMI_VENDOR_INFOFRAME + 18);
-
-	/* packet config */
-	if ((vic != HDMI1080P_24_3D_FP) && (vic != HDMI720P_50_3D_FP) &&
-	    (vic != HDMI720P_60_3D_FP)) {
-		writel(0x0000f321, HDMI_PACKET_CONFIG);
-		writel(0x0000000f, HDMI_PACKET_CONFIG + 4);
-	} else {
-		writel(0x00005321, HDMI_PACKET_CONFIG);
-		writel(0x0000000f, HDMI_PACKET_CONFIG + 4);
-	}
-
-	writel(0x08000000, HDMI_UNKNOWN); /* set input sync enable */
-
-	if (audio_enable)
-		writeb(0xc0, HDMI_VIDEO_CTRL + 3); /* hdmi mode + hdmi audio */
-	else
-		writeb(0x80, HDMI_VIDEO_CTRL + 3); /* hdmi/dvi mode */
-	writel(0x80000000, HDMI_CTRL); /* start hdmi controller */
-
-	if (audio_enable)
-		writeb(0xc0, HDMI_VIDEO_CTRL + 3); /* hdmi mode + hdmi audio */
-	else
-		writeb(0x80, HDMI_VIDEO_CTRL + 3); /* hdmi/dvi mode */
-	writel(0x80000000, HDMI_CTRL); /* start hdmi controller */
+static void tx_clock_config(const struct __disp_video_timing *timing)
+{
+	__s32 clk_div;
 
 	/* hdmi pll setting */
-	if ((vic == HDMI1440_480I) || (vic == HDMI1440_576I)) {
+	if ((timing->VIC == HDMI1440_480I) ||
+	    (timing->VIC == HDMI1440_576I)) {
 		clk_div = hdmi_clk / timing->PCLK;
 		clk_div /= 2;
 	} else {
@@ -555,6 +613,95 @@ __s32 video_config(__s32 vic)
 		writel(1 << 21, HDMI_TX_DRIVER + 12);
 	else
 		writel(0 << 21, HDMI_TX_DRIVER + 12);
+}
+
+/*
+ * Reprogram the timing of a running link in place, for timings that keep
+ * the active size and scan type such as 1080p 50 -> 60 -> 24Hz. The
+ * controller, audio and the sink's lock on TMDS are left alone, only the
+ * blanking, infoframes and transmitter clock divider change.
+ */
+__s32 video_timing_update(void)
+{
+	const struct __disp_video_timing *timing;
+	__s32 vic_tab, dw = 0;
+
+	vic_tab = get_video_info(video_mode);
+	if (vic_tab == -1)
+		return -1;
+
+	timing = &video_timing[vic_tab];
+
+	__inf("video_timing_update, video_mode:%d\n", video_mode);
+
+	if ((timing->VIC == HDMI1440_480I) || (timing->VIC == HDMI1440_576I))
+		dw = 1; /* Double Width */
+
+	video_timing_regs_config(timing, dw);
+	avi_infoframe_config(timing);
+	vendor_infoframe_config(timing->VIC);
+	tx_clock_config(timing);
+
+	return 0;
+}
+
+__s32 video_config(__s32 vic)
+{
+	__s32 vic_tab, reg_val, dw = 0;
+	const struct __disp_video_timing *timing;
+
+	__inf("video_config, video_mode:%d\n", vic);
+
+	vic_tab = get_video_info(vic);
+	if (vic_tab == -1)
+		return 0;
+
+	timing = &video_timing[vic_tab];
+	vic = timing->VIC;
+
+	if ((vic == HDMI1440_480I) || (vic == HDMI1440_576I))
+		dw = 1; /* Double Width */
+
+	writel(0x00000000, HDMI_CTRL);
+	writel(0x00000000, HDMI_AUDIO_CTRL); /* disable audio output */
+	writel(0x00000000, HDMI_VIDEO_CTRL); /* disable video output */
+	/* interrupt mask and clear all interrupt */
+	writel(0xffffffff, HDMI_INT_CTRL);
+
+	reg_val = 0x00000000;
+	if (dw)
+		reg_val |= 0x00000001; /* repetition */
+	if (timing->I)
+		reg_val |= 0x00000010; /* interlace */
+	writel(reg_val, HDMI_VIDEO_CTRL);
+
+	video_timing_regs_config(timing, dw);
+
+	writew(0x03e0, HDMI_TX_CLOCK); /* TX clock sequence */
+
+	avi_infoframe_config(timing);
+
+	/* gcp packet */
+	writel(0x00000003, HDMI_QCP_PACKET);
+	writel(0x00000000, HDMI_QCP_PACKET + 4);
+
+	vendor_infoframe_config(vic);
+
+	writel(0x08000000, HDMI_UNKNOWN); /* set input sync enable */
+
+	if (audio_enable)
+		writeb(0xc0, HDMI_VIDEO_CTRL + 3); /* hdmi mode + hdmi audio */
+	else
+		writeb(0x80, HDMI_VIDEO_CTRL + 3); /* hdmi/dvi mode */
+	writel(0x80000000, HDMI_CTRL); /* start hdmi controller */
+
+	if (audio_enable)
+		writeb(0xc0, HDMI_VIDEO_CTRL + 3); /* hdmi mode + hdmi audio */
+	else
+		writeb(0x80, HDMI_VIDEO_CTRL + 3); /* hdmi/dvi mode */
+	writel(0x80000000, HDMI_CTRL); /* start hdmi controller */
+
+	tx_clock_config(timing);
 
 	return 0;
 }
@@ -580,6 +727,26 @@ __s32 audio_config(void)
 	if (i == -1)
 		return 0;
 
+	/*
+	 * IEC 61937 bursts need the non-LPCM flag and no word length in
+	 * the channel status. HBR is clocked as 8 channels at 192 kHz but
+	 * announced with the 768 kHz frequency code.
+	 */
+	if (audio_info.data_raw != HDMI_AUDIO_LPCM) {
+		audio_info.CH_STATUS0 |= 0x2;
+		audio_info.CH_STATUS1 = 0;
+	}
+	if (audio_info.data_raw == HDMI_AUDIO_HBR) {
+		if (audio_info.channel_num != 8 ||
+		    audio_info.sample_rate != 192000) {
+			__wrn("hbr needs 8ch at 192kHz, got %dch %d\n",
+			      audio_info.channel_num, audio_info.sample_rate);
+			return 0;
+		}
+		audio_info.CH_STATUS0 &= ~(0xf << 24);
+		audio_info.CH_STATUS0 |= (9 << 24);
+	}
+
 	if (audio_info.channel_num == 1) {
 		if (audio_info.sample_bit == 32) {
 			/* audio fifo rst and select ddma, 2 ch 32bit pcm */
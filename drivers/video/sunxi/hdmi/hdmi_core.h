@@ -34,6 +34,10 @@ extern void __iomem *hdmi_base;
 #define HDMI_State_Audio_config		0x07
 #define HDMI_State_Playback		0x09
 
+#define HPD_DEBOUNCE_SAMPLES		3
+#define HPD_DEBOUNCE_MS			20
+#define HPD_POLL_MS			250
+
 #define HDMI1440_480I		6
 #define HDMI1440_576I		21
 #define HDMI480P		2
@@ -50,6 +54,13 @@ extern void __iomem *hdmi_base;
 #define HDMI720P_50_3D_FP	(HDMI720P_50  + 0x80)
 #define HDMI720P_60_3D_FP	(HDMI720P_60  + 0x80)
 
+/* 3D_Structure of the HDMI vendor specific infoframe */
+#define HDMI_3D_STRUCTURE_NONE	-1
+#define HDMI_3D_STRUCTURE_FP	0x0
+#define HDMI_3D_STRUCTURE_SSF	0x3
+#define HDMI_3D_STRUCTURE_TB	0x6
+#define HDMI_3D_STRUCTURE_SSH	0x8
+
 /* Non CEA-861-D modes */
 #define HDMI_NON_CEA861D_START	256
 #define HDMI1360_768_60		(HDMI_NON_CEA861D_START + 0)
@@ -85,6 +96,7 @@ typedef struct audio_timing {
 	__s32 CH_STATUS0;
 	__s32 CH_STATUS1;
 	__u8  sample_bit;
+	__u8  data_raw;
 
 } HDMI_AUDIO_INFO;
 
@@ -96,8 +108,12 @@ __s32 hdmi_main_task_loop(void);
 __s32 Hpd_Check(void);
 __s32 ParseEDID(void);
 __s32 video_config(__s32 vic);
+__s32 video_timing_update(void);
 __s32 audio_config(void);
 __s32 get_video_info(__s32 vic);
+__s32 hdmi_hpd_debouncing(void);
+void hdmi_core_resume(void);
+__s32 hdmi_set_3d_structure(__s32 structure);
 
 extern __u32 hdmi_pll; /* 0: video pll 0; 1: video pll 1 */
 extern __u32 hdmi_clk;
@@ -110,6 +126,7 @@ extern __u8 Device_Support_VIC[HDMI_DEVICE_SUPPORT_VIC_SIZE];
 extern __bool video_enable;
 extern __s32 hdmi_state;
 extern __s32 video_mode;
+extern __s32 video_3d_structure;
 extern HDMI_AUDIO_INFO audio_info;
 
 extern struct __disp_video_timing video_timing[];
@@ -27,9 +27,10 @@
 #include "hdmi_cec.h"
 
 #define EDID_BLOCK_LENGTH	0x80
-#define EDID_MAX_BLOCKS		2
+#define EDID_MAX_BLOCKS		4
 
 #define DDC_ADDR 		0x50
+#define DDC_SEGMENT_ADDR	0x30
 #define DDC_RETRIES 		3
 
 /*
@@ -202,12 +203,22 @@ static __s32 ParseEDID_CEA861_extension_block(__u8 *EDID_Block)
 	return 1;
 }
 
+/*
+ * Read count blocks starting at block in one DDC transfer; they have to
+ * be in the same E-DDC segment of two blocks.
+ */
 static int probe_ddc_edid(struct i2c_adapter *adapter,
-		int block, unsigned char *buf)
+		int block, int count, unsigned char *buf)
 {
-	unsigned char start = block * EDID_BLOCK_LENGTH;
+	unsigned char segment = block >> 1;
+	unsigned char start = (block & 1) * EDID_BLOCK_LENGTH;
 	struct i2c_msg msgs[] = {
 		{
+			.addr	= DDC_SEGMENT_ADDR,
+			.flags	= 0,
+			.len	= 1,
+			.buf	= &segment,
+		}, {
 			.addr	= DDC_ADDR,
 			.flags	= 0,
 			.len	= 1,
@@ -215,36 +226,41 @@ static int probe_ddc_edid(struct i2c_adapter *adapter,
 		}, {
 			.addr	= DDC_ADDR,
 			.flags	= I2C_M_RD,
-			.len	= EDID_BLOCK_LENGTH,
-			.buf	= buf + start,
+			.len	= count * EDID_BLOCK_LENGTH,
+			.buf	= buf + block * EDID_BLOCK_LENGTH,
 		}
 	};
+	/* the segment pointer is only written for segments past 0 */
+	int first = segment ? 0 : 1;
 
-	/* !!! only 1 byte I2C address length used */
-	if (block >= 2)
-		return -EIO;
+	if (count < 1 || (block & 1) + count > 2)
+		return -EINVAL;
 
-	if (i2c_transfer(adapter, msgs, 2) == 2)
+	if (i2c_transfer(adapter, msgs + first, 3 - first) == 3 - first)
 		return 0;
 
 	return -EIO;
 }
 
-static int get_edid_block(int block, unsigned char *buf)
+static int get_edid_blocks(int block, int count, unsigned char *buf)
 {
-	int i;
+	int i, j;
 
 	for (i = 1; i <= DDC_RETRIES; i++) {
-		if (probe_ddc_edid(&sunxi_hdmi_i2c_adapter, block, buf)) {
+		if (probe_ddc_edid(&sunxi_hdmi_i2c_adapter, block, count,
+				   buf)) {
 			dev_warn(&sunxi_hdmi_i2c_adapter.dev,
 				 "unable to read EDID block %d, try %d/%d\n",
 				 block, i, DDC_RETRIES);
 			continue;
 		}
-		if (EDID_CheckSum(block, buf) != 0) {
+		for (j = block; j < block + count; j++)
+			if (EDID_CheckSum(j, buf) != 0)
+				break;
+		if (j < block + count) {
 			dev_warn(&sunxi_hdmi_i2c_adapter.dev,
 				 "EDID block %d checksum error, try %d/%d\n",
-				 block, i, DDC_RETRIES);
+				 j, i, DDC_RETRIES);
 			continue;
 		}
 		break;
@@ -252,6 +268,74 @@ static int get_edid_block(int block, unsigned char *buf)
 	return (i <= DDC_RETRIES) ? 0 : -EIO;
 }
 
+/*
+ * Sinks seen before, hashed on the checksum of their base block. An
+ * entry is only reused when the base block matches byte for byte and the
+ * checksums of its extension blocks, one byte each to read, still match;
+ * that way a TV power-cycle or an AVR input switch costs one block read.
+ */
+#define EDID_CACHE_SIZE		4
+
+static struct {
+	__u8 blocks;
+	__u8 data[EDID_BLOCK_LENGTH * EDID_MAX_BLOCKS];
+} edid_cache[EDID_CACHE_SIZE];
+
+static int edid_cache_lookup(unsigned char *buf, __u8 blocks)
+{
+	int slot = buf[EDID_BLOCK_LENGTH - 1] % EDID_CACHE_SIZE;
+	unsigned char sum, offset;
+	int i;
+
+	if (edid_cache[slot].blocks != blocks ||
+	    memcmp(edid_cache[slot].data, buf, EDID_BLOCK_LENGTH))
+		return -1;
+
+	for (i = 1; i < blocks; i++) {
+		unsigned char segment = i >> 1;
+		struct i2c_msg msgs[] = {
+			{
+				.addr	= DDC_SEGMENT_ADDR,
+				.flags	= 0,
+				.len	= 1,
+				.buf	= &segment,
+			}, {
+				.addr	= DDC_ADDR,
+				.flags	= 0,
+				.len	= 1,
+				.buf	= &offset,
+			}, {
+				.addr	= DDC_ADDR,
+				.flags	= I2C_M_RD,
+				.len	= 1,
+				.buf	= &sum,
+			}
+		};
+		int first = segment ? 0 : 1;
+
+		offset = (i & 1) * EDID_BLOCK_LENGTH + EDID_BLOCK_LENGTH - 1;
+		if (i2c_transfer(&sunxi_hdmi_i2c_adapter, msgs + first,
+				 3 - first) != 3 - first)
+			return -1;
+		if (sum !=
+		    edid_cache[slot].data[(i + 1) * EDID_BLOCK_LENGTH - 1])
+			return -1;
+	}
+
+	memcpy(buf + EDID_BLOCK_LENGTH, edid_cache[slot].data +
+	       EDID_BLOCK_LENGTH, (blocks - 1) * EDID_BLOCK_LENGTH);
+
+	return 0;
+}
+
+static void edid_cache_store(unsigned char *buf, __u8 blocks)
+{
+	int slot = buf[EDID_BLOCK_LENGTH - 1] % EDID_CACHE_SIZE;
+
+	edid_cache[slot].blocks = blocks;
+	memcpy(edid_cache[slot].data, buf, blocks * EDID_BLOCK_LENGTH);
+}
+
 /*
  * collect the EDID ucdata of segment 0
  */
@@ -268,7 +352,7 @@ __s32 ParseEDID(void)
 
 	__inf("ParseEDID\n");
 
-	if (get_edid_block(0, EDID_Buf) != 0)
+	if (get_edid_blocks(0, 1, EDID_Buf) != 0)
 		goto ret;
 
 	if (EDID_Header_Check(EDID_Buf) != 0)
@@ -281,11 +365,19 @@ __s32 ParseEDID(void)
 	if (BlockCount > EDID_MAX_BLOCKS)
 		BlockCount = EDID_MAX_BLOCKS;
 
-	for (i = 1; i < BlockCount; i++) {
-		if (get_edid_block(i, EDID_Buf) != 0) {
-			BlockCount = i;
-			break;
+	if (edid_cache_lookup(EDID_Buf, BlockCount) == 0) {
+		__inf("ParseEDID: extension blocks from cache\n");
+	} else {
+		/* the rest of each segment in one burst */
+		for (i = 1; i < BlockCount; i += 2 - (i & 1)) {
+			__u32 count = min_t(__u32, BlockCount - i, 2 - (i & 1));
+
+			if (get_edid_blocks(i, count, EDID_Buf) != 0) {
+				BlockCount = i;
+				break;
+			}
 		}
+		edid_cache_store(EDID_Buf, BlockCount);
 	}
 
 	crc_val = crc32(-1U, EDID_Buf, EDID_BLOCK_LENGTH * BlockCount);
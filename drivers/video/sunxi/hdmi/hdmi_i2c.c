@@ -34,6 +34,9 @@
 
 #define Command_Ok 0x11
 
+/* E-DDC segment pointer */
+#define DDC_SEGMENT_ADDR 0x30
+
 struct i2c_adapter sunxi_hdmi_i2c_adapter;
 
 static int init_connection(void __iomem *base_addr)
@@ -70,10 +73,9 @@ static int init_connection(void __iomem *base_addr)
 }
 
 static int do_command(void __iomem *base_addr,
-		int command, u8 address, u8 len, u8 chip_addr)
+		int command, u8 address, u8 len, u8 chip_addr, u8 block)
 {
 	__u32 begin_ms, end_ms;
-	u8 block = 0;
 
 	 /* set FIFO read */
 	writel(readl(HDMI_I2C_GENERAL) & 0xfffffeff,
@@ -113,19 +115,23 @@ static int do_command(void __iomem *base_addr,
 	return 0;
 }
 
+/*
+ * The FIFO holds 16 bytes, longer reads are split into back to back
+ * commands without re-initialising the connection in between.
+ */
 static int do_read(void __iomem *base_addr,
-		struct i2c_msg *msg, int command, u8 chip_addr)
+		struct i2c_msg *msg, int command, u8 chip_addr, u8 segment)
 {
 	int i = 0;
 	int err = 0;
-	u8 bufPos = 0;
+	int bufPos = 0;
 
 	while (bufPos < msg->len) {
-		u8 readLen = (msg->len > 16) ? 16 : msg->len;
+		u8 readLen = (msg->len - bufPos > 16) ? 16 : msg->len - bufPos;
 
 		err = do_command(base_addr, command,
 				msg->addr, readLen,
-				chip_addr);
+				chip_addr, segment);
 
 		if (err != 0)
 			return err;
@@ -145,6 +151,7 @@ static int hdmi_i2c_sunxi_xfer(struct i2c_adapter *adap,
 	int i = 0;
 	int err = 0;
 	u8 chip_addr = 0;
+	u8 segment = 0;
 	int command =  Implicit_Offset_Address_Read;
 	void __iomem *base_addr = (void __iomem *)adap->algo_data;
 
@@ -153,13 +160,20 @@ static int hdmi_i2c_sunxi_xfer(struct i2c_adapter *adap,
 
 	for (i = 0; i < num; i++) {
 		if (msgs[i].flags & I2C_M_RD) {
-			err = do_read(base_addr, &msgs[i], command, chip_addr);
+			err = do_read(base_addr, &msgs[i], command, chip_addr,
+				      segment);
+		} else if (msgs[i].addr == DDC_SEGMENT_ADDR) {
+			/* sent along with the next offset write */
+			segment = *msgs[i].buf;
+			command = Implicit_Offset_Address_E_DDC_Read;
 		} else {
-			command = Explicit_Offset_Address_Read;
+			command = segment ?
+				Explicit_Offset_Address_E_DDC_Read :
+				Explicit_Offset_Address_Read;
 			chip_addr = *msgs[i].buf;
 			err = do_command(base_addr, command,
 				msgs[i].addr, 0,
-				chip_addr);
+				chip_addr, segment);
 		}
 
 		pr_debug("%s msgs[i].addr:0x%X msgs[i].len:%i"
@@ -1,25 +1,111 @@
+/*
+ * 1-Wire bus master on a sunxi GPIO
+ *
+ * Only the parts of a time slot that have an upper bound are timed with
+ * the cpu held: the low pulse and the sample of a read slot with
+ * interrupts off, about 15us, and the low pulse of a write-0 slot with
+ * preemption off, which an interrupt may stretch from 60 to 120us
+ * without harm. The rest of each slot, the recovery and the reset pulse
+ * have no upper bound and sleep on hrtimers, so the cpu is free between
+ * the bits and interrupt latency stays within the 15us.
+ */
+
 #include <linux/device.h>
 #include <linux/module.h>
-#include <linux/w1-gpio.h>
-#include <linux/platform_device.h>
 #include <linux/gpio.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/interrupt.h>
 #include <plat/sys_config.h>
 
+#include "w1.h"
+#include "w1_int.h"
+
 static int gpio = -1;
 module_param(gpio, int, 0444);
 MODULE_PARM_DESC(gpio, "w1 gpio pin number");
 
-static struct platform_device *w1_device;
+/* standard speed slot timing, us */
+#define W1_SUNXI_LOW1		6	/* low pulse of a write-1 or read slot */
+#define W1_SUNXI_SAMPLE		9	/* from its release to the sample */
+#define W1_SUNXI_TAIL1		55	/* rest of the write-1 or read slot */
+#define W1_SUNXI_LOW0		60	/* low pulse of a write-0 slot */
+#define W1_SUNXI_TAIL0		10	/* recovery after it */
+#define W1_SUNXI_RESET		480	/* reset pulse */
+#define W1_SUNXI_PRESENCE	240	/* slaves answer within this after it */
+#define W1_SUNXI_RSTREC		480	/* reset release to the first slot */
+
+static struct w1_bus_master *w1_master;
+
+static inline void w1_sunxi_low(void)
+{
+	gpio_direction_output(gpio, 0);
+}
+
+static inline void w1_sunxi_release(void)
+{
+	gpio_direction_input(gpio);
+}
+
+static inline u8 w1_sunxi_level(void)
+{
+	return gpio_get_value(gpio) ? 1 : 0;
+}
+
+static u8 w1_sunxi_touch_bit(void *data, u8 bit)
+{
+	unsigned long flags;
+	u8 result = 0;
+
+	if (bit) {
+		local_irq_save(flags);
+		w1_sunxi_low();
+		udelay(W1_SUNXI_LOW1);
+		w1_sunxi_release();
+		udelay(W1_SUNXI_SAMPLE);
+		result = w1_sunxi_level();
+		local_irq_restore(flags);
+		usleep_range(W1_SUNXI_TAIL1, 2 * W1_SUNXI_TAIL1);
+	} else {
+		preempt_disable();
+		w1_sunxi_low();
+		udelay(W1_SUNXI_LOW0);
+		w1_sunxi_release();
+		preempt_enable();
+		usleep_range(W1_SUNXI_TAIL0, 2 * W1_SUNXI_TAIL0);
+	}
+
+	return result;
+}
+
+/* 0 if a slave answered with a presence pulse, 1 if not */
+static u8 w1_sunxi_reset_bus(void *data)
+{
+	u8 present = 0;
+	int i;
+
+	w1_sunxi_low();
+	usleep_range(W1_SUNXI_RESET, W1_SUNXI_RESET + 100);
+
+	/* look for the presence pulse instead of sampling at one point */
+	preempt_disable();
+	w1_sunxi_release();
+	for (i = 0; i < W1_SUNXI_PRESENCE && !present; i++) {
+		udelay(1);
+		present = !w1_sunxi_level();
+	}
+	preempt_enable();
+
+	usleep_range(W1_SUNXI_RSTREC, W1_SUNXI_RSTREC + 100);
+
+	return !present;
+}
 
 static int __init w1_sunxi_init(void)
 {
 	int ret = 0;
-	struct w1_gpio_platform_data w1_gpio_pdata = {
-		.pin = gpio,
-		.is_open_drain = 0,
-	};
 
-	if (!gpio_is_valid(w1_gpio_pdata.pin)) {
+	if (!gpio_is_valid(gpio)) {
 		ret =
 		    script_parser_fetch("w1_para", "gpio", &gpio, sizeof(int));
 		if (ret || !gpio_is_valid(gpio)) {
@@ -27,38 +113,43 @@ static int __init w1_sunxi_init(void)
 			       gpio);
 			return -EINVAL;
 		}
-		w1_gpio_pdata.pin = gpio;
 	}
 
-	w1_device = platform_device_alloc("w1-gpio", 0);
-	if (!w1_device)
+	w1_master = kzalloc(sizeof(*w1_master), GFP_KERNEL);
+	if (!w1_master)
 		return -ENOMEM;
 
-	ret =
-	    platform_device_add_data(w1_device, &w1_gpio_pdata,
-				     sizeof(struct w1_gpio_platform_data));
+	ret = gpio_request(gpio, "w1");
 	if (ret)
 		goto err;
+	w1_sunxi_release();
+
+	w1_master->touch_bit = w1_sunxi_touch_bit;
+	w1_master->reset_bus = w1_sunxi_reset_bus;
 
-	ret = platform_device_add(w1_device);
+	ret = w1_add_master_device(w1_master);
 	if (ret)
-		goto err;
+		goto err_gpio;
 
 	return 0;
 
+err_gpio:
+	gpio_free(gpio);
 err:
-	platform_device_put(w1_device);
+	kfree(w1_master);
 	return ret;
 }
 
 static void __exit w1_sunxi_exit(void)
 {
-	platform_device_unregister(w1_device);
+	w1_remove_master_device(w1_master);
+	gpio_free(gpio);
+	kfree(w1_master);
 }
 
 module_init(w1_sunxi_init);
 module_exit(w1_sunxi_exit);
 
-MODULE_DESCRIPTION("GPIO w1 sunxi platform device");
+MODULE_DESCRIPTION("GPIO w1 bus master for sunxi");
 MODULE_AUTHOR("Damien Nicolet <zardam@gmail.com>");
 MODULE_LICENSE("GPL");
@@ -24,6 +24,8 @@
 #include <linux/types.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/smp.h>
 #include <linux/buffer_head.h>
 
 #include "squashfs_fs.h"
@@ -58,6 +60,12 @@ static const struct squashfs_decompressor squashfs_zlib_comp_ops = {
 };
 #endif
 
+#ifndef CONFIG_SQUASHFS_LZ4
+static const struct squashfs_decompressor squashfs_lz4_comp_ops = {
+	NULL, NULL, NULL, LZ4_COMPRESSION, "lz4", 0
+};
+#endif
+
 static const struct squashfs_decompressor squashfs_unknown_comp_ops = {
 	NULL, NULL, NULL, 0, "unknown", 0
 };
@@ -67,6 +75,7 @@ static const struct squashfs_decompressor *decompressor[] = {
 	&squashfs_lzo_comp_ops,
 	&squashfs_xz_comp_ops,
 	&squashfs_lzma_unsupported_comp_ops,
+	&squashfs_lz4_comp_ops,
 	&squashfs_unknown_comp_ops
 };
 
@@ -83,11 +92,18 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
-void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
+/*
+ * Sets up one decompressor stream, or with percpu one for every
+ * possible cpu, so readers on different cpus don't wait for each
+ * other. The streams are indexed by cpu id.
+ */
+int squashfs_decompressor_init(struct super_block *sb, unsigned short flags,
+	int percpu)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
 	void *strm, *buffer = NULL;
-	int length = 0;
+	int length = 0, nr_streams = percpu ? nr_cpu_ids : 1;
+	int err = 0, i;
 
 	/*
 	 * Read decompressor specific options from file system if present
@@ -95,22 +111,87 @@ void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 	if (SQUASHFS_COMP_OPTS(flags)) {
 		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
 		if (buffer == NULL)
-			return ERR_PTR(-ENOMEM);
+			return -ENOMEM;
 
 		length = squashfs_read_data(sb, &buffer,
 			sizeof(struct squashfs_super_block), 0, NULL,
 			PAGE_CACHE_SIZE, 1);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
+			err = length;
 			goto finished;
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	msblk->stream = kcalloc(nr_streams, sizeof(*msblk->stream),
+		GFP_KERNEL);
+	if (msblk->stream == NULL) {
+		err = -ENOMEM;
+		goto finished;
+	}
+	msblk->nr_streams = nr_streams;
+
+	for (i = 0; i < nr_streams; i++) {
+		if (percpu && !cpu_possible(i))
+			continue;
+
+		strm = msblk->decompressor->init(msblk, buffer, length);
+		if (IS_ERR(strm)) {
+			err = PTR_ERR(strm);
+			squashfs_decompressor_destroy(msblk);
+			goto finished;
+		}
+		msblk->stream[i].stream = strm;
+		mutex_init(&msblk->stream[i].mutex);
+	}
+
+	TRACE("%d %s decompressor streams\n", percpu ? num_possible_cpus() :
+		1, msblk->decompressor->name);
 
 finished:
 	kfree(buffer);
 
-	return strm;
+	return err;
+}
+
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	int i;
+
+	if (msblk->stream == NULL)
+		return;
+
+	for (i = 0; i < msblk->nr_streams; i++)
+		if (msblk->stream[i].stream)
+			msblk->decompressor->free(msblk->stream[i].stream);
+
+	kfree(msblk->stream);
+	msblk->stream = NULL;
+	msblk->nr_streams = 0;
+}
+
+
+/*
+ * Takes the stream of the current cpu. Preemption stays enabled, the
+ * decompressors sleep in wait_on_buffer(), so a reader may run on
+ * another cpu by the time it is done; that only makes the next reader
+ * of its stream wait for the mutex.
+ */
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	struct squashfs_stream *stream = msblk->stream;
+	int res;
+
+	if (msblk->nr_streams > 1)
+		stream += raw_smp_processor_id();
+
+	mutex_lock(&stream->mutex);
+	res = msblk->decompressor->decompress(msblk, stream->stream, buffer,
+		bh, b, offset, length, srclength, pages);
+	mutex_unlock(&stream->mutex);
+
+	return res;
 }
@@ -39,8 +39,13 @@ typedef struct
 	__u8    just_pol;
 	__u8    channel_num;
 	__u8    sample_bit;
+	__u8    data_raw;       /* HDMI_AUDIO_LPCM/NONPCM/HBR */
 }hdmi_audio_t;
 
+#define HDMI_AUDIO_LPCM		0
+#define HDMI_AUDIO_NONPCM	1	/* IEC 61937, AC-3, DTS core */
+#define HDMI_AUDIO_HBR		2	/* IEC 61937 at 768 kHz, TrueHD, DTS-HD MA */
+
 typedef struct
 {
     __s32 (*hdmi_audio_enable)(__u8 mode, __u8 channel);
@@ -74,6 +74,10 @@ typedef enum {
 	G2D_FMT_2BPP_PALETTE	= (0x1F),
 	G2D_FMT_1BPP_PALETTE	= (0x20),
 
+	/* cedar MB32 tiled output, G2D_CMD_CONVERT source only */
+	G2D_FMT_PYUV420UVC_MB32	= (0x21),
+	G2D_FMT_PYUV422UVC_MB32	= (0x22),
+
 }g2d_data_fmt;
 
 /* pixel sequence in double word */
@@ -214,6 +218,61 @@ typedef struct {
 
 }g2d_palette;
 
+/* operation types for G2D_CMD_BATCH */
+typedef enum {
+	G2D_OP_BITBLT			=	0x0,
+	G2D_OP_FILLRECT			=	0x1,
+	G2D_OP_STRETCHBLT		=	0x2,
+	G2D_OP_CONVERT			=	0x3,
+}g2d_op_type;
+
+/*
+ * Format conversion and scaling of src_rect into dst_rect, e.g. NV12
+ * (G2D_FMT_PYUV420UVC) or cedar tiled output to ARGB8888. Tiled sources
+ * go through the display scaler's writeback, which writes whole lines:
+ * dst_rect must then span the width of dst_image and dst_image must be
+ * ARGB8888 or XRGB8888.
+ */
+typedef struct {
+	g2d_image			 src_image;
+	g2d_rect			 src_rect;
+
+	g2d_image			 dst_image;
+	g2d_rect			 dst_rect;
+
+}g2d_convert;
+
+typedef struct {
+	g2d_op_type		 type;
+	union {
+		g2d_blt			 blt;
+		g2d_fillrect	 fill;
+		g2d_stretchblt	 stretch;
+		g2d_convert		 convert;
+	}u;
+
+}g2d_op;
+
+typedef struct {
+	g2d_op			*ops;
+	__u32			 count;
+	__s32			 eventfd;	/* signalled when the batch is done, -1 for none */
+	__u32			 seq;		/* out: batch number for G2D_CMD_BATCH_WAIT */
+
+}g2d_batch;
+
+/*
+ * G2D_CMD_DMABUF_IMPORT: fd in; addr and size out. addr is the physical
+ * address to use in g2d_image.addr, the buffer stays pinned until
+ * G2D_CMD_DMABUF_RELEASE with that addr or until /dev/g2d is closed.
+ */
+typedef struct {
+	__s32			 fd;
+	__u32			 addr;
+	__u32			 size;
+
+}g2d_dmabuf;
+
 #endif /*__G2D_BSP_DRV_H*/
 
 typedef enum
@@ -222,6 +281,11 @@ typedef enum
 	G2D_CMD_FILLRECT		=	0x51,
 	G2D_CMD_STRETCHBLT		=	0x52,
 	G2D_CMD_PALETTE_TBL		=	0x53,
+	G2D_CMD_BATCH			=	0x54,
+	G2D_CMD_BATCH_WAIT		=	0x55,
+	G2D_CMD_DMABUF_IMPORT	=	0x56,
+	G2D_CMD_DMABUF_RELEASE	=	0x57,
+	G2D_CMD_CONVERT			=	0x58,
 
 	G2D_CMD_MEM_REQUEST		=	0x59,
 	G2D_CMD_MEM_RELEASE		=	0x5A,
@@ -229,5 +293,15 @@ typedef enum
 	G2D_CMD_MEM_SELIDX		=	0x5C,
 }g2d_cmd;
 
+#ifdef __KERNEL__
+/* for other drivers, -EBUSY means the op has to be done by the cpu */
+int g2d_kernel_fill(g2d_fillrect *para);
+int g2d_kernel_blit(g2d_blt *para);
+/* may sleep */
+int g2d_kernel_convert(g2d_convert *para);
+/* for the display driver, whose scaler can read tiled sources */
+void g2d_set_tiled_convert(int (*func)(g2d_convert *para));
+#endif
+
 #endif	/* __G2D_DRIVER_H */
 
@@ -159,6 +159,17 @@ extern void (*late_time_init)(void);
 
 extern bool initcall_debug;
 
+/* Defined in init/boot_times.c */
+#ifdef CONFIG_DEBUG_FS
+extern __printf(4, 5)
+void boot_time_record(char kind, unsigned long long usecs, int ret,
+		      const char *fmt, ...);
+#else
+static inline __printf(4, 5)
+void boot_time_record(char kind, unsigned long long usecs, int ret,
+		      const char *fmt, ...) { }
+#endif
+
 #endif
   
 #ifndef MODULE
@@ -0,0 +1,55 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ *  LZ4 Kernel Interface
+ *
+ *  Compression and decompression of the LZ4 block format, as used
+ *  inside the frames of the reference lz4 tool: a token with the
+ *  literal and match lengths, the literals, and a 16 bit little
+ *  endian match offset.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#define LZ4_MEM_COMPRESS	(4096 * sizeof(u32))
+
+/*
+ * Worst case output of lz4_compress() for an input of isize bytes,
+ * the size dst must have.
+ */
+static inline size_t lz4_compressbound(size_t isize)
+{
+	return isize + (isize / 255) + 16;
+}
+
+/*
+ * lz4_compress()
+ *	src	: source address of the data
+ *	src_len	: size of the data to be compressed
+ *	dst	: output buffer, lz4_compressbound(src_len) bytes
+ *	dst_len	: is set to the size of the compressed data
+ *	wrkmem	: LZ4_MEM_COMPRESS bytes of scratch memory
+ *
+ *	Returns 0 on success.
+ */
+int lz4_compress(const unsigned char *src, size_t src_len,
+		 unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * lz4_decompress_unknownoutputsize()
+ *	src	: source address of the compressed data
+ *	src_len	: size of the compressed data
+ *	dest	: output buffer
+ *	dest_len: size of dest on entry, size of the decompressed data
+ *		  on return
+ *
+ *	Never reads outside src nor writes outside dest. Returns 0 on
+ *	success and a negative value if the data is malformed or does
+ *	not fit.
+ */
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+				     unsigned char *dest, size_t *dest_len);
+
+#endif
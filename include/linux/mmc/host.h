@@ -239,6 +239,7 @@ struct mmc_host {
 #define MMC_CAP2_BROKEN_VOLTAGE	(1 << 7)	/* Use the broken voltage */
 #define MMC_CAP2_DETECT_ON_ERR	(1 << 8)	/* On I/O err check card removal */
 #define MMC_CAP2_HC_ERASE_SZ	(1 << 9)	/* High-capacity erase size */
+#define MMC_CAP2_SDIO_IRQ_NOTHREAD (1 << 10)	/* Host runs sdio_run_irqs() */
 
 	mmc_pm_flag_t		pm_caps;	/* supported pm features */
 	unsigned int        power_notify_type;
@@ -385,6 +386,7 @@ extern void mmc_request_done(struct mmc_host *, struct mmc_request *);
 
 extern int mmc_cache_ctrl(struct mmc_host *, u8);
 
+/* not for MMC_CAP2_SDIO_IRQ_NOTHREAD hosts, they call sdio_run_irqs() */
 static inline void mmc_signal_sdio_irq(struct mmc_host *host)
 {
 	host->ops->enable_sdio_irq(host, 0);
@@ -392,6 +394,8 @@ static inline void mmc_signal_sdio_irq(struct mmc_host *host)
 	wake_up_process(host->sdio_irq_thread);
 }
 
+extern void sdio_run_irqs(struct mmc_host *host);
+
 struct regulator;
 
 #ifdef CONFIG_REGULATOR
@@ -101,6 +101,19 @@ typedef struct _boot_dram_para_t
 	unsigned int	dram_emr2;
 	unsigned int	dram_emr3;
 }standy_dram_para_t;
+
+/*
+ * dram training result of the last full init in standby, handed back
+ * to the kernel and passed in again next time so that resume can skip
+ * the zq calibration and the read pipe scan.
+ */
+struct aw_dram_cal{
+	unsigned int	valid;      /**<filled by a full init with dram_para */
+	unsigned int	fast;       /**<set by standby, the cache was used    */
+	unsigned int	zq;         /**<SDR_ZQSR                              */
+	unsigned int	rslr0;      /**<SDR_RSLR0                             */
+	unsigned int	rdqsgr;     /**<SDR_RDQSGR                            */
+};
 #endif
 
 /**
@@ -127,6 +140,8 @@ struct aw_pm_info{
     struct aw_pmu_arg       pmu_arg;        /**<args used by main function  */
 #ifdef CONFIG_ARCH_SUN7I
 	standy_dram_para_t	dram_para;
+	struct aw_dram_cal	dram_cal;
+	unsigned int		dram_freq;	/**<not 0: only re-init the dram at dram_para, no standby */
 #endif
 };
 
@@ -0,0 +1,25 @@
+/*
+ * include/linux/sunxi_dramfreq.h
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * What the display driver tells the dram clock scaling of sun7i: its
+ * vblanks, at which a switch may start, and the scanout bandwidth of
+ * both screens in KB/s, below which the clock must not go.
+ */
+
+#ifndef __SUNXI_DRAMFREQ_H__
+#define __SUNXI_DRAMFREQ_H__
+
+#ifdef CONFIG_SUN7I_DRAMFREQ
+extern void sunxi_dramfreq_vblank(int sel);
+extern void sunxi_dramfreq_scanout(unsigned int kbps);
+#else
+static inline void sunxi_dramfreq_vblank(int sel) { }
+static inline void sunxi_dramfreq_scanout(unsigned int kbps) { }
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * include/linux/sunxi_ion.h
+ *
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+
+#ifndef _LINUX_SUNXI_ION_H
+#define _LINUX_SUNXI_ION_H
+
+/*
+ * Heaps of the sunxi ion device. ion tries the highest id of a mask
+ * first, so a mask of SCANOUT and VE only falls back to the VE window
+ * when the rest of the contiguous memory is used up.
+ *
+ * SYSTEM	pages from anywhere, for the mali and the cpu
+ * VE		contiguous and inside the first 256MB of dram, which is
+ *		all the VE reaches; cedar frames and bitstreams
+ * SCANOUT	contiguous anywhere, for disp layers and g2d surfaces
+ *
+ * Without CMA there is no separate scanout heap, the VE window is a
+ * carveout set aside at boot (sunxi_ion_mem_reserve=, in MB).
+ */
+enum sunxi_ion_heap_id {
+	SUNXI_ION_HEAP_SYSTEM = 0,
+	SUNXI_ION_HEAP_VE,
+	SUNXI_ION_HEAP_SCANOUT,
+};
+
+#define SUNXI_ION_HEAP_SYSTEM_MASK	(1 << SUNXI_ION_HEAP_SYSTEM)
+#define SUNXI_ION_HEAP_VE_MASK		(1 << SUNXI_ION_HEAP_VE)
+#define SUNXI_ION_HEAP_SCANOUT_MASK	(1 << SUNXI_ION_HEAP_SCANOUT)
+#define SUNXI_ION_HEAP_CONTIG_MASK	(SUNXI_ION_HEAP_VE_MASK | \
+					 SUNXI_ION_HEAP_SCANOUT_MASK)
+
+#ifdef __KERNEL__
+struct ion_client;
+
+/* a client of the sunxi ion device for in-kernel users */
+extern struct ion_client *sunxi_ion_client_create(const char *name);
+#endif
+
+#endif /* _LINUX_SUNXI_ION_H */
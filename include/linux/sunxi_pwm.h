@@ -0,0 +1,31 @@
+/*
+ * include/linux/sunxi_pwm.h
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * Waveform mode of pwm-sunxi: the duty of a channel follows a stream
+ * of samples from a ring buffer, one sample per 1/rate seconds. A
+ * sample is the number of active cycles out of the cycles of the
+ * carrier period given to sunxi_pwm_wave_start().
+ */
+
+#ifndef __SUNXI_PWM_H__
+#define __SUNXI_PWM_H__
+
+#include <linux/types.h>
+
+struct pwm_device;
+
+int sunxi_pwm_wave_start(struct pwm_device *pwm, unsigned int rate,
+			 unsigned int cycles);
+void sunxi_pwm_wave_stop(struct pwm_device *pwm);
+
+/* queue up to count samples, returns how many fit in the ring */
+unsigned int sunxi_pwm_wave_queue(struct pwm_device *pwm, const u16 *samples,
+				  unsigned int count);
+unsigned int sunxi_pwm_wave_space(struct pwm_device *pwm);
+
+#endif
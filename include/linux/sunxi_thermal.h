@@ -0,0 +1,20 @@
+/*
+ * include/linux/sunxi_thermal.h
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * The cooling devices of sunxi. The SoC zone of sun4i-ts binds the
+ * ones of these types to its passive trip.
+ */
+
+#ifndef __SUNXI_THERMAL_H__
+#define __SUNXI_THERMAL_H__
+
+#define SUNXI_COOLING_CPU	"sunxi-cpufreq"
+#define SUNXI_COOLING_GPU	"sunxi-mali"
+#define SUNXI_COOLING_VE	"sunxi-ve"
+
+#endif
@@ -0,0 +1,85 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cedar
+
+#if !defined(_TRACE_CEDAR_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CEDAR_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * IOCTL_ENGINE_REQ and IOCTL_ENGINE_REL. The task id is -1 without the
+ * engine task scheduler, where a request just takes a VE reference.
+ */
+DECLARE_EVENT_CLASS(cedar_engine,
+
+	TP_PROTO(int task_id, long ret),
+
+	TP_ARGS(task_id, ret),
+
+	TP_STRUCT__entry(
+		__field(int, task_id)
+		__field(long, ret)
+	),
+
+	TP_fast_assign(
+		__entry->task_id = task_id;
+		__entry->ret = ret;
+	),
+
+	TP_printk("task=%d ret=%ld", __entry->task_id, __entry->ret)
+);
+
+DEFINE_EVENT(cedar_engine, cedar_engine_req,
+
+	TP_PROTO(int task_id, long ret),
+
+	TP_ARGS(task_id, ret)
+);
+
+DEFINE_EVENT(cedar_engine, cedar_engine_rel,
+
+	TP_PROTO(int task_id, long ret),
+
+	TP_ARGS(task_id, ret)
+);
+
+/* IOCTL_WAIT_VE starts waiting for the VE irq, timeout in seconds */
+TRACE_EVENT(cedar_wait_ve,
+
+	TP_PROTO(int timeout),
+
+	TP_ARGS(timeout),
+
+	TP_STRUCT__entry(
+		__field(int, timeout)
+	),
+
+	TP_fast_assign(
+		__entry->timeout = timeout;
+	),
+
+	TP_printk("timeout=%ds", __entry->timeout)
+);
+
+/* IOCTL_WAIT_VE returns, 1 for the irq and 0 for a timeout */
+TRACE_EVENT(cedar_wait_ve_done,
+
+	TP_PROTO(long ret),
+
+	TP_ARGS(ret),
+
+	TP_STRUCT__entry(
+		__field(long, ret)
+	),
+
+	TP_fast_assign(
+		__entry->ret = ret;
+	),
+
+	TP_printk("ret=%ld", __entry->ret)
+);
+
+#endif /* _TRACE_CEDAR_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,58 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM g2d
+
+#if !defined(_TRACE_G2D_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_G2D_H
+
+#include <linux/tracepoint.h>
+
+/* A blit goes to the mixer, after clipping to the images */
+TRACE_EVENT(g2d_blit,
+
+	TP_PROTO(u32 flag, u32 src_format, u32 dst_format, u32 w, u32 h),
+
+	TP_ARGS(flag, src_format, dst_format, w, h),
+
+	TP_STRUCT__entry(
+		__field(u32, flag)
+		__field(u32, src_format)
+		__field(u32, dst_format)
+		__field(u32, w)
+		__field(u32, h)
+	),
+
+	TP_fast_assign(
+		__entry->flag = flag;
+		__entry->src_format = src_format;
+		__entry->dst_format = dst_format;
+		__entry->w = w;
+		__entry->h = h;
+	),
+
+	TP_printk("flag=0x%x src_fmt=0x%x dst_fmt=0x%x %ux%u",
+		  __entry->flag, __entry->src_format, __entry->dst_format,
+		  __entry->w, __entry->h)
+);
+
+/* The mixer finished the blit, or the wait for it timed out */
+TRACE_EVENT(g2d_blit_done,
+
+	TP_PROTO(int ret),
+
+	TP_ARGS(ret),
+
+	TP_STRUCT__entry(
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->ret = ret;
+	),
+
+	TP_printk("ret=%d", __entry->ret)
+);
+
+#endif /* _TRACE_G2D_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,44 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sunxi_disp
+
+#if !defined(_TRACE_SUNXI_DISP_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SUNXI_DISP_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * A video layer at vblank, once the frame for the next scanout is set.
+ * shown counts the vblanks the frame has been on screen, more than one
+ * for a progressive frame means the next one came late.
+ */
+TRACE_EVENT(sunxi_disp_video_vblank,
+
+	TP_PROTO(u32 sel, u32 layer, s32 frame_id, u32 shown, u32 queued),
+
+	TP_ARGS(sel, layer, frame_id, shown, queued),
+
+	TP_STRUCT__entry(
+		__field(u32, sel)
+		__field(u32, layer)
+		__field(s32, frame_id)
+		__field(u32, shown)
+		__field(u32, queued)
+	),
+
+	TP_fast_assign(
+		__entry->sel = sel;
+		__entry->layer = layer;
+		__entry->frame_id = frame_id;
+		__entry->shown = shown;
+		__entry->queued = queued;
+	),
+
+	TP_printk("sel=%u layer=%u frame=%d shown=%u queued=%u",
+		  __entry->sel, __entry->layer, __entry->frame_id,
+		  __entry->shown, __entry->queued)
+);
+
+#endif /* _TRACE_SUNXI_DISP_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,72 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sunxi_dma
+
+#if !defined(_TRACE_SUNXI_DMA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SUNXI_DMA_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * A buf is queued on a channel. queued counts the bufs in the ring
+ * after it, the one the channel runs is not among them.
+ */
+TRACE_EVENT(sunxi_dma_enqueue,
+
+	TP_PROTO(u32 chan, const char *owner, u32 src, u32 dst, u32 bytes,
+		 u32 queued),
+
+	TP_ARGS(chan, owner, src, dst, bytes, queued),
+
+	TP_STRUCT__entry(
+		__field(u32, chan)
+		__string(owner, owner)
+		__field(u32, src)
+		__field(u32, dst)
+		__field(u32, bytes)
+		__field(u32, queued)
+	),
+
+	TP_fast_assign(
+		__entry->chan = chan;
+		__assign_str(owner, owner);
+		__entry->src = src;
+		__entry->dst = dst;
+		__entry->bytes = bytes;
+		__entry->queued = queued;
+	),
+
+	TP_printk("chan=%u owner=%s src=0x%08x dst=0x%08x bytes=%u queued=%u",
+		  __entry->chan, __get_str(owner), __entry->src, __entry->dst,
+		  __entry->bytes, __entry->queued)
+);
+
+/* The full done irq of a channel, before its callback runs */
+TRACE_EVENT(sunxi_dma_irq_fd,
+
+	TP_PROTO(u32 chan, const char *owner, int conti, u32 queued),
+
+	TP_ARGS(chan, owner, conti, queued),
+
+	TP_STRUCT__entry(
+		__field(u32, chan)
+		__string(owner, owner)
+		__field(int, conti)
+		__field(u32, queued)
+	),
+
+	TP_fast_assign(
+		__entry->chan = chan;
+		__assign_str(owner, owner);
+		__entry->conti = conti;
+		__entry->queued = queued;
+	),
+
+	TP_printk("chan=%u owner=%s conti=%d queued=%u",
+		  __entry->chan, __get_str(owner), __entry->conti,
+		  __entry->queued)
+);
+
+#endif /* _TRACE_SUNXI_DMA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
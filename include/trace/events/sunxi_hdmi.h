@@ -0,0 +1,46 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sunxi_hdmi
+
+#if !defined(_TRACE_SUNXI_HDMI_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SUNXI_HDMI_H
+
+#include <linux/tracepoint.h>
+
+#define show_hdmi_state(state)						\
+	__print_symbolic(state,						\
+		{ 0x02, "wait_hpd" },					\
+		{ 0x03, "rx_sense" },					\
+		{ 0x04, "edid_parse" },					\
+		{ 0x05, "wait_video_config" },				\
+		{ 0x06, "video_config" },				\
+		{ 0x07, "audio_config" },				\
+		{ 0x09, "playback" })
+
+/* The state machine of the main loop moved on */
+TRACE_EVENT(sunxi_hdmi_state,
+
+	TP_PROTO(int old_state, int new_state, int hpd),
+
+	TP_ARGS(old_state, new_state, hpd),
+
+	TP_STRUCT__entry(
+		__field(int, old_state)
+		__field(int, new_state)
+		__field(int, hpd)
+	),
+
+	TP_fast_assign(
+		__entry->old_state = old_state;
+		__entry->new_state = new_state;
+		__entry->hpd = hpd;
+	),
+
+	TP_printk("%s -> %s hpd=%d",
+		  show_hdmi_state(__entry->old_state),
+		  show_hdmi_state(__entry->new_state), __entry->hpd)
+);
+
+#endif /* _TRACE_SUNXI_HDMI_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,75 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sunxi_mmc
+
+#if !defined(_TRACE_SUNXI_MMC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SUNXI_MMC_H
+
+#include <linux/tracepoint.h>
+
+/* A request reaches the host, its data is mapped and the command sent */
+TRACE_EVENT(sunxi_mci_request,
+
+	TP_PROTO(int host, u32 opcode, u32 arg, u32 blocks, u32 blksz,
+		 int write),
+
+	TP_ARGS(host, opcode, arg, blocks, blksz, write),
+
+	TP_STRUCT__entry(
+		__field(int, host)
+		__field(u32, opcode)
+		__field(u32, arg)
+		__field(u32, blocks)
+		__field(u32, blksz)
+		__field(int, write)
+	),
+
+	TP_fast_assign(
+		__entry->host = host;
+		__entry->opcode = opcode;
+		__entry->arg = arg;
+		__entry->blocks = blocks;
+		__entry->blksz = blksz;
+		__entry->write = write;
+	),
+
+	TP_printk("host=%d cmd=%u arg=0x%08x blocks=%u blksz=%u %s",
+		  __entry->host, __entry->opcode, __entry->arg,
+		  __entry->blocks, __entry->blksz,
+		  __entry->write ? "write" : "read")
+);
+
+/* The request is handed back to the core, from the irq or polled */
+TRACE_EVENT(sunxi_mci_finalize,
+
+	TP_PROTO(int host, u32 opcode, int error, u32 int_sum, u32 bytes,
+		 int polled),
+
+	TP_ARGS(host, opcode, error, int_sum, bytes, polled),
+
+	TP_STRUCT__entry(
+		__field(int, host)
+		__field(u32, opcode)
+		__field(int, error)
+		__field(u32, int_sum)
+		__field(u32, bytes)
+		__field(int, polled)
+	),
+
+	TP_fast_assign(
+		__entry->host = host;
+		__entry->opcode = opcode;
+		__entry->error = error;
+		__entry->int_sum = int_sum;
+		__entry->bytes = bytes;
+		__entry->polled = polled;
+	),
+
+	TP_printk("host=%d cmd=%u error=%d int_sum=0x%08x bytes=%u polled=%d",
+		  __entry->host, __entry->opcode, __entry->error,
+		  __entry->int_sum, __entry->bytes, __entry->polled)
+);
+
+#endif /* _TRACE_SUNXI_MMC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
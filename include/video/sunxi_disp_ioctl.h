@@ -24,7 +24,7 @@
 
 /* for tracking the ioctls API/ABI */
 #define SUNXI_DISP_VERSION_MAJOR 1
-#define SUNXI_DISP_VERSION_MINOR 0
+#define SUNXI_DISP_VERSION_MINOR 8
 
 #define SUNXI_DISP_VERSION ((SUNXI_DISP_VERSION_MAJOR << 16) | SUNXI_DISP_VERSION_MINOR)
 #define SUNXI_DISP_VERSION_MAJOR_GET(x) (((x) >> 16) & 0x7FFF)
@@ -398,6 +398,102 @@ typedef struct {
 	__bool pre_frame_enable;
 } __disp_dit_info_t;
 
+/*
+ * DISP_CMD_VIDEO_SET_DIT_MODE. In kernel mode the driver shows each
+ * interlaced frame for exactly its two fields, uses the previous frame
+ * as the deinterlacer reference and keeps that frame's release event
+ * pending until it is no longer read; pre_frame_valid is ignored.
+ */
+typedef enum {
+	DISP_VIDEO_DIT_USER = 0,
+	DISP_VIDEO_DIT_KERNEL = 1,
+} __disp_video_dit_mode_t;
+
+/*
+ * DISP_CMD_VIDEO_QUEUE_FB entry. The frame is shown at the first vblank
+ * at or after pts (CLOCK_MONOTONIC nanoseconds, 0 means the next vblank).
+ * If release_fd is an eventfd it is signalled once the frame has been
+ * replaced on screen or dropped, after which the buffer may be reused.
+ */
+#define DISP_VIDEO_QUEUE_LEN 4
+
+typedef struct {
+	__disp_video_fb_t fb;
+	__u64 pts;
+	__s32 release_fd; /* eventfd, or -1 */
+} __disp_video_queue_fb_t;
+
+/*
+ * Record returned by read() on /dev/disp, one per screen that had a
+ * vblank since the last read. frame counts every vblank of that screen,
+ * so a gap means vblanks were missed; timestamp is CLOCK_MONOTONIC
+ * nanoseconds taken in the vblank interrupt.
+ */
+typedef struct {
+	__u32 sel;
+	__u32 frame;
+	__u64 timestamp;
+} __disp_vsync_event_t;
+
+/*
+ * DISP_CMD_DMABUF_IMPORT (arg[1] points to it; arg[0] is the screen as
+ * for every disp command): fd in; addr and size out. addr is the physical
+ * address to use in __disp_fb_t/__disp_video_fb_t; the buffer stays
+ * pinned until DISP_CMD_DMABUF_RELEASE with that addr or until
+ * /dev/disp is closed.
+ */
+typedef struct {
+	__s32 fd;
+	__u32 addr;
+	__u32 size;
+} __disp_dmabuf_import_t;
+
+/* FBIOGET_DMABUF: flags (O_CLOEXEC) in, dma-buf fd of the fb memory out */
+typedef struct {
+	__s32 fd;
+	__u32 flags;
+} __disp_fb_dmabuf_export_t;
+
+/*
+ * One entry of a DISP_CMD_LAYER_COMMIT batch. Only the members selected
+ * in flags are applied; the entries are applied in array order and are
+ * latched to the hardware together at the next vblank.
+ */
+#define DISP_COMMIT_MAX_LAYERS 8
+
+typedef enum {
+	DISP_COMMIT_OPEN = 0x01,
+	DISP_COMMIT_CLOSE = 0x02,
+	DISP_COMMIT_PARA = 0x04,
+	DISP_COMMIT_FB = 0x08,
+	DISP_COMMIT_SRC_WIN = 0x10,
+	DISP_COMMIT_SCN_WIN = 0x20,
+	DISP_COMMIT_VIDEO_FB = 0x40,
+} __disp_commit_flags_t;
+
+#define DISP_COMMIT_ALL_FLAGS 0x7f
+
+typedef struct {
+	__u32 hid;
+	__u32 flags; /* mask of __disp_commit_flags_t */
+	__disp_layer_info_t para;
+	__disp_fb_t fb;
+	__disp_rect_t src_win;
+	__disp_rect_t scn_win;
+	__disp_video_fb_t video_fb;
+} __disp_layer_commit_t;
+
+/*
+ * 3D setup of a scaler mode layer. On HDMI out_mode is one of TB, FP,
+ * SSF or SSH; FP switches the output to the matching _3D_FP tv mode.
+ */
+typedef struct {
+	__bool enable;
+	__disp_3d_src_mode_t src_mode;
+	__disp_3d_out_mode_t out_mode;
+	__u32 right_addr[3]; /* right eye, for DISP_3D_SRC_MODE_FP */
+} __disp_layer_3d_t;
+
 typedef struct {
 	__disp_hwc_mode_t pat_mode;
 	__u32 addr;
@@ -426,6 +522,39 @@ typedef struct {
 	__disp_fb_t output_fb;
 } __disp_capture_screen_para_t;
 
+/*
+ * DISP_CMD_CAPTURE_RING_START (arg[0] screen, arg[1] points to it):
+ * capture the composited screen every interval-th vblank into a ring of
+ * count buffers. addr[] are the physical addresses of the buffers, e.g.
+ * of DISP_CMD_DMABUF_IMPORT; output_fb gives format, mode and scaled
+ * size, its addr[] are the offsets of the planes into each buffer.
+ */
+#define DISP_CAPTURE_RING_MAX 4
+
+typedef struct {
+	__u32 count;
+	__u32 addr[DISP_CAPTURE_RING_MAX];
+	__u32 interval;
+	__disp_rectsz_t screen_size; /* as in __disp_capture_screen_para_t */
+	__disp_fb_t output_fb;
+} __disp_capture_ring_t;
+
+/*
+ * DISP_CMD_CAPTURE_RING_DQBUF (arg[1] points to it) returns the oldest
+ * filled buffer, blocking unless /dev/disp is O_NONBLOCK; poll() gives
+ * POLLPRI while one is ready. The buffer is not written again until it
+ * is handed back with DISP_CMD_CAPTURE_RING_QBUF (arg[1] index). frame
+ * and timestamp are those of the vblank the capture started at, as in
+ * __disp_vsync_event_t; dropped counts captures skipped so far because
+ * no buffer or scaler was free.
+ */
+typedef struct {
+	__u32 index;
+	__u32 frame;
+	__u64 timestamp;
+	__u32 dropped;
+} __disp_capture_frame_t;
+
 struct __disp_video_timing {
 	__s32 VIC;
 	__s32 PCLK;
@@ -458,6 +587,7 @@ typedef struct {
 				struct __disp_video_timing *video_timing);
 	__s32(*hdmi_get_HPD_status) (void);
 	__s32(*hdmi_set_pll) (__u32 pll, __u32 clk);
+	__s32(*hdmi_set_3d_mode) (__disp_3d_out_mode_t mode, __bool enable);
 } __disp_hdmi_func;
 
 typedef struct {
@@ -694,6 +824,15 @@ typedef enum tag_DISP_CMD {
 	DISP_CMD_DRC_SET_WINDOW = 0x28,
 	DISP_CMD_DRC_ON = 0x29,
 	DISP_CMD_GET_DE_FLICKER_EN = 0x2a,
+	/* returns KB/s fetched by the opened layers of a screen */
+	DISP_CMD_GET_BANDWIDTH = 0x2b,
+	/* returns the scanout budget over both screens in KB/s, 0: none */
+	DISP_CMD_GET_BANDWIDTH_BUDGET = 0x2c,
+	/* writeback capture ring, see __disp_capture_ring_t */
+	DISP_CMD_CAPTURE_RING_START = 0x2d,
+	DISP_CMD_CAPTURE_RING_STOP = 0x2e,
+	DISP_CMD_CAPTURE_RING_DQBUF = 0x2f,
+	DISP_CMD_CAPTURE_RING_QBUF = 0x30,
 
 	/* ----layer---- */
 	DISP_CMD_LAYER_REQUEST = 0x40,
@@ -745,6 +884,11 @@ typedef enum tag_DISP_CMD {
 	DISP_CMD_LAYER_GET_WHITE_EXTEN_LEVEL = 0x6f,
 	DISP_CMD_LAYER_SET_BLACK_EXTEN_LEVEL = 0x70,
 	DISP_CMD_LAYER_GET_BLACK_EXTEN_LEVEL = 0x71,
+	DISP_CMD_LAYER_COMMIT = 0x72,
+	/* arg: sel, hid, x, y by value; moves the layer, keeps its size */
+	DISP_CMD_LAYER_SET_POS = 0x73,
+	/* arg: sel, hid, __disp_layer_3d_t */
+	DISP_CMD_LAYER_SET_3D = 0x74,
 
 	/* ----scaler---- */
 	DISP_CMD_SCALER_REQUEST = 0x80,
@@ -765,6 +909,12 @@ typedef enum tag_DISP_CMD {
 	DISP_CMD_VIDEO_SET_FB = 0x102,
 	DISP_CMD_VIDEO_GET_FRAME_ID = 0x103,
 	DISP_CMD_VIDEO_GET_DIT_INFO = 0x104,
+	DISP_CMD_VIDEO_QUEUE_FB = 0x105,
+	DISP_CMD_VIDEO_SET_DIT_MODE = 0x106,
+
+	/* ----dma-buf---- */
+	DISP_CMD_DMABUF_IMPORT = 0x110,
+	DISP_CMD_DMABUF_RELEASE = 0x111,
 
 	/* ----lcd---- */
 	DISP_CMD_LCD_ON = 0x140,
@@ -776,6 +926,8 @@ typedef enum tag_DISP_CMD {
 	DISP_CMD_LCD_CHECK_CLOSE_FINISH = 0x14b,
 	DISP_CMD_LCD_SET_SRC = 0x14c,
 	DISP_CMD_LCD_USER_DEFINED_FUNC = 0x14d,
+	/* cpu panel with lcd_cpu_te: send a frame at the next TE pulse */
+	DISP_CMD_LCD_CPUIF_UPDATE = 0x14e,
 
 	/* ----tv---- */
 	DISP_CMD_TV_ON = 0x180,
@@ -837,6 +989,8 @@ typedef enum tag_DISP_CMD {
 	DISP_CMD_SPRITE_BLOCK_GET_PREV_BLOCK = 0x254,
 	DISP_CMD_SPRITE_BLOCK_GET_NEXT_BLOCK = 0x255,
 	DISP_CMD_SPRITE_BLOCK_GET_PRIO = 0x256,
+	/* arg: sel, hid, x, y by value */
+	DISP_CMD_SPRITE_BLOCK_SET_POS = 0x25e,
 
 	/* ----framebuffer---- */
 	DISP_CMD_FB_REQUEST = 0x280,
@@ -874,6 +1028,8 @@ typedef enum tag_DISP_CMD {
 #define FBIO_ALPHA_OFF 0x4713
 #define FBIOPUT_ALPHA_VALUE 0x4714
 
+#define FBIOGET_DMABUF _IOR('F', 0x21, __disp_fb_dmabuf_export_t)
+
 #define FBIO_DISPLAY_SCREEN0_ONLY 0x4720
 #define FBIO_DISPLAY_SCREEN1_ONLY 0x4721
 #define FBIO_DISPLAY_TWO_SAME_SCREEN_TB 0x4722
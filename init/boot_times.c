@@ -0,0 +1,122 @@
+/*
+ * init/boot_times.c
+ *
+ * The slowest initcalls, async init functions and driver probes of the
+ * boot, in <debugfs>/boot_times. initcall_debug logs every one of them;
+ * this keeps the few that matter without the log, so a slow boot can be
+ * looked at on a box that booted normally.
+ *
+ * Released under the GPL version 2 only.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/sort.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#define BOOT_TIMES	64
+
+struct boot_time {
+	char name[48];
+	unsigned int usecs;
+	int ret;
+	char kind;
+};
+
+static struct boot_time boot_times[BOOT_TIMES];
+static int boot_times_nr;
+static DEFINE_SPINLOCK(boot_times_lock);
+
+/**
+ * boot_time_record - note how long a step of the boot took
+ * @kind: 'i' for an initcall, 'a' for an async function, 'p' for a probe
+ * @usecs: duration
+ * @ret: what it returned
+ * @fmt: printf format of its name
+ *
+ * Only the BOOT_TIMES slowest are kept. Nothing is recorded once the
+ * system is running.
+ */
+void boot_time_record(char kind, unsigned long long usecs, int ret,
+		      const char *fmt, ...)
+{
+	struct boot_time *t;
+	unsigned long flags;
+	va_list args;
+	int i;
+
+	if (system_state != SYSTEM_BOOTING)
+		return;
+
+	spin_lock_irqsave(&boot_times_lock, flags);
+	if (boot_times_nr < BOOT_TIMES) {
+		t = &boot_times[boot_times_nr++];
+	} else {
+		t = &boot_times[0];
+		for (i = 1; i < BOOT_TIMES; i++)
+			if (boot_times[i].usecs < t->usecs)
+				t = &boot_times[i];
+		if (t->usecs >= usecs)
+			goto out;
+	}
+
+	va_start(args, fmt);
+	vsnprintf(t->name, sizeof(t->name), fmt, args);
+	va_end(args);
+	t->usecs = min_t(unsigned long long, usecs, UINT_MAX);
+	t->ret = ret;
+	t->kind = kind;
+out:
+	spin_unlock_irqrestore(&boot_times_lock, flags);
+}
+
+static int boot_time_cmp(const void *a, const void *b)
+{
+	const struct boot_time *ta = a, *tb = b;
+
+	if (ta->usecs == tb->usecs)
+		return 0;
+	return ta->usecs < tb->usecs ? 1 : -1;
+}
+
+static int boot_times_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	spin_lock_irq(&boot_times_lock);
+	sort(boot_times, boot_times_nr, sizeof(boot_times[0]),
+	     boot_time_cmp, NULL);
+
+	seq_printf(m, "%-7s %10s %5s  %s\n", "kind", "usecs", "ret", "name");
+	for (i = 0; i < boot_times_nr; i++)
+		seq_printf(m, "%-7s %10u %5d  %s\n",
+			   boot_times[i].kind == 'p' ? "probe" :
+			   boot_times[i].kind == 'a' ? "async" : "initcall",
+			   boot_times[i].usecs, boot_times[i].ret,
+			   boot_times[i].name);
+	spin_unlock_irq(&boot_times_lock);
+
+	return 0;
+}
+
+static int boot_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_times_show, inode->i_private);
+}
+
+static const struct file_operations boot_times_fops = {
+	.open		= boot_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init boot_times_init(void)
+{
+	debugfs_create_file("boot_times", 0444, NULL, NULL, &boot_times_fops);
+	return 0;
+}
+late_initcall(boot_times_init);
@@ -681,12 +681,15 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	ktime_t calltime = ktime_get();
 	int ret;
 
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	boot_time_record('i', ktime_to_ns(ktime_sub(ktime_get(), calltime)) >> 10,
+			 ret, "%pf", fn);
 
 	msgbuf[0] = 0;
 
@@ -125,7 +125,7 @@ static void async_run_entry_fn(struct work_struct *work)
 	struct async_entry *entry =
 		container_of(work, struct async_entry, work);
 	unsigned long flags;
-	ktime_t uninitialized_var(calltime), delta, rettime;
+	ktime_t calltime, delta, rettime;
 
 	/* 1) move self to the running queue */
 	spin_lock_irqsave(&async_lock, flags);
@@ -133,21 +133,20 @@ static void async_run_entry_fn(struct work_struct *work)
 	spin_unlock_irqrestore(&async_lock, flags);
 
 	/* 2) run (and print duration) */
-	if (initcall_debug && system_state == SYSTEM_BOOTING) {
+	if (initcall_debug && system_state == SYSTEM_BOOTING)
 		printk(KERN_DEBUG "calling  %lli_%pF @ %i\n",
 			(long long)entry->cookie,
 			entry->func, task_pid_nr(current));
-		calltime = ktime_get();
-	}
+	calltime = ktime_get();
 	entry->func(entry->data, entry->cookie);
-	if (initcall_debug && system_state == SYSTEM_BOOTING) {
-		rettime = ktime_get();
-		delta = ktime_sub(rettime, calltime);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	if (initcall_debug && system_state == SYSTEM_BOOTING)
 		printk(KERN_DEBUG "initcall %lli_%pF returned 0 after %lld usecs\n",
 			(long long)entry->cookie,
 			entry->func,
 			(long long)ktime_to_ns(delta) >> 10);
-	}
+	boot_time_record('a', ktime_to_ns(delta) >> 10, 0, "%pf", entry->func);
 
 	/* 3) remove self from the running queue */
 	spin_lock_irqsave(&async_lock, flags);
@@ -152,6 +152,43 @@ struct irq_domain *irq_domain_add_legacy(struct device_node *of_node,
 	irq_domain_add(domain);
 	return domain;
 }
+EXPORT_SYMBOL_GPL(irq_domain_add_legacy);
+
+/**
+ * irq_domain_remove() - Remove an irq domain.
+ * @domain: domain to remove
+ *
+ * Only legacy domains can go, their irq_descs and mappings belong to
+ * the caller, who must have freed every irq of the domain already or
+ * take care the irq_data no longer points here.
+ */
+void irq_domain_remove(struct irq_domain *domain)
+{
+	unsigned int i;
+
+	mutex_lock(&irq_domain_mutex);
+	WARN_ON(domain->revmap_type != IRQ_DOMAIN_MAP_LEGACY);
+
+	for (i = 0; i < domain->revmap_data.legacy.size; i++) {
+		struct irq_data *irq_data =
+			irq_get_irq_data(domain->revmap_data.legacy.first_irq + i);
+
+		if (irq_data && irq_data->domain == domain)
+			irq_data->domain = NULL;
+	}
+
+	list_del(&domain->link);
+	if (unlikely(irq_default_domain == domain))
+		irq_default_domain = NULL;
+	mutex_unlock(&irq_domain_mutex);
+
+	pr_debug("irq: Removed domain of type %d @0x%p\n",
+		 domain->revmap_type, domain);
+
+	of_node_put(domain->of_node);
+	kfree(domain);
+}
+EXPORT_SYMBOL_GPL(irq_domain_remove);
 
 /**
  * irq_domain_add_linear() - Allocate and register a legacy revmap irq_domain.
@@ -0,0 +1,160 @@
+/*
+ * LZ4 decompressor for the Linux kernel.
+ *
+ * Reads the legacy frame format of the lz4 tool ("lz4 -l"): a magic
+ * number, then chunks of at most 8MB of uncompressed data, each one
+ * a 32 bit little endian compressed size followed by an LZ4 block.
+ * Nothing marks the last chunk, the stream ends with the input.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_ARCHIVE_MAGIC	0x184c2102
+#define LZ4_CHUNK_SIZE		(8 << 20)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	u32 chunksize;
+	size_t out_len;
+	u8 *in_buf, *out_buf;
+	int ret = -1;
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_CHUNK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(lz4_compressbound(LZ4_CHUNK_SIZE));
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+	}
+
+	if (posp)
+		*posp = 0;
+
+	/*
+	 * With fill, in_buf only ever holds the piece being parsed, which
+	 * is read in one go: the 4 bytes of a size, or a whole chunk.
+	 */
+	if (fill)
+		in_len = fill(in_buf, 4);
+
+	if (in_len < 4 || get_unaligned_le32(in_buf) != LZ4_ARCHIVE_MAGIC) {
+		error("invalid header");
+		goto exit_2;
+	}
+	if (!fill)
+		in_buf += 4;
+	in_len -= 4;
+
+	if (posp)
+		*posp = 4;
+
+	for (;;) {
+		/* read compressed chunk size */
+		if (fill)
+			in_len = fill(in_buf, 4);
+		if (in_len <= 0)
+			break;
+		if (in_len < 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		chunksize = get_unaligned_le32(in_buf);
+
+		/* zero padding, or the size the kernel build appends */
+		if (chunksize == 0 || (!fill && in_len == 4))
+			break;
+
+		if (!fill)
+			in_buf += 4;
+		in_len -= 4;
+		if (posp)
+			*posp += 4;
+
+		/* another stream concatenated to this one */
+		if (chunksize == LZ4_ARCHIVE_MAGIC)
+			continue;
+
+		if (chunksize > lz4_compressbound(LZ4_CHUNK_SIZE)) {
+			error("chunk longer than the largest lz4 block");
+			goto exit_2;
+		}
+
+		if (fill)
+			in_len = fill(in_buf, chunksize);
+		if (in_len < (int)chunksize) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		out_len = LZ4_CHUNK_SIZE;
+		if (lz4_decompress_unknownoutputsize(in_buf, chunksize,
+						     out_buf, &out_len) < 0) {
+			error("Compressed data violation");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, out_len) != (int)out_len)
+			goto exit_2;
+		if (output)
+			out_buf += out_len;
+		if (posp)
+			*posp += chunksize;
+
+		if (!fill) {
+			in_buf += chunksize;
+			in_len -= chunksize;
+		}
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,129 @@
+/*
+ * LZ4 compressor
+ *
+ *  A greedy single pass over the input: the hash of the next four bytes
+ *  finds the last position they were seen at, a hit is extended both
+ *  ways and emitted as a sequence. Positions that keep missing are
+ *  skipped faster, so incompressible data costs little.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline u32 lz4_hash(u32 seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static inline unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		 unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *table = wrkmem;
+	const unsigned char *ip = src;
+	const unsigned char *anchor = src;
+	const unsigned char * const iend = src + src_len;
+	const unsigned char * const mflimit = iend - MFLIMIT;
+	const unsigned char * const matchlimit = iend - LASTLITERALS;
+	unsigned char *op = dst;
+	unsigned char *token;
+	size_t len;
+
+	if (src_len <= MFLIMIT)
+		goto last_literals;
+
+	memset(table, 0, LZ4_MEM_COMPRESS);
+	ip++;
+
+	while (ip < mflimit) {
+		const unsigned char *ref, *start;
+		u32 seq = get_unaligned_le32(ip);
+		u32 h = lz4_hash(seq);
+
+		ref = src + table[h];
+		table[h] = ip - src;
+		if (ref >= ip || ip - ref > MAX_DISTANCE ||
+		    get_unaligned_le32(ref) != seq) {
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		/* literals */
+		len = ip - anchor;
+		token = op++;
+		if (len >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			op = lz4_put_length(op, len - RUN_MASK);
+		} else {
+			*token = len << ML_BITS;
+		}
+		memcpy(op, anchor, len);
+		op += len;
+
+		/* offset */
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		/* match */
+		ip += MINMATCH;
+		ref += MINMATCH;
+		start = ip;
+		while (ip + 4 <= matchlimit &&
+		       get_unaligned((u32 *)ip) == get_unaligned((u32 *)ref)) {
+			ip += 4;
+			ref += 4;
+		}
+		while (ip < matchlimit && *ip == *ref) {
+			ip++;
+			ref++;
+		}
+		len = ip - start;
+		if (len >= ML_MASK) {
+			*token |= ML_MASK;
+			op = lz4_put_length(op, len - ML_MASK);
+		} else {
+			*token |= len;
+		}
+
+		anchor = ip;
+	}
+
+last_literals:
+	len = iend - anchor;
+	token = op++;
+	if (len >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, len - RUN_MASK);
+	} else {
+		*token = len << ML_BITS;
+	}
+	memcpy(op, anchor, len);
+	op += len;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
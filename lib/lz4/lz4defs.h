@@ -0,0 +1,22 @@
+/*
+ * lz4defs.h -- constants of the LZ4 block format
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#define MINMATCH	4
+/* a match must start at least 12 bytes before the end... */
+#define MFLIMIT		12
+/* ...and the last 5 bytes are always literals */
+#define LASTLITERALS	5
+#define MAX_DISTANCE	65535
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define LZ4_HASH_LOG	12
+#define LZ4_HASH_SIZE	(1 << LZ4_HASH_LOG)
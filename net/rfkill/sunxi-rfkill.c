@@ -25,6 +25,9 @@
 #include <linux/rfkill.h>
 #include <linux/delay.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 #include <plat/sys_config.h>
 
 #if defined CONFIG_BT_HCIUART_DEBUG
@@ -46,12 +49,37 @@ static __inline int mmc_pm_get_io_val(char* name) {return -1;}
 static DEFINE_SPINLOCK(bt_power_lock);
 static const char bt_name[] = "bcm4329";
 static struct rfkill *sw_rfkill;
+
+/*
+ * 100ms of settle time after the lines switch, timed by a delayed work
+ * and waited for on bt_settled. Userspace toggles wait as before, the
+ * restore rfkill does on resume returns at once; either way the next
+ * toggle starts only after the last one settled.
+ */
+#define BT_SETTLE_MS    100
+
+static DECLARE_COMPLETION(bt_settled);
+static struct delayed_work bt_settle_work;
+static ktime_t bt_power_start;
+static int bt_resuming;
+
+static void bt_settle(struct work_struct *work)
+{
+    RF_MSG("power settled after %lld us\n",
+           ktime_us_delta(ktime_get(), bt_power_start));
+    complete_all(&bt_settled);
+}
+
 static int rfkill_set_power(void *data, bool blocked)
 {
     unsigned int mod_sel = mmc_pm_get_mod_type();
 
     RF_MSG("rfkill set power %d\n", blocked);
 
+    wait_for_completion(&bt_settled);
+    INIT_COMPLETION(bt_settled);
+    bt_power_start = ktime_get();
+
     spin_lock(&bt_power_lock);
     switch (mod_sel)
     {
@@ -85,7 +113,10 @@ static int rfkill_set_power(void *data, bool blocked)
     }
 
     spin_unlock(&bt_power_lock);
-    msleep(100);
+
+    schedule_delayed_work(&bt_settle_work, msecs_to_jiffies(BT_SETTLE_MS));
+    if (!bt_resuming)
+        wait_for_completion(&bt_settled);
     return 0;
 }
 
@@ -118,12 +149,34 @@ static int sw_rfkill_remove(struct platform_device *pdev)
     return 0;
 }
 
+#ifdef CONFIG_PM
+/* set while the rfkill child below us resumes */
+static int sw_rfkill_resume(struct device *dev)
+{
+    bt_resuming = 1;
+    return 0;
+}
+
+static void sw_rfkill_complete(struct device *dev)
+{
+    bt_resuming = 0;
+}
+
+static const struct dev_pm_ops sw_rfkill_pm_ops = {
+    .resume = sw_rfkill_resume,
+    .complete = sw_rfkill_complete,
+};
+#endif
+
 static struct platform_driver sw_rfkill_driver = {
     .probe = sw_rfkill_probe,
     .remove = sw_rfkill_remove,
     .driver = {
         .name = "sunxi-rfkill",
         .owner = THIS_MODULE,
+#ifdef CONFIG_PM
+        .pm = &sw_rfkill_pm_ops,
+#endif
     },
 };
 
@@ -144,6 +197,8 @@ static int __init sw_rfkill_init(void)
 		return -ENODEV;
 	}
 
+    INIT_DELAYED_WORK(&bt_settle_work, bt_settle);
+    complete_all(&bt_settled);
     platform_device_register(&sw_rfkill_dev);
     return platform_driver_register(&sw_rfkill_driver);
 }
@@ -152,6 +207,7 @@ static void __exit sw_rfkill_exit(void)
 {
     platform_device_unregister(&sw_rfkill_dev);
     platform_driver_unregister(&sw_rfkill_driver);
+    flush_delayed_work_sync(&bt_settle_work);
 }
 
 module_init(sw_rfkill_init);
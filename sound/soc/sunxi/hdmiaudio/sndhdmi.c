@@ -20,6 +20,7 @@
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
 #include <sound/initval.h>
+#include <sound/asoundef.h>
 #include <plat/sys_config.h>
 #include <linux/io.h>
 
@@ -36,6 +37,9 @@ struct sndhdmi_priv {
 static hdmi_audio_t hdmi_para;
 static __audio_hdmi_func g_hdmi_func;
 
+/* channel status set by the application, only AES0 non-audio is used */
+static struct snd_aes_iec958 hdmi_iec958;
+
 void audio_set_hdmi_func(__audio_hdmi_func * hdmi_func)
 {
 	g_hdmi_func.hdmi_audio_enable = hdmi_func->hdmi_audio_enable;
@@ -53,10 +57,21 @@ static int sndhdmi_mute(struct snd_soc_dai *dai, int mute)
 	return 0;
 }
 
+/* audio_config() only knows layouts for 1, 2 and 8 channels */
+static unsigned int sndhdmi_channels[] = { 1, 2, 8 };
+
+static struct snd_pcm_hw_constraint_list sndhdmi_channels_constraint = {
+	.count = ARRAY_SIZE(sndhdmi_channels),
+	.list = sndhdmi_channels,
+	.mask = 0,
+};
+
 static int sndhdmi_startup(struct snd_pcm_substream *substream,
 	struct snd_soc_dai *dai)
 {
-	return 0;
+	return snd_pcm_hw_constraint_list(substream->runtime, 0,
+					  SNDRV_PCM_HW_PARAM_CHANNELS,
+					  &sndhdmi_channels_constraint);
 }
 
 static void sndhdmi_shutdown(struct snd_pcm_substream *substream,
@@ -85,6 +100,18 @@ static int sndhdmi_hw_params(struct snd_pcm_substream *substream,
 	if (4 == hdmi_para.channel_num)
 		hdmi_para.channel_num = 2;
 
+	/*
+	 * Passthrough is flagged like on spdif, through the channel status
+	 * control. 8 channels of IEC 61937 at 192 kHz is a HBR stream.
+	 */
+	if (hdmi_iec958.status[0] & IEC958_AES0_NONAUDIO) {
+		if (hdmi_para.channel_num == 8 && hdmi_para.sample_rate == 192000)
+			hdmi_para.data_raw = HDMI_AUDIO_HBR;
+		else
+			hdmi_para.data_raw = HDMI_AUDIO_NONPCM;
+	} else
+		hdmi_para.data_raw = HDMI_AUDIO_LPCM;
+
 	g_hdmi_func.hdmi_set_audio_para(&hdmi_para);
 	g_hdmi_func.hdmi_audio_enable(1, 1);
 
@@ -130,7 +157,7 @@ struct snd_soc_dai_driver sndhdmi_dai = {
 	.playback = {
 		.stream_name = "Playback",
 		.channels_min = 1,
-		.channels_max = 2,
+		.channels_max = 8,
 		.rates = SNDHDMI_RATES,
 		.formats = SNDHDMI_FORMATS,
 	},
@@ -140,6 +167,57 @@ struct snd_soc_dai_driver sndhdmi_dai = {
 };
 EXPORT_SYMBOL(sndhdmi_dai);
 
+static int sndhdmi_iec958_info(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_IEC958;
+	uinfo->count = 1;
+	return 0;
+}
+
+static int sndhdmi_iec958_mask_get(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_value *ucontrol)
+{
+	memset(ucontrol->value.iec958.status, 0xff,
+	       sizeof(ucontrol->value.iec958.status));
+	return 0;
+}
+
+static int sndhdmi_iec958_get(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.iec958 = hdmi_iec958;
+	return 0;
+}
+
+static int sndhdmi_iec958_put(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	int change = memcmp(&hdmi_iec958, &ucontrol->value.iec958,
+			    sizeof(hdmi_iec958)) != 0;
+
+	/* applied by the next hw_params */
+	hdmi_iec958 = ucontrol->value.iec958;
+	return change;
+}
+
+static const struct snd_kcontrol_new sndhdmi_controls[] = {
+	{
+		.access = SNDRV_CTL_ELEM_ACCESS_READ,
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM,
+		.name = SNDRV_CTL_NAME_IEC958("", PLAYBACK, MASK),
+		.info = sndhdmi_iec958_info,
+		.get = sndhdmi_iec958_mask_get,
+	},
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM,
+		.name = SNDRV_CTL_NAME_IEC958("", PLAYBACK, DEFAULT),
+		.info = sndhdmi_iec958_info,
+		.get = sndhdmi_iec958_get,
+		.put = sndhdmi_iec958_put,
+	},
+};
+
 static int sndhdmi_soc_probe(struct snd_soc_codec *codec)
 {
 	struct sndhdmi_priv *sndhdmi;
@@ -151,7 +229,8 @@ static int sndhdmi_soc_probe(struct snd_soc_codec *codec)
 	}
 	snd_soc_codec_set_drvdata(codec, sndhdmi);
 
-	return 0;
+	return snd_soc_add_codec_controls(codec, sndhdmi_controls,
+					  ARRAY_SIZE(sndhdmi_controls));
 }
 
 static int sndhdmi_soc_remove(struct snd_soc_codec *codec)
@@ -373,18 +373,10 @@ static int sunxi_hdmiaudio_trigger(struct snd_pcm_substream *substream,
 }
 
 //freq:   1: 22.5792MHz   0: 24.576MHz
+//the machine driver already got the pll at that rate from sunxi-audioclk
 static int sunxi_hdmiaudio_set_sysclk(struct snd_soc_dai *cpu_dai, int clk_id,
                                  unsigned int freq, int dir)
 {
-	if (sunxi_is_sun7i())
-		return 0; /* No rx / tx control, etc. on sun7i() */
-
-	if (!freq) {
-		clk_set_rate(hdmiaudio_pll2clk, 24576000);
-	} else {
-		clk_set_rate(hdmiaudio_pll2clk, 22579200);
-	}
-
 	return 0;
 }
 
@@ -555,7 +547,7 @@ static struct snd_soc_dai_driver sunxi_hdmiaudio_dai = {
 	.remove 	= sunxi_hdmiaudio_dai_remove,
 	.playback = {
 		.channels_min = 1,
-		.channels_max = 2,
+		.channels_max = 8,
 		.rates = SUNXI_I2S_RATES,
 		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S32_LE
 	},
@@ -21,6 +21,7 @@
 #include <sound/soc.h>
 #include <sound/pcm_params.h>
 #include <sound/soc-dapm.h>
+#include <plat/system.h>
 #include <plat/sys_config.h>
 #include <linux/io.h>
 
@@ -28,12 +29,18 @@
 #include "sunxi-hdmipcm.h"
 
 #include "sndhdmi.h"
+#include "../sunxi-audioclk.h"
 
 static struct clk *xtal;
 
 static int clk_users;
 static DEFINE_MUTEX(clk_lock);
 
+/* sun7i hdmi audio doesn't run from the audio pll */
+static struct sunxi_audioclk_user sndhdmi_clk = {
+	.name = "hdmi playback",
+};
+
 #ifdef ENFORCE_RATES
 static struct snd_pcm_hw_constraint_list hw_constraints_rates = {
 	.count	= ARRAY_SIZE(rates),
@@ -50,6 +57,9 @@ static int sunxi_sndhdmi_startup(struct snd_pcm_substream *substream)
 	#endif
 	mutex_lock(&clk_lock);
 	mutex_unlock(&clk_lock);
+	if (!sunxi_is_sun7i())
+		ret = sunxi_audioclk_constrain(substream->runtime,
+					       &sndhdmi_clk);
 	if (!ret) {
 	#ifdef ENFORCE_RATES
 		ret = snd_pcm_hw_constraint_list(runtime, 0,
@@ -214,6 +224,12 @@ static int sunxi_sndhdmi_hw_params(struct snd_pcm_substream *substream,
 	if (ret < 0)
 		return ret;
 
+	if (!sunxi_is_sun7i()) {
+		ret = sunxi_audioclk_acquire(&sndhdmi_clk, rate);
+		if (ret < 0)
+			return ret;
+	}
+
 	ret = snd_soc_dai_set_sysclk(cpu_dai, 0 , mpll, 0);
 	if (ret < 0)
 		return ret;
@@ -237,10 +253,17 @@ static int sunxi_sndhdmi_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+static int sunxi_sndhdmi_hw_free(struct snd_pcm_substream *substream)
+{
+	sunxi_audioclk_release(&sndhdmi_clk);
+	return 0;
+}
+
 static struct snd_soc_ops sunxi_sndhdmi_ops = {
 	.startup 	= sunxi_sndhdmi_startup,
 	.shutdown 	= sunxi_sndhdmi_shutdown,
 	.hw_params 	= sunxi_sndhdmi_hw_params,
+	.hw_free 	= sunxi_sndhdmi_hw_free,
 };
 
 static struct snd_soc_dai_link sunxi_sndhdmi_dai_link = {
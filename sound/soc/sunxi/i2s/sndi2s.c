@@ -44,10 +44,12 @@ static int sunxi_i2s_slave = 0;
 				SNDRV_PCM_RATE_352800 | SNDRV_PCM_RATE_384000)
 
 #if defined CONFIG_ARCH_SUN7I
-#define sndi2s_FORMATS (SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE)
+#define sndi2s_FORMATS (SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE | \
+			SNDRV_PCM_FMTBIT_S32_LE)
 #else
 #define sndi2s_FORMATS (SNDRV_PCM_FMTBIT_S8 | SNDRV_PCM_FMTBIT_S16_LE | \
-		                     SNDRV_PCM_FMTBIT_S18_3LE | SNDRV_PCM_FMTBIT_S20_LE)
+		                     SNDRV_PCM_FMTBIT_S18_3LE | SNDRV_PCM_FMTBIT_S20_LE | \
+		                     SNDRV_PCM_FMTBIT_S24_LE | SNDRV_PCM_FMTBIT_S32_LE)
 #endif
 
 static int sndi2s_mute(struct snd_soc_dai *dai, int mute)
@@ -107,7 +109,7 @@ struct snd_soc_dai_driver sndi2s_dai = {
 	.playback = {
 		.stream_name = "Playback",
 		.channels_min = 1,
-		.channels_max = 2,
+		.channels_max = 8,
 		.rates = sndi2s_RATES_MASTER,
 		.formats = sndi2s_FORMATS,
 	},
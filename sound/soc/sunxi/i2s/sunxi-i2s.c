@@ -417,6 +417,11 @@ static int sunxi_i2s_hw_params(struct snd_pcm_substream *substream,
 		reg_val |= SUNXI_IISFAT0_SR_24BIT;
 		sunxi_iis.samp_res = 24;
 		break;
+	case SNDRV_PCM_FORMAT_S32_LE:
+		/* the top 24 bits go out, the slot is 32 BCLK anyway */
+		reg_val |= SUNXI_IISFAT0_SR_24BIT;
+		sunxi_iis.samp_res = 32;
+		break;
 	default:
 		pr_err("[IIS-0] sunxi_i2s_hw_params: Unsupported format (%d)\n", (int)params_format(params));
 		return -EINVAL;
@@ -425,13 +430,19 @@ static int sunxi_i2s_hw_params(struct snd_pcm_substream *substream,
 
 	/* set FIFO control register */
 	reg_val = readl(sunxi_iis.regs + SUNXI_IISFCTL);
-	reg_val |= SUNXI_IISFCTL_TXIM_MOD1;				//1: Valid data at the LSB of TXFIFO register
-	//CHECK EXPANDING FORMAT!!!
-	if(sunxi_iis.samp_res == 24) {
+	if(sunxi_iis.samp_res == 32) {
+		reg_val &= ~SUNXI_IISFCTL_TXIM_MOD1;			//0: Valid data at the MSB of TXFIFO register
 		reg_val &= ~SUNXI_IISFCTL_RXOM_MOD3;			//00: Expanding 0 at LSB of DA_RXFIFO register
 	}
 	else {
-		reg_val |= SUNXI_IISFCTL_RXOM_MOD1;			//00: Expanding 0 at LSB of DA_RXFIFO register
+		reg_val |= SUNXI_IISFCTL_TXIM_MOD1;			//1: Valid data at the LSB of TXFIFO register
+		//CHECK EXPANDING FORMAT!!!
+		if(sunxi_iis.samp_res == 24) {
+			reg_val &= ~SUNXI_IISFCTL_RXOM_MOD3;		//00: Expanding 0 at LSB of DA_RXFIFO register
+		}
+		else {
+			reg_val |= SUNXI_IISFCTL_RXOM_MOD1;		//00: Expanding 0 at LSB of DA_RXFIFO register
+		}
 	}
 	writel(reg_val, sunxi_iis.regs + SUNXI_IISFCTL);
 
@@ -480,22 +491,12 @@ static int sunxi_i2s_trigger(struct snd_pcm_substream *substream,
 }
 
 //freq:   1: 22.5792MHz   0: 24.576MHz
+//in master mode the machine driver got the pll from sunxi-audioclk
 static int sunxi_i2s_set_sysclk(struct snd_soc_dai *cpu_dai, int clk_id,
                                  unsigned int freq, int dir)
 {
-	if (!freq) {
-		/*printk("[IIS-0] sunxi_i2s_set_sysclk: set sysclk=24576000\n");*/
-		if(sunxi_iis.slave)
-			gpio_write_one_pin_value(i2s_handle, 0, "i2s_clk_sel");
-		else
-			clk_set_rate(i2s_pll2clk, 24576000);
-	} else {
-		/*printk("[IIS-0] sunxi_i2s_set_sysclk: set sysclk=22579200\n");*/
-		if(sunxi_iis.slave)
-			gpio_write_one_pin_value(i2s_handle, 1, "i2s_clk_sel");
-		else
-			clk_set_rate(i2s_pll2clk, 22579200);
-	}
+	if(sunxi_iis.slave)
+		gpio_write_one_pin_value(i2s_handle, freq ? 1 : 0, "i2s_clk_sel");
 
 	return 0;
 }
@@ -712,15 +713,17 @@ static struct snd_soc_dai_driver sunxi_iis_dai = {
 	.remove 	= sunxi_i2s_dai_remove,
 	.playback 	= {
 		.channels_min = 1,
-		.channels_max = 2,
+		.channels_max = 8,	/* 2 on sun5i, see sunxi_i2s_dev_probe */
 		.rates = SUNXI_I2S_RATES_MASTER,
-		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE,
+		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE |
+			   SNDRV_PCM_FMTBIT_S32_LE,
 	},
 	.capture 	= {
 		.channels_min = 1,
 		.channels_max = 2,
 		.rates = SUNXI_I2S_RATES_MASTER,
-		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE,
+		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE |
+			   SNDRV_PCM_FMTBIT_S32_LE,
 	},
 	.symmetric_rates = 1,
 	.ops 		= &sunxi_iis_dai_ops,
@@ -793,6 +796,11 @@ static int __devinit sunxi_i2s_dev_probe(struct platform_device *pdev)
 	writel(reg_val, sunxi_iis.regs + SUNXI_IISCTL);
 
 	iounmap(sunxi_iis.ioregs);
+
+	/* only sun4i and sun7i have SDO1-3 */
+	if (sunxi_is_sun5i())
+		sunxi_iis_dai.playback.channels_max = 2;
+
 	ret = snd_soc_register_dai(&pdev->dev, &sunxi_iis_dai);
 	if (ret) {
 		dev_err(&pdev->dev, "Failed to register DAI\n");
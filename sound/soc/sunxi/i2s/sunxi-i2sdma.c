@@ -29,6 +29,7 @@
 #include <mach/hardware.h>
 #include <plat/dma_compat.h>
 
+#include "../sunxi-pcmdma.h"
 #include "sunxi-i2s.h"
 #include "sunxi-i2sdma.h"
 
@@ -36,12 +37,13 @@ static const struct snd_pcm_hardware sunxi_pcm_out_hardware = {
 	.info			= SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				      SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
 				      SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME,
-	.formats		= SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE |
+				  SNDRV_PCM_FMTBIT_S32_LE,
 	.rates			= SNDRV_PCM_RATE_8000_384000 | SNDRV_PCM_RATE_KNOT,
 	.rate_min		= 8000,
 	.rate_max		= 384000,
 	.channels_min		= 1,
-	.channels_max		= 2,
+	.channels_max		= 8,		/* four stereo lines, SDO0-3 */
 	.buffer_bytes_max	= 128*1024,    /* value must be (2^n)Kbyte size */
 	.period_bytes_min	= 1024*4,//1024*4,
 	.period_bytes_max	= 1024*32,//1024*32,
@@ -54,7 +56,8 @@ static const struct snd_pcm_hardware sunxi_pcm_in_hardware = {
 	.info			= SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				      SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
 				      SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME,
-	.formats		= SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE |
+				  SNDRV_PCM_FMTBIT_S32_LE,
 	.rates			= SNDRV_PCM_RATE_8000_384000 | SNDRV_PCM_RATE_KNOT,
 	.rate_min		= 8000,
 	.rate_max		= 384000,
@@ -68,159 +71,25 @@ static const struct snd_pcm_hardware sunxi_pcm_in_hardware = {
 	.fifo_size		= 64,
 };
 
-struct sunxi_runtime_data {
-	spinlock_t lock;
-	int state;
-	unsigned int dma_loaded;
-	unsigned int dma_limit;
-	unsigned int dma_period;
-	dma_addr_t dma_start;
-	dma_addr_t dma_pos;
-	dma_addr_t dma_end;
-	struct sunxi_dma_params *params;
-	/*DMA data width*/
-	unsigned int dma_width;
-};
-
-static void sunxi_pcm_enqueue(struct snd_pcm_substream *substream)
-{
-	int ret = 0;
-	struct sunxi_runtime_data *prtd = substream->runtime->private_data;
-	dma_addr_t pos = prtd->dma_pos;
-	unsigned long len = prtd->dma_period;
-	unsigned int limit = prtd->dma_limit;
-	int read = substream->stream == SNDRV_PCM_STREAM_PLAYBACK ? 0 : 1;
-
-	while(prtd->dma_loaded < limit){
-		if((pos + len) > prtd->dma_end){
-			len  = prtd->dma_end - pos;
-		}
-		ret = sunxi_dma_enqueue(prtd->params, pos, len, read);
-		if(ret == 0){
-			prtd->dma_loaded++;
-			pos += prtd->dma_period;
-			if(pos >= prtd->dma_end)
-				pos = prtd->dma_start;
-		}else{
-			break;
-		}
-	}
-	prtd->dma_pos = pos;
-}
-
-static void sunxi_audio_buffdone(struct sunxi_dma_params *dma, void *dev_id)
-{
-	struct sunxi_runtime_data *prtd;
-	struct snd_pcm_substream *substream = dev_id;
-
-	prtd = substream->runtime->private_data;
-	if (substream) {
-		snd_pcm_period_elapsed(substream);
-	}
-
-	spin_lock(&prtd->lock);
-	{
-		prtd->dma_loaded--;
-		sunxi_pcm_enqueue(substream);
-	}
-	spin_unlock(&prtd->lock);
-}
-
-static int sunxi_pcm_hw_params(struct snd_pcm_substream *substream,
-	struct snd_pcm_hw_params *params)
-{
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct sunxi_runtime_data *prtd = runtime->private_data;
-	struct snd_soc_pcm_runtime *rtd = substream->private_data;
-	unsigned long totbytes = params_buffer_bytes(params);
-	struct sunxi_dma_params *dma =
-			snd_soc_dai_get_dma_data(rtd->cpu_dai, substream);
-
-	int ret = 0;
-	if (!dma)
-		return 0;
-
-	prtd->dma_width = 16;
-	/* set DMA width for using in sunxi_pcm_prepare*/
-	switch(params_format(params)) {
-		case SNDRV_PCM_FORMAT_S16_LE:
-		prtd->dma_width = 16;
-		break;
-		case SNDRV_PCM_FORMAT_S20_3LE:
-		prtd->dma_width = 32;
-		break;
-		case SNDRV_PCM_FORMAT_S24_LE:
-		prtd->dma_width = 32;
-		break;
-	}
-	if (prtd->params == NULL) {
-		prtd->params = dma;
-		ret = sunxi_dma_request(prtd->params, 0);
-		if (ret < 0) {
-			printk("[IIS-0] sunxi_dma_request failed! ret == %d\n", ret);
-			return ret;
-		}
-	}
-
-	if (sunxi_dma_set_callback(prtd->params, sunxi_audio_buffdone,
-							    substream) != 0) {
-		sunxi_dma_release(prtd->params);
-		printk("[IIS-0] sunxi_dma_set_callback failed! ret == %d\n", ret);
-		prtd->params = NULL;
-		return -EINVAL;
-	}
-
-	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
-
-	runtime->dma_bytes = totbytes;
-
-	spin_lock_irq(&prtd->lock);
-	prtd->dma_loaded = 0;
-	prtd->dma_limit = runtime->hw.periods_min;
-	prtd->dma_period = params_period_bytes(params);
-	prtd->dma_start = runtime->dma_addr;
-	prtd->dma_pos = prtd->dma_start;
-	prtd->dma_end = prtd->dma_start + totbytes;
-
-	spin_unlock_irq(&prtd->lock);
-	return 0;
-}
-
-static int sunxi_pcm_hw_free(struct snd_pcm_substream *substream)
-{
-	struct sunxi_runtime_data *prtd = substream->runtime->private_data;
-
-	if (prtd->params)
-		sunxi_dma_flush(prtd->params);
-
-	snd_pcm_set_runtime_buffer(substream, NULL);
-
-	if (prtd->params) {
-		sunxi_dma_stop(prtd->params);
-		sunxi_dma_release(prtd->params);
-		prtd->params = NULL;
-	}
-
-	return 0;
-}
-
 static int sunxi_pcm_prepare(struct snd_pcm_substream *substream)
 {
-	struct sunxi_runtime_data *prtd = substream->runtime->private_data;
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
 	int ret = 0;
 
 	if (!prtd->params)
 		return 0;
 
+	/* continuous mode: the channel reloads the next period by itself */
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK){
 #if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
 		struct dma_hw_conf codec_dma_conf;
 		codec_dma_conf.drqsrc_type  = DRQ_TYPE_SDRAM;
 		codec_dma_conf.drqdst_type  = DRQ_TYPE_IIS;
-		codec_dma_conf.xfer_type    = DMAXFER_D_BHALF_S_BHALF;
+		codec_dma_conf.xfer_type    = prtd->dma_width > 16 ?
+				DMAXFER_D_BWORD_S_BWORD : DMAXFER_D_BHALF_S_BHALF;
 		codec_dma_conf.address_type = DMAADDRT_D_FIX_S_INC;
 		codec_dma_conf.dir          = SW_DMA_WDEV;
-		codec_dma_conf.reload       = 0;
+		codec_dma_conf.reload       = 1;
 		codec_dma_conf.hf_irq       = SW_DMA_IRQ_FULL;
 		codec_dma_conf.from         = prtd->dma_start;
 		codec_dma_conf.to           = prtd->params->dma_addr;
@@ -228,7 +97,6 @@ static int sunxi_pcm_prepare(struct snd_pcm_substream *substream)
 		dma_config_t codec_dma_conf;
 		memset(&codec_dma_conf, 0, sizeof(codec_dma_conf));
 
-		printk("[IIS-0] sunxi_pcm_prepare: playback DMA data width=(%d)\n", prtd->dma_width);
 		if(prtd->dma_width > 16)
 		{
 			codec_dma_conf.xfer_type.src_data_width	= DATA_WIDTH_32BIT;
@@ -245,18 +113,28 @@ static int sunxi_pcm_prepare(struct snd_pcm_substream *substream)
 		codec_dma_conf.address_type.dst_addr_mode = NDMA_ADDR_NOCHANGE;
 		codec_dma_conf.src_drq_type		= N_SRC_SDRAM;
 		codec_dma_conf.dst_drq_type		= N_DST_IIS0_TX;
-		codec_dma_conf.bconti_mode		= false;
+		codec_dma_conf.bconti_mode		= true;
 		codec_dma_conf.irq_spt			= CHAN_IRQ_FD; //buf full done irq
 #endif
 		ret = sunxi_dma_config(prtd->params, &codec_dma_conf, 0);
 	}
 	else {
 #if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
+		struct dma_hw_conf codec_dma_conf;
+		codec_dma_conf.drqsrc_type  = DRQ_TYPE_IIS;
+		codec_dma_conf.drqdst_type  = DRQ_TYPE_SDRAM;
+		codec_dma_conf.xfer_type    = prtd->dma_width > 16 ?
+				DMAXFER_D_BWORD_S_BWORD : DMAXFER_D_BHALF_S_BHALF;
+		codec_dma_conf.address_type = DMAADDRT_D_INC_S_FIX;
+		codec_dma_conf.dir          = SW_DMA_RDEV;
+		codec_dma_conf.reload       = 1;
+		codec_dma_conf.hf_irq       = SW_DMA_IRQ_FULL;
+		codec_dma_conf.from         = prtd->params->dma_addr;
+		codec_dma_conf.to           = prtd->dma_start;
 #else
 		dma_config_t codec_dma_conf;
 		memset(&codec_dma_conf, 0, sizeof(codec_dma_conf));
 
-		printk("[IIS-0] sunxi_pcm_prepare: capture DMA data width=(%d)\n", prtd->dma_width);
 		if(prtd->dma_width > 16)
 		{
 			codec_dma_conf.xfer_type.src_data_width	= DATA_WIDTH_32BIT;
@@ -267,224 +145,53 @@ static int sunxi_pcm_prepare(struct snd_pcm_substream *substream)
 			codec_dma_conf.xfer_type.src_data_width	= DATA_WIDTH_16BIT;
 			codec_dma_conf.xfer_type.dst_data_width	= DATA_WIDTH_16BIT;
 		}
-		codec_dma_conf.xfer_type.src_bst_len	= DATA_BRST_4;	
+		codec_dma_conf.xfer_type.src_bst_len	= DATA_BRST_4;
 		codec_dma_conf.xfer_type.dst_bst_len	= DATA_BRST_4;
 		codec_dma_conf.address_type.src_addr_mode = NDMA_ADDR_NOCHANGE;
 		codec_dma_conf.address_type.dst_addr_mode = NDMA_ADDR_INCREMENT;
 		codec_dma_conf.src_drq_type		= N_SRC_IIS0_RX;
 		codec_dma_conf.dst_drq_type		= N_DST_SDRAM;
-		codec_dma_conf.bconti_mode		= false;
+		codec_dma_conf.bconti_mode		= true;
 		codec_dma_conf.irq_spt			= CHAN_IRQ_FD; //buf full done irq
 #endif
 		ret = sunxi_dma_config(prtd->params, &codec_dma_conf, 0);
 	}
+	if (ret)
+		return ret;
 
-	/* flush the DMA channel */
-	prtd->dma_loaded = 0;
-	sunxi_dma_flush(prtd->params);
-	prtd->dma_pos = prtd->dma_start;
-
-	/* enqueue dma buffers */
-	sunxi_pcm_enqueue(substream);
-
-	return ret;
-}
-
-static int sunxi_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
-{
-	struct sunxi_runtime_data *prtd = substream->runtime->private_data;
-	int ret ;
-	spin_lock(&prtd->lock);
-
-	switch (cmd) {
-	case SNDRV_PCM_TRIGGER_START:
-	case SNDRV_PCM_TRIGGER_RESUME:
-	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
-		printk("[IIS-0] dma trigger start\n");
-		prtd->state |= ST_RUNNING;
-		sunxi_dma_start(prtd->params);
-		break;
-
-	case SNDRV_PCM_TRIGGER_SUSPEND:
-	case SNDRV_PCM_TRIGGER_STOP:
-	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
-        printk("[IIS-0] dma trigger stop\n");
-		prtd->state &= ~ST_RUNNING;
-		sunxi_dma_stop(prtd->params);
-		break;
-
-	default:
-		ret = -EINVAL;
-		break;
-	}
-
-	spin_unlock(&prtd->lock);
-	return 0;
-}
-
-static snd_pcm_uframes_t sunxi_pcm_pointer(struct snd_pcm_substream *substream)
-{
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct sunxi_runtime_data *prtd = runtime->private_data;
-	unsigned long res = 0;
-	snd_pcm_uframes_t offset = 0;
-	unsigned int dmasrc = 0;
-	unsigned int dmadst = 0;
-
-	spin_lock(&prtd->lock);
-	sunxi_dma_getcurposition(prtd->params,
-			 (dma_addr_t*)&dmasrc, (dma_addr_t*)&dmadst);
-
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		res = dmasrc + prtd->dma_period - prtd->dma_start;
-	}
-	else {
-	    	res = dmadst + prtd->dma_period - prtd->dma_start;
-		//res = dmadst - prtd->dma_start;
-	}
-	offset = bytes_to_frames(runtime, res);
-	spin_unlock(&prtd->lock);
-
-	if(offset >= runtime->buffer_size)
-		offset = 0;
-
-	return offset;
+	return sunxi_pcmdma_start_ring(substream);
 }
 
-
 static int sunxi_pcm_open(struct snd_pcm_substream *substream)
 {
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct sunxi_runtime_data *prtd;
-
-	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		snd_soc_set_runtime_hwparams(substream, &sunxi_pcm_out_hardware);
-	}
-	else {
-		snd_soc_set_runtime_hwparams(substream, &sunxi_pcm_in_hardware);
-	}
-
-	prtd = kzalloc(sizeof(struct sunxi_runtime_data), GFP_KERNEL);
-	if (prtd == NULL)
-		return -ENOMEM;
-
-	spin_lock_init(&prtd->lock);
-
-	runtime->private_data = prtd;
-	return 0;
-}
-
-static int sunxi_pcm_close(struct snd_pcm_substream *substream)
-{
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	struct sunxi_runtime_data *prtd = runtime->private_data;
-
-	kfree(prtd);
-
-	return 0;
-}
-
-static int sunxi_pcm_mmap(struct snd_pcm_substream *substream,
-	struct vm_area_struct *vma)
-{
-	struct snd_pcm_runtime *runtime = substream->runtime;
-
-	return dma_mmap_writecombine(substream->pcm->card->dev, vma,
-				     runtime->dma_area,
-				     runtime->dma_addr,
-				     runtime->dma_bytes);
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		return sunxi_pcmdma_open(substream, &sunxi_pcm_out_hardware);
+	else
+		return sunxi_pcmdma_open(substream, &sunxi_pcm_in_hardware);
 }
 
 static struct snd_pcm_ops sunxi_pcm_ops = {
 	.open			= sunxi_pcm_open,
-	.close			= sunxi_pcm_close,
+	.close			= sunxi_pcmdma_close,
 	.ioctl			= snd_pcm_lib_ioctl,
-	.hw_params		= sunxi_pcm_hw_params,
-	.hw_free		= sunxi_pcm_hw_free,
+	.hw_params		= sunxi_pcmdma_hw_params,
+	.hw_free		= sunxi_pcmdma_hw_free,
 	.prepare		= sunxi_pcm_prepare,
-	.trigger		= sunxi_pcm_trigger,
-	.pointer		= sunxi_pcm_pointer,
-	.mmap			= sunxi_pcm_mmap,
+	.trigger		= sunxi_pcmdma_trigger,
+	.pointer		= sunxi_pcmdma_pointer,
+	.mmap			= sunxi_pcmdma_mmap,
 };
 
-static int sunxi_pcm_preallocate_dma_buffer(struct snd_pcm *pcm, int stream)
-{
-	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
-	struct snd_dma_buffer *buf = &substream->dma_buffer;
-	size_t size = 0;
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		size = sunxi_pcm_out_hardware.buffer_bytes_max;
-	}
-	else {
-		size = sunxi_pcm_in_hardware.buffer_bytes_max;
-	}
-	buf->dev.type = SNDRV_DMA_TYPE_DEV;
-	buf->dev.dev = pcm->card->dev;
-	buf->private_data = NULL;
-	buf->area = dma_alloc_writecombine(pcm->card->dev, size,
-					   &buf->addr, GFP_KERNEL);
-
-	if (!buf->area)
-		return -ENOMEM;
-	buf->bytes = size;
-	return 0;
-}
-
-static void sunxi_pcm_free_dma_buffers(struct snd_pcm *pcm)
-{
-	struct snd_pcm_substream *substream;
-	struct snd_dma_buffer *buf;
-	int stream;
-
-	for (stream = 0; stream < 2; stream++) {
-		substream = pcm->streams[stream].substream;
-		if (!substream)
-			continue;
-
-		buf = &substream->dma_buffer;
-		if (!buf->area)
-			continue;
-
-		dma_free_writecombine(pcm->card->dev, buf->bytes,
-				      buf->area, buf->addr);
-		buf->area = NULL;
-	}
-}
-
-static u64 sunxi_pcm_mask = DMA_BIT_MASK(32);
-
 static int sunxi_pcm_new(struct snd_soc_pcm_runtime *rtd)
 {
-	struct snd_card *card = rtd->card->snd_card;
-	struct snd_pcm *pcm = rtd->pcm;
-	int ret = 0;
-	if (!card->dev->dma_mask)
-		card->dev->dma_mask = &sunxi_pcm_mask;
-	if (!card->dev->coherent_dma_mask)
-		card->dev->coherent_dma_mask = 0xffffffff;
-
-	if (pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream) {
-		ret = sunxi_pcm_preallocate_dma_buffer(pcm,
-			SNDRV_PCM_STREAM_PLAYBACK);
-		if (ret)
-			goto out;
-	}
-
-	if (pcm->streams[SNDRV_PCM_STREAM_CAPTURE].substream) {
-		ret = sunxi_pcm_preallocate_dma_buffer(pcm,
-			SNDRV_PCM_STREAM_CAPTURE);
-		if (ret)
-			goto out;
-	}
- out:
-	return ret;
+	return sunxi_pcmdma_new(rtd, sunxi_pcm_out_hardware.buffer_bytes_max,
+				sunxi_pcm_in_hardware.buffer_bytes_max);
 }
 
 static struct snd_soc_platform_driver sunxi_soc_platform = {
 	.ops		= &sunxi_pcm_ops,
 	.pcm_new	= sunxi_pcm_new,
-	.pcm_free	= sunxi_pcm_free_dma_buffers,
+	.pcm_free	= sunxi_pcmdma_free,
 };
 
 static int __devinit sunxi_i2s_pcm_probe(struct platform_device *pdev)
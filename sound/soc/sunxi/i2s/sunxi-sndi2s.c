@@ -28,10 +28,17 @@
 #include "sunxi-i2sdma.h"
 
 #include "sndi2s.h"
+#include "../sunxi-audioclk.h"
 
 /* slave mode flag*/
 static int sunxi_i2s_slave = 0;
 
+/* by stream, the pll is only ours in master mode */
+static struct sunxi_audioclk_user sndi2s_clk[2] = {
+	{ .name = "i2s playback" },
+	{ .name = "i2s capture" },
+};
+
 #ifdef ENFORCE_RATES
 static struct snd_pcm_hw_constraint_list hw_constraints_rates = {
 	.count	= ARRAY_SIZE(rates),
@@ -43,10 +50,11 @@ static struct snd_pcm_hw_constraint_list hw_constraints_rates = {
 static int sunxi_sndi2s_startup(struct snd_pcm_substream *substream)
 {
 	int ret = 0;
-	#ifdef ENFORCE_RATES
-		struct snd_pcm_runtime *runtime = substream->runtime;
-	#endif
+	struct snd_pcm_runtime *runtime = substream->runtime;
 
+	if (!sunxi_i2s_slave)
+		ret = sunxi_audioclk_constrain(runtime,
+					       &sndi2s_clk[substream->stream]);
 	if (!ret) {
 	#ifdef ENFORCE_RATES
 		ret = snd_pcm_hw_constraint_list(runtime, 0,
@@ -265,6 +273,13 @@ static int sunxi_sndi2s_hw_params(struct snd_pcm_substream *substream,
 	if (ret < 0)
 		return ret;
 
+	if (!sunxi_i2s_slave) {
+		ret = sunxi_audioclk_acquire(&sndi2s_clk[substream->stream],
+					     rate);
+		if (ret < 0)
+			return ret;
+	}
+
 	//call sunxi_iis_set_sysclk
 	ret = snd_soc_dai_set_sysclk(cpu_dai, 0 , mpll, 0);
 	if (ret < 0)
@@ -300,10 +315,17 @@ static int sunxi_sndi2s_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+static int sunxi_sndi2s_hw_free(struct snd_pcm_substream *substream)
+{
+	sunxi_audioclk_release(&sndi2s_clk[substream->stream]);
+	return 0;
+}
+
 static struct snd_soc_ops sunxi_sndi2s_ops = {
 	.startup 		= sunxi_sndi2s_startup,
 	.shutdown 		= sunxi_sndi2s_shutdown,
 	.hw_params 		= sunxi_sndi2s_hw_params,
+	.hw_free 		= sunxi_sndi2s_hw_free,
 };
 
 static struct snd_soc_dai_link sunxi_sndi2s_dai_link = {
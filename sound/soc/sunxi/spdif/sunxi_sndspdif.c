@@ -28,11 +28,26 @@
 #include "sunxi_spdma.h"
 
 #include "sndspdif.h"
+#include "../sunxi-audioclk.h"
 
 static struct clk *xtal;
 static int clk_users;
 static DEFINE_MUTEX(clk_lock);
 
+static struct sunxi_audioclk_user sndspdif_clk[2] = {
+	{ .name = "spdif playback" },
+	{ .name = "spdif capture" },
+};
+
+/*
+ * IEC61937 burst length in frames: 1536 for AC3 (DTS type I fits three
+ * times), 6144 covers E-AC3 and all DTS types. Bitstream periods are kept
+ * a multiple of it so a burst never straddles a period boundary.
+ */
+static unsigned int burst_frames = 1536;
+module_param(burst_frames, uint, 0644);
+MODULE_PARM_DESC(burst_frames, "Period step in frames for non-audio streams");
+
 #ifdef ENFORCE_RATES
 static struct snd_pcm_hw_constraint_list hw_constraints_rates = {
 	.count	= ARRAY_SIZE(rates),
@@ -44,9 +59,20 @@ static struct snd_pcm_hw_constraint_list hw_constraints_rates = {
 static int sunxi_sndspdif_startup(struct snd_pcm_substream *substream)
 {
 	int ret = 0;
-	#ifdef ENFORCE_RATES
-		struct snd_pcm_runtime *runtime = substream->runtime;
-	#endif
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	ret = sunxi_audioclk_constrain(runtime,
+				       &sndspdif_clk[substream->stream]);
+	if (ret < 0)
+		return ret;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+	    sunxi_spdif_get_nonaudio() && burst_frames) {
+		ret = snd_pcm_hw_constraint_step(runtime, 0,
+				SNDRV_PCM_HW_PARAM_PERIOD_SIZE, burst_frames);
+		if (ret < 0)
+			return ret;
+	}
 	if (!ret) {
 	#ifdef ENFORCE_RATES
 		ret = snd_pcm_hw_constraint_list(runtime, 0, SNDRV_PCM_HW_PARAM_RATE, &hw_constraints_rates);
@@ -184,7 +210,11 @@ static int sunxi_sndspdif_hw_params(struct snd_pcm_substream *substream,
 	if (ret < 0)
 		return ret;
 
-	ret = snd_soc_dai_set_fmt(cpu_dai, 0);
+	ret = snd_soc_dai_set_fmt(cpu_dai, sunxi_spdif_get_nonaudio());
+	if (ret < 0)
+		return ret;
+
+	ret = sunxi_audioclk_acquire(&sndspdif_clk[substream->stream], rate);
 	if (ret < 0)
 		return ret;
 
@@ -211,10 +241,17 @@ static int sunxi_sndspdif_hw_params(struct snd_pcm_substream *substream,
 	return 0;
 }
 
+static int sunxi_sndspdif_hw_free(struct snd_pcm_substream *substream)
+{
+	sunxi_audioclk_release(&sndspdif_clk[substream->stream]);
+	return 0;
+}
+
 static struct snd_soc_ops sunxi_sndspdif_ops = {
 	.startup 	= sunxi_sndspdif_startup,
 	.shutdown 	= sunxi_sndspdif_shutdown,
 	.hw_params 	= sunxi_sndspdif_hw_params,
+	.hw_free 	= sunxi_sndspdif_hw_free,
 };
 
 static struct snd_soc_dai_link sunxi_sndspdif_dai_link = {
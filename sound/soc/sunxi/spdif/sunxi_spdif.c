@@ -26,6 +26,7 @@
 #include <sound/pcm_params.h>
 #include <sound/initval.h>
 #include <sound/soc.h>
+#include <sound/asoundef.h>
 
 #include <mach/clock.h>
 #include <plat/sys_config.h>
@@ -59,6 +60,18 @@ struct sunxi_spdif_info sunxi_spdif;
 static u32 spdif_handle = 0;
 static struct clk *spdif_apbclk, *spdif_pll2clk, *spdif_pllx8, *spdif_moduleclk;
 
+/*
+ * Consumer channel status bytes 0-2 set through "IEC958 Playback Default",
+ * TXCHSTA0 has them in the same layout. Byte 3, the sample frequency, is
+ * filled in by set_clkdiv from the stream rate.
+ */
+static DEFINE_SPINLOCK(spdif_status_lock);
+static unsigned char spdif_status[3] = {
+	IEC958_AES0_CON_NOT_COPYRIGHT | IEC958_AES0_CON_EMPHASIS_NONE,
+	IEC958_AES1_CON_ORIGINAL | IEC958_AES1_CON_PCM_CODER,
+	0,
+};
+
 void sunxi_snd_txctrl(struct snd_pcm_substream *substream, int on)
 {
 	u32 reg_val;
@@ -70,7 +83,11 @@ void sunxi_snd_txctrl(struct snd_pcm_substream *substream, int on)
 	else {
 		reg_val &= ~SUNXI_SPDIF_TXCFG_SINGLEMOD;
 	}
-	reg_val |= SUNXI_SPDIF_TXCFG_ASS;	//Sending the last audio (may be 0?)
+	/* repeating the last word on underrun would corrupt a bitstream */
+	if (reg_val & SUNXI_SPDIF_TXCFG_NONAUDIO)
+		reg_val &= ~SUNXI_SPDIF_TXCFG_ASS;
+	else
+		reg_val |= SUNXI_SPDIF_TXCFG_ASS;	//Sending the last audio (may be 0?)
 	reg_val |= SUNXI_SPDIF_TXCFG_CHSTMODE;	//Channel status A&B generated form TX_CHSTA
 	writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
 
@@ -157,39 +174,55 @@ static inline int sunxi_snd_is_clkmaster(void)
 	return 0;
 }
 
+/* non-zero when userspace marked the channel status as non-audio */
+int sunxi_spdif_get_nonaudio(void)
+{
+	return !!(spdif_status[0] & IEC958_AES0_NONAUDIO);
+}
+EXPORT_SYMBOL_GPL(sunxi_spdif_get_nonaudio);
+
+/*
+ * fmt is 0 for linear PCM and non-zero for an IEC61937 bitstream: the
+ * controller then sends the validity bit set for every sample. There is
+ * no burst packer in the OWA, the Pa/Pb/Pc/Pd preambles come in the
+ * data from userspace.
+ */
 static int sunxi_spdif_set_fmt(struct snd_soc_dai *cpu_dai, unsigned int fmt)
 {
 	u32 reg_val;
+	unsigned long flags;
 
-	if (!fmt) {//PCM
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
+	reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
+	if (!fmt)
 		reg_val &= ~SUNXI_SPDIF_TXCFG_NONAUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
-
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
-		reg_val |= (SUNXI_SPDIF_TXCHSTA0_CHNUM(2));
-		reg_val &= ~SUNXI_SPDIF_TXCHSTA0_AUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
-
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
-		reg_val |= (SUNXI_SPDIF_RXCHSTA0_CHNUM(2));
-		reg_val &= ~SUNXI_SPDIF_RXCHSTA0_AUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
-	} else {  //non PCM
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
+	else
 		reg_val |= SUNXI_SPDIF_TXCFG_NONAUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
+	writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
 
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
-		reg_val |= (SUNXI_SPDIF_TXCHSTA0_CHNUM(2));
+	reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
+	reg_val &= ~0xffffff;
+	spin_lock_irqsave(&spdif_status_lock, flags);
+	reg_val |= spdif_status[0] | (spdif_status[1] << 8) |
+			(spdif_status[2] << 16);
+	spin_unlock_irqrestore(&spdif_status_lock, flags);
+	/* consumer format, the AUDIO bit follows the stream type */
+	reg_val &= ~(SUNXI_SPDIF_TXCHSTA0_PRO | SUNXI_SPDIF_TXCHSTA0_AUDIO);
+	if (fmt) {
 		reg_val |= SUNXI_SPDIF_TXCHSTA0_AUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
+		/* no pre-emphasis on a bitstream */
+		reg_val &= ~SUNXI_SPDIF_TXCHSTA0_EMPHASIS(7);
+	}
+	if (!(reg_val & SUNXI_SPDIF_TXCHSTA0_CHNUM(0xf)))
+		reg_val |= SUNXI_SPDIF_TXCHSTA0_CHNUM(2);
+	writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA0);
 
-		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
-		reg_val |= (SUNXI_SPDIF_RXCHSTA0_CHNUM(2));
+	reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
+	reg_val |= (SUNXI_SPDIF_RXCHSTA0_CHNUM(2));
+	if (!fmt)
+		reg_val &= ~SUNXI_SPDIF_RXCHSTA0_AUDIO;
+	else
 		reg_val |= SUNXI_SPDIF_RXCHSTA0_AUDIO;
-		writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
-	}
+	writel(reg_val, sunxi_spdif.regs + SUNXI_SPDIF_RXCHSTA0);
 
 	return 0;
 }
@@ -224,6 +257,11 @@ static int sunxi_spdif_hw_params(struct snd_pcm_substream *substream,
 	if(substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		dma_data = &sunxi_spdif_stereo_out;
 
+		/* IEC61937 carries 16 bit words on both subframes */
+		if (sunxi_spdif_get_nonaudio() &&
+		    (format != 16 || params_channels(params) != 2))
+			return -EINVAL;
+
 		reg_val1 = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCHSTA1);
 		reg_val = readl(sunxi_spdif.regs + SUNXI_SPDIF_TXCFG);
 		reg_val &= ~SUNXI_SPDIF_TXCFG_FMTRVD;
@@ -318,15 +356,10 @@ static int sunxi_spdif_trigger(struct snd_pcm_substream *substream,
 }
 
 //freq:   1: 22.5792MHz   0: 24.576MHz
+//the machine driver already got the pll at that rate from sunxi-audioclk
 static int sunxi_spdif_set_sysclk(struct snd_soc_dai *cpu_dai, int clk_id,
                                  unsigned int freq, int dir)
 {
-	if (!freq) {
-		clk_set_rate(spdif_pll2clk, 24576000);
-	} else {
-		clk_set_rate(spdif_pll2clk, 22579200);
-	}
-
 	return 0;
 }
 
@@ -475,10 +508,77 @@ u32 sunxi_spdif_get_clockrate(void)
 }
 EXPORT_SYMBOL_GPL(sunxi_spdif_get_clockrate);
 
-static int sunxi_spdif_dai_probe(struct snd_soc_dai *dai)
+static int sunxi_spdif_status_info(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_IEC958;
+	uinfo->count = 1;
+	return 0;
+}
+
+static int sunxi_spdif_status_get(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_value *ucontrol)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&spdif_status_lock, flags);
+	memcpy(ucontrol->value.iec958.status, spdif_status,
+	       sizeof(spdif_status));
+	spin_unlock_irqrestore(&spdif_status_lock, flags);
+	return 0;
+}
+
+static int sunxi_spdif_status_put(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_value *ucontrol)
+{
+	unsigned long flags;
+	int changed;
+
+	/* picked up by the next hw_params */
+	spin_lock_irqsave(&spdif_status_lock, flags);
+	changed = memcmp(spdif_status, ucontrol->value.iec958.status,
+			 sizeof(spdif_status)) != 0;
+	memcpy(spdif_status, ucontrol->value.iec958.status,
+	       sizeof(spdif_status));
+	spin_unlock_irqrestore(&spdif_status_lock, flags);
+	return changed;
+}
+
+static int sunxi_spdif_mask_get(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_value *ucontrol)
 {
+	ucontrol->value.iec958.status[0] = IEC958_AES0_NONAUDIO |
+			IEC958_AES0_CON_NOT_COPYRIGHT |
+			IEC958_AES0_CON_EMPHASIS;
+	ucontrol->value.iec958.status[1] = IEC958_AES1_CON_CATEGORY |
+			IEC958_AES1_CON_ORIGINAL;
+	ucontrol->value.iec958.status[2] = IEC958_AES2_CON_SOURCE |
+			IEC958_AES2_CON_CHANNEL;
 	return 0;
 }
+
+static const struct snd_kcontrol_new sunxi_spdif_controls[] = {
+	{
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM,
+		.name = SNDRV_CTL_NAME_IEC958("", PLAYBACK, DEFAULT),
+		.info = sunxi_spdif_status_info,
+		.get = sunxi_spdif_status_get,
+		.put = sunxi_spdif_status_put,
+	},
+	{
+		.access = SNDRV_CTL_ELEM_ACCESS_READ,
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM,
+		.name = SNDRV_CTL_NAME_IEC958("", PLAYBACK, CON_MASK),
+		.info = sunxi_spdif_status_info,
+		.get = sunxi_spdif_mask_get,
+	},
+};
+
+static int sunxi_spdif_dai_probe(struct snd_soc_dai *dai)
+{
+	return snd_soc_add_dai_controls(dai, sunxi_spdif_controls,
+					ARRAY_SIZE(sunxi_spdif_controls));
+}
 static int sunxi_spdif_dai_remove(struct snd_soc_dai *dai)
 {
 	return 0;
@@ -161,6 +161,7 @@ struct sunxi_spdif_info {
 extern struct sunxi_spdif_info sunxi_spdif;
 
 unsigned int sunxi_spdif_get_clockrate(void);
+extern int sunxi_spdif_get_nonaudio(void);
 
 extern void sunxi_snd_txctrl(struct snd_pcm_substream *substream, int on);
 extern void sunxi_snd_rxctrl(struct snd_pcm_substream *substream, int on);
@@ -0,0 +1,165 @@
+/*
+ * sound\soc\sunxi\sunxi-audioclk.c
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * audio pll arbiter shared by the codec, i2s, spdif and hdmi audio
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+
+#include "sunxi-audioclk.h"
+
+static struct clk *audioclk_pll;
+static DEFINE_MUTEX(audioclk_lock);
+static enum sunxi_audioclk_family audioclk_family;
+static int audioclk_users;
+
+static const unsigned long audioclk_pll_rate[] = {
+	[SUNXI_AUDIOCLK_48K]	= 24576000,
+	[SUNXI_AUDIOCLK_44K1]	= 22579200,
+};
+
+static unsigned int audioclk_rates_48k[] = {
+	8000, 12000, 16000, 24000, 32000, 48000, 96000, 192000,
+};
+
+static unsigned int audioclk_rates_44k1[] = {
+	11025, 22050, 44100, 88200, 176400,
+};
+
+static struct snd_pcm_hw_constraint_list audioclk_constraints[] = {
+	[SUNXI_AUDIOCLK_48K] = {
+		.count	= ARRAY_SIZE(audioclk_rates_48k),
+		.list	= audioclk_rates_48k,
+	},
+	[SUNXI_AUDIOCLK_44K1] = {
+		.count	= ARRAY_SIZE(audioclk_rates_44k1),
+		.list	= audioclk_rates_44k1,
+	},
+};
+
+enum sunxi_audioclk_family sunxi_audioclk_family(unsigned int rate)
+{
+	return (rate % 11025) == 0 ? SUNXI_AUDIOCLK_44K1 : SUNXI_AUDIOCLK_48K;
+}
+EXPORT_SYMBOL_GPL(sunxi_audioclk_family);
+
+/*
+ * Take the pll for a stream at rate, from hw_params. Calling it again
+ * for the same user moves it to the new family if nobody else holds
+ * the pll.
+ */
+int sunxi_audioclk_acquire(struct sunxi_audioclk_user *user,
+			   unsigned int rate)
+{
+	enum sunxi_audioclk_family family = sunxi_audioclk_family(rate);
+	int ret = 0;
+
+	mutex_lock(&audioclk_lock);
+
+	if (user->family == family)
+		goto out;
+
+	if (user->family != SUNXI_AUDIOCLK_NONE) {
+		user->family = SUNXI_AUDIOCLK_NONE;
+		audioclk_users--;
+	}
+
+	if (audioclk_users && audioclk_family != family) {
+		pr_info("sunxi-audioclk: %s can't run at %u, pll is held at %lu\n",
+			user->name, rate, audioclk_pll_rate[audioclk_family]);
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (!audioclk_users && audioclk_family != family) {
+		if (!IS_ERR_OR_NULL(audioclk_pll) &&
+		    clk_get_rate(audioclk_pll) != audioclk_pll_rate[family] &&
+		    clk_set_rate(audioclk_pll, audioclk_pll_rate[family])) {
+			pr_err("sunxi-audioclk: set pll to %lu failed\n",
+			       audioclk_pll_rate[family]);
+			ret = -EIO;
+			goto out;
+		}
+		audioclk_family = family;
+	}
+
+	user->family = family;
+	audioclk_users++;
+out:
+	mutex_unlock(&audioclk_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sunxi_audioclk_acquire);
+
+/* from hw_free, the pll keeps its rate for whoever comes next */
+void sunxi_audioclk_release(struct sunxi_audioclk_user *user)
+{
+	mutex_lock(&audioclk_lock);
+	if (user->family != SUNXI_AUDIOCLK_NONE) {
+		user->family = SUNXI_AUDIOCLK_NONE;
+		audioclk_users--;
+	}
+	mutex_unlock(&audioclk_lock);
+}
+EXPORT_SYMBOL_GPL(sunxi_audioclk_release);
+
+/* from open, limit the rates to the family others hold the pll at */
+int sunxi_audioclk_constrain(struct snd_pcm_runtime *runtime,
+			     struct sunxi_audioclk_user *user)
+{
+	enum sunxi_audioclk_family family = SUNXI_AUDIOCLK_NONE;
+
+	mutex_lock(&audioclk_lock);
+	if (audioclk_users > (user->family != SUNXI_AUDIOCLK_NONE))
+		family = audioclk_family;
+	mutex_unlock(&audioclk_lock);
+
+	if (family == SUNXI_AUDIOCLK_NONE)
+		return 0;
+
+	return snd_pcm_hw_constraint_list(runtime, 0, SNDRV_PCM_HW_PARAM_RATE,
+					  &audioclk_constraints[family]);
+}
+EXPORT_SYMBOL_GPL(sunxi_audioclk_constrain);
+
+static int __init sunxi_audioclk_init(void)
+{
+	audioclk_pll = clk_get(NULL, "audio_pll");
+	if (IS_ERR(audioclk_pll)) {
+		pr_err("sunxi-audioclk: no audio_pll\n");
+		return PTR_ERR(audioclk_pll);
+	}
+
+	audioclk_family = clk_get_rate(audioclk_pll) ==
+			audioclk_pll_rate[SUNXI_AUDIOCLK_44K1] ?
+			SUNXI_AUDIOCLK_44K1 : SUNXI_AUDIOCLK_48K;
+	return 0;
+}
+
+static void __exit sunxi_audioclk_exit(void)
+{
+	clk_put(audioclk_pll);
+}
+
+subsys_initcall(sunxi_audioclk_init);
+module_exit(sunxi_audioclk_exit);
+
+MODULE_AUTHOR("All winner");
+MODULE_DESCRIPTION("SUNXI audio pll arbiter");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,43 @@
+/*
+ * sound\soc\sunxi\sunxi-audioclk.h
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+#ifndef SUNXI_AUDIOCLK_H_
+#define SUNXI_AUDIOCLK_H_
+
+#include <sound/pcm.h>
+
+/*
+ * The codec, i2s, spdif and hdmi audio all run from the one audio pll,
+ * 24.576MHz for the 48kHz rates and 22.5792MHz for the 44.1kHz ones.
+ * Each stream holds the family it runs at from hw_params to hw_free;
+ * the pll is only reprogrammed when nobody else holds it, a stream of
+ * the other family gets -EBUSY, and streams opened while the pll is
+ * held only see the rates of its family, so alsa-lib resamples.
+ */
+enum sunxi_audioclk_family {
+	SUNXI_AUDIOCLK_NONE = 0,
+	SUNXI_AUDIOCLK_48K,	/* 24.576MHz */
+	SUNXI_AUDIOCLK_44K1,	/* 22.5792MHz */
+};
+
+struct sunxi_audioclk_user {
+	const char *name;
+	enum sunxi_audioclk_family family;	/* held, or NONE */
+};
+
+extern enum sunxi_audioclk_family sunxi_audioclk_family(unsigned int rate);
+extern int sunxi_audioclk_acquire(struct sunxi_audioclk_user *user,
+				  unsigned int rate);
+extern void sunxi_audioclk_release(struct sunxi_audioclk_user *user);
+extern int sunxi_audioclk_constrain(struct snd_pcm_runtime *runtime,
+				    struct sunxi_audioclk_user *user);
+
+#endif /* SUNXI_AUDIOCLK_H_ */
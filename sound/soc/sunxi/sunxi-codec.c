@@ -18,6 +18,7 @@
 #include <linux/ioctl.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/mutex.h>
 #include <asm/io.h>
 #include <plat/dma_compat.h>
 #ifdef CONFIG_PM
@@ -31,6 +32,7 @@
 #include <linux/clk.h>
 #include <linux/timer.h>
 #include "sunxi-codec.h"
+#include "sunxi-audioclk.h"
 #include <plat/sys_config.h>
 #include <mach/system.h>
 
@@ -39,10 +41,34 @@ static int has_playback, has_capture;
 static int gpio_pa_shutdown = 0;
 struct clk *codec_apbclk,*codec_pll2clk,*codec_moduleclk;
 
-static volatile unsigned int capture_dmasrc = 0;
-static volatile unsigned int capture_dmadst = 0;
-static volatile unsigned int play_dmasrc = 0;
-static volatile unsigned int play_dmadst = 0;
+/*
+ * Low latency playback: periods down to 256 bytes, the whole ring queued
+ * on the DMA in continuous mode so it never waits on the irq to reload.
+ */
+static bool low_latency;
+module_param(low_latency, bool, 0644);
+MODULE_PARM_DESC(low_latency, "Small periods and continuous DMA for playback");
+
+#define LOW_LATENCY_PERIOD_BYTES_MIN	256
+
+/*
+ * Playback and capture run off the same pll2 and module clock, so while
+ * one direction is configured the other is held to its rate and the pll
+ * is never retuned under it. Register updates from both directions and
+ * from the mixer go through codec_reg_lock.
+ */
+static DEFINE_SPINLOCK(codec_reg_lock);
+static DEFINE_MUTEX(codec_rate_lock);
+static unsigned int codec_rate[2];	/* by stream, 0 when not configured */
+static struct sunxi_audioclk_user codec_clk[2] = {
+	{ .name = "codec playback" },
+	{ .name = "codec capture" },
+};
+
+/* capture the output mixer instead of the inputs, for echo cancellation */
+#define ADC_SELECT_OUTPUT_MIXER	6
+static int codec_loopback;
+static unsigned int codec_adc_select;	/* input mux saved over loopback */
 
 /* Structure/enum declaration ------------------------------- */
 typedef struct codec_board_info {
@@ -176,7 +202,9 @@ int codec_wrreg_bits(unsigned short reg, unsigned int	mask,	unsigned int value)
 {
 	int change;
 	unsigned int old, new;
+	unsigned long flags;
 
+	spin_lock_irqsave(&codec_reg_lock, flags);
 	old	=	codec_rdreg(reg);
 	new	=	(old & ~mask) | value;
 	change = old != new;
@@ -184,6 +212,7 @@ int codec_wrreg_bits(unsigned short reg, unsigned int	mask,	unsigned int value)
 	if (change){
 		codec_wrreg(reg,new);
 	}
+	spin_unlock_irqrestore(&codec_reg_lock, flags);
 
 	return change;
 }
@@ -576,6 +605,50 @@ static const struct snd_kcontrol_new sun7i_adc_ctls[] = {
 	CODEC_SINGLE("Mic1 gain Volume", SUNXI_MIC_CRT, 29, 3, 0),
 };
 
+/*
+ * Capture Loopback Switch: the ADC records the output mixer, with the dac
+ * mixed in, so echo cancellation gets what is played next to the mic.
+ * The input mux is put back when it goes off.
+ */
+static int codec_loopback_get(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = codec_loopback;
+	return 0;
+}
+
+static int codec_loopback_put(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	int on = !!ucontrol->value.integer.value[0];
+
+	if (on == codec_loopback)
+		return 0;
+
+	if (on) {
+		codec_adc_select = (codec_rdreg(SUNXI_ADC_ACTL) >> ADC_SELECT) & 0x7;
+		codec_wr_control(SUNXI_DAC_ACTL, 0x1, MIXEN, 0x1);
+		codec_wr_control(SUNXI_DAC_ACTL, 0x1, 15, 0x1);	/* ldac to left mixer */
+		codec_wr_control(SUNXI_DAC_ACTL, 0x1, 14, 0x1);	/* rdac to right mixer */
+		codec_wr_control(SUNXI_ADC_ACTL, 0x7, ADC_SELECT,
+				 ADC_SELECT_OUTPUT_MIXER);
+	} else {
+		codec_wr_control(SUNXI_ADC_ACTL, 0x7, ADC_SELECT,
+				 codec_adc_select);
+	}
+	codec_loopback = on;
+
+	return 1;
+}
+
+static const struct snd_kcontrol_new codec_loopback_control = {
+	.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+	.name	= "Capture Loopback Switch",
+	.info	= snd_ctl_boolean_mono_info,
+	.get	= codec_loopback_get,
+	.put	= codec_loopback_put,
+};
+
 int __devinit snd_chip_codec_mixer_new(struct snd_card *card)
 {
   	/*
@@ -628,6 +701,10 @@ int __devinit snd_chip_codec_mixer_new(struct snd_card *card)
 		return -1;
 	}
 
+	if (has_playback && has_capture)
+		if ((err = snd_ctl_add(card, snd_ctl_new1(&codec_loopback_control, clnt))) < 0)
+			return err;
+
 	/*
 	*	当card被创建后，设备（组件）能够被创建并关联于该card。第一个参数是snd_card_create
 	*	创建的card指针，第二个参数type指的是device-level即设备类型，形式为SNDRV_DEV_XXX,包括
@@ -736,34 +813,37 @@ static void sunxi_audio_play_buffdone(struct sunxi_dma_params *dma,
 	spin_unlock(&play_prtd->lock);
 }
 
+/*
+ * The pointer comes from the byte counter of the running segment, so it
+ * moves inside a period instead of jumping from one buffdone to the next.
+ */
 static snd_pcm_uframes_t snd_sunxi_codec_pointer(struct snd_pcm_substream *substream)
 {
 	unsigned long play_res = 0, capture_res = 0;
 	struct sunxi_playback_runtime_data *play_prtd = NULL;
 	struct sunxi_capture_runtime_data *capture_prtd = NULL;
+	dma_addr_t src = 0, dst = 0;
+	unsigned long bytes = snd_pcm_lib_buffer_bytes(substream);
+
     if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK){
     	play_prtd = substream->runtime->private_data;
    		spin_lock(&play_prtd->lock);
-   		sunxi_dma_getcurposition(play_prtd->params,
-   			(dma_addr_t*)&play_dmasrc, (dma_addr_t*)&play_dmadst);
-		play_res = play_dmasrc + play_prtd->dma_period - play_prtd->dma_start;
+		if (sunxi_dma_getrunposition(play_prtd->params,
+				play_prtd->dma_period, &src, &dst) == 0)
+			play_res = src - play_prtd->dma_start;
 		spin_unlock(&play_prtd->lock);
-		if (play_res >= snd_pcm_lib_buffer_bytes(substream)) {
-			if (play_res == snd_pcm_lib_buffer_bytes(substream))
-				play_res = 0;
-		}
+		if (play_res >= bytes)
+			play_res = (play_res == bytes) ? 0 : play_res % bytes;
 		return bytes_to_frames(substream->runtime, play_res);
     }else{
     	capture_prtd = substream->runtime->private_data;
     	spin_lock(&capture_prtd->lock);
-		sunxi_dma_getcurposition(capture_prtd->params,
-		   (dma_addr_t*)&capture_dmasrc, (dma_addr_t*)&capture_dmadst);
-    	capture_res = capture_dmadst + capture_prtd->dma_period - capture_prtd->dma_start;
+		if (sunxi_dma_getrunposition(capture_prtd->params,
+				capture_prtd->dma_period, &src, &dst) == 0)
+			capture_res = dst - capture_prtd->dma_start;
     	spin_unlock(&capture_prtd->lock);
-    	if (capture_res >= snd_pcm_lib_buffer_bytes(substream)) {
-			if (capture_res == snd_pcm_lib_buffer_bytes(substream))
-				capture_res = 0;
-		}
+		if (capture_res >= bytes)
+			capture_res = (capture_res == bytes) ? 0 : capture_res % bytes;
 		return bytes_to_frames(substream->runtime, capture_res);
     }
 }
@@ -775,6 +855,24 @@ static int sunxi_codec_pcm_hw_params(struct snd_pcm_substream *substream, struct
     struct sunxi_playback_runtime_data *play_prtd = NULL;
     struct sunxi_capture_runtime_data *capture_prtd = NULL;
     unsigned long play_totbytes = 0, capture_totbytes = 0;
+	int other = substream->stream == SNDRV_PCM_STREAM_PLAYBACK ?
+			SNDRV_PCM_STREAM_CAPTURE : SNDRV_PCM_STREAM_PLAYBACK;
+	int ret;
+
+	mutex_lock(&codec_rate_lock);
+	if (codec_rate[other] && codec_rate[other] != params_rate(params)) {
+		mutex_unlock(&codec_rate_lock);
+		return -EBUSY;
+	}
+	ret = sunxi_audioclk_acquire(&codec_clk[substream->stream],
+				     params_rate(params));
+	if (ret < 0) {
+		mutex_unlock(&codec_rate_lock);
+		return ret;
+	}
+	codec_rate[substream->stream] = params_rate(params);
+	mutex_unlock(&codec_rate_lock);
+
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK){
 	  	play_runtime = substream->runtime;
 		play_prtd = play_runtime->private_data;
@@ -799,11 +897,11 @@ static int sunxi_codec_pcm_hw_params(struct snd_pcm_substream *substream, struct
 			play_runtime->dma_bytes = play_totbytes;
    			spin_lock_irq(&play_prtd->lock);
 			play_prtd->dma_loaded = 0;
-			play_prtd->dma_limit = play_runtime->hw.periods_min;
+			play_prtd->dma_limit = low_latency ? params_periods(params) :
+						play_runtime->hw.periods_min;
 			play_prtd->dma_period = params_period_bytes(params);
 			play_prtd->dma_start = play_runtime->dma_addr;
 
-			play_dmasrc = play_prtd->dma_start;
 			play_prtd->dma_pos = play_prtd->dma_start;
 			play_prtd->dma_end = play_prtd->dma_start + play_totbytes;
 
@@ -837,7 +935,6 @@ static int sunxi_codec_pcm_hw_params(struct snd_pcm_substream *substream, struct
 			capture_prtd->dma_period = params_period_bytes(params);
 			capture_prtd->dma_start = capture_runtime->dma_addr;
 
-			capture_dmadst = capture_prtd->dma_start;
 			capture_prtd->dma_pos = capture_prtd->dma_start;
 			capture_prtd->dma_end = capture_prtd->dma_start + capture_totbytes;
 
@@ -854,6 +951,11 @@ static int snd_sunxi_codec_hw_free(struct snd_pcm_substream *substream)
 	struct sunxi_playback_runtime_data *play_prtd = NULL;
 	struct sunxi_capture_runtime_data *capture_prtd = NULL;
 
+	mutex_lock(&codec_rate_lock);
+	codec_rate[substream->stream] = 0;
+	sunxi_audioclk_release(&codec_clk[substream->stream]);
+	mutex_unlock(&codec_rate_lock);
+
    	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK){
  		play_prtd = substream->runtime->private_data;
 		if(play_prtd->params)
@@ -886,6 +988,16 @@ static int snd_sunxi_codec_hw_free(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+/*
+ * The pll itself is set by sunxi-audioclk in hw_params, only the
+ * module clock follows it here, if the other way hasn't done it yet.
+ */
+static void codec_set_pll(unsigned long rate)
+{
+	if (clk_get_rate(codec_moduleclk) != rate)
+		clk_set_rate(codec_moduleclk, rate);
+}
+
 static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 {
 #if defined CONFIG_ARCH_SUN4I || defined CONFIG_ARCH_SUN5I
@@ -902,8 +1014,7 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 	if(substream->stream == SNDRV_PCM_STREAM_PLAYBACK){
 		switch(substream->runtime->rate){
 			case 44100:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
@@ -911,88 +1022,77 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 
 				break;
 			case 22050:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(2<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 11025:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(4<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 48000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 96000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(7<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 192000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(6<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 32000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(1<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 24000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(2<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 16000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(3<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 12000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(4<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			case 8000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(5<<29);
 				writel(reg_val, baseaddr + SUNXI_DAC_FIFOC);
 				break;
 			default:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_DAC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
@@ -1020,8 +1120,7 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 	}else{
 		switch(substream->runtime->rate){
 			case 44100:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
@@ -1029,72 +1128,63 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 
 				break;
 			case 22050:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(2<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 11025:
-				clk_set_rate(codec_pll2clk, 22579200);
-				clk_set_rate(codec_moduleclk, 22579200);
+				codec_set_pll(22579200);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(4<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 48000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 32000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(1<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 24000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(2<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 16000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(3<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 12000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(4<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			case 8000:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(5<<29);
 				writel(reg_val, baseaddr + SUNXI_ADC_FIFOC);
 				break;
 			default:
-				clk_set_rate(codec_pll2clk, 24576000);
-				clk_set_rate(codec_moduleclk, 24576000);
+				codec_set_pll(24576000);
 				reg_val = readl(baseaddr + SUNXI_ADC_FIFOC);
 				reg_val &=~(7<<29);
 				reg_val |=(0<<29);
@@ -1134,7 +1224,7 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 		codec_play_dma_conf.xfer_type    = DMAXFER_D_BHALF_S_BHALF;
 		codec_play_dma_conf.address_type = DMAADDRT_D_FIX_S_INC;
 		codec_play_dma_conf.dir          = SW_DMA_WDEV;
-		codec_play_dma_conf.reload       = 0;
+		codec_play_dma_conf.reload       = low_latency;
 		codec_play_dma_conf.hf_irq       = SW_DMA_IRQ_FULL;
 		codec_play_dma_conf.from         = play_prtd->dma_start;
 		codec_play_dma_conf.to           = play_prtd->params->dma_addr;
@@ -1148,7 +1238,7 @@ static int snd_sunxi_codec_prepare(struct	snd_pcm_substream	*substream)
 		codec_play_dma_conf.address_type.dst_addr_mode 	= NDMA_ADDR_NOCHANGE;
 		codec_play_dma_conf.src_drq_type		= N_SRC_SDRAM;
 		codec_play_dma_conf.dst_drq_type		= N_DST_AUDIO_CODEC_DA;
-		codec_play_dma_conf.bconti_mode			= false;
+		codec_play_dma_conf.bconti_mode			= low_latency;
 		codec_play_dma_conf.irq_spt			= CHAN_IRQ_FD;
 #endif
 		play_ret = sunxi_dma_config(play_prtd->params,
@@ -1284,6 +1374,30 @@ static int snd_sunxi_codec_trigger(struct snd_pcm_substream *substream, int cmd)
 	return 0;
 }
 
+/* full duplex: hold a new stream to the rate the other direction runs at */
+static int codec_constrain_rate(struct snd_pcm_substream *substream)
+{
+	int other = substream->stream == SNDRV_PCM_STREAM_PLAYBACK ?
+			SNDRV_PCM_STREAM_CAPTURE : SNDRV_PCM_STREAM_PLAYBACK;
+	unsigned int rate;
+	int ret;
+
+	/* and to the rate family i2s, spdif or hdmi hold the pll at */
+	ret = sunxi_audioclk_constrain(substream->runtime,
+				       &codec_clk[substream->stream]);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&codec_rate_lock);
+	rate = codec_rate[other];
+	mutex_unlock(&codec_rate_lock);
+
+	if (!rate)
+		return 0;
+	return snd_pcm_hw_constraint_minmax(substream->runtime,
+					    SNDRV_PCM_HW_PARAM_RATE, rate, rate);
+}
+
 static int snd_sunxicard_capture_open(struct snd_pcm_substream *substream)
 {
 	/*获得PCM运行时信息指针*/
@@ -1306,6 +1420,8 @@ static int snd_sunxicard_capture_open(struct snd_pcm_substream *substream)
 		return err;
 	if ((err = snd_pcm_hw_constraint_list(runtime, 0, SNDRV_PCM_HW_PARAM_RATE, &hw_constraints_rates)) < 0)
 		return err;
+	if ((err = codec_constrain_rate(substream)) < 0)
+		return err;
 
 	return 0;
 }
@@ -1333,12 +1449,18 @@ static int snd_sunxicard_playback_open(struct snd_pcm_substream *substream)
 	runtime->private_data = play_prtd;
 
 	runtime->hw = sunxi_pcm_playback_hardware;
+	if (low_latency) {
+		runtime->hw.period_bytes_min = LOW_LATENCY_PERIOD_BYTES_MIN;
+		runtime->hw.periods_min = 2;
+	}
 
 	/* ensure that buffer size is a multiple of period size */
 	if ((err = snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS)) < 0)
 		return err;
 	if ((err = snd_pcm_hw_constraint_list(runtime, 0, SNDRV_PCM_HW_PARAM_RATE, &hw_constraints_rates)) < 0)
 		return err;
+	if ((err = codec_constrain_rate(substream)) < 0)
+		return err;
 
 	return 0;
 }
@@ -1705,6 +1827,8 @@ static int __init sunxi_codec_init(void)
 	ret = platform_device_register(&sunxi_device_codec);
 	if (ret < 0)
 		return ret;
+	/* the codec and its card don't depend on other devices */
+	device_enable_async_suspend(&sunxi_device_codec.dev);
 
 	ret = platform_driver_register(&sunxi_codec_driver);
 	if (ret < 0) {
@@ -0,0 +1,321 @@
+/*
+ * sound\soc\sunxi\sunxi-pcmdma.c
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * PCM DMA ring shared by the i2s and spdif platform drivers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/dma-mapping.h>
+
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+
+#include "sunxi-pcmdma.h"
+
+static void sunxi_pcmdma_enqueue(struct snd_pcm_substream *substream)
+{
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
+	dma_addr_t pos = prtd->dma_pos;
+	unsigned long len = prtd->dma_period;
+	int read = substream->stream == SNDRV_PCM_STREAM_PLAYBACK ? 0 : 1;
+
+	while (prtd->dma_loaded < prtd->dma_limit) {
+		if ((pos + len) > prtd->dma_end)
+			len = prtd->dma_end - pos;
+		if (sunxi_dma_enqueue(prtd->params, pos, len, read) != 0)
+			break;
+		prtd->dma_loaded++;
+		pos += prtd->dma_period;
+		if (pos >= prtd->dma_end)
+			pos = prtd->dma_start;
+	}
+	prtd->dma_pos = pos;
+}
+
+static void sunxi_pcmdma_buffdone(struct sunxi_dma_params *dma, void *dev_id)
+{
+	struct snd_pcm_substream *substream = dev_id;
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
+
+	snd_pcm_period_elapsed(substream);
+
+	/* the channel already runs the next period, put this one back */
+	spin_lock(&prtd->lock);
+	prtd->dma_loaded--;
+	sunxi_pcmdma_enqueue(substream);
+	spin_unlock(&prtd->lock);
+}
+
+int sunxi_pcmdma_open(struct snd_pcm_substream *substream,
+		      const struct snd_pcm_hardware *hw)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct sunxi_pcmdma_runtime *prtd;
+
+	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+	snd_soc_set_runtime_hwparams(substream, hw);
+
+	prtd = kzalloc(sizeof(struct sunxi_pcmdma_runtime), GFP_KERNEL);
+	if (prtd == NULL)
+		return -ENOMEM;
+
+	spin_lock_init(&prtd->lock);
+
+	runtime->private_data = prtd;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_open);
+
+int sunxi_pcmdma_close(struct snd_pcm_substream *substream)
+{
+	kfree(substream->runtime->private_data);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_close);
+
+int sunxi_pcmdma_hw_params(struct snd_pcm_substream *substream,
+			   struct snd_pcm_hw_params *params)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct sunxi_pcmdma_runtime *prtd = runtime->private_data;
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	unsigned long totbytes = params_buffer_bytes(params);
+	struct sunxi_dma_params *dma =
+			snd_soc_dai_get_dma_data(rtd->cpu_dai, substream);
+	int ret;
+
+	if (!dma)
+		return 0;
+
+	/* 20 and 24 bit samples sit in 32 bit words like 32 bit ones */
+	prtd->dma_width = snd_pcm_format_physical_width(params_format(params))
+				> 16 ? 32 : 16;
+
+	if (prtd->params == NULL) {
+		prtd->params = dma;
+		ret = sunxi_dma_request(prtd->params, 0);
+		if (ret < 0) {
+			pr_err("sunxi-pcmdma: %s dma request failed (%d)\n",
+			       dma->client.name, ret);
+			prtd->params = NULL;
+			return ret;
+		}
+	}
+
+	if (sunxi_dma_set_callback(prtd->params, sunxi_pcmdma_buffdone,
+				   substream) != 0) {
+		pr_err("sunxi-pcmdma: %s dma callback failed\n",
+		       dma->client.name);
+		sunxi_dma_release(prtd->params);
+		prtd->params = NULL;
+		return -EINVAL;
+	}
+
+	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+
+	runtime->dma_bytes = totbytes;
+
+	spin_lock_irq(&prtd->lock);
+	prtd->dma_loaded = 0;
+	/* the whole ring stays queued */
+	prtd->dma_limit = params_periods(params);
+	prtd->dma_period = params_period_bytes(params);
+	prtd->dma_start = runtime->dma_addr;
+	prtd->dma_pos = prtd->dma_start;
+	prtd->dma_end = prtd->dma_start + totbytes;
+	spin_unlock_irq(&prtd->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_hw_params);
+
+int sunxi_pcmdma_hw_free(struct snd_pcm_substream *substream)
+{
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
+
+	if (prtd->params)
+		sunxi_dma_flush(prtd->params);
+
+	snd_pcm_set_runtime_buffer(substream, NULL);
+
+	if (prtd->params) {
+		sunxi_dma_stop(prtd->params);
+		sunxi_dma_release(prtd->params);
+		prtd->params = NULL;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_hw_free);
+
+/* called from the platform's prepare once the channel is configured */
+int sunxi_pcmdma_start_ring(struct snd_pcm_substream *substream)
+{
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
+
+	prtd->dma_loaded = 0;
+	sunxi_dma_flush(prtd->params);
+	prtd->dma_pos = prtd->dma_start;
+
+	sunxi_pcmdma_enqueue(substream);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_start_ring);
+
+int sunxi_pcmdma_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+	struct sunxi_pcmdma_runtime *prtd = substream->runtime->private_data;
+	int ret = 0;
+
+	spin_lock(&prtd->lock);
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		prtd->state |= SUNXI_PCMDMA_RUNNING;
+		sunxi_dma_start(prtd->params);
+		break;
+
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		prtd->state &= ~SUNXI_PCMDMA_RUNNING;
+		sunxi_dma_stop(prtd->params);
+		break;
+
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	spin_unlock(&prtd->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_trigger);
+
+/* from the byte counter of the running period, not at period granularity */
+snd_pcm_uframes_t sunxi_pcmdma_pointer(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct sunxi_pcmdma_runtime *prtd = runtime->private_data;
+	unsigned long bytes = snd_pcm_lib_buffer_bytes(substream);
+	unsigned long res = 0;
+	dma_addr_t src = 0, dst = 0;
+
+	spin_lock(&prtd->lock);
+	if (sunxi_dma_getrunposition(prtd->params, prtd->dma_period,
+				     &src, &dst) == 0) {
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			res = src - prtd->dma_start;
+		else
+			res = dst - prtd->dma_start;
+	}
+	spin_unlock(&prtd->lock);
+
+	if (res >= bytes)
+		res = (res == bytes) ? 0 : res % bytes;
+
+	return bytes_to_frames(runtime, res);
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_pointer);
+
+int sunxi_pcmdma_mmap(struct snd_pcm_substream *substream,
+		      struct vm_area_struct *vma)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	return dma_mmap_writecombine(substream->pcm->card->dev, vma,
+				     runtime->dma_area,
+				     runtime->dma_addr,
+				     runtime->dma_bytes);
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_mmap);
+
+static int sunxi_pcmdma_preallocate(struct snd_pcm *pcm, int stream,
+				    size_t size)
+{
+	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
+	struct snd_dma_buffer *buf = &substream->dma_buffer;
+
+	buf->dev.type = SNDRV_DMA_TYPE_DEV;
+	buf->dev.dev = pcm->card->dev;
+	buf->private_data = NULL;
+	buf->area = dma_alloc_writecombine(pcm->card->dev, size,
+					   &buf->addr, GFP_KERNEL);
+	if (!buf->area)
+		return -ENOMEM;
+	buf->bytes = size;
+	return 0;
+}
+
+void sunxi_pcmdma_free(struct snd_pcm *pcm)
+{
+	struct snd_pcm_substream *substream;
+	struct snd_dma_buffer *buf;
+	int stream;
+
+	for (stream = 0; stream < 2; stream++) {
+		substream = pcm->streams[stream].substream;
+		if (!substream)
+			continue;
+
+		buf = &substream->dma_buffer;
+		if (!buf->area)
+			continue;
+
+		dma_free_writecombine(pcm->card->dev, buf->bytes,
+				      buf->area, buf->addr);
+		buf->area = NULL;
+	}
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_free);
+
+static u64 sunxi_pcmdma_mask = DMA_BIT_MASK(32);
+
+int sunxi_pcmdma_new(struct snd_soc_pcm_runtime *rtd,
+		     size_t out_bytes, size_t in_bytes)
+{
+	struct snd_card *card = rtd->card->snd_card;
+	struct snd_pcm *pcm = rtd->pcm;
+	int ret = 0;
+
+	if (!card->dev->dma_mask)
+		card->dev->dma_mask = &sunxi_pcmdma_mask;
+	if (!card->dev->coherent_dma_mask)
+		card->dev->coherent_dma_mask = 0xffffffff;
+
+	if (pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream) {
+		ret = sunxi_pcmdma_preallocate(pcm, SNDRV_PCM_STREAM_PLAYBACK,
+					       out_bytes);
+		if (ret)
+			return ret;
+	}
+
+	if (pcm->streams[SNDRV_PCM_STREAM_CAPTURE].substream) {
+		ret = sunxi_pcmdma_preallocate(pcm, SNDRV_PCM_STREAM_CAPTURE,
+					       in_bytes);
+		if (ret)
+			sunxi_pcmdma_free(pcm);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sunxi_pcmdma_new);
+
+MODULE_AUTHOR("All winner");
+MODULE_DESCRIPTION("SUNXI PCM DMA ring");
+MODULE_LICENSE("GPL");
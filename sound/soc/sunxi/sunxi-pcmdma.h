@@ -0,0 +1,58 @@
+/*
+ * sound\soc\sunxi\sunxi-pcmdma.h
+ * (C) Copyright 2007-2012
+ * Allwinner Technology Co., Ltd. <www.allwinnertech.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ */
+#ifndef SUNXI_PCMDMA_H_
+#define SUNXI_PCMDMA_H_
+
+#include <sound/pcm.h>
+#include <sound/soc.h>
+#include <plat/dma_compat.h>
+
+/*
+ * PCM ring shared by the i2s and spdif platforms. The whole buffer is
+ * queued on a channel running in continuous mode, the hardware reloads
+ * the next period itself and buffdone only puts the finished one back,
+ * so a late callback doesn't leave the fifo without data. The platform
+ * configures its channel in prepare and then calls
+ * sunxi_pcmdma_start_ring().
+ */
+struct sunxi_pcmdma_runtime {
+	spinlock_t lock;
+	int state;
+	unsigned int dma_loaded;
+	unsigned int dma_limit;
+	unsigned int dma_period;
+	dma_addr_t dma_start;
+	dma_addr_t dma_pos;
+	dma_addr_t dma_end;
+	struct sunxi_dma_params *params;
+	/* DMA data width, 16 or 32 */
+	unsigned int dma_width;
+};
+
+#define SUNXI_PCMDMA_RUNNING	(1<<0)
+
+extern int sunxi_pcmdma_open(struct snd_pcm_substream *substream,
+			     const struct snd_pcm_hardware *hw);
+extern int sunxi_pcmdma_close(struct snd_pcm_substream *substream);
+extern int sunxi_pcmdma_hw_params(struct snd_pcm_substream *substream,
+				  struct snd_pcm_hw_params *params);
+extern int sunxi_pcmdma_hw_free(struct snd_pcm_substream *substream);
+extern int sunxi_pcmdma_start_ring(struct snd_pcm_substream *substream);
+extern int sunxi_pcmdma_trigger(struct snd_pcm_substream *substream, int cmd);
+extern snd_pcm_uframes_t sunxi_pcmdma_pointer(struct snd_pcm_substream *substream);
+extern int sunxi_pcmdma_mmap(struct snd_pcm_substream *substream,
+			     struct vm_area_struct *vma);
+extern int sunxi_pcmdma_new(struct snd_soc_pcm_runtime *rtd,
+			    size_t out_bytes, size_t in_bytes);
+extern void sunxi_pcmdma_free(struct snd_pcm *pcm);
+
+#endif /* SUNXI_PCMDMA_H_ */
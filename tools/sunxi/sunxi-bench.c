@@ -0,0 +1,401 @@
+/*
+ * sunxi-bench: throughput and latency of the sunxi G2D and display engine
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * Every result is one line of key=value pairs, so runs on different
+ * kernels and boards can be compared by a script:
+ *
+ *   test=g2d_fill fmt=argb8888 w=1280 h=720 count=100 us_per_op=2861 mpix_s=322
+ *
+ * The G2D part fills, blits and stretches buffers from /dev/g2d. The
+ * display part times the memory-to-memory scaler of /dev/disp, and
+ * DISP_CMD_LAYER_COMMIT on a small layer of the screen: the ioctl, and
+ * the time until the next vsync latched it. That layer shows up on the
+ * screen while the test runs.
+ *
+ * The memcpy throughput of the dma by size, next to the cpu, is in
+ * /sys/kernel/debug/dma/memcpy_bench in the same format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <linux/fb.h>
+
+#include "../../include/linux/g2d_driver.h"
+#include "../../include/video/sunxi_disp_ioctl.h"
+
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC	_IOW('F', 0x20, __u32)
+#endif
+
+/* both buffers hold a 1280x720 ARGB8888 image */
+#define BUF_W		1280
+#define BUF_H		720
+#define BUF_SIZE	(BUF_W * BUF_H * 4)
+
+/* the window of the layer commit test */
+#define LAYER_W		320
+#define LAYER_H		240
+
+static int iterations = 100;
+
+struct g2d_buf {
+	int idx;
+	__u32 addr;
+};
+
+static const struct {
+	const char *name;
+	g2d_data_fmt fmt;
+	int bpp;
+} g2d_formats[] = {
+	{ "argb8888", G2D_FMT_ARGB_AYUV8888, 4 },
+	{ "rgb565", G2D_FMT_RGB565, 2 },
+};
+
+static const struct {
+	unsigned int w, h;
+} g2d_sizes[] = {
+	{ 320, 240 },
+	{ 640, 480 },
+	{ 1280, 720 },
+};
+
+static unsigned long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void report(const char *test, const char *fmt, unsigned int w,
+		   unsigned int h, int count, unsigned long long us)
+{
+	unsigned long long per_op = us / count;
+
+	printf("test=%s fmt=%s w=%u h=%u count=%d us_per_op=%llu mpix_s=%llu\n",
+	       test, fmt, w, h, count, per_op,
+	       us ? (unsigned long long)w * h * count / us : 0);
+}
+
+static void report_error(const char *test, const char *what)
+{
+	printf("test=%s error=%s errno=%d\n", test, what, errno);
+}
+
+static int g2d_buf_alloc(int fd, struct g2d_buf *buf)
+{
+	buf->idx = ioctl(fd, G2D_CMD_MEM_REQUEST, BUF_SIZE);
+	if (buf->idx < 0)
+		return -1;
+
+	buf->addr = ioctl(fd, G2D_CMD_MEM_GETADR, buf->idx);
+	if ((int)buf->addr == -1) {
+		ioctl(fd, G2D_CMD_MEM_RELEASE, buf->idx);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void g2d_image_init(g2d_image *img, __u32 addr, unsigned int w,
+			   unsigned int h, g2d_data_fmt fmt)
+{
+	memset(img, 0, sizeof(*img));
+	img->addr[0] = addr;
+	img->w = w;
+	img->h = h;
+	img->format = fmt;
+	img->pixel_seq = G2D_SEQ_NORMAL;
+}
+
+static void bench_g2d_fill(int fd, struct g2d_buf *dst, int f, int s)
+{
+	unsigned int w = g2d_sizes[s].w, h = g2d_sizes[s].h;
+	unsigned long long start;
+	g2d_fillrect fill;
+	int i;
+
+	memset(&fill, 0, sizeof(fill));
+	g2d_image_init(&fill.dst_image, dst->addr, w, h, g2d_formats[f].fmt);
+	fill.dst_rect.w = w;
+	fill.dst_rect.h = h;
+	fill.color = 0xff336699;
+
+	start = now_us();
+	for (i = 0; i < iterations; i++) {
+		if (ioctl(fd, G2D_CMD_FILLRECT, &fill) < 0) {
+			report_error("g2d_fill", "ioctl");
+			return;
+		}
+	}
+	report("g2d_fill", g2d_formats[f].name, w, h, iterations,
+	       now_us() - start);
+}
+
+static void bench_g2d_blit(int fd, struct g2d_buf *src, struct g2d_buf *dst,
+			   int f, int s)
+{
+	unsigned int w = g2d_sizes[s].w, h = g2d_sizes[s].h;
+	unsigned long long start;
+	g2d_blt blt;
+	int i;
+
+	memset(&blt, 0, sizeof(blt));
+	g2d_image_init(&blt.src_image, src->addr, w, h, g2d_formats[f].fmt);
+	g2d_image_init(&blt.dst_image, dst->addr, w, h, g2d_formats[f].fmt);
+	blt.src_rect.w = w;
+	blt.src_rect.h = h;
+
+	start = now_us();
+	for (i = 0; i < iterations; i++) {
+		if (ioctl(fd, G2D_CMD_BITBLT, &blt) < 0) {
+			report_error("g2d_blit", "ioctl");
+			return;
+		}
+	}
+	report("g2d_blit", g2d_formats[f].name, w, h, iterations,
+	       now_us() - start);
+}
+
+/* from the full buffer to half of it each way, and back up */
+static void bench_g2d_stretch(int fd, struct g2d_buf *src,
+			      struct g2d_buf *dst, int up)
+{
+	unsigned int sw = up ? BUF_W / 2 : BUF_W, sh = up ? BUF_H / 2 : BUF_H;
+	unsigned int dw = up ? BUF_W : BUF_W / 2, dh = up ? BUF_H : BUF_H / 2;
+	unsigned long long start;
+	g2d_stretchblt str;
+	int i;
+
+	memset(&str, 0, sizeof(str));
+	g2d_image_init(&str.src_image, src->addr, sw, sh, G2D_FMT_ARGB_AYUV8888);
+	g2d_image_init(&str.dst_image, dst->addr, dw, dh, G2D_FMT_ARGB_AYUV8888);
+	str.src_rect.w = sw;
+	str.src_rect.h = sh;
+	str.dst_rect.w = dw;
+	str.dst_rect.h = dh;
+
+	start = now_us();
+	for (i = 0; i < iterations; i++) {
+		if (ioctl(fd, G2D_CMD_STRETCHBLT, &str) < 0) {
+			report_error(up ? "g2d_stretch_up" : "g2d_stretch_down",
+				     "ioctl");
+			return;
+		}
+	}
+	/* the rate is of the bigger side */
+	report(up ? "g2d_stretch_up" : "g2d_stretch_down", "argb8888",
+	       BUF_W, BUF_H, iterations, now_us() - start);
+}
+
+static void disp_fb_init(__disp_fb_t *fb, __u32 addr, unsigned int w,
+			 unsigned int h)
+{
+	memset(fb, 0, sizeof(*fb));
+	fb->addr[0] = addr;
+	fb->size.width = w;
+	fb->size.height = h;
+	fb->format = DISP_FORMAT_ARGB8888;
+	fb->seq = DISP_SEQ_ARGB;
+	fb->mode = DISP_MOD_INTERLEAVED;
+	fb->cs_mode = DISP_BT601;
+}
+
+static void bench_disp_scaler(int fd, int sel, struct g2d_buf *src,
+			      struct g2d_buf *dst)
+{
+	unsigned long args[4] = { sel, 0, 0, 0 };
+	__disp_scaler_para_t para;
+	unsigned long long start;
+	int handle, i;
+
+	handle = ioctl(fd, DISP_CMD_SCALER_REQUEST, args);
+	if (handle <= 0) {
+		report_error("disp_scaler", "request");
+		return;
+	}
+
+	memset(&para, 0, sizeof(para));
+	disp_fb_init(&para.input_fb, src->addr, BUF_W, BUF_H);
+	para.source_regn.width = BUF_W;
+	para.source_regn.height = BUF_H;
+	disp_fb_init(&para.output_fb, dst->addr, BUF_W / 2, BUF_H / 2);
+
+	args[1] = handle;
+	args[2] = (unsigned long)&para;
+	start = now_us();
+	for (i = 0; i < iterations; i++) {
+		if (ioctl(fd, DISP_CMD_SCALER_EXECUTE, args) < 0) {
+			report_error("disp_scaler", "execute");
+			break;
+		}
+	}
+	if (i == iterations)
+		report("disp_scaler", "argb8888", BUF_W, BUF_H, iterations,
+		       now_us() - start);
+
+	args[2] = 0;
+	ioctl(fd, DISP_CMD_SCALER_RELEASE, args);
+}
+
+/*
+ * Flip a layer between the two buffers. Each commit is latched at the
+ * next vblank, so the wait for the vsync after it is the latency a
+ * compositor sees.
+ */
+static void bench_disp_commit(int fd, int fb_fd, int sel, struct g2d_buf *a,
+			      struct g2d_buf *b)
+{
+	unsigned long args[4] = { sel, DISP_LAYER_WORK_MODE_NORMAL, 0, 0 };
+	unsigned long long start, t, ioctl_us = 0, latch_us = 0;
+	__disp_layer_commit_t commit;
+	__u32 zero = 0;
+	int hid, i;
+
+	hid = ioctl(fd, DISP_CMD_LAYER_REQUEST, args);
+	if (hid <= 0) {
+		report_error("disp_commit", "request");
+		return;
+	}
+
+	memset(&commit, 0, sizeof(commit));
+	commit.hid = hid;
+	commit.flags = DISP_COMMIT_OPEN | DISP_COMMIT_PARA;
+	commit.para.mode = DISP_LAYER_WORK_MODE_NORMAL;
+	commit.para.prio = 0xff;
+	commit.para.src_win.width = LAYER_W;
+	commit.para.src_win.height = LAYER_H;
+	commit.para.scn_win.width = LAYER_W;
+	commit.para.scn_win.height = LAYER_H;
+	disp_fb_init(&commit.para.fb, a->addr, LAYER_W, LAYER_H);
+
+	args[1] = (unsigned long)&commit;
+	args[2] = 1;
+	if (ioctl(fd, DISP_CMD_LAYER_COMMIT, args) < 0) {
+		report_error("disp_commit", "open");
+		goto release;
+	}
+
+	commit.flags = DISP_COMMIT_FB;
+	for (i = 0; i < iterations; i++) {
+		disp_fb_init(&commit.fb, (i & 1) ? a->addr : b->addr,
+			     LAYER_W, LAYER_H);
+		start = now_us();
+		if (ioctl(fd, DISP_CMD_LAYER_COMMIT, args) < 0) {
+			report_error("disp_commit", "commit");
+			break;
+		}
+		t = now_us();
+		ioctl_us += t - start;
+		if (fb_fd >= 0 && ioctl(fb_fd, FBIO_WAITFORVSYNC, &zero) == 0)
+			latch_us += now_us() - t;
+	}
+	if (i == iterations) {
+		printf("test=disp_commit w=%u h=%u count=%d us_per_op=%llu",
+		       LAYER_W, LAYER_H, iterations, ioctl_us / iterations);
+		if (fb_fd >= 0)
+			printf(" latch_us=%llu", latch_us / iterations);
+		printf("\n");
+	}
+
+	commit.flags = DISP_COMMIT_CLOSE;
+	ioctl(fd, DISP_CMD_LAYER_COMMIT, args);
+release:
+	args[1] = hid;
+	args[2] = 0;
+	ioctl(fd, DISP_CMD_LAYER_RELEASE, args);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-g] [-d] [-n iterations] [-s screen]\n"
+		"  -g  G2D fill, blit and stretch only\n"
+		"  -d  display scaler and layer commit only\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct g2d_buf buf[2];
+	int do_g2d = 0, do_disp = 0, sel = 0;
+	int g2d_fd, disp_fd, fb_fd, c, f, s;
+
+	while ((c = getopt(argc, argv, "gdn:s:")) != -1) {
+		switch (c) {
+		case 'g':
+			do_g2d = 1;
+			break;
+		case 'd':
+			do_disp = 1;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 's':
+			sel = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (iterations <= 0)
+		usage(argv[0]);
+	if (!do_g2d && !do_disp)
+		do_g2d = do_disp = 1;
+
+	/* the buffers of both parts come from the g2d driver */
+	g2d_fd = open("/dev/g2d", O_RDWR);
+	if (g2d_fd < 0) {
+		perror("/dev/g2d");
+		return 1;
+	}
+	if (g2d_buf_alloc(g2d_fd, &buf[0]) || g2d_buf_alloc(g2d_fd, &buf[1])) {
+		perror("G2D_CMD_MEM_REQUEST");
+		return 1;
+	}
+
+	if (do_g2d) {
+		for (f = 0; f < (int)(sizeof(g2d_formats) / sizeof(g2d_formats[0])); f++)
+			for (s = 0; s < (int)(sizeof(g2d_sizes) / sizeof(g2d_sizes[0])); s++) {
+				bench_g2d_fill(g2d_fd, &buf[0], f, s);
+				bench_g2d_blit(g2d_fd, &buf[0], &buf[1], f, s);
+			}
+		bench_g2d_stretch(g2d_fd, &buf[0], &buf[1], 0);
+		bench_g2d_stretch(g2d_fd, &buf[1], &buf[0], 1);
+	}
+
+	if (do_disp) {
+		disp_fd = open("/dev/disp", O_RDWR);
+		if (disp_fd < 0) {
+			perror("/dev/disp");
+		} else {
+			fb_fd = open(sel ? "/dev/fb1" : "/dev/fb0", O_RDWR);
+			bench_disp_scaler(disp_fd, sel, &buf[0], &buf[1]);
+			bench_disp_commit(disp_fd, fb_fd, sel, &buf[0], &buf[1]);
+			if (fb_fd >= 0)
+				close(fb_fd);
+			close(disp_fd);
+		}
+	}
+
+	ioctl(g2d_fd, G2D_CMD_MEM_RELEASE, buf[1].idx);
+	ioctl(g2d_fd, G2D_CMD_MEM_RELEASE, buf[0].idx);
+	close(g2d_fd);
+
+	return 0;
+}